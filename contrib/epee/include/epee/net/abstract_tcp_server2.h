@@ -54,6 +54,9 @@
 #define OXEN_DEFAULT_LOG_CATEGORY "net"
 
 #define ABSTRACT_SERVER_SEND_QUE_MAX_COUNT 1000
+// Limits on how much of the send queue gets coalesced into a single write
+#define ABSTRACT_SERVER_SEND_BATCH_MAX_COUNT 64
+#define ABSTRACT_SERVER_SEND_BATCH_MAX_BYTES (256 * 1024)
 
 namespace epee
 {
@@ -136,6 +139,7 @@ namespace net_utils
     virtual bool release();
     //------------------------------------------------------
     bool do_send_chunk(shared_sv chunk); ///< will send (or queue) a part of data. internal use only
+    void start_write(std::shared_ptr<connection<t_protocol_handler>> self); ///< writes out the front of the send queue; m_send_que_lock must be held
 
     std::shared_ptr<connection<t_protocol_handler> > safe_shared_from_this();
     bool shutdown();
@@ -529,18 +529,11 @@ PRAGMA_WARNING_DISABLE_VS(4355)
             return false;
         }
 
-        auto size_now = m_send_que.front().size();
         if (speed_limit_is_enabled())
 			do_send_handler_write( m_send_que.back().data(), m_send_que.back().size() ); // (((H)))
 
-        CHECK_AND_ASSERT_MES( size_now == m_send_que.front().size(), false, "Unexpected queue size");
         reset_timer(get_default_timeout(), false);
-        using namespace boost::placeholders;
-        boost::asio::async_write(socket(), boost::asio::buffer(m_send_que.front().data(), size_now ) ,
-                                 strand_.wrap(
-                                 boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
-                                 )
-                                 );
+        start_write(std::move(self));
     }
     
     //do_send_handler_stop( ptr , cb ); // empty function
@@ -551,6 +544,31 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   } // do_send_chunk
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_write(std::shared_ptr<connection<t_protocol_handler>> self)
+  {
+    // Called with m_send_que_lock held and no write in progress.  Gathers as many queued messages
+    // as fit into one scatter-gather write rather than writing them one at a time; the queued
+    // shared_sv's are often views into the same broadcast buffer, so nothing gets copied here.
+    std::vector<boost::asio::const_buffer> buffers;
+    size_t bytes = 0;
+    for (const auto& msg : m_send_que)
+    {
+      if (!buffers.empty() && (buffers.size() >= ABSTRACT_SERVER_SEND_BATCH_MAX_COUNT || bytes + msg.size() > ABSTRACT_SERVER_SEND_BATCH_MAX_BYTES))
+        break;
+      buffers.emplace_back(msg.data(), msg.size());
+      bytes += msg.size();
+    }
+    m_send_que_writing = buffers.size();
+
+    using namespace boost::placeholders;
+    boost::asio::async_write(socket(), buffers,
+                             strand_.wrap(
+                             boost::bind(&connection<t_protocol_handler>::handle_write, std::move(self), _1, _2)
+                             )
+                             );
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   std::chrono::milliseconds connection<t_protocol_handler>::get_default_timeout()
   {
     unsigned count;
@@ -701,7 +719,8 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       return;
     }
 
-    m_send_que.pop_front();
+    m_send_que.erase(m_send_que.begin(), m_send_que.begin() + std::min(m_send_que_writing, m_send_que.size()));
+    m_send_que_writing = 0;
     if(m_send_que.empty())
     {
       if(m_want_close_connection)
@@ -712,16 +731,9 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     {
       //have more data to send
 		reset_timer(get_default_timeout(), false);
-		auto size_now = m_send_que.front().size();
 		if (speed_limit_is_enabled())
 			do_send_handler_write_from_queue(e, m_send_que.front().size() , m_send_que.size()); // (((H)))
-		CHECK_AND_ASSERT_MES( size_now == m_send_que.front().size(), void(), "Unexpected queue size");
-        using namespace boost::placeholders;
-        boost::asio::async_write(socket(), boost::asio::buffer(m_send_que.front().data(), size_now) , 
-           strand_.wrap(
-            boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2)
-			  )
-          );
+        start_write(connection<t_protocol_handler>::shared_from_this());
     }
     lock.unlock();
 
@@ -97,6 +97,7 @@ class connection_basic { // not-templated base class for rapid developmet of som
     std::atomic<bool> m_was_shutdown;
     std::mutex m_send_que_lock;
     std::deque<shared_sv> m_send_que;
+    size_t m_send_que_writing = 0; // number of m_send_que entries in the write currently in progress
     std::atomic<bool> m_is_multithreaded;
     /// Strand to ensure the connection's handlers are not called concurrently.
     boost::asio::io_service::strand strand_;
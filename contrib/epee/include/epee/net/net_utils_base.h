@@ -145,6 +145,7 @@ namespace net_utils
                 bool matches(const ipv4_network_address &address) const;
 
 		constexpr uint32_t subnet() const noexcept { return m_ip & ~(0xffffffffull << m_mask); }
+		constexpr uint8_t mask() const noexcept { return m_mask; }
 		std::string str() const;
 		std::string host_str() const;
 		bool is_loopback() const;
@@ -36,6 +36,7 @@
 
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 
 namespace epee
 {
@@ -122,21 +123,54 @@ private:
      return i == 0;
   }
 
-protected:
-  rolling_median_t &operator=(const rolling_median_t&) = delete;
-  rolling_median_t(const rolling_median_t&) = delete;
+  size_t storage_size() const
+  {
+    return N * (sizeof(Item) + sizeof(int) * 2);
+  }
+
+  //allocates storage for N items and points `pos` and `heap` into it
+  void allocate()
+  {
+    data = (Item*)malloc(storage_size());
+    pos = (int*) (data + N);
+    heap = pos + N + (N / 2); //points to middle of storage.
+  }
 
 public:
   //creates new rolling_median_t: to calculate `nItems` running median. 
   rolling_median_t(size_t N): N(N)
   {
-    int size = N * (sizeof(Item) + sizeof(int) * 2);
-    data = (Item*)malloc(size);
-    pos = (int*) (data + N);
-    heap = pos + N + (N / 2); //points to middle of storage.
+    allocate();
     clear();
   }
 
+  //copies make an independent snapshot of the window (and its heaps), so that it can be restored
+  //later without reinserting every item; this is a single O(nItems) memcpy of the storage.
+  rolling_median_t(const rolling_median_t &m)
+  {
+    memcpy(this, &m, sizeof(rolling_median_t));
+    allocate();
+    memcpy(data, m.data, storage_size());
+  }
+  rolling_median_t &operator=(const rolling_median_t &m)
+  {
+    if (this != &m)
+    {
+      if (N != m.N)
+      {
+        free(data);
+        N = m.N;
+        allocate();
+      }
+      memcpy(data, m.data, storage_size());
+      idx = m.idx;
+      minCt = m.minCt;
+      maxCt = m.maxCt;
+      sz = m.sz;
+    }
+    return *this;
+  }
+
   rolling_median_t(rolling_median_t &&m)
   {
     memcpy(this, &m, sizeof(rolling_median_t));
@@ -174,14 +208,13 @@ public:
     return sz;
   }
 
-  //Inserts item, maintains median in O(lg nItems)
-  void insert(Item v)
+private:
+  //replaces the item in queue slot i with v, maintains median in O(lg nItems)
+  void replace(int i, Item v)
   {
-    int p = pos[idx];
-    Item old = data[idx];
-    data[idx] = v;
-    idx = (idx + 1) % N;
-    sz = std::min<int>(sz + 1, N);
+    int p = pos[i];
+    Item old = data[i];
+    data[i] = v;
     if (p > 0)         //new item is in minHeap
     {
       if (minCt < (N - 1) / 2)
@@ -219,6 +252,25 @@ public:
     }
   }
 
+public:
+  //Inserts item, maintains median in O(lg nItems)
+  void insert(Item v)
+  {
+    const int i = idx;
+    idx = (idx + 1) % N;
+    sz = std::min<int>(sz + 1, N);
+    replace(i, v);
+  }
+
+  //Undoes the last insert() once the queue is full, putting back the item that insert() pushed
+  //out of the queue (which the caller has to supply, as it is no longer stored here).  This lets
+  //the window be moved back as well as forward without refilling it, in O(lg nItems)
+  void pop_back(Item evicted)
+  {
+    idx = (idx + N - 1) % N;
+    replace(idx, evicted);
+  }
+
   //returns median item (or average of 2 when item count is even)
   Item median() const
   {
@@ -29,6 +29,7 @@
 #include "../misc_log_ex.h"
 #include "keyvalue_serialization_overloads.h"
 #include "../storages/portable_storage.h"
+#include "../storages/portable_storage_binary_writer.h"
 namespace epee
 {
   /************************************************************************/
@@ -50,13 +51,16 @@ namespace epee
 #define KV_MAP_SERIALIZABLE \
 public: \
   bool store(epee::serialization::portable_storage& st, epee::serialization::section* parent_section = nullptr) const; \
+  bool store(epee::serialization::binary_writer& st, epee::serialization::section* parent_section = nullptr) const; \
   bool _load(epee::serialization::portable_storage& st, epee::serialization::section* parent_section = nullptr); \
   bool load(epee::serialization::portable_storage& st, epee::serialization::section* parent_section = nullptr); \
-  template <bool is_store> bool _serialize_map(epee::serialization::portable_storage& stg, epee::serialization::section* parent_section) const;
+  template <bool is_store, typename Storage> bool _serialize_map(Storage& stg, epee::serialization::section* parent_section) const;
 
 #define KV_SERIALIZE_MAP_CODE_BEGIN(Class) \
   bool Class::store(epee::serialization::portable_storage& st, epee::serialization::section* parent_section) const \
   { return _serialize_map<true>(st, parent_section); } \
+  bool Class::store(epee::serialization::binary_writer& st, epee::serialization::section* parent_section) const \
+  { return _serialize_map<true>(st, parent_section); } \
   bool Class::_load(epee::serialization::portable_storage& st, epee::serialization::section* parent_section) \
   { return _serialize_map<false>(st, parent_section); } \
   bool Class::load(epee::serialization::portable_storage& st, epee::serialization::section* parent_section) \
@@ -65,8 +69,8 @@ public: \
     catch (...) {} \
     return false; \
   } \
-  template <bool is_store> \
-  bool Class::_serialize_map(epee::serialization::portable_storage& stg, epee::serialization::section* parent_section) const { \
+  template <bool is_store, typename Storage> \
+  bool Class::_serialize_map(Storage& stg, epee::serialization::section* parent_section) const { \
     /* de-const if we're being called (from the above non-const _load method) to deserialize */ \
     auto& this_ref = const_cast<std::conditional_t<is_store, const Class, Class>&>(*this);
 
@@ -60,6 +60,7 @@ namespace epee
       class converting_array_iterator {
         array_entry& array;
         size_t index = 0;
+        bool consume = false;
       public:
         using value_type = T;
         using difference_type = std::ptrdiff_t;
@@ -67,15 +68,21 @@ namespace epee
         using reference = T;
         using iterator_category = std::input_iterator_tag;
 
-        explicit converting_array_iterator(array_entry& array) : array{array} {}
-        converting_array_iterator(array_entry& array, bool end) : array{array} {
+        explicit converting_array_iterator(array_entry& array, bool consume = false) : array{array}, consume{consume} {}
+        converting_array_iterator(array_entry& array, bool end, bool consume) : array{array}, consume{consume} {
           if (end)
             index = var::visit([](auto& a) { return a.size(); }, array);
         }
         // Converting dereference operator.  Returns the converted value.  Note that this can throw
-        // if the requested conversion fails.
+        // if the requested conversion fails.  If the storage is consuming its values (see
+        // consume_values()) strings get moved out, so each element can only be dereferenced once.
         T operator*() const {
-          return var::visit([this](auto& a) { T val; convert_t(a[index], val); return val; }, array);
+          return var::visit([this](auto& a) {
+            if constexpr (std::is_same_v<std::remove_reference_t<decltype(a)>, array_t<T>> && std::is_same_v<T, std::string>)
+              if (consume)
+                return std::move(a[index]);
+            T val; convert_t(a[index], val); return val;
+          }, array);
         }
         bool operator==(const converting_array_iterator& other) const { return &array == &other.array && index == other.index; }
         bool operator!=(const converting_array_iterator& other) const { return !(*this == other); }
@@ -102,7 +109,7 @@ namespace epee
         if (!pentry)
           throw std::out_of_range{value_name + " does not exist"};
         auto& ar_entry = var::get<array_entry>(*pentry);
-        return {converting_array_iterator<T>{ar_entry}, converting_array_iterator<T>{ar_entry, true}};
+        return {converting_array_iterator<T>{ar_entry, m_consume}, converting_array_iterator<T>{ar_entry, true, m_consume}};
       }
 
       // Accesses an existing array value of the given type.  If the given value does not exist or
@@ -141,6 +148,11 @@ namespace epee
       bool dump_as_json(std::string& targetObj, size_t indent = 0, bool insert_newlines = true);
       bool load_from_json(std::string_view source);
 
+      /// Makes get_value() and converting_array_range() move string values out of the storage
+      /// rather than copying them, for a storage that was loaded just to be deserialized once.
+      /// Reading the same value a second time then gets an empty string.
+      void consume_values(bool consume = true) { m_consume = consume; }
+
       /// Lets you store a pointer to some arbitrary context object; typically used to pass some
       /// context to dependent child objects.
       template <typename T> void set_context(const T* obj) { context_type = &typeid(T); context = obj; }
@@ -165,6 +177,7 @@ namespace epee
 
       const void* context = nullptr;
       const std::type_info* context_type = nullptr;
+      bool m_consume = false;
 
 #pragma pack(push)
 #pragma pack(1)
@@ -186,6 +199,12 @@ namespace epee
       if(!pentry)
         return false;
 
+      if constexpr (std::is_same_v<T, std::string>)
+        if (auto* str = std::get_if<std::string>(pentry); str && m_consume)
+        {
+          val = std::move(*str);
+          return true;
+        }
       var::visit([&val](const auto& v) { convert_t(v, val); }, *pentry);
       return true;
       //CATCH_ENTRY("portable_storage::template<>get_value", false);
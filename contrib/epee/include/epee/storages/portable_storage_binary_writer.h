@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+#include <oxenc/endian.h>
+#include <oxenc/variant.h>
+
+#include "portable_storage.h"
+#include "../serialization/keyvalue_serialization_overloads.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /// Writes the portable storage binary format directly into a string as a KV-serializable type
+    /// is stored, without building the intermediate `section` tree that `portable_storage` builds
+    /// (and then walks, through an ostream) in store_to_binary.  The output is byte-for-byte what
+    /// `portable_storage` produces: since that stores entries in a std::map, entries written out of
+    /// key order get moved into order when their section is closed, and of entries written more
+    /// than once under the same name only the last is kept.
+    ///
+    /// Types using KV_MAP_SERIALIZABLE get a `store(binary_writer&)` that writes straight into the
+    /// buffer; other serializable types nested inside them (i.e. ones that only have a
+    /// `store(portable_storage&, section*)`) are stored into a temporary section which then gets
+    /// written out.
+    class binary_writer
+    {
+    public:
+      /// Writes the storage header and opens the root section.
+      binary_writer()
+      {
+        write(PORTABLE_STORAGE_SIGNATUREA);
+        write(PORTABLE_STORAGE_SIGNATUREB);
+        write(PORTABLE_STORAGE_FORMAT_VER);
+        begin_section();
+      }
+
+      /// Closes the root section and returns the serialized data.  The writer must not be used
+      /// after calling this.
+      std::string finish()
+      {
+        CHECK_AND_ASSERT_THROW_MES(m_sections.size() == 1, "binary_writer: unclosed section");
+        end_section();
+        return std::move(m_buf);
+      }
+
+      // Interface used by the KV serialization code; this mirrors portable_storage's, except that
+      // the section pointers are ignored: values always go into the most recently opened section.
+
+      template <typename T>
+      bool set_value(std::string_view name, const T& v, section* = nullptr)
+      {
+        static_assert(variant_contains<T, storage_entry> || std::is_same_v<T, storage_entry>);
+        key(name);
+        if constexpr (!std::is_same_v<T, storage_entry> && !std::is_same_v<T, array_entry>)
+          tag(SERIALIZE_TYPE_TAG<T>);
+        write(v);
+        return true;
+      }
+
+      template <typename T> void set_context(const T* obj) { context_type = &typeid(T); context = obj; }
+      void clear_context() { context_type = nullptr; context = nullptr; }
+      template <typename T> const T* get_context() {
+        return (context && context_type && *context_type == typeid(T))
+            ? static_cast<const T*>(context)
+            : nullptr;
+      }
+
+      // Low-level interface: an entry is written by calling key(), then tag() with the entry type,
+      // then the value.
+
+      /// Starts a new entry in the current section.
+      void key(std::string_view name)
+      {
+        CHECK_AND_ASSERT_THROW_MES(name.size() < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: {}, val: {}", name.size(), name);
+        m_entries.push_back(m_buf.size());
+        m_buf += static_cast<char>(name.size());
+        m_buf += name;
+      }
+
+      void tag(uint8_t type) { m_buf += static_cast<char>(type); }
+
+      /// Opens a section: the value of the current entry (after a `SERIALIZE_TYPE_TAG<section>`
+      /// tag) or the next element of a section array.  Must be matched with an end_section().
+      void begin_section()
+      {
+        m_sections.push_back({m_buf.size(), m_entries.size()});
+        m_buf += '\0'; // count placeholder, filled in by end_section()
+      }
+
+      void end_section()
+      {
+        auto sec = m_sections.back();
+        m_sections.pop_back();
+        auto first = m_entries.begin() + sec.first_entry;
+        size_t count = m_entries.end() - first;
+
+        bool sorted = true;
+        for (auto it = first; sorted && it + 1 < m_entries.end(); ++it)
+          sorted = entry_name(*it) < entry_name(*(it + 1));
+        if (!sorted)
+          count = sort_entries(first);
+
+        m_entries.erase(first, m_entries.end());
+        patch_varint(sec.count_pos, 1, count);
+      }
+
+      /// Calls `obj.store()` to write the fields of `obj` into the current (open) section.
+      template <typename T>
+      bool store_object(const T& obj)
+      {
+        if constexpr (requires { obj.store(*this, nullptr); })
+          return obj.store(*this, nullptr);
+        else
+        {
+          portable_storage ps;
+          section sec;
+          bool r = obj.store(ps, &sec);
+          write_entries(sec);
+          return r;
+        }
+      }
+
+      void write_varint(uint64_t v)
+      {
+        char buf[8];
+        m_buf.append(buf, pack_varint(buf, v));
+      }
+
+      template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+      void write(T v)
+      {
+        if constexpr (sizeof(T) > 1)
+          oxenc::host_to_little_inplace(v);
+        m_buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+      }
+
+      void write(double v)
+      {
+        static_assert(std::numeric_limits<double>::is_iec559 && sizeof(double) == 8 && (oxenc::little_endian || oxenc::big_endian));
+        char* buff = reinterpret_cast<char*>(&v);
+        if constexpr (oxenc::big_endian)
+          std::reverse(buff, buff + 8);
+        m_buf.append(buff, 8);
+      }
+
+      void write(const std::string& v) { write_string(v); }
+
+      /// Writes a string value (without its tag).
+      void write_string(std::string_view v)
+      {
+        CHECK_AND_ASSERT_THROW_MES(v.size() < MAX_STRING_LEN_POSSIBLE, "string to store is too large: {}", v.size());
+        write_varint(v.size());
+        m_buf += v;
+      }
+
+      void write(const section& sec)
+      {
+        begin_section();
+        write_entries(sec);
+        end_section();
+      }
+
+      void write(const array_entry& ae)
+      {
+        var::visit([this](const auto& arr) {
+            using T = typename std::remove_cv_t<std::remove_reference_t<decltype(arr)>>::value_type;
+            tag(SERIALIZE_FLAG_ARRAY | SERIALIZE_TYPE_TAG<T>);
+            write_varint(arr.size());
+            for (const auto& v : arr)
+              write(v);
+          }, ae);
+      }
+
+      /// Writes a tagged storage entry.
+      void write(const storage_entry& se)
+      {
+        var::visit([this](const auto& v) {
+            using T = std::remove_cv_t<std::remove_reference_t<decltype(v)>>;
+            if constexpr (!std::is_same_v<T, array_entry>) // array_entry writes a combined flag+type tag
+              tag(SERIALIZE_TYPE_TAG<T>);
+            write(v);
+          }, se);
+      }
+
+      /// Rewrites the `width`-byte varint at `pos` with `value`, which may need a different width.
+      /// Nothing after `pos` must have had its position recorded.
+      void patch_varint(size_t pos, size_t width, uint64_t value)
+      {
+        char buf[8];
+        size_t size = pack_varint(buf, value);
+        if (size == width)
+          std::memcpy(m_buf.data() + pos, buf, size);
+        else
+          m_buf.replace(pos, width, buf, size);
+      }
+
+      size_t size() const { return m_buf.size(); }
+      void reserve(size_t size) { m_buf.reserve(size); }
+
+    private:
+      struct open_section
+      {
+        size_t count_pos;   // position of the count varint in m_buf
+        size_t first_entry; // index of the section's first entry in m_entries
+      };
+
+      static size_t pack_varint(char* out, uint64_t val)
+      {
+        // the two least significant bits are used for size information
+        auto pack = [out](auto v, uint8_t mark) {
+          v <<= 2;
+          v |= mark;
+          if constexpr (sizeof(v) > 1)
+            oxenc::host_to_little_inplace(v);
+          std::memcpy(out, &v, sizeof(v));
+          return sizeof(v);
+        };
+        if (val < (1ULL << 6))
+          return pack(static_cast<uint8_t>(val), PORTABLE_RAW_SIZE_MARK_6BIT);
+        if (val < (1ULL << 14))
+          return pack(static_cast<uint16_t>(val), PORTABLE_RAW_SIZE_MARK_14BIT);
+        if (val < (1ULL << 30))
+          return pack(static_cast<uint32_t>(val), PORTABLE_RAW_SIZE_MARK_30BIT);
+        if (val < (1ULL << 62))
+          return pack(val, PORTABLE_RAW_SIZE_MARK_62BIT);
+        ASSERT_MES_AND_THROW("failed to pack varint -- integer value too large: {} >= 2^62", val);
+      }
+
+      void write_entries(const section& sec)
+      {
+        for (const auto& [name, entry] : sec.m_entries)
+        {
+          key(name);
+          write(entry);
+        }
+      }
+
+      std::string_view entry_name(size_t start) const
+      {
+        return {m_buf.data() + start + 1, static_cast<uint8_t>(m_buf[start])};
+      }
+
+      // Rewrites the entries from `first` (which must be the last entries in the buffer) in the
+      // order portable_storage would write them, and returns the resulting number of entries.
+      size_t sort_entries(std::vector<size_t>::iterator first)
+      {
+        struct range { std::string_view name; size_t start, end; };
+        std::vector<range> ranges;
+        for (auto it = first; it != m_entries.end(); ++it)
+          ranges.push_back({entry_name(*it), *it, it + 1 != m_entries.end() ? *(it + 1) : m_buf.size()});
+        std::stable_sort(ranges.begin(), ranges.end(), [](const range& a, const range& b) { return a.name < b.name; });
+
+        std::string sorted;
+        sorted.reserve(m_buf.size() - *first);
+        size_t count = 0;
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+          if (i + 1 < ranges.size() && ranges[i].name == ranges[i + 1].name)
+            continue; // overwritten by a later value
+          sorted.append(m_buf, ranges[i].start, ranges[i].end - ranges[i].start);
+          count++;
+        }
+        m_buf.replace(*first, std::string::npos, sorted);
+        return count;
+      }
+
+      std::string m_buf;
+      // Start positions of the entries of the currently open sections
+      std::vector<size_t> m_entries;
+      std::vector<open_section> m_sections;
+
+      const void* context = nullptr;
+      const std::type_info* context_type = nullptr;
+    };
+
+    //-------------------------------------------------------------------------------------------------------------------
+    // Overloads of the generic KV serialization functions (keyvalue_serialization_overloads.h) that
+    // write directly rather than through portable_storage's section tree.
+    //-------------------------------------------------------------------------------------------------------------------
+    template<class t_type>
+    bool serialize_t_val_as_blob(const t_type& d, binary_writer& stg, section*, const char* pname)
+    {
+      assert_blob_serializable<t_type>();
+      stg.key(pname);
+      stg.tag(SERIALIZE_TYPE_TAG<std::string>);
+      stg.write_string({reinterpret_cast<const char*>(&d), sizeof(d)});
+      return true;
+    }
+    //-------------------------------------------------------------------------------------------------------------------
+    template<class serializible_type>
+    bool serialize_t_obj(const serializible_type& obj, binary_writer& stg, section*, const char* pname)
+    {
+      stg.key(pname);
+      stg.tag(SERIALIZE_TYPE_TAG<section>);
+      stg.begin_section();
+      bool r = stg.store_object(obj);
+      stg.end_section();
+      return r;
+    }
+    //-------------------------------------------------------------------------------------------------------------------
+    template<class stl_container>
+    bool serialize_stl_container_t_val(const stl_container& container, binary_writer& stg, section*, const char* pname)
+    {
+      using T = typename stl_container::value_type;
+      if(!container.size()) return true;
+      stg.key(pname);
+      stg.tag(SERIALIZE_FLAG_ARRAY | SERIALIZE_TYPE_TAG<T>);
+      stg.write_varint(container.size());
+      for (auto& elem : container)
+        stg.write(static_cast<const T&>(elem));
+      return true;
+    }
+    //-------------------------------------------------------------------------------------------------------------------
+    template<class stl_container>
+    bool serialize_stl_container_pod_val_as_blob(const stl_container& container, binary_writer& stg, section*, const char* pname)
+    {
+      using T = typename stl_container::value_type;
+      assert_blob_serializable<T>();
+
+      if(!container.size()) return true;
+      stg.key(pname);
+      stg.tag(SERIALIZE_TYPE_TAG<std::string>);
+      if constexpr (is_std_vector<stl_container>)
+        stg.write_string({reinterpret_cast<const char*>(container.data()), sizeof(T) * container.size()});
+      else
+      {
+        std::string mb;
+        mb.reserve(sizeof(T) * container.size());
+        for (const auto &v : container)
+          mb.append(reinterpret_cast<const char*>(&v), sizeof(T));
+        stg.write_string(mb);
+      }
+      return true;
+    }
+    //-------------------------------------------------------------------------------------------------------------------
+    template<class stl_container>
+    bool serialize_stl_container_t_obj(const stl_container& container, binary_writer& stg, section*, const char* pname)
+    {
+      if (container.empty()) return true;
+      stg.key(pname);
+      stg.tag(SERIALIZE_FLAG_ARRAY | SERIALIZE_TYPE_TAG<section>);
+      size_t count_pos = stg.size();
+      stg.write_varint(container.size());
+      size_t count_width = stg.size() - count_pos;
+
+      size_t count = 0;
+      for (auto& elem : container)
+      {
+        count++;
+        stg.begin_section();
+        bool r = stg.store_object(elem);
+        stg.end_section();
+        if (!r)
+        {
+          // portable_storage keeps the elements stored so far, including the failed one
+          stg.patch_varint(count_pos, count_width, count);
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+}
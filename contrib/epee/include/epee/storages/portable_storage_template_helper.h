@@ -31,6 +31,7 @@
 
 #include "parserse_base_utils.h"
 #include "portable_storage.h"
+#include "portable_storage_binary_writer.h"
 
 namespace epee
 {
@@ -73,6 +74,7 @@ namespace epee
       if(!rs)
         return false;
 
+      ps.consume_values();
       return out.load(ps);
     }
     //-----------------------------------------------------------------------------------------------------------
@@ -83,15 +85,28 @@ namespace epee
       if (!ps.load_from_binary(binary_buff))
         return false;
 
+      ps.consume_values();
       return out.load(ps);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
     bool store_t_to_binary(t_struct& str_in, std::string& binary_buff, [[maybe_unused]]size_t indent = 0)
     {
-      portable_storage ps;
-      str_in.store(ps);
-      return ps.store_to_binary(binary_buff);
+      if constexpr (requires (binary_writer& w) { str_in.store(w); })
+      {
+        TRY_ENTRY();
+        binary_writer writer;
+        str_in.store(writer);
+        binary_buff = writer.finish();
+        return true;
+        CATCH_ENTRY("store_t_to_binary", false);
+      }
+      else
+      {
+        portable_storage ps;
+        str_in.store(ps);
+        return ps.store_to_binary(binary_buff);
+      }
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -30,7 +30,26 @@ void Keyring_Init(py::module& mod) {
                 return Keyring(spend_priv, spend_pub, view_priv, view_pub, std::move(type));
             }))
 
-            .def("get_main_address", &Keyring::get_main_address);
+            .def("get_main_address", &Keyring::get_main_address)
+            .def(
+                    "get_subaddress_spend_public_keys",
+                    [](Keyring& self, uint32_t account, uint32_t begin, uint32_t end) {
+                        std::vector<crypto::public_key> keys;
+                        {
+                            py::gil_scoped_release release;
+                            keys = self.get_subaddress_spend_public_keys(account, begin, end);
+                        }
+                        // The keys are contiguous, so hand them back as one buffer rather than
+                        // building a Python object for each.
+                        return py::bytes{
+                                reinterpret_cast<const char*>(keys.data()),
+                                keys.size() * sizeof(crypto::public_key)};
+                    },
+                    "Derives the spend public keys of subaddresses account.begin through "
+                    "account.end (inclusive), returned concatenated as 32-byte keys",
+                    py::arg("account"),
+                    py::arg("begin"),
+                    py::arg("end"));
 }
 
 }  // namespace wallet
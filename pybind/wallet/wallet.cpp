@@ -25,7 +25,42 @@ void omq_logger(oxenmq::LogLevel level, const char* file, int line, std::string
 }
 
 namespace wallet {
+
+namespace {
+    // One row of the buffer returned by Wallet.get_available_outputs
+    struct output_record {
+        int64_t amount;
+        int64_t output_index;
+        int64_t global_index;
+        int64_t unlock_time;
+        int64_t block_height;
+        crypto::public_key key;
+        crypto::key_image key_image;
+    };
+    static_assert(sizeof(output_record) == 5 * 8 + 2 * 32);
+    constexpr auto OUTPUT_RECORD_FORMAT = "=5q32s32s";
+
+    struct output_records {
+        std::vector<output_record> rows;
+    };
+}  // namespace
+
 void Wallet_Init(py::module& mod) {
+    // Exposes the records through the buffer protocol, so that e.g. memoryview or numpy can read
+    // them in place instead of getting a Python object per output.
+    py::class_<output_records>(mod, "OutputRecords", py::buffer_protocol())
+            .def("__len__", [](const output_records& r) { return r.rows.size(); })
+            .def_buffer([](output_records& r) {
+                return py::buffer_info{
+                        r.rows.data(),
+                        sizeof(output_record),
+                        OUTPUT_RECORD_FORMAT,
+                        1,
+                        {r.rows.size()},
+                        {sizeof(output_record)},
+                        true};
+            });
+
     py::class_<Wallet, std::shared_ptr<Wallet>>(mod, "Wallet")
             .def(py::init([](const std::string& wallet_name,
                              std::shared_ptr<Keyring> keyring,
@@ -44,6 +79,34 @@ void Wallet_Init(py::module& mod) {
                         std::move(config));
             }))
             .def("get_balance", &Wallet::get_balance)
+            .def(
+                    "get_balances",
+                    [](Wallet& self) {
+                        py::gil_scoped_release release;
+                        return std::make_pair(self.get_balance(), self.get_unlocked_balance());
+                    },
+                    "Returns (balance, unlocked balance) in one call")
+            .def(
+                    "get_available_outputs",
+                    [](Wallet& self, std::optional<int64_t> min_amount) {
+                        py::gil_scoped_release release;
+                        output_records result;
+                        auto outputs = self.get_available_outputs(min_amount);
+                        result.rows.reserve(outputs.size());
+                        for (const auto& o : outputs)
+                            result.rows.push_back(
+                                    {o.amount,
+                                     o.output_index,
+                                     o.global_index,
+                                     o.unlock_time,
+                                     o.block_height,
+                                     o.key,
+                                     o.key_image});
+                        return result;
+                    },
+                    "Returns the spendable outputs as an OutputRecords buffer of (amount, "
+                    "output_index, global_index, unlock_time, block_height, key, key_image) rows",
+                    py::arg("min_amount") = std::nullopt)
             .def("deregister", &Wallet::deregister);
 }
 
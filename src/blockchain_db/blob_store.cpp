@@ -0,0 +1,299 @@
+#include "blob_store.h"
+
+#include <fmt/std.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include "common/format.h"
+#include "logging/oxen_logger.h"
+
+namespace cryptonote {
+
+using namespace std::literals;
+
+static auto logcat = log::Cat("blockchain.db.blobs");
+
+static constexpr std::string_view SEGMENT_PREFIX = "blobs."sv;
+static constexpr int SEGMENT_DIGITS = 6;
+
+#ifndef _WIN32
+
+static std::runtime_error sys_error(std::string_view what, const fs::path& path) {
+    return std::runtime_error{"{} {}: {}"_format(what, path, std::strerror(errno))};
+}
+
+struct blob_store::segment {
+    int fd = -1;
+    void* map = MAP_FAILED;
+    uint64_t map_size = 0;
+    // Bytes of blob data in the segment; only ever grows.
+    std::atomic<uint64_t> size = 0;
+
+    ~segment() {
+        if (map != MAP_FAILED)
+            munmap(map, map_size);
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+blob_store::blob_store(fs::path dir, bool read_only, uint64_t segment_size) :
+        m_dir{std::move(dir)}, m_read_only{read_only}, m_segment_size{segment_size} {
+    if (m_segment_size == 0)
+        throw std::invalid_argument{"blob_store segment size must be non-zero"};
+
+    if (!m_read_only) {
+        std::error_code ec;
+        fs::create_directories(m_dir, ec);
+        if (ec)
+            throw std::runtime_error{
+                    "Failed to create blob store directory {}: {}"_format(m_dir, ec.message())};
+    }
+
+    refresh();
+
+    // The last segment is the one we keep appending into
+    if (!m_read_only && !m_segments.empty()) {
+        uint32_t last = m_segments.size() - 1;
+        m_segments.pop_back();
+        open_segment(last, true);
+    }
+
+    log::debug(logcat, "Opened blob store {} with {} segments", m_dir, m_segments.size());
+}
+
+blob_store::~blob_store() {
+    try {
+        sync();
+    } catch (const std::exception& e) {
+        log::error(logcat, "Failed to sync blob store on close: {}", e.what());
+    }
+}
+
+fs::path blob_store::segment_path(uint32_t index) const {
+    return m_dir / "{}{:0{}d}"_format(SEGMENT_PREFIX, index, SEGMENT_DIGITS);
+}
+
+void blob_store::open_segment(uint32_t index, bool writable, uint64_t min_map_size) {
+    auto path = segment_path(index);
+    auto seg = std::make_unique<segment>();
+    seg->fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (seg->fd < 0)
+        throw sys_error("Failed to open blob segment", path);
+
+    struct stat st;
+    if (fstat(seg->fd, &st) != 0)
+        throw sys_error("Failed to stat blob segment", path);
+    seg->size = static_cast<uint64_t>(st.st_size);
+
+    // Map the full segment size up front (not just what has been written so far) so that later
+    // appends, including those from another process, are readable without remapping.
+    seg->map_size = std::max<uint64_t>({m_segment_size, min_map_size, uint64_t(st.st_size)});
+    seg->map = mmap(nullptr, seg->map_size, PROT_READ, MAP_SHARED, seg->fd, 0);
+    if (seg->map == MAP_FAILED)
+        throw sys_error("Failed to map blob segment", path);
+
+    std::unique_lock lock{m_mutex};
+    if (m_segments.size() <= index)
+        m_segments.resize(index + 1);
+    m_segments[index] = std::move(seg);
+}
+
+void blob_store::start_segment(uint64_t min_size) {
+    uint32_t index = m_segments.size();
+    if (!m_segments.empty()) {
+        // Make sure the segment we are leaving is complete on disk before anything gets written to
+        // the new one
+        sync();
+        if (auto& prev = m_segments.back(); prev && prev->fd >= 0) {
+            close(prev->fd);
+            prev->fd = -1;
+        }
+    }
+
+    auto path = segment_path(index);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        throw sys_error("Failed to create blob segment", path);
+    close(fd);
+
+    // Persist the directory entry, otherwise the new segment could vanish in a crash even after
+    // sync() has flushed its contents.
+    if (int dirfd = ::open(m_dir.c_str(), O_RDONLY); dirfd >= 0) {
+        fsync(dirfd);
+        close(dirfd);
+    }
+
+    // A blob bigger than a whole segment gets a segment to itself, mapped to fit
+    open_segment(index, true, min_size);
+    log::debug(logcat, "Started blob segment {}", path);
+}
+
+void blob_store::refresh() const {
+    std::error_code ec;
+    std::vector<uint32_t> found;
+    for (const auto& entry : fs::directory_iterator{m_dir, ec}) {
+        auto name = entry.path().filename().string();
+        std::string_view sv{name};
+        if (!sv.starts_with(SEGMENT_PREFIX))
+            continue;
+        sv.remove_prefix(SEGMENT_PREFIX.size());
+        uint32_t index;
+        if (sv.size() != SEGMENT_DIGITS ||
+            std::from_chars(sv.data(), sv.data() + sv.size(), index).ptr != sv.data() + sv.size())
+            continue;
+        found.push_back(index);
+    }
+    if (ec)
+        throw std::runtime_error{
+                "Failed to read blob store directory {}: {}"_format(m_dir, ec.message())};
+
+    // Segments can be missing from the start (i.e. if they have been removed to save space), but
+    // the numbering of the rest is never changed.
+    auto& self = const_cast<blob_store&>(*this);
+    for (auto index : found) {
+        std::shared_lock lock{m_mutex};
+        bool have = index < m_segments.size() && m_segments[index];
+        lock.unlock();
+        if (!have)
+            self.open_segment(index, false);
+    }
+}
+
+blob_location blob_store::append(std::string_view blob) {
+    if (m_read_only)
+        throw std::runtime_error{"Cannot append to a read-only blob store"};
+    if (blob.size() > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error{"Blob too large for blob store"};
+
+    if (m_segments.empty() || !m_segments.back() ||
+        m_segments.back()->size + blob.size() > m_segments.back()->map_size)
+        start_segment(blob.size());
+
+    auto& seg = *m_segments.back();
+    blob_location loc;
+    loc.segment = m_segments.size() - 1;
+    loc.size = blob.size();
+    loc.offset = seg.size;
+
+    for (size_t written = 0; written < blob.size();) {
+        auto r = pwrite(seg.fd, blob.data() + written, blob.size() - written, loc.offset + written);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            throw sys_error("Failed to write to blob segment", segment_path(loc.segment));
+        }
+        written += r;
+    }
+
+    seg.size.store(loc.offset + loc.size, std::memory_order_release);
+    m_dirty = true;
+    return loc;
+}
+
+std::string_view blob_store::get(const blob_location& loc) const {
+    for (bool refreshed = false;; refreshed = true) {
+        std::shared_lock lock{m_mutex};
+        const segment* seg =
+                loc.segment < m_segments.size() ? m_segments[loc.segment].get() : nullptr;
+        if (seg) {
+            uint64_t end = loc.offset + loc.size;
+            if (end <= seg->size.load(std::memory_order_acquire))
+                return {static_cast<const char*>(seg->map) + loc.offset, loc.size};
+
+            // Another process may have appended since we last looked
+            if (m_read_only && end <= seg->map_size) {
+                struct stat st;
+                if (fstat(seg->fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= end) {
+                    const_cast<segment*>(seg)->size = st.st_size;
+                    return {static_cast<const char*>(seg->map) + loc.offset, loc.size};
+                }
+            }
+        }
+        lock.unlock();
+
+        if (!m_read_only || refreshed)
+            throw std::out_of_range{"Invalid blob location {}:{}+{}"_format(
+                    loc.segment, loc.offset, loc.size)};
+        refresh();
+    }
+}
+
+void blob_store::sync() {
+    if (!m_dirty || m_segments.empty() || !m_segments.back())
+        return;
+    auto& seg = *m_segments.back();
+#ifdef __APPLE__
+    int r = fsync(seg.fd);
+#else
+    int r = fdatasync(seg.fd);
+#endif
+    if (r != 0)
+        throw sys_error("Failed to sync blob segment", segment_path(m_segments.size() - 1));
+    m_dirty = false;
+}
+
+void blob_store::clear() {
+    if (m_read_only)
+        throw std::runtime_error{"Cannot clear a read-only blob store"};
+    auto files = filenames();
+    {
+        std::unique_lock lock{m_mutex};
+        m_segments.clear();
+        m_dirty = false;
+    }
+    for (const auto& f : files) {
+        std::error_code ec;
+        if (!fs::remove(f, ec) && ec)
+            throw std::runtime_error{
+                    "Failed to remove blob segment {}: {}"_format(f, ec.message())};
+    }
+}
+
+std::vector<fs::path> blob_store::filenames() const {
+    std::vector<fs::path> files;
+    std::shared_lock lock{m_mutex};
+    for (uint32_t i = 0; i < m_segments.size(); i++)
+        if (m_segments[i])
+            files.push_back(segment_path(i));
+    return files;
+}
+
+#else  // _WIN32
+
+struct blob_store::segment {};
+
+blob_store::blob_store(fs::path dir, bool read_only, uint64_t segment_size) :
+        m_dir{std::move(dir)}, m_read_only{read_only}, m_segment_size{segment_size} {
+    throw std::runtime_error{"External blob storage is not supported on Windows"};
+}
+blob_store::~blob_store() = default;
+blob_location blob_store::append(std::string_view) {
+    throw std::logic_error{"not supported"};
+}
+std::string_view blob_store::get(const blob_location&) const {
+    throw std::logic_error{"not supported"};
+}
+void blob_store::sync() {}
+void blob_store::clear() {}
+std::vector<fs::path> blob_store::filenames() const {
+    return {};
+}
+
+#endif
+
+}  // namespace cryptonote
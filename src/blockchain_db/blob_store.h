@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "common/fs.h"
+
+namespace cryptonote {
+
+#pragma pack(push, 1)
+/// Location of a blob inside a blob_store.  This is what gets stored in the database in place of
+/// the blob itself, so its layout must not change.
+struct blob_location {
+    uint32_t segment;
+    uint32_t size;
+    uint64_t offset;
+};
+#pragma pack(pop)
+
+static_assert(
+        sizeof(blob_location) == 16 && std::has_unique_object_representations_v<blob_location>);
+
+/// Append-only storage for immutable blobs, kept in a directory of numbered segment files which are
+/// memory-mapped read-only for lookups.  Finished segments are never rewritten, so the page cache
+/// can share them freely across readers and they can be dropped whole (or moved to other storage)
+/// without touching the database that references them.
+///
+/// The store has no index of its own: callers keep the returned blob_location values (e.g. in
+/// LMDB) and must call sync() before committing anything that refers to newly appended blobs.
+/// Space used by blobs that are no longer referenced (e.g. popped blocks) is not reclaimed.
+///
+/// A single writer may append concurrently with any number of readers.  Views returned by get()
+/// remain valid until the store is cleared or destroyed.
+///
+/// Not supported on Windows; construction throws there.
+class blob_store {
+  public:
+    static constexpr uint64_t DEFAULT_SEGMENT_SIZE = 1ULL << 30;  // 1GiB
+
+    /// Opens the store in `dir`, creating the directory if needed (and not read-only).  Throws
+    /// std::runtime_error on failure.
+    blob_store(fs::path dir, bool read_only, uint64_t segment_size = DEFAULT_SEGMENT_SIZE);
+    ~blob_store();
+
+    blob_store(const blob_store&) = delete;
+    blob_store& operator=(const blob_store&) = delete;
+
+    /// Appends a blob, starting a new segment if it does not fit in the current one.  The data is
+    /// not durable until the next sync().  Throws std::runtime_error on failure.
+    blob_location append(std::string_view blob);
+
+    /// Returns a view of a previously appended blob.  Throws std::out_of_range if the location
+    /// does not refer to data in the store.
+    std::string_view get(const blob_location& loc) const;
+
+    /// Flushes appended data to disk.  Does nothing if nothing has been appended since the last
+    /// sync.
+    void sync();
+
+    /// Removes all segments.  Any outstanding views become invalid.
+    void clear();
+
+    /// Returns the paths of all current segment files.
+    std::vector<fs::path> filenames() const;
+
+    const fs::path& directory() const { return m_dir; }
+
+  private:
+    struct segment;
+
+    fs::path segment_path(uint32_t index) const;
+    void open_segment(uint32_t index, bool writable, uint64_t min_map_size = 0);
+    void start_segment(uint64_t min_size);
+    void refresh() const;
+
+    fs::path m_dir;
+    const bool m_read_only;
+    const uint64_t m_segment_size;
+
+    mutable std::shared_mutex m_mutex;
+    mutable std::vector<std::unique_ptr<segment>> m_segments;
+    bool m_dirty = false;
+};
+
+}  // namespace cryptonote
@@ -30,6 +30,11 @@
 #include "blockchain_db.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
 
 #include "checkpoints/checkpoints.h"
 #include "common/exception.h"
@@ -49,10 +54,28 @@ static auto logcat = log::Cat("blockchain.db");
 const command_line::arg_descriptor<std::string> arg_db_sync_mode = {
         "db-sync-mode",
         "Specify sync option, using format "
-        "[safe|fast|fastest]:[sync|async]:[<nblocks_per_sync>[blocks]|<nbytes_per_sync>[bytes]].",
+        "[safe|fast|fastest]:[sync|async]:[<nblocks_per_sync>[blocks]|<nbytes_per_sync>[bytes]|"
+        "<max_delay>[ms|s]]. With a delay, block writes are committed without syncing and a "
+        "background sync makes them durable within that much time.",
         "fast:async:250000000bytes"};
 const command_line::arg_flag arg_db_salvage = {
         "db-salvage", "Try to salvage a blockchain database if it seems corrupted"};
+const command_line::arg_flag arg_db_external_blobs = {
+        "db-external-blobs",
+        "Store block blobs in append-only files alongside the database instead of inside it. Only "
+        "takes effect when creating a new database; not supported on Windows."};
+
+const command_line::arg_descriptor<uint64_t> arg_db_hot_cache_size = {
+        "db-hot-cache-size",
+        "Keep the block and transaction blobs of the most recent blocks, up to this many MiB, in "
+        "memory to serve reads of them without going to the database. 0 disables.",
+        0};
+
+const command_line::arg_flag arg_db_spending_index = {
+        "db-spending-index",
+        "Maintain an index of the transactions spending each key image and creating each output "
+        "key, for the get_spending_tx RPC. Only covers blocks added while it is enabled; running "
+        "without it drops the index."};
 
 std::unique_ptr<BlockchainDB> new_db() {
     return std::make_unique<BlockchainLMDB>();
@@ -61,6 +84,9 @@ std::unique_ptr<BlockchainDB> new_db() {
 void BlockchainDB::init_options(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_db_sync_mode);
     command_line::add_arg(desc, arg_db_salvage);
+    command_line::add_arg(desc, arg_db_external_blobs);
+    command_line::add_arg(desc, arg_db_hot_cache_size);
+    command_line::add_arg(desc, arg_db_spending_index);
 }
 
 void BlockchainDB::pop_block() {
@@ -385,6 +411,182 @@ uint64_t BlockchainDB::get_tx_block_height(const crypto::hash& h) const {
     return result;
 }
 
+std::vector<std::optional<tx_lookup>> BlockchainDB::get_txs_data(
+        const std::vector<crypto::hash>& hs) const {
+    std::vector<std::optional<tx_lookup>> result;
+    result.reserve(hs.size());
+    auto heights = get_tx_block_heights(hs);
+    for (size_t i = 0; i < hs.size(); i++) {
+        auto& tx = result.emplace_back();
+        uint64_t tx_id;
+        if (heights[i] == std::numeric_limits<uint64_t>::max() || !tx_exists(hs[i], tx_id))
+            continue;
+        tx.emplace();
+        tx->hash = hs[i];
+        tx->block_height = heights[i];
+        if (!get_pruned_tx_blob(hs[i], tx->pruned)) {
+            tx.reset();
+            continue;
+        }
+        if (!get_prunable_tx_hash(hs[i], tx->prunable_hash))
+            tx->prunable_hash = crypto::null<crypto::hash>;
+        if (!get_prunable_tx_blob(hs[i], tx->prunable))
+            tx->prunable.clear();
+        tx->output_indices = std::move(get_tx_amount_output_indices(tx_id, 1).front());
+    }
+    return result;
+}
+
+bool BlockchainDB::for_blocks_range_parallel(
+        uint64_t h1,
+        uint64_t h2,
+        const std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)>& f,
+        bool ordered,
+        unsigned threads) const {
+    if (h2 < h1)
+        return true;
+    const uint64_t count = h2 - h1 + 1;
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // Not worth starting up threads for (or not possible, if we have uncommitted writes that the
+    // threads wouldn't see):
+    if (threads == 1 || count <= 64 || write_txn_active())
+        return for_blocks_range(h1, h2, f);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop = false;
+    std::exception_ptr error;
+    auto set_error = [&] {
+        std::lock_guard lock{mutex};
+        if (!error)
+            error = std::current_exception();
+        stop = true;
+        cv.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    auto finish = [&] {
+        {
+            std::lock_guard lock{mutex};
+            stop = true;
+            cv.notify_all();
+        }
+        for (auto& t : workers)
+            t.join();
+        workers.clear();
+    };
+
+    if (!ordered) {
+        threads = std::min<uint64_t>(threads, count);
+        std::atomic<bool> failed = false;
+        auto scan = [&](uint64_t from, uint64_t to) {
+            try {
+                for_blocks_range(
+                        from,
+                        to,
+                        [&](uint64_t height, const crypto::hash& hash, const cryptonote::block& b) {
+                            if (failed || !f(height, hash, b)) {
+                                failed = true;
+                                return false;
+                            }
+                            return true;
+                        });
+            } catch (...) {
+                set_error();
+                failed = true;
+            }
+        };
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back(
+                    scan, h1 + count * i / threads, h1 + count * (i + 1) / threads - 1);
+        scan(h1, h1 + count / threads - 1);
+        finish();
+        if (error)
+            std::rethrow_exception(error);
+        return !failed;
+    }
+
+    // Ordered: the threads each read a batch at a time (staying no more than a couple of batches
+    // per thread ahead of `f`) and we hand the batches to `f` in order.
+    constexpr uint64_t BATCH = 64;
+    struct parsed_block {
+        uint64_t height;
+        crypto::hash hash;
+        cryptonote::block block;
+    };
+    const uint64_t n_batches = (count + BATCH - 1) / BATCH;
+    const uint64_t max_ahead = 2 * threads;
+    threads = std::min<uint64_t>(threads, n_batches);
+    std::map<uint64_t, std::vector<parsed_block>> ready;
+    uint64_t next_batch = 0, consumed = 0;
+
+    auto reader = [&] {
+        while (true) {
+            uint64_t batch;
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&] {
+                    return stop || next_batch >= n_batches || next_batch < consumed + max_ahead;
+                });
+                if (stop || next_batch >= n_batches)
+                    return;
+                batch = next_batch++;
+            }
+            std::vector<parsed_block> blocks;
+            try {
+                const uint64_t from = h1 + batch * BATCH;
+                blocks.reserve(std::min(BATCH, h2 - from + 1));
+                for_blocks_range(
+                        from,
+                        std::min(from + BATCH - 1, h2),
+                        [&](uint64_t height, const crypto::hash& hash, const cryptonote::block& b) {
+                            blocks.push_back({height, hash, b});
+                            return true;
+                        });
+            } catch (...) {
+                set_error();
+                return;
+            }
+            std::lock_guard lock{mutex};
+            ready.emplace(batch, std::move(blocks));
+            cv.notify_all();
+        }
+    };
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(reader);
+
+    bool result = true;
+    try {
+        for (uint64_t batch = 0; result && batch < n_batches; batch++) {
+            std::vector<parsed_block> blocks;
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&] { return stop || ready.count(batch); });
+                auto it = ready.find(batch);
+                if (it == ready.end())
+                    break;
+                blocks = std::move(it->second);
+                ready.erase(it);
+                consumed = batch + 1;
+                cv.notify_all();
+            }
+            for (const auto& [height, hash, block] : blocks)
+                if (!f(height, hash, block)) {
+                    result = false;
+                    break;
+                }
+        }
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    if (error)
+        std::rethrow_exception(error);
+    return result;
+}
+
 bool BlockchainDB::get_alt_block_header(
         const crypto::hash& blkid,
         alt_block_data_t* data,
@@ -423,6 +625,10 @@ void BlockchainDB::fill_timestamps_and_difficulties_for_pow(
     timestamps.reserve(block_count);
     difficulties.reserve(block_count);
 
+    if (timestamps_difficulty_height == chain_height && !timestamps.empty() &&
+        timestamps.size() == difficulties.size() && timestamps.size() <= block_count)
+        return;
+
     if (timestamps_difficulty_height == 0 || (chain_height - timestamps_difficulty_height) != 1 ||
         timestamps.size() > block_count || difficulties.size() > block_count) {
         // Cache invalidated.
@@ -452,4 +658,43 @@ void BlockchainDB::fill_timestamps_and_difficulties_for_pow(
             get_block_cumulative_difficulty(top_block_height));
 }
 
+bool BlockchainDB::pop_timestamp_and_difficulty_for_pow(
+        cryptonote::network_type nettype,
+        std::vector<uint64_t>& timestamps,
+        std::vector<uint64_t>& difficulties,
+        uint64_t chain_height) const {
+    constexpr uint64_t MIN_CHAIN_HEIGHT = 2;
+    if (chain_height < MIN_CHAIN_HEIGHT || timestamps.empty() ||
+        timestamps.size() != difficulties.size() || timestamps.size() > chain_height)
+        return false;
+
+    timestamps.pop_back();
+    difficulties.pop_back();
+
+    bool const before_hf16 = !is_hard_fork_at_least(nettype, hf::hf16_pulse, chain_height);
+    uint64_t const block_count = old::DIFFICULTY_BLOCKS_COUNT(before_hf16);
+    uint64_t start_height = chain_height - std::min<size_t>(chain_height, block_count);
+    start_height = std::max<uint64_t>(start_height, 1);
+
+    // The arrays now hold [chain_height - size, chain_height); the window we want starts at
+    // start_height, which is normally one block lower (but can differ across the hf16 change
+    // of window size).
+    uint64_t have_start = chain_height - timestamps.size();
+    if (have_start < start_height) {
+        uint64_t const excess = start_height - have_start;
+        timestamps.erase(timestamps.begin(), timestamps.begin() + excess);
+        difficulties.erase(difficulties.begin(), difficulties.begin() + excess);
+    } else if (have_start > start_height) {
+        std::vector<uint64_t> older_timestamps, older_difficulties;
+        for (uint64_t block_height = start_height; block_height < have_start; block_height++) {
+            older_timestamps.push_back(get_block_timestamp(block_height));
+            older_difficulties.push_back(get_block_cumulative_difficulty(block_height));
+        }
+        timestamps.insert(timestamps.begin(), older_timestamps.begin(), older_timestamps.end());
+        difficulties.insert(
+                difficulties.begin(), older_difficulties.begin(), older_difficulties.end());
+    }
+    return true;
+}
+
 }  // namespace cryptonote
@@ -33,6 +33,7 @@
 
 #include <boost/program_options.hpp>
 #include <exception>
+#include <optional>
 #include <string>
 
 #include "common/command_line.h"
@@ -107,8 +108,26 @@ struct checkpoint_t;
 /** a pair of <transaction hash, output index>, typedef for convenience */
 typedef std::pair<crypto::hash, uint64_t> tx_out_index;
 
-extern const command_line::arg_descriptor<std::string> arg_db_sync_mode;
+/** the transaction that spent a key image, and the height of its block */
+struct spending_tx {
+    crypto::hash txid;
+    uint64_t height;
+};
+
+/** a stored transaction's blobs along with its chain metadata, as fetched by get_txs_data() */
+struct tx_lookup {
+    crypto::hash hash;
+    std::string pruned;                    //!< the unprunable part of the tx
+    crypto::hash prunable_hash;            //!< null for v1 txes, which have no prunable part
+    std::string prunable;                  //!< empty if we don't have (or there is no) prunable data
+    uint64_t block_height;                 //!< the height of the block containing the tx
+    std::vector<uint64_t> output_indices;  //!< the amount-specific indices of the tx's outputs
+};
+ command_line::arg_descriptor<std::string> arg_db_sync_mode;
 extern const command_line::arg_flag arg_db_salvage;
+extern const command_line::arg_flag arg_db_external_blobs;
+extern const command_line::arg_descriptor<uint64_t> arg_db_hot_cache_size;
+extern const command_line::arg_flag arg_db_spending_index;
 
 #pragma pack(push, 1)
 
@@ -175,11 +194,36 @@ static_assert(
         sizeof(txpool_tx_meta_t) == 192 &&
         std::has_unique_object_representations_v<txpool_tx_meta_t>);
 
+/**
+ * @brief access counters of a database table, since startup
+ */
+struct db_table_stats {
+    std::string name;
+    uint64_t gets;
+    uint64_t puts;
+    uint64_t deletes;
+    uint64_t cursor_ops;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+};
+
+/**
+ * @brief database access statistics, since startup; see BlockchainDB::get_stats()
+ */
+struct db_stats {
+    std::vector<db_table_stats> tables;
+    uint64_t commits = 0;
+    double commit_seconds = 0;
+    uint64_t resizes = 0;
+    double resize_seconds = 0;
+};
+
 #define DBF_SAFE 1
 #define DBF_FAST 2
 #define DBF_FASTEST 4
 #define DBF_RDONLY 8
 #define DBF_SALVAGE 0x10
+#define DBF_EXTERNAL_BLOBS 0x20
 
 /***********************************
  * Exception Definitions
@@ -660,6 +704,22 @@ class BlockchainDB {
      */
     virtual std::vector<fs::path> get_filenames() const = 0;
 
+    /**
+     * @brief writes a consistent copy of the open database into a directory
+     *
+     * The copy is of the database as of a single point in time, even if it is being written to
+     * concurrently, and can be opened in place of the original (e.g. after moving it to another
+     * node's data directory).  Any files the database keeps outside of its main file are copied
+     * into the same relative locations under `dir`.
+     *
+     * @param dir the directory to write the copy into; it is created if needed, and must not
+     * already contain a database
+     * @param compact if true, omit free pages from the copy (slower, but smaller)
+     */
+    virtual void copy_to(const fs::path& dir, bool compact = true) const {
+        throw DB_ERROR("This database does not support copying");
+    }
+
     /**
      * @brief remove file(s) storing the database
      *
@@ -785,6 +845,86 @@ class BlockchainDB {
      */
     virtual void set_batch_transactions(bool) = 0;
 
+    /**
+     * @brief sets the memory budget for keeping recent blobs in memory
+     *
+     * Subclasses that support it keep the block and transaction blobs of the most recent blocks
+     * in memory, up to this many bytes, answering reads of them without going to the database.
+     * 0 (the default) disables this.
+     *
+     * @param bytes the maximum size of the blobs to keep
+     */
+    virtual void set_hot_cache_size(size_t bytes) {}
+
+    /**
+     * @brief enables or disables the key image and output key spending index
+     *
+     * Subclasses that support it keep, while enabled, a map of each key image to the transaction
+     * that spent it and of each output key to the transaction (and output index) that created it,
+     * for the blocks added from the moment it is enabled on.  Disabling it drops the index.
+     *
+     * @param enabled whether the index should be maintained
+     */
+    virtual void set_spending_index(bool enabled) {}
+
+    /**
+     * @brief grows the database map ahead of need, if the subclass has one
+     *
+     * Called periodically when idle, so that the map can be grown (which has to wait for all other
+     * database access to finish) at a time that doesn't hold up adding blocks.  Does nothing if a
+     * write is in progress.
+     */
+    virtual void maintain_map_size() {}
+
+    /**
+     * @brief writes out pending txpool changes, if the subclass defers them
+     *
+     * A subclass may hold txpool adds, updates and removals in memory (where the txpool getters
+     * still see them) and write them out in batches; this writes whatever is pending.  Called
+     * periodically by the pool, and should also be done on close.  Does nothing if a write txn is
+     * in progress.
+     */
+    virtual void flush_txpool() {}
+
+    /**
+     * @brief the height from which the spending index covers the chain
+     *
+     * @return the height of the first block indexed, or nullopt if the index isn't enabled
+     */
+    virtual std::optional<uint64_t> spending_index_height() const { return std::nullopt; }
+
+    /**
+     * @brief looks up the transaction that spent a key image in the spending index
+     *
+     * @param img the key image
+     *
+     * @return the spending transaction, or nullopt if it isn't indexed
+     */
+    virtual std::optional<spending_tx> get_spending_tx(const crypto::key_image& img) const {
+        return std::nullopt;
+    }
+
+    /**
+     * @brief looks up the transaction that created an output in the spending index
+     *
+     * @param key the output's one-time public key
+     *
+     * @return the transaction hash and local output index, or nullopt if it isn't indexed
+     */
+    virtual std::optional<tx_out_index> get_output_key_tx(const crypto::public_key& key) const {
+        return std::nullopt;
+    }
+
+    /**
+     * @brief checks whether the calling thread has a write (or batch) txn open
+     *
+     * Reads made from other threads won't see anything written in that txn until it is committed,
+     * so code that hands reads off to other threads has to do them itself while this is true.
+     *
+     * @return true if the calling thread is in a write txn
+     */
+    virtual bool write_txn_active() const { return false; }
+
     virtual void block_wtxn_start() = 0;
     virtual void block_wtxn_stop() = 0;
     virtual void block_wtxn_abort() = 0;
@@ -930,6 +1070,20 @@ class BlockchainDB {
      */
     virtual std::string get_block_blob_from_height(uint64_t height) const = 0;
 
+    /**
+     * @brief fetch a view of a block blob by height
+     *
+     * Like get_block_blob_from_height, but returns a view of the blob as stored in the database
+     * rather than a copy.  The view is only valid for as long as the read txn it was fetched in,
+     * so the caller must already hold one (e.g. via db_rtxn_guard); the subclass should throw
+     * DB_ERROR if there is none.
+     *
+     * @param height the height to look for
+     *
+     * @return a view of the block blob
+     */
+    virtual std::string_view get_block_blob_view_from_height(uint64_t height) const = 0;
+
     /**
      * @brief fetch a block by height
      *
@@ -1310,6 +1464,21 @@ class BlockchainDB {
     virtual bool get_pruned_tx_blobs_from(
             const crypto::hash& h, size_t count, std::vector<std::string>& bd) const = 0;
 
+    /**
+     * @brief fetches views of a number of pruned transaction blobs from the given hash, in
+     * canonical blockchain order
+     *
+     * As get_pruned_tx_blobs_from, but returns views into the database rather than copies.  As
+     * with get_block_blob_view_from_height the caller must hold a read txn for as long as the
+     * views are used.
+     *
+     * @param h the hash to look for
+     *
+     * @return true iff the transactions were found
+     */
+    virtual bool get_pruned_tx_blob_views_from(
+            const crypto::hash& h, size_t count, std::vector<std::string_view>& bd) const = 0;
+
     /**
      * @brief fetches the prunable transaction blob with the given hash
      *
@@ -1396,6 +1565,23 @@ class BlockchainDB {
     virtual std::vector<uint64_t> get_tx_block_heights(
             const std::vector<crypto::hash>& h) const = 0;
 
+    /**
+     * @brief fetches the blobs, block height and output indices of multiple transactions
+     *
+     * Does the work of get_pruned_tx_blob, get_prunable_tx_hash, get_prunable_tx_blob,
+     * get_tx_block_heights and get_tx_amount_output_indices for a whole batch of transactions at
+     * once.  The default implementation just makes those calls for each transaction; subclasses
+     * can override it to visit the transactions in storage order instead, which is much cheaper
+     * when, as is typical, they come from a handful of blocks.
+     *
+     * @param hs the hashes of the desired transactions
+     *
+     * @return the transactions' data in the same order as `hs`, with nullopt for any transaction
+     * not found in the database
+     */
+    virtual std::vector<std::optional<tx_lookup>> get_txs_data(
+            const std::vector<crypto::hash>& hs) const;
+
     // returns the total number of outputs of amount <amount>
     /**
      * @brief fetches the number of outputs of a given amount
@@ -1488,11 +1674,14 @@ class BlockchainDB {
      *
      * This function is a mirror of
      * get_output_data(const uint64_t& amount, const uint64_t& index)
-     * but for a list of outputs rather than just one.
+     * but for a list of outputs rather than just one.  Implementations may look the outputs up in
+     * whatever order is fastest, but always return them in the order requested.
      *
      * @param amounts an output amount, or as many as offsets
      * @param offsets a list of amount-specific output indices
      * @param outputs return-by-reference a list of outputs' metadata
+     * @param allow_partial if true then rather than throwing when an output doesn't exist, return
+     * just the outputs that precede the first (in request order) missing one
      */
     virtual void get_output_key(
             const epee::span<const uint64_t>& amounts,
@@ -1615,6 +1804,23 @@ class BlockchainDB {
      */
     virtual bool prune_blockchain(uint32_t pruning_seed = 0) = 0;
 
+    /**
+     * @brief prunes the blockchain a few transactions at a time
+     *
+     * Does the same pruning as prune_blockchain(), but only looks at up to `max_txs` transactions
+     * per call, each call in its own short write transaction, so that a live database can be
+     * pruned bit by bit without holding up block processing for long.  Each call resumes where
+     * the last one stopped (the position is stored in the database, so this survives restarts).
+     * The first call sets the pruning seed, after which new blocks are tracked for pruning as
+     * usual.  Space freed by pruning is reused by the database rather than returned to the OS.
+     *
+     * @param max_txs the maximum number of transactions to look at
+     * @param pruning_seed the seed to use if not pruned yet, 0 for default (highly recommended)
+     *
+     * @return the approximate fraction of the blockchain (from 0 to 1) pruned so far; 1 once done
+     */
+    virtual double prune_blockchain_step(size_t max_txs, uint32_t pruning_seed = 0) = 0;
+
     /**
      * @brief prunes recent blockchain changes as needed, iff pruning is enabled
      * @return success iff true
@@ -1803,6 +2009,67 @@ class BlockchainDB {
     virtual bool for_all_outputs(
             uint64_t amount, const std::function<bool(uint64_t height)>& f) const = 0;
 
+    /**
+     * @brief runs a function over a range of blocks, on several threads at once
+     *
+     * Splits [h1, h2] into a contiguous slice per thread and runs for_blocks_range() over each
+     * slice on its own thread (each of which, with LMDB, reads through its own read txn).  `f` is
+     * called concurrently from all of the threads, in height order within each slice, and so must
+     * be thread-safe.
+     *
+     * If `ordered` is set the threads instead read and parse the blocks a batch at a time while
+     * `f` is called only from the calling thread, in height order, working through the batches
+     * read so far.  This suits callers that have to process blocks in sequence.
+     *
+     * The threads only see committed data, so if the calling thread is in a write txn (see
+     * write_txn_active()) this just runs for_blocks_range() on the calling thread instead.
+     *
+     * @param h1 the start height
+     * @param h2 the end height (inclusive)
+     * @param f the function to run
+     * @param ordered whether `f` has to be called in height order, from the calling thread
+     * @param threads the number of threads to use, 0 for one per core
+     *
+     * @return false if the function returns false for any block (after which the scan stops
+     * early), otherwise true
+     */
+    bool for_blocks_range_parallel(
+            uint64_t h1,
+            uint64_t h2,
+            const std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)>& f,
+            bool ordered = false,
+            unsigned threads = 0) const;
+
+    /**
+     * @brief runs a function over all transactions stored, on several threads at once
+     *
+     * Like for_all_transactions(), but the transactions are split into `shards` parts (one per
+     * core if 0) that are scanned on separate threads, so `f` is called concurrently and must be
+     * thread-safe.  Transactions come in no particular order.  As with
+     * for_blocks_range_parallel(), this does a serial scan if the calling thread is in a write txn.
+     * Backends without a way to split up the transactions just call for_all_transactions().
+     *
+     * @return false if the function returns false for any transaction, otherwise true
+     */
+    virtual bool for_all_transactions_parallel(
+            std::function<bool(const crypto::hash&, const cryptonote::transaction&)> f,
+            bool pruned,
+            unsigned shards = 0) const {
+        return for_all_transactions(std::move(f), pruned);
+    }
+
+    /**
+     * @brief runs a function over all key images stored, on several threads at once
+     *
+     * The key image equivalent of for_all_transactions_parallel().
+     *
+     * @return false if the function returns false for any key image, otherwise true
+     */
+    virtual bool for_all_key_images_parallel(
+            std::function<bool(const crypto::key_image&)> f, unsigned shards = 0) const {
+        return for_all_key_images(std::move(f));
+    }
+
     /**
      * @brief runs a function over all alternative blocks stored
      *
@@ -1864,6 +2131,13 @@ class BlockchainDB {
      */
     virtual uint64_t get_database_size() const = 0;
 
+    /**
+     * @brief get database access statistics
+     *
+     * @return the statistics, or an empty db_stats if the implementation doesn't keep any
+     */
+    virtual db_stats get_stats() const { return {}; }
+
     /**
      * @brief fix up anything that may be wrong due to past bugs
      */
@@ -1875,6 +2149,22 @@ class BlockchainDB {
     virtual bool get_service_node_data(std::string& data, bool long_term) const = 0;
     virtual void clear_service_node_data() = 0;
 
+    /// Stores the serialized service node state record for a height, replacing any existing record
+    /// at that height.  Records are removed along with everything else by clear_service_node_data().
+    virtual void set_service_node_state(uint64_t height, std::string_view data) = 0;
+
+    /// Removes stored service node state records with heights below `height`.
+    virtual void remove_service_node_states_before(uint64_t height) = 0;
+
+    /// Removes stored service node state records with heights of `height` or above.
+    virtual void remove_service_node_states_from(uint64_t height) = 0;
+
+    /// Calls `f` with the height and serialized data of each stored service node state record, in
+    /// ascending height order.  The data view is only valid during the call.  Stops and returns
+    /// false as soon as `f` returns false, otherwise returns true.
+    virtual bool for_all_service_node_states(
+            std::function<bool(uint64_t height, std::string_view data)> f) const = 0;
+
     /// Updates the given proof data with the latest stored info for the given service node. Returns
     /// true if found (and fields updated), false otherwise.
     virtual bool get_service_node_proof(
@@ -1912,7 +2202,8 @@ class BlockchainDB {
     // timestamps_difficulty_height: The last 'chain_height' that this function
     // was invoked and loaded historical timestamp/difficulties into (allowing
     // this function to be called iteratively on the same input arrays over time).
-    // This should be set to 0 on the initial call.
+    // This should be set to 0 on the initial call.  If it equals chain_height the
+    // arrays are assumed to be up to date already and are left as they are.
     void fill_timestamps_and_difficulties_for_pow(
             cryptonote::network_type nettype,
             std::vector<uint64_t>& timestamps,
@@ -1920,6 +2211,17 @@ class BlockchainDB {
             uint64_t chain_height,
             uint64_t timestamps_difficulty_height) const;
 
+    // Moves timestamps/difficulties, as filled by fill_timestamps_and_difficulties_for_pow() for a
+    // chain of height `chain_height + 1`, down to the window for `chain_height` after the top block
+    // has been popped: the popped block is dropped and the block that moves into the window (if
+    // any) is loaded.  Returns false, leaving the arrays in an unspecified state, if they don't
+    // look like such a window (in which case they need to be refilled from scratch).
+    bool pop_timestamp_and_difficulty_for_pow(
+            cryptonote::network_type nettype,
+            std::vector<uint64_t>& timestamps,
+            std::vector<uint64_t>& difficulties,
+            uint64_t chain_height) const;
+
     /**
      * @brief set whether or not to automatically remove logs
      *
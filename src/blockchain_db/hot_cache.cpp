@@ -0,0 +1,94 @@
+#include "hot_cache.h"
+
+#include <mutex>
+
+namespace cryptonote {
+
+void blob_hot_cache::set_budget(size_t bytes) {
+    std::unique_lock lock{m_mutex};
+    m_budget = bytes;
+    while (m_bytes > m_budget && !m_blocks.empty())
+        erase(m_blocks.begin());
+}
+
+void blob_hot_cache::add_block(
+        uint64_t height,
+        std::string_view block_blob,
+        const std::vector<std::pair<crypto::hash, std::string_view>>& txs) {
+    if (!enabled())
+        return;
+
+    cached_block block{std::string{block_blob}, {}};
+    size_t bytes = block.blob.size();
+    for (auto& [txid, blob] : txs)
+        bytes += blob.size();
+
+    std::unique_lock lock{m_mutex};
+    // Anything already at this height (or above) belongs to a chain we've since left
+    for (auto it = m_blocks.lower_bound(height); it != m_blocks.end();)
+        erase(it++);
+    if (bytes > m_budget)
+        return;
+
+    block.txs.reserve(txs.size());
+    for (auto& [txid, blob] : txs)
+        if (m_txs.emplace(txid, blob).second)
+            block.txs.push_back(txid);
+        else
+            bytes -= blob.size();
+    m_bytes += bytes;
+    m_blocks.emplace(height, std::move(block));
+
+    while (m_bytes > m_budget)
+        erase(m_blocks.begin());
+}
+
+void blob_hot_cache::erase(std::map<uint64_t, cached_block>::iterator it) {
+    m_bytes -= it->second.blob.size();
+    for (auto& txid : it->second.txs)
+        if (auto tx = m_txs.find(txid); tx != m_txs.end()) {
+            m_bytes -= tx->second.size();
+            m_txs.erase(tx);
+        }
+    m_blocks.erase(it);
+}
+
+void blob_hot_cache::pop_blocks(uint64_t height) {
+    std::unique_lock lock{m_mutex};
+    for (auto it = m_blocks.lower_bound(height); it != m_blocks.end();)
+        erase(it++);
+}
+
+void blob_hot_cache::clear() {
+    std::unique_lock lock{m_mutex};
+    m_blocks.clear();
+    m_txs.clear();
+    m_bytes = 0;
+}
+
+std::optional<std::string> blob_hot_cache::block_blob(uint64_t height) const {
+    std::optional<std::string> result;
+    if (!enabled())
+        return result;
+    std::shared_lock lock{m_mutex};
+    if (auto it = m_blocks.find(height); it != m_blocks.end())
+        result = it->second.blob;
+    return result;
+}
+
+std::optional<std::string> blob_hot_cache::tx_blob(const crypto::hash& txid) const {
+    std::optional<std::string> result;
+    if (!enabled())
+        return result;
+    std::shared_lock lock{m_mutex};
+    if (auto it = m_txs.find(txid); it != m_txs.end())
+        result = it->second;
+    return result;
+}
+
+size_t blob_hot_cache::size() const {
+    std::shared_lock lock{m_mutex};
+    return m_bytes;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace cryptonote {
+
+/// In-memory copy of the block and transaction blobs of the most recent blocks, which are what the
+/// great majority of block and tx reads (RPC and serving syncing peers) are for, so that those are
+/// answered without going through the database (and, on slow storage, page faults).
+///
+/// Blocks are added as they are added to the database and dropped as they are popped; when the
+/// blobs held exceed the byte budget the lowest blocks (along with their txs) are evicted.  The
+/// cache holds only blocks the database also has, so it must be cleared whenever something the
+/// database had been given is discarded other than by popping (e.g. an aborted write txn).
+///
+/// All methods may be called concurrently from any threads.
+class blob_hot_cache {
+  public:
+    /// Sets the byte budget for the blobs held (evicting if needed); 0 disables the cache.
+    void set_budget(size_t bytes);
+
+    bool enabled() const { return m_budget > 0; }
+
+    /// Adds the block at `height` with the given blob, and the given (hash, blob) of its
+    /// transactions.  Does nothing if the cache is disabled.
+    void add_block(
+            uint64_t height,
+            std::string_view block_blob,
+            const std::vector<std::pair<crypto::hash, std::string_view>>& txs);
+
+    /// Drops the block at `height` and above, along with their transactions.
+    void pop_blocks(uint64_t height);
+
+    void clear();
+
+    std::optional<std::string> block_blob(uint64_t height) const;
+
+    std::optional<std::string> tx_blob(const crypto::hash& txid) const;
+
+    /// The total size of the blobs currently held
+    size_t size() const;
+
+  private:
+    struct cached_block {
+        std::string blob;
+        std::vector<crypto::hash> txs;
+    };
+
+    void erase(std::map<uint64_t, cached_block>::iterator it);  // Requires a unique lock
+
+    mutable std::shared_mutex m_mutex;
+    std::atomic<size_t> m_budget = 0;
+    size_t m_bytes = 0;
+    std::map<uint64_t, cached_block> m_blocks;
+    std::unordered_map<crypto::hash, std::string> m_txs;
+};
+
+}  // namespace cryptonote
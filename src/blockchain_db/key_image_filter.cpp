@@ -0,0 +1,56 @@
+#include "key_image_filter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cryptonote {
+
+// Bits set per key image.  8 bits at 16 bits per key is close to the optimum for a blocked filter.
+static constexpr int NUM_PROBES = 8;
+
+key_image_filter::key_image_filter(size_t capacity) :
+        m_blocks{std::max<size_t>(1, (capacity * BITS_PER_KEY + 511) / 512)},
+        m_capacity{m_blocks * 512 / BITS_PER_KEY},
+        m_bits{new std::atomic<uint64_t>[m_blocks * BLOCK_WORDS]} {
+    for (size_t i = 0; i < m_blocks * BLOCK_WORDS; i++)
+        m_bits[i].store(0, std::memory_order_relaxed);
+}
+
+std::atomic<uint64_t>* key_image_filter::block_for(const crypto::key_image& ki) const {
+    uint64_t w;
+    std::memcpy(&w, ki.data(), sizeof(w));
+    // Multiply-shift maps the top 32 bits onto [0, m_blocks) without a division
+    return &m_bits[((w >> 32) * m_blocks >> 32) * BLOCK_WORDS];
+}
+
+// Calls f(word, mask) for each of the probe bits of a key image.  These come from the 9-bit
+// fields (i.e. a bit index within the 512-bit block) of the second and third words of the key.
+template <typename F>
+static void for_each_probe(const crypto::key_image& ki, F&& f) {
+    uint64_t w[2];
+    std::memcpy(w, ki.data() + 8, sizeof(w));
+    for (int i = 0; i < NUM_PROBES; i++) {
+        unsigned bit = (w[i / 7] >> (9 * (i % 7))) & 511;
+        f(bit >> 6, uint64_t{1} << (bit & 63));
+    }
+}
+
+void key_image_filter::insert(const crypto::key_image& ki) {
+    auto* block = block_for(ki);
+    for_each_probe(ki, [block](size_t word, uint64_t mask) {
+        block[word].fetch_or(mask, std::memory_order_relaxed);
+    });
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool key_image_filter::maybe_contains(const crypto::key_image& ki) const {
+    auto* block = block_for(ki);
+    bool found = true;
+    for_each_probe(ki, [block, &found](size_t word, uint64_t mask) {
+        if (!(block[word].load(std::memory_order_relaxed) & mask))
+            found = false;
+    });
+    return found;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "crypto/crypto.h"
+
+namespace cryptonote {
+
+/// Fixed-size blocked bloom filter over key images, used to answer most "is this key image spent?"
+/// queries (which are overwhelmingly negative) without a database lookup.  Each key image sets
+/// bits within a single 64-byte block, so a lookup touches one cache line.
+///
+/// Key images are already uniformly distributed, so their bytes are used directly rather than
+/// being hashed again.
+///
+/// Key images can't be removed: a filter is a superset of what has been inserted, and so may give
+/// false positives (about 0.1% at capacity, getting worse beyond it) but never false negatives.
+///
+/// Inserts and lookups are lock-free and may happen concurrently from any threads.
+class key_image_filter {
+  public:
+    /// Creates an empty filter sized for about `capacity` key images.
+    explicit key_image_filter(size_t capacity);
+
+    void insert(const crypto::key_image& ki);
+
+    /// Returns false if the key image was definitely never inserted.
+    bool maybe_contains(const crypto::key_image& ki) const;
+
+    /// The number of inserts made (including repeats).
+    size_t size() const { return m_count.load(std::memory_order_relaxed); }
+
+    /// The number of key images this filter was sized for.
+    size_t capacity() const { return m_capacity; }
+
+  private:
+    static constexpr size_t BLOCK_WORDS = 8;  // 512 bits
+    static constexpr size_t BITS_PER_KEY = 16;
+
+    const size_t m_blocks;
+    const size_t m_capacity;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_bits;
+    std::atomic<size_t> m_count = 0;
+
+    std::atomic<uint64_t>* block_for(const crypto::key_image& ki) const;
+};
+
+}  // namespace cryptonote
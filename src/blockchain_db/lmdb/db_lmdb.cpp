@@ -32,15 +32,23 @@
 #include <fmt/std.h>
 #include <oxenc/endian.h>
 
+#include <algorithm>
+#include <array>
 #include <boost/circular_buffer.hpp>
 #include <chrono>
 #include <cstring>
+#include <exception>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
 #include <type_traits>
 #include <variant>
 
 #include "checkpoints/checkpoints.h"
 #include "common/format.h"
+#include "common/metrics.h"
 #include "common/median.h"
 #include "common/pruning.h"
 #include "common/string_util.h"
@@ -52,6 +60,7 @@
 #include "cryptonote_core/uptime_proof.h"
 #include "epee/string_tools.h"
 #include "logging/oxen_logger.h"
+#include "logging/trace.h"
 #include "oxen/log/level.hpp"
 #include "ringct/rctOps.h"
 
@@ -208,6 +217,11 @@ namespace {
  *
  * alt_blocks       block hash   {block data, block blob}
  *
+ * spent_key_txs     key image    {txn hash, block height}
+ * output_key_txs    output key   {txn hash, local index}
+ *
+ * (The last two are only filled while the optional spending index is enabled.)
+ *
  * Note: where the data items are of uniform size, DUPFIXED tables have
  * been used to save space. In most of these cases, a dummy "zerokval"
  * key is used when accessing the table; the Key listed above will be
@@ -242,23 +256,146 @@ const char* const LMDB_ALT_BLOCKS = "alt_blocks";
 const char* const LMDB_HF_STARTING_HEIGHTS = "hf_starting_heights";
 const char* const LMDB_HF_VERSIONS = "hf_versions";
 const char* const LMDB_SERVICE_NODE_DATA = "service_node_data";
+const char* const LMDB_SERVICE_NODE_STATES = "service_node_states";
 const char* const LMDB_SERVICE_NODE_LATEST =
         "service_node_proofs";  // contains the latest data sent with a proof: time, aux keys, ip,
                                 // ports
 
+const char* const LMDB_SPENT_KEY_TXS = "spent_key_txs";
+const char* const LMDB_OUTPUT_KEY_TXS = "output_key_txs";
+
 const char* const LMDB_PROPERTIES = "properties";
 
-constexpr unsigned int LMDB_DB_COUNT = 23;  // Should agree with the number of db's above
+constexpr unsigned int LMDB_DB_COUNT = 25;  // Should agree with the number of db's above
 
 const char zerokey[8] = {0};
 const MDB_val zerokval = {sizeof(zerokey), (void*)zerokey};
 
+// Per-table access counters, registered in the metrics registry.  Tables are identified by name
+// (so that reopening the database, or opening a second one, keeps adding to the same counters);
+// dbi_counters maps the open handles to them.
+struct table_counters {
+    std::string name;
+    tools::metrics::counter& gets;
+    tools::metrics::counter& puts;
+    tools::metrics::counter& deletes;
+    tools::metrics::counter& cursor_ops;
+    tools::metrics::counter& bytes_read;
+    tools::metrics::counter& bytes_written;
+
+    explicit table_counters(std::string_view table) :
+            name{table},
+            gets{op_counter(table, "get")},
+            puts{op_counter(table, "put")},
+            deletes{op_counter(table, "del")},
+            cursor_ops{op_counter(table, "cursor")},
+            bytes_read{byte_counter(table, "read")},
+            bytes_written{byte_counter(table, "write")} {}
+
+  private:
+    static tools::metrics::counter& op_counter(std::string_view table, const char* op) {
+        return tools::metrics::global().add_counter(
+                "oxen_lmdb_ops_total",
+                "LMDB operations, by table",
+                {{"table", std::string{table}}, {"op", op}});
+    }
+    static tools::metrics::counter& byte_counter(std::string_view table, const char* direction) {
+        return tools::metrics::global().add_counter(
+                "oxen_lmdb_bytes_total",
+                "Bytes of LMDB records read and written, by table",
+                {{"table", std::string{table}}, {"direction", direction}});
+    }
+};
+
+std::mutex table_counters_mutex;
+std::map<std::string, std::unique_ptr<table_counters>, std::less<>> all_table_counters;
+// Indexed by MDB_dbi (which LMDB allocates sequentially, from a small number per environment).
+// Entries are never freed, so the accessors below need no lock.
+std::array<std::atomic<table_counters*>, 64> dbi_counters{};
+
+table_counters* counters(MDB_dbi dbi) {
+    return dbi < dbi_counters.size() ? dbi_counters[dbi].load(std::memory_order_relaxed) : nullptr;
+}
+
+tools::metrics::histogram& commit_times() {
+    static auto& h = tools::metrics::global().add_histogram(
+            "oxen_lmdb_txn_commit_seconds",
+            "Time taken to commit LMDB transactions",
+            {0.0001, 0.001, 0.01, 0.1, 1, 10});
+    return h;
+}
+
+tools::metrics::histogram& resize_times() {
+    static auto& h = tools::metrics::global().add_histogram(
+            "oxen_lmdb_resize_seconds",
+            "Time taken by LMDB memory map resizes",
+            {0.001, 0.01, 0.1, 1, 10});
+    return h;
+}
+
 void lmdb_db_open(
         MDB_txn* txn, const char* name, int flags, MDB_dbi& dbi, const std::string& error_string) {
     if (auto res = mdb_dbi_open(txn, name, flags, &dbi))
         throw0(cryptonote::DB_OPEN_FAILURE(
                 "{}: {} - you may want to start with --db-salvage"_format(
                         error_string, mdb_strerror(res))));
+    if (dbi >= dbi_counters.size())
+        return;
+    std::lock_guard lock{table_counters_mutex};
+    auto it = all_table_counters.find(name);
+    if (it == all_table_counters.end())
+        it = all_table_counters.emplace(name, std::make_unique<table_counters>(name)).first;
+    dbi_counters[dbi] = it->second.get();
+}
+
+// Wrappers around the LMDB record accessors that count the accesses in the table's counters; all
+// record access in this file should go through these.
+int lmdb_get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data) {
+    int res = mdb_get(txn, dbi, key, data);
+    if (auto* c = counters(dbi)) {
+        c->gets.inc();
+        if (res == MDB_SUCCESS)
+            c->bytes_read.inc(data->mv_size);
+    }
+    return res;
+}
+
+int lmdb_put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data, unsigned int flags) {
+    if (auto* c = counters(dbi)) {
+        c->puts.inc();
+        c->bytes_written.inc(key->mv_size + data->mv_size);
+    }
+    return mdb_put(txn, dbi, key, data, flags);
+}
+
+int lmdb_del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data) {
+    if (auto* c = counters(dbi))
+        c->deletes.inc();
+    return mdb_del(txn, dbi, key, data);
+}
+
+int lmdb_cursor_get(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op) {
+    int res = mdb_cursor_get(cursor, key, data, op);
+    if (auto* c = counters(mdb_cursor_dbi(cursor))) {
+        c->cursor_ops.inc();
+        if (res == MDB_SUCCESS && data)
+            c->bytes_read.inc(data->mv_size);
+    }
+    return res;
+}
+
+int lmdb_cursor_put(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags) {
+    if (auto* c = counters(mdb_cursor_dbi(cursor))) {
+        c->puts.inc();
+        c->bytes_written.inc(key->mv_size + data->mv_size);
+    }
+    return mdb_cursor_put(cursor, key, data, flags);
+}
+
+int lmdb_cursor_del(MDB_cursor* cursor, unsigned int flags) {
+    if (auto* c = counters(mdb_cursor_dbi(cursor)))
+        c->deletes.inc();
+    return mdb_cursor_del(cursor, flags);
 }
 
 template <typename T, typename...>
@@ -335,7 +472,7 @@ class iterable_db {
         }
 
         void next(MDB_cursor_op op) {
-            int result = mdb_cursor_get(cursor, &k, &v, op);
+            int result = lmdb_cursor_get(cursor, &k, &v, op);
             if (result == MDB_NOTFOUND) {
                 element = {};
             } else if (result == MDB_SUCCESS) {
@@ -381,6 +518,47 @@ void setup_rcursor(
     }
 }
 
+// Splits the 32-byte hash space into `shards` ranges (one per core if 0) by their most significant
+// word in compare_hash32 order and calls `scan(from, to)` for each one on its own thread (the first
+// on this one), where `from` is nullptr for the first range and `to` is nullptr for the last.
+// Rethrows the first exception thrown by any of the scans once they have all finished.
+template <typename Scan>
+void scan_hash_shards(unsigned shards, Scan&& scan) {
+    if (!shards)
+        shards = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<crypto::hash> bounds(shards);
+    for (unsigned i = 1; i < shards; i++) {
+        uint32_t top = (uint64_t{i} << 32) / shards;
+        std::memcpy(bounds[i].data() + 28, &top, sizeof(top));
+    }
+    auto range = [&](unsigned i) {
+        return std::make_pair(
+                i ? &bounds[i] : nullptr, i + 1 < shards ? &bounds[i + 1] : nullptr);
+    };
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto run = [&](unsigned i) {
+        try {
+            auto [from, to] = range(i);
+            scan(from, to);
+        } catch (...) {
+            std::lock_guard lock{error_mutex};
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(shards - 1);
+    for (unsigned i = 1; i < shards; i++)
+        workers.emplace_back(run, i);
+    run(0);
+    for (auto& t : workers)
+        t.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
 }  // anonymous namespace
 
 #define CURSOR(name) setup_cursor(m_##name, m_cursors->name, *m_write_txn);
@@ -411,6 +589,7 @@ void setup_rcursor(
 #define m_cur_txpool_blob m_cursors->txpool_blob
 #define m_cur_alt_blocks m_cursors->alt_blocks
 #define m_cur_hf_versions m_cursors->hf_versions
+#define m_cur_service_node_states m_cursors->service_node_states
 #define m_cur_properties m_cursors->properties
 
 namespace cryptonote {
@@ -477,6 +656,14 @@ typedef struct outtx {
     uint64_t local_index;
 } outtx;
 
+// Value of the spent_key_txs and output_key_txs tables: the height for the former, the local output
+// index for the latter.
+struct key_tx {
+    crypto::hash tx_hash;
+    uint64_t value;
+};
+static_assert(sizeof(key_tx) == sizeof(crypto::hash) + sizeof(uint64_t));
+
 std::atomic<uint64_t> mdb_txn_safe::num_active_txns{0};
 std::atomic_flag mdb_txn_safe::creation_gate = ATOMIC_FLAG_INIT;
 
@@ -538,7 +725,11 @@ void mdb_txn_safe::commit(std::string message) {
         message = "Failed to commit a transaction to the db";
     }
 
-    if (auto result = mdb_txn_commit(m_txn)) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = mdb_txn_commit(m_txn);
+    commit_times().observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    if (result) {
         m_txn = nullptr;
         throw0(DB_ERROR("{}: {}"_format(message, mdb_strerror(result))));
     }
@@ -577,6 +768,7 @@ void lmdb_resized(MDB_env* env) {
     mdb_txn_safe::prevent_new_txns();
 
     log::info(logcat, "LMDB map resize detected.");
+    auto start = std::chrono::steady_clock::now();
 
     MDB_envinfo mei;
 
@@ -599,9 +791,16 @@ void lmdb_resized(MDB_env* env) {
             new_mapsize / (1024 * 1024));
 
     mdb_txn_safe::allow_new_txns();
+    resize_times().observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
 }
 
 int lmdb_txn_begin(MDB_env* env, MDB_txn* parent, unsigned int flags, MDB_txn** txn) {
+    static auto& read_txns = tools::metrics::global().add_counter(
+            "oxen_lmdb_txns_total", "LMDB transactions started", {{"type", "read"}});
+    static auto& write_txns = tools::metrics::global().add_counter(
+            "oxen_lmdb_txns_total", "LMDB transactions started", {{"type", "write"}});
+    (flags & MDB_RDONLY ? read_txns : write_txns).inc();
     int res = mdb_txn_begin(env, parent, flags, txn);
     if (res == MDB_MAP_RESIZED) {
         lmdb_resized(env);
@@ -626,8 +825,12 @@ void BlockchainLMDB::check_open() const {
 
 void BlockchainLMDB::do_resize(uint64_t increase_size) {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    // Grow by the given size, or else by at least 1GB and enough for the recent write rate to not
+    // need another resize soon.
+    const uint64_t add_size =
+            increase_size > 0 ? increase_size
+                              : std::max<uint64_t>(1LL << 30, predicted_map_growth());
     std::lock_guard lock{*this};
-    const uint64_t add_size = 1LL << 30;
 
     // check disk capacity
     try {
@@ -654,17 +857,10 @@ void BlockchainLMDB::do_resize(uint64_t increase_size) {
 
     mdb_env_stat(m_env, &mst);
 
-    // add 1Gb per resize, instead of doing a percentage increase
     uint64_t new_mapsize = (uint64_t)mei.me_mapsize + add_size;
-
-    // If given, use increase_size instead of above way of resizing.
-    // This is currently used for increasing by an estimated size at start of new
-    // batch txn.
-    if (increase_size > 0)
-        new_mapsize = mei.me_mapsize + increase_size;
-
     new_mapsize += (new_mapsize % mst.ms_psize);
 
+    auto start = std::chrono::steady_clock::now();
     mdb_txn_safe::prevent_new_txns();
 
     if (m_write_txn != nullptr) {
@@ -690,6 +886,67 @@ void BlockchainLMDB::do_resize(uint64_t increase_size) {
             new_mapsize / (1024 * 1024));
 
     mdb_txn_safe::allow_new_txns();
+    resize_times().observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void BlockchainLMDB::record_map_usage() {
+    MDB_envinfo mei;
+    mdb_env_info(m_env, &mei);
+    MDB_stat mst;
+    mdb_env_stat(m_env, &mst);
+    const uint64_t used = mst.ms_psize * mei.me_last_pgno;
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{m_map_usage_mutex};
+    if (!m_map_usage.empty() && now - m_map_usage.back().first < MAP_USAGE_SAMPLE_INTERVAL)
+        return;
+    m_map_usage.emplace_back(now, used);
+    while (m_map_usage.size() > 2 && now - m_map_usage.front().first > MAP_GROWTH_HORIZON)
+        m_map_usage.pop_front();
+}
+
+uint64_t BlockchainLMDB::predicted_map_growth() const {
+    std::lock_guard lock{m_map_usage_mutex};
+    if (m_map_usage.size() < 2)
+        return 0;
+    const auto& [first_time, first_used] = m_map_usage.front();
+    const auto& [last_time, last_used] = m_map_usage.back();
+    if (last_used <= first_used)
+        return 0;
+    // Extrapolate the growth over the samples we have to the full horizon
+    std::chrono::duration<double> span = last_time - first_time;
+    return static_cast<uint64_t>((last_used - first_used) * (MAP_GROWTH_HORIZON / span));
+}
+
+void BlockchainLMDB::maintain_map_size() {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+#if defined(ENABLE_AUTO_RESIZE)
+    check_open();
+    // Resizing has to wait for active txns to finish, which is exactly what we are trying to avoid
+    // doing while blocks are being written.
+    if (m_write_txn || m_batch_active || is_read_only())
+        return;
+
+    MDB_envinfo mei;
+    mdb_env_info(m_env, &mei);
+    MDB_stat mst;
+    mdb_env_stat(m_env, &mst);
+    const uint64_t used = mst.ms_psize * mei.me_last_pgno;
+    const uint64_t remaining = mei.me_mapsize - used;
+
+    // Keep enough room for the predicted growth (and at least MIN_MAP_HEADROOM), and when we fall
+    // short of that grow to twice that, so that this doesn't come up again for a while.
+    const uint64_t headroom = std::max(MIN_MAP_HEADROOM, predicted_map_growth());
+    if (remaining >= headroom && (double)used / mei.me_mapsize <= RESIZE_PERCENT)
+        return;
+    log::info(
+            logcat,
+            "Growing the LMDB map ahead of need: {}MiB remaining, {}MiB predicted to be needed",
+            remaining >> 20,
+            headroom >> 20);
+    do_resize(2 * headroom - std::min(remaining, headroom));
+#endif
 }
 
 // threshold_size is used for batch transactions
@@ -755,7 +1012,7 @@ void BlockchainLMDB::check_and_resize_for_batch(uint64_t batch_num_blocks, uint6
         // Currently we use the greater of threshold size and a minimum size. The
         // minimum size increase is used to avoid frequent resizes when the batch
         // size is set to a very small numbers of blocks.
-        increase_size = (threshold_size > min_increase_size) ? threshold_size : min_increase_size;
+        increase_size = std::max({threshold_size, min_increase_size, predicted_map_growth()});
         log::debug(logcat, "increase size: {}", increase_size);
     }
 
@@ -867,13 +1124,13 @@ void BlockchainLMDB::add_block(
     CURSOR(block_heights)
     blk_height bh = {blk_hash, m_height};
     MDB_val_set(val_h, bh);
-    if (mdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &val_h, MDB_GET_BOTH) == 0)
+    if (lmdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &val_h, MDB_GET_BOTH) == 0)
         throw1(BLOCK_EXISTS("Attempting to add block that's already in the db"));
 
     if (m_height > 0) {
         MDB_val_set(parent_key, blk.prev_id);
-        int result =
-                mdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &parent_key, MDB_GET_BOTH);
+        int result = lmdb_cursor_get(
+                m_cur_block_heights, (MDB_val*)&zerokval, &parent_key, MDB_GET_BOTH);
         if (result) {
             log::trace(logcat, "m_height: {}", m_height);
             log::trace(logcat, "parent_key: {}", blk.prev_id);
@@ -895,8 +1152,21 @@ void BlockchainLMDB::add_block(
 
     // this call to mdb_cursor_put will change height()
     std::string block_blob(block_to_blob(blk));
-    MDB_val_sized(blob, block_blob);
-    result = mdb_cursor_put(m_cur_blocks, &key, &blob, MDB_APPEND);
+    MDB_val blob;
+    blob_location loc;
+    if (m_blob_store) {
+        // The appended data is synced before the write txn commits.  If the txn is aborted instead
+        // it is simply left unreferenced.
+        try {
+            loc = m_blob_store->append(block_blob);
+        } catch (const std::exception& e) {
+            throw0(DB_ERROR("Failed to write block blob: {}"_format(e.what())));
+        }
+        blob = MDB_val{sizeof(loc), &loc};
+    } else {
+        blob = MDB_val{block_blob.size(), block_blob.data()};
+    }
+    result = lmdb_cursor_put(m_cur_blocks, &key, &blob, MDB_APPEND);
     if (result)
         throw0(DB_ERROR(
                 "Failed to add block blob to db transaction: {}"_format(mdb_strerror(result))));
@@ -912,7 +1182,7 @@ void BlockchainLMDB::add_block(
     if (m_height > 0) {
         uint64_t last_height = m_height - 1;
         MDB_val_set(h, last_height);
-        if ((result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &h, MDB_GET_BOTH)))
+        if ((result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &h, MDB_GET_BOTH)))
             throw1(BLOCK_DNE("Failed to get parent block info: {}"_format(mdb_strerror(result))));
         const mdb_block_info* bi_prev = (const mdb_block_info*)h.mv_data;
         bi.bi_cum_rct += bi_prev->bi_cum_rct;
@@ -920,12 +1190,12 @@ void BlockchainLMDB::add_block(
     bi.bi_long_term_block_weight = long_term_block_weight;
 
     MDB_val_set(val, bi);
-    result = mdb_cursor_put(m_cur_block_info, (MDB_val*)&zerokval, &val, MDB_APPENDDUP);
+    result = lmdb_cursor_put(m_cur_block_info, (MDB_val*)&zerokval, &val, MDB_APPENDDUP);
     if (result)
         throw0(DB_ERROR(
                 "Failed to add block info to db transaction: {}"_format(mdb_strerror(result))));
 
-    result = mdb_cursor_put(m_cur_block_heights, (MDB_val*)&zerokval, &val_h, 0);
+    result = lmdb_cursor_put(m_cur_block_heights, (MDB_val*)&zerokval, &val_h, 0);
     if (result)
         throw0(DB_ERROR("Failed to add block height by hash to db transaction: {}"_format(
                 mdb_strerror(result))));
@@ -952,7 +1222,7 @@ void BlockchainLMDB::remove_block() {
     CURSOR(blocks)
     MDB_val_copy<uint64_t> k(m_height - 1);
     MDB_val h = k;
-    if ((result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &h, MDB_GET_BOTH)))
+    if ((result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &h, MDB_GET_BOTH)))
         throw1(BLOCK_DNE("Attempting to remove block that's not in the db: {}"_format(
                 mdb_strerror(result))));
 
@@ -961,21 +1231,23 @@ void BlockchainLMDB::remove_block() {
     blk_height bh = {bi->bi_hash, 0};
     h.mv_data = (void*)&bh;
     h.mv_size = sizeof(bh);
-    if ((result = mdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &h, MDB_GET_BOTH)))
+    if ((result = lmdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &h, MDB_GET_BOTH)))
         throw1(DB_ERROR("Failed to locate block height by hash for removal: {}"_format(
                 mdb_strerror(result))));
-    if ((result = mdb_cursor_del(m_cur_block_heights, 0)))
+    if ((result = lmdb_cursor_del(m_cur_block_heights, 0)))
         throw1(DB_ERROR(
                 "Failed to add removal of block height by hash to db transaction: {}"_format(
                         mdb_strerror(result))));
 
-    if ((result = mdb_cursor_del(m_cur_blocks, 0)))
+    if ((result = lmdb_cursor_del(m_cur_blocks, 0)))
         throw1(DB_ERROR("Failed to add removal of block to db transaction: {}"_format(
                 mdb_strerror(result))));
 
-    if ((result = mdb_cursor_del(m_cur_block_info, 0)))
+    if ((result = lmdb_cursor_del(m_cur_block_info, 0)))
         throw1(DB_ERROR("Failed to add removal of block info to db transaction: {}"_format(
                 mdb_strerror(result))));
+
+    m_hot_cache.pop_blocks(m_height - 1);
 }
 
 uint64_t BlockchainLMDB::add_transaction_data(
@@ -999,7 +1271,7 @@ uint64_t BlockchainLMDB::add_transaction_data(
 
     MDB_val_set(val_tx_id, tx_id);
     MDB_val_set(val_h, tx_hash);
-    result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &val_h, MDB_GET_BOTH);
+    result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &val_h, MDB_GET_BOTH);
     if (result == 0) {
         txindex* tip = (txindex*)val_h.mv_data;
         throw1(TX_EXISTS("Attempting to add transaction that's already in the db (tx id {})"_format(
@@ -1019,7 +1291,7 @@ uint64_t BlockchainLMDB::add_transaction_data(
     val_h.mv_size = sizeof(ti);
     val_h.mv_data = (void*)&ti;
 
-    result = mdb_cursor_put(m_cur_tx_indices, (MDB_val*)&zerokval, &val_h, 0);
+    result = lmdb_cursor_put(m_cur_tx_indices, (MDB_val*)&zerokval, &val_h, 0);
     if (result)
         throw0(DB_ERROR(
                 "Failed to add tx data to db transaction: {}"_format(mdb_strerror(result))));
@@ -1042,20 +1314,20 @@ uint64_t BlockchainLMDB::add_transaction_data(
         throw0(DB_ERROR("pruned tx size is larger than tx size"));
 
     MDB_val pruned_blob = {unprunable_size, (void*)blob.data()};
-    result = mdb_cursor_put(m_cur_txs_pruned, &val_tx_id, &pruned_blob, MDB_APPEND);
+    result = lmdb_cursor_put(m_cur_txs_pruned, &val_tx_id, &pruned_blob, MDB_APPEND);
     if (result)
         throw0(DB_ERROR(
                 "Failed to add pruned tx blob to db transaction: {}"_format(mdb_strerror(result))));
 
     MDB_val prunable_blob = {blob.size() - unprunable_size, (void*)(blob.data() + unprunable_size)};
-    result = mdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
+    result = lmdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
     if (result)
         throw0(DB_ERROR("Failed to add prunable tx blob to db transaction: {}"_format(
                 mdb_strerror(result))));
 
     if (get_blockchain_pruning_seed()) {
         MDB_val_set(val_height, m_height);
-        result = mdb_cursor_put(m_cur_txs_prunable_tip, &val_tx_id, &val_height, 0);
+        result = lmdb_cursor_put(m_cur_txs_prunable_tip, &val_tx_id, &val_height, 0);
         if (result)
             throw0(DB_ERROR("Failed to add prunable tx id to db transaction: {}"_format(
                     mdb_strerror(result))));
@@ -1063,16 +1335,62 @@ uint64_t BlockchainLMDB::add_transaction_data(
 
     if (tx.version >= cryptonote::txversion::v2_ringct) {
         MDB_val_set(val_prunable_hash, tx_prunable_hash);
-        result =
-                mdb_cursor_put(m_cur_txs_prunable_hash, &val_tx_id, &val_prunable_hash, MDB_APPEND);
+        result = lmdb_cursor_put(
+                m_cur_txs_prunable_hash, &val_tx_id, &val_prunable_hash, MDB_APPEND);
         if (result)
             throw0(DB_ERROR("Failed to add prunable tx prunable hash to db transaction: {}"_format(
                     mdb_strerror(result))));
     }
 
+    if (m_spending_index_from)
+        add_spending_index_entries(tx, tx_hash, m_height);
+
     return tx_id;
 }
 
+void BlockchainLMDB::add_spending_index_entries(
+        const transaction& tx, const crypto::hash& tx_hash, uint64_t height) {
+    auto put = [&](MDB_dbi dbi, const auto& key, uint64_t value, std::string_view what) {
+        MDB_val_set(k, key);
+        key_tx kt{tx_hash, value};
+        MDB_val_set(v, kt);
+        if (int result = lmdb_put(*m_write_txn, dbi, &k, &v, 0))
+            throw0(DB_ERROR("Failed to add {} to the spending index: {}"_format(
+                    what, mdb_strerror(result))));
+    };
+    for (const auto& in : tx.vin)
+        if (auto* in_to_key = std::get_if<txin_to_key>(&in))
+            put(m_spent_key_txs, in_to_key->k_image, height, "key image");
+    for (size_t i = 0; i < tx.vout.size(); i++)
+        if (auto* out_to_key = std::get_if<txout_to_key>(&tx.vout[i].target))
+            put(m_output_key_txs, out_to_key->key, i, "output key");
+}
+
+void BlockchainLMDB::remove_spending_index_entries(
+        const transaction& tx, const crypto::hash& tx_hash) {
+    auto del = [&](MDB_dbi dbi, const auto& key, std::string_view what) {
+        MDB_val_set(k, key);
+        MDB_val v;
+        int result = lmdb_get(*m_write_txn, dbi, &k, &v);
+        if (result == MDB_NOTFOUND)
+            return;  // e.g. added before the index was enabled
+        if (result == 0 && v.mv_size == sizeof(key_tx) &&
+            static_cast<const key_tx*>(v.mv_data)->tx_hash != tx_hash)
+            return;  // Belongs to some other tx; leave it alone
+        if (result == 0)
+            result = lmdb_del(*m_write_txn, dbi, &k, nullptr);
+        if (result)
+            throw1(DB_ERROR("Failed to remove {} from the spending index: {}"_format(
+                    what, mdb_strerror(result))));
+    };
+    for (const auto& in : tx.vin)
+        if (auto* in_to_key = std::get_if<txin_to_key>(&in))
+            del(m_spent_key_txs, in_to_key->k_image, "key image");
+    for (const auto& out : tx.vout)
+        if (auto* out_to_key = std::get_if<txout_to_key>(&out.target))
+            del(m_output_key_txs, out_to_key->key, "output key");
+}
+
 // TODO: compare pros and cons of looking up the tx hash's tx index once and
 // passing it in to functions like this
 void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const transaction& tx) {
@@ -1091,21 +1409,21 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
 
     MDB_val_set(val_h, tx_hash);
 
-    if (mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &val_h, MDB_GET_BOTH))
+    if (lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &val_h, MDB_GET_BOTH))
         throw1(TX_DNE("Attempting to remove transaction that isn't in the db"));
     txindex* tip = (txindex*)val_h.mv_data;
     MDB_val_set(val_tx_id, tip->data.tx_id);
 
-    if ((result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, NULL, MDB_SET)))
+    if ((result = lmdb_cursor_get(m_cur_txs_pruned, &val_tx_id, NULL, MDB_SET)))
         throw1(DB_ERROR("Failed to locate pruned tx for removal: {}"_format(mdb_strerror(result))));
-    result = mdb_cursor_del(m_cur_txs_pruned, 0);
+    result = lmdb_cursor_del(m_cur_txs_pruned, 0);
     if (result)
         throw1(DB_ERROR("Failed to add removal of pruned tx to db transaction: {}"_format(
                 mdb_strerror(result))));
 
-    result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
+    result = lmdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
     if (result == 0) {
-        result = mdb_cursor_del(m_cur_txs_prunable, 0);
+        result = lmdb_cursor_del(m_cur_txs_prunable, 0);
         if (result)
             throw1(DB_ERROR("Failed to add removal of prunable tx to db transaction: {}"_format(
                     mdb_strerror(result))));
@@ -1113,21 +1431,21 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
         throw1(DB_ERROR(
                 "Failed to locate prunable tx for removal: {}"_format(mdb_strerror(result))));
 
-    result = mdb_cursor_get(m_cur_txs_prunable_tip, &val_tx_id, NULL, MDB_SET);
+    result = lmdb_cursor_get(m_cur_txs_prunable_tip, &val_tx_id, NULL, MDB_SET);
     if (result && result != MDB_NOTFOUND)
         throw1(DB_ERROR("Failed to locate tx id for removal: {}"_format(mdb_strerror(result))));
     if (result == 0) {
-        result = mdb_cursor_del(m_cur_txs_prunable_tip, 0);
+        result = lmdb_cursor_del(m_cur_txs_prunable_tip, 0);
         if (result)
             throw1(DB_ERROR("Error adding removal of tx id to db transaction{}"_format(
                     mdb_strerror(result))));
     }
 
     if (tx.version >= cryptonote::txversion::v2_ringct) {
-        if ((result = mdb_cursor_get(m_cur_txs_prunable_hash, &val_tx_id, NULL, MDB_SET)))
+        if ((result = lmdb_cursor_get(m_cur_txs_prunable_hash, &val_tx_id, NULL, MDB_SET)))
             throw1(DB_ERROR("Failed to locate prunable hash tx for removal: {}"_format(
                     mdb_strerror(result))));
-        result = mdb_cursor_del(m_cur_txs_prunable_hash, 0);
+        result = lmdb_cursor_del(m_cur_txs_prunable_hash, 0);
         if (result)
             throw1(DB_ERROR(
                     "Failed to add removal of prunable hash tx to db transaction: {}"_format(
@@ -1136,21 +1454,24 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
 
     remove_tx_outputs(tip->data.tx_id, tx);
 
-    result = mdb_cursor_get(m_cur_tx_outputs, &val_tx_id, NULL, MDB_SET);
+    if (m_spending_index_from)
+        remove_spending_index_entries(tx, tx_hash);
+
+    result = lmdb_cursor_get(m_cur_tx_outputs, &val_tx_id, NULL, MDB_SET);
     if (result == MDB_NOTFOUND)
         log::info(logcat, "tx has no outputs to remove: {}", tx_hash);
     else if (result)
         throw1(DB_ERROR(
                 "Failed to locate tx outputs for removal: {}"_format(mdb_strerror(result))));
     if (!result) {
-        result = mdb_cursor_del(m_cur_tx_outputs, 0);
+        result = lmdb_cursor_del(m_cur_tx_outputs, 0);
         if (result)
             throw1(DB_ERROR("Failed to add removal of tx outputs to db transaction: {}"_format(
                     mdb_strerror(result))));
     }
 
     // Don't delete the tx_indices entry until the end, after we're done with val_tx_id
-    if (mdb_cursor_del(m_cur_tx_indices, 0))
+    if (lmdb_cursor_del(m_cur_tx_indices, 0))
         throw1(DB_ERROR("Failed to add removal of tx index to db transaction"));
 }
 
@@ -1179,7 +1500,7 @@ uint64_t BlockchainLMDB::add_output(
     outtx ot = {m_num_outputs, tx_hash, local_index};
     MDB_val_set(vot, ot);
 
-    result = mdb_cursor_put(m_cur_output_txs, (MDB_val*)&zerokval, &vot, MDB_APPENDDUP);
+    result = lmdb_cursor_put(m_cur_output_txs, (MDB_val*)&zerokval, &vot, MDB_APPENDDUP);
     if (result)
         throw0(DB_ERROR(
                 "Failed to add output tx hash to db transaction: {}"_format(mdb_strerror(result))));
@@ -1187,7 +1508,7 @@ uint64_t BlockchainLMDB::add_output(
     outkey ok;
     MDB_val data;
     MDB_val_copy<uint64_t> val_amount(tx_output.amount);
-    result = mdb_cursor_get(m_cur_output_amounts, &val_amount, &data, MDB_SET);
+    result = lmdb_cursor_get(m_cur_output_amounts, &val_amount, &data, MDB_SET);
     if (!result) {
         mdb_size_t num_elems = 0;
         result = mdb_cursor_count(m_cur_output_amounts, &num_elems);
@@ -1212,7 +1533,7 @@ uint64_t BlockchainLMDB::add_output(
     }
     data.mv_data = &ok;
 
-    if ((result = mdb_cursor_put(m_cur_output_amounts, &val_amount, &data, MDB_APPENDDUP)))
+    if ((result = lmdb_cursor_put(m_cur_output_amounts, &val_amount, &data, MDB_APPENDDUP)))
         throw0(DB_ERROR(
                 "Failed to add output pubkey to db transaction: {}"_format(mdb_strerror(result))));
 
@@ -1236,7 +1557,7 @@ void BlockchainLMDB::add_tx_amount_output_indices(
     v.mv_size = sizeof(uint64_t) * num_outputs;
     // log::info(logcat, "tx_outputs[tx_hash] size: {}", v.mv_size);
 
-    result = mdb_cursor_put(m_cur_tx_outputs, &k_tx_id, &v, MDB_APPEND);
+    result = lmdb_cursor_put(m_cur_tx_outputs, &k_tx_id, &v, MDB_APPEND);
     if (result)
         throw0(DB_ERROR(
                 "Failed to add <tx hash, amount output index array> to db transaction: {}"_format(
@@ -1275,7 +1596,7 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
     MDB_val_set(k, amount);
     MDB_val_set(v, out_index);
 
-    auto result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
+    auto result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
     if (result == MDB_NOTFOUND)
         throw1(
                 OUTPUT_DNE("Attempting to get an output index by amount and amount index, but "
@@ -1285,20 +1606,20 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
 
     const pre_rct_outkey* ok = (const pre_rct_outkey*)v.mv_data;
     MDB_val_set(otxk, ok->output_id);
-    result = mdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &otxk, MDB_GET_BOTH);
+    result = lmdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &otxk, MDB_GET_BOTH);
     if (result == MDB_NOTFOUND) {
         throw0(DB_ERROR("Unexpected: global output index not found in m_output_txs"));
     } else if (result) {
         throw1(DB_ERROR("Error adding removal of output tx to db transaction{}"_format(
                 mdb_strerror(result))));
     }
-    result = mdb_cursor_del(m_cur_output_txs, 0);
+    result = lmdb_cursor_del(m_cur_output_txs, 0);
     if (result)
         throw0(DB_ERROR(
                 "Error deleting output index {}: {}"_format(out_index, mdb_strerror(result))));
 
     // now delete the amount
-    result = mdb_cursor_del(m_cur_output_amounts, 0);
+    result = lmdb_cursor_del(m_cur_output_amounts, 0);
     if (result)
         throw0(DB_ERROR("Error deleting amount for output index {}: {}"_format(
                 out_index, mdb_strerror(result))));
@@ -1315,7 +1636,7 @@ void BlockchainLMDB::prune_outputs(uint64_t amount) {
 
     MDB_val v;
     MDB_val_set(k, amount);
-    int result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
+    int result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
     if (result == MDB_NOTFOUND)
         return;
     if (result)
@@ -1331,7 +1652,7 @@ void BlockchainLMDB::prune_outputs(uint64_t amount) {
         const pre_rct_outkey* okp = (const pre_rct_outkey*)v.mv_data;
         output_ids.push_back(okp->output_id);
         log::debug(logcat, "output id {}", okp->output_id);
-        result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_NEXT_DUP);
+        result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_NEXT_DUP);
         if (result == MDB_NOTFOUND)
             break;
         if (result)
@@ -1340,16 +1661,16 @@ void BlockchainLMDB::prune_outputs(uint64_t amount) {
     if (output_ids.size() != num_elems)
         throw0(DB_ERROR("Unexpected number of outputs"));
 
-    result = mdb_cursor_del(m_cur_output_amounts, MDB_NODUPDATA);
+    result = lmdb_cursor_del(m_cur_output_amounts, MDB_NODUPDATA);
     if (result)
         throw0(DB_ERROR("Error deleting outputs: {}"_format(mdb_strerror(result))));
 
     for (uint64_t output_id : output_ids) {
         MDB_val_set(v, output_id);
-        result = mdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+        result = lmdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
         if (result)
             throw0(DB_ERROR("Error looking up output: {}"_format(mdb_strerror(result))));
-        result = mdb_cursor_del(m_cur_output_txs, 0);
+        result = lmdb_cursor_del(m_cur_output_txs, 0);
         if (result)
             throw0(DB_ERROR("Error deleting output: {}"_format(mdb_strerror(result))));
     }
@@ -1363,13 +1684,20 @@ void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image) {
     CURSOR(spent_keys)
 
     MDB_val k = {sizeof(k_image), (void*)&k_image};
-    if (auto result = mdb_cursor_put(m_cur_spent_keys, (MDB_val*)&zerokval, &k, MDB_NODUPDATA)) {
+    if (auto result = lmdb_cursor_put(m_cur_spent_keys, (MDB_val*)&zerokval, &k, MDB_NODUPDATA)) {
         if (result == MDB_KEYEXIST)
             throw1(KEY_IMAGE_EXISTS("Attempting to add spent key image that's already in the db"));
         else
             throw1(DB_ERROR("Error adding spent key image to db transaction: {}"_format(
                     mdb_strerror(result))));
     }
+
+    // The pending filter must be loaded first: a finishing build makes it current before clearing
+    // it, so this way we can't miss inserting into whichever one ends up current.
+    if (auto* pending = m_key_image_filter_pending.load())
+        pending->insert(k_image);
+    if (auto* filter = m_key_image_filter.load())
+        filter->insert(k_image);
 }
 
 void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image) {
@@ -1380,11 +1708,11 @@ void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image) {
     CURSOR(spent_keys)
 
     MDB_val k = {sizeof(k_image), (void*)&k_image};
-    auto result = mdb_cursor_get(m_cur_spent_keys, (MDB_val*)&zerokval, &k, MDB_GET_BOTH);
+    auto result = lmdb_cursor_get(m_cur_spent_keys, (MDB_val*)&zerokval, &k, MDB_GET_BOTH);
     if (result != 0 && result != MDB_NOTFOUND)
         throw1(DB_ERROR("Error finding spent key to remove{}"_format(mdb_strerror(result))));
     if (!result) {
-        result = mdb_cursor_del(m_cur_spent_keys, 0);
+        result = lmdb_cursor_del(m_cur_spent_keys, 0);
         if (result)
             throw1(DB_ERROR("Error adding removal of key image to db transaction{}"_format(
                     mdb_strerror(result))));
@@ -1660,6 +1988,40 @@ void BlockchainLMDB::open(
             m_service_node_data,
             "Failed to open db handle for m_service_node_data");
 
+    // Added without a migration, so it can be missing from an older database opened read-only (in
+    // which case we just act as if it were empty).
+    if (auto res = mdb_dbi_open(
+                txn,
+                LMDB_SERVICE_NODE_STATES,
+                MDB_INTEGERKEY | (mdb_flags & MDB_RDONLY ? 0 : MDB_CREATE),
+                &m_service_node_states);
+        res == MDB_SUCCESS)
+        m_have_service_node_states = true;
+    else if (res == MDB_NOTFOUND && (mdb_flags & MDB_RDONLY))
+        m_have_service_node_states = false;
+    else
+        throw0(DB_OPEN_FAILURE(
+                "Failed to open db handle for m_service_node_states: {} - you may want to start "
+                "with --db-salvage"_format(mdb_strerror(res))));
+
+    // Likewise added without a migration
+    auto res = mdb_dbi_open(
+            txn, LMDB_SPENT_KEY_TXS, mdb_flags & MDB_RDONLY ? 0 : MDB_CREATE, &m_spent_key_txs);
+    if (res == MDB_SUCCESS)
+        res = mdb_dbi_open(
+                txn,
+                LMDB_OUTPUT_KEY_TXS,
+                mdb_flags & MDB_RDONLY ? 0 : MDB_CREATE,
+                &m_output_key_txs);
+    if (res == MDB_SUCCESS)
+        m_have_spending_tables = true;
+    else if (res == MDB_NOTFOUND && (mdb_flags & MDB_RDONLY))
+        m_have_spending_tables = false;
+    else
+        throw0(DB_OPEN_FAILURE(
+                "Failed to open db handle for the spending index: {} - you may want to start "
+                "with --db-salvage"_format(mdb_strerror(res))));
+
     lmdb_db_open(
             txn,
             LMDB_SERVICE_NODE_LATEST,
@@ -1710,7 +2072,7 @@ void BlockchainLMDB::open(
     MDB_val_str(k, "version");
     MDB_val v;
     using db_version_t = uint32_t;
-    auto get_result = mdb_get(txn, m_properties, &k, &v);
+    auto get_result = lmdb_get(txn, m_properties, &k, &v);
     if (get_result == MDB_SUCCESS) {
         db_version_t db_version;
         std::memcpy(&db_version, v.mv_data, sizeof(db_version));
@@ -1753,7 +2115,7 @@ void BlockchainLMDB::open(
         if (m_height == 0) {
             MDB_val_str(k, "version");
             MDB_val_copy<db_version_t> v(static_cast<db_version_t>(VERSION));
-            auto put_result = mdb_put(txn, m_properties, &k, &v, 0);
+            auto put_result = lmdb_put(txn, m_properties, &k, &v, 0);
             if (put_result != MDB_SUCCESS) {
                 txn.abort();
                 mdb_env_close(m_env);
@@ -1764,10 +2126,95 @@ void BlockchainLMDB::open(
         }
     }
 
+    // External blob storage can only be chosen when the database is created, because the values in
+    // m_blocks are either all blobs or all blob_locations.
+    MDB_val_str(k_ext, "external_blobs");
+    bool external_blobs = lmdb_get(txn, m_properties, &k_ext, &v) == MDB_SUCCESS;
+    if (!external_blobs && (db_flags & DBF_EXTERNAL_BLOBS)) {
+        if (m_height == 0 && !(mdb_flags & MDB_RDONLY)) {
+            MDB_val_copy<uint32_t> v_ext(1);
+            if (auto result = lmdb_put(txn, m_properties, &k_ext, &v_ext, 0))
+                throw0(DB_ERROR("Failed to enable external blob storage: {}"_format(
+                        mdb_strerror(result))));
+            external_blobs = true;
+        } else {
+            log::warning(
+                    logcat,
+                    "Ignoring external blob storage option: it can only be enabled when creating a "
+                    "new database");
+        }
+    }
+
+    if (external_blobs) {
+        try {
+            m_blob_store = std::make_unique<blob_store>(m_folder / "blobs", mdb_flags & MDB_RDONLY);
+            // Anything left over from a previous database at this location is unreferenced
+            if (m_height == 0 && !(mdb_flags & MDB_RDONLY))
+                m_blob_store->clear();
+        } catch (const std::exception& e) {
+            txn.abort();
+            mdb_env_close(m_env);
+            throw0(DB_OPEN_FAILURE("Failed to open external blob storage: {}"_format(e.what())));
+        }
+        log::info(logcat, "Using external block blob storage in {}", m_blob_store->directory());
+    }
+
+    m_spending_index_from.reset();
+    MDB_val_str(k_spending, "spending_index_from");
+    if (lmdb_get(txn, m_properties, &k_spending, &v) == MDB_SUCCESS) {
+        uint64_t from;
+        std::memcpy(&from, v.mv_data, sizeof(from));
+        m_spending_index_from = from;
+    }
+
+    // Marks the database as in use until close() clears it, so that we can tell when we are
+    // recovering from a crash: LMDB comes back at the last synced commit, which with the
+    // non-syncing modes can be behind what had been added.
+    bool unclean_shutdown = false;
+    if (!(mdb_flags & MDB_RDONLY)) {
+        MDB_val_str(k_in_use, "in_use");
+        unclean_shutdown = lmdb_get(txn, m_properties, &k_in_use, &v) == MDB_SUCCESS;
+        MDB_val_copy<uint32_t> v_in_use(1);
+        if (auto result = lmdb_put(txn, m_properties, &k_in_use, &v_in_use, 0))
+            throw0(DB_ERROR("Failed to mark the database in use: {}"_format(mdb_strerror(result))));
+    }
+
     // commit the transaction
     txn.commit();
     m_open = true;
+    if (!(mdb_flags & MDB_RDONLY))
+        mdb_env_sync(m_env, true);
+    if (unclean_shutdown)
+        log::warning(
+                logcat,
+                "The blockchain database was not closed cleanly; resuming from height {}, the last "
+                "height that was durably written",
+                m_height);
     // from here, init should be finished
+
+    auto& metrics = tools::metrics::global();
+    m_metrics.push_back(metrics.add_gauge_callback(
+            "oxen_lmdb_map_size_bytes", "Size of the LMDB memory map", {}, [this] {
+                MDB_envinfo mei;
+                mdb_env_info(m_env, &mei);
+                return static_cast<double>(mei.me_mapsize);
+            }));
+    m_metrics.push_back(metrics.add_gauge_callback(
+            "oxen_lmdb_used_bytes", "Bytes of the LMDB memory map in use", {}, [this] {
+                MDB_envinfo mei;
+                mdb_env_info(m_env, &mei);
+                MDB_stat mst;
+                mdb_env_stat(m_env, &mst);
+                return static_cast<double>(mst.ms_psize) * mei.me_last_pgno;
+            }));
+
+    if (!(mdb_flags & MDB_RDONLY)) {
+        try {
+            start_key_image_filter_build();
+        } catch (const std::exception& e) {
+            log::warning(logcat, "Failed to start building the key image filter: {}", e.what());
+        }
+    }
 }
 
 void BlockchainLMDB::close() {
@@ -1776,8 +2223,29 @@ void BlockchainLMDB::close() {
         log::trace(logcat, "close() first calling batch_abort() due to active batch transaction");
         batch_abort();
     }
+    stop_key_image_filter();
+    m_metrics.clear();
+    try {
+        flush_txpool();
+    } catch (const std::exception& e) {
+        log::error(logcat, "Failed to write out pending txpool changes: {}", e.what());
+    }
+    if (!is_read_only()) {
+        mdb_txn_safe txn;
+        MDB_val_str(k, "in_use");
+        if (auto result = lmdb_txn_begin(m_env, NULL, 0, txn); result == MDB_SUCCESS) {
+            lmdb_del(txn, m_properties, &k, nullptr);
+            txn.commit();
+        } else
+            log::error(
+                    logcat,
+                    "Failed to clear the database in-use marker: {}",
+                    mdb_strerror(result));
+    }
     this->sync();
     m_tinfo.reset();
+    m_blob_store.reset();
+    m_hot_cache.clear();
 
     // FIXME: not yet thread safe!!!  Use with care.
     mdb_env_close(m_env);
@@ -1791,6 +2259,9 @@ void BlockchainLMDB::sync() {
     if (is_read_only())
         return;
 
+    if (m_blob_store)
+        m_blob_store->sync();
+
     // Does nothing unless LMDB environment was opened with MDB_NOSYNC or in part
     // MDB_NOMETASYNC. Force flush to be synchronous.
     if (auto result = mdb_env_sync(m_env, true)) {
@@ -1806,6 +2277,7 @@ void BlockchainLMDB::safesyncmode(const bool onoff) {
 void BlockchainLMDB::reset() {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
+    m_hot_cache.clear();
 
     mdb_txn_safe txn;
     if (auto result = lmdb_txn_begin(m_env, NULL, 0, txn))
@@ -1845,16 +2317,32 @@ void BlockchainLMDB::reset() {
         throw0(DB_ERROR("Failed to drop m_hf_versions: {}"_format(mdb_strerror(result))));
     if (auto result = mdb_drop(txn, m_service_node_data, 0))
         throw0(DB_ERROR("Failed to drop m_service_node_data: {}"_format(mdb_strerror(result))));
+    if (auto result = mdb_drop(txn, m_service_node_states, 0))
+        throw0(DB_ERROR(
+                "Failed to drop m_service_node_states: {}"_format(mdb_strerror(result))));
+    if (auto result = mdb_drop(txn, m_spent_key_txs, 0))
+        throw0(DB_ERROR("Failed to drop m_spent_key_txs: {}"_format(mdb_strerror(result))));
+    if (auto result = mdb_drop(txn, m_output_key_txs, 0))
+        throw0(DB_ERROR("Failed to drop m_output_key_txs: {}"_format(mdb_strerror(result))));
     if (auto result = mdb_drop(txn, m_properties, 0))
         throw0(DB_ERROR("Failed to drop m_properties: {}"_format(mdb_strerror(result))));
 
     // init with current version
     MDB_val_str(k, "version");
     MDB_val_copy<uint32_t> v(static_cast<uint32_t>(VERSION));
-    if (auto result = mdb_put(txn, m_properties, &k, &v, 0))
+    if (auto result = lmdb_put(txn, m_properties, &k, &v, 0))
         throw0(DB_ERROR("Failed to write version to database: {}"_format(mdb_strerror(result))));
+    if (m_blob_store) {
+        MDB_val_str(k_ext, "external_blobs");
+        MDB_val_copy<uint32_t> v_ext(1);
+        if (auto result = lmdb_put(txn, m_properties, &k_ext, &v_ext, 0))
+            throw0(DB_ERROR("Failed to write external blob storage flag to database: {}"_format(
+                    mdb_strerror(result))));
+    }
 
     txn.commit();
+    if (m_blob_store)
+        m_blob_store->clear();
     m_cum_size = 0;
     m_cum_count = 0;
 }
@@ -1864,9 +2352,38 @@ std::vector<fs::path> BlockchainLMDB::get_filenames() const {
     std::vector<fs::path> paths;
     paths.push_back(m_folder / BLOCKCHAINDATA_FILENAME);
     paths.push_back(m_folder / BLOCKCHAINDATA_LOCK_FILENAME);
+    if (m_blob_store)
+        for (auto& f : m_blob_store->filenames())
+            paths.push_back(std::move(f));
     return paths;
 }
 
+void BlockchainLMDB::copy_to(const fs::path& dir, bool compact) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+        throw0(DB_ERROR("Failed to create {}: {}"_format(dir, ec.message())));
+    if (fs::exists(dir / BLOCKCHAINDATA_FILENAME))
+        throw0(DB_ERROR("{} already contains a database"_format(dir)));
+
+    if (int r = mdb_env_copy2(m_env, dir.string().c_str(), compact ? MDB_CP_COMPACT : 0))
+        throw0(DB_ERROR("Failed to copy database to {}: {}"_format(dir, mdb_strerror(r))));
+
+    // Blob segments are append-only, so copying them after the database means they hold (at least)
+    // everything the copied database refers to.
+    if (m_blob_store) {
+        for (const auto& f : m_blob_store->filenames()) {
+            auto target = dir / fs::relative(f, m_folder);
+            fs::create_directories(target.parent_path(), ec);
+            if (ec || !fs::copy_file(f, target, ec))
+                throw0(DB_ERROR("Failed to copy {} to {}: {}"_format(f, target, ec.message())));
+        }
+    }
+}
+
 bool BlockchainLMDB::remove_data_file(const fs::path& folder) const {
     auto filename = folder / BLOCKCHAINDATA_FILENAME;
     try {
@@ -1950,6 +2467,22 @@ void BlockchainLMDB::unlock() {
             auto_txn.commit();               \
     } while (0)
 
+// Txpool changes go into m_txpool_pending rather than straight into the tables, and are written out
+// by flush_txpool().  Everything that reads the txpool looks in m_txpool_pending first, and holds
+// its lock while reading the tables, so that a flush (which also holds it, from writing until it
+// has committed and cleared the pending changes) appears all at once.
+
+bool BlockchainLMDB::txpool_tx_on_disk(const crypto::hash& txid) const {
+    TXN_PREFIX_RDONLY();
+    RCURSOR(txpool_meta)
+
+    MDB_val k = {sizeof(txid), (void*)&txid};
+    auto result = lmdb_cursor_get(m_cur_txpool_meta, &k, NULL, MDB_SET);
+    if (result != 0 && result != MDB_NOTFOUND)
+        throw1(DB_ERROR("Error finding txpool tx meta: {}"_format(mdb_strerror(result))));
+    return result != MDB_NOTFOUND;
+}
+
 void BlockchainLMDB::add_txpool_tx(
         const crypto::hash& txid, const std::string& blob, const txpool_tx_meta_t& meta) {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
@@ -1957,57 +2490,29 @@ void BlockchainLMDB::add_txpool_tx(
         throw1(DB_ERROR("Attempting to add txpool tx with empty blob"));
 
     check_open();
-    mdb_txn_cursors* m_cursors = &m_wcursors;
-
-    CURSOR(txpool_meta)
-    CURSOR(txpool_blob)
+    std::lock_guard lock{m_txpool_pending_mutex};
+    auto it = m_txpool_pending.find(txid);
+    bool on_disk = it != m_txpool_pending.end() ? it->second.on_disk : txpool_tx_on_disk(txid);
+    if (it != m_txpool_pending.end() ? it->second.meta.has_value() : on_disk)
+        throw1(DB_ERROR("Attempting to add txpool tx metadata that's already in the db"));
 
-    MDB_val k = {sizeof(txid), (void*)&txid};
-    MDB_val v = {sizeof(meta), (void*)&meta};
-    if (auto result = mdb_cursor_put(m_cur_txpool_meta, &k, &v, MDB_NODUPDATA)) {
-        if (result == MDB_KEYEXIST)
-            throw1(DB_ERROR("Attempting to add txpool tx metadata that's already in the db"));
-        else
-            throw1(DB_ERROR("Error adding txpool tx metadata to db transaction: {}"_format(
-                    mdb_strerror(result))));
-    }
-    MDB_val_sized(blob_val, blob);
-    if (blob_val.mv_size == 0)
-        throw1(DB_ERROR("Error adding txpool tx blob: tx is present, but data is empty"));
-    if (auto result = mdb_cursor_put(m_cur_txpool_blob, &k, &blob_val, MDB_NODUPDATA)) {
-        if (result == MDB_KEYEXIST)
-            throw1(DB_ERROR("Attempting to add txpool tx blob that's already in the db"));
-        else
-            throw1(DB_ERROR("Error adding txpool tx blob to db transaction: {}"_format(
-                    mdb_strerror(result))));
-    }
+    m_txpool_pending.insert_or_assign(
+            txid, pending_txpool_tx{meta, std::make_shared<const std::string>(blob), on_disk});
 }
 
 void BlockchainLMDB::update_txpool_tx(const crypto::hash& txid, const txpool_tx_meta_t& meta) {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
-    mdb_txn_cursors* m_cursors = &m_wcursors;
-
-    CURSOR(txpool_meta)
-    CURSOR(txpool_blob)
-
-    MDB_val k = {sizeof(txid), (void*)&txid};
-    MDB_val v;
-    auto result = mdb_cursor_get(m_cur_txpool_meta, &k, &v, MDB_SET);
-    if (result != 0)
-        throw1(DB_ERROR("Error finding txpool tx meta to update: {}"_format(mdb_strerror(result))));
-    result = mdb_cursor_del(m_cur_txpool_meta, 0);
-    if (result)
-        throw1(DB_ERROR("Error adding removal of txpool tx metadata to db transaction: {}"_format(
-                mdb_strerror(result))));
-    v = MDB_val({sizeof(meta), (void*)&meta});
-    if ((result = mdb_cursor_put(m_cur_txpool_meta, &k, &v, MDB_NODUPDATA)) != 0) {
-        if (result == MDB_KEYEXIST)
-            throw1(DB_ERROR("Attempting to add txpool tx metadata that's already in the db"));
-        else
-            throw1(DB_ERROR("Error adding txpool tx metadata to db transaction: {}"_format(
-                    mdb_strerror(result))));
-    }
+    std::lock_guard lock{m_txpool_pending_mutex};
+    if (auto it = m_txpool_pending.find(txid); it != m_txpool_pending.end()) {
+        if (!it->second.meta)
+            throw1(DB_ERROR("Error finding txpool tx meta to update: tx has been removed"));
+        it->second.meta = meta;
+    } else if (txpool_tx_on_disk(txid))
+        m_txpool_pending.emplace(txid, pending_txpool_tx{meta, nullptr, true});
+    else
+        throw1(DB_ERROR("Error finding txpool tx meta to update: {}"_format(
+                mdb_strerror(MDB_NOTFOUND))));
 }
 
 uint64_t BlockchainLMDB::get_txpool_tx_count(bool include_unrelayed_txes) const {
@@ -2017,6 +2522,7 @@ uint64_t BlockchainLMDB::get_txpool_tx_count(bool include_unrelayed_txes) const
     int result;
     uint64_t num_entries = 0;
 
+    std::lock_guard lock{m_txpool_pending_mutex};
     TXN_PREFIX_RDONLY();
 
     if (include_unrelayed_txes) {
@@ -2025,6 +2531,8 @@ uint64_t BlockchainLMDB::get_txpool_tx_count(bool include_unrelayed_txes) const
         if ((result = mdb_stat(m_txn, m_txpool_meta, &db_stats)))
             throw0(DB_ERROR("Failed to query m_txpool_meta: {}"_format(mdb_strerror(result))));
         num_entries = db_stats.ms_entries;
+        for (const auto& [txid, tx] : m_txpool_pending)
+            num_entries += tx.meta.has_value() - tx.on_disk;
     } else {
         // Filter unrelayed tx out of the result, so we need to loop over transactions and check
         // their meta data
@@ -2035,17 +2543,23 @@ uint64_t BlockchainLMDB::get_txpool_tx_count(bool include_unrelayed_txes) const
         MDB_val v;
         MDB_cursor_op op = MDB_FIRST;
         while (1) {
-            result = mdb_cursor_get(m_cur_txpool_meta, &k, &v, op);
+            result = lmdb_cursor_get(m_cur_txpool_meta, &k, &v, op);
             op = MDB_NEXT;
             if (result == MDB_NOTFOUND)
                 break;
             if (result)
                 throw0(DB_ERROR(
                         "Failed to enumerate txpool tx metadata: {}"_format(mdb_strerror(result))));
+            // Pending ones are counted below
+            if (m_txpool_pending.count(*(const crypto::hash*)k.mv_data))
+                continue;
             const txpool_tx_meta_t& meta = *(const txpool_tx_meta_t*)v.mv_data;
             if (!meta.do_not_relay)
                 ++num_entries;
         }
+        for (const auto& [txid, tx] : m_txpool_pending)
+            if (tx.meta && !tx.meta->do_not_relay)
+                ++num_entries;
     }
 
     return num_entries;
@@ -2055,56 +2569,46 @@ bool BlockchainLMDB::txpool_has_tx(const crypto::hash& txid) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
-    TXN_PREFIX_RDONLY();
-    RCURSOR(txpool_meta)
-
-    MDB_val k = {sizeof(txid), (void*)&txid};
-    auto result = mdb_cursor_get(m_cur_txpool_meta, &k, NULL, MDB_SET);
-    if (result != 0 && result != MDB_NOTFOUND)
-        throw1(DB_ERROR("Error finding txpool tx meta: {}"_format(mdb_strerror(result))));
-    return result != MDB_NOTFOUND;
+    std::lock_guard lock{m_txpool_pending_mutex};
+    if (auto it = m_txpool_pending.find(txid); it != m_txpool_pending.end())
+        return it->second.meta.has_value();
+    return txpool_tx_on_disk(txid);
 }
 
 void BlockchainLMDB::remove_txpool_tx(const crypto::hash& txid) {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
-    mdb_txn_cursors* m_cursors = &m_wcursors;
-
-    CURSOR(txpool_meta)
-    CURSOR(txpool_blob)
 
-    MDB_val k = {sizeof(txid), (void*)&txid};
-    auto result = mdb_cursor_get(m_cur_txpool_meta, &k, NULL, MDB_SET);
-    if (result != 0 && result != MDB_NOTFOUND)
-        throw1(DB_ERROR("Error finding txpool tx meta to remove: {}"_format(mdb_strerror(result))));
-    if (!result) {
-        result = mdb_cursor_del(m_cur_txpool_meta, 0);
-        if (result)
-            throw1(DB_ERROR(
-                    "Error adding removal of txpool tx metadata to db transaction: {}"_format(
-                            mdb_strerror(result))));
-    }
-    result = mdb_cursor_get(m_cur_txpool_blob, &k, NULL, MDB_SET);
-    if (result != 0 && result != MDB_NOTFOUND)
-        throw1(DB_ERROR("Error finding txpool tx blob to remove: {}"_format(mdb_strerror(result))));
-    if (!result) {
-        result = mdb_cursor_del(m_cur_txpool_blob, 0);
-        if (result)
-            throw1(DB_ERROR("Error adding removal of txpool tx blob to db transaction: {}"_format(
-                    mdb_strerror(result))));
-    }
+    std::lock_guard lock{m_txpool_pending_mutex};
+    if (auto it = m_txpool_pending.find(txid); it != m_txpool_pending.end()) {
+        if (it->second.on_disk) {
+            it->second.meta.reset();
+            it->second.blob.reset();
+        } else
+            // Never written, so there's nothing to remove
+            m_txpool_pending.erase(it);
+    } else if (txpool_tx_on_disk(txid))
+        m_txpool_pending.emplace(txid, pending_txpool_tx{std::nullopt, nullptr, true});
 }
 
 bool BlockchainLMDB::get_txpool_tx_meta(const crypto::hash& txid, txpool_tx_meta_t& meta) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
+    std::lock_guard lock{m_txpool_pending_mutex};
+    if (auto it = m_txpool_pending.find(txid); it != m_txpool_pending.end()) {
+        if (!it->second.meta)
+            return false;
+        meta = *it->second.meta;
+        return true;
+    }
+
     TXN_PREFIX_RDONLY();
     RCURSOR(txpool_meta)
 
     MDB_val k = {sizeof(txid), (void*)&txid};
     MDB_val v;
-    auto result = mdb_cursor_get(m_cur_txpool_meta, &k, &v, MDB_SET);
+    auto result = lmdb_cursor_get(m_cur_txpool_meta, &k, &v, MDB_SET);
     if (result == MDB_NOTFOUND)
         return false;
     if (result != 0)
@@ -2118,12 +2622,23 @@ bool BlockchainLMDB::get_txpool_tx_blob(const crypto::hash& txid, std::string& b
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
+    std::lock_guard lock{m_txpool_pending_mutex};
+    if (auto it = m_txpool_pending.find(txid); it != m_txpool_pending.end()) {
+        if (!it->second.meta)
+            return false;
+        if (it->second.blob) {
+            bd = *it->second.blob;
+            return true;
+        }
+        // Otherwise only the meta was updated; the blob on disk is current
+    }
+
     TXN_PREFIX_RDONLY();
     RCURSOR(txpool_blob)
 
     MDB_val k = {sizeof(txid), (void*)&txid};
     MDB_val v;
-    auto result = mdb_cursor_get(m_cur_txpool_blob, &k, &v, MDB_SET);
+    auto result = lmdb_cursor_get(m_cur_txpool_blob, &k, &v, MDB_SET);
     if (result == MDB_NOTFOUND)
         return false;
     if (result != 0)
@@ -2143,6 +2658,63 @@ std::string BlockchainLMDB::get_txpool_tx_blob(const crypto::hash& txid) const {
     return bd;
 }
 
+void BlockchainLMDB::flush_txpool() {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+    if (is_read_only())
+        return;
+    // Whoever has the write txn may still abort it, so we can't write into it; we'll get another
+    // go once it's done.
+    if (m_write_txn) {
+        log::debug(logcat, "Not flushing txpool changes: a write txn is in progress");
+        return;
+    }
+    {
+        std::lock_guard lock{m_txpool_pending_mutex};
+        if (m_txpool_pending.empty())
+            return;
+    }
+
+    // The write txn has to be started before taking the lock: a writer (e.g. adding a block) can
+    // make txpool changes, and so take the lock, while holding the write txn.
+    check_and_resize_for_batch(0, 0);
+    mdb_txn_safe txn;
+    if (auto mdb_res = lmdb_txn_begin(m_env, NULL, 0, txn))
+        throw0(DB_ERROR("Failed to create a transaction for the db in {}: {}"_format(
+                __FUNCTION__, mdb_strerror(mdb_res))));
+
+    std::lock_guard lock{m_txpool_pending_mutex};
+    size_t written = 0, removed = 0;
+    for (const auto& [txid, tx] : m_txpool_pending) {
+        MDB_val k = {sizeof(txid), (void*)&txid};
+        if (!tx.meta) {
+            if (!tx.on_disk)
+                continue;
+            for (auto dbi : {m_txpool_meta, m_txpool_blob})
+                if (auto result = lmdb_del(txn, dbi, &k, nullptr);
+                    result && result != MDB_NOTFOUND)
+                    throw1(DB_ERROR("Error removing txpool tx from db transaction: {}"_format(
+                            mdb_strerror(result))));
+            removed++;
+            continue;
+        }
+        MDB_val v = {sizeof(*tx.meta), (void*)&*tx.meta};
+        if (auto result = lmdb_put(txn, m_txpool_meta, &k, &v, 0))
+            throw1(DB_ERROR("Error adding txpool tx metadata to db transaction: {}"_format(
+                    mdb_strerror(result))));
+        if (tx.blob) {
+            MDB_val_sized(blob_val, (*tx.blob));
+            if (auto result = lmdb_put(txn, m_txpool_blob, &k, &blob_val, 0))
+                throw1(DB_ERROR("Error adding txpool tx blob to db transaction: {}"_format(
+                        mdb_strerror(result))));
+        }
+        written++;
+    }
+    txn.commit();
+    m_txpool_pending.clear();
+    log::debug(logcat, "Flushed txpool changes: {} written, {} removed", written, removed);
+}
+
 uint32_t BlockchainLMDB::get_blockchain_pruning_seed() const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
@@ -2151,7 +2723,7 @@ uint32_t BlockchainLMDB::get_blockchain_pruning_seed() const {
     RCURSOR(properties)
     MDB_val_str(k, "pruning_seed");
     MDB_val v;
-    int result = mdb_cursor_get(m_cur_properties, &k, &v, MDB_SET);
+    int result = lmdb_cursor_get(m_cur_properties, &k, &v, MDB_SET);
     if (result == MDB_NOTFOUND)
         return 0;
     if (result)
@@ -2165,7 +2737,7 @@ uint32_t BlockchainLMDB::get_blockchain_pruning_seed() const {
 
 static bool is_v1_tx(MDB_cursor* c_txs_pruned, MDB_val* tx_id) {
     MDB_val v;
-    int ret = mdb_cursor_get(c_txs_pruned, tx_id, &v, MDB_SET);
+    int ret = lmdb_cursor_get(c_txs_pruned, tx_id, &v, MDB_SET);
     if (ret)
         throw0(DB_ERROR("Failed to find transaction pruned data: {}"_format(mdb_strerror(ret))));
     if (v.mv_size == 0)
@@ -2204,7 +2776,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
 
     MDB_val_str(k, "pruning_seed");
     MDB_val v;
-    result = mdb_get(txn, m_properties, &k, &v);
+    result = lmdb_get(txn, m_properties, &k, &v);
     bool prune_tip_table = false;
     if (result == MDB_NOTFOUND) {
         // not pruned yet
@@ -2218,7 +2790,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
         pruning_seed = tools::make_pruning_seed(pruning_seed, PRUNING_LOG_STRIPES);
         v.mv_data = &pruning_seed;
         v.mv_size = sizeof(pruning_seed);
-        result = mdb_put(txn, m_properties, &k, &v, 0);
+        result = lmdb_put(txn, m_properties, &k, &v, 0);
         if (result)
             throw0(DB_ERROR("Failed to save pruning seed"));
         prune_tip_table = false;
@@ -2262,7 +2834,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
     if (prune_tip_table) {
         MDB_cursor_op op = MDB_FIRST;
         while (1) {
-            int ret = mdb_cursor_get(c_txs_prunable_tip, &k, &v, op);
+            int ret = lmdb_cursor_get(c_txs_prunable_tip, &k, &v, op);
             op = MDB_NEXT;
             if (ret == MDB_NOTFOUND)
                 break;
@@ -2276,7 +2848,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                 if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) &&
                     !is_v1_tx(c_txs_pruned, &k)) {
                     ++n_prunable_records;
-                    result = mdb_cursor_get(c_txs_prunable, &k, &v, MDB_SET);
+                    result = lmdb_cursor_get(c_txs_prunable, &k, &v, MDB_SET);
                     if (result == MDB_NOTFOUND)
                         log::warning(
                                 logcat,
@@ -2292,13 +2864,13 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                         ++n_pruned_records;
                         ++commit_counter;
                         n_bytes += k.mv_size + v.mv_size;
-                        result = mdb_cursor_del(c_txs_prunable, 0);
+                        result = lmdb_cursor_del(c_txs_prunable, 0);
                         if (result)
                             throw0(DB_ERROR("Failed to delete transaction prunable data: {}"_format(
                                     mdb_strerror(result))));
                     }
                 }
-                result = mdb_cursor_del(c_txs_prunable_tip, 0);
+                result = lmdb_cursor_del(c_txs_prunable_tip, 0);
                 if (result)
                     throw0(DB_ERROR("Failed to delete transaction tip data: {}"_format(
                             mdb_strerror(result))));
@@ -2334,7 +2906,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                     "Failed to open a cursor for tx_indices: {}"_format(mdb_strerror(result))));
         MDB_cursor_op op = MDB_FIRST;
         while (1) {
-            int ret = mdb_cursor_get(c_tx_indices, &k, &v, op);
+            int ret = lmdb_cursor_get(c_tx_indices, &k, &v, op);
             op = MDB_NEXT;
             if (ret == MDB_NOTFOUND)
                 break;
@@ -2350,7 +2922,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                 MDB_val_set(kp, ti.data.tx_id);
                 MDB_val_set(vp, block_height);
                 if (mode == prune_mode_check) {
-                    result = mdb_cursor_get(c_txs_prunable_tip, &kp, &vp, MDB_SET);
+                    result = lmdb_cursor_get(c_txs_prunable_tip, &kp, &vp, MDB_SET);
                     if (result && result != MDB_NOTFOUND)
                         throw0(DB_ERROR("Error looking for transaction prunable data: {}"_format(
                                 mdb_strerror(result))));
@@ -2363,7 +2935,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                                 blockchain_height,
                                 pruning_seed);
                 } else {
-                    result = mdb_cursor_put(c_txs_prunable_tip, &kp, &vp, 0);
+                    result = lmdb_cursor_put(c_txs_prunable_tip, &kp, &vp, 0);
                     if (result && result != MDB_NOTFOUND)
                         throw0(DB_ERROR("Error looking for transaction prunable data: {}"_format(
                                 mdb_strerror(result))));
@@ -2372,7 +2944,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
             MDB_val_set(kp, ti.data.tx_id);
             if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) &&
                 !is_v1_tx(c_txs_pruned, &kp)) {
-                result = mdb_cursor_get(c_txs_prunable, &kp, &v, MDB_SET);
+                result = lmdb_cursor_get(c_txs_prunable, &kp, &v, MDB_SET);
                 if (result && result != MDB_NOTFOUND)
                     throw0(DB_ERROR("Error looking for transaction prunable data: {}"_format(
                             mdb_strerror(result))));
@@ -2397,7 +2969,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                                 logcat, "Pruning at height {}/{}", block_height, blockchain_height);
                         ++n_pruned_records;
                         n_bytes += kp.mv_size + v.mv_size;
-                        result = mdb_cursor_del(c_txs_prunable, 0);
+                        result = lmdb_cursor_del(c_txs_prunable, 0);
                         if (result)
                             throw0(DB_ERROR("Failed to delete transaction prunable data: {}"_format(
                                     mdb_strerror(result))));
@@ -2407,7 +2979,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
             } else {
                 if (mode == prune_mode_check) {
                     MDB_val_set(kp, ti.data.tx_id);
-                    result = mdb_cursor_get(c_txs_prunable, &kp, &v, MDB_SET);
+                    result = lmdb_cursor_get(c_txs_prunable, &kp, &v, MDB_SET);
                     if (result && result != MDB_NOTFOUND)
                         throw0(DB_ERROR("Error looking for transaction prunable data: {}"_format(
                                 mdb_strerror(result))));
@@ -2447,7 +3019,7 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
                 MDB_val val;
                 val.mv_size = sizeof(ti);
                 val.mv_data = (void*)&ti;
-                result = mdb_cursor_get(c_tx_indices, (MDB_val*)&zerokval, &val, MDB_GET_BOTH);
+                result = lmdb_cursor_get(c_tx_indices, (MDB_val*)&zerokval, &val, MDB_GET_BOTH);
                 if (result)
                     throw0(DB_ERROR("Failed to restore cursor for tx_indices: {}"_format(
                             mdb_strerror(result))));
@@ -2467,6 +3039,14 @@ bool BlockchainLMDB::prune_worker(int mode, uint32_t pruning_seed) {
     mdb_cursor_close(c_txs_prunable);
     mdb_cursor_close(c_txs_pruned);
 
+    if (mode == prune_mode_prune) {
+        // A full prune finishes off any incremental pruning that was in progress
+        MDB_val_str(k_resume, "pruning_resume");
+        result = lmdb_del(txn, m_properties, &k_resume, NULL);
+        if (result && result != MDB_NOTFOUND)
+            throw0(DB_ERROR("Failed to remove pruning position: {}"_format(mdb_strerror(result))));
+    }
+
     txn.commit();
 
     log::info(
@@ -2490,6 +3070,171 @@ bool BlockchainLMDB::prune_blockchain(uint32_t pruning_seed) {
     return prune_worker(prune_mode_prune, pruning_seed);
 }
 
+double BlockchainLMDB::prune_blockchain_step(size_t max_txs, uint32_t pruning_seed) {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    const uint32_t log_stripes = tools::get_pruning_log_stripes(pruning_seed);
+    if (log_stripes && log_stripes != PRUNING_LOG_STRIPES)
+        throw0(DB_ERROR("Pruning seed not in range"));
+    pruning_seed = tools::get_pruning_stripe(pruning_seed);
+    if (pruning_seed > (1ul << PRUNING_LOG_STRIPES))
+        throw0(DB_ERROR("Pruning seed not in range"));
+    check_open();
+
+    const uint64_t blockchain_height = height();
+
+    mdb_txn_safe txn;
+    auto result = mdb_txn_begin(m_env, NULL, 0, txn);
+    if (result)
+        throw0(DB_ERROR(
+                "Failed to create a transaction for the db: {}"_format(mdb_strerror(result))));
+
+    // The hash of the next transaction (in tx_indices order) to look at.  This is kept in the
+    // properties table for as long as pruning is in progress, and removed once done.
+    crypto::hash resume{};
+    MDB_val_str(k_seed, "pruning_seed");
+    MDB_val_str(k_resume, "pruning_resume");
+    MDB_val v;
+    result = lmdb_get(txn, m_properties, &k_seed, &v);
+    if (result == MDB_NOTFOUND) {
+        if (pruning_seed == 0)
+            pruning_seed = tools::get_random_stripe();
+        pruning_seed = tools::make_pruning_seed(pruning_seed, PRUNING_LOG_STRIPES);
+        v.mv_data = &pruning_seed;
+        v.mv_size = sizeof(pruning_seed);
+        result = lmdb_put(txn, m_properties, &k_seed, &v, 0);
+        if (result)
+            throw0(DB_ERROR("Failed to save pruning seed"));
+        log::info(logcat, "Starting incremental blockchain pruning");
+    } else if (result == 0) {
+        if (v.mv_size != sizeof(uint32_t))
+            throw0(DB_ERROR("Failed to retrieve pruning seed: unexpected value size"));
+        uint32_t data;
+        memcpy(&data, v.mv_data, sizeof(data));
+        if (pruning_seed && tools::get_pruning_stripe(data) != pruning_seed)
+            throw0(DB_ERROR("Blockchain already pruned with different seed"));
+        if (tools::get_pruning_log_stripes(data) != PRUNING_LOG_STRIPES)
+            throw0(DB_ERROR("Blockchain already pruned with different base"));
+        pruning_seed = data;
+
+        result = lmdb_get(txn, m_properties, &k_resume, &v);
+        if (result == MDB_NOTFOUND) {
+            // Pruned, and not part way through (incremental) pruning
+            txn.abort();
+            return 1.0;
+        }
+        if (result)
+            throw0(DB_ERROR(
+                    "Failed to retrieve pruning position: {}"_format(mdb_strerror(result))));
+        if (v.mv_size != sizeof(resume))
+            throw0(DB_ERROR("Failed to retrieve pruning position: unexpected value size"));
+        memcpy(&resume, v.mv_data, sizeof(resume));
+    } else {
+        throw0(DB_ERROR(
+                "Failed to retrieve or create pruning seed: {}"_format(mdb_strerror(result))));
+    }
+
+    MDB_cursor *c_tx_indices, *c_txs_pruned, *c_txs_prunable, *c_txs_prunable_tip;
+    result = mdb_cursor_open(txn, m_tx_indices, &c_tx_indices);
+    if (result)
+        throw0(DB_ERROR("Failed to open a cursor for tx_indices: {}"_format(mdb_strerror(result))));
+    result = mdb_cursor_open(txn, m_txs_pruned, &c_txs_pruned);
+    if (result)
+        throw0(DB_ERROR("Failed to open a cursor for txs_pruned: {}"_format(mdb_strerror(result))));
+    result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable);
+    if (result)
+        throw0(DB_ERROR(
+                "Failed to open a cursor for txs_prunable: {}"_format(mdb_strerror(result))));
+    result = mdb_cursor_open(txn, m_txs_prunable_tip, &c_txs_prunable_tip);
+    if (result)
+        throw0(DB_ERROR(
+                "Failed to open a cursor for txs_prunable_tip: {}"_format(mdb_strerror(result))));
+
+    size_t n_txs = 0, n_pruned = 0;
+    uint64_t n_bytes = 0;
+    bool done = false;
+    MDB_val k = zerokval;
+    v = {sizeof(resume), &resume};
+    for (MDB_cursor_op op = MDB_GET_BOTH_RANGE;; op = MDB_NEXT_DUP) {
+        result = lmdb_cursor_get(c_tx_indices, &k, &v, op);
+        if (result == MDB_NOTFOUND) {
+            done = true;
+            break;
+        }
+        if (result)
+            throw0(DB_ERROR("Failed to enumerate transactions: {}"_format(mdb_strerror(result))));
+
+        txindex ti;
+        memcpy(&ti, v.mv_data, sizeof(ti));
+        if (n_txs == max_txs) {
+            resume = ti.key;
+            break;
+        }
+        ++n_txs;
+
+        const uint64_t block_height = ti.data.block_id;
+        MDB_val_set(kp, ti.data.tx_id);
+        if (block_height + PRUNING_TIP_BLOCKS >= blockchain_height) {
+            // Too recent to prune yet: track it so that update_pruning() prunes it later
+            MDB_val_set(vp, block_height);
+            result = lmdb_cursor_put(c_txs_prunable_tip, &kp, &vp, 0);
+            if (result && result != MDB_KEYEXIST)
+                throw0(DB_ERROR("Failed to add prunable tx id to db transaction: {}"_format(
+                        mdb_strerror(result))));
+        }
+        if (!tools::has_unpruned_block(block_height, blockchain_height, pruning_seed) &&
+            !is_v1_tx(c_txs_pruned, &kp)) {
+            MDB_val vp;
+            result = lmdb_cursor_get(c_txs_prunable, &kp, &vp, MDB_SET);
+            if (result == 0) {
+                n_bytes += kp.mv_size + vp.mv_size;
+                result = lmdb_cursor_del(c_txs_prunable, 0);
+                if (result)
+                    throw0(DB_ERROR("Failed to delete transaction prunable data: {}"_format(
+                            mdb_strerror(result))));
+                ++n_pruned;
+            } else if (result != MDB_NOTFOUND)
+                throw0(DB_ERROR("Error looking for transaction prunable data: {}"_format(
+                        mdb_strerror(result))));
+        }
+    }
+
+    if (done) {
+        result = lmdb_del(txn, m_properties, &k_resume, NULL);
+        if (result && result != MDB_NOTFOUND)
+            throw0(DB_ERROR("Failed to remove pruning position: {}"_format(mdb_strerror(result))));
+    } else {
+        v = {sizeof(resume), &resume};
+        result = lmdb_put(txn, m_properties, &k_resume, &v, 0);
+        if (result)
+            throw0(DB_ERROR("Failed to save pruning position: {}"_format(mdb_strerror(result))));
+    }
+
+    mdb_cursor_close(c_txs_prunable_tip);
+    mdb_cursor_close(c_txs_prunable);
+    mdb_cursor_close(c_txs_pruned);
+    mdb_cursor_close(c_tx_indices);
+
+    txn.commit();
+
+    log::debug(
+            logcat,
+            "Pruned {} of {} transactions looked at ({} bytes){}",
+            n_pruned,
+            n_txs,
+            n_bytes,
+            done ? ", blockchain pruning complete" : "");
+    if (done)
+        return 1.0;
+
+    // tx_indices is in hash order, so how far through the hash space the next tx is gives a good
+    // estimate of how far through the transactions we are.  (compare_hash32 orders hashes by their
+    // last 32-bit word first, so that is where the most significant bits are).
+    uint32_t hi, lo;
+    memcpy(&hi, resume.data() + 28, sizeof(hi));
+    memcpy(&lo, resume.data() + 24, sizeof(lo));
+    return (uint64_t{hi} << 32 | lo) / 0x1p64;
+}
+
 bool BlockchainLMDB::update_pruning() {
     return prune_worker(prune_mode_update, 0);
 }
@@ -2505,6 +3250,14 @@ bool BlockchainLMDB::for_all_txpool_txes(
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
+    // `f` may well change the pool, so we work from a copy of the pending changes rather than
+    // holding the lock while calling it.  (The blobs are shared, so this is cheap).
+    std::unordered_map<crypto::hash, pending_txpool_tx> pending;
+    {
+        std::lock_guard lock{m_txpool_pending_mutex};
+        pending = m_txpool_pending;
+    }
+
     TXN_PREFIX_RDONLY();
     RCURSOR(txpool_meta);
     RCURSOR(txpool_blob);
@@ -2515,7 +3268,7 @@ bool BlockchainLMDB::for_all_txpool_txes(
 
     MDB_cursor_op op = MDB_FIRST;
     while (1) {
-        int result = mdb_cursor_get(m_cur_txpool_meta, &k, &v, op);
+        int result = lmdb_cursor_get(m_cur_txpool_meta, &k, &v, op);
         op = MDB_NEXT;
         if (result == MDB_NOTFOUND)
             break;
@@ -2523,15 +3276,26 @@ bool BlockchainLMDB::for_all_txpool_txes(
             throw0(DB_ERROR(
                     "Failed to enumerate txpool tx metadata: {}"_format(mdb_strerror(result))));
         const crypto::hash txid = *(const crypto::hash*)k.mv_data;
-        const txpool_tx_meta_t& meta = *(const txpool_tx_meta_t*)v.mv_data;
-        if (!include_unrelayed_txes && meta.do_not_relay)
+        const txpool_tx_meta_t* meta = (const txpool_tx_meta_t*)v.mv_data;
+        // If it has pending changes, we take them out of `pending` so that they aren't passed
+        // again by the loop below (it may have been flushed since we copied them).
+        std::optional<pending_txpool_tx> changed;
+        if (auto it = pending.find(txid); it != pending.end()) {
+            changed = std::move(pending.extract(it).mapped());
+            if (!changed->meta)
+                continue;
+            meta = &*changed->meta;
+        }
+        if (!include_unrelayed_txes && meta->do_not_relay)
             // Skipping that tx
             continue;
         const std::string* passed_bd = NULL;
         std::string bd;
-        if (include_blob) {
+        if (include_blob && changed && changed->blob)
+            passed_bd = changed->blob.get();
+        else if (include_blob) {
             MDB_val b;
-            result = mdb_cursor_get(m_cur_txpool_blob, &k, &b, MDB_SET);
+            result = lmdb_cursor_get(m_cur_txpool_blob, &k, &b, MDB_SET);
             if (result == MDB_NOTFOUND)
                 throw0(DB_ERROR("Failed to find txpool tx blob to match metadata"));
             if (result)
@@ -2541,12 +3305,30 @@ bool BlockchainLMDB::for_all_txpool_txes(
             passed_bd = &bd;
         }
 
-        if (!f(txid, meta, passed_bd)) {
+        if (!f(txid, *meta, passed_bd)) {
             ret = false;
             break;
         }
     }
 
+    // Whatever is left is in the pool but not (yet) in the tables
+    for (auto it = pending.begin(); ret && it != pending.end(); ++it) {
+        const auto& [txid, tx] = *it;
+        if (!tx.meta || (!include_unrelayed_txes && tx.meta->do_not_relay))
+            continue;
+        std::string bd;
+        const std::string* passed_bd = nullptr;
+        if (include_blob && tx.blob)
+            passed_bd = tx.blob.get();
+        else if (include_blob) {
+            // A meta update of a tx that has been flushed (or removed) since we copied it
+            if (!get_txpool_tx_blob(txid, bd))
+                continue;
+            passed_bd = &bd;
+        }
+        ret = f(txid, *tx.meta, passed_bd);
+    }
+
     return ret;
 }
 
@@ -2623,7 +3405,7 @@ bool BlockchainLMDB::for_all_alt_blocks(
 
     MDB_cursor_op op = MDB_FIRST;
     while (1) {
-        int result = mdb_cursor_get(m_cur_alt_blocks, &k, &v, op);
+        int result = lmdb_cursor_get(m_cur_alt_blocks, &k, &v, op);
         op = MDB_NEXT;
         if (result == MDB_NOTFOUND)
             break;
@@ -2658,7 +3440,7 @@ bool BlockchainLMDB::block_exists(const crypto::hash& h, uint64_t* height) const
 
     bool ret = false;
     MDB_val_set(key, h);
-    auto get_result = mdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &key, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &key, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         log::trace(logcat, "Block with hash {} not found in db", h);
     } else if (get_result)
@@ -2695,14 +3477,14 @@ T BlockchainLMDB::get_and_convert_block_blob_from_height(uint64_t height, size_t
 
     MDB_val_copy<uint64_t> key(height);
     MDB_val value;
-    auto get_result = mdb_cursor_get(m_cur_blocks, &key, &value, MDB_SET);
+    auto get_result = lmdb_cursor_get(m_cur_blocks, &key, &value, MDB_SET);
     if (get_result == MDB_NOTFOUND)
         throw0(BLOCK_DNE(
                 "Attempt to get block from height {} failed -- block not in db"_format(height)));
     else if (get_result)
         throw0(DB_ERROR("Error attempting to retrieve a block from the db"));
 
-    std::string_view blob{reinterpret_cast<const char*>(value.mv_data), value.mv_size};
+    std::string_view blob = block_blob_from_value(value);
 
     T result;
     if constexpr (std::is_same_v<T, cryptonote::block>) {
@@ -2720,6 +3502,21 @@ T BlockchainLMDB::get_and_convert_block_blob_from_height(uint64_t height, size_t
     return result;
 }
 
+std::string_view BlockchainLMDB::block_blob_from_value(const MDB_val& v) const {
+    if (!m_blob_store)
+        return {reinterpret_cast<const char*>(v.mv_data), v.mv_size};
+
+    if (v.mv_size != sizeof(blob_location))
+        throw0(DB_ERROR("Invalid external block blob location in the db"));
+    blob_location loc;
+    std::memcpy(&loc, v.mv_data, sizeof(loc));
+    try {
+        return m_blob_store->get(loc);
+    } catch (const std::exception& e) {
+        throw0(DB_ERROR("Failed to read external block blob: {}"_format(e.what())));
+    }
+}
+
 block BlockchainLMDB::get_block_from_height(uint64_t height, size_t* size) const {
     log::trace(logcat, "BlockchainLMDB::{} {}", __func__, height);
     block result = get_and_convert_block_blob_from_height<block>(height, size);
@@ -2741,7 +3538,7 @@ uint64_t BlockchainLMDB::get_block_height(const crypto::hash& h) const {
     RCURSOR(block_heights);
 
     MDB_val_set(key, h);
-    auto get_result = mdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &key, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_heights, (MDB_val*)&zerokval, &key, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND)
         throw1(BLOCK_DNE("Attempted to retrieve non-existent block height from hash {}"_format(h)));
     else if (get_result)
@@ -2752,15 +3549,38 @@ uint64_t BlockchainLMDB::get_block_height(const crypto::hash& h) const {
     return ret;
 }
 
-block_header BlockchainLMDB::get_block_header_from_height(uint64_t height) const {
-    block_header result = get_and_convert_block_blob_from_height<cryptonote::block_header>(height);
-    return result;
-}
+block_header BlockchainLMDB::get_block_header_from_height(uint64_t height) const {
+    block_header result = get_and_convert_block_blob_from_height<cryptonote::block_header>(height);
+    return result;
+}
+
+std::string BlockchainLMDB::get_block_blob_from_height(uint64_t height) const {
+    log::trace(logcat, "BlockchainLMDB::{} {}", __func__, height);
+    if (auto cached = m_hot_cache.block_blob(height))
+        return std::move(*cached);
+    std::string result = get_and_convert_block_blob_from_height<std::string>(height);
+    return result;
+}
+
+std::string_view BlockchainLMDB::get_block_blob_view_from_height(uint64_t height) const {
+    log::trace(logcat, "BlockchainLMDB::{} {}", __func__, height);
+    check_open();
+
+    TXN_PREFIX_RDONLY();
+    if (my_rtxn)
+        throw0(DB_ERROR("Attempt to get a block blob view without an open read txn"));
+    RCURSOR(blocks);
+
+    MDB_val_copy<uint64_t> key(height);
+    MDB_val value;
+    auto get_result = lmdb_cursor_get(m_cur_blocks, &key, &value, MDB_SET);
+    if (get_result == MDB_NOTFOUND)
+        throw0(BLOCK_DNE(
+                "Attempt to get block from height {} failed -- block not in db"_format(height)));
+    else if (get_result)
+        throw0(DB_ERROR("Error attempting to retrieve a block from the db"));
 
-std::string BlockchainLMDB::get_block_blob_from_height(uint64_t height) const {
-    log::trace(logcat, "BlockchainLMDB::{} {}", __func__, height);
-    std::string result = get_and_convert_block_blob_from_height<std::string>(height);
-    return result;
+    return block_blob_from_value(value);
 }
 
 uint64_t BlockchainLMDB::get_block_timestamp(const uint64_t& height) const {
@@ -2771,7 +3591,7 @@ uint64_t BlockchainLMDB::get_block_timestamp(const uint64_t& height) const {
     RCURSOR(block_info);
 
     MDB_val_set(result, height);
-    auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         throw0(BLOCK_DNE(
                 "Attempt to get timestamp from height {} failed -- timestamp not in db"_format(
@@ -2817,7 +3637,7 @@ std::vector<uint64_t> BlockchainLMDB::get_block_cumulative_rct_outputs(
         } else {
             if (height == prev_height + 1) {
                 MDB_val k2;
-                result = mdb_cursor_get(m_cur_block_info, &k2, &v, MDB_NEXT_MULTIPLE);
+                result = lmdb_cursor_get(m_cur_block_info, &k2, &v, MDB_NEXT_MULTIPLE);
                 range_begin = ((const mdb_block_info*)v.mv_data)->bi_height;
                 range_end =
                         range_begin + v.mv_size / sizeof(mdb_block_info);  // whole records please
@@ -2827,7 +3647,7 @@ std::vector<uint64_t> BlockchainLMDB::get_block_cumulative_rct_outputs(
             } else {
                 v.mv_size = sizeof(uint64_t);
                 v.mv_data = (void*)&height;
-                result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+                result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
                 range_begin = height;
                 range_end = range_begin + 1;
             }
@@ -2865,7 +3685,7 @@ size_t BlockchainLMDB::get_block_weight(const uint64_t& height) const {
     RCURSOR(block_info);
 
     MDB_val_set(result, height);
-    auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         throw0(BLOCK_DNE(
                 "Attempt to get block size from height {} failed -- block size not in db"_format(
@@ -2904,7 +3724,7 @@ std::vector<uint64_t> BlockchainLMDB::get_block_info_64bit_fields(
             int result = 0;
             if (range_end > 0) {
                 MDB_val k2;
-                result = mdb_cursor_get(m_cur_block_info, &k2, &v, MDB_NEXT_MULTIPLE);
+                result = lmdb_cursor_get(m_cur_block_info, &k2, &v, MDB_NEXT_MULTIPLE);
                 range_begin = ((const mdb_block_info*)v.mv_data)->bi_height;
                 range_end =
                         range_begin + v.mv_size / sizeof(mdb_block_info);  // whole records please
@@ -2914,7 +3734,7 @@ std::vector<uint64_t> BlockchainLMDB::get_block_info_64bit_fields(
             } else {
                 v.mv_size = sizeof(uint64_t);
                 v.mv_data = (void*)&height;
-                result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+                result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
                 range_begin = height;
                 range_end = range_begin + 1;
             }
@@ -2937,7 +3757,7 @@ uint64_t BlockchainLMDB::get_max_block_size() {
     RCURSOR(properties)
     MDB_val_str(k, "max_block_size");
     MDB_val v;
-    int result = mdb_cursor_get(m_cur_properties, &k, &v, MDB_SET);
+    int result = lmdb_cursor_get(m_cur_properties, &k, &v, MDB_SET);
     if (result == MDB_NOTFOUND)
         return std::numeric_limits<uint64_t>::max();
     if (result)
@@ -2958,7 +3778,7 @@ void BlockchainLMDB::add_max_block_size(uint64_t sz) {
 
     MDB_val_str(k, "max_block_size");
     MDB_val v;
-    int result = mdb_cursor_get(m_cur_properties, &k, &v, MDB_SET);
+    int result = lmdb_cursor_get(m_cur_properties, &k, &v, MDB_SET);
     if (result && result != MDB_NOTFOUND)
         throw0(DB_ERROR("Failed to retrieve max block size: {}"_format(mdb_strerror(result))));
     uint64_t max_block_size = 0;
@@ -2971,7 +3791,7 @@ void BlockchainLMDB::add_max_block_size(uint64_t sz) {
         max_block_size = sz;
     v.mv_data = (void*)&max_block_size;
     v.mv_size = sizeof(max_block_size);
-    result = mdb_cursor_put(m_cur_properties, &k, &v, 0);
+    result = lmdb_cursor_put(m_cur_properties, &k, &v, 0);
     if (result)
         throw0(DB_ERROR("Failed to set max_block_size: {}"_format(mdb_strerror(result))));
 }
@@ -2996,7 +3816,7 @@ difficulty_type BlockchainLMDB::get_block_cumulative_difficulty(const uint64_t&
     RCURSOR(block_info);
 
     MDB_val_set(result, height);
-    auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         throw0(BLOCK_DNE(
                 "Attempt to get cumulative difficulty from height {} failed -- difficulty not in db"_format(
@@ -3032,7 +3852,7 @@ uint64_t BlockchainLMDB::get_block_already_generated_coins(const uint64_t& heigh
     RCURSOR(block_info);
 
     MDB_val_set(result, height);
-    auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         throw0(BLOCK_DNE(
                 "Attempt to get generated coins from height {} failed -- block size not in db"_format(
@@ -3053,7 +3873,7 @@ uint64_t BlockchainLMDB::get_block_long_term_weight(const uint64_t& height) cons
     RCURSOR(block_info);
 
     MDB_val_set(result, height);
-    auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         throw0(BLOCK_DNE(
                 "Attempt to get block long term weight from height {} failed -- block info not in db"_format(
@@ -3074,7 +3894,7 @@ crypto::hash BlockchainLMDB::get_block_hash_from_height(const uint64_t& height)
     RCURSOR(block_info);
 
     MDB_val_set(result, height);
-    auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_block_info, (MDB_val*)&zerokval, &result, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND) {
         throw0(BLOCK_DNE(
                 "Attempt to get hash from height {} failed -- hash not in db"_format(height)));
@@ -3161,7 +3981,7 @@ uint64_t BlockchainLMDB::num_outputs() const {
 
     uint64_t num = 0;
     MDB_val k, v;
-    result = mdb_cursor_get(m_cur_output_txs, &k, &v, MDB_LAST);
+    result = lmdb_cursor_get(m_cur_output_txs, &k, &v, MDB_LAST);
     if (result == MDB_NOTFOUND)
         num = 0;
     else if (result == 0)
@@ -3183,7 +4003,7 @@ bool BlockchainLMDB::tx_exists(const crypto::hash& h) const {
     bool tx_found = false;
 
     auto time1 = std::chrono::steady_clock::now();
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &key, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &key, MDB_GET_BOTH);
     if (get_result == 0)
         tx_found = true;
     else if (get_result != MDB_NOTFOUND)
@@ -3210,7 +4030,7 @@ bool BlockchainLMDB::tx_exists(const crypto::hash& h, uint64_t& tx_id) const {
     MDB_val_set(v, h);
 
     auto time1 = std::chrono::steady_clock::now();
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     time_tx_exists += std::chrono::steady_clock::now() - time1;
     if (!get_result) {
         txindex* tip = (txindex*)v.mv_data;
@@ -3237,7 +4057,7 @@ uint64_t BlockchainLMDB::get_tx_unlock_time(const crypto::hash& h) const {
     RCURSOR(tx_indices);
 
     MDB_val_set(v, h);
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND)
         throw1(TX_DNE(
                 "tx data with hash {} not found in db: {}"_format(h, mdb_strerror(get_result))));
@@ -3254,6 +4074,11 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, std::string& bd) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
+    if (auto cached = m_hot_cache.tx_blob(h)) {
+        bd += *cached;
+        return true;
+    }
+
     TXN_PREFIX_RDONLY();
     RCURSOR(tx_indices);
     RCURSOR(txs_pruned);
@@ -3261,13 +4086,13 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, std::string& bd) const {
 
     MDB_val_set(v, h);
     MDB_val result0, result1;
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (get_result == 0) {
         txindex* tip = (txindex*)v.mv_data;
         MDB_val_set(val_tx_id, tip->data.tx_id);
-        get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result0, MDB_SET);
+        get_result = lmdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result0, MDB_SET);
         if (get_result == 0) {
-            get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result1, MDB_SET);
+            get_result = lmdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result1, MDB_SET);
         }
     }
     if (get_result == MDB_NOTFOUND)
@@ -3293,11 +4118,11 @@ bool BlockchainLMDB::get_pruned_tx_blob(const crypto::hash& h, std::string& bd)
 
     MDB_val_set(v, h);
     MDB_val result;
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (get_result == 0) {
         txindex* tip = (txindex*)v.mv_data;
         MDB_val_set(val_tx_id, tip->data.tx_id);
-        get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
+        get_result = lmdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
     }
     if (get_result == MDB_NOTFOUND)
         return false;
@@ -3315,10 +4140,32 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
+    if (!count)
+        return true;
+
+    // Hold a txn so that the views stay valid until we have copied them
+    TXN_PREFIX_RDONLY();
+    std::vector<std::string_view> views;
+    if (!get_pruned_tx_blob_views_from(h, count, views))
+        return false;
+
+    bd.reserve(bd.size() + views.size());
+    for (auto v : views)
+        bd.emplace_back(v);
+    return true;
+}
+
+bool BlockchainLMDB::get_pruned_tx_blob_views_from(
+        const crypto::hash& h, size_t count, std::vector<std::string_view>& bd) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+
     if (!count)
         return true;
 
     TXN_PREFIX_RDONLY();
+    if (my_rtxn)
+        throw0(DB_ERROR("Attempt to get tx blob views without an open read txn"));
     RCURSOR(tx_indices);
     RCURSOR(txs_pruned);
 
@@ -3326,7 +4173,7 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(
 
     MDB_val_set(v, h);
     MDB_val result;
-    int res = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    int res = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (res == MDB_NOTFOUND)
         return false;
     if (res)
@@ -3337,13 +4184,13 @@ bool BlockchainLMDB::get_pruned_tx_blobs_from(
     MDB_val_set(val_tx_id, id);
     MDB_cursor_op op = MDB_SET;
     while (count--) {
-        res = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, op);
+        res = lmdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, op);
         op = MDB_NEXT;
         if (res == MDB_NOTFOUND)
             return false;
         if (res)
             throw0(DB_ERROR("DB error attempting to fetch tx blob: {}"_format(mdb_strerror(res))));
-        bd.emplace_back(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+        bd.emplace_back(reinterpret_cast<const char*>(result.mv_data), result.mv_size);
     }
 
     return true;
@@ -3359,11 +4206,11 @@ bool BlockchainLMDB::get_prunable_tx_blob(const crypto::hash& h, std::string& bd
 
     MDB_val_set(v, h);
     MDB_val result;
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (get_result == 0) {
         const txindex* tip = (const txindex*)v.mv_data;
         MDB_val_set(val_tx_id, tip->data.tx_id);
-        get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result, MDB_SET);
+        get_result = lmdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result, MDB_SET);
     }
     if (get_result == MDB_NOTFOUND)
         return false;
@@ -3387,11 +4234,11 @@ bool BlockchainLMDB::get_prunable_tx_hash(
 
     MDB_val_set(v, tx_hash);
     MDB_val result, val_tx_prunable_hash;
-    auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (get_result == 0) {
         txindex* tip = (txindex*)v.mv_data;
         MDB_val_set(val_tx_id, tip->data.tx_id);
-        get_result = mdb_cursor_get(m_cur_txs_prunable_hash, &val_tx_id, &result, MDB_SET);
+        get_result = lmdb_cursor_get(m_cur_txs_prunable_hash, &val_tx_id, &result, MDB_SET);
     }
     if (get_result == MDB_NOTFOUND)
         return false;
@@ -3442,7 +4289,7 @@ std::vector<uint64_t> BlockchainLMDB::get_tx_block_heights(
 
     for (const auto& h : hs) {
         MDB_val_set(v, h);
-        auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+        auto get_result = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
         if (get_result == MDB_NOTFOUND)
             result.push_back(std::numeric_limits<uint64_t>::max());
         else if (get_result)
@@ -3454,6 +4301,101 @@ std::vector<uint64_t> BlockchainLMDB::get_tx_block_heights(
     return result;
 }
 
+std::vector<std::optional<tx_lookup>> BlockchainLMDB::get_txs_data(
+        const std::vector<crypto::hash>& hs) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+    std::vector<std::optional<tx_lookup>> result(hs.size());
+
+    TXN_PREFIX_RDONLY();
+    RCURSOR(tx_indices);
+    RCURSOR(txs_pruned);
+    RCURSOR(txs_prunable);
+    RCURSOR(txs_prunable_hash);
+    RCURSOR(tx_outputs);
+
+    // Resolve the hashes in hash order, which is the order tx_indices stores them in, so that
+    // successive lookups mostly land on pages we've just read.
+    std::vector<size_t> order(hs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&hs](size_t a, size_t b) { return hs[a] < hs[b]; });
+
+    std::vector<std::pair<uint64_t, size_t>> ids;  // [tx_id, index into hs]
+    ids.reserve(hs.size());
+    for (size_t i : order) {
+        MDB_val_set(v, hs[i]);
+        auto res = lmdb_cursor_get(m_cur_tx_indices, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+        if (res == MDB_NOTFOUND)
+            continue;
+        if (res)
+            throw0(DB_ERROR("DB error attempting to fetch tx index: {}"_format(mdb_strerror(res))));
+        const auto& data = reinterpret_cast<const txindex*>(v.mv_data)->data;
+        auto& tx = result[i].emplace();
+        tx.hash = hs[i];
+        tx.block_height = data.block_id;
+        ids.emplace_back(data.tx_id, i);
+    }
+
+    // Now fetch everything else in tx id order: txes requested together are nearly always from
+    // the same few blocks, and so have consecutive ids that we can step through with MDB_NEXT
+    // rather than seeking to each one.
+    std::sort(ids.begin(), ids.end());
+
+    struct walker {
+        MDB_cursor* cur;
+        std::optional<uint64_t> at;  // the id the cursor is on, if known
+
+        // Positions the cursor on `id`, returning false if it isn't in the table
+        bool seek(uint64_t id, MDB_val& v) {
+            MDB_val k;
+            int res;
+            if (at && *at + 1 == id) {
+                res = lmdb_cursor_get(cur, &k, &v, MDB_NEXT);
+                if (res == 0 && *reinterpret_cast<const uint64_t*>(k.mv_data) == id) {
+                    at = id;
+                    return true;
+                }
+                if (res && res != MDB_NOTFOUND)
+                    throw0(DB_ERROR("DB error walking tx data: {}"_format(mdb_strerror(res))));
+            }
+            at.reset();
+            MDB_val_set(key, id);
+            res = lmdb_cursor_get(cur, &key, &v, MDB_SET);
+            if (res == MDB_NOTFOUND)
+                return false;
+            if (res)
+                throw0(DB_ERROR("DB error seeking tx data: {}"_format(mdb_strerror(res))));
+            at = id;
+            return true;
+        }
+    };
+    walker pruned{m_cur_txs_pruned}, prunable{m_cur_txs_prunable},
+            prunable_hash{m_cur_txs_prunable_hash}, outputs{m_cur_tx_outputs};
+
+    MDB_val v;
+    for (auto [tx_id, i] : ids) {
+        auto& tx = *result[i];
+        if (!pruned.seek(tx_id, v)) {
+            result[i].reset();
+            continue;
+        }
+        tx.pruned.assign(static_cast<const char*>(v.mv_data), v.mv_size);
+        if (prunable_hash.seek(tx_id, v))
+            std::memcpy(tx.prunable_hash.data(), v.mv_data, sizeof(crypto::hash));
+        else
+            tx.prunable_hash = crypto::null<crypto::hash>;
+        if (prunable.seek(tx_id, v))
+            tx.prunable.assign(static_cast<const char*>(v.mv_data), v.mv_size);
+        if (outputs.seek(tx_id, v)) {
+            auto* indices = static_cast<const uint64_t*>(v.mv_data);
+            tx.output_indices.assign(indices, indices + v.mv_size / sizeof(uint64_t));
+        } else
+            log::warning(logcat, "WARNING: Unexpected: tx {} has no amount indices stored", tx.hash);
+    }
+
+    return result;
+}
+
 uint64_t BlockchainLMDB::get_num_outputs(const uint64_t& amount) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
@@ -3464,7 +4406,7 @@ uint64_t BlockchainLMDB::get_num_outputs(const uint64_t& amount) const {
     MDB_val_copy<uint64_t> k(amount);
     MDB_val v;
     mdb_size_t num_elems = 0;
-    auto result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
+    auto result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
     if (result == MDB_SUCCESS) {
         mdb_cursor_count(m_cur_output_amounts, &num_elems);
     } else if (result != MDB_NOTFOUND)
@@ -3483,7 +4425,7 @@ output_data_t BlockchainLMDB::get_output_key(
 
     MDB_val_set(k, amount);
     MDB_val_set(v, index);
-    auto get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND)
         throw1(
                 OUTPUT_DNE("Attempting to get output pubkey by index, but key does not "
@@ -3513,7 +4455,7 @@ tx_out_index BlockchainLMDB::get_output_tx_and_index_from_global(const uint64_t&
 
     MDB_val_set(v, output_id);
 
-    auto get_result = mdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+    auto get_result = lmdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
     if (get_result == MDB_NOTFOUND)
         throw1(OUTPUT_DNE("output with given index not in db"));
     else if (get_result)
@@ -3556,7 +4498,7 @@ std::vector<std::vector<uint64_t>> BlockchainLMDB::get_tx_amount_output_indices(
 
     MDB_cursor_op op = MDB_SET;
     while (n_txes-- > 0) {
-        int result = mdb_cursor_get(m_cur_tx_outputs, &k_tx_id, &v, op);
+        int result = lmdb_cursor_get(m_cur_tx_outputs, &k_tx_id, &v, op);
         if (result == MDB_NOTFOUND)
             log::warning(
                     logcat,
@@ -3587,19 +4529,160 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
 
+    if (auto* filter = m_key_image_filter.load(); filter && !filter->maybe_contains(img))
+        return false;
+
     bool ret;
 
     TXN_PREFIX_RDONLY();
     RCURSOR(spent_keys);
 
     MDB_val k = {sizeof(img), (void*)&img};
-    ret = (mdb_cursor_get(m_cur_spent_keys, (MDB_val*)&zerokval, &k, MDB_GET_BOTH) == 0);
+    ret = (lmdb_cursor_get(m_cur_spent_keys, (MDB_val*)&zerokval, &k, MDB_GET_BOTH) == 0);
 
     return ret;
 }
 
+// Smallest filter we build (about 2MB), so that a new or small chain doesn't need a rebuild almost
+// immediately.
+static constexpr size_t MIN_KEY_IMAGE_FILTER_CAPACITY = 1 << 20;
+// Key images scanned per read txn while building, so that a build doesn't hold one read txn (and
+// thus hold up resizing) for the entire table.
+static constexpr size_t KEY_IMAGE_FILTER_BUILD_CHUNK = 100'000;
+
+void BlockchainLMDB::start_key_image_filter_build() {
+    std::lock_guard lock{m_key_image_filter_mutex};
+    if (m_key_image_filter_pending)
+        return;  // Already building
+    if (m_key_image_filter_thread.joinable())
+        m_key_image_filter_thread.join();
+
+    uint64_t count;
+    {
+        TXN_PREFIX_RDONLY();
+        MDB_stat stat;
+        if (auto result = mdb_stat(m_txn, m_spent_keys, &stat))
+            throw0(DB_ERROR("Failed to query m_spent_keys: {}"_format(mdb_strerror(result))));
+        count = stat.ms_entries;
+    }
+
+    auto& filter = m_key_image_filters.emplace_back(std::make_unique<key_image_filter>(
+            std::max<size_t>(2 * count, MIN_KEY_IMAGE_FILTER_CAPACITY)));
+    m_key_image_filter_pending = filter.get();
+    m_key_image_filter_stop = false;
+    m_key_image_filter_thread =
+            std::thread{[this, f = filter.get()] { build_key_image_filter(f); }};
+}
+
+void BlockchainLMDB::check_key_image_filter() {
+    auto* filter = m_key_image_filter.load();
+    if (!filter || filter->size() <= filter->capacity() || m_key_image_filter_pending)
+        return;
+    try {
+        start_key_image_filter_build();
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to start rebuilding the key image filter: {}", e.what());
+    }
+}
+
+void BlockchainLMDB::build_key_image_filter(key_image_filter* filter) {
+    auto started = std::chrono::steady_clock::now();
+    try {
+        std::optional<crypto::key_image> after;
+        while (!m_key_image_filter_stop) {
+            auto n = scan_key_images(after, KEY_IMAGE_FILTER_BUILD_CHUNK, [filter](const auto& ki) {
+                filter->insert(ki);
+            });
+            if (n < KEY_IMAGE_FILTER_BUILD_CHUNK) {
+                m_key_image_filter = filter;
+                m_key_image_filter_pending = nullptr;
+                log::info(
+                        logcat,
+                        "Built spent key image filter for {} key images in {}",
+                        filter->size(),
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - started));
+                return;
+            }
+        }
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to build spent key image filter: {}", e.what());
+    }
+    m_key_image_filter_pending = nullptr;
+}
+
+void BlockchainLMDB::stop_key_image_filter() {
+    std::lock_guard lock{m_key_image_filter_mutex};
+    m_key_image_filter_stop = true;
+    if (m_key_image_filter_thread.joinable())
+        m_key_image_filter_thread.join();
+    m_key_image_filter = nullptr;
+    m_key_image_filter_pending = nullptr;
+    m_key_image_filters.clear();
+}
+
+size_t BlockchainLMDB::scan_key_images(
+        std::optional<crypto::key_image>& after,
+        size_t limit,
+        const std::function<void(const crypto::key_image&)>& f) const {
+    check_open();
+
+    TXN_PREFIX_RDONLY();
+    RCURSOR(spent_keys);
+
+    MDB_val k = zerokval, v;
+    MDB_cursor_op op = MDB_FIRST;
+    if (after) {
+        v = {sizeof(*after), (void*)&*after};
+        op = MDB_GET_BOTH_RANGE;
+    }
+
+    size_t n = 0;
+    for (bool first = true; n < limit; first = false) {
+        int ret = lmdb_cursor_get(m_cur_spent_keys, &k, &v, op);
+        op = MDB_NEXT;
+        if (ret == MDB_NOTFOUND)
+            break;
+        if (ret)
+            throw0(DB_ERROR("Failed to enumerate key images: {}"_format(mdb_strerror(ret))));
+        const auto& ki = *static_cast<const crypto::key_image*>(v.mv_data);
+        if (first && after && ki == *after)
+            continue;  // The last one from the previous call
+        after = ki;
+        f(ki);
+        n++;
+    }
+    return n;
+}
+
 bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_image&)> f) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    return for_key_images_range(f, nullptr, nullptr);
+}
+
+bool BlockchainLMDB::for_all_key_images_parallel(
+        std::function<bool(const crypto::key_image&)> f, unsigned shards) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    if (write_txn_active())
+        return for_key_images_range(f, nullptr, nullptr);
+    std::atomic<bool> stopped = false;
+    auto g = [&](const crypto::key_image& ki) {
+        if (stopped || !f(ki)) {
+            stopped = true;
+            return false;
+        }
+        return true;
+    };
+    scan_hash_shards(shards, [&](const crypto::hash* from, const crypto::hash* to) {
+        for_key_images_range(g, from, to);
+    });
+    return !stopped;
+}
+
+bool BlockchainLMDB::for_key_images_range(
+        const std::function<bool(const crypto::key_image&)>& f,
+        const crypto::hash* from,
+        const crypto::hash* to) const {
     check_open();
 
     TXN_PREFIX_RDONLY();
@@ -3610,13 +4693,20 @@ bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_ima
 
     k = zerokval;
     MDB_cursor_op op = MDB_FIRST;
+    if (from) {
+        v = MDB_val{sizeof(*from), (void*)from};
+        op = MDB_GET_BOTH_RANGE;
+    }
+    MDB_val end{to ? sizeof(*to) : 0, (void*)to};
     while (1) {
-        int ret = mdb_cursor_get(m_cur_spent_keys, &k, &v, op);
+        int ret = lmdb_cursor_get(m_cur_spent_keys, &k, &v, op);
         op = MDB_NEXT;
         if (ret == MDB_NOTFOUND)
             break;
         if (ret < 0)
             throw0(DB_ERROR("Failed to enumerate key images"));
+        if (to && compare_hash32(&v, &end) >= 0)
+            break;
         const crypto::key_image k_image = *(const crypto::key_image*)v.mv_data;
         if (!f(k_image)) {
             fret = false;
@@ -3649,15 +4739,14 @@ bool BlockchainLMDB::for_blocks_range(
         op = MDB_FIRST;
     }
     while (1) {
-        int ret = mdb_cursor_get(m_cur_blocks, &k, &v, op);
+        int ret = lmdb_cursor_get(m_cur_blocks, &k, &v, op);
         op = MDB_NEXT;
         if (ret == MDB_NOTFOUND)
             break;
         if (ret)
             throw0(DB_ERROR("Failed to enumerate blocks"));
         uint64_t height = *(const uint64_t*)k.mv_data;
-        std::string bd;
-        bd.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+        std::string_view bd = block_blob_from_value(v);
         block b;
         if (!parse_and_validate_block_from_blob(bd, b))
             throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
@@ -3679,6 +4768,35 @@ bool BlockchainLMDB::for_all_transactions(
         std::function<bool(const crypto::hash&, const cryptonote::transaction&)> f,
         bool pruned) const {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    return for_transactions_range(f, pruned, nullptr, nullptr);
+}
+
+bool BlockchainLMDB::for_all_transactions_parallel(
+        std::function<bool(const crypto::hash&, const cryptonote::transaction&)> f,
+        bool pruned,
+        unsigned shards) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    if (write_txn_active())
+        return for_transactions_range(f, pruned, nullptr, nullptr);
+    std::atomic<bool> stopped = false;
+    auto g = [&](const crypto::hash& hash, const cryptonote::transaction& tx) {
+        if (stopped || !f(hash, tx)) {
+            stopped = true;
+            return false;
+        }
+        return true;
+    };
+    scan_hash_shards(shards, [&](const crypto::hash* from, const crypto::hash* to) {
+        for_transactions_range(g, pruned, from, to);
+    });
+    return !stopped;
+}
+
+bool BlockchainLMDB::for_transactions_range(
+        const std::function<bool(const crypto::hash&, const cryptonote::transaction&)>& f,
+        bool pruned,
+        const crypto::hash* from,
+        const crypto::hash* to) const {
     check_open();
 
     TXN_PREFIX_RDONLY();
@@ -3690,21 +4808,29 @@ bool BlockchainLMDB::for_all_transactions(
     MDB_val v;
     bool fret = true;
 
+    k = zerokval;
     MDB_cursor_op op = MDB_FIRST;
+    if (from) {
+        v = MDB_val{sizeof(*from), (void*)from};
+        op = MDB_GET_BOTH_RANGE;
+    }
+    MDB_val end{to ? sizeof(*to) : 0, (void*)to};
     while (1) {
-        int ret = mdb_cursor_get(m_cur_tx_indices, &k, &v, op);
+        int ret = lmdb_cursor_get(m_cur_tx_indices, &k, &v, op);
         op = MDB_NEXT;
         if (ret == MDB_NOTFOUND)
             break;
         if (ret)
             throw0(DB_ERROR("Failed to enumerate transactions: {}"_format(mdb_strerror(ret))));
+        if (to && compare_hash32(&v, &end) >= 0)
+            break;
 
         txindex* ti = (txindex*)v.mv_data;
         const crypto::hash hash = ti->key;
         k.mv_data = (void*)&ti->data.tx_id;
         k.mv_size = sizeof(ti->data.tx_id);
 
-        ret = mdb_cursor_get(m_cur_txs_pruned, &k, &v, MDB_SET);
+        ret = lmdb_cursor_get(m_cur_txs_pruned, &k, &v, MDB_SET);
         if (ret == MDB_NOTFOUND)
             break;
         if (ret)
@@ -3717,7 +4843,7 @@ bool BlockchainLMDB::for_all_transactions(
                 throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
             }
         } else {
-            ret = mdb_cursor_get(m_cur_txs_prunable, &k, &v, MDB_SET);
+            ret = lmdb_cursor_get(m_cur_txs_prunable, &k, &v, MDB_SET);
             if (ret)
                 throw0(DB_ERROR(
                         "Failed to get prunable tx data the db: {}"_format(mdb_strerror(ret))));
@@ -3750,7 +4876,7 @@ bool BlockchainLMDB::for_all_outputs(
 
     MDB_cursor_op op = MDB_FIRST;
     while (1) {
-        int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, op);
+        int ret = lmdb_cursor_get(m_cur_output_amounts, &k, &v, op);
         op = MDB_NEXT;
         if (ret == MDB_NOTFOUND)
             break;
@@ -3782,7 +4908,7 @@ bool BlockchainLMDB::for_all_outputs(
 
     MDB_cursor_op op = MDB_SET;
     while (1) {
-        int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, op);
+        int ret = lmdb_cursor_get(m_cur_output_amounts, &k, &v, op);
         op = MDB_NEXT_DUP;
         if (ret == MDB_NOTFOUND)
             break;
@@ -3804,6 +4930,10 @@ bool BlockchainLMDB::for_all_outputs(
     return fret;
 }
 
+bool BlockchainLMDB::write_txn_active() const {
+    return m_write_txn && m_writer == boost::this_thread::get_id();
+}
+
 // batch_num_blocks: (optional) Used to check if resize needed before batch transaction starts.
 bool BlockchainLMDB::batch_start(uint64_t batch_num_blocks, uint64_t batch_bytes) {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
@@ -3869,6 +4999,7 @@ void BlockchainLMDB::batch_commit() {
     delete m_write_batch_txn;
     m_write_batch_txn = nullptr;
     memset(&m_wcursors, 0, sizeof(m_wcursors));
+    check_key_image_filter();
 }
 
 void BlockchainLMDB::cleanup_batch() {
@@ -3881,6 +5012,7 @@ void BlockchainLMDB::cleanup_batch() {
 }
 
 void BlockchainLMDB::batch_stop() {
+    OXEN_TRACE_SPAN(logcat, "batch_stop");
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     if (!m_batch_transactions)
         throw0(DB_ERROR("batch transactions not enabled"));
@@ -3894,6 +5026,9 @@ void BlockchainLMDB::batch_stop() {
     log::trace(logcat, "batch transaction: committing...");
     auto time1 = std::chrono::steady_clock::now();
     try {
+        // Blobs must be on disk before the locations referring to them are
+        if (m_blob_store)
+            m_blob_store->sync();
         m_write_txn->commit();
         time_commit1 += std::chrono::steady_clock::now() - time1;
         cleanup_batch();
@@ -3901,9 +5036,98 @@ void BlockchainLMDB::batch_stop() {
         cleanup_batch();
         throw;
     }
+    check_key_image_filter();
     log::trace(logcat, "batch transaction: end");
 }
 
+void BlockchainLMDB::set_hot_cache_size(size_t bytes) {
+    m_hot_cache.set_budget(bytes);
+}
+
+void BlockchainLMDB::set_spending_index(bool enabled) {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+    if (enabled == m_spending_index_from.has_value())
+        return;
+    if (is_read_only()) {
+        log::warning(
+                logcat,
+                "Cannot {} the spending index of a read-only database",
+                enabled ? "enable" : "disable");
+        return;
+    }
+
+    TXN_PREFIX(0);
+    MDB_val_str(k, "spending_index_from");
+    if (enabled) {
+        uint64_t from = height();
+        MDB_val_set(v, from);
+        if (auto result = lmdb_put(*txn_ptr, m_properties, &k, &v, 0))
+            throw0(DB_ERROR("Failed to enable the spending index: {}"_format(
+                    mdb_strerror(result))));
+        m_spending_index_from = from;
+        log::info(logcat, "Spending index enabled from height {}", from);
+    } else {
+        for (auto dbi : {m_spent_key_txs, m_output_key_txs})
+            if (auto result = mdb_drop(*txn_ptr, dbi, 0))
+                throw0(DB_ERROR("Failed to drop the spending index: {}"_format(
+                        mdb_strerror(result))));
+        if (auto result = lmdb_del(*txn_ptr, m_properties, &k, nullptr);
+            result && result != MDB_NOTFOUND)
+            throw0(DB_ERROR("Failed to disable the spending index: {}"_format(
+                    mdb_strerror(result))));
+        m_spending_index_from.reset();
+        log::info(logcat, "Spending index disabled and dropped");
+    }
+    TXN_POSTFIX_SUCCESS();
+}
+
+std::optional<uint64_t> BlockchainLMDB::spending_index_height() const {
+    return m_spending_index_from;
+}
+
+std::optional<spending_tx> BlockchainLMDB::get_spending_tx(const crypto::key_image& img) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+    if (!m_spending_index_from || !m_have_spending_tables)
+        return std::nullopt;
+
+    TXN_PREFIX_RDONLY();
+    MDB_val_set(k, img);
+    MDB_val v;
+    auto result = lmdb_get(m_txn, m_spent_key_txs, &k, &v);
+    if (result == MDB_NOTFOUND)
+        return std::nullopt;
+    if (result)
+        throw0(DB_ERROR(
+                "Error attempting to retrieve a key image from the spending index: {}"_format(
+                        mdb_strerror(result))));
+    key_tx kt;
+    std::memcpy(&kt, v.mv_data, sizeof(kt));
+    return spending_tx{kt.tx_hash, kt.value};
+}
+
+std::optional<tx_out_index> BlockchainLMDB::get_output_key_tx(const crypto::public_key& key) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+    if (!m_spending_index_from || !m_have_spending_tables)
+        return std::nullopt;
+
+    TXN_PREFIX_RDONLY();
+    MDB_val_set(k, key);
+    MDB_val v;
+    auto result = lmdb_get(m_txn, m_output_key_txs, &k, &v);
+    if (result == MDB_NOTFOUND)
+        return std::nullopt;
+    if (result)
+        throw0(DB_ERROR(
+                "Error attempting to retrieve an output key from the spending index: {}"_format(
+                        mdb_strerror(result))));
+    key_tx kt;
+    std::memcpy(&kt, v.mv_data, sizeof(kt));
+    return tx_out_index{kt.tx_hash, kt.value};
+}
+
 void BlockchainLMDB::batch_abort() {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     if (!m_batch_transactions)
@@ -3924,6 +5148,8 @@ void BlockchainLMDB::batch_abort() {
     m_write_batch_txn = nullptr;
     m_batch_active = false;
     memset(&m_wcursors, 0, sizeof(m_wcursors));
+    // The cache may have blocks from the batch we just threw away
+    m_hot_cache.clear();
     log::trace(logcat, "batch transaction: aborted");
 }
 
@@ -4016,6 +5242,7 @@ void BlockchainLMDB::block_wtxn_start() {
 }
 
 void BlockchainLMDB::block_wtxn_stop() {
+    OXEN_TRACE_SPAN(logcat, "block_wtxn_stop");
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     if (!m_write_txn)
         throw0(DB_ERROR_TXN_START(
@@ -4026,12 +5253,15 @@ void BlockchainLMDB::block_wtxn_stop() {
     {
         if (!m_batch_active) {
             auto time1 = std::chrono::steady_clock::now();
+            if (m_blob_store)
+                m_blob_store->sync();
             m_write_txn->commit();
             time_commit1 += std::chrono::steady_clock::now() - time1;
 
             delete m_write_txn;
             m_write_txn = nullptr;
             memset(&m_wcursors, 0, sizeof(m_wcursors));
+            check_key_image_filter();
         }
     }
 }
@@ -4049,6 +5279,7 @@ void BlockchainLMDB::block_wtxn_abort() {
         delete m_write_txn;
         m_write_txn = nullptr;
         memset(&m_wcursors, 0, sizeof(m_wcursors));
+        m_hot_cache.clear();
     }
 }
 
@@ -4065,6 +5296,7 @@ uint64_t BlockchainLMDB::add_block(
         const difficulty_type& cumulative_difficulty,
         const uint64_t& coins_generated,
         const std::vector<std::pair<transaction, std::string>>& txs) {
+    OXEN_TRACE_SPAN(logcat, "add_block");
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     check_open();
     uint64_t m_height = height();
@@ -4089,6 +5321,16 @@ uint64_t BlockchainLMDB::add_block(
         throw;
     }
 
+    record_map_usage();
+
+    if (m_hot_cache.enabled()) {
+        std::vector<std::pair<crypto::hash, std::string_view>> tx_blobs;
+        tx_blobs.reserve(txs.size());
+        for (size_t i = 0; i < txs.size(); i++)
+            tx_blobs.emplace_back(blk.first.tx_hashes[i], txs[i].second);
+        m_hot_cache.add_block(m_height, blk.second, tx_blobs);
+    }
+
     return ++m_height;
 }
 
@@ -4157,7 +5399,7 @@ void BlockchainLMDB::update_block_checkpoint(checkpoint_t const& checkpoint) {
     MDB_val value = {};
     value.mv_size = buffer.len;
     value.mv_data = buffer.data;
-    int ret = mdb_cursor_put(m_cursors->block_checkpoints, &key, &value, 0);
+    int ret = lmdb_cursor_put(m_cursors->block_checkpoints, &key, &value, 0);
     if (ret)
         throw0(DB_ERROR("Failed to update block checkpoint in db transaction: {}"_format(
                 mdb_strerror(ret))));
@@ -4172,9 +5414,9 @@ void BlockchainLMDB::remove_block_checkpoint(uint64_t height) {
 
     MDB_val_set(key, height);
     MDB_val value = {};
-    int ret = mdb_cursor_get(m_cursors->block_checkpoints, &key, &value, MDB_SET_KEY);
+    int ret = lmdb_cursor_get(m_cursors->block_checkpoints, &key, &value, MDB_SET_KEY);
     if (ret == MDB_SUCCESS) {
-        ret = mdb_cursor_del(m_cursors->block_checkpoints, 0);
+        ret = lmdb_cursor_del(m_cursors->block_checkpoints, 0);
         if (ret)
             throw0(DB_ERROR("Failed to delete block checkpoint: {}"_format(mdb_strerror(ret))));
     } else {
@@ -4208,7 +5450,7 @@ bool BlockchainLMDB::get_block_checkpoint_internal(
 
     MDB_val_set(key, height);
     MDB_val value = {};
-    int ret = mdb_cursor_get(m_cursors->block_checkpoints, &key, &value, op);
+    int ret = lmdb_cursor_get(m_cursors->block_checkpoints, &key, &value, op);
     if (ret == MDB_SUCCESS) {
         checkpoint = convert_mdb_val_to_checkpoint(value);
     }
@@ -4288,7 +5530,7 @@ std::vector<checkpoint_t> BlockchainLMDB::get_checkpoints_range(
         RCURSOR(block_checkpoints);
 
         MDB_val_set(key, first_checkpoint.height);
-        int ret = mdb_cursor_get(m_cursors->block_checkpoints, &key, nullptr, MDB_SET_KEY);
+        int ret = lmdb_cursor_get(m_cursors->block_checkpoints, &key, nullptr, MDB_SET_KEY);
         if (ret != MDB_SUCCESS)
             throw0(DB_ERROR("Unexpected failure to get checkpoint we just queried: {}"_format(
                     mdb_strerror(ret))));
@@ -4301,7 +5543,7 @@ std::vector<checkpoint_t> BlockchainLMDB::get_checkpoints_range(
 
         for (; result.size() < num_desired_checkpoints;) {
             MDB_val value = {};
-            ret = mdb_cursor_get(m_cursors->block_checkpoints, nullptr, &value, op);
+            ret = lmdb_cursor_get(m_cursors->block_checkpoints, nullptr, &value, op);
 
             if (ret == MDB_NOTFOUND)
                 break;
@@ -4349,7 +5591,7 @@ void BlockchainLMDB::get_output_tx_and_index_from_global(
     for (const uint64_t& output_id : global_indices) {
         MDB_val_set(v, output_id);
 
-        auto get_result = mdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
+        auto get_result = lmdb_cursor_get(m_cur_output_txs, (MDB_val*)&zerokval, &v, MDB_GET_BOTH);
         if (get_result == MDB_NOTFOUND)
             throw1(OUTPUT_DNE("output with given index not in db"));
         else if (get_result)
@@ -4372,41 +5614,83 @@ void BlockchainLMDB::get_output_key(
     auto db3 = std::chrono::steady_clock::now();
     check_open();
     outputs.clear();
-    outputs.reserve(offsets.size());
+
+    const auto amount_at = [&](size_t i) { return amounts.size() == 1 ? amounts[0] : amounts[i]; };
+
+    // Look the outputs up in key order rather than request order: decoy requests are spread
+    // randomly across the whole output set, and walking it in order means consecutive lookups
+    // mostly hit the same or neighbouring pages, and runs of adjacent indices (and repeats) can
+    // just step the cursor instead of doing a full search.
+    std::vector<size_t> order(offsets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return std::make_pair(amount_at(a), offsets[a]) < std::make_pair(amount_at(b), offsets[b]);
+    });
+
+    outputs.resize(offsets.size());
+    // With allow_partial we return the outputs preceding the first (in request order) missing one
+    size_t first_missing = offsets.size();
 
     TXN_PREFIX_RDONLY();
 
     RCURSOR(output_amounts);
 
-    for (size_t i = 0; i < offsets.size(); ++i) {
-        const uint64_t amount = amounts.size() == 1 ? amounts[0] : amounts[i];
+    bool have_prev = false;
+    uint64_t prev_amount = 0, prev_offset = 0;
+    size_t prev_i = 0;
+    for (size_t i : order) {
+        const uint64_t amount = amount_at(i);
+        const uint64_t offset = offsets[i];
+
+        if (have_prev && amount == prev_amount && offset == prev_offset) {
+            outputs[i] = outputs[prev_i];
+            continue;
+        }
+
         MDB_val_set(k, amount);
-        MDB_val_set(v, offsets[i]);
+        MDB_val_set(v, offset);
+        int get_result;
+        if (have_prev && amount == prev_amount && offset == prev_offset + 1) {
+            get_result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_NEXT_DUP);
+            if (get_result == 0 && *(const uint64_t*)v.mv_data != offset)
+                get_result = MDB_NOTFOUND;
+        } else {
+            get_result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
+        }
 
-        auto get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
         if (get_result == MDB_NOTFOUND) {
             if (allow_partial) {
-                log::debug(logcat, "Partial result: {}/{}", outputs.size(), offsets.size());
-                break;
+                first_missing = std::min(first_missing, i);
+                have_prev = false;
+                continue;
             }
             throw1(
                     OUTPUT_DNE("Attempting to get output pubkey by global index (amount {}, index "
                                "{}, count {}), but key does not exist (current height {})"_format(
-                                       amount, offsets[i], get_num_outputs(amount), height())));
+                                       amount, offset, get_num_outputs(amount), height())));
         } else if (get_result)
             throw0(DB_ERROR("Error attempting to retrieve an output pubkey from the db{}"_format(
                     mdb_strerror(get_result))));
 
         if (amount == 0) {
             const outkey* okp = (const outkey*)v.mv_data;
-            outputs.push_back(okp->data);
+            outputs[i] = okp->data;
         } else {
             const pre_rct_outkey* okp = (const pre_rct_outkey*)v.mv_data;
-            outputs.resize(outputs.size() + 1);
-            output_data_t& data = outputs.back();
+            output_data_t& data = outputs[i];
             memcpy(&data, &okp->data, sizeof(pre_rct_output_data_t));
             data.commitment = rct::zeroCommit(amount);
         }
+
+        have_prev = true;
+        prev_amount = amount;
+        prev_offset = offset;
+        prev_i = i;
+    }
+
+    if (first_missing < outputs.size()) {
+        log::debug(logcat, "Partial result: {}/{}", first_missing, offsets.size());
+        outputs.resize(first_missing);
     }
     log::trace(logcat, "db3: {}", tools::friendly_duration(std::chrono::steady_clock::now() - db3));
 }
@@ -4429,7 +5713,7 @@ void BlockchainLMDB::get_output_tx_and_index(
     for (const uint64_t& index : offsets) {
         MDB_val_set(v, index);
 
-        auto get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
+        auto get_result = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
         if (get_result == MDB_NOTFOUND)
             throw1(OUTPUT_DNE("Attempting to get output by index, but key does not exist"));
         else if (get_result)
@@ -4465,7 +5749,7 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
     if (amounts.empty()) {
         MDB_cursor_op op = MDB_FIRST;
         while (1) {
-            int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, op);
+            int ret = lmdb_cursor_get(m_cur_output_amounts, &k, &v, op);
             op = MDB_NEXT_NODUP;
             if (ret == MDB_NOTFOUND)
                 break;
@@ -4480,7 +5764,7 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
     } else {
         for (const auto& amount : amounts) {
             MDB_val_copy<uint64_t> k(amount);
-            int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
+            int ret = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_SET);
             if (ret == MDB_NOTFOUND) {
                 if (0 >= min_count)
                     histogram[amount] = std::make_tuple(0, 0, 0);
@@ -4497,37 +5781,56 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
 
     if (unlocked || recent_cutoff > 0) {
         const uint64_t blockchain_height = height();
-        for (std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>>::iterator i =
-                     histogram.begin();
-             i != histogram.end();
-             ++i) {
-            uint64_t amount = i->first;
-            uint64_t num_elems = std::get<0>(i->second);
-            while (num_elems > 0) {
-                const tx_out_index toi = get_output_tx_and_index(amount, num_elems - 1);
-                const uint64_t height = get_tx_block_height(toi.first);
-                if (height + DEFAULT_TX_SPENDABLE_AGE <= blockchain_height)
-                    break;
-                --num_elems;
+
+        // An amount's outputs are stored in amount index order, which is also the order of the
+        // heights they were created at, so the number created at or below a given height can be
+        // binary searched instead of walking back through the outputs one at a time.
+        auto count_at_or_below = [&](uint64_t amount, uint64_t num_elems, uint64_t max_height) {
+            uint64_t lo = 0, hi = num_elems;
+            while (lo < hi) {
+                const uint64_t mid = lo + (hi - lo) / 2;
+                MDB_val_set(k, amount);
+                MDB_val_set(v, mid);
+                int ret = lmdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
+                if (ret)
+                    throw0(DB_ERROR("Failed to enumerate outputs: {}"_format(mdb_strerror(ret))));
+                const uint64_t height = amount == 0
+                                              ? ((const outkey*)v.mv_data)->data.height
+                                              : ((const pre_rct_outkey*)v.mv_data)->data.height;
+                if (height <= max_height)
+                    lo = mid + 1;
+                else
+                    hi = mid;
             }
-            // modifying second does not invalidate the iterator
-            std::get<1>(i->second) = num_elems;
-
-            if (recent_cutoff > 0) {
-                uint64_t recent = 0;
-                while (num_elems > 0) {
-                    const tx_out_index toi = get_output_tx_and_index(amount, num_elems - 1);
-                    const uint64_t height = get_tx_block_height(toi.first);
-                    const uint64_t ts = get_block_timestamp(height);
-                    if (ts < recent_cutoff)
-                        break;
-                    --num_elems;
-                    ++recent;
+            return lo;
+        };
+
+        // Outputs from the last DEFAULT_TX_SPENDABLE_AGE blocks are still locked
+        const bool any_unlocked = blockchain_height >= DEFAULT_TX_SPENDABLE_AGE;
+        const uint64_t unlocked_top = any_unlocked ? blockchain_height - DEFAULT_TX_SPENDABLE_AGE : 0;
+
+        // Unlocked outputs are recent back to the most recent unlocked block older than the cutoff;
+        // find that once for all amounts.
+        std::optional<uint64_t> cutoff_height;
+        if (recent_cutoff > 0 && any_unlocked) {
+            for (uint64_t h = unlocked_top + 1; h-- > 0;) {
+                if (get_block_timestamp(h) < recent_cutoff) {
+                    cutoff_height = h;
+                    break;
                 }
-                // modifying second does not invalidate the iterator
-                std::get<2>(i->second) = recent;
             }
         }
+
+        for (auto& [amount, counts] : histogram) {
+            auto& [num_elems, num_unlocked, num_recent] = counts;
+            num_unlocked =
+                    any_unlocked ? count_at_or_below(amount, num_elems, unlocked_top) : 0;
+            if (recent_cutoff > 0)
+                num_recent = num_unlocked - (cutoff_height
+                                                     ? count_at_or_below(
+                                                               amount, num_unlocked, *cutoff_height)
+                                                     : 0);
+        }
     }
 
     return histogram;
@@ -4556,7 +5859,7 @@ bool BlockchainLMDB::get_output_distribution(
     MDB_cursor_op op = MDB_SET;
     base = 0;
     while (1) {
-        int ret = mdb_cursor_get(m_cur_output_amounts, &k, &v, op);
+        int ret = lmdb_cursor_get(m_cur_output_amounts, &k, &v, op);
         op = MDB_NEXT_DUP;
         if (ret == MDB_NOTFOUND)
             break;
@@ -4595,13 +5898,13 @@ void BlockchainLMDB::get_output_blacklist(std::vector<uint64_t>& blacklist) cons
     MDB_val val;
     blacklist.reserve(db_stat.ms_entries);
 
-    if (int ret = mdb_cursor_get(m_cur_output_blacklist, &key, &val, MDB_FIRST)) {
+    if (int ret = lmdb_cursor_get(m_cur_output_blacklist, &key, &val, MDB_FIRST)) {
         if (ret != MDB_NOTFOUND) {
             throw0(DB_ERROR("Failed to enumerate output blacklist: {}"_format(mdb_strerror(ret))));
         }
     } else {
         for (MDB_cursor_op op = MDB_GET_MULTIPLE;; op = MDB_NEXT_MULTIPLE) {
-            int ret = mdb_cursor_get(m_cur_output_blacklist, &key, &val, op);
+            int ret = lmdb_cursor_get(m_cur_output_blacklist, &key, &val, op);
             if (ret == MDB_NOTFOUND)
                 break;
             if (ret)
@@ -4632,7 +5935,7 @@ void BlockchainLMDB::add_output_blacklist(std::vector<uint64_t> const& blacklist
     put_entries[0].mv_data = (uint64_t*)blacklist.data();
     put_entries[1].mv_size = blacklist.size();
 
-    if (int ret = mdb_cursor_put(
+    if (int ret = lmdb_cursor_put(
                 m_cur_output_blacklist, (MDB_val*)&zerokval, (MDB_val*)put_entries, MDB_MULTIPLE))
         throw0(DB_ERROR("Failed to add blacklisted output to db transaction: {}"_format(
                 mdb_strerror(ret))));
@@ -4676,7 +5979,7 @@ void BlockchainLMDB::add_alt_block(
     }
 
     MDB_val v = {val_size, (void*)val.get()};
-    if (auto result = mdb_cursor_put(m_cur_alt_blocks, &k, &v, MDB_NODUPDATA)) {
+    if (auto result = lmdb_cursor_put(m_cur_alt_blocks, &k, &v, MDB_NODUPDATA)) {
         if (result == MDB_KEYEXIST)
             throw1(DB_ERROR("Attempting to add alternate block that's already in the db"));
         else
@@ -4698,7 +6001,7 @@ bool BlockchainLMDB::get_alt_block(
 
     MDB_val_set(k, blkid);
     MDB_val v;
-    int result = mdb_cursor_get(m_cur_alt_blocks, &k, &v, MDB_SET);
+    int result = lmdb_cursor_get(m_cur_alt_blocks, &k, &v, MDB_SET);
     if (result == MDB_NOTFOUND)
         return false;
 
@@ -4719,11 +6022,11 @@ void BlockchainLMDB::remove_alt_block(const crypto::hash& blkid) {
 
     MDB_val k = {sizeof(blkid), (void*)&blkid};
     MDB_val v;
-    int result = mdb_cursor_get(m_cur_alt_blocks, &k, &v, MDB_SET);
+    int result = lmdb_cursor_get(m_cur_alt_blocks, &k, &v, MDB_SET);
     if (result)
         throw0(DB_ERROR("Error locating alternate block {} in the db: {}"_format(
                 blkid, mdb_strerror(result))));
-    result = mdb_cursor_del(m_cur_alt_blocks, 0);
+    result = lmdb_cursor_del(m_cur_alt_blocks, 0);
     if (result)
         throw0(DB_ERROR("Error deleting alternate block {} from the db: {}"_format(
                 blkid, mdb_strerror(result))));
@@ -4777,6 +6080,27 @@ uint64_t BlockchainLMDB::get_database_size() const {
     return fs::file_size(m_folder / BLOCKCHAINDATA_FILENAME);
 }
 
+db_stats BlockchainLMDB::get_stats() const {
+    db_stats stats;
+    {
+        std::lock_guard lock{table_counters_mutex};
+        for (const auto& [name, c] : all_table_counters)
+            stats.tables.push_back(
+                    {name,
+                     c->gets.value(),
+                     c->puts.value(),
+                     c->deletes.value(),
+                     c->cursor_ops.value(),
+                     c->bytes_read.value(),
+                     c->bytes_written.value()});
+    }
+    stats.commits = commit_times().count();
+    stats.commit_seconds = commit_times().sum();
+    stats.resizes = resize_times().count();
+    stats.resize_seconds = resize_times().sum();
+    return stats;
+}
+
 void BlockchainLMDB::fixup(cryptonote::network_type nettype) {
     log::trace(logcat, "BlockchainLMDB::{}", __func__);
     // Always call parent as well
@@ -4834,7 +6158,7 @@ void BlockchainLMDB::fixup(cryptonote::network_type nettype) {
                 try {
                     // NOTE: Retrieve block info
                     MDB_val_copy key(curr_height + 1);
-                    if (int result = mdb_cursor_get(
+                    if (int result = lmdb_cursor_get(
                                 m_cur_block_info, (MDB_val*)&zerokval, &key, MDB_GET_BOTH))
                         throw1(BLOCK_DNE(
                                 "Failed to get block info in recalculate difficulty: {}"_format(
@@ -4866,7 +6190,7 @@ void BlockchainLMDB::fixup(cryptonote::network_type nettype) {
 
                     // NOTE: Store to DB
                     MDB_val_set(val, next_block);
-                    if (int result = mdb_cursor_put(
+                    if (int result = lmdb_cursor_put(
                                 m_cur_block_info, (MDB_val*)&zerokval, &val, MDB_CURRENT))
                         throw1(BLOCK_DNE(
                                 "Failed to put block info: {}"_format(mdb_strerror(result))));
@@ -4909,7 +6233,7 @@ void BlockchainLMDB::fixup(cryptonote::network_type nettype) {
         if (result)                                                                            \
             throw0(DB_ERROR(                                                                   \
                     "Failed to open a cursor for {}: {}"_format(name, mdb_strerror(result)))); \
-        result = mdb_cursor_get(c_cur, &k, NULL, MDB_SET_KEY);                                 \
+        result = lmdb_cursor_get(c_cur, &k, NULL, MDB_SET_KEY);                                 \
         if (result)                                                                            \
             throw0(DB_ERROR(                                                                   \
                     "Failed to get DB record for {}: {}"_format(name, mdb_strerror(result)))); \
@@ -4927,7 +6251,7 @@ static int write_db_version(MDB_env* env, MDB_dbi& dest, uint32_t version) {
     int result = mdb_txn_begin(env, NULL, 0, txn);
     if (result)
         return result;
-    result = mdb_put(txn, dest, &vk, &v, 0);
+    result = lmdb_put(txn, dest, &vk, &v, 0);
     if (result)
         return result;
     txn.commit();
@@ -5031,7 +6355,7 @@ void BlockchainLMDB::migrate_0_1() {
                     i = ms.ms_entries;
                 }
             }
-            result = mdb_cursor_get(c_old, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_old, &k, &v, MDB_NEXT);
             if (result == MDB_NOTFOUND) {
                 txn.commit();
                 break;
@@ -5040,7 +6364,7 @@ void BlockchainLMDB::migrate_0_1() {
                         mdb_strerror(result))));
             bh.bh_hash = *(crypto::hash*)k.mv_data;
             bh.bh_height = *(uint64_t*)v.mv_data;
-            result = mdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
+            result = lmdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
             if (result)
                 throw0(DB_ERROR("Failed to put a record into block_heightr: {}"_format(
                         mdb_strerror(result))));
@@ -5048,7 +6372,7 @@ void BlockchainLMDB::migrate_0_1() {
              * This is a little slower than just letting mdb_drop() delete it all at the end, but
              * it saves a significant amount of disk space.
              */
-            result = mdb_cursor_del(c_old, 0);
+            result = lmdb_cursor_del(c_old, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_heights: {}"_format(
                         mdb_strerror(result))));
@@ -5159,7 +6483,7 @@ void BlockchainLMDB::migrate_0_1() {
                     i = ms.ms_entries;
                 }
             }
-            result = mdb_cursor_get(c_coins, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_coins, &k, &v, MDB_NEXT);
             if (result == MDB_NOTFOUND) {
                 break;
             } else if (result)
@@ -5167,17 +6491,17 @@ void BlockchainLMDB::migrate_0_1() {
                         mdb_strerror(result))));
             bi.bi_height = *(uint64_t*)k.mv_data;
             bi.bi_coins = *(uint64_t*)v.mv_data;
-            result = mdb_cursor_get(c_diffs, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_diffs, &k, &v, MDB_NEXT);
             if (result)
                 throw0(DB_ERROR("Failed to get a record from block_diffs: {}"_format(
                         mdb_strerror(result))));
             bi.bi_diff = *(uint64_t*)v.mv_data;
-            result = mdb_cursor_get(c_hashes, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_hashes, &k, &v, MDB_NEXT);
             if (result)
                 throw0(DB_ERROR("Failed to get a record from block_hashes: {}"_format(
                         mdb_strerror(result))));
             bi.bi_hash = *(crypto::hash*)v.mv_data;
-            result = mdb_cursor_get(c_sizes, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_sizes, &k, &v, MDB_NEXT);
             if (result)
                 throw0(DB_ERROR("Failed to get a record from block_sizes: {}"_format(
                         mdb_strerror(result))));
@@ -5185,32 +6509,32 @@ void BlockchainLMDB::migrate_0_1() {
                 bi.bi_weight = *(uint32_t*)v.mv_data;
             else
                 bi.bi_weight = *(uint64_t*)v.mv_data;  // this is a 32/64 compat bug in version 0
-            result = mdb_cursor_get(c_timestamps, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_timestamps, &k, &v, MDB_NEXT);
             if (result)
                 throw0(DB_ERROR("Failed to get a record from block_timestamps: {}"_format(
                         mdb_strerror(result))));
             bi.bi_timestamp = *(uint64_t*)v.mv_data;
-            result = mdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
+            result = lmdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
             if (result)
                 throw0(DB_ERROR(
                         "Failed to put a record into block_info: {}"_format(mdb_strerror(result))));
-            result = mdb_cursor_del(c_coins, 0);
+            result = lmdb_cursor_del(c_coins, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_coins: {}"_format(
                         mdb_strerror(result))));
-            result = mdb_cursor_del(c_diffs, 0);
+            result = lmdb_cursor_del(c_diffs, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_diffs: {}"_format(
                         mdb_strerror(result))));
-            result = mdb_cursor_del(c_hashes, 0);
+            result = lmdb_cursor_del(c_hashes, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_hashes: {}"_format(
                         mdb_strerror(result))));
-            result = mdb_cursor_del(c_sizes, 0);
+            result = lmdb_cursor_del(c_sizes, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_sizes: {}"_format(
                         mdb_strerror(result))));
-            result = mdb_cursor_del(c_timestamps, 0);
+            result = lmdb_cursor_del(c_timestamps, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_timestamps: {}"_format(
                         mdb_strerror(result))));
@@ -5308,18 +6632,18 @@ void BlockchainLMDB::migrate_0_1() {
                     i = ms.ms_entries;
                 }
             }
-            result = mdb_cursor_get(c_old, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_old, &k, &v, MDB_NEXT);
             if (result == MDB_NOTFOUND) {
                 txn.commit();
                 break;
             } else if (result)
                 throw0(DB_ERROR("Failed to get a record from hf_versions: {}"_format(
                         mdb_strerror(result))));
-            result = mdb_cursor_put(c_cur, &k, &v, MDB_APPEND);
+            result = lmdb_cursor_put(c_cur, &k, &v, MDB_APPEND);
             if (result)
                 throw0(DB_ERROR("Failed to put a record into hf_versionr: {}"_format(
                         mdb_strerror(result))));
-            result = mdb_cursor_del(c_old, 0);
+            result = lmdb_cursor_del(c_old, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from hf_versions: {}"_format(
                         mdb_strerror(result))));
@@ -5473,7 +6797,7 @@ void BlockchainLMDB::migrate_0_1() {
                     }
                     MDB_val_set(pk, "txblk");
                     MDB_val_set(pv, m_height);
-                    result = mdb_cursor_put(c_props, &pk, &pv, 0);
+                    result = lmdb_cursor_put(c_props, &pk, &pv, 0);
                     if (result)
                         throw0(DB_ERROR("Failed to update txblk property: {}"_format(
                                 mdb_strerror(result))));
@@ -5507,7 +6831,7 @@ void BlockchainLMDB::migrate_0_1() {
                     i = ms.ms_entries;
                     if (i) {
                         MDB_val_set(pk, "txblk");
-                        result = mdb_cursor_get(c_props, &pk, &k, MDB_SET);
+                        result = lmdb_cursor_get(c_props, &pk, &k, MDB_SET);
                         if (result)
                             throw0(DB_ERROR("Failed to get a record from properties: {}"_format(
                                     mdb_strerror(result))));
@@ -5515,20 +6839,20 @@ void BlockchainLMDB::migrate_0_1() {
                     }
                 }
                 if (i) {
-                    result = mdb_cursor_get(c_blocks, &k, &v, MDB_SET);
+                    result = lmdb_cursor_get(c_blocks, &k, &v, MDB_SET);
                     if (result)
                         throw0(DB_ERROR("Failed to get a record from blocks: {}"_format(
                                 mdb_strerror(result))));
                 }
             }
-            result = mdb_cursor_get(c_blocks, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_blocks, &k, &v, MDB_NEXT);
             if (result == MDB_NOTFOUND) {
                 MDB_val_set(pk, "txblk");
-                result = mdb_cursor_get(c_props, &pk, &v, MDB_SET);
+                result = lmdb_cursor_get(c_props, &pk, &v, MDB_SET);
                 if (result)
                     throw0(DB_ERROR(
                             "Failed to get a record from props: {}"_format(mdb_strerror(result))));
-                result = mdb_cursor_del(c_props, 0);
+                result = lmdb_cursor_del(c_props, 0);
                 if (result)
                     throw0(DB_ERROR("Failed to delete a record from props: {}"_format(
                             mdb_strerror(result))));
@@ -5547,7 +6871,7 @@ void BlockchainLMDB::migrate_0_1() {
             for (unsigned int j = 0; j < b.tx_hashes.size(); j++) {
                 transaction tx;
                 hk.mv_data = &b.tx_hashes[j];
-                result = mdb_cursor_get(c_txs, &hk, &v, MDB_SET);
+                result = lmdb_cursor_get(c_txs, &hk, &v, MDB_SET);
                 if (result)
                     throw0(DB_ERROR(
                             "Failed to get record from txs: {}"_format(mdb_strerror(result))));
@@ -5555,7 +6879,7 @@ void BlockchainLMDB::migrate_0_1() {
                 if (!parse_and_validate_tx_from_blob(bd, tx))
                     throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
                 add_transaction(null<hash>, std::make_pair(std::move(tx), bd), &b.tx_hashes[j]);
-                result = mdb_cursor_del(c_txs, 0);
+                result = lmdb_cursor_del(c_txs, 0);
                 if (result)
                     throw0(DB_ERROR(
                             "Failed to get record from txs: {}"_format(mdb_strerror(result))));
@@ -5667,7 +6991,7 @@ void BlockchainLMDB::migrate_1_2() {
                 }
             }
             MDB_val_set(k, i);
-            result = mdb_cursor_get(c_old, &k, &v, MDB_SET);
+            result = lmdb_cursor_get(c_old, &k, &v, MDB_SET);
             if (result == MDB_NOTFOUND) {
                 txn.commit();
                 break;
@@ -5696,14 +7020,14 @@ void BlockchainLMDB::migrate_1_2() {
             MDB_val nv;
             nv.mv_data = (void*)pruned.data();
             nv.mv_size = pruned.size();
-            result = mdb_cursor_put(c_cur0, (MDB_val*)&k, &nv, 0);
+            result = lmdb_cursor_put(c_cur0, (MDB_val*)&k, &nv, 0);
             if (result)
                 throw0(DB_ERROR(
                         "Failed to put a record into txs_pruned: {}"_format(mdb_strerror(result))));
 
             nv.mv_data = (void*)(bd.data() + pruned.size());
             nv.mv_size = bd.size() - pruned.size();
-            result = mdb_cursor_put(c_cur1, (MDB_val*)&k, &nv, 0);
+            result = lmdb_cursor_put(c_cur1, (MDB_val*)&k, &nv, 0);
             if (result)
                 throw0(DB_ERROR("Failed to put a record into txs_prunable: {}"_format(
                         mdb_strerror(result))));
@@ -5711,13 +7035,13 @@ void BlockchainLMDB::migrate_1_2() {
             if (tx.version >= cryptonote::txversion::v2_ringct) {
                 crypto::hash prunable_hash = get_transaction_prunable_hash(tx);
                 MDB_val_set(val_prunable_hash, prunable_hash);
-                result = mdb_cursor_put(c_cur2, (MDB_val*)&k, &val_prunable_hash, 0);
+                result = lmdb_cursor_put(c_cur2, (MDB_val*)&k, &val_prunable_hash, 0);
                 if (result)
                     throw0(DB_ERROR("Failed to put a record into txs_prunable_hash: {}"_format(
                             mdb_strerror(result))));
             }
 
-            result = mdb_cursor_del(c_old, 0);
+            result = lmdb_cursor_del(c_old, 0);
             if (result)
                 throw0(DB_ERROR(
                         "Failed to delete a record from txs: {}"_format(mdb_strerror(result))));
@@ -5815,7 +7139,7 @@ void BlockchainLMDB::migrate_2_3() {
                     i = db_stats.ms_entries;
                 }
             }
-            result = mdb_cursor_get(c_old, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_old, &k, &v, MDB_NEXT);
             if (result == MDB_NOTFOUND) {
                 txn.commit();
                 break;
@@ -5828,7 +7152,7 @@ void BlockchainLMDB::migrate_2_3() {
                 throw0(DB_ERROR("Bad height in block_info record"));
             bi.bi_cum_rct = distribution[bi.bi_height];
             MDB_val_set(nv, bi);
-            result = mdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
+            result = lmdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
             if (result)
                 throw0(DB_ERROR(
                         "Failed to put a record into block_infn: {}"_format(mdb_strerror(result))));
@@ -5836,7 +7160,7 @@ void BlockchainLMDB::migrate_2_3() {
              * This is a little slower than just letting mdb_drop() delete it all at the end, but
              * it saves a significant amount of disk space.
              */
-            result = mdb_cursor_del(c_old, 0);
+            result = lmdb_cursor_del(c_old, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_info: {}"_format(
                         mdb_strerror(result))));
@@ -5905,7 +7229,7 @@ void BlockchainLMDB::migrate_3_4() {
                     transaction tx;
                     txindex const* tx_index = (txindex const*)val.mv_data;
                     {
-                        int ret = mdb_cursor_get(m_cur_tx_indices, &key, &val, op);
+                        int ret = lmdb_cursor_get(m_cur_tx_indices, &key, &val, op);
                         if (ret == MDB_NOTFOUND)
                             break;
                         if (ret)
@@ -5916,7 +7240,7 @@ void BlockchainLMDB::migrate_3_4() {
                         key.mv_data = (void*)&tx_index->data.tx_id;
                         key.mv_size = sizeof(tx_index->data.tx_id);
                         {
-                            ret = mdb_cursor_get(m_cur_txs_pruned, &key, &val, MDB_SET);
+                            ret = lmdb_cursor_get(m_cur_txs_pruned, &key, &val, MDB_SET);
                             if (ret == MDB_NOTFOUND)
                                 break;
                             if (ret)
@@ -5925,7 +7249,7 @@ void BlockchainLMDB::migrate_3_4() {
 
                             bd.append(reinterpret_cast<char*>(val.mv_data), val.mv_size);
 
-                            ret = mdb_cursor_get(m_cur_txs_prunable, &key, &val, MDB_SET);
+                            ret = lmdb_cursor_get(m_cur_txs_prunable, &key, &val, MDB_SET);
                             if (ret)
                                 throw0(DB_ERROR("Failed to get prunable tx data the db: {}"_format(
                                         mdb_strerror(ret))));
@@ -6048,7 +7372,7 @@ void BlockchainLMDB::migrate_3_4() {
                     i = db_stats.ms_entries;
                 }
             }
-            result = mdb_cursor_get(c_old, &k, &v, MDB_NEXT);
+            result = lmdb_cursor_get(c_old, &k, &v, MDB_NEXT);
             if (result == MDB_NOTFOUND) {
                 txn.commit();
                 break;
@@ -6062,7 +7386,7 @@ void BlockchainLMDB::migrate_3_4() {
             if (!past_long_term_weight) {
                 MDB_val_copy<uint64_t> kb(bi.bi_height);
                 MDB_val vb = {};
-                result = mdb_cursor_get(c_blocks, &kb, &vb, MDB_SET);
+                result = lmdb_cursor_get(c_blocks, &kb, &vb, MDB_SET);
                 if (result)
                     throw0(DB_ERROR("Failed to query m_blocks: {}"_format(mdb_strerror(result))));
                 if (vb.mv_size == 0)
@@ -6089,7 +7413,7 @@ void BlockchainLMDB::migrate_3_4() {
             bi.bi_long_term_block_weight = long_term_block_weight;
 
             MDB_val_set(nv, bi);
-            result = mdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
+            result = lmdb_cursor_put(c_cur, (MDB_val*)&zerokval, &nv, MDB_APPENDDUP);
             if (result)
                 throw0(DB_ERROR(
                         "Failed to put a record into block_infn: {}"_format(mdb_strerror(result))));
@@ -6097,7 +7421,7 @@ void BlockchainLMDB::migrate_3_4() {
              * This is a little slower than just letting mdb_drop() delete it all at the end, but
              * it saves a significant amount of disk space.
              */
-            result = mdb_cursor_del(c_old, 0);
+            result = lmdb_cursor_del(c_old, 0);
             if (result)
                 throw0(DB_ERROR("Failed to delete a record from block_info: {}"_format(
                         mdb_strerror(result))));
@@ -6164,7 +7488,7 @@ void BlockchainLMDB::migrate_4_5(cryptonote::network_type /*nettype*/) {
     std::vector<entry_t> new_entries;
     for (MDB_cursor_op op = MDB_FIRST;; op = MDB_NEXT) {
         MDB_val key, val;
-        int ret = mdb_cursor_get(cursor, &key, &val, op);
+        int ret = lmdb_cursor_get(cursor, &key, &val, op);
         if (ret == MDB_NOTFOUND)
             break;
         if (ret)
@@ -6207,7 +7531,7 @@ void BlockchainLMDB::migrate_4_5(cryptonote::network_type /*nettype*/) {
 
         MDB_val_set(key, entry.key);
         MDB_val val = {val_size, (void*)val_buf.get()};
-        int ret = mdb_cursor_put(cursor, &key, &val, 0);
+        int ret = lmdb_cursor_put(cursor, &key, &val, 0);
         if (ret)
             throw0(DB_ERROR("Failed to re-update alt block data: {}"_format(mdb_strerror(ret))));
     }
@@ -6261,7 +7585,7 @@ void BlockchainLMDB::migrate_5_6() {
 
     for (MDB_cursor_op op = MDB_FIRST;; op = MDB_NEXT) {
         MDB_val key, val;
-        int ret = mdb_cursor_get(cursor, &key, &val, op);
+        int ret = lmdb_cursor_get(cursor, &key, &val, op);
         if (ret == MDB_NOTFOUND)
             break;
         if (ret)
@@ -6316,7 +7640,7 @@ void BlockchainLMDB::migrate_5_6() {
 
         val.mv_size = buffer.len;
         val.mv_data = buffer.data;
-        ret = mdb_cursor_put(cursor, &key, &val, MDB_CURRENT);
+        ret = lmdb_cursor_put(cursor, &key, &val, MDB_CURRENT);
         if (ret)
             throw0(DB_ERROR(
                     "Failed to update block checkpoint in db migration transaction: {}"_format(
@@ -6354,7 +7678,7 @@ void BlockchainLMDB::migrate_6_7() {
         // NOTE: Copy DB contents into memory
         for (MDB_cursor_op op = MDB_FIRST;; op = MDB_NEXT) {
             MDB_val key, val;
-            int ret = mdb_cursor_get(cursor, &key, &val, op);
+            int ret = lmdb_cursor_get(cursor, &key, &val, op);
             if (ret == MDB_NOTFOUND)
                 break;
             if (ret)
@@ -6399,7 +7723,7 @@ void BlockchainLMDB::migrate_6_7() {
             MDB_val value = {};
             value.mv_size = buffer.len;
             value.mv_data = buffer.data;
-            int ret = mdb_cursor_put(cursor, &key, &value, 0);
+            int ret = lmdb_cursor_put(cursor, &key, &value, 0);
             if (ret)
                 throw0(DB_ERROR("Failed to update block checkpoint in db transaction: {}"_format(
                         mdb_strerror(ret))));
@@ -6438,7 +7762,7 @@ void BlockchainLMDB::set_service_node_data(const std::string& data, bool long_te
     MDB_val_set(k, key);
     MDB_val_sized(blob, data);
     int result;
-    result = mdb_cursor_put(m_cursors->service_node_data, &k, &blob, 0);
+    result = lmdb_cursor_put(m_cursors->service_node_data, &k, &blob, 0);
     if (result)
         throw0(DB_ERROR("Failed to add service node data to db transaction: {}"_format(
                 mdb_strerror(result))));
@@ -6457,7 +7781,7 @@ bool BlockchainLMDB::get_service_node_data(std::string& data, bool long_term) co
     MDB_val_set(k, key);
     MDB_val v;
 
-    int result = mdb_cursor_get(m_cursors->service_node_data, &k, &v, MDB_SET_KEY);
+    int result = lmdb_cursor_get(m_cursors->service_node_data, &k, &v, MDB_SET_KEY);
     if (result != MDB_SUCCESS) {
         if (result == MDB_NOTFOUND) {
             return false;
@@ -6486,13 +7810,93 @@ void BlockchainLMDB::clear_service_node_data() {
     for (uint64_t const key : BLOB_KEYS) {
         MDB_val_set(k, key);
         int result;
-        if ((result = mdb_cursor_get(m_cursors->service_node_data, &k, NULL, MDB_SET)))
-            return;
-        if ((result = mdb_cursor_del(m_cursors->service_node_data, 0)))
+        if ((result = lmdb_cursor_get(m_cursors->service_node_data, &k, NULL, MDB_SET)))
+            continue;
+        if ((result = lmdb_cursor_del(m_cursors->service_node_data, 0)))
             throw1(DB_ERROR(
                     "Failed to add removal of service node data to db transaction: {}"_format(
                             mdb_strerror(result))));
     }
+
+    remove_service_node_states_from(0);
+}
+
+void BlockchainLMDB::set_service_node_state(uint64_t height, std::string_view data) {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+
+    mdb_txn_cursors* m_cursors = &m_wcursors;
+    CURSOR(service_node_states);
+
+    MDB_val_set(k, height);
+    MDB_val_sized(v, data);
+    if (int result = lmdb_cursor_put(m_cur_service_node_states, &k, &v, 0))
+        throw0(DB_ERROR("Failed to add service node state to db transaction: {}"_format(
+                mdb_strerror(result))));
+}
+
+void BlockchainLMDB::remove_service_node_states_before(uint64_t height) {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+
+    mdb_txn_cursors* m_cursors = &m_wcursors;
+    CURSOR(service_node_states);
+
+    MDB_val k, v;
+    int result;
+    while ((result = lmdb_cursor_get(m_cur_service_node_states, &k, &v, MDB_FIRST)) == 0 &&
+           *static_cast<const uint64_t*>(k.mv_data) < height)
+        if ((result = lmdb_cursor_del(m_cur_service_node_states, 0)))
+            throw1(DB_ERROR("Failed to remove service node state: {}"_format(
+                    mdb_strerror(result))));
+    if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR("Failed to enumerate service node states: {}"_format(
+                mdb_strerror(result))));
+}
+
+void BlockchainLMDB::remove_service_node_states_from(uint64_t height) {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+
+    mdb_txn_cursors* m_cursors = &m_wcursors;
+    CURSOR(service_node_states);
+
+    MDB_val k, v;
+    int result;
+    while ((result = lmdb_cursor_get(m_cur_service_node_states, &k, &v, MDB_LAST)) == 0 &&
+           *static_cast<const uint64_t*>(k.mv_data) >= height)
+        if ((result = lmdb_cursor_del(m_cur_service_node_states, 0)))
+            throw1(DB_ERROR("Failed to remove service node state: {}"_format(
+                    mdb_strerror(result))));
+    if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR("Failed to enumerate service node states: {}"_format(
+                mdb_strerror(result))));
+}
+
+bool BlockchainLMDB::for_all_service_node_states(
+        std::function<bool(uint64_t height, std::string_view data)> f) const {
+    log::trace(logcat, "BlockchainLMDB::{}", __func__);
+    check_open();
+
+    if (!m_have_service_node_states)
+        return true;
+
+    TXN_PREFIX_RDONLY();
+    RCURSOR(service_node_states);
+
+    MDB_val k, v;
+    for (MDB_cursor_op op = MDB_FIRST;; op = MDB_NEXT) {
+        int result = lmdb_cursor_get(m_cur_service_node_states, &k, &v, op);
+        if (result == MDB_NOTFOUND)
+            break;
+        if (result)
+            throw0(DB_ERROR("Failed to enumerate service node states: {}"_format(
+                    mdb_strerror(result))));
+        if (!f(*static_cast<const uint64_t*>(k.mv_data),
+               {static_cast<const char*>(v.mv_data), v.mv_size}))
+            return false;
+    }
+    return true;
 }
 
 template <typename C>
@@ -6594,7 +7998,7 @@ bool BlockchainLMDB::get_service_node_proof(
     RCURSOR(service_node_proofs);
     MDB_val v, k{sizeof(pubkey), (void*)&pubkey};
 
-    int result = mdb_cursor_get(m_cursors->service_node_proofs, &k, &v, MDB_SET_KEY);
+    int result = lmdb_cursor_get(m_cursors->service_node_proofs, &k, &v, MDB_SET_KEY);
     if (result == MDB_NOTFOUND)
         return false;
     else if (result != MDB_SUCCESS)
@@ -6618,7 +8022,7 @@ void BlockchainLMDB::set_service_node_proof(
 
     TXN_BLOCK_PREFIX(0);
     MDB_val k{sizeof(pubkey), (void*)&pubkey}, v{sizeof(data), &data};
-    int result = mdb_put(*txn_ptr, m_service_node_proofs, &k, &v, 0);
+    int result = lmdb_put(*txn_ptr, m_service_node_proofs, &k, &v, 0);
     if (result)
         throw0(DB_ERROR("Failed to add service node latest proof data to db transaction: {}"_format(
                 mdb_strerror(result))));
@@ -6658,13 +8062,13 @@ bool BlockchainLMDB::remove_service_node_proof(const crypto::public_key& pubkey)
     CURSOR(service_node_proofs)
 
     MDB_val k{sizeof(pubkey), (void*)&pubkey};
-    auto result = mdb_cursor_get(m_cursors->service_node_proofs, &k, NULL, MDB_SET);
+    auto result = lmdb_cursor_get(m_cursors->service_node_proofs, &k, NULL, MDB_SET);
     if (result == MDB_NOTFOUND)
         return false;
     if (result != MDB_SUCCESS)
         throw0(DB_ERROR(
                 "Error finding service node proof to remove{}"_format(mdb_strerror(result))));
-    result = mdb_cursor_del(m_cursors->service_node_proofs, 0);
+    result = lmdb_cursor_del(m_cursors->service_node_proofs, 0);
     if (result)
         throw0(DB_ERROR("Error remove service node proof{}"_format(mdb_strerror(result))));
     return true;
@@ -31,9 +31,20 @@
 #include <atomic>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/tss.hpp>
-
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+#include "blockchain_db/blob_store.h"
 #include "blockchain_db/blockchain_db.h"
+#include "blockchain_db/hot_cache.h"
+#include "blockchain_db/key_image_filter.h"
 #include "common/fs.h"
+#include "common/metrics.h"
 #include "ringct/rctTypes.h"
 
 #define ENABLE_AUTO_RESIZE
@@ -74,6 +85,7 @@ struct mdb_txn_cursors {
     MDB_cursor* hf_versions;
 
     MDB_cursor* service_node_data;
+    MDB_cursor* service_node_states;
     MDB_cursor* service_node_proofs;
     MDB_cursor* output_blacklist;
     MDB_cursor* properties;
@@ -101,6 +113,7 @@ struct mdb_rflags {
     bool m_rf_alt_blocks;
     bool m_rf_hf_versions;
     bool m_rf_service_node_data;
+    bool m_rf_service_node_states;
     bool m_rf_service_node_proofs;
     bool m_rf_properties;
 };
@@ -177,6 +190,8 @@ class BlockchainLMDB : public BlockchainDB {
 
     std::vector<fs::path> get_filenames() const override;
 
+    void copy_to(const fs::path& dir, bool compact = true) const override;
+
     bool remove_data_file(const fs::path& folder) const override;
 
     std::string get_db_name() const override;
@@ -199,6 +214,8 @@ class BlockchainLMDB : public BlockchainDB {
 
     std::string get_block_blob_from_height(uint64_t height) const override;
 
+    std::string_view get_block_blob_view_from_height(uint64_t height) const override;
+
     std::vector<uint64_t> get_block_cumulative_rct_outputs(
             const std::vector<uint64_t>& heights) const override;
 
@@ -243,6 +260,8 @@ class BlockchainLMDB : public BlockchainDB {
     bool get_pruned_tx_blob(const crypto::hash& h, std::string& tx) const override;
     bool get_pruned_tx_blobs_from(
             const crypto::hash& h, size_t count, std::vector<std::string>& bd) const override;
+    bool get_pruned_tx_blob_views_from(
+            const crypto::hash& h, size_t count, std::vector<std::string_view>& bd) const override;
     bool get_prunable_tx_blob(const crypto::hash& h, std::string& tx) const override;
     bool get_prunable_tx_hash(
             const crypto::hash& tx_hash, crypto::hash& prunable_hash) const override;
@@ -254,6 +273,9 @@ class BlockchainLMDB : public BlockchainDB {
     std::vector<uint64_t> get_tx_block_heights(
             const std::vector<crypto::hash>& hlist) const override;
 
+    std::vector<std::optional<tx_lookup>> get_txs_data(
+            const std::vector<crypto::hash>& hs) const override;
+
     uint64_t get_num_outputs(const uint64_t& amount) const override;
 
     output_data_t get_output_key(
@@ -294,6 +316,7 @@ class BlockchainLMDB : public BlockchainDB {
     std::string get_txpool_tx_blob(const crypto::hash& txid) const override;
     uint32_t get_blockchain_pruning_seed() const override;
     bool prune_blockchain(uint32_t pruning_seed = 0) override;
+    double prune_blockchain_step(size_t max_txs, uint32_t pruning_seed = 0) override;
     bool update_pruning() override;
     bool check_pruning() override;
 
@@ -315,6 +338,7 @@ class BlockchainLMDB : public BlockchainDB {
             std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const std::string*)> f,
             bool include_blob = false,
             bool include_unrelayed_txes = true) const override;
+    void flush_txpool() override;
 
     bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const override;
     bool for_blocks_range(
@@ -325,6 +349,12 @@ class BlockchainLMDB : public BlockchainDB {
     bool for_all_transactions(
             std::function<bool(const crypto::hash&, const cryptonote::transaction&)>,
             bool pruned) const override;
+    bool for_all_transactions_parallel(
+            std::function<bool(const crypto::hash&, const cryptonote::transaction&)> f,
+            bool pruned,
+            unsigned shards = 0) const override;
+    bool for_all_key_images_parallel(
+            std::function<bool(const crypto::key_image&)> f, unsigned shards = 0) const override;
     bool for_all_outputs(
             std::function<bool(
                     uint64_t amount, const crypto::hash& tx_hash, uint64_t height, size_t tx_idx)>
@@ -360,6 +390,13 @@ class BlockchainLMDB : public BlockchainDB {
     void batch_commit();
     void batch_stop() override;
     void batch_abort() override;
+    void set_hot_cache_size(size_t bytes) override;
+    void set_spending_index(bool enabled) override;
+    void maintain_map_size() override;
+    std::optional<uint64_t> spending_index_height() const override;
+    std::optional<spending_tx> get_spending_tx(const crypto::key_image& img) const override;
+    std::optional<tx_out_index> get_output_key_tx(const crypto::public_key& key) const override;
+    bool write_txn_active() const override;
 
     void block_wtxn_start() override;
     void block_wtxn_stop() override;
@@ -405,10 +442,27 @@ class BlockchainLMDB : public BlockchainDB {
     static int compare_string(const MDB_val* a, const MDB_val* b);
 
   private:
+    // Range versions of for_all_key_images and for_all_transactions: these visit the entries with
+    // hashes in [from, to) (in compare_hash32 order), where a nullptr means the start or end.
+    bool for_key_images_range(
+            const std::function<bool(const crypto::key_image&)>& f,
+            const crypto::hash* from,
+            const crypto::hash* to) const;
+    bool for_transactions_range(
+            const std::function<bool(const crypto::hash&, const cryptonote::transaction&)>& f,
+            bool pruned,
+            const crypto::hash* from,
+            const crypto::hash* to) const;
+
     void do_resize(uint64_t size_increase = 0);
 
     bool need_resize(uint64_t threshold_size = 0) const;
     void check_and_resize_for_batch(uint64_t batch_num_blocks, uint64_t batch_bytes);
+    // Samples how much of the map is in use, for predicted_map_growth()
+    void record_map_usage();
+    // Estimates how much the map will grow over the next MAP_GROWTH_HORIZON, going by the recent
+    // write rate; 0 if we don't know yet.
+    uint64_t predicted_map_growth() const;
     uint64_t get_estimated_batch_size(uint64_t batch_num_blocks, uint64_t batch_bytes) const;
 
     void add_block(
@@ -442,6 +496,10 @@ class BlockchainLMDB : public BlockchainDB {
 
     void remove_tx_outputs(const uint64_t tx_id, const transaction& tx);
 
+    void add_spending_index_entries(
+            const transaction& tx, const crypto::hash& tx_hash, uint64_t height);
+    void remove_spending_index_entries(const transaction& tx, const crypto::hash& tx_hash);
+
     void remove_output(const uint64_t amount, const uint64_t& out_index);
 
     void prune_outputs(uint64_t amount) override;
@@ -460,6 +518,8 @@ class BlockchainLMDB : public BlockchainDB {
 
     uint64_t get_database_size() const override;
 
+    db_stats get_stats() const override;
+
     std::vector<uint64_t> get_block_info_64bit_fields(
             uint64_t start_height, size_t count, uint64_t (*extract)(const mdb_block_info*)) const;
 
@@ -488,6 +548,12 @@ class BlockchainLMDB : public BlockchainDB {
     bool get_service_node_data(std::string& data, bool long_term) const override;
     void clear_service_node_data() override;
 
+    void set_service_node_state(uint64_t height, std::string_view data) override;
+    void remove_service_node_states_before(uint64_t height) override;
+    void remove_service_node_states_from(uint64_t height) override;
+    bool for_all_service_node_states(
+            std::function<bool(uint64_t height, std::string_view data)> f) const override;
+
     bool get_service_node_proof(
             const crypto::public_key& pubkey, service_nodes::proof_info& proof) const override;
     void set_service_node_proof(
@@ -502,6 +568,27 @@ class BlockchainLMDB : public BlockchainDB {
                  std::is_same_v<T, cryptonote::block_header> || std::is_same_v<T, std::string>
     T get_and_convert_block_blob_from_height(uint64_t height, size_t* size = nullptr) const;
 
+    // Returns the block blob for a value from m_blocks, which is either the blob itself or, for a
+    // database using external blob storage, its location in m_blob_store.
+    std::string_view block_blob_from_value(const MDB_val& v) const;
+
+    // Starts building a new spent key image filter in the background, sized for the current number
+    // of spent key images.  Must be called by the writer with no write txn open, so that every key
+    // image is either already committed (and so seen by the build) or added afterwards (and so
+    // inserted by add_spent_key).
+    void start_key_image_filter_build();
+    // Starts a rebuild if the current filter is over capacity; called after write txn commits.
+    void check_key_image_filter();
+    void build_key_image_filter(key_image_filter* filter);
+    void stop_key_image_filter();
+    // Calls `f` on up to `limit` spent key images following `after` (or from the start if
+    // nullopt), updating `after` to the last one, all in a single read txn.  Returns the number of
+    // key images visited.
+    size_t scan_key_images(
+            std::optional<crypto::key_image>& after,
+            size_t limit,
+            const std::function<void(const crypto::key_image&)>& f) const;
+
     MDB_env* m_env;
 
     MDB_dbi m_blocks;
@@ -532,13 +619,22 @@ class BlockchainLMDB : public BlockchainDB {
     MDB_dbi m_hf_versions;
 
     MDB_dbi m_service_node_data;
+    MDB_dbi m_service_node_states;
+    bool m_have_service_node_states = false;  // false only for a read-only db that predates it
     MDB_dbi m_service_node_proofs;
 
+    MDB_dbi m_spent_key_txs;
+    MDB_dbi m_output_key_txs;
+    bool m_have_spending_tables = false;  // false only for a read-only db that predates them
+    // The height from which the spending index is maintained, if it is enabled
+    std::optional<uint64_t> m_spending_index_from;
+
     MDB_dbi m_properties;
 
     mutable uint64_t m_cum_size;  // used in batch size estimation
     mutable unsigned int m_cum_count;
     fs::path m_folder;
+    std::unique_ptr<blob_store> m_blob_store;  // set if block blobs are stored outside of LMDB
     mdb_txn_safe* m_write_txn;        // may point to either a short-lived txn or a batch txn
     mdb_txn_safe* m_write_batch_txn;  // persist batch txn outside of BlockchainLMDB
     boost::thread::id m_writer;
@@ -549,6 +645,36 @@ class BlockchainLMDB : public BlockchainDB {
     mdb_txn_cursors m_wcursors;
     mutable boost::thread_specific_ptr<mdb_threadinfo> m_tinfo;
 
+    // Spent key image filter: once built, m_key_image_filter contains every key image in
+    // m_spent_keys, so has_key_image() can skip the lookup when it says no.  While a (re)build is
+    // running the writer inserts into both it and m_key_image_filter_pending.  Filters are owned by
+    // m_key_image_filters and only freed on close, so readers need no lock to use one.
+    std::vector<std::unique_ptr<key_image_filter>> m_key_image_filters;
+    std::atomic<key_image_filter*> m_key_image_filter = nullptr;
+    std::atomic<key_image_filter*> m_key_image_filter_pending = nullptr;
+    std::thread m_key_image_filter_thread;
+    std::atomic<bool> m_key_image_filter_stop = false;
+    std::mutex m_key_image_filter_mutex;  // serializes starting and stopping builds
+
+    // Recent block and tx blobs, if enabled by set_hot_cache_size()
+    blob_hot_cache m_hot_cache;
+
+    // Txpool changes not yet written to m_txpool_meta/m_txpool_blob.  The pool makes lots of small
+    // changes (one or two per incoming tx), so rather than taking a write txn for each we keep them
+    // here, where the txpool getters see them, until flush_txpool() writes them out together.
+    struct pending_txpool_tx {
+        std::optional<txpool_tx_meta_t> meta;     // nullopt if the tx has been removed
+        std::shared_ptr<const std::string> blob;  // null if the tables' blob is current
+        bool on_disk;                             // whether the tables have the tx
+    };
+    std::unordered_map<crypto::hash, pending_txpool_tx> m_txpool_pending;
+    mutable std::mutex m_txpool_pending_mutex;
+    // Whether the tables have `txid`, ignoring any pending changes
+    bool txpool_tx_on_disk(const crypto::hash& txid) const;
+
+    // Map size gauges; registered while the db is open
+    std::vector<tools::metrics::callback_handle> m_metrics;
+
 #if defined(__arm__)
     // force a value so it can compile with 32-bit ARM
     constexpr static uint64_t DEFAULT_MAPSIZE = 1LL << 31;
@@ -564,6 +690,15 @@ class BlockchainLMDB : public BlockchainDB {
     std::mutex m_synchronization_lock;
 
     constexpr static float RESIZE_PERCENT = 0.9f;
+
+    // Samples of (time, bytes of the map in use), at most one per MAP_USAGE_SAMPLE_INTERVAL and
+    // covering about MAP_GROWTH_HORIZON, from which map growth is predicted.
+    std::deque<std::pair<std::chrono::steady_clock::time_point, uint64_t>> m_map_usage;
+    mutable std::mutex m_map_usage_mutex;
+    constexpr static auto MAP_USAGE_SAMPLE_INTERVAL = std::chrono::minutes{1};
+    constexpr static auto MAP_GROWTH_HORIZON = std::chrono::hours{1};
+    // The least free space maintain_map_size() keeps in the map
+    constexpr static uint64_t MIN_MAP_HEADROOM = 1ULL << 30;
 };
 
 }  // namespace cryptonote
@@ -0,0 +1,256 @@
+#include "address_activity.h"
+
+#include <common/exception.h>
+#include <common/format.h>
+#include <common/guts.h>
+#include <cryptonote_basic/cryptonote_basic_impl.h>
+#include <cryptonote_basic/cryptonote_format_utils.h>
+#include <cryptonote_basic/tx_extra.h>
+#include <fmt/core.h>
+
+#include <algorithm>
+
+namespace cryptonote {
+
+static auto logcat = log::Cat("blockchain.db.activity");
+
+// Prefixes of the keys in the activity_links table
+constexpr char LINK_KEY_IMAGE = 'k', LINK_BLS_PUBKEY = 'b', LINK_ONS_NAME = 'o';
+
+template <typename T>
+static std::string link_key(char prefix, const T& val) {
+    std::string key;
+    key += prefix;
+    key += tools::view_guts(val);
+    return key;
+}
+
+static std::string ons_link_key(const tx_extra_oxen_name_system& ons) {
+    auto key = link_key(LINK_ONS_NAME, ons.name_hash);
+    key += static_cast<char>(ons.type);
+    return key;
+}
+
+AddressActivityDB::AddressActivityDB(
+        network_type nettype, const std::filesystem::path& db_path) :
+        db::Database(db_path, ""), m_nettype{nettype} {
+    if (!db.tableExists("activity_info"))
+        create_schema();
+    m_height = prepared_get<int64_t>("SELECT height FROM activity_info");
+}
+
+void AddressActivityDB::create_schema() {
+    SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
+    db.exec(R"(
+      CREATE TABLE activity(
+        id INTEGER PRIMARY KEY,
+        address VARCHAR NOT NULL,
+        height BIGINT NOT NULL,
+        txid BLOB NOT NULL,
+        type VARCHAR NOT NULL,
+        subject VARCHAR NOT NULL
+      );
+      CREATE INDEX activity_address_idx ON activity(address, id);
+      CREATE INDEX activity_height_idx ON activity(height);
+
+      CREATE TABLE activity_links(
+        key BLOB NOT NULL,
+        address VARCHAR NOT NULL,
+        height BIGINT NOT NULL,
+        PRIMARY KEY(key, address)
+      );
+      CREATE INDEX activity_links_height_idx ON activity_links(height);
+
+      CREATE TABLE activity_info(
+        height BIGINT NOT NULL
+      );
+      INSERT INTO activity_info(height) VALUES(0);
+    )");
+    transaction.commit();
+}
+
+void AddressActivityDB::update_height(uint64_t new_height) {
+    m_height = new_height;
+    prepared_exec("UPDATE activity_info SET height = ?", static_cast<int64_t>(new_height));
+}
+
+void AddressActivityDB::add_block(const block& blk, const std::vector<transaction>& txs) {
+    SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
+    index_block(blk, txs);
+    transaction.commit();
+}
+
+void AddressActivityDB::add_blocks(
+        const std::vector<std::pair<block, std::vector<transaction>>>& blocks) {
+    SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
+    for (const auto& [blk, txs] : blocks)
+        index_block(blk, txs);
+    transaction.commit();
+}
+
+void AddressActivityDB::blockchain_detached(uint64_t new_height) {
+    if (new_height >= m_height)
+        return;
+    log::debug(
+            logcat, "Rewinding address activity index from height {} to {}", m_height, new_height);
+    SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
+    prepared_exec("DELETE FROM activity WHERE height >= ?", static_cast<int64_t>(new_height));
+    prepared_exec("DELETE FROM activity_links WHERE height >= ?", static_cast<int64_t>(new_height));
+    update_height(new_height);
+    transaction.commit();
+}
+
+void AddressActivityDB::index_block(const block& blk, const std::vector<transaction>& txs) {
+    const uint64_t height = blk.get_height();
+    if (height > m_height)
+        throw oxen::traced<std::invalid_argument>{
+                "Cannot index block {}: the address activity index is only at height {}"_format(
+                        height, m_height)};
+    if (height < m_height) {
+        // A reorg we didn't hear about through a detach; drop what we have from here on.
+        prepared_exec("DELETE FROM activity WHERE height >= ?", static_cast<int64_t>(height));
+        prepared_exec("DELETE FROM activity_links WHERE height >= ?", static_cast<int64_t>(height));
+    }
+
+    if (blk.tx_hashes.size() != txs.size())
+        throw oxen::traced<std::invalid_argument>{
+                "Cannot index block {}: expected {} txes, got {}"_format(
+                        height, blk.tx_hashes.size(), txs.size())};
+    for (size_t i = 0; i < txs.size(); i++)
+        index_tx(txs[i], blk.tx_hashes[i], height);
+
+    update_height(height + 1);
+}
+
+void AddressActivityDB::index_tx(
+        const transaction& tx, const crypto::hash& txid, uint64_t height) {
+    std::string sn_str;
+    if (tx_extra_service_node_pubkey pk; get_field_from_tx_extra(tx, pk))
+        sn_str = tools::hex_guts(pk.m_service_node_key);
+
+    if (tx_extra_service_node_register reg; get_field_from_tx_extra(tx, reg)) {
+        for (size_t i = 0; i < reg.public_spend_keys.size() && i < reg.public_view_keys.size();
+             i++)
+            add_event(
+                    address_str({reg.public_spend_keys[i], reg.public_view_keys[i]}),
+                    height,
+                    txid,
+                    "sn_reserved",
+                    sn_str);
+    }
+
+    if (tx_extra_service_node_contributor contrib; get_field_from_tx_extra(tx, contrib)) {
+        auto address = address_str({contrib.m_spend_public_key, contrib.m_view_public_key});
+        add_event(address, height, txid, "sn_stake", sn_str);
+        if (tx_extra_tx_key_image_proofs proofs; get_field_from_tx_extra(tx, proofs))
+            for (const auto& proof : proofs.proofs)
+                link(link_key(LINK_KEY_IMAGE, proof.key_image), address, height);
+    }
+
+    if (tx_extra_tx_key_image_unlock unlock; get_field_from_tx_extra(tx, unlock))
+        for (const auto& address : linked(link_key(LINK_KEY_IMAGE, unlock.key_image)))
+            add_event(address, height, txid, "sn_unlock", sn_str);
+
+    if (eth::event::NewServiceNodeV2 reg{}; get_field_from_tx_extra(tx, reg)) {
+        auto pubkey = tools::hex_guts(reg.sn_pubkey);
+        auto bls_key = link_key(LINK_BLS_PUBKEY, reg.bls_pubkey);
+        for (const auto& c : reg.contributors) {
+            for (const auto& addr : {c.address, c.beneficiary}) {
+                auto address = "0x{:x}"_format(addr);
+                add_event(address, height, txid, "eth_sn_register", pubkey);
+                link(bls_key, address, height);
+                if (c.beneficiary == c.address)
+                    break;
+            }
+        }
+    }
+
+    auto add_bls_events = [&](const eth::bls_public_key& bls_pubkey, std::string_view type) {
+        auto bls_str = tools::hex_guts(bls_pubkey);
+        for (const auto& address : linked(link_key(LINK_BLS_PUBKEY, bls_pubkey)))
+            add_event(address, height, txid, type, bls_str);
+    };
+    if (eth::event::ServiceNodeExitRequest req{}; get_field_from_tx_extra(tx, req))
+        add_bls_events(req.bls_pubkey, "eth_sn_exit_request");
+    if (eth::event::ServiceNodeExit exit{}; get_field_from_tx_extra(tx, exit))
+        add_bls_events(exit.bls_pubkey, "eth_sn_exit");
+    if (eth::event::ServiceNodePurge purge{}; get_field_from_tx_extra(tx, purge))
+        add_bls_events(purge.bls_pubkey, "eth_sn_purge");
+
+    if (tx_extra_oxen_name_system ons; get_field_from_tx_extra(tx, ons)) {
+        std::string_view type = ons.is_buying() ? "ons_buy"
+                              : ons.is_renewing() ? "ons_renew"
+                                                  : "ons_update";
+        auto name_hash = tools::hex_guts(ons.name_hash);
+        auto key = ons_link_key(ons);
+
+        // Updates and renewals involve whoever owned the record until now, as well as any new
+        // owners that an update sets.
+        auto addresses = ons.is_buying() ? std::vector<std::string>{} : linked(key);
+        for (const auto* owner : {&ons.owner, &ons.backup_owner})
+            if (*owner) {
+                auto address = owner->to_string(m_nettype);
+                link(key, address, height);
+                if (std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+                    addresses.push_back(std::move(address));
+            }
+        for (const auto& address : addresses)
+            add_event(address, height, txid, type, name_hash);
+    }
+}
+
+void AddressActivityDB::add_event(
+        const std::string& address,
+        uint64_t height,
+        const crypto::hash& txid,
+        std::string_view type,
+        const std::string& subject) {
+    prepared_exec(
+            "INSERT INTO activity(address, height, txid, type, subject) VALUES(?, ?, ?, ?, ?)",
+            address,
+            static_cast<int64_t>(height),
+            db::blob_binder{tools::view_guts(txid)},
+            std::string{type},
+            subject);
+}
+
+void AddressActivityDB::link(std::string_view key, const std::string& address, uint64_t height) {
+    prepared_exec(
+            "INSERT OR IGNORE INTO activity_links(key, address, height) VALUES(?, ?, ?)",
+            db::blob_binder{key},
+            address,
+            static_cast<int64_t>(height));
+}
+
+std::vector<std::string> AddressActivityDB::linked(std::string_view key) {
+    return db::get_all<std::string>(prepared_bind(
+            "SELECT address FROM activity_links WHERE key = ?", db::blob_binder{key}));
+}
+
+std::string AddressActivityDB::address_str(const account_public_address& addr) const {
+    return get_account_address_as_str(m_nettype, false, addr);
+}
+
+std::vector<address_activity> AddressActivityDB::get_activity(
+        std::string_view address, int64_t after, size_t limit) {
+    limit = std::min(limit, MAX_LIMIT);
+    // The query binds this without copying, so it has to outlive the loop below
+    std::string addr{address};
+    std::vector<address_activity> result;
+    for (auto [id, height, txid, type, subject] :
+         prepared_results<int64_t, int64_t, db::blob_guts<crypto::hash>, std::string, std::string>(
+                 "SELECT id, height, txid, type, subject FROM activity"
+                 " WHERE address = ? AND id > ? ORDER BY id LIMIT ?",
+                 addr,
+                 after,
+                 static_cast<int64_t>(limit)))
+        result.push_back(
+                {id,
+                 static_cast<uint64_t>(height),
+                 std::move(txid).value,
+                 std::move(type),
+                 std::move(subject)});
+    return result;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cryptonote_basic/cryptonote_basic.h>
+#include <cryptonote_config.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <sqlitedb/database.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cryptonote {
+
+// One event in the address activity index
+struct address_activity {
+    // Increasing id of the event, used as the pagination cursor
+    int64_t id;
+    uint64_t height;
+    crypto::hash txid;
+    // What happened: sn_reserved, sn_stake, sn_unlock, eth_sn_register, eth_sn_exit_request,
+    // eth_sn_exit, eth_sn_purge, ons_buy, ons_update or ons_renew.
+    std::string type;
+    // What it happened to: the service node pubkey for the sn_* and eth_sn_register events, the BLS
+    // pubkey for the other eth_sn_* events, and the name hash of ONS events.
+    std::string subject;
+};
+
+// Optional side database (enabled with --address-activity-index) mapping wallet addresses,
+// Ethereum addresses and ONS ed25519 owners to the service node registrations, stakes and unlocks
+// and the ONS records that involved them, so that such lookups don't need a scan of the whole
+// chain.  It is kept up to date through the blockchain block add and detach hooks.
+//
+// Addresses are stored in their canonical string form: the base58 address for wallets, lower-case
+// 0x-prefixed hex for Ethereum addresses and lower-case hex for ed25519 ONS owners.
+//
+// Unlocks and L2 exits don't name an address themselves, so the index also remembers which
+// addresses the staked key images, L2 service node BLS keys and ONS names belong to as it sees them
+// and attributes later events through that.
+class AddressActivityDB : public db::Database {
+  public:
+    static constexpr size_t MAX_LIMIT = 1000;
+
+    AddressActivityDB(network_type nettype, const std::filesystem::path& db_path);
+    AddressActivityDB(const AddressActivityDB&) = delete;
+
+    // The number of blocks that have been indexed, i.e. the height of the next block to add
+    uint64_t height() const { return m_height; }
+
+    // Indexes the next block.  If a block at or below the indexed height is given, the blocks from
+    // that height on are first dropped (as if detached) and then it gets added; a block beyond
+    // the next height throws.
+    void add_block(const block& blk, const std::vector<transaction>& txs);
+
+    // Same as the above, but for a run of consecutive blocks in a single database transaction.
+    void add_blocks(const std::vector<std::pair<block, std::vector<transaction>>>& blocks);
+
+    // Drops everything indexed from blocks at heights `new_height` and above
+    void blockchain_detached(uint64_t new_height);
+
+    // Returns up to `limit` (at most MAX_LIMIT) events involving `address`, oldest first, starting
+    // after the event with id `after` (so that passing the id of the last returned event gets the
+    // next page).
+    std::vector<address_activity> get_activity(
+            std::string_view address, int64_t after = 0, size_t limit = 100);
+
+  private:
+    void create_schema();
+    void update_height(uint64_t new_height);
+    void index_block(const block& blk, const std::vector<transaction>& txs);
+    void index_tx(const transaction& tx, const crypto::hash& txid, uint64_t height);
+
+    void add_event(
+            const std::string& address,
+            uint64_t height,
+            const crypto::hash& txid,
+            std::string_view type,
+            const std::string& subject);
+    void link(std::string_view key, const std::string& address, uint64_t height);
+    std::vector<std::string> linked(std::string_view key);
+
+    std::string address_str(const account_public_address& addr) const;
+
+    network_type m_nettype;
+    uint64_t m_height = 0;
+};
+
+}  // namespace cryptonote
@@ -29,6 +29,7 @@
 
 #include <common/exception.h>
 #include <common/guts.h>
+#include <common/string_util.h>
 #include <cryptonote_basic/hardfork.h>
 #include <cryptonote_config.h>
 #include <cryptonote_core/blockchain.h>
@@ -37,7 +38,14 @@
 #include <sodium.h>
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <utility>
 
 namespace cryptonote {
 
@@ -298,6 +306,57 @@ void BlockchainSQLite::upgrade_schema() {
         transaction.commit();
     }
 
+    if (!table_exists("bls_signature_cache")) {
+        log::info(logcat, "Adding BLS signature cache to batching db");
+        SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
+        db.exec(R"(
+        CREATE TABLE bls_signature_cache(
+          type INTEGER NOT NULL,
+          id BLOB NOT NULL,
+          height BIGINT NOT NULL,
+          amount BIGINT NOT NULL,
+          msg_to_sign BLOB NOT NULL,
+          signers BLOB NOT NULL,
+          signature BLOB NOT NULL,
+          PRIMARY KEY(type, id)
+        );
+
+        CREATE TRIGGER bls_signature_cache_after_blocks_removed AFTER UPDATE ON batch_db_info
+        FOR EACH ROW WHEN NEW.height < OLD.height BEGIN
+            DELETE FROM bls_signature_cache WHERE type = 0 AND height > NEW.height;
+        END;
+        )");
+        transaction.commit();
+    }
+
+    if (!table_exists("l2_logs")) {
+        log::info(logcat, "Adding L2 event store to batching db");
+        SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
+        db.exec(R"(
+        CREATE TABLE l2_logs(
+          height BIGINT NOT NULL,
+          log_index INTEGER NOT NULL,
+          block_hash VARCHAR NOT NULL,
+          tx_hash VARCHAR NOT NULL,
+          topics VARCHAR NOT NULL,
+          data VARCHAR NOT NULL,
+          PRIMARY KEY(height, log_index)
+        );
+
+        CREATE TABLE l2_reward_rates(
+          height BIGINT PRIMARY KEY NOT NULL,
+          rate BIGINT NOT NULL
+        );
+
+        CREATE TABLE l2_sync_info(
+          id INTEGER PRIMARY KEY CHECK(id = 0),
+          synced_height BIGINT NOT NULL,
+          safe_height BIGINT NOT NULL
+        );
+        )");
+        transaction.commit();
+    }
+
     // This can be moved back into the relevant `if` clauses above eventually,
     // but the easiest way to make sure existing databases have the corrected triggers
     // is to just drop and recreate them unconditionally
@@ -337,6 +396,8 @@ void BlockchainSQLite::reset_database() {
       DROP TABLE IF EXISTS batched_payments_raw;
 
       DROP TABLE IF EXISTS batch_db_info;
+
+      DROP TABLE IF EXISTS bls_signature_cache;
     )");
 
     create_schema();
@@ -360,20 +421,40 @@ void BlockchainSQLite::blockchain_detached(uint64_t new_height) {
     if (height < new_height)
         return;
     int64_t revert_to_height = new_height - 1;
-    auto maybe_prev_interval = prepared_maybe_get<int64_t>(
-            "SELECT MAX(archive_height) FROM batched_payments_accrued_archive "
-            "WHERE archive_height <= ?",
-            revert_to_height);
 
-    if (!maybe_prev_interval) {
+    // The recent table holds a copy of the accrued rewards at every one of the last few heights,
+    // so a shallow rewind can restore the exact state without any blocks being replayed.
+    // Otherwise we go back to the closest archived snapshot and the blocks above it get re-added.
+    // (Snapshots are taken after the block at that height is applied).
+    auto min_recent = prepared_get<int64_t>(
+            "SELECT COALESCE(MIN(height), -1) FROM batched_payments_accrued_recent");
+    bool use_recent = min_recent >= 0 && revert_to_height >= min_recent;
+
+    std::optional<int64_t> snapshot_height;
+    if (use_recent)
+        snapshot_height = revert_to_height;
+    else
+        snapshot_height = prepared_maybe_get<int64_t>(
+                "SELECT MAX(archive_height) FROM batched_payments_accrued_archive "
+                "WHERE archive_height <= ?",
+                revert_to_height);
+
+    if (!snapshot_height) {
         auto fork_height =
                 cryptonote::hard_fork_begins(m_nettype, hf::hf19_reward_batching).value_or(0);
         reset_database();
         update_height(fork_height);
         return;
     }
-    const auto prev_interval = *maybe_prev_interval;
 
+    log::debug(
+            logcat,
+            "Rewinding batching db from height {} to {} snapshot at {}",
+            height,
+            use_recent ? "recent" : "archived",
+            *snapshot_height);
+
+    SQLite::Transaction transaction{db, SQLite::TransactionBehavior::IMMEDIATE};
     db.exec(fmt::format(
             R"(
       DELETE FROM batched_payments_raw WHERE height_paid > {0};
@@ -382,11 +463,13 @@ void BlockchainSQLite::blockchain_detached(uint64_t new_height) {
 
       INSERT INTO batched_payments_accrued
         SELECT address, amount, payout_offset
-        FROM batched_payments_accrued_archive WHERE archive_height = {0};
+        FROM {1} WHERE {2} = {0};
       )",
-            prev_interval));
-    update_height(prev_interval);
-    return;
+            *snapshot_height,
+            use_recent ? "batched_payments_accrued_recent" : "batched_payments_accrued_archive",
+            use_recent ? "height" : "archive_height"));
+    update_height(*snapshot_height);
+    transaction.commit();
 }
 
 // Must be called with the address_str_cache_mutex held!
@@ -420,49 +503,109 @@ std::pair<int, std::string> BlockchainSQLite::get_address_str(
     return result;
 }
 
+// Reward accruals are written with multi-row statements binding at most this many rows at a time,
+// which keeps us well under SQLite's bound parameter limit.  Bigger sets are split into power-of-2
+// sized chunks so that only a handful of distinct statements get prepared (and cached).
+static constexpr size_t MAX_ROWS_PER_STATEMENT = 128;
+using chunk_queries = std::array<std::string, std::countr_zero(MAX_ROWS_PER_STATEMENT) + 1>;
+
+// Builds the query for each chunk size; chunk_queries[i] binds 2^i rows.
+template <typename MakeQuery>
+static chunk_queries make_chunk_queries(MakeQuery&& make_query) {
+    chunk_queries queries;
+    for (size_t i = 0; i < queries.size(); i++)
+        queries[i] = make_query(size_t{1} << i);
+    return queries;
+}
+
+// Calls `f(query, rows_chunk)` for successive chunks of `rows`, stopping early (and returning
+// false) if `f` returns false.
+template <typename Row, typename F>
+static bool for_each_chunk(const chunk_queries& queries, std::span<const Row> rows, F&& f) {
+    while (!rows.empty()) {
+        size_t n = std::min(MAX_ROWS_PER_STATEMENT, std::bit_floor(rows.size()));
+        if (!f(queries[std::countr_zero(n)], rows.first(n)))
+            return false;
+        rows = rows.subspan(n);
+    }
+    return true;
+}
+
 bool BlockchainSQLite::add_sn_rewards(const block_payments& payments) {
     log::trace(logcat, "BlockchainDB_SQLITE::{}", __func__);
-    auto insert_payment = prepared_st(
-            "INSERT INTO batched_payments_accrued (address, payout_offset, amount) VALUES (?, ?, ?)"
-            " ON CONFLICT (address) DO UPDATE SET amount = amount + excluded.amount");
+    static const auto queries = make_chunk_queries([](size_t rows) {
+        return db::multi_values_query(
+                "INSERT INTO batched_payments_accrued (address, payout_offset, amount) VALUES ",
+                rows,
+                3,
+                " ON CONFLICT (address) DO UPDATE SET amount = amount + excluded.amount");
+    });
 
     const auto& netconf = get_config(m_nettype);
 
+    std::vector<std::tuple<std::string, int, int64_t>> rows;
+    rows.reserve(payments.size());
     for (auto& [addr, amt] : payments) {
         auto [offset, address_str] = get_address_str(addr, netconf.BATCHING_INTERVAL);
-        auto amount = static_cast<int64_t>(amt);
         log::trace(
                 logcat,
                 "Adding record for SN reward contributor {} to database with amount {}",
                 address_str,
                 amt);
-        db::exec_query(insert_payment, address_str, offset, amount);
-        insert_payment->reset();
+        rows.emplace_back(std::move(address_str), offset, static_cast<int64_t>(amt));
     }
 
-    return true;
+    return for_each_chunk(queries, std::span{std::as_const(rows)}, [this](auto& query, auto chunk) {
+        auto st = prepared_st(query);
+        int i = 1;
+        for (auto& [address, offset, amount] : chunk) {
+            st->bindNoCopy(i++, address);
+            st->bind(i++, offset);
+            st->bind(i++, amount);
+        }
+        st->exec();
+        return true;
+    });
 }
 
 bool BlockchainSQLite::subtract_sn_rewards(const block_payments& payments) {
     log::trace(logcat, "BlockchainDB_SQLITE::{}", __func__);
-    auto update_payment = prepared_st(
-            "UPDATE batched_payments_accrued SET amount = (amount - ?) WHERE address = ?");
-
-    for (auto& [addr, amt] : payments) {
-        auto [offset, address_str] = get_address_str(addr, 0);
-        auto result = db::exec_query(update_payment, static_cast<int64_t>(amt), address_str);
-        if (!result) {
+    // UPDATE ... FROM needs sqlite 3.33 but we still support 3.24, so the amounts get joined in
+    // through a CTE instead.
+    static const auto queries = make_chunk_queries([](size_t rows) {
+        return db::multi_values_query(
+                "WITH v(address, amount) AS (VALUES ",
+                rows,
+                2,
+                ") UPDATE batched_payments_accrued"
+                " SET amount = amount - (SELECT v.amount FROM v"
+                " WHERE v.address = batched_payments_accrued.address)"
+                " WHERE address IN (SELECT address FROM v)");
+    });
+
+    std::vector<std::pair<std::string, int64_t>> rows;
+    rows.reserve(payments.size());
+    for (auto& [addr, amt] : payments)
+        rows.emplace_back(get_address_str(addr, 0).second, static_cast<int64_t>(amt));
+
+    return for_each_chunk(queries, std::span{std::as_const(rows)}, [this](auto& query, auto chunk) {
+        auto st = prepared_st(query);
+        int i = 1;
+        for (auto& [address, amount] : chunk) {
+            st->bindNoCopy(i++, address);
+            st->bind(i++, amount);
+        }
+        if (auto updated = st->exec(); updated != static_cast<int>(chunk.size())) {
             log::error(
                     logcat,
-                    "tried to subtract payment from an address that doesn't exist or has "
-                    "insufficient balance: {}",
-                    address_str);
+                    "tried to subtract payments from addresses that don't exist or have "
+                    "insufficient balance: only {} of {} addresses updated",
+                    updated,
+                    chunk.size());
             return false;
         }
-        update_payment->reset();
-    }
-
-    return true;
+        return true;
+    });
 }
 
 std::vector<cryptonote::batch_sn_payment> BlockchainSQLite::get_sn_payments(uint64_t block_height) {
@@ -591,53 +734,36 @@ void BlockchainSQLite::add_rewards(
         uint64_t distribution_amount,
         const service_nodes::service_node_info& sn_info,
         block_payments& payments) const {
-    // Find out how much is due for the operator: fee_portions/PORTIONS * reward
-    assert(sn_info.portions_for_operator <= old::STAKING_PORTIONS);
-    uint64_t operator_fee =
-            mul128_div64(sn_info.portions_for_operator, distribution_amount, old::STAKING_PORTIONS);
-
-    assert(operator_fee <= distribution_amount);
-
-    // NOTE: Localdev does not have a cryptonote->ETH address step, so, old pre-ETH SN nodes don't
-    // have an address assigned to it. This breaks tests that expect pre-ETH SN's to receive
-    // funds in order to proceed.
-    bool use_eth_address = hf_version >= hf::hf21_eth;
-    if (use_eth_address && m_nettype == network_type::LOCALDEV) {
-        if (!sn_info.operator_ethereum_address)
-            use_eth_address = false;
-    }
-
-    // Pay the operator fee to the operator
-    if (operator_fee > 0) {
-        if (use_eth_address) {
-            assert(sn_info.contributors.size());  // NOTE: Be paranoid, check contributors size
-            eth::address fee_recipient = sn_info.contributors.size()
-                                               ? sn_info.contributors[0].ethereum_beneficiary
-                                               : sn_info.operator_ethereum_address;
-            payments[fee_recipient] += operator_fee;
-        } else {
-            payments[sn_info.operator_address] += operator_fee;
-        }
-    }
+    service_nodes::reward_table node;
+    node.add(sn_info, hf_version, m_nettype);
+    add_rewards(distribution_amount, node, payments);
+}
 
-    // Pay the balance to all the contributors (including the operator again)
-    uint64_t total_contributed_to_sn = std::accumulate(
-            sn_info.contributors.begin(),
-            sn_info.contributors.end(),
-            uint64_t(0),
-            [](auto&& a, auto&& b) { return a + b.amount; });
-
-    for (auto& contributor : sn_info.contributors) {
-        // This calculates (contributor.amount / total_contributed_to_winner_sn) *
-        // (distribution_amount - operator_fee) but using 128 bit integer math
-        uint64_t c_reward = mul128_div64(
-                contributor.amount, distribution_amount - operator_fee, total_contributed_to_sn);
-        if (c_reward > 0) {
-            // NOTE: At minimum, when we parsed the contributor if no benficiary is set, it should
-            // be assigned to the ethereum address by default.
-            auto& balance = use_eth_address ? payments[contributor.ethereum_beneficiary]
-                                            : payments[contributor.address];
-            balance += c_reward;
+void BlockchainSQLite::add_rewards(
+        uint64_t distribution_amount,
+        const service_nodes::reward_table& nodes,
+        block_payments& payments) const {
+    size_t c = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        // Find out how much is due for the operator: fee_portions/PORTIONS * reward
+        uint64_t operator_fee = mul128_div64(
+                nodes.operator_portions[i], distribution_amount, old::STAKING_PORTIONS);
+        assert(operator_fee <= distribution_amount);
+
+        // Pay the operator fee to the operator
+        if (operator_fee > 0)
+            payments[nodes.operator_recipient[i]] += operator_fee;
+
+        // Pay the balance to all the contributors (including the operator again)
+        for (; c < nodes.contributors_end[i]; c++) {
+            // This calculates (contributor.amount / total_contributed_to_winner_sn) *
+            // (distribution_amount - operator_fee) but using 128 bit integer math
+            uint64_t c_reward = mul128_div64(
+                    nodes.contributor_amount[c],
+                    distribution_amount - operator_fee,
+                    nodes.total_contributed[i]);
+            if (c_reward > 0)
+                payments[nodes.contributor_recipient[c]] += c_reward;
         }
     }
 }
@@ -692,12 +818,12 @@ bool BlockchainSQLite::reward_handler(
     }
 
     // Step 2: Iterate over the payable (active for >=24h) N service nodes and pay each node 1/N
-    // fraction of the total block reward.
-    const auto payable_service_nodes =
-            service_nodes_state.payable_service_nodes_infos(block.get_height(), m_nettype);
-    const uint64_t N = payable_service_nodes.size();
-    for (const auto& [node_pubkey, node_info] : payable_service_nodes)
-        add_rewards(block.major_version, block_reward / N, *node_info, payments);
+    // fraction of the total block reward.  (The table of payable nodes is cached in the state, and
+    // so gets reused when this block is popped).
+    const auto payable = service_nodes_state.payable_reward_table(
+            block.get_height(), block.major_version, m_nettype);
+    if (const uint64_t N = payable->size())
+        add_rewards(block_reward / N, *payable, payments);
 
     // Step 3: Add Governance reward to the list
     if (m_nettype != cryptonote::network_type::FAKECHAIN &&
@@ -1014,4 +1140,132 @@ bool BlockchainSQLite::delete_block_payments(uint64_t block_height) {
     return true;
 }
 
+void BlockchainSQLite::store_bls_signature(
+        bls_signature_type type, std::string_view id, const bls_cached_signature& sig) {
+    std::string_view msg{
+            reinterpret_cast<const char*>(sig.msg_to_sign.data()), sig.msg_to_sign.size()};
+    std::string_view signers{
+            reinterpret_cast<const char*>(sig.signers.data()),
+            sig.signers.size() * sizeof(eth::bls_public_key)};
+    prepared_exec(
+            "INSERT OR REPLACE INTO bls_signature_cache "
+            "(type, id, height, amount, msg_to_sign, signers, signature) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?)",
+            static_cast<int>(type),
+            db::blob_binder{id},
+            static_cast<int64_t>(sig.height),
+            static_cast<int64_t>(sig.amount),
+            db::blob_binder{msg},
+            db::blob_binder{signers},
+            db::blob_binder{tools::view_guts(sig.signature)});
+}
+
+std::optional<bls_cached_signature> BlockchainSQLite::get_bls_signature(
+        bls_signature_type type, std::string_view id) {
+    auto st = prepared_bind(
+            "SELECT height, amount, msg_to_sign, signers, signature FROM bls_signature_cache "
+            "WHERE type = ? AND id = ?",
+            static_cast<int>(type),
+            db::blob_binder{id});
+    if (!st->executeStep())
+        return std::nullopt;
+
+    auto [height, amount, msg, signers, signature] =
+            db::get<int64_t, int64_t, db::blob, db::blob, db::blob>(st);
+    if (signers.data.size() % sizeof(eth::bls_public_key) != 0 ||
+        signature.data.size() != sizeof(eth::bls_signature)) {
+        log::warning(logcat, "Ignoring invalid cached BLS signature");
+        return std::nullopt;
+    }
+
+    std::optional<bls_cached_signature> result;
+    auto& sig = result.emplace();
+    sig.height = static_cast<uint64_t>(height);
+    sig.amount = static_cast<uint64_t>(amount);
+    sig.msg_to_sign.assign(msg.data.begin(), msg.data.end());
+    sig.signers.resize(signers.data.size() / sizeof(eth::bls_public_key));
+    std::memcpy(sig.signers.data(), signers.data.data(), signers.data.size());
+    sig.signature = tools::make_from_guts<eth::bls_signature>(signature.data);
+    return result;
+}
+
+void BlockchainSQLite::prune_bls_signatures(bls_signature_type type, uint64_t cutoff) {
+    prepared_exec(
+            "DELETE FROM bls_signature_cache WHERE type = ? AND height < ?",
+            static_cast<int>(type),
+            static_cast<int64_t>(cutoff));
+}
+
+void BlockchainSQLite::store_l2_logs(std::span<const l2_stored_log> logs) {
+    for (const auto& log : logs) {
+        prepared_exec(
+                "DELETE FROM l2_logs WHERE height = ? AND block_hash != ?",
+                static_cast<int64_t>(log.height),
+                log.block_hash);
+        prepared_exec(
+                "INSERT OR REPLACE INTO l2_logs (height, log_index, block_hash, tx_hash, topics, "
+                "data) VALUES (?, ?, ?, ?, ?, ?)",
+                static_cast<int64_t>(log.height),
+                static_cast<int64_t>(log.log_index),
+                log.block_hash,
+                log.tx_hash,
+                tools::join(",", log.topics),
+                log.data);
+    }
+}
+
+void BlockchainSQLite::store_l2_reward_rate(uint64_t height, uint64_t rate) {
+    prepared_exec(
+            "INSERT OR REPLACE INTO l2_reward_rates (height, rate) VALUES (?, ?)",
+            static_cast<int64_t>(height),
+            static_cast<int64_t>(rate));
+}
+
+void BlockchainSQLite::store_l2_synced_height(uint64_t synced_height, uint64_t safe_height) {
+    prepared_exec(
+            "INSERT OR REPLACE INTO l2_sync_info (id, synced_height, safe_height) VALUES (0, ?, ?)",
+            static_cast<int64_t>(synced_height),
+            static_cast<int64_t>(safe_height));
+}
+
+void BlockchainSQLite::prune_l2_state(uint64_t log_expiry, uint64_t reward_expiry) {
+    prepared_exec("DELETE FROM l2_logs WHERE height <= ?", static_cast<int64_t>(log_expiry));
+    prepared_exec(
+            "DELETE FROM l2_reward_rates WHERE height < ?", static_cast<int64_t>(reward_expiry));
+}
+
+std::optional<l2_stored_state> BlockchainSQLite::load_l2_state() {
+    auto info = prepared_maybe_get<int64_t, int64_t>(
+            "SELECT synced_height, safe_height FROM l2_sync_info WHERE id = 0");
+    if (!info)
+        return std::nullopt;
+    auto [synced_height, safe_height] = *info;
+
+    std::optional<l2_stored_state> result;
+    auto& state = result.emplace();
+    state.synced_height = static_cast<uint64_t>(std::min(synced_height, safe_height));
+    prepared_exec(
+            "DELETE FROM l2_logs WHERE height > ?", static_cast<int64_t>(state.synced_height));
+
+    for (auto [height, log_index, block_hash, tx_hash, topics, data] :
+         prepared_results<int64_t, int64_t, std::string, std::string, std::string, std::string>(
+                 "SELECT height, log_index, block_hash, tx_hash, topics, data FROM l2_logs "
+                 "ORDER BY height, log_index")) {
+        auto& log = state.logs.emplace_back();
+        log.height = static_cast<uint64_t>(height);
+        log.log_index = static_cast<uint32_t>(log_index);
+        log.block_hash = std::move(block_hash);
+        log.tx_hash = std::move(tx_hash);
+        for (auto topic : tools::split(topics, ",", /*trim=*/true))
+            log.topics.emplace_back(topic);
+        log.data = std::move(data);
+    }
+
+    for (auto [height, rate] :
+         prepared_results<int64_t, int64_t>("SELECT height, rate FROM l2_reward_rates"))
+        state.reward_rates.emplace(static_cast<uint64_t>(height), static_cast<uint64_t>(rate));
+
+    return result;
+}
+
 }  // namespace cryptonote
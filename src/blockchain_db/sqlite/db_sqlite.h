@@ -33,14 +33,56 @@
 #include <cryptonote_core/service_node_list.h>  // service_node_list::state_t...
 
 #include <filesystem>
+#include <map>
+#include <optional>
 #include <sqlitedb/database.hpp>
 #include <string>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace cryptonote {
 
 using block_payments = std::
         unordered_map<std::variant<eth::address, cryptonote::account_public_address>, uint64_t>;
 
+// The kinds of aggregate BLS signatures kept in the BLS signature cache
+enum class bls_signature_type : int {
+    rewards = 0,
+    exit = 1,
+    liquidation = 2,
+};
+
+// An aggregate BLS signature, as stored in the BLS signature cache
+struct bls_cached_signature {
+    // The block height of a rewards signature, or the unix timestamp of an exit/liquidation
+    uint64_t height;
+    // The rewards amount of a rewards signature; 0 for exits and liquidations
+    uint64_t amount;
+    std::vector<uint8_t> msg_to_sign;
+    std::vector<eth::bls_public_key> signers;
+    eth::bls_signature signature;
+};
+
+// An L2 rewards contract log, as stored in the L2 event store
+struct l2_stored_log {
+    uint64_t height;
+    uint32_t log_index;
+    std::string block_hash;
+    std::string tx_hash;
+    std::vector<std::string> topics;
+    std::string data;
+};
+
+// The L2 tracker state loaded from the L2 event store on startup
+struct l2_stored_state {
+    // The L2 height through which logs have been fetched and stored
+    uint64_t synced_height;
+    std::vector<l2_stored_log> logs;
+    // reward height => reward rate
+    std::map<uint64_t, uint64_t> reward_rates;
+};
+
 class BlockchainSQLite : public db::Database {
   public:
     explicit BlockchainSQLite(cryptonote::network_type nettype, std::filesystem::path db_path);
@@ -59,7 +101,8 @@ class BlockchainSQLite : public db::Database {
 
     // add_sn_rewards/subtract_sn_rewards -> passing a map of addresses and amounts. These will be
     // added or subtracted to the database for each address specified. If the address does not exist
-    // it will be created.
+    // it will be created.  The updates for all the addresses are written using a few multi-row
+    // statements rather than one statement per address.
     bool add_sn_rewards(const block_payments& payments);
     bool subtract_sn_rewards(const block_payments& payments);
 
@@ -130,6 +173,12 @@ class BlockchainSQLite : public db::Database {
             const service_nodes::service_node_info& sn_info,
             block_payments& payments) const;
 
+    // As above, but pays `distribution_amount` to each of the nodes of a reward table.
+    void add_rewards(
+            uint64_t distribution_amount,
+            const service_nodes::reward_table& nodes,
+            block_payments& payments) const;
+
     // add/pop_block -> takes a block that contains new block rewards to be batched and added to the
     // database and/or batching payments that need to be subtracted from the database, in addition
     // it takes a reference to the service node state which it will use to calculate the individual
@@ -161,6 +210,36 @@ class BlockchainSQLite : public db::Database {
     bool save_payments(uint64_t block_height, const std::vector<batch_sn_payment>& paid_amounts);
     bool delete_block_payments(uint64_t block_height);
 
+    // Persistent cache of the aggregate BLS signatures assembled by the BLS aggregator, so that
+    // they don't have to be requested from the network again after a restart.  There is at most
+    // one signature of each type for each `id` (an ETH address for rewards, a BLS pubkey for exits
+    // and liquidations); storing a new one replaces it.  Rewards signatures above the height of a
+    // blockchain detach are dropped automatically.
+    void store_bls_signature(
+            bls_signature_type type, std::string_view id, const bls_cached_signature& sig);
+    std::optional<bls_cached_signature> get_bls_signature(
+            bls_signature_type type, std::string_view id);
+    // Removes signatures of the given type with a `height` below `cutoff`.
+    void prune_bls_signatures(bls_signature_type type, uint64_t cutoff);
+
+    // Local store of the L2 contract logs and reward rates retrieved by the L2 tracker, so that
+    // they don't all have to be fetched from the L2 provider again on restart.  Unlike the rest of
+    // the database this isn't tied to the Oxen chain, and so is left alone by `reset_database()`.
+    //
+    // Storing logs replaces any stored logs at the same heights with a different block hash, i.e.
+    // from an L2 block that has since been reorged away.
+    void store_l2_logs(std::span<const l2_stored_log> logs);
+    void store_l2_reward_rate(uint64_t height, uint64_t rate);
+    // Records the height through which L2 logs have been stored, and the L2 height below which
+    // they are considered safe from reorgs.
+    void store_l2_synced_height(uint64_t synced_height, uint64_t safe_height);
+    // Removes logs at or below `log_expiry` and reward rates below `reward_expiry`.
+    void prune_l2_state(uint64_t log_expiry, uint64_t reward_expiry);
+    // Loads the stored L2 state, if any.  Logs above the stored safe height are discarded (and the
+    // returned synced height lowered to match) so that they get fetched from the L2 again, in case
+    // they were reorged away while we weren't running.
+    std::optional<l2_stored_state> load_l2_state();
+
     uint64_t height;
 
   protected:
@@ -76,6 +76,9 @@ class BaseTestDB : public cryptonote::BlockchainDB {
     virtual std::string get_block_blob_from_height(uint64_t height) const override {
         return cryptonote::t_serializable_object_to_blob(get_block_from_height(height));
     }
+    virtual std::string_view get_block_blob_view_from_height(uint64_t height) const override {
+        return {};
+    }
     virtual std::string get_block_blob(const crypto::hash& h) const override {
         return std::string();
     }
@@ -92,6 +95,10 @@ class BaseTestDB : public cryptonote::BlockchainDB {
             const crypto::hash& h, size_t count, std::vector<std::string>& bd) const override {
         return false;
     }
+    virtual bool get_pruned_tx_blob_views_from(
+            const crypto::hash& h, size_t count, std::vector<std::string_view>& bd) const override {
+        return false;
+    }
     virtual bool get_prunable_tx_blob(const crypto::hash& h, std::string& tx) const override {
         return false;
     }
@@ -310,6 +317,9 @@ class BaseTestDB : public cryptonote::BlockchainDB {
 
     virtual uint32_t get_blockchain_pruning_seed() const override { return 0; }
     virtual bool prune_blockchain(uint32_t pruning_seed = 0) override { return true; }
+    virtual double prune_blockchain_step(size_t max_txs, uint32_t pruning_seed = 0) override {
+        return 1.0;
+    }
     virtual bool update_pruning() override { return true; }
     virtual bool check_pruning() override { return true; }
     virtual void prune_outputs(uint64_t amount) override {}
@@ -340,6 +350,13 @@ class BaseTestDB : public cryptonote::BlockchainDB {
         return false;
     }
     virtual void clear_service_node_data() override {}
+    void set_service_node_state(uint64_t height, std::string_view data) override {}
+    void remove_service_node_states_before(uint64_t height) override {}
+    void remove_service_node_states_from(uint64_t height) override {}
+    bool for_all_service_node_states(
+            std::function<bool(uint64_t height, std::string_view data)> f) const override {
+        return true;
+    }
 
     bool get_service_node_proof(
             const crypto::public_key& pubkey, service_nodes::proof_info& proof) const override {
@@ -0,0 +1,140 @@
+#include "ancestry_engine.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "blockchain_scan.h"
+#include "common/exception.h"
+#include "common/format.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+
+namespace blockchain_utils {
+
+namespace {
+    uint64_t saturating_add(uint64_t a, uint64_t b) {
+        return a > std::numeric_limits<uint64_t>::max() - b ? std::numeric_limits<uint64_t>::max()
+                                                             : a + b;
+    }
+}  // namespace
+
+crypto::hash ancestry_engine::output_tx(const output_ref& output) const {
+    return m_db.get_output_tx_and_index(output.amount, output.offset).first;
+}
+
+ancestry_engine::tx_node ancestry_engine::load(const crypto::hash& txid) const {
+    std::string blob;
+    if (!m_db.get_pruned_tx_blob(txid, blob))
+        throw oxen::traced<std::runtime_error>{"Failed to get tx {} from the db"_format(txid)};
+    cryptonote::transaction tx;
+    if (!cryptonote::parse_and_validate_tx_base_from_blob(blob, tx))
+        throw oxen::traced<std::runtime_error>{"Bad tx {}"_format(txid)};
+
+    tx_node node;
+    node.height = m_db.get_tx_block_height(txid);
+    if (tx.is_miner_tx())
+        return node;
+    std::vector<cryptonote::tx_out_index> sources;
+    for (const auto& in : tx.vin) {
+        const auto* in_to_key = std::get_if<cryptonote::txin_to_key>(&in);
+        if (!in_to_key)
+            throw oxen::traced<std::runtime_error>{"Bad vin type in tx {}"_format(txid)};
+        auto offsets = cryptonote::relative_output_offsets_to_absolute(in_to_key->key_offsets);
+        sources.clear();
+        m_db.get_output_tx_and_index(in_to_key->amount, offsets, sources);
+        for (size_t i = 0; i < offsets.size() && i < sources.size(); i++)
+            node.inputs.emplace_back(output_ref{in_to_key->amount, offsets[i]}, sources[i].first);
+    }
+    return node;
+}
+
+std::optional<std::vector<std::pair<crypto::hash, const ancestry_engine::tx_node*>>>
+ancestry_engine::reachable(const crypto::hash& txid, const bool* stop_requested) {
+    std::vector<std::pair<crypto::hash, const tx_node*>> found;
+    std::unordered_set<crypto::hash> seen{txid};
+    std::vector<crypto::hash> frontier{txid};
+    while (!frontier.empty()) {
+        // Load whatever in this frontier we haven't seen before, in parallel
+        std::vector<crypto::hash> to_load;
+        for (const auto& h : frontier)
+            if (!m_txes.count(h))
+                to_load.push_back(h);
+        std::vector<tx_node> loaded(to_load.size());
+        parallel_scan(
+                0,
+                to_load.size(),
+                [&](uint64_t i) { loaded[i] = load(to_load[i]); },
+                stop_requested,
+                m_threads,
+                16);
+        if (stop_requested && *stop_requested)
+            return std::nullopt;
+        for (size_t i = 0; i < to_load.size(); i++)
+            m_txes.emplace(to_load[i], std::move(loaded[i]));
+
+        std::vector<crypto::hash> next;
+        for (const auto& h : frontier) {
+            const auto& node = m_txes.at(h);
+            found.emplace_back(h, &node);
+            for (const auto& [output, source] : node.inputs)
+                if (seen.insert(source).second)
+                    next.push_back(source);
+        }
+        frontier = std::move(next);
+    }
+    return found;
+}
+
+std::optional<ancestry_engine::result> ancestry_engine::ancestry(
+        const crypto::hash& txid, const bool* stop_requested) {
+    auto txes = reachable(txid, stop_requested);
+    if (!txes)
+        return std::nullopt;
+
+    // Spenders come after the txes they spend from, so going from the highest we have seen every
+    // path into a tx by the time we get to it.
+    std::stable_sort(txes->begin(), txes->end(), [](const auto& a, const auto& b) {
+        return a.second->height > b.second->height;
+    });
+    result res;
+    res.txes = txes->size() - 1;
+    std::unordered_map<crypto::hash, uint64_t> paths{{txid, 1}};
+    for (const auto& [hash, node] : *txes) {
+        const uint64_t p = paths[hash];
+        for (const auto& [output, source] : node->inputs) {
+            auto& count = res.ancestors[output];
+            count = saturating_add(count, p);
+            auto& source_paths = paths[source];
+            source_paths = saturating_add(source_paths, p);
+        }
+    }
+    for (const auto& [output, count] : res.ancestors)
+        res.full = saturating_add(res.full, count);
+    return res;
+}
+
+std::optional<uint64_t> ancestry_engine::full_ancestry_count(
+        const crypto::hash& txid, const bool* stop_requested) {
+    if (auto it = m_full_counts.find(txid); it != m_full_counts.end())
+        return it->second;
+    auto txes = reachable(txid, stop_requested);
+    if (!txes)
+        return std::nullopt;
+
+    // Each tx's count only depends on those of the (lower) txes it spends from
+    std::stable_sort(txes->begin(), txes->end(), [](const auto& a, const auto& b) {
+        return a.second->height < b.second->height;
+    });
+    for (const auto& [hash, node] : *txes) {
+        if (m_full_counts.count(hash))
+            continue;
+        uint64_t count = 0;
+        for (const auto& [output, source] : node->inputs)
+            count = saturating_add(count, saturating_add(1, m_full_counts.at(source)));
+        m_full_counts.emplace(hash, count);
+    }
+    return m_full_counts.at(txid);
+}
+
+}  // namespace blockchain_utils
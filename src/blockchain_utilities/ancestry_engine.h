@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "blockchain_db/blockchain_db.h"
+#include "crypto/hash.h"
+
+namespace blockchain_utils {
+
+/// An output, by amount and amount-specific index (amount 0 for RingCT outputs)
+struct output_ref {
+    uint64_t amount;
+    uint64_t offset;
+
+    bool operator==(const output_ref& other) const = default;
+};
+
+}  // namespace blockchain_utils
+
+template <>
+struct std::hash<blockchain_utils::output_ref> {
+    size_t operator()(const blockchain_utils::output_ref& o) const {
+        return o.amount ^ (o.offset * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+namespace blockchain_utils {
+
+/// Computes transaction ancestries: the outputs that a tx's ring members, their creating txes' ring
+/// members, and so on back to coinbase, refer to.
+///
+/// The graph is explored breadth first: each new frontier of txes is loaded on `threads` threads at
+/// once (each reading through its own db read txn), resolving every ring member to the tx that
+/// created it through the db's output index.  The loaded txes are kept, so that later queries only
+/// need to load what earlier ones didn't reach, as are the per-tx full ancestry counts.
+///
+/// The counts are "full": an output reached along several paths counts once per path, which is
+/// what a naive recursive walk over the inputs would count.  They are computed by counting paths
+/// over the graph (which can't have cycles, as txes only spend outputs of earlier blocks) rather
+/// than walking each path, and saturate at the largest uint64_t.
+///
+/// Not safe for concurrent use.
+class ancestry_engine {
+  public:
+    explicit ancestry_engine(const cryptonote::BlockchainDB& db, unsigned threads = 0) :
+            m_db{db}, m_threads{threads} {}
+
+    struct result {
+        /// How many times each ancestor output is reached, over all paths from the tx
+        std::unordered_map<output_ref, uint64_t> ancestors;
+        /// Sum of the above
+        uint64_t full = 0;
+        /// Number of distinct txes in the ancestry, not counting the tx itself
+        size_t txes = 0;
+    };
+
+    /// Computes the ancestry of `txid`.  Returns nullopt if `*stop_requested` gets set, and throws
+    /// if a tx or output can't be found in the db.
+    std::optional<result> ancestry(const crypto::hash& txid, const bool* stop_requested = nullptr);
+
+    /// Just the full ancestry count of `txid`; this is memoised per tx, so is cheap for any tx
+    /// already reached by an earlier query.  Returns nullopt if `*stop_requested` gets set.
+    std::optional<uint64_t> full_ancestry_count(
+            const crypto::hash& txid, const bool* stop_requested = nullptr);
+
+    /// The tx that created an output
+    crypto::hash output_tx(const output_ref& output) const;
+
+    /// Number of txes loaded so far
+    size_t loaded_txes() const { return m_txes.size(); }
+
+  private:
+    struct tx_node {
+        uint64_t height = 0;
+        /// Each ring member and the tx that created it, in input order
+        std::vector<std::pair<output_ref, crypto::hash>> inputs;
+    };
+
+    tx_node load(const crypto::hash& txid) const;
+
+    /// Loads the txes reachable from `txid`, and returns them (including `txid` itself), or nullopt
+    /// if stopped.
+    std::optional<std::vector<std::pair<crypto::hash, const tx_node*>>> reachable(
+            const crypto::hash& txid, const bool* stop_requested);
+
+    const cryptonote::BlockchainDB& m_db;
+    unsigned m_threads;
+    std::unordered_map<crypto::hash, tx_node> m_txes;
+    std::unordered_map<crypto::hash, uint64_t> m_full_counts;
+};
+
+}  // namespace blockchain_utils
@@ -43,6 +43,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "ancestry_engine.h"
 #include "blockchain_db/blockchain_db.h"
 #include "blockchain_objects.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
@@ -161,27 +162,6 @@ struct ancestry_state_t {
 };
 BOOST_CLASS_VERSION(ancestry_state_t, 2)
 
-static void add_ancestor(
-        std::unordered_map<ancestor, unsigned int>& ancestry, uint64_t amount, uint64_t offset) {
-    std::pair<std::unordered_map<ancestor, unsigned int>::iterator, bool> p =
-            ancestry.insert(std::make_pair(ancestor{amount, offset}, 1));
-    if (!p.second) {
-        ++p.first->second;
-    }
-}
-
-static size_t get_full_ancestry(const std::unordered_map<ancestor, unsigned int>& ancestry) {
-    size_t count = 0;
-    for (const auto& i : ancestry)
-        count += i.second;
-    return count;
-}
-
-static size_t get_deduplicated_ancestry(
-        const std::unordered_map<ancestor, unsigned int>& ancestry) {
-    return ancestry.size();
-}
-
 static void add_ancestry(
         std::unordered_map<crypto::hash, std::unordered_set<ancestor>>& ancestry,
         const crypto::hash& txid,
@@ -216,53 +196,6 @@ static std::unordered_set<ancestor> get_ancestry(
     return i->second;
 }
 
-static bool get_block_from_height(
-        ancestry_state_t& state, BlockchainDB& db, uint64_t height, cryptonote::block& b) {
-    ++total_blocks;
-    if (state.block_cache.size() > height && state.block_cache[height].miner_tx &&
-        !state.block_cache[height].miner_tx->vin.empty()) {
-        ++cached_blocks;
-        b = state.block_cache[height];
-        return true;
-    }
-    std::string bd = db.get_block_blob_from_height(height);
-    if (!cryptonote::parse_and_validate_block_from_blob(bd, b)) {
-        log::warning(logcat, "Bad block from db");
-        return false;
-    }
-    if (opt_cache_blocks) {
-        state.block_cache.resize(height + 1);
-        state.block_cache[height] = b;
-    }
-    return true;
-}
-
-static bool get_transaction(
-        ancestry_state_t& state, BlockchainDB& db, const crypto::hash& txid, ::tx_data_t& tx_data) {
-    std::unordered_map<crypto::hash, ::tx_data_t>::const_iterator i = state.tx_cache.find(txid);
-    ++total_txes;
-    if (i != state.tx_cache.end()) {
-        ++cached_txes;
-        tx_data = i->second;
-        return true;
-    }
-
-    std::string bd;
-    if (!db.get_pruned_tx_blob(txid, bd)) {
-        log::warning(logcat, "Failed to get txid {} from db", txid);
-        return false;
-    }
-    cryptonote::transaction tx;
-    if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, tx)) {
-        log::warning(logcat, "Bad tx: {}", txid);
-        return false;
-    }
-    tx_data = ::tx_data_t(tx);
-    if (opt_cache_txes)
-        state.tx_cache.insert(std::make_pair(txid, tx_data));
-    return true;
-}
-
 static bool get_output_txid(
         ancestry_state_t& state,
         BlockchainDB& db,
@@ -278,43 +211,11 @@ static bool get_output_txid(
         return true;
     }
 
-    const output_data_t od = db.get_output_key(amount, offset, false);
-    cryptonote::block b;
-    if (!get_block_from_height(state, db, od.height, b))
-        return false;
-
-    for (size_t out = 0; b.miner_tx && out < b.miner_tx->vout.size(); ++out) {
-        if (const auto* txout =
-                    std::get_if<cryptonote::txout_to_key>(&b.miner_tx->vout[out].target)) {
-            if (txout->key == od.pubkey) {
-                txid = cryptonote::get_transaction_hash(*b.miner_tx);
-                if (opt_cache_outputs)
-                    state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
-                return true;
-            }
-        } else {
-            log::warning(
-                    logcat,
-                    "Bad vout type in txid {}",
-                    cryptonote::get_transaction_hash(*b.miner_tx));
-            return false;
-        }
-    }
-    for (const crypto::hash& block_txid : b.tx_hashes) {
-        ::tx_data_t tx_data3;
-        if (!get_transaction(state, db, block_txid, tx_data3))
-            return false;
-
-        for (size_t out = 0; out < tx_data3.vout.size(); ++out) {
-            if (tx_data3.vout[out] == od.pubkey) {
-                txid = block_txid;
-                if (opt_cache_outputs)
-                    state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
-                return true;
-            }
-        }
-    }
-    return false;
+    // The db's output index gives us the creating tx directly
+    txid = db.get_output_tx_and_index(amount, offset).first;
+    if (opt_cache_outputs)
+        state.output_cache.insert(std::make_pair(ancestor{amount, offset}, txid));
+    return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -345,6 +246,8 @@ int main(int argc, char* argv[]) {
     const command_line::arg_flag arg_include_coinbase{
             "include-coinbase", "Including coinbase tx in per height average"};
     const command_line::arg_flag arg_show_cache_stats{"show-cache-stats", "Show cache statistics"};
+    const command_line::arg_descriptor<unsigned> arg_threads = {
+            "threads", "Number of threads to load txes with (0 = one per core)", 0};
 
     command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
     command_line::add_network_args(desc_cmd_sett);
@@ -358,6 +261,7 @@ int main(int argc, char* argv[]) {
     command_line::add_arg(desc_cmd_sett, arg_cache_blocks);
     command_line::add_arg(desc_cmd_sett, arg_include_coinbase);
     command_line::add_arg(desc_cmd_sett, arg_show_cache_stats);
+    command_line::add_arg(desc_cmd_sett, arg_threads);
     command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
     po::options_description desc_options("Allowed options");
@@ -394,6 +298,7 @@ int main(int argc, char* argv[]) {
     opt_cache_blocks = command_line::get_arg(vm, arg_cache_blocks);
     bool opt_include_coinbase = command_line::get_arg(vm, arg_include_coinbase);
     bool opt_show_cache_stats = command_line::get_arg(vm, arg_show_cache_stats);
+    unsigned opt_threads = command_line::get_arg(vm, arg_threads);
 
     if ((!opt_txid_string.empty()) + !!opt_height + !opt_output_string.empty() > 1) {
         std::cerr << "Only one of --txid, --height, --output can be given" << std::endl;
@@ -607,65 +512,33 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    blockchain_utils::ancestry_engine engine{db, opt_threads};
     for (const crypto::hash& start_txid : start_txids) {
         log::warning(logcat, "Checking ancestry for txid {}", start_txid);
 
-        std::unordered_map<ancestor, unsigned int> ancestry;
-
-        std::list<crypto::hash> txids;
-        txids.push_back(start_txid);
-        while (!txids.empty()) {
-            const crypto::hash txid = txids.front();
-            txids.pop_front();
-
-            if (stop_requested)
-                goto done;
-
-            ::tx_data_t tx_data2;
-            if (!get_transaction(state, db, txid, tx_data2))
-                return 1;
-
-            const bool coinbase = tx_data2.coinbase;
-            if (coinbase)
-                continue;
-
-            for (size_t ring = 0; ring < tx_data2.vin.size(); ++ring) {
-                {
-                    const uint64_t amount = tx_data2.vin[ring].first;
-                    auto absolute_offsets = tx_data2.vin[ring].second;
-                    for (uint64_t offset : absolute_offsets) {
-                        add_ancestor(ancestry, amount, offset);
-
-                        // find the tx which created this output
-                        bool found = false;
-                        crypto::hash output_txid;
-                        if (!get_output_txid(state, db, amount, offset, output_txid)) {
-                            log::warning(logcat, "Output originating transaction not found");
-                            return 1;
-                        }
-
-                        add_ancestry(
-                                state.ancestry, txid, get_ancestry(state.ancestry, output_txid));
-                        txids.push_back(output_txid);
-                        log::debug(logcat, "adding txid: {}", output_txid);
-                    }
-                }
-            }
+        std::optional<blockchain_utils::ancestry_engine::result> ancestry;
+        try {
+            ancestry = engine.ancestry(start_txid, &stop_requested);
+        } catch (const std::exception& e) {
+            log::warning(logcat, "Failed to get ancestry: {}", e.what());
+            return 1;
         }
+        if (!ancestry)
+            goto done;
 
         log::info(
                 logcat,
                 "Ancestry for {}: {} / {}",
                 start_txid,
-                get_deduplicated_ancestry(ancestry),
-                get_full_ancestry(ancestry));
-        for (const auto& i : ancestry) {
+                ancestry->ancestors.size(),
+                ancestry->full);
+        for (const auto& [output, count] : ancestry->ancestors) {
             log::info(
                     logcat,
                     "{}/{}: {}",
-                    cryptonote::print_money(i.first.amount),
-                    i.first.offset,
-                    i.second);
+                    cryptonote::print_money(output.amount),
+                    output.offset,
+                    count);
         }
     }
 
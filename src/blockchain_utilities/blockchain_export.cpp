@@ -30,8 +30,11 @@
 #include <common/command_line.h>
 #include <common/exception.h>
 #include <fmt/std.h>
+#include <oxenc/hex.h>
+#include <sodium/crypto_sign.h>
 
 #include "blockchain_objects.h"
+#include "blockchain_snapshot.h"
 #include "blocksdat_file.h"
 #include "bootstrap_file.h"
 #include "cryptonote_core/cryptonote_core.h"
@@ -62,6 +65,16 @@ int main(int argc, char* argv[]) {
     const command_line::arg_descriptor<uint64_t> arg_block_stop = {
             "block-stop", "Stop at block number", block_stop};
     const command_line::arg_flag arg_blocks_dat = {"blocksdat", "Output in blocks.dat format"};
+    const command_line::arg_descriptor<std::string> arg_snapshot = {
+            "snapshot",
+            "Instead of exporting blocks, write a snapshot of the node's databases into this "
+            "directory, for installing on another node with oxen-blockchain-import --snapshot.  "
+            "The node must be shut down first."};
+    const command_line::arg_flag arg_block_hashes = {
+            "block-hashes", "Output a block hash file for oxend's --block-hashes-file"};
+    const command_line::arg_descriptor<std::string> arg_block_hashes_signing_key = {
+            "block-hashes-signing-key",
+            "Sign the --block-hashes output with this Ed25519 key, given as a 32-byte hex seed"};
 
     command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
     command_line::add_arg(desc_cmd_sett, arg_output_file);
@@ -69,6 +82,9 @@ int main(int argc, char* argv[]) {
     command_line::add_arg(desc_cmd_sett, arg_log_level);
     command_line::add_arg(desc_cmd_sett, arg_block_stop);
     command_line::add_arg(desc_cmd_sett, arg_blocks_dat);
+    command_line::add_arg(desc_cmd_sett, arg_snapshot);
+    command_line::add_arg(desc_cmd_sett, arg_block_hashes);
+    command_line::add_arg(desc_cmd_sett, arg_block_hashes_signing_key);
 
     command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
@@ -99,6 +115,26 @@ int main(int argc, char* argv[]) {
 
     auto nettype = command_line::get_network(vm);
     bool opt_blocks_dat = command_line::get_arg(vm, arg_blocks_dat);
+    bool opt_block_hashes = command_line::get_arg(vm, arg_block_hashes);
+
+    std::optional<crypto::ed25519_secret_key> signing_key;
+    if (auto seed_hex = command_line::get_arg(vm, arg_block_hashes_signing_key);
+        !seed_hex.empty()) {
+        std::array<unsigned char, crypto_sign_SEEDBYTES> seed;
+        if (!opt_block_hashes || seed_hex.size() != 2 * seed.size() || !oxenc::is_hex(seed_hex)) {
+            log::error(
+                    logcat,
+                    "--{} requires --{} and a {}-byte hex seed",
+                    arg_block_hashes_signing_key.name,
+                    arg_block_hashes.name,
+                    seed.size());
+            return 1;
+        }
+        oxenc::from_hex(seed_hex.begin(), seed_hex.end(), seed.begin());
+        crypto::ed25519_public_key pubkey;
+        crypto_sign_seed_keypair(pubkey.data(), signing_key.emplace().data(), seed.data());
+        log::warning(logcat, "Signing block hashes with public key {}", pubkey);
+    }
 
     auto config_folder = tools::utf8_path(command_line::get_arg(vm, cryptonote::arg_data_dir));
 
@@ -130,17 +166,32 @@ int main(int argc, char* argv[]) {
     }
     r = core_storage->init(std::move(db), nettype);
 
-    if (core_storage->get_blockchain_pruning_seed() && !opt_blocks_dat) {
+    CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
+
+    if (auto snapshot_dir = command_line::get_arg(vm, arg_snapshot); !snapshot_dir.empty()) {
+        auto m = write_snapshot(
+                core_storage->db(), config_folder, tools::utf8_path(snapshot_dir), nettype);
+        log::warning(
+                logcat,
+                "Wrote snapshot at height {} (top block {}) to {}",
+                m.height - 1,
+                m.top_hash,
+                snapshot_dir);
+        return 0;
+    }
+
+    if (core_storage->get_blockchain_pruning_seed() && !opt_blocks_dat && !opt_block_hashes) {
         log::warning(logcat, "Blockchain is pruned, cannot export");
         return 1;
     }
 
-    CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize source blockchain storage");
     log::warning(logcat, "Source blockchain storage initialized OK");
     log::warning(logcat, "Exporting blockchain raw data...");
 
-    if (opt_blocks_dat) {
+    if (opt_blocks_dat || opt_block_hashes) {
         BlocksdatFile blocksdat;
+        if (opt_block_hashes)
+            blocksdat.use_block_hash_file_format(nettype, signing_key ? &*signing_key : nullptr);
         r = blocksdat.store_blockchain_raw(core_storage, NULL, output_file_path, block_stop);
     } else {
         BootstrapFile bootstrap;
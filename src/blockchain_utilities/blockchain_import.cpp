@@ -29,19 +29,27 @@
 
 #include <fmt/color.h>
 #include <fmt/std.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <atomic>
 #include <boost/algorithm/string.hpp>
+#include <condition_variable>
 #include <cstdio>
+#include <deque>
 #include <fstream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <thread>
 
+#include "blockchain_snapshot.h"
 #include "blocks/blocks.h"
 #include "bootstrap_file.h"
 #include "bootstrap_serialization.h"
 #include "common/command_line.h"
 #include "common/exception.h"
+#include "common/threadpool.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "cryptonote_protocol/quorumnet.h"
@@ -72,6 +80,15 @@ uint64_t db_batch_size_verify = 5000;
 
 std::string refresh_string = "\r                                    \r";
 
+// Time spent in the import's own stages of a verified import, for --benchmark-json.  The stages
+// within adding each block come from Blockchain::get_block_add_stats().
+struct import_timings {
+    std::chrono::nanoseconds decode{};  // reading and decoding chunks (on the reader thread)
+    std::chrono::nanoseconds txs{};     // handle_incoming_txs
+    std::chrono::nanoseconds blocks{};  // handle_incoming_block
+    std::chrono::nanoseconds commit{};  // cleanup_handle_incoming_blocks, i.e. the db commit
+} timings;
+
 const command_line::arg_flag arg_recalculate_difficulty{
         "recalculate-difficulty",
         "Recalculate per-block difficulty starting from the height specified"};
@@ -115,7 +132,12 @@ int pop_blocks(cryptonote::core& core, int num_blocks) {
     return num_blocks;
 }
 
-int check_flush(cryptonote::core& core, std::vector<block_complete_entry>& blocks, bool force) {
+// `hashes` holds the block hash of each of `blocks` (already worked out while decoding them).
+int check_flush(
+        cryptonote::core& core,
+        std::vector<block_complete_entry>& blocks,
+        std::vector<crypto::hash>& hashes,
+        bool force) {
     if (blocks.empty())
         return 0;
     if (!force && blocks.size() < db_batch_size)
@@ -126,16 +148,6 @@ int check_flush(cryptonote::core& core, std::vector<block_complete_entry>& block
     if (!force && new_height % HASH_OF_HASHES_STEP)
         return 0;
 
-    std::vector<crypto::hash> hashes;
-    for (const auto& b : blocks) {
-        cryptonote::block block;
-        if (!parse_and_validate_block_from_blob(b.block, block)) {
-            log::error(logcat, "Failed to parse block: {}", get_blob_hash(b.block));
-            core.cleanup_handle_incoming_blocks();
-            return 1;
-        }
-        hashes.push_back(cryptonote::get_block_hash(block));
-    }
     core.blockchain.prevalidate_block_hashes(core.blockchain.db().height(), hashes);
 
     // TODO(doyle): Checkpointing
@@ -152,15 +164,16 @@ int check_flush(cryptonote::core& core, std::vector<block_complete_entry>& block
 
     size_t blockidx = 0;
     for (const block_complete_entry& block_entry : blocks) {
-        // process transactions
-        for (auto& tx_blob : block_entry.txs) {
-            tx_verification_context tvc{};
-            core.handle_incoming_tx(tx_blob, tvc, tx_pool_options::from_block());
-            if (tvc.m_verifivation_failed) {
+        // process transactions; these are parsed and verified in parallel, as when syncing
+        auto txs_start = std::chrono::steady_clock::now();
+        auto parsed_txs = core.handle_incoming_txs(block_entry.txs, tx_pool_options::from_block());
+        timings.txs += std::chrono::steady_clock::now() - txs_start;
+        for (size_t i = 0; i < parsed_txs.size(); i++) {
+            if (parsed_txs[i].tvc.m_verifivation_failed) {
                 log::error(
                         logcat,
                         "transaction verification failed, tx_id = {}",
-                        get_blob_hash(tx_blob));
+                        get_blob_hash(block_entry.txs[i]));
                 core.cleanup_handle_incoming_blocks();
                 return 1;
             }
@@ -170,12 +183,14 @@ int check_flush(cryptonote::core& core, std::vector<block_complete_entry>& block
 
         block_verification_context bvc{};
 
+        auto block_start = std::chrono::steady_clock::now();
         core.handle_incoming_block(
                 block_entry.block,
                 pblocks.empty() ? NULL : &pblocks[blockidx++],
                 bvc,
                 nullptr /*checkpoint*/,
                 false);  // <--- process block
+        timings.blocks += std::chrono::steady_clock::now() - block_start;
 
         if (bvc.m_verifivation_failed) {
             log::error(
@@ -190,15 +205,237 @@ int check_flush(cryptonote::core& core, std::vector<block_complete_entry>& block
         }
 
     }  // each download block
+    auto commit_start = std::chrono::steady_clock::now();
     if (!core.cleanup_handle_incoming_blocks())
         return 1;
+    timings.commit += std::chrono::steady_clock::now() - commit_start;
 
     blocks.clear();
+    hashes.clear();
     return 0;
 }
 
+// Imports with verification, as a pipeline: a reader thread reads chunks from the file and decodes
+// them in parallel (on the threadpool) a group at a time, while this thread verifies and adds the
+// blocks it has already decoded (which check_flush() again spreads across the threadpool for the
+// PoW and tx verification).  `h` is the height of the next block to import on entry, and is
+// advanced past the imported blocks.  Returns 1 once done, or 2 on error.
+int import_verified(
+        cryptonote::core& core,
+        BootstrapFile& bootstrap,
+        std::ifstream& import_file,
+        uint64_t& h,
+        uint64_t block_stop,
+        uint64_t& bytes_read,
+        uint64_t& num_imported) {
+    // Blocks decoded (in parallel) at a time, and how many of these groups the reader can get
+    // ahead of verification by.
+    constexpr size_t DECODE_GROUP_SIZE = 256;
+    constexpr size_t MAX_QUEUED_GROUPS = 4;
+
+    struct decoded_block {
+        block_complete_entry entry;
+        crypto::hash hash;
+    };
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::vector<decoded_block>> queue;
+    bool reader_done = false, stop_reader = false;
+    int reader_result = 1;
+
+    std::thread reader{[&, height = h] () mutable {
+        auto& tpool = tools::threadpool::getInstance();
+        int result = 0;
+        try {
+            while (!result) {
+                auto decode_start = std::chrono::steady_clock::now();
+                std::vector<std::string> chunks;
+                while (!result && chunks.size() < DECODE_GROUP_SIZE && height <= block_stop) {
+                    if ((result = bootstrap.read_chunk(
+                                 import_file, chunks.emplace_back(), bytes_read)))
+                        chunks.pop_back();
+                    else
+                        height += NUM_BLOCKS_PER_CHUNK;
+                }
+                if (!result && height > block_stop) {
+                    log::info(
+                            logcat,
+                            "Specified block number reached - stopping at block {}",
+                            block_stop);
+                    result = 1;
+                }
+
+                std::vector<decoded_block> group(chunks.size());
+                std::atomic<bool> failed = false;
+                tools::threadpool::waiter waiter;
+                for (size_t i = 0; i < chunks.size(); i++)
+                    tpool.submit(
+                            &waiter,
+                            [&, i] {
+                                try {
+                                    bootstrap::block_package bp;
+                                    serialization::parse_binary(chunks[i], bp);
+                                    auto& entry = group[i].entry;
+                                    group[i].hash = get_block_hash(bp.block);
+                                    entry.block = block_to_blob(bp.block);
+                                    entry.txs.reserve(bp.txs.size());
+                                    for (const auto& tx : bp.txs)
+                                        entry.txs.push_back(tx_to_blob(tx));
+                                } catch (const std::exception& e) {
+                                    log::error(
+                                            logcat,
+                                            "Error in deserialization of chunk: {}",
+                                            e.what());
+                                    failed = true;
+                                }
+                            },
+                            true);
+                waiter.wait(&tpool);
+                if (failed) {
+                    // Still hand over the blocks before the bad one
+                    group.erase(
+                            std::find_if(
+                                    group.begin(),
+                                    group.end(),
+                                    [](const auto& d) { return d.entry.block.empty(); }),
+                            group.end());
+                    result = 2;
+                }
+                timings.decode += std::chrono::steady_clock::now() - decode_start;
+
+                std::unique_lock lock{queue_mutex};
+                queue_cv.wait(
+                        lock, [&] { return stop_reader || queue.size() < MAX_QUEUED_GROUPS; });
+                if (stop_reader)
+                    break;
+                if (!group.empty())
+                    queue.push_back(std::move(group));
+                queue_cv.notify_all();
+            }
+        } catch (const std::exception& e) {
+            log::error(
+                    logcat, "exception while reading from file, height={}: {}", height, e.what());
+            result = 2;
+        }
+        std::lock_guard lock{queue_mutex};
+        reader_result = result;
+        reader_done = true;
+        queue_cv.notify_all();
+    }};
+
+    std::vector<block_complete_entry> blocks;
+    std::vector<crypto::hash> hashes;
+    int quit = 0;
+    constexpr int display_interval = 1000, progress_interval = 10;
+    while (!quit) {
+        std::vector<decoded_block> group;
+        {
+            std::unique_lock lock{queue_mutex};
+            queue_cv.wait(lock, [&] { return reader_done || !queue.empty(); });
+            if (queue.empty()) {
+                quit = reader_result;
+                break;
+            }
+            group = std::move(queue.front());
+            queue.pop_front();
+            queue_cv.notify_all();
+        }
+
+        for (auto& decoded : group) {
+            ++h;
+            if ((h - 1) % display_interval == 0)
+                std::cout << refresh_string;
+            log::debug(logcat, "loading block number {}", h - 1);
+            if ((h - 1) % progress_interval == 0)
+                std::cout << refresh_string << "block " << h - 1 << " / " << block_stop << "\r"
+                          << std::flush;
+
+            blocks.push_back(std::move(decoded.entry));
+            hashes.push_back(decoded.hash);
+            if (check_flush(core, blocks, hashes, false)) {
+                quit = 2;  // make sure we don't commit partial block data
+                break;
+            }
+            ++num_imported;
+        }
+    }
+
+    {
+        std::lock_guard lock{queue_mutex};
+        stop_reader = true;
+        queue_cv.notify_all();
+    }
+    reader.join();
+
+    if (quit < 2 && check_flush(core, blocks, hashes, true))
+        quit = 2;
+    return quit;
+}
+
+// Writes the results of a verified import as JSON, for comparing sync performance between builds:
+// blocks per second, the time spent in each stage of the import and of adding blocks, and the
+// peak resident memory of the process.
+bool write_benchmark_json(
+        const cryptonote::core& core,
+        const fs::path& path,
+        uint64_t start_height,
+        uint64_t end_height,
+        std::chrono::nanoseconds elapsed) {
+    auto secs = [](std::chrono::nanoseconds d) {
+        return std::chrono::duration<double>{d}.count();
+    };
+    auto add = core.blockchain.get_block_add_stats();
+
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    uint64_t peak_rss = usage.ru_maxrss;  // bytes
+#else
+    uint64_t peak_rss = uint64_t(usage.ru_maxrss) * 1024;  // KiB
+#endif
+
+    nlohmann::json result{
+            {"nettype", network_type_to_string(core.get_nettype())},
+            {"start_height", start_height},
+            {"end_height", end_height},
+            {"blocks", add.blocks},
+            {"txs", add.txs},
+            {"seconds", secs(elapsed)},
+            {"blocks_per_second", elapsed.count() ? add.blocks / secs(elapsed) : 0.0},
+            {"peak_rss_bytes", peak_rss},
+            {"stages",
+             {{"decode", secs(timings.decode)},
+              {"prepare_pow", secs(add.prepare_pow)},
+              {"prepare_txs", secs(add.prepare_txs)},
+              {"handle_txs", secs(timings.txs)},
+              {"handle_blocks", secs(timings.blocks)},
+              {"basic_checks", secs(add.basic_checks)},
+              {"pow", secs(add.pow)},
+              {"tx_checks", secs(add.tx_checks)},
+              {"rewards", secs(add.rewards)},
+              {"db_add", secs(add.db_add)},
+              {"service_node_list", secs(add.service_node_list)},
+              {"ons", secs(add.ons)},
+              {"batching", secs(add.batching)},
+              {"hooks", secs(add.hooks)},
+              {"commit", secs(timings.commit)}}}};
+
+    std::ofstream out{path};
+    out << result.dump(2) << '\n';
+    if (!out) {
+        log::error(logcat, "Failed to write benchmark results to {}", path);
+        return false;
+    }
+    log::info(logcat, "Wrote benchmark results to {}", path);
+    return true;
+}
+
 int import_from_file(
-        cryptonote::core& core, const fs::path& import_file_path, uint64_t block_stop = 0) {
+        cryptonote::core& core,
+        const fs::path& import_file_path,
+        uint64_t block_stop = 0,
+        const fs::path& benchmark_json = {}) {
     // Reset stats, in case we're using newly created db, accumulating stats
     // from addition of genesis block.
     // This aligns internal db counts with importer counts.
@@ -240,10 +477,7 @@ int import_from_file(
     // 4 byte magic + (currently) 1024 byte header structures
     bootstrap.seek_to_first_chunk(import_file);
 
-    char buffer1[1024];
-    char buffer_block[BUFFER_SIZE];
     block b;
-    transaction tx;
     int quit = 0;
     uint64_t bytes_read;
 
@@ -263,8 +497,6 @@ int import_from_file(
     log::info(logcat, "Reading blockchain from bootstrap file...");
     std::cout << "\n";
 
-    std::vector<block_complete_entry> blocks;
-
     uint64_t h = 0;
     uint64_t num_imported = 0;
 
@@ -290,56 +522,30 @@ int import_from_file(
         import_file.seekg(pos);
         core.blockchain.db().batch_start(db_batch_size, bytes);
     }
+    if (opt_verify) {
+        core.blockchain.reset_block_add_stats();
+        timings = {};
+        auto import_start = std::chrono::steady_clock::now();
+        quit = import_verified(
+                core, bootstrap, import_file, h, block_stop, bytes_read, num_imported);
+        if (!benchmark_json.empty())
+            write_benchmark_json(
+                    core,
+                    benchmark_json,
+                    start_height,
+                    core.blockchain.get_current_blockchain_height() - 1,
+                    std::chrono::steady_clock::now() - import_start);
+        goto quitting;
+    }
+
     while (!quit) {
-        uint32_t chunk_size;
-        import_file.read(buffer1, sizeof(chunk_size));
-        // TODO: bootstrap.read_chunk();
-        if (!import_file) {
-            std::cout << refresh_string;
-            log::info(logcat, "End of file reached");
+        std::string chunk;
+        if (int ret = bootstrap.read_chunk(import_file, chunk, bytes_read); ret == 1) {
             quit = 1;
             break;
+        } else if (ret) {
+            return ret;
         }
-        bytes_read += sizeof(chunk_size);
-
-        try {
-            serialization::parse_binary(std::string_view{buffer1, sizeof(chunk_size)}, chunk_size);
-        } catch (const std::exception& e) {
-            throw oxen::traced<std::runtime_error>(
-                    "Error in deserialization of chunk size: "s + e.what());
-        }
-        log::debug(logcat, "chunk_size: {}", chunk_size);
-
-        if (chunk_size > BUFFER_SIZE) {
-            log::warning(
-                    logcat, "WARNING: chunk_size {} > BUFFER_SIZE {}", chunk_size, BUFFER_SIZE);
-            throw oxen::traced<std::runtime_error>("Aborting: chunk size exceeds buffer size");
-        }
-        if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD) {
-            log::info(logcat, "NOTE: chunk_size {} > {}", chunk_size, CHUNK_SIZE_WARNING_THRESHOLD);
-        } else if (chunk_size == 0) {
-            log::error(logcat, "ERROR: chunk_size == 0");
-            return 2;
-        }
-        import_file.read(buffer_block, chunk_size);
-        if (!import_file) {
-            if (import_file.eof()) {
-                std::cout << refresh_string;
-                log::info(logcat, "End of file reached - file was truncated");
-                quit = 1;
-                break;
-            } else {
-                log::error(
-                        logcat,
-                        "ERROR: unexpected end of file: bytes read before error: {} of chunk_size "
-                        "{}",
-                        import_file.gcount(),
-                        chunk_size);
-                return 2;
-            }
-        }
-        bytes_read += chunk_size;
-        log::debug(logcat, "Total bytes read: {}", bytes_read);
 
         if (h > block_stop) {
             std::cout << refresh_string << "block " << h - 1 << " / " << block_stop << "\n"
@@ -356,7 +562,7 @@ int import_from_file(
         try {
             bootstrap::block_package bp;
             try {
-                serialization::parse_binary(std::string_view{buffer_block, chunk_size}, bp);
+                serialization::parse_binary(chunk, bp);
             } catch (const std::exception& e) {
                 throw oxen::traced<std::runtime_error>(
                         "Error in deserialization of chunk"s + e.what());
@@ -382,80 +588,64 @@ int import_from_file(
                               << std::flush;
                 }
 
-                if (opt_verify) {
-                    std::string block;
-                    cryptonote::block_to_blob(bp.block, block);
-                    std::vector<std::string> txs;
-                    for (const auto& tx : bp.txs) {
-                        txs.push_back(std::string());
-                        cryptonote::tx_to_blob(tx, txs.back());
-                    }
-                    blocks.push_back({block, txs});
-                    int ret = check_flush(core, blocks, false);
-                    if (ret) {
-                        quit = 2;  // make sure we don't commit partial block data
-                        break;
-                    }
-                } else {
-                    std::vector<std::pair<transaction, std::string>> txs;
-                    std::vector<transaction> archived_txs;
-
-                    archived_txs = bp.txs;
-
-                    // tx number 1: coinbase tx
-                    // tx number 2 onwards: archived_txs
-                    for (const transaction& tx : archived_txs) {
-                        // add blocks with verification.
-                        // for Blockchain and blockchain_storage add_new_block().
-                        // for add_block() method, without (much) processing.
-                        // don't add coinbase transaction to txs.
-                        //
-                        // because add_block() calls
-                        // add_transaction(blk_hash, blk.miner_tx) first, and
-                        // then a for loop for the transactions in txs.
-                        txs.push_back(std::make_pair(tx, tx_to_blob(tx)));
-                    }
+                std::vector<std::pair<transaction, std::string>> txs;
+                std::vector<transaction> archived_txs;
+
+                archived_txs = bp.txs;
+
+                // tx number 1: coinbase tx
+                // tx number 2 onwards: archived_txs
+                for (const transaction& tx : archived_txs) {
+                    // add blocks with verification.
+                    // for Blockchain and blockchain_storage add_new_block().
+                    // for add_block() method, without (much) processing.
+                    // don't add coinbase transaction to txs.
+                    //
+                    // because add_block() calls
+                    // add_transaction(blk_hash, blk.miner_tx) first, and
+                    // then a for loop for the transactions in txs.
+                    txs.push_back(std::make_pair(tx, tx_to_blob(tx)));
+                }
 
-                    size_t block_weight;
-                    difficulty_type cumulative_difficulty;
-                    uint64_t coins_generated;
-
-                    block_weight = bp.block_weight;
-                    cumulative_difficulty = bp.cumulative_difficulty;
-                    coins_generated = bp.coins_generated;
-
-                    try {
-                        uint64_t long_term_block_weight =
-                                core.blockchain.get_next_long_term_block_weight(block_weight);
-                        core.blockchain.db().add_block(
-                                std::make_pair(b, block_to_blob(b)),
-                                block_weight,
-                                long_term_block_weight,
-                                cumulative_difficulty,
-                                coins_generated,
-                                txs);
-                    } catch (const std::exception& e) {
-                        std::cout << refresh_string;
-                        log::error(logcat, "Error adding block to blockchain: {}", e.what());
-                        quit = 2;  // make sure we don't commit partial block data
-                        break;
-                    }
+                size_t block_weight;
+                difficulty_type cumulative_difficulty;
+                uint64_t coins_generated;
+
+                block_weight = bp.block_weight;
+                cumulative_difficulty = bp.cumulative_difficulty;
+                coins_generated = bp.coins_generated;
+
+                try {
+                    uint64_t long_term_block_weight =
+                            core.blockchain.get_next_long_term_block_weight(block_weight);
+                    core.blockchain.db().add_block(
+                            std::make_pair(b, block_to_blob(b)),
+                            block_weight,
+                            long_term_block_weight,
+                            cumulative_difficulty,
+                            coins_generated,
+                            txs);
+                } catch (const std::exception& e) {
+                    std::cout << refresh_string;
+                    log::error(logcat, "Error adding block to blockchain: {}", e.what());
+                    quit = 2;  // make sure we don't commit partial block data
+                    break;
+                }
 
-                    if (use_batch) {
-                        if ((h - 1) % db_batch_size == 0) {
-                            uint64_t bytes, h2;
-                            bool q2;
-                            std::cout << refresh_string;
-                            // zero-based height
-                            std::cout << "\n[- batch commit at height " << h - 1 << " -]\n";
-                            core.blockchain.db().batch_stop();
-                            pos = import_file.tellg();
-                            bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
-                            import_file.seekg(pos);
-                            core.blockchain.db().batch_start(db_batch_size, bytes);
-                            std::cout << "\n";
-                            core.blockchain.db().show_stats();
-                        }
+                if (use_batch) {
+                    if ((h - 1) % db_batch_size == 0) {
+                        uint64_t bytes, h2;
+                        bool q2;
+                        std::cout << refresh_string;
+                        // zero-based height
+                        std::cout << "\n[- batch commit at height " << h - 1 << " -]\n";
+                        core.blockchain.db().batch_stop();
+                        pos = import_file.tellg();
+                        bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
+                        import_file.seekg(pos);
+                        core.blockchain.db().batch_start(db_batch_size, bytes);
+                        std::cout << "\n";
+                        core.blockchain.db().show_stats();
                     }
                 }
                 ++num_imported;
@@ -470,12 +660,6 @@ int import_from_file(
 quitting:
     import_file.close();
 
-    if (opt_verify) {
-        int ret = check_flush(core, blocks, true);
-        if (ret)
-            return ret;
-    }
-
     if (use_batch) {
         if (quit > 1) {
             // There was an error, so don't commit pending data.
@@ -529,13 +713,29 @@ int main(int argc, char* argv[]) {
             "Blindly trust the import file and use potentially malicious blocks and transactions "
             "during import (only enable if you exported the file yourself)"};
     const command_line::arg_flag arg_batch = {"batch", "Batch transactions for faster import"};
+    const command_line::arg_descriptor<std::string> arg_snapshot = {
+            "snapshot",
+            "Install the node snapshot (from oxen-blockchain-export --snapshot) in this directory "
+            "into an empty data directory, instead of importing blocks"};
+    const command_line::arg_descriptor<std::string> arg_snapshot_top_hash = {
+            "snapshot-top-hash",
+            "Required with --snapshot: the trusted hash of the block at the snapshot height, such "
+            "as a checkpoint or a hash taken from a node you trust"};
     const command_line::arg_flag arg_resume = {
             "resume", "Resume from current height if output database already exists"};
+    const command_line::arg_descriptor<std::string> arg_benchmark_json = {
+            "benchmark-json",
+            "Benchmark a verified import: write its blocks/second, per-stage timings and peak "
+            "memory use to this file as JSON.  Use with --block-stop and a fresh data directory "
+            "to replay a fixed span of the bootstrap file"};
 
     command_line::add_arg(desc_cmd_sett, arg_input_file);
     command_line::add_arg(desc_cmd_sett, arg_log_level);
     command_line::add_arg(desc_cmd_sett, arg_batch_size);
     command_line::add_arg(desc_cmd_sett, arg_block_stop);
+    command_line::add_arg(desc_cmd_sett, arg_snapshot);
+    command_line::add_arg(desc_cmd_sett, arg_snapshot_top_hash);
+    command_line::add_arg(desc_cmd_sett, arg_benchmark_json);
 
     command_line::add_arg(desc_cmd_only, arg_count_blocks);
     command_line::add_arg(desc_cmd_only, arg_pop_blocks);
@@ -585,6 +785,14 @@ int main(int argc, char* argv[]) {
         std::cerr << "Error: batch-size must be > 0\n";
         return 1;
     }
+    fs::path benchmark_json;
+    if (auto bench = command_line::get_arg(vm, arg_benchmark_json); !bench.empty()) {
+        if (!opt_verify) {
+            std::cerr << "Error: --" << arg_benchmark_json.name << " requires a verified import\n";
+            return 1;
+        }
+        benchmark_json = tools::utf8_path(bench);
+    }
     if (opt_verify && command_line::is_arg_defaulted(vm, arg_batch_size)) {
         // usually want batch size default lower if verify on, so progress can be
         // frequently saved.
@@ -610,6 +818,29 @@ int main(int argc, char* argv[]) {
         import_file_path =
                 tools::utf8_path(m_config_folder) / fs::path(u8"export") / BLOCKCHAIN_RAW;
 
+    if (auto snapshot_dir = command_line::get_arg(vm, arg_snapshot); !snapshot_dir.empty()) {
+        auto top_hash_hex = command_line::get_arg(vm, arg_snapshot_top_hash);
+        if (top_hash_hex.empty()) {
+            log::error(logcat, "--{} requires --{}", arg_snapshot.name, arg_snapshot_top_hash.name);
+            return 1;
+        }
+        try {
+            auto m = install_snapshot(
+                    tools::utf8_path(snapshot_dir),
+                    tools::utf8_path(m_config_folder),
+                    net_type,
+                    tools::make_from_hex_guts<crypto::hash>(top_hash_hex));
+            log::info(
+                    logcat,
+                    "Installed snapshot at height {}; oxend will sync from there",
+                    m.height - 1);
+        } catch (const std::exception& e) {
+            log::error(logcat, "Failed to install snapshot: {}", e.what());
+            return 1;
+        }
+        return 0;
+    }
+
     if (command_line::get_arg(vm, arg_count_blocks)) {
         BootstrapFile bootstrap;
         bootstrap.count_blocks(import_file_path);
@@ -675,7 +906,7 @@ int main(int argc, char* argv[]) {
         if (command_line::get_arg(vm, arg_recalculate_difficulty))
             core.blockchain.db().fixup(core.get_nettype());
 
-        import_from_file(core, import_file_path, block_stop);
+        import_from_file(core, import_file_path, block_stop, benchmark_json);
 
         // ensure db closed
         //   - transactions properly checked and handled
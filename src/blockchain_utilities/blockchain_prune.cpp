@@ -550,12 +550,18 @@ int main(int argc, char* argv[]) {
             "fast:1000"};
     const command_line::arg_flag arg_copy_pruned_database = {
             "copy-pruned-database", "Copy database anyway if already pruned"};
+    const command_line::arg_flag arg_in_place = {
+            "in-place",
+            "Prune the database in place, a batch of transactions at a time, rather than copying "
+            "it into a new pruned database (which needs twice the disk space).  Can be interrupted "
+            "and resumed later."};
 
     command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
     command_line::add_network_args(desc_cmd_sett);
     command_line::add_arg(desc_cmd_sett, arg_log_level);
     command_line::add_arg(desc_cmd_sett, arg_db_sync_mode);
     command_line::add_arg(desc_cmd_sett, arg_copy_pruned_database);
+    command_line::add_arg(desc_cmd_sett, arg_in_place);
     command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
     po::options_description desc_options("Allowed options");
@@ -598,6 +604,42 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (command_line::get_arg(vm, arg_in_place)) {
+        // Transactions pruned per db transaction
+        constexpr size_t IN_PLACE_PRUNE_STEP = 10000;
+
+        blockchain_objects_t blockchain_objects = {};
+        Blockchain& blockchain = blockchain_objects.m_blockchain;
+        auto db = new_db();
+        if (!db) {
+            log::error(logcat, "Failed to initialize a database");
+            return 1;
+        }
+        auto path = tools::utf8_path(data_dir) / tools::utf8_path(db->get_db_name());
+        log::info(logcat, "Loading blockchain from folder {} ...", path);
+        try {
+            db->open(path, blockchain.nettype(), 0);
+        } catch (const std::exception& e) {
+            log::error(logcat, "Error opening database: {}", e.what());
+            return 1;
+        }
+        r = blockchain.init(std::move(db), net_type);
+        CHECK_AND_ASSERT_MES(r, 1, "Failed to initialize blockchain storage");
+
+        log::info(logcat, "Pruning in place...");
+        int logged = -1;
+        double progress;
+        while ((progress = blockchain.prune_blockchain_step(IN_PLACE_PRUNE_STEP)) < 1.0) {
+            if (int percent = progress * 100; percent != logged) {
+                log::info(logcat, "Pruning blockchain: {}% done", percent);
+                logged = percent;
+            }
+        }
+        blockchain.deinit();
+        log::info(logcat, "Blockchain pruned OK");
+        return 0;
+    }
+
     // If we wanted to use the memory pool, we would set up a fake_core.
 
     // Use Blockchain instead of lower-level BlockchainDB for two reasons:
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace blockchain_utils {
+
+/// Calls `f(height)` for each height in [start, stop), spread across `threads` threads (or one per
+/// core, if 0).  Threads take `batch` consecutive heights at a time so that each one's db reads
+/// stay mostly sequential.  The db reads happen on the scanning threads, so with LMDB each thread
+/// reads through its own read txn; `f` must be safe to call concurrently for different heights.
+///
+/// The scan finishes early (once the batches in progress are done) if `*stop_requested` becomes
+/// true.  If `f` throws, the scan stops the same way and the first exception is rethrown from here.
+template <typename F>
+void parallel_scan(
+        uint64_t start,
+        uint64_t stop,
+        F&& f,
+        const bool* stop_requested = nullptr,
+        unsigned threads = 0,
+        uint64_t batch = 256) {
+    if (start >= stop)
+        return;
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<uint64_t>(threads, (stop - start + batch - 1) / batch);
+
+    std::atomic<uint64_t> next{start};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&] {
+        try {
+            uint64_t from;
+            while (!failed && !(stop_requested && *stop_requested) &&
+                   (from = next.fetch_add(batch)) < stop)
+                for (uint64_t h = from, end = std::min(from + batch, stop); h < end; h++)
+                    f(h);
+        } catch (...) {
+            std::lock_guard lock{error_mutex};
+            if (!error)
+                error = std::current_exception();
+            failed = true;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; i++)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& t : workers)
+        t.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+}  // namespace blockchain_utils
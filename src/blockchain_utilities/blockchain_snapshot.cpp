@@ -0,0 +1,276 @@
+#include "blockchain_snapshot.h"
+
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <fmt/std.h>
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include "blockchain_db/blockchain_db.h"
+#include "blockchain_scan.h"
+#include "common/file.h"
+#include "common/guts.h"
+#include "common/sha256sum.h"
+#include "common/string_util.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "logging/oxen_logger.h"
+#include "networks.h"
+
+namespace blockchain_utils {
+
+using namespace std::literals;
+namespace log = oxen::log;
+
+static auto logcat = log::Cat("bcutil");
+
+static constexpr auto MANIFEST_HEADER = "oxen-snapshot 1"sv;
+static const fs::path ONS_DB_FILENAME{u8"ons.db"};
+static const fs::path LEGACY_ONS_DB_FILENAME{u8"lns.db"};
+static const fs::path SQLITE_DB_FILENAME{u8"sqlite.db"};
+
+std::string snapshot_manifest::to_string() const {
+    std::string out;
+    out += MANIFEST_HEADER;
+    out += "\nnettype {}\nheight {}\ntop_hash {}\n"_format(
+            cryptonote::network_type_to_string(nettype), height, top_hash);
+    for (const auto& [path, hash] : files)
+        out += "file {} {}\n"_format(hash, path);
+    return out;
+}
+
+snapshot_manifest snapshot_manifest::parse(std::string_view data) {
+    auto lines = tools::split(data, "\n", true);
+    if (lines.empty() || lines[0] != MANIFEST_HEADER)
+        throw std::runtime_error{"Not a snapshot manifest"};
+
+    snapshot_manifest m;
+    bool have_height = false, have_hash = false;
+    for (size_t i = 1; i < lines.size(); i++) {
+        auto line = lines[i];
+        auto space = line.find(' ');
+        auto key = line.substr(0, space);
+        auto value = space == std::string_view::npos ? ""sv : line.substr(space + 1);
+        if (key == "nettype")
+            m.nettype = cryptonote::network_type_from_string(value);
+        else if (key == "height") {
+            auto [p, ec] = std::from_chars(value.data(), value.data() + value.size(), m.height);
+            if (ec != std::errc{} || p != value.data() + value.size())
+                throw std::runtime_error{"Invalid snapshot height '{}'"_format(value)};
+            have_height = true;
+        } else if (key == "top_hash") {
+            m.top_hash = tools::make_from_hex_guts<crypto::hash>(value);
+            have_hash = true;
+        } else if (key == "file") {
+            // "file HASH PATH"; the path is everything after the hash, so may contain spaces
+            auto sep = value.find(' ');
+            if (sep == std::string_view::npos || sep + 1 == value.size())
+                throw std::runtime_error{"Invalid snapshot file line '{}'"_format(line)};
+            m.files[std::string{value.substr(sep + 1)}] =
+                    tools::make_from_hex_guts<crypto::hash>(value.substr(0, sep));
+        } else
+            throw std::runtime_error{"Unknown snapshot manifest field '{}'"_format(key)};
+    }
+    if (m.nettype == cryptonote::network_type::UNDEFINED || !have_height || !have_hash ||
+        m.height == 0)
+        throw std::runtime_error{"Incomplete snapshot manifest"};
+    return m;
+}
+
+namespace {
+
+    fs::path ons_db_path(const fs::path& data_dir) {
+        // Same preference as the daemon: an old lns.db, if present, is the one in use
+        if (auto legacy = data_dir / LEGACY_ONS_DB_FILENAME; fs::exists(legacy))
+            return legacy;
+        return data_dir / ONS_DB_FILENAME;
+    }
+
+    // Writes a compacted, consistent copy of an sqlite database
+    void copy_sqlite(SQLite::Database& db, const fs::path& to) {
+        SQLite::Statement vacuum{db, "VACUUM INTO ?"};
+        vacuum.bind(1, to.string());
+        vacuum.exec();
+    }
+
+    crypto::hash file_hash(const fs::path& path) {
+        crypto::hash h;
+        if (!tools::sha256sum_file(path, h))
+            throw std::runtime_error{"Failed to hash {}"_format(path)};
+        return h;
+    }
+
+}  // namespace
+
+snapshot_manifest write_snapshot(
+        const cryptonote::BlockchainDB& db,
+        const fs::path& data_dir,
+        const fs::path& out_dir,
+        cryptonote::network_type nettype) {
+    snapshot_manifest m;
+    m.nettype = nettype;
+    m.height = db.height();
+    m.top_hash = db.top_block_hash();
+    if (m.height == 0)
+        throw std::runtime_error{"Blockchain database is empty"};
+    const uint64_t top_height = m.height - 1;
+
+    if (fs::exists(out_dir / snapshot_manifest::FILENAME))
+        throw std::runtime_error{"{} already contains a snapshot"_format(out_dir)};
+    fs::create_directories(out_dir);
+
+    auto out_of_sync = [&](std::string_view what, uint64_t height) {
+        return std::runtime_error{
+                "{} is at height {} but the blockchain is at {}; snapshots must be taken from a "
+                "node that was shut down cleanly"_format(what, height, top_height)};
+    };
+
+    log::info(logcat, "Copying ONS database");
+    {
+        SQLite::Database ons{ons_db_path(data_dir).string(), SQLite::OPEN_READONLY};
+        SQLite::Statement settings{ons, "SELECT top_height, top_hash FROM settings WHERE id = 1"};
+        if (!settings.executeStep())
+            throw std::runtime_error{"ONS database has no settings"};
+        auto ons_height = static_cast<uint64_t>(settings.getColumn(0).getInt64());
+        auto ons_hash = settings.getColumn(1);
+        if (ons_height != top_height)
+            throw out_of_sync("ONS database", ons_height);
+        if (ons_hash.getBytes() != sizeof(crypto::hash) ||
+            std::memcmp(ons_hash.getBlob(), m.top_hash.data(), sizeof(crypto::hash)))
+            throw std::runtime_error{"ONS database top block hash does not match the blockchain"};
+        settings.reset();
+        copy_sqlite(ons, out_dir / ONS_DB_FILENAME);
+    }
+
+    log::info(logcat, "Copying batched rewards database");
+    {
+        SQLite::Database sql{(data_dir / SQLITE_DB_FILENAME).string(), SQLite::OPEN_READONLY};
+        auto sql_height = static_cast<uint64_t>(
+                sql.execAndGet("SELECT height FROM batch_db_info").getInt64());
+        if (sql_height != top_height)
+            throw out_of_sync("Batched rewards database", sql_height);
+        copy_sqlite(sql, out_dir / SQLITE_DB_FILENAME);
+    }
+
+    log::info(logcat, "Copying blockchain database");
+    db.copy_to(out_dir / db.get_db_name());
+    // If something was still writing to the database then the copies above could be of other
+    // heights than the blockchain copy
+    if (db.height() != m.height || db.top_block_hash() != m.top_hash)
+        throw std::runtime_error{
+                "Blockchain database changed while copying it; is a node still using it?"};
+
+    log::info(logcat, "Hashing snapshot files");
+    for (const auto& entry : fs::recursive_directory_iterator(out_dir)) {
+        if (!entry.is_regular_file())
+            continue;
+        auto rel = fs::relative(entry.path(), out_dir);
+        if (rel == fs::path{snapshot_manifest::FILENAME})
+            continue;
+        m.files[rel.generic_string()] = file_hash(entry.path());
+    }
+
+    if (!tools::dump_file(out_dir / snapshot_manifest::FILENAME, m.to_string()))
+        throw std::runtime_error{"Failed to write snapshot manifest"};
+    return m;
+}
+
+snapshot_manifest install_snapshot(
+        const fs::path& snapshot_dir,
+        const fs::path& data_dir,
+        cryptonote::network_type nettype,
+        const crypto::hash& expected_top_hash,
+        const bool* stop_requested) {
+    std::string manifest_data;
+    if (!tools::slurp_file(snapshot_dir / snapshot_manifest::FILENAME, manifest_data))
+        throw std::runtime_error{"Failed to read snapshot manifest in {}"_format(snapshot_dir)};
+    auto m = snapshot_manifest::parse(manifest_data);
+
+    if (m.nettype != nettype)
+        throw std::runtime_error{"Snapshot is for {}, not {}"_format(
+                cryptonote::network_type_to_string(m.nettype),
+                cryptonote::network_type_to_string(nettype))};
+    if (m.top_hash != expected_top_hash)
+        throw std::runtime_error{
+                "Snapshot top block {} (height {}) is not the expected block {}"_format(
+                        m.top_hash, m.height - 1, expected_top_hash)};
+
+    auto db = cryptonote::new_db();
+    const fs::path db_dir{db->get_db_name()};
+    for (const auto& required : {db_dir / cryptonote::BLOCKCHAINDATA_FILENAME,
+                                 fs::path{ONS_DB_FILENAME},
+                                 fs::path{SQLITE_DB_FILENAME}})
+        if (!m.files.count(required.generic_string()))
+            throw std::runtime_error{"Snapshot is missing {}"_format(required)};
+    for (const auto& existing : {data_dir / db_dir / cryptonote::BLOCKCHAINDATA_FILENAME,
+                                 data_dir / ONS_DB_FILENAME,
+                                 data_dir / LEGACY_ONS_DB_FILENAME,
+                                 data_dir / SQLITE_DB_FILENAME})
+        if (fs::exists(existing))
+            throw std::runtime_error{
+                    "{} already exists; snapshots can only be installed into an empty data "
+                    "directory"_format(existing)};
+
+    log::info(logcat, "Checking snapshot files");
+    for (const auto& [path, hash] : m.files)
+        if (file_hash(snapshot_dir / tools::utf8_path(path)) != hash)
+            throw std::runtime_error{"Snapshot file {} does not match the manifest"_format(path)};
+
+    log::info(logcat, "Verifying {} blocks of the snapshot blockchain", m.height);
+    db->open(snapshot_dir / db_dir, nettype, DBF_RDONLY);
+    if (db->height() != m.height || db->top_block_hash() != m.top_hash)
+        throw std::runtime_error{"Snapshot blockchain does not match its manifest"};
+    const bool pruned = db->get_blockchain_pruning_seed();
+
+    parallel_scan(
+            0,
+            m.height,
+            [&](uint64_t height) {
+                cryptonote::block b;
+                if (!cryptonote::parse_and_validate_block_from_blob(
+                            db->get_block_blob_from_height(height), b))
+                    throw std::runtime_error{"Failed to parse block {}"_format(height)};
+                if (cryptonote::get_block_hash(b) != db->get_block_hash_from_height(height))
+                    throw std::runtime_error{"Block {} has the wrong hash"_format(height)};
+                if (height > 0 && b.prev_id != db->get_block_hash_from_height(height - 1))
+                    throw std::runtime_error{
+                            "Block {} does not follow block {}"_format(height, height - 1)};
+
+                std::string blob;
+                for (const auto& tx_hash : b.tx_hashes) {
+                    cryptonote::transaction tx;
+                    crypto::hash actual;
+                    if (!pruned) {
+                        if (!db->get_tx_blob(tx_hash, blob) ||
+                            !cryptonote::parse_and_validate_tx_from_blob(blob, tx))
+                            throw std::runtime_error{"Missing or invalid tx {}"_format(tx_hash)};
+                        actual = cryptonote::get_transaction_hash(tx);
+                    } else {
+                        crypto::hash prunable_hash;
+                        if (!db->get_pruned_tx_blob(tx_hash, blob) ||
+                            !cryptonote::parse_and_validate_tx_base_from_blob(blob, tx) ||
+                            !db->get_prunable_tx_hash(tx_hash, prunable_hash))
+                            throw std::runtime_error{"Missing or invalid tx {}"_format(tx_hash)};
+                        actual = cryptonote::get_pruned_transaction_hash(tx, prunable_hash);
+                    }
+                    if (actual != tx_hash)
+                        throw std::runtime_error{
+                                "Block {} tx {} has the wrong hash"_format(height, tx_hash)};
+                }
+            },
+            stop_requested);
+    db->close();
+    if (stop_requested && *stop_requested)
+        throw std::runtime_error{"Snapshot verification interrupted"};
+
+    log::info(logcat, "Installing snapshot into {}", data_dir);
+    fs::create_directories(data_dir);
+    for (const auto& [path, hash] : m.files) {
+        auto target = data_dir / tools::utf8_path(path);
+        fs::create_directories(target.parent_path());
+        fs::copy_file(snapshot_dir / tools::utf8_path(path), target);
+    }
+    return m;
+}
+
+}  // namespace blockchain_utils
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "common/fs.h"
+#include "crypto/hash.h"
+#include "cryptonote_config.h"
+
+namespace cryptonote {
+class BlockchainDB;
+}
+
+namespace blockchain_utils {
+
+/// A node snapshot is a directory holding copies of all of a node's chain-derived databases as of
+/// the same block: the blockchain LMDB (which also holds the serialized service node list state),
+/// ons.db and the batched rewards sqlite.db.  Installing one into a new node's data directory lets
+/// it start syncing from the snapshot height rather than replaying the whole chain.
+///
+/// The manifest describes the snapshot: the chain it is of, and a sha256 of each file in it.
+struct snapshot_manifest {
+    static constexpr std::string_view FILENAME = "snapshot.manifest";
+
+    cryptonote::network_type nettype = cryptonote::network_type::UNDEFINED;
+    // The number of blocks in the snapshot, i.e. one more than the height of `top_hash`'s block
+    uint64_t height = 0;
+    crypto::hash top_hash{};
+    // sha256 of each file, keyed by its path relative to the snapshot directory
+    std::map<std::string, crypto::hash> files;
+
+    std::string to_string() const;
+    // Throws std::runtime_error if `data` isn't a valid manifest
+    static snapshot_manifest parse(std::string_view data);
+};
+
+/// Writes a snapshot of the node databases in `data_dir` into `out_dir`.  `db` must be the open
+/// blockchain db of `data_dir`.  The databases are checked to all be at the same block, which in
+/// practice means the node must have been shut down cleanly before the snapshot is taken.  Throws
+/// on failure.
+snapshot_manifest write_snapshot(
+        const cryptonote::BlockchainDB& db,
+        const fs::path& data_dir,
+        const fs::path& out_dir,
+        cryptonote::network_type nettype);
+
+/// Verifies the snapshot in `snapshot_dir` and copies it into `data_dir`, which must not already
+/// have a blockchain database.  Verification checks the files against the manifest, that the
+/// snapshot's top block is `expected_top_hash`, and that every block and transaction in the
+/// snapshot's blockchain database hashes to what its successor commits to, back to genesis.
+/// The service node, ONS and rewards databases can't be checked without replaying the chain, so
+/// are trusted to be what their producer derived from that chain.  Throws on failure.
+snapshot_manifest install_snapshot(
+        const fs::path& snapshot_dir,
+        const fs::path& data_dir,
+        cryptonote::network_type nettype,
+        const crypto::hash& expected_top_hash,
+        const bool* stop_requested = nullptr);
+
+}  // namespace blockchain_utils
@@ -37,7 +37,10 @@
 #include <chrono>
 
 #include "blockchain_objects.h"
+#include "blockchain_scan.h"
+#include "common/file.h"
 #include "cryptonote_core/cryptonote_core.h"
+#include "serialization/binary_utils.h"
 #include "version.h"
 
 namespace po = boost::program_options;
@@ -45,6 +48,78 @@ using namespace cryptonote;
 
 static bool stop_requested = false;
 
+namespace {
+
+// What the stats need from each block, gathered in parallel (and cached between runs with
+// --cache-file)
+struct tx_counts {
+    uint32_t ins;
+    uint32_t outs;
+    uint32_t ring_size;
+
+    template <class Archive>
+    void serialize_object(Archive& ar) {
+        field_varint(ar, "ins", ins);
+        field_varint(ar, "outs", outs);
+        field_varint(ar, "ring_size", ring_size);
+    }
+};
+
+struct block_summary {
+    uint64_t timestamp;
+    uint64_t size;  // block blob plus pruned tx blobs
+    std::vector<tx_counts> txs;
+
+    template <class Archive>
+    void serialize_object(Archive& ar) {
+        field_varint(ar, "timestamp", timestamp);
+        field_varint(ar, "size", size);
+        field(ar, "txs", txs);
+    }
+};
+
+struct stats_cache {
+    // hash of the last block in `blocks`, to notice if it has since been reorged away
+    crypto::hash top_hash;
+    // summaries of every block from the genesis block on
+    std::vector<block_summary> blocks;
+
+    template <class Archive>
+    void serialize_object(Archive& ar) {
+        field(ar, "top_hash", top_hash);
+        field(ar, "blocks", blocks);
+    }
+};
+
+block_summary summarize_block(const BlockchainDB& db, uint64_t height) {
+    block_summary summary;
+    std::string bd = db.get_block_blob_from_height(height);
+    cryptonote::block blk;
+    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
+        throw oxen::traced<std::runtime_error>("Bad block from db");
+    summary.timestamp = blk.timestamp;
+    summary.size = bd.size();
+    summary.txs.reserve(blk.tx_hashes.size());
+    for (const auto& tx_id : blk.tx_hashes) {
+        if (!tx_id)
+            throw oxen::traced<std::runtime_error>("Aborting: null txid");
+        if (!db.get_pruned_tx_blob(tx_id, bd))
+            throw oxen::traced<std::runtime_error>("Aborting: tx not found");
+        transaction tx;
+        if (!parse_and_validate_tx_base_from_blob(bd, tx))
+            throw oxen::traced<std::runtime_error>("Bad txn from db");
+        summary.size += bd.size();
+        auto& counts = summary.txs.emplace_back();
+        counts.ins = tx.vin.size();
+        counts.outs = tx.vout.size();
+        const auto* in = tx.vin.empty() ? nullptr : std::get_if<txin_to_key>(&tx.vin[0]);
+        counts.ring_size = in ? in->key_offsets.size() : 0;
+    }
+    return summary;
+}
+
+}  // namespace
+
 int main(int argc, char* argv[]) {
     oxen::set_terminate_handler();
     static auto logcat = log::Cat("bcutil");
@@ -71,6 +146,12 @@ int main(int argc, char* argv[]) {
     const command_line::arg_flag arg_outputs{"with-outputs", "with output stats"};
     const command_line::arg_flag arg_ringsize{"with-ringsize", "with ringsize stats"};
     const command_line::arg_flag arg_hours{"with-hours", "with txns per hour"};
+    const command_line::arg_descriptor<std::string> arg_cache_file = {
+            "cache-file",
+            "Keep per-block data in this file so that later runs only have to read new blocks",
+            ""};
+    const command_line::arg_descriptor<unsigned> arg_threads = {
+            "threads", "Number of threads to read blocks with (0 for one per core)", 0};
 
     command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
     command_line::add_network_args(desc_cmd_sett);
@@ -81,6 +162,8 @@ int main(int argc, char* argv[]) {
     command_line::add_arg(desc_cmd_sett, arg_outputs);
     command_line::add_arg(desc_cmd_sett, arg_ringsize);
     command_line::add_arg(desc_cmd_sett, arg_hours);
+    command_line::add_arg(desc_cmd_sett, arg_cache_file);
+    command_line::add_arg(desc_cmd_sett, arg_threads);
     command_line::add_arg(desc_cmd_only, command_line::arg_help);
 
     po::options_description desc_options("Allowed options");
@@ -115,6 +198,8 @@ int main(int argc, char* argv[]) {
     bool do_outputs = command_line::get_arg(vm, arg_outputs);
     bool do_ringsize = command_line::get_arg(vm, arg_ringsize);
     bool do_hours = command_line::get_arg(vm, arg_hours);
+    const fs::path cache_file = tools::utf8_path(command_line::get_arg(vm, arg_cache_file));
+    const unsigned threads = command_line::get_arg(vm, arg_threads);
 
     log::warning(logcat, "Initializing source blockchain (BlockchainDB)");
     blockchain_objects_t blockchain_objects = {};
@@ -147,6 +232,62 @@ int main(int argc, char* argv[]) {
         block_stop = db_height;
     log::info(logcat, "Starting from height {}, stopping at height {}", block_start, block_stop);
 
+    // Summaries of the blocks from height `base` on.  With a cache file we keep every block (so
+    // that the cache is usable by later runs with any range), reading only those not cached yet.
+    uint64_t base = block_start, scan_stop = block_stop;
+    std::vector<block_summary> blocks;
+    if (!cache_file.empty()) {
+        base = 0;
+        scan_stop = db_height;
+        std::string data;
+        stats_cache cache;
+        if (std::error_code ec; !fs::exists(cache_file, ec))
+            log::info(logcat, "Cache file {} not found, it will be created", cache_file);
+        else if (!tools::slurp_file(cache_file, data))
+            log::warning(logcat, "Failed to read cache file {}", cache_file);
+        else {
+            try {
+                serialization::parse_binary(data, cache);
+            } catch (const std::exception& e) {
+                log::warning(logcat, "Ignoring invalid cache file {}: {}", cache_file, e.what());
+                cache.blocks.clear();
+            }
+            if (!cache.blocks.empty() && cache.blocks.size() <= db_height &&
+                db.get_block_hash_from_height(cache.blocks.size() - 1) == cache.top_hash) {
+                blocks = std::move(cache.blocks);
+                log::info(logcat, "Loaded {} blocks from cache file", blocks.size());
+            } else
+                log::warning(logcat, "Cache file doesn't match the blockchain, ignoring it");
+        }
+    }
+
+    if (block_stop > scan_stop)
+        block_stop = scan_stop;
+    const uint64_t cached = blocks.size();
+    if (scan_stop > base + cached) {
+        log::info(logcat, "Reading blocks {} to {}", base + cached, scan_stop - 1);
+        blocks.resize(scan_stop - base);
+        blockchain_utils::parallel_scan(
+                base + cached,
+                scan_stop,
+                [&](uint64_t h) { blocks[h - base] = summarize_block(db, h); },
+                &stop_requested,
+                threads);
+    }
+    if (stop_requested) {
+        core_storage->deinit();
+        return 1;
+    }
+
+    if (!cache_file.empty() && blocks.size() > cached) {
+        stats_cache cache;
+        cache.top_hash = db.get_block_hash_from_height(scan_stop - 1);
+        cache.blocks = std::move(blocks);
+        if (!tools::dump_file(cache_file, serialization::dump_binary(cache)))
+            log::warning(logcat, "Failed to write cache file {}", cache_file);
+        blocks = std::move(cache.blocks);
+    }
+
     /*
      * The default output can be plotted with GnuPlot using these commands:
     set key autotitle columnhead
@@ -196,12 +337,7 @@ int main(int argc, char* argv[]) {
     unsigned int i;
 
     for (uint64_t h = block_start; h < block_stop; ++h) {
-        std::string bd = db.get_block_blob_from_height(h);
-        cryptonote::block blk;
-        if (!cryptonote::parse_and_validate_block_from_blob(bd, blk)) {
-            log::warning(logcat, "Bad block from db");
-            return 1;
-        }
+        const auto& blk = blocks[h - base];
         auto ts = std::chrono::system_clock::from_time_t(blk.timestamp);
         using namespace date;
         year_month_day curr_date{floor<days>(ts)};
@@ -256,25 +392,13 @@ int main(int argc, char* argv[]) {
             std::cout << "\n";
         }
     skip:
-        currsz += bd.size();
-        for (const auto& tx_id : blk.tx_hashes) {
-            if (!tx_id) {
-                throw oxen::traced<std::runtime_error>("Aborting: null txid");
-            }
-            if (!db.get_pruned_tx_blob(tx_id, bd)) {
-                throw oxen::traced<std::runtime_error>("Aborting: tx not found");
-            }
-            transaction tx;
-            if (!parse_and_validate_tx_base_from_blob(bd, tx)) {
-                log::warning(logcat, "Bad txn from db");
-                return 1;
-            }
-            currsz += bd.size();
+        currsz += blk.size;
+        for (const auto& tx : blk.txs) {
             currtxs++;
             if (do_hours)
                 txhr[hh_mm_ss{ts - floor<days>(ts)}.hours().count()]++;
             if (do_inputs) {
-                io = tx.vin.size();
+                io = tx.ins;
                 if (io < minins)
                     minins = io;
                 else if (io > maxins)
@@ -282,8 +406,7 @@ int main(int argc, char* argv[]) {
                 totins += io;
             }
             if (do_ringsize) {
-                const auto& tx_in_to_key = var::get<cryptonote::txin_to_key>(tx.vin[0]);
-                io = tx_in_to_key.key_offsets.size();
+                io = tx.ring_size;
                 if (io < minrings)
                     minrings = io;
                 else if (io > maxrings)
@@ -291,7 +414,7 @@ int main(int argc, char* argv[]) {
                 totrings += io;
             }
             if (do_outputs) {
-                io = tx.vout.size();
+                io = tx.outs;
                 if (io < minouts)
                     minouts = io;
                 else if (io > maxouts)
@@ -301,9 +424,6 @@ int main(int argc, char* argv[]) {
             tottxs++;
         }
         currblks++;
-
-        if (stop_requested)
-            break;
     }
 
     core_storage->deinit();
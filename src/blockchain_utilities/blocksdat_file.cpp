@@ -71,6 +71,10 @@ bool BlocksdatFile::open_writer(const fs::path& file_path, uint64_t block_stop)
 }
 
 bool BlocksdatFile::initialize_file(uint64_t block_stop) {
+    // block hash files get written in one go, on close
+    if (m_hash_file_nettype)
+        return true;
+
     const uint32_t nblocks = (block_stop + 1) / HASH_OF_HASHES_STEP;
     unsigned char nblocksc[4];
 
@@ -97,11 +101,17 @@ void BlocksdatFile::write_block(const crypto::hash& block_hash) {
                 m_hashes.data() + HASH_OF_HASHES_STEP,
                 (m_hashes.size() - HASH_OF_HASHES_STEP) * sizeof(crypto::hash));
         m_hashes.resize(m_hashes.size() - HASH_OF_HASHES_STEP);
-        m_raw_data_file->write(reinterpret_cast<const char*>(hash.data()), hash.size());
+        if (m_hash_file_nettype)
+            m_hash_of_hashes.push_back(hash);
+        else
+            m_raw_data_file->write(reinterpret_cast<const char*>(hash.data()), hash.size());
     }
 }
 
 bool BlocksdatFile::close() {
+    if (m_hash_file_nettype)
+        *m_raw_data_file << block_hash_file::serialize(
+                *m_hash_file_nettype, m_hash_of_hashes, m_signing_key);
     if (m_raw_data_file->fail())
         return false;
 
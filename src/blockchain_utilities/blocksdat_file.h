@@ -44,6 +44,7 @@
 #include "common/fs.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
+#include "cryptonote_core/block_hash_file.h"
 #include "cryptonote_core/blockchain.h"
 #include "version.h"
 
@@ -57,6 +58,14 @@ class BlocksdatFile {
             fs::path& output_file,
             uint64_t use_block_height = 0);
 
+    // Makes store_blockchain_raw() write a block_hash_file (signed with `signing_key`, if given)
+    // rather than the blocks.dat format that gets compiled into the daemon.
+    void use_block_hash_file_format(
+            network_type nettype, const crypto::ed25519_secret_key* signing_key = nullptr) {
+        m_hash_file_nettype = nettype;
+        m_signing_key = signing_key;
+    }
+
   protected:
     Blockchain* m_blockchain_storage;
 
@@ -71,4 +80,7 @@ class BlocksdatFile {
   private:
     uint64_t m_cur_height;  // tracks current height during export
     std::vector<crypto::hash> m_hashes;
+    std::optional<network_type> m_hash_file_nettype;
+    const crypto::ed25519_secret_key* m_signing_key = nullptr;
+    std::vector<crypto::hash> m_hash_of_hashes;
 };
@@ -31,6 +31,8 @@
 
 #include <fmt/std.h>
 
+#include <cstring>
+
 #include "bootstrap_serialization.h"
 #include "common/exception.h"
 #include "serialization/binary_utils.h"  // dump_binary(), parse_binary()
@@ -44,6 +46,23 @@ namespace {
 const uint32_t blockchain_raw_magic = 0x28721586;
 const uint32_t header_size = 1024;
 
+// Chunk types, stored in the chunk header of version 1 files
+constexpr uint8_t chunk_type_block = 0;
+constexpr uint8_t chunk_type_index = 1;
+
+// Sanity limit on the size of an index chunk (which, unlike block chunks, grows with the number of
+// blocks exported at once).
+constexpr uint32_t MAX_INDEX_CHUNK_SIZE = 256 * 1024 * 1024;
+
+// Chunk size, then (from version 1) the chunk type and a checksum of the chunk data
+constexpr uint64_t chunk_header_size(uint8_t version) {
+    return sizeof(uint32_t) + (version >= 1 ? 1 + sizeof(crypto::hash8) : 0);
+}
+
+crypto::hash8 chunk_checksum(std::string_view data) {
+    return crypto::keccak<crypto::hash8>(data);
+}
+
 std::string refresh_string = "\r                                    \r";
 auto logcat = log::Cat("bcutil");
 }  // namespace
@@ -83,6 +102,13 @@ bool BootstrapFile::open_writer(const fs::path& file_path) {
     }
     m_height = num_blocks;
 
+    if (do_initialize_file) {
+        m_version = 1;
+        m_offsets.clear();
+        m_last_index_offset = 0;
+        m_indexed_height = 0;
+    }
+
     if (do_initialize_file)
         m_raw_data_file->open(
                 file_path.string(), std::ios_base::binary | std::ios_base::out | std::ios::trunc);
@@ -119,7 +145,7 @@ bool BootstrapFile::initialize_file() {
     *m_raw_data_file << blob;
 
     bootstrap::file_info bfi;
-    bfi.major_version = 0;
+    bfi.major_version = m_version;
     bfi.minor_version = 1;
     bfi.header_size = header_size;
 
@@ -178,6 +204,22 @@ void BootstrapFile::flush_chunk() {
         log::warning(logcat, "WARNING: chunk_size {} > BUFFER_SIZE {}", chunk_size, BUFFER_SIZE);
     }
 
+    if (m_max_chunk < chunk_size) {
+        m_max_chunk = chunk_size;
+    }
+    m_offsets.push_back(m_raw_data_file->tellp());
+    write_chunk({m_buffer.data(), m_buffer.size()}, chunk_type_block);
+
+    m_buffer.clear();
+    delete m_output_stream;
+    m_output_stream =
+            new boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>>(
+                    m_buffer);
+    log::debug(logcat, "flushed chunk:  chunk_size: {}", chunk_size);
+}
+
+void BootstrapFile::write_chunk(std::string_view data, uint8_t type) {
+    uint32_t chunk_size = data.size();
     std::string blob;
     try {
         blob = serialization::dump_binary(chunk_size);
@@ -185,13 +227,15 @@ void BootstrapFile::flush_chunk() {
         throw oxen::traced<std::runtime_error>(
                 "Error in serialization of chunk size: "s + e.what());
     }
+    if (m_version >= 1) {
+        blob += static_cast<char>(type);
+        auto sum = chunk_checksum(data);
+        blob.append(reinterpret_cast<const char*>(sum.data()), sum.size());
+    }
     *m_raw_data_file << blob;
 
-    if (m_max_chunk < chunk_size) {
-        m_max_chunk = chunk_size;
-    }
     long pos_before = m_raw_data_file->tellp();
-    std::copy(m_buffer.begin(), m_buffer.end(), std::ostreambuf_iterator<char>(*m_raw_data_file));
+    m_raw_data_file->write(data.data(), data.size());
     m_raw_data_file->flush();
     long pos_after = m_raw_data_file->tellp();
     long num_chars_written = pos_after - pos_before;
@@ -204,13 +248,6 @@ void BootstrapFile::flush_chunk() {
                 num_chars_written);
         throw oxen::traced<std::runtime_error>("Error writing chunk");
     }
-
-    m_buffer.clear();
-    delete m_output_stream;
-    m_output_stream =
-            new boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>>(
-                    m_buffer);
-    log::debug(logcat, "flushed chunk:  chunk_size: {}", chunk_size);
 }
 
 void BootstrapFile::write_block(block& block) {
@@ -257,6 +294,23 @@ bool BootstrapFile::close() {
     if (m_raw_data_file->fail())
         return false;
 
+    // Index the blocks written since the last index chunk.  The index chunk ends with its own file
+    // offset so that a reader can find it from the end of the file, and links back to the previous
+    // index chunk so that nothing already written has to be rewritten.
+    if (m_version >= 1 && m_offsets.size() > m_indexed_height) {
+        bootstrap::chunk_index index;
+        index.first_height = m_indexed_height;
+        index.offsets.assign(m_offsets.begin() + m_indexed_height, m_offsets.end());
+        index.prev_index_offset = m_last_index_offset;
+        uint64_t offset = m_raw_data_file->tellp();
+        std::string data = t_serializable_object_to_blob(index);
+        data += serialization::dump_binary(offset);
+        write_chunk(data, chunk_type_index);
+        m_last_index_offset = offset;
+        m_indexed_height = m_offsets.size();
+        log::info(logcat, "Wrote index of {} blocks", index.offsets.size());
+    }
+
     m_raw_data_file->flush();
     delete m_output_stream;
     delete m_raw_data_file;
@@ -383,6 +437,11 @@ uint64_t BootstrapFile::seek_to_first_chunk(std::ifstream& import_file) {
             "bootstrap file v{}.{}",
             unsigned(bfi.major_version),
             unsigned(bfi.minor_version));
+    if (bfi.major_version > 1)
+        throw oxen::traced<std::runtime_error>(
+                "Unsupported bootstrap file version "s +
+                std::to_string(bfi.major_version));
+    m_version = bfi.major_version;
     log::info(logcat, "bootstrap magic size: {}", sizeof(file_magic));
     log::info(logcat, "bootstrap header size: {}", bfi.header_size);
 
@@ -392,31 +451,123 @@ uint64_t BootstrapFile::seek_to_first_chunk(std::ifstream& import_file) {
     return full_header_size;
 }
 
+bool BootstrapFile::read_chunk_header(
+        std::istream& import_file, uint32_t& chunk_size, uint8_t& type, crypto::hash8& sum) {
+    char buf[chunk_header_size(1)];
+    import_file.read(buf, chunk_header_size(m_version));
+    if (!import_file)
+        return false;
+    try {
+        serialization::parse_binary(std::string_view{buf, sizeof(chunk_size)}, chunk_size);
+    } catch (const std::exception& e) {
+        throw oxen::traced<std::runtime_error>(
+                "Error in deserialization of chunk_size: "s + e.what());
+    }
+    type = chunk_type_block;
+    sum = {};
+    if (m_version >= 1) {
+        type = static_cast<uint8_t>(buf[sizeof(chunk_size)]);
+        std::memcpy(sum.data(), buf + sizeof(chunk_size) + 1, sum.size());
+    }
+    return true;
+}
+
+int BootstrapFile::read_chunk(std::istream& import_file, std::string& chunk, uint64_t& bytes_read) {
+    while (true) {
+        uint32_t chunk_size;
+        uint8_t type;
+        crypto::hash8 sum;
+        if (!read_chunk_header(import_file, chunk_size, type, sum)) {
+            std::cout << refresh_string;
+            log::info(logcat, "End of file reached");
+            return 1;
+        }
+        bytes_read += chunk_header_size(m_version);
+        log::debug(logcat, "chunk_size: {}", chunk_size);
+
+        if (type == chunk_type_index) {
+            // Only needed for seeking, which has already happened by now
+            import_file.seekg(chunk_size, std::ios_base::cur);
+            bytes_read += chunk_size;
+            continue;
+        }
+        if (type != chunk_type_block) {
+            log::error(logcat, "ERROR: unknown chunk type {}", type);
+            return 2;
+        }
+        if (chunk_size > BUFFER_SIZE) {
+            log::warning(
+                    logcat, "WARNING: chunk_size {} > BUFFER_SIZE {}", chunk_size, BUFFER_SIZE);
+            throw oxen::traced<std::runtime_error>("Aborting: chunk size exceeds buffer size");
+        }
+        if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD) {
+            log::info(
+                    logcat, "NOTE: chunk_size {} > {}", chunk_size, CHUNK_SIZE_WARNING_THRESHOLD);
+        } else if (chunk_size == 0) {
+            log::error(logcat, "ERROR: chunk_size == 0");
+            return 2;
+        }
+        chunk.resize(chunk_size);
+        import_file.read(chunk.data(), chunk_size);
+        if (!import_file) {
+            if (import_file.eof()) {
+                std::cout << refresh_string;
+                log::info(logcat, "End of file reached - file was truncated");
+                return 1;
+            }
+            log::error(
+                    logcat,
+                    "ERROR: unexpected end of file: bytes read before error: {} of chunk_size {}",
+                    import_file.gcount(),
+                    chunk_size);
+            return 2;
+        }
+        if (m_version >= 1 && chunk_checksum(chunk) != sum) {
+            log::error(logcat, "ERROR: chunk checksum mismatch at offset {}", bytes_read);
+            return 2;
+        }
+        bytes_read += chunk_size;
+        log::debug(logcat, "Total bytes read: {}", bytes_read);
+        return 0;
+    }
+}
+
 uint64_t BootstrapFile::count_bytes(
-        std::ifstream& import_file, uint64_t blocks, uint64_t& h, bool& quit) {
+        std::ifstream& import_file,
+        uint64_t blocks,
+        uint64_t& h,
+        bool& quit,
+        bool record_offsets) {
     uint64_t bytes_read = 0;
     uint32_t chunk_size;
-    char buf1[sizeof(chunk_size)];
-    std::string str1;
+    uint8_t type;
+    crypto::hash8 sum;
     h = 0;
-    while (1) {
-        import_file.read(buf1, sizeof(chunk_size));
-        if (!import_file) {
+    while (h < blocks) {
+        uint64_t offset = record_offsets ? static_cast<uint64_t>(import_file.tellg()) : 0;
+        if (!read_chunk_header(import_file, chunk_size, type, sum)) {
             std::cout << refresh_string;
             log::debug(logcat, "End of file reached");
             quit = true;
             break;
         }
-        bytes_read += sizeof(chunk_size);
-        str1.assign(buf1, sizeof(chunk_size));
-        try {
-            serialization::parse_binary(str1, chunk_size);
-        } catch (const std::exception& e) {
-            throw oxen::traced<std::runtime_error>(
-                    "Error in deserialization of chunk_size: "s + e.what());
-        }
+        bytes_read += chunk_header_size(m_version);
         log::debug(logcat, "chunk_size: {}", chunk_size);
 
+        if (type == chunk_type_index) {
+            import_file.seekg(chunk_size, std::ios_base::cur);
+            bytes_read += chunk_size;
+            if (record_offsets) {
+                m_last_index_offset = offset;
+                m_indexed_height = m_offsets.size();
+            }
+            continue;
+        }
+        if (type != chunk_type_block) {
+            std::cout << refresh_string;
+            log::error(logcat, "ERROR: unknown chunk type {} at offset {}", type, bytes_read);
+            throw oxen::traced<std::runtime_error>("Aborting");
+        }
         if (chunk_size > BUFFER_SIZE) {
             std::cout << refresh_string;
             log::warning(
@@ -459,13 +610,96 @@ uint64_t BootstrapFile::count_bytes(
             throw oxen::traced<std::runtime_error>("Aborting");
         }
         bytes_read += chunk_size;
+        if (record_offsets)
+            m_offsets.push_back(offset);
         h += NUM_BLOCKS_PER_CHUNK;
-        if (h >= blocks)
-            break;
     }
     return bytes_read;
 }
 
+bool BootstrapFile::read_index_chunk(
+        std::istream& import_file,
+        uint64_t offset,
+        bootstrap::chunk_index& index,
+        uint64_t& end) {
+    import_file.clear();
+    import_file.seekg(offset);
+    uint32_t chunk_size;
+    uint8_t type;
+    crypto::hash8 sum;
+    if (!read_chunk_header(import_file, chunk_size, type, sum) || type != chunk_type_index ||
+        chunk_size < sizeof(uint64_t) || chunk_size > MAX_INDEX_CHUNK_SIZE)
+        return false;
+
+    std::string data(chunk_size, '\0');
+    import_file.read(data.data(), chunk_size);
+    if (!import_file || chunk_checksum(data) != sum)
+        return false;
+
+    // The index itself, followed by the chunk's own offset
+    std::string_view payload{data};
+    uint64_t self_offset;
+    try {
+        serialization::parse_binary(payload.substr(payload.size() - sizeof(uint64_t)), self_offset);
+        serialization::parse_binary(payload.substr(0, payload.size() - sizeof(uint64_t)), index);
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Invalid index chunk at offset {}: {}", offset, e.what());
+        return false;
+    }
+    if (self_offset != offset)
+        return false;
+    end = offset + chunk_header_size(m_version) + chunk_size;
+    return true;
+}
+
+// Loads m_offsets from the chain of index chunks ending at the end of the file.  Returns false if
+// the file doesn't end with a valid index chunk (for instance if an export was interrupted), or if
+// the chain of index chunks doesn't cover every block, in which case the file has to be scanned.
+bool BootstrapFile::load_index(std::ifstream& import_file, uint64_t first_chunk) {
+    import_file.seekg(0, std::ios_base::end);
+    const uint64_t file_size = import_file.tellg();
+    if (!import_file || file_size < first_chunk + sizeof(uint64_t))
+        return false;
+
+    char buf[sizeof(uint64_t)];
+    import_file.seekg(file_size - sizeof(buf));
+    import_file.read(buf, sizeof(buf));
+    if (!import_file)
+        return false;
+    uint64_t last_offset;
+    serialization::parse_binary(std::string_view{buf, sizeof(buf)}, last_offset);
+
+    // Newest first
+    std::vector<bootstrap::chunk_index> indices;
+    uint64_t limit = file_size;
+    for (uint64_t offset = last_offset;;) {
+        if (offset < first_chunk || offset >= limit)
+            return false;
+        auto& index = indices.emplace_back();
+        uint64_t end;
+        if (!read_index_chunk(import_file, offset, index, end))
+            return false;
+        if (indices.size() == 1 ? end != file_size : end > limit)
+            return false;
+        if (indices.size() > 1 &&
+            index.first_height + index.offsets.size() != indices[indices.size() - 2].first_height)
+            return false;
+        if (!index.prev_index_offset)
+            break;
+        limit = offset;
+        offset = index.prev_index_offset;
+    }
+    if (indices.back().first_height != 0)
+        return false;
+
+    m_offsets.clear();
+    for (auto it = indices.rbegin(); it != indices.rend(); ++it)
+        m_offsets.insert(m_offsets.end(), it->offsets.begin(), it->offsets.end());
+    m_last_index_offset = last_offset;
+    m_indexed_height = m_offsets.size();
+    return true;
+}
+
 uint64_t BootstrapFile::count_blocks(const fs::path& import_file_path) {
     std::streampos dummy_pos;
     uint64_t dummy_height = 0;
@@ -493,6 +727,22 @@ uint64_t BootstrapFile::count_blocks(
     uint64_t full_header_size;  // 4 byte magic + length of header structures
     full_header_size = seek_to_first_chunk(import_file);
 
+    m_offsets.clear();
+    m_last_index_offset = 0;
+    m_indexed_height = 0;
+    if (m_version >= 1 && load_index(import_file, full_header_size)) {
+        h = m_offsets.size();
+        if (start_height && start_height < h) {
+            start_pos = m_offsets[start_height];
+            seek_height = start_height;
+        }
+        log::info(logcat, "Read block index from bootstrap file");
+        std::cout << "Number of blocks: " << h << std::endl;
+        return h;
+    }
+    import_file.clear();
+    import_file.seekg(full_header_size);
+
     log::info(logcat, "Scanning blockchain from bootstrap file...");
     bool quit = false;
     uint64_t bytes_read = 0, blocks;
@@ -504,7 +754,7 @@ uint64_t BootstrapFile::count_blocks(
             start_pos = import_file.tellg();
             seek_height = h;
         }
-        bytes_read += count_bytes(import_file, progress_interval, blocks, quit);
+        bytes_read += count_bytes(import_file, progress_interval, blocks, quit, m_version >= 1);
         h += blocks;
         std::cout << "\r"
                   << "block height: " << h - 1 << "    \r" << std::flush;
@@ -39,6 +39,7 @@
 #include <fstream>
 
 #include "blockchain_utilities.h"
+#include "bootstrap_serialization.h"
 #include "common/command_line.h"
 #include "common/fs.h"
 #include "cryptonote_basic/cryptonote_basic.h"
@@ -49,12 +50,22 @@ using namespace cryptonote;
 
 class BootstrapFile {
   public:
-    uint64_t count_bytes(std::ifstream& import_file, uint64_t blocks, uint64_t& h, bool& quit);
+    uint64_t count_bytes(
+            std::ifstream& import_file,
+            uint64_t blocks,
+            uint64_t& h,
+            bool& quit,
+            bool record_offsets = false);
     uint64_t count_blocks(
             const fs::path& dir_path, std::streampos& start_pos, uint64_t& seek_height);
     uint64_t count_blocks(const fs::path& dir_path);
     uint64_t seek_to_first_chunk(std::ifstream& import_file);
 
+    // Reads the next block chunk of the file into `chunk`, skipping over any index chunks and
+    // verifying the chunk checksum (for files with them).  Returns 0 on success, 1 at the end of
+    // the file (including a truncated final chunk) and 2 on error.
+    int read_chunk(std::istream& import_file, std::string& chunk, uint64_t& bytes_read);
+
     bool store_blockchain_raw(
             cryptonote::Blockchain* cs,
             cryptonote::tx_memory_pool* txp,
@@ -81,4 +92,25 @@ class BootstrapFile {
     uint64_t m_height;
     uint64_t m_cur_height;  // tracks current height during export
     uint32_t m_max_chunk;
+
+    // Major version of the file being read or appended to: 0 is the original format of bare
+    // length-prefixed chunks; 1 adds a type and checksum to each chunk header, and an index chunk
+    // at the end of each export.
+    uint8_t m_version = 0;
+    // File offset of each block's chunk, if known (from the index, or from scanning the file)
+    std::vector<uint64_t> m_offsets;
+    // Offset of the last index chunk in the file (0 if none), and the number of blocks it and the
+    // ones before it cover.
+    uint64_t m_last_index_offset = 0;
+    uint64_t m_indexed_height = 0;
+
+    bool read_chunk_header(
+            std::istream& import_file, uint32_t& chunk_size, uint8_t& type, crypto::hash8& sum);
+    void write_chunk(std::string_view data, uint8_t type);
+    bool read_index_chunk(
+            std::istream& import_file,
+            uint64_t offset,
+            bootstrap::chunk_index& index,
+            uint64_t& end);
+    bool load_index(std::ifstream& import_file, uint64_t first_chunk);
 };
@@ -79,4 +79,24 @@ struct block_package {
     }
 };
 
+// Index chunk appended by each export to an indexed (file_info::major_version 1) bootstrap file,
+// giving the file offset of the chunk of each block the export wrote.  The index chunks form a
+// chain back through the earlier exports to the same file, so that the whole file is covered
+// without ever rewriting anything already written.
+struct chunk_index {
+    // height of the block at offsets[0]
+    uint64_t first_height;
+    // file offset of the chunk of each block from first_height on
+    std::vector<uint64_t> offsets;
+    // file offset of the previous export's index chunk, or 0 if this is the first one
+    uint64_t prev_index_offset;
+
+    template <class Archive>
+    void serialize_object(Archive& ar) {
+        field_varint(ar, "first_height", first_height);
+        field(ar, "offsets", offsets);
+        field_varint(ar, "prev_index_offset", prev_index_offset);
+    }
+};
+
 }  // namespace cryptonote::bootstrap
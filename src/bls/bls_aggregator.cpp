@@ -12,6 +12,7 @@
 #include <oxenc/bt_producer.h>
 #include <oxenmq/oxenmq.h>
 
+#include <algorithm>
 #include <chrono>
 #include <ethyl/utils.hpp>
 
@@ -23,6 +24,18 @@ namespace eth {
 // determines the age cutoff for what we are willing to sign.
 constexpr auto BLS_EXIT_REQUEST_MAX_AGE = 3min;
 
+// Limits on the timeout given to each node when gathering signatures; within them a node gets a few
+// times its recent average round-trip time.  Nodes we have not heard from before get the maximum.
+constexpr std::chrono::milliseconds NODE_REQUEST_MIN_TIMEOUT = 2s;
+constexpr std::chrono::milliseconds NODE_REQUEST_MAX_TIMEOUT = 15s;
+constexpr int NODE_REQUEST_TIMEOUT_RTT_MULTIPLE = 4;
+
+// The most signature requests we have outstanding at once
+constexpr size_t MAX_CONNECTIONS = 900;
+
+// How long connections made to gather signatures are kept open after the last request
+constexpr auto NODE_CONNECTION_KEEP_ALIVE = 5min;
+
 static constexpr std::string_view to_string(bls_exit_type type) {
     switch (type) {
         case bls_exit_type::normal: return "Exit";
@@ -267,6 +280,42 @@ namespace {
         std::vector<agg_log> error;
     };
 
+    struct signed_response {
+        service_nodes::service_node_address sn;
+        bls_signature signature;
+    };
+
+    // Verifies the signatures of `msg` collected from the network as a single batch and adds the
+    // valid ones to `result`'s signers and the aggregate signature.
+    void aggregate_signatures(
+            cryptonote::network_type nettype,
+            std::span<const uint8_t> msg,
+            std::span<const signed_response> responses,
+            signature_aggregator& agg_sig,
+            bls_aggregate_signed& result,
+            agg_log_list& agg_log_lister) {
+        std::vector<bls_signature> signatures;
+        std::vector<bls_public_key> pubkeys;
+        signatures.reserve(responses.size());
+        pubkeys.reserve(responses.size());
+        for (const auto& r : responses) {
+            signatures.push_back(r.signature);
+            pubkeys.push_back(r.sn.bls_pubkey);
+        }
+
+        auto valid = eth::verify_batch(nettype, signatures, pubkeys, msg);
+        for (size_t i = 0; i < responses.size(); i++) {
+            const auto& r = responses[i];
+            if (!valid[i]) {
+                agg_log_lister.error.emplace_back(r.sn, "Invalid BLS signature");
+                continue;
+            }
+            agg_sig.add(r.signature);
+            result.signers_bls_pubkeys.push_back(r.sn.bls_pubkey);
+            agg_log_lister.success.emplace_back(r.sn, "Success, sig: {}"_format(r.signature));
+        }
+    }
+
     void dump_agg_log_list(const agg_log_list& lister) {
         size_t total_aggs = lister.error.size() + lister.success.size();
         size_t success_pct = lister.success.size() / static_cast<float>(total_aggs) * 100.f;
@@ -428,10 +477,12 @@ bls_aggregator::bls_aggregator(cryptonote::core& _core) : core{_core} {
                     uint64_t top_height = core.blockchain.get_current_blockchain_height() - 1;
                     uint64_t cutoff = top_height - core.get_net_config().STORE_RECENT_REWARDS;
                     if (cutoff < top_height) {
-                        std::lock_guard lock{rewards_response_cache_mutex};
+                        std::unique_lock lock{rewards_response_cache_mutex};
                         std::erase_if(rewards_response_cache, [&cutoff](const auto& item) {
                             return item.second.height < cutoff;
                         });
+                        core.blockchain.sqlite_db().prune_bls_signatures(
+                                cryptonote::bls_signature_type::rewards, cutoff);
                     }
                 }
                 {
@@ -441,10 +492,13 @@ bls_aggregator::bls_aggregator(cryptonote::core& _core) : core{_core} {
                                     contract::REWARDS_EXIT_SIGNATURE_EXPIRY)
                                     .count();
 
-                    std::lock_guard lock{exit_liquidation_response_cache_mutex};
+                    std::unique_lock lock{exit_liquidation_response_cache_mutex};
                     std::erase_if(exit_liquidation_response_cache, [&cutoff](const auto& item) {
                         return item.second.timestamp < cutoff;
                     });
+                    auto& sql = core.blockchain.sqlite_db();
+                    sql.prune_bls_signatures(cryptonote::bls_signature_type::exit, cutoff);
+                    sql.prune_bls_signatures(cryptonote::bls_signature_type::liquidation, cutoff);
                 }
             },
             5min);
@@ -467,12 +521,53 @@ bls_registration_response bls_aggregator::registration(
             .ed_signature = crypto::null<crypto::ed25519_signature>};
 }
 
+std::chrono::milliseconds bls_aggregator::node_request_timeout(
+        const crypto::x25519_public_key& xpk) {
+    std::lock_guard lock{node_rtt_mutex};
+    auto it = node_rtt.find(xpk);
+    if (it == node_rtt.end())
+        return NODE_REQUEST_MAX_TIMEOUT;
+    return std::clamp(
+            NODE_REQUEST_TIMEOUT_RTT_MULTIPLE * it->second,
+            NODE_REQUEST_MIN_TIMEOUT,
+            NODE_REQUEST_MAX_TIMEOUT);
+}
+
+void bls_aggregator::record_node_rtt(
+        const crypto::x25519_public_key& xpk, std::chrono::milliseconds rtt) {
+    std::lock_guard lock{node_rtt_mutex};
+    auto [it, inserted] = node_rtt.emplace(xpk, rtt);
+    if (!inserted)
+        it->second = (7 * it->second + rtt) / 8;
+}
+
+void bls_aggregator::store_cached_signature(
+        cryptonote::bls_signature_type type,
+        std::string_view id,
+        const bls_aggregate_signed& response,
+        uint64_t height,
+        uint64_t amount) {
+    try {
+        core.blockchain.sqlite_db().store_bls_signature(
+                type,
+                id,
+                {.height = height,
+                 .amount = amount,
+                 .msg_to_sign = response.msg_to_sign,
+                 .signers = response.signers_bls_pubkeys,
+                 .signature = response.signature});
+    } catch (const std::exception& e) {
+        // Not fatal: we just won't be able to serve it from the database after a restart
+        log::warning(
+                logcat, "Failed to store aggregate BLS signature in the database: {}", e.what());
+    }
+}
+
 uint64_t bls_aggregator::nodes_request(
         std::string_view request_name, std::string_view message, const request_callback& callback) {
     std::mutex connection_mutex;
     std::condition_variable cv;
     size_t active_connections = 0;
-    const size_t MAX_CONNECTIONS = 900;
 
     // FIXME: make this function async rather than blocking
     std::vector<service_nodes::service_node_address> snodes;
@@ -486,67 +581,47 @@ uint64_t bls_aggregator::nodes_request(
 
         // TODO: We should query non-active SNs as well and try and get them to participate in the
         // aggregation step to reduce the number of non-signers. They might still be contactable.
-        if (core.service_node_list.is_service_node(snode.sn_pubkey, /*require_active*/ true)) {
-            if (1) {
-                std::lock_guard connection_lock(connection_mutex);
-                ++active_connections;
-                ++result;
-            } else {
-                // TODO(doyle): Rate limit
-                std::unique_lock connection_lock(connection_mutex);
-                cv.wait(connection_lock,
-                        [&active_connections] { return active_connections < MAX_CONNECTIONS; });
-            }
-
-            omq.request(
-                    tools::view_guts(snode.x_pubkey),
-                    request_name,
-                    [i, &snodes, &connection_mutex, &active_connections, &cv, &callback](
-                            bool success, std::vector<std::string> data) {
-                        callback(bls_response{snodes[i], success}, data);
-                        std::lock_guard connection_lock{connection_mutex};
-                        assert(active_connections);
-                        if (--active_connections == 0)
-                            cv.notify_all();
-                    },
-                    message);
-        } else {
-// TODO: This appears to work now that we currently generate the endpoint to contact the
-// node on (and actually use their xkey for authenticated comms). The localdev script
-// fails though but it progresses further than it did before when this was last enabled.
-#if 0
-            if (1) {
-                std::lock_guard connection_lock(connection_mutex);
-                ++active_connections;
-            } else {
-                // TODO(doyle): Rate limit
-                std::unique_lock connection_lock(connection_mutex);
-                cv.wait(connection_lock,
-                        [&active_connections] { return active_connections < MAX_CONNECTIONS; });
-            }
+        if (!core.service_node_list.is_service_node(snode.sn_pubkey, /*require_active*/ true))
+            continue;
 
-            auto addr = oxenmq::address{"curve://{}:{}/{:x}"_format(
-                    epee::string_tools::get_ip_string_from_int32(snode.ip), snode.port, snode.x_pubkey)};
-            auto conn = omq.connect_remote(
-                    addr,
-                    [](oxenmq::ConnectionID) { /* Successfully connected */ },
-                    [](oxenmq::ConnectionID, std::string_view) { /* Failed to connect */ });
-
-            omq.request(
-                    conn,
-                    request_name,
-                    [i, &snodes, &connection_mutex, &active_connections, &cv, &callback, conn, &omq](
-                            bool success, std::vector<std::string> data) {
-                        callback(bls_response{snodes[i], success}, data);
-                        std::lock_guard connection_lock{connection_mutex};
-                        assert(active_connections);
-                        if (--active_connections == 0)
-                            cv.notify_all();
-                        omq.disconnect(conn);
-                    },
-                    message);
-#endif
+        {
+            std::unique_lock connection_lock(connection_mutex);
+            cv.wait(connection_lock,
+                    [&active_connections] { return active_connections < MAX_CONNECTIONS; });
+            ++active_connections;
+            ++result;
         }
+
+        // Each node gets a timeout based on how quickly it has answered before, so that a few
+        // dead or slow nodes don't hold up the whole request for the full default timeout.  The
+        // connections are kept open for a while after the request so that the next aggregation
+        // (which will usually go to the same nodes) can reuse them.
+        omq.request(
+                tools::view_guts(snode.x_pubkey),
+                request_name,
+                [this,
+                 i,
+                 &snodes,
+                 &connection_mutex,
+                 &active_connections,
+                 &cv,
+                 &callback,
+                 started = std::chrono::steady_clock::now()](
+                        bool success, std::vector<std::string> data) {
+                    auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - started);
+                    record_node_rtt(snodes[i].x_pubkey, rtt);
+                    callback(bls_response{snodes[i], success}, data);
+                    std::lock_guard connection_lock{connection_mutex};
+                    assert(active_connections);
+                    if (--active_connections < MAX_CONNECTIONS)
+                        cv.notify_all();
+                },
+                message,
+                oxenmq::send_option::hint{"tcp://{}:{}"_format(
+                        epee::string_tools::get_ip_string_from_int32(snode.ip), snode.port)},
+                oxenmq::send_option::request_timeout{node_request_timeout(snode.x_pubkey)},
+                oxenmq::send_option::keep_alive{NODE_CONNECTION_KEEP_ALIVE});
     }
 
     std::unique_lock connection_lock{connection_mutex};
@@ -642,7 +717,7 @@ bls_rewards_response bls_aggregator::rewards_request(const address& addr, uint64
 
     // NOTE: Serve the response from our cache if it's a repeated request
     {
-        std::lock_guard lock{rewards_response_cache_mutex};
+        std::shared_lock lock{rewards_response_cache_mutex};
         auto cache_it = rewards_response_cache.find(addr);
         if (cache_it != rewards_response_cache.end()) {
             const bls_rewards_response& cache_response = cache_it->second;
@@ -659,6 +734,28 @@ bls_rewards_response bls_aggregator::rewards_request(const address& addr, uint64
         }
     }
 
+    // Otherwise we might still have it in the database from before a restart
+    if (auto cached = core.blockchain.sqlite_db().get_bls_signature(
+                cryptonote::bls_signature_type::rewards, tools::view_guts(addr));
+        cached && cached->height == height && cached->amount == amount) {
+        bls_rewards_response response;
+        response.addr = addr;
+        response.amount = amount;
+        response.height = height;
+        response.msg_to_sign = std::move(cached->msg_to_sign);
+        response.signers_bls_pubkeys = std::move(cached->signers);
+        response.signature = cached->signature;
+        log::trace(
+                logcat,
+                "Serving rewards request from database for address {} at height {} with rewards {} "
+                "amount",
+                addr,
+                height,
+                amount);
+        std::unique_lock lock{rewards_response_cache_mutex};
+        return rewards_response_cache[addr] = std::move(response);
+    }
+
     bls_rewards_response result{};
     result.addr = addr;
     result.amount = amount;
@@ -666,9 +763,10 @@ bls_rewards_response bls_aggregator::rewards_request(const address& addr, uint64
     result.msg_to_sign = get_reward_balance_msg_to_sign(
             core.get_nettype(), result.addr, tools::encode_integer_be<32>(amount));
 
-    // `nodesRequest` dispatches to a threadpool hence we require synchronisation:
+    // `nodesRequest` dispatches to a threadpool hence we require synchronisation.  Responses are
+    // only parsed as they arrive; the signatures get verified together once we have all of them.
     std::mutex sig_mutex;
-    eth::signature_aggregator agg_sig;
+    std::vector<signed_response> responses;
 
     oxenc::bt_dict_producer d;
     d.append("address", tools::view_guts(addr));
@@ -680,8 +778,9 @@ bls_rewards_response bls_aggregator::rewards_request(const address& addr, uint64
     uint64_t total_requests = nodes_request(
             OMQ_BLS_REWARDS_ENDPOINT,
             std::move(d).str(),
-            [&agg_log_lister, &agg_sig, &result, &sig_mutex, nettype = core.get_nettype()](
+            [&agg_log_lister, &responses, &result, &sig_mutex, nettype = core.get_nettype()](
                     const bls_response& response, const std::vector<std::string>& data) {
+                std::lock_guard lock{sig_mutex};
                 bls_rewards_response rewards_response = {};
                 if (!response.success || data.size() != 2 || data[0] != "200") {
                     agg_log_lister.error.emplace_back(
@@ -759,26 +858,12 @@ bls_rewards_response bls_aggregator::rewards_request(const address& addr, uint64
                     return;
                 }
 
-                if (!eth::verify(
-                            nettype,
-                            rewards_response.signature,
-                            response.sn.bls_pubkey,
-                            result.msg_to_sign)) {
-                    agg_log_lister.error.emplace_back(response.sn, "Invalid BLS signature");
-                    return;
-                }
-
-                // NOTE: Aggregate parameters
-                {
-                    std::lock_guard lock{sig_mutex};
-                    agg_sig.add(rewards_response.signature);
-                    result.signers_bls_pubkeys.push_back(response.sn.bls_pubkey);
-                }
-
-                agg_log_lister.success.emplace_back(
-                        response.sn, "Success, sig: {}"_format(rewards_response.signature));
+                responses.push_back({response.sn, rewards_response.signature});
             });
 
+    eth::signature_aggregator agg_sig;
+    aggregate_signatures(
+            core.get_nettype(), result.msg_to_sign, responses, agg_sig, result, agg_log_lister);
     result.signature = agg_sig.get();
 
     // NOTE: Dump the aggregate pubkey and other info that was generated
@@ -795,8 +880,14 @@ bls_rewards_response bls_aggregator::rewards_request(const address& addr, uint64
     // constitute a valid signature.
     uint64_t non_signers_count = total_requests - result.signers_bls_pubkeys.size();
     if (non_signers_count <= contract::rewards_bls_non_signer_threshold(total_requests)) {
-        std::lock_guard lock{rewards_response_cache_mutex};
+        std::unique_lock lock{rewards_response_cache_mutex};
         rewards_response_cache[addr] = result;
+        store_cached_signature(
+                cryptonote::bls_signature_type::rewards,
+                tools::view_guts(addr),
+                result,
+                result.height,
+                result.amount);
     }
 
     return result;
@@ -874,8 +965,31 @@ bls_exit_liquidation_response bls_aggregator::exit_liquidation_request(
     }
 
     // NOTE: Serve the response from our cache if it's a repeated request
+    const auto cache_type = type == bls_exit_type::normal
+                                  ? cryptonote::bls_signature_type::exit
+                                  : cryptonote::bls_signature_type::liquidation;
+    bool in_memory;
     {
-        std::lock_guard lock{exit_liquidation_response_cache_mutex};
+        std::shared_lock lock{exit_liquidation_response_cache_mutex};
+        in_memory = exit_liquidation_response_cache.count(bls_pubkey);
+    }
+    if (!in_memory) {
+        // We might still have it in the database from before a restart
+        if (auto cached = core.blockchain.sqlite_db().get_bls_signature(
+                    cache_type, tools::view_guts(bls_pubkey))) {
+            bls_exit_liquidation_response response;
+            response.type = type;
+            response.remove_pubkey = bls_pubkey;
+            response.timestamp = cached->height;
+            response.msg_to_sign = std::move(cached->msg_to_sign);
+            response.signers_bls_pubkeys = std::move(cached->signers);
+            response.signature = cached->signature;
+            std::unique_lock lock{exit_liquidation_response_cache_mutex};
+            exit_liquidation_response_cache.try_emplace(bls_pubkey, std::move(response));
+        }
+    }
+    {
+        std::shared_lock lock{exit_liquidation_response_cache_mutex};
         auto it = exit_liquidation_response_cache.find(bls_pubkey);
         if (it != exit_liquidation_response_cache.end()) {
             const bls_exit_liquidation_response& response = it->second;
@@ -929,7 +1043,7 @@ bls_exit_liquidation_response bls_aggregator::exit_liquidation_request(
             get_exit_msg_to_sign(core.get_nettype(), type, bls_pubkey, result.timestamp);
 
     std::mutex signers_mutex;
-    eth::signature_aggregator agg_sig;
+    std::vector<signed_response> responses;
 
     oxenc::bt_dict_producer message_dict;
     message_dict.append("bls_pubkey", tools::view_guts(bls_pubkey));
@@ -940,8 +1054,9 @@ bls_exit_liquidation_response bls_aggregator::exit_liquidation_request(
     uint64_t total_requests = nodes_request(
             endpoint,
             std::move(message_dict).str(),
-            [&agg_log_lister, &agg_sig, &result, &signers_mutex, nettype = core.get_nettype()](
+            [&agg_log_lister, &responses, &result, &signers_mutex](
                     const bls_response& response, const std::vector<std::string>& data) {
+                std::lock_guard lock{signers_mutex};
                 bls_exit_liquidation_response exit_response = {};
                 if (!response.success || data.size() != 2 || data[0] != "200")
                     throw oxen::traced<std::runtime_error>{
@@ -985,26 +1100,12 @@ bls_exit_liquidation_response bls_aggregator::exit_liquidation_request(
                     return;
                 }
 
-                if (!eth::verify(
-                            nettype,
-                            exit_response.signature,
-                            response.sn.bls_pubkey,
-                            result.msg_to_sign)) {
-                    agg_log_lister.error.emplace_back(response.sn, "Invalid BLS signature");
-                    return;
-                }
-
-                // NOTE: Aggregate parameters
-                {
-                    std::lock_guard<std::mutex> lock(signers_mutex);
-                    agg_sig.add(exit_response.signature);
-                    result.signers_bls_pubkeys.push_back(response.sn.bls_pubkey);
-                }
-
-                agg_log_lister.success.emplace_back(
-                        response.sn, "Success, sig: {}"_format(exit_response.signature));
+                responses.push_back({response.sn, exit_response.signature});
             });
 
+    eth::signature_aggregator agg_sig;
+    aggregate_signatures(
+            core.get_nettype(), result.msg_to_sign, responses, agg_sig, result, agg_log_lister);
     result.signature = agg_sig.get();
 
     // NOTE: Dump the aggregate pubkey and other info that was generated
@@ -1021,8 +1122,9 @@ bls_exit_liquidation_response bls_aggregator::exit_liquidation_request(
     // constitute a valid signature.
     uint64_t non_signers_count = total_requests - result.signers_bls_pubkeys.size();
     if (non_signers_count <= contract::rewards_bls_non_signer_threshold(total_requests)) {
-        std::lock_guard lock{exit_liquidation_response_cache_mutex};
+        std::unique_lock lock{exit_liquidation_response_cache_mutex};
         exit_liquidation_response_cache[bls_pubkey] = result;
+        store_cached_signature(cache_type, tools::view_guts(bls_pubkey), result, result.timestamp);
     }
 
     return result;
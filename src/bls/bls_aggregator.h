@@ -4,13 +4,21 @@
 #include <crypto/crypto.h>
 #include <cryptonote_core/service_node_list.h>
 
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace oxenmq {
 class OxenMq;
 }
 
+namespace cryptonote {
+enum class bls_signature_type : int;
+}
+
 namespace eth {
 struct bls_aggregate_signed {
     std::vector<uint8_t> msg_to_sign;
@@ -90,16 +98,39 @@ class bls_aggregator {
             std::string_view message,
             const request_callback& callback);
 
+    // Saves an aggregate signature that was just added to one of the response caches to the
+    // database, so that it can still be served after a restart.
+    void store_cached_signature(
+            cryptonote::bls_signature_type type,
+            std::string_view id,
+            const bls_aggregate_signed& response,
+            uint64_t height,
+            uint64_t amount = 0);
+
+    // Returns the timeout to use for a request to the node with the given x25519 pubkey, based on
+    // the round-trip times recorded for it.
+    std::chrono::milliseconds node_request_timeout(const crypto::x25519_public_key& xpk);
+
+    // Records the time a node took to respond to (or time out on) a request.
+    void record_node_rtt(const crypto::x25519_public_key& xpk, std::chrono::milliseconds rtt);
+
     cryptonote::core& core;
 
+    // Moving average of the request round-trip times of each node we've sent requests to, keyed by
+    // x25519 pubkey; see `node_request_timeout`.
+    std::mutex node_rtt_mutex;
+    std::unordered_map<crypto::x25519_public_key, std::chrono::milliseconds> node_rtt;
+
     // The BLS aggregator can be called from multiple threads via the RPC server. Since we have a
     // cache that can be concurrently written to, we guard each cache by a lock
-    std::mutex rewards_response_cache_mutex;
+    std::shared_mutex rewards_response_cache_mutex;
 
     // See `rewards_response_cache_mutex`
-    std::mutex exit_liquidation_response_cache_mutex;
+    std::shared_mutex exit_liquidation_response_cache_mutex;
 
-    // Cache the aggregate signature response for updating rewards to avoid requerying the network
+    // Cache the aggregate signature response for updating rewards to avoid requerying the network.
+    // These caches are also persisted in the SQLite database, from which they get refilled on
+    // demand after a restart.
     std::unordered_map<address, bls_rewards_response> rewards_response_cache;
 
     // The cache for exits and liquidation signature aggregations. See `rewards_response_cache`
@@ -7,7 +7,9 @@
 #include <oxen/log.hpp>
 
 #include "common/bigint.h"
+#include "common/exception.h"
 #include "common/guts.h"
+#include "common/threadpool.h"
 #include "crypto/crypto.h"
 #include "networks.h"
 
@@ -494,6 +496,101 @@ bool verify(
     return false;
 }
 
+namespace {
+
+    // A signature and pubkey from a batch, both already multiplied by the same random scalar
+    struct batch_item {
+        bn256::g1 pubkey;
+        bn256::g2 signature;
+    };
+
+    // Checks that e(G, Σ sig) == e(Σ pubkey, H) over the given items, and if not then recurses
+    // into each half to find the items responsible, setting `valid[index[i]]` for good items.
+    void verify_batch_range(
+            std::span<const batch_item> items,
+            std::span<const size_t> index,
+            const bn256::g2& hash,
+            std::vector<bool>& valid) {
+        std::array<bn256::g1, 2> g1;
+        std::array<bn256::g2, 2> g2;
+        g1[0] = bn256::g1::curve_gen;
+        g1[1] = items[0].pubkey;
+        g2[0] = items[0].signature;
+        for (size_t i = 1; i < items.size(); i++) {
+            g1[1] = g1[1].add(items[i].pubkey);
+            g2[0] = g2[0].add(items[i].signature);
+        }
+        g1[1] = g1[1].neg();
+        g2[1] = hash;
+
+        if (bn256::pairing_check(g1, g2)) {
+            for (auto i : index)
+                valid[i] = true;
+        } else if (items.size() > 1) {
+            const size_t half = items.size() / 2;
+            verify_batch_range(items.first(half), index.first(half), hash, valid);
+            verify_batch_range(items.subspan(half), index.subspan(half), hash, valid);
+        }
+    }
+
+}  // namespace
+
+std::vector<bool> verify_batch(
+        cryptonote::network_type nettype,
+        std::span<const bls_signature> signatures,
+        std::span<const bls_public_key> pubkeys,
+        std::span<const uint8_t> msg,
+        const eth::address* contract_addr) {
+    if (signatures.size() != pubkeys.size())
+        throw oxen::traced<std::invalid_argument>{
+                "verify_batch: signatures and pubkeys must be the same size"};
+
+    std::vector<bool> valid(signatures.size(), false);
+    if (signatures.empty())
+        return valid;
+
+    // Each signature/pubkey pair gets multiplied by its own random 128-bit scalar so that invalid
+    // signatures can't be constructed to cancel each other out in the sum.
+    std::vector<batch_item> items(signatures.size());
+    std::vector<char> parsed(signatures.size(), false);
+    auto prepare = [&](size_t i) {
+        auto& item = items[i];
+        if (auto ec = item.pubkey.unmarshal(tools::span_guts(pubkeys[i])); ec != std::error_code{})
+            return;
+        auto sig_swapped = swap_xy(tools::span_guts(signatures[i]));
+        if (auto ec = item.signature.unmarshal(sig_swapped); ec != std::error_code{})
+            return;
+        std::array<uint64_t, 4> r{};
+        do {
+            crypto::rand(2 * sizeof(uint64_t), reinterpret_cast<uint8_t*>(r.data()));
+        } while (r[0] == 0 && r[1] == 0);
+        item.pubkey = item.pubkey.scalar_mult(r);
+        item.signature = item.signature.scalar_mult(r);
+        parsed[i] = true;
+    };
+
+    tools::threadpool::getInstance().parallel_for(0, items.size(), prepare, 1, "bls_batch_prepare");
+
+    // Unparseable pubkeys or signatures are simply invalid; drop them from the batch
+    std::vector<size_t> index;
+    index.reserve(items.size());
+    for (size_t i = 0, j = 0; i < items.size(); i++) {
+        if (!parsed[i]) {
+            log::debug(logcat, "BLS batch verification: invalid pubkey or signature at {}", i);
+            continue;
+        }
+        if (j != i)
+            items[j] = std::move(items[i]);
+        index.push_back(i);
+        j++;
+    }
+    items.resize(index.size());
+
+    if (!items.empty())
+        verify_batch_range(items, index, signed_g2_base(msg, nettype, contract_addr), valid);
+    return valid;
+}
+
 bls_signature proof_of_possession(
         cryptonote::network_type nettype,
         const eth::address& operator_addr,
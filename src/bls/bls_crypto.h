@@ -5,6 +5,8 @@
 #include <cryptonote_config.h>
 
 #include <iterator>
+#include <span>
+#include <vector>
 
 namespace bn256 {
 class g1;
@@ -49,6 +51,20 @@ bool verify(
         std::span<const uint8_t> msg,
         const eth::address* contract_addr = nullptr);
 
+/// Verifies many BLS signatures of the same `msg` on `nettype`, where `signatures[i]` was allegedly
+/// signed by `pubkeys[i]`.  Returns a vector with an element for each signature that is true if
+/// and only if that signature is valid, i.e. the same as calling `verify()` on each one.
+///
+/// This is much faster than doing that, though: the message only gets hashed to G2 once, and the
+/// signatures are checked together with a single pairing check of a random linear combination of
+/// them, repeatedly splitting the batch in halves to find the bad ones if that check fails.
+std::vector<bool> verify_batch(
+        cryptonote::network_type nettype,
+        std::span<const bls_signature> signatures,
+        std::span<const bls_public_key> pubkeys,
+        std::span<const uint8_t> msg,
+        const eth::address* contract_addr = nullptr);
+
 /// Constructs a keccak 32-byte hash of `baseTag` on network `nettype`.  This tag is used for domain
 /// separation of different signature types and networks, and typically is called automatically by
 /// the above functions.  The pointer to the contract address can be used to override the contract
@@ -33,6 +33,7 @@
 
 #include <fmt/std.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "blockchain_db/blockchain_db.h"
@@ -49,7 +50,8 @@ namespace cryptonote {
 
 static auto logcat = log::Cat("checkpoints");
 
-bool checkpoint_t::check(crypto::hash const& hash) const {
+static bool check_hash(
+        uint64_t height, const crypto::hash& block_hash, const crypto::hash& hash) {
     bool result = block_hash == hash;
     if (result)
         log::info(logcat, "CHECKPOINT PASSED FOR HEIGHT {} {}", height, block_hash);
@@ -61,6 +63,10 @@ bool checkpoint_t::check(crypto::hash const& hash) const {
                 block_hash,
                 hash);
     return result;
+}
+
+bool checkpoint_t::check(crypto::hash const& hash) const {
+    return check_hash(height, block_hash, hash);
 };
 
 height_to_hash const HARDCODED_MAINNET_CHECKPOINTS[] = {
@@ -111,7 +117,66 @@ bool load_checkpoints_from_json(
     return true;
 }
 
+const checkpoints::checkpoint_entry* checkpoints::find(uint64_t height) const {
+    auto it = std::lower_bound(
+            m_index.begin(), m_index.end(), height, [](const checkpoint_entry& e, uint64_t h) {
+                return e.height < h;
+            });
+    return it != m_index.end() && it->height == height ? &*it : nullptr;
+}
+//---------------------------------------------------------------------------
+const checkpoints::checkpoint_entry* checkpoints::immutable_checkpoint(
+        uint64_t block_height) const {
+    static_assert(
+            service_nodes::CHECKPOINT_NUM_CHECKPOINTS_FOR_CHAIN_FINALITY == 2,
+            "Expect checkpoint finality to be 2, otherwise the immutable logic needs to check for "
+            "any hardcoded checkpoints inbetween");
+
+    auto it = std::upper_bound(
+            m_index.begin(),
+            m_index.end(),
+            block_height,
+            [](uint64_t h, const checkpoint_entry& e) { return h < e.height; });
+    if (it == m_index.begin())
+        return nullptr;
+    --it;
+    // A hardcoded checkpoint is always immutable; a service node one needs another checkpoint
+    // (of either type) behind it.
+    if (it->type != checkpoint_type::service_node)
+        return &*it;
+    if (it == m_index.begin())
+        return nullptr;
+    return &*std::prev(it);
+}
+//---------------------------------------------------------------------------
+void checkpoints::index_add(const checkpoint_t& checkpoint) {
+    auto it = std::lower_bound(
+            m_index.begin(),
+            m_index.end(),
+            checkpoint.height,
+            [](const checkpoint_entry& e, uint64_t h) { return e.height < h; });
+    if (it != m_index.end() && it->height == checkpoint.height)
+        *it = {checkpoint.height, checkpoint.block_hash, checkpoint.type};
+    else
+        m_index.insert(it, {checkpoint.height, checkpoint.block_hash, checkpoint.type});
+}
+//---------------------------------------------------------------------------
+void checkpoints::index_remove(uint64_t height) {
+    if (auto* entry = find(height))
+        m_index.erase(m_index.begin() + (entry - m_index.data()));
+}
+//---------------------------------------------------------------------------
+void checkpoints::reload() {
+    m_index.clear();
+    auto guard = db_rtxn_guard{*m_db};
+    for (const auto& checkpoint : m_db->get_checkpoints_range(0, UINT64_MAX))
+        index_add(checkpoint);
+    log::debug(logcat, "Loaded {} checkpoints from the db", m_index.size());
+}
+//---------------------------------------------------------------------------
 bool checkpoints::get_checkpoint(uint64_t height, checkpoint_t& checkpoint) const {
+    if (!find(height))
+        return false;
     try {
         auto guard = db_rtxn_guard{*m_db};
         return m_db->get_block_checkpoint(height, checkpoint);
@@ -131,15 +196,14 @@ bool checkpoints::add_checkpoint(uint64_t height, const std::string& hash_str) {
     CHECK_AND_ASSERT_MES(
             r, false, "Failed to parse checkpoint hash string into binary representation!");
 
-    checkpoint_t checkpoint = {};
-    if (get_checkpoint(height, checkpoint)) {
-        crypto::hash const& curr_hash = checkpoint.block_hash;
+    if (auto* existing = find(height)) {
         CHECK_AND_ASSERT_MES(
-                h == curr_hash,
+                h == existing->block_hash,
                 false,
                 "Checkpoint at given height already exists, and hash for new checkpoint was "
                 "different!");
     } else {
+        checkpoint_t checkpoint = {};
         checkpoint.type = checkpoint_type::hardcoded;
         checkpoint.height = height;
         checkpoint.block_hash = h;
@@ -155,6 +219,7 @@ bool checkpoints::update_checkpoint(checkpoint_t const& checkpoint) {
     try {
         batch_started = m_db->batch_start();
         m_db->update_block_checkpoint(checkpoint);
+        index_add(checkpoint);
     } catch (const std::exception& e) {
         log::error(
                 logcat,
@@ -177,11 +242,8 @@ void checkpoints::block_add(const block_add_info& info) {
         return;
 
     uint64_t end_cull_height = 0;
-    {
-        checkpoint_t immutable_checkpoint;
-        if (m_db->get_immutable_checkpoint(&immutable_checkpoint, height + 1))
-            end_cull_height = immutable_checkpoint.height;
-    }
+    if (auto* immutable = immutable_checkpoint(height + 1))
+        end_cull_height = immutable->height;
     uint64_t start_cull_height =
             (end_cull_height < service_nodes::CHECKPOINT_STORE_PERSISTENTLY_INTERVAL)
                     ? 0
@@ -196,11 +258,13 @@ void checkpoints::block_add(const block_add_info& info) {
     auto guard = db_wtxn_guard{*m_db};
     for (; m_last_cull_height < end_cull_height;
          m_last_cull_height += service_nodes::CHECKPOINT_INTERVAL) {
-        if (m_last_cull_height % service_nodes::CHECKPOINT_STORE_PERSISTENTLY_INTERVAL == 0)
+        if (m_last_cull_height % service_nodes::CHECKPOINT_STORE_PERSISTENTLY_INTERVAL == 0 ||
+            !find(m_last_cull_height))
             continue;
 
         try {
             m_db->remove_block_checkpoint(m_last_cull_height);
+            index_remove(m_last_cull_height);
         } catch (const std::exception& e) {
             log::error(
                     logcat,
@@ -217,35 +281,34 @@ void checkpoints::block_add(const block_add_info& info) {
 //---------------------------------------------------------------------------
 void checkpoints::blockchain_detached(uint64_t height) {
     m_last_cull_height = std::min(m_last_cull_height, height);
+    if (m_index.empty() || m_index.back().height < height)
+        return;
 
-    checkpoint_t top_checkpoint;
+    // Remove the checkpoints at the top checkpoint's height and every checkpoint interval below it
+    // down to the detach height.
+    uint64_t const top_height = m_index.back().height;
     auto guard = db_wtxn_guard{*m_db};
-    if (m_db->get_top_checkpoint(top_checkpoint)) {
-        uint64_t start_height = top_checkpoint.height;
-        for (size_t delete_height = start_height;
-             delete_height >= height && delete_height >= service_nodes::CHECKPOINT_INTERVAL;
-             delete_height -= service_nodes::CHECKPOINT_INTERVAL) {
-            try {
-                m_db->remove_block_checkpoint(delete_height);
-            } catch (const std::exception& e) {
-                log::error(
-                        logcat,
-                        "Remove block checkpoint on detach failed non-trivially at height: {}, "
-                        "what = {}",
-                        delete_height,
-                        e.what());
-            }
+    for (size_t i = m_index.size(); i > 0 && m_index[i - 1].height >= height; i--) {
+        uint64_t const delete_height = m_index[i - 1].height;
+        if (delete_height < service_nodes::CHECKPOINT_INTERVAL ||
+            (top_height - delete_height) % service_nodes::CHECKPOINT_INTERVAL != 0)
+            continue;
+        try {
+            m_db->remove_block_checkpoint(delete_height);
+            m_index.erase(m_index.begin() + (i - 1));
+        } catch (const std::exception& e) {
+            log::error(
+                    logcat,
+                    "Remove block checkpoint on detach failed non-trivially at height: {}, "
+                    "what = {}",
+                    delete_height,
+                    e.what());
         }
     }
 }
 //---------------------------------------------------------------------------
 bool checkpoints::is_in_checkpoint_zone(uint64_t height) const {
-    uint64_t top_checkpoint_height = 0;
-    checkpoint_t top_checkpoint;
-    if (m_db->get_top_checkpoint(top_checkpoint))
-        top_checkpoint_height = top_checkpoint.height;
-
-    return height <= top_checkpoint_height;
+    return height <= get_max_height();
 }
 //---------------------------------------------------------------------------
 bool checkpoints::check_block(
@@ -253,19 +316,18 @@ bool checkpoints::check_block(
         const crypto::hash& h,
         bool* is_a_checkpoint,
         bool* service_node_checkpoint) const {
-    checkpoint_t checkpoint;
-    bool found = get_checkpoint(height, checkpoint);
+    auto* checkpoint = find(height);
     if (is_a_checkpoint)
-        *is_a_checkpoint = found;
+        *is_a_checkpoint = checkpoint != nullptr;
     if (service_node_checkpoint)
         *service_node_checkpoint = false;
 
-    if (!found)
+    if (!checkpoint)
         return true;
 
-    bool result = checkpoint.check(h);
+    bool result = check_hash(height, checkpoint->block_hash, h);
     if (service_node_checkpoint)
-        *service_node_checkpoint = (checkpoint.type == checkpoint_type::service_node);
+        *service_node_checkpoint = (checkpoint->type == checkpoint_type::service_node);
 
     return result;
 }
@@ -278,19 +340,14 @@ bool checkpoints::is_alternative_block_allowed(
     if (0 == block_height)
         return false;
 
-    {
-        std::vector<checkpoint_t> const first_checkpoint =
-                m_db->get_checkpoints_range(0, blockchain_height, 1);
-        if (first_checkpoint.empty() || blockchain_height < first_checkpoint[0].height)
-            return true;
-    }
+    if (m_index.empty() || blockchain_height < m_index.front().height)
+        return true;
 
-    checkpoint_t immutable_checkpoint;
     uint64_t immutable_height = 0;
-    if (m_db->get_immutable_checkpoint(&immutable_checkpoint, blockchain_height)) {
-        immutable_height = immutable_checkpoint.height;
+    if (auto* immutable = immutable_checkpoint(blockchain_height)) {
+        immutable_height = immutable->height;
         if (service_node_checkpoint)
-            *service_node_checkpoint = (immutable_checkpoint.type == checkpoint_type::service_node);
+            *service_node_checkpoint = (immutable->type == checkpoint_type::service_node);
     }
 
     m_immutable_height = std::max(immutable_height, m_immutable_height);
@@ -299,18 +356,14 @@ bool checkpoints::is_alternative_block_allowed(
 }
 //---------------------------------------------------------------------------
 uint64_t checkpoints::get_max_height() const {
-    uint64_t result = 0;
-    checkpoint_t top_checkpoint;
-    if (m_db->get_top_checkpoint(top_checkpoint))
-        result = top_checkpoint.height;
-
-    return result;
+    return m_index.empty() ? 0 : m_index.back().height;
 }
 //---------------------------------------------------------------------------
 bool checkpoints::init(network_type nettype, BlockchainDB* db) {
     *this = {};
     m_db = db;
     m_nettype = nettype;
+    reload();
 
     if (db->is_read_only())
         return true;
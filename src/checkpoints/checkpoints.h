@@ -110,6 +110,14 @@ class checkpoints {
     void block_add(const block_add_info& info);
     void blockchain_detached(uint64_t height);
 
+    /**
+     * @brief gets the full checkpoint (including any service node signatures) at a height
+     *
+     * Heights without a checkpoint are answered from memory; the checkpoint itself is loaded from
+     * the db.
+     *
+     * @return true if there is a checkpoint at the height, and it could be loaded
+     */
     bool get_checkpoint(uint64_t height, checkpoint_t& checkpoint) const;
     /**
      * @brief adds a checkpoint to the container
@@ -196,7 +204,35 @@ class checkpoints {
      */
     bool init(network_type nettype, class BlockchainDB* db);
 
+    /**
+     * @brief reloads the in-memory checkpoint heights from the db
+     *
+     * Checkpoints are only read from the db at init, and are then kept in sync by the changes
+     * made through this class; this is needed if the db's checkpoints get changed some other way
+     * (e.g. by a db reset).
+     */
+    void reload();
+
   private:
+    /// What we keep in memory of each checkpoint in the db: everything but the signatures, which
+    /// are only needed when a full checkpoint is requested.
+    struct checkpoint_entry {
+        uint64_t height;
+        crypto::hash block_hash;
+        checkpoint_type type;
+    };
+
+    /// Returns the checkpoint at exactly `height`, or nullptr if there isn't one
+    const checkpoint_entry* find(uint64_t height) const;
+
+    /// Returns the newest checkpoint at or below `block_height` that can no longer be overridden,
+    /// or nullptr if there isn't one; see BlockchainDB::get_immutable_checkpoint.
+    const checkpoint_entry* immutable_checkpoint(uint64_t block_height) const;
+
+    void index_add(const checkpoint_t& checkpoint);
+    void index_remove(uint64_t height);
+
+    std::vector<checkpoint_entry> m_index;  // Sorted by height
     network_type m_nettype = network_type::UNDEFINED;
     uint64_t m_last_cull_height = 0;
     uint64_t m_immutable_height = 0;
@@ -0,0 +1,182 @@
+#include "alloc_profile.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace tools::alloc_profile {
+
+namespace {
+
+    struct counters {
+        std::atomic<int64_t> live_bytes{0};
+        std::atomic<int64_t> live_allocs{0};
+        std::atomic<uint64_t> allocs{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    // Constant-initialized, so usable from allocations made during static initialization
+    constinit std::array<counters, MAX_TAGS> tag_counters{};
+
+    std::mutex tags_mutex;
+    // Tag names by index; written only under tags_mutex, and only by appending
+    std::array<std::string, MAX_TAGS>& tag_names() {
+        static std::array<std::string, MAX_TAGS> names{"other"};
+        return names;
+    }
+    std::atomic<size_t> tag_count{1};
+
+    // The totals as of the previous stats() call, for the rates; guarded by tags_mutex
+    std::chrono::steady_clock::time_point last_sample = std::chrono::steady_clock::now();
+    std::array<std::pair<uint64_t, uint64_t>, MAX_TAGS> last_totals{};
+
+}  // namespace
+
+constinit thread_local uint8_t detail::current = 0;
+
+uint8_t detail::register_tag(std::string_view name) {
+    std::lock_guard lock{tags_mutex};
+    auto& names = tag_names();
+    size_t count = tag_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++)
+        if (names[i] == name)
+            return i;
+    if (count == MAX_TAGS)
+        return 0;
+    names[count] = name;
+    tag_count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+bool compiled() {
+#ifdef OXEN_ALLOC_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::vector<tag_stats> stats() {
+    std::vector<tag_stats> result;
+    if (!compiled())
+        return result;
+    std::lock_guard lock{tags_mutex};
+    auto& names = tag_names();
+    size_t count = tag_count.load(std::memory_order_acquire);
+    result.reserve(count);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::max(std::chrono::duration<double>(now - last_sample).count(), 1e-9);
+    last_sample = now;
+    for (size_t i = 0; i < count; i++) {
+        auto& c = tag_counters[i];
+        auto& [last_allocs, last_bytes] = last_totals[i];
+        auto& s = result.emplace_back();
+        s.name = names[i];
+        s.live_bytes = c.live_bytes.load(std::memory_order_relaxed);
+        s.live_allocs = c.live_allocs.load(std::memory_order_relaxed);
+        s.allocs = c.allocs.load(std::memory_order_relaxed);
+        s.bytes = c.bytes.load(std::memory_order_relaxed);
+        s.alloc_rate = (s.allocs - last_allocs) / elapsed;
+        s.byte_rate = (s.bytes - last_bytes) / elapsed;
+        last_allocs = s.allocs;
+        last_bytes = s.bytes;
+    }
+    return result;
+}
+
+#ifdef OXEN_ALLOC_PROFILING
+namespace {
+
+    // Each allocation is preceded by a header recording its size and tag, padded to keep the
+    // allocation aligned; the header is at the end of the padding, just before the allocation.
+    struct header {
+        size_t size;
+        uint8_t tag;
+    };
+    constexpr size_t DEFAULT_PADDING = alignof(std::max_align_t);
+    static_assert(sizeof(header) <= DEFAULT_PADDING);
+
+    constexpr size_t padding(size_t align) {
+        return std::max(DEFAULT_PADDING, align);
+    }
+
+    void* malloc_aligned(size_t size, size_t align) {
+        if (align <= DEFAULT_PADDING)
+            return std::malloc(size);
+#ifdef _WIN32
+        return _aligned_malloc(size, align);
+#else
+        return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+    }
+
+    void free_aligned(void* base, size_t align) {
+#ifdef _WIN32
+        if (align > DEFAULT_PADDING)
+            return _aligned_free(base);
+#endif
+        std::free(base);
+    }
+
+    void* allocate(size_t size, size_t align) {
+        const size_t pad = padding(align);
+        for (;;) {
+            if (void* base = malloc_aligned(pad + size, align)) {
+                auto* p = static_cast<char*>(base) + pad;
+                auto tag = detail::current;
+                new (p - sizeof(header)) header{size, tag};
+                auto& c = tag_counters[tag];
+                c.live_bytes.fetch_add(size, std::memory_order_relaxed);
+                c.live_allocs.fetch_add(1, std::memory_order_relaxed);
+                c.allocs.fetch_add(1, std::memory_order_relaxed);
+                c.bytes.fetch_add(size, std::memory_order_relaxed);
+                return p;
+            }
+            auto handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc{};
+            handler();
+        }
+    }
+
+    void deallocate(void* ptr, size_t align) noexcept {
+        if (!ptr)
+            return;
+        auto* p = static_cast<char*>(ptr);
+        auto* h = reinterpret_cast<header*>(p - sizeof(header));
+        auto& c = tag_counters[h->tag];
+        c.live_bytes.fetch_sub(h->size, std::memory_order_relaxed);
+        c.live_allocs.fetch_sub(1, std::memory_order_relaxed);
+        free_aligned(p - padding(align), align);
+    }
+
+}  // namespace
+#endif
+
+}  // namespace tools::alloc_profile
+
+#ifdef OXEN_ALLOC_PROFILING
+// The remaining replaceable forms (array, nothrow and sized) are implemented by the standard
+// library in terms of these.
+void* operator new(std::size_t size) {
+    return tools::alloc_profile::allocate(size, 0);
+}
+void* operator new(std::size_t size, std::align_val_t align) {
+    return tools::alloc_profile::allocate(size, static_cast<size_t>(align));
+}
+void operator delete(void* ptr) noexcept {
+    tools::alloc_profile::deallocate(ptr, 0);
+}
+void operator delete(void* ptr, std::align_val_t align) noexcept {
+    tools::alloc_profile::deallocate(ptr, static_cast<size_t>(align));
+}
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Heap allocation profiling by subsystem, for attributing memory growth.  When built with
+/// -DENABLE_ALLOC_PROFILING=ON the global operator new and delete are replaced with versions that
+/// count each allocation against the tag of the innermost OXEN_ALLOC_SCOPE active on the allocating
+/// thread (or "other", outside of any scope), and count its release against that same tag, so that
+/// a tag's live bytes are the memory still held from allocations made under it.  This adds a header
+/// and a few atomic operations to every allocation, so it is off by default; without it the scopes
+/// compile to nothing and stats() is empty.
+namespace tools::alloc_profile {
+
+/// The maximum number of distinct tags, including "other"; scopes beyond that count as "other".
+inline constexpr size_t MAX_TAGS = 64;
+
+struct tag_stats {
+    std::string name;
+    int64_t live_bytes;   // Bytes allocated and not yet freed
+    int64_t live_allocs;  // Allocations not yet freed
+    uint64_t allocs;      // Allocations made, ever
+    uint64_t bytes;       // Bytes allocated, ever
+    double alloc_rate;    // Allocations per second since the previous stats() call
+    double byte_rate;     // Bytes allocated per second since the previous stats() call
+};
+
+/// True if the build has allocation profiling compiled in.
+bool compiled();
+
+/// Returns the current counts of every registered tag, with allocation rates over the time since
+/// the previous call (or since startup, for the first call).
+std::vector<tag_stats> stats();
+
+namespace detail {
+    extern constinit thread_local uint8_t current;
+
+    /// Returns the index of the tag called `name`, registering it if new.
+    uint8_t register_tag(std::string_view name);
+}  // namespace detail
+
+/// Counts the allocations made by the current thread while it exists against `tag`.
+class scope {
+  public:
+    explicit scope(uint8_t tag) : m_prev{detail::current} { detail::current = tag; }
+    ~scope() { detail::current = m_prev; }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+  private:
+    uint8_t m_prev;
+};
+
+}  // namespace tools::alloc_profile
+
+#ifdef OXEN_ALLOC_PROFILING
+#define OXEN_ALLOC_CONCAT_(a, b) a##b
+#define OXEN_ALLOC_CONCAT(a, b) OXEN_ALLOC_CONCAT_(a, b)
+/// Counts the allocations made in the rest of the enclosing scope against the tag `name`.
+#define OXEN_ALLOC_SCOPE(name)                                                           \
+    static const uint8_t OXEN_ALLOC_CONCAT(oxen_alloc_tag_, __LINE__) =                  \
+            ::tools::alloc_profile::detail::register_tag(name);                          \
+    ::tools::alloc_profile::scope OXEN_ALLOC_CONCAT(oxen_alloc_scope_, __LINE__) {       \
+        OXEN_ALLOC_CONCAT(oxen_alloc_tag_, __LINE__)                                     \
+    }
+#else
+#define OXEN_ALLOC_SCOPE(name) static_cast<void>(0)
+#endif
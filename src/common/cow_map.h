@@ -0,0 +1,222 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace tools {
+
+/// An unordered map split into a fixed number of shards which are shared between copies of the map
+/// and only duplicated when modified.  Copying the map copies just the shard pointers, and
+/// modifying a copy duplicates only the shard holding the modified key (on average 1/Shards of the
+/// map) rather than everything.  This suits data that is snapshotted far more often than it
+/// changes, such as the service node state kept for each recent block.
+///
+/// The interface is a subset of std::unordered_map's, except that iterators are always const:
+/// values can only be changed through operator[], modify(), emplace() and erase(), which unshare
+/// the affected shard first.  Iteration order is unspecified, as with std::unordered_map.
+///
+/// Like the standard containers this is not internally synchronized: concurrent reads (including
+/// copying) are fine, but modifying a map requires that nothing else is accessing that same map.
+template <typename Key, typename T, typename Hash = std::hash<Key>, size_t Shards = 64>
+class cow_unordered_map {
+    static_assert(Shards > 0 && std::has_single_bit(Shards), "Shards must be a power of 2");
+
+    using shard_t = std::unordered_map<Key, T, Hash>;
+
+  public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = typename shard_t::value_type;
+    using size_type = size_t;
+
+    class const_iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename shard_t::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *m_it; }
+        pointer operator->() const { return &*m_it; }
+
+        const_iterator& operator++() {
+            ++m_it;
+            skip_empty();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a.m_shard == b.m_shard && (a.m_shard == Shards || a.m_it == b.m_it);
+        }
+
+      private:
+        friend class cow_unordered_map;
+
+        const cow_unordered_map* m_map = nullptr;
+        size_t m_shard = Shards;
+        typename shard_t::const_iterator m_it{};
+
+        const_iterator(
+                const cow_unordered_map* map, size_t shard, typename shard_t::const_iterator it) :
+                m_map{map}, m_shard{shard}, m_it{it} {
+            skip_empty();
+        }
+
+        // Advances past the end of the current shard (and any empty ones after it)
+        void skip_empty() {
+            while (m_shard < Shards && m_it == m_map->shard(m_shard).end())
+                if (++m_shard < Shards)
+                    m_it = m_map->shard(m_shard).begin();
+        }
+    };
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return {this, 0, shard(0).begin()}; }
+    const_iterator end() const { return {}; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const_iterator find(const Key& key) const {
+        auto i = shard_index(key);
+        const auto& s = shard(i);
+        auto it = s.find(key);
+        return it == s.end() ? end() : const_iterator{this, i, it};
+    }
+    size_t count(const Key& key) const { return shard(shard_index(key)).count(key); }
+    bool contains(const Key& key) const { return count(key); }
+
+    const T& at(const Key& key) const {
+        auto it = find(key);
+        if (it == end())
+            throw std::out_of_range{"cow_unordered_map::at: key not found"};
+        return it->second;
+    }
+
+    /// Returns a mutable reference to the value for `key`, default-constructing it if not present.
+    T& operator[](const Key& key) {
+        auto [it, inserted] = mutable_shard(shard_index(key)).try_emplace(key);
+        m_size += inserted;
+        return it->second;
+    }
+
+    /// Returns a mutable reference to the value `it` points at.  `it` is updated to remain valid;
+    /// any other iterators into the same shard may be invalidated.
+    T& modify(const_iterator& it) {
+        assert(it.m_map == this && it != end());
+        auto& s = mutable_shard(it.m_shard);
+        auto mit = s.find(it.m_it->first);
+        it.m_it = mit;
+        return mit->second;
+    }
+
+    /// Inserts a value for `key` constructed from `args` if `key` is not already present.
+    template <typename K, typename... Args>
+    std::pair<const_iterator, bool> emplace(K&& key, Args&&... args) {
+        auto i = shard_index(key);
+        auto [it, inserted] =
+                mutable_shard(i).try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+        m_size += inserted;
+        return {const_iterator{this, i, it}, inserted};
+    }
+
+    /// Erases the element at `it`, returning an iterator to the element after it.
+    const_iterator erase(const_iterator it) {
+        assert(it.m_map == this && it != end());
+        auto i = it.m_shard;
+        auto& s = mutable_shard(i);
+        auto next = s.erase(s.find(it.m_it->first));
+        m_size--;
+        return {this, i, next};
+    }
+    size_t erase(const Key& key) {
+        auto i = shard_index(key);
+        if (!shard(i).count(key))
+            return 0;
+        mutable_shard(i).erase(key);
+        m_size--;
+        return 1;
+    }
+
+    void clear() {
+        m_shards = {};
+        m_size = 0;
+    }
+
+    /// Returns true if this map and `other` still share all of their shards, i.e. one is an
+    /// unmodified copy of the other.  This only compares the shard pointers, so a false result does
+    /// not imply that the contents differ.
+    bool shares_all(const cow_unordered_map& other) const { return m_shards == other.m_shards; }
+
+    /// Calls `changed(key, value)` for each element of this map whose key is missing from `other`
+    /// or has a value there that compares unequal, and `removed(key)` for each key of `other` that
+    /// is not in this map.  Shards that the two maps still share are skipped without looking at
+    /// them, so diffing against an earlier copy of the same map only costs time proportional to
+    /// the shards modified since the copy.
+    template <typename Changed, typename Removed>
+    void for_each_difference(
+            const cow_unordered_map& other, Changed&& changed, Removed&& removed) const {
+        for (size_t i = 0; i < Shards; i++) {
+            if (m_shards[i] == other.m_shards[i])
+                continue;
+            const auto& mine = shard(i);
+            const auto& theirs = other.shard(i);
+            for (const auto& [key, value] : mine)
+                if (auto it = theirs.find(key); it == theirs.end() || !(it->second == value))
+                    changed(key, value);
+            for (const auto& [key, value] : theirs)
+                if (!mine.count(key))
+                    removed(key);
+        }
+    }
+
+  private:
+    std::array<std::shared_ptr<shard_t>, Shards> m_shards;
+    size_t m_size = 0;
+
+    static size_t shard_index(const Key& key) {
+        if constexpr (Shards == 1)
+            return 0;
+        else {
+            // Fibonacci hashing: mixes weak (e.g. identity) hashes, and taking the top bits keeps
+            // the shard from correlating with the bucket the key lands in within its shard.
+            constexpr size_t golden = sizeof(size_t) >= 8
+                                            ? static_cast<size_t>(0x9E3779B97F4A7C15ULL)
+                                            : static_cast<size_t>(0x9E3779B9UL);
+            return (Hash{}(key) * golden) >>
+                   (std::numeric_limits<size_t>::digits - std::countr_zero(Shards));
+        }
+    }
+
+    const shard_t& shard(size_t i) const {
+        static const shard_t empty_shard;
+        return m_shards[i] ? *m_shards[i] : empty_shard;
+    }
+
+    shard_t& mutable_shard(size_t i) {
+        auto& s = m_shards[i];
+        if (!s)
+            s = std::make_shared<shard_t>();
+        else if (s.use_count() > 1)
+            s = std::make_shared<shard_t>(*s);
+        return *s;
+    }
+};
+
+}  // namespace tools
@@ -0,0 +1,177 @@
+#include "json_writer.h"
+
+#include <oxenc/base64.h>
+#include <oxenc/hex.h>
+
+#include <charconv>
+#include <cstring>
+#include <iterator>
+
+#include "common/exception.h"
+
+namespace tools {
+
+namespace {
+
+    constexpr uint64_t ONES = 0x0101010101010101ULL;
+    constexpr uint64_t HIGH = 0x8080808080808080ULL;
+
+    // True if any of the 8 bytes of `w` is a control character, '"' or '\\', i.e. needs escaping.
+    // This lets us skip over plain text a word at a time rather than checking each byte.
+    constexpr bool needs_escape(uint64_t w) {
+        auto has_zero = [](uint64_t x) { return (x - ONES) & ~x & HIGH; };
+        return ((w - ONES * 0x20) & ~w & HIGH) | has_zero(w ^ (ONES * '"')) |
+               has_zero(w ^ (ONES * '\\'));
+    }
+
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+}  // namespace
+
+void json_writer::separate() {
+    if (!m_first)
+        m_out += ',';
+    m_first = false;
+}
+
+json_writer& json_writer::begin_object() {
+    separate();
+    m_out += '{';
+    m_first = true;
+    return *this;
+}
+
+json_writer& json_writer::end_object() {
+    m_out += '}';
+    m_first = false;
+    return *this;
+}
+
+json_writer& json_writer::begin_array() {
+    separate();
+    m_out += '[';
+    m_first = true;
+    return *this;
+}
+
+json_writer& json_writer::end_array() {
+    m_out += ']';
+    m_first = false;
+    return *this;
+}
+
+json_writer& json_writer::key(std::string_view k) {
+    separate();
+    write_escaped(k);
+    m_out += ':';
+    m_first = true;
+    return *this;
+}
+
+void json_writer::write_escaped(std::string_view s) {
+    m_out.reserve(m_out.size() + s.size() + 2);
+    m_out += '"';
+    size_t copied = 0, i = 0;
+    while (i < s.size()) {
+        if (i + 8 <= s.size()) {
+            uint64_t w;
+            std::memcpy(&w, s.data() + i, 8);
+            if (!needs_escape(w)) {
+                i += 8;
+                continue;
+            }
+        }
+        const auto c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            i++;
+            continue;
+        }
+        m_out.append(s.data() + copied, i - copied);
+        m_out += '\\';
+        switch (c) {
+            case '"': m_out += '"'; break;
+            case '\\': m_out += '\\'; break;
+            case '\b': m_out += 'b'; break;
+            case '\f': m_out += 'f'; break;
+            case '\n': m_out += 'n'; break;
+            case '\r': m_out += 'r'; break;
+            case '\t': m_out += 't'; break;
+            default:
+                m_out += "u00";
+                m_out += hex_digits[c >> 4];
+                m_out += hex_digits[c & 0xf];
+        }
+        copied = ++i;
+    }
+    m_out.append(s.data() + copied, s.size() - copied);
+    m_out += '"';
+}
+
+json_writer& json_writer::value(std::string_view s) {
+    separate();
+    write_escaped(s);
+    return *this;
+}
+
+json_writer& json_writer::value(bool b) {
+    separate();
+    m_out += b ? "true" : "false";
+    return *this;
+}
+
+json_writer& json_writer::value(std::nullptr_t) {
+    separate();
+    m_out += "null";
+    return *this;
+}
+
+json_writer& json_writer::value(const nlohmann::json& j) {
+    separate();
+    m_out += j.dump();
+    return *this;
+}
+
+json_writer& json_writer::write_int(int64_t v) {
+    separate();
+    char buf[20];
+    auto [end, ec] = std::to_chars(std::begin(buf), std::end(buf), v);
+    m_out.append(buf, end);
+    return *this;
+}
+
+json_writer& json_writer::write_uint(uint64_t v) {
+    separate();
+    char buf[20];
+    auto [end, ec] = std::to_chars(std::begin(buf), std::end(buf), v);
+    m_out.append(buf, end);
+    return *this;
+}
+
+json_writer& json_writer::binary(std::string_view data, json_binary_proxy::fmt format) {
+    separate();
+    switch (format) {
+        case json_binary_proxy::fmt::hex:
+            m_out.reserve(m_out.size() + oxenc::to_hex_size(data.size()) + 2);
+            m_out += '"';
+            oxenc::to_hex(data.begin(), data.end(), std::back_inserter(m_out));
+            break;
+        case json_binary_proxy::fmt::base64:
+            m_out.reserve(m_out.size() + (data.size() + 2) / 3 * 4 + 2);
+            m_out += '"';
+            oxenc::to_base64(data.begin(), data.end(), std::back_inserter(m_out));
+            break;
+        default:
+            throw oxen::traced<std::logic_error>{
+                    "Internal error: json can only hold hex or base64 encoded binary values"};
+    }
+    m_out += '"';
+    return *this;
+}
+
+json_writer& json_writer::raw(std::string_view encoded) {
+    separate();
+    m_out += encoded;
+    return *this;
+}
+
+}  // namespace tools
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+
+#include "json_binary_proxy.h"
+
+namespace tools {
+
+/// Writes json directly into a string, for large responses where building a nlohmann::json tree
+/// first and then dumping it costs more than producing the output itself.
+///
+/// Values are written in the order they are given; the writer only inserts the separators, so it
+/// is up to the caller to produce a well-formed document (keys only inside objects, balanced
+/// begin/end calls).  Strings are escaped as nlohmann::json would escape them, except that they
+/// are not checked for valid UTF-8.  Anything else that nlohmann::json can serialize (e.g. via a
+/// `to_json` overload) can be passed to `value()` as well, which converts it through
+/// nlohmann::json.
+///
+///     std::string out;
+///     tools::json_writer w{out};
+///     w.begin_object()
+///             .set("height", 123)
+///             .set_binary("hash", hash, json_binary_proxy::fmt::hex)
+///             .end_object();
+class json_writer {
+  public:
+    explicit json_writer(std::string& out) : m_out{out} {}
+
+    json_writer& begin_object();
+    json_writer& end_object();
+    json_writer& begin_array();
+    json_writer& end_array();
+
+    /// Writes an object key; must be followed by exactly one value (or object/array).
+    json_writer& key(std::string_view k);
+
+    json_writer& value(std::string_view s);
+    json_writer& value(const std::string& s) { return value(std::string_view{s}); }
+    json_writer& value(const char* s) { return value(std::string_view{s}); }
+    json_writer& value(bool b);
+    json_writer& value(std::nullptr_t);
+    json_writer& value(const nlohmann::json& j);
+
+    template <std::integral T>
+        requires(!std::same_as<T, bool>)
+    json_writer& value(T v) {
+        if constexpr (std::is_signed_v<T>)
+            return write_int(static_cast<int64_t>(v));
+        else
+            return write_uint(static_cast<uint64_t>(v));
+    }
+
+    template <typename T>
+        requires(!std::integral<T> && !std::convertible_to<const T&, std::string_view> &&
+                 !binary_json<T> && !binary_json_container<T>)
+    json_writer& value(const T& v) {
+        return value(nlohmann::json(v));
+    }
+
+    /// Writes binary data as a hex or base64 string (`fmt::bt` is not allowed: json can't carry
+    /// raw bytes).  The encoding is done directly into the output.
+    json_writer& binary(std::string_view data, json_binary_proxy::fmt format);
+
+    template <binary_json T>
+    json_writer& binary(const T& val, json_binary_proxy::fmt format) {
+        return binary(std::string_view{reinterpret_cast<const char*>(&val), sizeof(val)}, format);
+    }
+
+    template <binary_json_container T>
+    json_writer& binary(const T& vals, json_binary_proxy::fmt format) {
+        begin_array();
+        for (const auto& val : vals)
+            binary(val, format);
+        return end_array();
+    }
+
+    /// Shortcuts for key(k).value(v) and key(k).binary(v, format)
+    template <typename T>
+    json_writer& set(std::string_view k, const T& v) {
+        return key(k).value(v);
+    }
+    template <typename T>
+    json_writer& set_binary(std::string_view k, const T& v, json_binary_proxy::fmt format) {
+        return key(k).binary(v, format);
+    }
+
+    /// Appends already-encoded json as the next value.
+    json_writer& raw(std::string_view encoded);
+
+  private:
+    void separate();
+    void write_escaped(std::string_view s);
+    json_writer& write_int(int64_t v);
+    json_writer& write_uint(uint64_t v);
+
+    std::string& m_out;
+    // True at the start of an object or array, and just after a key: i.e. when the next value
+    // doesn't need a comma before it.
+    bool m_first = true;
+};
+
+}  // namespace tools
@@ -0,0 +1,216 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "format.h"
+
+namespace tools::metrics {
+
+namespace {
+
+    std::string format_labels(const labels& l) {
+        if (l.empty())
+            return "";
+        std::string out = "{";
+        for (const auto& [name, value] : l) {
+            if (out.size() > 1)
+                out += ',';
+            out += name;
+            out += "=\"";
+            for (char c : value) {
+                if (c == '\\' || c == '"')
+                    out += '\\';
+                if (c == '\n')
+                    out += "\\n";
+                else
+                    out += c;
+            }
+            out += '"';
+        }
+        out += '}';
+        return out;
+    }
+
+    // Adds a label to an already formatted label set
+    std::string with_label(std::string_view formatted, std::string_view label) {
+        if (formatted.empty())
+            return "{{{}}}"_format(label);
+        return "{},{}}}"_format(formatted.substr(0, formatted.size() - 1), label);
+    }
+
+}  // namespace
+
+histogram::histogram(std::vector<double> bounds) :
+        m_bounds{std::move(bounds)},
+        m_buckets{std::make_unique<std::atomic<uint64_t>[]>(m_bounds.size() + 1)} {
+    if (!std::is_sorted(m_bounds.begin(), m_bounds.end()))
+        throw std::invalid_argument{"histogram bounds must be ascending"};
+}
+
+void histogram::observe(double v) {
+    auto i = std::lower_bound(m_bounds.begin(), m_bounds.end(), v) - m_bounds.begin();
+    m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(v, std::memory_order_relaxed);
+}
+
+callback_handle& callback_handle::operator=(callback_handle&& h) noexcept {
+    if (this != &h) {
+        reset();
+        m_registry = h.m_registry;
+        m_id = h.m_id;
+        h.m_registry = nullptr;
+    }
+    return *this;
+}
+
+void callback_handle::reset() {
+    if (m_registry)
+        m_registry->remove_callback(m_id);
+    m_registry = nullptr;
+}
+
+registry::series& registry::get_series(
+        std::string_view name, std::string_view help, type t, const labels& l) {
+    if (m_callback_names.count(name))
+        throw std::logic_error{"metric {} is already registered as a callback"_format(name)};
+    auto it = m_families.find(name);
+    if (it == m_families.end())
+        it = m_families.emplace(std::string{name}, family{t, std::string{help}, {}}).first;
+    else if (it->second.t != t)
+        throw std::logic_error{"metric {} is already registered with another type"_format(name)};
+    return it->second.members[format_labels(l)];
+}
+
+counter& registry::add_counter(std::string_view name, std::string_view help, const labels& l) {
+    std::lock_guard lock{m_mutex};
+    auto& s = get_series(name, help, type::counter, l);
+    if (!s.c)
+        s.c = std::make_unique<counter>();
+    return *s.c;
+}
+
+gauge& registry::add_gauge(std::string_view name, std::string_view help, const labels& l) {
+    std::lock_guard lock{m_mutex};
+    auto& s = get_series(name, help, type::gauge, l);
+    if (!s.g)
+        s.g = std::make_unique<gauge>();
+    return *s.g;
+}
+
+histogram& registry::add_histogram(
+        std::string_view name, std::string_view help, std::vector<double> bounds, const labels& l) {
+    std::lock_guard lock{m_mutex};
+    auto& s = get_series(name, help, type::histogram, l);
+    if (!s.h)
+        s.h = std::make_unique<histogram>(std::move(bounds));
+    return *s.h;
+}
+
+callback_handle registry::add_gauge_callback(
+        std::string_view name,
+        std::string_view help,
+        const labels& l,
+        std::function<double()> value) {
+    std::lock_guard cb_lock{m_callback_mutex};
+    auto lbls = format_labels(l);
+    for (const auto& [id, cb] : m_callbacks)
+        if (cb.name == name && cb.labels == lbls)
+            throw std::logic_error{"metric {}{} is already registered"_format(name, lbls)};
+    {
+        std::lock_guard lock{m_mutex};
+        if (m_families.count(name))
+            throw std::logic_error{"metric {} is already registered"_format(name)};
+        if (auto it = m_callback_names.find(name); it != m_callback_names.end())
+            it->second++;
+        else
+            m_callback_names.emplace(name, 1);
+    }
+    auto id = m_next_callback_id++;
+    m_callbacks.emplace(
+            id, callback_gauge{std::string{name}, std::string{help}, lbls, std::move(value)});
+    return {this, id};
+}
+
+void registry::remove_callback(uint64_t id) {
+    std::lock_guard cb_lock{m_callback_mutex};
+    auto it = m_callbacks.find(id);
+    if (it == m_callbacks.end())
+        return;
+    {
+        std::lock_guard lock{m_mutex};
+        auto n = m_callback_names.find(it->second.name);
+        if (--n->second == 0)
+            m_callback_names.erase(n);
+    }
+    m_callbacks.erase(it);
+}
+
+std::string registry::render() const {
+    std::string out;
+    auto inserter = std::back_inserter(out);
+
+    std::lock_guard cb_lock{m_callback_mutex};
+    // name -> (help, [(labels, value)...])
+    std::map<std::string_view, std::pair<std::string_view, std::vector<std::string>>> callbacks;
+    for (const auto& [id, cb] : m_callbacks) {
+        auto& [help, lines] = callbacks[cb.name];
+        help = cb.help;
+        lines.push_back("{}{} {}\n"_format(cb.name, cb.labels, cb.value()));
+    }
+    for (auto& [name, help_lines] : callbacks) {
+        auto& [help, lines] = help_lines;
+        fmt::format_to(inserter, "# HELP {0} {1}\n# TYPE {0} gauge\n", name, help);
+        std::sort(lines.begin(), lines.end());
+        for (const auto& line : lines)
+            out += line;
+    }
+
+    std::lock_guard lock{m_mutex};
+    for (const auto& [name, fam] : m_families) {
+        fmt::format_to(
+                inserter,
+                "# HELP {0} {1}\n# TYPE {0} {2}\n",
+                name,
+                fam.help,
+                fam.t == type::counter ? "counter"
+                : fam.t == type::gauge ? "gauge"
+                                       : "histogram");
+        for (const auto& [lbls, s] : fam.members) {
+            if (s.c)
+                fmt::format_to(inserter, "{}{} {}\n", name, lbls, s.c->value());
+            else if (s.g)
+                fmt::format_to(inserter, "{}{} {}\n", name, lbls, s.g->value());
+            else if (s.h) {
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < s.h->bounds().size(); i++) {
+                    cumulative += s.h->bucket(i);
+                    fmt::format_to(
+                            inserter,
+                            "{}_bucket{} {}\n",
+                            name,
+                            with_label(lbls, "le=\"{}\""_format(s.h->bounds()[i])),
+                            cumulative);
+                }
+                cumulative += s.h->bucket(s.h->bounds().size());
+                fmt::format_to(
+                        inserter,
+                        "{0}_bucket{1} {2}\n{0}_sum{3} {4}\n{0}_count{3} {2}\n",
+                        name,
+                        with_label(lbls, "le=\"+Inf\""),
+                        cumulative,
+                        lbls,
+                        s.h->sum());
+            }
+        }
+    }
+    return out;
+}
+
+registry& global() {
+    static registry r;
+    return r;
+}
+
+}  // namespace tools::metrics
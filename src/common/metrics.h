@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Registry of counters, gauges and histograms that subsystems register into, exported in the
+/// Prometheus text exposition format (which OpenMetrics scrapers also accept).
+///
+/// Updating a metric is a relaxed atomic operation, so metrics can be updated from hot paths; only
+/// registering metrics and rendering them takes the registry lock.  Registered metrics live as long
+/// as the registry, so a reference to one can be kept (typically in a function-local static) and
+/// updated without looking it up again.  Registering the same name and labels again returns the
+/// same metric.
+namespace tools::metrics {
+
+using labels = std::vector<std::pair<std::string, std::string>>;
+
+class counter {
+  public:
+    void inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+class gauge {
+  public:
+    void set(int64_t v) { m_value.store(v, std::memory_order_relaxed); }
+    void inc(int64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    void dec(int64_t n = 1) { m_value.fetch_sub(n, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<int64_t> m_value{0};
+};
+
+class histogram {
+  public:
+    /// `bounds` are the (ascending) upper bounds of the buckets; there is an implicit +Inf bucket
+    /// after the last.
+    explicit histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    const std::vector<double>& bounds() const { return m_bounds; }
+    /// Non-cumulative count of bucket `i`; `i == bounds().size()` is the +Inf bucket.
+    uint64_t bucket(size_t i) const { return m_buckets[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    double sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+  private:
+    std::vector<double> m_bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<double> m_sum{0};
+};
+
+class registry;
+
+/// Keeps a callback gauge registered; destroying (or resetting) it unregisters the gauge.
+class callback_handle {
+  public:
+    callback_handle() = default;
+    callback_handle(callback_handle&& h) noexcept { *this = std::move(h); }
+    callback_handle& operator=(callback_handle&& h) noexcept;
+    ~callback_handle() { reset(); }
+
+    void reset();
+
+  private:
+    friend class registry;
+    callback_handle(registry* r, uint64_t id) : m_registry{r}, m_id{id} {}
+
+    registry* m_registry = nullptr;
+    uint64_t m_id = 0;
+};
+
+class registry {
+  public:
+    counter& add_counter(std::string_view name, std::string_view help, const labels& l = {});
+    gauge& add_gauge(std::string_view name, std::string_view help, const labels& l = {});
+    histogram& add_histogram(
+            std::string_view name,
+            std::string_view help,
+            std::vector<double> bounds,
+            const labels& l = {});
+
+    /// Registers a gauge whose value is obtained by calling `value` each time the metrics are
+    /// rendered, for values (such as a pool size) that the owning subsystem already tracks.  The
+    /// callback may take the subsystem's locks, but must not register callback gauges; the handle
+    /// waits for a running callback when destroyed, so must not be destroyed while holding a lock
+    /// the callback takes.
+    [[nodiscard]] callback_handle add_gauge_callback(
+            std::string_view name,
+            std::string_view help,
+            const labels& l,
+            std::function<double()> value);
+
+    /// Returns all registered metrics in the Prometheus text exposition format.
+    std::string render() const;
+
+  private:
+    friend class callback_handle;
+
+    enum class type { counter, gauge, histogram };
+
+    struct series {
+        std::unique_ptr<counter> c;
+        std::unique_ptr<gauge> g;
+        std::unique_ptr<histogram> h;
+    };
+
+    struct family {
+        type t;
+        std::string help;
+        // Keyed by the formatted label set, e.g. `{state="active"}`
+        std::map<std::string, series> members;
+    };
+
+    struct callback_gauge {
+        std::string name;
+        std::string help;
+        std::string labels;  // formatted
+        std::function<double()> value;
+    };
+
+    series& get_series(std::string_view name, std::string_view help, type t, const labels& l);
+    void remove_callback(uint64_t id);
+
+    // Callbacks are called without m_mutex held (so that a subsystem can update its metrics while
+    // holding a lock that its callback also takes); when both are needed m_callback_mutex is taken
+    // first.
+    mutable std::mutex m_callback_mutex;
+    std::map<uint64_t, callback_gauge> m_callbacks;
+    uint64_t m_next_callback_id = 1;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, family, std::less<>> m_families;
+    std::map<std::string, size_t, std::less<>> m_callback_names;  // name -> number of callbacks
+};
+
+/// The process-wide registry, served by the daemon's /metrics endpoint.
+registry& global();
+
+}  // namespace tools::metrics
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 
+#include "common/metrics.h"
 #include "crypto/crypto.h"
 #include "logging/oxen_logger.h"
 
@@ -12,6 +14,9 @@ namespace tools {
 // Periodic timer that gatekeeps calling of a job to a minimum interval after the previous job
 // finished.  Only the reset() call is thread-safe; everything else should be confined to the
 // owning thread.
+//
+// Each job's run times and failures are recorded in the global metrics, labelled with the task
+// description, as oxen_periodic_task_seconds and oxen_periodic_task_failures_total.
 class periodic_task {
   public:
     explicit periodic_task(
@@ -24,25 +29,51 @@ class periodic_task {
             m_last_worked_time{std::chrono::steady_clock::now()},
             m_trigger_now{start_immediately},
             m_random_max_delay{random_max_delay},
-            m_next_delay{make_delay()} {}
+            m_next_delay{make_delay()},
+            m_run_time{metrics::global().add_histogram(
+                    "oxen_periodic_task_seconds",
+                    "Time taken by each run of a periodic task",
+                    {0.001, 0.01, 0.1, 1, 10},
+                    {{"task", m_description}})},
+            m_failures{metrics::global().add_counter(
+                    "oxen_periodic_task_failures_total",
+                    "Periodic task runs that failed with an exception",
+                    {{"task", m_description}})} {}
 
     template <class functor_t>
     void do_call(functor_t functr) {
-        if (m_trigger_now ||
-            std::chrono::steady_clock::now() - m_last_worked_time > (m_interval + m_next_delay)) {
+        auto now = std::chrono::steady_clock::now();
+        if (m_trigger_now || now - m_last_worked_time > (m_interval + m_next_delay)) {
+            m_last_attempt = now;
             try {
                 functr();
             } catch (const std::exception& e) {
                 log::error(log::Cat("task"), "{} failed: {}", m_description, e.what());
+                m_failures.inc();
+                m_failed = true;
                 return;
             }
+            m_failed = false;
 
             m_last_worked_time = std::chrono::steady_clock::now();
+            m_run_time.observe(std::chrono::duration<double>(m_last_worked_time - now).count());
             m_trigger_now = false;
             m_next_delay = make_delay();
         }
     }
 
+    // Returns when do_call() will next run the job (which may be in the past, if it is already
+    // due).  After a failure this is at least `retry_delay` after the failed attempt, so that a
+    // caller sleeping until this doesn't spin on a failing job.
+    std::chrono::steady_clock::time_point next_due(
+            std::chrono::microseconds retry_delay = 1s) const {
+        auto due = m_trigger_now ? std::chrono::steady_clock::time_point::min()
+                                 : m_last_worked_time + m_interval + m_next_delay;
+        if (m_failed)
+            due = std::max(due, m_last_attempt + retry_delay);
+        return due;
+    }
+
     std::chrono::microseconds make_delay() const {
         return m_random_max_delay > 0s ? crypto::rand_range(0us, m_random_max_delay) : 0us;
     }
@@ -61,5 +92,9 @@ class periodic_task {
     std::atomic<bool> m_trigger_now;
     std::chrono::microseconds m_random_max_delay;  // Add Unif[0, this] to each interval
     std::chrono::microseconds m_next_delay;
+    std::chrono::steady_clock::time_point m_last_attempt;
+    bool m_failed = false;
+    metrics::histogram& m_run_time;
+    metrics::counter& m_failures;
 };
 };  // namespace tools
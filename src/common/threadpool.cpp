@@ -32,12 +32,14 @@
 #include "epee/misc_log_ex.h"
 #include "logging/oxen_logger.h"
 
-static thread_local int depth = 0;
 static thread_local bool is_leaf = false;
+// The pool and queue index of the worker running on this thread, if it is one
+static thread_local tools::threadpool* current_pool = nullptr;
+static thread_local size_t current_index = 0;
 
 namespace tools {
 
-threadpool::threadpool(unsigned int max_threads) : running(true), active(0) {
+threadpool::threadpool(unsigned int max_threads) : running(true) {
     create(max_threads);
 }
 
@@ -46,14 +48,13 @@ threadpool::~threadpool() {
 }
 
 void threadpool::destroy() {
+    running = false;
     try {
-        const std::unique_lock lock{mutex};
-        running = false;
+        const std::unique_lock lock{sleep_mutex};
         has_work.notify_all();
     } catch (...) {
         // if the lock throws, we're just do it without a lock and hope,
         // since the alternative is terminate
-        running = false;
         has_work.notify_all();
     }
     for (size_t i = 0; i < threads.size(); i++) {
@@ -63,6 +64,8 @@ void threadpool::destroy() {
         }
     }
     threads.clear();
+    queues.clear();
+    pending = 0;
 }
 
 void threadpool::recycle() {
@@ -71,36 +74,44 @@ void threadpool::recycle() {
 }
 
 void threadpool::create(unsigned int max_threads) {
-    const std::unique_lock lock{mutex};
     max = max_threads ? max_threads : tools::get_max_concurrency();
     running = true;
-    for (size_t i = max ? max : 1; i > 0; i--) {
-        threads.emplace_back([this] { run(false); });
-    }
+    size_t count = max ? max : 1;
+    for (size_t i = 0; i < count; i++)
+        queues.push_back(std::make_unique<task_queue>());
+    for (size_t i = 0; i < count; i++)
+        threads.emplace_back([this, i] { run(i); });
 }
 
-void threadpool::submit(waiter* obj, std::function<void()> f, bool leaf) {
+void threadpool::submit(waiter* obj, std::function<void()> f, const char* tag, bool leaf) {
     if (is_leaf) {
         auto logcat = oxen::log::Cat("threadpool");
         ASSERT_MES_AND_THROW("A leaf routine is using a thread pool");
     }
-    std::unique_lock lock{mutex};
-    if (!leaf && ((active == max && !queue.empty()) || depth > 0)) {
-        // if all available threads are already running
-        // and there's work waiting, just run in current thread
-        lock.unlock();
-        ++depth;
-        is_leaf = leaf;
-        f();
-        --depth;
-        is_leaf = false;
-    } else {
-        if (obj)
-            obj->inc();
-        if (leaf)
-            queue.push_front({obj, f, leaf});
-        else
-            queue.push_back({obj, f, leaf});
+    if (obj) {
+        obj->pool = this;
+        obj->inc();
+    }
+
+    task_counters* tc = tag ? &get_tag_counters(tag) : nullptr;
+    counters.submitted++;
+    if (tc)
+        tc->submitted++;
+
+    // Our own workers keep what they submit (so that nested tasks run depth-first on the thread
+    // that is going to wait for them); anything else gets spread across the workers.
+    auto& q = *queues[current_pool == this ? current_index : next_queue++ % queues.size()];
+    {
+        std::lock_guard lock{q.mutex};
+        q.tasks.push_back({obj, std::move(f), leaf, std::chrono::steady_clock::now(), tc});
+    }
+    auto depth = ++pending;
+    for (auto prev = max_pending.load(); depth > prev;)
+        if (max_pending.compare_exchange_weak(prev, depth))
+            break;
+
+    if (sleepers > 0) {
+        std::lock_guard lock{sleep_mutex};
         has_work.notify_one();
     }
 }
@@ -109,14 +120,130 @@ unsigned int threadpool::get_max_concurrency() const {
     return max;
 }
 
-threadpool::waiter::~waiter() {
-    try {
-        std::unique_lock lock{mt};
-        if (num)
-            log::error(
-                    globallogcat, "wait should have been called before waiter dtor - waiting now");
-    } catch (...) { /* ignore */
+threadpool::task_counters& threadpool::get_tag_counters(std::string_view tag) {
+    {
+        std::shared_lock lock{tags_mutex};
+        if (auto it = tag_counters.find(tag); it != tag_counters.end())
+            return *it->second;
     }
+    std::unique_lock lock{tags_mutex};
+    auto& tc = tag_counters[std::string{tag}];
+    if (!tc)
+        tc = std::make_unique<task_counters>();
+    return *tc;
+}
+
+static void add_to_histogram(auto& histogram, std::chrono::nanoseconds t) {
+    const auto& buckets = threadpool::task_stats::TIME_BUCKETS;
+    histogram[std::lower_bound(buckets.begin(), buckets.end(), t) - buckets.begin()]++;
+}
+
+void threadpool::task_counters::add(std::chrono::nanoseconds wait, std::chrono::nanoseconds run) {
+    wait_ns += wait.count();
+    run_ns += run.count();
+    add_to_histogram(wait_histogram, wait);
+    add_to_histogram(run_histogram, run);
+    executed++;
+}
+
+threadpool::task_stats threadpool::task_counters::snapshot() const {
+    task_stats s;
+    s.submitted = submitted;
+    s.executed = executed;
+    s.wait_time = std::chrono::nanoseconds{wait_ns};
+    s.run_time = std::chrono::nanoseconds{run_ns};
+    for (size_t i = 0; i < s.wait_histogram.size(); i++) {
+        s.wait_histogram[i] = wait_histogram[i];
+        s.run_histogram[i] = run_histogram[i];
+    }
+    return s;
+}
+
+threadpool::stats threadpool::get_stats() const {
+    stats s;
+    s.threads = max;
+    s.queued = pending;
+    s.max_queued = max_pending;
+    s.total = counters.snapshot();
+    std::shared_lock lock{tags_mutex};
+    for (const auto& [tag, tc] : tag_counters)
+        s.tags.emplace(tag, tc->snapshot());
+    return s;
+}
+
+bool threadpool::take(entry& e) {
+    const size_t n = queues.size();
+    size_t start = 0;
+    if (current_pool == this) {
+        auto& own = *queues[current_index];
+        std::lock_guard lock{own.mutex};
+        if (!own.tasks.empty()) {
+            e = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending--;
+            return true;
+        }
+        start = current_index + 1;
+    }
+
+    if (pending == 0)
+        return false;
+
+    for (size_t i = 0; i < n; i++) {
+        auto& q = *queues[(start + i) % n];
+        std::lock_guard lock{q.mutex};
+        if (!q.tasks.empty()) {
+            e = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void threadpool::execute(entry& e) {
+    const auto started = std::chrono::steady_clock::now();
+    const bool was_leaf = is_leaf;
+    is_leaf = e.leaf;
+    e.f();
+    is_leaf = was_leaf;
+
+    // Recorded before we tell the waiter, so that stats read after a wait() include its tasks
+    const auto wait = started - e.queued, run = std::chrono::steady_clock::now() - started;
+    counters.add(wait, run);
+    if (e.tag)
+        e.tag->add(wait, run);
+
+    if (e.wo)
+        e.wo->dec();
+}
+
+bool threadpool::run_one() {
+    entry e;
+    if (!take(e))
+        return false;
+    execute(e);
+    return true;
+}
+
+void threadpool::run(size_t index) {
+    current_pool = this;
+    current_index = index;
+    while (running) {
+        if (run_one())
+            continue;
+
+        std::unique_lock lock{sleep_mutex};
+        sleepers++;
+        has_work.wait(lock, [this] { return pending > 0 || !running; });
+        sleepers--;
+    }
+}
+
+threadpool::waiter::~waiter() {
+    if (num)
+        log::error(globallogcat, "wait should have been called before waiter dtor - waiting now");
     try {
         wait(NULL);
     } catch (const std::exception& e) {
@@ -125,51 +252,26 @@ threadpool::waiter::~waiter() {
 }
 
 void threadpool::waiter::wait(threadpool* tpool) {
+    if (!tpool)
+        tpool = pool;
+    // Rather than just blocking, run whatever is queued until everything we are waiting for is
+    // done; this is what makes it safe for tasks to wait on tasks of their own.
     if (tpool)
-        tpool->run(true);
+        while (num > 0 && tpool->run_one()) {}
+
+    // Anything left is running on other threads
     std::unique_lock lock{mt};
-    while (num)
-        cv.wait(lock);
+    cv.wait(lock, [this] { return num == 0; });
 }
 
 void threadpool::waiter::inc() {
-    const std::unique_lock lock{mt};
     num++;
 }
 
 void threadpool::waiter::dec() {
+    // The lock makes sure that wait() can't return (and the waiter be destroyed) until we are done
     const std::unique_lock lock{mt};
-    num--;
-    if (!num)
+    if (--num == 0)
         cv.notify_all();
 }
-
-void threadpool::run(bool flush) {
-    std::unique_lock lock{mutex};
-    while (running) {
-        entry e;
-        while (queue.empty() && running) {
-            if (flush)
-                return;
-            has_work.wait(lock);
-        }
-        if (!running)
-            break;
-
-        active++;
-        e = std::move(queue.front());
-        queue.pop_front();
-        lock.unlock();
-        ++depth;
-        is_leaf = e.leaf;
-        e.f();
-        --depth;
-        is_leaf = false;
-
-        if (e.wo)
-            e.wo->dec();
-        lock.lock();
-        active--;
-    }
-}
 }  // namespace tools
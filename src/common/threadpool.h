@@ -27,18 +27,32 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <deque>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <utility>
 #include <vector>
 
 namespace tools {
 //! A global thread pool
+//!
+//! Each worker thread has its own task queue: tasks submitted from a worker go onto that worker's
+//! queue (and are run newest-first by it), while other tasks are spread across the queues.  Idle
+//! workers steal the oldest tasks from the other queues.  Waiting on a waiter runs queued tasks
+//! until the waited-for tasks are done, so tasks can themselves submit tasks and wait for them.
 class threadpool {
   public:
     static threadpool& getInstance() {
@@ -54,20 +68,90 @@ class threadpool {
     class waiter {
         std::mutex mt;
         std::condition_variable cv;
-        int num;
+        std::atomic<int> num{0};
+        // The pool the tasks were submitted to, which the destructor helps out if it has to wait
+        threadpool* pool = nullptr;
+
+        friend class threadpool;
 
       public:
         void inc();
         void dec();
         void wait(threadpool* tpool);  //! Wait for a set of tasks to finish.
-        waiter() : num(0) {}
+        waiter() = default;
         ~waiter();
     };
 
     // Submit a task to the pool. The waiter pointer may be
     // NULL if the caller doesn't care to wait for the
-    // task to finish.
-    void submit(waiter* waiter, std::function<void()> f, bool leaf = false);
+    // task to finish.  Leaf tasks may not submit tasks of their own.
+    void submit(waiter* waiter, std::function<void()> f, bool leaf = false) {
+        submit(waiter, std::move(f), nullptr, leaf);
+    }
+    // Same as above, but also counts the task in the stats kept for `tag`, which identifies the
+    // call site (e.g. "rct_verify").  `tag` must stay valid for as long as the pool exists, which
+    // in practice means a string literal.
+    void submit(waiter* waiter, std::function<void()> f, const char* tag, bool leaf = false);
+
+    // Counters for tasks submitted to the pool (or with a particular tag).  The wait time of a
+    // task is the time from its submission until a thread starts running it.
+    struct task_stats {
+        // Upper bounds of the histogram buckets; the last histogram entry counts anything slower.
+        static constexpr std::array<std::chrono::microseconds, 6> TIME_BUCKETS{
+                std::chrono::microseconds{10},
+                std::chrono::microseconds{100},
+                std::chrono::milliseconds{1},
+                std::chrono::milliseconds{10},
+                std::chrono::milliseconds{100},
+                std::chrono::seconds{1}};
+        uint64_t submitted = 0;
+        uint64_t executed = 0;
+        std::chrono::nanoseconds wait_time{0};  // Sum over all executed tasks
+        std::chrono::nanoseconds run_time{0};   // Sum over all executed tasks
+        std::array<uint64_t, TIME_BUCKETS.size() + 1> wait_histogram{};
+        std::array<uint64_t, TIME_BUCKETS.size() + 1> run_histogram{};
+    };
+    struct stats {
+        unsigned int threads;
+        size_t queued;      // Tasks waiting for a thread right now
+        size_t max_queued;  // The most tasks that have been waiting at once
+        task_stats total;
+        std::map<std::string, task_stats> tags;  // Only the tasks submitted with a tag
+    };
+    // Returns a snapshot of the counters; these are cumulative since the pool was created.
+    stats get_stats() const;
+
+    // Calls `f(i)` for each i in [begin, end), split into contiguous chunks of at least
+    // `min_chunk` indices that get spread across the pool, and returns once all of them are done.
+    // The calling thread runs tasks while it waits.  Runs everything in the calling thread if
+    // there isn't enough work for more than one chunk.
+    // `tag`, if given, is used for the submitted chunks as with submit().
+    template <typename F>
+    void parallel_for(
+            size_t begin, size_t end, F&& f, size_t min_chunk = 1, const char* tag = nullptr) {
+        if (begin >= end)
+            return;
+        const size_t n = end - begin;
+        // A few chunks per thread lets threads that finish early pick up the slack
+        const size_t chunks = std::min<size_t>(
+                n / std::max<size_t>(min_chunk, 1), 4 * size_t{get_max_concurrency()});
+        if (chunks <= 1) {
+            for (size_t i = begin; i < end; i++)
+                f(i);
+            return;
+        }
+        const size_t chunk_size = (n + chunks - 1) / chunks;
+        waiter w;
+        for (size_t start = begin; start < end; start += chunk_size)
+            submit(
+                    &w,
+                    [&f, start, stop = std::min(end, start + chunk_size)] {
+                        for (size_t i = start; i < stop; i++)
+                            f(i);
+                    },
+                    tag);
+        w.wait(this);
+    }
 
     // destroy and recreate threads
     void recycle();
@@ -82,19 +166,53 @@ class threadpool {
     threadpool(unsigned int max_threads = 0);
     void destroy();
     void create(unsigned int max_threads);
+    struct task_counters {
+        std::atomic<uint64_t> submitted{0};
+        std::atomic<uint64_t> executed{0};
+        std::atomic<int64_t> wait_ns{0};
+        std::atomic<int64_t> run_ns{0};
+        std::array<std::atomic<uint64_t>, task_stats::TIME_BUCKETS.size() + 1> wait_histogram{};
+        std::array<std::atomic<uint64_t>, task_stats::TIME_BUCKETS.size() + 1> run_histogram{};
+
+        void add(std::chrono::nanoseconds wait, std::chrono::nanoseconds run);
+        task_stats snapshot() const;
+    };
     typedef struct entry {
         waiter* wo;
         std::function<void()> f;
         bool leaf;
+        std::chrono::steady_clock::time_point queued;
+        task_counters* tag;  // nullptr for untagged tasks
     } entry;
-    std::deque<entry> queue;
+    struct task_queue {
+        std::mutex mutex;
+        std::deque<entry> tasks;
+    };
+    // One per worker thread
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::atomic<size_t> next_queue{0};
+    // Tasks in the queues that nothing has started on yet
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> max_pending{0};
+    task_counters counters;
+    // Counters for each tag; entries are never removed, so pointers to them stay valid.
+    mutable std::shared_mutex tags_mutex;
+    std::map<std::string, std::unique_ptr<task_counters>, std::less<>> tag_counters;
+    task_counters& get_tag_counters(std::string_view tag);
+    // Only used for idle workers to sleep on
+    std::mutex sleep_mutex;
     std::condition_variable has_work;
-    std::mutex mutex;
+    std::atomic<unsigned int> sleepers{0};
     std::vector<std::thread> threads;
-    unsigned int active;
     unsigned int max;
-    bool running;
-    void run(bool flush = false);
+    std::atomic<bool> running;
+    // Takes a task off our own queue if we are one of this pool's workers, otherwise (or if that
+    // is empty) steals one from another queue.  Returns false if there was nothing to take.
+    bool take(entry& e);
+    // Takes and runs a single task; returns false if there wasn't one.
+    bool run_one();
+    void execute(entry& e);
+    void run(size_t index);
 };
 
 }  // namespace tools
@@ -52,6 +52,13 @@ inline bool force_software_aes() {
 #endif
 extern "C" const bool cpu_aes_enabled;
 
+// VAES (256-bit AES) lets us explode/implode the scratchpad four blocks at a time; like the AES-NI
+// code it gets compiled in whenever the compiler supports it, and used if the running CPU does.
+#if defined(HAS_INTEL_HW) && defined(__GNUC__) && (defined(__clang__) || __GNUC__ >= 8)
+#define HAS_INTEL_VAES
+extern const bool cpu_vaes_enabled;
+#endif
+
 // This cruft avoids casting-galore and allows us not to worry about sizeof(void*)
 class cn_sptr {
   public:
@@ -129,6 +136,36 @@ class cn_heavy_hash {
     void hardware_hash(const void* in, size_t len, void* out, bool prehashed);
 #endif
 
+    // True if hash2() below is faster than hashing the two inputs one after the other.
+    static bool hash2_accelerated() {
+#ifdef HAS_INTEL_HW
+        return cpu_aes_enabled;
+#else
+        return false;
+#endif
+    }
+
+    // Hashes two inputs at once, interleaving their main loops so that the scratchpad accesses of
+    // one overlap with those of the other.  `a` and `b` must not share a scratchpad (i.e. neither
+    // may be borrowed from the other).
+    static void hash2(
+            cn_heavy_hash& a,
+            cn_heavy_hash& b,
+            const void* in0,
+            size_t len0,
+            void* out0,
+            const void* in1,
+            size_t len1,
+            void* out1) {
+        assert(a.lpad.as_void() != b.lpad.as_void());
+#ifdef HAS_INTEL_HW
+        if (cpu_aes_enabled)
+            return hardware_hash2(a, b, in0, len0, out0, in1, len1, out1);
+#endif
+        a.hash(in0, len0, out0);
+        b.hash(in1, len1, out1);
+    }
+
   private:
     static constexpr size_t MASK = ((MEMORY - 1) >> 4) << 4;
     friend cn_heavy_hash_v1;
@@ -162,6 +199,17 @@ class cn_heavy_hash {
     void explode_scratchpad_hard();
     void implode_scratchpad_hard();
 #endif
+#ifdef HAS_INTEL_HW
+    static void hardware_hash2(
+            cn_heavy_hash& a,
+            cn_heavy_hash& b,
+            const void* in0,
+            size_t len0,
+            void* out0,
+            const void* in1,
+            size_t len1,
+            void* out1);
+#endif
 
     void explode_scratchpad_soft();
     void implode_scratchpad_soft();
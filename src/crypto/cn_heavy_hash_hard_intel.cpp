@@ -51,19 +51,44 @@ extern "C" {
 #include <cpuid.h>
 #endif
 
-static bool hw_check_aes() {
-    int32_t cpu_info[4] = {0};
-
+static void cpuid(int32_t leaf, int32_t (&cpu_info)[4]) {
 #if defined(HAS_WIN_INTRIN_API)
-    __cpuidex(cpu_info, 1, 0);
+    __cpuidex(cpu_info, leaf, 0);
 #else
-    __cpuid_count(1, 0, cpu_info[0], cpu_info[1], cpu_info[2], cpu_info[3]);
+    __cpuid_count(leaf, 0, cpu_info[0], cpu_info[1], cpu_info[2], cpu_info[3]);
 #endif
+}
+
+static bool hw_check_aes() {
+    int32_t cpu_info[4] = {0};
+    cpuid(1, cpu_info);
     return (cpu_info[2] & (1 << 25)) != 0;
 }
 
 extern "C" const bool cpu_aes_enabled = hw_check_aes() && !force_software_aes();
 
+#ifdef HAS_INTEL_VAES
+static bool hw_check_vaes() {
+    int32_t cpu_info[4] = {0};
+    cpuid(0, cpu_info);
+    if (cpu_info[0] < 7)
+        return false;
+    // The OS has to save the ymm registers for us (OSXSAVE, then XCR0 bits 1 and 2)
+    cpuid(1, cpu_info);
+    if (!(cpu_info[2] & (1 << 27)))
+        return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return false;
+    // AVX2 (for the 256-bit broadcasts/permutes) and VAES
+    cpuid(7, cpu_info);
+    return (cpu_info[1] & (1 << 5)) && (cpu_info[2] & (1 << 9));
+}
+
+const bool cpu_vaes_enabled = cpu_aes_enabled && hw_check_vaes();
+#endif
+
 #if !defined(_LP64) && !defined(_WIN64)
 #define BUILD32
 #endif
@@ -175,8 +200,125 @@ static inline __m128i* as_xmm(cn_sptr&& x) {
     return reinterpret_cast<__m128i*>(x.as_void());
 }
 
+#ifdef HAS_INTEL_VAES
+// 256-bit versions of the above used by the VAES explode/implode functions, which process the same
+// 8 blocks as the AES-NI versions in 4 registers: y0 holds x0 and x1, y1 holds x2 and x3, etc.
+#define VAES_TARGET __attribute__((target("aes,avx2,vaes")))
+
+VAES_TARGET static inline void aes_genkey4(const __m128i* memory, __m256i (&k)[10]) {
+    __m128i k0, k1, k2, k3, k4, k5, k6, k7, k8, k9;
+    aes_genkey(memory, k0, k1, k2, k3, k4, k5, k6, k7, k8, k9);
+    k[0] = _mm256_broadcastsi128_si256(k0);
+    k[1] = _mm256_broadcastsi128_si256(k1);
+    k[2] = _mm256_broadcastsi128_si256(k2);
+    k[3] = _mm256_broadcastsi128_si256(k3);
+    k[4] = _mm256_broadcastsi128_si256(k4);
+    k[5] = _mm256_broadcastsi128_si256(k5);
+    k[6] = _mm256_broadcastsi128_si256(k6);
+    k[7] = _mm256_broadcastsi128_si256(k7);
+    k[8] = _mm256_broadcastsi128_si256(k8);
+    k[9] = _mm256_broadcastsi128_si256(k9);
+}
+
+VAES_TARGET static inline void aes_rounds4(
+        const __m256i (&k)[10], __m256i& y0, __m256i& y1, __m256i& y2, __m256i& y3) {
+    for (const auto& key : k) {
+        y0 = _mm256_aesenc_epi128(y0, key);
+        y1 = _mm256_aesenc_epi128(y1, key);
+        y2 = _mm256_aesenc_epi128(y2, key);
+        y3 = _mm256_aesenc_epi128(y3, key);
+    }
+}
+
+VAES_TARGET static inline void xor_shift4(__m256i& y0, __m256i& y1, __m256i& y2, __m256i& y3) {
+    // Each of these is the register's pair of blocks shifted along by one: (x1, x2), ..., (x7, x0)
+    __m256i s0 = _mm256_permute2x128_si256(y0, y1, 0x21);
+    __m256i s1 = _mm256_permute2x128_si256(y1, y2, 0x21);
+    __m256i s2 = _mm256_permute2x128_si256(y2, y3, 0x21);
+    __m256i s3 = _mm256_permute2x128_si256(y3, y0, 0x21);
+    y0 = _mm256_xor_si256(y0, s0);
+    y1 = _mm256_xor_si256(y1, s1);
+    y2 = _mm256_xor_si256(y2, s2);
+    y3 = _mm256_xor_si256(y3, s3);
+}
+
+VAES_TARGET static inline void xor_load4(
+        const __m256i* p, __m256i& y0, __m256i& y1, __m256i& y2, __m256i& y3) {
+    y0 = _mm256_xor_si256(_mm256_load_si256(p + 0), y0);
+    y1 = _mm256_xor_si256(_mm256_load_si256(p + 1), y1);
+    y2 = _mm256_xor_si256(_mm256_load_si256(p + 2), y2);
+    y3 = _mm256_xor_si256(_mm256_load_si256(p + 3), y3);
+}
+
+template <size_t MEMORY, size_t VERSION>
+VAES_TARGET static void implode_scratchpad_vaes(void* spad_ptr, const void* lpad_ptr) {
+    auto* spad = reinterpret_cast<__m256i*>(spad_ptr);
+    const auto* lpad = reinterpret_cast<const __m256i*>(lpad_ptr);
+    __m256i k[10];
+    aes_genkey4(reinterpret_cast<const __m128i*>(spad + 1), k);
+
+    __m256i y0 = _mm256_load_si256(spad + 2);
+    __m256i y1 = _mm256_load_si256(spad + 3);
+    __m256i y2 = _mm256_load_si256(spad + 4);
+    __m256i y3 = _mm256_load_si256(spad + 5);
+
+    for (size_t i = 0; i < MEMORY / sizeof(__m256i); i += 4) {
+        xor_load4(lpad + i, y0, y1, y2, y3);
+        aes_rounds4(k, y0, y1, y2, y3);
+        if (VERSION > 0)
+            xor_shift4(y0, y1, y2, y3);
+    }
+
+    for (size_t i = 0; VERSION > 0 && i < MEMORY / sizeof(__m256i); i += 4) {
+        xor_load4(lpad + i, y0, y1, y2, y3);
+        aes_rounds4(k, y0, y1, y2, y3);
+        xor_shift4(y0, y1, y2, y3);
+    }
+
+    for (size_t i = 0; VERSION > 0 && i < 16; i++) {
+        aes_rounds4(k, y0, y1, y2, y3);
+        xor_shift4(y0, y1, y2, y3);
+    }
+
+    _mm256_store_si256(spad + 2, y0);
+    _mm256_store_si256(spad + 3, y1);
+    _mm256_store_si256(spad + 4, y2);
+    _mm256_store_si256(spad + 5, y3);
+}
+
+template <size_t MEMORY, size_t VERSION>
+VAES_TARGET static void explode_scratchpad_vaes(void* spad_ptr, void* lpad_ptr) {
+    const auto* spad = reinterpret_cast<const __m256i*>(spad_ptr);
+    auto* lpad = reinterpret_cast<__m256i*>(lpad_ptr);
+    __m256i k[10];
+    aes_genkey4(reinterpret_cast<const __m128i*>(spad), k);
+
+    __m256i y0 = _mm256_load_si256(spad + 2);
+    __m256i y1 = _mm256_load_si256(spad + 3);
+    __m256i y2 = _mm256_load_si256(spad + 4);
+    __m256i y3 = _mm256_load_si256(spad + 5);
+
+    for (size_t i = 0; VERSION > 0 && i < 16; i++) {
+        aes_rounds4(k, y0, y1, y2, y3);
+        xor_shift4(y0, y1, y2, y3);
+    }
+
+    for (size_t i = 0; i < MEMORY / sizeof(__m256i); i += 4) {
+        aes_rounds4(k, y0, y1, y2, y3);
+        _mm256_store_si256(lpad + i + 0, y0);
+        _mm256_store_si256(lpad + i + 1, y1);
+        _mm256_store_si256(lpad + i + 2, y2);
+        _mm256_store_si256(lpad + i + 3, y3);
+    }
+}
+#endif
+
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_heavy_hash<MEMORY, ITER, VERSION>::implode_scratchpad_hard() {
+#ifdef HAS_INTEL_VAES
+    if (cpu_vaes_enabled)
+        return implode_scratchpad_vaes<MEMORY, VERSION>(spad.as_void(), lpad.as_void());
+#endif
     __m128i x0, x1, x2, x3, x4, x5, x6, x7;
     __m128i k0, k1, k2, k3, k4, k5, k6, k7, k8, k9;
 
@@ -267,6 +409,10 @@ void cn_heavy_hash<MEMORY, ITER, VERSION>::implode_scratchpad_hard() {
 
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_heavy_hash<MEMORY, ITER, VERSION>::explode_scratchpad_hard() {
+#ifdef HAS_INTEL_VAES
+    if (cpu_vaes_enabled)
+        return explode_scratchpad_vaes<MEMORY, VERSION>(spad.as_void(), lpad.as_void());
+#endif
     __m128i x0, x1, x2, x3, x4, x5, x6, x7;
     __m128i k0, k1, k2, k3, k4, k5, k6, k7, k8, k9;
 
@@ -368,6 +514,69 @@ inline uint64_t xmm_extract_64(__m128i x) {
 #endif
 }
 
+namespace {
+// The state carried between iterations of the main loop
+struct hard_loop_state {
+    uint64_t al, ah, idx;
+    __m128i bx;
+
+    explicit hard_loop_state(const uint64_t* h0) :
+            al{h0[0] ^ h0[4]},
+            ah{h0[1] ^ h0[5]},
+            idx{h0[0] ^ h0[4]},
+            bx{_mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6])} {}
+};
+}  // namespace
+
+// One iteration of the main loop over the scratchpad at `lpad`
+template <size_t MEMORY, size_t VERSION>
+static inline void hard_loop_round(uint8_t* lpad, hard_loop_state& s) {
+    constexpr size_t MASK = ((MEMORY - 1) >> 4) << 4;
+    auto scratchpad_ptr = [lpad](uint64_t idx) { return cn_sptr{lpad + (idx & MASK)}; };
+
+    __m128i cx;
+    cx = _mm_load_si128(as_xmm(scratchpad_ptr(s.idx)));
+
+    cx = _mm_aesenc_si128(cx, _mm_set_epi64x(s.ah, s.al));
+
+    _mm_store_si128(as_xmm(scratchpad_ptr(s.idx)), _mm_xor_si128(s.bx, cx));
+    s.idx = xmm_extract_64(cx);
+    s.bx = cx;
+
+    uint64_t hi, lo, cl, ch;
+    cl = scratchpad_ptr(s.idx).as_uqword(0);
+    ch = scratchpad_ptr(s.idx).as_uqword(1);
+
+    lo = _umul128(s.idx, cl, &hi);
+
+    s.al += hi;
+    s.ah += lo;
+    scratchpad_ptr(s.idx).as_uqword(0) = s.al;
+    scratchpad_ptr(s.idx).as_uqword(1) = s.ah;
+    s.ah ^= ch;
+    s.al ^= cl;
+    s.idx = s.al;
+
+    if (VERSION > 0) {
+        int64_t n = scratchpad_ptr(s.idx).as_qword(0);
+        int32_t d = scratchpad_ptr(s.idx).as_dword(2);
+        int64_t q = n / (d | 5);
+        scratchpad_ptr(s.idx).as_qword(0) = n ^ q;
+        s.idx = d ^ q;
+    }
+}
+
+static void hard_finish(cn_sptr& spad, void* out) {
+    keccakf(spad.as_uqword(), 24);
+
+    switch (spad.as_byte(0) & 3) {
+        case 0: blake256_hash((uint8_t*)out, spad.as_byte(), 200); break;
+        case 1: groestl(spad.as_byte(), 200 * 8, (uint8_t*)out); break;
+        case 2: jh_hash(32 * 8, spad.as_byte(), 8 * 200, (uint8_t*)out); break;
+        case 3: skein_hash(8 * 32, spad.as_byte(), 8 * 200, (uint8_t*)out); break;
+    }
+}
+
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_heavy_hash<MEMORY, ITER, VERSION>::hardware_hash(
         const void* in, size_t len, void* out, bool prehashed) {
@@ -376,58 +585,48 @@ void cn_heavy_hash<MEMORY, ITER, VERSION>::hardware_hash(
 
     explode_scratchpad_hard();
 
-    uint64_t* h0 = spad.as_uqword();
-
-    uint64_t al0 = h0[0] ^ h0[4];
-    uint64_t ah0 = h0[1] ^ h0[5];
-    __m128i bx0 = _mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6]);
-
-    uint64_t idx0 = h0[0] ^ h0[4];
+    hard_loop_state s0{spad.as_uqword()};
 
     // Optim - 90% time boundary
-    for (size_t i = 0; i < ITER; i++) {
-        __m128i cx;
-        cx = _mm_load_si128(as_xmm(scratchpad_ptr(idx0)));
-
-        cx = _mm_aesenc_si128(cx, _mm_set_epi64x(ah0, al0));
-
-        _mm_store_si128(as_xmm(scratchpad_ptr(idx0)), _mm_xor_si128(bx0, cx));
-        idx0 = xmm_extract_64(cx);
-        bx0 = cx;
-
-        uint64_t hi, lo, cl, ch;
-        cl = scratchpad_ptr(idx0).as_uqword(0);
-        ch = scratchpad_ptr(idx0).as_uqword(1);
-
-        lo = _umul128(idx0, cl, &hi);
-
-        al0 += hi;
-        ah0 += lo;
-        scratchpad_ptr(idx0).as_uqword(0) = al0;
-        scratchpad_ptr(idx0).as_uqword(1) = ah0;
-        ah0 ^= ch;
-        al0 ^= cl;
-        idx0 = al0;
-
-        if (VERSION > 0) {
-            int64_t n = scratchpad_ptr(idx0).as_qword(0);
-            int32_t d = scratchpad_ptr(idx0).as_dword(2);
-            int64_t q = n / (d | 5);
-            scratchpad_ptr(idx0).as_qword(0) = n ^ q;
-            idx0 = d ^ q;
-        }
-    }
+    for (size_t i = 0; i < ITER; i++)
+        hard_loop_round<MEMORY, VERSION>(lpad.as_byte(), s0);
 
     implode_scratchpad_hard();
 
-    keccakf(spad.as_uqword(), 24);
+    hard_finish(spad, out);
+}
 
-    switch (spad.as_byte(0) & 3) {
-        case 0: blake256_hash((uint8_t*)out, spad.as_byte(), 200); break;
-        case 1: groestl(spad.as_byte(), 200 * 8, (uint8_t*)out); break;
-        case 2: jh_hash(32 * 8, spad.as_byte(), 8 * 200, (uint8_t*)out); break;
-        case 3: skein_hash(8 * 32, spad.as_byte(), 8 * 200, (uint8_t*)out); break;
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+void cn_heavy_hash<MEMORY, ITER, VERSION>::hardware_hash2(
+        cn_heavy_hash& a,
+        cn_heavy_hash& b,
+        const void* in0,
+        size_t len0,
+        void* out0,
+        const void* in1,
+        size_t len1,
+        void* out1) {
+    keccak((const uint8_t*)in0, len0, a.spad.as_byte(), 200);
+    keccak((const uint8_t*)in1, len1, b.spad.as_byte(), 200);
+
+    a.explode_scratchpad_hard();
+    b.explode_scratchpad_hard();
+
+    hard_loop_state s0{a.spad.as_uqword()};
+    hard_loop_state s1{b.spad.as_uqword()};
+
+    // The two rounds are independent, so the CPU can run each one's loads while the other is
+    // stalled waiting on memory.
+    for (size_t i = 0; i < ITER; i++) {
+        hard_loop_round<MEMORY, VERSION>(a.lpad.as_byte(), s0);
+        hard_loop_round<MEMORY, VERSION>(b.lpad.as_byte(), s1);
     }
+
+    a.implode_scratchpad_hard();
+    b.implode_scratchpad_hard();
+
+    hard_finish(a.spad, out0);
+    hard_finish(b.spad, out1);
 }
 
 template class cn_heavy_hash<2 * 1024 * 1024, 0x80000, 0>;
@@ -33,6 +33,7 @@
 #include "crypto-ops.h"
 
 /* sqrt(x) is such an integer y that 0 <= y <= p - 1, y % 2 = 0, and y^2 = x (mod p). */
+#ifndef CRYPTO_OPS_FE51
 /* d = -121665 / 121666 */
 const fe fe_d = {
         -10913610,
@@ -68,8 +69,10 @@ const fe fe_d2 = {
         29715968,
         9444199}; /* 2 * d */
 
+#endif
+
 /* base[i][j] = (j+1)*256^i*B */
-const ge_precomp ge_base[32][8] = {
+const ge_precomp_ref10 ge_base[32][8] = {
         {{{25967493,
            -14356035,
            29566456,
@@ -7751,6 +7754,7 @@ const ge_precomp ge_base[32][8] = {
            18423289,
            4177476}}}};
 
+#ifndef CRYPTO_OPS_FE51
 const ge_precomp ge_Bi[8] = {
         {{25967493,
           -14356035,
@@ -8040,7 +8044,9 @@ const fe fe_fffb4 = {
         -8444712,
         3212926,
         6885324}; /* sqrt(sqrt(-1) * A * (A + 2)) */
+#endif
 const ge_p3 ge_p3_identity = {{0}, {1, 0}, {1, 0}, {0}};
+#ifndef CRYPTO_OPS_FE51
 const ge_p3 ge_p3_H = {
         {7329926,
          -15101362,
@@ -8073,3 +8079,64 @@ const ge_p3 ge_p3_H = {
          3279062,
          14550766,
          -7453428}};
+#else
+
+/* The same constants as above (apart from ge_base, which stays in ref10 form), in 51-bit limbs */
+
+/* d = -121665 / 121666 */
+const fe fe_d = {
+        0x34dca135978a3, 0x1a8283b156ebd, 0x5e7a26001c029, 0x739c663a03cbb, 0x52036cee2b6ff};
+const fe fe_sqrtm1 = {
+        0x61b274a0ea0b0, 0x0d5a5fc8f189d, 0x7ef5e9cbd0c60, 0x78595a6804c9e, 0x2b8324804fc1d};
+const fe fe_d2 = {
+        0x69b9426b2f159, 0x35050762add7a, 0x3cf44c0038052, 0x6738cc7407977, 0x2406d9dc56dff};
+const ge_precomp ge_Bi[8] = {
+        {{0x493c6f58c3b85, 0x0df7181c325f7, 0x0f50b0b3e4cb7, 0x5329385a44c32, 0x07cf9d3a33d4b},
+         {0x03905d740913e, 0x0ba2817d673a2, 0x23e2827f4e67c, 0x133d2e0c21a34, 0x44fd2f9298f81},
+         {0x11205877aaa68, 0x479955893d579, 0x50d66309b67a0, 0x2d42d0dbee5ee, 0x6f117b689f0c6}},
+        {{0x5b0a84cee9730, 0x61d10c97155e4, 0x4059cc8096a10, 0x47a608da8014f, 0x7a164e1b9a80f},
+         {0x11fe8a4fcd265, 0x7bcb8374faacc, 0x52f5af4ef4d4f, 0x5314098f98d10, 0x2ab91587555bd},
+         {0x6933f0dd0d889, 0x44386bb4c4295, 0x3cb6d3162508c, 0x26368b872a2c6, 0x5a2826af12b9b}},
+        {{0x2bc4408a5bb33, 0x078ebdda05442, 0x2ffb112354123, 0x375ee8df5862d, 0x2945ccf146e20},
+         {0x182c3a447d6ba, 0x22964e536eff2, 0x192821f540053, 0x2f9f19e788e5c, 0x154a7e73eb1b5},
+         {0x3dbf1812a8285, 0x0fa17ba3f9797, 0x6f69cb49c3820, 0x34d5a0db3858d, 0x43aabe696b3bb}},
+        {{0x25cd0944ea3bf, 0x75673b81a4d63, 0x150b925d1c0d4, 0x13f38d9294114, 0x461bea69283c9},
+         {0x72c9aaa3221b1, 0x267774474f74d, 0x064b0e9b28085, 0x3f04ef53b27c9, 0x1d6edd5d2e531},
+         {0x36dc801b8b3a2, 0x0e0a7d4935e30, 0x1deb7cecc0d7d, 0x053a94e20dd2c, 0x7a9fbb1c6a0f9}},
+        {{0x6678aa6a8632f, 0x5ea3788d8b365, 0x21bd6d6994279, 0x7ace75919e4e3, 0x34b9ed338add7},
+         {0x6217e039d8064, 0x6dea408337e6d, 0x57ac112628206, 0x647cb65e30473, 0x49c05a51fadc9},
+         {0x4e8bf9045af1b, 0x514e33a45e0d6, 0x7533c5b8bfe0f, 0x583557b7e14c9, 0x73c172021b008}},
+        {{0x700848a802ade, 0x1e04605c4e5f7, 0x5c0d01b9767fb, 0x7d7889f42388b, 0x4275aae2546d8},
+         {0x75b0249864348, 0x52ee11070262b, 0x237ae54fb5acd, 0x3bfd1d03aaab5, 0x18ab598029d5c},
+         {0x32cc5fd6089e9, 0x426505c949b05, 0x46a18880c7ad2, 0x4a4221888ccda, 0x3dc65522b53df}},
+        {{0x0c222a2007f6d, 0x356b79bdb77ee, 0x41ee81efe12ce, 0x120a9bd07097d, 0x234fd7eec346f},
+         {0x7013b327fbf93, 0x1336eeded6a0d, 0x2b565a2bbf3af, 0x253ce89591955, 0x0267882d17602},
+         {0x0a119732ea378, 0x63bf1ba8e2a6c, 0x69f94cc90df9a, 0x431d1779bfc48, 0x497ba6fdaa097}},
+        {{0x6cc0313cfeaa0, 0x1a313848da499, 0x7cb534219230a, 0x39596dedefd60, 0x61e22917f12de},
+         {0x3cd86468ccf0b, 0x48553221ac081, 0x6c9464b4e0a6e, 0x75fba84180403, 0x43b5cd4218d05},
+         {0x2762f9bd0b516, 0x1c6e7fbddcbb3, 0x75909c3ace2bd, 0x42101972d3ec9, 0x511d61210ae4d}}};
+/* -A^2 */
+/* A = 2 * (1 - d) / (1 + d) = 486662 */
+const fe fe_ma2 = {
+        0x7ffc8db3de3c9, 0x7ffffffffffff, 0x7ffffffffffff, 0x7ffffffffffff, 0x7ffffffffffff};
+/* -A */
+const fe fe_ma = {
+        0x7fffffff892e7, 0x7ffffffffffff, 0x7ffffffffffff, 0x7ffffffffffff, 0x7ffffffffffff};
+/* sqrt(-2 * A * (A + 2)) */
+const fe fe_fffb1 = {
+        0x76975321c41ee, 0x517254e71a454, 0x7ec678f465012, 0x58b9054e29ba0, 0x7e71fbefdad61};
+/* sqrt(2 * A * (A + 2)) */
+const fe fe_fffb2 = {
+        0x66483607c9ae0, 0x0c08adefbfa5b, 0x0597ef947780d, 0x67b48ea28dbe0, 0x4d061e0a045a2};
+/* sqrt(-sqrt(-1) * A * (A + 2)) */
+const fe fe_fffb3 = {
+        0x37d8717302c66, 0x1d4b2c8452b03, 0x4368bb50093fd, 0x477dc4aa3201f, 0x674a110d14c20};
+/* sqrt(sqrt(-1) * A * (A + 2)) */
+const fe fe_fffb4 = {
+        0x51903b6b39186, 0x11427e94930a7, 0x3dd0cbbb91bf0, 0x5fc93607a443f, 0x1a43f3031067d};
+const ge_p3 ge_p3_H = {
+        {0x46649386fd873, 0x1d0c4fddf4d0e, 0x73cddc5ab32b3, 0x65c2eab55bf7c, 0x6188ae4072004},
+        {0x137157059658b, 0x633fb9d4555f3, 0x545c9b3ab42b7, 0x39654e7aa20ea, 0x141f9cd30d3a1},
+        {0x0000000000001, 0x0000000000000, 0x0000000000000, 0x0000000000000, 0x0000000000000},
+        {0x6c8160965b85d, 0x6f6cb437a16a2, 0x47e1f8869205f, 0x0c82358720e9a, 0x6391430de06ee}};
+#endif
@@ -65,6 +65,270 @@ uint64_t load_4(const unsigned char* in) {
     return result;
 }
 
+#ifdef CRYPTO_OPS_FE51
+
+/* 51-bit limb field arithmetic, in the style of curve25519-donna-c64.  Field elements are stored
+ * in five unsigned limbs, h = h[0] + 2^51 h[1] + 2^102 h[2] + 2^153 h[3] + 2^204 h[4], and the
+ * products are computed with 128-bit integers, which takes about half the multiplications of the
+ * ref10 code below.
+ *
+ * fe_mul, fe_sq and fe_sq2 leave each limb below 2^51 + 2^18; fe_add and fe_sub don't carry and
+ * so can give limbs up to about 2^54 when combining such values, which is still well inside what
+ * fe_mul and fe_sq can take.  fe_sub and fe_tobytes accept any limb values. */
+
+typedef unsigned __int128 fe_uint128;
+
+static const uint64_t fe_mask51 = (((uint64_t)1) << 51) - 1;
+
+static uint64_t load_8(const unsigned char* in) {
+    return ((uint64_t)load_4(in)) | (((uint64_t)load_4(in + 4)) << 32);
+}
+
+static void fe_0(fe h) {
+    h[0] = 0;
+    h[1] = 0;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = 0;
+}
+
+static void fe_1(fe h) {
+    h[0] = 1;
+    h[1] = 0;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = 0;
+}
+
+static void fe_copy(fe h, const fe f) {
+    h[0] = f[0];
+    h[1] = f[1];
+    h[2] = f[2];
+    h[3] = f[3];
+    h[4] = f[4];
+}
+
+/* Replace f with g if b == 1, leave it alone if b == 0.  b must be 0 or 1. */
+static void fe_cmov(fe f, const fe g, unsigned int b) {
+    uint64_t mask;
+    assert((((b - 1) & ~b) | ((b - 2) & ~(b - 1))) == (unsigned int)-1);
+    mask = -(uint64_t)b;
+    f[0] ^= (f[0] ^ g[0]) & mask;
+    f[1] ^= (f[1] ^ g[1]) & mask;
+    f[2] ^= (f[2] ^ g[2]) & mask;
+    f[3] ^= (f[3] ^ g[3]) & mask;
+    f[4] ^= (f[4] ^ g[4]) & mask;
+}
+
+void fe_add(fe h, const fe f, const fe g) {
+    h[0] = f[0] + g[0];
+    h[1] = f[1] + g[1];
+    h[2] = f[2] + g[2];
+    h[3] = f[3] + g[3];
+    h[4] = f[4] + g[4];
+}
+
+/* h = f - g, computed as f + 2p - g after carrying g so that each of its limbs is below those of
+ * 2p (2^52 - 38, 2^52 - 2, ...). */
+static void fe_sub(fe h, const fe f, const fe g) {
+    uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    g1 += g0 >> 51;
+    g0 &= fe_mask51;
+    g2 += g1 >> 51;
+    g1 &= fe_mask51;
+    g3 += g2 >> 51;
+    g2 &= fe_mask51;
+    g4 += g3 >> 51;
+    g3 &= fe_mask51;
+    g0 += 19 * (g4 >> 51);
+    g4 &= fe_mask51;
+    h[0] = f[0] + 0xfffffffffffdaULL - g0;
+    h[1] = f[1] + 0xffffffffffffeULL - g1;
+    h[2] = f[2] + 0xffffffffffffeULL - g2;
+    h[3] = f[3] + 0xffffffffffffeULL - g3;
+    h[4] = f[4] + 0xffffffffffffeULL - g4;
+}
+
+static void fe_neg(fe h, const fe f) {
+    fe zero;
+    fe_0(zero);
+    fe_sub(h, zero, f);
+}
+
+/* Carries the five 128-bit column sums of a product into h. */
+static void fe_carry_wide(
+        fe h, fe_uint128 r0, fe_uint128 r1, fe_uint128 r2, fe_uint128 r3, fe_uint128 r4) {
+    fe_uint128 c;
+    r1 += r0 >> 51;
+    r2 += r1 >> 51;
+    r3 += r2 >> 51;
+    r4 += r3 >> 51;
+    c = (r4 >> 51) * 19 + ((uint64_t)r0 & fe_mask51);
+    h[0] = (uint64_t)c & fe_mask51;
+    h[1] = ((uint64_t)r1 & fe_mask51) + (uint64_t)(c >> 51);
+    h[2] = (uint64_t)r2 & fe_mask51;
+    h[3] = (uint64_t)r3 & fe_mask51;
+    h[4] = (uint64_t)r4 & fe_mask51;
+}
+
+static void fe_mul(fe h, const fe f, const fe g) {
+    uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+    fe_uint128 r0, r1, r2, r3, r4;
+
+    r0 = (fe_uint128)f0 * g0 + (fe_uint128)f1 * g4_19 + (fe_uint128)f2 * g3_19 +
+         (fe_uint128)f3 * g2_19 + (fe_uint128)f4 * g1_19;
+    r1 = (fe_uint128)f0 * g1 + (fe_uint128)f1 * g0 + (fe_uint128)f2 * g4_19 +
+         (fe_uint128)f3 * g3_19 + (fe_uint128)f4 * g2_19;
+    r2 = (fe_uint128)f0 * g2 + (fe_uint128)f1 * g1 + (fe_uint128)f2 * g0 +
+         (fe_uint128)f3 * g4_19 + (fe_uint128)f4 * g3_19;
+    r3 = (fe_uint128)f0 * g3 + (fe_uint128)f1 * g2 + (fe_uint128)f2 * g1 + (fe_uint128)f3 * g0 +
+         (fe_uint128)f4 * g4_19;
+    r4 = (fe_uint128)f0 * g4 + (fe_uint128)f1 * g3 + (fe_uint128)f2 * g2 + (fe_uint128)f3 * g1 +
+         (fe_uint128)f4 * g0;
+
+    fe_carry_wide(h, r0, r1, r2, r3, r4);
+}
+
+/* h = f^2, doubled if shift is 1 */
+static void fe_sq_shift(fe h, const fe f, int shift) {
+    uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1, f2_2 = 2 * f2, f3_2 = 2 * f3;
+    uint64_t f3_19 = 19 * f3, f4_19 = 19 * f4;
+    fe_uint128 r0, r1, r2, r3, r4;
+
+    r0 = (fe_uint128)f0 * f0 + (fe_uint128)f1_2 * f4_19 + (fe_uint128)f2_2 * f3_19;
+    r1 = (fe_uint128)f0_2 * f1 + (fe_uint128)f2_2 * f4_19 + (fe_uint128)f3 * f3_19;
+    r2 = (fe_uint128)f0_2 * f2 + (fe_uint128)f1 * f1 + (fe_uint128)f3_2 * f4_19;
+    r3 = (fe_uint128)f0_2 * f3 + (fe_uint128)f1_2 * f2 + (fe_uint128)f4 * f4_19;
+    r4 = (fe_uint128)f0_2 * f4 + (fe_uint128)f1_2 * f3 + (fe_uint128)f2 * f2;
+
+    fe_carry_wide(h, r0 << shift, r1 << shift, r2 << shift, r3 << shift, r4 << shift);
+}
+
+static void fe_sq(fe h, const fe f) {
+    fe_sq_shift(h, f, 0);
+}
+
+/* h = 2 * f * f */
+static void fe_sq2(fe h, const fe f) {
+    fe_sq_shift(h, f, 1);
+}
+
+/* Writes the fully reduced value of h (whatever its limb values) as 32 little-endian bytes. */
+void fe_tobytes(unsigned char* s, const fe h) {
+    uint64_t t0 = h[0], t1 = h[1], t2 = h[2], t3 = h[3], t4 = h[4];
+    uint64_t w[4];
+    int i, j;
+
+#define FE_CARRY51         \
+    t1 += t0 >> 51;        \
+    t0 &= fe_mask51;       \
+    t2 += t1 >> 51;        \
+    t1 &= fe_mask51;       \
+    t3 += t2 >> 51;        \
+    t2 &= fe_mask51;       \
+    t4 += t3 >> 51;        \
+    t3 &= fe_mask51;       \
+    t0 += 19 * (t4 >> 51); \
+    t4 &= fe_mask51
+
+    /* Two carry passes give a value in [0, 2^255 - 1] with each limb below 2^51, which is either
+     * already reduced (below 2^255 - 19) or else needs p subtracted.  Adding 19 makes the second
+     * case overflow into bit 255, which the third pass folds into +19: so either way t + 19 is now
+     * in t, offset by 19, and adding 2^255 - 19 and dropping bit 255 removes the offset. */
+    FE_CARRY51;
+    FE_CARRY51;
+    t0 += 19;
+    FE_CARRY51;
+    t0 += (((uint64_t)1) << 51) - 19;
+    t1 += (((uint64_t)1) << 51) - 1;
+    t2 += (((uint64_t)1) << 51) - 1;
+    t3 += (((uint64_t)1) << 51) - 1;
+    t4 += (((uint64_t)1) << 51) - 1;
+    t1 += t0 >> 51;
+    t0 &= fe_mask51;
+    t2 += t1 >> 51;
+    t1 &= fe_mask51;
+    t3 += t2 >> 51;
+    t2 &= fe_mask51;
+    t4 += t3 >> 51;
+    t3 &= fe_mask51;
+    t4 &= fe_mask51;
+
+#undef FE_CARRY51
+
+    w[0] = t0 | (t1 << 51);
+    w[1] = (t1 >> 13) | (t2 << 38);
+    w[2] = (t2 >> 26) | (t3 << 25);
+    w[3] = (t3 >> 39) | (t4 << 12);
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 8; j++)
+            s[8 * i + j] = (unsigned char)(w[i] >> (8 * j));
+}
+
+/* Loads the low 255 bits of s into h, returning -1 (and leaving h unset) if they are not a
+ * canonical encoding, i.e. are p or larger. */
+static int fe_frombytes_canonical(fe h, const unsigned char* s) {
+    uint64_t w0 = load_8(s), w1 = load_8(s + 8), w2 = load_8(s + 16), w3 = load_8(s + 24);
+    uint64_t h0 = w0 & fe_mask51;
+    uint64_t h1 = ((w0 >> 51) | (w1 << 13)) & fe_mask51;
+    uint64_t h2 = ((w1 >> 38) | (w2 << 26)) & fe_mask51;
+    uint64_t h3 = ((w2 >> 25) | (w3 << 39)) & fe_mask51;
+    uint64_t h4 = (w3 >> 12) & fe_mask51;
+
+    if (h4 == fe_mask51 && h3 == fe_mask51 && h2 == fe_mask51 && h1 == fe_mask51 &&
+        h0 >= fe_mask51 - 18) {
+        return -1;
+    }
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+    h[3] = h3;
+    h[4] = h4;
+    return 0;
+}
+
+/* Loads all 256 bits of s (as an unreduced value) into h. */
+static void fe_frombytes_full(fe h, const unsigned char* s) {
+    uint64_t w0 = load_8(s), w1 = load_8(s + 8), w2 = load_8(s + 16), w3 = load_8(s + 24);
+    h[0] = w0 & fe_mask51;
+    h[1] = ((w0 >> 51) | (w1 << 13)) & fe_mask51;
+    h[2] = ((w1 >> 38) | (w2 << 26)) & fe_mask51;
+    h[3] = ((w2 >> 25) | (w3 << 39)) & fe_mask51;
+    h[4] = w3 >> 12;
+}
+
+/* Converts a ref10 field element (as used by the ge_base table) into 51-bit limbs.  Each pair
+ * of ref10 limbs covers 51 bits, and adding 2p makes the signed combinations non-negative. */
+static void fe_from_ref10(fe h, const fe_ref10 f) {
+    int i;
+    for (i = 0; i < 5; i++)
+        h[i] = (uint64_t)((int64_t)f[2 * i] + (int64_t)f[2 * i + 1] * (1 << 26)) +
+               (i == 0 ? 0xfffffffffffdaULL : 0xffffffffffffeULL);
+    h[1] += h[0] >> 51;
+    h[0] &= fe_mask51;
+    h[2] += h[1] >> 51;
+    h[1] &= fe_mask51;
+    h[3] += h[2] >> 51;
+    h[2] &= fe_mask51;
+    h[4] += h[3] >> 51;
+    h[3] &= fe_mask51;
+    h[0] += 19 * (h[4] >> 51);
+    h[4] &= fe_mask51;
+}
+
+static void fe_ref10_cmov(fe_ref10 f, const fe_ref10 g, unsigned int b) {
+    int32_t mask = -(int32_t)b;
+    int i;
+    for (i = 0; i < 10; i++)
+        f[i] ^= (f[i] ^ g[i]) & mask;
+}
+
+#else /* !CRYPTO_OPS_FE51 */
+
 /* From fe_0.c */
 
 /*
@@ -253,6 +517,8 @@ static void fe_copy(fe h, const fe f) {
     h[9] = f9;
 }
 
+#endif /* CRYPTO_OPS_FE51 */
+
 /* From fe_invert.c */
 
 void fe_invert(fe out, const fe z) {
@@ -343,6 +609,8 @@ static int fe_isnonzero(const fe f) {
            1;
 }
 
+#ifndef CRYPTO_OPS_FE51
+
 /* From fe_mul.c */
 
 /*
@@ -1219,6 +1487,153 @@ void fe_tobytes(unsigned char* s, const fe h) {
     s[31] = h9 >> 18;
 }
 
+/* From fe_frombytes.c, modified */
+
+/* Loads the low 255 bits of s into h, returning -1 (and leaving h unset) if they are not a
+ * canonical encoding, i.e. are p or larger. */
+static int fe_frombytes_canonical(fe h, const unsigned char* s) {
+    int64_t h0 = load_4(s);
+    int64_t h1 = load_3(s + 4) << 6;
+    int64_t h2 = load_3(s + 7) << 5;
+    int64_t h3 = load_3(s + 10) << 3;
+    int64_t h4 = load_3(s + 13) << 2;
+    int64_t h5 = load_4(s + 16);
+    int64_t h6 = load_3(s + 20) << 7;
+    int64_t h7 = load_3(s + 23) << 5;
+    int64_t h8 = load_3(s + 26) << 4;
+    int64_t h9 = (load_3(s + 29) & 8388607) << 2;
+    int64_t carry0;
+    int64_t carry1;
+    int64_t carry2;
+    int64_t carry3;
+    int64_t carry4;
+    int64_t carry5;
+    int64_t carry6;
+    int64_t carry7;
+    int64_t carry8;
+    int64_t carry9;
+
+    /* Validate the number to be canonical */
+    if (h9 == 33554428 && h8 == 268435440 && h7 == 536870880 && h6 == 2147483520 &&
+        h5 == 4294967295 && h4 == 67108860 && h3 == 134217720 && h2 == 536870880 &&
+        h1 == 1073741760 && h0 >= 4294967277) {
+        return -1;
+    }
+
+    carry9 = (h9 + (int64_t)(1 << 24)) >> 25;
+    h0 += carry9 * 19;
+    h9 -= carry9 << 25;
+    carry1 = (h1 + (int64_t)(1 << 24)) >> 25;
+    h2 += carry1;
+    h1 -= carry1 << 25;
+    carry3 = (h3 + (int64_t)(1 << 24)) >> 25;
+    h4 += carry3;
+    h3 -= carry3 << 25;
+    carry5 = (h5 + (int64_t)(1 << 24)) >> 25;
+    h6 += carry5;
+    h5 -= carry5 << 25;
+    carry7 = (h7 + (int64_t)(1 << 24)) >> 25;
+    h8 += carry7;
+    h7 -= carry7 << 25;
+
+    carry0 = (h0 + (int64_t)(1 << 25)) >> 26;
+    h1 += carry0;
+    h0 -= carry0 << 26;
+    carry2 = (h2 + (int64_t)(1 << 25)) >> 26;
+    h3 += carry2;
+    h2 -= carry2 << 26;
+    carry4 = (h4 + (int64_t)(1 << 25)) >> 26;
+    h5 += carry4;
+    h4 -= carry4 << 26;
+    carry6 = (h6 + (int64_t)(1 << 25)) >> 26;
+    h7 += carry6;
+    h6 -= carry6 << 26;
+    carry8 = (h8 + (int64_t)(1 << 25)) >> 26;
+    h9 += carry8;
+    h8 -= carry8 << 26;
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+    h[3] = h3;
+    h[4] = h4;
+    h[5] = h5;
+    h[6] = h6;
+    h[7] = h7;
+    h[8] = h8;
+    h[9] = h9;
+    return 0;
+}
+
+/* Loads all 256 bits of s (as an unreduced value) into h. */
+static void fe_frombytes_full(fe h, const unsigned char* s) {
+    int64_t h0 = load_4(s);
+    int64_t h1 = load_3(s + 4) << 6;
+    int64_t h2 = load_3(s + 7) << 5;
+    int64_t h3 = load_3(s + 10) << 3;
+    int64_t h4 = load_3(s + 13) << 2;
+    int64_t h5 = load_4(s + 16);
+    int64_t h6 = load_3(s + 20) << 7;
+    int64_t h7 = load_3(s + 23) << 5;
+    int64_t h8 = load_3(s + 26) << 4;
+    int64_t h9 = load_3(s + 29) << 2;
+    int64_t carry0;
+    int64_t carry1;
+    int64_t carry2;
+    int64_t carry3;
+    int64_t carry4;
+    int64_t carry5;
+    int64_t carry6;
+    int64_t carry7;
+    int64_t carry8;
+    int64_t carry9;
+
+    carry9 = (h9 + (int64_t)(1 << 24)) >> 25;
+    h0 += carry9 * 19;
+    h9 -= carry9 << 25;
+    carry1 = (h1 + (int64_t)(1 << 24)) >> 25;
+    h2 += carry1;
+    h1 -= carry1 << 25;
+    carry3 = (h3 + (int64_t)(1 << 24)) >> 25;
+    h4 += carry3;
+    h3 -= carry3 << 25;
+    carry5 = (h5 + (int64_t)(1 << 24)) >> 25;
+    h6 += carry5;
+    h5 -= carry5 << 25;
+    carry7 = (h7 + (int64_t)(1 << 24)) >> 25;
+    h8 += carry7;
+    h7 -= carry7 << 25;
+
+    carry0 = (h0 + (int64_t)(1 << 25)) >> 26;
+    h1 += carry0;
+    h0 -= carry0 << 26;
+    carry2 = (h2 + (int64_t)(1 << 25)) >> 26;
+    h3 += carry2;
+    h2 -= carry2 << 26;
+    carry4 = (h4 + (int64_t)(1 << 25)) >> 26;
+    h5 += carry4;
+    h4 -= carry4 << 26;
+    carry6 = (h6 + (int64_t)(1 << 25)) >> 26;
+    h7 += carry6;
+    h6 -= carry6 << 26;
+    carry8 = (h8 + (int64_t)(1 << 25)) >> 26;
+    h9 += carry8;
+    h8 -= carry8 << 26;
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+    h[3] = h3;
+    h[4] = h4;
+    h[5] = h5;
+    h[6] = h6;
+    h[7] = h7;
+    h[8] = h8;
+    h[9] = h9;
+}
+
+#endif /* !CRYPTO_OPS_FE51 */
+
 /* From ge_add.c */
 
 void ge_add(ge_p1p1* r, const ge_p3* p, const ge_cached* q) {
@@ -1462,81 +1877,10 @@ int ge_frombytes_vartime(ge_p3* h, const unsigned char* s) {
     fe vxx;
     fe check;
 
-    /* From fe_frombytes.c */
-
-    int64_t h0 = load_4(s);
-    int64_t h1 = load_3(s + 4) << 6;
-    int64_t h2 = load_3(s + 7) << 5;
-    int64_t h3 = load_3(s + 10) << 3;
-    int64_t h4 = load_3(s + 13) << 2;
-    int64_t h5 = load_4(s + 16);
-    int64_t h6 = load_3(s + 20) << 7;
-    int64_t h7 = load_3(s + 23) << 5;
-    int64_t h8 = load_3(s + 26) << 4;
-    int64_t h9 = (load_3(s + 29) & 8388607) << 2;
-    int64_t carry0;
-    int64_t carry1;
-    int64_t carry2;
-    int64_t carry3;
-    int64_t carry4;
-    int64_t carry5;
-    int64_t carry6;
-    int64_t carry7;
-    int64_t carry8;
-    int64_t carry9;
-
-    /* Validate the number to be canonical */
-    if (h9 == 33554428 && h8 == 268435440 && h7 == 536870880 && h6 == 2147483520 &&
-        h5 == 4294967295 && h4 == 67108860 && h3 == 134217720 && h2 == 536870880 &&
-        h1 == 1073741760 && h0 >= 4294967277) {
+    if (fe_frombytes_canonical(h->Y, s) != 0) {
         return -1;
     }
 
-    carry9 = (h9 + (int64_t)(1 << 24)) >> 25;
-    h0 += carry9 * 19;
-    h9 -= carry9 << 25;
-    carry1 = (h1 + (int64_t)(1 << 24)) >> 25;
-    h2 += carry1;
-    h1 -= carry1 << 25;
-    carry3 = (h3 + (int64_t)(1 << 24)) >> 25;
-    h4 += carry3;
-    h3 -= carry3 << 25;
-    carry5 = (h5 + (int64_t)(1 << 24)) >> 25;
-    h6 += carry5;
-    h5 -= carry5 << 25;
-    carry7 = (h7 + (int64_t)(1 << 24)) >> 25;
-    h8 += carry7;
-    h7 -= carry7 << 25;
-
-    carry0 = (h0 + (int64_t)(1 << 25)) >> 26;
-    h1 += carry0;
-    h0 -= carry0 << 26;
-    carry2 = (h2 + (int64_t)(1 << 25)) >> 26;
-    h3 += carry2;
-    h2 -= carry2 << 26;
-    carry4 = (h4 + (int64_t)(1 << 25)) >> 26;
-    h5 += carry4;
-    h4 -= carry4 << 26;
-    carry6 = (h6 + (int64_t)(1 << 25)) >> 26;
-    h7 += carry6;
-    h6 -= carry6 << 26;
-    carry8 = (h8 + (int64_t)(1 << 25)) >> 26;
-    h9 += carry8;
-    h8 -= carry8 << 26;
-
-    h->Y[0] = h0;
-    h->Y[1] = h1;
-    h->Y[2] = h2;
-    h->Y[3] = h3;
-    h->Y[4] = h4;
-    h->Y[5] = h5;
-    h->Y[6] = h6;
-    h->Y[7] = h7;
-    h->Y[8] = h8;
-    h->Y[9] = h9;
-
-    /* End fe_frombytes.c */
-
     fe_1(h->Z);
     fe_sq(u, h->Y);
     fe_mul(v, u, fe_d);
@@ -1720,6 +2064,7 @@ void ge_p3_tobytes(unsigned char* s, const ge_p3* h) {
     s[31] ^= fe_isnegative(x) << 7;
 }
 
+#ifndef CRYPTO_OPS_FE51
 /* From ge_precomp_0.c */
 
 static void ge_precomp_0(ge_precomp* h) {
@@ -1727,6 +2072,7 @@ static void ge_precomp_0(ge_precomp* h) {
     fe_1(h->yminusx);
     fe_0(h->xy2d);
 }
+#endif
 
 /* From ge_scalarmult_base.c */
 
@@ -1752,20 +2098,50 @@ static void ge_precomp_cmov(ge_precomp* t, const ge_precomp* u, unsigned char b)
     fe_cmov(t->xy2d, u->xy2d, b);
 }
 
+#ifdef CRYPTO_OPS_FE51
+static void ge_precomp_ref10_0(ge_precomp_ref10* h) {
+    int i;
+    for (i = 0; i < 10; i++) {
+        h->yplusx[i] = i == 0;
+        h->yminusx[i] = i == 0;
+        h->xy2d[i] = 0;
+    }
+}
+
+static void ge_precomp_ref10_cmov(
+        ge_precomp_ref10* t, const ge_precomp_ref10* u, unsigned char b) {
+    fe_ref10_cmov(t->yplusx, u->yplusx, b);
+    fe_ref10_cmov(t->yminusx, u->yminusx, b);
+    fe_ref10_cmov(t->xy2d, u->xy2d, b);
+}
+
+static void ge_precomp_from_ref10(ge_precomp* t, const ge_precomp_ref10* u) {
+    fe_from_ref10(t->yplusx, u->yplusx);
+    fe_from_ref10(t->yminusx, u->yminusx);
+    fe_from_ref10(t->xy2d, u->xy2d);
+}
+#else
+#define ge_precomp_ref10_0 ge_precomp_0
+#define ge_precomp_ref10_cmov ge_precomp_cmov
+#define ge_precomp_from_ref10(t, u) (*(t) = *(u))
+#endif
+
 static void select(ge_precomp* t, int pos, signed char b) {
+    ge_precomp_ref10 r;
     ge_precomp minust;
     unsigned char bnegative = negative(b);
     unsigned char babs = b - (((-bnegative) & b) << 1);
 
-    ge_precomp_0(t);
-    ge_precomp_cmov(t, &ge_base[pos][0], equal(babs, 1));
-    ge_precomp_cmov(t, &ge_base[pos][1], equal(babs, 2));
-    ge_precomp_cmov(t, &ge_base[pos][2], equal(babs, 3));
-    ge_precomp_cmov(t, &ge_base[pos][3], equal(babs, 4));
-    ge_precomp_cmov(t, &ge_base[pos][4], equal(babs, 5));
-    ge_precomp_cmov(t, &ge_base[pos][5], equal(babs, 6));
-    ge_precomp_cmov(t, &ge_base[pos][6], equal(babs, 7));
-    ge_precomp_cmov(t, &ge_base[pos][7], equal(babs, 8));
+    ge_precomp_ref10_0(&r);
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][0], equal(babs, 1));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][1], equal(babs, 2));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][2], equal(babs, 3));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][3], equal(babs, 4));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][4], equal(babs, 5));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][5], equal(babs, 6));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][6], equal(babs, 7));
+    ge_precomp_ref10_cmov(&r, &ge_base[pos][7], equal(babs, 8));
+    ge_precomp_from_ref10(t, &r);
     fe_copy(minust.yplusx, t->yminusx);
     fe_copy(minust.yminusx, t->yplusx);
     fe_neg(minust.xy2d, t->xy2d);
@@ -1864,6 +2240,37 @@ void ge_tobytes(unsigned char* s, const ge_p2* h) {
     s[31] ^= fe_isnegative(x) << 7;
 }
 
+void ge_tobytes_batch(unsigned char* s, const ge_p2* h, fe* tmp, size_t n) {
+    fe inv;
+    fe recip;
+    fe x;
+    fe y;
+    size_t i;
+
+    if (n == 0)
+        return;
+
+    /* Montgomery's trick: tmp[i] = Z_0 * ... * Z_i, so that after inverting the full product we
+     * can peel off each 1/Z_i with two multiplications. */
+    fe_copy(tmp[0], h[0].Z);
+    for (i = 1; i < n; i++)
+        fe_mul(tmp[i], tmp[i - 1], h[i].Z);
+
+    fe_invert(inv, tmp[n - 1]);
+
+    for (i = n; i-- > 0;) {
+        if (i > 0) {
+            fe_mul(recip, inv, tmp[i - 1]);
+            fe_mul(inv, inv, h[i].Z);
+        } else
+            fe_copy(recip, inv);
+        fe_mul(x, h[i].X, recip);
+        fe_mul(y, h[i].Y, recip);
+        fe_tobytes(s + 32 * i, y);
+        s[32 * i + 31] ^= fe_isnegative(x) << 7;
+    }
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -2278,12 +2685,8 @@ static void ge_cached_cmov(ge_cached* t, const ge_cached* u, unsigned char b) {
 }
 
 /* Assumes that a[31] <= 127 */
-void ge_scalarmult(ge_p2* r, const unsigned char* a, const ge_p3* A) {
-    signed char e[64];
+void ge_scalar_recode(signed char* e, const unsigned char* a) {
     int carry, carry2, i;
-    ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
-    ge_p1p1 t;
-    ge_p3 u;
 
     carry = 0; /* 0..1 */
     for (i = 0; i < 31; i++) {
@@ -2297,6 +2700,13 @@ void ge_scalarmult(ge_p2* r, const unsigned char* a, const ge_p3* A) {
     carry2 = (carry + 8) >> 4;     /* 0..8 */
     e[62] = carry - (carry2 << 4); /* -8..7 */
     e[63] = carry2;                /* 0..8 */
+}
+
+void ge_scalarmult_recoded(ge_p2* r, const signed char* e, const ge_p3* A) {
+    int i;
+    ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+    ge_p1p1 t;
+    ge_p3 u;
 
     ge_p3_to_cached(&Ai[0], A);
     for (i = 0; i < 7; i++) {
@@ -2305,20 +2715,24 @@ void ge_scalarmult(ge_p2* r, const unsigned char* a, const ge_p3* A) {
         ge_p3_to_cached(&Ai[i + 1], &u);
     }
 
-    ge_p2_0(r);
     for (i = 63; i >= 0; i--) {
         signed char b = e[i];
         unsigned char bnegative = negative(b);
         unsigned char babs = b - (((-bnegative) & b) << 1);
         ge_cached cur, minuscur;
-        ge_p2_dbl(&t, r);
-        ge_p1p1_to_p2(r, &t);
-        ge_p2_dbl(&t, r);
-        ge_p1p1_to_p2(r, &t);
-        ge_p2_dbl(&t, r);
-        ge_p1p1_to_p2(r, &t);
-        ge_p2_dbl(&t, r);
-        ge_p1p1_to_p3(&u, &t);
+        if (i == 63) {
+            /* Nothing to double yet: start from the identity */
+            ge_p3_0(&u);
+        } else {
+            ge_p2_dbl(&t, r);
+            ge_p1p1_to_p2(r, &t);
+            ge_p2_dbl(&t, r);
+            ge_p1p1_to_p2(r, &t);
+            ge_p2_dbl(&t, r);
+            ge_p1p1_to_p2(r, &t);
+            ge_p2_dbl(&t, r);
+            ge_p1p1_to_p3(&u, &t);
+        }
         ge_cached_0(&cur);
         ge_cached_cmov(&cur, &Ai[0], equal(babs, 1));
         ge_cached_cmov(&cur, &Ai[1], equal(babs, 2));
@@ -2338,6 +2752,12 @@ void ge_scalarmult(ge_p2* r, const unsigned char* a, const ge_p3* A) {
     }
 }
 
+void ge_scalarmult(ge_p2* r, const unsigned char* a, const ge_p3* A) {
+    signed char e[64];
+    ge_scalar_recode(e, a);
+    ge_scalarmult_recoded(r, e, A);
+}
+
 void ge_scalarmult_p3(ge_p3* r3, const unsigned char* a, const ge_p3* A) {
     signed char e[64];
     int carry, carry2, i;
@@ -2579,73 +2999,7 @@ void ge_fromfe_frombytes_vartime(ge_p2* r, const unsigned char* s) {
     fe u, v, w, x, y, z;
     unsigned char sign;
 
-    /* From fe_frombytes.c */
-
-    int64_t h0 = load_4(s);
-    int64_t h1 = load_3(s + 4) << 6;
-    int64_t h2 = load_3(s + 7) << 5;
-    int64_t h3 = load_3(s + 10) << 3;
-    int64_t h4 = load_3(s + 13) << 2;
-    int64_t h5 = load_4(s + 16);
-    int64_t h6 = load_3(s + 20) << 7;
-    int64_t h7 = load_3(s + 23) << 5;
-    int64_t h8 = load_3(s + 26) << 4;
-    int64_t h9 = load_3(s + 29) << 2;
-    int64_t carry0;
-    int64_t carry1;
-    int64_t carry2;
-    int64_t carry3;
-    int64_t carry4;
-    int64_t carry5;
-    int64_t carry6;
-    int64_t carry7;
-    int64_t carry8;
-    int64_t carry9;
-
-    carry9 = (h9 + (int64_t)(1 << 24)) >> 25;
-    h0 += carry9 * 19;
-    h9 -= carry9 << 25;
-    carry1 = (h1 + (int64_t)(1 << 24)) >> 25;
-    h2 += carry1;
-    h1 -= carry1 << 25;
-    carry3 = (h3 + (int64_t)(1 << 24)) >> 25;
-    h4 += carry3;
-    h3 -= carry3 << 25;
-    carry5 = (h5 + (int64_t)(1 << 24)) >> 25;
-    h6 += carry5;
-    h5 -= carry5 << 25;
-    carry7 = (h7 + (int64_t)(1 << 24)) >> 25;
-    h8 += carry7;
-    h7 -= carry7 << 25;
-
-    carry0 = (h0 + (int64_t)(1 << 25)) >> 26;
-    h1 += carry0;
-    h0 -= carry0 << 26;
-    carry2 = (h2 + (int64_t)(1 << 25)) >> 26;
-    h3 += carry2;
-    h2 -= carry2 << 26;
-    carry4 = (h4 + (int64_t)(1 << 25)) >> 26;
-    h5 += carry4;
-    h4 -= carry4 << 26;
-    carry6 = (h6 + (int64_t)(1 << 25)) >> 26;
-    h7 += carry6;
-    h6 -= carry6 << 26;
-    carry8 = (h8 + (int64_t)(1 << 25)) >> 26;
-    h9 += carry8;
-    h8 -= carry8 << 26;
-
-    u[0] = h0;
-    u[1] = h1;
-    u[2] = h2;
-    u[3] = h3;
-    u[4] = h4;
-    u[5] = h5;
-    u[6] = h6;
-    u[7] = h7;
-    u[8] = h8;
-    u[9] = h9;
-
-    /* End fe_frombytes.c */
+    fe_frombytes_full(u, s);
 
     fe_sq2(v, u); /* 2 * u^2 */
     fe_1(w);
@@ -4771,13 +5125,11 @@ int sc_isnonzero(const unsigned char* s) {
 }
 
 int ge_p3_is_point_at_infinity(const ge_p3* p) {
-    // X = 0 and Y == Z
-    int n;
-    for (n = 0; n < 10; ++n) {
-        if (p->X[n] | p->T[n])
-            return 0;
-        if (p->Y[n] != p->Z[n])
-            return 0;
-    }
-    return 1;
+    // X = 0 and Y == Z.  This compares the reduced values, as field elements (particularly the
+    // 51-bit ones, where fe_sub doesn't carry) can have more than one representation.
+    fe y_minus_z;
+    if (fe_isnonzero(p->X) || fe_isnonzero(p->T))
+        return 0;
+    fe_sub(y_minus_z, p->Y, p->Z);
+    return !fe_isnonzero(y_minus_z);
 }
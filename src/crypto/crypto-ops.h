@@ -29,11 +29,23 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 /* From fe.h */
 
+/* Field elements use 5 unsigned limbs of 51 bits when the compiler has a 128-bit integer type for
+ * the products (which is considerably faster on 64-bit CPUs), and ref10's 10 signed limbs of 26
+ * and 25 bits otherwise, or if CRYPTO_OPS_REF10 is defined.  The representation is private to
+ * crypto-ops: other code should only treat a fe as opaque storage.  The ge_base table is kept in
+ * ref10 form either way, and converted as entries are selected from it. */
+#if defined(__SIZEOF_INT128__) && !defined(CRYPTO_OPS_REF10)
+#define CRYPTO_OPS_FE51
+typedef uint64_t fe[5];
+#else
 typedef int32_t fe[10];
+#endif
+typedef int32_t fe_ref10[10];
 
 /* From ge.h */
 
@@ -63,6 +75,16 @@ typedef struct {
     fe xy2d;
 } ge_precomp;
 
+#ifdef CRYPTO_OPS_FE51
+typedef struct {
+    fe_ref10 yplusx;
+    fe_ref10 yminusx;
+    fe_ref10 xy2d;
+} ge_precomp_ref10;
+#else
+typedef ge_precomp ge_precomp_ref10;
+#endif
+
 typedef struct {
     fe YplusX;
     fe YminusX;
@@ -124,12 +146,15 @@ void ge_p3_tobytes(unsigned char*, const ge_p3*);
 
 /* From ge_scalarmult_base.c */
 
-extern const ge_precomp ge_base[32][8];
+extern const ge_precomp_ref10 ge_base[32][8];
 void ge_scalarmult_base(ge_p3*, const unsigned char*);
 
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char*, const ge_p2*);
+/* Same as calling ge_tobytes on each of the n points (writing 32*n bytes to s), but using a single
+ * field inversion for all of them.  tmp must have room for n field elements. */
+void ge_tobytes_batch(unsigned char* s, const ge_p2* h, fe* tmp, size_t n);
 
 /* From sc_reduce.c */
 
@@ -138,6 +163,10 @@ void sc_reduce(unsigned char*);
 /* New code */
 
 void ge_scalarmult(ge_p2*, const unsigned char*, const ge_p3*);
+/* ge_scalarmult split in two, for multiplying many points by the same scalar: the first recodes
+ * the scalar (with a[31] <= 128) into 64 signed radix-16 digits, the second does the multiply. */
+void ge_scalar_recode(signed char*, const unsigned char*);
+void ge_scalarmult_recoded(ge_p2*, const signed char*, const ge_p3*);
 void ge_scalarmult_p3(ge_p3*, const unsigned char*, const ge_p3*);
 void ge_double_scalarmult_precomp_vartime(
         ge_p2*, const unsigned char*, const ge_p3*, const unsigned char*, const ge_dsmp);
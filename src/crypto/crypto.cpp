@@ -215,6 +215,96 @@ bool generate_key_derivation(
     return true;
 }
 
+// Decodes each of `keys1` and encodes the point that `f(p2, p3, i)` computes from the i-th into
+// results[i] (left null where the key isn't a point), with one field inversion for all of them.
+template <typename Result, typename F>
+static bool encode_points_batch(
+        const std::vector<public_key>& keys1, std::vector<Result>& results, F&& f) {
+    const size_t n = keys1.size();
+    results.assign(n, Result{});
+
+    std::vector<ge_p2> points;
+    std::vector<size_t> index;
+    points.reserve(n);
+    index.reserve(n);
+    bool all_valid = true;
+    for (size_t i = 0; i < n; i++) {
+        ge_p3 point;
+        if (ge_frombytes_vartime(&point, keys1[i].data()) != 0) {
+            all_valid = false;
+            continue;
+        }
+        f(points.emplace_back(), point, i);
+        index.push_back(i);
+    }
+
+    if (points.size() == 1)
+        ge_tobytes(results[index[0]].data(), &points[0]);
+    else if (!points.empty()) {
+        auto tmp = std::make_unique<fe[]>(points.size());
+        std::vector<unsigned char> out(32 * points.size());
+        ge_tobytes_batch(out.data(), points.data(), tmp.get(), points.size());
+        for (size_t j = 0; j < index.size(); j++)
+            std::memcpy(results[index[j]].data(), out.data() + 32 * j, 32);
+    }
+    return all_valid;
+}
+
+bool generate_key_derivations(
+        const std::vector<public_key>& keys1,
+        const secret_key& key2,
+        std::vector<key_derivation>& derivations) {
+    assert(sc_check(key2.data()) == 0);
+    return encode_points_batch(
+            keys1, derivations, [&key2](ge_p2& out, const ge_p3& point, size_t) {
+                ge_p2 point2;
+                ge_p1p1 point3;
+                ge_scalarmult(&point2, key2.data(), &point);
+                ge_mul8(&point3, &point2);
+                ge_p1p1_to_p2(&out, &point3);
+            });
+}
+
+precomputed_derivation_key precompute_derivation_key(const secret_key& key) {
+    assert(sc_check(key.data()) == 0);
+    // 8*key as a plain (unreduced) integer, so that multiplying by it is exactly the same as
+    // multiplying by key and then by 8, even for points with a torsion component.  key < l < 2^253
+    // so this fits, with a top byte of at most 0x80 as ge_scalar_recode requires.
+    secret_key key8;
+    unsigned char carry = 0;
+    for (size_t i = 0; i < 32; i++) {
+        key8.data()[i] = (key.data()[i] << 3) | carry;
+        carry = key.data()[i] >> 5;
+    }
+    precomputed_derivation_key result;
+    ge_scalar_recode(result.digits.data(), key8.data());
+    return result;
+}
+
+bool generate_key_derivation(
+        const public_key& key1,
+        const precomputed_derivation_key& key2,
+        key_derivation& derivation) {
+    ge_p3 point;
+    ge_p2 point2;
+    if (ge_frombytes_vartime(&point, key1.data()) != 0) {
+        return false;
+    }
+    ge_scalarmult_recoded(&point2, key2.digits.data(), &point);
+    ge_tobytes(derivation.data(), &point2);
+    return true;
+}
+
+bool generate_key_derivations(
+        const std::vector<public_key>& keys1,
+        const precomputed_derivation_key& key2,
+        std::vector<key_derivation>& derivations) {
+    return encode_points_batch(
+            keys1, derivations, [&key2](ge_p2& out, const ge_p3& point, size_t) {
+                ge_scalarmult_recoded(&out, key2.digits.data(), &point);
+            });
+}
+
 void derivation_to_scalar(const key_derivation& derivation, size_t output_index, ec_scalar& res) {
     struct {
         key_derivation derivation;
@@ -283,6 +373,28 @@ bool derive_subaddress_public_key(
     return true;
 }
 
+bool derive_subaddress_public_keys(
+        const std::vector<public_key>& out_keys,
+        const std::vector<key_derivation>& derivations,
+        const std::vector<size_t>& output_indices,
+        std::vector<public_key>& results) {
+    if (derivations.size() != out_keys.size() || output_indices.size() != out_keys.size())
+        throw oxen::traced<std::invalid_argument>(
+                "mismatched derive_subaddress_public_keys inputs");
+    return encode_points_batch(
+            out_keys, results, [&](ge_p2& out, const ge_p3& point, size_t i) {
+                ec_scalar scalar;
+                ge_p3 point2;
+                ge_cached point3;
+                ge_p1p1 point4;
+                derivation_to_scalar(derivations[i], output_indices[i], scalar);
+                ge_scalarmult_base(&point2, scalar.data());
+                ge_p3_to_cached(&point3, &point2);
+                ge_sub(&point4, &point, &point3);
+                ge_p1p1_to_p2(&out, &point4);
+            });
+}
+
 struct s_comm {
     hash h;
     ec_point key;
@@ -364,6 +476,57 @@ bool check_signature(const hash& prefix_hash, const public_key& pub, const signa
     return sc_isnonzero(c.data()) == 0;
 }
 
+bool check_signatures(std::span<const signature_check> checks, std::vector<bool>* valid) {
+    const size_t n = checks.size();
+    if (valid)
+        valid->assign(n, false);
+
+    std::vector<ge_p2> points;
+    std::vector<size_t> index;
+    points.reserve(n);
+    index.reserve(n);
+    bool all_valid = true;
+    for (size_t i = 0; i < n; i++) {
+        const auto& check = checks[i];
+        ge_p3 tmp3;
+        if (ge_frombytes_vartime(&tmp3, check.pub.data()) != 0 || sc_check(check.sig.c()) != 0 ||
+            sc_check(check.sig.r()) != 0 || !sc_isnonzero(check.sig.c())) {
+            all_valid = false;
+            continue;
+        }
+        // R = sig.c A + sig.r G
+        ge_double_scalarmult_base_vartime(
+                &points.emplace_back(), check.sig.c(), &tmp3, check.sig.r());
+        index.push_back(i);
+    }
+
+    std::vector<unsigned char> comms(32 * points.size());
+    if (points.size() == 1)
+        ge_tobytes(comms.data(), &points[0]);
+    else if (!points.empty()) {
+        auto tmp = std::make_unique<fe[]>(points.size());
+        ge_tobytes_batch(comms.data(), points.data(), tmp.get(), points.size());
+    }
+
+    for (size_t j = 0; j < index.size(); j++) {
+        const auto& check = checks[index[j]];
+        s_comm buf;
+        buf.h = check.prefix_hash;
+        buf.key = check.pub;
+        std::memcpy(buf.comm.data(), comms.data() + 32 * j, 32);
+        bool good = memcmp(buf.comm.data(), infinity.data(), 32) != 0;
+        if (good) {
+            ec_scalar c = hash_to_scalar(&buf, sizeof(s_comm));
+            sc_sub(c.data(), c.data(), check.sig.c());
+            good = sc_isnonzero(c.data()) == 0;
+        }
+        if (good && valid)
+            (*valid)[index[j]] = true;
+        all_valid = all_valid && good;
+    }
+    return all_valid;
+}
+
 void generate_tx_proof(
         const hash& prefix_hash,
         const public_key& R,
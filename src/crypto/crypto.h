@@ -34,6 +34,7 @@
 #include <iostream>
 #include <optional>
 #include <random>
+#include <span>
 #include <type_traits>
 #include <vector>
 
@@ -195,6 +196,32 @@ bool secret_key_to_public_key(const secret_key& sec, public_key& pub);
 crypto::key_derivation generate_key_derivation(const public_key& key1, const secret_key& key2);
 bool generate_key_derivation(
         const public_key& key1, const secret_key& key2, key_derivation& derivation);
+// Computes generate_key_derivation(key, key2) for each of `keys1`.  This is faster than separate
+// calls when there are several keys as only one field inversion is needed to encode all of the
+// results.  A key that is not a valid point yields a null (all-zero) derivation and makes this
+// return false; the other derivations are still computed.
+bool generate_key_derivations(
+        const std::vector<public_key>& keys1,
+        const secret_key& key2,
+        std::vector<key_derivation>& derivations);
+
+// A secret key prepared for computing key derivations with many different public keys, such as a
+// wallet's view key while scanning: the cofactor multiplication is folded into the scalar, and the
+// scalar recoded for the multiplication, once here rather than in every derivation.
+struct precomputed_derivation_key_ {
+    std::array<signed char, 64> digits;
+};
+using precomputed_derivation_key = epee::mlocked<tools::scrubbed<precomputed_derivation_key_>>;
+precomputed_derivation_key precompute_derivation_key(const secret_key& key);
+// Same as the above, but with a key prepared by precompute_derivation_key().
+bool generate_key_derivation(
+        const public_key& key1,
+        const precomputed_derivation_key& key2,
+        key_derivation& derivation);
+bool generate_key_derivations(
+        const std::vector<public_key>& keys1,
+        const precomputed_derivation_key& key2,
+        std::vector<key_derivation>& derivations);
 bool derive_public_key(
         const key_derivation& derivation,
         std::size_t output_index,
@@ -211,6 +238,15 @@ bool derive_subaddress_public_key(
         const key_derivation& derivation,
         std::size_t output_index,
         public_key& result);
+// Computes derive_subaddress_public_key(out_keys[i], derivations[i], output_indices[i]) for each i,
+// which is what scanning does for every output it looks at.  As with generate_key_derivations only
+// one field inversion is needed for the whole batch; an out key that is not a valid point yields a
+// null result and makes this return false.  Throws if the inputs' sizes differ.
+bool derive_subaddress_public_keys(
+        const std::vector<public_key>& out_keys,
+        const std::vector<key_derivation>& derivations,
+        const std::vector<size_t>& output_indices,
+        std::vector<public_key>& results);
 
 /* Generation and checking of a non-standard Monero curve 25519 signature.  This is a custom
  * scheme that is not Ed25519 because it uses a random "r" (unlike Ed25519's use of a
@@ -253,6 +289,19 @@ void generate_signature(
 // See above.
 bool check_signature(const hash& prefix_hash, const public_key& pub, const signature& sig);
 
+struct signature_check {
+    hash prefix_hash;
+    public_key pub;
+    signature sig;
+};
+// Checks each of `checks` as check_signature does, returning true if all of them are valid.  If
+// `valid` is given it is set to the result for each signature.
+//
+// Because these signatures commit to R = sG + cA only through the hash c (and not R itself, as
+// Ed25519 does), they cannot be folded into a single multiscalar check; instead this saves by
+// encoding all of the recomputed R values with a single field inversion.
+bool check_signatures(std::span<const signature_check> checks, std::vector<bool>* valid = nullptr);
+
 /* Generation and checking of a tx proof; given a tx pubkey R, the recipient's view pubkey A, and
  * the key derivation D, the signature proves the knowledge of the tx secret key r such that R=r*G
  * and D=r*A When the recipient's address is a subaddress, the tx pubkey R is defined as R=r*B where
@@ -89,6 +89,14 @@ void rx_slow_hash(
         int miners,
         int is_alt);
 void rx_reorg(const uint64_t split_height);
+/* Enables verifying mainchain blocks using full RandomX datasets (built in the background with
+ * `threads` threads), or disables it and frees the datasets if `threads` is 0.  This needs about
+ * 2GB per dataset, and keeps up to two. */
+void rx_set_fast_verify(int threads);
+int rx_fast_verify_enabled(void);
+/* Starts building the full dataset for the given seed, if fast verification is enabled and it
+ * isn't already built or being built. */
+void rx_fast_prepare(const uint64_t seedheight, const unsigned char* seedhash);
 
 #ifdef __cplusplus
 }  // extern "C"
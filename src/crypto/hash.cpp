@@ -33,17 +33,27 @@ crypto::hash& crypto::hash::operator=(const crypto::hash8& h) {
     return *this;
 }
 
+// Per-thread heavy hash scratchpads; the v1 hasher borrows the (larger) v2 one.  Only threads that
+// do batched hashing ever allocate the second (N=1) pair.
+template <int N>
+static cn_heavy_hash_v2& heavy_v2() {
+    static thread_local cn_heavy_hash_v2 v2;
+    return v2;
+}
+template <int N>
+static cn_heavy_hash_v1& heavy_v1() {
+    static thread_local cn_heavy_hash_v1 v1 = cn_heavy_hash_v1::make_borrowed(heavy_v2<N>());
+    return v1;
+}
+
 void cn_slow_hash(const void* data, std::size_t length, hash& hash, cn_slow_hash_type type) {
     switch (type) {
         case cn_slow_hash_type::heavy_v1:
         case cn_slow_hash_type::heavy_v2: {
-            static thread_local cn_heavy_hash_v2 v2;
-            static thread_local cn_heavy_hash_v1 v1 = cn_heavy_hash_v1::make_borrowed(v2);
-
             if (type == cn_slow_hash_type::heavy_v1)
-                v1.hash(data, length, hash.data());
+                heavy_v1<0>().hash(data, length, hash.data());
             else
-                v2.hash(data, length, hash.data());
+                heavy_v2<0>().hash(data, length, hash.data());
         } break;
 
 #ifdef ENABLE_MONERO_SLOW_HASH
@@ -78,4 +88,35 @@ void cn_slow_hash(const void* data, std::size_t length, hash& hash, cn_slow_hash
     }
 }
 
+void cn_slow_hash(
+        std::span<const std::string_view> data, std::span<hash> hashes, cn_slow_hash_type type) {
+    assert(hashes.size() >= data.size());
+    size_t i = 0;
+    if (type == cn_slow_hash_type::heavy_v1 && cn_heavy_hash_v1::hash2_accelerated()) {
+        for (; i + 1 < data.size(); i += 2)
+            cn_heavy_hash_v1::hash2(
+                    heavy_v1<0>(),
+                    heavy_v1<1>(),
+                    data[i].data(),
+                    data[i].size(),
+                    hashes[i].data(),
+                    data[i + 1].data(),
+                    data[i + 1].size(),
+                    hashes[i + 1].data());
+    } else if (type == cn_slow_hash_type::heavy_v2 && cn_heavy_hash_v2::hash2_accelerated()) {
+        for (; i + 1 < data.size(); i += 2)
+            cn_heavy_hash_v2::hash2(
+                    heavy_v2<0>(),
+                    heavy_v2<1>(),
+                    data[i].data(),
+                    data[i].size(),
+                    hashes[i].data(),
+                    data[i + 1].data(),
+                    data[i + 1].size(),
+                    hashes[i + 1].data());
+    }
+    for (; i < data.size(); i++)
+        cn_slow_hash(data[i].data(), data[i].size(), hashes[i], type);
+}
+
 }  // namespace crypto
@@ -202,3 +202,111 @@ void keccak_finish(KECCAK_CTX* ctx, uint8_t* md, size_t mdlen) {
         memcpy_swap64le(md, ctx->hash, mdlen / sizeof(uint64_t));
     }
 }
+
+#if defined(__GNUC__)
+// KECCAK_MULTI_LANES 64-bit words, operated on together.  The compiler turns operations on these
+// into whatever vector instructions the target has (AVX2 or AVX-512 on x86, NEON on ARM), or into
+// plain scalar code if there are none.
+typedef uint64_t keccak_lanes __attribute__((vector_size(8 * KECCAK_MULTI_LANES)));
+
+#define LANES_ROTL(x, y) (((x) << (y)) | ((x) >> (64 - (y))))
+
+// keccakf() applied to KECCAK_MULTI_LANES independent states at once
+static void keccakf_multi(keccak_lanes st[25]) {
+    int i, j, round;
+    keccak_lanes t, bc[5];
+
+    for (round = 0; round < KECCAK_ROUNDS; round++) {
+
+        // Theta
+        for (i = 0; i < 5; i++)
+            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+
+        for (i = 0; i < 5; i++) {
+            t = bc[(i + 4) % 5] ^ LANES_ROTL(bc[(i + 1) % 5], 1);
+            for (j = 0; j < 25; j += 5)
+                st[j + i] ^= t;
+        }
+
+        // Rho Pi
+        t = st[1];
+        for (i = 0; i < 24; i++) {
+            j = keccakf_piln[i];
+            bc[0] = st[j];
+            st[j] = LANES_ROTL(t, keccakf_rotc[i]);
+            t = bc[0];
+        }
+
+        //  Chi
+        for (j = 0; j < 25; j += 5) {
+            for (i = 0; i < 5; i++)
+                bc[i] = st[j + i];
+            for (i = 0; i < 5; i++)
+                st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+        }
+
+        //  Iota
+        st[0] ^= keccakf_rndc[round];
+    }
+}
+
+// Hashes up to KECCAK_MULTI_LANES messages together
+static void keccak_multi_batch(
+        const uint8_t* const* in, const size_t* inlen, size_t count, uint8_t* md) {
+    keccak_lanes st[25];
+    uint8_t temp[KECCAK_MULTI_LANES][KECCAK_BLOCKLEN];
+    uint64_t out[KECCAK_MULTI_LANES][HASH_SIZE / 8];
+    size_t blocks[KECCAK_MULTI_LANES], max_blocks = 0, b, i, l;
+
+    memset(st, 0, sizeof(st));
+    for (l = 0; l < count; l++) {
+        // Full blocks plus the final, padded one
+        blocks[l] = inlen[l] / KECCAK_BLOCKLEN + 1;
+        if (blocks[l] > max_blocks)
+            max_blocks = blocks[l];
+
+        size_t rest = inlen[l] % KECCAK_BLOCKLEN;
+        if (rest)
+            memcpy(temp[l], in[l] + inlen[l] - rest, rest);
+        memset(temp[l] + rest, 0, KECCAK_BLOCKLEN - rest);
+        temp[l][rest] |= 0x01;
+        temp[l][KECCAK_BLOCKLEN - 1] |= 0x80;
+    }
+
+    for (b = 0; b < max_blocks; b++) {
+        for (l = 0; l < count; l++) {
+            if (b >= blocks[l])
+                continue;  // Finished: whatever happens to this lane's state from now is ignored
+            const uint8_t* block = b + 1 < blocks[l] ? in[l] + b * KECCAK_BLOCKLEN : temp[l];
+            for (i = 0; i < KECCAK_WORDS; i++) {
+                uint64_t w;
+                memcpy(&w, block + i * 8, 8);
+                st[i][l] ^= SWAP64LE(w);
+            }
+        }
+        keccakf_multi(st);
+        for (l = 0; l < count; l++)
+            if (b + 1 == blocks[l])
+                for (i = 0; i < HASH_SIZE / 8; i++)
+                    out[l][i] = st[i][l];
+    }
+
+    // Only written now that we are done reading all of the inputs
+    for (l = 0; l < count; l++)
+        memcpy_swap64le(md + l * HASH_SIZE, out[l], HASH_SIZE / 8);
+}
+#endif
+
+void keccak_multi(const uint8_t* const* in, const size_t* inlen, size_t count, uint8_t* md) {
+#if defined(__GNUC__)
+    for (size_t i = 0; i < count; i += KECCAK_MULTI_LANES)
+        keccak_multi_batch(
+                in + i,
+                inlen + i,
+                count - i < KECCAK_MULTI_LANES ? count - i : KECCAK_MULTI_LANES,
+                md + i * HASH_SIZE);
+#else
+    for (size_t i = 0; i < count; i++)
+        keccak(in[i], inlen[i], md + i * HASH_SIZE, HASH_SIZE);
+#endif
+}
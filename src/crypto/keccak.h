@@ -37,6 +37,23 @@ void keccakf(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t* in, size_t inlen, uint8_t* md);
 
+// Number of messages that keccak_multi() hashes together: 8 fills AVX-512 registers, 4 suits
+// AVX2 (and costs little more than 2 on NEON/SSE2)
+#ifndef KECCAK_MULTI_LANES
+#if defined(__AVX512F__)
+#define KECCAK_MULTI_LANES 8
+#else
+#define KECCAK_MULTI_LANES 4
+#endif
+#endif
+
+// Computes 32-byte keccak hashes (i.e. cn_fast_hash) of `count` independent messages: message i is
+// the `inlen[i]` bytes at `in[i]`, and its hash is written to `md + 32*i`.  Messages are processed
+// KECCAK_MULTI_LANES at a time with their states interleaved so that the permutation runs in SIMD
+// registers where the target has them.  The hash of message i may overlap the input of any message
+// k <= i (each batch is read before any of its hashes are written).
+void keccak_multi(const uint8_t* const* in, const size_t* inlen, size_t count, uint8_t* md);
+
 // Piecewise version of keccak
 void keccak_init(KECCAK_CTX* ctx);
 void keccak_update(KECCAK_CTX* ctx, const uint8_t* in, size_t inlen);
@@ -63,6 +63,33 @@ static int rx_dataset_nomem;
 static uint64_t rx_dataset_height;
 static THREADV randomx_vm* rx_vm = NULL;
 
+/* Full datasets for verifying (rather than mining) mainchain blocks, when enabled.  There are two
+ * so that the dataset for the next seed can be built in the background while the current one is
+ * still in use; a slot is only rebuilt once nothing is hashing with it. */
+typedef struct rx_fast_state {
+    randomx_dataset* fs_dataset;
+    char fs_hash[HASH_SIZE];
+    uint64_t fs_height;
+    int fs_ready;    /* dataset is fully built for fs_hash */
+    int fs_building; /* a builder thread is filling in the dataset */
+    int fs_users;    /* hashes currently running with the dataset */
+    int fs_thread_started;
+    CTHR_THREAD_TYPE fs_thread;
+} rx_fast_state;
+
+static CTHR_MUTEX_TYPE rx_fast_mutex = CTHR_MUTEX_INIT;
+static rx_fast_state rx_fast[2];
+static int rx_fast_threads; /* 0 if full-dataset verification is disabled */
+static int rx_fast_nomem;
+
+/* Idle VMs for full-dataset hashing.  These are shared by all threads (rather than being one per
+ * thread like rx_vm) because each one costs a few MB and is pointed at whichever dataset the next
+ * hash needs. */
+#define RX_VM_POOL_MAX 64
+static CTHR_MUTEX_TYPE rx_vm_pool_mutex = CTHR_MUTEX_INIT;
+static randomx_vm* rx_vm_pool[RX_VM_POOL_MAX];
+static int rx_vm_pool_size;
+
 static void local_abort(const char* msg) {
     fprintf(stderr, "%s\n", msg);
 #ifdef NDEBUG
@@ -122,6 +149,17 @@ void rx_reorg(const uint64_t split_height) {
         }
     }
     CTHR_MUTEX_UNLOCK(rx_mutex);
+
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    for (i = 0; i < 2; i++) {
+        if (split_height <= rx_fast[i].fs_height) {
+            /* A builder that is still running notices this when it finishes and discards the
+             * dataset. */
+            rx_fast[i].fs_height = 1;
+            rx_fast[i].fs_ready = 0;
+        }
+    }
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
 }
 
 uint64_t rx_seedheight(const uint64_t height) {
@@ -137,6 +175,7 @@ void rx_seedheights(const uint64_t height, uint64_t* seedheight, uint64_t* nexth
 }
 
 typedef struct seedinfo {
+    randomx_dataset* si_dataset;
     randomx_cache* si_cache;
     unsigned long si_start;
     unsigned long si_count;
@@ -144,11 +183,12 @@ typedef struct seedinfo {
 
 static CTHR_THREAD_RTYPE rx_seedthread(void* arg) {
     seedinfo* si = arg;
-    randomx_init_dataset(rx_dataset, si->si_cache, si->si_start, si->si_count);
+    randomx_init_dataset(si->si_dataset, si->si_cache, si->si_start, si->si_count);
     CTHR_THREAD_RETURN;
 }
 
-static void rx_initdata(randomx_cache* rs_cache, const int miners, const uint64_t seedheight) {
+/* Fills in `dataset` from `rs_cache`, split across `miners` threads (including this one). */
+static void rx_fill_dataset(randomx_dataset* dataset, randomx_cache* rs_cache, const int miners) {
     if (miners > 1) {
         unsigned long delta = randomx_dataset_item_count() / miners;
         unsigned long start = 0;
@@ -164,29 +204,225 @@ static void rx_initdata(randomx_cache* rs_cache, const int miners, const uint64_
             local_abort("Couldn't allocate RandomX mining threadlist");
         }
         for (i = 0; i < miners - 1; i++) {
+            si[i].si_dataset = dataset;
             si[i].si_cache = rs_cache;
             si[i].si_start = start;
             si[i].si_count = delta;
             start += delta;
         }
+        si[i].si_dataset = dataset;
         si[i].si_cache = rs_cache;
         si[i].si_start = start;
         si[i].si_count = randomx_dataset_item_count() - start;
         for (i = 1; i < miners; i++) {
             CTHR_THREAD_CREATE(st[i], rx_seedthread, &si[i]);
         }
-        randomx_init_dataset(rx_dataset, rs_cache, 0, si[0].si_count);
+        randomx_init_dataset(dataset, rs_cache, 0, si[0].si_count);
         for (i = 1; i < miners; i++) {
             CTHR_THREAD_JOIN(st[i]);
         }
         free(st);
         free(si);
     } else {
-        randomx_init_dataset(rx_dataset, rs_cache, 0, randomx_dataset_item_count());
+        randomx_init_dataset(dataset, rs_cache, 0, randomx_dataset_item_count());
     }
+}
+
+static void rx_initdata(randomx_cache* rs_cache, const int miners, const uint64_t seedheight) {
+    rx_fill_dataset(rx_dataset, rs_cache, miners);
     rx_dataset_height = seedheight;
 }
 
+static CTHR_THREAD_RTYPE rx_fast_buildthread(void* arg) {
+    rx_fast_state* fs = arg;
+    randomx_flags flags = enabled_flags() & ~disabled_flags();
+    randomx_cache* cache;
+    char hash[HASH_SIZE];
+    uint64_t height;
+    int threads;
+
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    memcpy(hash, fs->fs_hash, HASH_SIZE);
+    height = fs->fs_height;
+    threads = rx_fast_threads;
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+
+    /* Our own cache, so that nothing else replacing the cache of an rx_s slot can affect us */
+    cache = randomx_alloc_cache(flags | RANDOMX_FLAG_LARGE_PAGES);
+    if (cache == NULL)
+        cache = randomx_alloc_cache(flags);
+    if (cache != NULL) {
+        randomx_init_cache(cache, hash, HASH_SIZE);
+        rx_fill_dataset(fs->fs_dataset, cache, threads > 0 ? threads : 1);
+        randomx_release_cache(cache);
+    }
+
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    fs->fs_building = 0;
+    /* Only usable if nothing (such as a reorg) changed the slot while we were building it */
+    fs->fs_ready =
+            cache != NULL && fs->fs_height == height && !memcmp(fs->fs_hash, hash, HASH_SIZE);
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+    CTHR_THREAD_RETURN;
+}
+
+/* Must be called with rx_fast_mutex held */
+static void rx_fast_prepare_locked(const uint64_t seedheight, const unsigned char* seedhash) {
+    rx_fast_state* fs = NULL;
+    int i;
+
+    if (!rx_fast_threads || rx_fast_nomem)
+        return;
+    for (i = 0; i < 2; i++)
+        if ((rx_fast[i].fs_ready || rx_fast[i].fs_building) && rx_fast[i].fs_height == seedheight &&
+            !memcmp(rx_fast[i].fs_hash, seedhash, HASH_SIZE))
+            return; /* already have (or are getting) it */
+
+    /* Prefer a slot holding nothing useful, otherwise replace the one with the older seed (but
+     * never throw out a newer seed's dataset for an older one, e.g. for an RPC request of an old
+     * block) */
+    for (i = 0; i < 2; i++) {
+        rx_fast_state* s = &rx_fast[i];
+        if (s->fs_building || s->fs_users || (s->fs_ready && s->fs_height > seedheight))
+            continue;
+        if (fs == NULL || !s->fs_ready || (fs->fs_ready && s->fs_height < fs->fs_height))
+            fs = s;
+    }
+    if (fs == NULL)
+        return; /* both slots busy; we'll get another chance on a later hash */
+
+    if (fs->fs_thread_started) {
+        /* The previous builder has finished (fs_building is clear), so this doesn't block */
+        CTHR_THREAD_JOIN(fs->fs_thread);
+        fs->fs_thread_started = 0;
+    }
+    if (fs->fs_dataset == NULL) {
+        fs->fs_dataset = randomx_alloc_dataset(RANDOMX_FLAG_LARGE_PAGES);
+        if (fs->fs_dataset == NULL)
+            fs->fs_dataset = randomx_alloc_dataset(RANDOMX_FLAG_DEFAULT);
+        if (fs->fs_dataset == NULL) {
+            fprintf(stderr, "Couldn't allocate RandomX dataset; using light verification\n");
+            rx_fast_nomem = 1;
+            return;
+        }
+    }
+
+    fs->fs_ready = 0;
+    fs->fs_building = 1;
+    fs->fs_height = seedheight;
+    memcpy(fs->fs_hash, seedhash, HASH_SIZE);
+    CTHR_THREAD_CREATE(fs->fs_thread, rx_fast_buildthread, fs);
+    fs->fs_thread_started = 1;
+}
+
+void rx_fast_prepare(const uint64_t seedheight, const unsigned char* seedhash) {
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    rx_fast_prepare_locked(seedheight, seedhash);
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+}
+
+int rx_fast_verify_enabled(void) {
+    int enabled;
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    enabled = rx_fast_threads > 0 && !rx_fast_nomem;
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+    return enabled;
+}
+
+void rx_set_fast_verify(int threads) {
+    int i;
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    rx_fast_threads = threads > 0 ? threads : 0;
+    rx_fast_nomem = 0;
+    if (!rx_fast_threads) {
+        /* Free whatever isn't in use; a busy slot stays allocated, but is never used again */
+        for (i = 0; i < 2; i++) {
+            rx_fast_state* fs = &rx_fast[i];
+            fs->fs_ready = 0;
+            if (fs->fs_building || fs->fs_users)
+                continue;
+            if (fs->fs_thread_started) {
+                CTHR_THREAD_JOIN(fs->fs_thread);
+                fs->fs_thread_started = 0;
+            }
+            if (fs->fs_dataset != NULL) {
+                randomx_release_dataset(fs->fs_dataset);
+                fs->fs_dataset = NULL;
+            }
+        }
+    }
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+
+    if (!threads) {
+        CTHR_MUTEX_LOCK(rx_vm_pool_mutex);
+        while (rx_vm_pool_size > 0)
+            randomx_destroy_vm(rx_vm_pool[--rx_vm_pool_size]);
+        CTHR_MUTEX_UNLOCK(rx_vm_pool_mutex);
+    }
+}
+
+/* Hashes with a full dataset for the given seed if one is ready, returning 0 (without hashing) if
+ * there isn't one, in which case it starts building one for next time. */
+static int rx_fast_hash(
+        const uint64_t seedheight,
+        const unsigned char* seedhash,
+        const void* data,
+        size_t length,
+        unsigned char* hash) {
+    rx_fast_state* fs = NULL;
+    randomx_vm* vm = NULL;
+    randomx_flags flags;
+    int i;
+
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    for (i = 0; i < 2; i++)
+        if (rx_fast[i].fs_ready && rx_fast[i].fs_height == seedheight &&
+            !memcmp(rx_fast[i].fs_hash, seedhash, HASH_SIZE))
+            fs = &rx_fast[i];
+    if (fs == NULL || !rx_fast_threads) {
+        rx_fast_prepare_locked(seedheight, seedhash);
+        CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+        return 0;
+    }
+    fs->fs_users++;
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+
+    CTHR_MUTEX_LOCK(rx_vm_pool_mutex);
+    if (rx_vm_pool_size > 0)
+        vm = rx_vm_pool[--rx_vm_pool_size];
+    CTHR_MUTEX_UNLOCK(rx_vm_pool_mutex);
+
+    if (vm == NULL) {
+        flags = (enabled_flags() & ~disabled_flags()) | RANDOMX_FLAG_FULL_MEM;
+        if (flags & RANDOMX_FLAG_JIT)
+            flags |= RANDOMX_FLAG_SECURE & ~disabled_flags();
+        vm = randomx_create_vm(flags | RANDOMX_FLAG_LARGE_PAGES, NULL, fs->fs_dataset);
+        if (vm == NULL)
+            vm = randomx_create_vm(flags, NULL, fs->fs_dataset);
+        if (vm == NULL)
+            vm = randomx_create_vm(
+                    RANDOMX_FLAG_DEFAULT | RANDOMX_FLAG_FULL_MEM, NULL, fs->fs_dataset);
+        if (vm == NULL)
+            local_abort("Couldn't allocate RandomX VM");
+    } else {
+        randomx_vm_set_dataset(vm, fs->fs_dataset);
+    }
+
+    randomx_calculate_hash(vm, data, length, hash);
+
+    CTHR_MUTEX_LOCK(rx_vm_pool_mutex);
+    if (rx_vm_pool_size < RX_VM_POOL_MAX)
+        rx_vm_pool[rx_vm_pool_size++] = vm;
+    else
+        randomx_destroy_vm(vm);
+    CTHR_MUTEX_UNLOCK(rx_vm_pool_mutex);
+
+    CTHR_MUTEX_LOCK(rx_fast_mutex);
+    fs->fs_users--;
+    CTHR_MUTEX_UNLOCK(rx_fast_mutex);
+    return 1;
+}
+
 void rx_slow_hash(
         const uint64_t mainheight,
         const uint64_t seedheight,
@@ -202,6 +438,11 @@ void rx_slow_hash(
     rx_state* rx_sp;
     randomx_cache* cache;
 
+    /* Verifying a mainchain block: use a full dataset if we have one for this seed */
+    if (!miners && !is_alt && rx_fast_verify_enabled() &&
+        rx_fast_hash(seedheight, seedhash, data, length, hash))
+        return;
+
     CTHR_MUTEX_LOCK(rx_mutex);
 
     /* if alt block but with same seed as mainchain, no need for alt cache */
@@ -34,6 +34,23 @@
 #include <string.h>
 
 #include "hash-ops.h"
+#include "keccak.h"
+
+// Replaces `count` consecutive pairs of hashes starting at `in` with their hashes, written starting
+// at `out` (which may be `in`, since each hash only overlaps earlier inputs).
+static void hash_pairs(const unsigned char* in, size_t count, unsigned char* out) {
+    const uint8_t* ins[KECCAK_MULTI_LANES];
+    size_t lens[KECCAK_MULTI_LANES];
+    size_t i, n, k;
+    for (i = 0; i < count; i += n) {
+        n = count - i < KECCAK_MULTI_LANES ? count - i : KECCAK_MULTI_LANES;
+        for (k = 0; k < n; k++) {
+            ins[k] = in + (i + k) * 2 * HASH_SIZE;
+            lens[k] = 2 * HASH_SIZE;
+        }
+        keccak_multi(ins, lens, n, out + i * HASH_SIZE);
+    }
+}
 
 /***
  * Round to power of two, for count>=3 and for count being not too large (as reasonable for tree
@@ -84,7 +101,7 @@ void tree_hash(const unsigned char (*hashes)[HASH_SIZE], size_t count, unsigned
     } else if (count == 2) {
         cn_fast_hash(hashes, 2 * HASH_SIZE, root_hash);
     } else {
-        size_t i, j;
+        size_t j;
 
         size_t cnt = tree_hash_cnt(count);
 
@@ -94,16 +111,13 @@ void tree_hash(const unsigned char (*hashes)[HASH_SIZE], size_t count, unsigned
 
         memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
 
-        for (i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j) {
-            cn_fast_hash(hashes[i], 64, ints + j * HASH_SIZE);
-        }
-        assert(i == count);
+        // The hashes that don't fit in the power of two get paired up into the rest of the slots
+        j = 2 * cnt - count;
+        hash_pairs(hashes[j], cnt - j, ints + j * HASH_SIZE);
 
         while (cnt > 2) {
             cnt >>= 1;
-            for (i = 0, j = 0; j < cnt; i += 2, ++j) {
-                cn_fast_hash(ints + i * HASH_SIZE, 64, ints + j * HASH_SIZE);
-            }
+            hash_pairs(ints, cnt, ints);
         }
 
         cn_fast_hash(ints, 64, root_hash);
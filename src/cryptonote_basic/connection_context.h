@@ -29,9 +29,13 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <concepts>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <unordered_set>
 
 #include "common/format.h"
@@ -44,6 +48,105 @@ using namespace std::literals;
 
 namespace cryptonote {
 
+/// A bounded set of the tx hashes a peer is known (or assumed) to have: the ones it has sent us
+/// and the ones we have relayed to it.  Once full, the oldest hashes are forgotten first.  Unlike
+/// most of the connection context this gets used from other threads (when relaying blocks and
+/// txs), hence the lock.
+class known_tx_set {
+  public:
+    static constexpr size_t MAX_SIZE = 20'000;
+
+    known_tx_set() = default;
+    known_tx_set(const known_tx_set& other) { *this = other; }
+    known_tx_set& operator=(const known_tx_set& other) {
+        if (this != &other) {
+            std::scoped_lock lock{mutex, other.mutex};
+            order = other.order;
+            hashes = other.hashes;
+        }
+        return *this;
+    }
+
+    void add(const crypto::hash& h) {
+        std::lock_guard lock{mutex};
+        if (!hashes.insert(h).second)
+            return;
+        order.push_back(h);
+        if (order.size() > MAX_SIZE) {
+            hashes.erase(order.front());
+            order.pop_front();
+        }
+    }
+
+    bool contains(const crypto::hash& h) const {
+        std::lock_guard lock{mutex};
+        return hashes.count(h);
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::deque<crypto::hash> order;
+    std::unordered_set<crypto::hash> hashes;
+};
+
+/// Counters for one levin command (either received on a single connection, or across all of
+/// them).  Handler times are the time spent inside the command handler, including (for invokes)
+/// serializing the response.
+struct levin_command_stats {
+    /// Upper bounds of the handler time histogram buckets; there is one more bucket after these
+    /// for anything slower.
+    static constexpr std::array<std::chrono::microseconds, 5> HANDLER_TIME_BUCKETS{
+            100us, 1ms, 10ms, 100ms, 1s};
+
+    uint64_t count = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    std::chrono::nanoseconds handler_time{0};
+    std::chrono::nanoseconds max_handler_time{0};
+    std::array<uint64_t, HANDLER_TIME_BUCKETS.size() + 1> handler_time_histogram{};
+
+    void add(size_t in, size_t out, std::chrono::nanoseconds elapsed) {
+        count++;
+        bytes_in += in;
+        bytes_out += out;
+        handler_time += elapsed;
+        max_handler_time = std::max(max_handler_time, elapsed);
+        size_t b = 0;
+        while (b < HANDLER_TIME_BUCKETS.size() && elapsed > HANDLER_TIME_BUCKETS[b])
+            b++;
+        handler_time_histogram[b]++;
+    }
+};
+
+/// Per-command levin stats keyed by command id.  Locked because it gets updated by the
+/// connection's handlers while RPC threads read it.
+class levin_command_stats_map {
+  public:
+    levin_command_stats_map() = default;
+    levin_command_stats_map(const levin_command_stats_map& other) { *this = other; }
+    levin_command_stats_map& operator=(const levin_command_stats_map& other) {
+        if (this != &other) {
+            std::scoped_lock lock{mutex, other.mutex};
+            stats = other.stats;
+        }
+        return *this;
+    }
+
+    void add(int command, size_t in, size_t out, std::chrono::nanoseconds elapsed) {
+        std::lock_guard lock{mutex};
+        stats[command].add(in, out, elapsed);
+    }
+
+    std::map<int, levin_command_stats> get() const {
+        std::lock_guard lock{mutex};
+        return stats;
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::map<int, levin_command_stats> stats;
+};
+
 struct cryptonote_connection_context : public epee::net_utils::connection_context_base {
     enum state {
         state_before_handshake = 0,  // default state
@@ -67,6 +170,8 @@ struct cryptonote_connection_context : public epee::net_utils::connection_contex
     crypto::hash m_last_known_hash{};
     uint32_t m_pruning_seed{0};
     bool m_anchor{false};
+    known_tx_set m_known_txs;
+    levin_command_stats_map m_command_stats;
     // size_t m_score{0};  TODO: add score calculations
 };
 
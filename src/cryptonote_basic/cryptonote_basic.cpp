@@ -7,27 +7,40 @@
 
 namespace cryptonote {
 
+const tx_extra_cache* tx_extra_cache_ptr::set(const tx_extra_cache* cache) const {
+    const tx_extra_cache* expected = nullptr;
+    if (ptr.compare_exchange_strong(expected, cache, std::memory_order_acq_rel))
+        return cache;
+    delete cache;
+    return expected;
+}
+
+void tx_extra_cache_ptr::reset() {
+    delete ptr.exchange(nullptr, std::memory_order_acq_rel);
+}
+
 void transaction_prefix::set_null() {
     version = txversion::v1;
     unlock_time = 0;
     vin.clear();
     vout.clear();
     extra.clear();
+    extra_cache.reset();
     output_unlock_times.clear();
     type = txtype::standard;
 }
 
 std::vector<crypto::public_key> transaction_prefix::get_public_keys() const {
-    std::vector<cryptonote::tx_extra_field> fields;
-
-    if (!parse_tx_extra(extra, fields)) {
+    std::vector<cryptonote::tx_extra_field> parsed;
+    auto* fields = get_tx_extra_fields(*this, parsed);
+    if (!fields) {
         throw oxen::traced<std::invalid_argument>("Failed to parse tx_extra of a transaction.");
     }
 
     std::vector<crypto::public_key> keys;
     tx_extra_pub_key pk_field;
     size_t i = 0;
-    while (find_tx_extra_field_by_type(fields, pk_field, i++)) {
+    while (find_tx_extra_field_by_type(*fields, pk_field, i++)) {
         keys.push_back(pk_field.pub_key);
     }
 
@@ -37,6 +50,7 @@ std::vector<crypto::public_key> transaction_prefix::get_public_keys() const {
 transaction::transaction(const transaction& t) :
         transaction_prefix(t),
         hash_valid(false),
+        prefix_hash_valid(false),
         blob_size_valid(false),
         signatures(t.signatures),
         rct_signatures(t.rct_signatures),
@@ -47,6 +61,8 @@ transaction::transaction(const transaction& t) :
         hash = t.hash;
         set_hash_valid(true);
     }
+    if (t.is_prefix_hash_valid())
+        set_prefix_hash(t.prefix_hash);
     if (t.is_blob_size_valid()) {
         blob_size = t.blob_size;
         set_blob_size_valid(true);
@@ -56,6 +72,7 @@ transaction::transaction(const transaction& t) :
 transaction& transaction::operator=(const transaction& t) {
     transaction_prefix::operator=(t);
     set_hash_valid(false);
+    set_prefix_hash_valid(false);
     set_blob_size_valid(false);
     signatures = t.signatures;
     rct_signatures = t.rct_signatures;
@@ -63,6 +80,59 @@ transaction& transaction::operator=(const transaction& t) {
         hash = t.hash;
         set_hash_valid(true);
     }
+    if (t.is_prefix_hash_valid())
+        set_prefix_hash(t.prefix_hash);
+    if (t.is_blob_size_valid()) {
+        blob_size = t.blob_size;
+        set_blob_size_valid(true);
+    }
+    pruned = t.pruned;
+    unprunable_size = t.unprunable_size.load();
+    prefix_size = t.prefix_size.load();
+    return *this;
+}
+
+// So that vectors of txs move rather than copy them when growing
+static_assert(std::is_nothrow_move_constructible_v<transaction>);
+
+transaction::transaction(transaction&& t) noexcept :
+        transaction_prefix(std::move(t)),
+        hash_valid(false),
+        prefix_hash_valid(false),
+        blob_size_valid(false),
+        signatures(std::move(t.signatures)),
+        rct_signatures(std::move(t.rct_signatures)),
+        pruned(t.pruned),
+        unprunable_size(t.unprunable_size.load()),
+        prefix_size(t.prefix_size.load()) {
+    if (t.is_hash_valid()) {
+        hash = t.hash;
+        set_hash_valid(true);
+    }
+    if (t.is_prefix_hash_valid())
+        set_prefix_hash(t.prefix_hash);
+    if (t.is_blob_size_valid()) {
+        blob_size = t.blob_size;
+        set_blob_size_valid(true);
+    }
+    t.invalidate_hashes();
+}
+
+transaction& transaction::operator=(transaction&& t) noexcept {
+    if (this == &t)
+        return *this;
+    transaction_prefix::operator=(std::move(t));
+    set_hash_valid(false);
+    set_prefix_hash_valid(false);
+    set_blob_size_valid(false);
+    signatures = std::move(t.signatures);
+    rct_signatures = std::move(t.rct_signatures);
+    if (t.is_hash_valid()) {
+        hash = t.hash;
+        set_hash_valid(true);
+    }
+    if (t.is_prefix_hash_valid())
+        set_prefix_hash(t.prefix_hash);
     if (t.is_blob_size_valid()) {
         blob_size = t.blob_size;
         set_blob_size_valid(true);
@@ -70,6 +140,7 @@ transaction& transaction::operator=(const transaction& t) {
     pruned = t.pruned;
     unprunable_size = t.unprunable_size.load();
     prefix_size = t.prefix_size.load();
+    t.invalidate_hashes();
     return *this;
 }
 
@@ -79,6 +150,7 @@ void transaction::set_null() {
     rct_signatures = {};
     rct_signatures.type = rct::RCTType::Null;
     set_hash_valid(false);
+    set_prefix_hash_valid(false);
     set_blob_size_valid(false);
     pruned = false;
     unprunable_size = 0;
@@ -87,6 +159,7 @@ void transaction::set_null() {
 
 void transaction::invalidate_hashes() {
     set_hash_valid(false);
+    set_prefix_hash_valid(false);
     set_blob_size_valid(false);
 }
 
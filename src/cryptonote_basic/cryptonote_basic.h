@@ -165,6 +165,43 @@ struct tx_out {
 // only used in places like the RPC where we return a value even if not a blink at all.
 enum class blink_result { none = 0, rejected, accepted, timeout };
 
+struct tx_extra_cache;
+
+/// Holds the lazily parsed tx_extra fields of a transaction_prefix; see tx_extra_cache.  The cache
+/// is set at most once (so that threads sharing a const tx can all use it) and is never copied
+/// along with the tx: a copy starts with an empty cache.  Moving a tx moves its cache along.
+class tx_extra_cache_ptr {
+  public:
+    tx_extra_cache_ptr() = default;
+    tx_extra_cache_ptr(const tx_extra_cache_ptr&) noexcept {}
+    tx_extra_cache_ptr(tx_extra_cache_ptr&& p) noexcept :
+            ptr{p.ptr.exchange(nullptr, std::memory_order_acq_rel)} {}
+    tx_extra_cache_ptr& operator=(const tx_extra_cache_ptr&) {
+        reset();
+        return *this;
+    }
+    tx_extra_cache_ptr& operator=(tx_extra_cache_ptr&& p) noexcept {
+        if (this != &p) {
+            reset();
+            ptr.store(p.ptr.exchange(nullptr, std::memory_order_acq_rel), std::memory_order_release);
+        }
+        return *this;
+    }
+    ~tx_extra_cache_ptr() { reset(); }
+
+    const tx_extra_cache* get() const { return ptr.load(std::memory_order_acquire); }
+
+    /// Installs `cache` if no cache has been set yet (deleting it otherwise), and returns the
+    /// cache now in place.
+    const tx_extra_cache* set(const tx_extra_cache* cache) const;
+
+    /// Drops the cache.  Must not be called while other threads might be using it.
+    void reset();
+
+  private:
+    mutable std::atomic<const tx_extra_cache*> ptr{nullptr};
+};
+
 class transaction_prefix {
 
   public:
@@ -192,8 +229,14 @@ class transaction_prefix {
     std::vector<uint8_t> extra;
     std::vector<uint64_t> output_unlock_times;
 
+    // Parsed `extra` fields, filled in on demand by the tx_extra lookups that take a tx (rather
+    // than just its extra bytes).
+    tx_extra_cache_ptr extra_cache;
+
     template <class Archive>
     void serialize_object(Archive& ar) {
+        if constexpr (Archive::is_deserializer)
+            extra_cache.reset();
         field_varint(ar, "version", version, [](auto& version) {
             return version >= txversion::v1 && version < txversion::_count;
         });
@@ -243,6 +286,7 @@ class transaction final : public transaction_prefix {
   private:
     // hash cache
     mutable std::atomic<bool> hash_valid;
+    mutable std::atomic<bool> prefix_hash_valid;
     mutable std::atomic<bool> blob_size_valid;
 
   public:
@@ -252,6 +296,7 @@ class transaction final : public transaction_prefix {
 
     // hash cache
     mutable crypto::hash hash;
+    mutable crypto::hash prefix_hash;
     mutable size_t blob_size;
 
     bool pruned;
@@ -262,16 +307,27 @@ class transaction final : public transaction_prefix {
     transaction() { set_null(); }
     transaction(const transaction& t);
     transaction& operator=(const transaction& t);
+    // Moves leave `t` in a valid but unspecified state (call set_null() to reuse it).
+    transaction(transaction&& t) noexcept;
+    transaction& operator=(transaction&& t) noexcept;
     void set_null();
     void invalidate_hashes();
     bool is_hash_valid() const { return hash_valid.load(std::memory_order_acquire); }
     void set_hash_valid(bool v) const { hash_valid.store(v, std::memory_order_release); }
+    bool is_prefix_hash_valid() const { return prefix_hash_valid.load(std::memory_order_acquire); }
+    void set_prefix_hash_valid(bool v) const {
+        prefix_hash_valid.store(v, std::memory_order_release);
+    }
     bool is_blob_size_valid() const { return blob_size_valid.load(std::memory_order_acquire); }
     void set_blob_size_valid(bool v) const { blob_size_valid.store(v, std::memory_order_release); }
     void set_hash(const crypto::hash& h) {
         hash = h;
         set_hash_valid(true);
     }
+    void set_prefix_hash(const crypto::hash& h) const {
+        prefix_hash = h;
+        set_prefix_hash_valid(true);
+    }
     void set_blob_size(size_t sz) {
         blob_size = sz;
         set_blob_size_valid(true);
@@ -283,6 +339,7 @@ class transaction final : public transaction_prefix {
 
         if (Archive::is_deserializer) {
             set_hash_valid(false);
+            set_prefix_hash_valid(false);
             set_blob_size_valid(false);
         }
 
@@ -36,6 +36,7 @@
 #include <common/meta.h>
 #include <oxenc/hex.h>
 
+#include <array>
 #include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <limits>
@@ -138,6 +139,20 @@ crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx) {
     return h;
 }
 //---------------------------------------------------------------
+void get_transaction_prefix_hash(const transaction& tx, crypto::hash& h) {
+    if (tx.is_prefix_hash_valid()) {
+        h = tx.prefix_hash;
+        return;
+    }
+    get_transaction_prefix_hash(static_cast<const transaction_prefix&>(tx), h);
+}
+//---------------------------------------------------------------
+crypto::hash get_transaction_prefix_hash(const transaction& tx) {
+    crypto::hash h{};
+    get_transaction_prefix_hash(tx, h);
+    return h;
+}
+//---------------------------------------------------------------
 bool expand_transaction_1(transaction& tx, bool base_only) {
     if (tx.version >= txversion::v2_ringct && !tx.is_miner_tx()) {
         rct::rctSig& rv = tx.rct_signatures;
@@ -224,6 +239,13 @@ bool parse_and_validate_tx_from_blob(const std::string_view tx_blob, transaction
             expand_transaction_1(tx, false), false, "Failed to expand transaction data");
     tx.invalidate_hashes();
     tx.set_blob_size(tx_blob.size());
+    // We have the exact serialized bytes right here, so hash them now rather than having every
+    // later get_transaction_hash() call reserialize the transaction to get them back.
+    crypto::hash tx_hash, tx_prefix_hash;
+    if (calculate_transaction_hash(tx, tx_blob, tx_hash, tx_prefix_hash)) {
+        tx.set_hash(tx_hash);
+        tx.set_prefix_hash(tx_prefix_hash);
+    }
     return true;
 }
 //---------------------------------------------------------------
@@ -266,9 +288,15 @@ bool parse_and_validate_tx_from_blob(
     CHECK_AND_ASSERT_MES(
             expand_transaction_1(tx, false), false, "Failed to expand transaction data");
     tx.invalidate_hashes();
+    tx.set_blob_size(tx_blob.size());
     // TODO: validate tx
 
-    return get_transaction_hash(tx, tx_hash);
+    crypto::hash tx_prefix_hash;
+    if (!calculate_transaction_hash(tx, tx_blob, tx_hash, tx_prefix_hash))
+        return false;
+    tx.set_hash(tx_hash);
+    tx.set_prefix_hash(tx_prefix_hash);
+    return true;
 }
 //---------------------------------------------------------------
 bool parse_and_validate_tx_from_blob(
@@ -641,6 +669,19 @@ uint64_t get_tx_miner_fee(const transaction& tx, bool burning_enabled) {
     return true;
 }
 //---------------------------------------------------------------
+const std::vector<tx_extra_field>* get_tx_extra_fields(
+        const transaction_prefix& tx, std::vector<tx_extra_field>& fallback) {
+    auto* cache = tx.extra_cache.get();
+    if (!cache) {
+        auto* c = new tx_extra_cache{tx.extra, false, {}};
+        c->valid = parse_tx_extra(c->extra, c->fields);
+        cache = tx.extra_cache.set(c);
+    }
+    if (cache->extra != tx.extra)
+        return parse_tx_extra(tx.extra, fallback) ? &fallback : nullptr;
+    return cache->valid ? &cache->fields : nullptr;
+}
+//---------------------------------------------------------------
 [[nodiscard]] bool sort_tx_extra(
         const std::vector<uint8_t>& tx_extra, std::vector<uint8_t>& sorted_tx_extra) {
     std::vector<tx_extra_field> tx_extra_fields;
@@ -675,7 +716,10 @@ crypto::public_key get_tx_pub_key_from_extra(
 }
 //---------------------------------------------------------------
 crypto::public_key get_tx_pub_key_from_extra(const transaction_prefix& tx_prefix, size_t pk_index) {
-    return get_tx_pub_key_from_extra(tx_prefix.extra, pk_index);
+    tx_extra_pub_key pub_key_field;
+    if (get_field_from_tx_extra(tx_prefix, pub_key_field, pk_index))
+        return pub_key_field.pub_key;
+    return null<public_key>;
 }
 //---------------------------------------------------------------
 void add_tagged_data_to_tx_extra(
@@ -695,7 +739,10 @@ std::vector<crypto::public_key> get_additional_tx_pub_keys_from_extra(
 //---------------------------------------------------------------
 std::vector<crypto::public_key> get_additional_tx_pub_keys_from_extra(
         const transaction_prefix& tx) {
-    return get_additional_tx_pub_keys_from_extra(tx.extra);
+    tx_extra_additional_pub_keys additional_pub_keys;
+    if (get_field_from_tx_extra(tx, additional_pub_keys))
+        return additional_pub_keys.data;
+    return {};
 }
 //---------------------------------------------------------------
 static bool add_tx_extra_field_to_tx_extra(std::vector<uint8_t>& tx_extra, tx_extra_field& field) {
@@ -1189,6 +1236,49 @@ std::optional<subaddress_receive_info> is_out_to_acc_precomp(
     return std::nullopt;
 }
 //---------------------------------------------------------------
+std::vector<std::optional<subaddress_receive_info>> outs_to_acc_precomp(
+        const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses,
+        const std::vector<crypto::public_key>& out_keys,
+        const std::vector<size_t>& output_indices,
+        const crypto::key_derivation& derivation,
+        const std::vector<crypto::key_derivation>& additional_derivations,
+        hw::device& hwdev) {
+    const size_t n = out_keys.size();
+    std::vector<std::optional<subaddress_receive_info>> results(n);
+    std::vector<crypto::public_key> spendkeys;
+    hwdev.derive_subaddress_public_keys(
+            out_keys,
+            std::vector<crypto::key_derivation>(n, derivation),
+            output_indices,
+            spendkeys);
+
+    std::vector<crypto::public_key> retry_keys;
+    std::vector<crypto::key_derivation> retry_derivations;
+    std::vector<size_t> retry_indices, retry;
+    for (size_t j = 0; j < n; j++) {
+        if (auto found = subaddresses.find(spendkeys[j]); found != subaddresses.end())
+            results[j] = subaddress_receive_info{found->second, derivation};
+        else if (!additional_derivations.empty()) {
+            if (output_indices[j] >= additional_derivations.size()) {
+                log::error(logcat, "wrong number of additional derivations");
+                continue;
+            }
+            retry_keys.push_back(out_keys[j]);
+            retry_derivations.push_back(additional_derivations[output_indices[j]]);
+            retry_indices.push_back(output_indices[j]);
+            retry.push_back(j);
+        }
+    }
+    if (retry.empty())
+        return results;
+
+    hwdev.derive_subaddress_public_keys(retry_keys, retry_derivations, retry_indices, spendkeys);
+    for (size_t r = 0; r < retry.size(); r++)
+        if (auto found = subaddresses.find(spendkeys[r]); found != subaddresses.end())
+            results[retry[r]] = subaddress_receive_info{found->second, retry_derivations[r]};
+    return results;
+}
+//---------------------------------------------------------------
 bool lookup_acc_outs(
         const account_keys& acc,
         const transaction& tx,
@@ -1498,29 +1588,52 @@ crypto::hash get_pruned_transaction_hash(
     return res;
 }
 //---------------------------------------------------------------
-bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t* blob_size) {
+bool calculate_transaction_hash(
+        const transaction& t,
+        std::string_view blob,
+        crypto::hash& res,
+        crypto::hash& prefix_hash) {
+    const unsigned int prefix_size = t.prefix_size;
+    CHECK_AND_ASSERT_MES(
+            prefix_size <= blob.size(),
+            false,
+            "Inconsistent transaction prefix ({}) and blob ({}) sizes",
+            prefix_size,
+            blob.size());
+
     // v1 transactions hash the entire blob
     if (t.version == txversion::v1) {
-        size_t ignored_blob_size, &blob_size_ref = blob_size ? *blob_size : ignored_blob_size;
-        return get_object_hash(t, res, blob_size_ref);
+        get_blob_hash(blob.substr(0, prefix_size), prefix_hash);
+        get_blob_hash(blob, res);
+        return true;
     }
 
     // v2 transactions hash different parts together, than hash the set of those hashes
     crypto::hash hashes[3];
 
-    // prefix
-    get_transaction_prefix_hash(t, hashes[0]);
-
-    const std::string blob = tx_to_blob(t);
-    CHECK_AND_ASSERT_MES(!blob.empty(), false, "Failed to convert tx to blob");
-
     // TODO(oxen): Not sure if this is the right fix, we may just want to set
     // unprunable size to the size of the prefix because technically that is
     // what it is and then keep this code path.
-    if (t.is_transfer()) {
-        const unsigned int unprunable_size = t.unprunable_size;
-        const unsigned int prefix_size = t.prefix_size;
+    const unsigned int unprunable_size = t.unprunable_size;
+
+    // Common case: all three parts are slices of the blob, so hash them together in one pass.
+    if (t.is_transfer() && t.rct_signatures.type != rct::RCTType::Null && unprunable_size &&
+        prefix_size <= unprunable_size && unprunable_size <= blob.size()) {
+        const std::array<std::string_view, 3> parts{
+                blob.substr(0, prefix_size),
+                blob.substr(prefix_size, unprunable_size - prefix_size),
+                blob.substr(unprunable_size)};
+        crypto::cn_fast_hash(parts, hashes);
+        prefix_hash = hashes[0];
+        res = cn_fast_hash(hashes, sizeof(hashes));
+        return true;
+    }
 
+    // prefix
+    get_blob_hash(blob.substr(0, prefix_size), prefix_hash);
+    hashes[0] = prefix_hash;
+
+    if (t.is_transfer()) {
         // base rct
         CHECK_AND_ASSERT_MES(
                 prefix_size <= unprunable_size && unprunable_size <= blob.size(),
@@ -1529,9 +1642,7 @@ bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t*
                 prefix_size,
                 unprunable_size,
                 blob.size());
-        cryptonote::get_blob_hash(
-                std::string_view{blob}.substr(prefix_size, unprunable_size - prefix_size),
-                hashes[1]);
+        get_blob_hash(blob.substr(prefix_size, unprunable_size - prefix_size), hashes[1]);
     } else {
         transaction& tt = const_cast<transaction&>(t);
         serialization::binary_string_archiver ba;
@@ -1541,19 +1652,35 @@ bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t*
             log::error(logcat, "Failed to serialize rct signatures base: {}", e.what());
             return false;
         }
-        cryptonote::get_blob_hash(ba.str(), hashes[1]);
+        get_blob_hash(ba.str(), hashes[1]);
     }
 
     // prunable rct
     if (t.rct_signatures.type == rct::RCTType::Null) {
         hashes[2].zero();
-    } else if (!calculate_transaction_prunable_hash(t, &blob, hashes[2])) {
+    } else if (unprunable_size) {
+        CHECK_AND_ASSERT_MES(
+                unprunable_size <= blob.size(),
+                false,
+                "Inconsistent transaction unprunable and blob sizes");
+        get_blob_hash(blob.substr(unprunable_size), hashes[2]);
+    } else if (!calculate_transaction_prunable_hash(t, nullptr, hashes[2])) {
         log::error(logcat, "Failed to get tx prunable hash");
         return false;
     }
 
     // the tx hash is the hash of the 3 hashes
     res = cn_fast_hash(hashes, sizeof(hashes));
+    return true;
+}
+//---------------------------------------------------------------
+bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t* blob_size) {
+    const std::string blob = tx_to_blob(t);
+    CHECK_AND_ASSERT_MES(!blob.empty(), false, "Failed to convert tx to blob");
+
+    crypto::hash prefix_hash;
+    if (!calculate_transaction_hash(t, blob, res, prefix_hash))
+        return false;
 
     // we still need the size
     if (blob_size) {
@@ -64,6 +64,9 @@ void get_transaction_prefix_hash(const transaction_prefix& tx, crypto::hash& h,
 crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx, hw::device& hwdev);
 void get_transaction_prefix_hash(const transaction_prefix& tx, crypto::hash& h);
 crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx);
+// Same as the above, but returns the prefix hash cached in the transaction, if it has one.
+void get_transaction_prefix_hash(const transaction& tx, crypto::hash& h);
+crypto::hash get_transaction_prefix_hash(const transaction& tx);
 bool parse_and_validate_tx_prefix_from_blob(const std::string_view tx_blob, transaction_prefix& tx);
 bool parse_and_validate_tx_from_blob(
         const std::string_view tx_blob,
@@ -125,6 +128,11 @@ void add_tx_extra(transaction_prefix& tx, const T& val) {
 
 bool parse_tx_extra(
         const std::vector<uint8_t>& tx_extra, std::vector<tx_extra_field>& tx_extra_fields);
+// Returns the parsed fields of `tx.extra`, parsing them on first use and caching them in the tx for
+// later calls.  Returns nullptr if the extra fails to parse.  If the tx's extra has been modified
+// since it was cached then it gets parsed into (and the returned pointer refers to) `fallback`.
+const std::vector<tx_extra_field>* get_tx_extra_fields(
+        const transaction_prefix& tx, std::vector<tx_extra_field>& fallback);
 bool sort_tx_extra(const std::vector<uint8_t>& tx_extra, std::vector<uint8_t>& sorted_tx_extra);
 
 template <typename T>
@@ -134,6 +142,15 @@ bool get_field_from_tx_extra(const std::vector<uint8_t>& tx_extra, T& field, siz
            find_tx_extra_field_by_type(tx_extra_fields, field, skip);
 }
 
+// Same as above, but takes the tx itself, which lets it use (and fill) the tx's cache of parsed
+// extra fields.  Prefer this when looking up fields of a tx that you already have.
+template <typename T>
+bool get_field_from_tx_extra(const transaction_prefix& tx, T& field, size_t skip = 0) {
+    std::vector<tx_extra_field> fallback;
+    auto* fields = get_tx_extra_fields(tx, fallback);
+    return fields && find_tx_extra_field_by_type(*fields, field, skip);
+}
+
 crypto::public_key get_tx_pub_key_from_extra(
         const std::vector<uint8_t>& tx_extra, size_t pk_index = 0);
 crypto::public_key get_tx_pub_key_from_extra(const transaction_prefix& tx, size_t pk_index = 0);
@@ -218,6 +235,16 @@ std::optional<subaddress_receive_info> is_out_to_acc_precomp(
         const std::vector<crypto::key_derivation>& additional_derivations,
         size_t output_index,
         hw::device& hwdev);
+// Same as calling is_out_to_acc_precomp for each of a transaction's outputs, where out_keys[j] is
+// the key of output output_indices[j], but deriving in batches: first everything with the shared
+// derivation, then whatever didn't match with its additional derivation.
+std::vector<std::optional<subaddress_receive_info>> outs_to_acc_precomp(
+        const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses,
+        const std::vector<crypto::public_key>& out_keys,
+        const std::vector<size_t>& output_indices,
+        const crypto::key_derivation& derivation,
+        const std::vector<crypto::key_derivation>& additional_derivations,
+        hw::device& hwdev);
 bool lookup_acc_outs(
         const account_keys& acc,
         const transaction& tx,
@@ -264,6 +291,13 @@ bool calculate_transaction_prunable_hash(
         const transaction& t, const std::string* blob, crypto::hash& res);
 crypto::hash get_transaction_prunable_hash(const transaction& t, const std::string* blob = NULL);
 bool calculate_transaction_hash(const transaction& t, crypto::hash& res, size_t* blob_size);
+// Calculates the hash and prefix hash of `t` directly from `blob`, which must be the serialized
+// transaction that `t` was parsed from (or serialized into).
+bool calculate_transaction_hash(
+        const transaction& t,
+        std::string_view blob,
+        crypto::hash& res,
+        crypto::hash& prefix_hash);
 crypto::hash get_pruned_transaction_hash(
         const transaction& t, const crypto::hash& pruned_data_hash);
 
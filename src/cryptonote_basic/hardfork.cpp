@@ -28,7 +28,9 @@
 
 #include "hardfork.h"
 
+#include <algorithm>
 #include <array>
+#include <limits>
 
 namespace cryptonote {
 
@@ -207,6 +209,83 @@ static_assert(
         "Invalid devnet hard forks: version must start at 7, versions and heights must be strictly "
         "increasing, and timestamps must be non-decreasing");
 
+static_assert(
+        is_ordered(local_devnet_hard_forks),
+        "Invalid localdev hard forks: version must start at 7, versions and heights must be "
+        "strictly increasing, and timestamps must be non-decreasing");
+
+namespace {
+
+    // Lookup tables for the built-in networks, generated at compile time from the hard fork lists
+    // above, so that the height -> version and version -> height lookups below (which get called
+    // for nearly everything we validate) don't have to walk the hard fork list.
+    struct fork_table {
+        static constexpr size_t MAX_FORKS = 32;
+        static constexpr size_t NUM_VERSIONS = static_cast<size_t>(hf::_next) + 1;
+
+        size_t count = 0;
+        std::array<uint64_t, MAX_FORKS> heights{};
+        std::array<std::pair<hf, uint8_t>, MAX_FORKS> versions{};
+        // begins[v] is the height at which version v (or the first version after it, if v is
+        // skipped) activates, or uint64_t max if no such version is scheduled.  Versions above
+        // hf_max all map to the hf::_next element, which is never scheduled.
+        std::array<uint64_t, NUM_VERSIONS> begins{};
+
+        template <size_t N>
+        consteval explicit fork_table(const std::array<hard_fork, N>& forks) : count{N} {
+            static_assert(N <= MAX_FORKS);
+            for (size_t i = 0; i < N; i++) {
+                heights[i] = forks[i].height;
+                versions[i] = {forks[i].version, forks[i].snode_revision};
+            }
+            for (size_t v = 0; v < NUM_VERSIONS; v++) {
+                begins[v] = std::numeric_limits<uint64_t>::max();
+                for (const auto& f : forks) {
+                    if (static_cast<size_t>(f.version) >= v) {
+                        begins[v] = f.height;
+                        break;
+                    }
+                }
+            }
+        }
+
+        std::pair<hf, uint8_t> version_at(uint64_t height) const {
+            // Heights are strictly increasing, so the active fork is the last of the ones that have
+            // started; counting them (rather than searching) compiles to a short branchless loop.
+            size_t started = 0;
+            for (size_t i = 0; i < count; i++)
+                started += heights[i] <= height;
+            return started ? versions[started - 1] : std::pair<hf, uint8_t>{};
+        }
+
+        uint64_t begins_at(hf version) const {
+            return begins[std::min(static_cast<size_t>(version), NUM_VERSIONS - 1)];
+        }
+    };
+
+    constexpr fork_table mainnet_table{mainnet_hard_forks};
+    constexpr fork_table testnet_table{testnet_hard_forks};
+    constexpr fork_table devnet_table{devnet_hard_forks};
+    constexpr fork_table local_devnet_table{local_devnet_hard_forks};
+    constexpr fork_table stagenet_table{stagenet_hard_forks};
+
+    // Returns the lookup table for a network, or nullptr for the fakechain (whose hard forks are
+    // only known at runtime, so get looked up from fakechain_hardforks).
+    const fork_table* get_fork_table(network_type type) {
+        switch (type) {
+            case network_type::MAINNET: return &mainnet_table;
+            case network_type::STAGENET: return &stagenet_table;
+            case network_type::TESTNET: return &testnet_table;
+            case network_type::DEVNET: return &devnet_table;
+            case network_type::LOCALDEV: return &local_devnet_table;
+            case network_type::FAKECHAIN:
+            case network_type::UNDEFINED:;
+        }
+        return nullptr;
+    }
+
+}  // namespace
+
 std::vector<hard_fork> fakechain_hardforks;
 
 std::span<const hard_fork> get_hard_forks(network_type type) {
@@ -251,6 +330,9 @@ hf hard_fork_ceil(network_type nettype, hf version) {
 }
 
 std::pair<hf, uint8_t> get_network_version_revision(network_type nettype, uint64_t height) {
+    if (auto* table = get_fork_table(nettype))
+        return table->version_at(height);
+
     std::pair<hf, uint8_t> result;
     for (auto& h : get_hard_forks(nettype)) {
         if (h.height <= height)
@@ -262,9 +344,22 @@ std::pair<hf, uint8_t> get_network_version_revision(network_type nettype, uint64
 }
 
 bool is_hard_fork_at_least(network_type type, hf version, uint64_t height) {
+    if (auto* table = get_fork_table(type)) {
+        auto begins = table->begins_at(version);
+        return height >= begins && begins != std::numeric_limits<uint64_t>::max();
+    }
     return get_network_version(type, height) >= version;
 }
 
+std::optional<uint64_t> hard_fork_begins(network_type type, hf version) {
+    if (auto* table = get_fork_table(type)) {
+        if (auto height = table->begins_at(version); height != std::numeric_limits<uint64_t>::max())
+            return height;
+        return std::nullopt;
+    }
+    return get_hard_fork_heights(type, hard_fork_ceil(type, version)).first;
+}
+
 std::pair<hf, uint8_t> get_ideal_block_version(network_type nettype, uint64_t height) {
     std::pair<hf, uint8_t> result;
     for (auto& h : get_hard_forks(nettype)) {
@@ -105,9 +105,7 @@ inline hf get_network_version(network_type nettype, uint64_t height) {
 // be nullopt, but `hard_fork_begins(stagenet, hf16)` will return the HF21 fork height.
 //
 // Equivalent to `get_hard_fork_heights(type, hard_fork_ceil(type, version)).first`
-inline std::optional<uint64_t> hard_fork_begins(network_type type, hf version) {
-    return get_hard_fork_heights(type, hard_fork_ceil(type, version)).first;
-}
+std::optional<uint64_t> hard_fork_begins(network_type type, hf version);
 
 // Returns the "ideal" network version that we want to use on blocks we create, which is to use
 // the required major version and current minor version.  (Minor versions are sometimes used to
@@ -34,6 +34,7 @@
 #include <logging/oxen_logger.h>
 #include <oxenc/base64.h>
 
+#include <array>
 #include <numeric>
 #include <stdexcept>
 
@@ -50,6 +51,11 @@
 
 #include "miner.h"
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 extern "C" void rx_slow_hash_allocate_state();
 extern "C" void rx_slow_hash_free_state();
 
@@ -61,18 +67,27 @@ namespace {
             "start-mining", "Specify wallet address to mining for"};
     const command_line::arg_descriptor<uint32_t> arg_mining_threads = {
             "mining-threads", "Specify mining threads count"};
+    const command_line::arg_flag arg_mining_pin_threads = {
+            "mining-pin-threads",
+            "Pin each mining thread to its own CPU (Linux only).  On multi-socket machines this "
+            "keeps each thread's RandomX VM and scratchpad local to the CPU running it."};
+
+    // Number of nonces each mining thread hashes between checks for a new block template.  Larger
+    // batches amortize the per-template setup; this is small enough that a new template is still
+    // picked up within a few hashes.
+    constexpr size_t MINING_BATCH_SIZE = 8;
 }  // namespace
 
 miner::miner(
-        get_block_hash_cb hash,
+        get_block_hashes_cb hash,
         handle_block_found_cb found,
         create_next_miner_block_template_cb create) :
         m_stop{1},
         m_template{},
-        m_get_block_hash{std::move(hash)},
+        m_get_block_hashes{std::move(hash)},
         m_handle_block_found{std::move(found)},
         m_create_next_miner_block_template{std::move(create)} {
-    if (!(m_get_block_hash && m_handle_block_found && m_create_next_miner_block_template))
+    if (!(m_get_block_hashes && m_handle_block_found && m_create_next_miner_block_template))
         throw oxen::traced<std::invalid_argument>{
                 "Invalid miner constructor: required callbacks cannot be null"};
 }
@@ -137,18 +152,24 @@ void miner::update_hashrate() {
     std::unique_lock lock{m_hashrate_mutex};
     auto hashes = m_hashes.exchange(0);
     using dseconds = std::chrono::duration<double>;
-    if (m_last_hr_update && is_mining())
-        m_current_hash_rate =
-                hashes / dseconds{std::chrono::steady_clock::now() - *m_last_hr_update}.count();
-    m_last_hr_update = std::chrono::steady_clock::now();
+    auto now = std::chrono::steady_clock::now();
+    if (m_last_hr_update && is_mining()) {
+        double elapsed = dseconds{now - *m_last_hr_update}.count();
+        m_current_hash_rate = hashes / elapsed;
+        for (size_t i = 0; i < m_thread_hash_rates.size(); i++)
+            m_thread_hash_rates[i] = m_thread_hashes[i].exchange(0) / elapsed;
+    }
+    m_last_hr_update = now;
 }
 //-----------------------------------------------------------------------------------------------------
 void miner::init_options(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_start_mining);
     command_line::add_arg(desc, arg_mining_threads);
+    command_line::add_arg(desc, arg_mining_pin_threads);
 }
 //-----------------------------------------------------------------------------------------------------
 bool miner::init(const boost::program_options::variables_map& vm, network_type nettype) {
+    m_pin_threads = command_line::get_arg(vm, arg_mining_pin_threads);
     if (!command_line::is_arg_defaulted(vm, arg_start_mining)) {
         address_parse_info info;
         if (!cryptonote::get_account_address_from_str(
@@ -201,6 +222,12 @@ bool miner::start(
 
     request_block_template();  // lets update block template
 
+    {
+        std::unique_lock hr_lock{m_hashrate_mutex};
+        m_thread_hashes = std::make_unique<std::atomic<uint64_t>[]>(m_threads_total);
+        m_thread_hash_rates.assign(m_threads_total, 0.0);
+    }
+
     m_stop = false;
     m_stop_height = stop_after > 0 ? m_height + stop_after : std::numeric_limits<uint64_t>::max();
     if (stop_after > 0)
@@ -222,6 +249,14 @@ double miner::get_speed() const {
     return 0.0;
 }
 //-----------------------------------------------------------------------------------------------------
+std::vector<double> miner::get_thread_speeds() const {
+    if (is_mining()) {
+        std::unique_lock lock{m_hashrate_mutex};
+        return m_thread_hash_rates;
+    }
+    return {};
+}
+//-----------------------------------------------------------------------------------------------------
 extern "C" void rx_stop_mining(void);
 //-----------------------------------------------------------------------------------------------------
 bool miner::stop() {
@@ -286,13 +321,51 @@ void miner::resume() {
         log::debug(logcat, "MINING RESUMED");
 }
 //-----------------------------------------------------------------------------------------------------
+void miner::pin_worker_thread(uint32_t index) {
+#ifdef __linux__
+    // Thread i goes on the i-th CPU we are allowed to run on.  CPUs are numbered node by node on
+    // typical NUMA machines, so this also keeps the threads on as few nodes as possible.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        log::warning(logcat, "Unable to pin miner thread [{}]: can't get the CPU set", index);
+        return;
+    }
+    int const cpus = CPU_COUNT(&allowed);
+    if (cpus <= 0)
+        return;
+    uint32_t nth = index % cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || nth--)
+            continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (int err = pthread_setaffinity_np(pthread_self(), sizeof(one), &one); err != 0)
+            log::warning(
+                    logcat, "Unable to pin miner thread [{}] to CPU {}: {}", index, cpu, err);
+        else
+            log::debug(logcat, "Pinned miner thread [{}] to CPU {}", index, cpu);
+        return;
+    }
+#else
+    log::warning(logcat, "Pinning miner threads is not supported on this platform");
+#endif
+}
+//-----------------------------------------------------------------------------------------------------
 bool miner::worker_thread(uint32_t index, bool slow_mining) {
     log::info(logcat, "Miner thread was started [{}]", index);
+    // Pin before allocating anything so that the thread's RandomX VM ends up in memory local to the
+    // CPU it runs on.
+    if (m_pin_threads)
+        pin_worker_thread(index);
     uint32_t nonce = m_starter_nonce + index;
     uint64_t height = 0;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     block b;
+    std::array<uint32_t, MINING_BATCH_SIZE> nonces;
+    std::array<crypto::hash, MINING_BATCH_SIZE> hashes;
     rx_slow_hash_allocate_state();
     bool call_stop = false;
 
@@ -328,12 +401,21 @@ bool miner::worker_thread(uint32_t index, bool slow_mining) {
             break;
         }
 
-        b.nonce = nonce;
-        crypto::hash h;
-        m_get_block_hash(b, height, slow_mining ? 0 : tools::get_max_concurrency(), h);
-
-        if (check_hash(h, local_diff)) {
+        for (auto& n : nonces) {
+            n = nonce;
+            nonce += static_cast<uint32_t>(m_threads_total);
+        }
+        m_get_block_hashes(
+                b, height, slow_mining ? 0 : tools::get_max_concurrency(), nonces, hashes);
+        m_hashes += nonces.size();
+        m_thread_hashes[index] += nonces.size();
+
+        for (size_t i = 0; i < nonces.size(); i++) {
+            if (!check_hash(hashes[i], local_diff))
+                continue;
             // we lucky!
+            b.nonce = nonces[i];
+            b.invalidate_hashes();
             log::info(
                     logcat,
                     fg(fmt::terminal_color::green),
@@ -343,10 +425,10 @@ bool miner::worker_thread(uint32_t index, bool slow_mining) {
                     local_diff);
             cryptonote::block_verification_context bvc;
             m_handle_block_found(b, bvc);
+            // The rest of the batch is for the block we just found; the next loop picks up the
+            // template for the one after it.
+            break;
         }
-
-        nonce += static_cast<uint32_t>(m_threads_total);
-        ++m_hashes;
     }
     rx_slow_hash_free_state();
     log::info(logcat, "Miner thread stopped [{}]", index);
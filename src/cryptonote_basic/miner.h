@@ -31,7 +31,10 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <span>
 #include <thread>
+#include <vector>
 
 #include "common/fs.h"
 #include "common/periodic_task.h"
@@ -71,6 +74,14 @@ class miner {
   public:
     using get_block_hash_cb =
             std::function<bool(const cryptonote::block&, uint64_t, unsigned int, crypto::hash&)>;
+    // Batch version of get_block_hash_cb used by the mining threads: computes the hashes of the
+    // block with each of the given nonces (in place of the block's own nonce) into `hashes`.
+    using get_block_hashes_cb = std::function<bool(
+            const cryptonote::block& b,
+            uint64_t height,
+            unsigned int threads,
+            std::span<const uint32_t> nonces,
+            std::span<crypto::hash> hashes)>;
     using handle_block_found_cb = std::function<bool(block& b, block_verification_context& bvc)>;
     using create_next_miner_block_template_cb = std::function<bool(
             block& b,
@@ -80,7 +91,7 @@ class miner {
             uint64_t& expected_reward,
             const std::string& ex_nonce)>;
 
-    miner(get_block_hash_cb hash,
+    miner(get_block_hashes_cb hash,
           handle_block_found_cb found,
           create_next_miner_block_template_cb create);
     ~miner();
@@ -95,11 +106,20 @@ class miner {
             int stop_after = 0,
             bool slow_mining = false);
     double get_speed() const;
+    // Returns the hash rate of each mining thread, as of the last hash rate update
+    std::vector<double> get_thread_speeds() const;
+    // True if mining threads get pinned to CPUs (--mining-pin-threads)
+    bool pins_threads() const { return m_pin_threads; }
     uint32_t get_threads_count() const;
     bool stop();
     bool is_mining() const;
     const account_public_address& get_mining_address() const;
     bool on_idle();
+    // When on_idle() next has something to do
+    std::chrono::steady_clock::time_point next_idle_due() const {
+        return std::min(
+                m_update_block_template_interval.next_due(), m_update_hashrate_interval.next_due());
+    }
     void on_synchronized();
     // synchronous analog (for fast calls)
     static bool find_nonce_for_given_block(
@@ -113,6 +133,7 @@ class miner {
 
   private:
     bool worker_thread(uint32_t index, bool slow_mining = false);
+    void pin_worker_thread(uint32_t index);
     bool request_block_template();
     void update_hashrate();
 
@@ -138,7 +159,8 @@ class miner {
 
     std::list<std::thread> m_threads;
     std::mutex m_threads_lock;
-    get_block_hash_cb m_get_block_hash;
+    bool m_pin_threads = false;
+    get_block_hashes_cb m_get_block_hashes;
     handle_block_found_cb m_handle_block_found;
     create_next_miner_block_template_cb m_create_next_miner_block_template;
     account_public_address m_mine_address;
@@ -149,6 +171,9 @@ class miner {
     std::optional<std::chrono::steady_clock::time_point> m_last_hr_update;
     std::atomic<uint64_t> m_hashes = 0;
     double m_current_hash_rate = 0.0;
+    // Per-thread hash counts since the last hash rate update, and the rates they gave
+    std::unique_ptr<std::atomic<uint64_t>[]> m_thread_hashes;
+    std::vector<double> m_thread_hash_rates;
 
     bool m_do_mining = false;
     std::atomic<uint64_t> m_block_reward = 0;
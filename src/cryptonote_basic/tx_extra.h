@@ -682,6 +682,16 @@ using tx_extra_field = std::variant<
         tx_extra_merge_mining_tag,
         tx_extra_mysterious_minergate,
         tx_extra_padding>;
+
+// The parsed fields of a tx's extra, cached in the tx (see transaction_prefix::extra_cache) so that
+// looking up several fields of the same tx only parses its extra once.  `extra` is a copy of the
+// bytes the fields were parsed from, so that a cache left over from before the tx's extra was
+// modified is recognized and ignored.
+struct tx_extra_cache {
+    std::vector<uint8_t> extra;
+    bool valid;  // False if `extra` failed to parse, in which case `fields` is empty
+    std::vector<tx_extra_field> fields;
+};
 }  // namespace cryptonote
 
 BLOB_SERIALIZER(cryptonote::tx_extra_service_node_deregister_old::vote);
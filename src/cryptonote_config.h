@@ -87,6 +87,9 @@ inline constexpr auto ETH_L2_DEFAULT_REQUEST_TIMEOUT = 5s;
 // used to retrieve the logs.  Can be adjusted at runtime using the --l2-max-logs command
 // line/config file setting.
 inline constexpr auto ETH_L2_DEFAULT_MAX_LOGS = 1000;
+// The default number of log requests (of up to the max logs value, above) that we have in flight at
+// once when catching up on L2 logs.  Can be adjusted using the --l2-concurrent-logs setting.
+inline constexpr auto ETH_L2_DEFAULT_CONCURRENT_LOGS = 4;
 // When refreshing, this controls how often we get heights from *all* configured L2 providers
 // (instead of just the primary one) to check whether L2 providers are in sync.  (This only applies
 // when multiple L2 providers are in use).
@@ -186,6 +189,12 @@ inline constexpr uint64_t NOISE_BYTES = 3 * 1024;  // 3 kiB
 inline constexpr size_t NOISE_CHANNELS = 2;
 // ~20 * NOISE_BYTES max payload size for covert/noise send:
 inline constexpr size_t MAX_FRAGMENTS = 20;
+// Public txs are flooded in batches collected over this long (so that we can learn which peers
+// already have them before sending):
+inline constexpr auto FLOOD_BATCH_INTERVAL = 250ms;
+// Anonymity network (non-noise) batches wait up to this much longer again, chosen at random per
+// batch, so that when a local tx goes out over tor/i2p doesn't give away when it was submitted:
+inline constexpr auto FLOOD_ANON_DELAY_RANGE = 2s;
 
 // p2p-specific constants:
 namespace p2p {
@@ -212,6 +221,10 @@ namespace p2p {
     inline constexpr auto IP_BLOCK_TIME = 24h;
     inline constexpr size_t IP_FAILS_BEFORE_BLOCK = 10;
     inline constexpr auto IDLE_CONNECTION_KILL_INTERVAL = 5min;
+    // Peer requests for blocks and txs are served by this many threads, off the p2p io threads:
+    inline constexpr size_t REQUEST_THREADS = 2;
+    // A peer with more than this many such requests waiting to be served gets dropped:
+    inline constexpr size_t MAX_QUEUED_REQUESTS_PER_PEER = 8;
     inline constexpr uint32_t SUPPORT_FLAG_FLUFFY_BLOCKS = 0x01;
     inline constexpr uint32_t SUPPORT_FLAGS = SUPPORT_FLAG_FLUFFY_BLOCKS;
 
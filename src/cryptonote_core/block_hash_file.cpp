@@ -0,0 +1,164 @@
+#include "block_hash_file.h"
+
+#include <fmt/std.h>
+#include <oxenc/endian.h>
+#include <sodium/crypto_sign.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include "common/file.h"
+#endif
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "common/format.h"
+
+namespace cryptonote {
+
+namespace {
+
+    constexpr size_t SIGNATURE_SIZE = sizeof(crypto::ed25519_signature);
+    static_assert(SIGNATURE_SIZE == crypto_sign_BYTES);
+    static_assert(block_hash_file::HEADER_SIZE % sizeof(crypto::hash) == 0);
+
+    std::runtime_error load_error(const fs::path& path, std::string_view what) {
+        return std::runtime_error{"Invalid block hash file {}: {}"_format(path, what)};
+    }
+
+}  // namespace
+
+block_hash_file::block_hash_file(
+        const fs::path& path, network_type nettype, const crypto::ed25519_public_key* signer) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error{
+                "Failed to open block hash file {}: {}"_format(path, std::strerror(errno))};
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::runtime_error{
+                "Failed to stat block hash file {}: {}"_format(path, std::strerror(err))};
+    }
+    if (static_cast<uint64_t>(st.st_size) < HEADER_SIZE) {
+        close(fd);
+        throw load_error(path, "file is too short");
+    }
+    m_size = st.st_size;
+    void* map = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    int err = errno;
+    // The mapping stays valid without the descriptor
+    close(fd);
+    if (map == MAP_FAILED)
+        throw std::runtime_error{
+                "Failed to map block hash file {}: {}"_format(path, std::strerror(err))};
+    m_data = static_cast<const char*>(map);
+#else
+    if (!tools::slurp_file(path, m_contents))
+        throw std::runtime_error{"Failed to read block hash file {}"_format(path)};
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+    if (m_size < HEADER_SIZE)
+        throw load_error(path, "file is too short");
+#endif
+
+    try {
+        if (std::string_view{m_data, MAGIC.size()} != MAGIC)
+            throw load_error(path, "bad magic");
+        if (auto v = oxenc::load_little_to_host<uint32_t>(m_data + 8); v != VERSION)
+            throw load_error(path, "unsupported version {}"_format(v));
+        if (auto n = oxenc::load_little_to_host<uint32_t>(m_data + 12);
+            n != static_cast<uint8_t>(nettype))
+            throw load_error(path, "file is for a different network (type {})"_format(n));
+        if (auto step = oxenc::load_little_to_host<uint32_t>(m_data + 16);
+            step != HASH_OF_HASHES_STEP)
+            throw load_error(
+                    path,
+                    "hash step {} does not match expected {}"_format(step, HASH_OF_HASHES_STEP));
+        auto flags = oxenc::load_little_to_host<uint32_t>(m_data + 20);
+        if (flags & ~FLAG_SIGNED)
+            throw load_error(path, "unknown flags {:#x}"_format(flags));
+        m_signed = flags & FLAG_SIGNED;
+        auto count = oxenc::load_little_to_host<uint64_t>(m_data + 24);
+
+        size_t overhead = HEADER_SIZE + (m_signed ? SIGNATURE_SIZE : 0);
+        if (m_size < overhead || (m_size - overhead) % sizeof(crypto::hash) ||
+            count != (m_size - overhead) / sizeof(crypto::hash))
+            throw load_error(
+                    path, "file size {} does not match hash count {}"_format(m_size, count));
+        m_count = count;
+
+        if (signer) {
+            if (!m_signed)
+                throw load_error(path, "file is not signed");
+            size_t signed_len = m_size - SIGNATURE_SIZE;
+            if (0 != crypto_sign_verify_detached(
+                             reinterpret_cast<const unsigned char*>(m_data + signed_len),
+                             reinterpret_cast<const unsigned char*>(m_data),
+                             signed_len,
+                             signer->data()))
+                throw load_error(path, "signature verification failed");
+        }
+    } catch (...) {
+#ifndef _WIN32
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+        throw;
+    }
+}
+
+block_hash_file::~block_hash_file() {
+#ifndef _WIN32
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+crypto::hash block_hash_file::operator[](size_t i) const {
+    assert(i < m_count);
+    crypto::hash h;
+    std::memcpy(h.data(), m_data + HEADER_SIZE + i * sizeof(crypto::hash), h.size());
+    return h;
+}
+
+std::string block_hash_file::serialize(
+        network_type nettype,
+        std::span<const crypto::hash> hashes,
+        const crypto::ed25519_secret_key* signing_key) {
+    std::string out;
+    out.reserve(HEADER_SIZE + hashes.size() * sizeof(crypto::hash) + SIGNATURE_SIZE);
+    out += MAGIC;
+    auto append_le = [&out]<typename T>(T val) {
+        oxenc::host_to_little_inplace(val);
+        out.append(reinterpret_cast<const char*>(&val), sizeof(val));
+    };
+    append_le(VERSION);
+    append_le(uint32_t{static_cast<uint8_t>(nettype)});
+    append_le(static_cast<uint32_t>(HASH_OF_HASHES_STEP));
+    append_le(signing_key ? FLAG_SIGNED : uint32_t{0});
+    append_le(uint64_t{hashes.size()});
+    for (const auto& h : hashes)
+        out.append(reinterpret_cast<const char*>(h.data()), h.size());
+
+    if (signing_key) {
+        crypto::ed25519_signature sig;
+        crypto_sign_detached(
+                sig.data(),
+                nullptr,
+                reinterpret_cast<const unsigned char*>(out.data()),
+                out.size(),
+                signing_key->data());
+        out.append(reinterpret_cast<const char*>(sig.data()), sig.size());
+    }
+    return out;
+}
+
+}  // namespace cryptonote
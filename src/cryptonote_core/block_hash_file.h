@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "common/fs.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "cryptonote_config.h"
+
+namespace cryptonote {
+
+/// Read-only, memory-mapped file of trusted block hash-of-hashes, used to extend (or stand in for)
+/// the compiled-in hashes that let fast sync skip full verification of old blocks.  Unlike the
+/// compiled-in data it can be replaced without rebuilding, and can carry a signature so that a
+/// file obtained from elsewhere can be checked against a key the user trusts.
+///
+/// Layout (integers little-endian):
+///
+///     offset  size      field
+///     0       8         magic, "oxenbhh\0"
+///     8       4         format version (currently 1)
+///     12      4         network type
+///     16      4         step: the number of block hashes in each hash-of-hashes
+///     20      4         flags; FLAG_SIGNED means a signature follows the hashes
+///     24      8         count of hash-of-hashes
+///     32      32*count  the hashes; hash i is the cn_fast_hash of the hashes of blocks
+///                       [i*step, (i+1)*step)
+///     ...     64        (if signed) Ed25519 signature of all of the preceding bytes
+///
+/// The hashes are 32-byte aligned, so hash i of the file lives at a fixed offset and lookups read
+/// straight from the mapping: loading a file costs the signature check and nothing more.
+class block_hash_file {
+  public:
+    static constexpr std::string_view MAGIC{"oxenbhh\0", 8};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t FLAG_SIGNED = 1;
+    static constexpr size_t HEADER_SIZE = 32;
+
+    /// Opens and maps `path`, checking that it is a well-formed file for `nettype` using the
+    /// current HASH_OF_HASHES_STEP.  If `signer` is given the file must be signed by it.  Throws
+    /// std::runtime_error if the file can't be read or fails any of these checks.
+    block_hash_file(
+            const fs::path& path,
+            network_type nettype,
+            const crypto::ed25519_public_key* signer = nullptr);
+    ~block_hash_file();
+
+    block_hash_file(const block_hash_file&) = delete;
+    block_hash_file& operator=(const block_hash_file&) = delete;
+
+    /// Number of hash-of-hashes in the file
+    size_t size() const { return m_count; }
+
+    /// Number of blocks covered by the file's hashes
+    uint64_t covered_height() const { return m_count * HASH_OF_HASHES_STEP; }
+
+    /// True if the file carries a signature (which, if a signer was given, has been verified)
+    bool is_signed() const { return m_signed; }
+
+    /// Returns the hash of the hashes of blocks [i*HASH_OF_HASHES_STEP, (i+1)*HASH_OF_HASHES_STEP).
+    /// `i` must be less than size().
+    crypto::hash operator[](size_t i) const;
+
+    /// Builds the contents of a block hash file holding `hashes`, signed with `signing_key` (a
+    /// libsodium-style 64-byte Ed25519 secret key) if given.
+    static std::string serialize(
+            network_type nettype,
+            std::span<const crypto::hash> hashes,
+            const crypto::ed25519_secret_key* signing_key = nullptr);
+
+  private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_count = 0;
+    bool m_signed = false;
+#ifdef _WIN32
+    std::string m_contents;
+#endif
+};
+
+}  // namespace cryptonote
@@ -0,0 +1,36 @@
+#include "block_processing_stats.h"
+
+#include <algorithm>
+
+namespace cryptonote {
+
+block_processing_times& block_processing_times::operator+=(const block_processing_times& t) {
+    for (const auto& [name, stage] : STAGES)
+        this->*stage += t.*stage;
+    total += t.total;
+    return *this;
+}
+
+block_processing_stats::block_processing_stats(size_t recent_blocks) :
+        m_recent{std::max<size_t>(1, recent_blocks)} {}
+
+void block_processing_stats::add(const block_processing_record& record) {
+    std::lock_guard lock{m_mutex};
+    m_recent.push_back(record);
+    m_totals.blocks++;
+    m_totals.txs += record.txs;
+    m_totals.times += record.times;
+}
+
+std::vector<block_processing_record> block_processing_stats::recent(size_t count) const {
+    std::lock_guard lock{m_mutex};
+    count = std::min(count, m_recent.size());
+    return {m_recent.end() - count, m_recent.end()};
+}
+
+block_processing_stats::totals_t block_processing_stats::totals() const {
+    std::lock_guard lock{m_mutex};
+    return m_totals;
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <boost/circular_buffer.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace cryptonote {
+
+/// Time spent in each stage of adding one block to the main chain.
+struct block_processing_times {
+    // This block's share of preparing the incoming span it arrived in (on the thread pool):
+    // parsing the blocks and precomputing their PoW, and parsing the txs, looking up their ring
+    // members and prechecking ring signatures.  Zero for blocks that didn't arrive in a span.
+    std::chrono::nanoseconds prepare_blocks{};
+    std::chrono::nanoseconds prepare_txs{};
+    std::chrono::nanoseconds basic_checks{};
+    std::chrono::nanoseconds pow{};        // PoW verification not done in prepare_blocks
+    std::chrono::nanoseconds tx_checks{};  // existence, pool and input (including RCT) checks
+    std::chrono::nanoseconds rewards{};
+    std::chrono::nanoseconds db_add{};
+    std::chrono::nanoseconds service_node_list{};
+    std::chrono::nanoseconds ons{};
+    std::chrono::nanoseconds batching{};
+    std::chrono::nanoseconds quorum_cop{};
+    std::chrono::nanoseconds checkpoints{};
+    std::chrono::nanoseconds other_hooks{};  // any other hook_block_add hooks
+    // Of the stages after preparation, i.e. the time the block held up the adding thread
+    std::chrono::nanoseconds total{};
+
+    // The stages, with the names they are reported under
+    static constexpr std::array<
+            std::pair<std::string_view, std::chrono::nanoseconds block_processing_times::*>,
+            13>
+            STAGES{{
+                    {"prepare_blocks", &block_processing_times::prepare_blocks},
+                    {"prepare_txs", &block_processing_times::prepare_txs},
+                    {"basic_checks", &block_processing_times::basic_checks},
+                    {"pow", &block_processing_times::pow},
+                    {"tx_checks", &block_processing_times::tx_checks},
+                    {"rewards", &block_processing_times::rewards},
+                    {"db_add", &block_processing_times::db_add},
+                    {"service_node_list", &block_processing_times::service_node_list},
+                    {"ons", &block_processing_times::ons},
+                    {"batching", &block_processing_times::batching},
+                    {"quorum_cop", &block_processing_times::quorum_cop},
+                    {"checkpoints", &block_processing_times::checkpoints},
+                    {"other_hooks", &block_processing_times::other_hooks},
+            }};
+
+    block_processing_times& operator+=(const block_processing_times& t);
+};
+
+struct block_processing_record {
+    uint64_t height;
+    crypto::hash hash;
+    size_t txs;
+    std::chrono::system_clock::time_point added;
+    block_processing_times times;
+};
+
+/// Keeps the processing times of the most recently added blocks, plus running totals over every
+/// block added since startup for exporting as (monotonic) metrics.  Thread safe.
+class block_processing_stats {
+  public:
+    // A day of blocks at the target block time
+    static constexpr size_t DEFAULT_RECENT_BLOCKS = 720;
+
+    explicit block_processing_stats(size_t recent_blocks = DEFAULT_RECENT_BLOCKS);
+
+    void add(const block_processing_record& record);
+
+    /// Returns the records of up to `count` of the most recently added blocks, oldest first.
+    std::vector<block_processing_record> recent(size_t count = SIZE_MAX) const;
+
+    struct totals_t {
+        uint64_t blocks = 0;
+        uint64_t txs = 0;
+        block_processing_times times;
+    };
+    totals_t totals() const;
+
+  private:
+    mutable std::mutex m_mutex;
+    boost::circular_buffer<block_processing_record> m_recent;
+    totals_t m_totals;
+};
+
+}  // namespace cryptonote
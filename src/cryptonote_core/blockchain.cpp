@@ -38,13 +38,16 @@
 #include <sodium.h>
 
 #include <algorithm>
+#include <boost/asio/steady_timer.hpp>
 #include <chrono>
 #include <cstdio>
+#include <future>
 #include <limits>
 #include <stdexcept>
 
 #include "blockchain_db/blockchain_db.h"
 #include "blockchain_db/sqlite/db_sqlite.h"
+#include "common/alloc_profile.h"
 #include "common/boost_serialization_helper.h"
 #include "common/exception.h"
 #include "common/guts.h"
@@ -72,6 +75,7 @@
 #include "ethereum_transactions.h"
 #include "l2_tracker/events.h"
 #include "logging/oxen_logger.h"
+#include "logging/trace.h"
 #include "oxen/log.hpp"
 #include "ringct/rctSigs.h"
 #include "ringct/rctTypes.h"
@@ -139,8 +143,8 @@ Blockchain::Blockchain(
         m_bytes_to_sync(0),
         m_long_term_block_weights_window(LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
         m_long_term_effective_median_block_weight(0),
-        m_long_term_block_weights_cache_tip_hash{},
-        m_long_term_block_weights_cache_rolling_median(LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
+        m_long_term_block_weights_cache{LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE},
+        m_short_term_block_weights_cache{REWARD_BLOCKS_WINDOW},
         m_cancel(false),
         m_btc_valid(false),
         m_batch_success(true),
@@ -165,6 +169,17 @@ bool Blockchain::have_tx_keyimg_as_spent(const crypto::key_image& key_im) const
     return m_db->has_key_image(key_im);
 }
 //------------------------------------------------------------------
+std::vector<bool> Blockchain::have_key_images_as_spent(
+        const std::vector<crypto::key_image>& key_images) const {
+    log::trace(logcat, "Blockchain::{}", __func__);
+    std::vector<bool> spent;
+    spent.reserve(key_images.size());
+    db_rtxn_guard rtxn_guard{*m_db};
+    for (const auto& ki : key_images)
+        spent.push_back(m_db->has_key_image(ki));
+    return spent;
+}
+//------------------------------------------------------------------
 // This function makes sure that each "input" in an input (mixins) exists
 // and collects the public key for each from the transaction it was included in
 // via the visitor passed to it.
@@ -364,12 +379,93 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems(const std::atomic<bool
 
     using clock = std::chrono::steady_clock;
     using dseconds = std::chrono::duration<double>;
-    int64_t constexpr BLOCK_COUNT = 100;
+    int64_t constexpr BLOCK_COUNT = 250;
     auto work_start = clock::now();
     auto scan_start = work_start;
     dseconds ons_duration{}, snl_duration{}, sqlite_duration{}, ons_iteration_duration{},
             snl_iteration_duration{}, sqlite_iteration_duration{};
 
+    // Apply the ONS blocks in one transaction (committed along with the periodic progress updates)
+    // rather than one per block.  If the ONS db is empty (i.e. it is being rebuilt) then nothing
+    // but block processing uses it yet, so we can also leave building its lookup indices to the
+    // end.
+    bool const ons_bulk = m_ons_db.db && end_height > ons_height && end_height - ons_height > 1;
+    if (ons_bulk)
+        m_ons_db.begin_bulk_ingest(m_ons_db.height() + 1 < ons_height);
+    OXEN_DEFER {
+        m_ons_db.end_bulk_ingest();
+    };
+
+    // Each batch of blocks and their txs gets read (on a separate thread, through its own read
+    // txn) and parsed (on the threadpool) while the previous batch is being applied, so that the
+    // subsystem updates below are left as the only sequential work.  If we are inside a write txn
+    // then the blocks we need might not be committed yet, so the reads have to stay on this thread.
+    struct replay_batch {
+        std::vector<cryptonote::block> blocks;
+        std::vector<std::vector<cryptonote::transaction>> txs;
+        std::vector<std::vector<std::optional<tx_extra_oxen_name_system>>> ons_entries;
+    };
+    auto read_batch = [this, ons_height, end_height](uint64_t height) {
+        const size_t count = std::min<uint64_t>(BLOCK_COUNT, end_height - height);
+        replay_batch batch;
+        batch.blocks.resize(count);
+        batch.txs.resize(count);
+        batch.ons_entries.resize(count);
+        std::vector<std::vector<std::string>> tx_blobs(count);
+        {
+            db_rtxn_guard rtxn{*m_db};
+            for (size_t i = 0; i < count; i++) {
+                if (!parse_and_validate_block_from_blob(
+                            m_db->get_block_blob_from_height(height + i), batch.blocks[i]))
+                    throw oxen::traced<std::runtime_error>{
+                            "Invalid block at height {}"_format(height + i)};
+                // Like get_transactions(), this leaves out any txs that are missing
+                for (const auto& tx_hash : batch.blocks[i].tx_hashes)
+                    if (std::string blob; m_db->get_tx_blob(tx_hash, blob))
+                        tx_blobs[i].push_back(std::move(blob));
+            }
+        }
+
+        // Parse the txs, and pull the ONS details out of any ONS txs so that the (sequential) ONS
+        // db update only has to validate and store them.
+        std::atomic<bool> failed = false;
+        auto& tpool = tools::threadpool::getInstance();
+        tools::threadpool::waiter waiter;
+        for (size_t i = 0; i < count; i++) {
+            if (tx_blobs[i].empty())
+                continue;
+            tpool.submit(
+                    &waiter,
+                    [&, i] {
+                        auto& txs = batch.txs[i];
+                        txs.resize(tx_blobs[i].size());
+                        for (size_t j = 0; j < txs.size(); j++)
+                            if (!parse_and_validate_tx_from_blob(tx_blobs[i][j], txs[j]))
+                                failed = true;
+                        if (!m_ons_db.db || batch.blocks[i].get_height() < ons_height ||
+                            batch.blocks[i].major_version < hf::hf15_ons)
+                            return;
+                        auto& entries = batch.ons_entries[i];
+                        for (size_t j = 0; j < txs.size(); j++) {
+                            if (txs[j].type != txtype::oxen_name_system)
+                                continue;
+                            entries.resize(txs.size());
+                            if (tx_extra_oxen_name_system entry; ons::parse_ons_tx(txs[j], entry))
+                                entries[j] = std::move(entry);
+                        }
+                    },
+                    "replay_parse",
+                    true);
+        }
+        waiter.wait(&tpool);
+        if (failed)
+            throw oxen::traced<std::runtime_error>{
+                    "Invalid transaction in blocks from height {}"_format(height)};
+        return batch;
+    };
+    auto const read_policy = m_db->write_txn_active() ? std::launch::deferred : std::launch::async;
+    auto next_batch = std::async(read_policy, read_batch, start_height);
+
     for (int64_t block_count = total_blocks, index = 0; block_count > 0;
          block_count -= BLOCK_COUNT, index++) {
         if (abort && *abort)
@@ -394,6 +490,11 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems(const std::atomic<bool
                             start_height + (index * BLOCK_COUNT))
                             .c_str());
 #endif
+            if (m_ons_db.in_bulk_ingest()) {
+                auto ons_start = clock::now();
+                m_ons_db.bulk_commit();
+                ons_iteration_duration += clock::now() - ons_start;
+            }
             work_start = clock::now();
 
             ons_duration += ons_iteration_duration;
@@ -404,27 +505,30 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems(const std::atomic<bool
             sqlite_iteration_duration = 0s;
         }
 
-        std::vector<cryptonote::block> blocks;
+        replay_batch batch;
         uint64_t height = start_height + (index * BLOCK_COUNT);
-        if (!get_blocks(height, static_cast<uint64_t>(BLOCK_COUNT), blocks)) {
+        try {
+            batch = next_batch.get();
+        } catch (const std::exception& e) {
             log::error(
                     logcat,
-                    "Unable to get checkpointed historical blocks for updating oxen subsystems");
+                    "Unable to get historical blocks from height {} for updating oxen subsystems: "
+                    "{}",
+                    height,
+                    e.what());
             return false;
         }
+        if (block_count > BLOCK_COUNT)
+            next_batch = std::async(read_policy, read_batch, height + BLOCK_COUNT);
+        auto const& blocks = batch.blocks;
+        auto const& block_txs = batch.txs;
+        auto const& ons_entries = batch.ons_entries;
 
-        for (cryptonote::block const& blk : blocks) {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            cryptonote::block const& blk = blocks[i];
+            auto const& txs = block_txs[i];
             uint64_t block_height = blk.get_height();
 
-            std::vector<cryptonote::transaction> txs;
-            if (!get_transactions(blk.tx_hashes, txs)) {
-                log::error(
-                        logcat,
-                        "Unable to get transactions for block for updating ONS DB: {}",
-                        cryptonote::get_block_hash(blk));
-                return false;
-            }
-
             if (block_height >= snl_height) {
                 auto snl_start = clock::now();
 
@@ -451,11 +555,13 @@ bool Blockchain::load_missing_blocks_into_oxen_subsystems(const std::atomic<bool
 
             if (m_ons_db.db && (block_height >= ons_height)) {
                 auto ons_start = clock::now();
-                if (!m_ons_db.add_block(blk, txs)) {
+                if (!m_ons_db.add_block(blk, txs, ons_entries[i])) {
                     log::error(
                             logcat,
                             "Unable to process block for updating ONS DB: {}",
                             cryptonote::get_block_hash(blk));
+                    // Don't keep the partially applied block
+                    m_ons_db.end_bulk_ingest(false);
                     return false;
                 }
                 ons_iteration_duration += clock::now() - ons_start;
@@ -594,6 +700,8 @@ bool Blockchain::init(
 #if defined(PER_BLOCK_CHECKPOINT)
     if (m_nettype != network_type::FAKECHAIN)
         load_compiled_in_block_hashes(get_checkpoints);
+    load_block_hash_file();
+    start_known_block_hashes();
 #endif
 
     log::info(
@@ -662,14 +770,16 @@ bool Blockchain::init(
 
     if (test_options && test_options->long_term_block_weight_window) {
         m_long_term_block_weights_window = test_options->long_term_block_weight_window;
-        m_long_term_block_weights_cache_rolling_median =
-                epee::misc_utils::rolling_median_t<uint64_t>(m_long_term_block_weights_window);
+        m_long_term_block_weights_cache =
+                block_weights_median_cache{m_long_term_block_weights_window};
     }
 
     {
         db_txn_guard txn_guard{*m_db, m_db->is_read_only()};
         if (!update_next_cumulative_weight_limit())
             return false;
+        // Load the main chain hashes now rather than when the first peer asks us for them
+        m_chain_hashes.sync(*m_db);
     }
 
     if (ons_db && !m_ons_db.init(this, nettype, ons_db)) {
@@ -677,9 +787,21 @@ bool Blockchain::init(
         return false;
     }
 
-    hook_block_add([this](const auto& info) { m_checkpoints.block_add(info); });
+    hook_block_add(
+            [this](const auto& info) { m_checkpoints.block_add(info); },
+            &block_processing_times::checkpoints);
     hook_blockchain_detached(
             [this](const auto& info) { m_checkpoints.blockchain_detached(info.height); });
+    // The verification cache keys commit to everything the checks depend on, so its entries stay
+    // valid across a reorg; keeping them through one lets the txs of the chain we switch to (which
+    // mostly went through the mempool already) skip verifying again.  Explicitly popped blocks
+    // still drop theirs.
+    hook_blockchain_detached([this](const auto& info) {
+        if (info.by_pop_blocks)
+            m_verification_cache.blockchain_detached(info.height);
+    });
+    hook_block_add([this](const auto&) { m_alt_chain_cache.clear(); });
+    hook_blockchain_detached([this](const auto&) { m_alt_chain_cache.clear(); });
     for (const auto& hook : m_init_hooks)
         hook();
 
@@ -722,11 +844,29 @@ bool Blockchain::store_blockchain() {
     return true;
 }
 //------------------------------------------------------------------
+void Blockchain::schedule_db_sync() {
+    if (m_db_sync_scheduled.exchange(true))
+        return;  // The pending one will cover what we just committed
+    auto timer = std::make_shared<boost::asio::steady_timer>(m_async_service, m_db_sync_latency);
+    timer->async_wait([this, timer](const boost::system::error_code& ec) {
+        // Cleared before syncing, so that a commit made while we sync schedules another one
+        m_db_sync_scheduled = false;
+        if (ec)
+            return;
+        const uint64_t durable = m_db->height();
+        store_blockchain();
+        log::debug(logcat, "Blockchain db durable through height {}", durable);
+    });
+}
+//------------------------------------------------------------------
 bool Blockchain::deinit() {
     log::trace(logcat, "Blockchain::{}", __func__);
 
     log::trace(logcat, "Stopping blockchain read/write activity");
 
+    // Wait for any background PoW precomputation (which stops early if we've been cancelled)
+    m_precompute_waiter.wait(&tools::threadpool::getInstance());
+
     // stop async service
     m_async_work_idle.reset();
     m_async_thread.join();
@@ -809,13 +949,35 @@ block Blockchain::pop_block_from_blockchain(bool pop_batching_rewards = true) {
     log::trace(logcat, "Blockchain::{}", __func__);
     std::unique_lock lock{*this};
 
+    uint64_t const difficulty_height = m_cache.m_timestamps_and_difficulties_height;
     m_cache.m_timestamps_and_difficulties_height = 0;
 
+    {
+        std::lock_guard fee_lock{m_fee_estimates_mutex};
+        m_fee_estimates.reset();
+    }
+
     block popped_block;
     std::vector<transaction> popped_txs;
 
     CHECK_AND_ASSERT_THROW_MES(m_db->height() > 1, "Cannot pop the genesis block");
 
+    // Step the weight medians back below the block we are popping while it is still in the db: the
+    // update_next_cumulative_weight_limit() call below can then step them back again to the window
+    // it wants rather than having to reload them.
+    {
+        uint64_t const top_height = m_db->height() - 1;
+        crypto::hash const top_hash = m_db->top_block_hash();
+        for (auto* cache : {&m_long_term_block_weights_cache, &m_short_term_block_weights_cache})
+            if (cache->tip_hash == top_hash && top_height >= cache->window &&
+                (size_t)cache->rolling_median.size() == cache->window)
+                get_block_weight_median(
+                        *cache,
+                        top_height - cache->window,
+                        cache->window,
+                        cache == &m_long_term_block_weights_cache);
+    }
+
     try {
         m_db->pop_block(popped_block, popped_txs);
     }
@@ -829,12 +991,21 @@ block Blockchain::pop_block_from_blockchain(bool pop_batching_rewards = true) {
         throw;
     }
 
+    // The difficulty window likewise just moves down a block, so if it was filled for the chain we
+    // just popped from we can fix it up rather than reloading all of it.
+    if (difficulty_height == m_db->height() + 1 &&
+        m_db->pop_timestamp_and_difficulty_for_pow(
+                m_nettype, m_cache.m_timestamps, m_cache.m_difficulties, m_db->height()))
+        m_cache.m_timestamps_and_difficulties_height = m_db->height();
+
     if (pop_batching_rewards && !service_node_list.pop_batching_rewards_block(popped_block)) {
         log::error(logcat, "Failed to pop to batch rewards DB");
         throw oxen::traced<std::runtime_error>("Failed to pop batch rewards DB");
     }
 
     m_ons_db.block_detach(*this, m_db->height());
+    m_rct_output_counts.blockchain_detached(m_db->height());
+    m_chain_hashes.blockchain_detached(m_db->height());
 
     // return transactions from popped block to the tx_pool
     size_t pruned = 0;
@@ -880,6 +1051,9 @@ bool Blockchain::reset_and_set_genesis_block(const block& b) {
     invalidate_block_template_cache();
     m_db->reset();
     m_db->drop_alt_blocks();
+    m_checkpoints.reload();
+    m_alt_chain_cache.clear();
+    m_chain_hashes.clear();
 
     for (const auto& hook : m_init_hooks)
         hook();
@@ -917,13 +1091,14 @@ void Blockchain::get_short_chain_history(std::list<crypto::hash>& ids) const {
         return;
 
     db_rtxn_guard rtxn_guard{*m_db};
+    m_chain_hashes.sync(*m_db);
     for (uint64_t i = 0, decr = 1, offset = 1; offset < sz; ++i) {
-        ids.push_back(m_db->get_block_hash_from_height(sz - offset));
+        ids.push_back(m_chain_hashes[sz - offset]);
         if (i >= 10)
             decr *= 2;
         offset += decr;
     }
-    ids.push_back(m_db->get_block_hash_from_height(0));
+    ids.push_back(m_chain_hashes[0]);
 }
 //------------------------------------------------------------------
 crypto::hash Blockchain::get_block_id_by_height(uint64_t height) const {
@@ -1127,6 +1302,24 @@ bool Blockchain::switch_to_alternative_blockchain(
     log::trace(logcat, "Blockchain::{}", __func__);
     std::unique_lock lock{*this};
 
+    // Pop, replay (and, if that fails, roll back) in a single db txn rather than committing each
+    // block popped or added separately.
+    bool const stop_batch = m_db->batch_start();
+    bool result;
+    try {
+        result = switch_to_alternative_blockchain_batched(alt_chain, keep_disconnected_chain);
+    } catch (...) {
+        if (stop_batch)
+            m_db->batch_stop();
+        throw;
+    }
+    if (stop_batch)
+        m_db->batch_stop();
+    return result;
+}
+//------------------------------------------------------------------
+bool Blockchain::switch_to_alternative_blockchain_batched(
+        const std::list<block_extended_info>& alt_chain, bool keep_disconnected_chain) {
     m_cache.m_timestamps_and_difficulties_height = 0;
 
     // if empty alt chain passed (not sure how that could happen), return false
@@ -1142,6 +1335,12 @@ bool Blockchain::switch_to_alternative_blockchain(
         return false;
     }
 
+    // Snapshot the weight medians for the current tip: if the switch fails we can put them back as
+    // they were rather than relying on them having been stepped through every pop and re-add.
+    auto const original_tip = m_db->top_block_hash();
+    auto const long_term_weights_snapshot = m_long_term_block_weights_cache;
+    auto const short_term_weights_snapshot = m_short_term_block_weights_cache;
+
     // pop blocks from the blockchain until the top block is the parent
     // of the front block of the alt chain.
     std::list<block_and_checkpoint> disconnected_chain;  // TODO(oxen): use a vector and rbegin(),
@@ -1154,6 +1353,15 @@ bool Blockchain::switch_to_alternative_blockchain(
     }
 
     auto split_height = m_db->height();
+
+    // Reuse the PoW hashes we already computed when the alt blocks arrived.  That is only the same
+    // hash the main chain check computes if the RandomX seed block isn't part of what we are
+    // switching (hashes from before RandomX don't depend on the chain at all).
+    for (const auto& bei : alt_chain)
+        if (bei.proof_of_work && (bei.bl.major_version < hf::hf12_checkpointing ||
+                                  rx_seedheight(bei.height) < split_height))
+            m_blocks_longhash_table.emplace(get_block_hash(bei.bl), bei.proof_of_work);
+
     detached_info split_hook_data{split_height, /*by_pop_blocks=*/false};
     for (const auto& hook : m_blockchain_detached_hooks)
         hook(split_hook_data);
@@ -1180,6 +1388,10 @@ bool Blockchain::switch_to_alternative_blockchain(
             // functions: rollback and apply_chain, but for now we pretend it is
             // just the latter (because the rollback was done above).
             rollback_blockchain_switching(disconnected_chain, split_height);
+            if (m_db->top_block_hash() == original_tip) {
+                m_long_term_block_weights_cache = long_term_weights_snapshot;
+                m_short_term_block_weights_cache = short_term_weights_snapshot;
+            }
 
             const crypto::hash blkid = cryptonote::get_block_hash(bei.bl);
             add_block_as_invalid(bei.bl);
@@ -1189,6 +1401,7 @@ bool Blockchain::switch_to_alternative_blockchain(
                     "block_id: {}",
                     blkid);
             m_db->remove_alt_block(blkid);
+            m_alt_chain_cache.clear();
             alt_ch_iter++;
 
             for (auto alt_ch_to_orph_iter = alt_ch_iter; alt_ch_to_orph_iter != alt_chain.end();) {
@@ -1285,11 +1498,26 @@ difficulty_type Blockchain::get_difficulty_for_alternative_chain(
         if (!main_chain_start_offset)
             ++main_chain_start_offset;  // skip genesis block
 
-        // get difficulties and timestamps from relevant main chain blocks
-        for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-            timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
-            cumulative_difficulties.push_back(
-                    m_db->get_block_cumulative_difficulty(main_chain_start_offset));
+        // get difficulties and timestamps from relevant main chain blocks.  Alt chains usually
+        // branch off near the top of the main chain, in which case these are all in the window
+        // we keep for the next main chain block's difficulty and we can just copy them from there.
+        uint64_t const cache_height = m_cache.m_timestamps_and_difficulties_height;
+        uint64_t const cache_start = cache_height - m_cache.m_timestamps.size();
+        if (main_chain_start_offset < main_chain_stop_offset && cache_height == m_db->height() &&
+            m_cache.m_timestamps.size() == m_cache.m_difficulties.size() &&
+            main_chain_start_offset >= cache_start && main_chain_stop_offset <= cache_height) {
+            timestamps.assign(
+                    m_cache.m_timestamps.begin() + (main_chain_start_offset - cache_start),
+                    m_cache.m_timestamps.begin() + (main_chain_stop_offset - cache_start));
+            cumulative_difficulties.assign(
+                    m_cache.m_difficulties.begin() + (main_chain_start_offset - cache_start),
+                    m_cache.m_difficulties.begin() + (main_chain_stop_offset - cache_start));
+        } else {
+            for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
+                timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
+                cumulative_difficulties.push_back(
+                        m_db->get_block_cumulative_difficulty(main_chain_start_offset));
+            }
         }
 
         // make sure we haven't accidentally grabbed too many blocks...maybe don't need this check?
@@ -1496,9 +1724,7 @@ bool Blockchain::validate_block_rewards(
     if (version >= feature::EFFECTIVE_SHORT_TERM_MEDIAN_IN_PENALTY) {
         median_weight = m_current_block_cumul_weight_median;
     } else {
-        std::vector<uint64_t> last_blocks_weights;
-        get_last_n_blocks_weights(last_blocks_weights, REWARD_BLOCKS_WINDOW);
-        median_weight = tools::median(std::move(last_blocks_weights));
+        median_weight = get_short_term_block_weight_median();
     }
 
     oxen_block_reward_context block_reward_context = {};
@@ -1684,46 +1910,73 @@ void Blockchain::get_last_n_blocks_weights(std::vector<uint64_t>& weights, size_
 //------------------------------------------------------------------
 uint64_t Blockchain::get_long_term_block_weight_median(uint64_t start_height, size_t count) const {
     log::trace(logcat, "Blockchain::{}", __func__);
+    return get_block_weight_median(m_long_term_block_weights_cache, start_height, count, true);
+}
+//------------------------------------------------------------------
+uint64_t Blockchain::get_short_term_block_weight_median() const {
+    log::trace(logcat, "Blockchain::{}", __func__);
+    std::unique_lock lock{*this};
+    uint64_t const h = m_db->height();
+    if (h == 0)
+        return 0;
+    size_t const count = std::min<uint64_t>(h, REWARD_BLOCKS_WINDOW);
+    return get_block_weight_median(m_short_term_block_weights_cache, h - count, count, false);
+}
+//------------------------------------------------------------------
+uint64_t Blockchain::get_block_weight_median(
+        block_weights_median_cache& cache,
+        uint64_t start_height,
+        size_t count,
+        bool long_term) const {
     std::unique_lock lock{*this};
 
     CHECK_AND_ASSERT_THROW_MES(count > 0, "count == 0");
 
-    bool cached = false;
+    auto& rolling_median = cache.rolling_median;
+    auto get_weight = [&](uint64_t height) {
+        return long_term ? m_db->get_block_long_term_weight(height)
+                         : m_db->get_block_weight(height);
+    };
+
     uint64_t blockchain_height = m_db->height();
     uint64_t tip_height = start_height + count - 1;
     crypto::hash tip_hash{};
-    if (tip_height < blockchain_height &&
-        count == (size_t)m_long_term_block_weights_cache_rolling_median.size()) {
+    if (tip_height < blockchain_height && count == (size_t)rolling_median.size()) {
         tip_hash = m_db->get_block_hash_from_height(tip_height);
-        cached = tip_hash == m_long_term_block_weights_cache_tip_hash;
-    }
-
-    if (cached) {
-        log::trace(logcat, "requesting {} from {}, cached", count, start_height);
-        return m_long_term_block_weights_cache_rolling_median.median();
-    }
+        if (tip_hash == cache.tip_hash) {
+            log::trace(logcat, "requesting {} from {}, cached", count, start_height);
+            return rolling_median.median();
+        }
 
-    // in the vast majority of uncached cases, most is still cached,
-    // as we just move the window one block up:
-    if (tip_height > 0 && count == (size_t)m_long_term_block_weights_cache_rolling_median.size() &&
-        tip_height < blockchain_height) {
-        crypto::hash old_tip_hash = m_db->get_block_hash_from_height(tip_height - 1);
-        if (old_tip_hash == m_long_term_block_weights_cache_tip_hash) {
+        // in the vast majority of uncached cases, most is still cached,
+        // as we just move the window one block up:
+        if (tip_height > 0 && m_db->get_block_hash_from_height(tip_height - 1) == cache.tip_hash) {
             log::trace(logcat, "requesting {} from {}, incremental", count, start_height);
-            m_long_term_block_weights_cache_tip_hash = tip_hash;
-            m_long_term_block_weights_cache_rolling_median.insert(
-                    m_db->get_block_long_term_weight(tip_height));
-            return m_long_term_block_weights_cache_rolling_median.median();
+            cache.tip_hash = tip_hash;
+            rolling_median.insert(get_weight(tip_height));
+            return rolling_median.median();
+        }
+
+        // ... or, when blocks are popped, one block down.  We can only step back over a full
+        // window, where the weight to put back is the one that moving up pushed out of it.
+        if (count == cache.window && tip_height + 1 < blockchain_height &&
+            m_db->get_block_hash_from_height(tip_height + 1) == cache.tip_hash) {
+            log::trace(logcat, "requesting {} from {}, decremental", count, start_height);
+            cache.tip_hash = tip_hash;
+            rolling_median.pop_back(get_weight(start_height));
+            return rolling_median.median();
         }
     }
 
     log::trace(logcat, "requesting {} from {}, uncached", count, start_height);
-    std::vector<uint64_t> weights = m_db->get_long_term_block_weights(start_height, count);
-    m_long_term_block_weights_cache_tip_hash = tip_hash;
-    m_long_term_block_weights_cache_rolling_median.clear();
+    std::vector<uint64_t> weights = long_term
+                                          ? m_db->get_long_term_block_weights(start_height, count)
+                                          : m_db->get_block_weights(start_height, count);
+    cache.tip_hash = tip_hash;
+    rolling_median.clear();
     for (uint64_t w : weights)
-        m_long_term_block_weights_cache_rolling_median.insert(w);
-    return m_long_term_block_weights_cache_rolling_median.median();
+        rolling_median.insert(w);
+    return rolling_median.median();
 }
 //------------------------------------------------------------------
 uint64_t Blockchain::get_current_cumulative_block_weight_limit() const {
@@ -1992,22 +2245,83 @@ bool Blockchain::create_next_miner_block_template(
     return create_block_template_internal(b, info, diffic, height, expected_reward, ex_nonce);
 }
 //------------------------------------------------------------------
+std::optional<Blockchain::pulse_template> Blockchain::build_pulse_template(
+        const service_nodes::payout& producer) {
+    pulse_template t{};
+    t.producer = producer;
+    // Taken before building, so that changes made while building make the template stale
+    t.pool_cookie = tx_pool.cookie();
+    t.l2_height = m_l2_tracker ? m_l2_tracker->get_safe_height() : 0;
+
+    uint64_t expected_reward = 0;
+    block_template_info info = {};
+    info.service_node_payout = producer;
+    uint64_t diffic = 0;
+    std::string nonce = {};
+    if (!create_block_template_internal(t.b, info, diffic, t.height, expected_reward, nonce))
+        return std::nullopt;
+    return t;
+}
+
+std::optional<Blockchain::pulse_template> Blockchain::current_pulse_template(
+        const service_nodes::payout& producer) {
+    // Gathered before taking the template mutex, so that we never wait for the blockchain, pool
+    // or L2 tracker locks while holding it.
+    const crypto::hash tip = get_tail_id().second;
+    const uint64_t pool_cookie = tx_pool.cookie();
+    const uint64_t l2_height = m_l2_tracker ? m_l2_tracker->get_safe_height() : 0;
+
+    std::lock_guard lock{m_pulse_template_mutex};
+    if (m_pulse_template && m_pulse_template->b.prev_id == tip &&
+        m_pulse_template->pool_cookie == pool_cookie && m_pulse_template->l2_height == l2_height &&
+        m_pulse_template->producer.key == producer.key &&
+        m_pulse_template->producer.payouts == producer.payouts)
+        return m_pulse_template;
+    return std::nullopt;
+}
+
+void Blockchain::prebuild_pulse_block_template(const service_nodes::payout& block_producer) {
+    if (current_pulse_template(block_producer))
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    auto t = build_pulse_template(block_producer);
+    if (!t) {
+        log::debug(logcat, "Failed to pre-build a Pulse block template");
+        return;
+    }
+    log::debug(
+            logcat,
+            "Pre-built Pulse block template for height {} with {} txes in {}",
+            t->height,
+            t->b.tx_hashes.size(),
+            tools::friendly_duration(std::chrono::steady_clock::now() - start));
+    std::lock_guard lock{m_pulse_template_mutex};
+    m_pulse_template = std::move(t);
+}
+
 bool Blockchain::create_next_pulse_block_template(
         block& b,
         const service_nodes::payout& block_producer,
         uint8_t round,
         uint16_t validator_bitset,
         uint64_t& height) {
-    uint64_t expected_reward = 0;
-    block_template_info info = {};
-    info.service_node_payout = block_producer;
-    uint64_t diffic = 0;
-    std::string nonce = {};
+    auto t = current_pulse_template(block_producer);
+    if (t) {
+        log::debug(logcat, "Using the pre-built Pulse block template for height {}", t->height);
+        t->b.timestamp = time(nullptr);
+        // Votes can come in at any time without otherwise changing the template
+        if (t->b.major_version >= cryptonote::feature::ETH_BLS)
+            t->b.l2_votes = service_node_list.l2_pending_state_votes();
+    } else if (!(t = build_pulse_template(block_producer))) {
+        return false;
+    }
 
-    bool result = create_block_template_internal(b, info, diffic, height, expected_reward, nonce);
+    b = std::move(t->b);
+    height = t->height;
     b.pulse.round = round;
     b.pulse.validator_bitset = validator_bitset;
-    return result;
+    return true;
 }
 
 //------------------------------------------------------------------
@@ -2051,10 +2365,28 @@ bool Blockchain::build_alt_chain(
 
     int alt_checkpoint_count = 0;
     int checkpoint_count = 0;
+
+    // If this extends one of the alt chains we've recently built then take it from the cache
+    // instead of reading and parsing every block of it again.
+    auto cached = std::find_if(
+            m_alt_chain_cache.begin(), m_alt_chain_cache.end(), [&prev_id](const auto& c) {
+                return c.tip == prev_id;
+            });
+    bool const from_cache = cached != m_alt_chain_cache.end();
+    if (from_cache) {
+        alt_chain = std::move(cached->chain);
+        alt_checkpoint_count = cached->num_alt_checkpoints;
+        checkpoint_count = cached->num_checkpoints;
+        m_alt_chain_cache.erase(cached);
+        for (auto it = alt_chain.rbegin(); it != alt_chain.rend(); ++it)
+            timestamps.push_back(it->bl.timestamp);
+    }
+
     crypto::hash prev_hash{};
     block_extended_info bei = {};
     std::string checkpoint_blob;
-    for (bool found = m_db->get_alt_block(prev_id, &data, &blob, &checkpoint_blob); found;
+    for (bool found = !from_cache && m_db->get_alt_block(prev_id, &data, &blob, &checkpoint_blob);
+         found;
          found = m_db->get_alt_block(prev_hash, &data, &blob, &checkpoint_blob)) {
         CHECK_AND_ASSERT_MES(
                 cryptonote::parse_and_validate_block_from_blob(blob, bei.bl),
@@ -2162,6 +2494,7 @@ bool Blockchain::build_alt_chain(
             bvc.m_verifivation_failed = true;
             for (auto const& bei : alt_chain)
                 m_db->remove_alt_block(cryptonote::get_block_hash(bei.bl));
+            m_alt_chain_cache.clear();
 
             return false;
         }
@@ -2270,8 +2603,7 @@ bool Blockchain::handle_alternative_block(
         // Delay signature verification until Service Node List adds the block in
         // the block_add hook.
     } else {
-        block_pow_verified const blk_pow =
-                verify_block_pow(b, current_diff, chain_height, true /*alt_block*/);
+        blk_pow = verify_block_pow(b, current_diff, chain_height, true /*alt_block*/);
         if (!blk_pow.valid) {
             bvc.m_verifivation_failed = true;
             return false;
@@ -2280,6 +2612,7 @@ bool Blockchain::handle_alternative_block(
 
     // NOTE: Calculate cumulative difficulty
     cryptonote::alt_block_data_t alt_data = {};
+    bool tip_matches_checkpoint = false;
     {
         alt_data.cumulative_difficulty = current_diff;
         if (alt_chain.size())
@@ -2351,11 +2684,32 @@ bool Blockchain::handle_alternative_block(
         if (height_is_checkpointed) {
             if (!alt_block_matches_checkpoint)
                 num_checkpoints_on_chain++;
+            else
+                tip_matches_checkpoint = true;
         }
 
         alt_chain.push_back(block_extended_info(alt_data, b, checkpoint));
+        if (!pulse_block)
+            alt_chain.back().proof_of_work = blk_pow.proof_of_work;
     }
 
+    // Keeps the alt chain (now ending in this block) for the next block that extends it, in the
+    // same state build_alt_chain() would have built it in: that also takes a stored checkpoint
+    // for a block that matches it.
+    auto cache_alt_chain = [&] {
+        int num_alt_checkpoints = num_checkpoints_on_alt_chain;
+        if (auto& tip = alt_chain.back(); tip_matches_checkpoint && !tip.checkpointed) {
+            if (!get_checkpoint(tip.height, tip.checkpoint))
+                return;
+            tip.checkpointed = true;
+            num_alt_checkpoints++;
+        }
+        if (m_alt_chain_cache.size() >= ALT_CHAIN_CACHE_TIPS)
+            m_alt_chain_cache.erase(m_alt_chain_cache.begin());
+        m_alt_chain_cache.push_back(
+                {id, std::move(alt_chain), num_alt_checkpoints, num_checkpoints_on_chain});
+    };
+
     // NOTE: Block is within the allowable service node reorg window due to passing
     // is_alternative_block_allowed(). So we don't need to check that this block matches the
     // checkpoint unless it's a hardcoded checkpoint, in which case it must. Otherwise if it fails a
@@ -2430,9 +2784,15 @@ bool Blockchain::handle_alternative_block(
         if (!alt_chain_wins && alt_chain_has_equal_checkpoints) {
             uint64_t start = alt_chain.front().height;
             uint64_t end = std::max(alt_chain.back().height + 1, m_db->height());
+            crypto::hash const top = get_tail_id().second;
 
+            // The main chain side only changes with the main chain, and the alt blocks of a long
+            // fork usually arrive one after another, so it is worth keeping rather than reading
+            // the same main chain blocks again for each one.
             std::vector<block> blocks;
-            if (!get_blocks(start, end - start, blocks, nullptr /*txs*/)) {
+            bool const main_weight_cached = m_main_chain_pulse_weight.start == start &&
+                                            m_main_chain_pulse_weight.top == top;
+            if (!main_weight_cached && !get_blocks(start, end - start, blocks, nullptr /*txs*/)) {
                 log::error(
                         logcat,
                         "Unexpected failure to query blocks for alt chain switching calculation "
@@ -2462,10 +2822,15 @@ bool Blockchain::handle_alternative_block(
             }
 
             uint64_t main_chain_weight = 0;
-            for (auto const& block : blocks) {
-                main_chain_weight += MIN_WEIGHT_INCREMENT;
-                if (block.has_pulse())
-                    main_chain_weight += PULSE_BASE_WEIGHT / (1 + block.pulse.round);
+            if (main_weight_cached)
+                main_chain_weight = m_main_chain_pulse_weight.weight;
+            else {
+                for (auto const& block : blocks) {
+                    main_chain_weight += MIN_WEIGHT_INCREMENT;
+                    if (block.has_pulse())
+                        main_chain_weight += PULSE_BASE_WEIGHT / (1 + block.pulse.round);
+                }
+                m_main_chain_pulse_weight = {start, top, main_chain_weight};
             }
 
             alt_chain_wins = alt_chain_weight > main_chain_weight;
@@ -2487,6 +2852,7 @@ bool Blockchain::handle_alternative_block(
             fmt::format_to(std::back_inserter(msg), " difficulty {}", current_diff);
 
             log::info(globallogcat, fg(fmt::terminal_color::blue) | fmt::emphasis::bold, "{}", msg);
+            cache_alt_chain();
             return true;
         }
     } else {
@@ -2539,6 +2905,7 @@ bool Blockchain::handle_alternative_block(
                         id,
                         blk_pow.proof_of_work,
                         current_diff);
+                cache_alt_chain();
                 return true;
             }
         } else {
@@ -2570,6 +2937,7 @@ bool Blockchain::handle_alternative_block(
                         id,
                         blk_pow.proof_of_work,
                         current_diff);
+                cache_alt_chain();
                 return true;
             }
         }
@@ -2844,6 +3212,7 @@ bool Blockchain::get_outs(
         const rpc::GET_OUTPUTS_BIN::request& req, rpc::GET_OUTPUTS_BIN::response& res) const {
     log::trace(logcat, "Blockchain::{}", __func__);
     std::unique_lock lock{*this};
+    db_rtxn_guard rtxn_guard{*m_db};
 
     res.outs.clear();
     res.outs.reserve(req.outputs.size());
@@ -2925,12 +3294,10 @@ bool Blockchain::get_output_distribution(
         return false;
 
     if (amount == 0) {
-        std::vector<uint64_t> heights;
-        heights.reserve(to_height + 1 - start_height);
         const uint64_t real_start_height = start_height > 0 ? start_height - 1 : start_height;
-        for (uint64_t h = real_start_height; h <= to_height; ++h)
-            heights.push_back(h);
-        distribution = m_db->get_block_cumulative_rct_outputs(heights);
+        distribution = m_rct_output_counts.get(*m_db, real_start_height, to_height);
+        if (distribution.empty())
+            return false;
         if (start_height > 0) {
             base = distribution[0];
             distribution.erase(distribution.begin());
@@ -2964,9 +3331,10 @@ bool Blockchain::find_blockchain_supplement(
     }
 
     db_rtxn_guard rtxn_guard{*m_db};
+    m_chain_hashes.sync(*m_db);
     // make sure that the last block in the request's block list matches
     // the genesis block
-    auto gen_hash = m_db->get_block_hash_from_height(0);
+    const auto& gen_hash = m_chain_hashes[0];
     if (qblock_ids.back() != gen_hash) {
         log::info(
                 logcat,
@@ -2980,19 +3348,10 @@ bool Blockchain::find_blockchain_supplement(
     // Find the first block the foreign chain has that we also have.
     // Assume qblock_ids is in reverse-chronological order.
     auto bl_it = qblock_ids.begin();
-    uint64_t split_height = 0;
-    for (; bl_it != qblock_ids.end(); bl_it++) {
-        try {
-            if (m_db->block_exists(*bl_it, &split_height))
-                break;
-        } catch (const std::exception& e) {
-            log::warning(
-                    logcat,
-                    "Non-critical error trying to find block by hash in BlockchainDB, hash: {}",
-                    *bl_it);
-            return false;
-        }
-    }
+    std::optional<uint64_t> split_height;
+    for (; bl_it != qblock_ids.end(); bl_it++)
+        if ((split_height = m_chain_hashes.height(*bl_it)))
+            break;
 
     // this should be impossible, as we checked that we share the genesis block,
     // but just in case...
@@ -3002,7 +3361,7 @@ bool Blockchain::find_blockchain_supplement(
     }
 
     // we start to put block ids INCLUDING last known id, just to make other side be sure
-    starter_offset = split_height;
+    starter_offset = *split_height;
     return true;
 }
 //------------------------------------------------------------------
@@ -3126,6 +3485,30 @@ bool Blockchain::get_split_transactions_blobs(
     return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::get_transactions_data(
+        const std::vector<crypto::hash>& txs_ids,
+        std::vector<tx_lookup>& txs,
+        std::unordered_set<crypto::hash>* missed_txs) const {
+    log::trace(logcat, "Blockchain::{}", __func__);
+    std::unique_lock lock{*this};
+
+    try {
+        db_rtxn_guard rtxn_guard{*m_db};
+        auto found = m_db->get_txs_data(txs_ids);
+        txs.reserve(txs.size() + found.size());
+        for (size_t i = 0; i < found.size(); i++) {
+            if (found[i])
+                txs.push_back(std::move(*found[i]));
+            else if (missed_txs)
+                missed_txs->insert(txs_ids[i]);
+        }
+    } catch (const std::exception& e) {
+        log::error(logcat, "Failed to look up transactions: {}", e.what());
+        return false;
+    }
+    return true;
+}
+//------------------------------------------------------------------
 bool Blockchain::get_transactions(
         const std::vector<crypto::hash>& txs_ids,
         std::vector<transaction>& txs,
@@ -3171,7 +3554,7 @@ bool Blockchain::find_blockchain_supplement(
     }
 
     db_rtxn_guard rtxn_guard{*m_db};
-    current_height = get_current_blockchain_height();
+    current_height = m_chain_hashes.size();
     uint64_t stop_height = current_height;
     if (clip_pruned) {
         const uint32_t pruning_seed = get_blockchain_pruning_seed();
@@ -3185,7 +3568,7 @@ bool Blockchain::find_blockchain_supplement(
             std::min((size_t)(stop_height - start_height), BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT));
     for (size_t i = start_height; i < stop_height && count < BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT;
          i++, count++) {
-        hashes.push_back(m_db->get_block_hash_from_height(i));
+        hashes.push_back(m_chain_hashes[i]);
     }
 
     return true;
@@ -3240,7 +3623,6 @@ bool Blockchain::find_blockchain_supplement(
         }
     }
 
-    db_rtxn_guard rtxn_guard{*m_db};
     total_height = get_current_blockchain_height();
     size_t count = 0, size = 0;
     blocks.reserve(
@@ -3249,7 +3631,7 @@ bool Blockchain::find_blockchain_supplement(
                                     (size < FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE || count < 3);
          i++, count++) {
         auto& bd = blocks.emplace_back();
-        bd.block_blob = m_db->get_block_blob_from_height(i);
+        bd.block_blob = m_db->get_block_blob_view_from_height(i);
         block b;
         CHECK_AND_ASSERT_MES(
                 parse_and_validate_block_from_blob(bd.block_blob, b),
@@ -3258,17 +3640,21 @@ bool Blockchain::find_blockchain_supplement(
         bd.miner_tx_hash = get_miner_tx_hash && b.miner_tx
                                  ? cryptonote::get_transaction_hash(*b.miner_tx)
                                  : crypto::null<crypto::hash>;
-        std::vector<std::string> txs;
+        std::vector<std::string_view> txs;
         if (pruned) {
             CHECK_AND_ASSERT_MES(
-                    m_db->get_pruned_tx_blobs_from(b.tx_hashes.front(), b.tx_hashes.size(), txs),
+                    b.tx_hashes.empty() ||
+                            m_db->get_pruned_tx_blob_views_from(
+                                    b.tx_hashes.front(), b.tx_hashes.size(), txs),
                     false,
                     "Failed to retrieve all transactions needed");
         } else {
+            // Full tx blobs are stored in two parts, so can't be handed out as views
             std::unordered_set<crypto::hash> mis;
-            get_transactions_blobs(b.tx_hashes, txs, &mis, pruned);
+            get_transactions_blobs(b.tx_hashes, bd.owned_txs, &mis, pruned);
             CHECK_AND_ASSERT_MES(
                     mis.empty(), false, "internal error, transaction from block not found");
+            txs.assign(bd.owned_txs.begin(), bd.owned_txs.end());
         }
         size += bd.block_blob.size();
         for (const auto& t : txs)
@@ -3278,7 +3664,7 @@ bool Blockchain::find_blockchain_supplement(
                 txs.size() == b.tx_hashes.size(), false, "mismatched sizes of b.tx_hashes and txs");
         bd.txs.reserve(txs.size());
         for (size_t i = 0; i < txs.size(); ++i)
-            bd.txs.emplace_back(b.tx_hashes[i], std::move(txs[i]));
+            bd.txs.emplace_back(b.tx_hashes[i], txs[i]);
     }
     return true;
 }
@@ -3809,6 +4195,7 @@ bool Blockchain::check_tx_outputs(const transaction& tx, tx_verification_context
 bool Blockchain::have_tx_keyimges_as_spent(const transaction& tx) const {
     log::trace(logcat, "Blockchain::{}", __func__);
     if (!tx.is_miner_tx()) {
+        db_rtxn_guard rtxn_guard{*m_db};
         for (const txin_v& in : tx.vin) {
             CHECKED_GET_SPECIFIC_VARIANT(in, txin_to_key, in_to_key, true);
             if (have_tx_keyimg_as_spent(in_to_key.k_image))
@@ -4174,10 +4561,18 @@ bool Blockchain::check_tx_inputs(
                     }
                 }
 
+                // The ring signatures may have already been verified when the tx entered the pool
+                // or (in parallel) when the block span was prepared.  The key commits to the
+                // mixRing we just confirmed above, so a hit means exactly this check passed.
+                const auto ring_key = verification_cache::ring_key(get_transaction_hash(tx), rv);
+                if (m_verification_cache.have(ring_key))
+                    break;
+
                 if (!rct::verRctNonSemanticsSimple(rv)) {
                     log::error(log::Cat("verify"), "Failed to check ringct signatures!");
                     return false;
                 }
+                m_verification_cache.add(ring_key, m_db->height());
                 break;
             }
             case rct::RCTType::Full: {
@@ -4358,7 +4753,7 @@ bool Blockchain::check_tx_inputs(
             }
         } else if (tx.type == txtype::key_image_unlock) {
             cryptonote::tx_extra_tx_key_image_unlock unlock;
-            if (!cryptonote::get_field_from_tx_extra(tx.extra, unlock)) {
+            if (!cryptonote::get_field_from_tx_extra(tx, unlock)) {
                 log::error(logcat, "TX extra didn't have key image unlock in the tx_extra");
                 return false;
             }
@@ -4588,56 +4983,87 @@ bool Blockchain::check_fee(
 
 //------------------------------------------------------------------
 byte_and_output_fees Blockchain::get_dynamic_base_fee_estimate(uint64_t grace_blocks) const {
-    const auto version = get_network_version();
-    const uint64_t db_height = m_db->height();
-
     if (grace_blocks >= REWARD_BLOCKS_WINDOW)
         grace_blocks = REWARD_BLOCKS_WINDOW - 1;
 
-    const uint64_t min_block_weight = get_min_block_weight(version);
-    std::vector<uint64_t> weights;
-    get_last_n_blocks_weights(weights, REWARD_BLOCKS_WINDOW - grace_blocks);
-    weights.reserve(grace_blocks);
-    for (size_t i = 0; i < grace_blocks; ++i)
-        weights.push_back(min_block_weight);
+    std::shared_ptr<const fee_estimates> cached;
+    {
+        std::lock_guard lock{m_fee_estimates_mutex};
+        cached = m_fee_estimates;
+    }
+    const auto fee = cached && cached->height == m_db->height()
+                           ? cached->by_grace_blocks[grace_blocks]
+                           : get_fee_estimate(get_fee_estimate_inputs(), grace_blocks);
 
-    uint64_t median = tools::median(std::move(weights));
-    if (median <= min_block_weight)
-        median = min_block_weight;
+    const bool per_byte = get_network_version() < feature::PER_BYTE_FEE;
+    log::debug(
+            logcat,
+            "Estimating {}-block fee at {}/{} + {}.out",
+            grace_blocks,
+            print_money(fee.first),
+            (per_byte ? "byte" : "kB"),
+            print_money(fee.second));
+    return fee;
+}
+//------------------------------------------------------------------
+void Blockchain::update_fee_estimates() {
+    auto estimates = std::make_shared<fee_estimates>();
+    estimates->height = m_db->height();
+    const auto inputs = get_fee_estimate_inputs();
+    for (uint64_t grace_blocks = 0; grace_blocks < REWARD_BLOCKS_WINDOW; grace_blocks++)
+        estimates->by_grace_blocks[grace_blocks] = get_fee_estimate(inputs, grace_blocks);
+
+    std::lock_guard lock{m_fee_estimates_mutex};
+    m_fee_estimates = std::move(estimates);
+}
+//------------------------------------------------------------------
+Blockchain::fee_estimate_inputs Blockchain::get_fee_estimate_inputs() const {
+    fee_estimate_inputs inputs;
+    inputs.version = get_network_version();
+    const uint64_t db_height = m_db->height();
+
+    inputs.min_block_weight = get_min_block_weight(inputs.version);
+    get_last_n_blocks_weights(inputs.weights, REWARD_BLOCKS_WINDOW);
 
     uint64_t already_generated_coins =
             db_height ? m_db->get_block_already_generated_coins(db_height - 1) : 0;
-    uint64_t base_reward, base_reward_unpenalized;
+    uint64_t base_reward_unpenalized;
     if (!get_base_block_reward(
                 m_current_block_cumul_weight_limit / 2,
                 1,
                 already_generated_coins,
-                base_reward,
+                inputs.base_reward,
                 base_reward_unpenalized,
-                version,
-                m_db->height())) {
+                inputs.version,
+                db_height)) {
         log::error(
                 logcat,
                 "Failed to determine block reward, using placeholder {} as a high bound",
                 print_money(BLOCK_REWARD_OVERESTIMATE));
-        base_reward = BLOCK_REWARD_OVERESTIMATE;
+        inputs.base_reward = BLOCK_REWARD_OVERESTIMATE;
     }
+    return inputs;
+}
+//------------------------------------------------------------------
+byte_and_output_fees Blockchain::get_fee_estimate(
+        const fee_estimate_inputs& inputs, uint64_t grace_blocks) const {
+    // The last REWARD_BLOCKS_WINDOW - grace_blocks real weights, padded out with grace_blocks
+    // minimum-weight blocks
+    const size_t n_real =
+            std::min<size_t>(inputs.weights.size(), REWARD_BLOCKS_WINDOW - grace_blocks);
+    std::vector<uint64_t> weights(inputs.weights.end() - n_real, inputs.weights.end());
+    weights.resize(n_real + grace_blocks, inputs.min_block_weight);
 
-    const bool use_long_term_median_in_fee = version >= feature::LONG_TERM_BLOCK_WEIGHT;
+    uint64_t median = tools::median(std::move(weights));
+    if (median <= inputs.min_block_weight)
+        median = inputs.min_block_weight;
+
+    const bool use_long_term_median_in_fee = inputs.version >= feature::LONG_TERM_BLOCK_WEIGHT;
     const uint64_t use_median_value =
             use_long_term_median_in_fee
                     ? std::min<uint64_t>(median, m_long_term_effective_median_block_weight)
                     : median;
-    auto fee = get_dynamic_base_fee(base_reward, use_median_value, version);
-    const bool per_byte = version < feature::PER_BYTE_FEE;
-    log::debug(
-            logcat,
-            "Estimating {}-block fee at {}/{} + {}.out",
-            grace_blocks,
-            print_money(fee.first),
-            (per_byte ? "byte" : "kB"),
-            print_money(fee.second));
-    return fee;
+    return get_dynamic_base_fee(inputs.base_reward, use_median_value, inputs.version);
 }
 
 //------------------------------------------------------------------
@@ -5081,6 +5507,8 @@ bool Blockchain::handle_block_to_main_chain(
         block_verification_context& bvc,
         checkpoint_t const* checkpoint,
         bool notify) {
+    OXEN_TRACE_SPAN(logcat, "handle_block_to_main_chain");
+    OXEN_ALLOC_SCOPE("blockchain");
     log::trace(logcat, "Blockchain::{}", __func__);
 
     auto block_processing_start = std::chrono::steady_clock::now();
@@ -5098,6 +5526,7 @@ bool Blockchain::handle_block_to_main_chain(
         std::chrono::nanoseconds verify_pow_time;
         block_pow_verified blk_pow = {};
     } miner = {};
+    std::chrono::nanoseconds pow_elapsed{};  // Excluding any precomputed PoW time
 
     bool const pulse_block = bl.has_pulse();
     uint64_t const chain_height = get_current_blockchain_height();
@@ -5112,6 +5541,7 @@ bool Blockchain::handle_block_to_main_chain(
         auto verify_pow_start = std::chrono::steady_clock::now();
         miner.blk_pow = verify_block_pow(bl, current_diffic, chain_height, false /*alt_block*/);
         miner.verify_pow_time = std::chrono::steady_clock::now() - verify_pow_start;
+        pow_elapsed = miner.verify_pow_time;
 
         if (!miner.blk_pow.valid) {
             bvc.m_verifivation_failed = true;
@@ -5387,11 +5817,15 @@ bool Blockchain::handle_block_to_main_chain(
     // from the DB.
     // Secondly we don't use the blobs at all in the hooks, so passing it in
     // doesn't seem right.
+    //
+    // The block is in the db now (failures from here on pop it, rather than returning `txs` to the
+    // pool), so the txs can be moved rather than copied out of `txs`.
     std::vector<transaction> only_txs;
     only_txs.reserve(txs.size());
-    for (std::pair<transaction, std::string> const& tx_pair : txs)
-        only_txs.push_back(tx_pair.first);
+    for (auto& [tx, blob] : txs)
+        only_txs.push_back(std::move(tx));
 
+    auto sn_list_start = std::chrono::steady_clock::now();
     try {
         service_node_list.block_add(bl, only_txs, checkpoint);
     } catch (const std::exception& e) {
@@ -5404,11 +5838,13 @@ bool Blockchain::handle_block_to_main_chain(
         return false;
     }
 
+    auto ons_start = std::chrono::steady_clock::now();
     if (!m_ons_db.add_block(bl, only_txs)) {
         log::info(logcat, fg(fmt::terminal_color::red), "Failed to add block to ONS DB.");
         bvc.m_verifivation_failed = true;
         return false;
     }
+    auto batching_start = std::chrono::steady_clock::now();
     if (m_sqlite_db) {
         // This takes the block that is already validated and records the rewards that should be
         // paid to the service nodes into the batching database
@@ -5422,8 +5858,10 @@ bool Blockchain::handle_block_to_main_chain(
             throw oxen::traced<std::logic_error>("Blockchain missing SQLite Database");
     }
 
+    block_processing_times times;
+    auto hooks_start = std::chrono::steady_clock::now();
     block_add_info hook_data{bl, only_txs, checkpoint};
-    for (const auto& hook : m_block_add_hooks) {
+    for (auto hook_start = hooks_start; const auto& [hook, timing] : m_block_add_hooks) {
         try {
             hook(hook_data);
         } catch (const std::exception& e) {
@@ -5431,8 +5869,12 @@ bool Blockchain::handle_block_to_main_chain(
             bvc.m_verifivation_failed = true;
             return false;
         }
+        auto hook_end = std::chrono::steady_clock::now();
+        times.*timing += hook_end - hook_start;
+        hook_start = hook_end;
     }
-    auto addblock_elapsed = std::chrono::steady_clock::now() - addblock;
+    auto addblock_end = std::chrono::steady_clock::now();
+    auto addblock_elapsed = addblock_end - addblock;
 
     // do this after updating the hard fork state since the weight limit may change due to fork
     if (!update_next_cumulative_weight_limit()) {
@@ -5500,6 +5942,35 @@ bool Blockchain::handle_block_to_main_chain(
                 tools::friendly_duration(addblock_elapsed));
     }
 
+    auto& stats = m_block_add_stats;
+    stats.blocks++;
+    stats.txs += txs.size();
+    stats.basic_checks += t1_elapsed;
+    stats.pow += pow_elapsed;
+    stats.tx_checks += t_exists + t_pool + t_dblspnd + t_checktx;
+    stats.rewards += vmt_elapsed;
+    stats.db_add += sn_list_start - addblock;
+    stats.service_node_list += ons_start - sn_list_start;
+    stats.ons += batching_start - ons_start;
+    stats.batching += hooks_start - batching_start;
+    stats.hooks += addblock_end - hooks_start;
+    auto processing_end = std::chrono::steady_clock::now();
+    stats.total += processing_end - block_processing_start;
+
+    times.prepare_blocks = m_span_prepare_blocks_time;
+    times.prepare_txs = m_span_prepare_txs_time;
+    times.basic_checks = t1_elapsed;
+    times.pow = pow_elapsed;
+    times.tx_checks = t_exists + t_pool + t_dblspnd + t_checktx;
+    times.rewards = vmt_elapsed;
+    times.db_add = sn_list_start - addblock;
+    times.service_node_list = ons_start - sn_list_start;
+    times.ons = batching_start - ons_start;
+    times.batching = hooks_start - batching_start;
+    times.total = processing_end - block_processing_start;
+    m_block_processing_stats.add(
+            {new_height - 1, id, txs.size(), std::chrono::system_clock::now(), times});
+
     bvc.m_added_to_main_chain = true;
     ++m_sync_counter;
     tx_pool.on_blockchain_inc(bl);
@@ -5518,6 +5989,11 @@ bool Blockchain::prune_blockchain(uint32_t pruning_seed) {
     return m_db->prune_blockchain(pruning_seed);
 }
 //------------------------------------------------------------------
+double Blockchain::prune_blockchain_step(size_t max_txs, uint32_t pruning_seed) {
+    auto lock = tools::unique_locks(tx_pool, *this);
+    return m_db->prune_blockchain_step(max_txs, pruning_seed);
+}
+//------------------------------------------------------------------
 bool Blockchain::update_blockchain_pruning() {
     auto lock = tools::unique_locks(tx_pool, *this);
     return m_db->update_pruning();
@@ -5559,9 +6035,7 @@ bool Blockchain::update_next_cumulative_weight_limit(
     uint64_t full_reward_zone = get_min_block_weight(hf_version);
 
     if (hf_version < feature::LONG_TERM_BLOCK_WEIGHT) {
-        std::vector<uint64_t> weights;
-        get_last_n_blocks_weights(weights, REWARD_BLOCKS_WINDOW);
-        m_current_block_cumul_weight_median = tools::median(std::move(weights));
+        m_current_block_cumul_weight_median = get_short_term_block_weight_median();
     } else {
         const uint64_t block_weight = m_db->get_block_weight(db_height - 1);
 
@@ -5585,18 +6059,15 @@ bool Blockchain::update_next_cumulative_weight_limit(
         if (db_height == 1) {
             long_term_median = long_term_block_weight;
         } else {
-            m_long_term_block_weights_cache_tip_hash =
+            m_long_term_block_weights_cache.tip_hash =
                     m_db->get_block_hash_from_height(db_height - 1);
-            m_long_term_block_weights_cache_rolling_median.insert(long_term_block_weight);
-            long_term_median = m_long_term_block_weights_cache_rolling_median.median();
+            m_long_term_block_weights_cache.rolling_median.insert(long_term_block_weight);
+            long_term_median = m_long_term_block_weights_cache.rolling_median.median();
         }
         m_long_term_effective_median_block_weight =
                 std::max<uint64_t>(BLOCK_GRANTED_FULL_REWARD_ZONE_V5, long_term_median);
 
-        std::vector<uint64_t> weights;
-        get_last_n_blocks_weights(weights, REWARD_BLOCKS_WINDOW);
-
-        uint64_t short_term_median = tools::median(std::move(weights));
+        uint64_t short_term_median = get_short_term_block_weight_median();
         uint64_t effective_median_block_weight = std::min<uint64_t>(
                 std::max<uint64_t>(BLOCK_GRANTED_FULL_REWARD_ZONE_V5, short_term_median),
                 SHORT_TERM_BLOCK_WEIGHT_SURGE_FACTOR * m_long_term_effective_median_block_weight);
@@ -5743,6 +6214,7 @@ bool Blockchain::update_checkpoints_from_json_file(const fs::path& file_path) {
 //------------------------------------------------------------------
 bool Blockchain::update_checkpoint(cryptonote::checkpoint_t const& checkpoint) {
     std::unique_lock lock{*this};
+    m_alt_chain_cache.clear();
     bool result = m_checkpoints.update_checkpoint(checkpoint);
     return result;
 }
@@ -5756,17 +6228,139 @@ void Blockchain::block_longhash_worker(
         uint64_t height,
         const epee::span<const block>& blocks,
         std::unordered_map<crypto::hash, crypto::hash>& map) const {
+    // CryptoNight blocks get collected and hashed several at a time, which lets cn_slow_hash
+    // interleave them.
+    std::vector<crypto::hash> cn_ids;
+    std::vector<std::string> cn_blobs;
+    std::optional<crypto::cn_slow_hash_type> cn_type;
+    auto flush_cn = [&] {
+        if (cn_ids.empty())
+            return;
+        std::vector<std::string_view> data{cn_blobs.begin(), cn_blobs.end()};
+        std::vector<crypto::hash> pows(data.size());
+        crypto::cn_slow_hash(data, pows, *cn_type);
+        for (size_t i = 0; i < cn_ids.size(); i++)
+            map.emplace(cn_ids[i], pows[i]);
+        cn_ids.clear();
+        cn_blobs.clear();
+    };
+
     for (const auto& block : blocks) {
         if (m_cancel)
             break;
         crypto::hash id = get_block_hash(block);
+        if (auto it = m_precomputed_pow.find(id); it != m_precomputed_pow.end()) {
+            auto seed = block.major_version >= hf::hf12_checkpointing
+                              ? get_pending_block_id_by_height(rx_seedheight(height))
+                              : crypto::null<crypto::hash>;
+            if (it->second.seed == seed) {
+                map.emplace(id, it->second.pow);
+                height++;
+                continue;
+            }
+        }
+        if (auto type = get_block_cn_hash_type(m_nettype, block.major_version)) {
+            if (type != cn_type)
+                flush_cn();
+            cn_type = type;
+            cn_ids.push_back(id);
+            cn_blobs.push_back(get_block_hashing_blob(block));
+            if (cn_ids.size() >= 16)
+                flush_cn();
+            height++;
+            continue;
+        }
+        flush_cn();
         crypto::hash pow = get_block_longhash_w_blockchain(m_nettype, this, block, height++, 0);
         map.emplace(id, pow);
     }
+    if (!m_cancel)
+        flush_cn();
+}
+
+//------------------------------------------------------------------
+void Blockchain::precompute_block_pow(
+        uint64_t height,
+        std::vector<block_complete_entry> blocks,
+        const std::vector<block>& preceding) {
+    if (blocks.empty() || height + blocks.size() <= m_blocks_hash_check.size())
+        return;
+
+    auto& tpool = tools::threadpool::getInstance();
+    // The previous span's should be long done (prepare_handle_incoming_blocks waited for it)
+    m_precompute_waiter.wait(&tpool);
+    m_precomputed_pow.clear();
+
+    // Ids of the blocks that aren't in the chain yet, from ids_height on; the upcoming blocks' own
+    // ids get appended once they are parsed.
+    std::vector<crypto::hash> ids;
+    ids.reserve(preceding.size() + blocks.size());
+    for (const auto& b : preceding)
+        ids.push_back(get_block_hash(b));
+    const uint64_t ids_height = height - ids.size();
+    const uint64_t chain_height = m_db->height();
+
+    tpool.submit(
+            &m_precompute_waiter,
+            [this,
+             height,
+             chain_height,
+             ids_height,
+             blocks = std::move(blocks),
+             ids = std::move(ids)]() mutable {
+                std::vector<block> parsed(blocks.size());
+                for (size_t i = 0; i < blocks.size(); i++) {
+                    if (m_cancel)
+                        return;
+                    if (!parse_and_validate_block_from_blob(blocks[i].block, parsed[i])) {
+                        parsed.resize(i);
+                        break;
+                    }
+                    ids.push_back(get_block_hash(parsed[i]));
+                }
+
+                auto& tpool = tools::threadpool::getInstance();
+                tpool.parallel_for(
+                        0,
+                        parsed.size(),
+                        [&](size_t i) {
+                            const auto& blk = parsed[i];
+                            const uint64_t blk_height = height + i;
+                            if (m_cancel || blk_height < m_blocks_hash_check.size() ||
+                                blk.major_version >= feature::PULSE)
+                                return;
+                            randomx_longhash_context ctx{};
+                            if (blk.major_version >= hf::hf12_checkpointing) {
+                                ctx.current_blockchain_height = chain_height;
+                                ctx.seed_height = rx_seedheight(blk_height);
+                                if (ctx.seed_height >= ids_height)
+                                    ctx.seed_block_hash = ids[ctx.seed_height - ids_height];
+                                else {
+                                    // A seed we can't look up now just means this block's PoW
+                                    // gets computed when it is added
+                                    try {
+                                        ctx.seed_block_hash =
+                                                get_block_id_by_height(ctx.seed_height);
+                                    } catch (const std::exception&) {
+                                    }
+                                }
+                                if (!ctx.seed_block_hash)
+                                    return;
+                            }
+                            auto pow = get_block_longhash(m_nettype, ctx, blk, blk_height, 0);
+                            std::lock_guard lock{m_precomputed_pow_mutex};
+                            m_precomputed_pow[ids[blk_height - ids_height]] = {
+                                    ctx.seed_block_hash, pow};
+                        },
+                        1,
+                        "block_pow_precompute");
+            },
+            "block_pow_precompute");
 }
 
 //------------------------------------------------------------------
 bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync) {
+    OXEN_TRACE_SPAN(logcat, "cleanup_handle_incoming_blocks");
     bool success = false;
     log::trace(logcat, "Blockchain::{}", __func__);
 
@@ -5785,6 +6379,11 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync) {
             if (m_db_sync_mode != db_nosync)
                 store_blockchain();
             m_sync_counter = 0;
+        } else if (m_db_sync_latency > 0s && m_db_sync_mode != db_nosync) {
+            // Group commit: whatever gets committed until the sync starts gets made durable by it.
+            m_sync_counter = 0;
+            m_bytes_to_sync = 0;
+            schedule_db_sync();
         } else if (
                 m_db_sync_threshold &&
                 ((m_db_sync_on_blocks && m_sync_counter >= m_db_sync_threshold) ||
@@ -5806,6 +6405,8 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync) {
     m_blocks_longhash_table.clear();
     m_scan_table.clear();
     m_blocks_txs_check.clear();
+    m_span_prepare_blocks_time = 0ns;
+    m_span_prepare_txs_time = 0ns;
 
     // when we're well clear of the precomputed hashes, free the memory
     if (!m_blocks_hash_check.empty() && m_db->height() > m_blocks_hash_check.size() + 4096) {
@@ -5828,7 +6429,8 @@ uint64_t Blockchain::prevalidate_block_hashes(
     // pre: A A A A B B B B C C C C D D D D
 
     // easy case: height >= hashes
-    if (height >= m_blocks_hash_of_hashes.size() * HASH_OF_HASHES_STEP)
+    const size_t known_hashes = known_hash_of_hashes_count();
+    if (height >= known_hashes * HASH_OF_HASHES_STEP)
         return hashes.size();
 
     // if we're getting old blocks, we might have jettisoned the hashes already
@@ -5881,7 +6483,7 @@ uint64_t Blockchain::prevalidate_block_hashes(
     uint64_t usable = first_index * HASH_OF_HASHES_STEP -
                       height;  // may start negative, but unsigned under/overflow is not UB
     for (size_t n = first_index; n <= last_index; ++n) {
-        if (n < m_blocks_hash_of_hashes.size()) {
+        if (n < known_hashes) {
             // if the last index isn't fully filled, we can't tell if valid
             if (data.size() < (n - first_index) * HASH_OF_HASHES_STEP + HASH_OF_HASHES_STEP)
                 break;
@@ -5891,7 +6493,7 @@ uint64_t Blockchain::prevalidate_block_hashes(
                     data.data() + (n - first_index) * HASH_OF_HASHES_STEP,
                     HASH_OF_HASHES_STEP * sizeof(crypto::hash),
                     hash);
-            bool valid = hash == m_blocks_hash_of_hashes[n];
+            bool valid = hash == known_hash_of_hashes(n);
 
             // add to the known hashes array
             if (!valid) {
@@ -5992,8 +6594,12 @@ bool Blockchain::calc_batched_governance_reward(uint64_t height, uint64_t& rewar
 //    vs [k_image, output_keys] (m_scan_table). This is faster because it takes advantage of bulk
 //    queries and is threaded if possible. The table (m_scan_table) will be used later when querying
 //    output keys.
+// 3. Parse the txes in parallel, and verify the ring signatures of any tx whose ring members are
+//    all in the scan table on the thread pool (see precheck_ring_signatures), leaving only the
+//    state-dependent checks for the serial handle_block_to_main_chain.
 bool Blockchain::prepare_handle_incoming_blocks(
         const std::vector<block_complete_entry>& blocks_entry, std::vector<block>& blocks) {
+    OXEN_TRACE_SPAN(logcat, "prepare_handle_incoming_blocks");
     log::trace(logcat, "Blockchain::{}", __func__);
     auto prepare = std::chrono::steady_clock::now();
     uint64_t bytes = 0;
@@ -6101,6 +6707,8 @@ bool Blockchain::prepare_handle_incoming_blocks(
             // rarely use those values (and if isn't set all that happens is that the pow hash gets
             // computed later), so skip this entirely post-pulse.
             m_blocks_longhash_table.clear();
+            // Pick up whatever precompute_block_pow() got done for these blocks
+            m_precompute_waiter.wait(&tpool);
             uint64_t thread_height = height;
             tools::threadpool::waiter waiter;
             m_prepare_height = height;
@@ -6116,6 +6724,7 @@ bool Blockchain::prepare_handle_incoming_blocks(
                          thread_height,
                          blocks = epee::span<const block>(&blocks[thread_height - height], nblocks),
                          &map = maps[i]] { block_longhash_worker(thread_height, blocks, map); },
+                        "block_longhash",
                         true);
                 thread_height += nblocks;
             }
@@ -6147,6 +6756,8 @@ bool Blockchain::prepare_handle_incoming_blocks(
 
     auto prepare_elapsed = std::chrono::steady_clock::now() - prepare;
     m_fake_pow_calc_time = prepare_elapsed / blocks_entry.size();
+    m_block_add_stats.prepare_pow += prepare_elapsed;
+    m_span_prepare_blocks_time = prepare_elapsed / blocks_entry.size();
 
     if (blocks_entry.size() > 1 && threads > 1 && m_show_time_stats)
         log::debug(logcat, "Prepare blocks took: {}", tools::friendly_duration(prepare_elapsed));
@@ -6158,6 +6769,40 @@ bool Blockchain::prepare_handle_incoming_blocks(
     // [output] stores all output_data_t for each absolute_offset
     std::vector<output_data_t> txs;
     std::vector<std::pair<cryptonote::transaction, crypto::hash>> txes(total_txs);
+    // Full tx hashes; only set for txes where we could parse the prunable data (and thus can check
+    // the ring signatures ahead of time).
+    std::vector<crypto::hash> tx_hashes(total_txs);
+    std::vector<char> tx_parsed(total_txs, 0), tx_full(total_txs, 0);
+
+    // Parse and hash all the txes in the span in parallel
+    {
+        tools::threadpool::waiter parse_waiter;
+        size_t i = 0;
+        for (const auto& entry : blocks_entry) {
+            for (const auto& tx_blob : entry.txs) {
+                if (i >= txes.size())
+                    break;
+                tpool.submit(
+                        &parse_waiter,
+                        [&tx_blob, i, &txes, &tx_hashes, &tx_parsed, &tx_full] {
+                            auto& [tx, tx_prefix_hash] = txes[i];
+                            if (parse_and_validate_tx_from_blob(
+                                        tx_blob, tx, tx_hashes[i], tx_prefix_hash)) {
+                                tx_parsed[i] = tx_full[i] = 1;
+                                return;
+                            }
+                            tx.set_null();
+                            if (parse_and_validate_tx_base_from_blob(tx_blob, tx)) {
+                                cryptonote::get_transaction_prefix_hash(tx, tx_prefix_hash);
+                                tx_parsed[i] = 1;
+                            }
+                        },
+                        "block_tx_parse");
+                ++i;
+            }
+        }
+        parse_waiter.wait(&tpool);
+    }
 
     // generate absolute offsets
     size_t tx_index = 0;
@@ -6165,7 +6810,7 @@ bool Blockchain::prepare_handle_incoming_blocks(
         if (m_cancel)
             return false;
 
-        for (const auto& tx_blob : entry.txs) {
+        for (size_t n = 0; n < entry.txs.size(); ++n) {
             if (tx_index >= txes.size()) {
                 log::error(log::Cat("verify"), "tx_index is out of sync");
                 m_scan_table.clear();
@@ -6173,14 +6818,12 @@ bool Blockchain::prepare_handle_incoming_blocks(
             }
             transaction& tx = txes[tx_index].first;
             crypto::hash& tx_prefix_hash = txes[tx_index].second;
-            ++tx_index;
 
-            if (!parse_and_validate_tx_base_from_blob(tx_blob, tx)) {
+            if (!tx_parsed[tx_index++]) {
                 log::error(log::Cat("verify"), "Could not parse tx from incoming blocks");
                 m_scan_table.clear();
                 return false;
             }
-            cryptonote::get_transaction_prefix_hash(tx, tx_prefix_hash);
 
             auto its = m_scan_table.find(tx_prefix_hash);
             if (its != m_scan_table.end()) {
@@ -6299,9 +6942,93 @@ bool Blockchain::prepare_handle_incoming_blocks(
                     tools::friendly_duration(scantable_elapsed));
     }
 
+    if (total_txs > 0 && !m_cancel)
+        precheck_ring_signatures(txes, tx_hashes, tx_full);
+    auto prepare_txs_elapsed = std::chrono::steady_clock::now() - scantable;
+    m_block_add_stats.prepare_txs += prepare_txs_elapsed;
+    m_span_prepare_txs_time = prepare_txs_elapsed / blocks_entry.size();
+
     return true;
 }
 
+// Verifies, in parallel, the ring signatures of any txes in the incoming span whose ring members
+// are all already present in the scan table (i.e. which don't reference outputs created earlier in
+// the same span).  Successes are recorded in m_verification_cache so that
+// check_tx_inputs, which is still called serially for each block as it is added, can skip
+// repeating the CLSAG/MLSAG verification.  Everything else in check_tx_inputs (key image, unlock,
+// ring member consistency against the database) is still done there.
+void Blockchain::precheck_ring_signatures(
+        std::vector<std::pair<cryptonote::transaction, crypto::hash>>& txes,
+        const std::vector<crypto::hash>& tx_hashes,
+        const std::vector<char>& tx_full) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<const rct::rctSig*> rvv;
+    std::vector<crypto::hash> rvv_keys;
+    size_t cached = 0, verified_count = 0;
+    const uint64_t height = m_db->height();
+    for (size_t i = 0; i < txes.size(); ++i) {
+        auto& [tx, tx_prefix_hash] = txes[i];
+        if (!tx_full[i] || !tx.is_transfer() || tx.vin.empty() || tx.is_miner_tx() ||
+            !rct::is_rct_simple(tx.rct_signatures.type))
+            continue;
+
+        auto its = m_scan_table.find(tx_prefix_hash);
+        if (its == m_scan_table.end())
+            continue;
+
+        std::vector<std::vector<rct::ctkey>> pubkeys(tx.vin.size());
+        bool complete = true;
+        for (size_t n = 0; n < tx.vin.size() && complete; ++n) {
+            const auto* in_to_key = std::get_if<txin_to_key>(&tx.vin[n]);
+            if (!in_to_key)
+                complete = false;
+            else if (auto it = its->second.find(in_to_key->k_image);
+                     it == its->second.end() ||
+                     it->second.size() != in_to_key->key_offsets.size())
+                complete = false;
+            else {
+                pubkeys[n].reserve(it->second.size());
+                for (const auto& out : it->second)
+                    pubkeys[n].push_back(rct::ctkey{rct::pk2rct(out.pubkey), out.commitment});
+            }
+        }
+        if (!complete || !expand_transaction_2(tx, tx_prefix_hash, pubkeys))
+            continue;
+
+        // Most txes will have already been verified on their way into our mempool
+        auto key = verification_cache::ring_key(tx_hashes[i], tx.rct_signatures);
+        if (m_verification_cache.have(key)) {
+            ++cached;
+            continue;
+        }
+
+        rvv.push_back(&tx.rct_signatures);
+        rvv_keys.push_back(key);
+    }
+
+    // Verify every ring signature of the span in one fan-out; failures here aren't fatal: we just
+    // don't record the tx, and it gets verified (and rejected) the normal way in check_tx_inputs.
+    std::vector<bool> verified;
+    rct::verRctNonSemanticsSimple(rvv, verified);
+    for (size_t j = 0; j < rvv.size(); ++j) {
+        if (verified[j]) {
+            m_verification_cache.add(rvv_keys[j], height);
+            ++verified_count;
+        }
+    }
+
+    if (m_show_time_stats)
+        log::debug(
+                logcat,
+                "Prepare ring signature checks took: {} ({}/{} txes pre-verified, {} already "
+                "cached)",
+                tools::friendly_duration(std::chrono::steady_clock::now() - start),
+                verified_count,
+                rvv.size(),
+                cached);
+}
+
 uint64_t Blockchain::get_immutable_height() const {
     std::unique_lock lock{*this};
     checkpoint_t checkpoint;
@@ -6315,7 +7042,8 @@ void Blockchain::set_user_options(
         bool sync_on_blocks,
         uint64_t sync_threshold,
         blockchain_db_sync_mode sync_mode,
-        bool fast_sync) {
+        bool fast_sync,
+        std::chrono::milliseconds sync_latency) {
     if (sync_mode == db_defaultsync) {
         m_db_default_sync = true;
         sync_mode = db_async;
@@ -6324,6 +7052,7 @@ void Blockchain::set_user_options(
     m_fast_sync = fast_sync;
     m_db_sync_on_blocks = sync_on_blocks;
     m_db_sync_threshold = sync_threshold;
+    m_db_sync_latency = sync_latency;
     m_max_prepare_blocks_threads = maxthreads;
 }
 
@@ -6463,46 +7192,108 @@ void Blockchain::load_compiled_in_block_hashes(const GetCheckpointsCallback& get
                     std::memcpy(hash.data(), checkpoints.data(), hash.size());
                     checkpoints.remove_prefix(hash.size());
                 }
-                m_blocks_hash_check.resize(
-                        m_blocks_hash_of_hashes.size() * HASH_OF_HASHES_STEP, null<hash>);
                 log::info(logcat, "{} block hashes loaded", nblocks);
-
-                // FIXME: clear tx_pool because the process might have been
-                // terminated and caused it to store txs kept by blocks.
-                // The core will not call check_tx_inputs(..) for these
-                // transactions in this case. Consequently, the sanity check
-                // for tx hashes will fail in handle_block_to_main_chain(..)
-                std::unique_lock lock{tx_pool};
-
-                std::vector<transaction> txs;
-                tx_pool.get_transactions(txs);
-
-                size_t tx_weight;
-                uint64_t fee;
-                bool relayed, do_not_relay, double_spend_seen;
-                transaction pool_tx;
-                std::string txblob;
-                for (const transaction& tx : txs) {
-                    crypto::hash tx_hash = get_transaction_hash(tx);
-                    tx_pool.take_tx(
-                            tx_hash,
-                            pool_tx,
-                            txblob,
-                            tx_weight,
-                            fee,
-                            relayed,
-                            do_not_relay,
-                            double_spend_seen);
-                }
             }
         }
     }
 }
+
+void Blockchain::load_block_hash_file() {
+    if (m_block_hash_file_path.empty() || !m_fast_sync)
+        return;
+    std::unique_ptr<block_hash_file> file;
+    try {
+        file = std::make_unique<block_hash_file>(
+                m_block_hash_file_path,
+                m_nettype,
+                m_block_hash_file_signer ? &*m_block_hash_file_signer : nullptr);
+    } catch (const std::exception& e) {
+        log::error(logcat, "Failed to load block hashes: {}", e.what());
+        return;
+    }
+    if (!m_block_hash_file_signer)
+        log::warning(
+                logcat,
+                "No signing key given for {}; trusting its block hashes without verification",
+                m_block_hash_file_path);
+
+    // Where the file overlaps the compiled-in hashes they must agree: a file that disagrees with
+    // the binary is either for another chain or has been tampered with.
+    for (size_t i = 0; i < std::min(file->size(), m_blocks_hash_of_hashes.size()); i++) {
+        if ((*file)[i] != m_blocks_hash_of_hashes[i]) {
+            log::error(
+                    logcat,
+                    "Block hash file {} conflicts with the built-in block hashes at height {}",
+                    m_block_hash_file_path,
+                    i * HASH_OF_HASHES_STEP);
+            return;
+        }
+    }
+
+    log::info(
+            logcat,
+            "Loaded {} block hashes (to height {}) from {}",
+            file->size(),
+            file->covered_height(),
+            m_block_hash_file_path);
+    m_block_hash_file = std::move(file);
+}
+
+void Blockchain::start_known_block_hashes() {
+    const size_t known = known_hash_of_hashes_count();
+    if (known <= (m_db->height() + HASH_OF_HASHES_STEP - 1) / HASH_OF_HASHES_STEP) {
+        // Nothing left for the hashes to cover, so don't keep a file mapped for nothing
+        m_block_hash_file.reset();
+        return;
+    }
+    m_blocks_hash_check.resize(known * HASH_OF_HASHES_STEP, null<hash>);
+
+
+        // FIXME: clear tx_pool because the process might have been
+        // terminated and caused it to store txs kept by blocks.
+        // The core will not call check_tx_inputs(..) for these
+        // transactions in this case. Consequently, the sanity check
+        // for tx hashes will fail in handle_block_to_main_chain(..)
+        std::unique_lock lock{tx_pool};
+
+        std::vector<transaction> txs;
+        tx_pool.get_transactions(txs);
+
+        size_t tx_weight;
+        uint64_t fee;
+        bool relayed, do_not_relay, double_spend_seen;
+        transaction pool_tx;
+        std::string txblob;
+        for (const transaction& tx : txs) {
+            crypto::hash tx_hash = get_transaction_hash(tx);
+            tx_pool.take_tx(
+                    tx_hash,
+                    pool_tx,
+                    txblob,
+                    tx_weight,
+                    fee,
+                    relayed,
+                    do_not_relay,
+                    double_spend_seen);
+        }
+
+}
 #endif
 
+size_t Blockchain::known_hash_of_hashes_count() const {
+    return std::max(
+            m_blocks_hash_of_hashes.size(), m_block_hash_file ? m_block_hash_file->size() : 0);
+}
+
+crypto::hash Blockchain::known_hash_of_hashes(size_t i) const {
+    if (i < m_blocks_hash_of_hashes.size())
+        return m_blocks_hash_of_hashes[i];
+    return (*m_block_hash_file)[i];
+}
+
 bool Blockchain::is_within_compiled_block_hash_area(uint64_t height) const {
 #if defined(PER_BLOCK_CHECKPOINT)
-    return height < m_blocks_hash_of_hashes.size() * HASH_OF_HASHES_STEP;
+    return height < known_hash_of_hashes_count() * HASH_OF_HASHES_STEP;
 #else
     return false;
 #endif
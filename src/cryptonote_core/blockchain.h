@@ -46,6 +46,7 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/serialization/list.hpp>
+#include <chrono>
 #include <ethyl/provider.hpp>
 #include <functional>
 #include <thread>
@@ -53,13 +54,17 @@
 #include <unordered_set>
 
 #include "blockchain_db/blockchain_db.h"
+#include "chain_hash_index.h"
 #include "checkpoints/checkpoints.h"
+#include "common/threadpool.h"
 #include "common/util.h"
 #include "crypto/eth.h"
 #include "crypto/hash.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/difficulty.h"
 #include "cryptonote_basic/verification_context.h"
+#include "cryptonote_core/block_hash_file.h"
+#include "cryptonote_core/block_processing_stats.h"
 #include "cryptonote_core/oxen_name_system.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_tx_utils.h"
@@ -68,8 +73,10 @@
 #include "epee/string_tools.h"
 #include "l2_tracker/l2_tracker.h"
 #include "pulse.h"
+#include "rct_output_counts.h"
 #include "rpc/core_rpc_server_binary_commands.h"
 #include "rpc/core_rpc_server_commands_defs.h"
+#include "verification_cache.h"
 
 struct sqlite3;
 namespace service_nodes {
@@ -129,6 +136,7 @@ class Blockchain {
         uint64_t block_cumulative_weight;       //!< the weight of the block
         difficulty_type cumulative_difficulty;  //!< the accumulated difficulty after that block
         uint64_t already_generated_coins;       //!< the total coins minted after that block
+        crypto::hash proof_of_work{};  //!< the block's PoW hash, if it's been computed (else null)
     };
 
     /**
@@ -317,6 +325,25 @@ class Blockchain {
     bool prepare_handle_incoming_blocks(
             const std::vector<block_complete_entry>& blocks_entry, std::vector<block>& blocks);
 
+    /**
+     * @brief starts computing the proof of work of upcoming blocks in the background
+     *
+     * Meant to be called while syncing, after prepare_handle_incoming_blocks(), with the span of
+     * blocks that will be added next, so that their PoW is computed on the thread pool while the
+     * current ones are being added.  The next prepare_handle_incoming_blocks() uses the results
+     * for each block whose RandomX seed turned out to be the one it was computed with, and
+     * computes the rest as usual.
+     *
+     * @param height the height of the first of `blocks`
+     * @param blocks the upcoming blocks
+     * @param preceding the parsed blocks currently being added (which end just before `height`),
+     * needed to look up seed blocks that are not in the chain yet
+     */
+    void precompute_block_pow(
+            uint64_t height,
+            std::vector<block_complete_entry> blocks,
+            const std::vector<block>& preceding);
+
     /**
      * @brief incoming blocks post-processing, cleanup, and disk sync
      *
@@ -358,6 +385,17 @@ class Blockchain {
      */
     bool have_tx_keyimg_as_spent(const crypto::key_image& key_im) const;
 
+    /**
+     * @brief checks a batch of key images against the blockchain, as have_tx_keyimg_as_spent but
+     * using a single database read transaction for all of them.
+     *
+     * @param key_images the key images to search for
+     *
+     * @return a vector of the same size as `key_images` containing true for each spent one
+     */
+    std::vector<bool> have_key_images_as_spent(
+            const std::vector<crypto::key_image>& key_images) const;
+
     /**
      * @brief get the current height of the blockchain
      *
@@ -447,6 +485,17 @@ class Blockchain {
             uint16_t validator_bitset,
             uint64_t& height);
 
+    /**
+     * @brief builds ahead of time the template that create_next_pulse_block_template would build
+     * for the given producer, so that it's ready as soon as the Pulse round starts
+     *
+     * Does nothing if the template built last time is still current: built for the same producer
+     * on the same chain tip, with the same tx pool contents and L2 height.
+     *
+     * @param block_producer the service node that will receive the block reward
+     */
+    void prebuild_pulse_block_template(const service_nodes::payout& block_producer);
+
     /**
      * @brief checks if a block is known about with a given hash
      *
@@ -534,10 +583,16 @@ class Blockchain {
     bool find_blockchain_supplement(
             const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset) const;
 
+    // The blobs in here are views into the database (and so are only valid while the read txn
+    // they were fetched in is held), except for unpruned tx blobs, which have to be assembled and
+    // so are owned by `owned_txs` (moving a BlockData moves that storage along with it, so the
+    // views remain valid).
     struct BlockData {
-        std::string block_blob;
-        crypto::hash miner_tx_hash;                             // null if no miner tx
-        std::vector<std::pair<crypto::hash, std::string>> txs;  // hash => tx blob, in block order
+        std::string_view block_blob;
+        crypto::hash miner_tx_hash;  // null if no miner tx
+        std::vector<std::pair<crypto::hash, std::string_view>>
+                txs;                         // hash => tx blob, in block order
+        std::vector<std::string> owned_txs;  // storage for `txs` blobs when not pruned
     };
 
     /**
@@ -556,6 +611,9 @@ class Blockchain {
      * @param pruned whether to return full or pruned tx blobs
      * @param max_count the max number of blocks to get
      *
+     * The returned blobs point into the database, so the caller must hold a read txn, typically
+     * via read_snapshot(), for the duration of the call and for as long as it uses them.
+     *
      * @return true if a block found in common or req_start_block specified, else false
      */
     bool find_blockchain_supplement(
@@ -769,6 +827,13 @@ class Blockchain {
      */
     byte_and_output_fees get_dynamic_base_fee_estimate(uint64_t grace_blocks) const;
 
+    /**
+     * @brief recomputes the fee estimates served by get_dynamic_base_fee_estimate for the current
+     * chain tip, for every possible grace_blocks value.  Called after each new block is added;
+     * until then (or after a block is popped) estimates are computed on demand.
+     */
+    void update_fee_estimates();
+
     /**
      * @brief validate a transaction's fee
      *
@@ -866,6 +931,23 @@ class Blockchain {
             const std::vector<crypto::hash>& txs_ids,
             std::vector<std::tuple<crypto::hash, std::string, crypto::hash, std::string>>& txs,
             std::unordered_set<crypto::hash>* missed_txs = nullptr) const;
+
+    /**
+     * @brief gets transactions' split blobs along with their block heights and output indices
+     *
+     * Like get_split_transactions_blobs, but also returns the metadata RPC callers want for each
+     * transaction, all looked up in one batch (see BlockchainDB::get_txs_data).
+     *
+     * @param txs_ids the hashes of the transactions to get
+     * @param txs return-by-reference the transactions found, in the same order as `txs_ids`
+     * @param missed_txs optional pointer to an unordered set to add missed transactions ids to
+     *
+     * @return false if an unexpected exception occurs, else true
+     */
+    bool get_transactions_data(
+            const std::vector<crypto::hash>& txs_ids,
+            std::vector<tx_lookup>& txs,
+            std::unordered_set<crypto::hash>* missed_txs = nullptr) const;
     bool get_transactions(
             const std::vector<crypto::hash>& txs_ids,
             std::vector<transaction>& txs,
@@ -907,13 +989,33 @@ class Blockchain {
      * @param sync_threshold number of blocks/bytes to cache before syncing to database
      * @param sync_mode the ::blockchain_db_sync_mode to use
      * @param fast_sync sync using built-in block hashes as trusted
+     * @param sync_latency if non-zero, sync in the background within this long of a block being
+     * added (instead of going by sync_threshold)
      */
     void set_user_options(
             uint64_t maxthreads,
             bool sync_on_blocks,
             uint64_t sync_threshold,
             blockchain_db_sync_mode sync_mode,
-            bool fast_sync);
+            bool fast_sync,
+            std::chrono::milliseconds sync_latency = {});
+
+    /**
+     * @brief sets a file of trusted block hashes to use for fast sync in addition to the built-in
+     * ones
+     *
+     * Must be called before init() to take effect; the file (see block_hash_file) is only used if
+     * fast sync is enabled.  Problems with the file are logged and the file ignored, rather than
+     * preventing startup.
+     *
+     * @param path the block hash file
+     * @param signer if given, the file must carry a valid signature from this key
+     */
+    void set_block_hash_file(
+            fs::path path, std::optional<crypto::ed25519_public_key> signer = std::nullopt) {
+        m_block_hash_file_path = std::move(path);
+        m_block_hash_file_signer = signer;
+    }
 
     /**
      * @brief Put DB in safe sync mode
@@ -933,6 +1035,41 @@ class Blockchain {
      */
     void set_show_time_stats(bool stats) { m_show_time_stats = stats; }
 
+    /// Time spent in each stage of adding blocks to the main chain, summed over all blocks added
+    /// since the last reset_block_add_stats().  The prepare_* stages cover whole spans of incoming
+    /// blocks (on the thread pool); everything else is per block, on the adding thread.
+    struct block_add_stats {
+        uint64_t blocks = 0;
+        uint64_t txs = 0;
+        std::chrono::nanoseconds prepare_pow{};  // PoW precomputed for incoming spans
+        std::chrono::nanoseconds prepare_txs{};  // tx parsing, output scan and ring sigs in spans
+        std::chrono::nanoseconds basic_checks{};
+        std::chrono::nanoseconds pow{};        // PoW verification not done in prepare_pow
+        std::chrono::nanoseconds tx_checks{};  // existence, pool and input (including RCT) checks
+        std::chrono::nanoseconds rewards{};
+        std::chrono::nanoseconds db_add{};
+        std::chrono::nanoseconds service_node_list{};
+        std::chrono::nanoseconds ons{};
+        std::chrono::nanoseconds batching{};
+        std::chrono::nanoseconds hooks{};  // everything attached through hook_block_add
+        std::chrono::nanoseconds total{};  // of the per-block stages
+    };
+
+    block_add_stats get_block_add_stats() const {
+        std::unique_lock lock{*this};
+        return m_block_add_stats;
+    }
+    void reset_block_add_stats() {
+        std::unique_lock lock{*this};
+        m_block_add_stats = {};
+    }
+
+    /// Per-block stage timings of the most recently added blocks, and totals since startup.  Unlike
+    /// the above this doesn't need the blockchain lock, so can be queried while syncing.
+    const block_processing_stats& get_block_processing_stats() const {
+        return m_block_processing_stats;
+    }
+
     /**
      * @brief gets the network hard fork version of the blockchain at the given height.
      * If height is omitted, uses the current blockchain height.
@@ -1040,12 +1177,24 @@ class Blockchain {
      */
     BlockchainDB& db() { return *m_db; }
 
+    /**
+     * @brief get a reference to the cache of successful tx verification results
+     *
+     * Shared between mempool admission and block validation so that txes already verified on the
+     * way into the pool don't have their signatures and proofs verified again when they are mined.
+     *
+     * @return a reference to the verification cache
+     */
+    verification_cache& verification_results() { return m_verification_cache; }
+
     /// A reference to the service node list
     service_nodes::service_node_list& service_node_list;
 
     /**
      * @brief computes the "short" and "long" hashes for a set of blocks
      *
+     * Uses the hashes from m_precomputed_pow where they are still valid.
+     *
      * @param height the height of the first block
      * @param blocks the blocks to be hashed
      * @param map return-by-reference the hashes for each block
@@ -1070,6 +1219,8 @@ class Blockchain {
     uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash>& hashes);
     uint32_t get_blockchain_pruning_seed() const { return m_db->get_blockchain_pruning_seed(); }
     bool prune_blockchain(uint32_t pruning_seed = 0);
+    // Prunes up to `max_txs` more transactions; see BlockchainDB::prune_blockchain_step
+    double prune_blockchain_step(size_t max_txs, uint32_t pruning_seed = 0);
     bool update_blockchain_pruning();
     bool check_blockchain_pruning();
 
@@ -1081,6 +1232,30 @@ class Blockchain {
     void unlock() const { m_blockchain_lock.unlock(); }
     bool try_lock() const { return m_blockchain_lock.try_lock(); }
 
+    /// RAII read snapshot of the chain; see read_snapshot().
+    struct read_snapshot_guard {
+        std::unique_lock<const Blockchain> lock;
+        db_rtxn_guard rtxn;
+    };
+
+    /**
+     * @brief takes a read snapshot of the chain for a sequence of lookups
+     *
+     * Holds the blockchain lock and the calling thread's database read txn until the returned
+     * guard is destroyed, so that every lookup made in the meantime, whether through Blockchain or
+     * directly on db(), sees the same chain state and reuses the same (already open) txn and
+     * cursors rather than starting and resetting a read txn for each one.  Intended for RPC
+     * requests that look up many blocks, txes or outputs.
+     *
+     * The lock is taken before the txn (the same order Blockchain methods use) so that a snapshot
+     * cannot be held across a database resize.
+     *
+     * @return the snapshot guard
+     */
+    [[nodiscard]] read_snapshot_guard read_snapshot() const {
+        return {std::unique_lock{*this}, db_rtxn_guard{*m_db}};
+    }
+
     void cancel();
 
     /**
@@ -1092,8 +1267,15 @@ class Blockchain {
 
     /**
      * @brief add a hook called during new block handling; should throw to abort adding the block.
+     *
+     * @param timing the stage of the block processing stats that the hook's time is counted in
      */
-    void hook_block_add(BlockAddHook hook) { m_block_add_hooks.push_back(std::move(hook)); }
+    void hook_block_add(
+            BlockAddHook hook,
+            std::chrono::nanoseconds block_processing_times::*timing =
+                    &block_processing_times::other_hooks) {
+        m_block_add_hooks.emplace_back(std::move(hook), timing);
+    }
     /**
      * @brief add a hook to be called after a new block has been added to the (main) chain.  Unlike
      * the above, this only fires after addition is complete and successful, while the above hook is
@@ -1237,6 +1419,12 @@ class Blockchain {
   private:
 #endif
 
+    /**
+     * @brief schedules a background sync of the db within the configured sync latency, if one
+     * isn't already scheduled
+     */
+    void schedule_db_sync();
+
     struct block_pow_verified {
         bool valid;
         bool precomputed;
@@ -1295,14 +1483,32 @@ class Blockchain {
             m_scan_table;
     std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
 
+    // PoW computed by precompute_block_pow(), with the seed block id that it was computed with
+    struct precomputed_pow {
+        crypto::hash seed;
+        crypto::hash pow;
+    };
+    std::mutex m_precomputed_pow_mutex;
+    std::unordered_map<crypto::hash, precomputed_pow> m_precomputed_pow;
+    tools::threadpool::waiter m_precompute_waiter;
+
     // Keccak hashes for each block and for fast pow checking
     std::vector<crypto::hash> m_blocks_hash_of_hashes;
+    // Trusted hashes from a user-supplied file, continuing past (or replacing) the compiled-in ones
+    std::unique_ptr<block_hash_file> m_block_hash_file;
+    fs::path m_block_hash_file_path;
+    std::optional<crypto::ed25519_public_key> m_block_hash_file_signer;
     std::vector<crypto::hash> m_blocks_hash_check;
     std::vector<crypto::hash> m_blocks_txs_check;
 
     blockchain_db_sync_mode m_db_sync_mode;
     bool m_fast_sync;
     bool m_show_time_stats;
+    block_add_stats m_block_add_stats;
+    block_processing_stats m_block_processing_stats;
+    // Each block's share of preparing the current incoming span, if any
+    std::chrono::nanoseconds m_span_prepare_blocks_time{};
+    std::chrono::nanoseconds m_span_prepare_txs_time{};
     bool m_db_default_sync;
     bool m_db_sync_on_blocks;
     uint64_t m_db_sync_threshold;
@@ -1311,12 +1517,48 @@ class Blockchain {
     std::chrono::nanoseconds m_fake_scan_time;
     uint64_t m_sync_counter;
     uint64_t m_bytes_to_sync;
+    // If set, blocks are made durable by a background sync at most this long after being added
+    std::chrono::milliseconds m_db_sync_latency{0};
+    // Set while such a sync is scheduled but hasn't started yet
+    std::atomic<bool> m_db_sync_scheduled{false};
 
     uint64_t m_long_term_block_weights_window;
     uint64_t m_long_term_effective_median_block_weight;
-    mutable crypto::hash m_long_term_block_weights_cache_tip_hash;
-    mutable epee::misc_utils::rolling_median_t<uint64_t>
-            m_long_term_block_weights_cache_rolling_median;
+
+    // The median of a window of block weights ending at block `tip_hash`.  This is moved up or down
+    // the chain a block at a time, in O(log window), as blocks are added and popped rather than
+    // being reloaded from the database.  Copying one is a cheap snapshot (a memcpy of the window).
+    struct block_weights_median_cache {
+        crypto::hash tip_hash{};
+        epee::misc_utils::rolling_median_t<uint64_t> rolling_median;
+        size_t window;
+
+        explicit block_weights_median_cache(size_t window) :
+                rolling_median{window}, window{window} {}
+    };
+    mutable block_weights_median_cache m_long_term_block_weights_cache;
+    mutable block_weights_median_cache m_short_term_block_weights_cache;
+
+    // Everything get_dynamic_base_fee_estimate needs from the chain, loaded once per estimate (or
+    // set of estimates)
+    struct fee_estimate_inputs {
+        hf version;
+        uint64_t min_block_weight;
+        std::vector<uint64_t> weights;  // Of the last REWARD_BLOCKS_WINDOW blocks, oldest first
+        uint64_t base_reward;
+    };
+    fee_estimate_inputs get_fee_estimate_inputs() const;
+    byte_and_output_fees get_fee_estimate(
+            const fee_estimate_inputs& inputs, uint64_t grace_blocks) const;
+
+    // Fee estimates for each grace_blocks value, as of the chain height in `height`; replaced by
+    // update_fee_estimates() after every block and dropped when a block is popped.
+    struct fee_estimates {
+        uint64_t height;
+        std::array<byte_and_output_fees, REWARD_BLOCKS_WINDOW> by_grace_blocks;
+    };
+    mutable std::mutex m_fee_estimates_mutex;
+    std::shared_ptr<const fee_estimates> m_fee_estimates;
 
     // NOTE: PoW/Difficulty Cache
     // Before HF16, we use timestamps and difficulties only.
@@ -1343,7 +1585,8 @@ class Blockchain {
     // some invalid blocks
     std::set<crypto::hash> m_invalid_blocks;
 
-    std::vector<BlockAddHook> m_block_add_hooks;
+    std::vector<std::pair<BlockAddHook, std::chrono::nanoseconds block_processing_times::*>>
+            m_block_add_hooks;
     std::vector<BlockAddHook> m_alt_block_add_hooks;
     std::vector<BlockPostAddHook> m_block_post_add_hooks;
     std::vector<BlockchainDetachedHook> m_blockchain_detached_hooks;
@@ -1352,6 +1595,35 @@ class Blockchain {
 
     checkpoints m_checkpoints;
 
+    verification_cache m_verification_cache;
+
+    // The alt chains most recently built or extended, keyed by the hash of their tip, so that a
+    // block extending one of them doesn't have to read and parse the whole chain from the db
+    // again.  Cleared whenever the main chain, the checkpoints or the stored alt blocks change,
+    // since any of those can change what build_alt_chain() would produce.
+    struct cached_alt_chain {
+        crypto::hash tip;
+        std::list<block_extended_info> chain;
+        int num_alt_checkpoints;
+        int num_checkpoints;
+    };
+    static constexpr size_t ALT_CHAIN_CACHE_TIPS = 8;
+    std::vector<cached_alt_chain> m_alt_chain_cache;
+
+    // The Pulse chain weight of the main chain blocks from `start` up to the top block `top`, as
+    // last used to compare an alt chain against the main chain.
+    struct {
+        uint64_t start = 0;
+        crypto::hash top{};
+        uint64_t weight = 0;
+    } m_main_chain_pulse_weight;
+
+    mutable rct_output_counts m_rct_output_counts;
+
+    // Main chain block hashes for matching and answering sync requests; guarded by the blockchain
+    // lock (rather than its own), and synced with the db before each use.
+    mutable chain_hash_index m_chain_hashes;
+
     eth::L2Tracker* m_l2_tracker;
     network_type m_nettype;
     bool m_offline;
@@ -1368,6 +1640,24 @@ class Blockchain {
     uint64_t m_btc_expected_reward;
     bool m_btc_valid;
 
+    // Pulse block template built ahead of time (see prebuild_pulse_block_template), along with
+    // what it depends on: it can only be used while all of those are unchanged.
+    struct pulse_template {
+        block b;
+        uint64_t height;
+        service_nodes::payout producer;
+        uint64_t pool_cookie;
+        uint64_t l2_height;
+    };
+    std::mutex m_pulse_template_mutex;
+    std::optional<pulse_template> m_pulse_template;
+
+    // Returns a copy of the pre-built Pulse template, if there is one that's still current for
+    // `producer`.
+    std::optional<pulse_template> current_pulse_template(const service_nodes::payout& producer);
+    // Builds a Pulse template without any round information
+    std::optional<pulse_template> build_pulse_template(const service_nodes::payout& producer);
+
     bool m_batch_success;
 
     // for prepare_handle_incoming_blocks
@@ -1476,6 +1766,10 @@ class Blockchain {
     bool switch_to_alternative_blockchain(
             const std::list<block_extended_info>& alt_chain, bool keep_disconnected_chain);
 
+    // The body of switch_to_alternative_blockchain(), which runs this inside a db batch.
+    bool switch_to_alternative_blockchain_batched(
+            const std::list<block_extended_info>& alt_chain, bool keep_disconnected_chain);
+
     /**
      * @brief removes the most recent block from the blockchain
      *
@@ -1657,6 +1951,24 @@ class Blockchain {
      */
     uint64_t get_long_term_block_weight_median(uint64_t start_height, size_t count) const;
 
+    /**
+     * @brief gets the median weight of the last REWARD_BLOCKS_WINDOW blocks
+     *
+     * @return the median of the weights get_last_n_blocks_weights() would return for
+     * REWARD_BLOCKS_WINDOW blocks, or 0 for an empty blockchain
+     */
+    uint64_t get_short_term_block_weight_median() const;
+
+    /**
+     * @brief gets the median (long term, if `long_term` is set) weight of <count> blocks starting
+     * at <start_height>, using and updating `cache`
+     */
+    uint64_t get_block_weight_median(
+            block_weights_median_cache& cache,
+            uint64_t start_height,
+            size_t count,
+            bool long_term) const;
+
     /**
      * @brief checks if a transaction is unlocked (its outputs spendable)
      *
@@ -1793,6 +2105,25 @@ class Blockchain {
      */
     void load_compiled_in_block_hashes(const GetCheckpointsCallback& get_checkpoints);
 
+    /**
+     * @brief loads the block hash file given to set_block_hash_file(), if any
+     *
+     * The file is dropped (with an error logged) if it is invalid, badly signed, or disagrees with
+     * the compiled-in hashes.
+     */
+    void load_block_hash_file();
+
+    /**
+     * @brief prepares to check incoming blocks against the loaded hashes, if they reach past the
+     * current chain height
+     */
+    void start_known_block_hashes();
+
+    // The number of known hash-of-hashes, from the compiled-in hashes or the block hash file,
+    // and the i'th of them.
+    size_t known_hash_of_hashes_count() const;
+    crypto::hash known_hash_of_hashes(size_t i) const;
+
     /**
      * @brief expands v2 transaction data from blockchain
      *
@@ -1805,6 +2136,25 @@ class Blockchain {
             const crypto::hash& tx_prefix_hash,
             const std::vector<std::vector<rct::ctkey>>& pubkeys) const;
 
+    /**
+     * @brief verifies the ring signatures of a span of incoming block txes ahead of time
+     *
+     * Called from prepare_handle_incoming_blocks once the scan table is built.  Txes whose ring
+     * members are all available in the scan table have their CLSAGs (or MLSAGs) verified in
+     * parallel on the thread pool; those that pass are recorded in the verification cache so that
+     * the serial check_tx_inputs call made when the block is added can skip the signature
+     * verification.
+     *
+     * @param txes the parsed txes and their prefix hashes; the rct signatures of checked txes are
+     * expanded in place
+     * @param tx_hashes the full tx hashes, in the same order as `txes`
+     * @param tx_full whether each tx was fully parsed (i.e. including the prunable data)
+     */
+    void precheck_ring_signatures(
+            std::vector<std::pair<cryptonote::transaction, crypto::hash>>& txes,
+            const std::vector<crypto::hash>& tx_hashes,
+            const std::vector<char>& tx_full);
+
     /**
      * @brief invalidates any cached block template
      */
@@ -0,0 +1,105 @@
+#include "chain_hash_index.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#include "blockchain_db/blockchain_db.h"
+
+namespace cryptonote {
+
+uint64_t chain_hash_index::slot_key(const crypto::hash& h) {
+    // Block hashes are uniformly distributed, so their leading bytes are as good as any hash of them
+    uint64_t key;
+    std::memcpy(&key, h.data(), sizeof(key));
+    return key;
+}
+
+void chain_hash_index::sync(const BlockchainDB& db) {
+    const uint64_t height = db.height();
+    if (m_hashes.size() > height)
+        blockchain_detached(height);
+    // An aborted batch can take blocks back out (and others can replace them) without us hearing
+    // about it, so walk back to the last hash we still share with the db; this is nearly always
+    // just the one check of our last hash.
+    while (!m_hashes.empty() &&
+           m_hashes.back() != db.get_block_hash_from_height(m_hashes.size() - 1))
+        blockchain_detached(m_hashes.size() - 1);
+
+    if (m_hashes.size() < height && m_slots.size() < 2 * height)
+        rehash(std::bit_ceil(2 * height));
+    while (m_hashes.size() < height) {
+        uint64_t end = std::min<uint64_t>(height, m_hashes.size() + LOAD_BATCH);
+        auto hashes = db.get_hashes_range(m_hashes.size(), end - 1);
+        if (hashes.size() != end - m_hashes.size())
+            throw std::runtime_error{"Failed to load main chain block hashes"};
+        for (const auto& h : hashes)
+            push_back(h);
+    }
+}
+
+std::optional<uint64_t> chain_hash_index::height(const crypto::hash& h) const {
+    if (m_slots.empty())
+        return std::nullopt;
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = slot_key(h) & mask; m_slots[i]; i = (i + 1) & mask)
+        if (m_hashes[m_slots[i] - 1] == h)
+            return m_slots[i] - 1;
+    return std::nullopt;
+}
+
+void chain_hash_index::push_back(const crypto::hash& h) {
+    if (m_slots.size() < 2 * (m_hashes.size() + 1))
+        rehash(std::max<size_t>(1024, 2 * m_slots.size()));
+    m_hashes.push_back(h);
+    insert_slot(m_hashes.size() - 1);
+}
+
+void chain_hash_index::insert_slot(uint32_t height) {
+    const size_t mask = m_slots.size() - 1;
+    size_t i = slot_key(m_hashes[height]) & mask;
+    while (m_slots[i])
+        i = (i + 1) & mask;
+    m_slots[i] = height + 1;
+}
+
+void chain_hash_index::erase_slot(uint32_t height) {
+    const size_t mask = m_slots.size() - 1;
+    size_t i = slot_key(m_hashes[height]) & mask;
+    while (m_slots[i] != height + 1)
+        i = (i + 1) & mask;
+    // Backward shift deletion: move up any later entry of the probe run that may no longer be
+    // reachable through the emptied slot, so that we never need tombstones.
+    for (size_t j = (i + 1) & mask; m_slots[j]; j = (j + 1) & mask) {
+        size_t home = slot_key(m_hashes[m_slots[j] - 1]) & mask;
+        // The entry at j can move to i unless its home slot lies cyclically in (i, j]
+        bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            m_slots[i] = m_slots[j];
+            i = j;
+        }
+    }
+    m_slots[i] = 0;
+}
+
+void chain_hash_index::rehash(size_t slots) {
+    m_slots.assign(slots, 0);
+    for (size_t h = 0; h < m_hashes.size(); h++)
+        insert_slot(h);
+}
+
+void chain_hash_index::blockchain_detached(uint64_t height) {
+    if (height >= m_hashes.size())
+        return;
+    for (uint64_t h = m_hashes.size(); h > height; h--)
+        erase_slot(h - 1);
+    m_hashes.resize(height);
+}
+
+void chain_hash_index::clear() {
+    m_hashes.clear();
+    m_slots.clear();
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace cryptonote {
+
+class BlockchainDB;
+
+/// In-memory copy of the main chain's block hashes, indexed both by height and by hash.  Every
+/// syncing peer's NOTIFY_REQUEST_CHAIN has us match its chain locator against our chain and then
+/// send back up to BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT hashes from the split point on; served
+/// from here those are memory lookups rather than a database lookup for each hash.
+///
+/// Like rct_output_counts, hashes are loaded from the database on demand, continuing from wherever
+/// the index currently ends, and blockchain_detached() must be called when blocks are removed.
+/// sync() also checks the last loaded hash against the database, so that blocks dropped without
+/// going through blockchain_detached() (i.e. by an aborted batch) are never served.
+///
+/// The hash lookup is an open addressing table of heights, keyed by the leading bytes of the hash,
+/// so it costs 4 bytes per slot on top of the 32 of the hash itself.
+class chain_hash_index {
+  public:
+    /// How many heights we fetch from the database at a time when extending the index
+    static constexpr uint64_t LOAD_BATCH = 10'000;
+
+    /// Brings the index up to date with the main chain in `db`.  Must be called (with the
+    /// blockchain lock held) before the lookups below.
+    void sync(const BlockchainDB& db);
+
+    /// Returns the number of heights currently loaded, i.e. the chain height as of the last sync.
+    uint64_t size() const { return m_hashes.size(); }
+
+    /// Returns the hash of the block at `height`, which must be less than size().
+    const crypto::hash& operator[](uint64_t height) const { return m_hashes[height]; }
+
+    /// Returns the height of the main chain block with hash `h`, if it is in the index.
+    std::optional<uint64_t> height(const crypto::hash& h) const;
+
+    /// Appends the next block's hash.
+    void push_back(const crypto::hash& h);
+
+    /// Drops the hashes of all blocks at or above `height`.
+    void blockchain_detached(uint64_t height);
+
+    void clear();
+
+  private:
+    static uint64_t slot_key(const crypto::hash& h);
+    void insert_slot(uint32_t height);
+    void erase_slot(uint32_t height);
+    void rehash(size_t slots);
+
+    std::vector<crypto::hash> m_hashes;
+    // Open addressing (linear probing) table of height + 1 for each loaded block; 0 is an empty
+    // slot.  Its size is a power of 2, kept at least twice the number of hashes.
+    std::vector<uint32_t> m_slots;
+};
+
+}  // namespace cryptonote
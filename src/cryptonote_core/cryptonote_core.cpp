@@ -42,6 +42,7 @@ extern "C" {
 }
 #endif
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <csignal>
 #include <iomanip>
@@ -59,6 +60,7 @@ extern "C" {
 #include "common/i18n.h"
 #include "common/notify.h"
 #include "common/sha256sum.h"
+#include "common/string_util.h"
 #include "common/threadpool.h"
 #include "crypto/crypto.h"
 #include "cryptonote_basic/hardfork.h"
@@ -107,6 +109,16 @@ const command_line::arg_descriptor<size_t> arg_block_download_max_size = {
         "block-download-max-size",
         "Set maximum size of block download queue in bytes (0 for default)",
         0};
+const command_line::arg_descriptor<size_t> arg_block_download_max_memory = {
+        "block-download-max-memory",
+        "Set maximum memory in bytes for downloaded blocks waiting to be verified; blocks beyond "
+        "this are kept in temporary files in the data directory (0 for no limit)",
+        0};
+const command_line::arg_descriptor<size_t> arg_block_download_max_spans = {
+        "block-download-max-spans",
+        "Set how many downloaded spans of blocks to keep queued ahead of block verification (0 for "
+        "default)",
+        0};
 
 static const command_line::arg_flag arg_test_drop_download = {
         "test-drop-download",
@@ -117,13 +129,25 @@ static const command_line::arg_descriptor<uint64_t> arg_test_drop_download_heigh
         0};
 static const command_line::arg_descriptor<uint64_t> arg_fast_block_sync = {
         "fast-block-sync", "Sync up most of the way by using embedded, known block hashes.", 1};
+static const command_line::arg_descriptor<std::string> arg_block_hashes_file = {
+        "block-hashes-file",
+        "Trusted block hash file to use for fast sync in addition to the embedded block hashes, "
+        "for syncing quickly up to a more recent height than this build knows about."};
+static const command_line::arg_descriptor<std::string> arg_block_hashes_pubkey = {
+        "block-hashes-pubkey",
+        "Ed25519 public key (in hex) that --block-hashes-file must be signed by.  If omitted the "
+        "file's hashes are trusted without checking any signature."};
 static const command_line::arg_descriptor<uint64_t> arg_prep_blocks_threads = {
         "prep-blocks-threads",
         "Max number of threads to use when preparing block hashes in groups.",
         4};
+static const command_line::arg_flag arg_randomx_fast_verify = {
+        "randomx-fast-verify",
+        "Verify RandomX proof of work with the full dataset rather than in light mode; this is "
+        "several times faster when syncing old blocks, but needs about 4.5GB of extra memory."};
 static const command_line::arg_flag arg_show_time_stats = {
         "show-time-stats", "Show time-stats when processing blocks/txs and disk synchronization."};
-static const command_line::arg_descriptor<size_t> arg_block_sync_size = {
+const command_line::arg_descriptor<size_t> arg_block_sync_size = {
         "block-sync-size",
         "How many blocks to sync at once during chain synchronization (0 = adaptive).",
         0};
@@ -132,6 +156,28 @@ static const command_line::arg_flag arg_pad_transactions = {
         "Pad relayed transactions to help defend against traffic volume analysis"};
 static const command_line::arg_descriptor<size_t> arg_max_txpool_weight = {
         "max-txpool-weight", "Set maximum txpool weight in bytes.", DEFAULT_MEMPOOL_MAX_WEIGHT};
+static const command_line::arg_descriptor<size_t> arg_max_txpool_memory = {
+        "max-txpool-memory",
+        "Set a limit, in bytes, on the approximate memory used by txpool transactions; the lowest "
+        "fee transactions are dropped when it is exceeded, as with max-txpool-weight (0 = no "
+        "limit).",
+        0};
+static const command_line::arg_descriptor<uint64_t> arg_tx_batch_verify_window = {
+        "tx-batch-verify-window",
+        "Gather submitted transactions for up to this many milliseconds so that their range proofs "
+        "can be verified in a single batch (0 to disable).",
+        0};
+static const command_line::arg_descriptor<size_t> arg_tx_batch_verify_max = {
+        "tx-batch-verify-max",
+        "Verify a batch of gathered transactions immediately once this many are waiting (see "
+        "--tx-batch-verify-window).",
+        64};
+static const command_line::arg_descriptor<size_t> arg_bulletproof_batch_size = {
+        "bulletproof-batch-size",
+        "The most range proofs to verify together in one batch; larger sets of proofs are split "
+        "up and verified in parallel.  0 (the default) uses the size measured to work best on "
+        "this machine, which is measured on the first startup and kept in the data directory.",
+        0};
 static const command_line::arg_flag arg_service_node = {
         "service-node", "Run as a service node, option 'service-node-public-ip' must be set"};
 static const command_line::arg_descriptor<std::string> arg_public_ip = {
@@ -178,6 +224,11 @@ static const command_line::arg_descriptor<int> arg_l2_max_logs = {
         "Specify the maximum number of logs we will request at once in a single request to the L2 "
         "provider.  If more logs are needed than this at once then multiple requests will be used.",
         ETH_L2_DEFAULT_MAX_LOGS};
+static const command_line::arg_descriptor<int> arg_l2_concurrent_logs = {
+        "l2-concurrent-logs",
+        "Specify the maximum number of log requests that will be sent to the L2 provider at once "
+        "when more logs are needed than fit in a single request.",
+        ETH_L2_DEFAULT_CONCURRENT_LOGS};
 static const command_line::arg_descriptor<double> arg_l2_check_interval = {
         "l2-check-interval",
         "When multiple L2 providers are specified, this specifies how often (in seconds) all of "
@@ -223,6 +274,11 @@ static const command_line::arg_descriptor<uint64_t> arg_store_quorum_history = {
         0};
 static const command_line::arg_flag arg_disable_ip_check = {
         "disable-ip-check", "Disable the periodic Service Node IP check"};
+static const command_line::arg_flag arg_address_activity_index = {
+        "address-activity-index",
+        "Maintain an index of the service node registrations, stakes and unlocks and the ONS "
+        "records involving each wallet or ethereum address (e.g. for a block explorer).  Building "
+        "it for an existing blockchain takes a while on the first startup with this option."};
 
 // Loads stubs that fail if invoked.  The stubs are replaced in the
 // cryptonote_protocol/quorumnet.cpp glue code.
@@ -262,9 +318,10 @@ core::core() :
         miner{[this](const cryptonote::block& b,
                      uint64_t height,
                      unsigned int threads,
-                     crypto::hash& hash) {
-                  hash = cryptonote::get_block_longhash_w_blockchain(
-                          m_nettype, &blockchain, b, height, threads);
+                     std::span<const uint32_t> nonces,
+                     std::span<crypto::hash> hashes) {
+                  cryptonote::get_block_longhashes(
+                          m_nettype, &blockchain, b, height, threads, nonces, hashes);
                   return true;
               },
               [this](block& b, block_verification_context& bvc) {
@@ -328,17 +385,27 @@ void core::init_options(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_dev_allow_local);
     command_line::add_arg(desc, arg_prep_blocks_threads);
     command_line::add_arg(desc, arg_fast_block_sync);
+    command_line::add_arg(desc, arg_block_hashes_file);
+    command_line::add_arg(desc, arg_block_hashes_pubkey);
+    command_line::add_arg(desc, arg_randomx_fast_verify);
     command_line::add_arg(desc, arg_show_time_stats);
     command_line::add_arg(desc, arg_block_sync_size);
     command_line::add_arg(desc, arg_offline);
     command_line::add_arg(desc, arg_block_download_max_size);
+    command_line::add_arg(desc, arg_block_download_max_spans);
+    command_line::add_arg(desc, arg_block_download_max_memory);
     command_line::add_arg(desc, arg_max_txpool_weight);
+    command_line::add_arg(desc, arg_max_txpool_memory);
+    command_line::add_arg(desc, arg_tx_batch_verify_window);
+    command_line::add_arg(desc, arg_tx_batch_verify_max);
+    command_line::add_arg(desc, arg_bulletproof_batch_size);
     command_line::add_arg(desc, arg_service_node);
     command_line::add_arg(desc, arg_public_ip);
     command_line::add_arg(desc, arg_l2_provider);
     command_line::add_arg(desc, arg_l2_refresh);
     command_line::add_arg(desc, arg_l2_timeout);
     command_line::add_arg(desc, arg_l2_max_logs);
+    command_line::add_arg(desc, arg_l2_concurrent_logs);
     command_line::add_arg(desc, arg_l2_check_interval);
     command_line::add_arg(desc, arg_l2_check_threshold);
     command_line::add_arg(desc, arg_l2_skip_chainid);
@@ -357,6 +424,7 @@ void core::init_options(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_store_quorum_history);
     command_line::add_arg(desc, arg_omq_quorumnet_public);
     command_line::add_arg(desc, arg_disable_ip_check);
+    command_line::add_arg(desc, arg_address_activity_index);
 
     miner::init_options(desc);
     BlockchainDB::init_options(desc);
@@ -521,13 +589,51 @@ static Duration as_duration(double seconds) {
     return std::chrono::duration_cast<Duration>(dseconds(seconds));
 }
 
+// Where we keep the measured bulletproof batch size, along with the thread count it was measured
+// with: it needs measuring again if that changes.
+static const fs::path BULLETPROOF_BATCH_SIZE_FILE{u8"bulletproof_batch_size"};
+
+static size_t load_bulletproof_batch_size(const fs::path& path) {
+    const unsigned threads = tools::threadpool::getInstance().get_max_concurrency();
+    if (std::string contents; tools::slurp_file(path, contents)) {
+        std::string_view line{contents};
+        tools::trim(line);
+        auto parts = tools::split(line, " ");
+        size_t size;
+        unsigned measured_threads;
+        if (parts.size() == 2 && tools::parse_int(parts[0], size) && size > 0 &&
+            tools::parse_int(parts[1], measured_threads) && measured_threads == threads)
+            return size;
+    }
+
+    log::info(logcat, "Measuring the best bulletproof verification batch size...");
+    size_t size = rct::tune_bulletproof_batch_size();
+    log::info(logcat, "Verifying bulletproofs in batches of up to {}", size);
+    if (!tools::dump_file(path, "{} {}\n"_format(size, threads)))
+        log::warning(logcat, "Failed to save the bulletproof batch size to {}", path);
+    return size;
+}
 //-----------------------------------------------------------------------------------------------
+// Runs `f()` and logs how long it took, as a phase of startup.
+template <typename F>
+static auto timed_startup_phase(std::string_view phase, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = f();
+    log::info(
+            logcat,
+            "Startup: {} took {}",
+            phase,
+            tools::friendly_duration(std::chrono::steady_clock::now() - start));
+    return result;
+}
+
 bool core::init(
         const boost::program_options::variables_map& vm,
         const cryptonote::test_options* test_options,
         const GetCheckpointsCallback& get_checkpoints /* = nullptr */,
         const std::atomic<bool>* abort) {
     start_time = std::time(nullptr);
+    const auto init_start = std::chrono::steady_clock::now();
 
     if (test_options != NULL)
         m_nettype = network_type::FAKECHAIN;
@@ -538,6 +644,7 @@ bool core::init(
     CHECK_AND_ASSERT_MES(r, false, "Failed to apply command line options.");
 
     size_t max_txpool_weight = command_line::get_arg(vm, arg_max_txpool_weight);
+    size_t max_txpool_memory = command_line::get_arg(vm, arg_max_txpool_memory);
     bool const prune_blockchain = false; /* command_line::get_arg(vm, arg_prune_blockchain); */
     bool keep_alt_blocks = command_line::get_arg(vm, arg_keep_alt_blocks);
 
@@ -552,7 +659,7 @@ bool core::init(
     if (m_nettype == network_type::FAKECHAIN)
         folder /= "fake";
 
-    auto db = init_blockchain_db(folder, vm);
+    auto db = timed_startup_phase("blockchain db", [&] { return init_blockchain_db(folder, vm); });
     if (!db)
         return false;
 
@@ -599,7 +706,20 @@ bool core::init(
         }
     }
 
-    auto sqliteDB = std::make_unique<cryptonote::BlockchainSQLite>(m_nettype, sqlite_db_file_path);
+    // Opening the ONS and batched rewards databases (and checking the L2 providers, below) is
+    // mostly waiting on the disk or network, and none of them depend on each other, so they go
+    // ahead on their own threads while we set up the rest; we need them all by blockchain.init().
+    auto sqlite_db_future = std::async(std::launch::async, [&] {
+        return timed_startup_phase("batched rewards db", [&] {
+            return std::make_unique<cryptonote::BlockchainSQLite>(m_nettype, sqlite_db_file_path);
+        });
+    });
+    auto ons_db_future = std::async(
+            std::launch::async, [&, read_only = db->is_read_only()] {
+                return timed_startup_phase("ONS db", [&] {
+                    return ons::init_oxen_name_system(ons_db_file_path, read_only);
+                });
+            });
 
     // We need this hook to get added before the block hook below, so that it fires first and
     // catches the start of a reorg before the block hook fires for the block in the reorg.
@@ -655,23 +775,45 @@ bool core::init(
     // NOTE: There is an implicit dependency on service node lists being hooked first!
     blockchain.hook_init([this] { m_quorum_cop.init(); });
     blockchain.hook_block_add(
-            [this](const auto& info) { m_quorum_cop.block_add(info.block, info.txs); });
+            [this](const auto& info) { m_quorum_cop.block_add(info.block, info.txs); },
+            &block_processing_times::quorum_cop);
     blockchain.hook_blockchain_detached([this](const auto& info) {
         m_quorum_cop.blockchain_detached(info.height, info.by_pop_blocks);
     });
 
     blockchain.hook_block_post_add([this](const auto&) { update_omq_sns(); });
 
+    // Wallets ask for fee estimates before every send, so work them out once per block
+    blockchain.hook_block_post_add([this](const auto&) { blockchain.update_fee_estimates(); });
+
+    if (command_line::get_arg(vm, arg_address_activity_index)) {
+        m_address_activity = std::make_unique<AddressActivityDB>(
+                m_nettype,
+                m_nettype == network_type::FAKECHAIN ? ":memory:" : folder / "activity.db");
+        blockchain.hook_init(
+                [this] { sync_address_activity(blockchain.get_current_blockchain_height()); });
+        // A failure here shouldn't stop us from accepting the block: we just log it, and whatever
+        // got missed is indexed again from the db when the next block comes (or on restart).
+        blockchain.hook_block_add([this](const auto& info) {
+            try {
+                auto height = info.block.get_height();
+                sync_address_activity(height);
+                m_address_activity->add_block(info.block, info.txs);
+            } catch (const std::exception& e) {
+                log::error(logcat, "Failed to update the address activity index: {}", e.what());
+            }
+        });
+        blockchain.hook_blockchain_detached(
+                [this](const auto& info) { m_address_activity->blockchain_detached(info.height); });
+    }
+
     // Checkpoints
     m_checkpoints_path = m_config_folder / JSON_HASH_FILE_NAME;
 
-    sqlite3* ons_db = ons::init_oxen_name_system(ons_db_file_path, db->is_read_only());
-    if (!ons_db)
-        return false;
-
     init_oxenmq(vm);
     m_bls_aggregator = std::make_unique<eth::bls_aggregator>(*this);
 
+    std::future<bool> l2_chain_id_ok;
     const auto l2_provider = command_line::get_arg(vm, arg_l2_provider);
     if (!l2_provider.empty()) {
         // We support both multiple --l2-provider options, each of which can be a delimited list, so
@@ -698,6 +840,8 @@ bool core::init(
             m_l2_tracker->provider.setTimeout(as_duration<std::chrono::milliseconds>(
                     1000 * command_line::get_arg(vm, arg_l2_timeout)));
             m_l2_tracker->GETLOGS_MAX_BLOCKS = command_line::get_arg(vm, arg_l2_max_logs);
+            m_l2_tracker->GETLOGS_CONCURRENCY =
+                    std::max(1, command_line::get_arg(vm, arg_l2_concurrent_logs));
             m_l2_tracker->PROVIDERS_CHECK_INTERVAL = as_duration<std::chrono::milliseconds>(
                     command_line::get_arg(vm, arg_l2_check_interval));
             m_l2_tracker->PROVIDERS_CHECK_THRESHOLD =
@@ -723,8 +867,10 @@ bool core::init(
 
             if (!command_line::get_arg(vm, arg_l2_skip_chainid)) {
                 log::info(globallogcat, "Verifying L2 provider chain-id");
-                if (!m_l2_tracker->check_chain_id())
-                    return false;  // the above already logs critical on failure
+                l2_chain_id_ok = std::async(std::launch::async, [this] {
+                    return timed_startup_phase(
+                            "L2 provider check", [this] { return m_l2_tracker->check_chain_id(); });
+                });
             }
         }
     }
@@ -738,30 +884,71 @@ bool core::init(
     // TODO: remove this after HF21
     m_skip_proof_l2_check = command_line::get_arg(vm, arg_l2_skip_proof_check);
 
-    r = blockchain.init(
-            std::move(db),
-            m_nettype,
-            ons_db,
-            sqliteDB.release(),
-            m_l2_tracker.get(),
-            m_offline,
-            (m_nettype == network_type::FAKECHAIN && !test_options) ? &regtest_test_options
-                                                                    : test_options,
-            command_line::get_arg(vm, arg_fixed_difficulty),
-            get_checkpoints,
-            abort);
+    if (auto hashes_file = command_line::get_arg(vm, arg_block_hashes_file); !hashes_file.empty()) {
+        std::optional<crypto::ed25519_public_key> signer;
+        if (auto key = command_line::get_arg(vm, arg_block_hashes_pubkey); !key.empty()) {
+            try {
+                signer = tools::make_from_hex_guts<crypto::ed25519_public_key>(key);
+            } catch (const std::exception& e) {
+                log::error(logcat, "Invalid --{}: {}", arg_block_hashes_pubkey.name, e.what());
+                return false;
+            }
+        }
+        blockchain.set_block_hash_file(tools::utf8_path(hashes_file), signer);
+    }
+
+    auto sqliteDB = sqlite_db_future.get();
+    sqlite3* ons_db = ons_db_future.get();
+    if (!ons_db)
+        return false;
+    if (l2_chain_id_ok.valid() && !l2_chain_id_ok.get())
+        return false;  // check_chain_id() already logs critical on failure
+
+    // This loads the service node list state, along with everything else hooked into
+    // blockchain.init(); the tx pool has to wait for it, as validating pool txes (e.g. state
+    // changes) needs it.
+    r = timed_startup_phase("blockchain and service node state", [&] {
+        return blockchain.init(
+                std::move(db),
+                m_nettype,
+                ons_db,
+                sqliteDB.release(),
+                m_l2_tracker.get(),
+                m_offline,
+                (m_nettype == network_type::FAKECHAIN && !test_options) ? &regtest_test_options
+                                                                        : test_options,
+                command_line::get_arg(vm, arg_fixed_difficulty),
+                get_checkpoints,
+                abort);
+    });
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
 
-    r = mempool.init(max_txpool_weight);
+    r = timed_startup_phase("tx pool", [&] {
+        if (!mempool.init(max_txpool_weight, max_txpool_memory))
+            return false;
+        // now that we have a valid `blockchain`, we can clean out any
+        // transactions in the pool that do not conform to the current fork
+        mempool.validate(blockchain.get_network_version());
+        return true;
+    });
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize memory pool");
 
-    // now that we have a valid `blockchain`, we can clean out any
-    // transactions in the pool that do not conform to the current fork
-    mempool.validate(blockchain.get_network_version());
-
     bool show_time_stats = command_line::get_arg(vm, arg_show_time_stats) != 0;
     blockchain.set_show_time_stats(show_time_stats);
 
+    if (command_line::get_arg(vm, arg_randomx_fast_verify)) {
+        log::info(globallogcat, "Using full RandomX datasets for block verification");
+        rx_set_fast_verify(tools::threadpool::getInstance().get_max_concurrency());
+    }
+
+    m_rct_batch_verifier.configure(
+            std::chrono::milliseconds{command_line::get_arg(vm, arg_tx_batch_verify_window)},
+            command_line::get_arg(vm, arg_tx_batch_verify_max));
+    size_t bp_batch_size = command_line::get_arg(vm, arg_bulletproof_batch_size);
+    if (bp_batch_size == 0 && m_nettype != network_type::FAKECHAIN)
+        bp_batch_size = load_bulletproof_batch_size(m_config_folder / BULLETPROOF_BATCH_SIZE_FILE);
+    rct::set_bulletproof_batch_size(bp_batch_size);
+
     block_sync_size = command_line::get_arg(vm, arg_block_sync_size);
     if (block_sync_size > BLOCKS_SYNCHRONIZING_MAX_COUNT)
         log::error(
@@ -771,7 +958,8 @@ bool core::init(
 
     log::info(globallogcat, "Loading checkpoints");
     CHECK_AND_ASSERT_MES(
-            update_checkpoints_from_json_file(),
+            timed_startup_phase(
+                    "checkpoints", [this] { return update_checkpoints_from_json_file(); }),
             false,
             "One or more checkpoints loaded from json conflicted with existing checkpoints.");
 
@@ -782,21 +970,71 @@ bool core::init(
         blockchain.db().drop_alt_blocks();
 
     if (prune_blockchain) {
-        // display a message if the blockchain is not pruned yet
-        if (!blockchain.get_blockchain_pruning_seed()) {
-            log::info(globallogcat, "Pruning blockchain...");
-            CHECK_AND_ASSERT_MES(
-                    blockchain.prune_blockchain(), false, "Failed to prune blockchain");
-        } else {
+        if (blockchain.get_blockchain_pruning_seed())
             CHECK_AND_ASSERT_MES(
                     blockchain.update_blockchain_pruning(),
                     false,
                     "Failed to update blockchain pruning");
-        }
+        // Prune (or finish pruning) the rest of the blockchain a bit at a time from
+        // run_periodic_tasks() rather than holding up startup until it is all done.
+        m_background_pruning = true;
     }
 
+    register_metrics();
+    warm_randomx_cache();
+
+    log::info(
+            logcat,
+            "Startup: core initialized in {}",
+            tools::friendly_duration(std::chrono::steady_clock::now() - init_start));
     return true;
 }
+//-----------------------------------------------------------------------------------------------
+void core::warm_randomx_cache() {
+    if (m_nettype == network_type::FAKECHAIN)
+        return;
+    // Only worth it if the next block probably needs RandomX: i.e. we're still syncing through the
+    // RandomX blocks, or the top block is a pulse fallback (mined) block.  Otherwise the cache is
+    // only built if and when one comes along, as before.
+    auto top = blockchain.db().get_top_block();
+    if (top.major_version < hf::hf12_checkpointing || top.has_pulse())
+        return;
+    // Hashing the top block builds the cache for its seed, which is the next block's as well
+    // except at the end of a seed epoch.
+    tools::threadpool::getInstance().submit(
+            &m_randomx_warm_waiter,
+            [this, top = std::move(top)] {
+                timed_startup_phase("RandomX cache warm-up", [&] {
+                    return get_block_longhash_w_blockchain(
+                            m_nettype, &blockchain, top, top.get_height(), 0);
+                });
+            },
+            "randomx_warm");
+}
+//-----------------------------------------------------------------------------------------------
+void core::register_metrics() {
+    auto& metrics = tools::metrics::global();
+    m_metrics.push_back(metrics.add_gauge_callback(
+            "oxen_txpool_transactions", "Transactions in the mempool", {}, [this] {
+                return static_cast<double>(mempool.get_transactions_count());
+            }));
+    m_metrics.push_back(metrics.add_gauge_callback(
+            "oxen_txpool_weight_bytes", "Total weight of the mempool transactions", {}, [this] {
+                return static_cast<double>(mempool.get_txpool_weight());
+            }));
+    using counts = service_nodes::service_node_list::state_counts;
+    for (auto [state, count] :
+         {std::pair{"active", &counts::active},
+          std::pair{"decommissioned", &counts::decommissioned},
+          std::pair{"awaiting_contributions", &counts::awaiting_contributions}})
+        m_metrics.push_back(metrics.add_gauge_callback(
+                "oxen_service_nodes",
+                "Registered service nodes",
+                {{"state", state}},
+                [this, count = count] {
+                    return static_cast<double>(service_node_list.get_state_counts().*count);
+                }));
+}
 
 std::unique_ptr<BlockchainDB> core::init_blockchain_db(
         fs::path folder, const boost::program_options::variables_map& vm) {
@@ -805,6 +1043,7 @@ std::unique_ptr<BlockchainDB> core::init_blockchain_db(
     bool fast_sync = command_line::get_arg(vm, arg_fast_block_sync) != 0;
     uint64_t blocks_threads = command_line::get_arg(vm, arg_prep_blocks_threads);
     bool db_salvage = command_line::get_arg(vm, cryptonote::arg_db_salvage) != 0;
+    bool db_external_blobs = command_line::get_arg(vm, cryptonote::arg_db_external_blobs) != 0;
 
     // make sure the data directory exists, and try to lock it
     if (std::error_code ec;
@@ -834,6 +1073,7 @@ std::unique_ptr<BlockchainDB> core::init_blockchain_db(
     blockchain_db_sync_mode sync_mode = db_defaultsync;
     bool sync_on_blocks = true;
     uint64_t sync_threshold = 1;
+    std::chrono::milliseconds sync_latency{0};
 
     try {
         uint64_t db_flags = 0;
@@ -888,6 +1128,9 @@ std::unique_ptr<BlockchainDB> core::init_blockchain_db(
             } else if (!strcmp(endptr, "bytes")) {
                 sync_on_blocks = false;
                 sync_threshold = threshold;
+            } else if (!strcmp(endptr, "ms") || !strcmp(endptr, "s")) {
+                sync_latency = std::chrono::milliseconds{threshold * (*endptr == 's' ? 1000 : 1)};
+                sync_threshold = 0;
             } else {
                 log::error(logcat, "Invalid db sync mode: {}", options[2]);
                 return nullptr;
@@ -896,17 +1139,21 @@ std::unique_ptr<BlockchainDB> core::init_blockchain_db(
 
         if (db_salvage)
             db_flags |= DBF_SALVAGE;
+        if (db_external_blobs)
+            db_flags |= DBF_EXTERNAL_BLOBS;
 
         db->open(folder, m_nettype, db_flags);
         if (!db->m_open)
             return nullptr;
+        db->set_hot_cache_size(command_line::get_arg(vm, cryptonote::arg_db_hot_cache_size) << 20);
+        db->set_spending_index(command_line::get_arg(vm, cryptonote::arg_db_spending_index));
     } catch (const DB_ERROR& e) {
         log::error(logcat, "Error opening database: {}", e.what());
         return nullptr;
     }
 
     blockchain.set_user_options(
-            blocks_threads, sync_on_blocks, sync_threshold, sync_mode, fast_sync);
+            blocks_threads, sync_on_blocks, sync_threshold, sync_mode, fast_sync, sync_latency);
 
     return db;
 }
@@ -991,6 +1238,39 @@ bool init_key(
     return true;
 }
 
+//-----------------------------------------------------------------------------------------------
+void core::sync_address_activity(uint64_t height) {
+    auto& index = *m_address_activity;
+    if (index.height() > height) {
+        index.blockchain_detached(height);
+        return;
+    }
+    if (index.height() == height)
+        return;
+
+    log::info(
+            globallogcat,
+            "Updating the address activity index from height {} to {}",
+            index.height(),
+            height);
+    constexpr uint64_t BATCH_SIZE = 1000;
+    auto& db = blockchain.db();
+    while (index.height() < height) {
+        std::vector<std::pair<block, std::vector<transaction>>> blocks;
+        for (uint64_t h = index.height(); h < height && blocks.size() < BATCH_SIZE; h++) {
+            auto& [blk, txs] = blocks.emplace_back(
+                    db.get_block_from_height(h), std::vector<transaction>{});
+            if (!blockchain.get_transactions(blk.tx_hashes, txs) ||
+                txs.size() != blk.tx_hashes.size())
+                throw oxen::traced<std::runtime_error>{
+                        "Unable to load the transactions of block {}"_format(h)};
+        }
+        index.add_blocks(blocks);
+        if (index.height() < height)
+            log::info(globallogcat, "... indexed through height {}", index.height() - 1);
+    }
+}
+
 //-----------------------------------------------------------------------------------------------
 bool core::init_service_keys() {
     auto& keys = m_service_keys;
@@ -1213,9 +1493,17 @@ void core::start_oxenmq() {
                 std::chrono::milliseconds(500),
                 false,
                 m_pulse_thread_id);
+        // The timer above is only a fallback: Pulse schedules its own wake-ups for stage deadlines
+        // and gets kicked immediately when a new block arrives.
+        blockchain.hook_block_post_add([this](const auto&) {
+            m_omq->job([this] { pulse::main(m_quorumnet_state, *this); }, *m_pulse_thread_id);
+            prebuild_pulse_template();
+        });
         m_omq->add_timer([this]() { check_service_node_time(); }, 5s, false);
         m_omq->add_timer([this]() { check_service_node_ip_address(); }, 15min, false);
     }
+    m_periodic_tasks_thread = m_omq->add_tagged_thread("core tasks");
+    schedule_periodic_tasks(std::chrono::steady_clock::now());
     m_omq->start();
 
     // This forces an IP check after initialization instead of deferring it 15 minutes.
@@ -1227,11 +1515,13 @@ void core::deinit() {
 #ifdef ENABLE_SYSTEMD
     sd_notify(0, "STOPPING=1\nSTATUS=Shutting down");
 #endif
+    m_metrics.clear();
     if (m_quorumnet_state)
         quorumnet_delete(m_quorumnet_state);
     m_omq.reset();
     service_node_list.store();
     miner.stop();
+    m_randomx_warm_waiter.wait(&tools::threadpool::getInstance());
     mempool.deinit();
     blockchain.deinit();
 }
@@ -1311,13 +1601,15 @@ static bool is_canonical_bulletproof_layout(const std::vector<rct::Bulletproof>&
 }
 //-----------------------------------------------------------------------------------------------
 void core::parse_incoming_tx_accumulated_batch(
-        std::vector<tx_verification_batch_info>& tx_info, bool kept_by_block) {
+        std::vector<tx_verification_batch_info>& tx_info, bool kept_by_block, bool batch_admission) {
     if (kept_by_block && blockchain.is_within_compiled_block_hash_area()) {
         log::trace(logcat, "Skipping semantics check for txs kept by block in embedded hash area");
         return;
     }
 
+    auto& cache = blockchain.verification_results();
     std::vector<const rct::rctSig*> rvv;
+    std::vector<size_t> rvv_tx;
     for (size_t n = 0; n < tx_info.size(); ++n) {
         if (!tx_info[n].result || tx_info[n].already_have)
             continue;
@@ -1368,7 +1660,11 @@ void core::parse_incoming_tx_accumulated_batch(
                     tx_info[n].result = false;
                     break;
                 }
+                // Already proven, e.g. a tx being returned to the pool from a popped block
+                if (cache.have(verification_cache::semantics_key(tx_info[n].tx_hash)))
+                    break;
                 rvv.push_back(&rv);  // delayed batch verification
+                rvv_tx.push_back(n);
                 break;
             default:
                 log::error(log::Cat("verify"), "Unknown rct type: {}", (int)rv.type);
@@ -1378,16 +1674,23 @@ void core::parse_incoming_tx_accumulated_batch(
                 break;
         }
     }
-    if (!rvv.empty() && !rct::verRctSemanticsSimple(rvv)) {
+    if (!rvv.empty() && batch_admission) {
+        // Verified together with any other concurrent submissions; we get back our own results
+        auto results = m_rct_batch_verifier.verify(rvv);
+        for (size_t r = 0; r < results.size(); ++r) {
+            if (!results[r]) {
+                auto& info = tx_info[rvv_tx[r]];
+                set_semantics_failed(info.tx_hash);
+                info.tvc.m_verifivation_failed = true;
+                info.result = false;
+            }
+        }
+    } else if (!rvv.empty() && !rct::verRctSemanticsSimple(rvv)) {
         log::info(
                 logcat,
                 "One transaction among this group has bad semantics, verifying one at a time");
         const bool assumed_bad = rvv.size() == 1;  // if there's only one tx, it must be the bad one
-        for (size_t n = 0; n < tx_info.size(); ++n) {
-            if (!tx_info[n].result || tx_info[n].already_have)
-                continue;
-            if (!rct::is_rct_bulletproof(tx_info[n].tx.rct_signatures.type))
-                continue;
+        for (size_t n : rvv_tx) {
             if (assumed_bad || !rct::verRctSemanticsSimple(tx_info[n].tx.rct_signatures)) {
                 set_semantics_failed(tx_info[n].tx_hash);
                 tx_info[n].tvc.m_verifivation_failed = true;
@@ -1395,10 +1698,15 @@ void core::parse_incoming_tx_accumulated_batch(
             }
         }
     }
+
+    const uint64_t height = blockchain.get_current_blockchain_height();
+    for (size_t n : rvv_tx)
+        if (tx_info[n].result)
+            cache.add(verification_cache::semantics_key(tx_info[n].tx_hash), height);
 }
 //-----------------------------------------------------------------------------------------------
 std::vector<cryptonote::tx_verification_batch_info> core::parse_incoming_txs(
-        const std::vector<std::string>& tx_blobs, const tx_pool_options& opts) {
+        const std::vector<std::string>& tx_blobs, const tx_pool_options& opts, bool batch_admission) {
     // Caller needs to do this around both this *and* handle_parsed_txs
     // auto lock = incoming_tx_lock();
     std::vector<cryptonote::tx_verification_batch_info> tx_info(tx_blobs.size());
@@ -1407,14 +1715,20 @@ std::vector<cryptonote::tx_verification_batch_info> core::parse_incoming_txs(
     tools::threadpool::waiter waiter;
     for (size_t i = 0; i < tx_blobs.size(); i++) {
         tx_info[i].blob = &tx_blobs[i];
-        tpool.submit(&waiter, [this, &info = tx_info[i]] {
-            try {
-                parse_incoming_tx_pre(info);
-            } catch (const std::exception& e) {
-                log::error(log::Cat("verify"), "Exception in handle_incoming_tx_pre: {}", e.what());
-                info.tvc.m_verifivation_failed = true;
-            }
-        });
+        tpool.submit(
+                &waiter,
+                [this, &info = tx_info[i]] {
+                    try {
+                        parse_incoming_tx_pre(info);
+                    } catch (const std::exception& e) {
+                        log::error(
+                                log::Cat("verify"),
+                                "Exception in handle_incoming_tx_pre: {}",
+                                e.what());
+                        info.tvc.m_verifivation_failed = true;
+                    }
+                },
+                "incoming_tx_parse");
     }
     waiter.wait(&tpool);
 
@@ -1431,7 +1745,7 @@ std::vector<cryptonote::tx_verification_batch_info> core::parse_incoming_txs(
         }
     }
 
-    parse_incoming_tx_accumulated_batch(tx_info, opts.kept_by_block);
+    parse_incoming_tx_accumulated_batch(tx_info, opts.kept_by_block, batch_admission);
 
     return tx_info;
 }
@@ -1498,8 +1812,24 @@ bool core::handle_parsed_txs(
 //-----------------------------------------------------------------------------------------------
 std::vector<cryptonote::tx_verification_batch_info> core::handle_incoming_txs(
         const std::vector<std::string>& tx_blobs, const tx_pool_options& opts) {
+    if (opts.kept_by_block || !m_rct_batch_verifier.enabled()) {
+        auto lock = incoming_tx_lock();
+        auto parsed = parse_incoming_txs(tx_blobs, opts);
+        handle_parsed_txs(parsed, opts);
+        return parsed;
+    }
+
+    // Do the parsing and semantic checks *without* the incoming tx lock so that other concurrent
+    // submissions can join the same batched range proof verification.
+    auto parsed = parse_incoming_txs(tx_blobs, opts, true /*batch_admission*/);
+
     auto lock = incoming_tx_lock();
-    auto parsed = parse_incoming_txs(tx_blobs, opts);
+    // Since we weren't holding the lock something else may have added the tx in the meantime:
+    for (auto& info : parsed) {
+        if (info.result && !info.already_have &&
+            (mempool.have_tx(info.tx_hash) || blockchain.have_tx(info.tx_hash)))
+            info.already_have = true;
+    }
     handle_parsed_txs(parsed, opts);
     return parsed;
 }
@@ -1645,15 +1975,37 @@ core::parse_incoming_blinks(const std::vector<serializable_blink_metadata>& blin
         if (no_quorum)
             continue;
 
+        // Verify all the signatures together, then add the ones that passed
         std::vector<std::pair<size_t, std::string>> failures;
+        std::vector<crypto::signature_check> sig_checks;
+        std::vector<size_t> checked;
+        sig_checks.reserve(bdata.signature.size());
+        checked.reserve(bdata.signature.size());
+        auto approval_hash = blink.hash(true /*approved*/);
         for (size_t s = 0; s < bdata.signature.size(); s++) {
+            auto& quorum_validators = *validators[bdata.quorum[s]];
+            if (bdata.position[s] >= quorum_validators.size()) {
+                failures.emplace_back(s, "Invalid blink quorum position");
+                continue;
+            }
+            sig_checks.push_back(
+                    {approval_hash, quorum_validators[bdata.position[s]], bdata.signature[s]});
+            checked.push_back(s);
+        }
+        std::vector<bool> valid;
+        crypto::check_signatures(sig_checks, &valid);
+        for (size_t i = 0; i < checked.size(); i++) {
+            size_t s = checked[i];
+            if (!valid[i]) {
+                failures.emplace_back(s, "Given blink quorum signature verification failed!");
+                continue;
+            }
             try {
-                blink.add_signature(
+                blink.add_prechecked_signature(
                         static_cast<blink_tx::subquorum>(bdata.quorum[s]),
                         bdata.position[s],
                         true /*approved*/,
-                        bdata.signature[s],
-                        validators[bdata.quorum[s]]->at(bdata.position[s]));
+                        bdata.signature[s]);
             } catch (const std::exception& e) {
                 failures.emplace_back(s, e.what());
             }
@@ -1922,10 +2274,7 @@ bool core::is_key_image_spent(const crypto::key_image& key_image) const {
 //-----------------------------------------------------------------------------------------------
 bool core::are_key_images_spent(
         const std::vector<crypto::key_image>& key_im, std::vector<bool>& spent) const {
-    spent.clear();
-    for (auto& ki : key_im) {
-        spent.push_back(blockchain.have_tx_keyimg_as_spent(ki));
-    }
+    spent = blockchain.have_key_images_as_spent(key_im);
     return true;
 }
 //-----------------------------------------------------------------------------------------------
@@ -2022,8 +2371,10 @@ std::optional<std::tuple<int64_t, int64_t, int64_t>> core::get_coinbase_tx_sum(
         }
     }
 
+    // The blocks get read and parsed ahead of us on other threads, leaving this one just the
+    // summing (and tx lookups) to do.
     const uint64_t end = start_offset + count - 1;
-    blockchain.for_blocks_range(
+    blockchain.db().for_blocks_range_parallel(
             start_offset,
             end,
             [this, &cache_to, &result, &cache_build_started](
@@ -2063,7 +2414,8 @@ std::optional<std::tuple<int64_t, int64_t, int64_t>> core::get_coinbase_tx_sum(
                     cache_to = 0;
                 }
                 return true;
-            });
+            },
+            true /*ordered*/);
 
     return result;
 }
@@ -2152,6 +2504,13 @@ bool core::submit_uptime_proof() {
 //-----------------------------------------------------------------------------------------------
 bool core::handle_uptime_proof(
         const NOTIFY_BTENCODED_UPTIME_PROOF::request& req, bool& my_uptime_proof_confirmation) {
+    // Each proof reaches us many times as it gets relayed around the network, so drop the copies of
+    // ones we have already verified before doing any parsing or signature checking.
+    if (service_node_list.uptime_proof_seen(crypto::keccak(req.proof))) {
+        log::trace(logcat, "Ignoring already-seen uptime proof");
+        return false;
+    }
+
     std::unique_ptr<uptime_proof::Proof> proof;
     try {
         proof = std::make_unique<uptime_proof::Proof>(
@@ -2577,9 +2936,16 @@ Use "help <command>" to see a command's documentation.
         m_starter_message_showed = true;
     }
 
+    return true;
+}
+//-----------------------------------------------------------------------------------------------
+void core::run_periodic_tasks() {
     m_txpool_auto_relayer.do_call([this] { return relay_txpool_transactions(); });
     m_service_node_vote_relayer.do_call([this] { return relay_service_node_votes(); });
     m_check_disk_space_interval.do_call([this] { return check_disk_space(); });
+    m_db_map_size_interval.do_call([this] { return maintain_db_map_size(); });
+    if (m_pulse_thread_id)
+        m_pulse_template_interval.do_call([this] { return prebuild_pulse_template(); });
     m_sn_proof_cleanup_interval.do_call([&snl = service_node_list] {
         snl.cleanup_proofs();
         return true;
@@ -2595,6 +2961,8 @@ Use "help <command>" to see a command's documentation.
 
     m_blockchain_pruning_interval.do_call(
             [this] { return blockchain.update_blockchain_pruning(); });
+    if (m_background_pruning)
+        m_background_pruning_interval.do_call([this] { return prune_blockchain_step(); });
     miner.on_idle();
     mempool.on_idle();
 
@@ -2603,6 +2971,71 @@ Use "help <command>" to see a command's documentation.
             [this] { sd_notify(0, ("WATCHDOG=1\nSTATUS=" + get_status_string()).c_str()); });
 #endif
 
+    auto due = std::min(miner.next_idle_due(), mempool.next_idle_due());
+    for (const auto* task :
+         {&m_txpool_auto_relayer,
+          &m_service_node_vote_relayer,
+          &m_check_disk_space_interval,
+          &m_db_map_size_interval,
+          &m_sn_proof_cleanup_interval,
+          &m_blockchain_pruning_interval})
+        due = std::min(due, task->next_due());
+    if (m_pulse_thread_id)
+        due = std::min(due, m_pulse_template_interval.next_due());
+    if (m_service_node)
+        due = std::min(due, m_check_uptime_proof_interval.next_due());
+    if (m_background_pruning)
+        due = std::min(due, m_background_pruning_interval.next_due());
+#ifdef ENABLE_SYSTEMD
+    due = std::min(due, m_systemd_notify_interval.next_due());
+#endif
+    schedule_periodic_tasks(due);
+}
+//-----------------------------------------------------------------------------------------------
+void core::schedule_periodic_tasks(std::chrono::steady_clock::time_point due) {
+    // We still wake up at least once a second: some tasks only become eligible (e.g. uptime proofs
+    // after the startup delay) or get reset() by other threads in between their deadlines.
+    auto now = std::chrono::steady_clock::now();
+    auto delay = due <= now ? 10ms : std::chrono::ceil<std::chrono::milliseconds>(due - now);
+    m_omq->add_timer(
+            m_periodic_tasks_timer,
+            [this] {
+                m_omq->cancel_timer(m_periodic_tasks_timer);
+                run_periodic_tasks();
+            },
+            std::clamp<std::chrono::milliseconds>(delay, 10ms, 1s),
+            true /*squelch*/,
+            m_periodic_tasks_thread);
+}
+//-----------------------------------------------------------------------------------------------
+bool core::maintain_db_map_size() {
+    // Only when nothing is being written; we'll get another chance next time if it's busy.
+    std::unique_lock lock{blockchain, std::try_to_lock};
+    if (!lock)
+        return true;
+    try {
+        blockchain.db().maintain_map_size();
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to grow the blockchain database map: {}", e.what());
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------------------------
+bool core::prebuild_pulse_template() {
+    if (blockchain.get_network_version() < feature::PULSE)
+        return true;
+    // The first round's producer is the block leader; later rounds' producers are picked from the
+    // quorum only once the first round fails, which we don't try to anticipate.
+    auto leader = service_node_list.get_next_block_leader();
+    if (leader.key != m_service_keys.pub)
+        return true;
+    m_omq->job([this, leader = std::move(leader)] {
+        try {
+            blockchain.prebuild_pulse_block_template(leader);
+        } catch (const std::exception& e) {
+            log::warning(logcat, "Failed to pre-build a Pulse block template: {}", e.what());
+        }
+    });
     return true;
 }
 //-----------------------------------------------------------------------------------------------
@@ -2617,6 +3050,23 @@ bool core::check_disk_space() {
     return true;
 }
 //-----------------------------------------------------------------------------------------------
+bool core::prune_blockchain_step() {
+    // Small enough that each step only holds the blockchain lock (and the db write lock) briefly
+    constexpr size_t PRUNE_STEP_TXS = 1000;
+
+    double progress = blockchain.prune_blockchain_step(PRUNE_STEP_TXS);
+    if (progress >= 1.0) {
+        log::info(logcat, "Blockchain pruning complete");
+        m_background_pruning = false;
+        return true;
+    }
+    if (int percent = progress * 100; percent != m_background_pruning_logged) {
+        log::info(logcat, "Pruning blockchain: {}% done", percent);
+        m_background_pruning_logged = percent;
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------------------------
 void core::flush_bad_txs_cache() {
     bad_semantics_txes_lock.lock();
     for (int idx = 0; idx < 2; ++idx)
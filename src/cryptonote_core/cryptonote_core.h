@@ -27,9 +27,11 @@
 #include <mutex>
 
 #include "blockchain.h"
+#include "blockchain_db/sqlite/address_activity.h"
 #include "bls/bls_aggregator.h"
 #include "common/command_line.h"
 #include "common/exception.h"
+#include "common/metrics.h"
 #include "crypto/crypto.h"
 #include "crypto/hash.h"
 #include "cryptonote_basic/connection_context.h"
@@ -40,6 +42,7 @@
 #include "epee/storages/portable_storage_template_helper.h"
 #include "epee/warnings.h"
 #include "pulse.h"
+#include "rct_batch_verifier.h"
 #include "service_node_list.h"
 #include "service_node_quorum_cop.h"
 #include "service_node_voting.h"
@@ -58,6 +61,9 @@ extern const command_line::arg_descriptor<difficulty_type> arg_fixed_difficulty;
 extern const command_line::arg_flag arg_dev_allow_local;
 extern const command_line::arg_flag arg_offline;
 extern const command_line::arg_descriptor<size_t> arg_block_download_max_size;
+extern const command_line::arg_descriptor<size_t> arg_block_download_max_spans;
+extern const command_line::arg_descriptor<size_t> arg_block_download_max_memory;
+extern const command_line::arg_descriptor<size_t> arg_block_sync_size;
 
 // Function pointers that are set to throwing stubs and get replaced by the actual functions in
 // cryptonote_protocol/quorumnet.cpp's quorumnet::init_core_callbacks().  This indirection is here
@@ -126,14 +132,24 @@ class core final {
     core& operator=(const core&) = delete;
 
     /**
-     * @brief calls various idle routines
+     * @brief called from the p2p idle loop; shows the startup message the first time.
      *
-     * @note see miner::on_idle and tx_memory_pool::on_idle
+     * The periodic maintenance work runs separately, in run_periodic_tasks().
      *
      * @return true
      */
     bool on_idle();
 
+    /**
+     * @brief runs whichever periodic maintenance tasks are due: pool and vote relaying, disk space
+     * and db map size checks, pruning, uptime proofs, and the miner's and tx pool's idle work
+     * (see miner::on_idle and tx_memory_pool::on_idle).
+     *
+     * This runs from a timer on its own oxenmq thread (set up by start_oxenmq()), which it re-arms
+     * for the next task's deadline, so is not held up by (or holding up) the p2p loop.
+     */
+    void run_periodic_tasks();
+
     /**
      * @brief handles an incoming uptime proof that is encoded using B-encoding
      *
@@ -177,10 +193,17 @@ class core final {
      * vector: THE CALLER MUST ENSURE THE BLOBS PERSIST UNTIL THE RETURNED VECTOR IS PASSED OFF TO
      * HANDLE_INCOMING_TXS()!
      *
+     * @param batch_admission if true then bulletproof txes are verified through the shared
+     * admission queue (see rct_batch_verifier) so that they can be batched with txes submitted by
+     * other threads.  This waits for the batch window, and so must *not* be used while holding
+     * m_incoming_tx_lock (which means the caller has to recheck `already_have` after taking it).
+     *
      * @return vector of tx_verification_batch_info structs for the given transactions.
      */
     std::vector<cryptonote::tx_verification_batch_info> parse_incoming_txs(
-            const std::vector<std::string>& tx_blobs, const tx_pool_options& opts);
+            const std::vector<std::string>& tx_blobs,
+            const tx_pool_options& opts,
+            bool batch_admission = false);
 
     /**
      * @brief handles parsed incoming transactions
@@ -216,7 +239,10 @@ class core final {
     /**
      * Wrapper that does a parse + handle when nothing is needed between the parsing the handling.
      *
-     * Both operations are performed under the required incoming transaction lock.
+     * Both operations are performed under the required incoming transaction lock, except when
+     * admission batching is enabled (--tx-batch-verify-window) for relayed/submitted txes: then the
+     * parsing and semantic checks happen before taking the lock so that concurrent submissions can
+     * share one batched range proof verification.
      *
      * @param tx_blobs see parse_incoming_txs
      * @param opts tx pool options for accepting these transactions
@@ -439,6 +465,10 @@ class core final {
     /// Returns a reference to the Ethereum L2 tracking object
     eth::L2Tracker& l2_tracker() { return *m_l2_tracker; }
 
+    /// Returns the address activity index, or nullptr if it isn't enabled (with
+    /// --address-activity-index).
+    AddressActivityDB* address_activity_db() { return m_address_activity.get(); }
+
     /// Returns a reference to the OxenMQ object.  Must not be called before init(), and should not
     /// be used for any omq communication until after start_oxenmq() has been called.
     oxenmq::OxenMQ& omq() { return *m_omq; }
@@ -724,7 +754,9 @@ class core final {
 
     void parse_incoming_tx_pre(tx_verification_batch_info& tx_info);
     void parse_incoming_tx_accumulated_batch(
-            std::vector<tx_verification_batch_info>& tx_info, bool kept_by_block);
+            std::vector<tx_verification_batch_info>& tx_info,
+            bool kept_by_block,
+            bool batch_admission = false);
 
     /**
      * @brief act on a set of command line options given
@@ -770,6 +802,29 @@ class core final {
      */
     bool check_disk_space();
 
+    /**
+     * @brief grows the blockchain database map ahead of need, if the blockchain isn't busy
+     *
+     * @return true
+     */
+    bool maintain_db_map_size();
+
+    /**
+     * @brief if we'll be the producer of the next block's first Pulse round, queues a job to build
+     * its block template ahead of time (if the one already built is no longer current)
+     *
+     * @return true
+     */
+    bool prebuild_pulse_template();
+
+    /**
+     * @brief prunes the next few transactions of the blockchain, if background pruning is on, and
+     * reports the progress so far
+     *
+     * @return true on success, false otherwise
+     */
+    bool prune_blockchain_step();
+
     /**
      * @brief Initializes service keys by loading or creating.  An Ed25519 key (from which we also
      * get an x25519 key) is always created; the Monero SN keypair is only created when running in
@@ -780,6 +835,10 @@ class core final {
      */
     bool init_service_keys();
 
+    /// Brings the address activity index up to the block at `height - 1`, indexing the blocks it
+    /// is missing from the blockchain database.
+    void sync_address_activity(uint64_t height);
+
     /**
      * Checks the given x25519 pubkey against the configured access lists and, if allowed, returns
      * the access level; otherwise returns `denied`.
@@ -844,6 +903,17 @@ class core final {
      */
     bool check_block_rate();
 
+    /*
+     * @brief registers the tx pool and service node list metrics
+     */
+    void register_metrics();
+
+    /*
+     * @brief starts building the RandomX cache for the next block in the background, if it looks
+     * like it will need one
+     */
+    void warm_randomx_cache();
+
     bool m_test_drop_download = true;  //!< whether or not to drop incoming blocks (for testing)
 
     uint64_t m_test_drop_download_height =
@@ -853,6 +923,8 @@ class core final {
 
     std::unique_ptr<eth::L2Tracker> m_l2_tracker;
 
+    std::unique_ptr<AddressActivityDB> m_address_activity;
+
     std::unique_ptr<eth::bls_aggregator> m_bls_aggregator;
 
     i_cryptonote_protocol* m_pprotocol;        //!< cryptonote protocol instance
@@ -868,15 +940,24 @@ class core final {
     std::mutex m_sn_timestamp_mutex;
     service_nodes::participation_history<service_nodes::timesync_entry, 30> m_sn_times;
 
+    /// Callback gauges for the tx pool and service node list, registered by init()
+    std::vector<tools::metrics::callback_handle> m_metrics;
+
     /// interval for checking re-relaying txpool transactions
     tools::periodic_task m_txpool_auto_relayer{"pool relay", 2min, false};
     /// interval for checking for disk space
     tools::periodic_task m_check_disk_space_interval{"disk space checker", 10min};
+    /// interval for growing the blockchain db map ahead of need
+    tools::periodic_task m_db_map_size_interval{"db map size", 1min};
+    /// interval for refreshing the pre-built Pulse block template with new pool txes
+    tools::periodic_task m_pulse_template_interval{"pulse template", 5s};
     /// interval for checking our own uptime proof; starts low, but will be set to
     /// get_net_config().UPTIME_PROOF_CHECK_INTERVAL after the first proof goes out.
     tools::periodic_task m_check_uptime_proof_interval{"uptime proof", 30s};
     /// interval for incremental blockchain pruning
     tools::periodic_task m_blockchain_pruning_interval{"pruning interval", 5h};
+    /// interval for pruning the next part of the blockchain while background pruning is running
+    tools::periodic_task m_background_pruning_interval{"background pruning", 5s};
     /// interval for when we re-relay service node votes
     tools::periodic_task m_service_node_vote_relayer{"vote relay", 2min, false};
     /// interval for when we drop expired uptime proofs
@@ -887,6 +968,12 @@ class core final {
     /// has the "daemon will sync now" message been shown?
     std::atomic<bool> m_starter_message_showed;
 
+    /// set while the blockchain is being pruned from run_periodic_tasks(); cleared once fully
+    /// pruned
+    bool m_background_pruning = false;
+    /// the pruning progress last logged, in whole percent
+    int m_background_pruning_logged = -1;
+
     uint64_t m_target_blockchain_height;  //!< blockchain height target
 
     network_type m_nettype;  //!< which network are we on?
@@ -924,6 +1011,12 @@ class core final {
     std::unordered_set<crypto::hash> bad_semantics_txes[2];
     std::mutex bad_semantics_txes_lock;
 
+    /// Cross-submission batching of the bulletproof checks of incoming txes
+    rct_batch_verifier m_rct_batch_verifier;
+
+    /// The background RandomX cache build started by warm_randomx_cache()
+    tools::threadpool::waiter m_randomx_warm_waiter;
+
     bool m_offline;
     bool m_pad_transactions;
     bool m_has_ip_check_disabled;
@@ -939,6 +1032,12 @@ class core final {
     } m_coinbase_cache;
 
     std::optional<oxenmq::TaggedThreadID> m_pulse_thread_id;
+
+    /// thread and timer that run_periodic_tasks() runs on
+    std::optional<oxenmq::TaggedThreadID> m_periodic_tasks_thread;
+    oxenmq::TimerID m_periodic_tasks_timer;
+    /// arms the timer to run run_periodic_tasks() at `due`, or in a second at the latest
+    void schedule_periodic_tasks(std::chrono::steady_clock::time_point due);
 };
 }  // namespace cryptonote
 
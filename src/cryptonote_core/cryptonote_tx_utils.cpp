@@ -30,6 +30,9 @@
 
 #include "cryptonote_tx_utils.h"
 
+#include <oxenc/endian.h>
+
+#include <cstring>
 #include <random>
 #include <unordered_set>
 
@@ -1353,6 +1356,19 @@ randomx_longhash_context::randomx_longhash_context(
     }
 }
 
+std::optional<crypto::cn_slow_hash_type> get_block_cn_hash_type(
+        cryptonote::network_type nettype, hf hf_version) {
+    if (nettype == network_type::FAKECHAIN)
+        return cn_slow_hash_type::turtle_lite_v2;
+    if (hf_version >= hf::hf12_checkpointing)
+        return std::nullopt;
+    if (hf_version >= hf::hf11_infinite_staking)
+        return cn_slow_hash_type::turtle_lite_v2;
+    if (hf_version >= hf::hf7)
+        return cn_slow_hash_type::heavy_v2;
+    return cn_slow_hash_type::heavy_v1;
+}
+
 crypto::hash get_block_longhash(
         cryptonote::network_type nettype,
         randomx_longhash_context const& randomx_context,
@@ -1361,32 +1377,19 @@ crypto::hash get_block_longhash(
         int miners) {
     crypto::hash result{};
     const auto bd = get_block_hashing_blob(b);
-    const auto hf_version = b.major_version;
 
-    crypto::cn_slow_hash_type cn_type = cn_slow_hash_type::heavy_v1;
-    if (nettype == network_type::FAKECHAIN) {
-        cn_type = cn_slow_hash_type::turtle_lite_v2;
-    } else {
-        if (hf_version >= hf::hf12_checkpointing) {
-            rx_slow_hash(
-                    randomx_context.current_blockchain_height,
-                    randomx_context.seed_height,
-                    randomx_context.seed_block_hash.data(),
-                    bd.data(),
-                    bd.size(),
-                    result.data(),
-                    miners,
-                    0);
-            return result;
-        }
-
-        if (hf_version >= hf::hf11_infinite_staking)
-            cn_type = cn_slow_hash_type::turtle_lite_v2;
-        else if (hf_version >= hf::hf7)
-            cn_type = crypto::cn_slow_hash_type::heavy_v2;
-    }
-
-    crypto::cn_slow_hash(bd.data(), bd.size(), result, cn_type);
+    if (auto cn_type = get_block_cn_hash_type(nettype, b.major_version))
+        crypto::cn_slow_hash(bd.data(), bd.size(), result, *cn_type);
+    else
+        rx_slow_hash(
+                randomx_context.current_blockchain_height,
+                randomx_context.seed_height,
+                randomx_context.seed_block_hash.data(),
+                bd.data(),
+                bd.size(),
+                result.data(),
+                miners,
+                0);
     return result;
 }
 
@@ -1398,9 +1401,77 @@ crypto::hash get_block_longhash_w_blockchain(
         int miners) {
     crypto::hash result = get_block_longhash(
             nettype, randomx_longhash_context(pbc, b, height), b, height, miners);
+
+    // When verifying with full datasets get the next seed's one built as soon as its seed block
+    // exists, so that it is ready by the time blocks switch to it.
+    if (pbc && !miners && nettype != network_type::FAKECHAIN &&
+        b.major_version >= hf::hf12_checkpointing && rx_fast_verify_enabled()) {
+        uint64_t seed_height, next_height;
+        rx_seedheights(height, &seed_height, &next_height);
+        if (next_height != seed_height)
+            rx_fast_prepare(
+                    next_height, pbc->get_pending_block_id_by_height(next_height).data());
+    }
     return result;
 }
 
+void get_block_longhashes(
+        cryptonote::network_type nettype,
+        const Blockchain* pbc,
+        const block& b,
+        uint64_t height,
+        int miners,
+        std::span<const uint32_t> nonces,
+        std::span<crypto::hash> hashes) {
+    assert(hashes.size() >= nonces.size());
+    if (nonces.empty())
+        return;
+
+    // The nonce is a fixed-width field of the header, so find where it lands in the hashing blob by
+    // seeing where two headers differing only in every bit of the nonce first differ.
+    block_header header = b;
+    std::string const header_blob = t_serializable_object_to_blob(header);
+    header.nonce = ~header.nonce;
+    std::string const flipped_blob = t_serializable_object_to_blob(header);
+    size_t const nonce_pos =
+            std::mismatch(header_blob.begin(), header_blob.end(), flipped_blob.begin()).first -
+            header_blob.begin();
+    CHECK_AND_ASSERT_THROW_MES(
+            nonce_pos + sizeof(uint32_t) <= header_blob.size(),
+            "Unable to locate the nonce in the block hashing blob");
+
+    std::string bd = get_block_hashing_blob(b);
+    auto set_nonce = [nonce_pos](std::string& blob, uint32_t nonce) {
+        nonce = oxenc::host_to_little(nonce);
+        std::memcpy(blob.data() + nonce_pos, &nonce, sizeof(nonce));
+    };
+
+    if (auto cn_type = get_block_cn_hash_type(nettype, b.major_version)) {
+        std::vector<std::string> blobs(nonces.size(), bd);
+        std::vector<std::string_view> views(nonces.size());
+        for (size_t i = 0; i < nonces.size(); i++) {
+            set_nonce(blobs[i], nonces[i]);
+            views[i] = blobs[i];
+        }
+        crypto::cn_slow_hash(views, hashes, *cn_type);
+        return;
+    }
+
+    randomx_longhash_context const randomx_context{pbc, b, height};
+    for (size_t i = 0; i < nonces.size(); i++) {
+        set_nonce(bd, nonces[i]);
+        rx_slow_hash(
+                randomx_context.current_blockchain_height,
+                randomx_context.seed_height,
+                randomx_context.seed_block_hash.data(),
+                bd.data(),
+                bd.size(),
+                hashes[i].data(),
+                miners,
+                0);
+    }
+}
+
 void get_block_longhash_reorg(const uint64_t split_height) {
     rx_reorg(split_height);
 }
@@ -33,6 +33,7 @@
 
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
+#include <span>
 
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/verification_context.h"
@@ -369,6 +370,10 @@ struct randomx_longhash_context {
 };
 
 class Blockchain;
+// Returns the CryptoNight variant used for the proof-of-work of blocks with the given version, or
+// std::nullopt if they use RandomX.
+std::optional<crypto::cn_slow_hash_type> get_block_cn_hash_type(
+        cryptonote::network_type nettype, hf hf_version);
 crypto::hash get_block_longhash(
         cryptonote::network_type nettype,
         randomx_longhash_context const& randomx_context,
@@ -386,6 +391,17 @@ crypto::hash get_block_longhash_w_blockchain(
         const block& b,
         uint64_t height,
         int miners);
+// Computes the PoW hashes of copies of `b` that differ only in their nonce, writing the hash for
+// `nonces[i]` into `hashes[i]` (which must be at least as long as `nonces`), for mining.  The
+// hashing blob and RandomX seed are worked out once for the whole batch rather than once per nonce.
+void get_block_longhashes(
+        cryptonote::network_type nettype,
+        const Blockchain* pb,
+        const block& b,
+        uint64_t height,
+        int miners,
+        std::span<const uint32_t> nonces,
+        std::span<crypto::hash> hashes);
 void get_block_longhash_reorg(const uint64_t split_height);
 
 }  // namespace cryptonote
@@ -15,7 +15,7 @@ namespace eth {
 
 template <std::derived_from<event::L2StateChange> Event>
 bool extract_event(const cryptonote::transaction& tx, Event& evt, std::string* fail_reason) {
-    if (cryptonote::get_field_from_tx_extra(tx.extra, evt))
+    if (cryptonote::get_field_from_tx_extra(tx, evt))
         return true;
     if (fail_reason)
         *fail_reason =
@@ -24,6 +24,7 @@
 #include "cryptonote_basic/tx_extra.h"
 #include "cryptonote_config.h"
 #include "cryptonote_core/blockchain.h"
+#include "logging/trace.h"
 #include "oxen_economy.h"
 
 extern "C" {
@@ -1427,32 +1428,44 @@ static bool validate_against_previous_mapping(
 // Sanity check value to disallow the empty name hash
 static const crypto::hash null_name_hash = name_to_hash("");
 
+bool parse_ons_tx(
+        cryptonote::transaction const& tx,
+        cryptonote::tx_extra_oxen_name_system& entry,
+        std::string* reason) {
+    if (check_condition(
+                tx.type != cryptonote::txtype::oxen_name_system,
+                reason,
+                "{} uses wrong tx type, expected={}",
+                tx,
+                cryptonote::txtype::oxen_name_system))
+        return false;
+
+    if (check_condition(
+                !cryptonote::get_field_from_tx_extra(tx, entry),
+                reason,
+                "{} didn't have oxen name service in the tx_extra",
+                tx))
+        return false;
+
+    return true;
+}
+
 bool name_system_db::validate_ons_tx(
         hf hf_version,
         uint64_t blockchain_height,
         cryptonote::transaction const& tx,
         cryptonote::tx_extra_oxen_name_system& ons_extra,
         std::string* reason) {
-    // -----------------------------------------------------------------------------------------------
-    // Pull out ONS Extra from TX
-    // -----------------------------------------------------------------------------------------------
-    {
-        if (check_condition(
-                    tx.type != cryptonote::txtype::oxen_name_system,
-                    reason,
-                    "{} uses wrong tx type, expected={}",
-                    tx,
-                    cryptonote::txtype::oxen_name_system))
-            return false;
-
-        if (check_condition(
-                    !cryptonote::get_field_from_tx_extra(tx.extra, ons_extra),
-                    reason,
-                    "{} didn't have oxen name service in the tx_extra",
-                    tx))
-            return false;
-    }
+    return parse_ons_tx(tx, ons_extra, reason) &&
+           validate_parsed_ons_tx(hf_version, blockchain_height, tx, ons_extra, reason);
+}
 
+bool name_system_db::validate_parsed_ons_tx(
+        hf hf_version,
+        uint64_t blockchain_height,
+        cryptonote::transaction const& tx,
+        cryptonote::tx_extra_oxen_name_system const& ons_extra,
+        std::string* reason) {
     // -----------------------------------------------------------------------------------------------
     // Check TX ONS Serialized Fields are NULL if they are not specified
     // -----------------------------------------------------------------------------------------------
@@ -1913,6 +1926,27 @@ std::optional<cryptonote::address_parse_info> mapping_value::get_wallet_address_
 
 namespace {
 
+    // Indices that block processing doesn't use itself, and so which bulk ingests can drop and
+    // rebuild (much more cheaply) once they finish.
+    char constexpr DEFERRABLE_INDICES_SQL[] = R"(
+CREATE INDEX IF NOT EXISTS owner_id_index ON mappings(owner_id);
+CREATE INDEX IF NOT EXISTS backup_owner_index ON mappings(backup_owner_id);
+CREATE INDEX IF NOT EXISTS mapping_type_name_exp ON mappings (type, name_hash, expiration_height DESC);
+)";
+    char constexpr DROP_DEFERRABLE_INDICES_SQL[] =
+            "DROP INDEX IF EXISTS owner_id_index; DROP INDEX IF EXISTS backup_owner_index; DROP "
+            "INDEX IF EXISTS mapping_type_name_exp";
+
+    bool exec_sql(name_system_db& ons_db, const char* sql, std::string_view what) {
+        char* sql_err = nullptr;
+        if (sqlite3_exec(ons_db.db, sql, nullptr, nullptr, &sql_err) != SQLITE_OK) {
+            log::error(logcat, "Failed to {} in ONS DB, reason={}", what, sql_err ? sql_err : "??");
+            sqlite3_free(sql_err);
+            return false;
+        }
+        return true;
+    }
+
     bool build_default_tables(name_system_db& ons_db) {
         std::string mappings_columns = R"(
     id INTEGER PRIMARY KEY NOT NULL,
@@ -1942,12 +1976,9 @@ CREATE TABLE IF NOT EXISTS settings (
 
 CREATE TABLE IF NOT EXISTS mappings ()" + mappings_columns +
                                             R"();
-CREATE INDEX IF NOT EXISTS owner_id_index ON mappings(owner_id);
 DROP INDEX IF EXISTS backup_owner_id_index;
-CREATE INDEX IF NOT EXISTS backup_owner_index ON mappings(backup_owner_id);
 CREATE UNIQUE INDEX IF NOT EXISTS name_type_update ON mappings (name_hash, type, update_height DESC);
-CREATE INDEX IF NOT EXISTS mapping_type_name_exp ON mappings (type, name_hash, expiration_height DESC);
-)";
+)" + DEFERRABLE_INDICES_SQL;
 
         char* table_err_msg = nullptr;
         int table_created = sqlite3_exec(
@@ -2111,6 +2142,15 @@ FROM mappings
 
     constexpr auto EXPIRATION = " (expiration_height IS NULL OR expiration_height >= ?) "sv;
 
+    // Owner lookups go through the owner ids rather than filtering on the joined addresses, so
+    // that the owner address index (which covers the id) and the mappings owner id indices find
+    // the rows directly instead of scanning every mapping.
+    constexpr auto SQL_WHERE_OWNER =
+            "WHERE (mappings.owner_id IN (SELECT id FROM owner WHERE address IN ("sv;
+    constexpr auto SQL_OR_BACKUP_OWNER =
+            ")) OR mappings.backup_owner_id IN (SELECT id FROM owner WHERE address IN ("sv;
+    constexpr auto SQL_OWNER_SUFFIX = ")))"sv;
+
 }  // namespace
 
 bool name_system_db::init(
@@ -2121,7 +2161,9 @@ bool name_system_db::init(
     this->nettype = nettype;
 
     std::string const GET_MAPPINGS_BY_OWNER_STR = sql_select_mappings_and_owners_prefix +
-                                                  "WHERE ? IN (o1.address, o2.address)" +
+                                                  std::string{SQL_WHERE_OWNER} + "?" +
+                                                  std::string{SQL_OR_BACKUP_OWNER} + "?" +
+                                                  std::string{SQL_OWNER_SUFFIX} +
                                                   sql_select_mappings_and_owners_suffix;
     std::string const GET_MAPPING_STR = sql_select_mappings_and_owners_prefix +
                                         "WHERE type = ? AND name_hash = ?" +
@@ -2512,24 +2554,39 @@ SELECT                type, name_hash, ?,    ?)";
 }  // namespace
 
 bool name_system_db::add_block(
-        const cryptonote::block& block, const std::vector<cryptonote::transaction>& txs) {
+        const cryptonote::block& block,
+        const std::vector<cryptonote::transaction>& txs,
+        std::span<const std::optional<cryptonote::tx_extra_oxen_name_system>> parsed) {
+    OXEN_TRACE_SPAN(logcat, "ons::add_block");
     uint64_t height = block.get_height();
     if (last_processed_height >= height)
         return true;
 
-    scoped_db_transaction db_transaction(*this);
-    if (!db_transaction)
-        return false;
+    // In bulk ingest mode we are already inside the bulk transaction
+    std::optional<scoped_db_transaction> db_transaction;
+    if (!bulk_ingest) {
+        db_transaction.emplace(*this);
+        if (!*db_transaction)
+            return false;
+    }
 
     bool ons_parsed_from_block = false;
     if (block.major_version >= hf::hf15_ons) {
-        for (cryptonote::transaction const& tx : txs) {
+        for (size_t i = 0; i < txs.size(); i++) {
+            cryptonote::transaction const& tx = txs[i];
             if (tx.type != cryptonote::txtype::oxen_name_system)
                 continue;
 
             cryptonote::tx_extra_oxen_name_system entry = {};
             std::string fail_reason;
-            if (!validate_ons_tx(block.major_version, height, tx, entry, &fail_reason)) {
+            bool valid;
+            if (i < parsed.size() && parsed[i]) {
+                entry = *parsed[i];
+                valid = validate_parsed_ons_tx(
+                        block.major_version, height, tx, entry, &fail_reason);
+            } else
+                valid = validate_ons_tx(block.major_version, height, tx, entry, &fail_reason);
+            if (!valid) {
                 log::error(
                         logcat,
                         "ONS TX: Failed to validate for tx={}. This should have failed validation "
@@ -2542,8 +2599,13 @@ bool name_system_db::add_block(
             }
 
             crypto::hash const& tx_hash = cryptonote::get_transaction_hash(tx);
-            if (!add_ons_entry(*this, height, entry, tx_hash))
+            uncache_mapping(entry.type, hash_to_base64(entry.name_hash));
+            if (!add_ons_entry(*this, height, entry, tx_hash)) {
+                // The transaction gets rolled back, but lookups in the meantime could have cached
+                // the partially applied block.
+                clear_mapping_cache();
                 return false;
+            }
 
             ons_parsed_from_block = true;
         }
@@ -2551,13 +2613,77 @@ bool name_system_db::add_block(
 
     last_processed_height = height;
     last_processed_hash = cryptonote::get_block_hash(block);
-    if (ons_parsed_from_block) {
+    // Bulk ingests save the settings when they commit
+    if (ons_parsed_from_block && db_transaction) {
         save_settings(last_processed_height, last_processed_hash, static_cast<int>(DB_VERSION));
-        db_transaction.commit = ons_parsed_from_block;
+        db_transaction->commit = ons_parsed_from_block;
     }
     return true;
 }
 
+bool name_system_db::begin_bulk_ingest(bool defer_indices) {
+    if (bulk_ingest || transaction_begun) {
+        log::error(logcat, "Cannot begin ONS bulk ingest: a transaction is already active");
+        return false;
+    }
+    if (!exec_sql(*this, "BEGIN;", "begin bulk ingest transaction"))
+        return false;
+    transaction_begun = true;
+    bulk_ingest = true;
+    bulk_committed_height = last_processed_height;
+    bulk_committed_hash = last_processed_hash;
+
+    // Dropping the indices is transactional, so a rollback brings them back; a crash after a
+    // commit leaves them to be recreated by build_default_tables on the next startup.
+    if (defer_indices && exec_sql(*this, DROP_DEFERRABLE_INDICES_SQL, "drop deferrable indices"))
+        bulk_deferred_indices = true;
+    return true;
+}
+
+bool name_system_db::bulk_commit() {
+    if (!bulk_ingest)
+        return false;
+    if (last_processed_height != bulk_committed_height)
+        save_settings(last_processed_height, last_processed_hash, static_cast<int>(DB_VERSION));
+    if (!exec_sql(*this, "END;", "commit bulk ingest transaction")) {
+        end_bulk_ingest(false);
+        return false;
+    }
+    bulk_committed_height = last_processed_height;
+    bulk_committed_hash = last_processed_hash;
+    if (!exec_sql(*this, "BEGIN;", "begin bulk ingest transaction")) {
+        transaction_begun = false;
+        end_bulk_ingest();
+        return false;
+    }
+    return true;
+}
+
+void name_system_db::end_bulk_ingest(bool commit) {
+    if (!bulk_ingest)
+        return;
+    bulk_ingest = false;
+
+    if (transaction_begun) {
+        if (commit && last_processed_height != bulk_committed_height)
+            save_settings(last_processed_height, last_processed_hash, static_cast<int>(DB_VERSION));
+        if (commit && !exec_sql(*this, "END;", "commit bulk ingest transaction"))
+            commit = false;
+        if (!commit) {
+            exec_sql(*this, "ROLLBACK;", "roll back bulk ingest transaction");
+            last_processed_height = bulk_committed_height;
+            last_processed_hash = bulk_committed_hash;
+            clear_mapping_cache();
+        }
+        transaction_begun = false;
+    }
+
+    if (bulk_deferred_indices) {
+        bulk_deferred_indices = false;
+        exec_sql(*this, DEFERRABLE_INDICES_SQL, "rebuild deferred indices");
+    }
+}
+
 struct ons_update_history {
     uint64_t value_last_update_height = static_cast<uint64_t>(-1);
     uint64_t owner_last_update_height = static_cast<uint64_t>(-1);
@@ -2644,6 +2770,7 @@ bool name_system_db::save_settings(uint64_t top_height, crypto::hash const& top_
 }
 
 bool name_system_db::prune_db(uint64_t height) {
+    clear_mapping_cache();
     if (!bind_and_run(ons_sql_type::pruning, prune_mappings_sql, nullptr, height))
         return false;
     if (!sql_run_statement(ons_sql_type::pruning, prune_owners_sql, nullptr))
@@ -2685,12 +2812,31 @@ bool name_system_db::get_wallet_mapping(
     return false;
 }
 
-mapping_record name_system_db::get_mapping(
-        mapping_type type,
-        std::string_view name_base64_hash,
-        std::optional<uint64_t> blockchain_height) {
-    assert(name_base64_hash.size() == 44 && name_base64_hash.back() == '=' &&
-           oxenc::is_base64(name_base64_hash));
+namespace {
+    std::string mapping_cache_key(mapping_type type, std::string_view name_base64_hash) {
+        auto db_type = db_mapping_type(type);
+        std::string key;
+        key.reserve(2 + name_base64_hash.size());
+        key += static_cast<char>(db_type >> 8);
+        key += static_cast<char>(db_type & 0xff);
+        key += name_base64_hash;
+        return key;
+    }
+}  // namespace
+
+mapping_record name_system_db::get_latest_mapping(
+        mapping_type type, std::string_view name_base64_hash) {
+    auto key = mapping_cache_key(type, name_base64_hash);
+    uint64_t generation;
+    {
+        std::lock_guard lock{mapping_cache_mutex};
+        if (auto it = mapping_cache_index.find(key); it != mapping_cache_index.end()) {
+            mapping_cache.splice(mapping_cache.begin(), mapping_cache, it->second);
+            return it->second->second;
+        }
+        generation = mapping_cache_generation;
+    }
+
     mapping_record result = {};
     result.loaded = bind_and_run(
             ons_sql_type::get_mapping,
@@ -2698,6 +2844,46 @@ mapping_record name_system_db::get_mapping(
             &result,
             db_mapping_type(type),
             name_base64_hash);
+
+    // Don't cache the result if anything was invalidated while we were querying, as it may
+    // already be stale.
+    std::lock_guard lock{mapping_cache_mutex};
+    if (generation == mapping_cache_generation && !mapping_cache_index.count(key)) {
+        auto& cached = mapping_cache.emplace_front(std::move(key), result);
+        mapping_cache_index.emplace(cached.first, mapping_cache.begin());
+        if (mapping_cache.size() > MAPPING_CACHE_SIZE) {
+            mapping_cache_index.erase(mapping_cache.back().first);
+            mapping_cache.pop_back();
+        }
+    }
+    return result;
+}
+
+void name_system_db::uncache_mapping(mapping_type type, std::string_view name_base64_hash) {
+    auto key = mapping_cache_key(type, name_base64_hash);
+    std::lock_guard lock{mapping_cache_mutex};
+    mapping_cache_generation++;
+    if (auto it = mapping_cache_index.find(key); it != mapping_cache_index.end()) {
+        auto entry = it->second;
+        mapping_cache_index.erase(it);
+        mapping_cache.erase(entry);
+    }
+}
+
+void name_system_db::clear_mapping_cache() {
+    std::lock_guard lock{mapping_cache_mutex};
+    mapping_cache_generation++;
+    mapping_cache_index.clear();
+    mapping_cache.clear();
+}
+
+mapping_record name_system_db::get_mapping(
+        mapping_type type,
+        std::string_view name_base64_hash,
+        std::optional<uint64_t> blockchain_height) {
+    assert(name_base64_hash.size() == 44 && name_base64_hash.back() == '=' &&
+           oxenc::is_base64(name_base64_hash));
+    mapping_record result = get_latest_mapping(type, name_base64_hash);
     if (blockchain_height && !result.active(*blockchain_height))
         result.loaded = false;
     return result;
@@ -2708,6 +2894,18 @@ std::optional<mapping_value> name_system_db::resolve(
     assert(name_hash_b64.size() == 44 && name_hash_b64.back() == '=' &&
            oxenc::is_base64(name_hash_b64));
     std::optional<mapping_value> result;
+
+    // The latest record answers almost every lookup: either nothing is registered, or the latest
+    // record is the active one.  Only if it has expired do we need to check the database for an
+    // older, still active row.
+    auto latest = get_latest_mapping(type, name_hash_b64);
+    if (!latest)
+        return result;
+    if (latest.active(blockchain_height)) {
+        result = latest.encrypted_value;
+        return result;
+    }
+
     bind_all(resolve_sql, db_mapping_type(type), name_hash_b64, blockchain_height);
     if (step(resolve_sql) == SQLITE_ROW) {
         if (auto blob = get<std::optional<blob_view>>(resolve_sql, 0)) {
@@ -2779,10 +2977,6 @@ std::vector<mapping_record> name_system_db::get_mappings_by_owners(
     std::vector<std::variant<blob_view, uint64_t>> bind;
     // Generate string statement
     {
-        constexpr auto SQL_WHERE_OWNER = "WHERE (o1.address IN ("sv;
-        constexpr auto SQL_OR_BACKUP_OWNER = ") OR o2.address IN ("sv;
-        constexpr auto SQL_SUFFIX = "))"sv;
-
         std::string placeholders;
         placeholders.reserve(3 * owners.size());
         for (size_t i = 0; i < owners.size(); i++)
@@ -2792,14 +2986,14 @@ std::vector<mapping_record> name_system_db::get_mappings_by_owners(
 
         sql_statement.reserve(
                 sql_select_mappings_and_owners_prefix.size() + SQL_WHERE_OWNER.size() +
-                SQL_OR_BACKUP_OWNER.size() + SQL_SUFFIX.size() + 2 * placeholders.size() + 5 +
-                EXPIRATION.size() + sql_select_mappings_and_owners_suffix.size());
+                SQL_OR_BACKUP_OWNER.size() + SQL_OWNER_SUFFIX.size() + 2 * placeholders.size() +
+                5 + EXPIRATION.size() + sql_select_mappings_and_owners_suffix.size());
         sql_statement += sql_select_mappings_and_owners_prefix;
         sql_statement += SQL_WHERE_OWNER;
         sql_statement += placeholders;
         sql_statement += SQL_OR_BACKUP_OWNER;
         sql_statement += placeholders;
-        sql_statement += SQL_SUFFIX;
+        sql_statement += SQL_OWNER_SUFFIX;
 
         for ([[maybe_unused]] int i : {0, 1})
             for (auto const& owner : owners)
@@ -4,7 +4,11 @@
 #include <oxenc/hex.h>
 
 #include <cassert>
+#include <list>
+#include <mutex>
+#include <span>
 #include <string>
+#include <unordered_map>
 
 #include "common/fs.h"
 #include "crypto/crypto.h"
@@ -338,10 +342,35 @@ class sql_compiled_statement final {
     explicit operator bool() const { return statement != nullptr; }
 };
 
+// Extracts the ONS details from the tx_extra of an ONS transaction.  Returns false (setting
+// `reason`, if given) if the tx is not an ONS tx or carries no ONS details.  This needs no database
+// access, and so can be done ahead of (and in parallel with) validation.
+bool parse_ons_tx(
+        cryptonote::transaction const& tx,
+        cryptonote::tx_extra_oxen_name_system& entry,
+        std::string* reason = nullptr);
+
 struct name_system_db {
     bool
     init(cryptonote::Blockchain const* blockchain, cryptonote::network_type nettype, sqlite3* db);
-    bool add_block(const cryptonote::block& block, const std::vector<cryptonote::transaction>& txs);
+    // Applies the ONS txs of a block.  `parsed` optionally holds the already parsed (with
+    // parse_ons_tx) ONS details of each tx in `txs`; txs without a value there are parsed here.
+    bool add_block(
+            const cryptonote::block& block,
+            const std::vector<cryptonote::transaction>& txs,
+            std::span<const std::optional<cryptonote::tx_extra_oxen_name_system>> parsed = {});
+
+    // Bulk ingest mode, for loading many blocks at once: add_block applies blocks inside a single
+    // transaction, committed by bulk_commit() or end_bulk_ingest(), rather than one per block.
+    // With `defer_indices` the indices that block processing doesn't need are dropped until the
+    // ingest ends and then rebuilt in one go, which is much faster when rebuilding from scratch.
+    bool begin_bulk_ingest(bool defer_indices);
+    // Commits the blocks added so far in bulk ingest mode and continues in a new transaction.
+    bool bulk_commit();
+    // Ends bulk ingest mode, committing the outstanding blocks (or rolling them back if `commit` is
+    // false) and rebuilding any deferred indices.  Does nothing if not in bulk ingest mode.
+    void end_bulk_ingest(bool commit = true);
+    bool in_bulk_ingest() const { return bulk_ingest; }
 
     cryptonote::network_type network_type() const { return nettype; }
     uint64_t height() const { return last_processed_height; }
@@ -402,10 +431,20 @@ struct name_system_db {
             cryptonote::transaction const& tx,
             cryptonote::tx_extra_oxen_name_system& entry,
             std::string* reason);
+    // Same as validate_ons_tx, but for an `entry` already extracted from the tx by parse_ons_tx.
+    bool validate_parsed_ons_tx(
+            cryptonote::hf hf_version,
+            uint64_t blockchain_height,
+            cryptonote::transaction const& tx,
+            cryptonote::tx_extra_oxen_name_system const& entry,
+            std::string* reason);
 
     // Destructor; closes the sqlite3 database if one is open
     ~name_system_db();
 
+    // The number of (type, name) lookups that get_mapping and resolve keep cached in memory.
+    static constexpr size_t MAPPING_CACHE_SIZE = 1024;
+
     sqlite3* db = nullptr;
     bool transaction_begun = false;
 
@@ -413,6 +452,11 @@ struct name_system_db {
     cryptonote::network_type nettype;
     uint64_t last_processed_height = 0;
     crypto::hash last_processed_hash{};
+    bool bulk_ingest = false;
+    bool bulk_deferred_indices = false;
+    // The last processed block as of the last bulk ingest commit, restored on rollback
+    uint64_t bulk_committed_height = 0;
+    crypto::hash bulk_committed_hash{};
     sql_compiled_statement save_owner_sql{*this};
     sql_compiled_statement save_mapping_sql{*this};
     sql_compiled_statement save_settings_sql{*this};
@@ -426,6 +470,19 @@ struct name_system_db {
     sql_compiled_statement get_mappings_by_owner_sql{*this};
     sql_compiled_statement get_mapping_counts_sql{*this};
     sql_compiled_statement get_mappings_on_height_and_newer_sql{*this};
+
+    // LRU cache of the latest mapping record (regardless of expiry, and including "not found"
+    // results) for recently looked up names, most recently used first.  Entries are keyed by the
+    // db mapping type and name hash, dropped when a block touches the name, and cleared entirely
+    // when blocks are detached.
+    std::mutex mapping_cache_mutex;
+    uint64_t mapping_cache_generation = 0;  // Bumped on every invalidation
+    std::list<std::pair<std::string, mapping_record>> mapping_cache;
+    std::unordered_map<std::string_view, decltype(mapping_cache)::iterator> mapping_cache_index;
+
+    mapping_record get_latest_mapping(mapping_type type, std::string_view name_base64_hash);
+    void uncache_mapping(mapping_type type, std::string_view name_base64_hash);
+    void clear_mapping_cache();
 };
 
 };  // namespace ons
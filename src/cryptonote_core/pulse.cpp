@@ -1,8 +1,10 @@
 #include <array>
 #include <chrono>
 #include <mutex>
+#include <optional>
 #include <variant>
 
+#include "common/oxen.h"
 #include "common/random.h"
 #include "cryptonote_basic/hardfork.h"
 #include "cryptonote_core.h"
@@ -23,6 +25,9 @@ namespace pulse {
 
 namespace log = oxen::log;
 
+// Processes a message without advancing the state machine
+static void process_message(void* quorumnet_state, pulse::message const& msg);
+
 namespace {
 
     auto logcat = log::Cat("pulse");
@@ -93,6 +98,17 @@ namespace {
     template <typename T>
     using quorum_array = std::array<T, service_nodes::PULSE_QUORUM_NUM_VALIDATORS>;
 
+    // How many rounds' quorums we work out in advance when a new block arrives.  Later rounds (i.e.
+    // when the network is struggling) are computed on demand.
+    constexpr uint8_t PRECOMPUTED_ROUNDS = 4;
+
+    // The quorum for a round and our part in it
+    struct round_plan {
+        service_nodes::quorum quorum;
+        sn_type participant;
+        size_t my_quorum_position;
+    };
+
     // Stores message for quorumnet per stage. Some validators may reach later
     // stages before we arrive at that stage. To properly validate messages we also
     // need to wait until we arrive at the same stage such that we have received all
@@ -143,6 +159,13 @@ namespace {
                                     // date nodes
             pulse::time_point round_0_start_time;  // When round 0 should start and subsequent round
                                                    // timings are derived from.
+
+            // Snapshot of the service node list state the quorums for this height come from, and
+            // the plans for the first rounds, so that rounds start without any lookups.
+            std::vector<service_nodes::pubkey_and_sninfo> active_nodes;
+            crypto::public_key block_leader;
+            cryptonote::hf hf_version;
+            std::array<std::optional<round_plan>, PRECOMPUTED_ROUNDS> plans;
         } wait_for_next_block;
 
         struct {
@@ -211,6 +234,12 @@ namespace {
         } transient;
 
         round_state state;
+
+        // Set by main() so that message handling and wake-up timers can drive the state machine
+        cryptonote::core* core;
+        bool running;  // True whilst the state machine is being advanced
+        oxenmq::TimerID wake_timer;
+        std::optional<pulse::time_point> wake_time;  // When the pending wake-up timer fires
     };
 
     round_context context;
@@ -429,7 +458,7 @@ namespace {
 
         for (auto& [msg, queued] : stage.queue.buffer) {
             if (queued == queueing_state::received) {
-                pulse::handle_message(quorumnet_state, msg);
+                process_message(quorumnet_state, msg);
                 queued = queueing_state::processed;
             }
         }
@@ -474,9 +503,19 @@ namespace {
         return true;
     }
 
+    void run(void* quorumnet_state, cryptonote::core& core);
+
 }  // anonymous namespace
 
 void handle_message(void* quorumnet_state, pulse::message const& msg) {
+    process_message(quorumnet_state, msg);
+
+    // Don't wait for the next tick if the message completes the stage
+    if (context.core && !context.running && context.state >= round_state::wait_for_round)
+        run(quorumnet_state, *context.core);
+}
+
+static void process_message(void* quorumnet_state, pulse::message const& msg) {
     if (context.state < round_state::wait_for_round) {
         // TODO(doyle): Handle this better.
         // We are not ready for any messages because we haven't prepared for a round
@@ -1108,8 +1147,46 @@ namespace {
         return round_state::wait_for_next_block;
     }
 
+    // Generates the quorum for `round` of the next block from the service node state captured by
+    // wait_for_next_block, and works out what part (if any) we play in it.
+    round_plan make_round_plan(
+            round_context const& context,
+            service_nodes::service_node_keys const& key,
+            cryptonote::Blockchain const& blockchain,
+            uint8_t round) {
+        auto const& next = context.wait_for_next_block;
+        round_plan result = {};
+        result.participant = sn_type::none;
+        result.quorum = service_nodes::generate_pulse_quorum(
+                blockchain.nettype(),
+                next.block_leader,
+                next.hf_version,
+                next.active_nodes,
+                service_nodes::get_pulse_entropy_for_next_block(
+                        blockchain.db(), next.top_hash, round),
+                round);
+
+        if (!service_nodes::verify_pulse_quorum_sizes(result.quorum))
+            return result;
+
+        if (key.pub == result.quorum.workers[0]) {
+            result.participant = sn_type::producer;
+        } else {
+            for (size_t index = 0; index < result.quorum.validators.size(); index++) {
+                if (result.quorum.validators[index] == key.pub) {
+                    result.participant = sn_type::validator;
+                    result.my_quorum_position = index;
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
     round_state wait_for_next_block(
-            round_context& context, cryptonote::Blockchain const& blockchain) {
+            round_context& context,
+            service_nodes::service_node_keys const& key,
+            cryptonote::Blockchain const& blockchain) {
         //
         // NOTE: If the top hash stored in the pulse context is the same as the top block's hash
         // then we've already attempted Pulse with the current state of the blockchain and
@@ -1145,6 +1222,15 @@ namespace {
         context.wait_for_next_block.top_hash = top_hash;
         context.prepare_for_round = {};
 
+        // Snapshot the service node state the quorums are drawn from and work out the first few
+        // rounds now, so that starting a round (which is time critical) doesn't have to.
+        auto& next = context.wait_for_next_block;
+        next.active_nodes = blockchain.service_node_list.active_service_nodes_infos();
+        next.block_leader = blockchain.service_node_list.get_next_block_leader().key;
+        next.hf_version = blockchain.get_network_version();
+        for (uint8_t round = 0; round < PRECOMPUTED_ROUNDS; round++)
+            next.plans[round] = make_round_plan(context, key, blockchain, round);
+
         return round_state::prepare_for_round;
     }
 
@@ -1235,22 +1321,17 @@ namespace {
                     context.transient.random_value.wait.stage.end_time + conf.PULSE_STAGE_TIMEOUT;
         }
 
-        std::vector<crypto::hash> const entropy = service_nodes::get_pulse_entropy_for_next_block(
-                blockchain.db(),
-                context.wait_for_next_block.top_hash,
-                context.prepare_for_round.round);
-        auto const active_node_list = blockchain.service_node_list.active_service_nodes_infos();
-        auto hf_version = blockchain.get_network_version();
-        crypto::public_key const& block_leader =
-                blockchain.service_node_list.get_next_block_leader().key;
-
-        context.prepare_for_round.quorum = service_nodes::generate_pulse_quorum(
-                blockchain.nettype(),
-                block_leader,
-                hf_version,
-                active_node_list,
-                entropy,
-                context.prepare_for_round.round);
+        uint8_t const round = context.prepare_for_round.round;
+        round_plan plan;
+        if (auto* cached = round < PRECOMPUTED_ROUNDS ? &context.wait_for_next_block.plans[round]
+                                                      : nullptr;
+            cached && *cached) {
+            plan = std::move(**cached);
+            cached->reset();
+        } else {
+            plan = make_round_plan(context, key, blockchain, round);
+        }
+        context.prepare_for_round.quorum = std::move(plan.quorum);
 
         if (!service_nodes::verify_pulse_quorum_sizes(context.prepare_for_round.quorum)) {
             log::info(
@@ -1275,25 +1356,15 @@ namespace {
         //
         // NOTE: Quorum participation
         //
-        if (key.pub == context.prepare_for_round.quorum.workers[0]) {
-            // NOTE: Producer doesn't send handshakes, they only collect the
-            // handshake bitsets from the other validators to determine who to
-            // lock in for this round in the block template.
-            context.prepare_for_round.participant = sn_type::producer;
+        // NOTE: Producer doesn't send handshakes, they only collect the handshake bitsets from the
+        // other validators to determine who to lock in for this round in the block template.
+        context.prepare_for_round.participant = plan.participant;
+        if (plan.participant == sn_type::producer) {
             context.prepare_for_round.node_name = "W[0]";
-        } else {
-            for (size_t index = 0; index < context.prepare_for_round.quorum.validators.size();
-                 index++) {
-                auto const& validator_key = context.prepare_for_round.quorum.validators[index];
-                if (validator_key == key.pub) {
-                    context.prepare_for_round.participant = sn_type::validator;
-                    context.prepare_for_round.my_quorum_position = index;
-                    context.prepare_for_round.node_name =
-                            "V[" + std::to_string(context.prepare_for_round.my_quorum_position) +
-                            "]";
-                    break;
-                }
-            }
+        } else if (plan.participant == sn_type::validator) {
+            context.prepare_for_round.my_quorum_position = plan.my_quorum_position;
+            context.prepare_for_round.node_name =
+                    "V[" + std::to_string(context.prepare_for_round.my_quorum_position) + "]";
         }
 
         return round_state::wait_for_round;
@@ -1992,11 +2063,129 @@ namespace {
         return round_state::send_and_wait_for_signed_blocks;
     }
 
+    // The time at which the current state next needs to be advanced if no messages arrive first,
+    // i.e. when the round starts or the stage we're waiting in times out.
+    std::optional<pulse::time_point> next_deadline() {
+        auto& stages = context.transient;
+        switch (context.state) {
+            case round_state::wait_for_round: return context.prepare_for_round.start_time;
+            case round_state::send_and_wait_for_handshakes:
+                return stages.send_and_wait_for_handshakes.stage.end_time;
+            case round_state::wait_for_handshake_bitsets:
+                return stages.wait_for_handshake_bitsets.stage.end_time;
+            case round_state::wait_for_block_template:
+                return stages.wait_for_block_template.stage.end_time;
+            case round_state::send_and_wait_for_random_value_hashes:
+                return stages.random_value_hashes.wait.stage.end_time;
+            case round_state::send_and_wait_for_random_value:
+                return stages.random_value.wait.stage.end_time;
+            case round_state::send_and_wait_for_signed_blocks:
+                return stages.signed_block.wait.stage.end_time;
+            default: return std::nullopt;
+        }
+    }
+
+    // Arranges for the state machine to be run again at the next deadline, unless a wake-up at or
+    // before then is already pending.
+    void schedule_wake(void* quorumnet_state, cryptonote::core& core) {
+        auto deadline = next_deadline();
+        auto now = pulse::clock::now();
+        if (!deadline || *deadline <= now || (context.wake_time && *context.wake_time <= *deadline))
+            return;
+
+        auto& omq = core.omq();
+        if (context.wake_time)
+            omq.cancel_timer(context.wake_timer);
+        context.wake_time = *deadline;
+
+        // Round up so that we don't wake just short of the deadline and find nothing to do
+        omq.add_timer(
+                context.wake_timer,
+                [quorumnet_state, &core] {
+                    core.omq().cancel_timer(context.wake_timer);
+                    context.wake_time.reset();
+                    run(quorumnet_state, core);
+                },
+                std::chrono::ceil<std::chrono::milliseconds>(*deadline - now),
+                true /*squelch*/,
+                core.pulse_thread_id());
+    }
+
+    void run(void* quorumnet_state, cryptonote::core& core) {
+        cryptonote::Blockchain& blockchain = core.blockchain;
+        service_nodes::service_node_keys const& key = core.get_service_keys();
+
+        context.running = true;
+        OXEN_DEFER {
+            context.running = false;
+        };
+
+        auto& node_list = core.service_node_list;
+        for (auto last_state = round_state::null_state;
+             last_state != context.state || last_state == round_state::null_state;) {
+            last_state = context.state;
+
+            switch (context.state) {
+                case round_state::null_state:
+                    context.state = round_state::wait_for_next_block;
+                    break;
+
+                case round_state::wait_for_next_block:
+                    context.state = wait_for_next_block(context, key, blockchain);
+                    break;
+
+                case round_state::prepare_for_round:
+                    context.state = prepare_for_round(context, key, blockchain);
+                    break;
+
+                case round_state::wait_for_round:
+                    context.state = wait_for_round(context, blockchain);
+                    break;
+
+                case round_state::send_and_wait_for_handshakes:
+                    context.state = send_and_wait_for_handshakes(context, quorumnet_state, key);
+                    break;
+
+                case round_state::send_handshake_bitsets:
+                    context.state = send_handshake_bitsets(context, quorumnet_state, key);
+                    break;
+
+                case round_state::wait_for_handshake_bitsets:
+                    context.state = wait_for_handshake_bitsets(context, quorumnet_state);
+                    break;
+
+                case round_state::wait_for_block_template:
+                    context.state = wait_for_block_template(context, node_list, quorumnet_state);
+                    break;
+
+                case round_state::send_block_template:
+                    context.state = send_block_template(context, quorumnet_state, key, blockchain);
+                    break;
+
+                case round_state::send_and_wait_for_random_value_hashes:
+                    context.state = send_and_wait_for_random_value_hashes(
+                            context, node_list, quorumnet_state, key);
+                    break;
+
+                case round_state::send_and_wait_for_random_value:
+                    context.state = send_and_wait_for_random_value(
+                            context, node_list, quorumnet_state, key);
+                    break;
+
+                case round_state::send_and_wait_for_signed_blocks:
+                    context.state = send_and_wait_for_signed_blocks(
+                            context, node_list, quorumnet_state, key, core);
+                    break;
+            }
+        }
+
+        schedule_wake(quorumnet_state, core);
+    }
+
 }  // anonymous namespace
 
 void main(void* quorumnet_state, cryptonote::core& core) {
     cryptonote::Blockchain& blockchain = core.blockchain;
-    service_nodes::service_node_keys const& key = core.get_service_keys();
 
     //
     // NOTE: Early exit if too early
@@ -2018,62 +2207,8 @@ void main(void* quorumnet_state, cryptonote::core& core) {
         return;
     }
 
-    auto& node_list = core.service_node_list;
-    for (auto last_state = round_state::null_state;
-         last_state != context.state || last_state == round_state::null_state;) {
-        last_state = context.state;
-
-        switch (context.state) {
-            case round_state::null_state: context.state = round_state::wait_for_next_block; break;
-
-            case round_state::wait_for_next_block:
-                context.state = wait_for_next_block(context, blockchain);
-                break;
-
-            case round_state::prepare_for_round:
-                context.state = prepare_for_round(context, key, blockchain);
-                break;
-
-            case round_state::wait_for_round:
-                context.state = wait_for_round(context, blockchain);
-                break;
-
-            case round_state::send_and_wait_for_handshakes:
-                context.state = send_and_wait_for_handshakes(context, quorumnet_state, key);
-                break;
-
-            case round_state::send_handshake_bitsets:
-                context.state = send_handshake_bitsets(context, quorumnet_state, key);
-                break;
-
-            case round_state::wait_for_handshake_bitsets:
-                context.state = wait_for_handshake_bitsets(context, quorumnet_state);
-                break;
-
-            case round_state::wait_for_block_template:
-                context.state = wait_for_block_template(context, node_list, quorumnet_state);
-                break;
-
-            case round_state::send_block_template:
-                context.state = send_block_template(context, quorumnet_state, key, blockchain);
-                break;
-
-            case round_state::send_and_wait_for_random_value_hashes:
-                context.state = send_and_wait_for_random_value_hashes(
-                        context, node_list, quorumnet_state, key);
-                break;
-
-            case round_state::send_and_wait_for_random_value:
-                context.state =
-                        send_and_wait_for_random_value(context, node_list, quorumnet_state, key);
-                break;
-
-            case round_state::send_and_wait_for_signed_blocks:
-                context.state = send_and_wait_for_signed_blocks(
-                        context, node_list, quorumnet_state, key, core);
-                break;
-        }
-    }
+    context.core = &core;
+    run(quorumnet_state, core);
 }
 
 }  // namespace pulse
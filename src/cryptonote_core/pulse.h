@@ -76,7 +76,12 @@ struct message {
     } signed_block;
 };
 
+// Advances the Pulse state machine.  Must be invoked on the Pulse thread: it is called on a
+// periodic timer and when blocks arrive, and it schedules its own wake-ups at the next stage
+// boundary.
 void main(void* quorumnet_state, cryptonote::core& core);
+// Handles a Pulse message from quorumnet (on the Pulse thread), advancing the state machine
+// straight away if the message completes the current stage.
 void handle_message(void* quorumnet_state, pulse::message const& msg);
 
 struct timings {
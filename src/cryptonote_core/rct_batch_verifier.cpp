@@ -0,0 +1,103 @@
+#include "rct_batch_verifier.h"
+
+#include <algorithm>
+
+#include "logging/oxen_logger.h"
+#include "ringct/rctSigs.h"
+
+namespace cryptonote {
+
+static auto logcat = log::Cat("verify");
+
+void rct_batch_verifier::configure(std::chrono::milliseconds window, size_t max_batch) {
+    std::lock_guard lock{m_mutex};
+    m_window = window;
+    m_max_batch = max_batch;
+}
+
+void rct_batch_verifier::bisect(
+        const std::vector<const rct::rctSig*>& sigs,
+        std::vector<bool>& results,
+        size_t begin,
+        size_t end,
+        bool known_bad) {
+    if (begin >= end)
+        return;
+    if (end - begin == 1) {
+        results[begin] = !known_bad && rct::verRctSemanticsSimple(*sigs[begin]);
+        return;
+    }
+    if (!known_bad &&
+        rct::verRctSemanticsSimple(
+                std::vector<const rct::rctSig*>(sigs.begin() + begin, sigs.begin() + end))) {
+        std::fill(results.begin() + begin, results.begin() + end, true);
+        return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    bisect(sigs, results, begin, mid);
+    // If the left half was entirely good then the failure must be in the right half
+    bool left_good = std::all_of(
+            results.begin() + begin, results.begin() + mid, [](bool good) { return good; });
+    bisect(sigs, results, mid, end, left_good);
+}
+
+std::vector<bool> rct_batch_verifier::verify(const std::vector<const rct::rctSig*>& rvv) {
+    std::vector<bool> results(rvv.size(), false);
+    if (rvv.empty())
+        return results;
+
+    std::unique_lock lock{m_mutex};
+    if (!enabled()) {
+        lock.unlock();
+        bisect(rvv, results, 0, rvv.size());
+        return results;
+    }
+
+    request req{rvv, results};
+    m_pending.push_back(&req);
+    m_pending_sigs += rvv.size();
+    if (m_pending_sigs >= m_max_batch)
+        m_cv.notify_all();
+
+    if (m_collecting) {
+        // Someone else is gathering the current batch and will verify ours along with theirs
+        m_cv.wait(lock, [&req] { return req.done; });
+        return results;
+    }
+
+    // We're the first one in: wait for the batch to fill up (or the window to expire), then take
+    // everything queued so far.  Anything arriving after that starts a new batch.
+    m_collecting = true;
+    m_cv.wait_for(lock, m_window, [this] { return m_pending_sigs >= m_max_batch; });
+    auto batch = std::move(m_pending);
+    m_pending.clear();
+    m_pending_sigs = 0;
+    m_collecting = false;
+    lock.unlock();
+
+    std::vector<const rct::rctSig*> sigs;
+    for (auto* r : batch)
+        sigs.insert(sigs.end(), r->rvv.begin(), r->rvv.end());
+    std::vector<bool> all_results(sigs.size(), false);
+    bisect(sigs, all_results, 0, sigs.size());
+
+    size_t bad = std::count(all_results.begin(), all_results.end(), false);
+    log::debug(
+            logcat,
+            "Batch verified {} rct signatures from {} submissions; {} failed",
+            sigs.size(),
+            batch.size(),
+            bad);
+
+    lock.lock();
+    auto it = all_results.begin();
+    for (auto* r : batch) {
+        std::copy(it, it + r->rvv.size(), r->results.begin());
+        it += r->rvv.size();
+        r->done = true;
+    }
+    m_cv.notify_all();
+    return results;
+}
+
+}  // namespace cryptonote
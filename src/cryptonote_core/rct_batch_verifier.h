@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "ringct/rctTypes.h"
+
+namespace cryptonote {
+
+/// Admission queue for the semantic (i.e. bulletproof range proof and commitment sum) checks of
+/// incoming txes.  Concurrent callers of `verify()` are gathered into a single batch, for up to
+/// `window` or until `max_batch` rctSigs are waiting, and verified with one bulletproof multiexp;
+/// if the batch fails it is bisected to find the offending rctSig(s).  Each caller blocks until its
+/// own results are available.
+///
+/// With a zero window (the default) batching is disabled and `enabled()` returns false.
+class rct_batch_verifier {
+  public:
+    void configure(std::chrono::milliseconds window, size_t max_batch);
+
+    bool enabled() const { return m_window.count() > 0 && m_max_batch > 1; }
+
+    /// Verifies the given rctSigs (which must all be simple bulletproof types), possibly together
+    /// with those of other concurrent callers.  Returns the per-rctSig result, in the same order as
+    /// `rvv`.
+    std::vector<bool> verify(const std::vector<const rct::rctSig*>& rvv);
+
+  private:
+    struct request {
+        const std::vector<const rct::rctSig*>& rvv;
+        std::vector<bool>& results;
+        bool done = false;
+    };
+
+    // Verifies `sigs[begin, end)`, writing the outcomes into `results`.  `known_bad` indicates that
+    // we already know that the range as a whole fails, in which case a single-element range doesn't
+    // need to be verified again.
+    static void bisect(
+            const std::vector<const rct::rctSig*>& sigs,
+            std::vector<bool>& results,
+            size_t begin,
+            size_t end,
+            bool known_bad = false);
+
+    std::chrono::milliseconds m_window{0};
+    size_t m_max_batch = 64;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<request*> m_pending;
+    size_t m_pending_sigs = 0;
+    bool m_collecting = false;
+};
+
+}  // namespace cryptonote
@@ -0,0 +1,41 @@
+#include "rct_output_counts.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "blockchain_db/blockchain_db.h"
+
+namespace cryptonote {
+
+std::vector<uint64_t> rct_output_counts::get(const BlockchainDB& db, uint64_t from, uint64_t to) {
+    if (from > to)
+        return {};
+
+    std::lock_guard lock{m_mutex};
+    std::vector<uint64_t> heights;
+    while (m_counts.size() <= to) {
+        uint64_t end = std::min<uint64_t>(to + 1, m_counts.size() + LOAD_BATCH);
+        heights.resize(end - m_counts.size());
+        for (size_t i = 0; i < heights.size(); i++)
+            heights[i] = m_counts.size() + i;
+        auto counts = db.get_block_cumulative_rct_outputs(heights);
+        if (counts.size() != heights.size())
+            throw std::runtime_error{"Failed to load cumulative rct output counts"};
+        m_counts.insert(m_counts.end(), counts.begin(), counts.end());
+    }
+
+    return {m_counts.begin() + from, m_counts.begin() + to + 1};
+}
+
+void rct_output_counts::blockchain_detached(uint64_t height) {
+    std::lock_guard lock{m_mutex};
+    if (height < m_counts.size())
+        m_counts.resize(height);
+}
+
+size_t rct_output_counts::size() const {
+    std::lock_guard lock{m_mutex};
+    return m_counts.size();
+}
+
+}  // namespace cryptonote
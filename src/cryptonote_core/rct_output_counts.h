@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cryptonote {
+
+class BlockchainDB;
+
+/// In-memory copy of the cumulative per-block RCT output counts stored in each block's info in the
+/// database.  Every wallet requests the (amount 0) output distribution to pick decoys, and serving
+/// those from here is a copy of the requested slice rather than a database lookup for every block
+/// in the range.
+///
+/// Counts are loaded from the database on demand, continuing from wherever the array currently
+/// ends, so newly added blocks cost nothing until they are requested; blockchain_detached() must be
+/// called when blocks are removed so that counts of replaced blocks are never served.
+class rct_output_counts {
+  public:
+    /// How many heights we fetch from the database at a time when extending the array
+    static constexpr uint64_t LOAD_BATCH = 10'000;
+
+    /// Returns the cumulative counts for heights `from` through `to` (inclusive), loading any not
+    /// yet loaded from `db`.  `to` must be less than the db height.  Returns an empty vector if
+    /// `from > to`.
+    std::vector<uint64_t> get(const BlockchainDB& db, uint64_t from, uint64_t to);
+
+    /// Drops the counts of all blocks at or above `height`.
+    void blockchain_detached(uint64_t height);
+
+    /// Returns the number of heights currently loaded.
+    size_t size() const;
+
+  private:
+    mutable std::mutex m_mutex;
+    std::vector<uint64_t> m_counts;
+};
+
+}  // namespace cryptonote
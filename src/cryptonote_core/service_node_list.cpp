@@ -42,6 +42,7 @@
 #include "blockchain.h"
 #include "blockchain_db/sqlite/db_sqlite.h"
 #include "bls/bls_crypto.h"
+#include "common/alloc_profile.h"
 #include "common/exception.h"
 #include "common/i18n.h"
 #include "common/lock.h"
@@ -61,6 +62,7 @@
 #include "epee/net/local_ip.h"
 #include "ethereum_transactions.h"
 #include "l2_tracker/events.h"
+#include "logging/trace.h"
 #include "oxen/log.hpp"
 #include "oxen_economy.h"
 #include "pulse.h"
@@ -78,12 +80,15 @@ namespace service_nodes {
 static auto logcat = log::Cat("service_nodes");
 
 size_t constexpr STORE_LONG_TERM_STATE_INTERVAL = 10000;
+// Short-term states are stored as per-height deltas, with a full checkpoint record this often
+size_t constexpr STORE_STATE_CHECKPOINT_INTERVAL = 100;
 
 constexpr auto X25519_MAP_PRUNING_INTERVAL = 5min;
 constexpr auto X25519_MAP_PRUNING_LAG = 24h;
 static_assert(
         X25519_MAP_PRUNING_LAG > cryptonote::config::mainnet::config.UPTIME_PROOF_VALIDITY,
         "x25519 map pruning lag is too short!");
+constexpr auto SEEN_PROOFS_PRUNING_INTERVAL = 1min;
 
 static uint64_t short_term_state_cull_height(hf hf_version, uint64_t block_height) {
     size_t constexpr DEFAULT_SHORT_TERM_STATE_HISTORY = 6 * STATE_CHANGE_TX_LIFETIME_IN_BLOCKS;
@@ -101,7 +106,8 @@ service_node_list::service_node_list(cryptonote::Blockchain& blockchain) :
         blockchain(blockchain)  // Warning: don't touch `blockchain`, it gets initialized *after* us
         ,
         m_service_node_keys(nullptr),
-        m_state{this} {}
+        m_state{this},
+        m_state_snapshot{std::make_shared<const state_t>(m_state)} {}
 
 void service_node_list::init() {
     std::lock_guard lock(m_sn_mutex);
@@ -112,18 +118,35 @@ void service_node_list::init() {
 
     uint64_t current_height = blockchain.get_current_blockchain_height();
     bool loaded = load(current_height);
-    if (loaded &&
-        m_transient.old_quorum_states.size() < std::min(m_store_quorum_history, uint64_t{10})) {
+    size_t quorum_count =
+            m_transient.old_quorum_states.size() + m_transient.deferred_quorum_count;
+    if (loaded && quorum_count < std::min(m_store_quorum_history, uint64_t{10})) {
         log::warning(
                 logcat,
                 "Full history storage requested, but {} old quorum states found",
-                m_transient.old_quorum_states.size());
+                quorum_count);
         loaded = false;  // Either we don't have stored history or the history is very short, so
                          // recalculation is necessary or cheap.
     }
 
     if (!loaded || m_state.height > current_height)
         reset(true);
+    else
+        publish_state();
+}
+
+void service_node_list::publish_state() {
+    auto snapshot = std::make_shared<const state_t>(m_state);
+    // Fill in the lazily computed leader now, while it's still ours alone, so that readers sharing
+    // the snapshot never write to it.
+    snapshot->get_next_block_leader();
+    std::lock_guard lock{m_state_snapshot_mutex};
+    m_state_snapshot = std::move(snapshot);
+}
+
+std::shared_ptr<const service_node_list::state_t> service_node_list::state_snapshot() const {
+    std::lock_guard lock{m_state_snapshot_mutex};
+    return m_state_snapshot;
 }
 
 template <std::predicate<const service_node_info&> UnaryPredicate>
@@ -147,21 +170,82 @@ static std::vector<service_nodes::pubkey_and_sninfo> sort_and_filter(
     return result;
 }
 
+static bool is_active_candidate(const service_node_info& info) {
+    return info.is_active();
+}
+
+static bool is_decommissioned_candidate(const service_node_info& info) {
+    return info.is_decommissioned() && info.is_fully_funded();
+}
+
+static bool pubkey_less(const crypto::public_key& a, const crypto::public_key& b) {
+    return memcmp(a.data(), b.data(), a.size()) < 0;
+}
+
+// Returns `sorted`, the pubkey-sorted elements of some earlier service_nodes_infos that satisfy
+// `p`, updated with `changes`: a pubkey-sorted list of every service node added, modified, or
+// removed (with a null info) since.
+template <std::predicate<const service_node_info&> UnaryPredicate>
+static std::vector<pubkey_and_sninfo> merge_sorted_changes(
+        const std::vector<pubkey_and_sninfo>& sorted,
+        const std::vector<pubkey_and_sninfo>& changes,
+        UnaryPredicate p) {
+    std::vector<pubkey_and_sninfo> result;
+    result.reserve(sorted.size() + changes.size());
+    auto it = sorted.begin();
+    for (const auto& change : changes) {
+        for (; it != sorted.end() && pubkey_less(it->first, change.first); ++it)
+            result.push_back(*it);
+        if (it != sorted.end() && it->first == change.first)
+            ++it;
+        if (change.second && p(*change.second))
+            result.push_back(change);
+    }
+    result.insert(result.end(), it, sorted.end());
+    return result;
+}
+
+std::shared_ptr<const service_node_list::state_t::sorted_nodes_t>
+service_node_list::state_t::update_sorted_nodes() {
+    if (sorted_nodes && service_nodes_infos.shares_all(sorted_nodes->infos))
+        return sorted_nodes;
+
+    auto updated = std::make_shared<sorted_nodes_t>();
+    if (sorted_nodes) {
+        std::vector<pubkey_and_sninfo> changes;
+        service_nodes_infos.for_each_difference(
+                sorted_nodes->infos,
+                [&](const crypto::public_key& pubkey, const auto& info) {
+                    changes.emplace_back(pubkey, info);
+                },
+                [&](const crypto::public_key& pubkey) { changes.emplace_back(pubkey, nullptr); });
+        std::sort(changes.begin(), changes.end(), [](const auto& a, const auto& b) {
+            return pubkey_less(a.first, b.first);
+        });
+        updated->active = merge_sorted_changes(sorted_nodes->active, changes, is_active_candidate);
+        updated->decommissioned = merge_sorted_changes(
+                sorted_nodes->decommissioned, changes, is_decommissioned_candidate);
+    } else {
+        updated->active = sort_and_filter(service_nodes_infos, is_active_candidate);
+        updated->decommissioned =
+                sort_and_filter(service_nodes_infos, is_decommissioned_candidate, false);
+    }
+    updated->infos = service_nodes_infos;
+    sorted_nodes = updated;
+    return updated;
+}
+
 std::vector<pubkey_and_sninfo> service_node_list::state_t::active_service_nodes_infos() const {
-    return sort_and_filter(
-            service_nodes_infos,
-            [](const service_node_info& info) { return info.is_active(); },
-            /*reserve=*/true);
+    if (sorted_nodes && service_nodes_infos.shares_all(sorted_nodes->infos))
+        return sorted_nodes->active;
+    return sort_and_filter(service_nodes_infos, is_active_candidate, /*reserve=*/true);
 }
 
 std::vector<pubkey_and_sninfo> service_node_list::state_t::decommissioned_service_nodes_infos()
         const {
-    return sort_and_filter(
-            service_nodes_infos,
-            [](const service_node_info& info) {
-                return info.is_decommissioned() && info.is_fully_funded();
-            },
-            /*reserve=*/false);
+    if (sorted_nodes && service_nodes_infos.shares_all(sorted_nodes->infos))
+        return sorted_nodes->decommissioned;
+    return sort_and_filter(service_nodes_infos, is_decommissioned_candidate, /*reserve=*/false);
 }
 
 std::vector<pubkey_and_sninfo> service_node_list::state_t::payable_service_nodes_infos(
@@ -174,6 +258,60 @@ std::vector<pubkey_and_sninfo> service_node_list::state_t::payable_service_nodes
             /*reserve=*/true);
 }
 
+std::shared_ptr<const reward_table> service_node_list::state_t::payable_reward_table(
+        uint64_t height, cryptonote::hf hf_version, cryptonote::network_type nettype) const {
+    auto& c = payable_reward_table_cache;
+    if (!c || c->height != height || c->hf_version != hf_version || c->nettype != nettype) {
+        auto table = std::make_shared<reward_table>();
+        const auto payable = payable_service_nodes_infos(height, nettype);
+        table->operator_portions.reserve(payable.size());
+        table->operator_recipient.reserve(payable.size());
+        table->total_contributed.reserve(payable.size());
+        table->contributors_end.reserve(payable.size());
+        for (const auto& [pubkey, info] : payable)
+            table->add(*info, hf_version, nettype);
+        c = reward_table_cache{height, hf_version, nettype, std::move(table)};
+    }
+    return c->table;
+}
+
+void reward_table::add(
+        const service_node_info& info, cryptonote::hf hf_version, cryptonote::network_type nettype) {
+    assert(info.portions_for_operator <= cryptonote::old::STAKING_PORTIONS);
+
+    // NOTE: Localdev does not have a cryptonote->ETH address step, so, old pre-ETH SN nodes don't
+    // have an address assigned to it. This breaks tests that expect pre-ETH SN's to receive
+    // funds in order to proceed.
+    bool use_eth_address = hf_version >= hf::hf21_eth;
+    if (use_eth_address && nettype == cryptonote::network_type::LOCALDEV &&
+        !info.operator_ethereum_address)
+        use_eth_address = false;
+
+    operator_portions.push_back(info.portions_for_operator);
+    if (use_eth_address) {
+        assert(info.contributors.size());  // NOTE: Be paranoid, check contributors size
+        operator_recipient.emplace_back(
+                info.contributors.size() ? info.contributors[0].ethereum_beneficiary
+                                         : info.operator_ethereum_address);
+    } else {
+        operator_recipient.emplace_back(info.operator_address);
+    }
+
+    uint64_t total = 0;
+    for (const auto& contributor : info.contributors) {
+        total += contributor.amount;
+        // NOTE: At minimum, when we parsed the contributor if no benficiary is set, it should be
+        // assigned to the ethereum address by default.
+        if (use_eth_address)
+            contributor_recipient.emplace_back(contributor.ethereum_beneficiary);
+        else
+            contributor_recipient.emplace_back(contributor.address);
+        contributor_amount.push_back(contributor.amount);
+    }
+    total_contributed.push_back(total);
+    contributors_end.push_back(contributor_amount.size());
+}
+
 std::shared_ptr<const quorum> service_node_list::get_quorum(
         quorum_type type,
         uint64_t height,
@@ -191,6 +329,9 @@ std::shared_ptr<const quorum> service_node_list::get_quorum(
             quorums = &it->quorums;
 
         if (!quorums) {
+            // Loading what load() deferred doesn't change our logical state, so is fine to do from
+            // a const method (and we hold the lock).
+            const_cast<service_node_list*>(this)->load_deferred_archive();
             auto it = m_transient.state_archive.find(height);
             if (it != m_transient.state_archive.end())
                 quorums = &it->quorums;
@@ -199,6 +340,7 @@ std::shared_ptr<const quorum> service_node_list::get_quorum(
 
     if (!quorums && include_old)  // NOTE: Search m_transient.old_quorum_states
     {
+        const_cast<service_node_list*>(this)->load_deferred_quorums();
         auto it = std::lower_bound(
                 m_transient.old_quorum_states.begin(),
                 m_transient.old_quorum_states.end(),
@@ -270,25 +412,37 @@ bool service_node_list::get_quorum_pubkey(
 }
 
 size_t service_node_list::get_service_node_count() const {
-    std::lock_guard lock(m_sn_mutex);
-    return m_state.service_nodes_infos.size();
+    return state_snapshot()->service_nodes_infos.size();
+}
+
+service_node_list::state_counts service_node_list::get_state_counts() const {
+    state_counts counts;
+    for (const auto& [pubkey, info] : state_snapshot()->service_nodes_infos) {
+        if (!info->is_fully_funded())
+            counts.awaiting_contributions++;
+        else if (info->is_decommissioned())
+            counts.decommissioned++;
+        else
+            counts.active++;
+    }
+    return counts;
 }
 
 std::vector<service_node_pubkey_info> service_node_list::get_service_node_list_state(
         const std::vector<crypto::public_key>& service_node_pubkeys) const {
-    std::lock_guard lock(m_sn_mutex);
+    auto state = state_snapshot();
     std::vector<service_node_pubkey_info> result;
 
     if (service_node_pubkeys.empty()) {
-        result.reserve(m_state.service_nodes_infos.size());
+        result.reserve(state->service_nodes_infos.size());
 
-        for (const auto& info : m_state.service_nodes_infos)
+        for (const auto& info : state->service_nodes_infos)
             result.emplace_back(info);
     } else {
         result.reserve(service_node_pubkeys.size());
         for (const auto& it : service_node_pubkeys) {
-            auto find_it = m_state.service_nodes_infos.find(it);
-            if (find_it != m_state.service_nodes_infos.end())
+            auto find_it = state->service_nodes_infos.find(it);
+            if (find_it != state->service_nodes_infos.end())
                 result.emplace_back(*find_it);
         }
     }
@@ -296,6 +450,48 @@ std::vector<service_node_pubkey_info> service_node_list::get_service_node_list_s
     return result;
 }
 
+std::optional<service_node_list::state_delta> service_node_list::get_block_delta(
+        uint64_t height, const crypto::hash& block_hash) const {
+    if (height == 0)
+        return std::nullopt;
+
+    std::lock_guard lock(m_sn_mutex);
+    const state_t* state = &m_state;
+    if (m_state.height != height) {
+        auto it = m_transient.state_history.find(height);
+        if (it == m_transient.state_history.end())
+            return std::nullopt;
+        state = &*it;
+    }
+    auto prev = m_transient.state_history.find(height - 1);
+    if (state->block_hash != block_hash || state->only_loaded_quorums ||
+        prev == m_transient.state_history.end() || prev->only_loaded_quorums)
+        return std::nullopt;
+
+    // Only the shards of the info map modified by the block need to be looked at
+    state_delta delta;
+    const auto& prev_infos = prev->service_nodes_infos;
+    state->service_nodes_infos.for_each_difference(
+            prev_infos,
+            [&](const crypto::public_key& pubkey, const auto& info) {
+                auto it = prev_infos.find(pubkey);
+                if (it == prev_infos.end()) {
+                    delta.added.push_back(pubkey);
+                    return;
+                }
+                delta.changed.push_back(pubkey);
+                const auto& old = *it->second;
+                if (old.is_active() != info->is_active() ||
+                    old.is_decommissioned() != info->is_decommissioned() ||
+                    old.is_fully_funded() != info->is_fully_funded())
+                    delta.state_changed.push_back(pubkey);
+                if (old.swarm_id != info->swarm_id)
+                    delta.swarm_changed.emplace_back(pubkey, info->swarm_id);
+            },
+            [&](const crypto::public_key& pubkey) { delta.removed.push_back(pubkey); });
+    return delta;
+}
+
 void service_node_list::set_my_service_node_keys(const service_node_keys* keys) {
     std::lock_guard lock(m_sn_mutex);
     m_service_node_keys = keys;
@@ -309,16 +505,17 @@ void service_node_list::set_quorum_history_storage(uint64_t hist_size) {
 
 bool service_node_list::is_service_node(
         const crypto::public_key& pubkey, bool require_active) const {
-    std::lock_guard lock(m_sn_mutex);
-    auto it = m_state.service_nodes_infos.find(pubkey);
-    return it != m_state.service_nodes_infos.end() && (!require_active || it->second->is_active());
+    auto state = state_snapshot();
+    auto it = state->service_nodes_infos.find(pubkey);
+    return it != state->service_nodes_infos.end() && (!require_active || it->second->is_active());
 }
 
 bool service_node_list::is_key_image_locked(
         crypto::key_image const& check_image,
         uint64_t* unlock_height,
         service_node_info::contribution_t* the_locked_contribution) const {
-    for (const auto& pubkey_info : m_state.service_nodes_infos) {
+    auto state = state_snapshot();
+    for (const auto& pubkey_info : state->service_nodes_infos) {
         const service_node_info& info = *pubkey_info.second;
         for (const service_node_info::contributor_t& contributor : info.contributors) {
             for (const service_node_info::contribution_t& contribution :
@@ -338,7 +535,7 @@ bool service_node_list::is_key_image_locked(
 
 std::optional<registration_details> reg_tx_extract_fields(const cryptonote::transaction& tx) {
     cryptonote::tx_extra_service_node_register registration;
-    if (!get_field_from_tx_extra(tx.extra, registration))
+    if (!get_field_from_tx_extra(tx, registration))
         return std::nullopt;
 
     if (registration.public_spend_keys.size() != registration.public_view_keys.size() ||
@@ -430,7 +627,7 @@ static registration_details eth_reg_v2_details(
 static std::optional<registration_details> eth_reg_v2_tx_extract_fields(
         hf hf_version, const cryptonote::transaction& tx) {
     eth::event::NewServiceNodeV2 registration;
-    if (!cryptonote::get_field_from_tx_extra(tx.extra, registration))
+    if (!cryptonote::get_field_from_tx_extra(tx, registration))
         return std::nullopt;
     return eth_reg_v2_details(hf_version, registration);
 }
@@ -720,7 +917,7 @@ bool tx_get_staking_components_and_amounts(
         // would be generated, when they want to spend it in the future.
 
         cryptonote::tx_extra_tx_key_image_proofs key_image_proofs;
-        if (!get_field_from_tx_extra(tx.extra, key_image_proofs)) {
+        if (!get_field_from_tx_extra(tx, key_image_proofs)) {
             log::info(
                     logcat,
                     "TX: Didn't have key image proofs in the tx_extra, rejected on height: {} for "
@@ -850,6 +1047,11 @@ static service_node_info& duplicate_info(std::shared_ptr<const service_node_info
     return *new_ptr;
 }
 
+static service_node_info& duplicate_info(
+        service_nodes_infos_t& infos, service_nodes_infos_t::iterator& it) {
+    return duplicate_info(infos.modify(it));
+}
+
 bool service_node_list::state_t::process_state_change_tx(
         state_set const& state_history,
         state_set const& state_archive,
@@ -875,6 +1077,8 @@ bool service_node_list::state_t::process_state_change_tx(
 
     auto it = state_history.find(state_change.block_height);
     if (it == state_history.end()) {
+        if (sn_list)  // state_archive is sn_list's archive, which might not have been parsed yet
+            sn_list->load_deferred_archive();
         it = state_archive.find(state_change.block_height);
         if (it == state_archive.end()) {
             log::error(
@@ -940,7 +1144,7 @@ bool service_node_list::state_t::process_state_change_tx(
     }
 
     uint64_t block_height = block.get_height();
-    auto& info = duplicate_info(iter->second);
+    auto& info = duplicate_info(service_nodes_infos, iter);
     bool is_me = my_keys && my_keys->pub == key;
 
     // Build a decomm/dereg quorum reason string list if this is a dereg/decom so that we can print
@@ -1171,7 +1375,7 @@ bool service_node_list::state_t::process_key_image_unlock_tx(
     }
 
     cryptonote::tx_extra_tx_key_image_unlock unlock;
-    if (!cryptonote::get_field_from_tx_extra(tx.extra, unlock)) {
+    if (!cryptonote::get_field_from_tx_extra(tx, unlock)) {
         log::info(
                 logcat,
                 "Unlock TX: Didn't have key image unlock in the tx_extra, rejected on height: {} "
@@ -1215,7 +1419,7 @@ bool service_node_list::state_t::process_key_image_unlock_tx(
                         service_nodes::generate_request_stake_unlock_hash(unlock.nonce),
                         cit->key_image_pub_key,
                         unlock.signature)) {
-                duplicate_info(it->second).requested_unlock_height = unlock_height;
+                duplicate_info(service_nodes_infos, it).requested_unlock_height = unlock_height;
                 return true;
             } else {
                 log::info(
@@ -1253,7 +1457,7 @@ bool service_node_list::state_t::is_premature_unlock(
     const service_node_info& node_info = *it->second;
 
     cryptonote::tx_extra_tx_key_image_unlock unlock;
-    if (!cryptonote::get_field_from_tx_extra(tx.extra, unlock))
+    if (!cryptonote::get_field_from_tx_extra(tx, unlock))
         return false;
 
     uint64_t small_contributor_unlock_blocks =
@@ -1594,17 +1798,16 @@ static eth::event::StateChangeVariant get_event_from_tx(const cryptonote::transa
     StateChangeVariant result;
     bool success = false;
     if (tx.type == cryptonote::txtype::ethereum_new_service_node_v2)
-        success = cryptonote::get_field_from_tx_extra(tx.extra, result.emplace<NewServiceNodeV2>());
+        success = cryptonote::get_field_from_tx_extra(tx, result.emplace<NewServiceNodeV2>());
     else if (tx.type == cryptonote::txtype::ethereum_service_node_exit_request)
-        success = cryptonote::get_field_from_tx_extra(
-                tx.extra, result.emplace<ServiceNodeExitRequest>());
+        success = cryptonote::get_field_from_tx_extra(tx, result.emplace<ServiceNodeExitRequest>());
     else if (tx.type == cryptonote::txtype::ethereum_service_node_exit)
-        success = cryptonote::get_field_from_tx_extra(tx.extra, result.emplace<ServiceNodeExit>());
+        success = cryptonote::get_field_from_tx_extra(tx, result.emplace<ServiceNodeExit>());
     else if (tx.type == cryptonote::txtype::ethereum_staking_requirement_updated)
         success = cryptonote::get_field_from_tx_extra(
-                tx.extra, result.emplace<StakingRequirementUpdated>());
+                tx, result.emplace<StakingRequirementUpdated>());
     else if (tx.type == cryptonote::txtype::ethereum_purge_missing_service_node)
-        success = cryptonote::get_field_from_tx_extra(tx.extra, result.emplace<ServiceNodePurge>());
+        success = cryptonote::get_field_from_tx_extra(tx, result.emplace<ServiceNodePurge>());
 
     if (!success)
         result.emplace<std::monostate>();
@@ -1624,12 +1827,12 @@ static std::tuple<crypto::public_key, std::string, uint64_t> eth_tx_info(
     } else if (tx.type == cryptonote::txtype::ethereum_service_node_exit_request) {
         type = "unlock";
         if (eth::event::ServiceNodeExitRequest remreq;
-            cryptonote::get_field_from_tx_extra(tx.extra, remreq) &&
+            cryptonote::get_field_from_tx_extra(tx, remreq) &&
             (pk = snl.find_public_key(remreq.bls_pubkey)))
             type += " (key: {})"_format(pk);
     } else if (tx.type == cryptonote::txtype::ethereum_service_node_exit) {
         type = "exit";
-        if (eth::event::ServiceNodeExit exit; cryptonote::get_field_from_tx_extra(tx.extra, exit) &&
+        if (eth::event::ServiceNodeExit exit; cryptonote::get_field_from_tx_extra(tx, exit) &&
                                               (pk = snl.find_public_key(exit.bls_pubkey))) {
             eth::address op = {};
             snl.for_each_recently_removed_node([&](const auto& node) {
@@ -1643,13 +1846,11 @@ static std::tuple<crypto::public_key, std::string, uint64_t> eth_tx_info(
         }
     } else if (tx.type == cryptonote::txtype::ethereum_staking_requirement_updated) {
         type = "staking requirement";
-        if (eth::event::StakingRequirementUpdated req;
-            cryptonote::get_field_from_tx_extra(tx.extra, req))
+        if (eth::event::StakingRequirementUpdated req; cryptonote::get_field_from_tx_extra(tx, req))
             val = req.staking_requirement;
     } else if (tx.type == cryptonote::txtype::ethereum_purge_missing_service_node) {
         type = "sn purge";
-        if (eth::event::ServiceNodePurge purge;
-            cryptonote::get_field_from_tx_extra(tx.extra, purge))
+        if (eth::event::ServiceNodePurge purge; cryptonote::get_field_from_tx_extra(tx, purge))
             type += " (bls: {})"_format(purge.bls_pubkey);
     }
     return result;
@@ -1710,7 +1911,8 @@ bool service_node_list::state_t::process_confirmed_event(
         cryptonote::hf hf_version,
         uint64_t height,
         uint32_t index,
-        const service_node_keys* my_keys) {
+        const service_node_keys* my_keys,
+        std::unordered_set<eth::bls_public_key>* active_bls) {
 
     if (service_nodes_infos.count(new_sn.sn_pubkey)) {
         log::warning(
@@ -1719,11 +1921,13 @@ bool service_node_list::state_t::process_confirmed_event(
                 new_sn.sn_pubkey);
         return false;
     }
-    if (auto it = std::find_if(
-                service_nodes_infos.begin(),
-                service_nodes_infos.end(),
-                [&new_sn](const auto& p) { return p.second->bls_public_key == new_sn.bls_pubkey; });
-        it != service_nodes_infos.end()) {
+    if (active_bls ? active_bls->count(new_sn.bls_pubkey)
+                   : std::any_of(
+                             service_nodes_infos.begin(),
+                             service_nodes_infos.end(),
+                             [&new_sn](const auto& p) {
+                                 return p.second->bls_public_key == new_sn.bls_pubkey;
+                             })) {
         log::warning(
                 logcat,
                 "Duplicate BLS pubkey ({}) in confirmed service node registration for {}; "
@@ -1755,6 +1959,8 @@ bool service_node_list::state_t::process_confirmed_event(
                     "Confirmed service node registration from ethereum: {} on height: {}",
                     key,
                     height);
+        if (active_bls)
+            active_bls->insert(service_node_info->bls_public_key);
         insert_info(key, std::move(service_node_info));
         return true;
     } catch (const std::exception& e) {
@@ -1825,7 +2031,7 @@ bool service_node_list::state_t::process_confirmed_event(
                 index,
                 unlock_height);
 
-    duplicate_info(it->second).requested_unlock_height = unlock_height;
+    duplicate_info(service_nodes_infos, it).requested_unlock_height = unlock_height;
     return false;  // false => this doesn't affect swarms
 }
 
@@ -2253,7 +2459,7 @@ bool service_node_list::state_t::process_contribution_tx(
     // Successfully Validated
     //
 
-    auto& info = duplicate_info(iter->second);
+    auto& info = duplicate_info(service_nodes_infos, iter);
     if (new_contributor) {
         contributor_position = info.contributors.size();
         info.contributors.emplace_back().address = stake.address;
@@ -2545,6 +2751,45 @@ static bool find_block_in_db(
     return true;
 }
 
+// How many checkpoint heights of verified checkpoints we remember
+static constexpr size_t VERIFIED_CHECKPOINT_HEIGHTS = 256;
+
+bool service_node_list::verify_checkpoint_cached(
+        hf hf_version, const cryptonote::checkpoint_t& checkpoint, const quorum& quorum) const {
+    // Hashing all of this is far cheaper than checking the signatures
+    std::basic_string<unsigned char> buffer;
+    buffer.reserve(
+            2 + sizeof(checkpoint.block_hash) +
+            checkpoint.signatures.size() * (sizeof(uint16_t) + sizeof(crypto::signature)) +
+            quorum.validators.size() * sizeof(crypto::public_key));
+    buffer += static_cast<unsigned char>(hf_version);
+    buffer += static_cast<unsigned char>(checkpoint.type);
+    buffer += tools::view_guts<unsigned char>(checkpoint.block_hash);
+    for (const auto& sig : checkpoint.signatures) {
+        buffer += tools::view_guts<unsigned char>(oxenc::host_to_little(sig.voter_index));
+        buffer += tools::view_guts<unsigned char>(sig.signature);
+    }
+    for (const auto& validator : quorum.validators)
+        buffer += tools::view_guts<unsigned char>(validator);
+    auto digest = crypto::cn_fast_hash(buffer.data(), buffer.size());
+
+    {
+        std::lock_guard lock{m_verified_checkpoints_mutex};
+        if (auto it = m_verified_checkpoints.find(checkpoint.height);
+            it != m_verified_checkpoints.end() && it->second.count(digest))
+            return true;
+    }
+
+    if (!service_nodes::verify_checkpoint(hf_version, checkpoint, quorum))
+        return false;
+
+    std::lock_guard lock{m_verified_checkpoints_mutex};
+    m_verified_checkpoints[checkpoint.height].insert(digest);
+    while (m_verified_checkpoints.size() > VERIFIED_CHECKPOINT_HEIGHTS)
+        m_verified_checkpoints.erase(m_verified_checkpoints.begin());
+    return true;
+}
+
 void service_node_list::verify_block(
         const cryptonote::block& block,
         bool alt_block,
@@ -2571,11 +2816,10 @@ void service_node_list::verify_block(
                             block_type, cryptonote::get_block_hash(block))};
 
         bool failed_checkpoint_verify =
-                !service_nodes::verify_checkpoint(block.major_version, *checkpoint, *quorum);
+                !verify_checkpoint_cached(block.major_version, *checkpoint, *quorum);
         if (alt_block && failed_checkpoint_verify) {
             for (std::shared_ptr<const service_nodes::quorum> alt_quorum : alt_quorums) {
-                if (service_nodes::verify_checkpoint(
-                            block.major_version, *checkpoint, *alt_quorum)) {
+                if (verify_checkpoint_cached(block.major_version, *checkpoint, *alt_quorum)) {
                     failed_checkpoint_verify = false;
                     break;
                 }
@@ -2695,6 +2939,8 @@ void service_node_list::block_add(
         const std::vector<cryptonote::transaction>& txs,
         cryptonote::checkpoint_t const* checkpoint,
         bool skip_verify) {
+    OXEN_TRACE_SPAN(logcat, "service_node_list::block_add");
+    OXEN_ALLOC_SCOPE("service_node_list");
     if (block.major_version < hf::hf9_service_nodes)
         return;
 
@@ -2702,6 +2948,7 @@ void service_node_list::block_add(
     process_block(block, txs);
     if (!skip_verify)
         verify_block(block, false /*alt_block*/, checkpoint);
+    publish_state();
     if (block.has_pulse()) {
         // NOTE: Only record participation if its a block we recently received.
         // Otherwise processing blocks in retrospect/re-loading on restart seeds
@@ -3007,18 +3254,29 @@ service_nodes::quorum generate_pulse_quorum(
 
 static void generate_other_quorums(
         service_node_list::state_t& state,
-        std::vector<pubkey_and_sninfo> const& active_snode_list,
+        service_node_list::state_t::sorted_nodes_t const& sorted_nodes,
+        service_node_list::state_t const* same_alt_state,
         cryptonote::network_type nettype,
         hf hf_version) {
     assert(state.block_hash);
 
+    // An alt chain state for this same block (i.e. we are now switching to that alt chain) was
+    // built from identical inputs, so it already has the quorums we would generate here.
+    if (same_alt_state) {
+        state.quorums.obligations = same_alt_state->quorums.obligations;
+        state.quorums.checkpointing = same_alt_state->quorums.checkpointing;
+        state.quorums.blink = same_alt_state->quorums.blink;
+        return;
+    }
+
     // The two quorums here have different selection criteria: the entire checkpoint quorum and the
     // state change *validators* want only active service nodes, but the state change *workers*
     // (i.e. the nodes to be tested) also include decommissioned service nodes.  (Prior to v12 there
     // are no decommissioned nodes, so this distinction is irrelevant for network concensus).
-    std::vector<pubkey_and_sninfo> decomm_snode_list;
-    if (hf_version >= hf::hf12_checkpointing)
-        decomm_snode_list = state.decommissioned_service_nodes_infos();
+    auto const& active_snode_list = sorted_nodes.active;
+    static const std::vector<pubkey_and_sninfo> no_nodes;
+    auto const& decomm_snode_list =
+            hf_version >= hf::hf12_checkpointing ? sorted_nodes.decommissioned : no_nodes;
 
     quorum_type const max_quorum_type = max_quorum_type_for_hf(hf_version);
     for (int type_int = 0; type_int <= (int)max_quorum_type; type_int++) {
@@ -3156,6 +3414,14 @@ void service_node_list::state_t::update_from_block(
     assert(block.get_height() == height + 1);
     quorums = {};
     auto hf_version = block.major_version;
+    crypto::hash const new_block_hash = cryptonote::get_block_hash(block);
+
+    // If we have already built an alt chain state for this block then its quorums are the ones we
+    // are about to generate, so we can reuse them rather than shuffling everything again.
+    state_t const* same_alt_state = nullptr;
+    if (auto it = alt_states.find(new_block_hash);
+        it != alt_states.end() && it->second.height == height + 1)
+        same_alt_state = &it->second;
 
     //
     // Generate Pulse Quorum and winner before we make any changes to the state because changing the
@@ -3163,22 +3429,28 @@ void service_node_list::state_t::update_from_block(
     //
     crypto::public_key winner_pubkey = get_next_block_leader().key;
     if (hf_version >= hf::hf16_pulse) {
-        if (auto quorum = get_next_pulse_quorum(hf_version, block.pulse.round, db, nettype)) {
+        std::shared_ptr<const quorum> pulse_quorum;
+        if (same_alt_state)
+            pulse_quorum = same_alt_state->quorums.pulse;
+        else if (auto quorum = get_next_pulse_quorum(hf_version, block.pulse.round, db, nettype))
+            pulse_quorum = std::make_shared<service_nodes::quorum>(std::move(*quorum));
+
+        if (pulse_quorum) {
             // NOTE: Send candidate to the back of the list
-            for (size_t quorum_index = 0; quorum_index < quorum->validators.size();
+            for (size_t quorum_index = 0; quorum_index < pulse_quorum->validators.size();
                  quorum_index++) {
-                crypto::public_key const& key = quorum->validators[quorum_index];
+                crypto::public_key const& key = pulse_quorum->validators[quorum_index];
                 service_node_info& new_info = duplicate_info(service_nodes_infos[key]);
                 new_info.pulse_sorter.last_height_validating_in_quorum = height;
                 new_info.pulse_sorter.quorum_index = quorum_index;
             }
 
-            quorums.pulse = std::make_shared<service_nodes::quorum>(std::move(*quorum));
+            quorums.pulse = std::move(pulse_quorum);
         }
     }
 
     ++height;
-    block_hash = cryptonote::get_block_hash(block);
+    block_hash = new_block_hash;
 
     // Remove incomplete oxen registrations at hf20, as oxen contributions are no
     // longer allowed at this point.  Contributions to these nodes will be unlocked.
@@ -3242,7 +3514,7 @@ void service_node_list::state_t::update_from_block(
     if (auto it = service_nodes_infos.find(winner_pubkey); it != service_nodes_infos.end()) {
         // set the winner as though it was re-registering at transaction index=UINT32_MAX for
         // this block
-        auto& info = duplicate_info(it->second);
+        auto& info = duplicate_info(service_nodes_infos, it);
         info.last_reward_block_height = height;
         info.last_reward_transaction_index = UINT32_MAX;
     }
@@ -3261,6 +3533,11 @@ void service_node_list::state_t::update_from_block(
 
         const uint32_t vote_weight =
                 unconfirmed_l2_tx::FULL_SCORE / (block.has_pulse() ? 1 + block.pulse.round : 1);
+
+        // Tally the whole block's votes first, then apply the events that they confirmed in one
+        // pass, so that a burst of events (such as a mass registration) shares the work of
+        // checking them against the current list.
+        std::vector<std::pair<uint32_t, crypto::hash>> confirmed;
         auto unconf_it = unconfirmed_l2_txes.begin();
         for (uint32_t i = 0; i < block.l2_votes.size(); i++) {
             bool vote = block.l2_votes[i];
@@ -3279,20 +3556,7 @@ void service_node_list::state_t::update_from_block(
 
                 if (*done) {
                     log::info(logcat, "State change tx {} confirmed by votes", txhash);
-
-                    std::string fail;
-                    auto event = eth::extract_event(sn_list->blockchain.db().get_tx(txhash), &fail);
-                    if (std::holds_alternative<std::monostate>(event))
-                        throw oxen::traced<std::runtime_error>{
-                                "Internal error: did not find state change tx data in blockchain database: {}"_format(
-                                        fail)};
-                    need_swarm_update += std::visit(
-                            [&](const auto& e) {
-                                return process_confirmed_event(
-                                        e, nettype, hf_version, height, i, my_keys);
-                            },
-                            event);
-
+                    confirmed.emplace_back(i, txhash);
                 } else {
                     log::warning(
                             logcat,
@@ -3308,6 +3572,37 @@ void service_node_list::state_t::update_from_block(
                 ++unconf_it;
             }
         }
+
+        // BLS pubkeys of the registered nodes, for spotting duplicate registrations.  Collected
+        // (once) when we reach the first registration, and dropped again after any other event as
+        // that may have removed a node.
+        std::optional<std::unordered_set<eth::bls_public_key>> active_bls;
+        for (const auto& [i, txhash] : confirmed) {
+            std::string fail;
+            auto event = eth::extract_event(sn_list->blockchain.db().get_tx(txhash), &fail);
+            if (std::holds_alternative<std::monostate>(event))
+                throw oxen::traced<std::runtime_error>{
+                        "Internal error: did not find state change tx data in blockchain database: {}"_format(
+                                fail)};
+            need_swarm_update += std::visit(
+                    [&]<typename Event>(const Event& e) {
+                        if constexpr (std::is_same_v<Event, eth::event::NewServiceNodeV2>) {
+                            if (!active_bls) {
+                                active_bls.emplace();
+                                active_bls->reserve(service_nodes_infos.size() + confirmed.size());
+                                for (const auto& [pk, info] : service_nodes_infos)
+                                    active_bls->insert(info->bls_public_key);
+                            }
+                            return process_confirmed_event(
+                                    e, nettype, hf_version, height, i, my_keys, &*active_bls);
+                        } else {
+                            active_bls.reset();
+                            return process_confirmed_event(
+                                    e, nettype, hf_version, height, i, my_keys);
+                        }
+                    },
+                    event);
+        }
     }
 
     //
@@ -3363,34 +3658,70 @@ void service_node_list::state_t::update_from_block(
         }
     }
 
-    // Filtered pubkey-sorted vector of service nodes that are active (fully funded and *not*
-    // decommissioned).
-    std::vector<pubkey_and_sninfo> active_snode_list = sort_and_filter(
-            service_nodes_infos, [](const service_node_info& info) { return info.is_active(); });
+    // Filtered pubkey-sorted vectors of service nodes that are active (fully funded and *not*
+    // decommissioned) and that are decommissioned.
+    auto sorted = update_sorted_nodes();
+    auto const& active_snode_list = sorted->active;
     if (need_swarm_update) {
-        crypto::hash const block_hash = cryptonote::get_block_hash(block);
         uint64_t seed = 0;
         std::memcpy(&seed, block_hash.data(), sizeof(seed));
 
-        /// Gather existing swarms from infos
-        swarm_snode_map_t existing_swarms;
-        for (const auto& key_info : active_snode_list)
-            existing_swarms[key_info.second->swarm_id].push_back(key_info.first);
+        /// Gather existing swarms from infos: if we have the membership from the last swarm update
+        /// then we only need to apply the service nodes that have changed since then.
+        auto cache = std::make_shared<swarm_cache_t>();
+        if (swarm_cache) {
+            auto& old_infos = swarm_cache->infos;
+            auto active_swarm = [](const service_node_info& info) -> std::optional<swarm_id_t> {
+                if (info.is_active())
+                    return info.swarm_id;
+                return std::nullopt;
+            };
+            cache->swarms = swarm_cache->swarms;
+            service_nodes_infos.for_each_difference(
+                    old_infos,
+                    [&](const crypto::public_key& pubkey, const auto& info) {
+                        auto old = old_infos.find(pubkey);
+                        move_swarm_member(
+                                cache->swarms,
+                                pubkey,
+                                old != old_infos.end() ? active_swarm(*old->second) : std::nullopt,
+                                active_swarm(*info));
+                    },
+                    [&](const crypto::public_key& pubkey) {
+                        move_swarm_member(
+                                cache->swarms,
+                                pubkey,
+                                active_swarm(*old_infos.at(pubkey)),
+                                std::nullopt);
+                    });
+        } else {
+            for (const auto& key_info : active_snode_list)
+                cache->swarms[key_info.second->swarm_id].push_back(key_info.first);
+        }
+        swarm_snode_map_t existing_swarms = cache->swarms;
 
         calc_swarm_changes(existing_swarms, seed);
 
         /// Apply changes
         for (const auto& [swarm_id, snodes] : existing_swarms) {
             for (const auto& snode : snodes) {
-                auto& sn_info_ptr = service_nodes_infos.at(snode);
-                if (sn_info_ptr->swarm_id == swarm_id)
+                auto it = service_nodes_infos.find(snode);
+                auto old_swarm_id = it->second->swarm_id;
+                if (old_swarm_id == swarm_id)
                     continue;  /// nothing changed for this snode
-                duplicate_info(sn_info_ptr).swarm_id = swarm_id;
+                duplicate_info(service_nodes_infos, it).swarm_id = swarm_id;
+                move_swarm_member(cache->swarms, snode, old_swarm_id, swarm_id);
             }
         }
+
+        cache->infos = service_nodes_infos;
+        swarm_cache = std::move(cache);
     }
-    generate_other_quorums(*this, active_snode_list, nettype, hf_version);
+    generate_other_quorums(*this, *sorted, same_alt_state, nettype, hf_version);
+    // Pick up the swarm changes, so that the next block starts with an up-to-date sorted list
+    update_sorted_nodes();
     next_block_leader_cache.reset();
+    payable_reward_table_cache.reset();
     log::debug(
             logcat,
             "Updated state from block {}; block_leader was {}, now {}",
@@ -3472,6 +3803,12 @@ void service_node_list::process_block(
 void service_node_list::blockchain_detached(uint64_t height) {
     std::lock_guard lock(m_sn_mutex);
 
+    {
+        std::lock_guard vc_lock{m_verified_checkpoints_mutex};
+        m_verified_checkpoints.erase(
+                m_verified_checkpoints.lower_bound(height), m_verified_checkpoints.end());
+    }
+
     uint64_t revert_to_height = height - 1;
     bool reinitialise = false;
     bool using_archive = false;
@@ -3485,6 +3822,7 @@ void service_node_list::blockchain_detached(uint64_t height) {
 
     // Try finding the next closest old state at 10k intervals
     if (reinitialise) {
+        load_deferred_archive();
         uint64_t prev_interval =
                 revert_to_height - (revert_to_height % STORE_LONG_TERM_STATE_INTERVAL);
         auto it = m_transient.state_archive.find(prev_interval);
@@ -3507,6 +3845,16 @@ void service_node_list::blockchain_detached(uint64_t height) {
     auto it = std::prev(history.end());
     m_state = std::move(*it);
     history.erase(it);
+
+    // Stored state records above the new top are from the detached blocks
+    if (auto& stored = m_transient.stored_state_height; stored && *stored >= m_state.height) {
+        if (m_state.height > 0)
+            stored = m_state.height - 1;
+        else
+            stored.reset();
+    }
+
+    publish_state();
 }
 
 std::vector<crypto::public_key> service_node_list::state_t::get_expired_nodes(
@@ -4165,7 +4513,8 @@ static service_node_list::quorum_for_serialization serialize_quorum_state(
 static service_node_list::state_serialized serialize_service_node_state_object(
         hf hf_version,
         service_node_list::state_t const& state,
-        bool only_serialize_quorums = false) {
+        bool only_serialize_quorums = false,
+        bool include_infos = true) {
     service_node_list::state_serialized result = {};
     result.height = state.height;
     result.staking_requirement = state.staking_requirement;
@@ -4178,15 +4527,92 @@ static service_node_list::state_serialized serialize_service_node_state_object(
     if (only_serialize_quorums)
         return result;
 
-    result.infos.reserve(state.service_nodes_infos.size());
-    for (const auto& kv_pair : state.service_nodes_infos)
-        result.infos.emplace_back(kv_pair);
+    if (include_infos) {
+        result.infos.reserve(state.service_nodes_infos.size());
+        for (const auto& kv_pair : state.service_nodes_infos)
+            result.infos.emplace_back(kv_pair);
+    }
 
     result.key_image_blacklist = state.key_image_blacklist;
     result.block_hash = state.block_hash;
     return result;
 }
 
+// Builds the db record for `state`: a delta against `prev` (which must be the state of the previous
+// height) if given, otherwise a checkpoint.
+static service_node_list::state_record_serialized serialize_state_record(
+        hf hf_version,
+        service_node_list::state_t const& state,
+        service_node_list::state_t const* prev) {
+    service_node_list::state_record_serialized result = {};
+    result.checkpoint = !prev;
+    if (result.checkpoint) {
+        result.state = serialize_service_node_state_object(hf_version, state);
+        return result;
+    }
+
+    result.state = serialize_service_node_state_object(
+            hf_version, state, false /*only_serialize_quorums*/, false /*include_infos*/);
+    // Infos are only ever replaced (see duplicate_info), never modified in place once shared with
+    // an older state, so comparing the pointers is enough to find the changed ones.
+    state.service_nodes_infos.for_each_difference(
+            prev->service_nodes_infos,
+            [&](const crypto::public_key& pubkey, const auto& info) {
+                result.state.infos.emplace_back(pubkey_and_sninfo{pubkey, info});
+            },
+            [&](const crypto::public_key& pubkey) { result.removed.push_back(pubkey); });
+    return result;
+}
+
+void service_node_list::store_state_records(hf hf_version) {
+    auto& db = blockchain.db();
+    auto& stored = m_transient.stored_state_height;
+    auto& checkpoints = m_transient.stored_checkpoints;
+
+    // Anything above the stored height is either stale (from before a reorg) or the current height
+    // (which can still change before the next block), so gets rewritten.
+    uint64_t write_from = stored ? *stored + 1 : 0;
+    db.remove_service_node_states_from(write_from);
+    checkpoints.erase(checkpoints.lower_bound(write_from), checkpoints.end());
+
+    size_t written = 0;
+    const state_t* prev = nullptr;
+    auto write = [&](const state_t& state) {
+        if (state.height >= write_from) {
+            bool delta = prev && !prev->only_loaded_quorums && !state.only_loaded_quorums &&
+                         prev->height + 1 == state.height &&
+                         state.height % STORE_STATE_CHECKPOINT_INTERVAL != 0;
+            auto record = serialize_state_record(hf_version, state, delta ? prev : nullptr);
+            serialization::binary_string_archiver ba;
+            serialization::serialize(ba, record);
+            db.set_service_node_state(state.height, ba.str());
+            if (record.checkpoint && !state.only_loaded_quorums)
+                checkpoints.insert(state.height);
+            written++;
+        }
+        prev = &state;
+    };
+    for (const auto& state : m_transient.state_history)
+        write(state);
+    write(m_state);
+
+    if (m_state.height > 0)
+        stored = m_state.height - 1;
+    else
+        stored.reset();
+
+    // Keep records from the newest checkpoint that the oldest state we hold can be replayed from
+    uint64_t oldest = m_transient.state_history.empty() ? m_state.height
+                                                        : m_transient.state_history.begin()->height;
+    if (auto it = checkpoints.upper_bound(oldest); it != checkpoints.begin()) {
+        --it;
+        db.remove_service_node_states_before(*it);
+        checkpoints.erase(checkpoints.begin(), it);
+    }
+
+    log::debug(logcat, "Stored {} service node state records from height {}", written, write_from);
+}
+
 bool service_node_list::store() {
     if (!blockchain.has_db())
         return false;  // Haven't been initialized yet
@@ -4207,6 +4633,11 @@ bool service_node_list::store() {
         serialize_entry->version = serialize_version;
     }
 
+    // Both of these get rewritten in full, so need everything that load() deferred
+    if (m_transient.state_added_to_archive)
+        load_deferred_archive();
+    load_deferred_quorums();
+
     m_transient.cache_short_term_data.quorum_states.reserve(m_transient.old_quorum_states.size());
     for (const quorums_by_height& entry : m_transient.old_quorum_states)
         m_transient.cache_short_term_data.quorum_states.push_back(
@@ -4218,25 +4649,6 @@ bool service_node_list::store() {
                     serialize_service_node_state_object(hf_version, it));
     }
 
-    // NOTE: A state_t may reference quorums up to (VOTE_LIFETIME
-    // + VOTE_OR_TX_VERIFY_HEIGHT_BUFFER) blocks back. So in the
-    // (MAX_SHORT_TERM_STATE_HISTORY | 2nd oldest checkpoint) window of states we store, the
-    // first (VOTE_LIFETIME + VOTE_OR_TX_VERIFY_HEIGHT_BUFFER) states we only
-    // store their quorums, such that the following states have quorum
-    // information preceeding it.
-
-    uint64_t const max_short_term_height =
-            short_term_state_cull_height(hf_version, (m_state.height - 1)) + VOTE_LIFETIME +
-            VOTE_OR_TX_VERIFY_HEIGHT_BUFFER;
-    for (auto it = m_transient.state_history.begin();
-         it != m_transient.state_history.end() && it->height <= max_short_term_height;
-         it++) {
-        // TODO(oxen): There are 2 places where we convert a state_t to be a serialized state_t
-        // without quorums. We should only do this in one location for clarity.
-        m_transient.cache_short_term_data.states.push_back(serialize_service_node_state_object(
-                hf_version, *it, it->height < max_short_term_height /*only_serialize_quorums*/));
-    }
-
     m_transient.cache_data_blob.clear();
     if (m_transient.state_added_to_archive) {
         serialization::binary_string_archiver ba;
@@ -4270,11 +4682,19 @@ bool service_node_list::store() {
             return false;
         }
         m_transient.cache_data_blob.append(ba.str());
-        {
-            auto& db = blockchain.db();
-            cryptonote::db_wtxn_guard txn_guard{db};
-            db.set_service_node_data(m_transient.cache_data_blob, false /*long_term*/);
-        }
+    }
+
+    // The short-term blob now only carries the version and the optional quorum history; the recent
+    // states themselves are written per height, in the same transaction.
+    try {
+        auto& db = blockchain.db();
+        cryptonote::db_wtxn_guard txn_guard{db};
+        db.set_service_node_data(m_transient.cache_data_blob, false /*long_term*/);
+        store_state_records(hf_version);
+    } catch (const std::exception& e) {
+        log::error(logcat, "Failed to store service node info: {}", e.what());
+        m_transient.stored_state_height.reset();
+        return false;
     }
 
     m_transient.state_added_to_archive = false;
@@ -4560,6 +4980,10 @@ bool service_node_list::handle_uptime_proof(
         return false;
     }
 
+    // From here on every copy of this proof gets rejected (as a duplicate) or has nothing new, so
+    // we can skip the work for any further copies that get relayed to us.
+    record_seen_uptime_proof(proof->proof_hash);
+
     auto& iproof = proofs[proof->pubkey];
 
     if (now <= std::chrono::system_clock::from_time_t(iproof.timestamp) +
@@ -4623,8 +5047,9 @@ bool service_node_list::handle_uptime_proof(
         // keys of a node will be available in the registration and updated when a node is
         // registered.
         if (it->second->bls_public_key != proof->pubkey_bls) {
-            auto& info = duplicate_info(it->second);
+            auto& info = duplicate_info(m_state.service_nodes_infos, it);
             info.bls_public_key = proof->pubkey_bls;
+            publish_state();
         }
     }
 
@@ -4658,6 +5083,25 @@ bool service_node_list::handle_uptime_proof(
     return true;
 }
 
+bool service_node_list::uptime_proof_seen(const crypto::hash& proof_hash) const {
+    std::lock_guard lock{m_seen_proofs_mutex};
+    auto it = m_seen_proofs.find(proof_hash);
+    return it != m_seen_proofs.end() && std::chrono::steady_clock::now() < it->second;
+}
+
+void service_node_list::record_seen_uptime_proof(const crypto::hash& proof_hash) {
+    // Copies older than this fail the timestamp check anyway, so there's no point remembering them
+    // for longer.
+    auto expiry = 2 * get_config(blockchain.nettype()).UPTIME_PROOF_TOLERANCE;
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{m_seen_proofs_mutex};
+    if (now - m_seen_proofs_last_pruned >= SEEN_PROOFS_PRUNING_INTERVAL) {
+        std::erase_if(m_seen_proofs, [&now](const auto& seen) { return seen.second <= now; });
+        m_seen_proofs_last_pruned = now;
+    }
+    m_seen_proofs[proof_hash] = now + expiry;
+}
+
 void service_node_list::cleanup_proofs() {
     log::debug(logcat, "Cleaning up expired SN proofs");
     auto locks = tools::unique_locks(m_sn_mutex, blockchain);
@@ -4698,8 +5142,8 @@ crypto::public_key service_node_list::find_public_key(
                 blockchain.nettype(),
                 feature::SN_PK_IS_ED25519,
                 blockchain.get_current_blockchain_height())) {
-        std::lock_guard lock{m_sn_mutex};
-        if (auto it = m_state.x25519_map.find(x25519); it != m_state.x25519_map.end())
+        auto state = state_snapshot();
+        if (auto it = state->x25519_map.find(x25519); it != state->x25519_map.end())
             return it->second;
 
     } else {
@@ -4719,24 +5163,23 @@ crypto::public_key service_node_list::state_t::find_public_key(
 }
 
 crypto::public_key service_node_list::find_public_key(const eth::bls_public_key& bls_pubkey) const {
-    std::lock_guard lock{m_sn_mutex};
-    return m_state.find_public_key(bls_pubkey);
+    return state_snapshot()->find_public_key(bls_pubkey);
 }
 
 crypto::public_key service_node_list::find_public_key_registered(
         const eth::bls_public_key& bls_pubkey) const {
-    std::lock_guard lock{m_sn_mutex};
-    auto pk = m_state.find_public_key(bls_pubkey);
-    if (pk && !m_state.service_nodes_infos.count(pk))
+    auto state = state_snapshot();
+    auto pk = state->find_public_key(bls_pubkey);
+    if (pk && !state->service_nodes_infos.count(pk))
         pk = crypto::null<crypto::public_key>;
     return pk;
 }
 
 crypto::public_key service_node_list::get_random_pubkey() {
-    std::lock_guard lock{m_sn_mutex};
+    auto state = state_snapshot();
     if (auto it = tools::select_randomly(
-                m_state.service_nodes_infos.begin(), m_state.service_nodes_infos.end());
-        it != m_state.service_nodes_infos.end()) {
+                state->service_nodes_infos.begin(), state->service_nodes_infos.end());
+        it != state->service_nodes_infos.end()) {
         return it->first;
     }
     return crypto::null<crypto::public_key>;
@@ -4842,8 +5285,7 @@ std::vector<bool> service_node_list::l2_pending_state_votes() const {
 }
 
 uint64_t service_node_list::get_staking_requirement() const {
-    std::lock_guard lock{m_sn_mutex};
-    return m_state.get_staking_requirement(blockchain.nettype());
+    return state_snapshot()->get_staking_requirement(blockchain.nettype());
 }
 
 uint64_t service_node_list::state_t::get_staking_requirement(
@@ -5004,6 +5446,57 @@ service_node_list::state_t::state_t(service_node_list& snl, state_serialized&& s
     quorums = quorum_for_serialization_to_quorum_manager(state.quorums);
 }
 
+service_node_list::state_t::state_t(
+        const state_t& prev,
+        state_serialized&& state,
+        const std::vector<crypto::public_key>& removed) :
+        state_t{prev} {
+    state_t changes{*prev.sn_list, std::move(state)};
+    block_hash = changes.block_hash;
+    only_loaded_quorums = changes.only_loaded_quorums;
+    key_image_blacklist = std::move(changes.key_image_blacklist);
+    height = changes.height;
+    block_leader = changes.block_leader;
+    unconfirmed_l2_txes = std::move(changes.unconfirmed_l2_txes);
+    staking_requirement = changes.staking_requirement;
+    quorums = std::move(changes.quorums);
+
+    // The alt pk maps are derived from the infos' keys and the recently removed nodes, so we only
+    // need to rebuild them (rather than keep sharing prev's) if one of those changed.
+    auto nettype = sn_list->blockchain.nettype();
+    bool rebuild_maps = !removed.empty() ||
+                        cryptonote::is_hard_fork_at_least(nettype, feature::ETH_BLS, height) !=
+                                cryptonote::is_hard_fork_at_least(
+                                        nettype, feature::ETH_BLS, prev.height) ||
+                        !std::equal(
+                                recently_removed_nodes.begin(),
+                                recently_removed_nodes.end(),
+                                changes.recently_removed_nodes.begin(),
+                                changes.recently_removed_nodes.end(),
+                                [](const auto& a, const auto& b) {
+                                    return a.service_node_pubkey == b.service_node_pubkey &&
+                                           a.info.bls_public_key == b.info.bls_public_key;
+                                });
+    recently_removed_nodes = std::move(changes.recently_removed_nodes);
+
+    for (const auto& pubkey : removed)
+        service_nodes_infos.erase(pubkey);
+    for (const auto& [pubkey, info] : changes.service_nodes_infos) {
+        if (!rebuild_maps) {
+            auto it = service_nodes_infos.find(pubkey);
+            rebuild_maps = it == service_nodes_infos.end() ||
+                           it->second->bls_public_key != info->bls_public_key;
+        }
+        service_nodes_infos[pubkey] = info;
+    }
+
+    if (rebuild_maps) {
+        x25519_map.clear();
+        bls_map.clear();
+        initialize_alt_pk_maps();
+    }
+}
+
 void service_node_list::state_t::initialize_alt_pk_maps() {
     // Compute the x25519 -> pubkey mappings for this state for post-merged-pubkey hardforks.
     // (Before that the primary and Ed keys might differ, and we need the Ed key to get the correct
@@ -5082,6 +5575,42 @@ service_nodes_infos_t::iterator service_node_list::state_t::erase_info(
     return service_nodes_infos.erase(it);
 }
 
+// Reads just the version and the number of old quorum states from the front of a serialized
+// data_for_serialization, without parsing the rest.
+static std::pair<service_node_list::data_for_serialization::version_t, size_t> peek_short_term_data(
+        std::string_view blob) {
+    using version_t = service_node_list::data_for_serialization::version_t;
+    serialization::binary_string_unarchiver ar{blob};
+    version_t version;
+    serialization::field_varint(
+            ar, "version", version, [](auto v) { return v < version_t::count; });
+    size_t count;
+    auto arr = ar.begin_array(count);
+    return {version, count};
+}
+
+bool service_node_list::append_quorum_states(
+        std::deque<quorums_by_height>& out,
+        const std::vector<quorum_for_serialization>& quorum_states,
+        uint64_t min_height) {
+    uint64_t last_loaded_height = 0;
+    for (const auto& states : quorum_states) {
+        if (states.height < min_height)
+            continue;
+
+        if (states.height <= last_loaded_height) {
+            log::warning(
+                    logcat,
+                    "Serialised quorums is not stored in ascending order by height in DB, "
+                    "failed to load from DB");
+            return false;
+        }
+        last_loaded_height = states.height;
+        out.emplace_back(states.height, quorum_for_serialization_to_quorum_manager(states));
+    }
+    return true;
+}
+
 bool service_node_list::load(const uint64_t current_height) {
     log::info(logcat, "service_node_list::load()");
     reset(false);
@@ -5089,23 +5618,16 @@ bool service_node_list::load(const uint64_t current_height) {
         return false;
     }
 
-    // NOTE: Deserialize long term state history (optional, if it doesn't exist- this node can't
+    // NOTE: Read long term state history (optional, if it doesn't exist- this node can't
     // roll-back but this is not considered fatal. It will have to recompute the rollback by jumping
-    // back and processing blocks forward).
+    // back and processing blocks forward).  It is only parsed when first needed.
     uint64_t bytes_loaded = 0;
     auto& db = blockchain.db();
     cryptonote::db_rtxn_guard txn_guard{db};
     std::string blob;
     if (db.get_service_node_data(blob, true /*long_term*/)) {
         bytes_loaded += blob.size();
-        try {
-            data_for_serialization data_in = {};
-            serialization::parse_binary(blob, data_in);
-            for (state_serialized& entry : data_in.states)
-                m_transient.state_archive.emplace_hint(
-                        m_transient.state_archive.end(), *this, std::move(entry));
-        } catch (...) {
-        }
+        m_transient.deferred_archive = std::move(blob);
     }
 
     // NOTE: Deserialize short term state history
@@ -5114,8 +5636,13 @@ bool service_node_list::load(const uint64_t current_height) {
 
     bytes_loaded += blob.size();
     data_for_serialization data_in = {};
+    size_t quorum_count = 0;
     try {
-        serialization::parse_binary(blob, data_in);
+        std::tie(data_in.version, quorum_count) = peek_short_term_data(blob);
+        // From version 5 the blob holds nothing but the quorum history, which we parse on first
+        // use; before that it also holds the recent states, so we need all of it now.
+        if (data_in.version < data_for_serialization::version_t::version_5_state_records)
+            serialization::parse_binary(blob, data_in);
     } catch (const std::exception& e) {
         log::error(logcat, "Failed to parse service node data from blob: {}", e.what());
         return false;
@@ -5136,34 +5663,25 @@ bool service_node_list::load(const uint64_t current_height) {
         return false;
     }
 
-    if (data_in.states.empty())
-        return false;
-
-    {
-        const uint64_t hist_state_from_height = current_height - m_store_quorum_history;
-        uint64_t last_loaded_height = 0;
-        for (auto& states : data_in.quorum_states) {
-            if (states.height < hist_state_from_height)
-                continue;
-
-            quorums_by_height entry = {};
-            entry.height = states.height;
-            entry.quorums = quorum_for_serialization_to_quorum_manager(states);
-
-            if (states.height <= last_loaded_height) {
-                log::warning(
-                        logcat,
-                        "Serialised quorums is not stored in ascending order by height in DB, "
-                        "failed to load from DB");
-                return false;
-            }
-            last_loaded_height = states.height;
-            m_transient.old_quorum_states.push_back(entry);
+    const uint64_t hist_state_from_height = current_height - m_store_quorum_history;
+    if (data_in.version >= data_for_serialization::version_t::version_5_state_records) {
+        if (!load_state_records(bytes_loaded))
+            return false;
+        if (quorum_count > 0) {
+            m_transient.deferred_quorum_states = std::move(blob);
+            m_transient.deferred_quorum_count = quorum_count;
+            m_transient.deferred_quorum_min_height = hist_state_from_height;
         }
-    }
+    } else {
+        // Older format, with the recent states in the short-term blob.  The next store() rewrites
+        // them as per-height records.
+        if (!append_quorum_states(
+                    m_transient.old_quorum_states, data_in.quorum_states, hist_state_from_height))
+            return false;
+
+        if (data_in.states.empty())
+            return false;
 
-    {
-        assert(data_in.states.size() > 0);
         size_t const last_index = data_in.states.size() - 1;
         if (data_in.states[last_index].only_stored_quorums) {
             log::warning(logcat, "Unexpected last serialized state only has quorums loaded");
@@ -5199,16 +5717,125 @@ bool service_node_list::load(const uint64_t current_height) {
     log::info(globallogcat, "Service node data loaded successfully, height: {}", m_state.height);
     log::info(
             globallogcat,
-            "{} nodes and {} recent states loaded, {} historical states loaded, ({})",
+            "{} nodes and {} recent states loaded ({})",
             m_state.service_nodes_infos.size(),
             m_transient.state_history.size(),
-            m_transient.state_archive.size(),
             tools::get_human_readable_bytes(bytes_loaded));
 
     log::info(logcat, "service_node_list::load() returning success");
     return true;
 }
 
+bool service_node_list::load_state_records(uint64_t& bytes_loaded) {
+    std::optional<state_t> last;
+    std::set<uint64_t> checkpoints;
+    bool valid = true;
+    blockchain.db().for_all_service_node_states([&](uint64_t height, std::string_view data) {
+        bytes_loaded += data.size();
+        state_record_serialized record = {};
+        try {
+            serialization::parse_binary(data, record);
+        } catch (const std::exception& e) {
+            log::error(
+                    logcat,
+                    "Failed to parse service node state record at height {}: {}",
+                    height,
+                    e.what());
+            return valid = false;
+        }
+
+        if (record.state.height != height ||
+            (!record.checkpoint &&
+             !(last && !last->only_loaded_quorums && last->height + 1 == height))) {
+            log::error(logcat, "Service node state record at height {} does not follow on", height);
+            return valid = false;
+        }
+
+        state_t state = record.checkpoint
+                              ? state_t{*this, std::move(record.state)}
+                              : state_t{*last, std::move(record.state), record.removed};
+        if (!state.block_hash)
+            state.block_hash = blockchain.get_block_id_by_height(height);
+        if (record.checkpoint && !state.only_loaded_quorums)
+            checkpoints.insert(height);
+
+        if (last)
+            m_transient.state_history.emplace_hint(
+                    m_transient.state_history.end(), std::move(*last));
+        last = std::move(state);
+        return true;
+    });
+
+    if (!valid || !last)
+        return false;
+    if (last->only_loaded_quorums) {
+        log::warning(logcat, "Unexpected last stored state only has quorums loaded");
+        return false;
+    }
+
+    m_state = std::move(*last);
+    if (m_state.height > 0)
+        m_transient.stored_state_height = m_state.height - 1;
+    m_transient.stored_checkpoints = std::move(checkpoints);
+    return true;
+}
+
+void service_node_list::load_deferred_archive() {
+    auto& blob = m_transient.deferred_archive;
+    if (blob.empty())
+        return;
+
+    auto started = std::chrono::steady_clock::now();
+    size_t loaded = 0;
+    try {
+        data_for_serialization data_in = {};
+        serialization::parse_binary(blob, data_in);
+        for (state_serialized& entry : data_in.states)
+            // Anything already in the archive was added since startup and takes precedence
+            loaded += m_transient.state_archive.emplace(*this, std::move(entry)).second;
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to parse stored service node state archive: {}", e.what());
+    }
+    std::string{}.swap(blob);
+    log::debug(
+            logcat,
+            "Loaded {} archived service node states in {}",
+            loaded,
+            tools::friendly_duration(std::chrono::steady_clock::now() - started));
+}
+
+void service_node_list::load_deferred_quorums() {
+    auto& blob = m_transient.deferred_quorum_states;
+    if (blob.empty())
+        return;
+
+    std::deque<quorums_by_height> loaded;
+    try {
+        data_for_serialization data_in = {};
+        serialization::parse_binary(blob, data_in);
+        // Quorums culled from the state history since startup are already in old_quorum_states
+        // and come after all of the stored ones.
+        if (!m_transient.old_quorum_states.empty())
+            std::erase_if(data_in.quorum_states, [&](const auto& q) {
+                return q.height >= m_transient.old_quorum_states.front().height;
+            });
+        if (!append_quorum_states(
+                    loaded, data_in.quorum_states, m_transient.deferred_quorum_min_height))
+            loaded.clear();
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to parse stored quorum history: {}", e.what());
+        loaded.clear();
+    }
+    std::string{}.swap(blob);
+    m_transient.deferred_quorum_count = 0;
+
+    auto& quorums = m_transient.old_quorum_states;
+    quorums.insert(quorums.begin(), loaded.begin(), loaded.end());
+    if (quorums.size() > m_store_quorum_history)
+        quorums.erase(quorums.begin(), quorums.begin() + (quorums.size() - m_store_quorum_history));
+    log::debug(logcat, "Loaded {} stored old quorums", loaded.size());
+}
+
 void service_node_list::reset(bool delete_db_entry) {
     m_transient = {};
     m_state = state_t{this};
@@ -5224,6 +5851,8 @@ void service_node_list::reset(bool delete_db_entry) {
     // ETH exits, a 'delayed_payment' row is added to the DB. If we _don't_ reset the SQL DB then we
     // double up on exit payments to be handed to them.
     blockchain.sqlite_db().reset_database();
+
+    publish_state();
 }
 
 size_t service_node_info::total_num_locked_contributions() const {
@@ -32,11 +32,16 @@
 #include <concepts>
 #include <iterator>
 #include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <string_view>
 #include <type_traits>
+#include <variant>
+#include <unordered_set>
 
+#include "common/cow_map.h"
 #include "common/util.h"
 #include "crypto/crypto.h"
 #include "crypto/eth.h"
@@ -47,6 +52,7 @@
 #include "cryptonote_core/ethereum_transactions.h"
 #include "cryptonote_core/service_node_quorum_cop.h"
 #include "cryptonote_core/service_node_rules.h"
+#include "cryptonote_core/service_node_swarm.h"
 #include "cryptonote_core/service_node_voting.h"
 #include "l2_tracker/events.h"
 #include "networks.h"
@@ -395,8 +401,9 @@ struct service_node_address {
 };
 
 using pubkey_and_sninfo = std::pair<crypto::public_key, std::shared_ptr<const service_node_info>>;
+// Copy-on-write, so that the state_t kept for each recent block shares everything but the changes
 using service_nodes_infos_t =
-        std::unordered_map<crypto::public_key, std::shared_ptr<const service_node_info>>;
+        tools::cow_unordered_map<crypto::public_key, std::shared_ptr<const service_node_info>>;
 
 struct service_node_pubkey_info {
     crypto::public_key pubkey;
@@ -464,6 +471,32 @@ struct payout {
     std::vector<payout_entry> payouts;
 };
 
+/// The reward shares of a set of service nodes, laid out in contiguous arrays (rather than behind
+/// each node's shared service_node_info) for distributing batched rewards across them.
+struct reward_table {
+    using recipient = std::variant<eth::address, cryptonote::account_public_address>;
+
+    // One element per node:
+    std::vector<uint64_t> operator_portions;  // operator fee, out of old::STAKING_PORTIONS
+    std::vector<recipient> operator_recipient;
+    std::vector<uint64_t> total_contributed;
+    // Node i's contributors are the elements from contributors_end[i-1] (0 for the first node) up
+    // to contributors_end[i] of the arrays below.
+    std::vector<size_t> contributors_end;
+
+    // One element per contributor of each node:
+    std::vector<recipient> contributor_recipient;
+    std::vector<uint64_t> contributor_amount;
+
+    size_t size() const { return operator_portions.size(); }
+
+    // Appends a node, paying it to its ethereum addresses (from HF21) or its wallet addresses.
+    void add(
+            const service_node_info& info,
+            cryptonote::hf hf_version,
+            cryptonote::network_type nettype);
+};
+
 crypto::x25519_public_key snpk_to_xpk(const crypto::public_key& snpk);
 
 /// Collection of keys used by a service node
@@ -511,10 +544,7 @@ class service_node_list {
     void init();
     void validate_miner_tx(const cryptonote::miner_tx_info& info) const;
     void alt_block_add(const cryptonote::block_add_info& info);
-    payout get_next_block_leader() const {
-        std::lock_guard lock{m_sn_mutex};
-        return m_state.get_next_block_leader();
-    }
+    payout get_next_block_leader() const { return state_snapshot()->get_next_block_leader(); }
     bool is_service_node(const crypto::public_key& pubkey, bool require_active = true) const;
     bool is_key_image_locked(
             crypto::key_image const& check_image,
@@ -542,12 +572,43 @@ class service_node_list {
             crypto::public_key& key) const;
 
     size_t get_service_node_count() const;
+
+    /// Numbers of registered service nodes by state, as of the current top block.
+    struct state_counts {
+        size_t active = 0;
+        size_t decommissioned = 0;
+        size_t awaiting_contributions = 0;
+    };
+    state_counts get_state_counts() const;
+
     std::vector<service_node_pubkey_info> get_service_node_list_state(
             const std::vector<crypto::public_key>& service_node_pubkeys = {}) const;
     const std::vector<key_image_blacklist_entry>& get_blacklisted_key_images() const {
         return m_state.key_image_blacklist;
     }
 
+    /// Changes to the registered service nodes made by a single block; see get_block_delta().
+    struct state_delta {
+        /// Newly registered nodes
+        std::vector<crypto::public_key> added;
+        /// Nodes that are no longer registered
+        std::vector<crypto::public_key> removed;
+        /// Nodes that remain registered but whose info may have been updated (e.g. rewards,
+        /// contributions, or any of the changes below).
+        std::vector<crypto::public_key> changed;
+        /// The subset of `changed` whose active, decommissioned, or fully funded status changed.
+        std::vector<crypto::public_key> state_changed;
+        /// The subset of `changed` that moved to a different swarm, with the new swarm id.
+        std::vector<std::pair<crypto::public_key, swarm_id_t>> swarm_changed;
+    };
+
+    /// Returns the changes to the registered service nodes made by the block with the given height
+    /// and hash, found by comparing the states before and after the block.  Only recent blocks of
+    /// the main chain are available; returns nullopt if the block isn't one of them (or the
+    /// state before it isn't available, e.g. just after startup).
+    std::optional<state_delta> get_block_delta(
+            uint64_t height, const crypto::hash& block_hash) const;
+
     /// Accesses a proof with the required lock held; used to extract needed proof values.  Func
     /// should be callable with a single `const proof_info &` argument.  If there is no proof info
     /// at all for the given pubkey then Func will not be called.
@@ -618,13 +679,14 @@ class service_node_list {
     }
 
     /// Loops through all registered service nodes and calls `f` with the pubkey and basic service
-    /// node info.  The SN lock is held while iterating, so the "something" should be quick.  If the
-    /// callback returns bool then `true` means stop iterating (i.e. you'd found what you wanted),
-    /// `false` means continue.  (Any other return type ignores the return value).
+    /// node info.  This iterates over the most recently published state without taking the SN
+    /// lock, so it neither waits for nor delays block processing.  If the callback returns bool
+    /// then `true` means stop iterating (i.e. you'd found what you wanted), `false` means continue.
+    /// (Any other return type ignores the return value).
     template <std::invocable<const crypto::public_key&, const service_node_info&> Func>
     void for_each_service_node(Func f) const {
-        std::lock_guard lock{m_sn_mutex};
-        for (const auto& [pk, sni] : m_state.service_nodes_infos) {
+        auto state = state_snapshot();
+        for (const auto& [pk, sni] : state->service_nodes_infos) {
             if constexpr (std::is_same_v<bool, decltype(f(pk, *sni))>) {
                 if (f(pk, *sni))
                     break;
@@ -634,25 +696,25 @@ class service_node_list {
         }
     }
 
-    /// If the given pubkey is a registered service node then call f with its current info (with the
-    /// service node lock held).  Doesn't call f if not a registered service node.
+    /// If the given pubkey is a registered service node then call f with its current info (from the
+    /// most recently published state).  Doesn't call f if not a registered service node.
     template <std::invocable<const service_node_info&> Func>
     void if_service_node(const crypto::public_key& pk, Func f) const {
-        std::lock_guard lock{m_sn_mutex};
-        if (auto it = m_state.service_nodes_infos.find(pk); it != m_state.service_nodes_infos.end())
+        auto state = state_snapshot();
+        if (auto it = state->service_nodes_infos.find(pk); it != state->service_nodes_infos.end())
             f(*it->second);
     }
 
     struct recently_removed_node;
 
-    /// Loops through all recently removed nodes, invoking the callback (with the SN list lock held)
-    /// for each one.  If the function has a bool return then the return value indicates whether the
-    /// invoker is done, i.e. returning true once you have found what you want to break the
-    /// iteration.
+    /// Loops through all recently removed nodes (as of the most recently published state), invoking
+    /// the callback for each one.  If the function has a bool return then the return value
+    /// indicates whether the invoker is done, i.e. returning true once you have found what you want
+    /// to break the iteration.
     template <std::invocable<const recently_removed_node&> Func>
     void for_each_recently_removed_node(Func f) const {
-        std::lock_guard lock{m_sn_mutex};
-        for (const auto& node : m_state.recently_removed_nodes) {
+        auto state = state_snapshot();
+        for (const auto& node : state->recently_removed_nodes) {
             if constexpr (std::is_same_v<bool, decltype(f(node))>) {
                 if (f(node))
                     break;
@@ -752,13 +814,16 @@ class service_node_list {
     }
 
     std::vector<pubkey_and_sninfo> active_service_nodes_infos() const {
-        std::unique_lock lock{m_sn_mutex};
-        return m_state.active_service_nodes_infos();
+        return state_snapshot()->active_service_nodes_infos();
     }
 
     void set_my_service_node_keys(const service_node_keys* keys);
     void set_quorum_history_storage(
             uint64_t hist_size);  // 0 = none (default), 1 = unlimited, N = # of blocks
+
+    // Writes the service node state to the database.  Recent states are stored as one record per
+    // height, and only records for heights added since the last call (plus the current height,
+    // which may still change) are written, so this is cheap to call frequently.
     bool store();
 
     uptime_proof::Proof generate_uptime_proof(
@@ -775,6 +840,11 @@ class service_node_list {
             bool& my_uptime_proof_confirmation,
             crypto::x25519_public_key& x25519_pkey);
 
+    // Returns true if a proof with the given proof hash (i.e. the keccak hash of the serialized
+    // proof) has recently passed verification here.  Such a proof is just another relayed copy that
+    // handle_uptime_proof would reject, so callers can drop it before parsing or verifying it.
+    bool uptime_proof_seen(const crypto::hash& proof_hash) const;
+
     void record_checkpoint_participation(
             crypto::public_key const& pubkey, uint64_t height, bool participated);
 
@@ -870,6 +940,18 @@ class service_node_list {
   private:
     bool set_peer_reachable(bool storage_server, crypto::public_key const& pubkey, bool value);
 
+    // Writes the per-height state records for heights not yet in the db and prunes the ones that
+    // are no longer needed.  Must be called with a db write transaction active.
+    void store_state_records(cryptonote::hf hf_version);
+    // Loads state_history and m_state from the per-height state records.  Returns false if there
+    // are none or they are not usable.
+    bool load_state_records(uint64_t& bytes_loaded);
+    // The long-term state archive and the old quorum history are rarely needed and can be slow to
+    // parse, so load() only reads them from the db; these parse them on first use.  Both are no-ops
+    // once loaded.
+    void load_deferred_archive();
+    void load_deferred_quorums();
+
   public:
     struct quorum_for_serialization {
         uint8_t version;
@@ -1023,13 +1105,14 @@ class service_node_list {
             version_2_regen_recently_removed_nodes_w_sn_info,
             version_3_eth_beneficiary,
             version_4_ensure_rescan_resets_sql_db,
+            version_5_state_records,  // short-term states are in per-height records, not `states`
             count,
         };
         static version_t get_version(cryptonote::hf /*hf_version*/) {
-            return version_t::version_4_ensure_rescan_resets_sql_db;
+            return version_t::version_5_state_records;
         }
 
-        version_t version{version_t::version_4_ensure_rescan_resets_sql_db};
+        version_t version{version_t::version_5_state_records};
         std::vector<quorum_for_serialization> quorum_states;
         std::vector<state_serialized> states;
         void clear() {
@@ -1048,6 +1131,30 @@ class service_node_list {
         }
     };
 
+    // A per-height record of the recent state history.  Checkpoint records hold the full state;
+    // other records hold everything except the service node infos in full, plus just the infos
+    // that changed since the previous height and the pubkeys of nodes that were removed.  Loading
+    // replays the records forward from the oldest checkpoint.
+    struct state_record_serialized {
+        enum struct version_t : uint8_t {
+            version_0,
+            count,
+        };
+        version_t version{version_t::version_0};
+        bool checkpoint;
+        state_serialized state;
+        std::vector<crypto::public_key> removed;
+
+        template <class Archive>
+        void serialize_object(Archive& ar) {
+            field_varint(ar, "version", version, [](auto v) { return v < version_t::count; });
+            field(ar, "checkpoint", checkpoint);
+            field(ar, "state", state);
+            if (!checkpoint)
+                field(ar, "removed", removed);
+        }
+    };
+
     struct state_t;
     using state_set = std::set<state_t, std::less<>>;
     using block_height = uint64_t;
@@ -1056,8 +1163,8 @@ class service_node_list {
         bool only_loaded_quorums{false};
         service_nodes_infos_t service_nodes_infos;
         std::vector<key_image_blacklist_entry> key_image_blacklist;
-        std::unordered_map<crypto::x25519_public_key, crypto::public_key> x25519_map;
-        std::unordered_map<eth::bls_public_key, crypto::public_key> bls_map;
+        tools::cow_unordered_map<crypto::x25519_public_key, crypto::public_key> x25519_map;
+        tools::cow_unordered_map<eth::bls_public_key, crypto::public_key> bls_map;
         block_height height{0};
         // Mutable because we are allowed to (and need to) change it via std::set iterator:
         mutable quorum_manager quorums;
@@ -1083,10 +1190,38 @@ class service_node_list {
         // the default staking requirement applies.
         uint64_t staking_requirement{0};
 
+        // The swarm membership of the active service nodes as of the last swarm update, along with
+        // the service_nodes_infos it was built from (which is cheap to keep, as copies share
+        // unmodified shards).  This lets the next swarm update bring the membership up to date from
+        // just the service nodes that have changed since, rather than rebuilding it.  Not
+        // serialized; a state without it rebuilds the membership at its next swarm update.
+        struct swarm_cache_t {
+            service_nodes_infos_t infos;
+            swarm_snode_map_t swarms;
+        };
+        std::shared_ptr<const swarm_cache_t> swarm_cache;
+
+        // The pubkey-sorted quorum candidates (see active_service_nodes_infos() and
+        // decommissioned_service_nodes_infos()) as of `infos`.  update_sorted_nodes() brings these
+        // up to date by merging in just the service nodes that have changed since, which saves
+        // re-sorting the whole list for every block; the accessors return them directly while
+        // service_nodes_infos is unmodified.  Not serialized.
+        struct sorted_nodes_t {
+            service_nodes_infos_t infos;
+            std::vector<pubkey_and_sninfo> active;
+            std::vector<pubkey_and_sninfo> decommissioned;
+        };
+        std::shared_ptr<const sorted_nodes_t> sorted_nodes;
+
         service_node_list* sn_list;
 
         explicit state_t(service_node_list* snl) : sn_list{snl} {}
         state_t(service_node_list& snl, state_serialized&& state);
+        // Constructs the state following `prev` from a non-checkpoint state record, where
+        // `state.infos` contains only the changed infos.
+        state_t(const state_t& prev,
+                state_serialized&& state,
+                const std::vector<crypto::public_key>& removed);
 
         friend bool operator<(const state_t& a, const state_t& b) { return a.height < b.height; }
         friend bool operator<(const state_t& s, block_height h) { return s.height < h; }
@@ -1108,6 +1243,14 @@ class service_node_list {
                 const;  // return: All nodes that are active and have been online for a period
                         // greater than SERVICE_NODE_PAYABLE_AFTER_BLOCKS
 
+        // Returns the reward_table of payable_service_nodes_infos(height, nettype), for a block of
+        // version `hf_version`.  The table is cached until the state next changes.
+        std::shared_ptr<const reward_table> payable_reward_table(
+                uint64_t height, cryptonote::hf hf_version, cryptonote::network_type nettype) const;
+
+        // Updates `sorted_nodes` to match the current service_nodes_infos and returns it.
+        std::shared_ptr<const sorted_nodes_t> update_sorted_nodes();
+
         // Takes a BLS pubkey, returns the SN pubkey if known, otherwise null.  Note that "known"
         // here includes both registered SNs and SNs in the recently expired list (i.e. left oxend,
         // but not yet confirmed gone from the contract).
@@ -1171,13 +1314,18 @@ class service_node_list {
 
         // Applies a pulse-quorums-confirmed L2 event to the service node list state.  Returns true
         // if processing the event affects swarms, false if it does not.
+        //
+        // For registrations, `active_bls` can be given the BLS pubkeys of all registered nodes to
+        // check for a duplicate key against instead of scanning the whole list; the new node's key
+        // is added to it if the registration is accepted.
         bool process_confirmed_event(
                 const eth::event::NewServiceNodeV2& new_sn,
                 cryptonote::network_type nettype,
                 cryptonote::hf hf_version,
                 uint64_t height,
                 uint32_t index,
-                const service_node_keys* my_keys);
+                const service_node_keys* my_keys,
+                std::unordered_set<eth::bls_public_key>* active_bls = nullptr);
         bool process_confirmed_event(
                 const eth::event::ServiceNodeExitRequest& rem_req,
                 cryptonote::network_type nettype,
@@ -1264,6 +1412,14 @@ class service_node_list {
         void initialize_alt_pk_maps();
 
         mutable std::optional<service_nodes::payout> next_block_leader_cache;
+
+        struct reward_table_cache {
+            uint64_t height;
+            cryptonote::hf hf_version;
+            cryptonote::network_type nettype;
+            std::shared_ptr<const reward_table> table;  // Shared (not copied) by state copies
+        };
+        mutable std::optional<reward_table_cache> payable_reward_table_cache;
     };
 
     // Can be set to true (via --dev-allow-local-ips) for debugging a new testnet on a local private
@@ -1364,6 +1520,14 @@ class service_node_list {
     void reset(bool delete_db_entry = false);
     bool load(uint64_t current_height);
 
+    // Makes the current m_state visible to state_snapshot().  Must be called (with m_sn_mutex
+    // held) whenever a change to m_state is complete.
+    void publish_state();
+
+    // Returns the most recently published state.  This does not take m_sn_mutex, so is what the
+    // read-only query methods that only need m_state use.
+    std::shared_ptr<const state_t> state_snapshot() const;
+
     mutable std::recursive_mutex m_sn_mutex;
     const service_node_keys* m_service_node_keys;
     uint64_t m_store_quorum_history = 0;
@@ -1376,6 +1540,25 @@ class service_node_list {
             std::chrono::system_clock::from_time_t(0);
     std::unordered_map<crypto::public_key, proof_info> proofs;
 
+    // Hashes of recently verified proofs, with the time until which further copies get dropped
+    void record_seen_uptime_proof(const crypto::hash& proof_hash);
+    mutable std::mutex m_seen_proofs_mutex;
+    std::unordered_map<crypto::hash, std::chrono::steady_clock::time_point> m_seen_proofs;
+    std::chrono::steady_clock::time_point m_seen_proofs_last_pruned{};
+
+    // verify_checkpoint(), but remembering the checkpoints that have passed so that seeing the same
+    // checkpoint again with the same quorum (e.g. when a block we first saw on an alt chain gets
+    // added to the main chain) doesn't repeat the signature checks.
+    bool verify_checkpoint_cached(
+            cryptonote::hf hf_version,
+            const cryptonote::checkpoint_t& checkpoint,
+            const quorum& quorum) const;
+    // Checkpoint height => digests of the block hash, signatures and quorum of the checkpoints at
+    // that height that have verified.  Entries above the detach height are dropped in
+    // blockchain_detached().
+    mutable std::mutex m_verified_checkpoints_mutex;
+    mutable std::map<uint64_t, std::unordered_set<crypto::hash>> m_verified_checkpoints;
+
     struct quorums_by_height {
         quorums_by_height() = default;
         quorums_by_height(uint64_t height, quorum_manager quorums) :
@@ -1384,6 +1567,13 @@ class service_node_list {
         quorum_manager quorums;
     };
 
+    // Appends the serialized quorums at or above `min_height` to `out`.  Returns false (leaving
+    // `out` partially updated) if they are not in ascending height order.
+    static bool append_quorum_states(
+            std::deque<quorums_by_height>& out,
+            const std::vector<quorum_for_serialization>& quorum_states,
+            uint64_t min_height);
+
     struct {
         std::deque<quorums_by_height> old_quorum_states;  // Store all old quorum history only if
                                                           // run with --store-full-quorum-history
@@ -1393,6 +1583,16 @@ class service_node_list {
                                   // (height % STORE_LONG_TERM_STATE_INTERVAL))
         std::unordered_map<crypto::hash, state_t> alt_state;
         bool state_added_to_archive;
+        // Height up to which the state records in the database match state_history (and so can be
+        // the base of the next delta record), or nullopt if they need to be rewritten from scratch.
+        std::optional<uint64_t> stored_state_height;
+        std::set<uint64_t> stored_checkpoints;  // Heights of the full checkpoint records in the db
+        // Serialized state_archive and old_quorum_states, if not yet parsed (see
+        // load_deferred_archive() and load_deferred_quorums()).
+        std::string deferred_archive;
+        std::string deferred_quorum_states;
+        size_t deferred_quorum_count;
+        uint64_t deferred_quorum_min_height;
         data_for_serialization cache_long_term_data;
         data_for_serialization cache_short_term_data;
         std::string cache_data_blob;
@@ -1400,6 +1600,12 @@ class service_node_list {
 
     state_t m_state;  // NOTE: Not in m_transient due to the non-trivial constructor. We can't
                       // blanket initialise using = {}; needs to be reset in ::reset(...) manually
+
+    // Immutable copy of m_state as of the last publish_state().  Copying a state only copies
+    // the shard pointers of its service node maps, so this is cheap to replace after each block.
+    // The mutex only guards replacing/copying the pointer itself.
+    std::shared_ptr<const state_t> m_state_snapshot;
+    mutable std::mutex m_state_snapshot_mutex;
 };
 
 struct staking_components {
@@ -31,11 +31,13 @@
 #include <oxenc/endian.h>
 
 #include "common/oxen.h"
+#include "common/threadpool.h"
 #include "common/util.h"
 #include "cryptonote_basic/hardfork.h"
 #include "cryptonote_config.h"
 #include "cryptonote_core.h"
 #include "epee/net/local_ip.h"
+#include "logging/trace.h"
 #include "service_node_list.h"
 #include "service_node_voting.h"
 #include "uptime_proof.h"
@@ -46,6 +48,9 @@ using cryptonote::hf;
 namespace service_nodes {
 static auto logcat = log::Cat("quorum_cop");
 
+// The obligation tests are cheap, so only spread them across threads when each gets a few of them
+static constexpr size_t MIN_TESTS_PER_THREAD = 8;
+
 std::string quorum::to_string() const {
     std::string result;
     auto append = std::back_inserter(result);
@@ -88,45 +93,77 @@ void quorum_cop::init() {
     m_last_checkpointed_height = 0;
 }
 
-// Perform service node tests -- this returns true is the server node is in a good state, that is,
-// has submitted uptime proofs, participated in required quorums, etc.
-service_node_test_results quorum_cop::check_service_node(
-        hf hf_version, const crypto::public_key& pubkey, const service_node_info& info) const {
-    const auto& netconf = m_core.get_net_config();
-
-    service_node_test_results result;  // Defaults to true for individual tests
-    bool ss_reachable = true, lokinet_reachable = true;
+struct quorum_cop::test_inputs {
+    bool ss_reachable = true;
+    bool lokinet_reachable = true;
     uint64_t timestamp = 0;
     decltype(std::declval<proof_info>().public_ips) ips{};
     uint64_t l2_height = 0;
+    uint64_t latest_l2_height = 0;
     std::chrono::seconds proof_age = 0s;
+    // Timestamp of the block of the node's last IP change penalty (or registration); only looked
+    // up when the proof has two recent IPs, as that is the only time the IP change check needs it.
+    std::optional<uint64_t> last_ip_change_timestamp;
 
     participation_history<service_nodes::checkpoint_participation_entry> checkpoint_participation{};
     participation_history<service_nodes::pulse_participation_entry> pulse_participation{};
     participation_history<service_nodes::timestamp_participation_entry> timestamp_participation{};
     participation_history<service_nodes::timesync_entry> timesync_status{};
+};
 
+quorum_cop::test_inputs quorum_cop::get_test_inputs(
+        const crypto::public_key& pubkey, const service_node_info& info) const {
+    const auto& netconf = m_core.get_net_config();
     const auto unreachable_threshold =
             netconf.UPTIME_PROOF_VALIDITY - netconf.UPTIME_PROOF_FREQUENCY;
 
+    test_inputs in;
     m_core.service_node_list.access_proof(pubkey, [&](const proof_info& proof) {
-        ss_reachable = !proof.ss_reachable.unreachable_for(unreachable_threshold);
-        lokinet_reachable = !proof.lokinet_reachable.unreachable_for(unreachable_threshold);
-        timestamp = std::max(proof.timestamp, proof.effective_timestamp);
-        ips = proof.public_ips;
-        checkpoint_participation = proof.checkpoint_participation;
-        pulse_participation = proof.pulse_participation;
-        timestamp_participation = proof.timestamp_participation;
-        timesync_status = proof.timesync_status;
-        l2_height = proof.proof->l2_height;
+        in.ss_reachable = !proof.ss_reachable.unreachable_for(unreachable_threshold);
+        in.lokinet_reachable = !proof.lokinet_reachable.unreachable_for(unreachable_threshold);
+        in.timestamp = std::max(proof.timestamp, proof.effective_timestamp);
+        in.ips = proof.public_ips;
+        in.checkpoint_participation = proof.checkpoint_participation;
+        in.pulse_participation = proof.pulse_participation;
+        in.timestamp_participation = proof.timestamp_participation;
+        in.timesync_status = proof.timesync_status;
+        in.l2_height = proof.proof->l2_height;
         auto now = std::chrono::system_clock::now();
         auto proof_timestamp =
                 std::chrono::system_clock::time_point(std::chrono::seconds(proof.proof->timestamp));
-        proof_age = (proof_timestamp > now)
-                          ? 0s
-                          : std::chrono::duration_cast<std::chrono::seconds>(now - proof_timestamp);
+        in.proof_age = (proof_timestamp > now) ? 0s
+                                               : std::chrono::duration_cast<std::chrono::seconds>(
+                                                         now - proof_timestamp);
     });
-    std::chrono::seconds time_since_last_uptime_proof{std::time(nullptr) - timestamp};
+    in.latest_l2_height = m_core.l2_tracker().get_latest_height();
+
+    if (in.ips[0].first && in.ips[1].first) {
+        try {
+            in.last_ip_change_timestamp =
+                    m_core.blockchain.db().get_block_timestamp(info.last_ip_change_height);
+        } catch (const std::exception& e) {
+            log::debug(
+                    logcat,
+                    "Unable to get block {} for {}'s last IP change: {}",
+                    info.last_ip_change_height,
+                    pubkey,
+                    e.what());
+        }
+    }
+    return in;
+}
+
+// Perform service node tests -- this returns true is the server node is in a good state, that is,
+// has submitted uptime proofs, participated in required quorums, etc.
+service_node_test_results quorum_cop::check_service_node(
+        hf hf_version,
+        const crypto::public_key& pubkey,
+        const service_node_info& info,
+        const test_inputs& inputs) const {
+    const auto& netconf = m_core.get_net_config();
+
+    service_node_test_results result;  // Defaults to true for individual tests
+    std::chrono::seconds time_since_last_uptime_proof{std::time(nullptr) - inputs.timestamp};
 
     bool check_uptime_obligation = true;
     bool check_checkpoint_obligation = true;
@@ -143,46 +180,46 @@ service_node_test_results quorum_cop::check_service_node(
         result.uptime_proved = false;
     }
 
-    if (!ss_reachable) {
+    if (!inputs.ss_reachable) {
         log::info(logcat, "Service Node storage server is not reachable for node: {}", pubkey);
         result.storage_server_reachable = false;
     }
 
     // TODO: perhaps come back and make this activate on some "soft fork" height before HF19?
-    if (!lokinet_reachable && hf_version >= hf::hf19_reward_batching) {
+    if (!inputs.lokinet_reachable && hf_version >= hf::hf19_reward_batching) {
         log::info(logcat, "Service Node lokinet is not reachable for node: {}", pubkey);
         result.lokinet_reachable = false;
     }
 
     // IP change checks
-    if (ips[0].first && ips[1].first) {
+    if (inputs.ips[0].first && inputs.ips[1].first) {
         // Figure out when we last had a blockchain-level IP change penalty (or when we registered);
         // we only consider IP changes starting two hours after the last IP penalty.
-        std::vector<cryptonote::block> blocks;
-        if (m_core.blockchain.get_blocks(info.last_ip_change_height, 1, blocks)) {
+        if (auto penalty_time = inputs.last_ip_change_timestamp) {
             uint64_t find_ips_used_since = std::max(
                     uint64_t(std::time(nullptr)) - std::chrono::seconds{IP_CHANGE_WINDOW}.count(),
-                    uint64_t(blocks[0].timestamp) + std::chrono::seconds{IP_CHANGE_BUFFER}.count());
-            if (ips[0].second > find_ips_used_since && ips[1].second > find_ips_used_since)
+                    *penalty_time + std::chrono::seconds{IP_CHANGE_BUFFER}.count());
+            if (inputs.ips[0].second > find_ips_used_since &&
+                inputs.ips[1].second > find_ips_used_since)
                 result.single_ip = false;
         }
     }
 
     // Checking if the nodes L2 height is too far behind
-    auto l2_min_acceptable_height = m_core.l2_tracker().get_latest_height();
+    auto l2_min_acceptable_height = inputs.latest_l2_height;
     l2_min_acceptable_height -= std::min(
-            static_cast<uint64_t>(proof_age / cryptonote::config::L2_BLOCK_TIME),
+            static_cast<uint64_t>(inputs.proof_age / cryptonote::config::L2_BLOCK_TIME),
             l2_min_acceptable_height);
     l2_min_acceptable_height -=
             std::min(cryptonote::L2_HEIGHT_DELAY_THRESHOLD, l2_min_acceptable_height);
 
-    if (check_l2_height && l2_height < l2_min_acceptable_height) {
+    if (check_l2_height && inputs.l2_height < l2_min_acceptable_height) {
         log::info(
                 logcat,
                 "Service Node: {}, failed l2 height check. Node L2 height: {}, Threshold L2 "
                 "height: {}",
                 pubkey,
-                l2_height,
+                inputs.l2_height,
                 l2_min_acceptable_height);
         result.recent_l2_height = false;
     }
@@ -190,21 +227,21 @@ service_node_test_results quorum_cop::check_service_node(
     // These checks will not be performed when a node is being considered for recommission
     if (!info.is_decommissioned()) {
         if (check_checkpoint_obligation &&
-            checkpoint_participation.failures() > CHECKPOINT_MAX_MISSABLE_VOTES) {
+            inputs.checkpoint_participation.failures() > CHECKPOINT_MAX_MISSABLE_VOTES) {
             log::info(logcat, "Service Node: {}, failed checkpoint obligation check", pubkey);
             result.checkpoint_participation = false;
         }
 
-        if (pulse_participation.failures() > PULSE_MAX_MISSABLE_VOTES) {
+        if (inputs.pulse_participation.failures() > PULSE_MAX_MISSABLE_VOTES) {
             log::info(logcat, "Service Node: {}, failed pulse obligation check", pubkey);
             result.pulse_participation = false;
         }
 
-        if (timestamp_participation.failures() > TIMESTAMP_MAX_MISSABLE_VOTES) {
+        if (inputs.timestamp_participation.failures() > TIMESTAMP_MAX_MISSABLE_VOTES) {
             log::info(logcat, "Service Node: {}, failed timestamp obligation check", pubkey);
             result.timestamp_participation = false;
         }
-        if (timesync_status.failures() > TIMESYNC_MAX_UNSYNCED_VOTES) {
+        if (inputs.timesync_status.failures() > TIMESYNC_MAX_UNSYNCED_VOTES) {
             log::info(logcat, "Service Node: {}, failed timesync obligation check", pubkey);
             result.timesync_status = false;
         }
@@ -387,7 +424,14 @@ void quorum_cop::process_quorums(cryptonote::block const& block) {
                         auto worker_states = m_core.service_node_list.get_service_node_list_state(
                                 quorum->workers);
                         auto worker_it = worker_states.begin();
-                        std::unique_lock lock{m_lock};
+                        struct tested_node {
+                            size_t node_index;
+                            const service_node_info* info;
+                            test_inputs inputs;
+                            service_node_test_results results;
+                        };
+                        std::vector<tested_node> tested;
+                        tested.reserve(worker_states.size());
                         int good = 0, total = 0;
                         for (size_t node_index = 0; node_index < quorum->workers.size();
                              ++worker_it, ++node_index) {
@@ -400,14 +444,33 @@ void quorum_cop::process_quorums(cryptonote::block const& block) {
                                 break;
                             total++;
 
-                            const auto& node_key = worker_it->pubkey;
                             const auto& info = *worker_it->info;
-
                             if (!info.can_be_voted_on(m_obligations_height))
                                 continue;
 
-                            auto test_results = check_service_node(
-                                    obligations_height_hf_version, node_key, info);
+                            tested.push_back(
+                                    {node_index, &info, get_test_inputs(worker_it->pubkey, info)});
+                        }
+
+                        // With the inputs copied out the tests don't touch any shared state, so we
+                        // can spread them across the thread pool.
+                        tools::threadpool::getInstance().parallel_for(
+                                0,
+                                tested.size(),
+                                [&](size_t i) {
+                                    auto& t = tested[i];
+                                    t.results = check_service_node(
+                                            obligations_height_hf_version,
+                                            quorum->workers[t.node_index],
+                                            *t.info,
+                                            t.inputs);
+                                },
+                                MIN_TESTS_PER_THREAD,
+                                "obligation_tests");
+
+                        std::vector<quorum_vote_t> votes;
+                        for (const auto& [node_index, info_ptr, inputs, test_results] : tested) {
+                            const auto& info = *info_ptr;
                             bool passed = test_results.passed();
 
                             new_state vote_for_state;
@@ -518,13 +581,17 @@ void quorum_cop::process_quorums(cryptonote::block const& block) {
                                 continue;
                             }
 
-                            quorum_vote_t vote = service_nodes::make_state_change_vote(
+                            votes.push_back(service_nodes::make_state_change_vote(
                                     m_obligations_height,
                                     static_cast<uint16_t>(index_in_group),
                                     node_index,
                                     vote_for_state,
                                     reason,
-                                    my_keys);
+                                    my_keys));
+                        }
+
+                        std::unique_lock lock{m_lock};
+                        for (const auto& vote : votes) {
                             cryptonote::vote_verification_context vvc;
                             if (!handle_vote(vote, vvc))
                                 log::error(
@@ -554,7 +621,10 @@ void quorum_cop::process_quorums(cryptonote::block const& block) {
                             if (info.can_be_voted_on(m_obligations_height)) {
                                 tested_myself_once_per_block = true;
                                 auto my_test_results = check_service_node(
-                                        obligations_height_hf_version, my_keys.pub, info);
+                                        obligations_height_hf_version,
+                                        my_keys.pub,
+                                        info,
+                                        get_test_inputs(my_keys.pub, info));
                                 const bool print_failings =
                                         info.is_decommissioned() ||
                                         (info.is_active() && !my_test_results.passed() &&
@@ -655,6 +725,7 @@ void quorum_cop::process_quorums(cryptonote::block const& block) {
 
 void quorum_cop::block_add(
         const cryptonote::block& block, const std::vector<cryptonote::transaction>& txs) {
+    OXEN_TRACE_SPAN(logcat, "quorum_cop::block_add");
     process_quorums(block);
     uint64_t const height = block.get_height() + 1;  // chain height = new top block height + 1
     m_vote_pool.remove_expired_votes(height);
@@ -129,10 +129,17 @@ class quorum_cop {
 
   private:
     void process_quorums(cryptonote::block const& block);
+
+    // The proof and chain data that check_service_node() tests, copied out beforehand so that the
+    // tests themselves don't need to take any locks (and so can run in parallel).
+    struct test_inputs;
+    test_inputs get_test_inputs(
+            const crypto::public_key& pubkey, const service_node_info& info) const;
     service_node_test_results check_service_node(
             cryptonote::hf hf_version,
             const crypto::public_key& pubkey,
-            const service_node_info& info) const;
+            const service_node_info& info,
+            const test_inputs& inputs) const;
 
     cryptonote::core& m_core;
     voting_pool m_vote_pool;
@@ -315,4 +315,31 @@ void calc_swarm_changes(swarm_snode_map_t& swarm_to_snodes, uint64_t seed) {
         log::debug(logcat, "{}: {}", entry.first, entry.second.size());
     }
 }
+
+void move_swarm_member(
+        swarm_snode_map_t& swarm_to_snodes,
+        const crypto::public_key& pubkey,
+        std::optional<swarm_id_t> from,
+        std::optional<swarm_id_t> to) {
+    if (from == to)
+        return;
+
+    if (from) {
+        if (auto it = swarm_to_snodes.find(*from); it != swarm_to_snodes.end()) {
+            auto& members = it->second;
+            auto pos = std::lower_bound(members.begin(), members.end(), pubkey);
+            if (pos != members.end() && *pos == pubkey)
+                members.erase(pos);
+            if (members.empty())
+                swarm_to_snodes.erase(it);
+        }
+    }
+
+    if (to) {
+        auto& members = swarm_to_snodes[*to];
+        auto pos = std::lower_bound(members.begin(), members.end(), pubkey);
+        if (pos == members.end() || *pos != pubkey)
+            members.insert(pos, pubkey);
+    }
+}
 }  // namespace service_nodes
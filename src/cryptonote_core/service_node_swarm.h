@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <optional>
 #include <random>
 #include <vector>
 
@@ -23,4 +24,15 @@ uint64_t get_new_swarm_id(const swarm_snode_map_t& swarm_to_snodes);
 
 void calc_swarm_changes(swarm_snode_map_t& swarm_to_snodes, uint64_t seed);
 
+/// Moves `pubkey` from swarm `from` to swarm `to` in a map of swarm membership, where nullopt means
+/// not in any swarm (i.e. not an active service node).  Members of each swarm are kept sorted by
+/// pubkey and swarms left without members are removed, so that applying each change in the active
+/// service nodes keeps the map identical to one built from scratch from the pubkey-sorted active
+/// service nodes.
+void move_swarm_member(
+        swarm_snode_map_t& swarm_to_snodes,
+        const crypto::public_key& pubkey,
+        std::optional<swarm_id_t> from,
+        std::optional<swarm_id_t> to);
+
 }  // namespace service_nodes
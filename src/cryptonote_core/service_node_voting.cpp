@@ -210,6 +210,8 @@ bool verify_tx_state_change(
             state_change.block_height, state_change.service_node_index, state_change.state);
     std::array<int, service_nodes::STATE_CHANGE_QUORUM_SIZE> validator_set = {};
     int validator_index_tracker = -1;
+    std::vector<crypto::signature_check> sig_checks;
+    sig_checks.reserve(state_change.votes.size());
     for (const auto& vote : state_change.votes) {
         if (hf_version >= hf::hf13_enforce_checkpoints)  // NOTE: After HF13, votes must be stored
                                                          // in ascending order
@@ -236,12 +238,20 @@ bool verify_tx_state_change(
             return bad_tx(tvc);
         }
 
-        crypto::public_key const& key = quorum.validators[vote.validator_index];
-        if (!crypto::check_signature(hash, key, vote.signature)) {
-            log::info(logcat, "Invalid signature for voter {}/{}", vote.validator_index, key);
-            vvc.m_signature_not_valid = true;
-            return bad_tx(tvc);
-        }
+        sig_checks.push_back({hash, quorum.validators[vote.validator_index], vote.signature});
+    }
+
+    // Check the signatures together once everything else has passed
+    if (std::vector<bool> valid; !crypto::check_signatures(sig_checks, &valid)) {
+        for (size_t i = 0; i < valid.size(); i++)
+            if (!valid[i])
+                log::info(
+                        logcat,
+                        "Invalid signature for voter {}/{}",
+                        state_change.votes[i].validator_index,
+                        sig_checks[i].pub);
+        vvc.m_signature_not_valid = true;
+        return bad_tx(tvc);
     }
 
     return true;
@@ -320,6 +330,8 @@ bool verify_quorum_signatures(
         } break;
     }
 
+    std::vector<crypto::signature_check> sig_checks;
+    sig_checks.reserve(signatures.size());
     for (size_t i = 0; i < signatures.size(); i++) {
         service_nodes::quorum_signature const& quorum_signature = signatures[i];
         if (enforce_vote_ordering && i < (signatures.size() - 1)) {
@@ -380,16 +392,21 @@ bool verify_quorum_signatures(
             return false;
         }
 
-        if (!crypto::check_signature(hash, key, quorum_signature.signature)) {
-            log::warning(
-                    globallogcat,
-                    "Incorrect signature for vote, failed verification at height: {} for voter: "
-                    "{}\n{}",
-                    height,
-                    key,
-                    quorum);
-            return false;
-        }
+        sig_checks.push_back({hash, key, quorum_signature.signature});
+    }
+
+    // Check the signatures together once everything else has passed
+    if (std::vector<bool> valid; !crypto::check_signatures(sig_checks, &valid)) {
+        for (size_t i = 0; i < valid.size(); i++)
+            if (!valid[i])
+                log::warning(
+                        globallogcat,
+                        "Incorrect signature for vote, failed verification at height: {} for "
+                        "voter: {}\n{}",
+                        height,
+                        sig_checks[i].pub,
+                        quorum);
+        return false;
     }
 
     return true;
@@ -606,21 +623,21 @@ bool verify_vote_signature(
     return result;
 }
 
-template <typename T>
-static std::vector<pool_vote_entry>* find_vote_in_pool(
-        std::vector<T>& pool, const quorum_vote_t& vote, bool create) {
-    T typed_vote{vote};
-    auto it = std::find(pool.begin(), pool.end(), typed_vote);
-    if (it != pool.end())
-        return &it->votes;
-    if (!create)
-        return nullptr;
-    pool.push_back(std::move(typed_vote));
-    return &pool.back().votes;
+// Returns a pointer to the value for `key` in `map`, inserting a default value if not found and
+// `create` is true, otherwise returning nullptr if not found.
+template <typename Map, typename Key>
+static typename Map::mapped_type* find_in(Map& map, const Key& key, bool create) {
+    if (create)
+        return &map[key];
+    auto it = map.find(key);
+    return it != map.end() ? &it->second : nullptr;
 }
 
-std::vector<pool_vote_entry>* voting_pool::find_vote_pool(
+voting_pool::vote_group* voting_pool::find_vote_group(
         const quorum_vote_t& find_vote, bool create_if_not_found) {
+    static_assert(
+            STATE_CHANGE_QUORUM_SIZE <= MAX_VOTES_PER_GROUP &&
+            CHECKPOINT_QUORUM_SIZE <= MAX_VOTES_PER_GROUP);
     switch (find_vote.type) {
         default:
             log::info(logcat, "Unhandled find_vote type with value: {}", (int)find_vote.type);
@@ -628,49 +645,54 @@ std::vector<pool_vote_entry>* voting_pool::find_vote_pool(
             return nullptr;
 
         case quorum_type::obligations:
-            return find_vote_in_pool(m_obligations_pool, find_vote, create_if_not_found);
+            if (auto* votes = find_in(m_pool, find_vote.block_height, create_if_not_found))
+                return find_in(
+                        votes->obligations,
+                        std::make_pair(
+                                uint32_t{find_vote.state_change.worker_index},
+                                find_vote.state_change.state),
+                        create_if_not_found);
+            return nullptr;
 
         case quorum_type::checkpointing:
-            return find_vote_in_pool(m_checkpoint_pool, find_vote, create_if_not_found);
+            if (auto* votes = find_in(m_pool, find_vote.block_height, create_if_not_found))
+                return find_in(
+                        votes->checkpoints, find_vote.checkpoint.block_hash, create_if_not_found);
+            return nullptr;
     }
 }
 
+void voting_pool::unqueue(vote_group& group) {
+    for (auto& [index, entry] : group.votes)
+        m_relay_queue.erase({entry.time_last_sent_p2p, &entry});
+}
+
+void voting_pool::unqueue(height_votes& votes) {
+    for (auto& [key, group] : votes.obligations)
+        unqueue(group);
+    for (auto& [hash, group] : votes.checkpoints)
+        unqueue(group);
+}
+
 void voting_pool::set_relayed(const std::vector<quorum_vote_t>& votes) {
     std::unique_lock lock{m_lock};
-    const time_t now = time(NULL);
+    const uint64_t now = time(nullptr);
 
     for (const quorum_vote_t& find_vote : votes) {
-        std::vector<pool_vote_entry>* vote_pool = find_vote_pool(find_vote);
+        vote_group* group = find_vote_group(find_vote);
+        if (!group)
+            continue;
+        auto it = group->votes.find(find_vote.index_in_group);
+        if (it == group->votes.end())
+            continue;
 
-        if (vote_pool)  // We found the group that this vote belongs to
-        {
-            auto vote = std::find_if(
-                    vote_pool->begin(),
-                    vote_pool->end(),
-                    [&find_vote](pool_vote_entry const& entry) {
-                        return (find_vote.index_in_group == entry.vote.index_in_group);
-                    });
-
-            if (vote != vote_pool->end()) {
-                vote->time_last_sent_p2p = now;
-            }
-        }
+        auto& entry = it->second;
+        m_relay_queue.erase({entry.time_last_sent_p2p, &entry});
+        entry.time_last_sent_p2p = now;
+        m_relay_queue.emplace(entry.time_last_sent_p2p, &entry);
     }
 }
 
-template <typename T>
-static void append_relayable_votes(
-        std::vector<quorum_vote_t>& result,
-        const T& pool,
-        const uint64_t max_last_sent,
-        uint64_t min_height) {
-    for (const auto& pool_entry : pool)
-        for (const auto& vote_entry : pool_entry.votes)
-            if (vote_entry.vote.block_height >= min_height &&
-                vote_entry.time_last_sent_p2p <= max_last_sent)
-                result.push_back(vote_entry.vote);
-}
-
 std::vector<quorum_vote_t> voting_pool::get_relayable_votes(
         uint64_t height, hf hf_version, bool quorum_relay) const {
     std::unique_lock lock{m_lock};
@@ -687,50 +709,52 @@ std::vector<quorum_vote_t> voting_pool::get_relayable_votes(
     if (quorum_relay && hf_version < hf::hf14_blink)
         return result;  // no quorum relaying before HF14
 
-    if (hf_version < hf::hf14_blink || quorum_relay)
-        append_relayable_votes(result, m_obligations_pool, max_last_sent, min_height);
-
-    if (hf_version < hf::hf14_blink || !quorum_relay)
-        append_relayable_votes(result, m_checkpoint_pool, max_last_sent, min_height);
-
-    return result;
-}
+    const bool obligations = hf_version < hf::hf14_blink || quorum_relay;
+    const bool checkpoints = hf_version < hf::hf14_blink || !quorum_relay;
 
-// return: True if the vote was unique
-static bool add_vote_to_pool_if_unique(
-        std::vector<pool_vote_entry>& votes, quorum_vote_t const& vote) {
-    auto vote_it = std::lower_bound(
-            votes.begin(),
-            votes.end(),
-            vote,
-            [](pool_vote_entry const& pool_entry, quorum_vote_t const& vote) {
-                assert(pool_entry.vote.group == vote.group);
-                return pool_entry.vote.index_in_group < vote.index_in_group;
-            });
-
-    if (vote_it == votes.end() || vote_it->vote.index_in_group != vote.index_in_group) {
-        votes.insert(vote_it, {vote});
-        return true;
+    for (const auto& [last_sent, entry] : m_relay_queue) {
+        if (last_sent > max_last_sent)
+            break;
+        const auto& vote = entry->vote;
+        if (vote.block_height >= min_height &&
+            (vote.type == quorum_type::obligations ? obligations : checkpoints))
+            result.push_back(vote);
     }
 
-    return false;
+    return result;
 }
 
 std::vector<pool_vote_entry> voting_pool::add_pool_vote_if_unique(
         const quorum_vote_t& vote, cryptonote::vote_verification_context& vvc) {
     std::unique_lock lock{m_lock};
-    auto* votes = find_vote_pool(vote, /*create_if_not_found=*/true);
-    if (!votes)
+    vote_group* group = find_vote_group(vote, /*create_if_not_found=*/true);
+    if (!group)
         return {};
 
-    vvc.m_added_to_pool = add_vote_to_pool_if_unique(*votes, vote);
-    return *votes;
+    if (vote.index_in_group >= MAX_VOTES_PER_GROUP) {
+        log::error(logcat, "Invalid vote index {} in vote pool", vote.index_in_group);
+        return {};
+    }
+
+    vvc.m_added_to_pool = !group->received[vote.index_in_group];
+    if (vvc.m_added_to_pool) {
+        group->received.set(vote.index_in_group);
+        auto& entry = group->votes.emplace(vote.index_in_group, pool_vote_entry{vote})
+                              .first->second;
+        m_relay_queue.emplace(entry.time_last_sent_p2p, &entry);
+    }
+
+    std::vector<pool_vote_entry> result;
+    result.reserve(group->votes.size());
+    for (const auto& [index, entry] : group->votes)
+        result.push_back(entry);
+    return result;
 }
 
 void voting_pool::remove_used_votes(std::vector<cryptonote::transaction> const& txs, hf version) {
     // TODO(doyle): Cull checkpoint votes
     std::unique_lock lock{m_lock};
-    if (m_obligations_pool.empty())
+    if (m_pool.empty())
         return;
 
     for (const auto& tx : txs) {
@@ -743,44 +767,42 @@ void voting_pool::remove_used_votes(std::vector<cryptonote::transaction> const&
             continue;
         }
 
-        auto it = std::find(m_obligations_pool.begin(), m_obligations_pool.end(), state_change);
-
-        if (it != m_obligations_pool.end())
-            m_obligations_pool.erase(it);
-    }
-}
-
-template <typename T>
-static void cull_votes(std::vector<T>& vote_pool, uint64_t min_height, uint64_t max_height) {
-    for (auto it = vote_pool.begin(); it != vote_pool.end();) {
-        const T& pool_entry = *it;
-        if (pool_entry.height < min_height || pool_entry.height > max_height)
-            it = vote_pool.erase(it);
-        else
-            ++it;
+        auto height_it = m_pool.find(state_change.block_height);
+        if (height_it == m_pool.end())
+            continue;
+        auto& obligations = height_it->second.obligations;
+        auto it = obligations.find({state_change.service_node_index, state_change.state});
+        if (it != obligations.end()) {
+            unqueue(it->second);
+            obligations.erase(it);
+        }
     }
 }
 
 void voting_pool::remove_expired_votes(uint64_t height) {
     std::unique_lock lock{m_lock};
     uint64_t min_height = (height < VOTE_LIFETIME) ? 0 : height - VOTE_LIFETIME;
-    cull_votes(m_obligations_pool, min_height, height);
-    cull_votes(m_checkpoint_pool, min_height, height);
+
+    auto keep_begin = m_pool.lower_bound(min_height);
+    for (auto it = m_pool.begin(); it != keep_begin; ++it)
+        unqueue(it->second);
+    m_pool.erase(m_pool.begin(), keep_begin);
+
+    auto keep_end = m_pool.upper_bound(height);
+    for (auto it = keep_end; it != m_pool.end(); ++it)
+        unqueue(it->second);
+    m_pool.erase(keep_end, m_pool.end());
 }
 
 bool voting_pool::received_checkpoint_vote(uint64_t height, size_t index_in_quorum) const {
-    auto pool_it = std::find_if(
-            m_checkpoint_pool.begin(),
-            m_checkpoint_pool.end(),
-            [height](checkpoint_pool_entry const& entry) { return entry.height == height; });
-
-    if (pool_it == m_checkpoint_pool.end())
+    std::unique_lock lock{m_lock};
+    auto it = m_pool.find(height);
+    if (it == m_pool.end() || index_in_quorum >= MAX_VOTES_PER_GROUP)
         return false;
 
-    for (auto it = pool_it->votes.begin(); it != pool_it->votes.end(); it++) {
-        if (it->vote.index_in_group == index_in_quorum)
+    for (const auto& [hash, group] : it->second.checkpoints)
+        if (group.received[index_in_quorum])
             return true;
-    }
 
     return false;
 }
@@ -28,9 +28,12 @@
 
 #pragma once
 
+#include <bitset>
 #include <boost/serialization/base_object.hpp>
 #include <cassert>
+#include <map>
 #include <mutex>
+#include <set>
 #include <utility>
 #include <vector>
 
@@ -168,42 +171,35 @@ struct voting_pool {
     bool received_checkpoint_vote(uint64_t height, size_t index_in_quorum) const;
 
   private:
-    std::vector<pool_vote_entry>* find_vote_pool(
-            const quorum_vote_t& vote, bool create_if_not_found = false);
-
-    struct obligations_pool_entry {
-        explicit obligations_pool_entry(const quorum_vote_t& vote) :
-                height{vote.block_height},
-                worker_index{vote.state_change.worker_index},
-                state{vote.state_change.state} {}
-        obligations_pool_entry(const cryptonote::tx_extra_service_node_state_change& sc) :
-                height{sc.block_height}, worker_index{sc.service_node_index}, state{sc.state} {}
-
-        uint64_t height;
-        uint32_t worker_index;
-        new_state state;
-        std::vector<pool_vote_entry> votes;
-
-        bool operator==(const obligations_pool_entry& e) const {
-            return height == e.height && worker_index == e.worker_index && state == e.state;
-        }
+    // Upper bound on the number of validators (and so votes) in a quorum; votes have had their
+    // index_in_group checked against the quorum by verify_vote_signature before they get here.
+    static constexpr size_t MAX_VOTES_PER_GROUP = 32;
+
+    // The votes for a single state change or checkpoint, keyed by index_in_group.  The map gives
+    // stable addresses for m_relay_queue; the bitset gives quick duplicate checks.
+    struct vote_group {
+        std::bitset<MAX_VOTES_PER_GROUP> received;
+        std::map<uint16_t, pool_vote_entry> votes;
     };
-    std::vector<obligations_pool_entry> m_obligations_pool;
-
-    struct checkpoint_pool_entry {
-        explicit checkpoint_pool_entry(const quorum_vote_t& vote) :
-                height{vote.block_height}, hash{vote.checkpoint.block_hash} {}
-        checkpoint_pool_entry(uint64_t height, crypto::hash const& hash) :
-                height(height), hash(hash) {}
-        uint64_t height;
-        crypto::hash hash;
-        std::vector<pool_vote_entry> votes;
-
-        bool operator==(const checkpoint_pool_entry& e) const {
-            return height == e.height && hash == e.hash;
-        }
+
+    // All votes for a given block height, so that expiring a height drops all of them at once.
+    struct height_votes {
+        // Keyed by (worker index, new state)
+        std::map<std::pair<uint32_t, new_state>, vote_group> obligations;
+        // Keyed by checkpointed block hash
+        std::map<crypto::hash, vote_group> checkpoints;
     };
-    std::vector<checkpoint_pool_entry> m_checkpoint_pool;
+
+    vote_group* find_vote_group(const quorum_vote_t& vote, bool create_if_not_found = false);
+    // Removes a group's votes from m_relay_queue; called before destroying the group.
+    void unqueue(vote_group& group);
+    void unqueue(height_votes& votes);
+
+    std::map<uint64_t, height_votes> m_pool;
+
+    // Every pooled vote, ordered by when we last relayed it (0 if never), so that finding the ones
+    // due for relaying doesn't have to look at all the others.
+    std::set<std::pair<uint64_t, pool_vote_entry*>> m_relay_queue;
 
     mutable std::recursive_mutex m_lock;
 };
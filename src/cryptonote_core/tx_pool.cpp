@@ -39,10 +39,12 @@
 #include "blockchain.h"
 #include "blockchain_db/blockchain_db.h"
 #include "blockchain_db/locked_txn.h"
+#include "common/alloc_profile.h"
 #include "common/boost_serialization_helper.h"
 #include "common/exception.h"
 #include "common/lock.h"
 #include "common/median.h"
+#include "common/threadpool.h"
 #include "common/util.h"
 #include "crypto/hash.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
@@ -51,6 +53,7 @@
 #include "cryptonote_core/service_node_list.h"
 #include "cryptonote_tx_utils.h"
 #include "epee/warnings.h"
+#include "logging/trace.h"
 
 DISABLE_VS_WARNINGS(4244 4345 4503)  //'boost::foreach_detail_::or_' : decorated name length
                                      // exceeded, name was truncated
@@ -86,6 +89,22 @@ namespace {
         else
             return get_min_block_weight(version) - COINBASE_BLOB_RESERVED_SIZE;
     }
+
+    // Rough per-allocation cost of a node in a node-based std container (links, hash/colour and
+    // allocator header), used for estimating the memory held for pool txes.
+    constexpr size_t NODE_OVERHEAD = 4 * sizeof(void*);
+
+    // Estimated memory held for a tx in the pool: its blob, its m_txs_by_priority and m_txs_by_id
+    // entries, and an m_spent_key_images entry (map node plus txid set node) for each input.
+    size_t tx_memory_usage(const transaction_prefix& tx, size_t blob_size) {
+        constexpr size_t per_tx = sizeof(tx_by_fee_and_receive_time_entry) + NODE_OVERHEAD +
+                                  sizeof(crypto::hash) + 2 * sizeof(void*) + sizeof(size_t) +
+                                  NODE_OVERHEAD;
+        constexpr size_t per_input = sizeof(crypto::key_image) +
+                                     sizeof(std::unordered_set<crypto::hash>) +
+                                     sizeof(crypto::hash) + 2 * NODE_OVERHEAD;
+        return blob_size + per_tx + tx.vin.size() * per_input;
+    }
 }  // namespace
 //---------------------------------------------------------------------------------
 // warning: bchs is passed here uninitialized, so don't do anything but store it
@@ -93,7 +112,9 @@ tx_memory_pool::tx_memory_pool(Blockchain& bchs) :
         m_cookie(0),
         m_blockchain(bchs),
         m_txpool_max_weight(DEFAULT_MEMPOOL_MAX_WEIGHT),
-        m_txpool_weight(0) {}
+        m_txpool_weight(0),
+        m_pool_seqno(crypto::rand<uint64_t>() >> 2),
+        m_pool_changes_base(m_pool_seqno) {}
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::have_duplicated_non_standard_tx(
         transaction const& tx, hf hard_fork_version) const {
@@ -166,7 +187,7 @@ bool tx_memory_pool::have_duplicated_non_standard_tx(
         }
     } else if (tx.type == txtype::key_image_unlock) {
         tx_extra_tx_key_image_unlock unlock;
-        if (!cryptonote::get_field_from_tx_extra(tx.extra, unlock)) {
+        if (!cryptonote::get_field_from_tx_extra(tx, unlock)) {
             log::error(
                     logcat,
                     "Could not get key image unlock from tx: {}, tx to add is possibly invalid, "
@@ -180,7 +201,7 @@ bool tx_memory_pool::have_duplicated_non_standard_tx(
                 continue;
 
             tx_extra_tx_key_image_unlock pool_unlock;
-            if (!cryptonote::get_field_from_tx_extra(pool_tx.extra, pool_unlock)) {
+            if (!cryptonote::get_field_from_tx_extra(pool_tx, pool_unlock)) {
                 log::info(
                         logcat,
                         "Could not get key image unlock from tx: {}, possibly corrupt tx in the "
@@ -202,7 +223,7 @@ bool tx_memory_pool::have_duplicated_non_standard_tx(
 
     } else if (tx.type == txtype::oxen_name_system) {
         tx_extra_oxen_name_system data;
-        if (!cryptonote::get_field_from_tx_extra(tx.extra, data)) {
+        if (!cryptonote::get_field_from_tx_extra(tx, data)) {
             log::error(
                     logcat,
                     "Could not get acquire name service from tx: {}, tx to add is possibly "
@@ -216,7 +237,7 @@ bool tx_memory_pool::have_duplicated_non_standard_tx(
                 continue;
 
             tx_extra_oxen_name_system pool_data;
-            if (!cryptonote::get_field_from_tx_extra(pool_tx.extra, pool_data)) {
+            if (!cryptonote::get_field_from_tx_extra(pool_tx, pool_data)) {
                 log::info(
                         logcat,
                         "Could not get acquire name service from tx: {}, possibly corrupt tx in "
@@ -308,6 +329,8 @@ bool tx_memory_pool::add_tx(
         const tx_pool_options& opts,
         hf hf_version,
         uint64_t* blink_rollback_height) {
+    OXEN_TRACE_SPAN(logcat, "add_tx");
+    OXEN_ALLOC_SCOPE("txpool");
     // this should already be called with that lock, but let's make it explicit for clarity
     std::unique_lock lock{m_transactions_lock};
     if (blob.size() == 0) {
@@ -474,15 +497,22 @@ bool tx_memory_pool::add_tx(
                     (have_tx_keyimges_as_spent(tx) ||
                      have_duplicated_non_standard_tx(tx, hf_version));
             try {
-                m_parsed_tx_cache.insert(std::make_pair(id, tx));
+                if (m_parsed_tx_cache.insert(std::make_pair(id, tx)).second)
+                    m_parsed_tx_cache_memory += blob.size();
+                // No write txn needed: the db holds pool changes back and writes them out in
+                // batches (see on_idle()), so we undo the add ourselves if we fail after it.
                 std::unique_lock b_lock{m_blockchain};
-                LockedTXN lock(m_blockchain);
                 m_blockchain.db().add_txpool_tx(id, blob, meta);
-                if (!insert_key_images(tx, id, opts.kept_by_block))
+                if (!insert_key_images(tx, id, opts.kept_by_block)) {
+                    m_blockchain.db().remove_txpool_tx(id);
                     return false;
-                m_txs_by_priority.emplace(
-                        prio, fee / (double)(tx_weight ? tx_weight : 1), receive_time, id);
-                lock.commit();
+                }
+                add_to_sorted_container(
+                        prio,
+                        fee / (double)(tx_weight ? tx_weight : 1),
+                        receive_time,
+                        id,
+                        tx_memory_usage(tx, blob.size()));
             } catch (const std::exception& e) {
                 log::error(logcat, "Error adding transaction to txpool: {}", e.what());
                 return false;
@@ -511,19 +541,22 @@ bool tx_memory_pool::add_tx(
         meta.double_spend_seen = false;
 
         try {
-            if (opts.kept_by_block)
-                m_parsed_tx_cache.insert(std::make_pair(id, tx));
+            if (opts.kept_by_block && m_parsed_tx_cache.insert(std::make_pair(id, tx)).second)
+                m_parsed_tx_cache_memory += blob.size();
             std::unique_lock b_lock{m_blockchain};
-            LockedTXN lock(m_blockchain);
             m_blockchain.db().remove_txpool_tx(id);
             m_blockchain.db().add_txpool_tx(id, blob, meta);
             if (!insert_key_images(tx, id, opts.kept_by_block)) {
                 oxen::log::error(logcat, "Failed to insert key images for tx: ", id);
+                m_blockchain.db().remove_txpool_tx(id);
                 return false;
             }
-            m_txs_by_priority.emplace(
-                    prio, fee / (double)(tx_weight ? tx_weight : 1), receive_time, id);
-            lock.commit();
+            add_to_sorted_container(
+                    prio,
+                    fee / (double)(tx_weight ? tx_weight : 1),
+                    receive_time,
+                    id,
+                    tx_memory_usage(tx, blob.size()));
         } catch (const std::exception& e) {
             log::error(logcat, "internal error: error adding transaction to txpool: {}", e.what());
             return false;
@@ -604,9 +637,20 @@ bool tx_memory_pool::add_existing_blink(std::shared_ptr<blink_tx> blink_ptr) {
         return false;
 
     ptr = blink_ptr;
+    record_pool_change(blink_ptr->get_txhash());
     return true;
 }
 //---------------------------------------------------------------------------------
+void tx_memory_pool::notify_approved_blink(const blink_tx& blink) {
+    auto* tx = std::get_if<transaction>(&blink.tx);
+    if (!tx || m_tx_notify.empty())
+        return;
+    auto opts = tx_pool_options::new_blink(true, m_blockchain.get_network_version(blink.height));
+    auto blob = tx_to_blob(*tx);
+    for (auto& notify : m_tx_notify)
+        notify(blink.get_txhash(), *tx, blob, opts);
+}
+//---------------------------------------------------------------------------------
 std::shared_ptr<blink_tx> tx_memory_pool::get_blink(const crypto::hash& tx_hash) const {
     auto it = m_blinks.find(tx_hash);
     if (it != m_blinks.end())
@@ -795,6 +839,22 @@ void tx_memory_pool::set_txpool_max_weight(size_t bytes) {
     m_txpool_max_weight = bytes;
 }
 //---------------------------------------------------------------------------------
+size_t tx_memory_pool::get_txpool_memory() const {
+    std::unique_lock lock{m_transactions_lock};
+    return m_txpool_memory + m_parsed_tx_cache_memory;
+}
+//---------------------------------------------------------------------------------
+void tx_memory_pool::set_txpool_max_memory(size_t bytes) {
+    std::unique_lock lock{m_transactions_lock};
+    m_txpool_max_memory = bytes;
+}
+//---------------------------------------------------------------------------------
+bool tx_memory_pool::over_limit() const {
+    return m_txpool_weight > m_txpool_max_weight ||
+           (m_txpool_max_memory &&
+            m_txpool_memory + m_parsed_tx_cache_memory > m_txpool_max_memory);
+}
+//---------------------------------------------------------------------------------
 bool tx_memory_pool::remove_tx(
         const crypto::hash& txid,
         const txpool_tx_meta_t* meta,
@@ -832,7 +892,8 @@ bool tx_memory_pool::remove_tx(
     m_blockchain.db().remove_txpool_tx(txid);
     m_txpool_weight -= meta->weight;
     remove_transaction_keyimages(tx, txid);
-    m_txs_by_priority.erase(it);
+    remove_from_sorted_container(it);
+    uncache_parsed_tx(txid, tx_blob.size());
 
     return true;
 }
@@ -891,7 +952,7 @@ void tx_memory_pool::prune(const crypto::hash& skip) {
     auto it = m_txs_by_priority.end();
     if (it != m_txs_by_priority.begin())
         it = std::prev(it);
-    while (m_txpool_weight > m_txpool_max_weight && it != m_txs_by_priority.begin()) {
+    while (over_limit() && it != m_txs_by_priority.begin()) {
         if (std::get<tx_priority>(*it) != tx_priority::standard)
             break;
 
@@ -901,16 +962,19 @@ void tx_memory_pool::prune(const crypto::hash& skip) {
     lock.commit();
     if (changed)
         ++m_cookie;
-    if (m_txpool_weight > m_txpool_max_weight)
+    if (over_limit())
         log::info(
                 logcat,
-                "Pool weight after pruning is still larger than limit: {}/{}",
+                "Pool after pruning is still larger than limit: weight {}/{}, memory {}/{}",
                 m_txpool_weight,
-                m_txpool_max_weight);
+                m_txpool_max_weight,
+                m_txpool_memory + m_parsed_tx_cache_memory,
+                m_txpool_max_memory);
 }
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::insert_key_images(
         const transaction_prefix& tx, const crypto::hash& id, bool kept_by_block) {
+    std::unique_lock ki_lock{m_spent_key_images_mutex};
     for (const auto& in : tx.vin) {
         CHECKED_GET_SPECIFIC_VARIANT(in, txin_to_key, txin, false);
         std::unordered_set<crypto::hash>& kei_image_set = m_spent_key_images[txin.k_image];
@@ -939,6 +1003,7 @@ bool tx_memory_pool::insert_key_images(
 bool tx_memory_pool::remove_transaction_keyimages(
         const transaction_prefix& tx, const crypto::hash& actual_hash) {
     auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    std::unique_lock ki_lock{m_spent_key_images_mutex};
 
     // ND: Speedup
     for (const txin_v& vi : tx.vin) {
@@ -974,12 +1039,8 @@ bool tx_memory_pool::remove_transaction_keyimages(
     ++m_cookie;
     return true;
 }
-tx_memory_pool::key_images_container tx_memory_pool::get_spent_key_images(bool already_locked) {
-    std::unique_lock tx_lock{*this, std::defer_lock};
-    std::unique_lock bc_lock{m_blockchain, std::defer_lock};
-    if (!already_locked)
-        std::lock(tx_lock, bc_lock);
-
+tx_memory_pool::key_images_container tx_memory_pool::get_spent_key_images() const {
+    std::shared_lock ki_lock{m_spent_key_images_mutex};
     return m_spent_key_images;
 }
 
@@ -1031,13 +1092,22 @@ bool tx_memory_pool::take_tx(
     }
 
     if (sorted_it != m_txs_by_priority.end())
-        m_txs_by_priority.erase(sorted_it);
+        remove_from_sorted_container(sorted_it);
+    uncache_parsed_tx(id, txblob.size());
     ++m_cookie;
     return true;
 }
 //---------------------------------------------------------------------------------
 void tx_memory_pool::on_idle() {
     m_remove_stuck_tx_interval.do_call([this]() { return remove_stuck_transactions(); });
+    m_flush_interval.do_call([this]() {
+        // If the blockchain is busy (e.g. adding blocks) we just try again next time
+        std::unique_lock lock{m_blockchain, std::try_to_lock};
+        if (!lock)
+            return false;
+        m_blockchain.db().flush_txpool();
+        return true;
+    });
 }
 
 void tx_memory_pool::add_notify(std::function<
@@ -1052,9 +1122,45 @@ void tx_memory_pool::add_notify(std::function<
 //---------------------------------------------------------------------------------
 sorted_tx_container::iterator tx_memory_pool::find_tx_in_sorted_container(
         const crypto::hash& id) const {
-    return std::find_if(m_txs_by_priority.begin(), m_txs_by_priority.end(), [&](const auto& a) {
-        return std::get<crypto::hash>(a) == id;
-    });
+    auto it = m_txs_by_id.find(id);
+    return it != m_txs_by_id.end() ? it->second.it : m_txs_by_priority.end();
+}
+//---------------------------------------------------------------------------------
+void tx_memory_pool::add_to_sorted_container(
+        tx_priority prio,
+        double fee_per_byte,
+        std::time_t receive_time,
+        const crypto::hash& id,
+        size_t memory) {
+    auto [it, inserted] = m_txs_by_priority.emplace(prio, fee_per_byte, receive_time, id);
+    if (!inserted)
+        return;
+    m_txs_by_id[id] = {it, memory};
+    m_txpool_memory += memory;
+    record_pool_change(id);
+}
+//---------------------------------------------------------------------------------
+void tx_memory_pool::remove_from_sorted_container(sorted_tx_container::iterator it) {
+    if (auto idx = m_txs_by_id.find(std::get<crypto::hash>(*it)); idx != m_txs_by_id.end()) {
+        m_txpool_memory -= std::min(m_txpool_memory, idx->second.memory);
+        m_txs_by_id.erase(idx);
+    }
+    record_pool_change(std::get<crypto::hash>(*it));
+    m_txs_by_priority.erase(it);
+}
+//---------------------------------------------------------------------------------
+void tx_memory_pool::record_pool_change(const crypto::hash& txid) {
+    std::lock_guard lock{m_pool_changes_mutex};
+    m_pool_changes.emplace_back(++m_pool_seqno, txid);
+    while (m_pool_changes.size() > MAX_POOL_CHANGES) {
+        m_pool_changes_base = m_pool_changes.front().first;
+        m_pool_changes.pop_front();
+    }
+}
+//---------------------------------------------------------------------------------
+void tx_memory_pool::uncache_parsed_tx(const crypto::hash& id, size_t blob_size) {
+    if (m_parsed_tx_cache.erase(id))
+        m_parsed_tx_cache_memory -= std::min(m_parsed_tx_cache_memory, blob_size);
 }
 //---------------------------------------------------------------------------------
 // TODO: investigate whether boolean return is appropriate
@@ -1083,7 +1189,7 @@ bool tx_memory_pool::remove_stuck_transactions() {
                                 "txs container!",
                                 txid);
                     } else {
-                        m_txs_by_priority.erase(sorted_it);
+                        remove_from_sorted_container(sorted_it);
                     }
                     m_timed_out_transactions.insert(txid);
                     remove.push_back(std::make_pair(txid, meta.weight));
@@ -1107,6 +1213,7 @@ bool tx_memory_pool::remove_stuck_transactions() {
                     m_blockchain.db().remove_txpool_tx(txid);
                     m_txpool_weight -= entry.second;
                     remove_transaction_keyimages(tx, txid);
+                    uncache_parsed_tx(txid, bd.size());
                 }
             } catch (const std::exception& e) {
                 log::warning(logcat, "Failed to remove stuck transaction: {}", txid);
@@ -1226,14 +1333,16 @@ void tx_memory_pool::set_relayed(const std::vector<std::pair<crypto::hash, std::
     lock.commit();
 }
 //---------------------------------------------------------------------------------
+// The following only read the pool tables of the database, which doesn't need the pool lock:
+// changes to the pool are only visible once committed, and a read txn gives a consistent view of
+// the pool across multiple reads.
 size_t tx_memory_pool::get_transactions_count(bool include_unrelayed_txes) const {
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
     return m_blockchain.db().get_txpool_tx_count(include_unrelayed_txes);
 }
 //---------------------------------------------------------------------------------
 void tx_memory_pool::get_transactions(
         std::vector<transaction>& txs, bool include_unrelayed_txes) const {
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
 
     txs.reserve(m_blockchain.db().get_txpool_tx_count(include_unrelayed_txes));
     m_blockchain.db().for_all_txpool_txes(
@@ -1256,7 +1365,10 @@ void tx_memory_pool::get_transaction_hashes(
         std::vector<crypto::hash>& txs,
         bool include_unrelayed_txes,
         bool include_only_blinked) const {
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    auto blink_lock = blink_shared_lock(std::defer_lock);
+    if (include_only_blinked)
+        blink_lock.lock();
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
 
     txs.reserve(m_blockchain.db().get_txpool_tx_count(include_unrelayed_txes));
     m_blockchain.db().for_all_txpool_txes(
@@ -1273,8 +1385,50 @@ void tx_memory_pool::get_transaction_hashes(
             include_unrelayed_txes);
 }
 //------------------------------------------------------------------
+tx_memory_pool::tx_hash_changes tx_memory_pool::get_transaction_hash_changes(
+        uint64_t since, bool include_unrelayed_txes, bool include_only_blinked) const {
+    // The pool lock ensures that every change in the log has been committed to the database
+    // (changes are recorded during the update, before the commit).
+    std::unique_lock pool_lock{m_transactions_lock};
+
+    tx_hash_changes result{};
+    std::unordered_set<crypto::hash> changed;
+    {
+        std::lock_guard lock{m_pool_changes_mutex};
+        result.seqno = m_pool_seqno;
+        result.incremental = since >= m_pool_changes_base && since <= m_pool_seqno;
+        if (result.incremental) {
+            auto it = std::lower_bound(
+                    m_pool_changes.begin(),
+                    m_pool_changes.end(),
+                    since + 1,
+                    [](const auto& change, uint64_t seqno) { return change.first < seqno; });
+            for (; it != m_pool_changes.end(); ++it)
+                changed.insert(it->second);
+        }
+    }
+
+    if (!result.incremental) {
+        get_transaction_hashes(result.added, include_unrelayed_txes, include_only_blinked);
+        return result;
+    }
+
+    auto blink_lock = blink_shared_lock(std::defer_lock);
+    if (include_only_blinked)
+        blink_lock.lock();
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
+    for (const auto& txid : changed) {
+        txpool_tx_meta_t meta;
+        bool present = m_blockchain.db().get_txpool_tx_meta(txid, meta) &&
+                       (include_unrelayed_txes || !meta.do_not_relay) &&
+                       (!include_only_blinked || has_blink(txid));
+        (present ? result.added : result.removed).push_back(txid);
+    }
+    return result;
+}
+//------------------------------------------------------------------
 tx_memory_pool::tx_stats tx_memory_pool::get_transaction_stats(bool include_unrelayed_txes) const {
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
 
     tx_stats stats{};
     const uint64_t now = time(NULL);
@@ -1364,7 +1518,7 @@ tx_memory_pool::tx_stats tx_memory_pool::get_transaction_stats(bool include_unre
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::check_for_key_images(
         const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const {
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    std::shared_lock ki_lock{m_spent_key_images_mutex};
 
     spent.clear();
 
@@ -1381,7 +1535,7 @@ int tx_memory_pool::find_transactions(
     if (tx_hashes.empty())
         return 0;
     txblobs.reserve(txblobs.size() + tx_hashes.size());
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
 
     int added = 0;
     for (auto& id : tx_hashes) {
@@ -1401,7 +1555,7 @@ std::vector<std::optional<transaction>> tx_memory_pool::load_transactions(
         const std::vector<crypto::hash>& tx_hashes) const {
     std::vector<std::optional<transaction>> result;
     result.reserve(tx_hashes.size());
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
 
     for (auto& txid : tx_hashes) {
         auto& otx = result.emplace_back();
@@ -1435,6 +1589,8 @@ bool tx_memory_pool::on_blockchain_inc(block const& blk) {
     std::unique_lock lock{m_transactions_lock};
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
+    m_parsed_tx_cache_memory = 0;
+    m_template_tx_cache.clear();
 
     std::vector<transaction> pool_txs;
     get_transactions(pool_txs);
@@ -1528,12 +1684,14 @@ bool tx_memory_pool::on_blockchain_dec() {
     std::unique_lock lock{m_transactions_lock};
     m_input_cache.clear();
     m_parsed_tx_cache.clear();
+    m_parsed_tx_cache_memory = 0;
+    m_template_tx_cache.clear();
     return true;
 }
 //------------------------------------------------------------------
 std::vector<uint8_t> tx_memory_pool::have_txs(const std::vector<crypto::hash>& hashes) const {
     std::vector<uint8_t> result(hashes.size(), false);
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    db_rtxn_guard rtxn_guard{m_blockchain.db()};
 
     auto& db = m_blockchain.db();
     for (size_t i = 0; i < hashes.size(); i++)
@@ -1548,7 +1706,7 @@ bool tx_memory_pool::have_tx(const crypto::hash& id) const {
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::have_tx_keyimges_as_spent(
         const transaction& tx, std::vector<crypto::hash>* conflicting) const {
-    auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
+    std::shared_lock ki_lock{m_spent_key_images_mutex};
 
     bool ret = false;
     for (const auto& in : tx.vin) {
@@ -1565,7 +1723,7 @@ bool tx_memory_pool::have_tx_keyimges_as_spent(
 }
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::have_tx_keyimg_as_spent(const crypto::key_image& key_im) const {
-    std::unique_lock lock{m_transactions_lock};
+    std::shared_lock ki_lock{m_spent_key_images_mutex};
     return m_spent_key_images.end() != m_spent_key_images.find(key_im);
 }
 //---------------------------------------------------------------------------------
@@ -1780,21 +1938,40 @@ bool tx_memory_pool::is_transaction_ready_to_go(
     return true;
 }
 //---------------------------------------------------------------------------------
+/**
+ * @brief get the key images spent by a transaction
+ *
+ * @param tx the transaction
+ *
+ * @return the key images of the transaction's inputs, up to the first input that is not a
+ * txin_to_key
+ */
+static std::vector<crypto::key_image> get_key_images(const transaction_prefix& tx) {
+    std::vector<crypto::key_image> k_images;
+    k_images.reserve(tx.vin.size());
+    for (const auto& in : tx.vin) {
+        auto* itk = std::get_if<txin_to_key>(&in);
+        if (!itk)
+            break;
+        k_images.push_back(itk->k_image);
+    }
+    return k_images;
+}
+//---------------------------------------------------------------------------------
 /**
  * @brief check if any of a transaction's spent key images are present in a given set
  *
- * @param kic the set of key images to check against
- * @param tx the transaction to check
+ * @param k_images the set of key images to check against
+ * @param tx_k_images the key images of the transaction to check
  *
  * @return true if any key images present in the set, otherwise false
  */
 static bool have_key_images(
-        const std::unordered_set<crypto::key_image>& k_images, const transaction_prefix& tx) {
-    for (size_t i = 0; i != tx.vin.size(); i++) {
-        CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], txin_to_key, itk, false);
-        if (k_images.count(itk.k_image))
+        const std::unordered_set<crypto::key_image>& k_images,
+        const std::vector<crypto::key_image>& tx_k_images) {
+    for (const auto& ki : tx_k_images)
+        if (k_images.count(ki))
             return true;
-    }
     return false;
 }
 //---------------------------------------------------------------------------------
@@ -1802,21 +1979,21 @@ static bool have_key_images(
 /**
  * @brief append the key images from a transaction to the given set
  *
- * @param kic the set of key images to append to
- * @param tx the transaction
+ * @param k_images the set of key images to append to
+ * @param tx_k_images the key images of the transaction
  *
  * @return false if any append fails, otherwise true
  */
 static bool append_key_images(
-        std::unordered_set<crypto::key_image>& k_images, const transaction_prefix& tx) {
-    for (size_t i = 0; i != tx.vin.size(); i++) {
-        CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], txin_to_key, itk, false);
-        auto i_res = k_images.insert(itk.k_image);
+        std::unordered_set<crypto::key_image>& k_images,
+        const std::vector<crypto::key_image>& tx_k_images) {
+    for (const auto& ki : tx_k_images) {
+        auto i_res = k_images.insert(ki);
         CHECK_AND_ASSERT_MES(
                 i_res.second,
                 false,
                 "internal error: key images pool cache - inserted duplicate image in set: {}",
-                itk.k_image);
+                ki);
     }
     return true;
 }
@@ -1976,33 +2153,49 @@ bool tx_memory_pool::fill_block_template(
             }
         }
 
-        std::string txblob = m_blockchain.db().get_txpool_tx_blob(txid);
-        cryptonote::transaction tx;
-
         // Skip transactions that are not ready to be
         // included into the blockchain or that are
         // missing key images
-        const cryptonote::txpool_tx_meta_t original_meta = meta;
         bool ready = false;
-        try {
-            ready = is_transaction_ready_to_go(meta, txid, txblob, tx, version, height, l2_max);
-        } catch (const std::exception& e) {
-            log::error(logcat, "Failed to check transaction readiness: {}", e.what());
-            // continue, not fatal
-        }
-        if (memcmp(&original_meta, &meta, sizeof(meta))) {
+        std::vector<crypto::key_image> tx_k_images;
+        if (auto cached = m_template_tx_cache.find(txid);
+            cached != m_template_tx_cache.end() && cached->second.version == version &&
+            cached->second.height == height) {
+            ready = cached->second.ready;
+            if (ready)
+                tx_k_images = cached->second.key_images;
+        } else {
+            std::string txblob = m_blockchain.db().get_txpool_tx_blob(txid);
+            cryptonote::transaction tx;
+            const cryptonote::txpool_tx_meta_t original_meta = meta;
+            bool checked = false;
             try {
-                m_blockchain.db().update_txpool_tx(txid, meta);
+                ready = is_transaction_ready_to_go(
+                        meta, txid, txblob, tx, version, height, l2_max);
+                checked = true;
             } catch (const std::exception& e) {
-                log::error(logcat, "Failed to update tx meta: {}", e.what());
+                log::error(logcat, "Failed to check transaction readiness: {}", e.what());
                 // continue, not fatal
             }
+            if (memcmp(&original_meta, &meta, sizeof(meta))) {
+                try {
+                    m_blockchain.db().update_txpool_tx(txid, meta);
+                } catch (const std::exception& e) {
+                    log::error(logcat, "Failed to update tx meta: {}", e.what());
+                    // continue, not fatal
+                }
+            }
+            tx_k_images = get_key_images(tx);
+            // L2 events also depend on the L2 tracker's current votes and the requested l2_max,
+            // which can change without a new block, so those always get rechecked.
+            if (checked && !is_l2_event_tx(tx.type))
+                m_template_tx_cache[txid] = {version, height, ready, tx_k_images};
         }
         if (!ready) {
             log::debug(logcat, "  not ready to go");
             continue;
         }
-        if (have_key_images(k_images, tx)) {
+        if (have_key_images(k_images, tx_k_images)) {
             log::debug(logcat, "  key images already seen");
             continue;
         }
@@ -2014,7 +2207,7 @@ bool tx_memory_pool::fill_block_template(
         raw_fee += meta.fee;
         net_fee = next_reward_parts.miner_fee;
         best_reward = next_reward;
-        append_key_images(k_images, tx);
+        append_key_images(k_images, tx_k_images);
         log::debug(
                 logcat,
                 "  added, new block weight {}/{}, reward {}",
@@ -2088,8 +2281,9 @@ size_t tx_memory_pool::validate(hf version) {
                             "container!",
                             txid);
                 } else {
-                    m_txs_by_priority.erase(sorted_it);
+                    remove_from_sorted_container(sorted_it);
                 }
+                uncache_parsed_tx(txid, txblob.size());
                 ++n_removed;
             } catch (const std::exception& e) {
                 log::error(logcat, "Failed to remove invalid tx from pool");
@@ -2103,49 +2297,99 @@ size_t tx_memory_pool::validate(hf version) {
     return n_removed;
 }
 //---------------------------------------------------------------------------------
-bool tx_memory_pool::init(size_t max_txpool_weight) {
+bool tx_memory_pool::init(size_t max_txpool_weight, size_t max_txpool_memory) {
     auto locks = tools::unique_locks(m_transactions_lock, m_blockchain);
 
     m_txpool_max_weight = max_txpool_weight ? max_txpool_weight : DEFAULT_MEMPOOL_MAX_WEIGHT;
+    m_txpool_max_memory = max_txpool_memory;
     m_txs_by_priority.clear();
-    m_spent_key_images.clear();
+    m_txs_by_id.clear();
+    {
+        std::unique_lock ki_lock{m_spent_key_images_mutex};
+        m_spent_key_images.clear();
+    }
     m_txpool_weight = 0;
+    m_txpool_memory = 0;
     std::vector<crypto::hash> remove;
 
-    // first add the not kept by block, then the kept by block,
-    // to avoid rejection due to key image collision
-    for (int pass = 0; pass < 2; ++pass) {
-        const bool kept = pass == 1;
-        bool r = m_blockchain.db().for_all_txpool_txes(
-                [this, &remove, kept](
-                        const crypto::hash& txid,
-                        const txpool_tx_meta_t& meta,
-                        const std::string* bd) {
-                    if (kept != (bool)meta.kept_by_block)
-                        return true;
-                    cryptonote::transaction_prefix tx;
-                    if (!parse_and_validate_tx_prefix_from_blob(*bd, tx)) {
-                        log::warning(logcat, "Failed to parse tx from txpool, removing");
-                        remove.push_back(txid);
-                        return true;
-                    }
-                    if (!insert_key_images(tx, txid, meta.kept_by_block)) {
-                        log::error(logcat, "Failed to insert key images from txpool tx");
-                        return false;
-                    }
+    // The stored txes were all verified when they were added, and their inputs get checked against
+    // the chain again (see is_transaction_ready_to_go()) before they go into a block, so all we
+    // need to do here is parse them.  With a big pool that's most of the startup time, so we read
+    // them in chunks and parse each chunk on the threadpool.
+    struct stored_tx {
+        crypto::hash txid;
+        txpool_tx_meta_t meta;
+        std::string blob;
+        cryptonote::transaction_prefix tx;
+        size_t blob_size;
+        bool parsed;
+    };
+    constexpr size_t CHUNK_SIZE = 1024, PARSE_BATCH_SIZE = 32;
+    std::vector<stored_tx> chunk, kept;
+    chunk.reserve(CHUNK_SIZE);
+    auto& tpool = tools::threadpool::getInstance();
+
+    auto add_parsed = [this](const stored_tx& stx) {
+        if (!insert_key_images(stx.tx, stx.txid, stx.meta.kept_by_block)) {
+            log::error(logcat, "Failed to insert key images from txpool tx");
+            return false;
+        }
 
-                    tx_priority prio = is_l2_event_tx(tx.type) ? tx_priority::l2_event
-                                     : !tx.is_transfer()       ? tx_priority::state_change
-                                                               : tx_priority::standard;
-                    m_txs_by_priority.emplace(
-                            prio, meta.fee / (double)meta.weight, meta.receive_time, txid);
-                    m_txpool_weight += meta.weight;
-                    return true;
-                },
-                true);
-        if (!r)
+        tx_priority prio = is_l2_event_tx(stx.tx.type) ? tx_priority::l2_event
+                         : !stx.tx.is_transfer()       ? tx_priority::state_change
+                                                       : tx_priority::standard;
+        add_to_sorted_container(
+                prio,
+                stx.meta.fee / (double)stx.meta.weight,
+                stx.meta.receive_time,
+                stx.txid,
+                tx_memory_usage(stx.tx, stx.blob_size));
+        m_txpool_weight += stx.meta.weight;
+        return true;
+    };
+
+    // Parses the txes in `chunk` and adds them; the kept by block ones are held back to be added
+    // once all the others have been, to avoid rejection due to key image collision.
+    auto add_chunk = [&] {
+        tools::threadpool::waiter waiter;
+        for (size_t i = 0; i < chunk.size(); i += PARSE_BATCH_SIZE)
+            tpool.submit(
+                    &waiter,
+                    [&chunk, i, end = std::min(i + PARSE_BATCH_SIZE, chunk.size())] {
+                        for (size_t j = i; j < end; j++) {
+                            auto& stx = chunk[j];
+                            stx.parsed = parse_and_validate_tx_prefix_from_blob(stx.blob, stx.tx);
+                            stx.blob_size = stx.blob.size();
+                            stx.blob = std::string{};
+                        }
+                    },
+                    true /*leaf*/);
+        waiter.wait(&tpool);
+
+        for (auto& stx : chunk) {
+            if (!stx.parsed) {
+                log::warning(logcat, "Failed to parse tx from txpool, removing");
+                remove.push_back(stx.txid);
+            } else if (stx.meta.kept_by_block)
+                kept.push_back(std::move(stx));
+            else if (!add_parsed(stx))
+                return false;
+        }
+        chunk.clear();
+        return true;
+    };
+
+    bool r = m_blockchain.db().for_all_txpool_txes(
+            [&](const crypto::hash& txid, const txpool_tx_meta_t& meta, const std::string* bd) {
+                chunk.push_back({txid, meta, *bd});
+                return chunk.size() < CHUNK_SIZE || add_chunk();
+            },
+            true);
+    if (!r || !add_chunk())
+        return false;
+    for (const auto& stx : kept)
+        if (!add_parsed(stx))
             return false;
-    }
     if (!remove.empty()) {
         LockedTXN lock(m_blockchain);
         for (const auto& txid : remove) {
@@ -2167,6 +2411,8 @@ bool tx_memory_pool::init(size_t max_txpool_weight) {
 
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::deinit() {
+    std::unique_lock lock{m_blockchain};
+    m_blockchain.db().flush_txpool();
     return true;
 }
 }  // namespace cryptonote
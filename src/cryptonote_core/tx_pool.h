@@ -31,6 +31,7 @@
 #pragma once
 
 #include <boost/serialization/version.hpp>
+#include <deque>
 #include <functional>
 #include <set>
 #include <unordered_map>
@@ -245,6 +246,17 @@ class tx_memory_pool {
      */
     bool add_existing_blink(std::shared_ptr<blink_tx> blink);
 
+    /**
+     * @brief invokes the add_notify callbacks for a blink tx that has just become approved
+     *
+     * A blink tx is added to the pool (as do-not-relay, and so without notification) while its
+     * quorum is still signing it; this announces it once it collects enough approvals.  Does
+     * nothing if `blink` does not hold the full transaction.
+     *
+     * @param blink the newly approved blink tx
+     */
+    void notify_approved_blink(const blink_tx& blink);
+
     /**
      * @brief accesses blink tx details if the given tx hash is a known, approved blink tx, nullptr
      * otherwise.
@@ -366,10 +378,16 @@ class tx_memory_pool {
     /**
      * @brief action to take periodically
      *
-     * Currently checks transaction pool for stale ("stuck") transactions
+     * Checks transaction pool for stale ("stuck") transactions, and writes pending pool changes
+     * out to the db.
      */
     void on_idle();
 
+    /// When on_idle() next has something to do
+    std::chrono::steady_clock::time_point next_idle_due() const {
+        return std::min(m_remove_stuck_tx_interval.next_due(), m_flush_interval.next_due());
+    }
+
     /**
      * Specifies a callback to invoke when one or more transactions is added to the mempool.  Note
      * that, because incoming blocks have their transactions added to the mempool, this *does*
@@ -421,10 +439,12 @@ class tx_memory_pool {
      * @brief loads pool state (if any) from disk, and initializes pool
      *
      * @param max_txpool_weight the max weight in bytes
+     * @param max_txpool_memory the max (approximate) memory used by the pool in bytes, or 0 for no
+     * limit beyond the weight limit
      *
      * @return true
      */
-    bool init(size_t max_txpool_weight = 0);
+    bool init(size_t max_txpool_weight = 0, size_t max_txpool_memory = 0);
 
     /**
      * @brief attempts to save the transaction pool state to disk
@@ -489,6 +509,33 @@ class tx_memory_pool {
             bool include_unrelayed_txes = true,
             bool include_only_blinked = false) const;
 
+    /// Result of get_transaction_hash_changes()
+    struct tx_hash_changes {
+        /// The pool sequence number this result is current as of; pass it as `since` to the next
+        /// call to get only what changed after this one.
+        uint64_t seqno;
+        /// True if `added` is just the txids changed since `since` and `removed` is filled;
+        /// false if `since` was 0, unknown or too old to be answered incrementally, in which case
+        /// `added` contains the whole pool (as for get_transaction_hashes) and `removed` is empty.
+        bool incremental;
+        std::vector<crypto::hash> added;
+        std::vector<crypto::hash> removed;
+    };
+
+    /**
+     * @brief get the transaction hashes that have entered or left the pool since a previous call,
+     * so that pollers can avoid fetching the whole pool every time.
+     *
+     * A tx that was blink approved since `since` counts as added when `include_only_blinked` is
+     * given.  A tx can appear in `removed` without the caller having seen it added (e.g. if it
+     * came and went between calls, or is a non-blink tx when only blinks are requested).
+     *
+     * @param since the `seqno` from a previous call, or 0 to get the whole pool
+     * @param include_unrelayed_txes, include_only_blinked as for get_transaction_hashes
+     */
+    tx_hash_changes get_transaction_hash_changes(
+            uint64_t since, bool include_unrelayed_txes, bool include_only_blinked) const;
+
     /// Return type of get_transaction_stats()
     struct tx_stats {
         uint64_t bytes_total;      ///< Total size of all transactions in pool.
@@ -635,6 +682,19 @@ class tx_memory_pool {
      */
     void set_txpool_max_weight(size_t bytes);
 
+    /**
+     * @brief get the approximate memory used by the pool's txes, in bytes.  This counts the tx
+     * blobs plus the per-tx bookkeeping kept in memory (priority and key image entries, and the
+     * parsed tx cache) rather than the consensus tx weight.
+     */
+    size_t get_txpool_memory() const;
+
+    /**
+     * @brief set the max approximate memory (as returned by get_txpool_memory()) that the pool may
+     * use before low priority txes get pruned, in bytes.  0 means no limit.
+     */
+    void set_txpool_max_memory(size_t bytes);
+
     // TODO: confirm the below comments and investigate whether or not this
     //       is the desired behavior
     //! map key images to transactions which spent them
@@ -647,11 +707,9 @@ class tx_memory_pool {
     using key_images_container =
             std::unordered_map<crypto::key_image, std::unordered_set<crypto::hash>>;
 
-    /// Returns a copy of the map of key images -> set of transactions which spent them.
-    ///
-    /// \param already_locked can be passed as true if the caller already has a lock on the
-    /// blockchain and mempool objects; otherwise a new lock will be obtained by the call.
-    key_images_container get_spent_key_images(bool already_locked = false);
+    /// Returns a copy of the map of key images -> set of transactions which spent them.  This only
+    /// needs the key image lock, not the pool lock (see m_spent_key_images_mutex).
+    key_images_container get_spent_key_images() const;
 
   private:
     /**
@@ -808,10 +866,18 @@ class tx_memory_pool {
     //! container for spent key images from the transactions in the pool
     key_images_container m_spent_key_images;
 
+    //! guards m_spent_key_images.  Modifications also require the pool lock, so code that holds
+    //! the pool lock can read it without this; this lets key image queries (e.g. from RPC) go
+    //! ahead without waiting for the pool lock.
+    mutable std::shared_mutex m_spent_key_images_mutex;
+
     // TODO: this time should be a named constant somewhere, not hard-coded
     //! interval on which to check for stale/"stuck" transactions
     tools::periodic_task m_remove_stuck_tx_interval{"stale tx cleanup", 30s};
 
+    //! interval on which pool changes held back by the db are written out
+    tools::periodic_task m_flush_interval{"pool flush", 2s};
+
     // TODO: look into doing this better
     //!< container for transactions organized by fee per size and receive time
     sorted_tx_container m_txs_by_priority;
@@ -835,6 +901,28 @@ class tx_memory_pool {
      */
     sorted_tx_container::iterator find_tx_in_sorted_container(const crypto::hash& id) const;
 
+    /// Adds a tx to m_txs_by_priority (and the m_txs_by_id index), accounting `memory` bytes
+    /// towards m_txpool_memory.
+    void add_to_sorted_container(
+            tx_priority prio,
+            double fee_per_byte,
+            std::time_t receive_time,
+            const crypto::hash& id,
+            size_t memory);
+
+    /// Removes a tx from m_txs_by_priority and its index, and releases its memory accounting.
+    void remove_from_sorted_container(sorted_tx_container::iterator it);
+
+    /// Drops a tx from m_parsed_tx_cache (if present) given the size of its blob.
+    void uncache_parsed_tx(const crypto::hash& id, size_t blob_size);
+
+    /// Returns true if the pool is above either its weight or memory limit
+    bool over_limit() const;
+
+    /// Records a change to the given tx (added, removed or newly blink approved) in the pool
+    /// change log.  Called with the pool or blink lock held, but doesn't take or need either.
+    void record_pool_change(const crypto::hash& txid);
+
     //! cache/call Blockchain::check_tx_inputs results
     bool check_tx_inputs(
             cryptonote::transaction& tx,
@@ -856,6 +944,29 @@ class tx_memory_pool {
     size_t m_txpool_max_weight;
     size_t m_txpool_weight;
 
+    //! approximate memory footprint of the pool txes (see get_txpool_memory()), of which
+    //! m_parsed_tx_cache_memory is the part held by m_parsed_tx_cache.
+    size_t m_txpool_max_memory = 0;
+    size_t m_txpool_memory = 0;
+    size_t m_parsed_tx_cache_memory = 0;
+
+    //! index of m_txs_by_priority by tx hash, along with the memory accounted for each tx
+    struct sorted_tx_index_entry {
+        sorted_tx_container::iterator it;
+        size_t memory;
+    };
+    std::unordered_map<crypto::hash, sorted_tx_index_entry> m_txs_by_id;
+
+    //! recent pool changes for get_transaction_hash_changes(): the sequence number assigned to each
+    //! change and the affected txid, in order, and the sequence number after which everything is
+    //! still in the log.  Sequence numbers start from a random value so that a cursor from a
+    //! different node (or an earlier run of this one) is never mistaken as valid.
+    static constexpr size_t MAX_POOL_CHANGES = 10'000;
+    std::deque<std::pair<uint64_t, crypto::hash>> m_pool_changes;
+    uint64_t m_pool_seqno;
+    uint64_t m_pool_changes_base;
+    mutable std::mutex m_pool_changes_mutex;
+
     mutable std::unordered_map<
             crypto::hash,
             std::tuple<bool, tx_verification_context, uint64_t, crypto::hash>>
@@ -863,6 +974,18 @@ class tx_memory_pool {
 
     std::unordered_map<crypto::hash, transaction> m_parsed_tx_cache;
 
+    //! readiness (and spent key images) of pool txes as last determined by fill_block_template.
+    //! Only valid for the current chain tip, so cleared whenever it changes; this lets repeated
+    //! template building (e.g. by pulse leaders for each round) skip re-parsing and re-checking
+    //! txes already considered.
+    struct template_tx_info {
+        hf version;
+        uint64_t height;
+        bool ready;
+        std::vector<crypto::key_image> key_images;
+    };
+    std::unordered_map<crypto::hash, template_tx_info> m_template_tx_cache;
+
     mutable std::shared_mutex m_blinks_mutex;
 
     // Contains blink metadata for approved blink transactions. { txhash => blink_tx, ... }.
@@ -0,0 +1,117 @@
+#include "verification_cache.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include "common/metrics.h"
+#include "crypto/keccak.h"
+
+namespace cryptonote {
+
+using namespace std::literals;
+
+verification_cache::verification_cache(size_t max_entries) :
+        m_max_per_shard{std::max<size_t>(1, max_entries / NUM_SHARDS)} {}
+
+crypto::hash verification_cache::semantics_key(const crypto::hash& tx_hash) {
+    constexpr auto tag = "rct-semantics"sv;
+    KECCAK_CTX ctx;
+    keccak_init(&ctx);
+    keccak_update(&ctx, reinterpret_cast<const uint8_t*>(tag.data()), tag.size());
+    keccak_update(&ctx, tx_hash.data(), tx_hash.size());
+    crypto::hash result;
+    keccak_finish(&ctx, result.data(), result.size());
+    return result;
+}
+
+crypto::hash verification_cache::ring_key(const crypto::hash& tx_hash, const rct::rctSig& rv) {
+    constexpr auto tag = "rct-ring-sigs"sv;
+    KECCAK_CTX ctx;
+    keccak_init(&ctx);
+    keccak_update(&ctx, reinterpret_cast<const uint8_t*>(tag.data()), tag.size());
+    keccak_update(&ctx, tx_hash.data(), tx_hash.size());
+    for (const auto& ring : rv.mixRing) {
+        // Include the sizes so that different ring layouts of the same keys can't collide
+        const uint64_t n = ring.size();
+        keccak_update(&ctx, reinterpret_cast<const uint8_t*>(&n), sizeof(n));
+        for (const auto& member : ring) {
+            keccak_update(&ctx, member.dest.bytes, sizeof(member.dest.bytes));
+            keccak_update(&ctx, member.mask.bytes, sizeof(member.mask.bytes));
+        }
+    }
+    crypto::hash result;
+    keccak_finish(&ctx, result.data(), result.size());
+    return result;
+}
+
+bool verification_cache::have(const crypto::hash& key) const {
+    static auto& hits = tools::metrics::global().add_counter(
+            "oxen_verification_cache_lookups_total",
+            "Transaction verification cache lookups",
+            {{"result", "hit"}});
+    static auto& misses = tools::metrics::global().add_counter(
+            "oxen_verification_cache_lookups_total",
+            "Transaction verification cache lookups",
+            {{"result", "miss"}});
+    auto& s = shard_for(key);
+    bool found;
+    {
+        std::lock_guard lock{s.mutex};
+        found = s.entries.count(key);
+    }
+    (found ? hits : misses).inc();
+    return found;
+}
+
+void verification_cache::add(const crypto::hash& key, uint64_t height) {
+    auto& s = shard_for(key);
+    std::lock_guard lock{s.mutex};
+    auto [it, inserted] = s.entries.emplace(key, height);
+    if (!inserted) {
+        it->second = std::max(it->second, height);
+        return;
+    }
+    s.order.push_back(key);
+    while (s.entries.size() > m_max_per_shard && !s.order.empty()) {
+        s.entries.erase(s.order.front());
+        s.order.pop_front();
+    }
+}
+
+void verification_cache::blockchain_detached(uint64_t height) {
+    for (auto& s : m_shards) {
+        std::lock_guard lock{s.mutex};
+        for (auto it = s.entries.begin(); it != s.entries.end();) {
+            if (it->second >= height)
+                it = s.entries.erase(it);
+            else
+                ++it;
+        }
+        // Drop the now-dangling keys from the eviction order
+        s.order.erase(
+                std::remove_if(
+                        s.order.begin(),
+                        s.order.end(),
+                        [&s](const crypto::hash& k) { return !s.entries.count(k); }),
+                s.order.end());
+    }
+}
+
+void verification_cache::clear() {
+    for (auto& s : m_shards) {
+        std::lock_guard lock{s.mutex};
+        s.entries.clear();
+        s.order.clear();
+    }
+}
+
+size_t verification_cache::size() const {
+    size_t total = 0;
+    for (auto& s : m_shards) {
+        std::lock_guard lock{s.mutex};
+        total += s.entries.size();
+    }
+    return total;
+}
+
+}  // namespace cryptonote
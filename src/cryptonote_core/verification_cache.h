@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "crypto/hash.h"
+#include "ringct/rctTypes.h"
+
+namespace cryptonote {
+
+/// Bounded, sharded cache of successful (expensive) tx verification results, shared between
+/// mempool admission and block validation so that a tx verified when it entered the pool doesn't
+/// get verified again when it shows up in a block.
+///
+/// Keys are digests that commit to everything the cached check depends on:
+/// - `semantics_key` is for the bulletproof/commitment sum checks, which depend only on the tx
+///   itself (and so just on the tx hash).
+/// - `ring_key` is for the CLSAG/MLSAG checks, which also depend on the ring members the tx
+///   resolves to, and so includes the (expanded) mixRing.
+///
+/// Only successes are stored.  Each entry records the chain height at which it was added so that
+/// entries added at or above a detached height can be dropped on a reorg.
+class verification_cache {
+  public:
+    static constexpr size_t DEFAULT_MAX_ENTRIES = 65536;
+
+    explicit verification_cache(size_t max_entries = DEFAULT_MAX_ENTRIES);
+
+    static crypto::hash semantics_key(const crypto::hash& tx_hash);
+    static crypto::hash ring_key(const crypto::hash& tx_hash, const rct::rctSig& rv);
+
+    /// Returns true if the given key has been recorded as successfully verified.
+    bool have(const crypto::hash& key) const;
+
+    /// Records a successful verification.  If the cache is full, the oldest entry of the key's
+    /// shard is evicted.
+    void add(const crypto::hash& key, uint64_t height);
+
+    /// Drops all entries added at or above `height`.
+    void blockchain_detached(uint64_t height);
+
+    void clear();
+
+    size_t size() const;
+
+  private:
+    static constexpr size_t NUM_SHARDS = 16;
+
+    struct shard {
+        mutable std::mutex mutex;
+        std::unordered_map<crypto::hash, uint64_t> entries;
+        std::deque<crypto::hash> order;  // insertion order, for eviction
+    };
+
+    shard& shard_for(const crypto::hash& key) {
+        return m_shards[key.data()[crypto::hash::size() - 1] % NUM_SHARDS];
+    }
+    const shard& shard_for(const crypto::hash& key) const {
+        return m_shards[key.data()[crypto::hash::size() - 1] % NUM_SHARDS];
+    }
+
+    size_t m_max_per_shard;
+    std::array<shard, NUM_SHARDS> m_shards;
+};
+
+}  // namespace cryptonote
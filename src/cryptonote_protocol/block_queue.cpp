@@ -31,22 +31,62 @@
 
 #include "block_queue.h"
 
+#include <fmt/std.h>
+
+#include <algorithm>
+#include <cmath>
 #include <unordered_map>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/file.h"
+#include "common/format.h"
 #include "common/pruning.h"
+#include "epee/storages/portable_storage_template_helper.h"
 #include "epee/string_tools.h"
 
 namespace cryptonote {
 
 static auto logcat = log::Cat("cn.block_queue");
 
+// Weight given to the newest measurement in the per-peer averages
+static constexpr double PEER_STATS_ALPHA = 0.3;
+// How quickly the per-peer peak rate is allowed to fall back towards the measured rates
+static constexpr double PEER_PEAK_RATE_DECAY = 0.95;
+
+block_queue::~block_queue() {
+    for (const auto& span : blocks)
+        if (!span.spill_file.empty()) {
+            std::error_code ec;
+            fs::remove(span.spill_file, ec);
+        }
+}
+
+void block_queue::set_memory_limit(size_t max_bytes, fs::path dir) {
+    std::unique_lock lock{mutex};
+    max_memory = max_bytes;
+    spill_dir = std::move(dir);
+    if (!max_memory)
+        return;
+
+    std::error_code ec;
+    fs::remove_all(spill_dir, ec);
+    fs::create_directories(spill_dir, ec);
+    if (ec)
+        log::warning(
+                logcat,
+                "Failed to create block queue spill directory {}: {}",
+                spill_dir,
+                ec.message());
+}
+
 void block_queue::add_blocks(
         uint64_t height,
         std::vector<cryptonote::block_complete_entry> bcel,
         const connection_id_t& connection_id,
         float rate,
         size_t size) {
+    OXEN_ALLOC_SCOPE("block_queue");
     std::unique_lock lock{mutex};
     std::vector<crypto::hash> hashes;
     bool has_hashes = remove_span(height, &hashes);
@@ -58,6 +98,39 @@ void block_queue::add_blocks(
         }
         set_span_hashes(height, connection_id, hashes);
     }
+    if (max_memory)
+        spill_spans();
+}
+
+void block_queue::spill_spans() {
+    size_t memory = get_memory_size();
+    if (memory <= max_memory || blocks.size() < 2)
+        return;
+
+    // Spill from the end of the queue so that what stays in memory is what will be needed first
+    for (auto it = std::prev(blocks.end()); memory > max_memory && it != blocks.begin(); --it) {
+        if (it->blocks.empty())
+            continue;
+        auto& s = const_cast<span&>(*it);  // blocks and spill_file don't influence sorting
+        auto path = spill_dir / "{}.blocks"_format(s.start_block_height);
+        NOTIFY_RESPONSE_GET_BLOCKS::request data{};
+        data.blocks = std::move(s.blocks);
+        if (!tools::dump_file(path, epee::serialization::store_t_to_binary(data))) {
+            log::warning(logcat, "Failed to write block queue span to {}", path);
+            s.blocks = std::move(data.blocks);
+            return;
+        }
+        s.blocks.clear();
+        s.blocks.shrink_to_fit();
+        s.spill_file = std::move(path);
+        memory -= s.size;
+        log::debug(
+                logcat,
+                "Spilled span {} - {} to disk, {} bytes still in memory",
+                s.start_block_height,
+                s.start_block_height + s.nblocks - 1,
+                memory);
+    }
 }
 
 void block_queue::add_blocks(
@@ -75,18 +148,24 @@ void block_queue::flush_spans(const connection_id_t& connection_id, bool all) {
     block_map::iterator i = blocks.begin();
     while (i != blocks.end()) {
         block_map::iterator j = i++;
-        if (j->connection_id == connection_id && (all || j->blocks.size() == 0)) {
+        if (j->connection_id == connection_id && (all || !j->filled())) {
             erase_block(j);
         }
     }
+    if (all)
+        peers.erase(connection_id);
 }
 
-void block_queue::erase_block(block_map::iterator j) {
+void block_queue::erase_block(block_map::iterator j, bool remove_spill_file) {
     CHECK_AND_ASSERT_THROW_MES(j != blocks.end(), "Invalid iterator");
     for (const crypto::hash& h : j->hashes) {
         requested_hashes.erase(h);
         have_blocks.erase(h);
     }
+    if (remove_spill_file && !j->spill_file.empty()) {
+        std::error_code ec;
+        fs::remove(j->spill_file, ec);
+    }
     blocks.erase(j);
 }
 
@@ -95,11 +174,12 @@ void block_queue::flush_stale_spans(const std::set<connection_id_t>& live_connec
     block_map::iterator i = blocks.begin();
     while (i != blocks.end()) {
         block_map::iterator j = i++;
-        if (j->blocks.empty() &&
+        if (!j->filled() &&
             live_connections.find(j->connection_id) == live_connections.end()) {
             erase_block(j);
         }
     }
+    std::erase_if(peers, [&](const auto& p) { return !live_connections.count(p.first); });
 }
 
 bool block_queue::remove_span(uint64_t start_block_height, std::vector<crypto::hash>* hashes) {
@@ -145,7 +225,7 @@ uint64_t block_queue::get_next_needed_height(uint64_t blockchain_height) const {
     for (const auto& span : blocks) {
         if (span.start_block_height + span.nblocks - 1 < blockchain_height)
             continue;
-        if (span.start_block_height != last_needed_height || (first && span.blocks.empty()))
+        if (span.start_block_height != last_needed_height || (first && !span.filled()))
             return last_needed_height;
         last_needed_height = span.start_block_height + span.nblocks;
         first = false;
@@ -163,7 +243,9 @@ void block_queue::print() const {
                 span.start_block_height,
                 (span.start_block_height + span.nblocks - 1),
                 span.nblocks,
-                (span.blocks.empty() ? "scheduled" : "filled    "),
+                (!span.filled()               ? "scheduled"
+                 : span.spill_file.empty() ? "filled    "
+                                           : "spilled   "),
                 boost::lexical_cast<std::string>(span.connection_id),
                 ((unsigned)(span.rate * 10 / 1024.f)) / 10.f);
 }
@@ -185,7 +267,7 @@ std::string block_queue::get_overview(uint64_t blockchain_height) const {
                                 (uint64_t)1,
                                 (i->start_block_height - expected) / (i->nblocks ? i->nblocks : 1)),
                         '_');
-            s += i->blocks.empty() ? "." : i->start_block_height == blockchain_height ? "m" : "o";
+            s += !i->filled() ? "." : i->start_block_height == blockchain_height ? "m" : "o";
             expected = i->start_block_height + i->nblocks;
         }
         ++i;
@@ -323,7 +405,7 @@ std::pair<uint64_t, uint64_t> block_queue::get_next_span_if_scheduled(
     block_map::const_iterator i = blocks.begin();
     if (i == blocks.end())
         return std::make_pair(0, 0);
-    if (!i->blocks.empty())
+    if (i->filled())
         return std::make_pair(0, 0);
     hashes = i->hashes;
     connection_id = i->connection_id;
@@ -335,7 +417,7 @@ void block_queue::reset_next_span_time() {
     CHECK_AND_ASSERT_THROW_MES(!blocks.empty(), "No next span to reset time");
     block_map::iterator i = blocks.begin();
     CHECK_AND_ASSERT_THROW_MES(i != blocks.end(), "No next span to reset time");
-    CHECK_AND_ASSERT_THROW_MES(i->blocks.empty(), "Next span is not empty");
+    CHECK_AND_ASSERT_THROW_MES(!i->filled(), "Next span is not empty");
     const_cast<std::chrono::steady_clock::time_point&>(i->time)  // time doesn't influence sorting
             = std::chrono::steady_clock::now();
 }
@@ -348,7 +430,7 @@ void block_queue::set_span_hashes(
     for (block_map::iterator i = blocks.begin(); i != blocks.end(); ++i) {
         if (i->start_block_height == start_height && i->connection_id == connection_id) {
             span s = *i;
-            erase_block(i);
+            erase_block(i, false);
             s.hashes = std::move(hashes);
             for (const crypto::hash& h : s.hashes)
                 requested_hashes.insert(h);
@@ -368,10 +450,34 @@ bool block_queue::get_next_span(
         return false;
     block_map::const_iterator i = blocks.begin();
     for (; i != blocks.end(); ++i) {
-        if (!filled || !i->blocks.empty()) {
+        if (!filled || i->filled()) {
             height = i->start_block_height;
             bcel = i->blocks;
             connection_id = i->connection_id;
+            if (!i->spill_file.empty()) {
+                // On failure we return an empty span, which the caller drops and re-requests
+                std::string data;
+                NOTIFY_RESPONSE_GET_BLOCKS::request spilled{};
+                if (tools::slurp_file(i->spill_file, data) &&
+                    epee::serialization::load_t_from_binary(spilled, data))
+                    bcel = std::move(spilled.blocks);
+                else
+                    log::error(logcat, "Failed to reload block queue span from {}", i->spill_file);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool block_queue::get_span_blocks(
+        uint64_t height, std::vector<cryptonote::block_complete_entry>& bcel) const {
+    std::unique_lock lock{mutex};
+    for (const auto& s : blocks) {
+        if (s.start_block_height > height)
+            break;
+        if (s.start_block_height == height && !s.blocks.empty()) {
+            bcel = s.blocks;
             return true;
         }
     }
@@ -382,7 +488,8 @@ bool block_queue::has_next_span(
         uint64_t height,
         bool& filled,
         std::chrono::steady_clock::time_point& time,
-        connection_id_t& connection_id) const {
+        connection_id_t& connection_id,
+        uint64_t* nblocks) const {
     std::unique_lock lock{mutex};
     if (blocks.empty())
         return false;
@@ -391,9 +498,11 @@ bool block_queue::has_next_span(
         return false;
     if (i->start_block_height > height)
         return false;
-    filled = !i->blocks.empty();
+    filled = i->filled();
     time = i->time;
     connection_id = i->connection_id;
+    if (nblocks)
+        *nblocks = i->nblocks;
     return true;
 }
 
@@ -405,11 +514,20 @@ size_t block_queue::get_data_size() const {
     return size;
 }
 
-size_t block_queue::get_num_filled_spans() const {
+size_t block_queue::get_memory_size() const {
     std::unique_lock lock{mutex};
     size_t size = 0;
     for (const auto& span : blocks)
         if (!span.blocks.empty())
+            size += span.size;
+    return size;
+}
+
+size_t block_queue::get_num_filled_spans() const {
+    std::unique_lock lock{mutex};
+    size_t size = 0;
+    for (const auto& span : blocks)
+        if (span.filled())
             ++size;
     return size;
 }
@@ -442,7 +560,7 @@ float block_queue::get_speed(const connection_id_t& connection_id) const {
     std::unique_lock lock{mutex};
     std::unordered_map<connection_id_t, float> speeds;
     for (const auto& span : blocks) {
-        if (span.blocks.empty())
+        if (!span.filled())
             continue;
         // note that the average below does not average over the whole set, but over the
         // previous pseudo average and the latest rate: this gives much more importance
@@ -481,7 +599,7 @@ float block_queue::get_download_rate(const connection_id_t& connection_id) const
     std::unique_lock lock{mutex};
     float conn_rate = -1.f;
     for (const auto& span : blocks) {
-        if (span.blocks.empty())
+        if (!span.filled())
             continue;
         if (span.connection_id != connection_id)
             continue;
@@ -504,6 +622,70 @@ float block_queue::get_download_rate(const connection_id_t& connection_id) const
     return conn_rate;
 }
 
+void block_queue::add_peer_measurement(
+        const connection_id_t& connection_id,
+        uint64_t nblocks,
+        size_t bytes,
+        std::chrono::steady_clock::duration elapsed) {
+    const double secs = std::chrono::duration<double>{elapsed}.count();
+    if (nblocks == 0 || bytes == 0 || secs <= 0)
+        return;
+    const double rate = bytes / secs;
+    const double block_size = double(bytes) / nblocks;
+
+    std::unique_lock lock{mutex};
+    auto [it, inserted] = peers.try_emplace(connection_id, peer_stats{rate, rate, block_size, 0});
+    auto& p = it->second;
+    if (!inserted) {
+        p.rate += PEER_STATS_ALPHA * (rate - p.rate);
+        p.block_size += PEER_STATS_ALPHA * (block_size - p.block_size);
+        p.peak_rate = std::max(rate, p.peak_rate * PEER_PEAK_RATE_DECAY);
+    }
+    // Whatever this span took beyond what its bytes would have needed at the peak rate is round
+    // trip (and request handling) overhead.  With equal sized spans this underestimates, but span
+    // sizes vary as soon as the rate estimate moves, which is when it matters.
+    const double rtt = std::max(0.0, secs - bytes / p.peak_rate);
+    p.rtt = inserted ? rtt : p.rtt + PEER_STATS_ALPHA * (rtt - p.rtt);
+    log::trace(
+            logcat,
+            "Peer {}: span of {} blocks, {} bytes in {}s; now {} B/s (peak {}), {} B/block, rtt "
+            "{}s",
+            boost::lexical_cast<std::string>(connection_id),
+            nblocks,
+            bytes,
+            secs,
+            p.rate,
+            p.peak_rate,
+            p.block_size,
+            p.rtt);
+}
+
+uint64_t block_queue::get_span_length(
+        const connection_id_t& connection_id, uint64_t default_blocks, uint64_t max_blocks) const {
+    std::unique_lock lock{mutex};
+    auto it = peers.find(connection_id);
+    if (it == peers.end())
+        return std::min(default_blocks, max_blocks);
+    const auto& p = it->second;
+    const double target = std::max(
+            std::chrono::duration<double>{SPAN_TARGET_TIME}.count(), SPAN_TARGET_RTTS * p.rtt);
+    const double blocks = target * p.rate / p.block_size;
+    if (!std::isfinite(blocks) || blocks >= max_blocks)
+        return max_blocks;
+    return std::min(max_blocks, std::max<uint64_t>(MIN_SPAN_BLOCKS, blocks));
+}
+
+std::optional<std::chrono::steady_clock::duration> block_queue::get_expected_span_time(
+        const connection_id_t& connection_id, uint64_t nblocks) const {
+    std::unique_lock lock{mutex};
+    auto it = peers.find(connection_id);
+    if (it == peers.end())
+        return std::nullopt;
+    const auto& p = it->second;
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>{nblocks * p.block_size / p.rate});
+}
+
 bool block_queue::foreach (std::function<bool(const span&)> f) const {
     std::unique_lock lock{mutex};
     block_map::const_iterator i = blocks.begin();
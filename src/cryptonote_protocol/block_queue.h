@@ -31,13 +31,17 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "common/fs.h"
 #include "crypto/hash.h"
 #include "cryptonote_protocol_defs.h"
 #include "epee/net/net_utils_base.h"
@@ -61,6 +65,9 @@ class block_queue {
         float rate;
         size_t size;
         std::chrono::steady_clock::time_point time;
+        // Set when the blocks of a filled span have been written out to disk to stay within the
+        // memory limit, in which case `blocks` is empty.
+        fs::path spill_file;
 
         span(uint64_t start_block_height,
              std::vector<cryptonote::block_complete_entry> blocks,
@@ -85,11 +92,22 @@ class block_queue {
                 size(0),
                 time(time) {}
 
+        bool filled() const { return !blocks.empty() || !spill_file.empty(); }
+
         bool operator<(const span& s) const { return start_block_height < s.start_block_height; }
     };
     typedef std::set<span> block_map;
 
   public:
+    ~block_queue();
+
+    /// Limits the memory held by downloaded spans to about `max_bytes`: once filled spans exceed
+    /// it, the spans furthest from being processed have their blocks written to files in
+    /// `spill_dir` and are read back when get_next_span() returns them.  The next span to be
+    /// processed always stays in memory.  0 means no limit.  Any files left in `spill_dir` from
+    /// an earlier run are removed.
+    void set_memory_limit(size_t max_bytes, fs::path spill_dir);
+
     void add_blocks(
             uint64_t height,
             std::vector<cryptonote::block_complete_entry> bcel,
@@ -131,12 +149,18 @@ class block_queue {
             std::vector<cryptonote::block_complete_entry>& bcel,
             connection_id_t& connection_id,
             bool filled = true) const;
+    /// Copies out the blocks of the filled span starting at `height`, if there is one and it
+    /// hasn't been spilled to disk.
+    bool get_span_blocks(
+            uint64_t height, std::vector<cryptonote::block_complete_entry>& bcel) const;
     bool has_next_span(
             uint64_t height,
             bool& filled,
             std::chrono::steady_clock::time_point& time,
-            connection_id_t& connection_id) const;
+            connection_id_t& connection_id,
+            uint64_t* nblocks = nullptr) const;
     size_t get_data_size() const;
+    size_t get_memory_size() const;
     size_t get_num_filled_spans() const;
     crypto::hash get_last_known_hash(const connection_id_t& connection_id) const;
     bool has_spans(const connection_id_t& connection_id) const;
@@ -146,8 +170,36 @@ class block_queue {
     bool requested(const crypto::hash& hash) const;
     bool have(const crypto::hash& hash) const;
 
+    /// Records that `connection_id` delivered a span of `nblocks` blocks totalling `bytes` bytes
+    /// `elapsed` after it was requested.  These measurements drive get_span_length() and
+    /// get_expected_span_time().
+    void add_peer_measurement(
+            const connection_id_t& connection_id,
+            uint64_t nblocks,
+            size_t bytes,
+            std::chrono::steady_clock::duration elapsed);
+
+    /// Returns how many blocks to request from `connection_id` in its next span: enough for the
+    /// span to take about SPAN_TARGET_TIME (or SPAN_TARGET_RTTS round trips, on high latency
+    /// links) at the peer's measured throughput, clamped to [MIN_SPAN_BLOCKS, max_blocks].  Returns
+    /// `default_blocks` for a peer we have no measurements for yet.
+    uint64_t get_span_length(
+            const connection_id_t& connection_id,
+            uint64_t default_blocks,
+            uint64_t max_blocks) const;
+
+    /// Returns how long we expect `connection_id` to take to deliver a span of `nblocks` blocks at
+    /// its measured rate, or nullopt if we have no measurements for it yet.
+    std::optional<std::chrono::steady_clock::duration> get_expected_span_time(
+            const connection_id_t& connection_id, uint64_t nblocks) const;
+
+    static constexpr std::chrono::seconds SPAN_TARGET_TIME{5};
+    static constexpr int SPAN_TARGET_RTTS = 10;
+    static constexpr uint64_t MIN_SPAN_BLOCKS = 20;
+
   private:
-    void erase_block(block_map::iterator j);
+    void erase_block(block_map::iterator j, bool remove_spill_file = true);
+    void spill_spans();
     inline bool requested_internal(const crypto::hash& hash) const;
 
   private:
@@ -155,5 +207,18 @@ class block_queue {
     mutable std::recursive_mutex mutex;
     std::unordered_set<crypto::hash> requested_hashes;
     std::unordered_set<crypto::hash> have_blocks;
+    size_t max_memory = 0;
+    fs::path spill_dir;
+
+    // Per-peer download measurements; rate, block_size and rtt are exponentially weighted
+    // averages while peak_rate is the best recent span rate, used to split each span's time into
+    // transfer time and round trip overhead.
+    struct peer_stats {
+        double rate;        // bytes/s
+        double peak_rate;   // bytes/s
+        double block_size;  // bytes
+        double rtt;         // seconds
+    };
+    std::unordered_map<connection_id_t, peer_stats> peers;
 };
 }  // namespace cryptonote
@@ -33,6 +33,7 @@
 #include <list>
 
 #include "common/oxen.h"
+#include "cryptonote_basic/connection_context.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "epee/net/net_utils_base.h"
 #include "epee/serialization/keyvalue_serialization.h"
@@ -84,6 +85,8 @@ struct connection_info {
     uint32_t pruning_seed;
 
     uint8_t address_type;
+
+    std::map<int, levin_command_stats> command_stats;
 };
 
 /************************************************************************/
@@ -37,6 +37,7 @@
 #include <boost/circular_buffer.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <chrono>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -46,6 +47,7 @@
 #include "cryptonote_basic/connection_context.h"
 #include "cryptonote_protocol_defs.h"
 #include "cryptonote_protocol_handler_common.h"
+#include "request_queue.h"
 #include "epee/storages/levin_abstract_invoke2.h"
 #include "epee/warnings.h"
 
@@ -236,6 +238,8 @@ class t_cryptonote_protocol_handler : public i_cryptonote_protocol {
     uint64_t m_sync_spans_downloaded, m_sync_old_spans_downloaded, m_sync_bad_spans_downloaded;
     uint64_t m_sync_download_chain_size, m_sync_download_objects_size;
     size_t m_block_download_max_size;
+    size_t m_block_download_max_spans;
+    bool m_adaptive_span_size;
 
     // Values for sync time estimates
     std::chrono::steady_clock::time_point m_sync_start_time;
@@ -250,6 +254,15 @@ class t_cryptonote_protocol_handler : public i_cryptonote_protocol {
     std::mutex m_buffer_mutex;
     boost::circular_buffer<size_t> m_avg_buffer = boost::circular_buffer<size_t>(10);
 
+    // Serves expensive peer requests off the io threads; null until init()
+    std::unique_ptr<request_queue> m_request_queue;
+
+    /// Calls `serve()`, which returns the NOTIFY::request to send back to the peer of `context` or
+    /// nullopt if the peer should be dropped.  If the request queue is running this happens on one
+    /// of its threads, after any earlier requests from the same peer have been answered.
+    template <typename NOTIFY, typename Serve>
+    void serve_request(cryptonote_connection_context& context, Serve serve);
+
     template <class t_parameter>
     bool post_notify(typename t_parameter::request& arg, cryptonote_connection_context& context) {
         log::debug(
@@ -37,6 +37,7 @@
 // developer rfree: this code is caller of our new network code, and is modded; e.g. for rate limiting
 
 #include <list>
+#include <map>
 #include <ctime>
 #include <chrono>
 #include <fmt/core.h>
@@ -69,6 +70,9 @@ namespace cryptonote
   constexpr auto PASSIVE_PEER_KICK_TIME = 1min;
   constexpr auto DROP_ON_SYNC_WEDGE_THRESHOLD = 30s;
   constexpr auto LAST_ACTIVITY_STALL_THRESHOLD = 2s;
+  // re-request the next span from a faster peer once it has taken this many times longer than
+  // the reserving peer's measured rate says it should
+  constexpr float SPAN_OVERDUE_MULTIPLIER = 3.f;
 
   using seconds_f = std::chrono::duration<double>;
 
@@ -96,6 +100,11 @@ namespace cryptonote
     m_sync_download_objects_size = 0;
 
     m_block_download_max_size = command_line::get_arg(vm, cryptonote::arg_block_download_max_size);
+    m_block_download_max_spans = command_line::get_arg(vm, cryptonote::arg_block_download_max_spans);
+    m_adaptive_span_size = command_line::get_arg(vm, cryptonote::arg_block_sync_size) == 0;
+    m_request_queue = std::make_unique<request_queue>(p2p::REQUEST_THREADS, p2p::MAX_QUEUED_REQUESTS_PER_PEER);
+    if (size_t max_memory = command_line::get_arg(vm, cryptonote::arg_block_download_max_memory))
+      m_block_queue.set_memory_limit(max_memory, tools::utf8_path(command_line::get_arg(vm, cryptonote::arg_data_dir)) / "block_queue");
 
     return true;
   }
@@ -103,6 +112,7 @@ namespace cryptonote
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::deinit()
   {
+    m_request_queue.reset();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -303,6 +313,7 @@ namespace cryptonote
       cnx.height = cntxt.m_remote_blockchain_height;
       cnx.pruning_seed = cntxt.m_pruning_seed;
       cnx.address_type = (uint8_t)cntxt.m_remote_address.get_type_id();
+      cnx.command_stats = cntxt.m_command_stats.get();
 
       connections.push_back(cnx);
 
@@ -621,6 +632,7 @@ namespace cryptonote
             
             context.m_requested_objects.erase(req_tx_it);
           }          
+          context.m_known_txs.add(tx_hash);
           
           // we might already have the tx that the peer
           // sent in our pool, so don't verify again..
@@ -988,8 +1000,13 @@ namespace cryptonote
       const auto txpool_opts = tx_pool_options::from_peer();
       auto parsed_txs = m_core.parse_incoming_txs(arg.txs, txpool_opts);
       for (auto &txi : parsed_txs)
+      {
+        if (!txi.parsed)
+          continue;
+        context.m_known_txs.add(txi.tx_hash);
         if (blink_approved.count(txi.tx_hash))
           txi.approved_blink = true;
+      }
 
       uint64_t blink_rollback_height = 0;
       all_okay = m_core.handle_parsed_txs(parsed_txs, txpool_opts, &blink_rollback_height);
@@ -1068,16 +1085,56 @@ namespace cryptonote
       return 1;
     }
 
-    NOTIFY_RESPONSE_GET_BLOCKS::request rsp;
-    if(!m_core.blockchain.handle_get_blocks(arg, rsp))
+    serve_request<NOTIFY_RESPONSE_GET_BLOCKS>(context, [this, arg = std::move(arg)]() mutable -> std::optional<NOTIFY_RESPONSE_GET_BLOCKS::request> {
+      NOTIFY_RESPONSE_GET_BLOCKS::request rsp;
+      if(!m_core.blockchain.handle_get_blocks(arg, rsp))
+      {
+        log::error(logcat, "failed to handle request NOTIFY_REQUEST_GET_BLOCKS, dropping connection");
+        return std::nullopt;
+      }
+      log::info(log::Cat("net.p2p.msg"), "-->>NOTIFY_RESPONSE_GET_BLOCKS: blocks.size()={}, rsp.m_current_blockchain_height={}, missed_ids.size()={}", rsp.blocks.size(), rsp.current_blockchain_height, rsp.missed_ids.size());
+      return rsp;
+    });
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  template<typename NOTIFY, typename Serve>
+  void t_cryptonote_protocol_handler<t_core>::serve_request(cryptonote_connection_context& context, Serve serve)
+  {
+    if (!m_request_queue)
     {
-      log::error(logcat, "failed to handle request NOTIFY_REQUEST_GET_BLOCKS, dropping connection");
+      if (auto rsp = serve())
+        post_notify<NOTIFY>(*rsp, context);
+      else
+        drop_connection(context, false, false);
+      return;
+    }
+
+    auto job = [this, conn = context.m_connection_id, zone = context.m_remote_address.get_zone(), serve = std::move(serve)]() mutable {
+      if (m_stopping)
+        return;
+      if (auto rsp = serve())
+      {
+        // Serialize here rather than in post_notify, so that it doesn't happen under the p2p
+        // connections lock
+        std::string blob;
+        epee::serialization::store_t_to_binary(*rsp, blob);
+        m_p2p->relay_notify_to_list(NOTIFY::ID, epee::strspan<uint8_t>(blob), {{zone, conn}});
+      }
+      else
+      {
+        m_p2p->for_connection(conn, [this](cryptonote_connection_context& ctx, nodetool::peerid_type) {
+          drop_connection(ctx, false, false);
+          return true;
+        });
+      }
+    };
+    if (!m_request_queue->push(context.m_connection_id, std::move(job)))
+    {
+      log::info(logcat, "{}Too many requests waiting to be served, dropping connection", context);
       drop_connection(context, false, false);
-      return 1;
     }
-    log::info(log::Cat("net.p2p.msg"), "-->>NOTIFY_RESPONSE_GET_BLOCKS: blocks.size()={}, rsp.m_current_blockchain_height={}, missed_ids.size()={}", rsp.blocks.size(), rsp.current_blockchain_height, rsp.missed_ids.size());
-    post_notify<NOTIFY_RESPONSE_GET_BLOCKS>(rsp, context);
-    return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
 
@@ -1188,6 +1245,7 @@ namespace cryptonote
       // add that new span to the block queue
       seconds_f dt = now - request_time;
       const double rate = size / dt.count();
+      m_block_queue.add_peer_measurement(context.m_connection_id, arg.blocks.size(), size, now - request_time);
       log::debug(logcat, "{} adding span: {} at height {}, {} seconds, {} kB/s, size now {} MB", context, arg.blocks.size(), start_height, dt.count(), (rate/1024), (m_block_queue.get_data_size() + blocks_size) / 1048576.f);
       m_block_queue.add_blocks(start_height, arg.blocks, context.m_connection_id, rate, blocks_size);
 
@@ -1380,6 +1438,11 @@ namespace cryptonote
             return 1;
           }
 
+          // Get the thread pool going on the PoW of the next span while we add this one
+          if (std::vector<cryptonote::block_complete_entry> next_blocks;
+              m_block_queue.get_span_blocks(start_height + blocks.size(), next_blocks))
+            m_core.blockchain.precompute_block_pow(start_height + blocks.size(), std::move(next_blocks), pblocks);
+
           {
             bool remove_spans = false;
             OXEN_DEFER
@@ -1604,16 +1667,17 @@ skip:
       return 1;
     }
 
-    NOTIFY_NEW_TRANSACTIONS::request rsp;
-    rsp.requested = true;
-    if(!m_core.blockchain.handle_get_txs(arg, rsp))
-    {
-      log::error(logcat, "failed to handle request NOTIFY_REQUEST_GET_TXS, dropping connection");
-      drop_connection(context, false, false);
-      return 1;
-    }
-    log::info(log::Cat("net.p2p.msg"), "-->>NOTIFY_NEW_TRANSACTIONS: requested=true, txs[{}], blinks[{}]", rsp.txs.size(), rsp.blinks.size());
-    post_notify<NOTIFY_NEW_TRANSACTIONS>(rsp, context);
+    serve_request<NOTIFY_NEW_TRANSACTIONS>(context, [this, arg = std::move(arg)]() mutable -> std::optional<NOTIFY_NEW_TRANSACTIONS::request> {
+      NOTIFY_NEW_TRANSACTIONS::request rsp;
+      rsp.requested = true;
+      if(!m_core.blockchain.handle_get_txs(arg, rsp))
+      {
+        log::error(logcat, "failed to handle request NOTIFY_REQUEST_GET_TXS, dropping connection");
+        return std::nullopt;
+      }
+      log::info(log::Cat("net.p2p.msg"), "-->>NOTIFY_NEW_TRANSACTIONS: requested=true, txs[{}], blinks[{}]", rsp.txs.size(), rsp.blinks.size());
+      return rsp;
+    });
     return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -1730,6 +1794,7 @@ skip:
     connection_id_t connection_id{};
     std::pair<uint64_t, uint64_t> span;
     bool filled;
+    uint64_t nblocks = 0;
 
     const uint64_t blockchain_height = m_core.blockchain.get_current_blockchain_height();
     if (context.m_remote_blockchain_height <= blockchain_height)
@@ -1738,7 +1803,7 @@ skip:
     const bool has_next_block = tools::has_unpruned_block(blockchain_height, context.m_remote_blockchain_height, context.m_pruning_seed);
     if (has_next_block)
     {
-      if (!m_block_queue.has_next_span(blockchain_height, filled, request_time, connection_id))
+      if (!m_block_queue.has_next_span(blockchain_height, filled, request_time, connection_id, &nblocks))
       {
         log::debug(logcat, "{} we should download it as no peer reserved it", context);
         return true;
@@ -1752,6 +1817,20 @@ skip:
           return true;
         }
 
+        // if we've measured the reserving peer, we can tell it's stalling well before the fixed
+        // threshold; take over if we expect to be able to deliver the span sooner than it has
+        // already taken
+        if (connection_id != context.m_connection_id && dt >= REQUEST_NEXT_SCHEDULED_SPAN_THRESHOLD_STANDBY)
+        {
+          const auto theirs = m_block_queue.get_expected_span_time(connection_id, nblocks);
+          const auto ours = m_block_queue.get_expected_span_time(context.m_connection_id, nblocks);
+          if (theirs && ours && dt >= *theirs * SPAN_OVERDUE_MULTIPLIER && *ours < *theirs)
+          {
+            log::debug(logcat, "{} we should download it as it's overdue ({}s, expected {}s) and we expect to take {}s", context, seconds_f{dt}.count(), seconds_f{*theirs}.count(), seconds_f{*ours}.count());
+            return true;
+          }
+        }
+
         // in standby, be ready to double download early since we're idling anyway
         // let the fastest peer trigger first
         long threshold;
@@ -1910,7 +1989,8 @@ skip:
         const uint32_t add_stripe = tools::get_pruning_stripe(bc_height, context.m_remote_blockchain_height, PRUNING_LOG_STRIPES);
         const uint32_t peer_stripe = tools::get_pruning_stripe(context.m_pruning_seed);
         const size_t block_queue_size_threshold = m_block_download_max_size ? m_block_download_max_size : BLOCK_QUEUE_SIZE_THRESHOLD;
-        bool queue_proceed = nspans < BLOCK_QUEUE_NSPANS_THRESHOLD || size < block_queue_size_threshold;
+        const size_t block_queue_nspans_threshold = m_block_download_max_spans ? m_block_download_max_spans : BLOCK_QUEUE_NSPANS_THRESHOLD;
+        bool queue_proceed = nspans < block_queue_nspans_threshold || size < block_queue_size_threshold;
         // get rid of blocks we already requested, or already have
         skip_unneeded_hashes(context, true);
         uint64_t next_needed_height = m_block_queue.get_next_needed_height(bc_height);
@@ -2009,7 +2089,9 @@ skip:
       NOTIFY_REQUEST_GET_BLOCKS::request req;
       bool is_next = false;
       size_t count = 0;
-      const size_t count_limit = m_core.get_block_sync_size(m_core.blockchain.get_current_blockchain_height());
+      size_t count_limit = m_core.get_block_sync_size(m_core.blockchain.get_current_blockchain_height());
+      if (m_adaptive_span_size)
+        count_limit = m_block_queue.get_span_length(context.m_connection_id, count_limit, CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT);
       std::pair<uint64_t, uint64_t> span = std::make_pair(0, 0);
       if (force_next_span)
       {
@@ -2387,38 +2469,47 @@ You are now synchronized with the network.
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::relay_block(NOTIFY_NEW_FLUFFY_BLOCK::request& arg, cryptonote_connection_context& exclude_context)
   {
-    // sort peers between fluffy ones and others
-    std::vector<std::pair<epee::net_utils::zone, connection_id_t>> fluffyConnections;
-    m_p2p->for_each_connection([&exclude_context, &fluffyConnections](connection_context& context, nodetool::peerid_type peer_id)
+    // arg.b.txs is in the same order as the block's tx hashes, which lets us work out which txs
+    // each peer already has without rehashing them.  If it somehow isn't, send everything.
+    block b;
+    const bool have_tx_hashes = !arg.b.txs.empty() && parse_and_validate_block_from_blob(arg.b.block, b) && b.tx_hashes.size() == arg.b.txs.size();
+
+    // Group peers by the block txs we expect them to be missing: each peer gets the block along
+    // with just those txs, so that it neither needs a NOTIFY_REQUEST_FLUFFY_MISSING_TX round trip
+    // nor gets sent txs it already has, while peers with the same needs share one message.
+    std::map<std::vector<size_t>, std::vector<std::pair<epee::net_utils::zone, connection_id_t>>> peer_groups;
+    m_p2p->for_each_connection([&](connection_context& context, nodetool::peerid_type peer_id)
     {
       if (peer_id && exclude_context.m_connection_id != context.m_connection_id && context.m_remote_address.get_zone() == epee::net_utils::zone::public_)
       {
-        log::debug(logcat, "{}PEER FLUFFY BLOCKS - RELAYING THIN/COMPACT WHATEVER BLOCK", context);
-        fluffyConnections.push_back({context.m_remote_address.get_zone(), context.m_connection_id});
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < arg.b.txs.size(); ++i)
+        {
+          if (!have_tx_hashes || !context.m_known_txs.contains(b.tx_hashes[i]))
+            missing.push_back(i);
+          if (have_tx_hashes)
+            context.m_known_txs.add(b.tx_hashes[i]);
+        }
+        peer_groups[missing].push_back({context.m_remote_address.get_zone(), context.m_connection_id});
       }
       return true;
     });
 
-    std::string fluffyBlob;
-    if (arg.b.txs.size())
-    {
-      epee::serialization::store_t_to_binary(arg, fluffyBlob);
-    }
-    else
-    {
-      // NOTE: We should never ideally hit this case. If we do, some developer
-      // at the calling site passed in the full block information
-
-      // relay_block is only meant to send the header, tx blobs should be
-      // requested subsequently in handle notify fluffy transactions
-      log::debug(logcat, "relay_block called with argument that contains TX blobs, this is the non-expected case");
-      NOTIFY_NEW_FLUFFY_BLOCK::request arg_without_tx_blobs = {};
-      arg_without_tx_blobs.current_blockchain_height        = arg.current_blockchain_height;
-      arg_without_tx_blobs.b.block                          = arg.b.block;
-      epee::serialization::store_t_to_binary(arg_without_tx_blobs, fluffyBlob);
+    NOTIFY_NEW_FLUFFY_BLOCK::request peer_arg{};
+    peer_arg.current_blockchain_height = arg.current_blockchain_height;
+    peer_arg.b.block = arg.b.block;
+    peer_arg.b.checkpoint = arg.b.checkpoint;
+    peer_arg.b.blinks = arg.b.blinks;
+    for (auto& [missing, connections] : peer_groups)
+    {
+      peer_arg.b.txs.clear();
+      for (size_t i : missing)
+        peer_arg.b.txs.push_back(arg.b.txs[i]);
+      log::debug(logcat, "Relaying fluffy block with {}/{} txs to {} peers", missing.size(), arg.b.txs.size(), connections.size());
+      std::string fluffyBlob;
+      epee::serialization::store_t_to_binary(peer_arg, fluffyBlob);
+      m_p2p->relay_notify_to_list(NOTIFY_NEW_FLUFFY_BLOCK::ID, epee::strspan<uint8_t>(fluffyBlob), std::move(connections));
     }
-
-    m_p2p->relay_notify_to_list(NOTIFY_NEW_FLUFFY_BLOCK::ID, epee::strspan<uint8_t>(fluffyBlob), std::move(fluffyConnections));
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -2470,8 +2561,11 @@ You are now synchronized with the network.
       }
     }
 
-    // no check for success, so tell core they're relayed unconditionally
-    m_p2p->send_txs(std::move(arg.txs), exclude_context.m_remote_address.get_zone(), exclude_context.m_connection_id, m_core.pad_transactions());
+    // no check for success, so tell core they're relayed unconditionally.  If we have all the
+    // hashes then the notifier can avoid sending txs to peers that already have them.
+    if (relayed_txes.size() != arg.txs.size())
+      relayed_txes.clear();
+    m_p2p->send_txs(std::move(arg.txs), exclude_context.m_remote_address.get_zone(), exclude_context.m_connection_id, m_core.pad_transactions(), std::move(relayed_txes));
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -2595,6 +2689,9 @@ You are now synchronized with the network.
   void t_cryptonote_protocol_handler<t_core>::stop()
   {
     m_stopping = true;
+    // Make sure nothing is still reading from the database once the core shuts down
+    if (m_request_queue)
+      m_request_queue->stop();
     m_core.stop();
   }
 } // namespace
@@ -30,8 +30,12 @@
 
 #include <boost/asio/steady_timer.hpp>
 #include <boost/system/system_error.hpp>
+#include <algorithm>
 #include <chrono>
 #include <deque>
+#include <iterator>
+#include <map>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/varint.h"
@@ -169,7 +173,7 @@ namespace {
 }  // namespace
 
 namespace detail {
-    struct zone {
+    struct zone : std::enable_shared_from_this<zone> {
         explicit zone(
                 boost::asio::io_service& io_service,
                 std::shared_ptr<connections> p2p,
@@ -178,6 +182,7 @@ namespace detail {
                 p2p(std::move(p2p)),
                 noise(std::move(noise_in)),
                 next_epoch(io_service),
+                next_flood(io_service),
                 strand(io_service),
                 map(),
                 channels(),
@@ -190,6 +195,7 @@ namespace detail {
         const std::shared_ptr<connections> p2p;
         const epee::shared_sv noise;  //!< `!empty()` means zone is using noise channels
         boost::asio::steady_timer next_epoch;
+        boost::asio::steady_timer next_flood;
         boost::asio::io_service::strand strand;
         net::dandelionpp::connection_map
                 map;  //!< Tracks outgoing uuid's for noise channels or Dandelion++ stems
@@ -198,6 +204,20 @@ namespace detail {
         std::atomic<std::size_t>
                 connection_count;  //!< Only update in strand, can be read at any time
         const bool is_public;      //!< Zone is public ipv4/ipv6 connections
+
+        struct flood_tx {
+            crypto::hash hash;
+            std::string blob;
+            connection_id_t source;
+        };
+        std::vector<flood_tx> flood_queue;  //!< Only access in strand
+        bool flood_pad = false;             //!< Only access in strand
+        //! The queued txs had no outbound connection to go to, and are being held until one
+        //! connects (anonymity zones only).  Only access in strand.
+        bool flood_held = false;
+
+        //! \pre Called within `strand`, with `flood_queue` not empty.
+        void start_flood_timer();
     };
 }  // namespace detail
 
@@ -434,6 +454,134 @@ namespace {
         }
     };
 
+    //! Sends the batched txs, giving each connection just the ones it isn't known to have.
+    struct send_flood {
+        std::shared_ptr<detail::zone> zone_;
+
+        //! \pre Called within `zone_->strand`.
+        void operator()(boost::system::error_code error) {
+            if (!zone_ || !zone_->p2p)
+                return;
+
+            if (error && error != boost::system::errc::operation_canceled)
+                throw boost::system::system_error{error, "send_flood timer failed"};
+
+            assert(zone_->strand.running_in_this_thread());
+
+            auto queue = std::move(zone_->flood_queue);
+            zone_->flood_queue.clear();
+            const bool pad = std::exchange(zone_->flood_pad, false);
+            zone_->flood_held = false;
+            if (queue.empty())
+                return;
+
+            if (zone_->is_public)  // don't leak receive order
+                std::sort(queue.begin(), queue.end(), [](const auto& a, const auto& b) {
+                    return a.blob < b.blob;
+                });
+
+            // Connections that need the same subset of the txs share a message.  Txs are marked as
+            // known as we go so that a later batch doesn't send them again.
+            std::map<std::vector<size_t>, std::vector<connection_id_t>> groups;
+            size_t eligible = 0;
+            zone_->p2p->foreach_connection([&](detail::p2p_context& context) {
+                // Same restriction as flood_notify (see there)
+                if (!zone_->is_public && context.m_is_income)
+                    return true;
+                ++eligible;
+                std::vector<size_t> send;
+                for (size_t i = 0; i < queue.size(); ++i) {
+                    if (queue[i].source == context.m_connection_id ||
+                        context.m_known_txs.contains(queue[i].hash))
+                        continue;
+                    send.push_back(i);
+                    context.m_known_txs.add(queue[i].hash);
+                }
+                if (!send.empty())
+                    groups[std::move(send)].push_back(context.m_connection_id);
+                return true;
+            });
+
+            // An anonymity zone with no outbound connections (e.g. at startup, or while tor/i2p
+            // circuits are being rebuilt) would otherwise drop the txs until the pool next
+            // rebroadcasts them, minutes later.  Hold them instead, and send as soon as a
+            // connection comes up (see `release_flood`).  Duplicates from rebroadcasts are dropped
+            // so that the held queue stays bounded by the distinct txs waiting.
+            if (!eligible && !zone_->is_public) {
+                std::sort(queue.begin(), queue.end(), [](const auto& a, const auto& b) {
+                    return a.hash < b.hash;
+                });
+                queue.erase(
+                        std::unique(
+                                queue.begin(),
+                                queue.end(),
+                                [](const auto& a, const auto& b) { return a.hash == b.hash; }),
+                        queue.end());
+                log::debug(
+                        logcat,
+                        "No outbound connections; holding {} tx(s) until one connects",
+                        queue.size());
+                zone_->flood_queue = std::move(queue);
+                zone_->flood_pad = pad;
+                zone_->flood_held = true;
+                return;
+            }
+
+            for (auto& [indices, connections] : groups) {
+                std::vector<std::string> txs;
+                txs.reserve(indices.size());
+                for (size_t i : indices)
+                    txs.push_back(queue[i].blob);
+                const std::string payload = make_tx_payload(std::move(txs), pad);
+                epee::shared_sv message{epee::levin::make_notify(
+                        NOTIFY_NEW_TRANSACTIONS::ID, epee::strspan<std::uint8_t>(payload))};
+                for (const connection_id_t& connection : connections)
+                    zone_->p2p->send(message, connection);
+            }
+        }
+    };
+
+    //! Adds txs to the next flood batch, starting the batch timer if needed.
+    struct queue_flood {
+        std::shared_ptr<detail::zone> zone_;
+        std::vector<detail::zone::flood_tx> txs_;
+        bool pad_;
+
+        //! \pre Called within `zone_->strand`.
+        void operator()() {
+            if (!zone_)
+                return;
+
+            assert(zone_->strand.running_in_this_thread());
+
+            // Held txs wait for `release_flood` rather than a timer
+            const bool start = zone_->flood_queue.empty() && !zone_->flood_held;
+            std::move(txs_.begin(), txs_.end(), std::back_inserter(zone_->flood_queue));
+            zone_->flood_pad |= pad_;
+            if (start)
+                zone_->start_flood_timer();
+        }
+    };
+
+    //! Sends any txs held for lack of an outbound connection, after the usual batch delay.
+    struct release_flood {
+        std::shared_ptr<detail::zone> zone_;
+
+        //! \pre Called within `zone_->strand`.
+        void operator()() {
+            if (!zone_)
+                return;
+
+            assert(zone_->strand.running_in_this_thread());
+
+            if (!zone_->flood_held)
+                return;
+            zone_->flood_held = false;
+            if (!zone_->flood_queue.empty())
+                zone_->start_flood_timer();
+        }
+    };
+
     //! Prepares connections for new channel epoch and sets timer for next epoch
     struct start_epoch {
         // Variables allow for Dandelion++ extension
@@ -462,6 +610,14 @@ namespace {
     };
 }  // namespace
 
+void detail::zone::start_flood_timer() {
+    std::chrono::steady_clock::duration delay = FLOOD_BATCH_INTERVAL;
+    if (!is_public)
+        delay += random_duration(FLOOD_ANON_DELAY_RANGE);
+    next_flood.expires_after(delay);
+    next_flood.async_wait(strand.wrap(send_flood{shared_from_this()}));
+}
+
 notify::notify(
         boost::asio::io_service& service,
         std::shared_ptr<connections> p2p,
@@ -491,7 +647,16 @@ notify::status notify::get_status() const noexcept {
 }
 
 void notify::new_out_connection() {
-    if (!zone_ || zone_->noise.view.empty() || NOISE_CHANNELS <= zone_->connection_count)
+    if (!zone_)
+        return;
+
+    if (zone_->noise.view.empty()) {
+        if (!zone_->is_public)
+            zone_->strand.dispatch(release_flood{zone_});
+        return;
+    }
+
+    if (NOISE_CHANNELS <= zone_->connection_count)
         return;
 
     zone_->strand.dispatch(update_channels{zone_, get_out_connections(*(zone_->p2p))});
@@ -511,11 +676,29 @@ void notify::run_stems() {
         channel.next_noise.cancel();
 }
 
+void notify::run_flood() {
+    if (!zone_)
+        return;
+    zone_->next_flood.cancel();
+}
+
 bool notify::send_txs(
-        std::vector<std::string> txs, const connection_id_t& source, const bool pad_txs) {
+        std::vector<std::string> txs,
+        const connection_id_t& source,
+        const bool pad_txs,
+        std::vector<crypto::hash> tx_hashes) {
     if (!zone_)
         return false;
 
+    if (zone_->noise.view.empty() && !txs.empty() && tx_hashes.size() == txs.size()) {
+        std::vector<detail::zone::flood_tx> queued;
+        queued.reserve(txs.size());
+        for (size_t i = 0; i < txs.size(); ++i)
+            queued.push_back({tx_hashes[i], std::move(txs[i]), source});
+        zone_->strand.dispatch(queue_flood{zone_, std::move(queued), pad_txs});
+        return true;
+    }
+
     if (zone_->is_public)
         std::sort(txs.begin(), txs.end());  // don't leak receive order
 
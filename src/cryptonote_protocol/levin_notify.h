@@ -32,6 +32,7 @@
 #include <memory>
 #include <vector>
 
+#include "crypto/hash.h"
 #include "epee/net/enums.h"
 #include "epee/net/net_utils_base.h"
 #include "epee/shared_sv.h"
@@ -91,7 +92,8 @@ class notify {
     //! \return Status information for zone selection.
     status get_status() const noexcept;
 
-    //! Probe for new outbound connection - skips if not needed.
+    //! Probe for new outbound connection - skips if not needed.  Also sends any txs an
+    //! anonymity zone was holding for lack of outbound connections.
     void new_out_connection();
 
     //! Run the logic for the next epoch immediately. Only use in testing.
@@ -100,6 +102,9 @@ class notify {
     //! Run the logic for the next stem timeout imemdiately. Only use in  testing.
     void run_stems();
 
+    //! Send batched flood notifications immediately. Only use in testing.
+    void run_flood();
+
     /*! Send txs using `cryptonote_protocol_defs.h` payload format wrapped in a
         levin header. The message will be sent in a "discreet" manner if
         enabled - if `!noise.empty()` then the `command`/`payload` will be
@@ -116,8 +121,20 @@ class notify {
         \param pad_txs A request to pad txs to help conceal origin via
           statistical analysis. Ignored if noise was enabled during
           construction.
+        \param tx_hashes The hashes of `txs`, in the same order.  When given
+          (and noise is not enabled), the txs are batched for up to
+          `FLOOD_BATCH_INTERVAL` and each connection is only sent the ones it
+          is not already known to have (see `known_tx_set`).  Anonymity zones
+          add a random delay of up to `FLOOD_ANON_DELAY_RANGE` to each batch,
+          and hold the txs until `new_out_connection()` while they have no
+          outbound connections.  Otherwise every connection gets all of `txs`
+          straight away.
 
       \return True iff the notification is queued for sending. */
-    bool send_txs(std::vector<std::string> txs, const epee::connection_id_t& source, bool pad_txs);
+    bool send_txs(
+            std::vector<std::string> txs,
+            const epee::connection_id_t& source,
+            bool pad_txs,
+            std::vector<crypto::hash> tx_hashes = {});
 };
 }  // namespace cryptonote::levin
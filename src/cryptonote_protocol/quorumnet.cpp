@@ -32,10 +32,13 @@
 #include <oxenmq/oxenmq.h>
 #include <time.h>
 
+#include <atomic>
+#include <bitset>
 #include <iterator>
 #include <shared_mutex>
 
 #include "common/exception.h"
+#include "common/metrics.h"
 #include "common/random.h"
 #include "cryptonote_basic/hardfork.h"
 #include "cryptonote_config.h"
@@ -46,6 +49,7 @@
 #include "cryptonote_core/tx_blink.h"
 #include "cryptonote_core/tx_pool.h"
 #include "cryptonote_core/uptime_proof.h"
+#include "logging/trace.h"
 #include "quorumnet_conn_matrix.h"
 
 namespace quorumnet {
@@ -110,6 +114,24 @@ namespace {
         std::condition_variable pulse_message_queue_cv;
         std::queue<pulse::message> pulse_message_queue;
 
+        // Signatures for blinks we already know about, waiting to be verified and relayed.
+        // Signatures that arrive for a blink while a batch is queued get added to it so that they
+        // share one batch verification, one blink lock and one relay.
+        struct signature_batch {
+            quorum_array quorums;
+            uint64_t checksum;
+            std::list<pending_signature> signatures;
+            uint64_t reply_tag = 0;
+            oxenmq::ConnectionID reply_conn;
+            // The peer all of the batch came from (so we don't relay back to them), if just one
+            std::string received_from;
+        };
+        std::mutex signature_batch_mutex;
+        std::unordered_map<std::shared_ptr<blink_tx>, signature_batch> signature_batches;
+
+        // Set while a job to pre-connect to upcoming quorum peers is queued
+        std::atomic<bool> prewarm_pending = false;
+
         QnetState(cryptonote::core& core) : core{core} {}
 
         static QnetState& from(void* obj) {
@@ -414,9 +436,6 @@ E get_enum(const bt_dict &d, const std::string &key) {
         template <typename QuorumIt>
         void compute_validator_peers(QuorumIt qbegin, QuorumIt qend, bool /*opportunistic*/) {
 
-            // TODO: when we receive a new block, if our quorum starts soon we can tell SNNetwork to
-            // pre-connect (to save the time in handshaking when we get an actual blink tx).
-
             strong_peers = 0;
 
             size_t i = 0;
@@ -663,6 +682,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     }
 
     void handle_obligation_vote(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_obligation_vote");
         log::debug(logcat, "Received a relayed obligation vote from {}", to_hex(m.conn.pubkey()));
 
         if (m.data.size() != 1) {
@@ -813,10 +833,12 @@ E get_enum(const bt_dict &d, const std::string &key) {
 
         auto& btx = *btxptr;
 
-        // First check values and discard any signatures for positions we already have.
+        // First check values and discard any signatures for positions we already have (or that
+        // appear more than once in this batch).
         {
             // Don't take out a heavier unique lock until later when we are sure we need
             auto lock = btx.shared_lock();
+            std::array<std::bitset<BLINK_SUBQUORUM_SIZE>, NUM_BLINK_QUORUMS> seen;
             for (auto it = signatures.begin(); it != signatures.end();) {
                 auto& pending = *it;
                 auto& qi = std::get<uint8_t>(pending);
@@ -829,10 +851,12 @@ E get_enum(const bt_dict &d, const std::string &key) {
                     log::warning(logcat, "Invalid blink signature: subquorum position is invalid");
                     it = signatures.erase(it);
                 } else if (
+                        seen[qi][position] ||
                         btx.get_signature_status(subquorum, position) !=
-                        blink_tx::signature_status::none) {
+                                blink_tx::signature_status::none) {
                     it = signatures.erase(it);
                 } else {
+                    seen[qi].set(position);
                     ++it;
                 }
             }
@@ -841,21 +865,24 @@ E get_enum(const bt_dict &d, const std::string &key) {
             return;
 
         // Now check and discard any invalid signatures (we can do this without holding a lock)
-        for (auto it = signatures.begin(); it != signatures.end();) {
-            auto& pending = *it;
-            auto& approval = std::get<bool>(pending);
-            auto& qi = std::get<uint8_t>(pending);
-            auto& position = std::get<int>(pending);
-            auto& signature = std::get<crypto::signature>(pending);
-
-            auto& validators = blink_quorums[qi]->validators;
-
-            if (!crypto::check_signature(btx.hash(approval), validators[position], signature)) {
+        std::array<crypto::hash, 2> const hashes{btx.hash(false), btx.hash(true)};
+        std::vector<crypto::signature_check> checks;
+        checks.reserve(signatures.size());
+        for (auto& [approval, qi, position, signature] : signatures)
+            checks.push_back(
+                    {hashes[approval], blink_quorums[qi]->validators[position], signature});
+
+        std::vector<bool> valid;
+        if (!crypto::check_signatures(checks, &valid)) {
+            size_t i = 0;
+            for (auto it = signatures.begin(); it != signatures.end(); i++) {
+                if (valid[i]) {
+                    ++it;
+                    continue;
+                }
                 log::warning(logcat, "Invalid blink signature: signature verification failed");
                 it = signatures.erase(it);
-                continue;
             }
-            ++it;
         }
 
         if (signatures.empty())
@@ -924,9 +951,33 @@ E get_enum(const bt_dict &d, const std::string &key) {
                 pool.add_existing_blink(btxptr);
             }
             pool.set_relayable({{btx.get_txhash()}});
+            pool.notify_approved_blink(btx);
             qnet.core.relay_txpool_transactions();
         }
 
+        // Let the originating node know the result before we get into relaying signatures
+        if (reply_tag && reply_conn) {
+            if (became_approved) {
+                log::info(
+                        logcat,
+                        "Blink tx became approved; sending result back to originating node");
+                qnet.omq.send(
+                        reply_conn,
+                        "bl.good",
+                        bt_serialize(bt_dict{{"!", reply_tag}}),
+                        send_option::optional{});
+            } else if (became_rejected) {
+                log::info(
+                        logcat,
+                        "Blink tx became rejected; sending result back to originating node");
+                qnet.omq.send(
+                        reply_conn,
+                        "bl.bad",
+                        bt_serialize(bt_dict{{"!", reply_tag}}),
+                        send_option::optional{});
+            }
+        }
+
         if (signatures.empty())
             return;
 
@@ -976,28 +1027,65 @@ E get_enum(const bt_dict &d, const std::string &key) {
         pinfo.relay_to_peers("quorum.blink_sign", blink_sign_data);
 
         log::trace(logcat, "Done blink signature relay");
+    }
 
-        if (reply_tag && reply_conn) {
-            if (became_approved) {
-                log::info(
-                        logcat,
-                        "Blink tx became approved; sending result back to originating node");
-                qnet.omq.send(
-                        reply_conn,
-                        "bl.good",
-                        bt_serialize(bt_dict{{"!", reply_tag}}),
-                        send_option::optional{});
-            } else if (became_rejected) {
-                log::info(
-                        logcat,
-                        "Blink tx became rejected; sending result back to originating node");
-                qnet.omq.send(
-                        reply_conn,
-                        "bl.bad",
-                        bt_serialize(bt_dict{{"!", reply_tag}}),
-                        send_option::optional{});
+    /// Processes the batch of signatures queued for a blink by queue_blink_signatures.
+    void flush_blink_signatures(QnetState& qnet, const std::shared_ptr<blink_tx>& btxptr) {
+        QnetState::signature_batch batch;
+        {
+            std::lock_guard lock{qnet.signature_batch_mutex};
+            auto it = qnet.signature_batches.find(btxptr);
+            if (it == qnet.signature_batches.end())
+                return;
+            batch = std::move(it->second);
+            qnet.signature_batches.erase(it);
+        }
+
+        log::debug(logcat, "Processing batch of {} blink signatures", batch.signatures.size());
+        process_blink_signatures(
+                qnet,
+                btxptr,
+                batch.quorums,
+                batch.checksum,
+                std::move(batch.signatures),
+                batch.reply_tag,
+                batch.reply_conn,
+                batch.received_from);
+    }
+
+    /// Adds received signatures for a known blink to the blink's pending batch, queuing a job to
+    /// process the batch if there isn't one already.  The job runs once the worker threads get to
+    /// it, so batches stay small (and add no delay) when lightly loaded, and grow to take in
+    /// everything that arrived in the meantime when busy.
+    void queue_blink_signatures(
+            QnetState& qnet,
+            const std::shared_ptr<blink_tx>& btxptr,
+            quorum_array&& blink_quorums,
+            uint64_t quorum_checksum,
+            std::list<pending_signature>&& signatures,
+            uint64_t reply_tag,
+            oxenmq::ConnectionID reply_conn,
+            const std::string& received_from) {
+        bool queued;
+        {
+            std::lock_guard lock{qnet.signature_batch_mutex};
+            auto [it, inserted] = qnet.signature_batches.try_emplace(btxptr);
+            auto& batch = it->second;
+            if (inserted) {
+                batch.quorums = std::move(blink_quorums);
+                batch.checksum = quorum_checksum;
+                batch.reply_tag = reply_tag;
+                batch.reply_conn = std::move(reply_conn);
+                batch.received_from = received_from;
+            } else if (batch.received_from != received_from) {
+                batch.received_from.clear();
             }
+            batch.signatures.splice(batch.signatures.end(), signatures);
+            queued = !inserted;
         }
+
+        if (!queued)
+            qnet.omq.job([&qnet, btxptr] { flush_blink_signatures(qnet, btxptr); });
     }
 
     /// A "blink" message is used to submit a blink tx from a node to members of the blink quorum
@@ -1021,6 +1109,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     ///           blink submission will fail immediately if it does not).
     ///
     void handle_blink(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_blink");
         // TODO: if someone sends an invalid tx (i.e. one that doesn't get to the distribution
         // stage) then put a timeout on that IP during which new submissions from them are dropped
         // for a short time. If an incoming connection:
@@ -1423,6 +1512,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     ///
     /// Signatures will be forwarded if new; known signatures will be ignored.
     void handle_blink_signature(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_blink_signature");
         log::debug(logcat, "Received a blink tx signature from SN {}", to_hex(m.conn.pubkey()));
 
         if (m.data.size() != 1)
@@ -1559,10 +1649,10 @@ E get_enum(const bt_dict &d, const std::string &key) {
 
         log::info(logcat, "Found blink tx in local blink cache");
 
-        process_blink_signatures(
+        queue_blink_signatures(
                 qnet,
                 btxptr,
-                blink_quorums,
+                std::move(blink_quorums),
                 checksum,
                 std::move(signatures),
                 reply_tag,
@@ -1937,6 +2027,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     // node. The message is added to the Pulse message queue and validating the
     // contents of the message is left to the caller.
     void handle_pulse_participation_bit_or_bitset(Message& m, QnetState& qnet, bool bitset) {
+        OXEN_TRACE_SPAN(logcat, "handle_pulse_participation");
         if (m.data.size() != 1)
             throw oxen::traced<std::runtime_error>{
                     "Rejecting pulse participation {}: expected one data entry not {}"_format(
@@ -1963,6 +2054,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     }
 
     void handle_pulse_block_template(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_pulse_block_template");
         if (m.data.size() != 1)
             throw oxen::traced<std::runtime_error>{
                     "Rejecting pulse block template expected one data entry not {}"_format(
@@ -1985,6 +2077,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     }
 
     void handle_pulse_random_value_hash(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_pulse_random_value_hash");
         if (m.data.size() != 1)
             throw oxen::traced<std::runtime_error>(
                     "Rejecting pulse random value hash expected one data entry not "s +
@@ -2014,6 +2107,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     }
 
     void handle_pulse_random_value(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_pulse_random_value");
         if (m.data.size() != 1)
             throw oxen::traced<std::runtime_error>(
                     "Rejecting pulse random value expected one data entry not "s +
@@ -2041,6 +2135,7 @@ E get_enum(const bt_dict &d, const std::string &key) {
     }
 
     void handle_pulse_signed_block(Message& m, QnetState& qnet) {
+        OXEN_TRACE_SPAN(logcat, "handle_pulse_signed_block");
         if (m.data.size() != 1)
             throw oxen::traced<std::runtime_error>{
                     "Rejecting pulse signed block expected one data entry not {}"_format(
@@ -2065,6 +2160,73 @@ E get_enum(const bt_dict &d, const std::string &key) {
                 qnet.core.pulse_thread_id());
     }
 
+    // Number of Pulse rounds of the next block whose quorum peers we connect to in advance
+    constexpr uint8_t PREWARM_PULSE_ROUNDS = 2;
+
+    // Opens connections to the peers we would have to relay to in the blink and Pulse quorums we
+    // are about to take part in, so that the first message of a quorum doesn't have to wait on
+    // the connection and handshake.  This gets repeated for each new block; connections to peers
+    // that drop out of our upcoming quorums are no longer refreshed and get closed by OxenMQ once
+    // they have been idle for the keep-alive time.
+    void prewarm_quorum_connections(QnetState& qnet) {
+        auto& core = qnet.core;
+        auto& snl = core.service_node_list;
+
+        // x25519 pubkey => connection string
+        std::unordered_map<std::string, std::string> targets;
+        auto add_targets = [&targets](const peer_info& pinfo) {
+            if (!pinfo.my_position_count)
+                return;
+            for (auto& [x25519, addr] : pinfo.peers)
+                if (!addr.empty())
+                    targets.emplace(x25519, addr);
+        };
+
+        // A blink gets submitted at the current height, or the next one if that block arrives
+        // while the blink is on its way.
+        uint64_t height = core.blockchain.get_current_blockchain_height();
+        for (uint64_t h : {height, height + 1}) {
+            try {
+                auto quorums = get_blink_quorums(h, snl, nullptr);
+                add_targets(peer_info{qnet, quorum_type::blink, quorums.begin(), quorums.end()});
+            } catch (const std::exception& e) {
+                log::trace(
+                        logcat,
+                        "Not pre-connecting to blink quorums at height {}: {}",
+                        h,
+                        e.what());
+            }
+        }
+
+        auto hf_version = core.blockchain.get_network_version();
+        if (hf_version >= cryptonote::hf::hf16_pulse) {
+            auto active_nodes = snl.active_service_nodes_infos();
+            auto const leader = snl.get_next_block_leader().key;
+            for (uint8_t round = 0; round < PREWARM_PULSE_ROUNDS; round++) {
+                auto quorum = generate_pulse_quorum(
+                        core.get_nettype(),
+                        leader,
+                        hf_version,
+                        active_nodes,
+                        get_pulse_entropy_for_next_block(core.blockchain.db(), round),
+                        round);
+                if (verify_pulse_quorum_sizes(quorum))
+                    add_targets(peer_info{
+                            qnet,
+                            quorum_type::pulse,
+                            &quorum,
+                            true /*opportunistic*/,
+                            {},
+                            true /*include_workers*/});
+            }
+        }
+
+        auto keep_alive = 3 * get_config(core.get_nettype()).TARGET_BLOCK_TIME;
+        for (auto& [x25519, addr] : targets)
+            qnet.omq.connect_sn(x25519, keep_alive, addr);
+        log::debug(logcat, "Pre-connected to {} upcoming quorum peers", targets.size());
+    }
+
 }  // namespace
 
 /// Sets the cryptonote::quorumnet_* function pointers (allowing core to avoid linking to
@@ -2079,6 +2241,19 @@ void init_core_callbacks() {
 }
 
 namespace {
+    // Wraps a command handler so that the messages it receives get counted
+    template <typename Handler>
+    auto counted(std::string_view category, std::string_view command, Handler handler) {
+        auto& received = tools::metrics::global().add_counter(
+                "oxen_quorumnet_messages_total",
+                "Quorumnet messages received",
+                {{"category", std::string{category}}, {"command", std::string{command}}});
+        return [&received, handler = std::move(handler)](oxenmq::Message& m) {
+            received.inc();
+            handler(m);
+        };
+    }
+
     void setup_endpoints(cryptonote::core& core, void* obj) {
         using namespace oxenmq;
 
@@ -2094,48 +2269,94 @@ namespace {
                         "qnet initialization failure: quorumnet_new must be called for service "
                         "node operation"};
             auto& qnet = QnetState::from(obj);
+
+            // Pre-connect to upcoming quorum peers on each new block (but not while syncing, and
+            // without queuing up more than one update at a time).
+            core.blockchain.hook_block_post_add([&qnet](const auto& info) {
+                if (info.block.get_height() + 1 < qnet.core.get_target_blockchain_height() ||
+                    qnet.prewarm_pending.exchange(true))
+                    return;
+                qnet.omq.job([&qnet] {
+                    qnet.prewarm_pending = false;
+                    prewarm_quorum_connections(qnet);
+                });
+            });
+
             // quorum.*: commands between quorum members, requires that both side of the connection
             // is a SN
             omq.add_category("quorum", sn_to_sn, 2 /*reserved threads*/)
                     // Receives an obligation vote
                     .add_command(
-                            "vote_ob", [&qnet](Message& m) { handle_obligation_vote(m, qnet); })
+                            "vote_ob",
+                            counted("quorum", "vote_ob", [&qnet](Message& m) {
+                                handle_obligation_vote(m, qnet);
+                            }))
                     // Receives blink tx signatures or rejections between quorum members (either
                     // original or forwarded).  These are propagated by the receiver if new
                     .add_command(
-                            "blink_sign", [&qnet](Message& m) { handle_blink_signature(m, qnet); })
+                            "blink_sign",
+                            counted("quorum", "blink_sign", [&qnet](Message& m) {
+                                handle_blink_signature(m, qnet);
+                            }))
                     // Receives a request for the timestamp
-                    .add_request_command("timestamp", [](Message& m) { handle_timestamp(m); });
+                    .add_request_command(
+                            "timestamp",
+                            counted("quorum", "timestamp", [](Message& m) {
+                                handle_timestamp(m);
+                            }));
 
             // blink.*: commands sent to blink quorum members from anyone (e.g. blink submission)
             omq.add_category("blink", sn_incoming, 1 /*reserved thread*/)
                     // Receives a new blink tx submission from an external node, or forward from
                     // other quorum members who received it from an external node.
-                    .add_command("submit", [&qnet](Message& m) { handle_blink(m, qnet); });
+                    .add_command(
+                            "submit",
+                            counted("blink", "submit", [&qnet](Message& m) {
+                                handle_blink(m, qnet);
+                            }));
 
+            auto pulse_command = [](const std::string& command, auto handler) {
+                return counted(PULSE_CMD_CATEGORY, command, std::move(handler));
+            };
             omq.add_category(PULSE_CMD_CATEGORY, sn_to_sn, 1 /*reserved thread*/)
                     .add_command(
                             PULSE_CMD_VALIDATOR_BIT,
-                            [&qnet](Message& m) {
-                                handle_pulse_participation_bit_or_bitset(m, qnet, false /*bitset*/);
-                            })
+                            pulse_command(
+                                    PULSE_CMD_VALIDATOR_BIT,
+                                    [&qnet](Message& m) {
+                                        handle_pulse_participation_bit_or_bitset(
+                                                m, qnet, false /*bitset*/);
+                                    }))
                     .add_command(
                             PULSE_CMD_VALIDATOR_BITSET,
-                            [&qnet](Message& m) {
-                                handle_pulse_participation_bit_or_bitset(m, qnet, true /*bitset*/);
-                            })
+                            pulse_command(
+                                    PULSE_CMD_VALIDATOR_BITSET,
+                                    [&qnet](Message& m) {
+                                        handle_pulse_participation_bit_or_bitset(
+                                                m, qnet, true /*bitset*/);
+                                    }))
                     .add_command(
                             PULSE_CMD_BLOCK_TEMPLATE,
-                            [&qnet](Message& m) { handle_pulse_block_template(m, qnet); })
+                            pulse_command(
+                                    PULSE_CMD_BLOCK_TEMPLATE,
+                                    [&qnet](Message& m) { handle_pulse_block_template(m, qnet); }))
                     .add_command(
                             PULSE_CMD_RANDOM_VALUE_HASH,
-                            [&qnet](Message& m) { handle_pulse_random_value_hash(m, qnet); })
+                            pulse_command(
+                                    PULSE_CMD_RANDOM_VALUE_HASH,
+                                    [&qnet](Message& m) {
+                                        handle_pulse_random_value_hash(m, qnet);
+                                    }))
                     .add_command(
                             PULSE_CMD_RANDOM_VALUE,
-                            [&qnet](Message& m) { handle_pulse_random_value(m, qnet); })
-                    .add_command(PULSE_CMD_SIGNED_BLOCK, [&qnet](Message& m) {
-                        handle_pulse_signed_block(m, qnet);
-                    });
+                            pulse_command(
+                                    PULSE_CMD_RANDOM_VALUE,
+                                    [&qnet](Message& m) { handle_pulse_random_value(m, qnet); }))
+                    .add_command(
+                            PULSE_CMD_SIGNED_BLOCK,
+                            pulse_command(PULSE_CMD_SIGNED_BLOCK, [&qnet](Message& m) {
+                                handle_pulse_signed_block(m, qnet);
+                            }));
         }
 
         // bl.*: responses to blinks sent from quorum members back to the node who submitted the
@@ -2146,14 +2367,14 @@ namespace {
                 // only sent by the entry point service nodes into the quorum to let it know the tx
                 // verification has not started from that node.  It does not necessarily indicate a
                 // failure unless all entry point attempts return the same.
-                .add_command("nostart", handle_blink_not_started)
+                .add_command("nostart", counted("bl", "nostart", handle_blink_not_started))
                 // Message send back from the entry SNs back to the initiator that the Blink tx has
                 // been rejected: that is, enough signed rejections have occured that the Blink tx
                 // cannot be accepted.
-                .add_command("bad", handle_blink_failure)
+                .add_command("bad", counted("bl", "bad", handle_blink_failure))
                 // Sends a message from the entry SNs back to the initiator that the Blink tx has
                 // been accepted and validated and is being broadcast to the network.
-                .add_command("good", handle_blink_success);
+                .add_command("good", counted("bl", "good", handle_blink_success));
 
         // Compatibility aliases.  No longer used since 7.1.4, but can still be received from
         // previous 7.1.x nodes. Transition plan: 8.1.0: keep the aliases (so the 7.1.x nodes still
@@ -0,0 +1,91 @@
+#include "request_queue.h"
+
+#include "logging/oxen_logger.h"
+
+namespace cryptonote {
+
+static auto logcat = log::Cat("cn.request_queue");
+
+request_queue::request_queue(size_t threads, size_t max_per_connection) :
+        m_max_per_connection{max_per_connection} {
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; i++)
+        m_threads.emplace_back([this] { worker(); });
+}
+
+request_queue::~request_queue() {
+    stop();
+}
+
+void request_queue::stop() {
+    {
+        std::lock_guard lock{m_mutex};
+        if (m_stopping)
+            return;
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+    m_threads.clear();
+    m_connections.clear();
+    m_ready.clear();
+}
+
+bool request_queue::push(const connection_id_t& conn, std::function<void()> job) {
+    {
+        std::lock_guard lock{m_mutex};
+        if (m_stopping)
+            return false;
+        auto& c = m_connections[conn];
+        if (c.jobs.size() >= m_max_per_connection)
+            return false;
+        c.jobs.push_back(std::move(job));
+        if (c.running || c.jobs.size() > 1)
+            return true;
+        m_ready.push_back(conn);
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+size_t request_queue::queued(const connection_id_t& conn) const {
+    std::lock_guard lock{m_mutex};
+    auto it = m_connections.find(conn);
+    return it == m_connections.end() ? 0 : it->second.jobs.size();
+}
+
+void request_queue::worker() {
+    std::unique_lock lock{m_mutex};
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stopping || !m_ready.empty(); });
+        if (m_stopping)
+            return;
+
+        auto conn = m_ready.front();
+        m_ready.pop_front();
+        auto& c = m_connections[conn];
+        c.running = true;
+        auto job = std::move(c.jobs.front());
+        lock.unlock();
+
+        try {
+            job();
+        } catch (const std::exception& e) {
+            log::error(logcat, "Queued request failed: {}", e.what());
+        }
+
+        lock.lock();
+        // Only this worker removes `conn`'s entry while it is running, so `c` is still valid
+        c.jobs.pop_front();
+        c.running = false;
+        if (c.jobs.empty())
+            m_connections.erase(conn);
+        else {
+            m_ready.push_back(conn);
+            m_cv.notify_one();
+        }
+    }
+}
+
+}  // namespace cryptonote
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "epee/net/net_utils_base.h"
+
+namespace cryptonote {
+
+using epee::connection_id_t;
+
+/// Runs jobs on a small set of worker threads, keeping the jobs for each connection in order: a
+/// connection's next job does not start until its previous one has finished, while jobs for
+/// different connections run in parallel.  This is used for peer requests that are expensive to
+/// serve (i.e. reading blocks out of the database) so that they don't hold up the p2p io threads.
+class request_queue {
+  public:
+    /// Starts `threads` workers.  Each connection may have up to `max_per_connection` jobs waiting
+    /// or running at once.
+    request_queue(size_t threads, size_t max_per_connection);
+
+    /// Stops the queue, waiting for running jobs to finish.  Jobs that have not started yet are
+    /// discarded.
+    ~request_queue();
+
+    request_queue(const request_queue&) = delete;
+    request_queue& operator=(const request_queue&) = delete;
+
+    /// Queues `job` to run after any other jobs queued for `conn`.  Returns false (without
+    /// queuing anything) if `conn` already has the maximum number of jobs queued, or if the queue
+    /// has been stopped.
+    bool push(const connection_id_t& conn, std::function<void()> job);
+
+    /// Returns the number of jobs waiting or running for `conn`.
+    size_t queued(const connection_id_t& conn) const;
+
+    /// Stops the workers; see the destructor.  Subsequent pushes fail.
+    void stop();
+
+  private:
+    struct connection_jobs {
+        std::deque<std::function<void()>> jobs;  // the front job is running, if `running`
+        bool running = false;
+    };
+
+    void worker();
+
+    const size_t m_max_per_connection;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::unordered_map<connection_id_t, connection_jobs> m_connections;
+    // Connections with jobs waiting and none running
+    std::deque<connection_id_t> m_ready;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+};
+
+}  // namespace cryptonote
@@ -188,6 +188,22 @@ bool command_parser_executor::print_net_stats(const std::vector<std::string>& ar
     return m_executor.print_net_stats();
 }
 
+bool command_parser_executor::print_threadpool(const std::vector<std::string>& args) {
+    if (!args.empty())
+        return false;
+
+    return m_executor.print_threadpool();
+}
+
+bool command_parser_executor::trace(const std::vector<std::string>& args) {
+    if (args.size() == 1 && (args[0] == "start" || args[0] == "stop" || args[0] == "clear"))
+        return m_executor.trace(args[0], "");
+    if (args.size() == 2 && args[0] == "dump")
+        return m_executor.trace(args[0], args[1]);
+    std::cout << "usage: trace start|stop|clear|dump FILE" << std::endl;
+    return true;
+}
+
 bool command_parser_executor::print_blockchain_info(const std::vector<std::string>& args) {
     if (!args.size()) {
         std::cout << "need block index parameter" << std::endl;
@@ -140,6 +140,10 @@ class command_parser_executor final {
 
     bool print_net_stats(const std::vector<std::string>& args);
 
+    bool print_threadpool(const std::vector<std::string>& args);
+
+    bool trace(const std::vector<std::string>& args);
+
     bool print_sn_state_changes(const std::vector<std::string>& args);
 
     bool flush_cache(const std::vector<std::string>& args);
@@ -67,6 +67,18 @@ void command_server::init_commands(cryptonote::rpc::core_rpc_server* rpc_server)
             "print_net_stats",
             [this](const auto& x) { return m_parser.print_net_stats(x); },
             "Print network statistics.");
+    m_command_lookup.set_handler(
+            "print_threadpool",
+            [this](const auto& x) { return m_parser.print_threadpool(x); },
+            "Print how many tasks the verification thread pool has run and how long they spent "
+            "queued and running.");
+    m_command_lookup.set_handler(
+            "trace",
+            [this](const auto& x) { return m_parser.trace(x); },
+            "trace start|stop|clear|dump FILE",
+            "Start or stop recording tracing spans of the daemon's hot paths, discard the spans "
+            "recorded so far, or write them to FILE in the Chrome trace format (which Perfetto "
+            "and chrome://tracing can open).");
     m_command_lookup.set_handler(
             "print_bc",
             [this](const auto& x) { return m_parser.print_blockchain_info(x); },
@@ -228,16 +228,25 @@ daemon::daemon(boost::program_options::variables_map vm_) :
         }
     }
 
+    auto http_threads =
+            command_line::get_arg(vm, cryptonote::rpc::http_server::arg_rpc_http_threads);
+    if (http_threads == 0)
+        throw oxen::traced<std::runtime_error>{"--rpc-http-threads must be at least 1"};
+
     if (!rpc_listen_admin.empty()) {
         log::info(logcat, "- admin HTTP RPC server");
         http_rpc_admin.emplace(
-                *rpc, rpc_config, false /*not restricted*/, std::move(rpc_listen_admin));
+                *rpc,
+                rpc_config,
+                false /*not restricted*/,
+                std::move(rpc_listen_admin),
+                http_threads);
     }
 
     if (!rpc_listen_public.empty()) {
         log::info(logcat, "- public HTTP RPC server");
         http_rpc_public.emplace(
-                *rpc, rpc_config, true /*restricted*/, std::move(rpc_listen_public));
+                *rpc, rpc_config, true /*restricted*/, std::move(rpc_listen_public), http_threads);
     }
 
     log::info(
@@ -299,6 +308,7 @@ void daemon::init_options(
     cryptonote::rpc::core_rpc_server::init_options(option_spec, hidden);
     cryptonote::rpc::http_server::init_options(option_spec, hidden);
     cryptonote::rpc::init_omq_options(option_spec);
+    cryptonote::rpc::init_shm_options(option_spec);
     quorumnet::init_core_callbacks();
 }
 
@@ -343,6 +353,9 @@ bool daemon::run(bool interactive) {
         omq_rpc = std::make_unique<cryptonote::rpc::omq_rpc>(*core, *rpc, vm);
         core->start_oxenmq();
 
+        // Runs its requests as OxenMQ jobs, so has to come after OxenMQ is started
+        shm_rpc = std::make_unique<cryptonote::rpc::shm_rpc>(*core, *rpc, vm);
+
         if (http_rpc_admin) {
             log::info(logcat, "Starting admin HTTP RPC server");
             http_rpc_admin->start();
@@ -395,6 +408,11 @@ bool daemon::run(bool interactive) {
             rpc_commands.reset();
         }
 
+        if (shm_rpc) {
+            log::info(logcat, "Stopping shared memory RPC server...");
+            shm_rpc.reset();
+        }
+
         if (http_rpc_public) {
             log::info(logcat, "Stopping public HTTP RPC server...");
             http_rpc_public->shutdown();
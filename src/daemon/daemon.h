@@ -37,6 +37,7 @@
 #include "rpc/core_rpc_server.h"
 #include "rpc/http_server.h"
 #include "rpc/omq_server.h"
+#include "rpc/shm_server.h"
 
 #undef OXEN_DEFAULT_LOG_CATEGORY
 #define OXEN_DEFAULT_LOG_CATEGORY "daemon"
@@ -76,6 +77,7 @@ class daemon {
     std::unique_ptr<cryptonote::rpc::core_rpc_server> rpc;
     std::optional<cryptonote::rpc::http_server> http_rpc_admin, http_rpc_public;
     std::unique_ptr<cryptonote::rpc::omq_rpc> omq_rpc;
+    std::unique_ptr<cryptonote::rpc::shm_rpc> shm_rpc;
 };
 
 }  // namespace daemonize
@@ -50,6 +50,7 @@
 
 #include "checkpoints/checkpoints.h"
 #include "common/exception.h"
+#include "common/file.h"
 #include "common/median.h"
 #include "common/password.h"
 #include "common/pruning.h"
@@ -692,6 +693,15 @@ bool rpc_command_executor::mining_status() {
                 "Mining at {} with {} threads",
                 get_mining_speed(mres["speed"].get<long>()),
                 mres["threads_count"].get<int>());
+        if (auto it = mres.find("thread_speeds"); it != mres.end() && !it->empty()) {
+            std::string speeds;
+            for (auto& speed : *it)
+                speeds += (speeds.empty() ? "" : ", ") + get_mining_speed(speed.get<long>());
+            tools::msg_writer(
+                    "Per-thread speeds{}: {}",
+                    mres.value("pinned_threads", false) ? " (pinned)" : "",
+                    speeds);
+        }
         tools::msg_writer("Mining address: {}", mres["address"].get<std::string_view>());
     }
     tools::msg_writer("PoW algorithm: {}", mres["pow_algorithm"].get<std::string_view>());
@@ -788,6 +798,91 @@ bool rpc_command_executor::print_net_stats() {
     return true;
 }
 
+bool rpc_command_executor::print_threadpool() {
+    auto maybe_stats = try_running(
+            [this] { return invoke<GET_THREADPOOL_STATS>(); },
+            "Failed to retrieve thread pool statistics");
+    if (!maybe_stats)
+        return false;
+    auto& stats = *maybe_stats;
+
+    tools::success_msg_writer(
+            "Thread pool: {} threads, {} tasks queued now, at most {} at once",
+            stats["threads"].get<unsigned>(),
+            stats["queued"].get<uint64_t>(),
+            stats["max_queued"].get<uint64_t>());
+
+    auto seconds = [](double s) {
+        return tools::friendly_duration(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::duration<double>{s}));
+    };
+    std::vector<std::string> buckets;
+    for (auto& b : stats["time_buckets"])
+        buckets.push_back("≤" + seconds(b.get<double>()));
+    buckets.push_back(">" + seconds(stats["time_buckets"].back().get<double>()));
+
+    auto writer = tools::msg_writer();
+    writer.append(
+            "{:<24}{:>12}{:>12}{:>14}{:>14}\n",
+            "tag",
+            "submitted",
+            "executed",
+            "avg wait",
+            "avg run");
+    auto print_row = [&](std::string_view tag, const json& ts) {
+        auto executed = ts["executed"].get<uint64_t>();
+        writer.append(
+                "{:<24}{:>12}{:>12}{:>14}{:>14}\n",
+                tag,
+                ts["submitted"].get<uint64_t>(),
+                executed,
+                executed ? seconds(ts["wait_time"].get<double>() / executed) : "-",
+                executed ? seconds(ts["run_time"].get<double>() / executed) : "-");
+    };
+    for (auto& [tag, ts] : stats["tags"].items())
+        print_row(tag, ts);
+    print_row("(all)", stats["total"]);
+
+    for (auto hist : {"wait_histogram", "run_histogram"}) {
+        writer.append("\nAll tasks by {} time:\n", hist == "wait_histogram"sv ? "wait" : "run");
+        auto& counts = stats["total"][hist];
+        for (size_t i = 0; i < buckets.size() && i < counts.size(); i++)
+            writer.append("  {:>10}: {}\n", buckets[i], counts[i].get<uint64_t>());
+    }
+
+    return true;
+}
+
+bool rpc_command_executor::trace(std::string_view action, const std::string& file) {
+    json params;
+    if (action == "start" || action == "stop")
+        params["enable"] = action == "start";
+    else if (action == "clear")
+        params["clear"] = true;
+    else
+        params["dump"] = true;
+
+    auto maybe_res = try_running(
+            [&] { return invoke<TRACE>(std::move(params)); }, "Failed to control tracing");
+    if (!maybe_res)
+        return false;
+    auto& res = *maybe_res;
+
+    if (!res["compiled"].get<bool>())
+        tools::fail_msg_writer("This daemon was built without tracing (ENABLE_TRACING=OFF)");
+    else if (action == "dump") {
+        if (!tools::dump_file(tools::utf8_path(file), res["trace"].get<std::string>())) {
+            tools::fail_msg_writer("Failed to write trace to {}", file);
+            return false;
+        }
+        tools::success_msg_writer("Trace written to {}", file);
+    } else
+        tools::success_msg_writer(
+                "Tracing is {}", res["enabled"].get<bool>() ? "enabled" : "disabled");
+    return true;
+}
+
 bool rpc_command_executor::print_blockchain_info(
         int64_t start_block_index, uint64_t end_block_index) {
     // negative: relative to the end
@@ -258,6 +258,10 @@ class rpc_command_executor final {
 
     bool print_net_stats();
 
+    bool print_threadpool();
+
+    bool trace(std::string_view action, const std::string& file);
+
     bool flush_cache(bool bad_txs, bool invalid_blocks);
 
     bool claim_rewards(std::string_view address);
@@ -160,6 +160,20 @@ class device {
             const crypto::key_derivation& derivation,
             const std::size_t output_index,
             crypto::public_key& derived_pub) = 0;
+    // derive_subaddress_public_key() for each (pubs[i], derivations[i], output_indices[i]); a
+    // result is left null where that fails.  The default device does the batch with a single field
+    // inversion; others just do them one at a time.
+    virtual void derive_subaddress_public_keys(
+            const std::vector<crypto::public_key>& pubs,
+            const std::vector<crypto::key_derivation>& derivations,
+            const std::vector<size_t>& output_indices,
+            std::vector<crypto::public_key>& derived_pubs) {
+        derived_pubs.assign(pubs.size(), crypto::public_key{});
+        for (size_t i = 0; i < pubs.size(); i++)
+            if (!derive_subaddress_public_key(
+                        pubs[i], derivations[i], output_indices[i], derived_pubs[i]))
+                derived_pubs[i] = crypto::public_key{};
+    }
     virtual crypto::public_key get_subaddress_spend_public_key(
             const cryptonote::account_keys& keys, const cryptonote::subaddress_index& index) = 0;
     virtual std::vector<crypto::public_key> get_subaddress_spend_public_keys(
@@ -192,6 +206,19 @@ class device {
             const crypto::public_key& pub,
             const crypto::secret_key& sec,
             crypto::key_derivation& derivation) = 0;
+    // Generates the derivation of each of `pubs` with `sec`, as generate_key_derivation() would;
+    // `ok[i]` is set to false where that fails.  Hardware devices override this to get through a
+    // whole block batch under one lock and with as few round trips as they can manage.
+    virtual void generate_key_derivations(
+            const std::vector<crypto::public_key>& pubs,
+            const crypto::secret_key& sec,
+            std::vector<crypto::key_derivation>& derivations,
+            std::vector<bool>& ok) {
+        derivations.resize(pubs.size());
+        ok.resize(pubs.size());
+        for (size_t i = 0; i < pubs.size(); i++)
+            ok[i] = generate_key_derivation(pubs[i], sec, derivations[i]);
+    }
     virtual bool conceal_derivation(
             crypto::key_derivation& derivation,
             const crypto::public_key& tx_pub_key,
@@ -114,6 +114,14 @@ bool device_default::derive_subaddress_public_key(
     return crypto::derive_subaddress_public_key(out_key, derivation, output_index, derived_key);
 }
 
+void device_default::derive_subaddress_public_keys(
+        const std::vector<crypto::public_key>& pubs,
+        const std::vector<crypto::key_derivation>& derivations,
+        const std::vector<size_t>& output_indices,
+        std::vector<crypto::public_key>& derived_pubs) {
+    crypto::derive_subaddress_public_keys(pubs, derivations, output_indices, derived_pubs);
+}
+
 crypto::public_key device_default::get_subaddress_spend_public_key(
         const cryptonote::account_keys& keys, const cryptonote::subaddress_index& index) {
     if (index.is_zero())
@@ -246,14 +254,25 @@ crypto::secret_key device_default::generate_keys(
 
 crypto::key_derivation device_default::generate_key_derivation(
         const crypto::public_key& pub, const crypto::secret_key& sec) {
-    return crypto::generate_key_derivation(pub, sec);
+    crypto::key_derivation d;
+    generate_key_derivation(pub, sec, d);
+    return d;
 }
 
 bool device_default::generate_key_derivation(
         const crypto::public_key& key1,
         const crypto::secret_key& key2,
         crypto::key_derivation& derivation) {
-    return crypto::generate_key_derivation(key1, key2, derivation);
+    // Scanning derives with the wallet's view key over and over (from several threads at once), so
+    // keep the last key used by each thread prepared.
+    thread_local crypto::secret_key last_key;
+    thread_local crypto::precomputed_derivation_key last_precomputed =
+            crypto::precompute_derivation_key(last_key);
+    if (key2 != last_key) {
+        last_key = key2;
+        last_precomputed = crypto::precompute_derivation_key(key2);
+    }
+    return crypto::generate_key_derivation(key1, last_precomputed, derivation);
 }
 
 bool device_default::derivation_to_scalar(
@@ -80,6 +80,11 @@ class device_default : public hw::device {
             const crypto::key_derivation& derivation,
             const std::size_t output_index,
             crypto::public_key& derived_pub) override;
+    void derive_subaddress_public_keys(
+            const std::vector<crypto::public_key>& pubs,
+            const std::vector<crypto::key_derivation>& derivations,
+            const std::vector<size_t>& output_indices,
+            std::vector<crypto::public_key>& derived_pubs) override;
     crypto::public_key get_subaddress_spend_public_key(
             const cryptonote::account_keys& keys,
             const cryptonote::subaddress_index& index) override;
@@ -151,6 +151,82 @@ void HMACmap::clear() {
     hmacs.clear();
 }
 
+/* ===================================================================== */
+/* ===                     DerivationCache                          ==== */
+/* ===================================================================== */
+
+static std::string derivation_key(const crypto::public_key& pub, const crypto::secret_key& sec) {
+    std::string key;
+    key.reserve(64);
+    key.append(reinterpret_cast<const char*>(pub.data()), 32);
+    key.append(reinterpret_cast<const char*>(sec.data()), 32);
+    return key;
+}
+
+static std::string derived_pub_key(
+        unsigned char ins,
+        const crypto::key_derivation& derivation,
+        size_t output_index,
+        const crypto::public_key& pub) {
+    std::string key;
+    key.reserve(1 + 32 + 32 + sizeof(uint64_t));
+    key += static_cast<char>(ins);
+    key.append(reinterpret_cast<const char*>(derivation.data()), 32);
+    key.append(reinterpret_cast<const char*>(pub.data()), 32);
+    auto index = oxenc::host_to_little<uint64_t>(output_index);
+    key.append(reinterpret_cast<const char*>(&index), sizeof(index));
+    return key;
+}
+
+bool DerivationCache::find_derivation(
+        const crypto::public_key& pub,
+        const crypto::secret_key& sec,
+        crypto::key_derivation& derivation) const {
+    auto it = derivations.find(derivation_key(pub, sec));
+    if (it == derivations.end())
+        return false;
+    derivation = it->second;
+    return true;
+}
+
+void DerivationCache::add_derivation(
+        const crypto::public_key& pub,
+        const crypto::secret_key& sec,
+        const crypto::key_derivation& derivation) {
+    if (derivations.size() >= MAX_SIZE)
+        derivations.clear();
+    derivations.insert_or_assign(derivation_key(pub, sec), derivation);
+}
+
+bool DerivationCache::find_derived_pub(
+        unsigned char ins,
+        const crypto::key_derivation& derivation,
+        size_t output_index,
+        const crypto::public_key& pub,
+        crypto::public_key& derived_pub) const {
+    auto it = derived_pubs.find(derived_pub_key(ins, derivation, output_index, pub));
+    if (it == derived_pubs.end())
+        return false;
+    derived_pub = it->second;
+    return true;
+}
+
+void DerivationCache::add_derived_pub(
+        unsigned char ins,
+        const crypto::key_derivation& derivation,
+        size_t output_index,
+        const crypto::public_key& pub,
+        const crypto::public_key& derived_pub) {
+    if (derived_pubs.size() >= MAX_SIZE)
+        derived_pubs.clear();
+    derived_pubs.insert_or_assign(derived_pub_key(ins, derivation, output_index, pub), derived_pub);
+}
+
+void DerivationCache::clear() {
+    derivations.clear();
+    derived_pubs.clear();
+}
+
 /* ===================================================================== */
 /* ===                        Keymap                                ==== */
 /* ===================================================================== */
@@ -514,6 +590,7 @@ unsigned int device_ledger::finish_and_exchange(int& offset, bool wait_on_input)
 
 bool device_ledger::reset() {
     reset_buffer();
+    derivation_cache.clear();
     int offset = set_command_header_noopt(INS_RESET);
     CHECK_AND_ASSERT_THROW_MES(
             offset + OXEN_VERSION_STR.size() <= BUFFER_SEND_SIZE, "OXEN_VERSION_STR is too long");
@@ -733,6 +810,10 @@ bool device_ledger::connect() {
     return true;
 }
 
+bool device_ledger::use_derivation_cache() const {
+    return !tx_in_progress && (mode_ == mode::TRANSACTION_PARSE || mode_ == mode::NONE);
+}
+
 bool device_ledger::connected() const {
     return hw_device->connected();
 }
@@ -897,7 +978,13 @@ bool device_ledger::derive_subaddress_public_key(
         // (wihtout the help of the device), so continue that way.
         log::debug(logcat, "derive_subaddress_public_key  : PARSE mode with known viewkey");
         crypto::derive_subaddress_public_key(pub, derivation, output_index, derived_pub);
-    } else {
+    } else if (!use_derivation_cache() ||
+               !derivation_cache.find_derived_pub(
+                       INS_DERIVE_SUBADDRESS_PUBLIC_KEY,
+                       derivation,
+                       output_index,
+                       pub,
+                       derived_pub)) {
 
         int offset = set_command_header_noopt(INS_DERIVE_SUBADDRESS_PUBLIC_KEY);
         // pub
@@ -911,6 +998,10 @@ bool device_ledger::derive_subaddress_public_key(
 
         // pub key
         receive_bytes(derived_pub.data(), 32);
+
+        if (use_derivation_cache())
+            derivation_cache.add_derived_pub(
+                    INS_DERIVE_SUBADDRESS_PUBLIC_KEY, derivation, output_index, pub, derived_pub);
     }
 #ifdef DEBUG_HWDEVICE
     check32("derive_subaddress_public_key",
@@ -1263,6 +1354,8 @@ bool device_ledger::generate_key_derivation(
         // Note derivation in PARSE mode can only happen with viewkey, so assert it!
         assert(is_fake_view_key(sec));
         r = crypto::generate_key_derivation(pub, viewkey, derivation);
+    } else if (use_derivation_cache() && derivation_cache.find_derivation(pub, sec, derivation)) {
+        r = true;
     } else {
         int offset = set_command_header_noopt(INS_GEN_KEY_DERIVATION);
         // pub
@@ -1276,6 +1369,8 @@ bool device_ledger::generate_key_derivation(
         // derivation data
         receive_secret(derivation.data(), offset);
 
+        if (use_derivation_cache())
+            derivation_cache.add_derivation(pub, sec, derivation);
         r = true;
     }
 #ifdef DEBUG_HWDEVICE
@@ -1287,6 +1382,30 @@ bool device_ledger::generate_key_derivation(
     return r;
 }
 
+void device_ledger::generate_key_derivations(
+        const std::vector<crypto::public_key>& pubs,
+        const crypto::secret_key& sec,
+        std::vector<crypto::key_derivation>& derivations,
+        std::vector<bool>& ok) {
+    // The device has no instruction taking more than one derivation per APDU, so the best we can do
+    // is to hold the device for the whole batch, skip the round trips for anything it has already
+    // answered, and not ask again for repeats within the batch.  (command_locker isn't recursive,
+    // so generate_key_derivation takes that one itself for each request.)
+    std::lock_guard lock{device_locker};
+    derivations.resize(pubs.size());
+    ok.resize(pubs.size());
+    std::unordered_map<crypto::public_key, size_t> first_seen;
+    for (size_t i = 0; i < pubs.size(); i++) {
+        auto [it, inserted] = first_seen.emplace(pubs[i], i);
+        if (!inserted) {
+            derivations[i] = derivations[it->second];
+            ok[i] = ok[it->second];
+            continue;
+        }
+        ok[i] = generate_key_derivation(pubs[i], sec, derivations[i]);
+    }
+}
+
 bool device_ledger::conceal_derivation(
         crypto::key_derivation& derivation,
         const crypto::public_key& tx_pub_key,
@@ -1403,18 +1522,26 @@ bool device_ledger::derive_public_key(
     log_hexbuffer("derive_public_key: [[OUT]] derived_pub ", derived_pub_x.data(), 32);
 #endif
 
-    int offset = set_command_header_noopt(INS_DERIVE_PUBLIC_KEY);
-    // derivation
-    send_secret(derivation.data(), offset);
-    // index
-    send_u32(output_index, offset);
-    // pub
-    send_bytes(pub.data(), 32, offset);
+    const bool cache = use_derivation_cache();
+    if (!cache || !derivation_cache.find_derived_pub(
+                          INS_DERIVE_PUBLIC_KEY, derivation, output_index, pub, derived_pub)) {
+        int offset = set_command_header_noopt(INS_DERIVE_PUBLIC_KEY);
+        // derivation
+        send_secret(derivation.data(), offset);
+        // index
+        send_u32(output_index, offset);
+        // pub
+        send_bytes(pub.data(), 32, offset);
 
-    finish_and_exchange(offset);
+        finish_and_exchange(offset);
 
-    // pub key
-    receive_bytes(derived_pub.data(), 32);
+        // pub key
+        receive_bytes(derived_pub.data(), 32);
+
+        if (cache)
+            derivation_cache.add_derived_pub(
+                    INS_DERIVE_PUBLIC_KEY, derivation, output_index, pub, derived_pub);
+    }
 
 #ifdef DEBUG_HWDEVICE
     check32("derive_public_key", "derived_pub", derived_pub_x.data(), derived_pub.data());
@@ -1641,6 +1768,7 @@ bool device_ledger::open_tx(
 
     key_map.clear();
     hmac_map.clear();
+    derivation_cache.clear();
     tx_in_progress = true;
     int offset = set_command_header_noopt(INS_OPEN_TX, 0x01);
 
@@ -2289,6 +2417,7 @@ bool device_ledger::close_tx() {
     send_simple(INS_CLOSE_TX);
     key_map.clear();
     hmac_map.clear();
+    derivation_cache.clear();
     tx_in_progress = false;
     unlock();
     return true;
@@ -32,6 +32,7 @@
 #include <chrono>
 #include <cstddef>
 #include <string>
+#include <unordered_map>
 
 #include "device.hpp"
 #include "device/io_ledger_tcp.hpp"
@@ -143,6 +144,43 @@ class HMACmap {
     void clear();
 };
 
+/// Results of derivation requests the device has already answered, keyed by the request's inputs,
+/// so that a transaction seen more than once (in the pool and then in a block, or on a rescan), or
+/// with several outputs to us, doesn't cost another round trip per output each time.  Bounded: it
+/// is simply emptied when full, which suits a refresh's access pattern well enough.
+class DerivationCache {
+  public:
+    static constexpr size_t MAX_SIZE = 4096;
+
+    bool find_derivation(
+            const crypto::public_key& pub,
+            const crypto::secret_key& sec,
+            crypto::key_derivation& derivation) const;
+    void add_derivation(
+            const crypto::public_key& pub,
+            const crypto::secret_key& sec,
+            const crypto::key_derivation& derivation);
+    // `ins` is the instruction that computed it, since derive_public_key and
+    // derive_subaddress_public_key take the same inputs
+    bool find_derived_pub(
+            unsigned char ins,
+            const crypto::key_derivation& derivation,
+            size_t output_index,
+            const crypto::public_key& pub,
+            crypto::public_key& derived_pub) const;
+    void add_derived_pub(
+            unsigned char ins,
+            const crypto::key_derivation& derivation,
+            size_t output_index,
+            const crypto::public_key& pub,
+            const crypto::public_key& derived_pub);
+    void clear();
+
+  private:
+    std::unordered_map<std::string, crypto::key_derivation> derivations;
+    std::unordered_map<std::string, crypto::public_key> derived_pubs;
+};
+
 #define BUFFER_SEND_SIZE 262
 #define BUFFER_RECV_SIZE 262
 
@@ -210,6 +248,12 @@ class device_ledger : public device {
     // hmac for some encrypted value
     HMACmap hmac_map;
 
+    // Only used outside of transactions, where the device's answers depend on nothing but the
+    // inputs; the derivations it returns are encrypted with its session key, so this is also
+    // cleared on reset().
+    DerivationCache derivation_cache;
+    bool use_derivation_cache() const;
+
     // To speed up blockchain parsing the view key maybe handle here.
     crypto::secret_key viewkey;
     bool has_view_key;
@@ -323,6 +367,11 @@ class device_ledger : public device {
             const crypto::public_key& pub,
             const crypto::secret_key& sec,
             crypto::key_derivation& derivation) override;
+    void generate_key_derivations(
+            const std::vector<crypto::public_key>& pubs,
+            const crypto::secret_key& sec,
+            std::vector<crypto::key_derivation>& derivations,
+            std::vector<bool>& ok) override;
     bool conceal_derivation(
             crypto::key_derivation& derivation,
             const crypto::public_key& tx_pub_key,
@@ -5,13 +5,16 @@
 #include <common/lock.h>
 #include <crypto/crypto.h>
 #include <crypto/eth.h>
+#include <blockchain_db/sqlite/db_sqlite.h>
 #include <cryptonote_basic/cryptonote_format_utils.h>
 #include <cryptonote_core/cryptonote_core.h>
 #include <fmt/color.h>
 #include <logging/oxen_logger.h>
 #include <oxenmq/oxenmq.h>
 
+#include <atomic>
 #include <chrono>
+#include <memory>
 #include <utility>
 #include <variant>
 
@@ -35,6 +38,7 @@ L2Tracker::L2Tracker(cryptonote::core& core_, std::chrono::milliseconds update_f
     core.omq().add_timer(
             updater,
             [this, update_frequency, dedicated_thread] {
+                load_stored_state();
                 update_state();
                 auto& omq = core.omq();
                 omq.cancel_timer(updater);
@@ -98,6 +102,40 @@ void L2Tracker::set_height(uint64_t l2_height, bool take_lock) {
     prune_old_states();
 }
 
+void L2Tracker::load_stored_state() {
+    std::optional<cryptonote::l2_stored_state> stored;
+    try {
+        stored = core.blockchain.sqlite_db().load_l2_state();
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to load stored L2 state: {}", e.what());
+    }
+    if (!stored)
+        return;
+
+    // See process_logs for why we need the mempool lock as well
+    auto locks = tools::unique_locks(mutex, core.mempool);
+    for (auto& stored_log : stored->logs) {
+        ethyl::LogEntry log{};
+        log.address = rewards_contract.address();
+        log.topics = std::move(stored_log.topics);
+        log.data = std::move(stored_log.data);
+        log.blockNumber = stored_log.height;
+        log.blockHash = std::move(stored_log.block_hash);
+        log.transactionHash = std::move(stored_log.tx_hash);
+        log.logIndex = stored_log.log_index;
+        process_log_entry(log);
+    }
+    reward_rate.merge(stored->reward_rates);
+    synced_height = std::max(synced_height, stored->synced_height);
+    log::info(
+            logcat,
+            "Loaded {} L2 logs and {} reward rates from the local store; L2 logs are synced "
+            "through height {}",
+            stored->logs.size(),
+            reward_rate.size(),
+            synced_height);
+}
+
 void L2Tracker::update_state() {
     // TODO: also check chain id?  Perhaps just one on first startup?
 
@@ -112,6 +150,16 @@ void L2Tracker::update_state() {
         provider.getAllHeightsAsync([this](std::vector<ethyl::HeightInfo> height_info) {
             log::debug(logcat, "Got all provider heights");
             next_provider_check = std::chrono::steady_clock::now() + PROVIDERS_CHECK_INTERVAL;
+            for (const auto& hi : height_info)
+                record_request(hi.index, std::nullopt, hi.success);
+            std::vector<bool> unreliable(height_info.size());
+            {
+                std::lock_guard slock{stats_mutex};
+                for (const auto& hi : height_info)
+                    if (hi.index < unreliable.size() && hi.index < stats.size())
+                        unreliable[hi.index] =
+                                stats[hi.index].error_rate > PROVIDERS_MAX_ERROR_RATE;
+            }
             uint64_t best_height = 0;
             for (auto& hi : height_info)
                 if (hi.height > best_height)
@@ -119,14 +167,20 @@ void L2Tracker::update_state() {
             uint64_t threshold = best_height < PROVIDERS_CHECK_THRESHOLD
                                        ? 0
                                        : best_height - PROVIDERS_CHECK_THRESHOLD;
-            // Sort to maintain index order of any "good" (above threshold) providers first, and
-            // then followed by any "bad" (below threshold) where the bad nodes are ordered by the
-            // height they gave us in descending order.
+            // Sort to maintain index order of any "good" (above threshold) providers first (with
+            // good-but-unreliable ones, i.e. with a high recent error rate, after reliable ones),
+            // and then followed by any "bad" (below threshold) where the bad nodes are ordered by
+            // the height they gave us in descending order.
             std::sort(height_info.begin(), height_info.end(), [&](const auto& a, const auto& b) {
                 bool a_good = a.height >= threshold, b_good = b.height >= threshold;
-                if (a_good && b_good)
-                    // Both above threshold: preserve the configured order
+                if (a_good && b_good) {
+                    // Both above threshold: reliable first, otherwise preserve the configured order
+                    bool a_unreliable = a.index < unreliable.size() && unreliable[a.index];
+                    bool b_unreliable = b.index < unreliable.size() && unreliable[b.index];
+                    if (a_unreliable != b_unreliable)
+                        return b_unreliable;
                     return a.index < b.index;
+                }
                 if (a_good && !b_good)
                     return true;
                 if (b_good && !a_good)
@@ -147,7 +201,8 @@ void L2Tracker::update_state() {
             new_prio.reserve(height_info.size());
             for (const auto& hi : height_info) {
                 new_prio.push_back(hi.index);
-                if (!hi.success || hi.height < threshold) {
+                bool is_unreliable = hi.index < unreliable.size() && unreliable[hi.index];
+                if (!hi.success || hi.height < threshold || is_unreliable) {
                     auto& name = client_info()[hi.index].name;
                     auto& url = client_info()[hi.index].url;
                     auto level = hi.index == 0 ? log::Level::err : log::Level::warn;
@@ -155,6 +210,13 @@ void L2Tracker::update_state() {
                     if (!hi.success)
                         log::log(
                                 logcat, level, "Failed to retrieve height from {} [{}]", name, url);
+                    else if (hi.height >= threshold)
+                        log::log(
+                                logcat,
+                                level,
+                                "{} [{}] has a high request error rate",
+                                name,
+                                tools::trim_url(url));
                     else
                         log::log(
                                 logcat,
@@ -244,7 +306,8 @@ void L2Tracker::update_state() {
 }
 
 void L2Tracker::update_height() {
-    provider.getLatestHeightAsync([this](std::optional<uint64_t> height) {
+    provider.getLatestHeightAsync([this, req = start_request()](std::optional<uint64_t> height) {
+        finish_request(req, height.has_value());
         bool keep_going = false;
         {
             std::lock_guard lock{mutex};
@@ -275,7 +338,7 @@ void L2Tracker::update_height() {
     });
 }
 
-void L2Tracker::update_rewards(std::optional<std::forward_list<uint64_t>> more) {
+void L2Tracker::update_rewards() {
     // If the contract addresses aren't set yet (i.e. for HF20 before the contract is deployed)
     // then there's nothing else to actually update yet and so we're done.
     const auto& conf = core.get_net_config();
@@ -295,93 +358,106 @@ void L2Tracker::update_rewards(std::optional<std::forward_list<uint64_t>> more)
 
     // Make sure we have the last 2 L2_REWARD_POOL_UPDATE_BLOCKS reward values on hand so that we
     // can be called on at any time as a pulse validator to validate the l2_reward amount with a
-    // safety margin.  We get called with nullopt initially to determine which heights we need, then
-    // recurse with more set to the list of heights we need to retrieve.  For each one, we retrieve,
-    // remove it from the list, then recurse (as needed) until more is empty.
-    if (!more) {
-        const auto reward_update_blocks = core.get_net_config().L2_REWARD_POOL_UPDATE_BLOCKS;
-        std::forward_list<uint64_t> need;
-        {
-            std::shared_lock lock{mutex};
-            for (auto r_height = reward_height(
-                         latest_height - std::min(latest_height, reward_update_blocks),
-                         reward_update_blocks);
-                 r_height <= latest_height;
-                 r_height += reward_update_blocks) {
-                if (!reward_rate.count(r_height))
-                    need.push_front(r_height);
-            }
-            log::debug(
-                    logcat, "Need to fetch reward rate for heights: {{{}}}", fmt::join(need, ","));
+    // safety margin.  We request all the heights we are missing at once, and move on to the logs
+    // once they have all come back.
+    const auto reward_update_blocks = core.get_net_config().L2_REWARD_POOL_UPDATE_BLOCKS;
+    std::vector<uint64_t> need;
+    {
+        std::shared_lock lock{mutex};
+        for (auto r_height = reward_height(
+                     latest_height - std::min(latest_height, reward_update_blocks),
+                     reward_update_blocks);
+             r_height <= latest_height;
+             r_height += reward_update_blocks) {
+            if (!reward_rate.count(r_height))
+                need.push_back(r_height);
         }
+        log::debug(logcat, "Need to fetch reward rate for heights: {{{}}}", fmt::join(need, ","));
+    }
 
-        if (!need.empty())
-            update_rewards(std::move(need));
-        else
-            update_logs();
+    if (need.empty()) {
+        update_logs();
         return;
     }
 
-    assert(!more->empty());
-    std::shared_lock lock{mutex};
-    auto r_height = more->front();
-    more->pop_front();
-    log::debug(logcat, "Starting query for reward height {}", r_height);
-    provider.callReadFunctionJSONAsync(
-            core.get_net_config().ETHEREUM_POOL_CONTRACT,
-            "0x{:x}"_format(contract::call::Pool_rewardRate),
-            [this, r_height, more = std::move(more)](std::optional<nlohmann::json> result) mutable {
-                if (!result)
-                    log::warning(logcat, "Failed to fetch reward rate for height {}", r_height);
-                else if (!result->is_string())
-                    log::warning(logcat, "Unexpected reward rate result: {}", result->dump());
-                else {
-                    // NOTE: In certain conditions (like when intialising an empty reward pool)
-                    // the returned reward rate can be "0x" which we handle as 0.
-                    std::array<std::byte, 32> rate256{};
-                    std::span<const char> rate256_hex =
-                            tools::hex_span(result->get<std::string_view>());
-
-                    if (rate256_hex.empty() ||
-                        tools::try_load_from_hex_guts(rate256_hex, rate256)) {
-                        try {
-                            auto reward = tools::decode_integer_be(rate256);
-                            {
-                                std::lock_guard lock{mutex};
-                                reward_rate[r_height] = reward;
+    auto remaining = std::make_shared<std::atomic<size_t>>(need.size());
+    for (auto r_height : need) {
+        log::debug(logcat, "Starting query for reward height {}", r_height);
+        provider.callReadFunctionJSONAsync(
+                core.get_net_config().ETHEREUM_POOL_CONTRACT,
+                "0x{:x}"_format(contract::call::Pool_rewardRate),
+                [this, r_height, reward_update_blocks, remaining, req = start_request()](
+                        std::optional<nlohmann::json> result) {
+                    finish_request(req, result.has_value());
+                    if (!result)
+                        log::warning(logcat, "Failed to fetch reward rate for height {}", r_height);
+                    else if (!result->is_string())
+                        log::warning(logcat, "Unexpected reward rate result: {}", result->dump());
+                    else {
+                        // NOTE: In certain conditions (like when intialising an empty reward pool)
+                        // the returned reward rate can be "0x" which we handle as 0.
+                        std::array<std::byte, 32> rate256{};
+                        std::span<const char> rate256_hex =
+                                tools::hex_span(result->get<std::string_view>());
+
+                        if (rate256_hex.empty() ||
+                            tools::try_load_from_hex_guts(rate256_hex, rate256)) {
+                            try {
+                                auto reward = tools::decode_integer_be(rate256);
+                                {
+                                    std::lock_guard lock{mutex};
+                                    reward_rate[r_height] = reward;
+                                }
+                                try {
+                                    core.blockchain.sqlite_db().store_l2_reward_rate(
+                                            r_height, reward);
+                                } catch (const std::exception& e) {
+                                    log::warning(
+                                            logcat, "Failed to store L2 reward rate: {}", e.what());
+                                }
+                                log::debug(
+                                        logcat,
+                                        "Contract reward rate for L2 heights {}-{} is {}",
+                                        r_height,
+                                        r_height + reward_update_blocks - 1,
+                                        reward);
+                            } catch (const std::exception& e) {
+                                log::warning(logcat, "Failed to parse reward rate: {}", e.what());
                             }
-                            log::debug(
+                        } else {
+                            log::warning(
                                     logcat,
-                                    "Contract reward rate for L2 heights {}-{} is {}",
-                                    r_height,
-                                    r_height + core.get_net_config().L2_REWARD_POOL_UPDATE_BLOCKS -
-                                            1,
-                                    reward);
-                        } catch (const std::exception& e) {
-                            log::warning(logcat, "Failed to parse reward rate: {}", e.what());
+                                    "Unparseable reward rate result: {} {}",
+                                    result->get<std::string_view>(),
+                                    std::string_view(rate256_hex.data(), rate256_hex.size()));
                         }
-                    } else {
-                        log::warning(
-                                logcat,
-                                "Unparseable reward rate result: {} {}",
-                                result->get<std::string_view>(),
-                                std::string_view(rate256_hex.data(), rate256_hex.size()));
                     }
-                }
 
-                log::debug(
-                        logcat,
-                        "Finished querying reward for height {}, there is more: {}",
-                        r_height,
-                        more->empty() ? "no" : "yes");
-                if (!more->empty())
-                    update_rewards(std::move(more));
-                else
-                    update_logs();
-            },
-            "0x{:x}"_format(r_height));
+                    auto left = --*remaining;
+                    log::debug(
+                            logcat,
+                            "Finished querying reward for height {}, {} queries remaining",
+                            r_height,
+                            left);
+                    if (left == 0)
+                        update_logs();
+                },
+                "0x{:x}"_format(r_height));
+    }
 }
 
+// A set of consecutive log ranges requested together, and their results as they come back.
+struct L2Tracker::logs_fetch {
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    std::vector<std::optional<std::vector<ethyl::LogEntry>>> results;
+    std::atomic<size_t> remaining;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+};
+
+// How many times we will halve the log request range (from GETLOGS_MAX_BLOCKS) when log requests
+// fail before giving up until the next update.
+static constexpr int GETLOGS_MAX_SHRINK = 4;
+
 void L2Tracker::update_logs() {
     std::shared_lock lock{mutex};
 
@@ -404,117 +480,185 @@ void L2Tracker::update_logs() {
         return;
     }
 
-    uint64_t to = std::min(latest_height, from + GETLOGS_MAX_BLOCKS - 1);
+    const uint64_t range_blocks = std::max<uint64_t>(1, GETLOGS_MAX_BLOCKS >> getlogs_shrink);
+    auto fetch = std::make_shared<logs_fetch>();
+    for (uint64_t start = from;
+         start <= latest_height && fetch->ranges.size() < std::max<size_t>(1, GETLOGS_CONCURRENCY);
+         start += range_blocks)
+        fetch->ranges.emplace_back(start, std::min(latest_height, start + range_blocks - 1));
+    fetch->results.resize(fetch->ranges.size());
+    fetch->remaining = fetch->ranges.size();
 
     log::debug(
             logcat,
-            "Initiating L2 request for logs for heights {}-{} (target height: {})",
+            "Initiating {} L2 request(s) for logs for heights {}-{} (target height: {})",
+            fetch->ranges.size(),
             from,
-            to,
+            fetch->ranges.back().second,
             latest_height);
-    provider.getLogsAsync(
-            from,
-            to,
-            rewards_contract.address(),
-            [this, to, from, started = std::chrono::steady_clock::now()](
-                    std::optional<std::vector<ethyl::LogEntry>> logs) {
-                bool keep_going = false;
-                {
-                    // NOTE: This lambda locks both the TX pool and the L2 tracker atomically
-                    // because we will add the L2 transactions into the mempool. This prevents
-                    // deadlock in other codepaths that may try to lock like
-                    //
-                    //   This thread: Lock(L2 Tracker) -> Lock (TX pool)
-                    //   Other thread: Lock(TX pool)   -> Lock (L2 Tracker)
-                    //
-                    // For example, this was happening in our worker thread for
-                    // (1) tx_memory_pool::remove_stuck_transaction and
-                    // (2) blockchain::handle_block_to_main_chain whereby
-                    //
-                    //   This thread: Lock(L2 Tracker) -> Lock(TX pool)
-                    //   (1):         Lock(TX Pool, Blockchain)
-                    //   (2):         Lock(Blockchain) -> Lock(L2 Tracker)
-                    //
-                    auto locks = tools::unique_locks(mutex, core.mempool);
-                    if (!logs) {
-                        log::warning(logcat, "Failed to retrieve L2 logs for {}-{}", from, to);
-                        update_in_progress = false;
-                        log::debug(logcat, "L2 update finished");
-                        // End without calling update_purge_list because we want to be sure we've
-                        // seen any pending events before we start considering purges.
-                        return;
-                    }
-                    log::debug(
-                            logcat,
-                            "Retrieved {} L2 logs for heights {}-{} in {:.3f}s",
-                            logs->size(),
-                            from,
-                            to,
-                            std::chrono::duration<double>{
-                                    std::chrono::steady_clock::now() - started}
-                                    .count());
-
-                    for (const auto& log : *logs) {
-                        if (!log.blockNumber) {
-                            log::error(logcat, "Log item from L2 provider without a blockNumber!");
-                            continue;
-                        }
-                        try {
-                            auto tx = get_log_event(chain_id, log);
-                            add_to_mempool(tx);
-                            if (auto* reg_v2 = std::get_if<event::NewServiceNodeV2>(&tx))
-                                recent_regs_v2.add(std::move(*reg_v2), *log.blockNumber);
-                            else if (auto* ul = std::get_if<event::ServiceNodeExitRequest>(&tx))
-                                recent_unlocks.add(std::move(*ul), *log.blockNumber);
-                            else if (auto* exit = std::get_if<event::ServiceNodeExit>(&tx))
-                                recent_exits.add(std::move(*exit), *log.blockNumber);
-                            else if (auto* req = std::get_if<event::StakingRequirementUpdated>(&tx))
-                                recent_req_changes.add(std::move(*req), *log.blockNumber);
-                            else {
-                                assert(tx.index() == 0);
-                            }
-                        } catch (const std::exception& e) {
-
-                            fmt::memory_buffer buffer{};
-                            fmt::format_to(
-                                    std::back_inserter(buffer),
-                                    "The raw blob was (32 byte chunks/line):\n\n");
-                            std::string_view hex = log.data;
-                            while (hex.size()) {
-                                std::string_view chunk = tools::string_safe_substr(
-                                        hex, 0, 64);  // Grab 32 byte chunk
-                                fmt::format_to(
-                                        std::back_inserter(buffer),
-                                        "  {}\n",
-                                        chunk);  // Output the chunk
-                                hex = tools::string_safe_substr(
-                                        hex, 64, hex.size());  // Advance the hex
-                            }
+    for (size_t i = 0; i < fetch->ranges.size(); i++) {
+        auto [start, end] = fetch->ranges[i];
+        provider.getLogsAsync(
+                start,
+                end,
+                rewards_contract.address(),
+                [this, fetch, i, req = start_request()](
+                        std::optional<std::vector<ethyl::LogEntry>> logs) {
+                    finish_request(req, logs.has_value());
+                    fetch->results[i] = std::move(logs);
+                    if (--fetch->remaining == 0)
+                        process_logs(*fetch);
+                });
+    }
+}
 
-                            log::error(
-                                    logcat,
-                                    "Failed to convert L2 state change transaction to an Oxen "
-                                    "state change transaction: {}\n\n{}",
-                                    e.what(),
-                                    fmt::to_string(buffer));
-                            continue;
-                        }
-                    }
+void L2Tracker::process_logs(logs_fetch& fetch) {
+    enum class next_step { logs, purge_list, done };
+    next_step next;
+    std::vector<cryptonote::l2_stored_log> to_store;
+    std::optional<uint64_t> stored_synced_height;
+    uint64_t safe_height = 0, log_expiry = 0, reward_expiry = 0;
+    {
+        // NOTE: This locks both the TX pool and the L2 tracker atomically because we will add the
+        // L2 transactions into the mempool. This prevents deadlock in other codepaths that may try
+        // to lock like
+        //
+        //   This thread: Lock(L2 Tracker) -> Lock (TX pool)
+        //   Other thread: Lock(TX pool)   -> Lock (L2 Tracker)
+        //
+        // For example, this was happening in our worker thread for
+        // (1) tx_memory_pool::remove_stuck_transaction and
+        // (2) blockchain::handle_block_to_main_chain whereby
+        //
+        //   This thread: Lock(L2 Tracker) -> Lock(TX pool)
+        //   (1):         Lock(TX Pool, Blockchain)
+        //   (2):         Lock(Blockchain) -> Lock(L2 Tracker)
+        //
+        auto locks = tools::unique_locks(mutex, core.mempool);
+
+        // Results are applied in height order, stopping at the first failure: everything after
+        // it gets requested again.
+        bool failed = false;
+        for (size_t i = 0; i < fetch.ranges.size(); i++) {
+            auto [from, to] = fetch.ranges[i];
+            auto& logs = fetch.results[i];
+            if (!logs) {
+                log::warning(logcat, "Failed to retrieve L2 logs for {}-{}", from, to);
+                failed = true;
+                break;
+            }
+            log::debug(
+                    logcat,
+                    "Retrieved {} L2 logs for heights {}-{} in {:.3f}s",
+                    logs->size(),
+                    from,
+                    to,
+                    std::chrono::duration<double>{std::chrono::steady_clock::now() - fetch.started}
+                            .count());
+
+            for (const auto& log : *logs) {
+                process_log_entry(log);
+                if (log.blockNumber) {
+                    auto& stored = to_store.emplace_back();
+                    stored.height = *log.blockNumber;
+                    stored.log_index = log.logIndex.value_or(to_store.size() - 1);
+                    stored.block_hash = log.blockHash.value_or("");
+                    stored.tx_hash = log.transactionHash.value_or("");
+                    stored.topics = log.topics;
+                    stored.data = log.data;
+                }
+            }
 
-                    synced_height = to;
+            synced_height = to;
+            stored_synced_height = to;
+        }
 
-                    keep_going = to < latest_height;
-                }
-                if (keep_going)
-                    update_logs();
-                else
-                    // NB: there is a `return` statement above that will bypass this on fetch error,
-                    // but that is desirable: we want the purge list update to always follow a full
-                    // log update so that we don't add nodes to the purge list that are undergoing a
-                    // normal contract exit, and so we need any pending regular exits to be noticed
-                    // before we consider purging.
-                    update_purge_list();
-            });
+        const auto& conf = core.get_net_config();
+        safe_height = latest_height - std::min(latest_height, conf.L2_TRACKER_SAFE_BLOCKS);
+        log_expiry = latest_height - std::min(latest_height, HIST_SIZE);
+        reward_expiry = reward_height(log_expiry, conf.L2_REWARD_POOL_UPDATE_BLOCKS);
+
+        if (!failed) {
+            if (getlogs_shrink > 0)
+                getlogs_shrink--;
+            next = synced_height < latest_height ? next_step::logs : next_step::purge_list;
+        } else if (
+                getlogs_shrink < GETLOGS_MAX_SHRINK && (GETLOGS_MAX_BLOCKS >> getlogs_shrink) > 1) {
+            // Providers commonly reject requests covering too many blocks or returning too many
+            // logs, so retry right away with smaller ranges.
+            getlogs_shrink++;
+            log::debug(
+                    logcat,
+                    "Retrying L2 log requests with ranges of {} blocks",
+                    std::max<uint64_t>(1, GETLOGS_MAX_BLOCKS >> getlogs_shrink));
+            next = next_step::logs;
+        } else {
+            update_in_progress = false;
+            log::debug(logcat, "L2 update finished");
+            // End without calling update_purge_list because we want to be sure we've seen any
+            // pending events before we start considering purges.
+            next = next_step::done;
+        }
+    }
+
+    if (stored_synced_height) {
+        try {
+            auto& sqlite = core.blockchain.sqlite_db();
+            sqlite.store_l2_logs(to_store);
+            sqlite.store_l2_synced_height(*stored_synced_height, safe_height);
+            sqlite.prune_l2_state(log_expiry, reward_expiry);
+        } catch (const std::exception& e) {
+            log::warning(logcat, "Failed to store L2 logs: {}", e.what());
+        }
+    }
+
+    if (next == next_step::logs)
+        update_logs();
+    else if (next == next_step::purge_list)
+        // NB: we deliberately don't get here after a fetch error: we want the purge list update to
+        // always follow a full log update so that we don't add nodes to the purge list that are
+        // undergoing a normal contract exit, and so we need any pending regular exits to be
+        // noticed before we consider purging.
+        update_purge_list();
+}
+
+// Must be called with the mutex (and mempool lock) held!
+void L2Tracker::process_log_entry(const ethyl::LogEntry& log) {
+    if (!log.blockNumber) {
+        log::error(logcat, "Log item from L2 provider without a blockNumber!");
+        return;
+    }
+    try {
+        auto tx = get_log_event(chain_id, log);
+        add_to_mempool(tx);
+        if (auto* reg_v2 = std::get_if<event::NewServiceNodeV2>(&tx))
+            recent_regs_v2.add(std::move(*reg_v2), *log.blockNumber);
+        else if (auto* ul = std::get_if<event::ServiceNodeExitRequest>(&tx))
+            recent_unlocks.add(std::move(*ul), *log.blockNumber);
+        else if (auto* exit = std::get_if<event::ServiceNodeExit>(&tx))
+            recent_exits.add(std::move(*exit), *log.blockNumber);
+        else if (auto* req = std::get_if<event::StakingRequirementUpdated>(&tx))
+            recent_req_changes.add(std::move(*req), *log.blockNumber);
+        else {
+            assert(tx.index() == 0);
+        }
+    } catch (const std::exception& e) {
+        fmt::memory_buffer buffer{};
+        fmt::format_to(std::back_inserter(buffer), "The raw blob was (32 byte chunks/line):\n\n");
+        std::string_view hex = log.data;
+        while (hex.size()) {
+            std::string_view chunk = tools::string_safe_substr(hex, 0, 64);  // Grab 32 byte chunk
+            fmt::format_to(std::back_inserter(buffer), "  {}\n", chunk);     // Output the chunk
+            hex = tools::string_safe_substr(hex, 64, hex.size());            // Advance the hex
+        }
+
+        log::error(
+                logcat,
+                "Failed to convert L2 state change transaction to an Oxen state change "
+                "transaction: {}\n\n{}",
+                e.what(),
+                fmt::to_string(buffer));
+    }
 }
 
 void L2Tracker::update_purge_list(bool curr_height_fallback) {
@@ -801,6 +945,51 @@ std::optional<std::chrono::nanoseconds> L2Tracker::latest_height_age() const {
     return std::nullopt;
 }
 
+L2Tracker::request_start L2Tracker::start_request() const {
+    request_start req{std::nullopt, std::chrono::steady_clock::now()};
+    if (auto order = provider.getClientOrder(); !order.empty())
+        req.client = order.front();
+    return req;
+}
+
+void L2Tracker::finish_request(const request_start& req, bool success) {
+    if (req.client)
+        record_request(*req.client, std::chrono::steady_clock::now() - req.started, success);
+}
+
+void L2Tracker::record_request(
+        size_t client, std::optional<std::chrono::duration<double>> latency, bool success) {
+    // Weight of the newest sample in the moving averages
+    constexpr double ALPHA = 0.2;
+
+    std::lock_guard lock{stats_mutex};
+    if (stats.size() <= client)
+        stats.resize(client + 1);
+    auto& st = stats[client];
+    st.requests++;
+    if (!success)
+        st.failures++;
+    st.error_rate += ALPHA * ((success ? 0.0 : 1.0) - st.error_rate);
+    // Failures usually take until the timeout, so would only muddy the latency of the provider
+    if (latency && success)
+        st.latency = st.latency ? *st.latency + ALPHA * (*latency - *st.latency) : *latency;
+}
+
+std::pair<std::vector<std::pair<ethyl::Client, L2Tracker::provider_stats>>, std::optional<size_t>>
+L2Tracker::get_provider_stats() const {
+    std::pair<std::vector<std::pair<ethyl::Client, provider_stats>>, std::optional<size_t>> result;
+    auto& [providers, primary] = result;
+    for (auto& client : provider.getClients())
+        providers.emplace_back(std::move(client), provider_stats{});
+    if (auto order = provider.getClientOrder(); !order.empty())
+        primary = order.front();
+
+    std::lock_guard lock{stats_mutex};
+    for (size_t i = 0; i < providers.size() && i < stats.size(); i++)
+        providers[i].second = stats[i];
+    return result;
+}
+
 uint64_t L2Tracker::get_safe_height() const {
     std::shared_lock lock{mutex};
     const cryptonote::network_config& config = cryptonote::get_config(core.get_nettype());
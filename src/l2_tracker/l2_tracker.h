@@ -5,10 +5,12 @@
 
 #include <chrono>
 #include <ethyl/provider.hpp>
-#include <forward_list>
 #include <iterator>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <unordered_set>
+#include <vector>
 
 #include "crypto/eth.h"
 #include "events.h"
@@ -52,11 +54,43 @@ class L2Tracker {
              latest_purge_check = 0;
     bool initial = true;
     bool update_in_progress = false;
+    // How many times the log request range has been halved from GETLOGS_MAX_BLOCKS because of
+    // failed log requests; each successful fetch undoes one halving.
+    int getlogs_shrink = 0;
     std::chrono::steady_clock::time_point next_provider_check = std::chrono::steady_clock::now();
     std::optional<std::chrono::steady_clock::time_point> primary_down;
     std::chrono::steady_clock::time_point primary_last_warned;
     std::optional<std::chrono::steady_clock::time_point> latest_height_ts;
 
+  public:
+    // Request statistics we keep for each configured L2 provider
+    struct provider_stats {
+        // Exponentially weighted moving average of the response time of successful requests sent
+        // while this was the primary provider (nullopt if there haven't been any).  Requests are
+        // only routed through the primary, and so only its latency can be observed.
+        std::optional<std::chrono::duration<double>> latency;
+        // Exponentially weighted moving average of the fraction of requests that failed, from both
+        // all-provider height checks and requests sent while this was the primary.
+        double error_rate = 0;
+        uint64_t requests = 0, failures = 0;
+    };
+
+  private:
+    // Stats of each configured provider (by client index); guarded by stats_mutex rather than
+    // `mutex` so that they can be updated from any L2 callback.
+    mutable std::mutex stats_mutex;
+    std::vector<provider_stats> stats;
+
+    // The primary client and start time of a request, used to record its outcome in `stats`.
+    struct request_start {
+        std::optional<size_t> client;
+        std::chrono::steady_clock::time_point started;
+    };
+    request_start start_request() const;
+    void finish_request(const request_start& req, bool success);
+    void record_request(
+            size_t client, std::optional<std::chrono::duration<double>> latency, bool success);
+
     // Provider state updating: `update_state()` starts a chain of updates, each one triggering the
     // next step in the chain when its response is received.  While such an update is in progress
     // any call to `update_state()` will do nothing.
@@ -73,14 +107,16 @@ class L2Tracker {
     //    height from our current active provider.  Proceed to 3.
     // 3. If we are missing reward info for a recent reward height block (i.e. those divisible by
     //    L2_REWARD_POOL_UPDATE_BLOCKS), fetch the updated reward data.  We generally keep the most
-    //    recent and second-most recent on hand, and so this step will repeat if we need both.  Once
+    //    recent and second-most recent on hand; if we need both they are requested at once.  Once
     //    we've done any reward updates (or if none were needed) proceed to 4.
     // 4. Log updating.  We fetch logs, starting at the next block height after the most recent log
     //    fetch (or HIST_SIZE ago, if that is later), giving us ethereum events for node actions.
-    //    We fetch at most 100 (by default, but confirable) at a time, and as each set of logs comes
-    //    back repeat this step until we have fetched all logs up to the current height.  Any such
-    //    witnessed events are added to the mempool for inclusion in new blocks and are used for
-    //    confirm (or deny) L2 events that are still awaiting confirmation.
+    //    We fetch at most GETLOGS_MAX_BLOCKS at a time in up to GETLOGS_CONCURRENCY concurrent
+    //    requests, and once a set of logs comes back repeat this step until we have fetched all
+    //    logs up to the current height.  If a request fails we retry with smaller ranges, as
+    //    providers commonly reject ranges with too many results.  Any such witnessed events are
+    //    added to the mempool for inclusion in new blocks and are used for confirm (or deny) L2
+    //    events that are still awaiting confirmation.
     // 5. If the height passed a new L2_NODE_LIST_PURGE_BLOCKS height interval since the last purge
     //    check we performed then we fetch the full set of current nodes from the contract; any
     //    nodes present in the oxend service node list that are neither present in the contract nor
@@ -91,10 +127,17 @@ class L2Tracker {
     //    fallback).
     //
     void update_state();
+    // Loads the L2 logs and reward rates kept in the local L2 event store (in the batching
+    // database), so that only newer logs have to be fetched from the L2 provider.  Called before
+    // the first update.
+    void load_stored_state();
     void set_height(uint64_t new_height, bool take_lock = true);
     void update_height();
-    void update_rewards(std::optional<std::forward_list<uint64_t>> more = std::nullopt);
+    void update_rewards();
     void update_logs();
+    struct logs_fetch;
+    void process_logs(logs_fetch& fetch);
+    void process_log_entry(const ethyl::LogEntry& log);
     void update_purge_list(bool curr_height_fallback = false);
     void add_to_mempool(const event::StateChangeVariant& state_change);
 
@@ -134,6 +177,11 @@ class L2Tracker {
     // HIST_SIZE / (this value) requests to fill the initial event state.
     uint64_t GETLOGS_MAX_BLOCKS = cryptonote::ETH_L2_DEFAULT_MAX_LOGS;
 
+    // How many log requests of GETLOGS_MAX_BLOCKS we send at once when more blocks than that need
+    // to be fetched (typically when starting up, or after losing the provider for a while).  The
+    // responses are processed in height order once all of the concurrent requests have completed.
+    size_t GETLOGS_CONCURRENCY = cryptonote::ETH_L2_DEFAULT_CONCURRENT_LOGS;
+
     // These two parameters control how we re-check all the configured L2 providers to reprioritize,
     // when multiple providers are configured.  When checking, we consider each provider to be in
     // good standing if its height is within `CHECK_THRESHOLD` blocks of the maximum height we
@@ -144,6 +192,11 @@ class L2Tracker {
     std::chrono::milliseconds PROVIDERS_CHECK_INTERVAL = cryptonote::ETH_L2_DEFAULT_CHECK_INTERVAL;
     uint64_t PROVIDERS_CHECK_THRESHOLD = cryptonote::ETH_L2_DEFAULT_CHECK_THRESHOLD;
 
+    // Providers that are in sync but whose average error rate is above this are prioritized after
+    // the providers that are in sync and reliable, so that a primary that answers height checks
+    // but keeps failing other requests doesn't hold up every update until it is fully off line.
+    double PROVIDERS_MAX_ERROR_RATE = 0.5;
+
     // Does a *synchronous* test of the chainId of all providers; this is intended to be called once
     // during oxen-core construction, and to abort startup if the provider(s) are providing the
     // wrong chain.  Logs errors and returns false if any return a chainId that doesn't match the
@@ -169,6 +222,11 @@ class L2Tracker {
     // Returns the age of the last successful height response we got from an L2 RPC provider.
     std::optional<std::chrono::nanoseconds> latest_height_age() const;
 
+    // Returns the info and request statistics of each configured L2 provider, in configured order,
+    // along with the index of the current primary provider (if there are any providers).
+    std::pair<std::vector<std::pair<ethyl::Client, provider_stats>>, std::optional<size_t>>
+    get_provider_stats() const;
+
     // Initiates a synchronous request to the current L2 contract to retrieve the current list of
     // BLS pubkeys, and returns the numeric contract IDs of any contract pubkeys that are not in the
     // `[begin..end)` input range.
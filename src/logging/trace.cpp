@@ -0,0 +1,147 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include "common/format.h"
+
+namespace oxen::logging::trace {
+
+namespace {
+
+    struct event {
+        const std::string* cat;
+        std::string_view name;
+        int64_t start;
+        int64_t end;
+    };
+
+    // Written only by its thread.  `written` counts the events ever recorded, so the newest is at
+    // (written - 1) % size, and `claimed` is bumped before an event's slot gets overwritten: a
+    // reader copies events out and then uses `claimed` to discard any that the writer might have
+    // overwritten while it was copying.
+    struct thread_buffer {
+        uint32_t tid;
+        std::string thread_name;
+        std::atomic<uint64_t> claimed{0};
+        std::atomic<uint64_t> written{0};
+        std::vector<event> events = std::vector<event>(THREAD_BUFFER_SPANS);
+    };
+
+    std::mutex buffers_mutex;
+    // Buffers outlive their threads, so that spans of threads that have finished still get dumped
+    std::vector<std::shared_ptr<thread_buffer>> buffers;
+    // Spans which started before this (set by clear()) are not dumped
+    std::atomic<int64_t> cleared_at{0};
+
+    std::shared_ptr<thread_buffer> register_thread() {
+        auto buf = std::make_shared<thread_buffer>();
+#ifdef __linux__
+        char name[16];
+        if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+            buf->thread_name = name;
+#endif
+        std::lock_guard lock{buffers_mutex};
+        buf->tid = buffers.size() + 1;
+        buffers.push_back(buf);
+        return buf;
+    }
+
+    void append_json_string(std::string& out, std::string_view s) {
+        out += '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                out += c;
+        }
+        out += '"';
+    }
+
+}  // namespace
+
+int64_t detail::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+void detail::record(const std::string& cat, std::string_view name, int64_t start, int64_t end) {
+    thread_local const std::shared_ptr<thread_buffer> buf = register_thread();
+    auto i = buf->written.load(std::memory_order_relaxed);
+    buf->claimed.store(i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    buf->events[i % buf->events.size()] = {&cat, name, start, end};
+    buf->written.store(i + 1, std::memory_order_release);
+}
+
+void enable(bool on) {
+    detail::enabled = on;
+}
+
+void clear() {
+    cleared_at = detail::now();
+}
+
+std::string dump_chrome_trace() {
+    std::vector<std::shared_ptr<thread_buffer>> bufs;
+    {
+        std::lock_guard lock{buffers_mutex};
+        bufs = buffers;
+    }
+    const auto since = cleared_at.load();
+
+    std::string out = R"({"displayTimeUnit":"ms","traceEvents":[)";
+    bool first = true;
+    auto next = [&] {
+        if (!first)
+            out += ',';
+        first = false;
+    };
+    std::vector<event> events;
+    for (const auto& buf : bufs) {
+        const uint64_t size = buf->events.size();
+        auto end = buf->written.load(std::memory_order_acquire);
+        auto begin = end > size ? end - size : 0;
+        events.clear();
+        for (auto i = begin; i < end; i++)
+            events.push_back(buf->events[i % size]);
+        // Drop whatever the thread overwrote (or started to) while we were copying
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto claimed = buf->claimed.load(std::memory_order_relaxed);
+        size_t skip = claimed > begin + size
+                            ? std::min<uint64_t>(claimed - size - begin, end - begin)
+                            : 0;
+
+        if (!buf->thread_name.empty()) {
+            next();
+            out += R"({"name":"thread_name","ph":"M","pid":1,"tid":)";
+            out += "{},\"args\":{{\"name\":"_format(buf->tid);
+            append_json_string(out, buf->thread_name);
+            out += "}}";
+        }
+        for (size_t i = skip; i < events.size(); i++) {
+            const auto& e = events[i];
+            if (e.start < since)
+                continue;
+            next();
+            out += R"({"ph":"X","pid":1,"name":)";
+            append_json_string(out, e.name);
+            out += ",\"cat\":";
+            append_json_string(out, *e.cat);
+            out += ",\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}"_format(
+                    buf->tid, e.start / 1000.0, (e.end - e.start) / 1000.0);
+        }
+    }
+    out += "]}";
+    return out;
+}
+
+}  // namespace oxen::logging::trace
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "oxen_logger.h"
+
+/// Low-overhead tracing of hot paths.  A span records the times at which it was entered and left
+/// into a ring buffer owned by the recording thread, without formatting anything or taking a lock;
+/// the buffers are only read when dumped, as a Chrome trace event file (which chrome://tracing and
+/// the Perfetto UI both open).
+///
+/// Spans are added with OXEN_TRACE_SPAN, which compiles to nothing when the build has tracing
+/// disabled (-DENABLE_TRACING=OFF).  When compiled in, nothing gets recorded until tracing is
+/// enabled at run time, and until then a span costs a relaxed atomic load.
+namespace oxen::logging::trace {
+
+/// The number of spans kept for each thread; once full, a thread's oldest spans get overwritten.
+inline constexpr size_t THREAD_BUFFER_SPANS = 8192;
+
+namespace detail {
+    inline std::atomic<bool> enabled{false};
+
+    int64_t now();
+    void record(const std::string& cat, std::string_view name, int64_t start, int64_t end);
+}  // namespace detail
+
+inline bool enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/// Starts or stops recording spans.  Spans already recorded are kept (until overwritten).
+void enable(bool on = true);
+
+/// Discards the spans recorded so far.
+void clear();
+
+/// Returns the recorded spans of all threads as a Chrome trace event format JSON document.
+std::string dump_chrome_trace();
+
+/// Records the time from its construction to its destruction (if tracing was enabled when it was
+/// constructed).  `name` must point at storage that outlives the dump, such as a string literal.
+class span {
+  public:
+    span(const log::logger_ptr& cat, std::string_view name) {
+        if (enabled()) {
+            m_cat = &cat->name();
+            m_name = name;
+            m_start = detail::now();
+        }
+    }
+    ~span() {
+        if (m_cat)
+            detail::record(*m_cat, m_name, m_start, detail::now());
+    }
+
+    span(const span&) = delete;
+    span& operator=(const span&) = delete;
+
+  private:
+    const std::string* m_cat = nullptr;
+    std::string_view m_name;
+    int64_t m_start;
+};
+
+}  // namespace oxen::logging::trace
+
+#ifdef OXEN_TRACING
+#define OXEN_TRACE_CONCAT_(a, b) a##b
+#define OXEN_TRACE_CONCAT(a, b) OXEN_TRACE_CONCAT_(a, b)
+/// Traces the rest of the enclosing scope as a span named `name` in log category `cat`.
+#define OXEN_TRACE_SPAN(cat, name) \
+    ::oxen::logging::trace::span OXEN_TRACE_CONCAT(oxen_trace_span_, __LINE__) { cat, name }
+#else
+#define OXEN_TRACE_SPAN(cat, name) static_cast<void>(0)
+#endif
@@ -197,12 +197,14 @@ bool generate_multisig_composite_key_image(
             return false;
         used.insert(pki);
     }
-    for (const auto& pki : pkis) {
-        if (used.find(pki) == used.end()) {
-            used.insert(pki);
-            rct::addKeys((rct::key&)ki, rct::ki2rct(ki), rct::ki2rct(pki));
-        }
-    }
+    // Sum everything in one go rather than pairwise so that the point is only compressed once
+    rct::keyV terms;
+    terms.reserve(1 + pkis.size());
+    terms.push_back(rct::ki2rct(ki));
+    for (const auto& pki : pkis)
+        if (used.insert(pki).second)
+            terms.push_back(rct::ki2rct(pki));
+    ki = rct::rct2ki(rct::addKeys(terms));
     return true;
 }
 //-----------------------------------------------------------------
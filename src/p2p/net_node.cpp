@@ -148,6 +148,10 @@ const command_line::arg_descriptor<std::vector<std::string>> arg_anonymous_inbou
         "\"x.onion,127.0.0.1:18083,100\""};
 const command_line::arg_flag arg_p2p_hide_my_port{
         "hide-my-port", "Do not announce yourself as peerlist candidate"};
+const command_line::arg_descriptor<std::string> arg_ban_list = {
+        "ban-list",
+        "Specify ban list file, one IP address or CIDR subnet per line; the hosts and subnets in "
+        "it are blocked for as long as the daemon runs"};
 const command_line::arg_flag arg_no_sync{
         "no-sync", "Don't synchronize the blockchain with other peers"};
 
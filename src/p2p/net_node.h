@@ -60,6 +60,7 @@
 #include "net_node_common.h"
 #include "net_peerlist.h"
 #include "p2p_protocol_defs.h"
+#include "subnet_trie.h"
 
 PUSH_WARNINGS
 DISABLE_VS_WARNINGS(4355)
@@ -233,6 +234,11 @@ class node_server
     uint32_t get_this_peer_port() { return m_listening_port; }
     t_payload_net_handler& get_payload_object();
 
+    /// Returns the stats of every levin command received (on any connection) since startup
+    std::map<int, cryptonote::levin_command_stats> get_command_stats() const {
+        return m_command_stats.get();
+    }
+
     // debug functions
     bool log_peerlist();
     bool log_connections();
@@ -281,10 +287,17 @@ class node_server
 
     fs::path get_peerlist_file() const;
 
-    CHAIN_LEVIN_INVOKE_MAP2(p2p_connection_context);  // move levin_commands_handler interface
-                                                      // invoke(...) callbacks into invoke map
-    CHAIN_LEVIN_NOTIFY_MAP2(p2p_connection_context);  // move levin_commands_handler interface
-                                                      // notify(...) callbacks into nothing
+    // levin_commands_handler interface: both dispatch into the invoke map below, recording the
+    // command's stats on the connection and in the node-wide totals
+    int invoke(
+            int command,
+            const epee::span<const uint8_t> in_buff,
+            std::string& buff_out,
+            p2p_connection_context& context) override;
+    int notify(
+            int command,
+            const epee::span<const uint8_t> in_buff,
+            p2p_connection_context& context) override;
 
     BEGIN_INVOKE_MAP2(node_server)
     if (is_filtered_command(context.m_remote_address, command))
@@ -340,7 +353,8 @@ class node_server
             std::vector<std::string> txs,
             const epee::net_utils::zone origin,
             const connection_id_t& source,
-            const bool pad_txs);
+            const bool pad_txs,
+            std::vector<crypto::hash> tx_hashes);
     virtual bool invoke_command_to_peer(
             int command,
             const epee::span<const uint8_t> req_buff,
@@ -360,6 +374,8 @@ class node_server
             std::function<bool(typename t_payload_net_handler::connection_context&, peerid_type)>
                     f);
     virtual bool add_host_fail(const epee::net_utils::network_address& address);
+    // Blocks, indefinitely, the hosts and subnets listed in the given file
+    bool load_ban_list(const fs::path& path);
     //----------------- i_connection_filter --------------------------------------------------------
     virtual bool is_remote_host_allowed(
             const epee::net_utils::network_address& address, time_t* t = NULL);
@@ -496,6 +512,7 @@ class node_server
     std::atomic_flag m_fallback_seed_nodes_added;
     std::vector<nodetool::peerlist_entry> m_command_line_peers;
     uint64_t m_peer_livetime;
+    cryptonote::levin_command_stats_map m_command_stats;
     // keep connections to initiate some interactions
 
     static std::optional<p2p_connection_context> public_connect(
@@ -516,6 +533,7 @@ class node_server
     std::shared_mutex m_blocked_hosts_lock;  // for both hosts and subnets
     std::map<std::string, time_t> m_blocked_hosts;
     std::map<epee::net_utils::ipv4_network_subnet, time_t> m_blocked_subnets;
+    subnet_trie m_blocked_subnet_index;  // The same subnets as m_blocked_subnets, for lookups
 
     std::mutex m_host_fails_score_lock;
     std::map<std::string, uint64_t> m_host_fails_score;
@@ -543,6 +561,7 @@ extern const command_line::arg_descriptor<std::vector<std::string>> arg_p2p_seed
 extern const command_line::arg_descriptor<std::vector<std::string>> arg_tx_proxy;
 extern const command_line::arg_descriptor<std::vector<std::string>> arg_anonymous_inbound;
 extern const command_line::arg_flag arg_p2p_hide_my_port;
+extern const command_line::arg_descriptor<std::string> arg_ban_list;
 extern const command_line::arg_flag arg_no_sync;
 
 extern const command_line::arg_flag arg_no_igd;
@@ -112,6 +112,7 @@ void node_server<t_payload_net_handler>::init_options(
     command_line::add_arg(desc, arg_tx_proxy);
     command_line::add_arg(desc, arg_anonymous_inbound);
     command_line::add_arg(desc, arg_p2p_hide_my_port);
+    command_line::add_arg(desc, arg_ban_list);
     command_line::add_arg(desc, arg_no_sync);
     command_line::add_arg(hidden, arg_no_igd);
     command_line::add_arg(hidden, arg_igd);
@@ -193,26 +194,30 @@ bool node_server<t_payload_net_handler>::is_remote_host_allowed(
         }
     }
 
-    // manually loop in subnets
+    // look up the subnets containing it
     if (address.get_type_id() == epee::net_utils::address_type::ipv4) {
-        auto ipv4_address = address.template as<epee::net_utils::ipv4_network_address>();
-        std::map<epee::net_utils::ipv4_network_subnet, time_t>::iterator it;
-        for (it = m_blocked_subnets.begin(); it != m_blocked_subnets.end();) {
-            if (now >= it->second) {
-                it = m_blocked_subnets.erase(it);
-                log::info(
-                        logcat,
-                        fg(fmt::terminal_color::cyan),
-                        "Subnet {} unblocked",
-                        it->first.host_str());
-                continue;
-            }
-            if (it->first.matches(ipv4_address)) {
-                if (t)
-                    *t = it->second - now;
-                return false;
-            }
-            ++it;
+        auto ip = address.template as<epee::net_utils::ipv4_network_address>().ip();
+        std::vector<epee::net_utils::ipv4_network_subnet> expired;
+        std::optional<time_t> blocked_until;
+        m_blocked_subnet_index.for_each_match(ip, [&](const auto& subnet, time_t expiry) {
+            if (now >= expiry)
+                expired.push_back(subnet);
+            else if (!blocked_until || expiry > *blocked_until)
+                blocked_until = expiry;
+        });
+        for (const auto& subnet : expired) {
+            m_blocked_subnets.erase(subnet);
+            m_blocked_subnet_index.erase(subnet);
+            log::info(
+                    logcat,
+                    fg(fmt::terminal_color::cyan),
+                    "Subnet {} unblocked",
+                    subnet.host_str());
+        }
+        if (blocked_until) {
+            if (t)
+                *t = *blocked_until - now;
+            return false;
         }
     }
 
@@ -282,6 +287,7 @@ bool node_server<t_payload_net_handler>::block_subnet(
     else
         limit = now + seconds;
     m_blocked_subnets[subnet] = limit;
+    m_blocked_subnet_index.insert(subnet, limit);
 
     // drop any connection to that subnet. This should only have to look into
     // the zone related to the connection, but really make sure everything is
@@ -318,8 +324,46 @@ bool node_server<t_payload_net_handler>::unblock_subnet(
     auto i = m_blocked_subnets.find(subnet);
     if (i == m_blocked_subnets.end())
         return false;
+    m_blocked_subnet_index.erase(i->first);
     m_blocked_subnets.erase(i);
-    log::info(logcat, fg(fmt::terminal_color::cyan), "Subnet {}", subnet.host_str());
+    log::info(logcat, fg(fmt::terminal_color::cyan), "Subnet {} unblocked", subnet.host_str());
+    return true;
+}
+//-----------------------------------------------------------------------------------
+template <class t_payload_net_handler>
+bool node_server<t_payload_net_handler>::load_ban_list(const fs::path& path) {
+    std::string contents;
+    if (!tools::slurp_file(path, contents)) {
+        log::error(logcat, "Failed to read ban list {}", path);
+        return false;
+    }
+
+    // This runs before we have any connections, so rather than going through block_host and
+    // block_subnet (and logging each of what may be a great many entries) add them directly.
+    std::unique_lock lock{m_blocked_hosts_lock};
+    size_t hosts = 0, subnets = 0, line_number = 0;
+    for (auto line : tools::split(contents, "\n")) {
+        line_number++;
+        tools::trim(line);
+        if (line.empty() || line.front() == '#')
+            continue;
+        if (auto subnet = net::get_ipv4_subnet_address(line)) {
+            m_blocked_subnets[*subnet] = std::numeric_limits<time_t>::max();
+            m_blocked_subnet_index.insert(*subnet, std::numeric_limits<time_t>::max());
+            subnets++;
+        } else if (auto addr = net::get_network_address(line, 0); addr && addr->is_blockable()) {
+            m_blocked_hosts[addr->host_str()] = std::numeric_limits<time_t>::max();
+            hosts++;
+        } else {
+            log::warning(
+                    logcat,
+                    "Invalid entry on line {} of ban list {}: {}",
+                    line_number,
+                    path,
+                    line);
+        }
+    }
+    log::info(logcat, "Blocked {} hosts and {} subnets from ban list {}", hosts, subnets, path);
     return true;
 }
 //-----------------------------------------------------------------------------------
@@ -415,6 +459,10 @@ bool node_server<t_payload_net_handler>::handle_command_line(
             return false;
     }
 
+    if (command_line::has_arg(vm, arg_ban_list) &&
+        !load_ban_list(command_line::get_arg(vm, arg_ban_list)))
+        return false;
+
     if (command_line::get_arg(vm, arg_p2p_hide_my_port))
         m_hide_my_port = true;
 
@@ -746,6 +794,34 @@ node_server<t_payload_net_handler>::get_payload_object() {
 }
 //-----------------------------------------------------------------------------------
 template <class t_payload_net_handler>
+int node_server<t_payload_net_handler>::invoke(
+        int command,
+        const epee::span<const uint8_t> in_buff,
+        std::string& buff_out,
+        p2p_connection_context& context) {
+    bool handled = false;
+    auto start = std::chrono::steady_clock::now();
+    int ret = handle_invoke_map(false, command, in_buff, buff_out, context, handled);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    context.m_command_stats.add(command, in_buff.size(), buff_out.size(), elapsed);
+    m_command_stats.add(command, in_buff.size(), buff_out.size(), elapsed);
+    return ret;
+}
+//-----------------------------------------------------------------------------------
+template <class t_payload_net_handler>
+int node_server<t_payload_net_handler>::notify(
+        int command, const epee::span<const uint8_t> in_buff, p2p_connection_context& context) {
+    bool handled = false;
+    std::string unused;
+    auto start = std::chrono::steady_clock::now();
+    int ret = handle_invoke_map(true, command, in_buff, unused, context, handled);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    context.m_command_stats.add(command, in_buff.size(), 0, elapsed);
+    m_command_stats.add(command, in_buff.size(), 0, elapsed);
+    return ret;
+}
+//-----------------------------------------------------------------------------------
+template <class t_payload_net_handler>
 bool node_server<t_payload_net_handler>::run() {
     // creating thread to log number of connections
     mPeersLoggerThread.emplace([&]() {
@@ -1959,6 +2035,9 @@ bool node_server<t_payload_net_handler>::relay_notify_to_list(
         const epee::span<const uint8_t> data_buff,
         std::vector<std::pair<epee::net_utils::zone, connection_id_t>> connections) {
     std::sort(connections.begin(), connections.end());
+    // Build the levin message once and share it between all the connections' send queues rather
+    // than copying it into a new buffer for each one.
+    epee::shared_sv message{epee::levin::make_notify(command, data_buff)};
     auto zone = m_network_zones.begin();
     for (const auto& c_id : connections) {
         for (;;) {
@@ -1972,7 +2051,7 @@ bool node_server<t_payload_net_handler>::relay_notify_to_list(
             ++zone;
         }
         if (zone->first == c_id.first)
-            zone->second.m_net_server.get_config_object().notify(command, data_buff, c_id.second);
+            zone->second.m_net_server.get_config_object().send(message, c_id.second);
     }
     return true;
 }
@@ -1982,12 +2061,17 @@ epee::net_utils::zone node_server<t_payload_net_handler>::send_txs(
         std::vector<std::string> txs,
         const epee::net_utils::zone origin,
         const connection_id_t& source,
-        const bool pad_txs) {
+        const bool pad_txs,
+        std::vector<crypto::hash> tx_hashes) {
     namespace enet = epee::net_utils;
 
-    const auto send = [&txs, &source, pad_txs](std::pair<const enet::zone, network_zone>& network) {
+    const auto send = [&txs, &source, pad_txs, &tx_hashes](
+                              std::pair<const enet::zone, network_zone>& network) {
         if (network.second.m_notifier.send_txs(
-                    std::move(txs), source, (pad_txs || network.first != enet::zone::public_)))
+                    std::move(txs),
+                    source,
+                    (pad_txs || network.first != enet::zone::public_),
+                    std::move(tx_hashes)))
             return network.first;
         return enet::zone::invalid;
     };
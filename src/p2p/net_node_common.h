@@ -51,7 +51,8 @@ struct i_p2p_endpoint {
             std::vector<std::string> txs,
             const epee::net_utils::zone origin,
             const connection_id_t& source,
-            const bool pad_txs) = 0;
+            const bool pad_txs,
+            std::vector<crypto::hash> tx_hashes) = 0;
     virtual bool invoke_command_to_peer(
             int command,
             const epee::span<const uint8_t> req_buff,
@@ -90,7 +91,8 @@ struct p2p_endpoint_stub : public i_p2p_endpoint<t_connection_context> {
             std::vector<std::string> txs,
             const epee::net_utils::zone origin,
             const connection_id_t& source,
-            const bool pad_txs) {
+            const bool pad_txs,
+            std::vector<crypto::hash> tx_hashes) {
         return epee::net_utils::zone::invalid;
     }
     virtual bool invoke_command_to_peer(
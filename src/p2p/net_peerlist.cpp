@@ -116,6 +116,12 @@ namespace {
     void copy_peers(Container& dest, const Range& src) {
         std::copy(src.begin(), src.end(), std::back_inserter(dest));
     }
+
+    // Returns the `i`th most recently seen peer from a ranked by_time index
+    template <typename Index>
+    const auto& nth_newest(const Index& by_time_index, size_t i) {
+        return *by_time_index.nth(by_time_index.size() - 1 - i);
+    }
 }  // namespace
 
 struct peerlist_join {
@@ -259,17 +265,21 @@ void peerlist_manager::get_peerlist(peerlist_types& peers) {
 
 //--------------------------------------------------------------------------------------------------
 void peerlist_manager::trim_gray_peerlist() {
-    while (m_peers_gray.size() > cryptonote::p2p::LOCAL_GRAY_PEERLIST_LIMIT) {
-        peers_indexed::index<by_time>::type& sorted_index = m_peers_gray.get<by_time>();
-        sorted_index.erase(sorted_index.begin());
-    }
+    if (m_peers_gray.size() <= cryptonote::p2p::LOCAL_GRAY_PEERLIST_LIMIT)
+        return;
+    auto& sorted_index = m_peers_gray.get<by_time>();
+    sorted_index.erase(
+            sorted_index.begin(),
+            sorted_index.nth(m_peers_gray.size() - cryptonote::p2p::LOCAL_GRAY_PEERLIST_LIMIT));
 }
 //--------------------------------------------------------------------------------------------------
 void peerlist_manager::trim_white_peerlist() {
-    while (m_peers_white.size() > cryptonote::p2p::LOCAL_WHITE_PEERLIST_LIMIT) {
-        peers_indexed::index<by_time>::type& sorted_index = m_peers_white.get<by_time>();
-        sorted_index.erase(sorted_index.begin());
-    }
+    if (m_peers_white.size() <= cryptonote::p2p::LOCAL_WHITE_PEERLIST_LIMIT)
+        return;
+    auto& sorted_index = m_peers_white.get<by_time>();
+    sorted_index.erase(
+            sorted_index.begin(),
+            sorted_index.nth(m_peers_white.size() - cryptonote::p2p::LOCAL_WHITE_PEERLIST_LIMIT));
 }
 //--------------------------------------------------------------------------------------------------
 bool peerlist_manager::merge_peerlist(
@@ -290,8 +300,7 @@ bool peerlist_manager::get_white_peer_by_index(peerlist_entry& p, size_t i) {
     if (i >= m_peers_white.size())
         return false;
 
-    peers_indexed::index<by_time>::type& by_time_index = m_peers_white.get<by_time>();
-    p = *std::prev(by_time_index.end(), i + 1);
+    p = nth_newest(m_peers_white.get<by_time>(), i);
     return true;
 }
 //--------------------------------------------------------------------------------------------------
@@ -300,8 +309,7 @@ bool peerlist_manager::get_gray_peer_by_index(peerlist_entry& p, size_t i) {
     if (i >= m_peers_gray.size())
         return false;
 
-    peers_indexed::index<by_time>::type& by_time_index = m_peers_gray.get<by_time>();
-    p = *std::prev(by_time_index.end(), i + 1);
+    p = nth_newest(m_peers_gray.get<by_time>(), i);
     return true;
 }
 //--------------------------------------------------------------------------------------------------
@@ -320,7 +328,6 @@ bool peerlist_manager::get_peerlist_head(
         std::vector<peerlist_entry>& bs_head, bool anonymize, uint32_t depth) {
     std::unique_lock lock{m_peerlist_lock};
     auto& by_time_index = m_peers_white.get<by_time>();
-    uint32_t cnt = 0;
 
     // picks a random set of peers within the whole set, rather pick the first depth elements.
     // The intent is that if someone asks twice, they can't easily tell:
@@ -335,21 +342,26 @@ bool peerlist_manager::get_peerlist_head(
     // See Cao, Tong et al. "Exploring the Monero Peer-to-Peer Network".
     // https://eprint.iacr.org/2019/411
     //
-    const uint32_t pick_depth = anonymize ? m_peers_white.size() : depth;
-    bs_head.reserve(pick_depth);
-    for (auto it = by_time_index.rbegin(); it != by_time_index.rend(); ++it) {
-        if (cnt++ >= pick_depth)
-            break;
-
-        bs_head.push_back(*it);
+    const size_t count = std::min<size_t>(depth, by_time_index.size());
+    bs_head.reserve(bs_head.size() + count);
+    if (!anonymize) {
+        for (auto it = by_time_index.rbegin(); it != std::next(by_time_index.rbegin(), count); ++it)
+            bs_head.push_back(*it);
+        return true;
     }
 
-    if (anonymize) {
-        std::shuffle(bs_head.begin(), bs_head.end(), tools::rng);
-        if (bs_head.size() > depth)
-            bs_head.resize(depth);
-        for (auto& e : bs_head)
-            e.last_seen = 0;
+    // Pick `count` distinct random positions (Floyd's algorithm) and look each of them up rather
+    // than copying and shuffling the whole list.
+    std::vector<size_t> picked;
+    picked.reserve(count);
+    for (size_t j = by_time_index.size() - count; j < by_time_index.size(); j++) {
+        size_t t = crypto::rand_idx(j + 1);
+        picked.push_back(std::find(picked.begin(), picked.end(), t) == picked.end() ? t : j);
+    }
+    std::shuffle(picked.begin(), picked.end(), tools::rng);
+    for (size_t i : picked) {
+        auto& e = bs_head.emplace_back(*by_time_index.nth(i));
+        e.last_seen = 0;
     }
 
     return true;
@@ -456,10 +468,7 @@ bool peerlist_manager::get_random_gray_peer(peerlist_entry& pe) {
         return false;
     }
 
-    size_t random_index = crypto::rand_idx(m_peers_gray.size());
-
-    peers_indexed::index<by_time>::type& by_time_index = m_peers_gray.get<by_time>();
-    pe = *std::prev(by_time_index.end(), random_index + 1);
+    pe = nth_newest(m_peers_gray.get<by_time>(), crypto::rand_idx(m_peers_gray.size()));
 
     return true;
 
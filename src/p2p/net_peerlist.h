@@ -33,6 +33,7 @@
 #include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <iosfwd>
 #include <list>
@@ -166,8 +167,9 @@ class peerlist_manager {
                                     peerlist_entry,
                                     epee::net_utils::network_address,
                                     &peerlist_entry::adr>>,
-                    // sort by peerlist_entry::last_seen<
-                    boost::multi_index::ordered_non_unique<
+                    // sort by peerlist_entry::last_seen; ranked so that the i'th newest peer
+                    // (for by-index and random selection) is found in O(log n)
+                    boost::multi_index::ranked_non_unique<
                             boost::multi_index::tag<by_time>,
                             boost::multi_index::
                                     member<peerlist_entry, int64_t, &peerlist_entry::last_seen>>>>;
@@ -0,0 +1,65 @@
+#include "subnet_trie.h"
+
+#include <algorithm>
+#include <array>
+
+namespace nodetool {
+
+void subnet_trie::insert(const epee::net_utils::ipv4_network_subnet& subnet, time_t expiry) {
+    const uint32_t ip = subnet.subnet();
+    const uint8_t bits = std::min<uint8_t>(subnet.mask(), 32);
+    uint32_t n = 0;
+    for (uint8_t depth = 0; depth < bits; depth++) {
+        auto bit = (ip >> depth) & 1;
+        if (!nodes[n].child[bit]) {
+            uint32_t next;
+            if (!free_nodes.empty()) {
+                next = free_nodes.back();
+                free_nodes.pop_back();
+            } else {
+                next = nodes.size();
+                nodes.emplace_back();
+            }
+            nodes[n].child[bit] = next;
+        }
+        n = nodes[n].child[bit];
+    }
+    if (!nodes[n].expiry)
+        count++;
+    nodes[n].expiry = expiry;
+}
+
+bool subnet_trie::erase(const epee::net_utils::ipv4_network_subnet& subnet) {
+    const uint32_t ip = subnet.subnet();
+    const uint8_t bits = std::min<uint8_t>(subnet.mask(), 32);
+    std::array<uint32_t, 33> path;
+    uint32_t n = 0;
+    path[0] = 0;
+    for (uint8_t depth = 0; depth < bits; depth++) {
+        if (!(n = nodes[n].child[(ip >> depth) & 1]))
+            return false;
+        path[depth + 1] = n;
+    }
+    if (!nodes[n].expiry)
+        return false;
+    nodes[n].expiry.reset();
+    count--;
+
+    // Prune the nodes that no longer lead to anything, from the bottom up
+    for (uint8_t depth = bits; depth > 0; depth--) {
+        auto& nd = nodes[path[depth]];
+        if (nd.expiry || nd.child[0] || nd.child[1])
+            break;
+        nodes[path[depth - 1]].child[(ip >> (depth - 1)) & 1] = 0;
+        free_nodes.push_back(path[depth]);
+    }
+    return true;
+}
+
+void subnet_trie::clear() {
+    nodes.assign(1, node{});
+    free_nodes.clear();
+    count = 0;
+}
+
+}  // namespace nodetool
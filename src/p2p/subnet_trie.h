@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <vector>
+
+#include "epee/net/net_utils_base.h"
+
+namespace nodetool {
+
+/// Index of blocked IPv4 subnets, so that checking an address against a large blocklist doesn't
+/// mean testing every blocked subnet.  This is a binary trie over the prefix bits of the subnets
+/// (in the same bit order that `ipv4_network_subnet` masks them), so a lookup visits at most one
+/// node per prefix bit -- 33 at most -- however many subnets are in it.
+class subnet_trie {
+  public:
+    /// Adds `subnet`, or updates its expiry if it is already present.
+    void insert(const epee::net_utils::ipv4_network_subnet& subnet, time_t expiry);
+
+    /// Removes `subnet`; returns true if it was present.
+    bool erase(const epee::net_utils::ipv4_network_subnet& subnet);
+
+    /// Calls `f(subnet, expiry)` for every subnet containing `ip`, widest subnet first.
+    template <typename F>
+    void for_each_match(uint32_t ip, F&& f) const {
+        uint32_t n = 0;
+        for (uint8_t depth = 0;; depth++) {
+            if (auto& expiry = nodes[n].expiry)
+                f(epee::net_utils::ipv4_network_subnet{ip & prefix_mask(depth), depth}, *expiry);
+            if (depth == 32 || !(n = nodes[n].child[(ip >> depth) & 1]))
+                break;
+        }
+    }
+
+    size_t size() const { return count; }
+
+    void clear();
+
+  private:
+    struct node {
+        // Index of the child for a 0 and 1 next prefix bit; 0 (the root) means none.
+        uint32_t child[2] = {0, 0};
+        // Set if the subnet ending at this node is in the trie
+        std::optional<time_t> expiry;
+    };
+
+    static constexpr uint32_t prefix_mask(uint8_t bits) {
+        return bits >= 32 ? 0xffffffff : (uint32_t{1} << bits) - 1;
+    }
+
+    std::vector<node> nodes{1};
+    std::vector<uint32_t> free_nodes;
+    size_t count = 0;
+};
+
+}  // namespace nodetool
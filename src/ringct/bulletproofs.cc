@@ -34,6 +34,7 @@
 #include <logging/oxen_logger.h>
 #include "epee/span.h"
 #include "common/varint.h"
+#include "common/threadpool.h"
 #include "cryptonote_config.h"
 extern "C"
 {
@@ -48,6 +49,12 @@ extern "C"
 #define STRAUS_SIZE_LIMIT 232
 #define PIPPENGER_SIZE_LIMIT 0
 
+// Proofs covering at least this many bits (i.e. M*N, so 4+ outputs) have the big pieces of the
+// prover spread across the thread pool; below that the threading overhead isn't worth it.
+#define PROVE_THREADED_MIN_MN 256
+// Smallest number of points folded by a single thread pool job
+#define PROVE_FOLD_CHUNK 16
+
 namespace rct
 {
 
@@ -70,7 +77,7 @@ static const rct::key MINUS_INV_EIGHT = { { 0x74, 0xa4, 0x19, 0x7a, 0xf0, 0x7d,
 static const rct::keyV oneN = vector_dup(rct::identity(), maxN);
 static const rct::keyV twoN = vector_powers(TWO, maxN);
 static const rct::key ip12 = inner_product(oneN, twoN);
-static std::mutex init_mutex;
+static std::once_flag init_once;
 
 static inline rct::key multiexp(const std::vector<MultiexpData> &data, size_t HiGi_size)
 {
@@ -100,13 +107,10 @@ static rct::key get_exponent(const rct::key &base, size_t idx)
   return e;
 }
 
-static void init_exponents()
+// Builds the generators and their straus/pippenger caches, which are shared (read only) by every
+// thread proving or verifying from then on.  Sized for the largest aggregated proof we allow.
+static void init_exponents_once()
 {
-  std::lock_guard lock{init_mutex};
-
-  static bool init_done = false;
-  if (init_done)
-    return;
   std::vector<MultiexpData> data;
   data.reserve(maxN*maxM*2);
   for (size_t i = 0; i < maxN*maxM; ++i)
@@ -128,8 +132,13 @@ static void init_exponents()
   //MINFO("Straus cache size: " << straus_get_cache_size(straus_HiGi_cache)/1024 << " kB");
   //MINFO("Pippenger cache size: " << pippenger_get_cache_size(pippenger_HiGi_cache)/1024 << " kB");
   size_t cache_size = (sizeof(Hi)+sizeof(Hi_p3))*2 + straus_get_cache_size(straus_HiGi_cache) + pippenger_get_cache_size(pippenger_HiGi_cache);
-  //MINFO("Total cache size: " << cache_size/1024 << "kB");
-  init_done = true;
+  log::debug(logcat, "Bulletproof generator cache size: {} kB", cache_size / 1024);
+}
+
+// Called at the start of every prove and verify, so is lock-free once the caches are built
+static void init_exponents()
+{
+  std::call_once(init_once, init_exponents_once);
 }
 
 /* Given two scalar arrays, construct a vector commitment */
@@ -259,11 +268,50 @@ static rct::keyV hadamard(const rct::keyV &a, const rct::keyV &b)
 }
 
 /* folds a curvepoint array using a two way scaled Hadamard product */
-static void hadamard_fold(std::vector<ge_p3> &v, const rct::keyV *scale, const rct::key &a, const rct::key &b)
+/* Runs a set of prover jobs on the thread pool, rethrowing the first exception any of them threw */
+class prove_jobs
+{
+public:
+  template <typename F>
+  void add(F f)
+  {
+    tpool.submit(&waiter, [this, f = std::move(f)] {
+      try { f(); }
+      catch (...)
+      {
+        std::lock_guard lock{error_mutex};
+        if (!error)
+          error = std::current_exception();
+      }
+    });
+  }
+
+  void wait()
+  {
+    waiter.wait(&tpool);
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  /* Splits [0, n) into roughly one chunk per thread (but no smaller than PROVE_FOLD_CHUNK) */
+  size_t chunk_size(size_t n) const
+  {
+    const size_t threads = std::max<size_t>(1, tpool.get_max_concurrency());
+    return std::max<size_t>(PROVE_FOLD_CHUNK, (n + threads - 1) / threads);
+  }
+
+private:
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+/* Folds v[begin, end) with the upper half of v; see hadamard_fold */
+static void hadamard_fold_range(std::vector<ge_p3> &v, const rct::keyV *scale, const rct::key &a, const rct::key &b, size_t begin, size_t end)
 {
-  CHECK_AND_ASSERT_THROW_MES((v.size() & 1) == 0, "Vector size should be even");
   const size_t sz = v.size() / 2;
-  for (size_t n = 0; n < sz; ++n)
+  for (size_t n = begin; n < end; ++n)
   {
     ge_dsmp c[2];
     ge_dsm_precomp(c[0], &v[n]);
@@ -273,6 +321,24 @@ static void hadamard_fold(std::vector<ge_p3> &v, const rct::keyV *scale, const r
     if (scale) sc_mul(sb.bytes, b.bytes, (*scale)[sz + n].bytes); else sb = b;
     ge_double_scalarmult_precomp_vartime2_p3(&v[n], sa.bytes, c[0], sb.bytes, c[1]);
   }
+}
+
+static void hadamard_fold(std::vector<ge_p3> &v, const rct::keyV *scale, const rct::key &a, const rct::key &b, prove_jobs *jobs = NULL)
+{
+  CHECK_AND_ASSERT_THROW_MES((v.size() & 1) == 0, "Vector size should be even");
+  const size_t sz = v.size() / 2;
+  if (jobs)
+  {
+    // Each point only depends on itself and its partner in the upper half, so the chunks are
+    // independent; the caller waits on the jobs and then shrinks the vector.
+    const size_t chunk = jobs->chunk_size(sz);
+    for (size_t begin = 0; begin < sz; begin += chunk)
+      jobs->add([&v, scale, &a, &b, begin, end = std::min(begin + chunk, sz)] {
+        hadamard_fold_range(v, scale, a, b, begin, end);
+      });
+    return;
+  }
+  hadamard_fold_range(v, scale, a, b, 0, sz);
   v.resize(sz);
 }
 
@@ -494,6 +560,7 @@ Bulletproof bulletproof_PROVE(const rct::keyV &sv, const rct::keyV &gamma)
   CHECK_AND_ASSERT_THROW_MES(M <= maxM, "sv/gamma are too large");
   const size_t logMN = logM + logN;
   const size_t MN = M * N;
+  const bool threaded = MN >= PROVE_THREADED_MIN_MN;
 
   rct::keyV V(sv.size());
   rct::keyV aL(MN), aR(MN);
@@ -553,17 +620,28 @@ try_again:
 
   // PAPER LINES 43-44
   rct::key alpha = rct::skGen();
-  rct::key ve = vector_exponent(aL8, aR8);
+  rct::keyV sL = rct::skvGen(MN), sR = rct::skvGen(MN);
+  rct::key rho = rct::skGen();
+  rct::key veA, veS;
+  if (threaded)
+  {
+    prove_jobs jobs;
+    jobs.add([&] { veS = vector_exponent(sL, sR); });
+    veA = vector_exponent(aL8, aR8);
+    jobs.wait();
+  }
+  else
+  {
+    veA = vector_exponent(aL8, aR8);
+    veS = vector_exponent(sL, sR);
+  }
   rct::key A;
   sc_mul(tmp.bytes, alpha.bytes, INV_EIGHT.bytes);
-  rct::addKeys(A, ve, rct::scalarmultBase(tmp));
+  rct::addKeys(A, veA, rct::scalarmultBase(tmp));
 
   // PAPER LINES 45-47
-  rct::keyV sL = rct::skvGen(MN), sR = rct::skvGen(MN);
-  rct::key rho = rct::skGen();
-  ve = vector_exponent(sL, sR);
   rct::key S;
-  rct::addKeys(S, ve, rct::scalarmultBase(rho));
+  rct::addKeys(S, veS, rct::scalarmultBase(rho));
   S = rct::scalarmultKey(S, INV_EIGHT);
 
   // PAPER LINES 48-50
@@ -707,10 +785,21 @@ try_again:
     rct::key cR = inner_product(slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime));
 
     // PAPER LINES 23-24
-    sc_mul(tmp.bytes, cL.bytes, x_ip.bytes);
-    L[round] = cross_vector_exponent8(nprime, Gprime, nprime, Hprime, 0, aprime, 0, bprime, nprime, scale, &ge_p3_H, &tmp);
-    sc_mul(tmp.bytes, cR.bytes, x_ip.bytes);
-    R[round] = cross_vector_exponent8(nprime, Gprime, 0, Hprime, nprime, aprime, nprime, bprime, 0, scale, &ge_p3_H, &tmp);
+    rct::key cLx, cRx;
+    sc_mul(cLx.bytes, cL.bytes, x_ip.bytes);
+    sc_mul(cRx.bytes, cR.bytes, x_ip.bytes);
+    if (threaded && nprime >= PROVE_FOLD_CHUNK)
+    {
+      prove_jobs jobs;
+      jobs.add([&] { R[round] = cross_vector_exponent8(nprime, Gprime, 0, Hprime, nprime, aprime, nprime, bprime, 0, scale, &ge_p3_H, &cRx); });
+      L[round] = cross_vector_exponent8(nprime, Gprime, nprime, Hprime, 0, aprime, 0, bprime, nprime, scale, &ge_p3_H, &cLx);
+      jobs.wait();
+    }
+    else
+    {
+      L[round] = cross_vector_exponent8(nprime, Gprime, nprime, Hprime, 0, aprime, 0, bprime, nprime, scale, &ge_p3_H, &cLx);
+      R[round] = cross_vector_exponent8(nprime, Gprime, 0, Hprime, nprime, aprime, nprime, bprime, 0, scale, &ge_p3_H, &cRx);
+    }
 
     // PAPER LINES 25-27
     w[round] = hash_cache_mash(hash_cache, L[round], R[round]);
@@ -724,8 +813,20 @@ try_again:
     const rct::key winv = invert(w[round]);
     if (nprime > 1)
     {
-      hadamard_fold(Gprime, NULL, winv, w[round]);
-      hadamard_fold(Hprime, scale, w[round], winv);
+      if (threaded && nprime >= PROVE_FOLD_CHUNK)
+      {
+        prove_jobs jobs;
+        hadamard_fold(Gprime, NULL, winv, w[round], &jobs);
+        hadamard_fold(Hprime, scale, w[round], winv, &jobs);
+        jobs.wait();
+        Gprime.resize(nprime);
+        Hprime.resize(nprime);
+      }
+      else
+      {
+        hadamard_fold(Gprime, NULL, winv, w[round]);
+        hadamard_fold(Hprime, scale, w[round], winv);
+      }
     }
 
     // PAPER LINES 33-34
@@ -130,10 +130,16 @@ static inline rct::key pow2(size_t n)
   return res;
 }
 
-static inline int test(const rct::key &k, size_t n)
+// Returns the c-bit window of k starting at bit n (bits past the end of k read as 0).  c can be at
+// most 9, so the window never spans more than two bytes.
+static inline unsigned int get_window(const rct::key &k, size_t n, size_t c)
 {
   if (n >= 256) return 0;
-  return k[n >> 3] & (1 << (n & 7));
+  const size_t byte = n >> 3;
+  unsigned int w = k.bytes[byte];
+  if (byte < 31)
+    w |= (unsigned int)k.bytes[byte + 1] << 8;
+  return (w >> (n & 7)) & ((1u << c) - 1);
 }
 
 static inline void add(ge_p3 &p3, const ge_cached &other)
@@ -396,7 +402,10 @@ rct::key straus(const std::vector<MultiexpData> &data, const std::shared_ptr<str
   STEP = STEP ? STEP : 192;
 
   static constexpr unsigned int mask = (1<<STRAUS_C)-1;
-  std::shared_ptr<straus_cached_data> local_cache = cache == NULL ? straus_init_cache(data) : cache;
+  // A passed-in cache is usually the process-wide generator cache that every verifying thread
+  // shares, so we use it through a plain pointer rather than bumping its (contended) refcount.
+  const std::shared_ptr<straus_cached_data> own_cache = cache == NULL ? straus_init_cache(data) : NULL;
+  const straus_cached_data *local_cache = cache == NULL ? own_cache.get() : cache.get();
   ge_cached cached;
   ge_p1p1 p1;
   ge_p3 p3;
@@ -556,7 +565,9 @@ rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<
   bool result_init = false;
   std::unique_ptr<ge_p3[]> buckets{new ge_p3[1<<c]};
   bool buckets_init[1<<9];
-  std::shared_ptr<pippenger_cached_data> local_cache = cache == NULL ? pippenger_init_cache(data) : cache;
+  // See straus() as to the plain pointer
+  const std::shared_ptr<pippenger_cached_data> own_cache = cache == NULL ? pippenger_init_cache(data) : NULL;
+  const pippenger_cached_data *local_cache = cache == NULL ? own_cache.get() : cache.get();
   std::shared_ptr<pippenger_cached_data> local_cache_2 = data.size() > cache_size ? pippenger_init_cache(data, cache_size) : NULL;
 
   rct::key maxscalar = rct::zero();
@@ -591,10 +602,7 @@ rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<
     // partition scalars into buckets
     for (size_t i = 0; i < data.size(); ++i)
     {
-      unsigned int bucket = 0;
-      for (size_t j = 0; j < c; ++j)
-        if (test(data[i].scalar, k*c+j))
-          bucket |= 1<<j;
+      const unsigned int bucket = get_window(data[i].scalar, k*c, c);
       if (bucket == 0)
         continue;
       CHECK_AND_ASSERT_THROW_MES(bucket < (1u<<c), "bucket overflow");
@@ -30,7 +30,13 @@
 
 #include "rctSigs.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
 #include "bulletproofs.h"
+#include "common/exception.h"
 #include "common/threadpool.h"
 #include "common/util.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
@@ -40,6 +46,16 @@
 namespace rct {
 static auto logcat = log::Cat("ringct");
 
+// Past this, bigger multiexps save little per proof but need ever larger pippenger caches
+constexpr size_t DEFAULT_BULLETPROOF_BATCH_SIZE = 64;
+// Don't split proof sets into batches smaller than this just to keep more threads busy: the
+// per-batch overhead would eat up what the extra threads get us.
+constexpr size_t MIN_BULLETPROOF_BATCH_SIZE = 4;
+static std::atomic<size_t> bulletproof_batch_size{DEFAULT_BULLETPROOF_BATCH_SIZE};
+// decodeRctBatch checks commitments on the thread pool, this many per job, once it has more than
+// this many outputs.
+constexpr size_t DECODE_BATCH_SIZE = 16;
+
 static rct::Bulletproof make_dummy_bulletproof(
         const std::vector<uint64_t>& outamounts, rct::keyV& C, rct::keyV& masks) {
     const size_t n_outs = outamounts.size();
@@ -108,6 +124,75 @@ bool verBulletproof(const std::vector<const Bulletproof*>& proofs) {
     }
 }
 
+void set_bulletproof_batch_size(size_t max_proofs) {
+    bulletproof_batch_size = max_proofs ? max_proofs : DEFAULT_BULLETPROOF_BATCH_SIZE;
+}
+
+size_t get_bulletproof_batch_size() {
+    return bulletproof_batch_size;
+}
+
+// Verifies the proofs in batches as per the bulletproof batch size, in parallel on the thread pool
+static bool verBulletproofBatched(const std::vector<const Bulletproof*>& proofs) {
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    const size_t threads = std::max<size_t>(tpool.get_max_concurrency(), 1);
+    const size_t max_batch = bulletproof_batch_size;
+    const size_t batch = std::min(
+            max_batch,
+            std::max(MIN_BULLETPROOF_BATCH_SIZE, (proofs.size() + threads - 1) / threads));
+    if (proofs.size() <= batch)
+        return verBulletproof(proofs);
+
+    const size_t num_batches = (proofs.size() + batch - 1) / batch;
+    std::unique_ptr<bool[]> results{new bool[num_batches]};
+    tools::threadpool::waiter waiter;
+    for (size_t i = 0; i < num_batches; i++)
+        tpool.submit(
+                &waiter,
+                [&, i] {
+                    auto begin = proofs.begin() + i * batch;
+                    auto end = i + 1 == num_batches ? proofs.end() : begin + batch;
+                    results[i] = verBulletproof(std::vector<const Bulletproof*>(begin, end));
+                },
+                "rct_bp_batch",
+                true);
+    waiter.wait(&tpool);
+    return std::all_of(results.get(), results.get() + num_batches, [](bool r) { return r; });
+}
+
+size_t tune_bulletproof_batch_size() {
+    constexpr size_t MAX_TUNED_BATCH_SIZE = 256;
+    // Worth doubling the batch size only if it takes at least this much off the per-proof time
+    constexpr double MIN_SPEEDUP = 0.9;
+
+    // A two output proof, as in the vast majority of txes; verifying the same proof over and over
+    // costs the same as verifying different ones.
+    const Bulletproof proof = bulletproof_PROVE(std::vector<uint64_t>{1, 2}, {skGen(), skGen()});
+    auto per_proof_time = [&proof](size_t n) {
+        std::vector<const Bulletproof*> proofs(n, &proof);
+        auto best = std::chrono::steady_clock::duration::max();
+        for (int i = 0; i < 2; i++) {
+            auto start = std::chrono::steady_clock::now();
+            if (!bulletproof_VERIFY(proofs))
+                throw oxen::traced<std::runtime_error>{"bulletproof batch verification failed"};
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        return std::chrono::duration<double>(best).count() / n;
+    };
+
+    size_t best = MIN_BULLETPROOF_BATCH_SIZE;
+    double best_time = per_proof_time(best);
+    for (size_t n = best * 2; n <= MAX_TUNED_BATCH_SIZE; n *= 2) {
+        double t = per_proof_time(n);
+        log::debug(logcat, "Bulletproof batch of {}: {:.3f}ms per proof", n, t * 1000);
+        if (t > best_time * MIN_SPEEDUP)
+            break;
+        best = n;
+        best_time = t;
+    }
+    return best;
+}
+
 // Borromean (c.f. gmax/andytoshi's paper)
 bool verifyBorromean(const boroSig& bb, const ge_p3 P1[64], const ge_p3 P2[64]) {
     key64 Lv1;
@@ -1030,9 +1115,10 @@ bool verRct(const rctSig& rv, bool semantics) {
             std::deque<bool> results(rv.outPk.size(), false);
             DP("range proofs verified?");
             for (size_t i = 0; i < rv.outPk.size(); i++)
-                tpool.submit(&waiter, [&, i] {
-                    results[i] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]);
-                });
+                tpool.submit(
+                        &waiter,
+                        [&, i] { results[i] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]); },
+                        "rct_range_proof");
             waiter.wait(&tpool);
 
             for (size_t i = 0; i < results.size(); ++i) {
@@ -1160,13 +1246,17 @@ bool verRctSemanticsSimple(const std::vector<const rctSig*>& rvv) {
                     proofs.push_back(&rv.p.bulletproofs[i]);
             } else {
                 for (size_t i = 0; i < rv.p.rangeSigs.size(); i++)
-                    tpool.submit(&waiter, [&, i, offset] {
-                        results[i + offset] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]);
-                    });
+                    tpool.submit(
+                            &waiter,
+                            [&, i, offset] {
+                                results[i + offset] =
+                                        verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]);
+                            },
+                            "rct_range_proof");
                 offset += rv.p.rangeSigs.size();
             }
         }
-        if (!proofs.empty() && !verBulletproof(proofs)) {
+        if (!proofs.empty() && !verBulletproofBatched(proofs)) {
             log::info(logcat, "Aggregate range proof verified failed");
             return false;
         }
@@ -1198,65 +1288,128 @@ bool verRctSemanticsSimple(const rctSig& rv) {
 // ver RingCT simple
 // assumes only post-rct style inputs (at least for max anonymity)
 bool verRctNonSemanticsSimple(const rctSig& rv) {
-    try {
+    std::vector<bool> results;
+    return verRctNonSemanticsSimple(std::vector<const rctSig*>(1, &rv), results);
+}
 
-        CHECK_AND_ASSERT_MES(
-                rct::is_rct_simple(rv.type),
-                false,
-                "verRctNonSemanticsSimple called on non simple rctSig");
-        const bool bulletproof = is_rct_bulletproof(rv.type);
+// Batched version: computes the pre-clsag hashes and then verifies every CLSAG/MLSAG of every
+// rctSig in one thread pool fan-out.  A malformed or failing rctSig only fails its own result.
+bool verRctNonSemanticsSimple(const std::vector<const rctSig*>& rvv, std::vector<bool>& results) {
+    results.assign(rvv.size(), false);
+
+    // Basic structure checks; anything failing these isn't submitted for verification at all.
+    std::deque<bool> ok(rvv.size(), false);
+    size_t total_inputs = 0;
+    for (size_t t = 0; t < rvv.size(); ++t) {
+        const rctSig* rvp = rvv[t];
+        if (!rvp) {
+            log::info(logcat, "rctSig pointer is NULL");
+            continue;
+        }
+        const rctSig& rv = *rvp;
+        if (!rct::is_rct_simple(rv.type)) {
+            log::info(logcat, "verRctNonSemanticsSimple called on non simple rctSig");
+            continue;
+        }
         // semantics check is early, and mixRing/MGs aren't resolved yet
-        if (bulletproof)
-            CHECK_AND_ASSERT_MES(
-                    rv.p.pseudoOuts.size() == rv.mixRing.size(),
-                    false,
-                    "Mismatched sizes of rv.p.pseudoOuts and mixRing");
-        else
-            CHECK_AND_ASSERT_MES(
-                    rv.pseudoOuts.size() == rv.mixRing.size(),
-                    false,
-                    "Mismatched sizes of rv.pseudoOuts and mixRing");
-
-        const size_t threads = std::max(rv.outPk.size(), rv.mixRing.size());
-
-        std::deque<bool> results(threads);
-        tools::threadpool& tpool = tools::threadpool::getInstance();
-        tools::threadpool::waiter waiter;
-
+        const bool bulletproof = is_rct_bulletproof(rv.type);
         const keyV& pseudoOuts = bulletproof ? rv.p.pseudoOuts : rv.pseudoOuts;
+        if (pseudoOuts.size() != rv.mixRing.size()) {
+            log::info(
+                    logcat,
+                    "Mismatched sizes of {} and mixRing",
+                    bulletproof ? "rv.p.pseudoOuts" : "rv.pseudoOuts");
+            continue;
+        }
+        const size_t nsigs = rv.type == RCTType::CLSAG ? rv.p.CLSAGs.size() : rv.p.MGs.size();
+        if (nsigs < rv.mixRing.size()) {
+            log::info(logcat, "Mismatched sizes of signatures and mixRing");
+            continue;
+        }
+        ok[t] = true;
+        total_inputs += rv.mixRing.size();
+    }
 
-        const key message = get_pre_clsag_hash(rv, hw::get_device("default"));
-
-        results.clear();
-        results.resize(rv.mixRing.size());
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+
+    std::vector<key> messages(rvv.size());
+    for (size_t t = 0; t < rvv.size(); ++t) {
+        if (!ok[t])
+            continue;
+        tpool.submit(
+                &waiter,
+                [&, t] {
+                    try {
+                        messages[t] = get_pre_clsag_hash(*rvv[t], hw::get_device("default"));
+                    } catch (const std::exception& e) {
+                        log::info(logcat, "Error in verRctNonSemanticsSimple: {}", e.what());
+                        ok[t] = false;
+                    } catch (...) {
+                        log::info(
+                                logcat,
+                                "Error in verRctNonSemanticsSimple, but not an actual exception");
+                        ok[t] = false;
+                    }
+                },
+                "rct_message_hash");
+    }
+    waiter.wait(&tpool);
+
+    std::deque<bool> input_results(total_inputs, false);
+    size_t offset = 0;
+    for (size_t t = 0; t < rvv.size(); ++t) {
+        if (!ok[t])
+            continue;
+        const rctSig& rv = *rvv[t];
+        const keyV& pseudoOuts = is_rct_bulletproof(rv.type) ? rv.p.pseudoOuts : rv.pseudoOuts;
         for (size_t i = 0; i < rv.mixRing.size(); i++) {
-            tpool.submit(&waiter, [&, i] {
-                if (rv.type == RCTType::CLSAG)
-                    results[i] = verRctCLSAGSimple(
-                            message, rv.p.CLSAGs[i], rv.mixRing[i], pseudoOuts[i]);
-                else
-                    results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
-            });
+            tpool.submit(
+                    &waiter,
+                    [&, t, i, offset] {
+                        // we can get deep throws from ge_frombytes_vartime if input isn't valid
+                        try {
+                            if (rv.type == RCTType::CLSAG)
+                                input_results[offset + i] = verRctCLSAGSimple(
+                                        messages[t], rv.p.CLSAGs[i], rv.mixRing[i], pseudoOuts[i]);
+                            else
+                                input_results[offset + i] = verRctMGSimple(
+                                        messages[t], rv.p.MGs[i], rv.mixRing[i], pseudoOuts[i]);
+                        } catch (const std::exception& e) {
+                            log::info(logcat, "Error in verRctNonSemanticsSimple: {}", e.what());
+                        } catch (...) {
+                            log::info(
+                                    logcat,
+                                    "Error in verRctNonSemanticsSimple, but not an actual "
+                                    "exception");
+                        }
+                    },
+                    "rct_ring_signature");
         }
-        waiter.wait(&tpool);
-
-        for (size_t i = 0; i < results.size(); ++i) {
-            if (!results[i]) {
-                log::info(logcat, "verRctMGSimple/verRctCLSAGSimple failed for input {}", i);
-                return false;
+        offset += rv.mixRing.size();
+    }
+    waiter.wait(&tpool);
+
+    bool all = true;
+    offset = 0;
+    for (size_t t = 0; t < rvv.size(); ++t) {
+        if (ok[t]) {
+            const size_t n = rvv[t]->mixRing.size();
+            bool good = true;
+            for (size_t i = 0; i < n; ++i) {
+                if (!input_results[offset + i]) {
+                    log::info(logcat, "verRctMGSimple/verRctCLSAGSimple failed for input {}", i);
+                    good = false;
+                    break;
+                }
             }
+            offset += n;
+            results[t] = good;
         }
-
-        return true;
-    }
-    // we can get deep throws from ge_frombytes_vartime if input isn't valid
-    catch (const std::exception& e) {
-        log::info(logcat, "Error in verRctNonSemanticsSimple: {}", e.what());
-        return false;
-    } catch (...) {
-        log::info(logcat, "Error in verRctNonSemanticsSimple, but not an actual exception");
-        return false;
+        all = all && results[t];
     }
+
+    return all;
 }
 
 // RingCT protocol
@@ -1266,6 +1419,33 @@ bool verRctNonSemanticsSimple(const rctSig& rv) {
 //    Also contains masked "amount" and "mask" so the receiver can see how much they received
 // verRct:
 //    verifies that all signatures (rangeProogs, MG sig, sum inputs = outputs) are correct
+// mask*G + amount*H: the commitment an output with a decoded mask and amount must have.  This is
+// addKeys2(C, mask, amount, H), but faster for the amounts real outputs have (which fit in 64
+// bits): mask*G uses the fixed-base table, and amount*H (against a precomputed table for H) only
+// needs as many doublings as the amount has bits, rather than one per bit of the mask.
+static key amount_commitment(const key& mask, const key& amount) {
+    static const geDsmp H_table = [] {
+        geDsmp table;
+        precomp(table.k, H);
+        return table;
+    }();
+    ge_p3 C_p3;
+    ge_scalarmult_base(&C_p3, mask.bytes);
+    if (!equalKeys(amount, zero())) {
+        ge_p3 aH;
+        ge_double_scalarmult_precomp_vartime2_p3(
+                &aH, amount.bytes, H_table.k, zero().bytes, H_table.k);
+        ge_cached aH_cached;
+        ge_p3_to_cached(&aH_cached, &aH);
+        ge_p1p1 sum;
+        ge_add(&sum, &C_p3, &aH_cached);
+        ge_p1p1_to_p3(&C_p3, &sum);
+    }
+    key C;
+    ge_p3_tobytes(C.bytes, &C_p3);
+    return C;
+}
+
 // decodeRct: (c.f. https://eprint.iacr.org/2015/1098 section 5.1.1)
 //    uses the attached ecdh info to find the amounts represented by each output commitment
 //    must know the destination private key to find the correct amount, else will return a random
@@ -1288,7 +1468,7 @@ xmr_amount decodeRct(
     key Ctmp;
     CHECK_AND_ASSERT_THROW_MES(sc_check(mask.bytes) == 0, "warning, bad ECDH mask");
     CHECK_AND_ASSERT_THROW_MES(sc_check(amount.bytes) == 0, "warning, bad ECDH amount");
-    addKeys2(Ctmp, mask, amount, H);
+    Ctmp = amount_commitment(mask, amount);
     DP("Ctmp");
     DP(Ctmp);
     if (equalKeys(C, Ctmp) == false) {
@@ -1322,7 +1502,7 @@ xmr_amount decodeRctSimple(
     key Ctmp;
     CHECK_AND_ASSERT_THROW_MES(sc_check(mask.bytes) == 0, "warning, bad ECDH mask");
     CHECK_AND_ASSERT_THROW_MES(sc_check(amount.bytes) == 0, "warning, bad ECDH amount");
-    addKeys2(Ctmp, mask, amount, H);
+    Ctmp = amount_commitment(mask, amount);
     DP("Ctmp");
     DP(Ctmp);
     if (equalKeys(C, Ctmp) == false) {
@@ -1337,6 +1517,54 @@ xmr_amount decodeRctSimple(const rctSig& rv, const key& sk, unsigned int i, hw::
     return decodeRctSimple(rv, sk, i, mask, hwdev);
 }
 
+std::vector<std::optional<std::pair<xmr_amount, key>>> decodeRctBatch(
+        const rctSig& rv,
+        const std::vector<std::pair<unsigned int, key>>& outputs,
+        hw::device& hwdev) {
+    CHECK_AND_ASSERT_THROW_MES(
+            rv.type == RCTType::Full || rct::is_rct_simple(rv.type),
+            "decodeRctBatch called on unsupported rct type");
+    CHECK_AND_ASSERT_THROW_MES(
+            rv.outPk.size() == rv.ecdhInfo.size(), "Mismatched sizes of rv.outPk and rv.ecdhInfo");
+    const bool v2 = rv.type == RCTType::Bulletproof2 || rv.type == RCTType::CLSAG;
+
+    // The ecdh decoding goes through the device, so stays on this thread; only the commitment
+    // checks (the expensive part) go to the thread pool.
+    std::vector<ecdhTuple> decoded(outputs.size());
+    for (size_t j = 0; j < outputs.size(); j++) {
+        const auto& [i, sk] = outputs[j];
+        CHECK_AND_ASSERT_THROW_MES(i < rv.ecdhInfo.size(), "Bad index");
+        decoded[j] = rv.ecdhInfo[i];
+        hwdev.ecdhDecode(decoded[j], sk, v2);
+    }
+
+    std::vector<std::optional<std::pair<xmr_amount, key>>> results(outputs.size());
+    auto check = [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; j++) {
+            const auto& [mask, amount] = decoded[j];
+            if (sc_check(mask.bytes) != 0 || sc_check(amount.bytes) != 0)
+                continue;
+            if (equalKeys(rv.outPk[outputs[j].first].mask, amount_commitment(mask, amount)))
+                results[j].emplace(h2d(amount), mask);
+        }
+    };
+    if (outputs.size() <= DECODE_BATCH_SIZE) {
+        check(0, outputs.size());
+    } else {
+        tools::threadpool& tpool = tools::threadpool::getInstance();
+        tools::threadpool::waiter waiter;
+        for (size_t begin = 0; begin < outputs.size(); begin += DECODE_BATCH_SIZE)
+            tpool.submit(
+                    &waiter,
+                    [&, begin] {
+                        check(begin, std::min(begin + DECODE_BATCH_SIZE, outputs.size()));
+                    },
+                    "rct_decode");
+        waiter.wait(&tpool);
+    }
+    return results;
+}
+
 bool signMultisigMLSAG(
         rctSig& rv,
         const std::vector<unsigned int>& indices,
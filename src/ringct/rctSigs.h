@@ -33,6 +33,7 @@
 // #define DBG
 
 #include <cstddef>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -180,7 +181,20 @@ inline bool verRct(const rctSig& rv) {
 }
 bool verRctSemanticsSimple(const rctSig& rv);
 bool verRctSemanticsSimple(const std::vector<const rctSig*>& rv);
+// The most bulletproofs that verRctSemanticsSimple verifies together in a single multiexp.  Larger
+// proof sets are split into batches of at most this many (and smaller still when needed to give
+// every thread pool thread a batch), which are verified in parallel.  0 restores the default.
+void set_bulletproof_batch_size(size_t max_proofs);
+size_t get_bulletproof_batch_size();
+// Times batch verification of bulletproofs at doubling batch sizes on this machine and returns
+// the largest size that still gave a worthwhile per-proof speedup over half of it; taking a
+// fraction of a second, this is meant to be run once and its result kept.
+size_t tune_bulletproof_batch_size();
 bool verRctNonSemanticsSimple(const rctSig& rv);
+// Verifies the CLSAGs/MLSAGs of many rctSigs (e.g. all the txes of a block span) at once, sharing a
+// single thread pool fan-out.  `results` is set to the per-rctSig outcome (in the same order as
+// `rv`); returns true only if all of them verified.
+bool verRctNonSemanticsSimple(const std::vector<const rctSig*>& rv, std::vector<bool>& results);
 inline bool verRctSimple(const rctSig& rv) {
     return verRctSemanticsSimple(rv) && verRctNonSemanticsSimple(rv);
 }
@@ -189,6 +203,15 @@ xmr_amount decodeRct(const rctSig& rv, const key& sk, unsigned int i, hw::device
 xmr_amount decodeRctSimple(
         const rctSig& rv, const key& sk, unsigned int i, key& mask, hw::device& hwdev);
 xmr_amount decodeRctSimple(const rctSig& rv, const key& sk, unsigned int i, hw::device& hwdev);
+// Decodes several outputs of one tx at once, with decodeRct or decodeRctSimple's rules as `rv.type`
+// requires: `outputs` are output indices and their amount keys (the `sk` the single versions
+// take).  Returns the amount and mask of each, in the same order, or nullopt for an output that
+// doesn't decode to its commitment (i.e. where the single versions would throw).  Large batches
+// have their commitments checked on the thread pool.
+std::vector<std::optional<std::pair<xmr_amount, key>>> decodeRctBatch(
+        const rctSig& rv,
+        const std::vector<std::pair<unsigned int, key>>& outputs,
+        hw::device& hwdev);
 key get_pre_clsag_hash(const rctSig& rv, hw::device& hwdev);
 bool signMultisig(
         rctSig& rv,
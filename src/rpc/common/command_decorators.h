@@ -68,6 +68,12 @@ struct RPC_COMMAND {
     ///   std::string data = "abc";
     ///   rpc.response_b64["foo"]["bar"] = data; // json: "YWJj", bt: "abc"
     tools::json_binary_proxy response_b64{response, tools::json_binary_proxy::fmt::base64};
+
+    /// Already-encoded json response.  Commands with large responses can write their response
+    /// straight into this (typically with a tools::json_writer) rather than building up
+    /// `response`: if non-empty, this is returned as-is and `response` is ignored.  Only for json
+    /// requests: when `is_bt()` the command must still fill `response`.
+    std::string response_json;
 };
 
 /// Tag types that are used (via inheritance) to set rpc endpoint properties
@@ -91,4 +97,13 @@ struct NO_ARGS : virtual RPC_COMMAND {};
 /// if specified).
 struct LEGACY : virtual RPC_COMMAND {};
 
+/// Specifies that, for a given request and requester (admin or not), the command's response only
+/// changes when the blockchain tip changes, and so the encoded response can be cached and reused
+/// until then (or for at most response_cache::MAX_AGE, which bounds how stale any incidental
+/// values in the response can get).
+struct CACHE_PER_TIP : virtual RPC_COMMAND {};
+
+/// Like CACHE_PER_TIP, but for commands whose response also depends on the txpool contents.
+struct CACHE_PER_TXPOOL : virtual CACHE_PER_TIP {};
+
 }  // namespace cryptonote::rpc
@@ -94,13 +94,18 @@ void http_server_base::jsonrpc_error_response(
     res.writeHeader("Content-Type", "application/json");
     if (m_closing)
         res.writeHeader("Connection", "close");
+    res.end(jsonrpc_error(code, std::move(message), std::move(id), error_data));
+    if (m_closing)
+        res.close();
+}
+
+std::string http_server_base::jsonrpc_error(
+        int code, std::string message, nlohmann::json id, nlohmann::json* error_data) {
     nlohmann::json error{{"code", code}, {"message", std::move(message)}};
     if (error_data)
         error["data"] = std::move(*error_data);
-    res.end(nlohmann::json{{"jsonrpc", "2.0"}, {"id", std::move(id)}, {"error", std::move(error)}}
-                    .dump());
-    if (m_closing)
-        res.close();
+    return nlohmann::json{{"jsonrpc", "2.0"}, {"id", std::move(id)}, {"error", std::move(error)}}
+            .dump();
 }
 
 std::string http_server_base::get_remote_address(HttpResponse& res) {
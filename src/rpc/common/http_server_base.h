@@ -2,6 +2,7 @@
 
 #include <uWebSockets/App.h>
 
+#include <atomic>
 #include <future>
 #include <nlohmann/json_fwd.hpp>
 #include <unordered_set>
@@ -45,6 +46,10 @@ class http_server_base {
             nlohmann::json id,
             nlohmann::json* error_data = nullptr) const;
 
+    // Returns the JSON RPC error object body that jsonrpc_error_response sends.
+    static std::string jsonrpc_error(
+            int code, std::string message, nlohmann::json id, nlohmann::json* error_data = nullptr);
+
     // Posts a callback to the uWebSockets thread loop controlling this connection; all writes must
     // be done from that thread, and so this method is provided to defer a callback from another
     // thread into that one.  The function should have signature `void ()`.
@@ -85,8 +90,8 @@ class http_server_base {
     // we return it in the ACAO header; otherwise (or if this is empty) we omit the header entirely.
     std::unordered_set<std::string> m_cors;
     // Will be set to true when we're trying to shut down which closes any connections as we reply
-    // to them.  Should only be read/write from inside the uWS loop.
-    bool m_closing = false;
+    // to them.
+    std::atomic<bool> m_closing = false;
     // If true then always reply with 'Access-Control-Allow-Origin: *' to allow anything.
     bool m_cors_any = false;
 };
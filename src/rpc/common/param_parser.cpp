@@ -0,0 +1,113 @@
+#include "param_parser.hpp"
+
+namespace cryptonote::rpc {
+
+void throw_invalid_json_value(std::string_view name, std::string_view problem) {
+    throw oxen::traced<std::domain_error>{
+            "Invalid value for '" + std::string{name} + "': " + std::string{problem}};
+}
+
+namespace {
+
+    // Walks the json events, handing the values of the keys we want to their targets as they go
+    // by.  Anything else is skipped without being stored anywhere.
+    class json_body_loader : public json::json_sax_t {
+      public:
+        explicit json_body_loader(std::span<json_body_target> targets) :
+                targets{targets}, found(targets.size()) {}
+
+        void check_required() const {
+            for (size_t i = 0; i < targets.size(); i++)
+                if (targets[i].is_required && !found[i])
+                    throw oxen::traced<std::runtime_error>{
+                            "Required key '" + std::string{targets[i].name} + "' not found"};
+        }
+
+        bool null() override { return scalar(nullptr); }
+        bool boolean(bool val) override { return scalar(val); }
+        bool number_integer(number_integer_t val) override { return scalar(int64_t{val}); }
+        bool number_unsigned(number_unsigned_t val) override { return scalar(uint64_t{val}); }
+        bool number_float(number_float_t val, const string_t&) override { return scalar(val); }
+        bool string(string_t& val) override { return scalar(std::string_view{val}); }
+        bool binary(binary_t&) override { return scalar(nullptr); }
+
+        bool start_object(std::size_t) override {
+            if (depth == 1 && current)
+                throw_invalid_json_value(current->name, "unexpected object");
+            if (depth == 2 && list)
+                throw_invalid_json_value(current->name, "unexpected object in list");
+            depth++;
+            return true;
+        }
+        bool end_object() override {
+            depth--;
+            return true;
+        }
+        bool key(string_t& k) override {
+            if (depth == 1) {
+                current = nullptr;
+                for (auto& t : targets)
+                    if (t.name == k) {
+                        current = &t;
+                        break;
+                    }
+            }
+            return true;
+        }
+        bool start_array(std::size_t) override {
+            if (depth == 0)
+                throw oxen::traced<std::domain_error>{"Request parameters must be a json object"};
+            if (depth == 1 && current) {
+                if (!current->start_list)
+                    throw_invalid_json_value(current->name, "unexpected list");
+                list = current->start_list(current->val);
+                found[current - targets.data()] = true;
+            } else if (depth == 2 && list)
+                throw_invalid_json_value(current->name, "unexpected nested list");
+            depth++;
+            return true;
+        }
+        bool end_array() override {
+            if (--depth == 1)
+                list = nullptr;
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const json::exception& e) override {
+            throw oxen::traced<std::runtime_error>{e.what()};
+        }
+
+      private:
+        bool scalar(const json_scalar& v) {
+            // A bare `null` is accepted as no parameters at all (as it is for parsed json)
+            if (depth == 0 && std::holds_alternative<std::nullptr_t>(v))
+                return true;
+            if (depth == 0)
+                throw oxen::traced<std::domain_error>{"Request parameters must be a json object"};
+            if (depth == 1 && current) {
+                current->load(current->val, current->name, v);
+                found[current - targets.data()] = true;
+            } else if (depth == 2 && list)
+                current->load_element(list, current->name, v);
+            return true;
+        }
+
+        std::span<json_body_target> targets;
+        std::vector<bool> found;
+        // 1 while directly inside the top-level object, 2 inside a list (or object) value, etc.
+        int depth = 0;
+        // The target for the most recent top-level key, if we want its value
+        json_body_target* current = nullptr;
+        // The list being loaded, while we are inside a list value of a target
+        void* list = nullptr;
+    };
+
+}  // namespace
+
+void load_json_body(std::string_view body, std::span<json_body_target> targets) {
+    json_body_loader loader{targets};
+    json::sax_parse(body, &loader);
+    loader.check_required();
+}
+
+}  // namespace cryptonote::rpc
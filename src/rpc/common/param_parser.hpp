@@ -3,12 +3,17 @@
 #include <common/exception.h>
 #include <oxenc/bt_serialize.h>
 
+#include <array>
 #include <chrono>
+#include <limits>
 #include <nlohmann/json.hpp>
+#include <span>
 #include <type_traits>
 #include <utility>
+#include <variant>
 
 #include "common/json_binary_proxy.h"
+#include "rpc_command.h"
 
 namespace cryptonote::rpc {
 using nlohmann::json;
@@ -212,6 +217,141 @@ void load_tuple_values(bt_list_consumer& c, TupleLike& val, std::index_sequence<
     (load_value(c, std::get<Is>(val)), ...);
 }
 
+// A single, non-container value from a json_body
+using json_scalar = std::variant<std::nullptr_t, bool, int64_t, uint64_t, double, std::string_view>;
+
+[[noreturn]] void throw_invalid_json_value(std::string_view name, std::string_view problem);
+
+// Loads a json_body value into `val`, accepting the same input as load_value(json_range&, ...).
+template <typename T>
+void load_json_scalar(T& val, std::string_view name, const json_scalar& v) {
+    if constexpr (std::is_same_v<T, bool>) {
+        if (auto* b = std::get_if<bool>(&v))
+            val = *b;
+        else if (auto* u = std::get_if<uint64_t>(&v); u && *u <= 1)
+            val = *u;
+        else
+            throw_invalid_json_value(name, "expected boolean");
+    } else if constexpr (std::is_unsigned_v<T>) {
+        auto* u = std::get_if<uint64_t>(&v);
+        if (!u)
+            throw_invalid_json_value(name, "non-negative value required");
+        if (sizeof(T) < sizeof(uint64_t) && *u > std::numeric_limits<T>::max())
+            throw_invalid_json_value(name, "value too large");
+        val = *u;
+    } else if constexpr (std::is_integral_v<T>) {
+        if (auto* u = std::get_if<uint64_t>(&v)) {
+            if (*u > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+                throw_invalid_json_value(name, "value is too large");
+            val = *u;
+        } else if (auto* i = std::get_if<int64_t>(&v)) {
+            if (sizeof(T) < sizeof(int64_t) && *i < std::numeric_limits<T>::lowest())
+                throw_invalid_json_value(name, "negative value magnitude is too large");
+            val = *i;
+        } else
+            throw_invalid_json_value(name, "value is not an integer");
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        auto* s = std::get_if<std::string_view>(&v);
+        if (!s)
+            throw_invalid_json_value(name, "expected a string");
+        val = *s;
+    } else if constexpr (tools::json_is_binary<T> || std::is_same_v<T, eth::address>) {
+        auto* s = std::get_if<std::string_view>(&v);
+        if (!s)
+            throw_invalid_json_value(name, "expected a hex or base64 string");
+        tools::load_binary_parameter(*s, false /*no raw*/, val);
+    } else if constexpr (is_expandable_list<T>) {
+        throw_invalid_json_value(name, "expected a list");
+    } else {
+        // Notably string_views (which would outlive the text they point into) and tuples
+        static_assert(std::is_same_v<T, void>, "Unsupported json_body load type");
+    }
+}
+
+// Strips the required/ignore_empty_string/optional wrappers from a get_values() value type
+template <typename T>
+struct json_target_base {
+    using type = T;
+};
+template <typename T>
+struct json_target_base<required<T>> : json_target_base<T> {};
+template <typename T>
+struct json_target_base<ignore_empty_string<T>> : json_target_base<T> {};
+template <typename T>
+struct json_target_base<std::optional<T>> : json_target_base<T> {};
+
+template <typename T>
+auto& unwrap_json_target(T& val) {
+    if constexpr (is_required_wrapper<T> || is_ignore_empty_string_wrapper<T>)
+        return unwrap_json_target(val.value);
+    else if constexpr (is_std_optional<T>)
+        return unwrap_json_target(val.emplace());
+    else
+        return val;
+}
+
+template <typename T>
+void load_json_target(T& val, std::string_view name, const json_scalar& v) {
+    if constexpr (is_ignore_empty_string_wrapper<T>) {
+        if (auto* s = std::get_if<std::string_view>(&v); s && s->empty())
+            return;
+    }
+    load_json_scalar(unwrap_json_target(val), name, v);
+}
+
+// One of the values a get_values() call loads from a json_body.  The loading is type-erased so
+// that the (single) json parsing pass, in load_json_body(), isn't instantiated for every call.
+struct json_body_target {
+    std::string_view name;
+    void* val;
+    bool is_required;
+    // Loads a non-list value
+    void (*load)(void* val, std::string_view name, const json_scalar& v);
+    // For list values: clears the list (returning it), then appends elements to it
+    void* (*start_list)(void* val) = nullptr;
+    void (*load_element)(void* list, std::string_view name, const json_scalar& v) = nullptr;
+};
+
+template <typename T>
+json_body_target make_json_body_target(std::string_view name, T& val) {
+    json_body_target t{
+            name,
+            &val,
+            is_required_wrapper<T>,
+            [](void* p, std::string_view n, const json_scalar& v) {
+                load_json_target(*static_cast<T*>(p), n, v);
+            }};
+    using Base = typename json_target_base<T>::type;
+    if constexpr (is_expandable_list<Base>) {
+        t.start_list = [](void* p) -> void* {
+            auto& list = unwrap_json_target(*static_cast<T*>(p));
+            list.clear();
+            return &list;
+        };
+        t.load_element = [](void* list, std::string_view n, const json_scalar& v) {
+            typename Base::value_type elem{};
+            load_json_scalar(elem, n, v);
+            static_cast<Base*>(list)->push_back(std::move(elem));
+        };
+    }
+    return t;
+}
+
+template <typename T, typename... More>
+void make_json_body_targets(
+        json_body_target* out, std::string_view name, T&& val, More&&... more) {
+    *out = make_json_body_target(name, val);
+    if constexpr (sizeof...(More) > 0) {
+        check_ascending_names(name, more...);
+        make_json_body_targets(out + 1, std::forward<More>(more)...);
+    }
+}
+
+// Parses the json object in `body`, loading the values of the given targets as it goes; other
+// keys are skipped (but must still be valid json).  Throws on invalid json, a bad value for one
+// of the targets, or a missing required value.
+void load_json_body(std::string_view body, std::span<json_body_target> targets);
+
 // Takes a json object iterator or bt_dict_consumer and loads the current value at the iterator.
 // This calls itself recursively, if needed, to unwrap optional/required/ignore_empty_string
 // wrappers.
@@ -258,6 +398,11 @@ void get_values(Input& in, std::string_view name, T&& val, More&&... more) {
             // A monostate indicates that no parameters field was provided at all
             get_values(var::get<std::monostate>(in), name, val, std::forward<More>(more)...);
         }
+    } else if constexpr (std::is_same_v<json_body, Input>) {
+        static_assert(sizeof...(More) % 2 == 0);
+        std::array<json_body_target, 1 + sizeof...(More) / 2> targets;
+        make_json_body_targets(targets.data(), name, val, std::forward<More>(more)...);
+        load_json_body(in.data, targets);
     } else if constexpr (std::is_same_v<std::string_view, Input>) {
         if (in.front() == 'd') {
             bt_dict_consumer d{in};
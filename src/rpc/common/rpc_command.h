@@ -2,8 +2,16 @@
 
 #include <oxenc/bt_serialize.h>
 
+#include <chrono>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
+#include "command_decorators.h"
 #include "json_bt.h"
 
 namespace cryptonote::rpc {
@@ -14,6 +22,14 @@ using namespace std::literals;
 
 using rpc_input = std::variant<std::monostate, nlohmann::json, oxenc::bt_dict_consumer>;
 
+/// The unparsed text of a json request body.  Commands that define a `parse_request(RPC&,
+/// json_body)` overload (which must only use get_values() to load plain values and lists of them)
+/// get their json parameters loaded from it in a single pass, without first parsing the request
+/// into a nlohmann::json.
+struct json_body {
+    std::string_view data;
+};
+
 /// Exception when trying to invoke an RPC command that indicate a parameter parse failure (will
 /// give an invalid params error for JSON-RPC, for example).
 struct parse_error : std::runtime_error {
@@ -47,7 +63,7 @@ struct rpc_error : std::runtime_error {
     std::string message;
 };
 
-enum struct rpc_source : uint8_t { internal, http, omq };
+enum struct rpc_source : uint8_t { internal, http, omq, shm };
 
 /// Contains the context of the invocation, which must be filled out by the glue code (e.g. HTTP
 /// RPC server) with requester-specific context details.
@@ -59,7 +75,7 @@ struct rpc_context {
     // first place if attempted by a public requestor).
     bool admin = false;
 
-    // The RPC engine source of the request, i.e. internal, HTTP, OMQ
+    // The RPC engine source of the request, i.e. internal, HTTP, OMQ, shared memory
     rpc_source source = rpc_source::internal;
 
     // A free-form identifier (meant for humans) identifiying the remote address of the request;
@@ -95,10 +111,49 @@ struct rpc_request {
     rpc_context context;
 };
 
+/// Encoded responses of a CACHE_PER_TIP command, keyed by the request.  Each entry is tagged
+/// with a version string supplied by the server (identifying the chain tip, and the txpool state
+/// for CACHE_PER_TXPOOL commands); an entry is only used while the version is unchanged.
+class response_cache {
+  public:
+    /// Entries are never used once they are this old, whether or not the version changed
+    static constexpr auto MAX_AGE = 1s;
+    /// Requests can carry arbitrary parameters, so we limit how many we remember; once full the
+    /// cache is emptied and starts over
+    static constexpr size_t MAX_ENTRIES = 64;
+
+    std::optional<std::string> get(const std::string& key, std::string_view version) const {
+        std::shared_lock lock{m_mutex};
+        auto it = m_entries.find(key);
+        if (it == m_entries.end() || it->second.version != version ||
+            std::chrono::steady_clock::now() - it->second.created > MAX_AGE)
+            return std::nullopt;
+        return it->second.response;
+    }
+
+    void put(std::string key, std::string version, std::string response) {
+        std::unique_lock lock{m_mutex};
+        if (m_entries.size() >= MAX_ENTRIES && !m_entries.count(key))
+            m_entries.clear();
+        m_entries.insert_or_assign(
+                std::move(key),
+                entry{std::move(version), std::chrono::steady_clock::now(), std::move(response)});
+    }
+
+  private:
+    struct entry {
+        std::string version;
+        std::chrono::steady_clock::time_point created;
+        std::string response;
+    };
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, entry> m_entries;
+};
+
 // Note: to use, parse_request(RPC, rpc_input) must be defined for each typename RPC
 // this is used on.
 template <typename RPC, typename RPCServer, typename RPCCallback>
-auto make_invoke() {
+auto make_uncached_invoke() {
     return [](rpc_request&& request, RPCServer& server) -> typename RPCCallback::result_type {
         RPC rpc{};
 
@@ -107,6 +162,12 @@ auto make_invoke() {
                 if (body->front() == 'd') {  // Looks like a bt dict
                     rpc.set_bt();
                     parse_request(rpc, oxenc::bt_dict_consumer{*body});
+                } else if constexpr (std::is_base_of_v<NO_ARGS, RPC>) {
+                    // Nothing to load, but we still want to reject garbage
+                    if (!json::accept(*body))
+                        throw std::runtime_error{"invalid json"};
+                } else if constexpr (requires { parse_request(rpc, json_body{*body}); }) {
+                    parse_request(rpc, json_body{*body});
                 } else
                     parse_request(rpc, json::parse(*body));
             } else if (auto* j = std::get_if<json>(&request.body)) {
@@ -121,6 +182,9 @@ auto make_invoke() {
 
         server.invoke(rpc, std::move(request.context));
 
+        if (!rpc.is_bt() && !rpc.response_json.empty())
+            return std::move(rpc.response_json);
+
         if (rpc.response.is_null())
             rpc.response = json::object();
 
@@ -131,4 +195,42 @@ auto make_invoke() {
     };
 }
 
+// Like make_uncached_invoke, but for CACHE_PER_TIP commands the responses are cached.  The server
+// must then have a `response_cache_version(bool txpool)` method returning the current version
+// string (see response_cache), and cached responses are returned already encoded, in a
+// std::string.
+template <typename RPC, typename RPCServer, typename RPCCallback>
+auto make_invoke() {
+    return [](rpc_request&& request, RPCServer& server) -> typename RPCCallback::result_type {
+        if constexpr (std::is_base_of_v<CACHE_PER_TIP, RPC>) {
+            static response_cache cache;
+            auto body = request.body_view();
+            bool bt = body && !body->empty() && body->front() == 'd';
+            std::string cache_key{request.context.admin ? 'A' : 'P'};
+            if (body)
+                cache_key += *body;
+            else if (auto* j = std::get_if<json>(&request.body))
+                cache_key += j->dump();
+            auto cache_version =
+                    server.response_cache_version(std::is_base_of_v<CACHE_PER_TXPOOL, RPC>);
+            if (auto cached = cache.get(cache_key, cache_version))
+                return std::move(*cached);
+
+            auto result = make_uncached_invoke<RPC, RPCServer, RPCCallback>()(
+                    std::move(request), server);
+            std::string encoded;
+            if (bt)
+                encoded = oxenc::bt_serialize(std::get<oxenc::bt_value>(result));
+            else if (auto* j = std::get_if<json>(&result))
+                encoded = j->dump();
+            else
+                encoded = std::get<std::string>(std::move(result));
+            cache.put(std::move(cache_key), std::move(cache_version), encoded);
+            return encoded;
+        } else {
+            return make_uncached_invoke<RPC, RPCServer, RPCCallback>()(std::move(request), server);
+        }
+    };
+}
+
 }  // namespace cryptonote::rpc
@@ -44,13 +44,17 @@
 #include <variant>
 
 #include "blockchain_db/sqlite/db_sqlite.h"
+#include "common/alloc_profile.h"
 #include "common/command_line.h"
 #include "common/guts.h"
 #include "common/json_binary_proxy.h"
+#include "common/json_writer.h"
+#include "common/metrics.h"
 #include "common/oxen.h"
 #include "common/random.h"
 #include "common/sha256sum.h"
 #include "common/string_util.h"
+#include "common/threadpool.h"
 #include "core_rpc_server_binary_commands.h"
 #include "core_rpc_server_command_parser.h"
 #include "core_rpc_server_error_codes.h"
@@ -72,6 +76,7 @@
 #include "epee/string_tools.h"
 #include "l2_tracker/events.h"
 #include "logging/oxen_logger.h"
+#include "logging/trace.h"
 #include "net/parse.h"
 #include "oxen/log.hpp"
 #include "oxen_economy.h"
@@ -102,7 +107,11 @@ namespace {
         // Temporary: remove once RPC conversion is complete
         static_assert(!FIXME_has_nested_response_v<RPC>);
 
-        cmd->invoke = make_invoke<RPC, core_rpc_server, rpc_command>();
+        cmd->invoke = [](rpc_request&& request,
+                         core_rpc_server& server) -> rpc_command::result_type {
+            OXEN_TRACE_SPAN(logcat, RPC::names()[0]);
+            return make_invoke<RPC, core_rpc_server, rpc_command>()(std::move(request), server);
+        };
 
         for (const auto& name : RPC::names())
             regs.emplace(name, cmd);
@@ -120,6 +129,7 @@ namespace {
         // deprecated (tentatively to be removed in Oxen 11).
         cmd->invoke = [](rpc_request&& request,
                          core_rpc_server& server) -> rpc_command::result_type {
+            OXEN_TRACE_SPAN(logcat, RPC::names()[0]);
             typename RPC::request req{};
             std::string_view data;
             if (auto body = request.body_view())
@@ -132,9 +142,14 @@ namespace {
 
             auto res = server.invoke(std::move(req), std::move(request.context));
 
-            std::string response;
-            epee::serialization::store_t_to_binary(res, response);
-            return response;
+            // Some commands serialize their own response, to avoid copying large blobs around
+            if constexpr (std::is_same_v<decltype(res), std::string>)
+                return res;
+            else {
+                std::string response;
+                epee::serialization::store_t_to_binary(res, response);
+                return response;
+            }
         };
 
         for (const auto& name : RPC::names())
@@ -194,6 +209,14 @@ bool core_rpc_server::check_core_ready() {
         }                             \
     } while (0)
 
+//------------------------------------------------------------------------------------------------------------------------------
+std::string core_rpc_server::response_cache_version(bool txpool) const {
+    auto [height, hash] = m_core.blockchain.get_tail_id();
+    std::string version{tools::view_guts(hash)};
+    if (txpool)
+        version += "/{}"_format(m_core.mempool.cookie());
+    return version;
+}
 //------------------------------------------------------------------------------------------------------------------------------
 void core_rpc_server::invoke(GET_HEIGHT& get_height, rpc_context) {
     auto [height, hash] = m_core.blockchain.get_tail_id();
@@ -330,6 +353,219 @@ void core_rpc_server::invoke(GET_NET_STATS& get_net_stats, rpc_context) {
     }
     get_net_stats.response["status"] = STATUS_OK;
 }
+//------------------------------------------------------------------------------------------------------------------------------
+namespace {
+    // Appends the HELP and TYPE lines that precede a metric in the Prometheus text format
+    void prometheus_metric(
+            std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+        fmt::format_to(
+                std::back_inserter(out), "# HELP {0} {1}\n# TYPE {0} {2}\n", name, help, type);
+    }
+}  // namespace
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::append_p2p_metrics(std::string& out) {
+    auto stats = m_p2p.get_command_stats();
+    auto metric = [&](std::string_view name, std::string_view type, std::string_view help) {
+        prometheus_metric(out, name, type, help);
+    };
+    metric("oxen_p2p_command_messages_total", "counter", "P2P commands received");
+    for (const auto& [command, st] : stats)
+        fmt::format_to(
+                std::back_inserter(out),
+                "oxen_p2p_command_messages_total{{command=\"{}\"}} {}\n",
+                command,
+                st.count);
+    metric("oxen_p2p_command_bytes_in_total", "counter", "Bytes of P2P command payloads received");
+    for (const auto& [command, st] : stats)
+        fmt::format_to(
+                std::back_inserter(out),
+                "oxen_p2p_command_bytes_in_total{{command=\"{}\"}} {}\n",
+                command,
+                st.bytes_in);
+    metric("oxen_p2p_command_bytes_out_total",
+           "counter",
+           "Bytes of responses sent to P2P commands");
+    for (const auto& [command, st] : stats)
+        fmt::format_to(
+                std::back_inserter(out),
+                "oxen_p2p_command_bytes_out_total{{command=\"{}\"}} {}\n",
+                command,
+                st.bytes_out);
+    metric("oxen_p2p_command_handler_seconds", "histogram", "Time spent handling P2P commands");
+    for (const auto& [command, st] : stats) {
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < levin_command_stats::HANDLER_TIME_BUCKETS.size(); i++) {
+            cumulative += st.handler_time_histogram[i];
+            fmt::format_to(
+                    std::back_inserter(out),
+                    "oxen_p2p_command_handler_seconds_bucket{{command=\"{}\",le=\"{}\"}} {}\n",
+                    command,
+                    std::chrono::duration<double>(levin_command_stats::HANDLER_TIME_BUCKETS[i])
+                            .count(),
+                    cumulative);
+        }
+        fmt::format_to(
+                std::back_inserter(out),
+                "oxen_p2p_command_handler_seconds_bucket{{command=\"{0}\",le=\"+Inf\"}} {1}\n"
+                "oxen_p2p_command_handler_seconds_sum{{command=\"{0}\"}} {2}\n"
+                "oxen_p2p_command_handler_seconds_count{{command=\"{0}\"}} {1}\n",
+                command,
+                st.count,
+                std::chrono::duration<double>(st.handler_time).count());
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::append_block_processing_metrics(std::string& out) {
+    auto totals = m_core.blockchain.get_block_processing_stats().totals();
+    prometheus_metric(out, "oxen_blocks_processed_total", "counter", "Blocks added to the chain");
+    fmt::format_to(std::back_inserter(out), "oxen_blocks_processed_total {}\n", totals.blocks);
+    prometheus_metric(
+            out,
+            "oxen_block_txs_processed_total",
+            "counter",
+            "Transactions in blocks added to the chain");
+    fmt::format_to(std::back_inserter(out), "oxen_block_txs_processed_total {}\n", totals.txs);
+    prometheus_metric(
+            out,
+            "oxen_block_processing_seconds_total",
+            "counter",
+            "Time spent adding blocks to the chain, excluding span preparation");
+    fmt::format_to(
+            std::back_inserter(out),
+            "oxen_block_processing_seconds_total {}\n",
+            std::chrono::duration<double>(totals.times.total).count());
+    prometheus_metric(
+            out,
+            "oxen_block_processing_stage_seconds_total",
+            "counter",
+            "Time spent in each stage of adding blocks to the chain");
+    for (const auto& [name, stage] : block_processing_times::STAGES)
+        fmt::format_to(
+                std::back_inserter(out),
+                "oxen_block_processing_stage_seconds_total{{stage=\"{}\"}} {}\n",
+                name,
+                std::chrono::duration<double>(totals.times.*stage).count());
+}
+//------------------------------------------------------------------------------------------------------------------------------
+std::string core_rpc_server::prometheus_metrics() {
+    std::string out;
+    append_p2p_metrics(out);
+    append_block_processing_metrics(out);
+    out += tools::metrics::global().render();
+    return out;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(GET_P2P_METRICS& get_p2p_metrics, rpc_context) {
+    std::string out;
+    append_p2p_metrics(out);
+    get_p2p_metrics.response["metrics"] = std::move(out);
+    get_p2p_metrics.response["status"] = STATUS_OK;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(GET_THREADPOOL_STATS& get_threadpool_stats, rpc_context) {
+    using task_stats = tools::threadpool::task_stats;
+    auto stats = tools::threadpool::getInstance().get_stats();
+    auto to_json = [](const task_stats& ts) {
+        return json{
+                {"submitted", ts.submitted},
+                {"executed", ts.executed},
+                {"wait_time", std::chrono::duration<double>(ts.wait_time).count()},
+                {"run_time", std::chrono::duration<double>(ts.run_time).count()},
+                {"wait_histogram", ts.wait_histogram},
+                {"run_histogram", ts.run_histogram}};
+    };
+    auto& res = get_threadpool_stats.response;
+    res["threads"] = stats.threads;
+    res["queued"] = stats.queued;
+    res["max_queued"] = stats.max_queued;
+    auto& buckets = res["time_buckets"] = json::array();
+    for (auto b : task_stats::TIME_BUCKETS)
+        buckets.push_back(std::chrono::duration<double>(b).count());
+    res["total"] = to_json(stats.total);
+    auto& tags = res["tags"] = json::object();
+    for (const auto& [tag, ts] : stats.tags)
+        tags[tag] = to_json(ts);
+    res["status"] = STATUS_OK;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(GET_BLOCK_PROCESSING_STATS& get_block_processing_stats, rpc_context) {
+    const auto& stats = m_core.blockchain.get_block_processing_stats();
+    auto to_json = [](const block_processing_times& times) {
+        auto stages = json::object();
+        for (const auto& [name, stage] : block_processing_times::STAGES)
+            stages[name] = std::chrono::duration<double>(times.*stage).count();
+        return stages;
+    };
+    auto& res = get_block_processing_stats.response;
+    auto& blocks = res["blocks"] = json::array();
+    for (const auto& r : stats.recent(get_block_processing_stats.request.count.value_or(SIZE_MAX)))
+        blocks.push_back(json{
+                {"height", r.height},
+                {"hash", tools::hex_guts(r.hash)},
+                {"txs", r.txs},
+                {"added",
+                 std::chrono::duration<double>(r.added.time_since_epoch()).count()},
+                {"total", std::chrono::duration<double>(r.times.total).count()},
+                {"stages", to_json(r.times)}});
+    auto totals = stats.totals();
+    res["totals"] = json{
+            {"blocks", totals.blocks},
+            {"txs", totals.txs},
+            {"total", std::chrono::duration<double>(totals.times.total).count()},
+            {"stages", to_json(totals.times)}};
+    res["status"] = STATUS_OK;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(GET_DB_STATS& get_db_stats, rpc_context) {
+    auto stats = m_core.blockchain.db().get_stats();
+    auto& res = get_db_stats.response;
+    auto& tables = res["tables"] = json::object();
+    for (const auto& t : stats.tables)
+        tables[t.name] = json{
+                {"gets", t.gets},
+                {"puts", t.puts},
+                {"deletes", t.deletes},
+                {"cursor_ops", t.cursor_ops},
+                {"bytes_read", t.bytes_read},
+                {"bytes_written", t.bytes_written}};
+    res["commits"] = stats.commits;
+    res["commit_seconds"] = stats.commit_seconds;
+    res["resizes"] = stats.resizes;
+    res["resize_seconds"] = stats.resize_seconds;
+    res["status"] = STATUS_OK;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(GET_ALLOCATION_STATS& get_allocation_stats, rpc_context) {
+    auto& res = get_allocation_stats.response;
+    res["compiled"] = tools::alloc_profile::compiled();
+    auto& tags = res["tags"] = json::object();
+    for (const auto& t : tools::alloc_profile::stats())
+        tags[t.name] = json{
+                {"live_bytes", t.live_bytes},
+                {"live_allocs", t.live_allocs},
+                {"allocs", t.allocs},
+                {"bytes", t.bytes},
+                {"alloc_rate", t.alloc_rate},
+                {"byte_rate", t.byte_rate}};
+    res["status"] = STATUS_OK;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(TRACE& trace, rpc_context) {
+    namespace tracing = oxen::logging::trace;
+    if (trace.request.clear)
+        tracing::clear();
+    if (trace.request.enable)
+        tracing::enable(*trace.request.enable);
+#ifdef OXEN_TRACING
+    trace.response["compiled"] = true;
+#else
+    trace.response["compiled"] = false;
+#endif
+    trace.response["enabled"] = tracing::enabled();
+    if (trace.request.dump)
+        trace.response["trace"] = tracing::dump_chrome_trace();
+    trace.response["status"] = STATUS_OK;
+}
 namespace {
     //------------------------------------------------------------------------------------------------------------------------------
     class pruned_transaction {
@@ -344,39 +580,50 @@ namespace {
     };
 }  // namespace
 //------------------------------------------------------------------------------------------------------------------------------
-GET_BLOCKS_BIN::response core_rpc_server::invoke(GET_BLOCKS_BIN::request&& req, rpc_context) {
-    GET_BLOCKS_BIN::response res{};
+std::string core_rpc_server::invoke(GET_BLOCKS_BIN::request&& req, rpc_context) {
+    // The block and pruned tx blobs we get back are views into the database, so the snapshot has
+    // to stay alive until they have been written into the serialized response.  Holding it also
+    // keeps the supplement and the output index lookups below consistent.
+    auto snapshot = m_core.blockchain.read_snapshot();
+
+    auto failed = [] {
+        GET_BLOCKS_BIN::response res{};
+        res.status = "Failed";
+        return epee::serialization::store_t_to_binary(res);
+    };
 
     std::vector<Blockchain::BlockData> bs;
+    uint64_t current_height = 0, start_height = 0;
 
     if (!m_core.blockchain.find_blockchain_supplement(
                 req.start_height,
                 req.block_ids,
                 bs,
-                res.current_height,
-                res.start_height,
+                current_height,
+                start_height,
                 req.prune,
                 !req.no_miner_tx,
-                GET_BLOCKS_BIN::MAX_COUNT)) {
-        res.status = "Failed";
-        return res;
-    }
+                req.max_count ? std::min<size_t>(req.max_count, GET_BLOCKS_BIN::MAX_COUNT)
+                              : GET_BLOCKS_BIN::MAX_COUNT))
+        return failed();
 
     size_t size = 0, ntxes = 0;
-    res.blocks.reserve(bs.size());
-    res.output_indices.reserve(bs.size());
+    std::vector<GET_BLOCKS_BIN::block_blobs> blocks;
+    std::vector<GET_BLOCKS_BIN::block_output_indices> output_indices;
+    blocks.reserve(bs.size());
+    output_indices.reserve(bs.size());
     for (auto& bd : bs) {
-        auto& res_b = res.blocks.emplace_back();
-        res_b.block = std::move(bd.block_blob);
+        auto& res_b = blocks.emplace_back();
+        res_b.block = bd.block_blob;
         size += res_b.block.size();
-        auto& out_ind = res.output_indices.emplace_back().indices;
+        auto& out_ind = output_indices.emplace_back().indices;
         ntxes += bd.txs.size();
         out_ind.reserve(1 + bd.txs.size());
         if (req.no_miner_tx || !bd.miner_tx_hash)
             out_ind.emplace_back();
         res_b.txs.reserve(bd.txs.size());
         for (auto& [txhash, txdata] : bd.txs)
-            size += res_b.txs.emplace_back(std::move(txdata)).size();
+            size += res_b.txs.emplace_back(txdata).size();
 
         const bool miner_tx = bd.miner_tx_hash && !req.no_miner_tx;
         const size_t n_txes_to_lookup = bd.txs.size() + miner_tx;
@@ -384,18 +631,16 @@ GET_BLOCKS_BIN::response core_rpc_server::invoke(GET_BLOCKS_BIN::request&& req,
             std::vector<std::vector<uint64_t>> indices;
             bool r = m_core.blockchain.get_tx_outputs_gindexs(
                     miner_tx ? bd.miner_tx_hash : bd.txs.front().first, n_txes_to_lookup, indices);
-            if (!r || indices.size() != n_txes_to_lookup) {
-                res.status = "Failed";
-                return res;
-            }
+            if (!r || indices.size() != n_txes_to_lookup)
+                return failed();
             for (size_t i = 0; i < indices.size(); ++i)
                 out_ind.emplace_back(std::move(indices[i]));
         }
     }
 
     log::debug(logcat, "on_get_blocks: {} blocks, {} txes, size {}", bs.size(), ntxes, size);
-    res.status = STATUS_OK;
-    return res;
+    return GET_BLOCKS_BIN::serialize_response(
+            blocks, start_height, current_height, STATUS_OK, output_indices, false);
 }
 GET_ALT_BLOCKS_HASHES_BIN::response core_rpc_server::invoke(
         GET_ALT_BLOCKS_HASHES_BIN::request&&, rpc_context) {
@@ -426,6 +671,7 @@ GET_BLOCKS_BY_HEIGHT_BIN::response core_rpc_server::invoke(
     res.status = "Failed";
     res.blocks.clear();
     res.blocks.reserve(req.heights.size());
+    auto snapshot = m_core.blockchain.read_snapshot();
     for (uint64_t height : req.heights) {
         block blk;
         try {
@@ -473,6 +719,140 @@ GET_OUTPUTS_BIN::response core_rpc_server::invoke(
     return res;
 }
 //------------------------------------------------------------------------------------------------------------------------------
+static GET_OUTPUT_SCAN_DATA_BIN::tx_data make_scan_data(
+        const transaction& tx, const crypto::hash& txid, std::vector<uint64_t> output_indices) {
+    GET_OUTPUT_SCAN_DATA_BIN::tx_data td{};
+    td.txid = txid;
+    td.type = static_cast<uint8_t>(tx.type);
+    td.rct_type = static_cast<uint8_t>(tx.rct_signatures.type);
+
+    if (auto pk = get_tx_pub_key_from_extra(tx); pk)
+        td.tx_pubkeys.push_back(pk);
+    for (auto& pk : get_additional_tx_pub_keys_from_extra(tx))
+        td.tx_pubkeys.push_back(pk);
+
+    for (auto& in : tx.vin)
+        if (auto* in_to_key = std::get_if<txin_to_key>(&in))
+            td.key_images.push_back(in_to_key->k_image);
+
+    const auto& rv = tx.rct_signatures;
+    const bool rct = rv.type != rct::RCTType::Null;
+    const bool compact_amounts =
+            tools::equals_any(rv.type, rct::RCTType::Bulletproof2, rct::RCTType::CLSAG);
+    td.output_keys.reserve(tx.vout.size());
+    td.unlock_times.reserve(tx.vout.size());
+    for (size_t i = 0; i < tx.vout.size(); i++) {
+        auto* out_to_key = std::get_if<txout_to_key>(&tx.vout[i].target);
+        td.output_keys.push_back(out_to_key ? out_to_key->key : crypto::public_key{});
+        td.unlock_times.push_back(tx.get_unlock_time(i));
+        if (!rct)
+            td.amounts.push_back(tx.vout[i].amount);
+        else if (i < rv.ecdhInfo.size()) {
+            if (compact_amounts) {
+                uint64_t amount;
+                std::memcpy(&amount, rv.ecdhInfo[i].amount.bytes, sizeof(amount));
+                td.amounts.push_back(amount);
+            } else
+                td.ecdh_info.push_back(rv.ecdhInfo[i]);
+        }
+        if (rct && i < rv.outPk.size())
+            td.commitments.push_back(rv.outPk[i].mask);
+    }
+    td.output_indices = std::move(output_indices);
+    return td;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const GET_OUTPUT_SCAN_DATA_BIN::block_data> core_rpc_server::get_output_scan_data(
+        uint64_t height) {
+    constexpr size_t MAX_CACHED_SCAN_BLOCKS = 2000;
+
+    auto& db = m_core.blockchain.db();
+    auto hash = db.get_block_hash_from_height(height);
+    {
+        std::lock_guard lock{m_scan_data_cache_mutex};
+        if (auto it = m_scan_data_cache.find(hash); it != m_scan_data_cache.end())
+            return it->second;
+    }
+
+    auto blk = db.get_block_from_height(height);
+    std::vector<transaction> txs;
+    if (!m_core.blockchain.get_transactions(blk.tx_hashes, txs) ||
+        txs.size() != blk.tx_hashes.size())
+        return nullptr;
+
+    auto bd = std::make_shared<GET_OUTPUT_SCAN_DATA_BIN::block_data>();
+    bd->height = height;
+    bd->hash = hash;
+    bd->timestamp = blk.timestamp;
+
+    // The miner tx (if there is one) and the block's txes are consecutive in the database, so we
+    // can fetch all their output indices in one go.
+    std::optional<crypto::hash> miner_txid;
+    if (blk.miner_tx)
+        miner_txid = get_transaction_hash(*blk.miner_tx);
+    const size_t n_txes = txs.size() + miner_txid.has_value();
+    std::vector<std::vector<uint64_t>> indices;
+    if (n_txes > 0 && (!m_core.blockchain.get_tx_outputs_gindexs(
+                               miner_txid ? *miner_txid : blk.tx_hashes.front(), n_txes, indices) ||
+                       indices.size() != n_txes))
+        return nullptr;
+
+    bd->txs.reserve(n_txes);
+    size_t i = 0;
+    if (miner_txid)
+        bd->txs.push_back(make_scan_data(*blk.miner_tx, *miner_txid, std::move(indices[i++])));
+    for (size_t j = 0; j < txs.size(); j++)
+        bd->txs.push_back(make_scan_data(txs[j], blk.tx_hashes[j], std::move(indices[i++])));
+
+    std::lock_guard lock{m_scan_data_cache_mutex};
+    if (m_scan_data_cache.emplace(hash, bd).second) {
+        m_scan_data_cache_order.push_back(hash);
+        if (m_scan_data_cache_order.size() > MAX_CACHED_SCAN_BLOCKS) {
+            m_scan_data_cache.erase(m_scan_data_cache_order.front());
+            m_scan_data_cache_order.pop_front();
+        }
+    }
+    return bd;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+GET_OUTPUT_SCAN_DATA_BIN::response core_rpc_server::invoke(
+        GET_OUTPUT_SCAN_DATA_BIN::request&& req, rpc_context context) {
+    GET_OUTPUT_SCAN_DATA_BIN::response res{};
+
+    if (!context.admin && req.count > GET_OUTPUT_SCAN_DATA_BIN::MAX_COUNT) {
+        res.status = "Too many blocks requested";
+        return res;
+    }
+
+    // Keep the blocks and the output indices we look up consistent with each other
+    auto snapshot = m_core.blockchain.read_snapshot();
+    res.current_height = m_core.blockchain.get_current_blockchain_height();
+    if (req.start_height >= res.current_height) {
+        res.status = "Invalid start height";
+        return res;
+    }
+    uint64_t end = req.start_height + std::min(req.count, res.current_height - req.start_height);
+
+    res.blocks.reserve(end - req.start_height);
+    for (uint64_t height = req.start_height; height < end; height++) {
+        std::shared_ptr<const GET_OUTPUT_SCAN_DATA_BIN::block_data> bd;
+        try {
+            bd = get_output_scan_data(height);
+        } catch (const std::exception& e) {
+            log::warning(
+                    logcat, "Failed to get output scan data for block {}: {}", height, e.what());
+        }
+        if (!bd) {
+            res.status = "Error retrieving block at height " + std::to_string(height);
+            return res;
+        }
+        res.blocks.push_back(*bd);
+    }
+
+    res.status = STATUS_OK;
+    return res;
+}
+//------------------------------------------------------------------------------------------------------------------------------
 void core_rpc_server::invoke(GET_OUTPUTS& get_outputs, rpc_context context) {
     if (!context.admin && get_outputs.request.output_indices.size() > GET_OUTPUTS::MAX_COUNT) {
         get_outputs.response["status"] = "Too many outs requested";
@@ -849,24 +1229,16 @@ static std::unordered_map<crypto::hash, tx_info> get_pool_txs_impl(cryptonote::c
     return tx_infos;
 }
 
-static auto pool_locks(cryptonote::core& core) {
-    auto& pool = core.mempool;
-    std::unique_lock tx_lock{pool, std::defer_lock};
-    std::unique_lock bc_lock{core.blockchain, std::defer_lock};
-    auto blink_lock = pool.blink_shared_lock(std::defer_lock);
-    std::lock(tx_lock, bc_lock, blink_lock);
-    return std::make_tuple(std::move(tx_lock), std::move(bc_lock), std::move(blink_lock));
-}
-
+// These don't take the pool or blockchain locks: the txes come from a single database snapshot and
+// the key images from their own lock, so a dump of a large pool neither waits for nor holds up
+// pool updates.  (The two can be very slightly out of sync with each other if the pool changes in
+// between, which is no different from the pool changing just after the response is built).
 static std::pair<std::unordered_map<crypto::hash, tx_info>, tx_memory_pool::key_images_container>
 get_pool_txs_kis(cryptonote::core& core) {
-    auto locks = pool_locks(core);
-    return {get_pool_txs_impl(core), core.mempool.get_spent_key_images(true)};
-}
-
-static tx_memory_pool::key_images_container get_pool_kis(cryptonote::core& core) {
-    auto locks = pool_locks(core);
-    return core.mempool.get_spent_key_images(true);
+    auto kis = core.mempool.get_spent_key_images();
+    auto blink_lock = core.mempool.blink_shared_lock();
+    db_rtxn_guard rtxn_guard{core.blockchain.db()};
+    return {get_pool_txs_impl(core), std::move(kis)};
 }
 
 //------------------------------------------------------------------------------------------------------------------------------
@@ -875,12 +1247,21 @@ void core_rpc_server::invoke(GET_TRANSACTIONS& get, rpc_context) {
     std::unordered_set<crypto::hash> missed_txs;
     using split_tx = std::tuple<crypto::hash, std::string, crypto::hash, std::string>;
     std::vector<split_tx> txs;
+    // Block height and output indices of the txes found in the chain, fetched along with the blobs
+    std::unordered_map<crypto::hash, std::pair<uint64_t, std::vector<uint64_t>>> chain_info;
     if (!get.request.tx_hashes.empty()) {
-        if (!m_core.blockchain.get_split_transactions_blobs(
-                    get.request.tx_hashes, txs, &missed_txs)) {
+        std::vector<tx_lookup> found;
+        if (!m_core.blockchain.get_transactions_data(get.request.tx_hashes, found, &missed_txs)) {
             get.response["status"] = STATUS_FAILED;
             return;
         }
+        txs.reserve(found.size());
+        for (auto& tx : found) {
+            chain_info.emplace(
+                    tx.hash, std::make_pair(tx.block_height, std::move(tx.output_indices)));
+            txs.emplace_back(
+                    tx.hash, std::move(tx.pruned), tx.prunable_hash, std::move(tx.prunable));
+        }
         log::debug(
                 logcat,
                 "Found {}/{} transactions on the blockchain",
@@ -976,6 +1357,8 @@ void core_rpc_server::invoke(GET_TRANSACTIONS& get, rpc_context) {
 
     auto& txs_out = get.response["txs"];
     txs_out = json::array();
+    // Txes are usually requested a block at a time, so don't look up the same timestamp for each
+    std::unordered_map<uint64_t, uint64_t> block_timestamps;
 
     for (const auto& [tx_hash, unprunable_data, prunable_hash, prunable_data] : txs) {
         auto& e = txs_out.emplace_back();
@@ -1089,9 +1472,12 @@ void core_rpc_server::invoke(GET_TRANSACTIONS& get, rpc_context) {
             if (meta.max_used_block_height)
                 e["max_used_height"] = meta.max_used_block_height;
         } else {
-            height = m_core.blockchain.db().get_tx_block_height(tx_hash);
+            height = chain_info.at(tx_hash).first;
             e["block_height"] = height;
-            e["block_timestamp"] = m_core.blockchain.db().get_block_timestamp(height);
+            auto [ts, inserted] = block_timestamps.try_emplace(height);
+            if (inserted)
+                ts->second = m_core.blockchain.db().get_block_timestamp(height);
+            e["block_timestamp"] = ts->second;
             if (height > immutable_height) {
                 if (!blink_lock)
                     blink_lock.lock();
@@ -1106,15 +1492,8 @@ void core_rpc_server::invoke(GET_TRANSACTIONS& get, rpc_context) {
             e["stake_amount"] = sc.transferred;
 
         // output indices too if not in pool
-        if (!in_pool) {
-            std::vector<uint64_t> indices;
-            if (m_core.blockchain.get_tx_outputs_gindexs(tx_hash, indices))
-                e["output_indices"] = std::move(indices);
-            else {
-                get.response["status"] = STATUS_FAILED;
-                return;
-            }
-        }
+        if (!in_pool)
+            e["output_indices"] = std::move(chain_info.at(tx_hash).second);
     }
 
     log::debug(
@@ -1128,33 +1507,73 @@ void core_rpc_server::invoke(GET_TRANSACTIONS& get, rpc_context) {
 void core_rpc_server::invoke(IS_KEY_IMAGE_SPENT& spent, rpc_context) {
     spent.response["status"] = STATUS_FAILED;
 
+    const auto& key_images = spent.request.key_images;
     std::vector<bool> blockchain_spent;
-    if (!m_core.are_key_images_spent(spent.request.key_images, blockchain_spent))
+    if (!m_core.are_key_images_spent(key_images, blockchain_spent))
         return;
-    std::optional<tx_memory_pool::key_images_container> kis;
+
+    // Only look up the ones not spent in the chain in the pool
+    std::vector<crypto::key_image> unspent;
+    for (size_t n = 0; n < key_images.size(); n++)
+        if (!blockchain_spent[n])
+            unspent.push_back(key_images[n]);
+    std::vector<bool> pool_spent;
+    if (!unspent.empty() && !m_core.are_key_images_spent_in_pool(unspent, pool_spent))
+        return;
+
     auto spent_status = json::array();
-    for (size_t n = 0; n < spent.request.key_images.size(); n++) {
+    for (size_t n = 0, u = 0; n < key_images.size(); n++) {
         if (blockchain_spent[n])
             spent_status.push_back(IS_KEY_IMAGE_SPENT::SPENT::BLOCKCHAIN);
-        else {
-            if (!kis) {
-                try {
-                    kis = get_pool_kis(m_core);
-                } catch (const std::exception& e) {
-                    log::error(logcat, "Failed to get pool key images: {}", e.what());
-                    return;
-                }
-            }
+        else
             spent_status.push_back(
-                    kis->count(spent.request.key_images[n]) ? IS_KEY_IMAGE_SPENT::SPENT::POOL
-                                                            : IS_KEY_IMAGE_SPENT::SPENT::UNSPENT);
-        }
+                    pool_spent[u++] ? IS_KEY_IMAGE_SPENT::SPENT::POOL
+                                    : IS_KEY_IMAGE_SPENT::SPENT::UNSPENT);
     }
 
     spent.response["status"] = STATUS_OK;
     spent.response["spent_status"] = std::move(spent_status);
 }
 
+//------------------------------------------------------------------------------------------------------------------------------
+void core_rpc_server::invoke(GET_SPENDING_TX& rpc, rpc_context) {
+    auto& db = m_core.blockchain.db();
+    auto indexed_from = db.spending_index_height();
+    if (!indexed_from)
+        throw rpc_error{
+                ERROR_UNSUPPORTED_RPC,
+                "The spending index is not enabled (see --db-spending-index)"};
+
+    const auto& req = rpc.request;
+    if (req.key_images.size() + req.output_keys.size() > GET_SPENDING_TX::MAX_KEYS)
+        throw rpc_error{
+                ERROR_WRONG_PARAM,
+                "Too many keys requested (at most {})"_format(GET_SPENDING_TX::MAX_KEYS)};
+
+    auto binary_format =
+            rpc.is_bt() ? tools::json_binary_proxy::fmt::bt : tools::json_binary_proxy::fmt::hex;
+    auto& spending = rpc.response["spending"];
+    spending = json::array();
+    for (const auto& ki : req.key_images) {
+        auto& s = spending.emplace_back();
+        if (auto tx = db.get_spending_tx(ki)) {
+            tools::json_binary_proxy{s, binary_format}["txid"] = tx->txid;
+            s["height"] = tx->height;
+        }
+    }
+    auto& outputs = rpc.response["outputs"];
+    outputs = json::array();
+    for (const auto& key : req.output_keys) {
+        auto& o = outputs.emplace_back();
+        if (auto tx = db.get_output_key_tx(key)) {
+            tools::json_binary_proxy{o, binary_format}["txid"] = tx->first;
+            o["index"] = tx->second;
+        }
+    }
+    rpc.response["indexed_from"] = *indexed_from;
+    rpc.response["status"] = STATUS_OK;
+}
+
 static constexpr auto BLINK_TIMEOUT = "Blink quorum timeout"sv;
 static constexpr auto BLINK_REJECTED = "Transaction rejected by blink quorum"sv;
 
@@ -1302,6 +1721,10 @@ void core_rpc_server::invoke(MINING_STATUS& mining_status, rpc_context) {
     if (m_core.miner.is_mining()) {
         mining_status.response["speed"] = std::lround(m_core.miner.get_speed());
         mining_status.response["threads_count"] = m_core.miner.get_threads_count();
+        auto& thread_speeds = mining_status.response["thread_speeds"] = nlohmann::json::array();
+        for (double speed : m_core.miner.get_thread_speeds())
+            thread_speeds.push_back(std::lround(speed));
+        mining_status.response["pinned_threads"] = m_core.miner.pins_threads();
         mining_status.response["block_reward"] = m_core.miner.get_block_reward();
     }
     const account_public_address& lMiningAdr = m_core.miner.get_mining_address();
@@ -1383,10 +1806,13 @@ GET_TRANSACTION_POOL_HASHES_BIN::response core_rpc_server::invoke(
         GET_TRANSACTION_POOL_HASHES_BIN::request&& req, rpc_context context) {
     GET_TRANSACTION_POOL_HASHES_BIN::response res{};
 
-    std::vector<crypto::hash> tx_pool_hashes;
-    m_core.mempool.get_transaction_hashes(tx_pool_hashes, context.admin, req.blinked_txs_only);
+    auto changes = m_core.mempool.get_transaction_hash_changes(
+            req.pool_seqno, context.admin, req.blinked_txs_only);
 
-    res.tx_hashes = std::move(tx_pool_hashes);
+    res.tx_hashes = std::move(changes.added);
+    res.removed_tx_hashes = std::move(changes.removed);
+    res.pool_seqno = changes.seqno;
+    res.incremental = changes.incremental;
     res.status = STATUS_OK;
     return res;
 }
@@ -1474,66 +1900,173 @@ static uint64_t get_block_coinbase_payouts(const block& blk) {
     return reward;
 }
 //------------------------------------------------------------------------------------------------------------------------------
+// What the header RPCs report about a block that has to come from the block itself, rather than
+// from the per-height block info the db keeps (difficulty, weights), which is cheap to look up.
+struct block_header_summary {
+    crypto::hash hash;
+    hf major_version;
+    uint8_t minor_version;
+    uint64_t timestamp;
+    crypto::hash prev_id;
+    uint32_t nonce;
+    size_t block_size;  // Just the block blob; the db weight gets added for the reported size
+    uint64_t coinbase_payouts;
+    uint64_t reward;
+    std::optional<crypto::public_key> service_node_winner;
+    crypto::hash4 sn_winner_tail;
+    uint64_t l2_height;
+    uint64_t l2_reward;
+    std::vector<bool> l2_votes;
+    std::optional<crypto::hash> miner_tx_hash;
+    size_t miner_tx_outs = 0;
+    std::vector<crypto::hash> tx_hashes;
+    // Only set once a request has asked for it, as it is expensive to compute
+    std::optional<crypto::hash> pow_hash;
+};
+//------------------------------------------------------------------------------------------------------------------------------
+static std::shared_ptr<block_header_summary> make_block_header_summary(
+        const block& blk, size_t block_size, const crypto::hash& hash) {
+    auto s = std::make_shared<block_header_summary>();
+    s->hash = hash;
+    s->major_version = blk.major_version;
+    s->minor_version = blk.minor_version;
+    s->timestamp = blk.timestamp;
+    s->prev_id = blk.prev_id;
+    s->nonce = blk.nonce;
+    s->block_size = block_size;
+    s->coinbase_payouts = get_block_coinbase_payouts(blk);
+    s->reward = blk.major_version >= cryptonote::hf::hf19_reward_batching ? blk.reward
+                                                                          : s->coinbase_payouts;
+    if (blk.major_version < feature::ETH_BLS)
+        s->service_node_winner =
+                cryptonote::get_service_node_winner_from_tx_extra(blk.miner_tx.value().extra);
+    s->sn_winner_tail = blk.sn_winner_tail;
+    s->l2_height = blk.l2_height;
+    s->l2_reward = blk.l2_reward;
+    s->l2_votes = blk.l2_votes;
+    if (blk.miner_tx) {
+        s->miner_tx_hash = cryptonote::get_transaction_hash(*blk.miner_tx);
+        s->miner_tx_outs = blk.miner_tx->vout.size();
+    }
+    s->tx_hashes = blk.tx_hashes;
+    return s;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<const block_header_summary> core_rpc_server::get_block_header_summary(
+        uint64_t height, bool pow_hash) {
+    constexpr size_t MAX_CACHED_HEADERS = 10000;
+
+    auto hash = m_core.blockchain.db().get_block_hash_from_height(height);
+    {
+        std::lock_guard lock{m_header_cache_mutex};
+        if (auto it = m_header_cache.find(hash);
+            it != m_header_cache.end() && (!pow_hash || it->second->pow_hash))
+            return it->second;
+    }
+
+    block blk;
+    size_t block_size;
+    if (!m_core.blockchain.get_block_by_height(height, blk, &block_size))
+        return nullptr;
+    // Key by the hash of the block we actually loaded, in case of a reorg since the lookup above
+    auto s = make_block_header_summary(blk, block_size, get_block_hash(blk));
+    if (pow_hash)
+        s->pow_hash = get_block_longhash_w_blockchain(
+                m_core.get_nettype(), &m_core.blockchain, blk, height, 0);
+
+    std::lock_guard lock{m_header_cache_mutex};
+    if (auto [it, inserted] = m_header_cache.try_emplace(s->hash, s); inserted) {
+        m_header_cache_order.push_back(s->hash);
+        if (m_header_cache_order.size() > MAX_CACHED_HEADERS) {
+            m_header_cache.erase(m_header_cache_order.front());
+            m_header_cache_order.pop_front();
+        }
+    } else if (s->pow_hash) {
+        it->second = s;
+    }
+    return s;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+namespace {
+    // Where fill_block_header_response puts the fields: a nlohmann::json (for bt or small
+    // responses), or a json_writer for writing json straight out.
+    struct json_fields {
+        nlohmann::json& response;
+        tools::json_binary_proxy binary;
+        json_fields(nlohmann::json& response, bool is_bt) :
+                response{response},
+                binary{response,
+                       is_bt ? tools::json_binary_proxy::fmt::bt
+                             : tools::json_binary_proxy::fmt::hex} {}
+        template <typename T>
+        void set(const char* key, const T& val) {
+            response[key] = val;
+        }
+        template <typename T>
+        void set_hex(const char* key, const T& val) {
+            binary[key] = val;
+        }
+    };
+    struct writer_fields {
+        tools::json_writer& w;
+        template <typename T>
+        void set(const char* key, const T& val) {
+            w.set(key, val);
+        }
+        template <typename T>
+        void set_hex(const char* key, const T& val) {
+            w.set_binary(key, val, tools::json_binary_proxy::fmt::hex);
+        }
+    };
+}  // namespace
+
+template <typename Fields>
 static void fill_block_header_response(
-        const block& blk,
-        size_t block_size,
+        const block_header_summary& s,
         bool orphan_status,
-        std::optional<uint64_t> maybe_height,
-        const crypto::hash& hash,
+        uint64_t height,
         bool fill_pow_hash,
         bool get_tx_hashes,
-        nlohmann::json& response,
-        bool is_bt,
+        Fields&& response,
         cryptonote::core& core) {
 
     auto& db = core.blockchain.db();
 
-    tools::json_binary_proxy response_hex{
-            response,
-            is_bt ? tools::json_binary_proxy::fmt::bt : tools::json_binary_proxy::fmt::hex};
-
-    uint64_t height = maybe_height ? *maybe_height : blk.get_height();
-
-    response["major_version"] = static_cast<uint8_t>(blk.major_version);
-    response["minor_version"] = static_cast<uint8_t>(blk.minor_version);
-    response["timestamp"] = blk.timestamp;
-    response_hex["prev_hash"] = blk.prev_id;
-    response["nonce"] = blk.nonce;
-    response["orphan_status"] = orphan_status;
-    response["height"] = height;
-    response["depth"] = core.blockchain.get_current_blockchain_height() - height - 1;
-    response_hex["hash"] = hash;
-    response["difficulty"] = core.blockchain.block_difficulty(height);
-    response["cumulative_difficulty"] = db.get_block_cumulative_difficulty(height);
+    response.set("major_version", static_cast<uint8_t>(s.major_version));
+    response.set("minor_version", static_cast<uint8_t>(s.minor_version));
+    response.set("timestamp", s.timestamp);
+    response.set_hex("prev_hash", s.prev_id);
+    response.set("nonce", s.nonce);
+    response.set("orphan_status", orphan_status);
+    response.set("height", height);
+    response.set("depth", core.blockchain.get_current_blockchain_height() - height - 1);
+    response.set_hex("hash", s.hash);
+    response.set("difficulty", core.blockchain.block_difficulty(height));
+    response.set("cumulative_difficulty", db.get_block_cumulative_difficulty(height));
     auto weight = db.get_block_weight(height);
-    response["block_weight"] = weight;
-    response["block_size"] = block_size + weight;
-    auto coinbase = get_block_coinbase_payouts(blk);
-    response["coinbase_payouts"] = coinbase;
-    response["reward"] =
-            blk.major_version >= cryptonote::hf::hf19_reward_batching ? blk.reward : coinbase;
-    response["num_txes"] = blk.tx_hashes.size();
-    if (fill_pow_hash)
-        response_hex["pow_hash"] = get_block_longhash_w_blockchain(
-                core.get_nettype(), &core.blockchain, blk, height, 0);
-    response["long_term_weight"] = db.get_block_long_term_weight(height);
-    if (blk.major_version < feature::ETH_BLS)
-        response_hex["service_node_winner"] =
-                cryptonote::get_service_node_winner_from_tx_extra(blk.miner_tx.value().extra);
+    response.set("block_weight", weight);
+    response.set("block_size", s.block_size + weight);
+    response.set("coinbase_payouts", s.coinbase_payouts);
+    response.set("reward", s.reward);
+    response.set("num_txes", s.tx_hashes.size());
+    if (fill_pow_hash && s.pow_hash)
+        response.set_hex("pow_hash", *s.pow_hash);
+    response.set("long_term_weight", db.get_block_long_term_weight(height));
+    if (s.service_node_winner)
+        response.set_hex("service_node_winner", *s.service_node_winner);
     else
-        response_hex["service_node_winner_tail"] = blk.sn_winner_tail;
-    if (blk.major_version >= cryptonote::feature::ETH_BLS) {
-        response["l2_height"] = blk.l2_height;
-        response["l2_reward"] = blk.l2_reward;
-        response["l2_votes"] = blk.l2_votes;
+        response.set_hex("service_node_winner_tail", s.sn_winner_tail);
+    if (s.major_version >= cryptonote::feature::ETH_BLS) {
+        response.set("l2_height", s.l2_height);
+        response.set("l2_reward", s.l2_reward);
+        response.set("l2_votes", s.l2_votes);
     }
-    if (blk.miner_tx) {
-        response_hex["miner_tx_hash"] = cryptonote::get_transaction_hash(*blk.miner_tx);
-        response["miner_tx_outs"] = blk.miner_tx->vout.size();
+    if (s.miner_tx_hash) {
+        response.set_hex("miner_tx_hash", *s.miner_tx_hash);
+        response.set("miner_tx_outs", s.miner_tx_outs);
     }
-    if (get_tx_hashes)
-        for (const auto& tx_hash : blk.tx_hashes)
-            response_hex["tx_hashes"].push_back(tx_hash);
+    if (get_tx_hashes && !s.tx_hashes.empty())
+        response.set_hex("tx_hashes", s.tx_hashes);
 }
 //------------------------------------------------------------------------------------------------------------------------------
 void core_rpc_server::invoke(GET_LAST_BLOCK_HEADER& get_last_block_header, rpc_context context) {
@@ -1542,23 +2075,20 @@ void core_rpc_server::invoke(GET_LAST_BLOCK_HEADER& get_last_block_header, rpc_c
         return;
     }
 
-    auto [last_block_height, last_block_hash] = m_core.blockchain.get_tail_id();
-    block last_block;
-    size_t block_size;
-    bool have_last_block =
-            m_core.blockchain.get_block_by_height(last_block_height, last_block, &block_size);
-    if (!have_last_block)
+    auto last_block_height = m_core.blockchain.get_tail_id().first;
+    const bool pow = get_last_block_header.request.fill_pow_hash && context.admin;
+    auto summary = get_block_header_summary(last_block_height, pow);
+    if (!summary)
         throw rpc_error{ERROR_INTERNAL, "Internal error: can't get last block."};
     fill_block_header_response(
-            last_block,
-            block_size,
+            *summary,
             false,
             last_block_height,
-            last_block_hash,
-            get_last_block_header.request.fill_pow_hash && context.admin,
+            pow,
             get_last_block_header.request.get_tx_hashes,
-            get_last_block_header.response["block_header"],
-            get_last_block_header.is_bt(),
+            json_fields{
+                    get_last_block_header.response["block_header"],
+                    get_last_block_header.is_bt()},
             m_core);
 
     get_last_block_header.response["status"] = STATUS_OK;
@@ -1566,32 +2096,43 @@ void core_rpc_server::invoke(GET_LAST_BLOCK_HEADER& get_last_block_header, rpc_c
 //------------------------------------------------------------------------------------------------------------------------------
 
 void core_rpc_server::invoke(GET_BLOCK_HEADER_BY_HASH& gbh, rpc_context context) {
-    auto get = [this, &gbh, admin = context.admin](
+    auto get = [this, &gbh, pow = gbh.request.fill_pow_hash && context.admin](
                        const std::string& hash, nlohmann::json& response) {
         crypto::hash block_hash;
         if (!tools::try_load_from_hex_guts(hash, block_hash))
             throw rpc_error{
                     ERROR_WRONG_PARAM,
                     "Failed to parse hex representation of block hash. Hex = " + hash + '.'};
-        block blk;
-        size_t block_size;
+        std::shared_ptr<const block_header_summary> summary;
+        uint64_t height;
         bool orphan = false;
-        bool have_block =
-                m_core.blockchain.get_block_by_hash(block_hash, blk, &block_size, &orphan);
-        if (!have_block)
-            throw rpc_error{
-                    ERROR_INTERNAL,
-                    "Internal error: can't get block by hash. Hash = " + hash + '.'};
+        if (m_core.blockchain.db().block_exists(block_hash, &height)) {
+            summary = get_block_header_summary(height, pow);
+            if (summary && summary->hash != block_hash)
+                summary.reset();
+        }
+        if (!summary) {
+            // Not (or no longer) in the main chain: load it directly, without caching
+            block blk;
+            size_t block_size;
+            if (!m_core.blockchain.get_block_by_hash(block_hash, blk, &block_size, &orphan))
+                throw rpc_error{
+                        ERROR_INTERNAL,
+                        "Internal error: can't get block by hash. Hash = " + hash + '.'};
+            height = blk.get_height();
+            auto s = make_block_header_summary(blk, block_size, block_hash);
+            if (pow)
+                s->pow_hash = get_block_longhash_w_blockchain(
+                        m_core.get_nettype(), &m_core.blockchain, blk, height, 0);
+            summary = std::move(s);
+        }
         fill_block_header_response(
-                blk,
-                block_size,
+                *summary,
                 orphan,
-                std::nullopt,
-                block_hash,
-                gbh.request.fill_pow_hash && admin,
+                height,
+                pow,
                 gbh.request.get_tx_hashes,
-                response,
-                gbh.is_bt(),
+                json_fields{response, gbh.is_bt()},
                 m_core);
     };
 
@@ -1615,27 +2156,46 @@ void core_rpc_server::invoke(
     uint64_t end_height = get_block_headers_range.request.end_height;
     if (start_height >= bc_height || end_height >= bc_height || start_height > end_height)
         throw rpc_error{ERROR_TOO_BIG_HEIGHT, "Invalid start/end heights."};
+    const bool pow = get_block_headers_range.request.fill_pow_hash && context.admin;
+    const bool tx_hashes = get_block_headers_range.request.get_tx_hashes;
+    std::vector<std::shared_ptr<const block_header_summary>> summaries;
+    summaries.reserve(end_height - start_height + 1);
     for (uint64_t h = start_height; h <= end_height; ++h) {
-        block blk;
-        size_t block_size;
-        bool have_block = m_core.blockchain.get_block_by_height(h, blk, &block_size);
-        if (!have_block)
+        auto& summary = summaries.emplace_back(get_block_header_summary(h, pow));
+        if (!summary)
             throw rpc_error{
                     ERROR_INTERNAL,
                     "Internal error: can't get block by height. Height = {}."_format(h)};
+    }
+
+    if (get_block_headers_range.is_bt()) {
+        auto& headers = get_block_headers_range.response["headers"];
+        for (uint64_t h = start_height; h <= end_height; ++h)
+            fill_block_header_response(
+                    *summaries[h - start_height],
+                    false,
+                    h,
+                    pow,
+                    tx_hashes,
+                    json_fields{headers.emplace_back(), true},
+                    m_core);
+        get_block_headers_range.response["status"] = STATUS_OK;
+        return;
+    }
+
+    // Ranges can be large, so for json we write the response out directly rather than building
+    // (and then dumping) a json object holding every header.
+    auto& out = get_block_headers_range.response_json;
+    out.reserve(summaries.size() * (tx_hashes ? 1024 : 768));
+    tools::json_writer w{out};
+    w.begin_object().key("headers").begin_array();
+    for (uint64_t h = start_height; h <= end_height; ++h) {
+        w.begin_object();
         fill_block_header_response(
-                blk,
-                block_size,
-                false,
-                std::nullopt,
-                get_block_hash(blk),
-                get_block_headers_range.request.fill_pow_hash && context.admin,
-                get_block_headers_range.request.get_tx_hashes,
-                get_block_headers_range.response["headers"].emplace_back(),
-                get_block_headers_range.is_bt(),
-                m_core);
+                *summaries[h - start_height], false, h, pow, tx_hashes, writer_fields{w}, m_core);
+        w.end_object();
     }
-    get_block_headers_range.response["status"] = STATUS_OK;
+    w.end_array().set("status", STATUS_OK).end_object();
 }
 //------------------------------------------------------------------------------------------------------------------------------
 void core_rpc_server::invoke(GET_BLOCK_HEADER_BY_HEIGHT& gbh, rpc_context context) {
@@ -1650,24 +2210,19 @@ void core_rpc_server::invoke(GET_BLOCK_HEADER_BY_HEIGHT& gbh, rpc_context contex
                     "Requested block height: " + std::to_string(height) +
                             " greater than current top block height: " +
                             std::to_string(curr_height - 1)};
-        block blk;
-        size_t blk_size = 0;
-        bool have_block = m_core.blockchain.get_block_by_height(height, blk, &blk_size);
-        if (!have_block)
+        auto summary = get_block_header_summary(height, pow);
+        if (!summary)
             throw rpc_error{
                     ERROR_INTERNAL,
                     "Internal error: can't get block by height. Height = " +
                             std::to_string(height) + '.'};
         fill_block_header_response(
-                blk,
-                blk_size,
+                *summary,
                 false,
                 height,
-                get_block_hash(blk),
                 pow,
                 gbh.request.get_tx_hashes,
-                bhr,
-                gbh.is_bt(),
+                json_fields{bhr, gbh.is_bt()},
                 m_core);
     };
 
@@ -1713,16 +2268,20 @@ void core_rpc_server::invoke(GET_BLOCK& get_block, rpc_context context) {
         block_hash = get_block_hash(blk);
         block_height = get_block.request.height;
     }
+    // We need the full block here anyway, so just summarize it directly
+    const uint64_t height = block_height ? *block_height : blk.get_height();
+    const bool pow = get_block.request.fill_pow_hash && context.admin;
+    auto summary = make_block_header_summary(blk, block_size, block_hash);
+    if (pow)
+        summary->pow_hash = get_block_longhash_w_blockchain(
+                m_core.get_nettype(), &m_core.blockchain, blk, height, 0);
     fill_block_header_response(
-            blk,
-            block_size,
+            *summary,
             orphan,
-            block_height,
-            block_hash,
-            get_block.request.fill_pow_hash && context.admin,
+            height,
+            pow,
             false /*tx hashes*/,
-            get_block.response["block_header"],
-            get_block.is_bt(),
+            json_fields{get_block.response["block_header"], get_block.is_bt()},
             m_core);
     get_block.response_hex["tx_hashes"] = blk.tx_hashes;
     get_block.response_hex["blob"] = t_serializable_object_to_blob(blk);
@@ -1730,6 +2289,18 @@ void core_rpc_server::invoke(GET_BLOCK& get_block, rpc_context context) {
     get_block.response["status"] = STATUS_OK;
 }
 
+static json json_command_stats(const levin_command_stats& st) {
+    return json{
+            {"count", st.count},
+            {"bytes_in", st.bytes_in},
+            {"bytes_out", st.bytes_out},
+            {"handler_us",
+             std::chrono::duration_cast<std::chrono::microseconds>(st.handler_time).count()},
+            {"max_handler_us",
+             std::chrono::duration_cast<std::chrono::microseconds>(st.max_handler_time).count()},
+    };
+}
+
 static json json_connection_info(const connection_info& ci) {
     json info{
             {"incoming", ci.incoming},
@@ -1761,6 +2332,11 @@ static json json_connection_info(const connection_info& ci) {
     // supported on Oxen:
     if (ci.pruning_seed)
         info["pruning_seed"] = ci.pruning_seed;
+    if (!ci.command_stats.empty()) {
+        auto& commands = info["commands"];
+        for (const auto& [command, st] : ci.command_stats)
+            commands[std::to_string(command)] = json_command_stats(st);
+    }
     return info;
 }
 
@@ -1967,6 +2543,23 @@ void core_rpc_server::invoke(GET_SERVICE_NODE_STATUS& sns, rpc_context) {
         rhex["pubkey_x25519"] = keys.pub_x25519;
         rhex["pubkey_bls"] = keys.pub_bls;
     }
+
+    if (m_core.have_l2_tracker()) {
+        auto [providers, primary] = m_core.l2_tracker().get_provider_stats();
+        auto& l2_providers = sns.response["l2_providers"] = json::array();
+        for (size_t i = 0; i < providers.size(); i++) {
+            const auto& [client, stats] = providers[i];
+            auto& p = l2_providers.emplace_back(json{
+                    {"name", client.name},
+                    {"url", tools::trim_url(client.url)},
+                    {"primary", primary == i},
+                    {"error_rate", stats.error_rate},
+                    {"requests", stats.requests},
+                    {"failures", stats.failures}});
+            if (stats.latency)
+                p["latency_ms"] = std::chrono::duration<double, std::milli>{*stats.latency}.count();
+        }
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------
@@ -3014,6 +3607,127 @@ void core_rpc_server::fill_sn_response_entry(
     }
 }
 
+namespace {
+    // Fields of a GET_SERVICE_NODES entry that depend only on the chain state at the top block
+    // (i.e. not on uptime proofs, reachability tests, the current time, or this node's own
+    // settings), and so can be reused by other requests until the next block.
+    const std::unordered_set<std::string> sn_block_state_fields{
+            "service_node_pubkey",
+            "is_removable",
+            "is_liquidatable",
+            "registration_height",
+            "requested_unlock_height",
+            "last_reward_block_height",
+            "last_reward_transaction_index",
+            "active",
+            "payable",
+            "funded",
+            "state_height",
+            "earned_downtime_blocks",
+            "decommission_count",
+            "total_contributed",
+            "staking_requirement",
+            "portions_for_operator",
+            "operator_fee",
+            "swarm_id",
+            "swarm",
+            "registration_hf_version",
+            "operator_address",
+            "total_reserved",
+            "last_decommission_reason_consensus_all",
+            "last_decommission_reason_consensus_any",
+            "last_decomm_reasons",
+            "contributors",
+            "locked_contributions",
+    };
+    // Keys that can come from uptime proofs before ETH_BLS, but are part of the SN state after.
+    const std::unordered_set<std::string> sn_key_fields{
+            "pubkey_bls", "pubkey_ed25519", "pubkey_x25519"};
+
+    constexpr size_t MAX_CACHED_SN_STATES = 8;
+
+    // Selects `limit` random elements of `v`, in random order, or shuffles all of `v` if `limit` is
+    // negative or at least the size of `v`.  A limit of 0 leaves `v` alone.
+    template <typename T>
+    void select_random_sns(std::vector<T>& v, int limit) {
+        const int top_sn_index = (int)v.size() - 1;
+        if (limit < 0 || limit > top_sn_index) {
+            // We asked for -1 (no limit but shuffle) or a value >= the count, so just shuffle the
+            // entire list
+            std::shuffle(v.begin(), v.end(), tools::rng);
+        } else if (limit > 0) {
+            // We need to select N random elements, in random order, from yyyyyyyy.  We could (and
+            // used to) just shuffle the entire list and return the first N, but that is quite
+            // inefficient when the list is large and N is small.  So instead this algorithm is
+            // going to select a random element from yyyyyyyy, swap it to position 0, so we get:
+            // [x]yyyyyyyy where one of the new y's used to be at element 0.  Then we select a
+            // random element from the new y's (i.e. all the elements beginning at position 1), and
+            // swap it into element 1, to get [xx]yyyyyy, then keep repeating until our set of x's
+            // is big enough, say [xxx]yyyyy.  At that point we chop of the y's to just be left with
+            // [xxx], and only required N swaps in total.
+            for (int i = 0; i < limit; i++) {
+                int j = std::uniform_int_distribution<int>{i, top_sn_index}(tools::rng);
+                using std::swap;
+                if (i != j)
+                    swap(v[i], v[j]);
+            }
+
+            v.resize(limit);
+        }
+    }
+}  // namespace
+
+// Returns the (unshuffled) `service_node_states` entries for a request for all service nodes, from
+// the cache if an identical request has already been made at the current top block.  Returns
+// nullptr if the request isn't cacheable because it wants specific nodes or fields that can change
+// without a new block.
+std::shared_ptr<const std::vector<json>> core_rpc_server::get_cached_sn_states(
+        const GET_SERVICE_NODES::request_parameters& req,
+        bool is_bt,
+        uint64_t top_height,
+        const crypto::hash& top_hash) {
+    if (!req.service_node_pubkeys.empty() || req.fields.empty() || req.fields.count("all"))
+        return nullptr;
+    bool keys_cacheable = is_hard_fork_at_least(nettype(), feature::ETH_BLS, top_height);
+    for (const auto& f : req.fields)
+        if (!sn_block_state_fields.count(f) && !(keys_cacheable && sn_key_fields.count(f)))
+            return nullptr;
+
+    {
+        std::lock_guard lock{m_sn_states_cache_mutex};
+        for (const auto& c : m_sn_states_cache)
+            if (c.block_hash == top_hash && c.is_bt == is_bt && c.active_only == req.active_only &&
+                c.fields == req.fields)
+                return c.entries;
+    }
+
+    auto sn_infos = m_core.service_node_list.get_service_node_list_state();
+    const auto removable = m_core.blockchain.get_removable_nodes();
+    auto entries = std::make_shared<std::vector<json>>();
+    entries->reserve(sn_infos.size());
+    for (auto& pubkey_info : sn_infos)
+        if (!req.active_only || pubkey_info.info->is_active())
+            fill_sn_response_entry(
+                    entries->emplace_back(json::object()),
+                    is_bt,
+                    req.fields,
+                    pubkey_info,
+                    top_height,
+                    &removable);
+
+    // If a block arrived while we were building this then we can't be sure which state it came
+    // from, so just return it without caching it.
+    if (m_core.blockchain.get_tail_id().second != top_hash)
+        return entries;
+
+    std::lock_guard lock{m_sn_states_cache_mutex};
+    std::erase_if(m_sn_states_cache, [&](const auto& c) { return c.block_hash != top_hash; });
+    if (m_sn_states_cache.size() >= MAX_CACHED_SN_STATES)
+        m_sn_states_cache.erase(m_sn_states_cache.begin());
+    m_sn_states_cache.push_back({top_hash, is_bt, req.active_only, req.fields, entries});
+    return entries;
+}
+
 //------------------------------------------------------------------------------------------------------------------------------
 void core_rpc_server::invoke(GET_SERVICE_NODES& sns, rpc_context) {
     auto& req = sns.request;
@@ -3043,6 +3757,19 @@ void core_rpc_server::invoke(GET_SERVICE_NODES& sns, rpc_context) {
                     top_hash;  // Force it on a poll request even if it wasn't a requested field
     }
 
+    auto& sn_states = (sns.response["service_node_states"] = json::array());
+
+    if (auto cached = get_cached_sn_states(req, sns.is_bt(), top_height, top_hash)) {
+        std::vector<const json*> picked;
+        picked.reserve(cached->size());
+        for (const auto& entry : *cached)
+            picked.push_back(&entry);
+        select_random_sns(picked, req.limit);
+        for (const auto* entry : picked)
+            sn_states.push_back(*entry);
+        return;
+    }
+
     auto sn_infos = m_core.service_node_list.get_service_node_list_state(req.service_node_pubkeys);
 
     if (req.active_only)
@@ -3055,32 +3782,8 @@ void core_rpc_server::invoke(GET_SERVICE_NODES& sns, rpc_context) {
                         }),
                 sn_infos.end());
 
-    const int top_sn_index = (int)sn_infos.size() - 1;
-    if (req.limit < 0 || req.limit > top_sn_index) {
-        // We asked for -1 (no limit but shuffle) or a value >= the count, so just shuffle the
-        // entire list
-        std::shuffle(sn_infos.begin(), sn_infos.end(), tools::rng);
-    } else if (req.limit > 0) {
-        // We need to select N random elements, in random order, from yyyyyyyy.  We could (and used
-        // to) just shuffle the entire list and return the first N, but that is quite inefficient
-        // when the list is large and N is small.  So instead this algorithm is going to select a
-        // random element from yyyyyyyy, swap it to position 0, so we get: [x]yyyyyyyy where one of
-        // the new y's used to be at element 0.  Then we select a random element from the new y's
-        // (i.e. all the elements beginning at position 1), and swap it into element 1, to get
-        // [xx]yyyyyy, then keep repeating until our set of x's is big enough, say [xxx]yyyyy.  At
-        // that point we chop of the y's to just be left with [xxx], and only required N swaps in
-        // total.
-        for (int i = 0; i < req.limit; i++) {
-            int j = std::uniform_int_distribution<int>{i, top_sn_index}(tools::rng);
-            using std::swap;
-            if (i != j)
-                swap(sn_infos[i], sn_infos[j]);
-        }
-
-        sn_infos.resize(req.limit);
-    }
+    select_random_sns(sn_infos, req.limit);
 
-    auto& sn_states = (sns.response["service_node_states"] = json::array());
     const auto removable = m_core.blockchain.get_removable_nodes();
     for (auto& pubkey_info : sn_infos)
         fill_sn_response_entry(
@@ -3601,4 +4304,42 @@ void core_rpc_server::invoke(GET_ACCRUED_REWARDS& rpc, rpc_context) {
     rpc.response["status"] = STATUS_OK;
 }
 
+void core_rpc_server::invoke(GET_ADDRESS_ACTIVITY& rpc, rpc_context) {
+    auto* index = m_core.address_activity_db();
+    if (!index)
+        throw rpc_error{
+                ERROR_UNSUPPORTED_RPC,
+                "The address activity index is not enabled (see --address-activity-index)"};
+
+    // The index stores addresses in canonical form, so normalize what we were given to match
+    const auto& req = rpc.request;
+    std::string address;
+    if (eth::address eth_address{};
+        req.address.starts_with("0x") &&
+        tools::try_load_from_hex_guts<eth::address>(req.address, eth_address))
+        address = "0x{:x}"_format(eth_address);
+    else if (address_parse_info info{};
+             get_account_address_from_str(info, nettype(), req.address))
+        address = get_account_address_as_str(nettype(), info.is_subaddress, info.address);
+    else if (crypto::ed25519_public_key ed{}; tools::try_load_from_hex_guts(req.address, ed))
+        address = tools::hex_guts(ed);
+    else
+        throw rpc_error{ERROR_WRONG_PARAM, "Invalid address '{}'"_format(req.address)};
+
+    rpc.response["height"] = index->height();
+    auto& events = rpc.response["events"];
+    events = json::array();
+    for (auto& ev : index->get_activity(address, req.after, req.limit)) {
+        auto& e = events.emplace_back();
+        e["id"] = ev.id;
+        e["height"] = ev.height;
+        tools::json_binary_proxy{e, rpc.is_bt() ? tools::json_binary_proxy::fmt::bt
+                                                : tools::json_binary_proxy::fmt::hex}["txid"] =
+                ev.txid;
+        e["type"] = std::move(ev.type);
+        e["subject"] = std::move(ev.subject);
+    }
+    rpc.response["status"] = STATUS_OK;
+}
+
 }  // namespace cryptonote::rpc
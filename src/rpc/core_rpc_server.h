@@ -33,7 +33,9 @@
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <variant>
 
 #include "common/json_binary_proxy.h"
@@ -64,6 +66,7 @@ template <typename T>
 constexpr bool FIXME_has_nested_response_v = FIXME_has_nested_response<T>::value;
 
 class core_rpc_server;
+struct block_header_summary;
 
 /// Stores an RPC command callback.  These are set up in core_rpc_server.cpp.
 struct rpc_command {
@@ -130,11 +133,26 @@ class core_rpc_server {
 
     network_type nettype() const { return m_core.get_nettype(); }
 
+    /// Returns the current version string for cached responses of CACHE_PER_TIP commands (or of
+    /// CACHE_PER_TXPOOL commands, if `txpool` is true); see response_cache.
+    std::string response_cache_version(bool txpool) const;
+
+    /// Returns the p2p and block processing metrics, along with everything registered in the
+    /// global metrics registry, in the Prometheus text exposition format, as served on the admin
+    /// HTTP RPC's /metrics endpoint.
+    std::string prometheus_metrics();
+
     // JSON & bt-encoded RPC endpoints
     void invoke(ONS_RESOLVE& resolve, rpc_context context);
     void invoke(GET_HEIGHT& req, rpc_context context);
     void invoke(GET_INFO& info, rpc_context context);
     void invoke(GET_NET_STATS& get_net_stats, rpc_context context);
+    void invoke(GET_P2P_METRICS& get_p2p_metrics, rpc_context context);
+    void invoke(GET_THREADPOOL_STATS& get_threadpool_stats, rpc_context context);
+    void invoke(GET_BLOCK_PROCESSING_STATS& get_block_processing_stats, rpc_context context);
+    void invoke(GET_DB_STATS& get_db_stats, rpc_context context);
+    void invoke(GET_ALLOCATION_STATS& get_allocation_stats, rpc_context context);
+    void invoke(TRACE& trace, rpc_context context);
     void invoke(GET_OUTPUTS& get_outputs, rpc_context context);
     void invoke(HARD_FORK_INFO& hfinfo, rpc_context context);
     void invoke(START_MINING& start_mining, rpc_context context);
@@ -153,6 +171,7 @@ class core_rpc_server {
     void invoke(GET_PENDING_EVENTS& sns, rpc_context context);
     void invoke(GET_LIMIT& limit, rpc_context context);
     void invoke(SET_LIMIT& limit, rpc_context context);
+    void invoke(GET_SPENDING_TX& rpc, rpc_context context);
     void invoke(IS_KEY_IMAGE_SPENT& spent, rpc_context context);
     void invoke(SUBMIT_TRANSACTION& tx, rpc_context context);
     void invoke(GET_BLOCK_HASH& req, rpc_context context);
@@ -204,12 +223,14 @@ class core_rpc_server {
     void invoke(GET_OUTPUT_HISTOGRAM& get_output_histogram, rpc_context context);
     void invoke(ONS_OWNERS_TO_NAMES& ons_owners_to_names, rpc_context context);
     void invoke(GET_ACCRUED_REWARDS& rpc, rpc_context context);
+    void invoke(GET_ADDRESS_ACTIVITY& rpc, rpc_context context);
     void invoke(ONS_NAMES_TO_OWNERS& ons_names_to_owners, rpc_context context);
 
     // Deprecated Monero NIH binary endpoints:
     GET_ALT_BLOCKS_HASHES_BIN::response invoke(
             GET_ALT_BLOCKS_HASHES_BIN::request&& req, rpc_context context);
-    GET_BLOCKS_BIN::response invoke(GET_BLOCKS_BIN::request&& req, rpc_context context);
+    // Returns the already-serialized response; see GET_BLOCKS_BIN::serialize_response
+    std::string invoke(GET_BLOCKS_BIN::request&& req, rpc_context context);
     GET_BLOCKS_BY_HEIGHT_BIN::response invoke(
             GET_BLOCKS_BY_HEIGHT_BIN::request&& req, rpc_context context);
     GET_HASHES_BIN::response invoke(GET_HASHES_BIN::request&& req, rpc_context context);
@@ -218,6 +239,8 @@ class core_rpc_server {
     GET_OUTPUT_DISTRIBUTION_BIN::response invoke(
             GET_OUTPUT_DISTRIBUTION_BIN::request&& req, rpc_context context);
     GET_OUTPUTS_BIN::response invoke(GET_OUTPUTS_BIN::request&& req, rpc_context context);
+    GET_OUTPUT_SCAN_DATA_BIN::response invoke(
+            GET_OUTPUT_SCAN_DATA_BIN::request&& req, rpc_context context);
     GET_TRANSACTION_POOL_HASHES_BIN::response invoke(
             GET_TRANSACTION_POOL_HASHES_BIN::request&& req, rpc_context context);
     GET_TX_GLOBAL_OUTPUTS_INDEXES_BIN::response invoke(
@@ -228,6 +251,9 @@ class core_rpc_server {
   private:
     bool check_core_ready();
 
+    void append_p2p_metrics(std::string& out);
+    void append_block_processing_metrics(std::string& out);
+
     void fill_sn_response_entry(
             nlohmann::json& entry,
             bool is_bt,
@@ -236,8 +262,48 @@ class core_rpc_server {
             uint64_t top_height,
             const std::unordered_map<eth::bls_public_key, bool>* removable);
 
+    std::shared_ptr<const std::vector<nlohmann::json>> get_cached_sn_states(
+            const GET_SERVICE_NODES::request_parameters& req,
+            bool is_bt,
+            uint64_t top_height,
+            const crypto::hash& top_hash);
+
+    std::shared_ptr<const GET_OUTPUT_SCAN_DATA_BIN::block_data> get_output_scan_data(
+            uint64_t height);
+
+    // Returns the (cached) header summary of the main chain block at `height`, computing its PoW
+    // hash as well if `pow_hash` is set.  Returns nullptr if the block can't be loaded.
+    std::shared_ptr<const block_header_summary> get_block_header_summary(
+            uint64_t height, bool pow_hash);
+
     core& m_core;
     nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core>>& m_p2p;
+
+    // Recently built `service_node_states` lists of GET_SERVICE_NODES requests that only asked for
+    // fields that can't change until the next block; see get_cached_sn_states().
+    struct sn_states_cache_entry {
+        crypto::hash block_hash;
+        bool is_bt;
+        bool active_only;
+        std::unordered_set<std::string> fields;
+        std::shared_ptr<const std::vector<nlohmann::json>> entries;
+    };
+    std::mutex m_sn_states_cache_mutex;
+    std::vector<sn_states_cache_entry> m_sn_states_cache;
+
+    // Recently built GET_OUTPUT_SCAN_DATA_BIN block data, keyed by block hash (so that entries for
+    // blocks that get popped are simply never looked up again), plus the insertion order for
+    // evicting the oldest entries.
+    std::mutex m_scan_data_cache_mutex;
+    std::unordered_map<crypto::hash, std::shared_ptr<const GET_OUTPUT_SCAN_DATA_BIN::block_data>>
+            m_scan_data_cache;
+    std::deque<crypto::hash> m_scan_data_cache_order;
+
+    // Recently used block header summaries for the header RPCs, keyed by block hash just like the
+    // scan data cache above.
+    std::mutex m_header_cache_mutex;
+    std::unordered_map<crypto::hash, std::shared_ptr<const block_header_summary>> m_header_cache;
+    std::deque<crypto::hash> m_header_cache_order;
 };
 
 }  // namespace cryptonote::rpc
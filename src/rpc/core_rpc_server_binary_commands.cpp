@@ -1,5 +1,7 @@
 #include "core_rpc_server_binary_commands.h"
 
+#include "epee/storages/portable_storage_binary_writer.h"
+
 namespace cryptonote::rpc {
 
 KV_SERIALIZE_MAP_CODE_BEGIN(EMPTY)
@@ -18,6 +20,7 @@ KV_SERIALIZE_CONTAINER_POD_AS_BLOB(block_ids)
 KV_SERIALIZE(start_height)
 KV_SERIALIZE(prune)
 KV_SERIALIZE_OPT(no_miner_tx, false)
+KV_SERIALIZE_OPT(max_count, (uint64_t)0)
 KV_SERIALIZE_MAP_CODE_END()
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCKS_BIN::tx_output_indices)
@@ -37,6 +40,100 @@ KV_SERIALIZE(output_indices)
 KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
+namespace {
+
+    using epee::serialization::SERIALIZE_FLAG_ARRAY;
+    using epee::serialization::SERIALIZE_TYPE_TAG;
+    constexpr uint8_t TAG_U64 = SERIALIZE_TYPE_TAG<uint64_t>;
+    constexpr uint8_t TAG_BOOL = SERIALIZE_TYPE_TAG<bool>;
+    constexpr uint8_t TAG_STRING = SERIALIZE_TYPE_TAG<std::string>;
+    constexpr uint8_t TAG_SECTION = SERIALIZE_TYPE_TAG<epee::serialization::section>;
+
+}  // namespace
+
+std::string GET_BLOCKS_BIN::serialize_response(
+        const std::vector<block_blobs>& blocks,
+        uint64_t start_height,
+        uint64_t current_height,
+        std::string_view status,
+        const std::vector<block_output_indices>& output_indices,
+        bool untrusted) {
+    // Entries are written in key order (the order portable_storage writes them in), so that the
+    // writer doesn't have to reorder them.
+    epee::serialization::binary_writer w;
+
+    size_t reserve = 256;
+    for (const auto& b : blocks) {
+        reserve += b.block.size() + 32;
+        for (const auto& tx : b.txs)
+            reserve += tx.size() + 8;
+    }
+    for (const auto& boi : output_indices)
+        for (const auto& toi : boi.indices)
+            reserve += 16 + 8 * toi.indices.size();
+    w.reserve(reserve);
+
+    auto key = [&w](std::string_view name, uint8_t type) {
+        w.key(name);
+        w.tag(type);
+    };
+
+    if (!blocks.empty()) {
+        key("blocks", SERIALIZE_FLAG_ARRAY | TAG_SECTION);
+        w.write_varint(blocks.size());
+        for (const auto& b : blocks) {
+            w.begin_section();
+            // "blinks" would sort first, but is empty and so omitted
+            key("block", TAG_STRING);
+            w.write_string(b.block);
+            key("checkpoint", TAG_STRING);
+            w.write_string("");
+            if (!b.txs.empty()) {
+                key("txs", SERIALIZE_FLAG_ARRAY | TAG_STRING);
+                w.write_varint(b.txs.size());
+                for (const auto& tx : b.txs)
+                    w.write_string(tx);
+            }
+            w.end_section();
+        }
+    }
+
+    key("current_height", TAG_U64);
+    w.write(current_height);
+
+    if (!output_indices.empty()) {
+        key("output_indices", SERIALIZE_FLAG_ARRAY | TAG_SECTION);
+        w.write_varint(output_indices.size());
+        for (const auto& boi : output_indices) {
+            w.begin_section();
+            if (!boi.indices.empty()) {
+                key("indices", SERIALIZE_FLAG_ARRAY | TAG_SECTION);
+                w.write_varint(boi.indices.size());
+                for (const auto& toi : boi.indices) {
+                    w.begin_section();
+                    if (!toi.indices.empty()) {
+                        key("indices", SERIALIZE_FLAG_ARRAY | TAG_U64);
+                        w.write_varint(toi.indices.size());
+                        for (auto i : toi.indices)
+                            w.write(i);
+                    }
+                    w.end_section();
+                }
+            }
+            w.end_section();
+        }
+    }
+
+    key("start_height", TAG_U64);
+    w.write(start_height);
+    key("status", TAG_STRING);
+    w.write_string(status);
+    key("untrusted", TAG_BOOL);
+    w.write(untrusted);
+
+    return w.finish();
+}
+
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_BLOCKS_BY_HEIGHT_BIN::request)
 KV_SERIALIZE(heights)
 KV_SERIALIZE_MAP_CODE_END()
@@ -100,15 +197,52 @@ KV_SERIALIZE(status)
 KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_OUTPUT_SCAN_DATA_BIN::request)
+KV_SERIALIZE(start_height)
+KV_SERIALIZE(count)
+KV_SERIALIZE_MAP_CODE_END()
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_OUTPUT_SCAN_DATA_BIN::tx_data)
+KV_SERIALIZE_VAL_POD_AS_BLOB(txid)
+KV_SERIALIZE(type)
+KV_SERIALIZE(rct_type)
+KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_pubkeys)
+KV_SERIALIZE_CONTAINER_POD_AS_BLOB(key_images)
+KV_SERIALIZE_CONTAINER_POD_AS_BLOB(output_keys)
+KV_SERIALIZE(output_indices)
+KV_SERIALIZE(unlock_times)
+KV_SERIALIZE_CONTAINER_POD_AS_BLOB(commitments)
+KV_SERIALIZE(amounts)
+KV_SERIALIZE_CONTAINER_POD_AS_BLOB(ecdh_info)
+KV_SERIALIZE_MAP_CODE_END()
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_OUTPUT_SCAN_DATA_BIN::block_data)
+KV_SERIALIZE(height)
+KV_SERIALIZE_VAL_POD_AS_BLOB(hash)
+KV_SERIALIZE(timestamp)
+KV_SERIALIZE(txs)
+KV_SERIALIZE_MAP_CODE_END()
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_OUTPUT_SCAN_DATA_BIN::response)
+KV_SERIALIZE(blocks)
+KV_SERIALIZE(current_height)
+KV_SERIALIZE(status)
+KV_SERIALIZE(untrusted)
+KV_SERIALIZE_MAP_CODE_END()
+
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSACTION_POOL_HASHES_BIN::request)
 KV_SERIALIZE_OPT(blinked_txs_only, false)
 KV_SERIALIZE_OPT(long_poll, false)
 KV_SERIALIZE_VAL_POD_AS_BLOB_OPT(tx_pool_checksum, crypto::hash{})
+KV_SERIALIZE_OPT(pool_seqno, (uint64_t)0)
 KV_SERIALIZE_MAP_CODE_END()
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSACTION_POOL_HASHES_BIN::response)
 KV_SERIALIZE(status)
 KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_hashes)
+KV_SERIALIZE_CONTAINER_POD_AS_BLOB(removed_tx_hashes)
+KV_SERIALIZE_OPT(pool_seqno, (uint64_t)0)
+KV_SERIALIZE_OPT(incremental, false)
 KV_SERIALIZE(untrusted)
 KV_SERIALIZE_MAP_CODE_END()
 
@@ -64,6 +64,9 @@ struct GET_BLOCKS_BIN : PUBLIC, BINARY {
         bool prune;             // Prunes the blockchain, dropping off 7/8ths of the blocks.
         bool no_miner_tx;  // If specified and true, don't include miner transactions in transaction
                            // results.
+        uint64_t max_count;  // If non-zero, return at most this many blocks (the daemon never
+                             // returns more than MAX_COUNT).  Lets a client make several requests
+                             // by height ahead of time knowing where each batch will end.
 
         KV_MAP_SERIALIZABLE
     };
@@ -92,6 +95,26 @@ struct GET_BLOCKS_BIN : PUBLIC, BINARY {
 
         KV_MAP_SERIALIZABLE
     };
+
+    // Non-owning equivalent of a `block_complete_entry` in `response::blocks` (get_blocks.bin
+    // never sends checkpoints or blinks).
+    struct block_blobs {
+        std::string_view block;
+        std::vector<std::string_view> txs;
+    };
+
+    // Serializes a response directly into epee binary form, producing exactly what
+    // `epee::serialization::store_t_to_binary` produces for the equivalent `response`, but
+    // copying each blob only once: straight from the given view into the output.  This lets the
+    // daemon send blobs that point into the database without first copying them into a
+    // `response` and then again into a portable_storage.
+    static std::string serialize_response(
+            const std::vector<block_blobs>& blocks,
+            uint64_t start_height,
+            uint64_t current_height,
+            std::string_view status,
+            const std::vector<block_output_indices>& output_indices,
+            bool untrusted);
 };
 
 void to_json(nlohmann::json& j, const GET_BLOCKS_BIN::tx_output_indices& toi);
@@ -247,12 +270,22 @@ struct GET_TRANSACTION_POOL_HASHES_BIN : PUBLIC, BINARY {
         crypto::hash tx_pool_checksum;  // Optional: If `long_poll` is true the caller must pass the
                                         // hashes of all their known tx pool hashes, XOR'ed
                                         // together.  Ignored when using OMQ RPC.
+        uint64_t pool_seqno;  // Optional: the `pool_seqno` from a previous response, to get only
+                              // the changes since then (see `incremental`).  Not supported with
+                              // `long_poll`.
         KV_MAP_SERIALIZABLE
     };
 
     struct response {
         std::string status;  // General RPC error code. "OK" means everything looks good.
-        std::vector<crypto::hash> tx_hashes;  // List of transaction hashes,
+        std::vector<crypto::hash> tx_hashes;  // List of transaction hashes; when `incremental` is
+                                              // true, just the ones added since `pool_seqno`.
+        std::vector<crypto::hash> removed_tx_hashes;  // When `incremental` is true, the hashes that
+                                                      // have left the pool since `pool_seqno`.
+        uint64_t pool_seqno;  // Current pool sequence number, to pass in the next request.
+        bool incremental;  // True if this is only the changes since the requested `pool_seqno`;
+                           // false (or omitted) if `tx_hashes` is the whole pool, which is
+                           // returned when no `pool_seqno` was given or it is too old.
         bool untrusted;  // States if the result is obtained using the bootstrap mode, and is
                          // therefore not trusted (`true`), or when the daemon is fully synced
                          // (`false`).
@@ -287,6 +320,64 @@ struct GET_OUTPUT_BLACKLIST_BIN : PUBLIC, BINARY {
     };
 };
 
+OXEN_RPC_DOC_INTROSPECT
+// Get the compact per-transaction data a wallet needs to scan a range of blocks for its outputs
+// and spends.  Binary request.  Compared to get_blocks.bin this leaves out everything a wallet
+// doesn't need to recognise its own outputs (signatures, range proofs, most of the tx extra, etc.),
+// so a wallet only needs to fetch the full transactions that turn out to involve it.
+struct GET_OUTPUT_SCAN_DATA_BIN : PUBLIC, BINARY {
+    static constexpr auto names() { return NAMES("get_output_scan_data.bin"); }
+
+    static constexpr size_t MAX_COUNT = 1000;
+
+    struct request {
+        uint64_t start_height;  // The height of the first block to fetch.
+        uint64_t count;         // How many blocks to fetch; at most MAX_COUNT (and the chain end).
+
+        KV_MAP_SERIALIZABLE
+    };
+
+    struct tx_data {
+        crypto::hash txid;
+        uint8_t type;      // The cryptonote::txtype of the transaction
+        uint8_t rct_type;  // The rct::RCTType of the transaction; 0 for non-RingCT transactions
+        std::vector<crypto::public_key> tx_pubkeys;  // The main tx pubkey from the tx extra (if
+                                                     // present) followed by any additional pubkeys
+        std::vector<crypto::key_image> key_images;   // Key images of the tx's inputs
+        std::vector<crypto::public_key> output_keys;
+        std::vector<uint64_t> output_indices;  // Global output indices of the outputs
+        std::vector<uint64_t> unlock_times;    // Per-output unlock times
+        std::vector<rct::key> commitments;     // Output commitments (RingCT only)
+        // The amounts of the outputs: plaintext for non-RingCT transactions, or the 8-byte
+        // encrypted amounts of the compact (Bulletproof2/CLSAG) RingCT types.  Empty for older
+        // RingCT types, which have ecdh_info instead.
+        std::vector<uint64_t> amounts;
+        std::vector<rct::ecdhTuple> ecdh_info;  // Full ecdh info of non-compact RingCT types
+
+        KV_MAP_SERIALIZABLE
+    };
+
+    struct block_data {
+        uint64_t height;
+        crypto::hash hash;
+        uint64_t timestamp;
+        std::vector<tx_data> txs;  // The miner tx (if any) followed by the block's transactions
+
+        KV_MAP_SERIALIZABLE
+    };
+
+    struct response {
+        std::vector<block_data> blocks;
+        uint64_t current_height;  // The current block height.
+        std::string status;       // General RPC error code. "OK" means everything looks good.
+        bool untrusted;  // States if the result is obtained using the bootstrap mode, and is
+                         // therefore not trusted (`true`), or when the daemon is fully synced
+                         // (`false`).
+
+        KV_MAP_SERIALIZABLE
+    };
+};
+
 /// List of all supported rpc command structs to allow compile-time enumeration of all supported
 /// RPC types.  Every type added above that has an RPC endpoint needs to be added here, and needs
 /// a core_rpc_server::invoke() overload that takes a <TYPE>::request and returns a
@@ -300,6 +391,7 @@ using core_rpc_binary_types = tools::type_list<
         GET_OUTPUTS_BIN,
         GET_OUTPUT_BLACKLIST_BIN,
         GET_OUTPUT_DISTRIBUTION_BIN,
+        GET_OUTPUT_SCAN_DATA_BIN,
         GET_TRANSACTION_POOL_HASHES_BIN,
         GET_TX_GLOBAL_OUTPUTS_INDEXES_BIN>;
 
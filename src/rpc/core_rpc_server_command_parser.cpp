@@ -15,11 +15,22 @@ namespace cryptonote::rpc {
 
 using nlohmann::json;
 
-void parse_request(ONS_RESOLVE& ons, rpc_input in) {
+// Commands taking only plain values (and lists of them) are loaded through a load_params template,
+// so that they can also be parsed straight from the text of a json request (see json_body).
+
+template <typename Input>
+static void load_params(ONS_RESOLVE& ons, Input& in) {
     get_values(
             in, "name_hash", required{ons.request.name_hash}, "type", required{ons.request.type});
 }
 
+void parse_request(ONS_RESOLVE& ons, rpc_input in) {
+    load_params(ons, in);
+}
+void parse_request(ONS_RESOLVE& ons, json_body in) {
+    load_params(ons, in);
+}
+
 void parse_request(GET_SERVICE_NODES& sns, rpc_input in) {
     // Remember: key access must be in sorted order (even across get_values() calls).
     get_values(in, "active_only", sns.request.active_only);
@@ -97,10 +108,18 @@ void parse_request(GET_OUTPUTS& get_outputs, rpc_input in) {
         get_values(in, "outputs", get_outputs.request.output_indices);
 }
 
-void parse_request(GET_TRANSACTION_POOL_STATS& pstats, rpc_input in) {
+template <typename Input>
+static void load_params(GET_TRANSACTION_POOL_STATS& pstats, Input& in) {
     get_values(in, "include_unrelayed", pstats.request.include_unrelayed);
 }
 
+void parse_request(GET_TRANSACTION_POOL_STATS& pstats, rpc_input in) {
+    load_params(pstats, in);
+}
+void parse_request(GET_TRANSACTION_POOL_STATS& pstats, json_body in) {
+    load_params(pstats, in);
+}
+
 void parse_request(HARD_FORK_INFO& hfinfo, rpc_input in) {
     get_values(in, "height", hfinfo.request.height, "version", hfinfo.request.version);
     if (hfinfo.request.height && hfinfo.request.version)
@@ -159,6 +178,10 @@ void parse_request(IS_KEY_IMAGE_SPENT& spent, rpc_input in) {
     get_values(in, "key_images", spent.request.key_images);
 }
 
+void parse_request(GET_SPENDING_TX& rpc, rpc_input in) {
+    get_values(in, "key_images", rpc.request.key_images, "output_keys", rpc.request.output_keys);
+}
+
 void parse_request(SUBMIT_TRANSACTION& tx, rpc_input in) {
     if (auto* json_in = std::get_if<json>(&in))
         if (auto it = json_in->find("tx_as_hex"); it != json_in->end())
@@ -214,13 +237,21 @@ void parse_request(SUBMIT_TRANSACTION& tx, rpc_input in) {
         throw oxen::traced<std::domain_error>{"Invalid 'tx' value: expected hex, base64, or bytes"};
 }
 
-void parse_request(GET_BLOCK_HASH& bh, rpc_input in) {
+template <typename Input>
+static void load_params(GET_BLOCK_HASH& bh, Input& in) {
     get_values(in, "heights", bh.request.heights);
 
     if (bh.request.heights.size() > bh.MAX_HEIGHTS)
         throw oxen::traced<std::domain_error>{"Error: too many block heights requested at once"};
 }
 
+void parse_request(GET_BLOCK_HASH& bh, rpc_input in) {
+    load_params(bh, in);
+}
+void parse_request(GET_BLOCK_HASH& bh, json_body in) {
+    load_params(bh, in);
+}
+
 void parse_request(GET_PEER_LIST& pl, rpc_input in) {
     get_values(in, "public_only", pl.request.public_only);
 }
@@ -252,10 +283,33 @@ void parse_request(GET_COINBASE_TX_SUM& get_coinbase_tx_sum, rpc_input in) {
             get_coinbase_tx_sum.request.height);
 }
 
-void parse_request(GET_FEE_ESTIMATE& get_fee_estimate, rpc_input in) {
+void parse_request(GET_BLOCK_PROCESSING_STATS& stats, rpc_input in) {
+    get_values(in, "count", stats.request.count);
+}
+
+void parse_request(TRACE& trace, rpc_input in) {
+    get_values(
+            in,
+            "clear",
+            trace.request.clear,
+            "dump",
+            trace.request.dump,
+            "enable",
+            trace.request.enable);
+}
+
+template <typename Input>
+static void load_params(GET_FEE_ESTIMATE& get_fee_estimate, Input& in) {
     get_values(in, "grace_blocks", get_fee_estimate.request.grace_blocks);
 }
 
+void parse_request(GET_FEE_ESTIMATE& get_fee_estimate, rpc_input in) {
+    load_params(get_fee_estimate, in);
+}
+void parse_request(GET_FEE_ESTIMATE& get_fee_estimate, json_body in) {
+    load_params(get_fee_estimate, in);
+}
+
 void parse_request(OUT_PEERS& out_peers, rpc_input in) {
     get_values(in, "out_peers", out_peers.request.out_peers, "set", out_peers.request.set);
 }
@@ -360,7 +414,8 @@ void parse_request(SET_BANS& set_bans, rpc_input in) {
             required{set_bans.request.seconds});
 }
 
-void parse_request(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, rpc_input in) {
+template <typename Input>
+static void load_params(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, Input& in) {
     get_values(
             in,
             "end_height",
@@ -373,7 +428,15 @@ void parse_request(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, rpc_input i
             get_block_headers_range.request.start_height);
 }
 
-void parse_request(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, rpc_input in) {
+void parse_request(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, rpc_input in) {
+    load_params(get_block_headers_range, in);
+}
+void parse_request(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, json_body in) {
+    load_params(get_block_headers_range, in);
+}
+
+template <typename Input>
+static void load_params(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, Input& in) {
     get_values(
             in,
             "fill_pow_hash",
@@ -386,7 +449,15 @@ void parse_request(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, rpc_i
             get_block_header_by_height.request.heights);
 }
 
-void parse_request(GET_BLOCK& get_block, rpc_input in) {
+void parse_request(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, rpc_input in) {
+    load_params(get_block_header_by_height, in);
+}
+void parse_request(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, json_body in) {
+    load_params(get_block_header_by_height, in);
+}
+
+template <typename Input>
+static void load_params(GET_BLOCK& get_block, Input& in) {
     get_values(
             in,
             "fill_pow_hash",
@@ -397,6 +468,13 @@ void parse_request(GET_BLOCK& get_block, rpc_input in) {
             get_block.request.height);
 }
 
+void parse_request(GET_BLOCK& get_block, rpc_input in) {
+    load_params(get_block, in);
+}
+void parse_request(GET_BLOCK& get_block, json_body in) {
+    load_params(get_block, in);
+}
+
 void parse_request(GET_OUTPUT_HISTOGRAM& get_output_histogram, rpc_input in) {
     get_values(
             in,
@@ -416,6 +494,17 @@ void parse_request(GET_ACCRUED_REWARDS& rpc, rpc_input in) {
     get_values(in, "addresses", rpc.request.addresses);
 }
 
+void parse_request(GET_ADDRESS_ACTIVITY& rpc, rpc_input in) {
+    get_values(
+            in,
+            "address",
+            required{rpc.request.address},
+            "after",
+            rpc.request.after,
+            "limit",
+            rpc.request.limit);
+}
+
 void parse_request(ONS_OWNERS_TO_NAMES& ons_owners_to_names, rpc_input in) {
     get_values(
             in,
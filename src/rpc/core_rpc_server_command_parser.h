@@ -5,6 +5,7 @@
 #include <nlohmann/json.hpp>
 
 #include "core_rpc_server_commands_defs.h"
+#include "rpc/common/rpc_command.h"
 
 namespace cryptonote::rpc {
 
@@ -16,12 +17,20 @@ void parse_request(BANNED& banned, rpc_input in);
 void parse_request(FLUSH_CACHE& flush_cache, rpc_input in);
 void parse_request(FLUSH_TRANSACTION_POOL& flush_transaction_pool, rpc_input in);
 void parse_request(GET_ACCRUED_REWARDS& rpc, rpc_input in);
+void parse_request(GET_ADDRESS_ACTIVITY& rpc, rpc_input in);
 void parse_request(GET_FEE_ESTIMATE& get_fee_estimate, rpc_input in);
+void parse_request(GET_FEE_ESTIMATE& get_fee_estimate, json_body in);
 void parse_request(GET_BLOCK& get_block, rpc_input in);
+void parse_request(GET_BLOCK& get_block, json_body in);
 void parse_request(GET_BLOCK_HASH& bh, rpc_input in);
+void parse_request(GET_BLOCK_HASH& bh, json_body in);
+void parse_request(GET_BLOCK_PROCESSING_STATS& stats, rpc_input in);
+void parse_request(TRACE& trace, rpc_input in);
 void parse_request(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, rpc_input in);
+void parse_request(GET_BLOCK_HEADERS_RANGE& get_block_headers_range, json_body in);
 void parse_request(GET_BLOCK_HEADER_BY_HASH& get_block_header_by_hash, rpc_input in);
 void parse_request(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, rpc_input in);
+void parse_request(GET_BLOCK_HEADER_BY_HEIGHT& get_block_header_by_height, json_body in);
 void parse_request(GET_CHECKPOINTS& getcp, rpc_input in);
 void parse_request(GET_COINBASE_TX_SUM& get_coinbase_tx_sum, rpc_input in);
 void parse_request(GET_QUORUM_STATE& get_quorum_state, rpc_input in);
@@ -36,13 +45,16 @@ void parse_request(GET_SN_STATE_CHANGES& get_sn_state_changes, rpc_input in);
 void parse_request(GET_TRANSACTIONS& get, rpc_input in);
 void parse_request(GET_TRANSACTION_POOL& get, rpc_input in);
 void parse_request(GET_TRANSACTION_POOL_STATS& pstats, rpc_input in);
+void parse_request(GET_TRANSACTION_POOL_STATS& pstats, json_body in);
 void parse_request(HARD_FORK_INFO& hfinfo, rpc_input in);
 void parse_request(IN_PEERS& in_peers, rpc_input in);
+void parse_request(GET_SPENDING_TX& rpc, rpc_input in);
 void parse_request(IS_KEY_IMAGE_SPENT& spent, rpc_input in);
 void parse_request(LOKINET_PING& lokinet_ping, rpc_input in);
 void parse_request(ONS_OWNERS_TO_NAMES& ons_owners_to_names, rpc_input in);
 void parse_request(ONS_NAMES_TO_OWNERS& ons_names_to_owners, rpc_input in);
 void parse_request(ONS_RESOLVE& ons, rpc_input in);
+void parse_request(ONS_RESOLVE& ons, json_body in);
 void parse_request(OUT_PEERS& out_peers, rpc_input in);
 void parse_request(POP_BLOCKS& pop_blocks, rpc_input in);
 void parse_request(PRUNE_BLOCKCHAIN& prune_blockchain, rpc_input in);
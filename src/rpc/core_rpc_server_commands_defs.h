@@ -340,6 +340,41 @@ struct IS_KEY_IMAGE_SPENT : PUBLIC, LEGACY {
     } request;
 };
 
+/// RPC: blockchain/get_spending_tx
+///
+/// Looks up the transactions that spent key images and that created outputs, from the optional
+/// spending index.  Requires that oxend is running with `--db-spending-index`; the index only
+/// covers blocks added since that was first enabled (see `indexed_from`).
+///
+/// Inputs:
+///
+/// - `key_images` -- list of key images to look up the spending transactions of.
+/// - `output_keys` -- list of output one-time public keys to look up the creating transactions of.
+///   Together with `key_images`, at most 1000 values may be given.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `indexed_from` -- the height of the first block covered by the index.
+/// - `spending` -- array in the same order as `key_images`; each element is null if the key image
+///   isn't spent in an indexed block, otherwise a dict of:
+///   - `txid` -- the hash of the spending transaction.
+///   - `height` -- the height of the block containing it.
+/// - `outputs` -- array in the same order as `output_keys`; each element is null if no indexed
+///   block created the output, otherwise a dict of:
+///   - `txid` -- the hash of the transaction that created it.
+///   - `index` -- the index of the output within that transaction.
+struct GET_SPENDING_TX : PUBLIC {
+    static constexpr auto names() { return NAMES("get_spending_tx"); }
+
+    static constexpr size_t MAX_KEYS = 1000;
+
+    struct request_parameters {
+        std::vector<crypto::key_image> key_images;
+        std::vector<crypto::public_key> output_keys;
+    } request;
+};
+
 /// RPC: blockchain/get_outs
 ///
 /// Retrieve transaction outputs
@@ -484,6 +519,8 @@ struct STOP_MINING : LEGACY, NO_ARGS {
 /// - `active` -- States if mining is enabled (`true`) or disabled (`false`).
 /// - `speed` -- Mining power in hashes per seconds.
 /// - `threads_count` -- Number of running mining threads.
+/// - `thread_speeds` -- Hash rate of each mining thread, in hashes per second.
+/// - `pinned_threads` -- True if the mining threads are pinned to CPUs (`--mining-pin-threads`).
 /// - `address` -- Account address daemon is mining to. Empty if not mining.
 /// - `pow_algorithm` -- Current hashing algorithm name
 /// - `block_target` -- The expected time to solve per block, i.e. TARGET_BLOCK_TIME
@@ -557,7 +594,7 @@ struct MINING_STATUS : LEGACY, NO_ARGS {
 /// - `free_space` -- Available disk space on the node.
 ///
 /// Example-JSON-Fetch
-struct GET_INFO : PUBLIC, LEGACY, NO_ARGS {
+struct GET_INFO : PUBLIC, LEGACY, NO_ARGS, CACHE_PER_TXPOOL {
     static constexpr auto names() { return NAMES("get_info", "getinfo"); }
 };
 
@@ -702,7 +739,7 @@ struct GET_BLOCK_HASH : PUBLIC {
 /// ```
 ///
 /// Example-JSON-Fetch
-struct GET_LAST_BLOCK_HEADER : PUBLIC {
+struct GET_LAST_BLOCK_HEADER : PUBLIC, CACHE_PER_TIP {
     static constexpr auto names() { return NAMES("get_last_block_header", "getlastblockheader"); }
 
     struct request_parameters {
@@ -982,6 +1019,14 @@ struct GET_TRANSACTION_POOL_STATS : PUBLIC, LEGACY {
 ///   - `localhost` -- set to true if the peer is a localhost connection; omitted otherwise.
 ///   - `local_ip` -- set to true if the peer is a non-public, local network connection; omitted
 ///     otherwise.
+///   - `commands` -- dict of the p2p commands received from this peer, keyed by command id (as a
+///     string), each a dict of:
+///     - `count` -- number of times the command was received
+///     - `bytes_in` -- total size of the received command payloads
+///     - `bytes_out` -- total size of the responses we sent back (for invoke-style commands)
+///     - `handler_us` -- total time spent handling the command, in microseconds
+///     - `max_handler_us` -- longest time spent handling a single instance of the command
+///     Omitted if nothing has been received yet.
 ///
 /// Example output:
 /// ```json
@@ -1099,6 +1144,185 @@ struct STOP_DAEMON : LEGACY, NO_ARGS {
     static constexpr auto names() { return NAMES("stop_daemon"); }
 };
 
+/// RPC: daemon/get_p2p_metrics
+///
+/// Get counters and handler time histograms of the p2p commands received by this node since it
+/// started, summed across all connections, in the Prometheus text exposition format.
+///
+/// Inputs: none.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `metrics` -- the metrics, as a string in Prometheus text format.  Metrics are labelled with
+///   the numeric levin `command` id: `oxen_p2p_command_messages_total`,
+///   `oxen_p2p_command_bytes_in_total`, `oxen_p2p_command_bytes_out_total` and the histogram
+///   `oxen_p2p_command_handler_seconds`.
+struct GET_P2P_METRICS : NO_ARGS {
+    static constexpr auto names() { return NAMES("get_p2p_metrics"); }
+};
+
+/// RPC: daemon/get_threadpool_stats
+///
+/// Get counters of the tasks run by the daemon's verification thread pool since it started, for
+/// the pool as a whole and broken down by the code that submitted them.
+///
+/// Inputs: none.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `threads` -- the number of worker threads in the pool.
+/// - `queued` -- the number of tasks currently waiting for a thread.
+/// - `max_queued` -- the most tasks that have been waiting for a thread at once.
+/// - `time_buckets` -- upper bounds, in seconds, of the histogram buckets below.  The histograms
+///   have one more entry than this, counting the tasks slower than the last bound.
+/// - `total` -- counters for all tasks, as a dict containing:
+///   - `submitted` -- number of tasks submitted to the pool.
+///   - `executed` -- number of tasks that have finished running.
+///   - `wait_time` -- total seconds that executed tasks spent queued before a thread started
+///     running them.
+///   - `run_time` -- total seconds spent running tasks.
+///   - `wait_histogram` -- counts of executed tasks by queued time, bucketed by `time_buckets`.
+///   - `run_histogram` -- counts of executed tasks by run time, bucketed by `time_buckets`.
+/// - `tags` -- dict of the same counters for the tasks submitted from each tagged call site (such
+///   as `"rct_ring_signature"`), keyed by the tag.
+struct GET_THREADPOOL_STATS : NO_ARGS {
+    static constexpr auto names() { return NAMES("get_threadpool_stats"); }
+};
+
+/// RPC: daemon/get_block_processing_stats
+///
+/// Get the time spent in each stage of adding the most recently added blocks to the chain (the
+/// daemon keeps the last 720), and the totals of those times over all blocks added since the
+/// daemon started.
+///
+/// Inputs:
+///
+/// - `count` -- (optional) the number of most recent blocks to return.  If omitted, all of the
+///   kept blocks are returned.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `blocks` -- list of the blocks, oldest first, each a dict containing:
+///   - `height` -- the block height.
+///   - `hash` -- the block hash.
+///   - `txs` -- the number of (non-coinbase) transactions in the block.
+///   - `added` -- unix timestamp (with fractional seconds) at which the block was added.
+///   - `total` -- seconds spent adding the block, excluding the `prepare_*` stages (which run on
+///     the thread pool for a whole span of incoming blocks at once).
+///   - `stages` -- dict of the seconds spent in each stage.  The stages are:
+///     - `prepare_blocks` -- the block's share of parsing its incoming span's blocks and
+///       precomputing their proof of work.  0 for blocks that didn't arrive in a span.
+///     - `prepare_txs` -- the block's share of parsing its span's transactions, looking up their
+///       ring members and prechecking their ring signatures.  0 for blocks that didn't arrive in a
+///       span.
+///     - `basic_checks` -- block header, timestamp and miner tx checks.
+///     - `pow` -- proof of work verification, if not precomputed.
+///     - `tx_checks` -- transaction verification, including inputs and RCT signatures.
+///     - `rewards` -- block reward validation.
+///     - `db_add` -- writing the block to the blockchain database.
+///     - `service_node_list` -- updating the service node list.
+///     - `ons` -- updating the Oxen Name System database.
+///     - `batching` -- recording batched service node rewards.
+///     - `quorum_cop` -- quorum and uptime proof handling.
+///     - `checkpoints` -- checkpoint handling.
+///     - `other_hooks` -- other block processing.
+/// - `totals` -- dict of totals since the daemon started: `blocks` and `txs` counts, and `total`
+///   and `stages` seconds as above.
+struct GET_BLOCK_PROCESSING_STATS : RPC_COMMAND {
+    static constexpr auto names() { return NAMES("get_block_processing_stats"); }
+
+    struct request_parameters {
+        std::optional<uint64_t> count;
+    } request;
+};
+
+/// RPC: daemon/get_db_stats
+///
+/// Get the blockchain database access counters of each table since the daemon started, to see
+/// which tables and access patterns dominate its I/O.  The same counters (along with commit and
+/// resize time histograms) are exported on the /metrics endpoint.
+///
+/// Inputs: none.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `tables` -- dict of the database tables, each a dict containing:
+///   - `gets` -- record lookups by key.
+///   - `puts` -- records written.
+///   - `deletes` -- records deleted.
+///   - `cursor_ops` -- cursor positioning and iteration operations.
+///   - `bytes_read` -- bytes of record values returned by lookups and cursor operations.
+///   - `bytes_written` -- bytes of keys and values written.
+/// - `commits` -- the number of database transactions committed.
+/// - `commit_seconds` -- the total time spent committing database transactions.
+/// - `resizes` -- the number of times the database memory map was resized.
+/// - `resize_seconds` -- the total time spent resizing the memory map (during which all database
+///   access is blocked).
+struct GET_DB_STATS : NO_ARGS {
+    static constexpr auto names() { return NAMES("get_db_stats"); }
+};
+
+/// RPC: daemon/get_allocation_stats
+///
+/// Get the daemon's heap allocation counts by subsystem (tx pool, block processing, service node
+/// list, block queue, RPC), for attributing memory growth.  Allocations made outside of any tagged
+/// subsystem count as `other`.  Allocation profiling slows every allocation, so it is only compiled
+/// in with `-DENABLE_ALLOC_PROFILING=ON`; otherwise `tags` is empty.
+///
+/// Inputs: none.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `compiled` -- true if allocation profiling is compiled into this daemon.
+/// - `tags` -- dict of the subsystem tags, each a dict containing:
+///   - `live_bytes` -- bytes allocated by the subsystem and not yet freed.
+///   - `live_allocs` -- allocations made by the subsystem and not yet freed.
+///   - `allocs` -- allocations made since the daemon started.
+///   - `bytes` -- bytes allocated since the daemon started.
+///   - `alloc_rate` -- allocations per second since the previous call of this endpoint.
+///   - `byte_rate` -- bytes allocated per second since the previous call of this endpoint.
+struct GET_ALLOCATION_STATS : NO_ARGS {
+    static constexpr auto names() { return NAMES("get_allocation_stats"); }
+};
+
+/// RPC: daemon/trace
+///
+/// Controls the recording of tracing spans around the daemon's hot paths (block processing, tx
+/// pool admission, RPC dispatch, quorumnet handlers and LMDB transaction commits), and dumps what
+/// was recorded.  Each thread keeps its most recent spans, so a dump covers the last stretch of
+/// activity of each thread.  Tracing can be compiled out with `-DENABLE_TRACING=OFF`, in which
+/// case nothing ever gets recorded.
+///
+/// Inputs:
+///
+/// - `enable` -- (optional) true to start recording spans, false to stop.  If omitted, recording
+///   is left as it is.
+/// - `clear` -- if true, discard the spans recorded so far (before enabling, if also given).
+/// - `dump` -- if true, return the recorded spans.
+///
+/// Outputs:
+///
+/// - `status` -- General RPC status string. `"OK"` means everything looks good.
+/// - `compiled` -- true if this daemon was built with tracing spans.
+/// - `enabled` -- true if spans are now being recorded.
+/// - `trace` -- if `dump` was given, the recorded spans as a JSON document in the Chrome trace
+///   event format, as a string.  Write it to a file to load it in Perfetto (ui.perfetto.dev) or
+///   chrome://tracing.
+struct TRACE : RPC_COMMAND {
+    static constexpr auto names() { return NAMES("trace"); }
+
+    struct request_parameters {
+        std::optional<bool> enable;
+        bool clear = false;
+        bool dump = false;
+    } request;
+};
+
 /// RPC: daemon/get_limit
 ///
 /// Get daemon p2p bandwidth limits.
@@ -1217,7 +1441,7 @@ struct IN_PEERS : LEGACY {
 /// ```
 ///
 /// Example-JSON-Fetch
-struct HARD_FORK_INFO : PUBLIC {
+struct HARD_FORK_INFO : PUBLIC, CACHE_PER_TIP {
     static constexpr auto names() { return NAMES("hard_fork_info"); }
 
     struct request_parameters {
@@ -1489,7 +1713,7 @@ struct GET_COINBASE_TX_SUM : RPC_COMMAND {
 /// ```
 ///
 /// Example-JSON-Fetch
-struct GET_FEE_ESTIMATE : PUBLIC {
+struct GET_FEE_ESTIMATE : PUBLIC, CACHE_PER_TIP {
     static constexpr auto names() { return NAMES("get_fee_estimate"); }
 
     struct request_parameters {
@@ -2117,6 +2341,16 @@ struct GET_SERVICE_NODES : PUBLIC {
 /// - `height` -- current top block height at the time of the request (note that this is generally
 ///   one less than the "blockchain height").
 /// - `block_hash` -- current top block hash at the time of the request
+/// - `l2_providers` -- array of the configured L2 providers, in configured order, if this daemon
+///   has an L2 tracker.  Each element is a dict containing keys:
+///   - `name` -- the name of the provider.
+///   - `url` -- the provider URL, with any credentials and most of the path elided.
+///   - `primary` -- true if this is the provider currently used for L2 requests.
+///   - `latency_ms` -- moving average of the response time (in milliseconds) of successful
+///     requests while this provider was primary.  Omitted if there have not been any.
+///   - `error_rate` -- moving average of the fraction of requests to this provider that failed.
+///   - `requests` -- total number of requests to this provider.
+///   - `failures` -- total number of failed requests to this provider.
 /// - `status` -- generic RPC error code; "OK" means the request was successful.
 struct GET_SERVICE_NODE_STATUS : NO_ARGS {
     static constexpr auto names() { return NAMES("get_service_node_status"); }
@@ -2206,6 +2440,45 @@ struct GET_ACCRUED_REWARDS : PUBLIC {
     } request;
 };
 
+/// RPC: blockchain/get_address_activity
+///
+/// Retrieves the service node registrations, stakes and unlocks and the ONS records that involved
+/// an address, from the optional address activity index.  Requires that oxend is running with
+/// `--address-activity-index`.
+///
+/// Unlocks and L2 exits are attributed to the addresses that staked the unlocked key image or
+/// contributed to the exiting service node; ONS updates and renewals to the owners of the record
+/// before the update and any new owners that it sets.
+///
+/// Inputs:
+///  - `address` -- the Oxen wallet address, Ethereum address (0x-prefixed hex) or ONS ed25519
+///    owner key (hex) to look up.
+///  - `after` -- optional: return only the events after the one with this `id`; pass the `id` of
+///    the last event of the previous call to get the next page of results.
+///  - `limit` -- optional: the maximum number of events to return (default 100, at most 1000).
+///
+/// Outputs:
+///  - `status` -- Generic RPC error code. "OK" is the success value.
+///  - `height` -- the number of blocks that have been indexed.
+///  - `events` -- list of events involving the address, oldest first.  Each element contains:
+///    - `id` -- the id of the event, increasing with height.
+///    - `height` -- the height of the block containing the event.
+///    - `txid` -- the transaction of the event.
+///    - `type` -- one of `sn_reserved` (a registration reserving a contribution slot for the
+///      address), `sn_stake`, `sn_unlock`, `eth_sn_register`, `eth_sn_exit_request`,
+///      `eth_sn_exit`, `eth_sn_purge`, `ons_buy`, `ons_update` or `ons_renew`.
+///    - `subject` -- the service node pubkey (for `sn_*` and `eth_sn_register` events), BLS
+///      pubkey (for other `eth_sn_*` events) or ONS name hash (for `ons_*` events), in hex.  Empty
+///      if the transaction didn't say.
+struct GET_ADDRESS_ACTIVITY : PUBLIC {
+    static constexpr auto names() { return NAMES("get_address_activity"); }
+    struct request_parameters {
+        std::string address;
+        int64_t after = 0;
+        uint64_t limit = 100;
+    } request;
+};
+
 /// Dev-RPC: service_node/storage_server_ping
 ///
 /// Endpoint to receive an uptime ping from the connected storage server. This is used
@@ -2281,7 +2554,7 @@ struct LOKINET_PING : RPC_COMMAND {
 /// - `status` -- generic RPC error code; "OK" means the request was successful.
 /// - `staking_requirement` -- The staking requirement in Oxen, in atomic units.
 /// - `height` -- The current blockchain height for which the staking requirement applies.
-struct GET_STAKING_REQUIREMENT : PUBLIC, NO_ARGS {
+struct GET_STAKING_REQUIREMENT : PUBLIC, NO_ARGS, CACHE_PER_TIP {
     static constexpr auto names() { return NAMES("get_staking_requirement"); }
 };
 
@@ -2783,6 +3056,7 @@ using core_rpc_types = tools::type_list<
         FLUSH_CACHE,
         FLUSH_TRANSACTION_POOL,
         GET_ACCRUED_REWARDS,
+        GET_ADDRESS_ACTIVITY,
         GET_ALTERNATE_CHAINS,
         GET_BANS,
         GET_FEE_ESTIMATE,
@@ -2802,6 +3076,7 @@ using core_rpc_types = tools::type_list<
         GET_NET_STATS,
         GET_OUTPUTS,
         GET_OUTPUT_HISTOGRAM,
+        GET_P2P_METRICS,
         GET_PEER_LIST,
         GET_PENDING_EVENTS,
         GET_QUORUM_STATE,
@@ -2818,6 +3093,11 @@ using core_rpc_types = tools::type_list<
         GET_SERVICE_PRIVKEYS,
         GET_SN_STATE_CHANGES,
         GET_STAKING_REQUIREMENT,
+        GET_THREADPOOL_STATS,
+        GET_BLOCK_PROCESSING_STATS,
+        GET_DB_STATS,
+        GET_ALLOCATION_STATS,
+        TRACE,
         GET_TRANSACTIONS,
         GET_TRANSACTION_POOL,
         GET_TRANSACTION_POOL_HASHES,
@@ -2826,6 +3106,7 @@ using core_rpc_types = tools::type_list<
         HARD_FORK_INFO,
         IN_PEERS,
         IS_KEY_IMAGE_SPENT,
+        GET_SPENDING_TX,
         LOKINET_PING,
         MINING_STATUS,
         ONS_OWNERS_TO_NAMES,
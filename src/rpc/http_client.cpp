@@ -116,6 +116,11 @@ void http_client::copy_params_from(const http_client& other) {
     base_url = other.base_url;
     timeout = other.timeout;
     auth = other.auth;
+    proxy = other.proxy;
+    client_cert = other.client_cert;
+    verify_https = other.verify_https;
+    ca_info = other.ca_info;
+    apply_timeout = apply_auth = apply_proxy = apply_ssl = true;
 }
 
 nlohmann::json http_client::json_rpc(std::string_view method, nlohmann::json params) {
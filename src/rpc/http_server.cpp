@@ -2,13 +2,20 @@
 #include "http_server.h"
 
 #include <oxenc/variant.h>
+#include <zlib.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <exception>
+#include <limits>
+#include <optional>
 #include <variant>
 
+#include "common/alloc_profile.h"
 #include "common/command_line.h"
 #include "common/exception.h"
+#include "common/metrics.h"
 #include "common/string_util.h"
 #include "cryptonote_config.h"
 #include "cryptonote_core/cryptonote_core.h"
@@ -49,6 +56,13 @@ const command_line::arg_descriptor<uint16_t> http_server::arg_rpc_restricted_bin
 const command_line::arg_flag http_server::arg_restricted_rpc = {
         "restricted-rpc", "Deprecated, use --rpc-public instead"};
 
+const command_line::arg_descriptor<unsigned> http_server::arg_rpc_http_threads = {
+        "rpc-http-threads",
+        "Number of HTTP RPC event loop threads (each listening on all the --rpc-public/--rpc-admin "
+        "addresses) used to parse requests and send replies; the requests themselves are "
+        "processed by the general worker threads.",
+        1};
+
 // This option doesn't do anything anymore, but keep it here for now in case people added it to
 // config files/startup flags.
 const command_line::arg_flag http_server::arg_public_node = {
@@ -64,6 +78,7 @@ void http_server::init_options(
         boost::program_options::options_description& hidden) {
     command_line::add_arg(desc, arg_rpc_public);
     command_line::add_arg(desc, arg_rpc_admin);
+    command_line::add_arg(desc, arg_rpc_http_threads);
 
     command_line::add_arg(hidden, arg_rpc_bind_port);
     command_line::add_arg(hidden, arg_rpc_restricted_bind_port);
@@ -78,7 +93,8 @@ http_server::http_server(
         core_rpc_server& server,
         rpc_args rpc_config,
         bool restricted,
-        std::vector<std::tuple<std::string, uint16_t, bool>> bind) :
+        std::vector<std::tuple<std::string, uint16_t, bool>> bind,
+        unsigned threads) :
         m_server{server}, m_restricted{restricted} {
     // uWS is designed to work from a single thread, which is good (we pull off the requests and
     // then stick them into the OMQ job queue to be scheduled along with other jobs).  But as a
@@ -86,86 +102,110 @@ http_server::http_server(
     // (thread local) event loop pointer back from the thread so that we can shut it down later
     // (injecting a callback into it is one of the few thread-safe things we can do across threads).
     //
-    // Things we need in the owning thread, fulfilled from the http thread:
+    // To use more than one core for request parsing and reply encoding we run several such
+    // threads, each with its own uWS::App and endpoints, all listening on the same addresses
+    // (uSockets sets SO_REUSEPORT, so the kernel spreads incoming connections between them).
+    //
+    // Things we need in the owning thread, fulfilled from each http thread:
 
     // - the uWS::Loop* for the event loop thread (which is thread_local).  We can get this during
     //   thread startup, after the thread does basic initialization.
-    std::promise<uWS::Loop*> loop_promise;
-    auto loop_future = loop_promise.get_future();
-
+    //
     // - the us_listen_socket_t* on which the server is listening.  We can't get this until we
     //   actually start listening, so wait until `start()` for it.  (We also double-purpose it to
     //   send back an exception if one fires during startup).
-    std::promise<std::vector<us_listen_socket_t*>> startup_success_promise;
-    m_startup_success = startup_success_promise.get_future();
-
-    // Things we need to send from the owning thread to the event loop thread:
-    // - a signal when the thread should bind to the port and start the event loop (when we call
+    //
+    // Things we need to send from the owning thread to the event loop threads:
+    // - a signal when the threads should bind to the port and start the event loop (when we call
     //   start()).
     // m_startup_promise
 
-    m_rpc_thread = std::thread{
-            [this, rpc_config = std::move(rpc_config), bind = std::move(bind)](
-                    std::promise<uWS::Loop*> loop_promise,
-                    std::future<bool> startup_future,
-                    std::promise<std::vector<us_listen_socket_t*>> startup_success) {
-                uWS::App http;
-                try {
-                    create_rpc_endpoints(http);
-                } catch (...) {
-                    loop_promise.set_exception(std::current_exception());
-                    return;
-                }
-                loop_promise.set_value(uWS::Loop::get());
-                if (!startup_future.get())
-                    // False means cancel, i.e. we got destroyed/shutdown without start() being
-                    // called
-                    return;
+    m_login = rpc_config.login;
+    m_cors = {
+            rpc_config.access_control_origins.begin(), rpc_config.access_control_origins.end()};
+
+    m_bind = std::move(bind);
+
+    std::shared_future<bool> startup_future = m_startup_promise.get_future();
+    m_loops.resize(std::max(threads, 1u));
+    std::vector<std::future<uWS::Loop*>> loop_futures;
+    for (auto& l : m_loops) {
+        std::promise<uWS::Loop*> loop_promise;
+        loop_futures.push_back(loop_promise.get_future());
+        std::promise<std::vector<us_listen_socket_t*>> startup_success_promise;
+        l.startup_success = startup_success_promise.get_future();
+
+        l.thread = std::thread{
+                [this](
+                        std::promise<uWS::Loop*> loop_promise,
+                        std::shared_future<bool> startup_future,
+                        std::promise<std::vector<us_listen_socket_t*>> startup_success) {
+                    uWS::App http;
+                    try {
+                        create_rpc_endpoints(http);
+                    } catch (...) {
+                        loop_promise.set_exception(std::current_exception());
+                        return;
+                    }
+                    loop_promise.set_value(uWS::Loop::get());
+                    if (!startup_future.get())
+                        // False means cancel, i.e. we got destroyed/shutdown without start() being
+                        // called
+                        return;
 
-                m_login = rpc_config.login;
-
-                m_cors = {
-                        rpc_config.access_control_origins.begin(),
-                        rpc_config.access_control_origins.end()};
-
-                std::vector<us_listen_socket_t*> listening;
-                try {
-                    bool required_bind_failed = false;
-                    for (const auto& [addr, port, required] : bind)
-                        http.listen(
-                                addr,
-                                port,
-                                [&listening, req = required, &required_bind_failed](
-                                        us_listen_socket_t* sock) {
-                                    if (sock)
-                                        listening.push_back(sock);
-                                    else if (req)
-                                        required_bind_failed = true;
-                                });
-
-                    if (listening.empty() || required_bind_failed) {
-                        std::ostringstream error;
-                        error << "RPC HTTP server failed to bind; ";
-                        if (listening.empty())
-                            error << "no valid bind address(es) given";
-                        error << "tried to bind to:";
-                        for (const auto& [addr, port, required] : bind)
-                            error << ' ' << addr << ':' << port;
-                        throw oxen::traced<std::runtime_error>(error.str());
+                    std::vector<us_listen_socket_t*> listening;
+                    try {
+                        bool required_bind_failed = false;
+                        for (const auto& [addr, port, required] : m_bind)
+                            http.listen(
+                                    addr,
+                                    port,
+                                    [&listening, req = required, &required_bind_failed](
+                                            us_listen_socket_t* sock) {
+                                        if (sock)
+                                            listening.push_back(sock);
+                                        else if (req)
+                                            required_bind_failed = true;
+                                    });
+
+                        if (listening.empty() || required_bind_failed) {
+                            std::ostringstream error;
+                            error << "RPC HTTP server failed to bind; ";
+                            if (listening.empty())
+                                error << "no valid bind address(es) given";
+                            error << "tried to bind to:";
+                            for (const auto& [addr, port, required] : m_bind)
+                                error << ' ' << addr << ':' << port;
+                            throw oxen::traced<std::runtime_error>(error.str());
+                        }
+                    } catch (...) {
+                        for (auto* s : listening)
+                            us_listen_socket_close(/*ssl=*/false, s);
+                        startup_success.set_exception(std::current_exception());
+                        return;
                     }
-                } catch (...) {
-                    startup_success.set_exception(std::current_exception());
-                    return;
-                }
-                startup_success.set_value(std::move(listening));
+                    startup_success.set_value(std::move(listening));
 
-                http.run();
-            },
-            std::move(loop_promise),
-            m_startup_promise.get_future(),
-            std::move(startup_success_promise)};
+                    http.run();
+                },
+                std::move(loop_promise),
+                startup_future,
+                std::move(startup_success_promise)};
+    }
 
-    m_loop = loop_future.get();
+    std::exception_ptr failed;
+    for (size_t i = 0; i < m_loops.size(); i++) {
+        try {
+            m_loops[i].loop = loop_futures[i].get();
+        } catch (...) {
+            failed = std::current_exception();
+        }
+    }
+    if (failed) {
+        shutdown(true);
+        std::rethrow_exception(failed);
+    }
+    m_loop = m_loops.front().loop;
 }
 
 void http_server::create_rpc_endpoints(uWS::App& http) {
@@ -197,6 +237,16 @@ void http_server::create_rpc_endpoints(uWS::App& http) {
         handle_json_rpc_request(*res, *req);
     });
 
+    // Prometheus scrape endpoint; like the metrics RPC commands this is admin-only
+    if (m_restricted)
+        http.get("/metrics", access_denied);
+    else
+        http.get("/metrics", [this](HttpResponse* res, HttpRequest* req) {
+            if (m_login && !check_auth(*req, *res))
+                return;
+            handle_metrics_request(*res, *req);
+        });
+
     // Fallback to send a 404 for anything else:
     http.any("/*", [this](HttpResponse* res, HttpRequest* req) {
         if (m_login && !check_auth(*req, *res))
@@ -208,10 +258,14 @@ void http_server::create_rpc_endpoints(uWS::App& http) {
 
 namespace {
 
+    struct batch_data;
+
     struct call_data {
         http_server& http;
         core_rpc_server& core_rpc;
         HttpResponse& res;
+        // The event loop that owns `res`; all writes to it have to be deferred into this loop
+        uWS::Loop* loop{uWS::Loop::get()};
         std::string uri;
         const rpc_command* call{nullptr};
         rpc_request request{};
@@ -220,6 +274,14 @@ namespace {
         bool jsonrpc{false};
         nlohmann::json jsonrpc_id{nullptr};
         std::vector<std::pair<std::string, std::string>> extra_headers;  // Extra headers to send
+        // Overrides the json or binary Content-Type that the response for `call` would get
+        std::string_view content_type;
+        // True if the client sent an Accept-Encoding that allows a gzip-compressed response
+        bool accept_gzip{false};
+        // Set for the individual calls of a JSON RPC batch request: these don't reply themselves
+        // but hand their response to the batch, which replies once all of them are done.
+        std::shared_ptr<batch_data> batch;
+        size_t batch_index{0};
 
         call_data(
                 http_server& http,
@@ -232,11 +294,12 @@ namespace {
 
         // If we have to drop the request because we are overloaded we want to reply with an error
         // (so that we close the connection instead of leaking it and leaving it hanging).  We don't
-        // do this, of course, if the request got aborted and replied to.
+        // do this, of course, if the request got aborted and replied to.  (A dropped batch call
+        // leaves the batch incomplete, so the error gets sent when the batch request is destroyed).
         ~call_data() {
-            if (replied || aborted)
+            if (replied || aborted || batch)
                 return;
-            http.loop_defer([&http = http, &res = res, jsonrpc = jsonrpc] {
+            loop->defer([&http = http, &res = res, jsonrpc = jsonrpc] {
                 if (jsonrpc)
                     http.jsonrpc_error_response(
                             res, -32003, "Server busy, try again later", nullptr);
@@ -255,13 +318,17 @@ namespace {
 
         // Wrappers around .http.jsonrpc_error_response and .http.error_response that do nothing if
         // the request is already replied to, and otherwise set `replied` and forward everything
-        // passed in to http.<method>(...).
+        // passed in to http.<method>(...).  (For a batch call the JSON RPC error goes into the
+        // batch response instead).
         template <typename... T>
-        auto jsonrpc_error_response(T&&... args) {
+        void jsonrpc_error_response(HttpResponse& res, T&&... args) {
             if (replied || aborted)
                 return;
             replied = true;
-            return http.jsonrpc_error_response(std::forward<T>(args)...);
+            if (batch)
+                batch_reply(http_server::jsonrpc_error(std::forward<T>(args)...));
+            else
+                http.jsonrpc_error_response(res, std::forward<T>(args)...);
         }
         template <typename... T>
         auto error_response(T&&... args) {
@@ -270,33 +337,144 @@ namespace {
             replied = true;
             return http.error_response(std::forward<T>(args)...);
         }
+
+        void batch_reply(std::string body);
     };
 
-    // Queues a response for the HTTP thread to handle
+    // A JSON RPC batch request, i.e. an array of calls which we run independently (and so,
+    // potentially, in parallel on different workers).  The request's single response, an array of
+    // the individual responses, gets sent once the last of them finishes.
+    struct batch_data {
+        std::shared_ptr<call_data> request;
+        std::vector<std::string> responses;
+        std::atomic<size_t> remaining;
+
+        batch_data(std::shared_ptr<call_data> request, size_t size) :
+                request{std::move(request)}, responses(size), remaining{size} {}
+    };
+
+    // Returns true if an Accept-Encoding header value allows gzip
+    bool accepts_gzip(std::string_view accept_encoding) {
+        for (auto enc : tools::split(accept_encoding, ",")) {
+            std::string_view q;
+            if (auto pos = enc.find(';'); pos != std::string_view::npos) {
+                q = enc.substr(pos + 1);
+                enc = enc.substr(0, pos);
+                tools::trim(q);
+            }
+            tools::trim(enc);
+            // q=0 (or 0.0, etc.) means "not acceptable"
+            bool refused = q.starts_with("q=") && q.find_first_not_of("0.", 2) == q.npos;
+            if ((enc == "gzip"sv || enc == "*"sv) && !refused)
+                return true;
+        }
+        return false;
+    }
+
+    // Returns `body` gzip-compressed, or nullopt if compression fails or doesn't make it smaller.
+    std::optional<std::string> gzip_compress(std::string_view body) {
+        if (body.size() > std::numeric_limits<uInt>::max())
+            return std::nullopt;
+        z_stream zs{};
+        int r = deflateInit2(
+                &zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16 /*gzip*/, 8, Z_DEFAULT_STRATEGY);
+        if (r != Z_OK)
+            return std::nullopt;
+        std::string out;
+        out.resize(deflateBound(&zs, body.size()));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        zs.avail_in = body.size();
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = out.size();
+        r = deflate(&zs, Z_FINISH);
+        deflateEnd(&zs);
+        if (r != Z_STREAM_END || zs.total_out >= body.size())
+            return std::nullopt;
+        out.resize(zs.total_out);
+        return out;
+    }
+
+    // Queues a response for the HTTP thread to handle.  Compression, if accepted by the client,
+    // happens here, i.e. in the calling worker thread rather than in the HTTP thread.
     void queue_response(std::shared_ptr<call_data> data, std::string body) {
-        auto& http = data->http;
+        if (data->batch)
+            return data->batch_reply(std::move(body));
+        bool gzipped = false;
+        if (data->accept_gzip && body.size() >= http_server::MIN_GZIP_SIZE) {
+            if (auto compressed = gzip_compress(body)) {
+                body = std::move(*compressed);
+                gzipped = true;
+            }
+        }
+        auto* loop = data->loop;
         data->replied = true;
-        http.loop_defer([data = std::move(data), body = std::move(body)] {
+        loop->defer([data = std::move(data), body = std::move(body), gzipped]() mutable {
             if (data->aborted)
                 return;
-            data->res.cork([data = std::move(data), body = std::move(body)] {
+            data->res.cork([data = std::move(data), body = std::move(body), gzipped]() mutable {
                 auto& res = data->res;
                 res.writeHeader("Server", data->http.server_header());
                 res.writeHeader(
                         "Content-Type",
-                        data->call->is_binary ? "application/octet-stream"sv
-                                              : "application/json"sv);
+                        !data->content_type.empty() ? data->content_type
+                        : data->call->is_binary     ? "application/octet-stream"sv
+                                                    : "application/json"sv);
+                if (gzipped)
+                    res.writeHeader("Content-Encoding", "gzip");
+                if (data->accept_gzip)
+                    res.writeHeader("Vary", "Accept-Encoding");
                 if (data->http.closing())
                     res.writeHeader("Connection", "close");
                 for (const auto& [name, value] : data->extra_headers)
                     res.writeHeader(name, value);
-                res.end(body);
-                if (data->http.closing())
-                    res.close();
+                if (body.size() <= http_server::RESPONSE_CHUNK_SIZE) {
+                    res.end(body);
+                    if (data->http.closing())
+                        res.close();
+                    return;
+                }
+                // For a large response we only hand uWS as much as the socket will currently take,
+                // and feed it the rest as the socket becomes writable, rather than having it copy
+                // whatever doesn't fit straight away into its own backpressure buffer.
+                auto write = [data, body = std::make_shared<std::string>(std::move(body)),
+                              start = res.getWriteOffset()](uintmax_t) {
+                    auto& res = data->res;
+                    for (;;) {
+                        std::string_view remaining{*body};
+                        remaining.remove_prefix(res.getWriteOffset() - start);
+                        auto [ok, done] = res.tryEnd(
+                                remaining.substr(0, http_server::RESPONSE_CHUNK_SIZE),
+                                body->size());
+                        if (done) {
+                            if (data->http.closing())
+                                res.close();
+                            return true;
+                        }
+                        if (!ok)
+                            return false;  // Wait for the socket to become writable again
+                    }
+                };
+                res.onWritable(write);
+                write(0);
             });
         });
     }
 
+    void call_data::batch_reply(std::string body) {
+        replied = true;
+        batch->responses[batch_index] = std::move(body);
+        if (--batch->remaining > 0)
+            return;
+        std::string response = "[";
+        for (auto& r : batch->responses) {
+            if (response.size() > 1)
+                response += ',';
+            response += r;
+        }
+        response += ']';
+        queue_response(std::move(batch->request), std::move(response));
+    }
+
     void invoke_txpool_hashes_bin(std::shared_ptr<call_data> data);
 
     // Invokes the actual RPC request; this is called (via oxenmq) from some random OMQ worker
@@ -304,7 +482,7 @@ namespace {
     // loop.
     void invoke_rpc(std::shared_ptr<call_data> dataptr) {
         auto& data = *dataptr;
-        if (data.aborted)
+        if (data.aborted || (data.batch && data.batch->request->aborted))
             return;
 
         // Replace the default tx pool hashes callback with our own (which adds long poll support):
@@ -325,7 +503,11 @@ namespace {
         std::string result;
         try {
             auto r = data.call->invoke(std::move(data.request), data.core_rpc);
-            if (data.jsonrpc)
+            if (data.jsonrpc && std::holds_alternative<std::string>(r))
+                // Already-encoded json (i.e. a cached response), so just wrap it up
+                result = R"({{"jsonrpc":"2.0","id":{},"result":{}}})"_format(
+                        data.jsonrpc_id.dump(), var::get<std::string>(r));
+            else if (data.jsonrpc)
                 result =
                         nlohmann::json{
                                 {"jsonrpc", "2.0"},
@@ -362,7 +544,7 @@ namespace {
         }
 
         if (json_error != 0) {
-            data.http.loop_defer([data = std::move(dataptr),
+            data.loop->defer([data = std::move(dataptr),
                                   json_error,
                                   msg = std::move(data.jsonrpc ? json_message : http_message),
                                   json_err_data = std::move(json_error_data)]() mutable {
@@ -424,43 +606,49 @@ namespace {
         if (!epee::serialization::load_t_from_binary(req, body))
             throw parse_error{"Failed to parse binary data parameters"};
 
+        if (!req.long_poll) {
+            // Not a long poll, so just a regular request (which might be incremental)
+            auto res = data->core_rpc.invoke(std::move(req), data->request.context);
+            std::string response;
+            epee::serialization::store_t_to_binary(res, response);
+            queue_response(std::move(data), std::move(response));
+            return;
+        }
+
         std::vector<crypto::hash> pool_hashes;
         data->core_rpc.get_core().mempool.get_transaction_hashes(
                 pool_hashes,
                 data->request.context.admin,
                 req.blinked_txs_only /*include_only_blinked*/);
 
-        if (req.long_poll) {
-            crypto::hash checksum{};
-            for (const auto& h : pool_hashes)
-                checksum ^= h;
-
-            if (req.tx_pool_checksum == checksum) {
-                // Hashes match, which means we need to defer this request until later.
-                std::lock_guard lock{long_poll_mutex};
-                log::trace(
-                        logcat,
-                        "Deferring long poll request from {}: long polling requested and remote's "
-                        "checksum matches current pool ({})",
-                        data->request.context.remote,
-                        checksum);
-                long_pollers.emplace_back(
-                        std::move(data),
-                        std::chrono::steady_clock::now() +
-                                GET_TRANSACTION_POOL_HASHES_BIN::long_poll_timeout);
-                return;
-            }
+        crypto::hash checksum{};
+        for (const auto& h : pool_hashes)
+            checksum ^= h;
 
+        if (req.tx_pool_checksum == checksum) {
+            // Hashes match, which means we need to defer this request until later.
+            std::lock_guard lock{long_poll_mutex};
             log::trace(
                     logcat,
-                    "Ignoring long poll request from {}: pool hash mismatch (remote: {}, local: "
-                    "{})",
+                    "Deferring long poll request from {}: long polling requested and remote's "
+                    "checksum matches current pool ({})",
                     data->request.context.remote,
-                    req.tx_pool_checksum,
                     checksum);
+            long_pollers.emplace_back(
+                    std::move(data),
+                    std::chrono::steady_clock::now() +
+                            GET_TRANSACTION_POOL_HASHES_BIN::long_poll_timeout);
+            return;
         }
 
-        // Either not a long poll request or checksum didn't match
+        log::trace(
+                logcat,
+                "Ignoring long poll request from {}: pool hash mismatch (remote: {}, local: "
+                "{})",
+                data->request.context.remote,
+                req.tx_pool_checksum,
+                checksum);
+
         queue_response(std::move(data), pool_hashes_response(std::move(pool_hashes)));
     }
 
@@ -537,6 +725,113 @@ namespace {
                     long_pollers.size());
     }
 
+    // Sets up `data` to invoke the JSON RPC call `jsonrpc`, returning the method name, or replies
+    // with an error (and returns nullopt) if the call is invalid or not allowed.
+    std::optional<std::string> prepare_jsonrpc_call(
+            call_data& data, nlohmann::json& jsonrpc, bool restricted) {
+        if (!jsonrpc.is_object()) {
+            log::info(
+                    logcat,
+                    "Invalid JSON RPC request from {}: request is not an object",
+                    data.request.context.remote);
+            data.jsonrpc_error_response(data.res, -32600, "Invalid Request", nullptr);
+            return std::nullopt;
+        }
+
+        data.jsonrpc_id = std::move(jsonrpc["id"]);
+        std::string method;
+        try {
+            method = jsonrpc["method"].get<std::string>();
+        } catch (const std::exception& e) {
+            log::info(
+                    logcat,
+                    "Invalid JSON RPC request from {}: no 'method' in request",
+                    data.request.context.remote);
+            data.jsonrpc_error_response(data.res, -32600, "Invalid Request", data.jsonrpc_id);
+            return std::nullopt;
+        }
+
+        if (auto it = rpc_commands.find(method);
+            it != rpc_commands.end() && !it->second->is_binary)
+            data.call = it->second.get();
+        else {
+            log::info(
+                    logcat,
+                    "Invalid JSON RPC request from {}: method '{}' is invalid",
+                    data.request.context.remote,
+                    method);
+            data.jsonrpc_error_response(data.res, -32601, "Method not found", data.jsonrpc_id);
+            return std::nullopt;
+        }
+
+        if (restricted && !data.call->is_public) {
+            log::warning(
+                    logcat,
+                    "Invalid JSON RPC request from {}: method '{}' is restricted",
+                    data.request.context.remote,
+                    method);
+            data.jsonrpc_error_response(
+                    data.res,
+                    403,
+                    "Forbidden; this command is not available over public RPC",
+                    data.jsonrpc_id);
+            return std::nullopt;
+        }
+
+        log::debug(
+                logcat,
+                "Incoming JSON RPC request for {} from {}",
+                method,
+                data.request.context.remote);
+
+        if (auto it = jsonrpc.find("params"); it != jsonrpc.end())
+            data.request.body = std::move(*it);
+
+        return method;
+    }
+
+    // Injects a task into OMQ's `cat` category, keeping count of the tasks queued (OxenMQ doesn't
+    // expose its queue depths) for the metrics endpoint.
+    void inject_rpc_task(
+            oxenmq::OxenMQ& omq,
+            std::string cat,
+            std::string cmd,
+            std::string remote,
+            std::function<void()> task) {
+        static auto& rpc_queued = tools::metrics::global().add_gauge(
+                "oxen_rpc_queued_tasks",
+                "HTTP RPC requests waiting for an OMQ worker",
+                {{"category", "rpc"}});
+        static auto& admin_queued = tools::metrics::global().add_gauge(
+                "oxen_rpc_queued_tasks",
+                "HTTP RPC requests waiting for an OMQ worker",
+                {{"category", "admin"}});
+        auto& queued = cat == "admin" ? admin_queued : rpc_queued;
+        queued.inc();
+        omq.inject_task(
+                std::move(cat),
+                std::move(cmd),
+                std::move(remote),
+                [&queued, task = std::move(task)] {
+                    queued.dec();
+                    OXEN_ALLOC_SCOPE("rpc");
+                    task();
+                });
+    }
+
+    // Queues a prepared JSON RPC call to be invoked by an OMQ worker
+    void queue_jsonrpc_call(std::shared_ptr<call_data> data, std::string_view method) {
+        auto& omq = data->core_rpc.get_core().omq();
+        std::string cat{data->call->is_public ? "rpc" : "admin"};
+        std::string cmd{"jsonrpc:"};  // Used for OMQ job logging; prefixed with jsonrpc: so we can
+        cmd += method;                // distinguish it
+        std::string remote{data->request.context.remote};
+        inject_rpc_task(
+                omq, std::move(cat), std::move(cmd), std::move(remote), [data = std::move(data)] {
+                    invoke_rpc(std::move(data));
+                });
+    }
+
 }  // anonymous namespace
 
 void http_server::handle_base_request(
@@ -548,6 +843,7 @@ void http_server::handle_base_request(
     request.context.source = rpc_source::http;
     request.context.remote = get_remote_address(res);
     handle_cors(req, data->extra_headers);
+    data->accept_gzip = accepts_gzip(req.getHeader("accept-encoding"));
     log::trace(
             logcat,
             "Received {} {} request from {}",
@@ -571,8 +867,8 @@ void http_server::handle_base_request(
         std::string cmd{"http:" + data->uri};  // Used for OMQ job logging; prefixed with http: so
                                                // we can distinguish it
         std::string remote{data->request.context.remote};
-        omq.inject_task(
-                std::move(cat), std::move(cmd), std::move(remote), [data = std::move(data)] {
+        inject_rpc_task(
+                omq, std::move(cat), std::move(cmd), std::move(remote), [data = std::move(data)] {
                     invoke_rpc(std::move(data));
                 });
     });
@@ -586,6 +882,7 @@ void http_server::handle_json_rpc_request(HttpResponse& res, HttpRequest& req) {
     request.context.source = rpc_source::http;
     request.context.remote = get_remote_address(res);
     handle_cors(req, data->extra_headers);
+    data->accept_gzip = accepts_gzip(req.getHeader("accept-encoding"));
 
     res.onAborted([data] { data->aborted = true; });
     res.onData([buffer = ""s, data, restricted = m_restricted](
@@ -608,63 +905,57 @@ void http_server::handle_json_rpc_request(HttpResponse& res, HttpRequest& req) {
             return data->jsonrpc_error_response(data->res, -32700, "Parse error", nullptr);
         }
 
-        data->jsonrpc_id = std::move(jsonrpc["id"]);
-        const std::string* method;
-        try {
-            method = &jsonrpc["method"].get_ref<const std::string&>();
-        } catch (const std::exception& e) {
-            log::info(
-                    logcat,
-                    "Invalid JSON RPC request from {}: no 'method' in request",
-                    data->request.context.remote);
-            return data->jsonrpc_error_response(
-                    data->res, -32600, "Invalid Request", data->jsonrpc_id);
+        if (!jsonrpc.is_array()) {
+            if (auto method = prepare_jsonrpc_call(*data, jsonrpc, restricted))
+                queue_jsonrpc_call(std::move(data), *method);
+            return;
         }
 
-        if (auto it = rpc_commands.find(*method);
-            it != rpc_commands.end() && !it->second->is_binary)
-            data->call = it->second.get();
-        else {
+        // A batch: each call is prepared and queued separately, and the batch replies with all of
+        // their responses once the last one finishes.
+        if (jsonrpc.empty() || jsonrpc.size() > http_server::MAX_JSONRPC_BATCH) {
             log::info(
                     logcat,
-                    "Invalid JSON RPC request from {}: method '{}' is invalid",
+                    "Invalid JSON RPC request from {}: invalid batch size {}",
                     data->request.context.remote,
-                    *method);
-            return data->jsonrpc_error_response(
-                    data->res, -32601, "Method not found", data->jsonrpc_id);
+                    jsonrpc.size());
+            return data->jsonrpc_error_response(data->res, -32600, "Invalid Request", nullptr);
         }
-
-        if (restricted && !data->call->is_public) {
-            log::warning(
-                    logcat,
-                    "Invalid JSON RPC request from {}: method '{}' is restricted",
-                    data->request.context.remote,
-                    *method);
-            return data->jsonrpc_error_response(
-                    data->res,
-                    403,
-                    "Forbidden; this command is not available over public RPC",
-                    data->jsonrpc_id);
+        auto batch = std::make_shared<batch_data>(data, jsonrpc.size());
+        for (size_t i = 0; i < jsonrpc.size(); i++) {
+            auto call =
+                    std::make_shared<call_data>(data->http, data->core_rpc, data->res, data->uri);
+            call->jsonrpc = true;
+            call->request.context = data->request.context;
+            call->batch = batch;
+            call->batch_index = i;
+            if (auto method = prepare_jsonrpc_call(*call, jsonrpc[i], restricted))
+                queue_jsonrpc_call(std::move(call), *method);
         }
+    });
+}
 
-        log::debug(
-                logcat,
-                "Incoming JSON RPC request for {} from {}",
-                *method,
-                data->request.context.remote);
-
-        if (auto it = jsonrpc.find("params"); it != jsonrpc.end())
-            data->request.body = *it;
+void http_server::handle_metrics_request(HttpResponse& res, HttpRequest& req) {
+    auto data = std::make_shared<call_data>(*this, m_server, res, std::string{req.getUrl()});
+    data->content_type = "text/plain; version=0.0.4"sv;
+    data->request.context.remote = get_remote_address(res);
+    data->accept_gzip = accepts_gzip(req.getHeader("accept-encoding"));
+    res.onAborted([data] { data->aborted = true; });
 
-        auto& omq = data->core_rpc.get_core().omq();
-        std::string cat{data->call->is_public ? "rpc" : "admin"};
-        std::string cmd{"jsonrpc:" + *method};  // Used for OMQ job logging; prefixed with jsonrpc:
-                                                // so we can distinguish it
-        std::string remote{data->request.context.remote};
-        omq.inject_task(
-                std::move(cat), std::move(cmd), std::move(remote), [data = std::move(data)] {
-                    invoke_rpc(std::move(data));
-                });
+    auto& omq = m_server.get_core().omq();
+    std::string remote{data->request.context.remote};
+    inject_rpc_task(omq, "admin", "http:/metrics", std::move(remote), [data = std::move(data)] {
+        if (data->aborted)
+            return;
+        std::string metrics;
+        try {
+            metrics = data->core_rpc.prometheus_metrics();
+        } catch (const std::exception& e) {
+            log::warning(logcat, "HTTP metrics request raised an exception: {}", e.what());
+            data->loop->defer([data] { data->error_response(data->res, http_server::HTTP_ERROR); });
+            return;
+        }
+        queue_response(std::move(data), std::move(metrics));
     });
 }
 
@@ -681,7 +972,18 @@ void http_server::start() {
 
     m_startup_promise.set_value(true);
     m_sent_startup = true;
-    m_listen_socks = m_startup_success.get();
+    std::exception_ptr failed;
+    for (auto& l : m_loops) {
+        try {
+            l.listen_socks = l.startup_success.get();
+        } catch (...) {
+            failed = std::current_exception();
+        }
+    }
+    if (failed) {
+        shutdown(true);
+        std::rethrow_exception(failed);
+    }
 
     auto& omq = m_server.get_core().omq();
     if (timer_started.insert(&omq).second)
@@ -689,7 +991,7 @@ void http_server::start() {
 }
 
 void http_server::shutdown(bool join) {
-    if (!m_rpc_thread.joinable())
+    if (std::none_of(m_loops.begin(), m_loops.end(), [](auto& l) { return l.thread.joinable(); }))
         return;
 
     if (!m_sent_shutdown) {
@@ -697,22 +999,26 @@ void http_server::shutdown(bool join) {
         if (!m_sent_startup) {
             m_startup_promise.set_value(false);
             m_sent_startup = true;
-        } else if (!m_listen_socks.empty()) {
-            loop_defer([this] {
-                log::trace(logcat, "closing {} listening sockets", m_listen_socks.size());
-                for (auto* s : m_listen_socks)
+        }
+        m_closing = true;
+        for (auto& l : m_loops) {
+            if (l.listen_socks.empty())
+                continue;
+            l.loop->defer([&l] {
+                log::trace(logcat, "closing {} listening sockets", l.listen_socks.size());
+                for (auto* s : l.listen_socks)
                     us_listen_socket_close(/*ssl=*/false, s);
-                m_listen_socks.clear();
-
-                m_closing = true;
+                l.listen_socks.clear();
 
                 {
                     // Destroy any pending long poll connections as well
                     log::trace(logcat, "closing pending long poll requests");
                     std::lock_guard lock{long_poll_mutex};
                     for (auto it = long_pollers.begin(); it != long_pollers.end();) {
-                        if (&it->first->http != this)
-                            continue;  // Belongs to some other http_server instance
+                        if (it->first->loop != l.loop) {
+                            ++it;
+                            continue;  // Belongs to some other event loop
+                        }
                         it->first->aborted = true;
                         it->first->res.close();
                         it = long_pollers.erase(it);
@@ -723,9 +1029,11 @@ void http_server::shutdown(bool join) {
         m_sent_shutdown = true;
     }
 
-    log::trace(logcat, "joining rpc thread");
+    log::trace(logcat, "joining rpc threads");
     if (join)
-        m_rpc_thread.join();
+        for (auto& l : m_loops)
+            if (l.thread.joinable())
+                l.thread.join();
     log::trace(logcat, "done shutdown");
 }
 
@@ -46,6 +46,7 @@ class http_server : public http_server_base {
   public:
     static const command_line::arg_descriptor<std::vector<std::string>> arg_rpc_public;
     static const command_line::arg_descriptor<std::vector<std::string>> arg_rpc_admin;
+    static const command_line::arg_descriptor<unsigned> arg_rpc_http_threads;
 
     // Deprecated:
     static const command_line::arg_descriptor<uint16_t> arg_rpc_bind_port;
@@ -53,6 +54,14 @@ class http_server : public http_server_base {
     static const command_line::arg_flag arg_restricted_rpc;
     static const command_line::arg_flag arg_public_node;
 
+    // The maximum number of calls accepted in a single JSON RPC batch request
+    static constexpr size_t MAX_JSONRPC_BATCH = 1000;
+    // Responses larger than this are written in pieces of (at most) this size as the connection
+    // becomes writable rather than all at once.
+    static constexpr size_t RESPONSE_CHUNK_SIZE = 256 * 1024;
+    // Responses at least this large are gzip-compressed if the client's Accept-Encoding allows it
+    static constexpr size_t MIN_GZIP_SIZE = 1024;
+
     static void init_options(
             boost::program_options::options_description& desc,
             boost::program_options::options_description& hidden);
@@ -61,19 +70,19 @@ class http_server : public http_server_base {
             core_rpc_server& server,
             rpc_args rpc_config,
             bool restricted,
-            std::vector<std::tuple<std::string, uint16_t, bool>> bind  // {IP,port,required}
-    );
+            std::vector<std::tuple<std::string, uint16_t, bool>> bind,  // {IP,port,required}
+            unsigned threads = 1);
 
     ~http_server() override;
 
-    /// Starts the event loop in the thread handling http requests.  Core must have been initialized
-    /// and OxenMQ started.  Will propagate an exception from the thread if startup fails.
+    /// Starts the event loop in the thread(s) handling http requests.  Core must have been
+    /// initialized and OxenMQ started.  Will propagate an exception from the thread if startup fails.
     void start();
 
     /// Closes the http server connection.  Can safely be called multiple times, or to abort a
     /// startup if called before start().
     ///
-    /// \param join - if true, wait for the proxy thread to exit.  If false then joining will occur
+    /// \param join - if true, wait for the http threads to exit.  If false then joining will occur
     /// during destruction.
     void shutdown(bool join = false);
 
@@ -88,15 +97,32 @@ class http_server : public http_server_base {
     /// Handles a POST request to /json_rpc.
     void handle_json_rpc_request(HttpResponse& res, HttpRequest& req);
 
+    /// Handles a GET request to /metrics, replying with core_rpc_server::prometheus_metrics().
+    void handle_metrics_request(HttpResponse& res, HttpRequest& req);
+
     // The core rpc server which handles the internal requests
     core_rpc_server& m_server;
-    // A promise we send from outside into the event loop thread to signal it to start.  We sent
-    // "true" to go ahead with binding + starting the event loop, or false to abort.
+    // A promise we send from outside into the event loop threads to signal them to start.  We sent
+    // "true" to go ahead with binding + starting the event loops, or false to abort.
     std::promise<bool> m_startup_promise;
-    // A future (promise held by the thread) that delivers us the listening uSockets sockets so
-    // that, when we want to shut down, we can tell uWebSockets to close them (which will then run
-    // off the end of the event loop).  This also doubles to propagate listen exceptions back to us.
-    std::future<std::vector<us_listen_socket_t*>> m_startup_success;
+    struct event_loop {
+        // The loop, for injecting callbacks into it
+        uWS::Loop* loop{nullptr};
+        // A future (promise held by the thread) that delivers us the listening uSockets sockets so
+        // that, when we want to shut down, we can tell uWebSockets to close them (which will then
+        // run off the end of the event loop).  This also doubles to propagate listen exceptions
+        // back to us.
+        std::future<std::vector<us_listen_socket_t*>> startup_success;
+        // The sockets this loop is listening on; only accessed from inside the loop once running.
+        std::vector<us_listen_socket_t*> listen_socks;
+        std::thread thread;
+    };
+    // The event loops, one per thread, each with its own copy of the endpoints and its own
+    // listening sockets on every bind address.  (We don't use the base class's single-loop
+    // m_rpc_thread/m_listen_socks; m_loop is the first of these).
+    std::vector<event_loop> m_loops;
+    // The addresses every loop listens on
+    std::vector<std::tuple<std::string, uint16_t, bool>> m_bind;
     // Whether we have sent the startup/shutdown signals
     bool m_sent_startup{false}, m_sent_shutdown{false};
     // Whether this is restricted, i.e. public.  Unrestricted allows admin commands.
@@ -8,6 +8,7 @@
 #include <oxenmq/fmt.h>
 #include <oxenmq/oxenmq.h>
 
+#include "common/alloc_profile.h"
 #include "common/string_util.h"
 #include "cryptonote_config.h"
 #include "rpc/common/param_parser.hpp"
@@ -242,6 +243,7 @@ omq_rpc::omq_rpc(
                     if (!m.data.empty())
                         request.body = m.data[0];
 
+                    OXEN_ALLOC_SCOPE("rpc");
                     try {
                         auto result = var::visit(
                                 [](auto&& v) -> std::string {
@@ -317,6 +319,7 @@ omq_rpc::omq_rpc(
     // The "subscribe" category is for public subscriptions; i.e. anyone on a public RPC node,
     // or anyone on a private RPC node with public access level.
     omq.add_category("sub", AuthLevel::basic);
+    notify_thread_ = omq.add_tagged_thread("rpc notify");
 
     omq.add_request_command(
             "sub", "mempool", [this](oxenmq::Message& m) { on_mempool_sub_request(m); });
@@ -324,10 +327,40 @@ omq_rpc::omq_rpc(
     omq.add_request_command(
             "sub", "block", [this](oxenmq::Message& m) { on_block_sub_request(m); });
 
+    omq.add_request_command("sub", "service_nodes", [this](oxenmq::Message& m) {
+        on_service_nodes_sub_request(m);
+    });
+
+    omq.add_request_command(
+            "sub", "blocks", [this](oxenmq::Message& m) { on_blocks_sub_request(m); });
+
     core_.blockchain.hook_block_post_add([this](const auto& info) {
         send_block_notifications(info.block);
+        send_service_nodes_notifications(info.block);
         return true;
     });
+    // Wallets syncing over rpc.get_blocks mostly ask for the newest blocks, so once anyone is
+    // using it we encode new blocks as they arrive rather than on the first request for them.
+    core_.blockchain.hook_block_post_add([this](const auto& info) {
+        {
+            std::lock_guard lock{block_cache_mutex_};
+            if (block_cache_.empty())
+                return;
+        }
+        try {
+            cache_encoded_block(
+                    info.block.get_height(), cryptonote::get_block_hash(info.block), info.block);
+        } catch (const std::exception& e) {
+            log::debug(logcat, "Not caching new block for rpc.get_blocks: {}", e.what());
+        }
+    });
+    core_.blockchain.hook_blockchain_detached([this](const auto& info) {
+        std::lock_guard lock{block_cache_mutex_};
+        for (auto it = block_cache_.lower_bound(info.height); it != block_cache_.end();) {
+            block_cache_bytes_ -= it->second.encoded.size();
+            it = block_cache_.erase(it);
+        }
+    });
     core_.mempool.add_notify([this](const crypto::hash& id,
                                     const transaction& tx,
                                     const std::string& blob,
@@ -336,66 +369,228 @@ omq_rpc::omq_rpc(
     });
 }
 
-template <typename Mutex, typename Subs, typename Call>
-static void send_notifies(Mutex& mutex, Subs& subs, const char* desc, Call call) {
-    std::vector<oxenmq::ConnectionID> remove;
+template <typename Subs, typename Want>
+void omq_rpc::send_notifies(
+        Subs& subs, const char* desc, std::vector<std::string> message, Want want) {
+    std::vector<queued_notify> sends;
+    bool expired = false;
     {
-        std::shared_lock lock{mutex};
+        std::shared_lock lock{subs_mutex_};
 
         if (subs.empty())
             return;
 
+        auto msg = std::make_shared<const std::vector<std::string>>(std::move(message));
         auto now = std::chrono::steady_clock::now();
-
-        for (const auto& sub_pair : subs) {
-            auto& conn = sub_pair.first;
-            auto& sub = sub_pair.second;
-            if (sub.expiry < now) {
-                remove.push_back(conn);
-                continue;
-            } else {
-                call(conn, sub);
-            }
+        sends.reserve(subs.size());
+        for (const auto& [conn, sub] : subs) {
+            if (sub.expiry < now)
+                expired = true;
+            else if (want(sub))
+                sends.push_back({conn, msg, nullptr});
         }
     }
 
-    if (remove.empty())
-        return;
-    std::unique_lock lock{mutex};
+    queue_notifies(std::move(sends));
+
+    if (expired)
+        core_.omq().job([this, &subs, desc] { remove_expired(subs, desc); }, *notify_thread_);
+}
+
+void omq_rpc::queue_notifies(std::vector<queued_notify> sends) {
+    auto& omq = core_.omq();
+    for (size_t i = 0; i < sends.size(); i += NOTIFY_BATCH_SIZE) {
+        auto begin = std::make_move_iterator(sends.begin() + i);
+        auto end = std::make_move_iterator(
+                sends.begin() + std::min(sends.size(), i + NOTIFY_BATCH_SIZE));
+        omq.job(
+                [&omq, batch = std::vector(begin, end)] {
+                    for (const auto& [conn, msg, pending] : batch) {
+                        omq.send(
+                                conn,
+                                msg->front(),
+                                oxenmq::send_option::data_parts(msg->begin() + 1, msg->end()));
+                        if (pending)
+                            --*pending;
+                    }
+                },
+                *notify_thread_);
+    }
+}
+
+template <typename Subs>
+void omq_rpc::remove_expired(Subs& subs, const char* desc) {
+    std::unique_lock lock{subs_mutex_};
     auto now = std::chrono::steady_clock::now();
-    for (auto& conn : remove) {
-        auto it = subs.find(conn);
-        if (it != subs.end() &&
-            it->second.expiry <
-                    now /* recheck: client might have resubscribed in between locks */) {
+    for (auto it = subs.begin(); it != subs.end();) {
+        // Recheck: the client might have resubscribed since the notification that queued this
+        if (it->second.expiry < now) {
             log::debug(
                     logcat,
                     "Removing {} from {} subscriptions: subscription timed out",
-                    conn,
+                    it->first,
                     desc);
-            subs.erase(it);
+            it = subs.erase(it);
+        } else {
+            ++it;
         }
     }
 }
 
 void omq_rpc::send_block_notifications(const block& block) {
+    send_notifies(
+            block_subs_,
+            "block",
+            {"notify.block",
+             "{}"_format(block.get_height()),
+             std::string{tools::view_guts(block.hash)}},
+            [](auto&) { return true; });
+
+    {
+        std::unique_lock lock{subs_mutex_};
+        if (blocks_subs_.empty())
+            return;
+        // If this block replaces ones we already pushed (i.e. we reorged) then go back and push
+        // the new chain from here.
+        for (auto& [conn, sub] : blocks_subs_)
+            sub.next_height = std::min(sub.next_height, block.get_height());
+    }
+    // We're called with the blockchain locked, so push from the notify thread instead
+    core_.omq().job([this] { push_blocks(); }, *notify_thread_);
+}
+
+void omq_rpc::push_blocks() {
+    std::lock_guard push_lock{blocks_push_mutex_};
+    auto chain_height = core_.blockchain.get_current_blockchain_height();
+
+    std::vector<std::tuple<oxenmq::ConnectionID, uint64_t, uint64_t>> pushes;
+    {
+        std::unique_lock lock{subs_mutex_};
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = blocks_subs_.begin(); it != blocks_subs_.end();) {
+            auto& [conn, sub] = *it;
+            if (sub.expiry < now) {
+                log::debug(
+                        logcat,
+                        "Removing {} from blocks subscriptions: subscription timed out",
+                        conn);
+                it = blocks_subs_.erase(it);
+                continue;
+            }
+            auto end = std::min(chain_height, sub.limit);
+            if (sub.next_height < end) {
+                pushes.emplace_back(conn, sub.next_height, end);
+                sub.next_height = end;
+            }
+            ++it;
+        }
+    }
+
     auto& omq = core_.omq();
-    std::string height = "{}"_format(block.get_height());
-    send_notifies(subs_mutex_, block_subs_, "block", [&](auto& conn, auto& /*sub*/) {
-        omq.send(conn, "notify.block", height, tools::view_guts(block.hash));
+    for (auto& [conn, from, to] : pushes) {
+        for (auto height = from; height < to; height++) {
+            try {
+                omq.send(conn, "notify.blocks", get_encoded_block(height));
+            } catch (const std::runtime_error& e) {
+                log::warning(logcat, "Failed to push block {} to {}: {}", height, conn, e.what());
+                break;
+            }
+        }
+    }
+}
+
+void omq_rpc::send_service_nodes_notifications(const block& block) {
+    {
+        std::shared_lock lock{subs_mutex_};
+        if (service_nodes_subs_.empty())
+            return;
+    }
+
+    uint64_t block_height = block.get_height();
+    std::string height = "{}"_format(block_height);
+    std::optional<std::string> delta_data;
+    if (auto delta = core_.service_node_list.get_block_delta(block_height, block.hash)) {
+        auto pubkey_list = [](const std::vector<crypto::public_key>& pubkeys) {
+            oxenc::bt_list l;
+            for (const auto& pk : pubkeys)
+                l.emplace_back(std::string{tools::view_guts(pk)});
+            return l;
+        };
+        oxenc::bt_list swarms;
+        for (const auto& [pk, swarm] : delta->swarm_changed)
+            swarms.emplace_back(oxenc::bt_list{std::string{tools::view_guts(pk)}, swarm});
+        delta_data = oxenc::bt_serialize(oxenc::bt_dict{
+                {"added", pubkey_list(delta->added)},
+                {"changed", pubkey_list(delta->changed)},
+                {"removed", pubkey_list(delta->removed)},
+                {"state", pubkey_list(delta->state_changed)},
+                {"swarm", std::move(swarms)}});
+    }
+
+    std::vector<std::string> message{
+            "notify.service_nodes",
+            std::move(height),
+            std::string{tools::view_guts(block.hash)},
+            std::string{tools::view_guts(block.prev_id)}};
+    if (delta_data)
+        message.push_back(std::move(*delta_data));
+    send_notifies(service_nodes_subs_, "service_nodes", std::move(message), [](auto&) {
+        return true;
     });
 }
 
 void omq_rpc::send_mempool_notifications(
         const crypto::hash& id,
-        const transaction& /*tx*/,
+        const transaction& tx,
         const std::string& blob,
         const tx_pool_options& opts) {
-    auto& omq = core_.omq();
-    send_notifies(subs_mutex_, mempool_subs_, "mempool", [&](auto& conn, auto& sub) {
-        if (sub.type == mempool_sub_type::all || opts.approved_blink)
-            omq.send(conn, "notify.mempool", tools::view_guts(id), blob);
-    });
+    if (!has_subs(mempool_subs_))
+        return;
+
+    auto fee = "{}"_format(get_tx_miner_fee(
+            tx, core_.blockchain.get_network_version() >= feature::FEE_BURNING));
+    auto weight = "{}"_format(get_transaction_weight(tx, blob.size()));
+    std::string txid{tools::view_guts(id)};
+    // Built on first use, as with no full subscribers we don't need the copy of the blob
+    std::shared_ptr<const std::vector<std::string>> full, compact;
+
+    std::vector<queued_notify> sends;
+    bool expired = false;
+    {
+        std::shared_lock lock{subs_mutex_};
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& [conn, sub] : mempool_subs_) {
+            if (sub.expiry < now) {
+                expired = true;
+                continue;
+            }
+            if (!(sub.type == mempool_sub_type::all || opts.approved_blink))
+                continue;
+            // A subscriber falling behind gets the compact form, and then nothing, rather than
+            // letting its backlog (and our memory use) grow without bound.
+            auto pending = sub.pending->load(std::memory_order_relaxed);
+            if (pending >= MEMPOOL_MAX_PENDING) {
+                log::debug(logcat, "Dropping mempool notification for {}: too far behind", conn);
+                continue;
+            }
+            auto& msg = sub.hashes_only || pending >= MEMPOOL_COMPACT_PENDING ? compact : full;
+            if (!msg)
+                msg = std::make_shared<const std::vector<std::string>>(std::vector<std::string>{
+                        "notify.mempool",
+                        txid,
+                        &msg == &full ? blob : ""s,
+                        fee,
+                        weight});
+            ++*sub.pending;
+            sends.push_back({conn, msg, sub.pending});
+        }
+    }
+
+    queue_notifies(std::move(sends));
+
+    if (expired)
+        core_.omq().job(
+                [this] { remove_expired(mempool_subs_, "mempool"); }, *notify_thread_);
 }
 
 /// Get a set of blocks, their transactions, and their created outputs' global indices
@@ -471,103 +666,127 @@ void omq_rpc::on_get_blocks(oxenmq::Message& m) {
     if (max_count != 0)
         end = std::min(start_height + max_count, chain_height);
 
-    using bt_list = oxenc::bt_list;
-    using bt_dict = oxenc::bt_dict;
-
     std::vector<std::string> bt_blocks;
 
     uint64_t i;
     for (i = start_height; i < end; i++) {
-        bt_dict block_bt;
-
-        auto hash = core_.blockchain.get_block_id_by_height(i);
-        block b;
-        if (!core_.blockchain.get_block_by_height(i, b)) {
-            m.send_reply("Unknown error fetching blocks.");
+        std::string block_str;
+        try {
+            block_str = get_encoded_block(i);
+        } catch (const std::runtime_error& e) {
+            m.send_reply(e.what());
             return;
         }
+        size_t sz =
+                block_str.size() + 16;  // conservative estimate of 16 bytes wire overhead per block
 
-        block_bt["hash"] = tools::view_guts(hash);
-        block_bt["height"] = i;
-        block_bt["timestamp"] = b.timestamp;
-
-        std::vector<std::string> txs;
-        core_.blockchain.get_transactions_blobs(b.tx_hashes, txs);
-        if (txs.size() != b.tx_hashes.size()) {
-            m.send_reply("Unknown error fetching transactions.");
-            return;
+        if (message_size + sz > size_limit) {
+            // i is checked after loop to signal "end of chain", so decrement if we don't add
+            // the block
+            i--;
+            break;
         }
 
-        bt_list tx_list_bt;
+        bt_blocks.push_back(std::move(block_str));
+    }
+
+    std::string status = "OK";
+    if (i == chain_height)
+        status = "END";
+    else if (bt_blocks.empty())
+        status = "TOO BIG";
 
-        std::vector<uint64_t> indices;
+    m.send_reply(status, oxenmq::send_option::data_parts(bt_blocks));
+}
 
-        if (b.miner_tx) {
-            bt_dict tx_bt;
+std::string omq_rpc::get_encoded_block(uint64_t height) {
+    auto hash = core_.blockchain.get_block_id_by_height(height);
+    {
+        std::lock_guard lock{block_cache_mutex_};
+        auto it = block_cache_.find(height);
+        if (it != block_cache_.end() && it->second.hash == hash)
+            return it->second.encoded;
+    }
 
-            crypto::hash miner_tx_hash;
-            cryptonote::get_transaction_hash(*b.miner_tx, miner_tx_hash, nullptr);
+    block b;
+    if (!core_.blockchain.get_block_by_height(height, b))
+        throw std::runtime_error{"Unknown error fetching blocks."};
+    return cache_encoded_block(height, hash, b);
+}
 
-            if (!core_.blockchain.get_tx_outputs_gindexs(miner_tx_hash, indices)) {
-                m.send_reply("Unknown error fetching output info.");
-                return;
-            }
+std::string omq_rpc::cache_encoded_block(
+        uint64_t height, const crypto::hash& hash, const block& b) {
+    using bt_list = oxenc::bt_list;
+    using bt_dict = oxenc::bt_dict;
 
-            tx_bt["global_indices"] = bt_list(indices.begin(), indices.end());
-            tx_bt["hash"] = tools::copy_guts(miner_tx_hash);
-            tx_bt["tx"] = tx_to_blob(*b.miner_tx);
+    bt_dict block_bt;
+    block_bt["hash"] = tools::view_guts(hash);
+    block_bt["height"] = height;
+    block_bt["timestamp"] = b.timestamp;
 
-            tx_list_bt.push_back(std::move(tx_bt));
-        }
+    std::vector<std::string> txs;
+    core_.blockchain.get_transactions_blobs(b.tx_hashes, txs);
+    if (txs.size() != b.tx_hashes.size())
+        throw std::runtime_error{"Unknown error fetching transactions."};
 
-        for (size_t tx_index = 0; tx_index < txs.size(); tx_index++) {
-            bt_dict tx_bt;
+    bt_list tx_list_bt;
 
-            indices.clear();
+    std::vector<uint64_t> indices;
 
-            const auto& txhash = b.tx_hashes[tx_index];
+    if (b.miner_tx) {
+        bt_dict tx_bt;
 
-            if (not core_.blockchain.get_tx_outputs_gindexs(txhash, indices)) {
-                m.send_reply("Unknown error fetching output info.");
-                return;
-            }
+        crypto::hash miner_tx_hash;
+        cryptonote::get_transaction_hash(*b.miner_tx, miner_tx_hash, nullptr);
 
-            tx_bt["global_indices"] = bt_list(indices.begin(), indices.end());
-            tx_bt["hash"] = std::string{tools::view_guts(txhash)};
-            tx_bt["tx"] = std::move(txs[tx_index]);
+        if (!core_.blockchain.get_tx_outputs_gindexs(miner_tx_hash, indices))
+            throw std::runtime_error{"Unknown error fetching output info."};
 
-            tx_list_bt.push_back(std::move(tx_bt));
-        }
+        tx_bt["global_indices"] = bt_list(indices.begin(), indices.end());
+        tx_bt["hash"] = tools::copy_guts(miner_tx_hash);
+        tx_bt["tx"] = tx_to_blob(*b.miner_tx);
 
-        block_bt["transactions"] = std::move(tx_list_bt);
+        tx_list_bt.push_back(std::move(tx_bt));
+    }
 
-        auto block_str = oxenc::bt_serialize(block_bt);
-        size_t sz =
-                block_str.size() + 16;  // conservative estimate of 16 bytes wire overhead per block
+    for (size_t tx_index = 0; tx_index < txs.size(); tx_index++) {
+        bt_dict tx_bt;
 
-        if (message_size + sz > size_limit) {
-            // i is checked after loop to signal "end of chain", so decrement if we don't add
-            // the block
-            i--;
-            break;
-        }
+        indices.clear();
 
-        bt_blocks.push_back(std::move(block_str));
+        const auto& txhash = b.tx_hashes[tx_index];
+
+        if (not core_.blockchain.get_tx_outputs_gindexs(txhash, indices))
+            throw std::runtime_error{"Unknown error fetching output info."};
+
+        tx_bt["global_indices"] = bt_list(indices.begin(), indices.end());
+        tx_bt["hash"] = std::string{tools::view_guts(txhash)};
+        tx_bt["tx"] = std::move(txs[tx_index]);
+
+        tx_list_bt.push_back(std::move(tx_bt));
     }
 
-    std::string status = "OK";
-    if (i == chain_height)
-        status = "END";
-    else if (bt_blocks.empty())
-        status = "TOO BIG";
+    block_bt["transactions"] = std::move(tx_list_bt);
 
-    m.send_reply(status, oxenmq::send_option::data_parts(bt_blocks));
+    auto encoded = oxenc::bt_serialize(block_bt);
+
+    std::lock_guard lock{block_cache_mutex_};
+    auto& entry = block_cache_[height];
+    block_cache_bytes_ += encoded.size() - entry.encoded.size();
+    entry.hash = hash;
+    entry.encoded = encoded;
+    while (block_cache_bytes_ > BLOCK_CACHE_MAX_BYTES && !block_cache_.empty()) {
+        block_cache_bytes_ -= block_cache_.begin()->second.encoded.size();
+        block_cache_.erase(block_cache_.begin());
+    }
+    return encoded;
 }
 
 // TX mempool subscriptions: [sub.mempool, blink] or [sub.mempool, all] to subscribe to new
-// approved mempool blink txes, or to all new mempool txes.  You get back a reply of "OK" or
-// "ALREADY" -- the former indicates that you are newly subscribed for tx updates (either
-// because you weren't subscribed before, or your subscription type changed); the latter
+// approved mempool blink txes, or to all new mempool txes.  Add a third "hashes" part (e.g.
+// [sub.mempool, all, hashes]) to get notifications without the tx blob.  You get back a reply of
+// "OK" or "ALREADY" -- the former indicates that you are newly subscribed for tx updates (either
+// because you weren't subscribed before, or your subscription type or option changed); the latter
 // indicates that you were already subscribed for the request tx types.  Any other value should
 // be considered an error.
 //
@@ -576,16 +795,27 @@ void omq_rpc::on_get_blocks(oxenmq::Message& m) {
 // replies as a indicator that there was some server-side interruption (such as a restart) that
 // might necessitate the client rechecking the mempool.
 //
-// When a tx arrives the node sends back [notify.mempool, txhash, txblob] every time a new
-// transaction is added to the mempool (minus some additions that aren't really new transactions
+// When a tx arrives the node sends back [notify.mempool, txhash, txblob, fee, weight] every time a
+// new transaction is added to the mempool (minus some additions that aren't really new transactions
 // such as txes that came from an existing block during a rollback).  Note that both txhash and
-// txblob are binary: in particular, txhash is *not* hex-encoded.
+// txblob are binary: in particular, txhash is *not* hex-encoded.  fee (in atomic OXEN) and weight
+// are decimal strings.  txblob is empty for "hashes" subscriptions, and also for other subscribers
+// that have fallen behind on notifications; those that fall much further behind miss
+// notifications until they catch up.
 //
 void omq_rpc::on_mempool_sub_request(oxenmq::Message& m) {
-    if (m.data.size() != 1) {
+    if (m.data.empty() || m.data.size() > 2) {
         m.send_reply("Invalid subscription request: no subscription type given");
         return;
     }
+    bool hashes_only = false;
+    if (m.data.size() == 2) {
+        if (m.data[1] != "hashes"sv) {
+            m.send_reply("Invalid mempool subscription option '" + std::string{m.data[1]} + "'");
+            return;
+        }
+        hashes_only = true;
+    }
 
     mempool_sub_type sub_type;
     if (m.data[0] == "blink"sv)
@@ -600,10 +830,11 @@ void omq_rpc::on_mempool_sub_request(oxenmq::Message& m) {
     {
         std::unique_lock lock{subs_mutex_};
         auto expiry = std::chrono::steady_clock::now() + 30min;
-        auto result = mempool_subs_.emplace(m.conn, mempool_sub{expiry, sub_type});
+        auto result = mempool_subs_.emplace(m.conn, mempool_sub{expiry, sub_type, hashes_only});
         if (!result.second) {
             result.first->second.expiry = expiry;
-            if (result.first->second.type == sub_type) {
+            if (result.first->second.type == sub_type &&
+                result.first->second.hashes_only == hashes_only) {
                 log::trace(
                         logcat,
                         "Renewed mempool subscription request from conn id {}@{}",
@@ -613,6 +844,7 @@ void omq_rpc::on_mempool_sub_request(oxenmq::Message& m) {
                 return;
             }
             result.first->second.type = sub_type;
+            result.first->second.hashes_only = hashes_only;
         }
         log::debug(
                 logcat,
@@ -625,10 +857,8 @@ void omq_rpc::on_mempool_sub_request(oxenmq::Message& m) {
 }
 
 // New block subscriptions: [sub.block].  This sends a notification every time a new block is
-// added to the blockchain.
-//
-// TODO: make this support [sub.block, sn] so that we can receive notification only for blocks
-// that change the SN composition.
+// added to the blockchain.  (See [sub.service_nodes] for notifications that also describe what
+// each block changed in the service node list).
 //
 // The subscription request returns the current [height, blockhash] as a reply.
 //
@@ -650,4 +880,118 @@ void omq_rpc::on_block_sub_request(oxenmq::Message& m) {
     }
 }
 
+// Service node list subscriptions: [sub.service_nodes].  This sends a notification describing the
+// changes to the registered service nodes every time a new block is added to the blockchain, so
+// that clients that track the service node list (such as storage servers and lokinet routers) can
+// fetch the full list once (via `rpc.get_service_nodes`) and then keep it up to date by only
+// fetching details of the nodes that change.
+//
+// Replies and expiry work the same way as [sub.block].
+//
+// Notifications are [notify.service_nodes, height, blockhash, prevhash, delta] where blockhash and
+// prevhash are the (binary) hashes of the new block and its parent, and delta is a bt-encoded dict
+// containing lists of (binary) service node pubkeys:
+// - "added" -- newly registered service nodes
+// - "removed" -- service nodes that are no longer registered
+// - "changed" -- service nodes that remain registered but whose details may have changed
+// - "state" -- the subset of "changed" that became active, decommissioned, or fully funded (or
+//   stopped being so)
+// - "swarm" -- the subset of "changed" assigned to a new swarm, as a list of [pubkey, swarm_id]
+//   pairs
+//
+// A delta only applies to the list as of prevhash: if prevhash is not the hash of the last block
+// the client processed (e.g. because of a missed notification or a reorg) then it needs to resync
+// by fetching the full list again.  The delta is omitted (i.e. the message has only four parts)
+// when the daemon can't compute it, which also requires a resync.
+// Block data subscriptions: [sub.blocks, params].  This pushes full blocks, in the same format as
+// the blocks returned by [rpc.get_blocks], starting from a given height and then as each new block
+// is added, so that a synced wallet doesn't need a request per block.  params is a bt-encoded dict
+// of:
+//
+// - \p start_height -- (optional) the height to push blocks from.  Defaults to the current chain
+//   height (i.e. only new blocks) for a new subscription, or to carrying on from where we got to
+//   for a renewal.  Give it again to re-sync from an earlier height.
+// - \p received -- (optional) the height of the next block the client still needs, i.e. it has
+//   everything below this.  Defaults to start_height.
+//
+// Flow control: at most 20 blocks past `received` are pushed until the client acknowledges more by
+// renewing with a higher `received`, so a client should renew as it processes blocks (and, as with
+// other subscriptions, at least every 30 minutes to keep the subscription alive).
+//
+// The reply is ["OK" or "ALREADY", height] with the current chain height.  Each block is then
+// sent in a [notify.blocks, block] message, in height order.  After a reorg the blocks of the new
+// chain are pushed again from the split height, so a client seeing a height it already has should
+// replace everything from that height up.
+void omq_rpc::on_blocks_sub_request(oxenmq::Message& m) {
+    std::optional<uint64_t> start_height, received;
+    if (!m.data.empty()) {
+        try {
+            get_values(m.data[0], "received", received, "start_height", start_height);
+        } catch (const std::exception& e) {
+            m.send_reply(std::string("Invalid blocks subscription request: ") + e.what());
+            return;
+        }
+    }
+
+    auto chain_height = core_.blockchain.get_current_blockchain_height();
+    if (start_height && *start_height > chain_height) {
+        m.send_reply(
+                "Invalid blocks subscription request: start_height given is above current chain "
+                "height.");
+        return;
+    }
+
+    {
+        std::unique_lock lock{subs_mutex_};
+        auto expiry = std::chrono::steady_clock::now() + 30min;
+        auto [it, added] = blocks_subs_.try_emplace(m.conn);
+        auto& sub = it->second;
+        sub.expiry = expiry;
+        if (added || start_height) {
+            sub.next_height = start_height.value_or(chain_height);
+            sub.limit = received.value_or(sub.next_height) + BLOCK_PUSH_WINDOW;
+        } else if (received) {
+            sub.limit = std::max(sub.limit, *received + BLOCK_PUSH_WINDOW);
+        }
+        if (added)
+            log::debug(
+                    logcat,
+                    "New blocks subscription request from conn {}@{} from height {}",
+                    m.conn,
+                    m.remote,
+                    sub.next_height);
+        else
+            log::trace(
+                    logcat,
+                    "Renewed blocks subscription request from conn id {}@{}",
+                    m.conn,
+                    m.remote);
+        m.send_reply(added ? "OK" : "ALREADY", "{}"_format(chain_height));
+    }
+
+    push_blocks();
+}
+
+void omq_rpc::on_service_nodes_sub_request(oxenmq::Message& m) {
+    std::unique_lock lock{subs_mutex_};
+    auto expiry = std::chrono::steady_clock::now() + 30min;
+    auto result = service_nodes_subs_.emplace(m.conn, service_nodes_sub{expiry});
+    if (!result.second) {
+        result.first->second.expiry = expiry;
+        log::trace(
+                logcat,
+                "Renewed service node subscription request from conn id {}@{}",
+                m.conn,
+                m.remote);
+        m.send_reply("ALREADY");
+    } else {
+        log::debug(
+                logcat,
+                "New service node subscription request from conn {}@{}",
+                m.conn,
+                m.remote);
+        m.send_reply("OK");
+    }
+}
+
 }  // namespace cryptonote::rpc
@@ -52,17 +52,59 @@ class omq_rpc final {
     struct mempool_sub {
         std::chrono::steady_clock::time_point expiry;
         mempool_sub_type type;
+        bool hashes_only = false;  // Leave out the tx blob, for clients that only want the ids
+        // Notifications queued for this subscriber and not yet handed to OMQ
+        std::shared_ptr<std::atomic<size_t>> pending = std::make_shared<std::atomic<size_t>>(0);
     };
+    // Once this many mempool notifications are queued for a subscriber we stop including tx blobs
+    // in new ones, and at MEMPOOL_MAX_PENDING we drop new ones entirely until it catches up.
+    static constexpr size_t MEMPOOL_COMPACT_PENDING = 250, MEMPOOL_MAX_PENDING = 1000;
 
     struct block_sub {
         std::chrono::steady_clock::time_point expiry;
     };
 
+    struct service_nodes_sub {
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    struct blocks_sub {
+        std::chrono::steady_clock::time_point expiry;
+        uint64_t next_height;  // The next block to push
+        uint64_t limit;        // Blocks at or above this wait until the client acknowledges more
+    };
+    // How many blocks past the last one a client told us it received we push without waiting.
+    static constexpr uint64_t BLOCK_PUSH_WINDOW = 20;
+
     cryptonote::core& core_;
     core_rpc_server& rpc_;
     std::shared_timed_mutex subs_mutex_;
     std::unordered_map<oxenmq::ConnectionID, mempool_sub> mempool_subs_;
     std::unordered_map<oxenmq::ConnectionID, block_sub> block_subs_;
+    std::unordered_map<oxenmq::ConnectionID, service_nodes_sub> service_nodes_subs_;
+    std::unordered_map<oxenmq::ConnectionID, blocks_sub> blocks_subs_;
+    // Notifications are sent from this thread, so that whatever triggers them (block or mempool
+    // processing) never waits on the sends, while each subscriber still gets them in order.
+    std::optional<oxenmq::TaggedThreadID> notify_thread_;
+    // How many subscribers each notification job sends to, so that one notification to many
+    // subscribers doesn't tie up the notify thread in a single job.
+    static constexpr size_t NOTIFY_BATCH_SIZE = 256;
+    // Held while pushing blocks so that each subscriber gets them in order
+    std::mutex blocks_push_mutex_;
+
+    // The bt-encoded rpc.get_blocks entries of recently requested (and, once anyone has requested
+    // blocks, newly added) blocks, by height.  An entry is only used if its hash still matches the
+    // chain; detached blocks are also dropped when the chain detaches them.  When the cache grows
+    // past BLOCK_CACHE_MAX_BYTES the lowest heights go first, as most requests are for the top of
+    // the chain.
+    struct cached_block {
+        crypto::hash hash;
+        std::string encoded;
+    };
+    static constexpr size_t BLOCK_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+    std::mutex block_cache_mutex_;
+    std::map<uint64_t, cached_block> block_cache_;
+    size_t block_cache_bytes_ = 0;
 
   public:
     omq_rpc(cryptonote::core& core,
@@ -71,6 +113,8 @@ class omq_rpc final {
 
     void send_block_notifications(const block& block);
 
+    void send_service_nodes_notifications(const block& block);
+
     void send_mempool_notifications(
             const crypto::hash& id,
             const transaction& tx,
@@ -80,9 +124,50 @@ class omq_rpc final {
   private:
     void on_get_blocks(oxenmq::Message& m);
 
+    // Returns the encoded rpc.get_blocks entry for the block at `height`, from the cache if
+    // possible.  Throws std::runtime_error if the block can't be loaded.
+    std::string get_encoded_block(uint64_t height);
+
+    // Encodes and caches the entry for the given (already added) block
+    std::string cache_encoded_block(uint64_t height, const crypto::hash& hash, const block& b);
+
     void on_mempool_sub_request(oxenmq::Message& m);
 
     void on_block_sub_request(oxenmq::Message& m);
+
+    void on_service_nodes_sub_request(oxenmq::Message& m);
+
+    void on_blocks_sub_request(oxenmq::Message& m);
+
+    // One send to be made from the notify thread
+    struct queued_notify {
+        oxenmq::ConnectionID conn;
+        std::shared_ptr<const std::vector<std::string>> message;  // The command, then data parts
+        std::shared_ptr<std::atomic<size_t>> pending;  // If set, decremented once sent
+    };
+
+    // Sends the given notifies from the notify thread, in batches of NOTIFY_BATCH_SIZE.
+    void queue_notifies(std::vector<queued_notify> sends);
+
+    // Queues `message` (the command followed by its data parts) to be sent from the notify thread
+    // to every subscriber in `subs` that hasn't expired and for which `want(sub)` is true.  Expired
+    // subscribers get removed, also from the notify thread.
+    template <typename Subs, typename Want>
+    void send_notifies(
+            Subs& subs, const char* desc, std::vector<std::string> message, Want want);
+
+    template <typename Subs>
+    void remove_expired(Subs& subs, const char* desc);
+
+    template <typename Subs>
+    bool has_subs(const Subs& subs) {
+        std::shared_lock lock{subs_mutex_};
+        return !subs.empty();
+    }
+
+    // Sends each [sub.blocks] subscriber the blocks it is due, up to the top of the chain or the
+    // end of its window.  Makes blockchain calls, so must not be called with the blockchain locked.
+    void push_blocks();
 };
 
 }  // namespace cryptonote::rpc
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Layout and ring buffer logic of the shared memory RPC channel (see shm_server.h).  This header
+// has no dependencies on the rest of oxend so that local clients can use it directly.
+//
+// A client connects to the daemon's --shm-rpc unix socket and receives, via SCM_RIGHTS, three file
+// descriptors: a memfd holding the channel, an eventfd it signals after writing requests (or
+// consuming responses), and an eventfd the daemon signals after writing responses.  The memfd
+// starts with a channel_header, followed by the request ring's data and then the response ring's
+// data, each `ring_size` bytes.  Closing the socket ends the channel.
+//
+// Each ring carries frames: a frame_header followed by `size` payload bytes, wrapping around the
+// end of the data area as needed.  A request payload is the RPC command name (e.g.
+// "submit_transaction"), a NUL byte, then the request body exactly as it would be sent over OMQ.
+// A response payload is a three character status code ("200", "400" or "500", as for OMQ RPC)
+// followed by the response body.  Responses carry the id of their request, and may arrive out of
+// order.
+namespace cryptonote::rpc::shm {
+
+inline constexpr std::array<char, 8> MAGIC{'O', 'X', 'S', 'H', 'M', 'R', 'P', 'C'};
+inline constexpr uint32_t VERSION = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+struct ring_indices {
+    // Total bytes ever written; only modified by the ring's producer
+    alignas(64) std::atomic<uint64_t> head;
+    // Total bytes ever consumed; only modified by the ring's consumer
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+struct channel_header {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t ring_size;  // Size of each ring's data area; a power of two
+    ring_indices requests;
+    ring_indices responses;
+};
+
+struct frame_header {
+    uint32_t size;  // Payload bytes following this header
+    uint32_t id;    // Chosen by the client; echoed back in the response
+};
+
+// One end of a single-producer, single-consumer ring.  The indices written by the other end live
+// in memory that end controls, so they are validated on every use rather than trusted.
+class ring {
+  public:
+    enum class status { ok, again, error };
+
+    ring(ring_indices& idx, char* data, uint32_t size) : idx_{idx}, data_{data}, size_{size} {}
+
+    // Producer: appends one frame with payload `a` followed by `b`.  Returns `again` if there
+    // isn't currently room for it, and `error` if the indices are inconsistent or the frame could
+    // never fit.
+    status write(uint32_t id, std::string_view a, std::string_view b) {
+        const uint64_t frame = sizeof(frame_header) + a.size() + b.size();
+        if (frame > size_)
+            return status::error;
+        const uint64_t head = idx_.head.load(std::memory_order_relaxed);
+        const uint64_t tail = idx_.tail.load(std::memory_order_acquire);
+        if (head - tail > size_)
+            return status::error;
+        if (size_ - (head - tail) < frame)
+            return status::again;
+        frame_header fh{static_cast<uint32_t>(a.size() + b.size()), id};
+        copy_in(head, &fh, sizeof(fh));
+        copy_in(head + sizeof(fh), a.data(), a.size());
+        copy_in(head + sizeof(fh) + a.size(), b.data(), b.size());
+        idx_.head.store(head + frame, std::memory_order_release);
+        return status::ok;
+    }
+
+    // Consumer: pops one frame into `id` and `payload`.  Returns `again` if no complete frame is
+    // available, and `error` if the producer wrote something invalid.
+    status read(uint32_t& id, std::string& payload) {
+        const uint64_t tail = idx_.tail.load(std::memory_order_relaxed);
+        const uint64_t head = idx_.head.load(std::memory_order_acquire);
+        const uint64_t used = head - tail;
+        if (used > size_)
+            return status::error;
+        if (used == 0)
+            return status::again;
+        frame_header fh;
+        if (used < sizeof(fh))
+            return status::error;
+        copy_out(tail, &fh, sizeof(fh));
+        if (fh.size > used - sizeof(fh))
+            return status::error;
+        id = fh.id;
+        payload.resize(fh.size);
+        copy_out(tail + sizeof(fh), payload.data(), fh.size);
+        idx_.tail.store(tail + sizeof(fh) + fh.size, std::memory_order_release);
+        return status::ok;
+    }
+
+  private:
+    void copy_in(uint64_t pos, const void* src, size_t len) {
+        const size_t off = pos & (size_ - 1);
+        const size_t first = std::min<size_t>(len, size_ - off);
+        std::memcpy(data_ + off, src, first);
+        std::memcpy(data_, static_cast<const char*>(src) + first, len - first);
+    }
+    void copy_out(uint64_t pos, void* dest, size_t len) const {
+        const size_t off = pos & (size_ - 1);
+        const size_t first = std::min<size_t>(len, size_ - off);
+        std::memcpy(dest, data_ + off, first);
+        std::memcpy(static_cast<char*>(dest) + first, data_, len - first);
+    }
+
+    ring_indices& idx_;
+    char* data_;
+    uint32_t size_;
+};
+
+}  // namespace cryptonote::rpc::shm
@@ -0,0 +1,444 @@
+#include "shm_server.h"
+
+#include <common/exception.h>
+#include <fmt/core.h>
+#include <fmt/std.h>
+#include <oxenc/bt.h>
+#include <oxenmq/oxenmq.h>
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <optional>
+
+#include "common/alloc_profile.h"
+#include "common/command_line.h"
+#include "common/oxen.h"
+#include "common/string_util.h"
+#include "shm_channel.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cryptonote::rpc {
+
+namespace {
+
+    static auto logcat = log::Cat("daemon.rpc");
+
+    const command_line::arg_descriptor<std::string> arg_shm_rpc{
+            "shm-rpc",
+            "Listens for shared memory RPC clients on the unix socket at the given path.  Clients "
+            "on the same host get a shared memory channel for calling the public RPC commands "
+            "(such as submit_transaction) without per-request socket I/O.  Linux only."};
+    const command_line::arg_descriptor<uint32_t> arg_shm_rpc_ring_size{
+            "shm-rpc-ring-size",
+            "Size in bytes of each direction of a --shm-rpc channel; must be a power of two of at "
+            "least 65536.  Larger requests and responses can't be sent over the channel.",
+            1 << 20};
+
+    // Requests from one channel that can be queued or running at once; once reached, we leave
+    // further requests in the ring until responses are delivered.
+    constexpr size_t MAX_IN_FLIGHT = 64;
+
+    // Same codes as OMQ RPC replies
+    constexpr std::string_view SHM_OK{"200"sv}, SHM_BAD_REQUEST{"400"sv}, SHM_ERROR{"500"sv};
+
+}  // namespace
+
+void init_shm_options(boost::program_options::options_description& desc) {
+    command_line::add_arg(desc, arg_shm_rpc);
+    command_line::add_arg(desc, arg_shm_rpc_ring_size);
+}
+
+#ifdef __linux__
+
+namespace {
+
+    void notify(int efd) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto r = ::write(efd, &one, sizeof(one));
+    }
+
+    void drain(int efd) {
+        uint64_t count;
+        [[maybe_unused]] auto r = ::read(efd, &count, sizeof(count));
+    }
+
+    [[noreturn]] void throw_errno(std::string_view what) {
+        throw oxen::traced<std::runtime_error>(
+                "shm RPC: {} failed: {}"_format(what, std::strerror(errno)));
+    }
+
+}  // namespace
+
+struct shm_rpc::channel {
+    int sock_fd = -1;
+    int req_event_fd = -1;
+    int resp_event_fd = -1;
+    int wakeup_fd = -1;  // dup of the server's, so that responses never touch the server itself
+    void* mem = MAP_FAILED;
+    size_t mem_size = 0;
+    uint32_t ring_size = 0;
+    std::optional<shm::ring> requests, responses;
+
+    // The fields below are guarded by resp_mutex; responses are written from worker threads
+    std::mutex resp_mutex;
+    struct pending_response {
+        uint32_t id;
+        std::string_view code;
+        std::string body;
+    };
+    std::deque<pending_response> pending;
+    bool closed = false;
+
+    // Requests read from the ring whose responses haven't been written into it yet
+    std::atomic<size_t> in_flight{0};
+
+    ~channel() {
+        if (mem != MAP_FAILED)
+            munmap(mem, mem_size);
+        for (int fd : {sock_fd, req_event_fd, resp_event_fd, wakeup_fd})
+            if (fd != -1)
+                ::close(fd);
+    }
+
+    // Writes as many pending responses as fit into the ring.  Must hold resp_mutex.
+    void flush() {
+        bool wrote = false;
+        while (!pending.empty()) {
+            auto& r = pending.front();
+            auto st = responses->write(r.id, r.code, r.body);
+            if (st == shm::ring::status::again)
+                break;
+            if (st == shm::ring::status::error) {
+                // The client broke the response ring's indices; we're done with it
+                log::warning(logcat, "shm RPC client corrupted its response ring; dropping it");
+                closed = true;
+                pending.clear();
+                notify(wakeup_fd);
+                return;
+            }
+            pending.pop_front();
+            wrote = true;
+            if (in_flight-- == MAX_IN_FLIGHT)
+                notify(wakeup_fd);
+        }
+        if (wrote)
+            notify(resp_event_fd);
+    }
+
+    void respond(uint32_t id, std::string_view code, std::string body) {
+        if (sizeof(shm::frame_header) + code.size() + body.size() > ring_size) {
+            code = SHM_ERROR;
+            body = "Response is too large for the shared memory channel";
+        }
+        std::lock_guard lock{resp_mutex};
+        if (closed)
+            return;
+        pending.push_back({id, code, std::move(body)});
+        flush();
+    }
+};
+
+shm_rpc::shm_rpc(
+        cryptonote::core& core,
+        core_rpc_server& rpc,
+        const boost::program_options::variables_map& vm) :
+        core_{core}, rpc_{rpc} {
+    auto path = command_line::get_arg(vm, arg_shm_rpc);
+    if (path.empty())
+        return;
+    socket_path_ = tools::utf8_path(path);
+
+    ring_size_ = command_line::get_arg(vm, arg_shm_rpc_ring_size);
+    if (ring_size_ < 65536 || (ring_size_ & (ring_size_ - 1)))
+        throw oxen::traced<std::invalid_argument>(
+                "Invalid --shm-rpc-ring-size: expected a power of two of at least 65536");
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw oxen::traced<std::invalid_argument>("--shm-rpc socket path is too long");
+    std::memcpy(addr.sun_path, path.data(), path.size());
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd_ == -1)
+        throw_errno("socket");
+    // Replace a stale socket from a previous run, but nothing else
+    if (struct stat st; ::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        ::unlink(path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1)
+        throw_errno("bind");
+    // Owner and group only, as with the default --lmq-umask for ipc sockets
+    ::chmod(path.c_str(), 0660);
+    if (::listen(listen_fd_, 16) == -1)
+        throw_errno("listen");
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ == -1 || wakeup_fd_ == -1)
+        throw_errno("epoll/eventfd setup");
+    for (int fd : {listen_fd_, wakeup_fd_}) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1)
+            throw_errno("epoll_ctl");
+    }
+
+    log::info(globallogcat, "Shared memory RPC listening on {}", socket_path_);
+    thread_ = std::thread{[this] { run(); }};
+}
+
+shm_rpc::~shm_rpc() {
+    if (thread_.joinable()) {
+        stop_ = true;
+        notify(wakeup_fd_);
+        thread_.join();
+    }
+    for (auto& [fd, ch] : channels_) {
+        std::lock_guard lock{ch->resp_mutex};
+        ch->closed = true;
+    }
+    channels_.clear();
+    for (int fd : {listen_fd_, epoll_fd_, wakeup_fd_})
+        if (fd != -1)
+            ::close(fd);
+    if (listen_fd_ != -1)
+        ::unlink(socket_path_.c_str());
+}
+
+void shm_rpc::run() {
+    std::array<epoll_event, 64> events;
+    while (!stop_) {
+        int n = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            log::error(logcat, "shm RPC: epoll_wait failed: {}", std::strerror(errno));
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                accept_client();
+                continue;
+            }
+            if (fd == wakeup_fd_) {
+                drain(wakeup_fd_);
+                if (stop_)
+                    return;
+                // Channels that hit MAX_IN_FLIGHT (or broke) since we last looked
+                std::vector<std::shared_ptr<channel>> chs;
+                for (auto& [cfd, ch] : channels_)
+                    if (cfd == ch->req_event_fd)
+                        chs.push_back(ch);
+                for (auto& ch : chs)
+                    read_requests(ch);
+                continue;
+            }
+            auto it = channels_.find(fd);
+            if (it == channels_.end())
+                continue;  // Closed earlier in this batch
+            auto ch = it->second;
+            if (fd == ch->sock_fd) {
+                // Clients never send anything over the socket, so this is a disconnect
+                close_channel(ch);
+                continue;
+            }
+            drain(ch->req_event_fd);
+            {
+                // The client also signals us after consuming responses, so try to deliver any
+                // that were waiting for room
+                std::lock_guard lock{ch->resp_mutex};
+                if (!ch->closed)
+                    ch->flush();
+            }
+            read_requests(ch);
+        }
+    }
+}
+
+void shm_rpc::accept_client() {
+    int sock = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (sock == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            log::warning(logcat, "shm RPC: accept failed: {}", std::strerror(errno));
+        return;
+    }
+
+    auto ch = std::make_shared<channel>();
+    ch->sock_fd = sock;
+    ch->ring_size = ring_size_;
+    ch->mem_size = sizeof(shm::channel_header) + 2 * size_t{ring_size_};
+
+    int mem_fd = memfd_create("oxend-shm-rpc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    OXEN_DEFER {
+        if (mem_fd != -1)
+            ::close(mem_fd);
+    };
+    // The size is sealed so that the client can't truncate the memory out from under us (which
+    // would get us a SIGBUS rather than an error)
+    if (mem_fd == -1 || ::ftruncate(mem_fd, ch->mem_size) == -1 ||
+        fcntl(mem_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1 ||
+        (ch->mem = mmap(nullptr, ch->mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0)) ==
+                MAP_FAILED) {
+        log::warning(logcat, "shm RPC: failed to set up channel memory: {}", std::strerror(errno));
+        return;
+    }
+    ch->req_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    ch->resp_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    ch->wakeup_fd = ::dup(wakeup_fd_);
+    if (ch->req_event_fd == -1 || ch->resp_event_fd == -1 || ch->wakeup_fd == -1) {
+        log::warning(logcat, "shm RPC: failed to set up channel: {}", std::strerror(errno));
+        return;
+    }
+
+    auto* header = new (ch->mem) shm::channel_header{};
+    header->magic = shm::MAGIC;
+    header->version = shm::VERSION;
+    header->ring_size = ring_size_;
+    char* data = static_cast<char*>(ch->mem) + sizeof(shm::channel_header);
+    ch->requests.emplace(header->requests, data, ring_size_);
+    ch->responses.emplace(header->responses, data + ring_size_, ring_size_);
+
+    // Hand the client its memory and eventfds
+    int fds[3] = {mem_fd, ch->req_event_fd, ch->resp_event_fd};
+    char byte = 0;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char cbuf[CMSG_SPACE(sizeof(fds))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (::sendmsg(sock, &msg, MSG_NOSIGNAL) != 1) {
+        log::warning(logcat, "shm RPC: failed to send channel to client: {}", std::strerror(errno));
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = ch->sock_fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, ch->sock_fd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = ch->req_event_fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, ch->req_event_fd, &ev);
+    channels_[ch->sock_fd] = ch;
+    channels_[ch->req_event_fd] = ch;
+    log::debug(logcat, "shm RPC: new client channel on fd {}", ch->sock_fd);
+}
+
+void shm_rpc::close_channel(const std::shared_ptr<channel>& ch) {
+    log::debug(logcat, "shm RPC: closing client channel on fd {}", ch->sock_fd);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, ch->sock_fd, nullptr);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, ch->req_event_fd, nullptr);
+    channels_.erase(ch->sock_fd);
+    channels_.erase(ch->req_event_fd);
+    std::lock_guard lock{ch->resp_mutex};
+    ch->closed = true;
+    ch->pending.clear();
+    // The fds and mapping go away with the last reference, once any running requests finish
+}
+
+void shm_rpc::read_requests(const std::shared_ptr<channel>& ch) {
+    {
+        std::lock_guard lock{ch->resp_mutex};
+        if (ch->closed)
+            return close_channel(ch);
+    }
+    uint32_t id;
+    std::string payload;
+    while (ch->in_flight < MAX_IN_FLIGHT) {
+        auto st = ch->requests->read(id, payload);
+        if (st == shm::ring::status::again)
+            break;
+        if (st == shm::ring::status::error) {
+            log::warning(logcat, "shm RPC client wrote an invalid request frame; dropping it");
+            return close_channel(ch);
+        }
+
+        ch->in_flight++;
+        auto nul = payload.find('\0');
+        std::string_view name{payload.data(), std::min(nul, payload.size())};
+        auto cmd_it = rpc_commands.find(std::string{name});
+        if (nul == std::string::npos || cmd_it == rpc_commands.end() || !cmd_it->second->is_public) {
+            ch->respond(id, SHM_BAD_REQUEST, "Unknown or unavailable RPC command");
+            continue;
+        }
+
+        core_.omq().job([this, ch, id, &call = *cmd_it->second, payload = std::move(payload), nul] {
+            rpc_request request{};
+            request.context.admin = false;
+            request.context.source = rpc_source::shm;
+            request.context.remote = "shm";
+            if (nul + 1 < payload.size())
+                request.body = std::string_view{payload}.substr(nul + 1);
+
+            OXEN_ALLOC_SCOPE("rpc");
+            try {
+                auto result = var::visit(
+                        [](auto&& v) -> std::string {
+                            using T = decltype(v);
+                            if constexpr (std::is_same_v<oxenc::bt_value&&, T>)
+                                return bt_serialize(std::move(v));
+                            else if constexpr (std::is_same_v<nlohmann::json&&, T>)
+                                return v.dump();
+                            else {
+                                static_assert(std::is_same_v<std::string&&, T>);
+                                return std::move(v);
+                            }
+                        },
+                        call.invoke(std::move(request), rpc_));
+                ch->respond(id, SHM_OK, std::move(result));
+                return;
+            } catch (const parse_error& e) {
+                log::info(logcat, "shm RPC request called with unparseable data: {}", e.what());
+                ch->respond(id, SHM_BAD_REQUEST, "Unable to parse request: "s + e.what());
+                return;
+            } catch (const rpc_error& e) {
+                log::warning(logcat, "shm RPC request failed with: {}", e.what());
+                ch->respond(id, SHM_ERROR, e.what());
+                return;
+            } catch (const std::exception& e) {
+                log::warning(logcat, "shm RPC request raised an exception: {}", e.what());
+            } catch (...) {
+                log::warning(logcat, "shm RPC request raised an unknown exception");
+            }
+            ch->respond(id, SHM_ERROR, "An exception occured while processing your request");
+        });
+        payload = std::string{};
+    }
+}
+
+#else
+
+shm_rpc::shm_rpc(
+        cryptonote::core& core,
+        core_rpc_server& rpc,
+        const boost::program_options::variables_map& vm) :
+        core_{core}, rpc_{rpc} {
+    if (!command_line::get_arg(vm, arg_shm_rpc).empty())
+        throw oxen::traced<std::invalid_argument>("--shm-rpc is only supported on Linux");
+}
+
+shm_rpc::~shm_rpc() = default;
+
+#endif
+
+}  // namespace cryptonote::rpc
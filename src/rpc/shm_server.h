@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include "common/fs.h"
+#include "core_rpc_server.h"
+
+namespace cryptonote::rpc {
+
+void init_shm_options(boost::program_options::options_description& desc);
+
+/**
+ * Shared memory RPC server, for services running on the same host as oxend.  Clients connect to a
+ * unix socket and are handed a shared memory channel (see shm_channel.h for the layout) over which
+ * they can call the public RPC commands, with eventfds for notification instead of a socket per
+ * request.  Requests are run on the OxenMQ worker threads, the same as OMQ RPC requests.
+ *
+ * Only available on Linux; elsewhere the constructor does nothing.
+ */
+class shm_rpc final {
+  public:
+    shm_rpc(cryptonote::core& core,
+            core_rpc_server& rpc,
+            const boost::program_options::variables_map& vm);
+    ~shm_rpc();
+
+    struct channel;
+
+  private:
+    void run();
+    void accept_client();
+    void close_channel(const std::shared_ptr<channel>& ch);
+    void read_requests(const std::shared_ptr<channel>& ch);
+
+    cryptonote::core& core_;
+    core_rpc_server& rpc_;
+    fs::path socket_path_;
+    uint32_t ring_size_ = 0;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    // Signalled to stop the server, or when a channel that had too many requests in flight can
+    // take more
+    int wakeup_fd_ = -1;
+    std::atomic<bool> stop_{false};
+    // Channels, by both their socket and request eventfd; only used from the server thread
+    std::unordered_map<int, std::shared_ptr<channel>> channels_;
+    std::thread thread_;
+};
+
+}  // namespace cryptonote::rpc
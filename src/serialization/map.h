@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <unordered_map>
 
@@ -55,6 +56,9 @@ namespace detail {
         auto arr = ar.begin_array(cnt);
 
         m.clear();
+        // Each element takes at least a byte, which bounds what a bad count can make us allocate
+        if constexpr (reservable<Map>)
+            m.reserve(std::min<size_t>(cnt, ar.remaining_bytes()));
 
         for (size_t i = 0; i < cnt; i++) {
             std::pair<typename Map::key_type, typename Map::mapped_type> e{};
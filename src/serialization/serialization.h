@@ -371,10 +371,12 @@ void serialize(Archive& ar, T& v) {
 
 class binary_archiver;
 class binary_unarchiver;
+class binary_string_unarchiver;
 
 // True if Archive is a binary archiver or unarchiver
 template <typename Archive>
 constexpr bool is_binary = std::is_base_of_v<binary_archiver, Archive> ||
-                           std::is_base_of_v<binary_unarchiver, Archive>;
+                           std::is_base_of_v<binary_unarchiver, Archive> ||
+                           std::is_base_of_v<binary_string_unarchiver, Archive>;
 
 }  // namespace serialization
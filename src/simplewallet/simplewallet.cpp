@@ -4882,12 +4882,31 @@ void simple_wallet::refresh_progress_reporter_t::update_blockchain_height() {
 }
 //----------------------------------------------------------------------------------------------------
 void simple_wallet::on_new_block(uint64_t height, const cryptonote::block& block) {
+    m_refresh_status.height.store(height + 1, std::memory_order_relaxed);
+    if (m_auto_refresh_refreshing)
+        update_balance_snapshot(height + 1);
     if (m_locked)
         return;
     if (!m_auto_refresh_refreshing)
         m_refresh_progress_reporter.update(height, false);
 }
 //----------------------------------------------------------------------------------------------------
+void simple_wallet::update_balance_snapshot(uint64_t height) {
+    // Called from the refresh thread between blocks, so the wallet is consistent here; the balance
+    // cache makes this cheap, but there's no point doing it more than once a second.
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{m_balance_snapshot_mutex};
+    auto& snap = m_balance_snapshot;
+    if (snap.valid && snap.account == m_current_subaddress_account && now - snap.time < 1s)
+        return;
+    snap.account = m_current_subaddress_account;
+    snap.height = height;
+    snap.balance = m_wallet->balance(snap.account, false);
+    snap.unlocked = m_wallet->unlocked_balance(snap.account, false);
+    snap.time = now;
+    snap.valid = true;
+}
+//----------------------------------------------------------------------------------------------------
 void simple_wallet::on_money_received(
         uint64_t height,
         const crypto::hash& txid,
@@ -5293,11 +5312,34 @@ bool simple_wallet::show_balance(
         PRINT_USAGE(USAGE_SHOW_BALANCE);
         return true;
     }
+    // A long background refresh would otherwise have to reach a break between blocks (and finish
+    // any block fetch in flight) before we could print anything, so answer from the snapshot the
+    // refresh keeps up to date instead.
+    if (args.empty() && m_auto_refresh_refreshing && show_balance_snapshot())
+        return true;
     LOCK_IDLE_SCOPE();
     show_balance_unlocked(args.size() == 1);
     return true;
 }
 //----------------------------------------------------------------------------------------------------
+bool simple_wallet::show_balance_snapshot() {
+    balance_snapshot snap;
+    {
+        std::lock_guard lock{m_balance_snapshot_mutex};
+        snap = m_balance_snapshot;
+    }
+    if (!snap.valid || snap.account != m_current_subaddress_account)
+        return false;
+    success_msg_writer() << tr("Currently selected account: [") << snap.account << tr("]");
+    success_msg_writer() << tr("Balance: ") << print_money(snap.balance) << ", "
+                         << tr("unlocked balance: ") << print_money(snap.unlocked);
+    message_writer() << "(as of block {}; background refresh in progress, {}/{})"_format(
+            snap.height,
+            m_refresh_status.height.load(std::memory_order_relaxed),
+            m_refresh_status.target.load(std::memory_order_relaxed));
+    return true;
+}
+//----------------------------------------------------------------------------------------------------
 bool simple_wallet::show_incoming_transfers(const std::vector<std::string>& args) {
     if (args.size() > 3) {
         PRINT_USAGE(USAGE_INCOMING_TRANSFERS);
@@ -8921,15 +8963,26 @@ bool simple_wallet::check_refresh(bool long_poll_trigger) {
         try {
             uint64_t fetched_blocks;
             bool received_money;
-            if (try_connect_to_daemon(true))
+            if (try_connect_to_daemon(true)) {
+                // The node proxy caches the height, so this doesn't cost a request every second
+                std::string err;
+                if (uint64_t target = m_wallet->get_daemon_blockchain_height(err); err.empty())
+                    m_refresh_status.target.store(target, std::memory_order_relaxed);
                 m_wallet->refresh(
                         m_wallet->is_trusted_daemon(),
                         0,
                         fetched_blocks,
                         received_money,
                         long_poll_trigger /*check pool*/);
+            }
         } catch (...) {
         }
+        m_refresh_status.height.store(
+                m_wallet->get_blockchain_current_height(), std::memory_order_relaxed);
+        {
+            std::lock_guard lock{m_balance_snapshot_mutex};
+            m_balance_snapshot.valid = false;
+        }
         m_auto_refresh_refreshing = false;
     }
     return true;
@@ -9473,6 +9526,15 @@ bool simple_wallet::get_description(const std::vector<std::string>& args) {
 }
 //----------------------------------------------------------------------------------------------------
 bool simple_wallet::status(const std::vector<std::string>& args) {
+    // Don't touch the wallet or the daemon connection while a background refresh that is catching
+    // up is using them; its progress counters are all we need.
+    uint64_t refreshed = m_refresh_status.height.load(std::memory_order_relaxed);
+    uint64_t target = m_refresh_status.target.load(std::memory_order_relaxed);
+    if (m_auto_refresh_refreshing && refreshed < target) {
+        success_msg_writer() << "Refreshed " << refreshed << "/" << target
+                             << ", syncing (background refresh in progress)";
+        return true;
+    }
     uint64_t local_height = m_wallet->get_blockchain_current_height();
     rpc::version_t version;
     bool ssl = false;
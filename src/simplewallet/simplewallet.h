@@ -179,6 +179,7 @@ class simple_wallet : public tools::i_wallet2_callback {
     bool save_bc(const std::vector<std::string>& args);
     bool refresh(const std::vector<std::string>& args);
     bool show_balance_unlocked(bool detailed = false);
+    bool show_balance_snapshot();
     bool show_balance(const std::vector<std::string>& args = std::vector<std::string>());
     bool show_incoming_transfers(const std::vector<std::string>& args);
     bool show_payments(const std::vector<std::string>& args);
@@ -399,6 +400,7 @@ class simple_wallet : public tools::i_wallet2_callback {
     // idle thread workers
     bool check_inactivity();
     bool check_refresh(bool long_poll_trigger);
+    void update_balance_snapshot(uint64_t height);
 #ifdef WALLET_ENABLE_MMS
     bool check_mms();
 #endif
@@ -493,7 +495,7 @@ class simple_wallet : public tools::i_wallet2_callback {
     std::condition_variable m_idle_cond;
 
     std::atomic<bool> m_auto_refresh_enabled;
-    bool m_auto_refresh_refreshing;
+    std::atomic<bool> m_auto_refresh_refreshing;
     std::atomic<bool> m_in_manual_refresh;
     uint32_t m_current_subaddress_account;
 
@@ -501,6 +503,27 @@ class simple_wallet : public tools::i_wallet2_callback {
     crypto::hash m_password_asked_on_checksum;
     std::thread m_long_poll_thread;
 
+    // Progress of the background refresh, updated by the idle thread as it scans and readable
+    // from commands without pausing it.
+    struct {
+        std::atomic<uint64_t> height{0};
+        std::atomic<uint64_t> target{0};
+    } m_refresh_status;
+
+    // Balance of the current account as of the last block scanned by the background refresh, so
+    // that `balance` can answer without waiting for a long refresh to pause.  Guarded by its own
+    // mutex rather than the idle mutex held for the whole refresh.
+    struct balance_snapshot {
+        bool valid = false;
+        uint32_t account = 0;
+        uint64_t height = 0;
+        uint64_t balance = 0;
+        uint64_t unlocked = 0;
+        std::chrono::steady_clock::time_point time;
+    };
+    std::mutex m_balance_snapshot_mutex;
+    balance_snapshot m_balance_snapshot;
+
     std::atomic<time_t> m_last_activity_time;
     std::atomic<bool> m_locked;
     std::atomic<bool> m_in_command;
@@ -4,6 +4,8 @@
 #include <fmt/core.h>
 #include <sqlite3.h>
 
+#include <atomic>
+
 namespace db {
 std::string multi_in_query(std::string_view prefix, size_t count, std::string_view suffix) {
     std::string query;
@@ -18,27 +20,103 @@ std::string multi_in_query(std::string_view prefix, size_t count, std::string_vi
     return query;
 }
 
-Database::StatementWrapper Database::prepared_st(const std::string& query) {
-    std::unordered_map<std::string, SQLite::Statement>* sts;
+std::string multi_values_query(
+        std::string_view prefix, size_t rows, size_t columns, std::string_view suffix) {
+    std::string query;
+    query.reserve(prefix.size() + rows * (2 * columns + 2) + suffix.size());
+    query += prefix;
+    for (size_t r = 0; r < rows; r++) {
+        query += r > 0 ? ",(" : "(";
+        for (size_t c = 0; c < columns; c++) {
+            if (c > 0)
+                query += ',';
+            query += '?';
+        }
+        query += ')';
+    }
+    query += suffix;
+    return query;
+}
+
+Database::thread_state& Database::this_thread_state() {
+    // The calling thread's state for the database it used most recently; checked against the
+    // instance id rather than the address as a database could be destroyed and a new one
+    // allocated in its place.
+    thread_local uint64_t last_id = 0;
+    thread_local thread_state* last_state = nullptr;
+    if (last_id == instance_id)
+        return *last_state;
+
+    thread_state* state;
     {
-        std::shared_lock rlock{prepared_sts_mutex};
-        if (auto it = prepared_sts.find(std::this_thread::get_id()); it != prepared_sts.end())
-            sts = &it->second;
+        std::shared_lock rlock{thread_states_mutex};
+        if (auto it = thread_states.find(std::this_thread::get_id()); it != thread_states.end())
+            state = &it->second;
         else {
             rlock.unlock();
-            std::unique_lock wlock{prepared_sts_mutex};
-            sts = &prepared_sts.try_emplace(std::this_thread::get_id()).first->second;
+            std::unique_lock wlock{thread_states_mutex};
+            state = &thread_states.try_emplace(std::this_thread::get_id()).first->second;
         }
     }
-    if (auto qit = sts->find(query); qit != sts->end())
+    last_id = instance_id;
+    last_state = state;
+    return *state;
+}
+
+Database::StatementWrapper Database::prepared_st(std::string_view query) {
+    auto& state = this_thread_state();
+    bool reading = state.snapshot_depth > 0 && state.read_db;
+    auto& sts = reading ? state.read_statements : state.statements;
+    if (auto qit = sts.find(query); qit != sts.end())
         return StatementWrapper{qit->second};
-    return StatementWrapper{sts->try_emplace(query, db, query).first->second};
+    std::string q{query};
+    return StatementWrapper{sts.try_emplace(q, reading ? *state.read_db : db, q).first->second};
+}
+
+Database::ReadSnapshot::ReadSnapshot(Database& database, thread_state& state) :
+        database{database}, state{state} {
+    if (state.snapshot_depth++ > 0 || database.read_path.empty())
+        return;
+    try {
+        if (!state.read_db) {
+            state.read_db = std::make_unique<SQLite::Database>(
+                    database.read_path, SQLite::OPEN_READONLY, 5000 /*ms*/);
+            if (!database.password.empty())
+                state.read_db->key(database.password);
+        }
+        state.read_db->exec("BEGIN");
+    } catch (...) {
+        state.snapshot_depth--;
+        throw;
+    }
 }
 
+Database::ReadSnapshot::~ReadSnapshot() {
+    if (--state.snapshot_depth > 0 || !state.read_db)
+        return;
+    // Statements left stepping would keep the read transaction open
+    for (auto& [query, st] : state.read_statements)
+        st.tryReset();
+    if (int rc = state.read_db->tryExec("COMMIT"); rc != SQLITE_OK)
+        log::warning(
+                sqlitedb_logcat, "Failed to end read snapshot transaction: {}", sqlite3_errstr(rc));
+}
+
+Database::ReadSnapshot Database::read_snapshot() {
+    return ReadSnapshot{*this, this_thread_state()};
+}
+
+static std::atomic<uint64_t> next_instance_id{1};
+
 Database::Database(const fs::path& db_path, const std::string_view db_password) :
         db{db_path,
            SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLite::OPEN_FULLMUTEX,
-           5000 /*ms*/} {
+           5000 /*ms*/},
+        instance_id{next_instance_id++},
+        password{db_password} {
+    if (auto p = db_path.u8string(); !p.empty() && p != u8":memory:")
+        read_path = db_path;
+
     // Don't fail on these because we can still work even if they fail
     if (int rc = db.tryExec("PRAGMA journal_mode = WAL"); rc != SQLITE_OK)
         log::error(sqlitedb_logcat, "Failed to set journal mode to WAL: {}", sqlite3_errstr(rc));
@@ -4,7 +4,9 @@
 #include <common/string_util.h>
 #include <epee/misc_log_ex.h>
 
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <optional>
 #include <shared_mutex>
 #include <string_view>
@@ -189,6 +191,12 @@ std::vector<type_or_tuple<T...>> get_all(SQLite::Statement& st, const Bind&... b
 // Example: multi_in_query("foo(", 3, ")bar") will return "foo(?,?,?)bar"
 std::string multi_in_query(std::string_view prefix, size_t count, std::string_view suffix);
 
+// Takes a query prefix and suffix and places <rows> parenthesized groups of <columns> ? between
+// them, for multi-row VALUES lists.
+// Example: multi_values_query("VALUES ", 2, 3, "") will return "VALUES (?,?,?),(?,?,?)"
+std::string multi_values_query(
+        std::string_view prefix, size_t rows, size_t columns, std::string_view suffix);
+
 // Storage database class.
 class Database {
   public:
@@ -198,10 +206,42 @@ class Database {
     SQLite::Database db;
 
   private:
-    // SQLiteCpp's statements are not thread-safe, so we prepare them thread-locally when needed
-    std::unordered_map<std::thread::id, std::unordered_map<std::string, SQLite::Statement>>
-            prepared_sts;
-    std::shared_mutex prepared_sts_mutex;
+    // Lets the statement cache be looked up by string_view, so that passing a literal query
+    // doesn't have to allocate a std::string for every execution.
+    struct query_hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view query) const {
+            return std::hash<std::string_view>{}(query);
+        }
+    };
+    using statement_cache =
+            std::unordered_map<std::string, SQLite::Statement, query_hash, std::equal_to<>>;
+
+    // What each thread that uses the database has of its own.  SQLiteCpp's statements are not
+    // thread-safe, so we prepare them thread-locally when needed.
+    struct thread_state {
+        // Statements prepared on `db`
+        statement_cache statements;
+        // Read-only connection used while a read_snapshot() is active on this thread, opened on
+        // first use.
+        std::unique_ptr<SQLite::Database> read_db;
+        // Statements prepared on *read_db; declared after it so that they are finalized first.
+        statement_cache read_statements;
+        int snapshot_depth = 0;
+    };
+    std::unordered_map<std::thread::id, thread_state> thread_states;
+    std::shared_mutex thread_states_mutex;
+
+    // Unique (never reused) id of this database, used to recognize the calling thread's cached
+    // thread_state pointer so that repeat queries don't need to take thread_states_mutex.
+    const uint64_t instance_id;
+
+    // Where and how to open read connections; empty if the database can't have any (i.e. it is
+    // in-memory), in which case read snapshots just use `db`.
+    fs::path read_path;
+    std::string password;
+
+    thread_state& this_thread_state();
 
     /** Wrapper around a SQLite::Statement that calls `tryReset()` on destruction of the wrapper. */
     class StatementWrapper {
@@ -274,13 +314,33 @@ class Database {
 
   public:
     /// Prepares a query, caching it, and returns a wrapper that automatically resets the prepared
-    /// statement on destruction.
-    StatementWrapper prepared_st(const std::string& query);
+    /// statement on destruction.  Inside a read_snapshot() this prepares it on the thread's read
+    /// connection.
+    StatementWrapper prepared_st(std::string_view query);
+
+    /// Holds a read transaction on a connection of the calling thread's own, which the queries
+    /// this thread makes while it exists go through.  With WAL journaling these neither wait for
+    /// nor block writes on the main connection, and all see the database as it was when the first
+    /// of them ran.  The connection is read-only, so anything attempting a write inside a
+    /// snapshot throws.  Snapshots nest; only the outermost one begins and ends the transaction.
+    class ReadSnapshot {
+        Database& database;
+        thread_state& state;
+        ReadSnapshot(Database& database, thread_state& state);
+        friend class Database;
+
+      public:
+        ReadSnapshot(const ReadSnapshot&) = delete;
+        ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+        ~ReadSnapshot();
+    };
+
+    [[nodiscard]] ReadSnapshot read_snapshot();
 
     /// Prepares (with caching) and binds a query, returning the active statement handle.  Like
     /// `prepared_st` the wrapper resets the prepared statement on destruction.
     template <typename... T>
-    StatementWrapper prepared_bind(const std::string& query, const T&... bind) {
+    StatementWrapper prepared_bind(std::string_view query, const T&... bind) {
         auto st = prepared_st(query);
         bind_oneshot(st, bind...);
         return st;
@@ -290,21 +350,21 @@ class Database {
     /// through results where each row is a T or tuple<T...>:
     template <typename... T, typename... Bind>
         requires(sizeof...(T) != 0)
-    IterableStatementWrapper<T...> prepared_results(const std::string& query, const Bind&... bind) {
+    IterableStatementWrapper<T...> prepared_results(std::string_view query, const Bind&... bind) {
         return IterableStatementWrapper<T...>{prepared_bind(query, bind...)};
     }
 
     /// Prepares (with caching) a query and then executes it, optionally binding the given
     /// parameters when executing.
     template <typename... T>
-    int prepared_exec(const std::string& query, const T&... bind) {
+    int prepared_exec(std::string_view query, const T&... bind) {
         return exec_query(prepared_st(query), bind...);
     }
 
     /// Prepares (with caching) a query that returns a single row (with optional bind parameters),
     /// executes it, and returns the value.  Throws if the query returns 0 or more than 1 rows.
     template <typename... T, typename... Bind>
-    auto prepared_get(const std::string& query, const Bind&... bind) {
+    auto prepared_get(std::string_view query, const Bind&... bind) {
         return exec_and_get<T...>(prepared_st(query), bind...);
     }
 
@@ -312,7 +372,7 @@ class Database {
     /// parameters), executes it, and returns the value or nullopt if the query returned no rows.
     /// Throws if the query returns more than 1 rows.
     template <typename... T, typename... Bind>
-    auto prepared_maybe_get(const std::string& query, const Bind&... bind) {
+    auto prepared_maybe_get(std::string_view query, const Bind&... bind) {
         return exec_and_maybe_get<T...>(prepared_st(query), bind...);
     }
 
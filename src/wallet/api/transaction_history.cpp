@@ -30,6 +30,7 @@
 
 #include "transaction_history.h"
 
+#include <algorithm>
 #include <list>
 #include <string>
 
@@ -74,10 +75,8 @@ TransactionInfo* TransactionHistoryImpl::transaction(int index) const {
 EXPORT
 TransactionInfo* TransactionHistoryImpl::transaction(std::string_view id) const {
     std::shared_lock lock{m_historyMutex};
-    auto itr = std::find_if(m_history.begin(), m_history.end(), [&](const TransactionInfo* ti) {
-        return ti->hash() == id;
-    });
-    return itr != m_history.end() ? *itr : nullptr;
+    auto itr = m_hashIndex.find(id);
+    return itr != m_hashIndex.end() ? m_history[itr->second] : nullptr;
 }
 
 EXPORT
@@ -86,6 +85,16 @@ std::vector<TransactionInfo*> TransactionHistoryImpl::getAll() const {
     return m_history;
 }
 
+EXPORT
+std::vector<TransactionInfo*> TransactionHistoryImpl::getPage(int offset, int count) const {
+    std::shared_lock lock{m_historyMutex};
+    if (offset < 0 || count <= 0 || static_cast<size_t>(offset) >= m_history.size())
+        return {};
+    auto begin = m_history.begin() + offset;
+    auto end = begin + std::min<size_t>(count, m_history.end() - begin);
+    return {begin, end};
+}
+
 static reward_type from_pay_type(wallet::pay_type ptype) {
     switch (ptype) {
         case wallet::pay_type::service_node: return reward_type::service_node;
@@ -96,20 +105,16 @@ static reward_type from_pay_type(wallet::pay_type ptype) {
 
 EXPORT
 void TransactionHistoryImpl::refresh() {
-    // multithreaded access:
-    // for "write" access, locking exclusively
-    std::unique_lock lock{m_historyMutex};
+    // The new history is built without holding m_historyMutex (reading the wallet can take a
+    // while on large wallets) and only swapped in under the exclusive lock at the end, so readers
+    // never block on a rebuild.
+    std::vector<TransactionInfo*> history;
 
     // TODO: configurable values;
     uint64_t min_height = 0;
     uint64_t max_height = (uint64_t)-1;
     uint64_t wallet_height = m_wallet->blockChainHeight();
 
-    // delete old transactions;
-    for (auto t : m_history)
-        delete t;
-    m_history.clear();
-
     // transactions are stored in wallet2:
     // - confirmed_transfer_details   - out transfers
     // - unconfirmed_transfer_details - pending out transfers
@@ -144,7 +149,7 @@ void TransactionHistoryImpl::refresh() {
         ti->m_unlock_time = pd.m_unlock_time;
         ti->m_reward_type = from_pay_type(pd.m_type);
         ti->m_is_stake = pd.m_type == wallet::pay_type::stake;
-        m_history.push_back(ti);
+        history.push_back(ti);
     }
 
     // confirmed output transactions
@@ -195,7 +200,7 @@ void TransactionHistoryImpl::refresh() {
         for (const auto& d : pd.m_dests) {
             ti->m_transfers.push_back({d.amount, d.address(w->nettype(), pd.m_payment_id)});
         }
-        m_history.push_back(ti);
+        history.push_back(ti);
     }
 
     // unconfirmed output transactions
@@ -231,7 +236,7 @@ void TransactionHistoryImpl::refresh() {
         ti->m_timestamp = pd.m_timestamp;
         ti->m_confirmations = 0;
         ti->m_is_stake = pd.m_pay_type == wallet::pay_type::stake;
-        m_history.push_back(ti);
+        history.push_back(ti);
     }
 
     // unconfirmed payments (tx pool)
@@ -259,10 +264,27 @@ void TransactionHistoryImpl::refresh() {
         ti->m_confirmations = 0;
         ti->m_reward_type = from_pay_type(pd.m_type);
         ti->m_is_stake = pd.m_type == wallet::pay_type::stake;
-        m_history.push_back(ti);
+        history.push_back(ti);
 
         log::info(logcat, "{}: Unconfirmed payment found {}", __FUNCTION__, pd.m_amount);
     }
+
+    // A hash can appear more than once (e.g. a payment to several subaddresses); like the linear
+    // search this replaces, lookups by id return the first entry.
+    std::unordered_map<std::string_view, size_t> index;
+    index.reserve(history.size());
+    for (size_t i = 0; i < history.size(); i++)
+        index.emplace(static_cast<TransactionInfoImpl*>(history[i])->m_hash, i);
+
+    {
+        std::unique_lock lock{m_historyMutex};
+        m_history.swap(history);
+        m_hashIndex.swap(index);
+    }
+
+    // delete old transactions;
+    for (auto t : history)
+        delete t;
 }
 
 }  // namespace Wallet
@@ -29,6 +29,8 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
 
 #include "wallet/api/wallet2_api.h"
 
@@ -44,11 +46,14 @@ class TransactionHistoryImpl : public TransactionHistory {
     TransactionInfo* transaction(int index) const override;
     TransactionInfo* transaction(std::string_view id) const override;
     std::vector<TransactionInfo*> getAll() const override;
+    std::vector<TransactionInfo*> getPage(int offset, int count) const override;
     void refresh() override;
 
   private:
     // TransactionHistory is responsible of memory management
     std::vector<TransactionInfo*> m_history;
+    // tx hash -> index of its first entry in m_history; keys view the entries' own hash strings
+    std::unordered_map<std::string_view, size_t> m_hashIndex;
     WalletImpl* m_wallet;
     mutable std::shared_mutex m_historyMutex;
 };
@@ -126,6 +126,7 @@ struct Wallet2CallbackImpl : public tools::i_wallet2_callback {
             // log::trace(logcat, "{}: new block. height: {}", __FUNCTION__, height);
             if (m_listener) {
                 m_listener->newBlock(height);
+                m_listener->refreshProgress(height, m_wallet->m_refreshTargetHeight);
             }
         }
     }
@@ -485,6 +486,8 @@ EXPORT
 WalletImpl::~WalletImpl() {
 
     log::info(logcat, "{}", __FUNCTION__);
+    // Run out any queued async operations (as cancelled) while the wallet is still usable
+    stopAsync();
     m_wallet_ptr->callback(nullptr);
     // Stop refresh and long poll threads
     stopRefresh();
@@ -1732,6 +1735,59 @@ PendingTransaction* WalletImpl::createTransaction(
             subaddr_indices);
 }
 
+EXPORT
+std::shared_ptr<AsyncOperation> WalletImpl::createTransactionMultDestAsync(
+        const std::vector<std::string>& dst_addr,
+        std::optional<std::vector<uint64_t>> amount,
+        uint32_t priority,
+        uint32_t subaddr_account,
+        std::set<uint32_t> subaddr_indices,
+        std::function<void(PendingTransaction*)> callback) {
+    auto op = std::make_shared<AsyncOperationImpl>();
+    queueAsync(
+            op,
+            [this,
+             op,
+             dst_addr,
+             amount = std::move(amount),
+             priority,
+             subaddr_account,
+             subaddr_indices = std::move(subaddr_indices),
+             callback = std::move(callback)]() mutable {
+                PendingTransaction* tx = nullptr;
+                if (!op->cancelled())
+                    tx = createTransactionMultDest(
+                            dst_addr,
+                            std::move(amount),
+                            priority,
+                            subaddr_account,
+                            std::move(subaddr_indices));
+                if (!op->finish() && tx) {
+                    disposeTransaction(tx);
+                    tx = nullptr;
+                }
+                callback(tx);
+            });
+    return op;
+}
+
+EXPORT
+std::shared_ptr<AsyncOperation> WalletImpl::createTransactionAsync(
+        const std::string& dst_addr,
+        std::optional<uint64_t> amount,
+        uint32_t priority,
+        uint32_t subaddr_account,
+        std::set<uint32_t> subaddr_indices,
+        std::function<void(PendingTransaction*)> callback) {
+    return createTransactionMultDestAsync(
+            std::vector<std::string>{dst_addr},
+            amount ? (std::vector<uint64_t>{*amount}) : (std::optional<std::vector<uint64_t>>()),
+            priority,
+            subaddr_account,
+            std::move(subaddr_indices),
+            std::move(callback));
+}
+
 EXPORT
 PendingTransaction* WalletImpl::createSweepUnmixableTransaction()
 
@@ -1824,6 +1880,18 @@ TransactionHistory* WalletImpl::history() {
     return m_history.get();
 }
 
+EXPORT
+std::shared_ptr<AsyncOperation> WalletImpl::refreshHistoryAsync(
+        std::function<void(TransactionHistory*)> callback) {
+    auto op = std::make_shared<AsyncOperationImpl>();
+    queueAsync(op, [this, op, callback = std::move(callback)] {
+        if (!op->cancelled())
+            m_history->refresh();
+        callback(op->finish() ? m_history.get() : nullptr);
+    });
+    return op;
+}
+
 EXPORT
 AddressBook* WalletImpl::addressBook() {
     return m_addressBook.get();
@@ -2277,6 +2345,7 @@ void WalletImpl::doRefresh() {
                     w->light_wallet() ||
 #endif
                     daemonSynced()) {
+                m_refreshTargetHeight = daemonBlockChainHeight();
                 if (rescan)
                     w->rescan_blockchain(false);
                 w->refresh(trustedDaemon());
@@ -2333,6 +2402,82 @@ void WalletImpl::pauseRefresh() {
     }
 }
 
+EXPORT
+void WalletImpl::queueAsync(std::shared_ptr<AsyncOperationImpl> op, std::function<void()> job) {
+    std::unique_lock lock{m_asyncMutex};
+    if (m_asyncDone) {
+        // Wallet is being destroyed; report the operation as cancelled right away
+        lock.unlock();
+        op->cancel();
+        job();
+        return;
+    }
+    if (!m_asyncThread.joinable())
+        m_asyncThread = std::thread([this] { asyncThreadFunc(); });
+    m_asyncJobs.emplace_back(std::move(op), std::move(job));
+    m_asyncCV.notify_one();
+}
+
+EXPORT
+void WalletImpl::asyncThreadFunc() {
+    log::trace(logcat, "{}: starting async worker thread", __FUNCTION__);
+    std::unique_lock lock{m_asyncMutex};
+    while (true) {
+        m_asyncCV.wait(lock, [this] { return m_asyncDone || !m_asyncJobs.empty(); });
+        if (m_asyncJobs.empty())
+            break;
+        auto [op, job] = std::move(m_asyncJobs.front());
+        m_asyncJobs.pop_front();
+        // Anything still queued at shutdown gets its callback, but as a cancelled operation
+        if (m_asyncDone)
+            op->cancel();
+        lock.unlock();
+        try {
+            job();
+        } catch (const std::exception& e) {
+            log::error(logcat, "{}: async operation failed: {}", __FUNCTION__, e.what());
+        }
+        lock.lock();
+    }
+    log::trace(logcat, "{}: async worker thread stopped", __FUNCTION__);
+}
+
+EXPORT
+void WalletImpl::stopAsync() {
+    {
+        std::lock_guard lock{m_asyncMutex};
+        m_asyncDone = true;
+    }
+    m_asyncCV.notify_one();
+    if (m_asyncThread.joinable())
+        m_asyncThread.join();
+}
+
+EXPORT
+AsyncOperation::~AsyncOperation() {}
+
+EXPORT
+bool AsyncOperationImpl::cancel() {
+    auto expected = state::pending;
+    return m_state.compare_exchange_strong(expected, state::cancelled) ||
+           expected == state::cancelled;
+}
+
+EXPORT
+bool AsyncOperationImpl::cancelled() const {
+    return m_state == state::cancelled;
+}
+
+EXPORT
+bool AsyncOperationImpl::finished() const {
+    return m_state == state::finished;
+}
+
+bool AsyncOperationImpl::finish() {
+    auto expected = state::pending;
+    return m_state.compare_exchange_strong(expected, state::finished);
+}
+
 EXPORT
 bool WalletImpl::isNewWallet() const {
     // in case wallet created without daemon connection, closed and opened again,
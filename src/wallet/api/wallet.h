@@ -31,6 +31,8 @@
 #pragma once
 
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -52,6 +54,22 @@ class SubaddressImpl;
 class SubaddressAccountImpl;
 struct Wallet2CallbackImpl;
 
+class AsyncOperationImpl : public AsyncOperation {
+  public:
+    bool cancel() override;
+    bool cancelled() const override;
+    bool finished() const override;
+
+  private:
+    enum class state { pending, cancelled, finished };
+    std::atomic<state> m_state{state::pending};
+
+    // Marks the operation finished; returns false (and leaves it cancelled) if it was cancelled.
+    bool finish();
+
+    friend class WalletImpl;
+};
+
 // Wrapper that holds a lock to prevent background refreshes, which kill things; provides `->`
 // indirection into the tools::wallet2 instance.
 struct LockedWallet {
@@ -208,6 +226,20 @@ class WalletImpl : public Wallet {
             uint32_t subaddr_account = 0,
             std::set<uint32_t> subaddr_indices = {}) override;
     PendingTransaction* createSweepUnmixableTransaction() override;
+    std::shared_ptr<AsyncOperation> createTransactionMultDestAsync(
+            const std::vector<std::string>& dst_addr,
+            std::optional<std::vector<uint64_t>> amount,
+            uint32_t priority,
+            uint32_t subaddr_account,
+            std::set<uint32_t> subaddr_indices,
+            std::function<void(PendingTransaction*)> callback) override;
+    std::shared_ptr<AsyncOperation> createTransactionAsync(
+            const std::string& dst_addr,
+            std::optional<uint64_t> amount,
+            uint32_t priority,
+            uint32_t subaddr_account,
+            std::set<uint32_t> subaddr_indices,
+            std::function<void(PendingTransaction*)> callback) override;
     bool submitTransaction(std::string_view filename) override;
     UnsignedTransaction* loadUnsignedTx(std::string_view unsigned_filename) override;
     bool exportKeyImages(std::string_view filename) override;
@@ -216,6 +248,8 @@ class WalletImpl : public Wallet {
     void disposeTransaction(PendingTransaction* t) override;
     uint64_t estimateTransactionFee(uint32_t priority, uint32_t recipients = 1) const override;
     TransactionHistory* history() override;
+    std::shared_ptr<AsyncOperation> refreshHistoryAsync(
+            std::function<void(TransactionHistory*)> callback) override;
     AddressBook* addressBook() override;
     Subaddress* subaddress() override;
     SubaddressAccount* subaddressAccount() override;
@@ -323,6 +357,11 @@ class WalletImpl : public Wallet {
     void doRefresh();
     bool daemonSynced() const;
     void stopRefresh();
+    // Queues `job` on the async worker thread (starting it if needed).  `job` is always run, even
+    // during shutdown, but is expected to check `op` and skip its work if cancelled.
+    void queueAsync(std::shared_ptr<AsyncOperationImpl> op, std::function<void()> job);
+    void asyncThreadFunc();
+    void stopAsync();
     bool isNewWallet() const;
     void pendingTxPostProcess(PendingTransactionImpl* pending);
     bool doInit(
@@ -362,6 +401,15 @@ class WalletImpl : public Wallet {
     std::condition_variable m_refreshCV;
     std::thread m_refreshThread;
     std::thread m_longPollThread;
+    // daemon height at the start of the current refresh, for WalletListener::refreshProgress
+    std::atomic<uint64_t> m_refreshTargetHeight{0};
+
+    // serial worker for the ...Async methods; started on first use
+    std::mutex m_asyncMutex;
+    std::condition_variable m_asyncCV;
+    std::deque<std::pair<std::shared_ptr<AsyncOperationImpl>, std::function<void()>>> m_asyncJobs;
+    std::thread m_asyncThread;
+    bool m_asyncDone = false;
 
     // flag indicating wallet is recovering from seed
     // so it shouldn't be considered as new and pull blocks (slow-refresh)
@@ -32,8 +32,10 @@
 
 #include <chrono>
 #include <ctime>
+#include <functional>
 #include <iostream>
 #include <list>
+#include <memory>
 #include <optional>
 #include <set>
 #include <stdexcept>
@@ -189,6 +191,15 @@ struct TransactionHistory {
     virtual TransactionInfo* transaction(int index) const = 0;
     virtual TransactionInfo* transaction(std::string_view id) const = 0;
     virtual std::vector<TransactionInfo*> getAll() const = 0;
+    /**
+     * @brief getPage - returns up to `count` entries starting at `offset`; an empty vector if the
+     * offset is past the end.  Returned pointers stay valid until the next refresh().
+     */
+    virtual std::vector<TransactionInfo*> getPage(int offset, int count) const = 0;
+    /**
+     * @brief refresh - rebuilds the history from the wallet.  The rebuild happens without blocking
+     * concurrent readers, which keep seeing the previous history until it completes.
+     */
     virtual void refresh() = 0;
 };
 
@@ -315,6 +326,30 @@ struct DeviceProgress {
     bool m_indeterminate;
 };
 
+/**
+ * @brief AsyncOperation - handle to an operation started by one of the Wallet `...Async` methods.
+ * The operation's callback is invoked exactly once, on the wallet's background worker thread.
+ */
+struct AsyncOperation {
+    virtual ~AsyncOperation() = 0;
+    /**
+     * @brief cancel - requests cancellation.  An operation that has not started yet never runs; one
+     * that is already running completes, but its result is discarded.  Either way the callback
+     * receives a null result.
+     * @return false if the operation had already finished, true otherwise
+     */
+    virtual bool cancel() = 0;
+    /**
+     * @brief cancelled - returns true if cancel() was called before the operation finished
+     */
+    virtual bool cancelled() const = 0;
+    /**
+     * @brief finished - returns true once the operation has completed without being cancelled (its
+     * callback is then about to be, or has been, invoked with the result)
+     */
+    virtual bool finished() const = 0;
+};
+
 struct Wallet;
 struct WalletListener {
     virtual ~WalletListener() = 0;
@@ -357,6 +392,16 @@ struct WalletListener {
      */
     virtual void refreshed() = 0;
 
+    /**
+     * @brief refreshProgress - called periodically while the wallet is refreshing
+     * @param height        - height the wallet has scanned up to
+     * @param target_height - daemon height the refresh is catching up to (0 if unknown)
+     */
+    virtual void refreshProgress(uint64_t height, uint64_t target_height) {
+        (void)height;
+        (void)target_height;
+    }
+
     /**
      * @brief called by device if the action is required
      */
@@ -913,6 +958,33 @@ struct Wallet {
 
     virtual PendingTransaction* createSweepUnmixableTransaction() = 0;
 
+    /*!
+     * \brief createTransactionMultDestAsync - non-blocking version of createTransactionMultDest.
+     * The transaction is built on the wallet's background worker thread and passed to `callback`,
+     * which takes ownership as with createTransactionMultDest (release it with
+     * disposeTransaction).  The callback receives nullptr if the operation is cancelled.
+     * \return handle that can be used to cancel the operation
+     */
+    virtual std::shared_ptr<AsyncOperation> createTransactionMultDestAsync(
+            const std::vector<std::string>& dst_addr,
+            std::optional<std::vector<uint64_t>> amount,
+            uint32_t priority,
+            uint32_t subaddr_account,
+            std::set<uint32_t> subaddr_indices,
+            std::function<void(PendingTransaction*)> callback) = 0;
+
+    /*!
+     * \brief createTransactionAsync - non-blocking version of createTransaction; see
+     * createTransactionMultDestAsync.
+     */
+    virtual std::shared_ptr<AsyncOperation> createTransactionAsync(
+            const std::string& dst_addr,
+            std::optional<uint64_t> amount,
+            uint32_t priority,
+            uint32_t subaddr_account,
+            std::set<uint32_t> subaddr_indices,
+            std::function<void(PendingTransaction*)> callback) = 0;
+
     /*!
      * \brief loadUnsignedTx  - creates transaction from unsigned tx file (utf8 filename)
      * \return                - UnsignedTransaction object. caller is responsible to check
@@ -957,6 +1029,14 @@ struct Wallet {
     virtual bool importKeyImages(std::string_view filename) = 0;
 
     virtual TransactionHistory* history() = 0;
+    /*!
+     * \brief refreshHistoryAsync - rebuilds history() on the wallet's background worker thread and
+     * then invokes `callback` with it (or with nullptr if cancelled).  Readers of history() are not
+     * blocked while the rebuild runs.
+     * \return handle that can be used to cancel the operation
+     */
+    virtual std::shared_ptr<AsyncOperation> refreshHistoryAsync(
+            std::function<void(TransactionHistory*)> callback) = 0;
     virtual AddressBook* addressBook() = 0;
     virtual Subaddress* subaddress() = 0;
     virtual SubaddressAccount* subaddressAccount() = 0;
@@ -226,7 +226,7 @@ namespace {
         return n_entries * (32 + 1024);  // highball 1kB for the ring data to make sure
     }
 
-    enum { BLACKBALL_BLACKBALL, BLACKBALL_UNBLACKBALL, BLACKBALL_QUERY, BLACKBALL_CLEAR };
+    enum { BLACKBALL_BLACKBALL, BLACKBALL_UNBLACKBALL, BLACKBALL_CLEAR };
 
 }  // anonymous namespace
 
@@ -299,6 +299,7 @@ ringdb::~ringdb() {
 }
 
 void ringdb::close() {
+    end_read_txn();
     if (env) {
         mdb_dbi_close(env, dbi_rings);
         mdb_dbi_close(env, dbi_blackballs);
@@ -307,13 +308,66 @@ void ringdb::close() {
     }
 }
 
+ringdb::read_session::read_session(ringdb& db) : db_{db} {
+    db_.read_sessions_++;
+}
+
+ringdb::read_session::~read_session() {
+    if (--db_.read_sessions_ == 0)
+        db_.end_read_txn();
+}
+
+MDB_txn* ringdb::begin_read_txn() {
+    if (read_txn_)
+        return read_txn_;
+
+    MDB_txn* txn;
+    int dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+    if (dbr == MDB_MAP_RESIZED) {
+        // Another process grew the database; adopt its size and try again
+        dbr = mdb_env_set_mapsize(env, 0);
+        if (!dbr)
+            dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+    }
+    THROW_WALLET_EXCEPTION_IF(
+            dbr,
+            tools::error::wallet_internal_error,
+            "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+    if (read_sessions_)
+        read_txn_ = txn;
+    return txn;
+}
+
+void ringdb::end_read_txn(MDB_txn* txn) {
+    if (txn != read_txn_)
+        mdb_txn_abort(txn);
+}
+
+void ringdb::end_read_txn() {
+    if (read_txn_) {
+        mdb_txn_abort(read_txn_);
+        read_txn_ = nullptr;
+    }
+}
+
 bool ringdb::add_rings(
         const crypto::chacha_key& chacha_key, const cryptonote::transaction_prefix& tx) {
+    return add_rings(chacha_key, std::vector{&tx});
+}
+
+bool ringdb::add_rings(
+        const crypto::chacha_key& chacha_key,
+        const std::vector<const cryptonote::transaction_prefix*>& txs) {
     MDB_txn* txn;
     int dbr;
     bool tx_active = false;
 
-    dbr = resize_env(env, filename_, get_ring_data_size(tx.vin.size()));
+    size_t n_inputs = 0;
+    for (const auto* tx : txs)
+        n_inputs += tx->vin.size();
+
+    end_read_txn();
+    dbr = resize_env(env, filename_, get_ring_data_size(n_inputs));
     THROW_WALLET_EXCEPTION_IF(
             dbr, tools::error::wallet_internal_error, "Failed to set env map size");
     dbr = mdb_txn_begin(env, NULL, 0, &txn);
@@ -327,15 +381,17 @@ bool ringdb::add_rings(
     };
     tx_active = true;
 
-    for (const auto& in : tx.vin) {
-        if (!std::holds_alternative<cryptonote::txin_to_key>(in))
-            continue;
-        const auto& txin = var::get<cryptonote::txin_to_key>(in);
-        const uint32_t ring_size = txin.key_offsets.size();
-        if (ring_size == 1)
-            continue;
+    for (const auto* tx : txs) {
+        for (const auto& in : tx->vin) {
+            if (!std::holds_alternative<cryptonote::txin_to_key>(in))
+                continue;
+            const auto& txin = var::get<cryptonote::txin_to_key>(in);
+            const uint32_t ring_size = txin.key_offsets.size();
+            if (ring_size == 1)
+                continue;
 
-        store_relative_ring(txn, dbi_rings, txin.k_image, txin.key_offsets, chacha_key);
+            store_relative_ring(txn, dbi_rings, txin.k_image, txin.key_offsets, chacha_key);
+        }
     }
 
     dbr = mdb_txn_commit(txn);
@@ -353,6 +409,7 @@ bool ringdb::remove_rings(
     int dbr;
     bool tx_active = false;
 
+    end_read_txn();
     dbr = resize_env(env, filename_, 0);
     THROW_WALLET_EXCEPTION_IF(
             dbr, tools::error::wallet_internal_error, "Failed to set env map size");
@@ -420,31 +477,16 @@ bool ringdb::get_ring(
         const crypto::chacha_key& chacha_key,
         const crypto::key_image& key_image,
         std::vector<uint64_t>& outs) {
-    MDB_txn* txn;
-    int dbr;
-    bool tx_active = false;
-
-    dbr = resize_env(env, filename_, 0);
-    THROW_WALLET_EXCEPTION_IF(
-            dbr,
-            tools::error::wallet_internal_error,
-            "Failed to set env map size: " + std::string(mdb_strerror(dbr)));
-    dbr = mdb_txn_begin(env, NULL, 0, &txn);
-    THROW_WALLET_EXCEPTION_IF(
-            dbr,
-            tools::error::wallet_internal_error,
-            "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+    MDB_txn* txn = begin_read_txn();
     OXEN_DEFER {
-        if (tx_active)
-            mdb_txn_abort(txn);
+        end_read_txn(txn);
     };
-    tx_active = true;
 
     MDB_val key, data;
     std::string key_ciphertext = encrypt(key_image, chacha_key, 0);
     key.mv_data = (void*)key_ciphertext.data();
     key.mv_size = key_ciphertext.size();
-    dbr = mdb_get(txn, dbi_rings, &key, &data);
+    int dbr = mdb_get(txn, dbi_rings, &key, &data);
     THROW_WALLET_EXCEPTION_IF(
             dbr && dbr != MDB_NOTFOUND,
             tools::error::wallet_internal_error,
@@ -473,13 +515,6 @@ bool ringdb::get_ring(
     log::debug(logcat, "Relative: {}", tools::join(" ", outs));
     outs = cryptonote::relative_output_offsets_to_absolute(outs);
     log::debug(logcat, "Absolute: {}", tools::join(" ", outs));
-
-    dbr = mdb_txn_commit(txn);
-    THROW_WALLET_EXCEPTION_IF(
-            dbr,
-            tools::error::wallet_internal_error,
-            "Failed to commit txn getting ring from database: " + std::string(mdb_strerror(dbr)));
-    tx_active = false;
     return true;
 }
 
@@ -488,11 +523,23 @@ bool ringdb::set_ring(
         const crypto::key_image& key_image,
         const std::vector<uint64_t>& outs,
         bool relative) {
+    return set_rings(chacha_key, {{key_image, outs}}, relative);
+}
+
+bool ringdb::set_rings(
+        const crypto::chacha_key& chacha_key,
+        const std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>>& rings,
+        bool relative) {
     MDB_txn* txn;
     int dbr;
     bool tx_active = false;
 
-    dbr = resize_env(env, filename_, outs.size() * 64);
+    size_t n_outs = 0;
+    for (const auto& [key_image, outs] : rings)
+        n_outs += outs.size();
+
+    end_read_txn();
+    dbr = resize_env(env, filename_, n_outs * 64);
     THROW_WALLET_EXCEPTION_IF(
             dbr,
             tools::error::wallet_internal_error,
@@ -508,12 +555,13 @@ bool ringdb::set_ring(
     };
     tx_active = true;
 
-    store_relative_ring(
-            txn,
-            dbi_rings,
-            key_image,
-            relative ? outs : cryptonote::absolute_output_offsets_to_relative(outs),
-            chacha_key);
+    for (const auto& [key_image, outs] : rings)
+        store_relative_ring(
+                txn,
+                dbi_rings,
+                key_image,
+                relative ? outs : cryptonote::absolute_output_offsets_to_relative(outs),
+                chacha_key);
 
     dbr = mdb_txn_commit(txn);
     THROW_WALLET_EXCEPTION_IF(
@@ -529,13 +577,8 @@ bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>>&
     MDB_cursor* cursor;
     int dbr;
     bool tx_active = false;
-    bool ret = true;
-
-    THROW_WALLET_EXCEPTION_IF(
-            outputs.size() > 1 && op == BLACKBALL_QUERY,
-            tools::error::wallet_internal_error,
-            "Blackball query only makes sense for a single output");
 
+    end_read_txn();
     dbr = resize_env(env, filename_, 32 * 2 * outputs.size());  // a pubkey, and some slack
     THROW_WALLET_EXCEPTION_IF(
             dbr,
@@ -578,16 +621,6 @@ bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>>&
                 if (dbr == 0)
                     dbr = mdb_cursor_del(cursor, 0);
                 break;
-            case BLACKBALL_QUERY:
-                dbr = mdb_cursor_get(cursor, &key, &data, MDB_GET_BOTH);
-                THROW_WALLET_EXCEPTION_IF(
-                        dbr && dbr != MDB_NOTFOUND,
-                        tools::error::wallet_internal_error,
-                        "Failed to lookup in blackballs table: " + std::string(mdb_strerror(dbr)));
-                ret = dbr != MDB_NOTFOUND;
-                if (dbr == MDB_NOTFOUND)
-                    dbr = 0;
-                break;
             case BLACKBALL_CLEAR: break;
             default:
                 THROW_WALLET_EXCEPTION(tools::error::wallet_internal_error, "Invalid blackball op");
@@ -615,7 +648,7 @@ bool ringdb::blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>>&
             "Failed to commit txn blackballing output to database: " +
                     std::string(mdb_strerror(dbr)));
     tx_active = false;
-    return ret;
+    return true;
 }
 
 bool ringdb::blackball(const std::vector<std::pair<uint64_t, uint64_t>>& outputs) {
@@ -633,8 +666,29 @@ bool ringdb::unblackball(const std::pair<uint64_t, uint64_t>& output) {
 }
 
 bool ringdb::blackballed(const std::pair<uint64_t, uint64_t>& output) {
-    std::vector<std::pair<uint64_t, uint64_t>> outputs(1, output);
-    return blackball_worker(outputs, BLACKBALL_QUERY);
+    MDB_txn* txn = begin_read_txn();
+    OXEN_DEFER {
+        end_read_txn(txn);
+    };
+
+    MDB_cursor* cursor;
+    int dbr = mdb_cursor_open(txn, dbi_blackballs, &cursor);
+    THROW_WALLET_EXCEPTION_IF(
+            dbr,
+            tools::error::wallet_internal_error,
+            "Failed to create cursor for blackballs table: " + std::string(mdb_strerror(dbr)));
+    OXEN_DEFER {
+        mdb_cursor_close(cursor);
+    };
+
+    MDB_val key{sizeof(output.first), (void*)&output.first};
+    MDB_val data{sizeof(output.second), (void*)&output.second};
+    dbr = mdb_cursor_get(cursor, &key, &data, MDB_GET_BOTH);
+    THROW_WALLET_EXCEPTION_IF(
+            dbr && dbr != MDB_NOTFOUND,
+            tools::error::wallet_internal_error,
+            "Failed to lookup in blackballs table: " + std::string(mdb_strerror(dbr)));
+    return dbr != MDB_NOTFOUND;
 }
 
 bool ringdb::clear_blackballs() {
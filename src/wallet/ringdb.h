@@ -47,7 +47,27 @@ class ringdb {
 
     const fs::path& filename() { return filename_; }
 
+    /// While one of these exists, ring and blackball lookups share a single read-only LMDB
+    /// transaction instead of starting one each, which matters when building a tx looks up many
+    /// of them.  Any write to the database ends the shared transaction (LMDB doesn't allow a
+    /// thread to have both at once), and the next lookup starts a new one.
+    class read_session {
+      public:
+        explicit read_session(ringdb& db);
+        ~read_session();
+
+        read_session(const read_session&) = delete;
+        read_session& operator=(const read_session&) = delete;
+
+      private:
+        ringdb& db_;
+    };
+
     bool add_rings(const crypto::chacha_key& chacha_key, const cryptonote::transaction_prefix& tx);
+    // Adds the rings of all of the given txes in a single LMDB transaction
+    bool add_rings(
+            const crypto::chacha_key& chacha_key,
+            const std::vector<const cryptonote::transaction_prefix*>& txs);
     bool remove_rings(
             const crypto::chacha_key& chacha_key, const std::vector<crypto::key_image>& key_images);
     bool remove_rings(
@@ -61,6 +81,11 @@ class ringdb {
             const crypto::key_image& key_image,
             const std::vector<uint64_t>& outs,
             bool relative);
+    // Sets the rings of all of the given key images in a single LMDB transaction
+    bool set_rings(
+            const crypto::chacha_key& chacha_key,
+            const std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>>& rings,
+            bool relative);
 
     bool blackball(const std::pair<uint64_t, uint64_t>& output);
     bool blackball(const std::vector<std::pair<uint64_t, uint64_t>>& outputs);
@@ -70,11 +95,19 @@ class ringdb {
 
   private:
     bool blackball_worker(const std::vector<std::pair<uint64_t, uint64_t>>& outputs, int op);
+    // Returns a read-only transaction for a lookup: the shared one during a read session
+    // (starting it if needed), otherwise a new one.  Pass it to end_read_txn(txn) when done.
+    MDB_txn* begin_read_txn();
+    void end_read_txn(MDB_txn* txn);
+    // Ends the shared read transaction, if there is one
+    void end_read_txn();
 
   private:
     fs::path filename_;
     MDB_env* env = nullptr;
     MDB_dbi dbi_rings;
     MDB_dbi dbi_blackballs;
+    int read_sessions_ = 0;
+    MDB_txn* read_txn_ = nullptr;
 };
 }  // namespace tools
@@ -38,6 +38,8 @@
 #include <oxenc/base64.h>
 #include <oxenc/endian.h>
 
+#include <deque>
+#include <exception>
 #include <iterator>
 #include <mutex>
 #include <numeric>
@@ -141,6 +143,16 @@ namespace {
 
     constexpr uint64_t FIRST_REFRESH_GRANULARITY = 1024;
 
+    // refresh() sizes the batches it asks for so that each takes about this long to scan, within
+    // these limits: big enough that round trips don't dominate, small enough to keep the pipeline
+    // moving and stop() responsive when blocks are expensive to process.
+    constexpr auto REFRESH_BATCH_TARGET = 2s;
+    constexpr uint64_t REFRESH_MIN_BATCH = 100;
+
+    // how many of the most recent blocks of the cached rct distribution get refetched, to pick up
+    // shallow reorgs
+    constexpr uint64_t RCT_DISTRIBUTION_REFETCH_BLOCKS = 10;
+
     constexpr double GAMMA_SHAPE = 19.28;
     constexpr double GAMMA_SCALE = 1 / 1.61;
 
@@ -1394,6 +1406,7 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended) :
         m_devices_registered(false),
         m_device_last_key_image_sync(0),
         m_offline(false),
+        m_immutable_height(0),
         m_rpc_version(0) {}
 
 wallet2::~wallet2() {}
@@ -1560,6 +1573,7 @@ bool wallet2::set_daemon(
     m_long_poll_local = localhost;
 
     m_node_rpc_proxy.invalidate();
+    m_rct_distribution.clear();
 
     std::string url = m_http_client.get_base_url();
     log::info(logcat, "set daemon to {}", (url.empty() ? "(none, offline)" : url));
@@ -1798,6 +1812,7 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index) {
                     (index2.major == index.major ? index.minor : 0), m_subaddress_lookahead_minor);
             const std::vector<crypto::public_key> pkeys = hwdev.get_subaddress_spend_public_keys(
                     m_account.get_keys(), index2.major, 0, end);
+            m_subaddresses.reserve(m_subaddresses.size() + end);
             for (index2.minor = 0; index2.minor < end; ++index2.minor) {
                 const crypto::public_key& D = pkeys[index2.minor];
                 m_subaddresses[D] = index2;
@@ -1813,6 +1828,7 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index) {
         cryptonote::subaddress_index index2 = {index.major, begin};
         const std::vector<crypto::public_key> pkeys = hwdev.get_subaddress_spend_public_keys(
                 m_account.get_keys(), index2.major, index2.minor, end);
+        m_subaddresses.reserve(m_subaddresses.size() + (end - begin));
         for (; index2.minor < end; ++index2.minor) {
             const crypto::public_key& D = pkeys[index2.minor - begin];
             m_subaddresses[D] = index2;
@@ -1875,6 +1891,7 @@ void wallet2::set_spent(size_t idx, uint64_t height) {
             print_money(td.m_amount));
     td.m_spent = true;
     td.m_spent_height = height;
+    invalidate_balance_cache();
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::set_unspent(size_t idx) {
@@ -1884,6 +1901,7 @@ void wallet2::set_unspent(size_t idx) {
             logcat, "Setting UNSPENT: ki {}, amount {}", td.m_key_image, print_money(td.m_amount));
     td.m_spent = false;
     td.m_spent_height = 0;
+    invalidate_balance_cache();
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::is_spent(const transfer_details& td, bool strict) const {
@@ -1904,12 +1922,14 @@ void wallet2::freeze(size_t idx) {
     CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid transfer_details index");
     transfer_details& td = m_transfers[idx];
     td.m_frozen = true;
+    invalidate_balance_cache();
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::thaw(size_t idx) {
     CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid transfer_details index");
     transfer_details& td = m_transfers[idx];
     td.m_frozen = false;
+    invalidate_balance_cache();
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::frozen(size_t idx) const {
@@ -2034,6 +2054,39 @@ static uint64_t decodeRct(
     }
 }
 //----------------------------------------------------------------------------------------------------
+// Decodes the amounts of the received RingCT outputs of `tx` together (see rct::decodeRctBatch),
+// leaving them in `tx_scan_info` for scan_output.  One that doesn't decode is left alone, for
+// scan_output to try (and report) on its own.
+static void decode_received_amounts(
+        const cryptonote::transaction& tx,
+        std::vector<wallet2::tx_scan_info_t>& tx_scan_info,
+        hw::device& hwdev) {
+    const auto& rv = tx.rct_signatures;
+    if (rv.type != rct::RCTType::Full && !rct::is_rct_simple(rv.type))
+        return;
+    std::vector<size_t> indices;
+    std::vector<std::pair<unsigned int, rct::key>> outputs;
+    for (size_t i = 0; i < tx_scan_info.size(); ++i) {
+        if (!tx_scan_info[i].received || tx_scan_info[i].money_transfered != 0)
+            continue;
+        crypto::secret_key scalar1;
+        hwdev.derivation_to_scalar(tx_scan_info[i].received->derivation, i, scalar1);
+        indices.push_back(i);
+        outputs.emplace_back(i, rct::sk2rct(scalar1));
+    }
+    if (outputs.size() < 2)
+        return;
+    try {
+        auto decoded = rct::decodeRctBatch(rv, outputs, hwdev);
+        for (size_t j = 0; j < indices.size(); ++j)
+            if (decoded[j])
+                std::tie(tx_scan_info[indices[j]].money_transfered,
+                         tx_scan_info[indices[j]].mask) = *decoded[j];
+    } catch (const std::exception& e) {
+        log::warning(logcat, "Failed to batch decode outputs: {}", e.what());
+    }
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::scan_output(
         const cryptonote::transaction& tx,
         bool miner_tx,
@@ -2379,13 +2432,18 @@ void wallet2::process_new_transaction(
                         tx,
                         tx_pub_key,
                         m_account.get_keys());
-                if (tx_scan_info[i].received) {
+                if (tx_scan_info[i].received)
                     hwdev.conceal_derivation(
                             tx_scan_info[i].received->derivation,
                             tx_pub_key,
                             additional_tx_pub_keys.data,
                             derivation,
                             additional_derivations);
+            }
+            if (!miner_tx)
+                decode_received_amounts(tx, tx_scan_info, hwdev);
+            for (size_t i = 0; i < tx.vout.size(); ++i) {
+                if (tx_scan_info[i].received) {
                     scan_output(
                             tx,
                             miner_tx,
@@ -2729,6 +2787,7 @@ void wallet2::process_new_transaction(
                             tx.vout[o].amount ? tx.vout[o].amount : tx_scan_info[o].amount;
                     uint64_t extra_amount = amount - transfer.amount();
                     if (process_transaction) {
+                        invalidate_balance_cache();
                         transfer.m_block_height = height;
                         transfer.m_internal_output_index = o;
                         transfer.m_global_output_index =
@@ -3008,7 +3067,7 @@ void wallet2::process_new_transaction(
                     m_callback->on_unconfirmed_money_received(
                             height, txid, tx, payment.m_amount, payment.m_subaddr_index);
             } else
-                m_payments.emplace(payment_id, payment);
+                index_payment(*m_payments.emplace(payment_id, payment));
             log::debug(
                     logcat,
                     "Payment found in {}: {} / {} / {}",
@@ -3035,6 +3094,8 @@ void wallet2::process_new_transaction(
                 pd.m_unmined_blink = false;
             }
         }
+        invalidate_history_index();
+        invalidate_balance_cache();
 
         // All transfers from the earliest confirmed blink iterator needs to be
         // re-sorted since the blink was confirmed in the mempool and inserted
@@ -3081,8 +3142,10 @@ wallet2::confirmed_transfer_details* wallet2::process_unconfirmed(
             try {
                 auto [it, ins] = m_confirmed_txs.emplace(
                         txid, confirmed_transfer_details{unconf_it->second, height});
-                if (ins)
+                if (ins) {
                     ctd = &it->second;
+                    index_confirmed(*it);
+                }
             } catch (...) {
                 // can fail if the tx has unexpected input types
                 log::warning(
@@ -3090,6 +3153,7 @@ wallet2::confirmed_transfer_details* wallet2::process_unconfirmed(
             }
         }
         m_unconfirmed_txs.erase(unconf_it);
+        invalidate_balance_cache();
     }
     return ctd;
 }
@@ -3134,10 +3198,14 @@ void wallet2::process_outgoing(
     for (const auto& in : tx.vin)
         if (auto* txin = std::get_if<cryptonote::txin_to_key>(&in))
             details.m_rings.push_back(std::make_pair(txin->k_image, txin->key_offsets));
+    if (!ins && details.m_block_height != height)
+        invalidate_history_index();
     details.m_block_height = height;
     details.m_timestamp = ts;
     details.m_unlock_time = tx.unlock_time;
     details.m_unlock_times = tx.output_unlock_times;
+    if (ins)
+        index_confirmed(*it);
 
     add_rings(tx);
 }
@@ -3289,7 +3357,9 @@ void wallet2::pull_blocks(
         const std::list<crypto::hash>& short_chain_history,
         std::vector<cryptonote::block_complete_entry>& blocks,
         std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices>& o_indices,
-        uint64_t& current_height) {
+        uint64_t& current_height,
+        uint64_t max_count,
+        cryptonote::rpc::http_client* client) {
     cryptonote::rpc::GET_BLOCKS_BIN::request req{};
     cryptonote::rpc::GET_BLOCKS_BIN::response res{};
     req.block_ids = short_chain_history;
@@ -3299,7 +3369,8 @@ void wallet2::pull_blocks(
     req.prune = true;
     req.start_height = start_height;
     req.no_miner_tx = m_refresh_type == RefreshNoCoinbase;
-    bool r = invoke_http<rpc::GET_BLOCKS_BIN>(req, res);
+    req.max_count = max_count;
+    bool r = invoke_http<rpc::GET_BLOCKS_BIN>(client ? *client : m_http_client, req, res);
     THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getblocks.bin");
     THROW_WALLET_EXCEPTION_IF(res.status == rpc::STATUS_BUSY, error::daemon_busy, "getblocks.bin");
     THROW_WALLET_EXCEPTION_IF(
@@ -3406,58 +3477,94 @@ void wallet2::process_parsed_blocks(
     hwdev.set_mode(hw::device::mode::TRANSACTION_PARSE);
     const cryptonote::account_keys& keys = m_account.get_keys();
 
+    auto derivation_failed = [](wallet2::is_out_data& iod) {
+        log::warning(logcat, "Failed to generate key derivation from tx pubkey, skipping");
+        static_assert(
+                sizeof(iod.derivation) == sizeof(rct::key),
+                "Mismatched sizes of key_derivation and rct::key");
+        memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
+    };
     auto gender = [&](wallet2::is_out_data& iod) {
-        if (!hwdev.generate_key_derivation(iod.pkey, keys.m_view_secret_key, iod.derivation)) {
-            log::warning(logcat, "Failed to generate key derivation from tx pubkey, skipping");
-            static_assert(
-                    sizeof(iod.derivation) == sizeof(rct::key),
-                    "Mismatched sizes of key_derivation and rct::key");
-            memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
-        }
+        if (!hwdev.generate_key_derivation(iod.pkey, keys.m_view_secret_key, iod.derivation))
+            derivation_failed(iod);
     };
 
-    for (size_t i = 0; i < tx_cache_data.size(); ++i) {
-        if (tx_cache_data[i].empty())
-            continue;
-        tpool.submit(
-                &waiter,
-                [&hwdev, &gender, &tx_cache_data, i]() {
-                    auto& slot = tx_cache_data[i];
-                    std::unique_lock hwdev_lock{hwdev};
-                    for (auto& iod : slot.primary)
-                        gender(iod);
-                    for (auto& iod : slot.additional)
-                        gender(iod);
-                },
-                true);
+    if (hwdev.is_hardware_device()) {
+        // Threads would only queue up on the device lock, so hand the device the whole batch at
+        // once instead and let it save what round trips it can.
+        std::vector<crypto::public_key> pkeys;
+        for (const auto& slot : tx_cache_data) {
+            for (const auto& iod : slot.primary)
+                pkeys.push_back(iod.pkey);
+            for (const auto& iod : slot.additional)
+                pkeys.push_back(iod.pkey);
+        }
+        std::vector<crypto::key_derivation> derivations;
+        std::vector<bool> ok;
+        {
+            std::unique_lock hwdev_lock{hwdev};
+            hwdev.generate_key_derivations(pkeys, keys.m_view_secret_key, derivations, ok);
+        }
+        size_t k = 0;
+        auto apply = [&](wallet2::is_out_data& iod) {
+            iod.derivation = derivations[k];
+            if (!ok[k])
+                derivation_failed(iod);
+            k++;
+        };
+        for (auto& slot : tx_cache_data) {
+            for (auto& iod : slot.primary)
+                apply(iod);
+            for (auto& iod : slot.additional)
+                apply(iod);
+        }
+    } else {
+        for (size_t i = 0; i < tx_cache_data.size(); ++i) {
+            if (tx_cache_data[i].empty())
+                continue;
+            tpool.submit(
+                    &waiter,
+                    [&hwdev, &gender, &tx_cache_data, i]() {
+                        auto& slot = tx_cache_data[i];
+                        std::unique_lock hwdev_lock{hwdev};
+                        for (auto& iod : slot.primary)
+                            gender(iod);
+                        for (auto& iod : slot.additional)
+                            gender(iod);
+                    },
+                    true);
+        }
+        waiter.wait(&tpool);
     }
-    waiter.wait(&tpool);
 
     auto geniod = [&](const cryptonote::transaction& tx, size_t n_vouts, size_t txidx) {
+        // Scan all of the tx's outputs against each derivation at once, so that the subaddress
+        // spend keys get derived as a batch rather than one output at a time.
+        std::vector<crypto::public_key> keys;
+        std::vector<size_t> indices;
         for (size_t k = 0; k < n_vouts; ++k) {
-            const auto& o = tx.vout[k];
-            if (std::holds_alternative<cryptonote::txout_to_key>(o.target)) {
-                std::vector<crypto::key_derivation> additional_derivations;
-                additional_derivations.reserve(tx_cache_data[txidx].additional.size());
-                for (const auto& iod : tx_cache_data[txidx].additional)
-                    additional_derivations.push_back(iod.derivation);
-                const auto& key = var::get<txout_to_key>(o.target).key;
-                for (size_t l = 0; l < tx_cache_data[txidx].primary.size(); ++l) {
-                    THROW_WALLET_EXCEPTION_IF(
-                            tx_cache_data[txidx].primary[l].received.size() != n_vouts,
-                            error::wallet_internal_error,
-                            "Unexpected received array size");
-                    tx_cache_data[txidx].primary[l].received[k] = is_out_to_acc_precomp(
-                            m_subaddresses,
-                            key,
-                            tx_cache_data[txidx].primary[l].derivation,
-                            additional_derivations,
-                            k,
-                            hwdev);
-                    additional_derivations.clear();
-                }
+            if (auto* out = std::get_if<cryptonote::txout_to_key>(&tx.vout[k].target)) {
+                keys.push_back(out->key);
+                indices.push_back(k);
             }
         }
+        if (keys.empty())
+            return;
+        std::vector<crypto::key_derivation> additional_derivations;
+        additional_derivations.reserve(tx_cache_data[txidx].additional.size());
+        for (const auto& iod : tx_cache_data[txidx].additional)
+            additional_derivations.push_back(iod.derivation);
+        for (auto& iod : tx_cache_data[txidx].primary) {
+            THROW_WALLET_EXCEPTION_IF(
+                    iod.received.size() != n_vouts,
+                    error::wallet_internal_error,
+                    "Unexpected received array size");
+            auto received = outs_to_acc_precomp(
+                    m_subaddresses, keys, indices, iod.derivation, additional_derivations, hwdev);
+            for (size_t j = 0; j < indices.size(); ++j)
+                iod.received[indices[j]] = std::move(received[j]);
+            additional_derivations.clear();
+        }
     };
 
     txidx = 0;
@@ -3567,6 +3674,108 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t& bloc
     refresh(trusted_daemon, start_height, blocks_fetched, received_money);
 }
 //----------------------------------------------------------------------------------------------------
+struct wallet2::refresh_pipeline {
+    // A GET_BLOCKS_BIN request made by height, on the assumption that the batches before it come
+    // back with exactly as many blocks as requested.
+    struct prefetch {
+        uint64_t start_height;
+        uint64_t count;  // How many blocks we asked for
+        std::vector<cryptonote::block_complete_entry> blocks;
+        std::vector<parsed_block> parsed_blocks;
+        uint64_t current_height = 0;
+        bool error = false;
+        tools::threadpool::waiter waiter;
+    };
+
+    std::deque<std::unique_ptr<prefetch>> prefetches;
+    // Prefetches that turned out to be useless, which we don't wait for until the refresh is done
+    std::vector<std::unique_ptr<prefetch>> discarded;
+    size_t next_client = 0;
+
+    // Read by the fetching task while the refresh thread updates it from scan times
+    std::atomic<uint64_t> batch_size{cryptonote::rpc::GET_BLOCKS_BIN::MAX_COUNT};
+    // Cleared if the daemon returns more blocks than we asked for (i.e. it predates max_count),
+    // since then there's no telling where its batches start.
+    bool speculate = true;
+
+    void discard() {
+        for (auto& p : prefetches)
+            discarded.push_back(std::move(p));
+        prefetches.clear();
+    }
+
+    // Adjusts the batch size given that scanning `blocks` blocks took `elapsed`
+    void processed(size_t blocks, std::chrono::steady_clock::duration elapsed) {
+        // A short batch near the top of the chain doesn't say much about the scan rate
+        if (blocks < REFRESH_MIN_BATCH)
+            return;
+        double rate = blocks / std::max(std::chrono::duration<double>(elapsed).count(), 0.001);
+        auto target = static_cast<uint64_t>(
+                rate * std::chrono::duration<double>(REFRESH_BATCH_TARGET).count());
+        // Move halfway towards the target so that one odd batch doesn't swing it too far
+        auto size = (batch_size.load(std::memory_order_relaxed) + target) / 2;
+        batch_size.store(
+                std::clamp<uint64_t>(
+                        size, REFRESH_MIN_BATCH, cryptonote::rpc::GET_BLOCKS_BIN::MAX_COUNT),
+                std::memory_order_relaxed);
+    }
+
+    ~refresh_pipeline() {
+        auto& tpool = tools::threadpool::getInstance();
+        for (auto& p : prefetches)
+            p->waiter.wait(&tpool);
+        for (auto& p : discarded)
+            p->waiter.wait(&tpool);
+    }
+};
+//----------------------------------------------------------------------------------------------------
+void wallet2::parse_blocks(
+        const std::vector<cryptonote::block_complete_entry>& blocks,
+        std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices>& o_indices,
+        std::vector<parsed_block>& parsed_blocks,
+        bool& error) const {
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    parsed_blocks.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+        tpool.submit(
+                &waiter,
+                [&, i] {
+                    return parse_block_round(
+                            blocks[i].block,
+                            parsed_blocks[i].block,
+                            parsed_blocks[i].hash,
+                            parsed_blocks[i].error);
+                },
+                true);
+    waiter.wait(&tpool);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (parsed_blocks[i].error) {
+            error = true;
+            break;
+        }
+        parsed_blocks[i].o_indices = std::move(o_indices[i]);
+    }
+
+    std::mutex error_lock;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        parsed_blocks[i].txes.resize(blocks[i].txs.size());
+        for (size_t j = 0; j < blocks[i].txs.size(); ++j) {
+            tpool.submit(
+                    &waiter,
+                    [&, i, j]() {
+                        if (!parse_and_validate_tx_base_from_blob(
+                                    blocks[i].txs[j], parsed_blocks[i].txes[j])) {
+                            std::lock_guard lock{error_lock};
+                            error = true;
+                        }
+                    },
+                    true);
+        }
+    }
+    waiter.wait(&tpool);
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::pull_and_parse_next_blocks(
         uint64_t start_height,
         uint64_t& blocks_start_height,
@@ -3577,7 +3786,8 @@ void wallet2::pull_and_parse_next_blocks(
         std::vector<parsed_block>& parsed_blocks,
         bool& last,
         bool& error,
-        std::exception_ptr& exception) {
+        std::exception_ptr& exception,
+        refresh_pipeline* pipeline) {
     error = false;
     last = false;
     exception = nullptr;
@@ -3599,66 +3809,137 @@ void wallet2::pull_and_parse_next_blocks(
             short_chain_history.push_front(s->hash);
         }
 
-        // pull the new blocks
-        std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices> o_indices;
         uint64_t current_height;
-        pull_blocks(
-                start_height,
-                blocks_start_height,
-                short_chain_history,
-                blocks,
-                o_indices,
-                current_height);
-        THROW_WALLET_EXCEPTION_IF(
-                blocks.size() != o_indices.size(),
-                error::wallet_internal_error,
-                "Mismatched sizes of blocks and o_indices");
+        uint64_t requested = 0;
+        if (pipeline)
+            requested = pipeline->prefetches.empty()
+                              ? pipeline->batch_size.load(std::memory_order_relaxed)
+                              : pipeline->prefetches.front()->count;
+        if (!pipeline || !take_prefetched_blocks(
+                                 *pipeline,
+                                 prev_parsed_blocks,
+                                 blocks_start_height,
+                                 blocks,
+                                 parsed_blocks,
+                                 current_height)) {
+            // pull the new blocks
+            std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices> o_indices;
+            pull_blocks(
+                    start_height,
+                    blocks_start_height,
+                    short_chain_history,
+                    blocks,
+                    o_indices,
+                    current_height,
+                    requested);
+            THROW_WALLET_EXCEPTION_IF(
+                    blocks.size() != o_indices.size(),
+                    error::wallet_internal_error,
+                    "Mismatched sizes of blocks and o_indices");
 
-        tools::threadpool& tpool = tools::threadpool::getInstance();
-        tools::threadpool::waiter waiter;
-        parsed_blocks.resize(blocks.size());
-        for (size_t i = 0; i < blocks.size(); ++i)
-            tpool.submit(
-                    &waiter,
-                    [&, i] {
-                        return parse_block_round(
-                                blocks[i].block,
-                                parsed_blocks[i].block,
-                                parsed_blocks[i].hash,
-                                parsed_blocks[i].error);
-                    },
-                    true);
-        waiter.wait(&tpool);
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            if (parsed_blocks[i].error) {
-                error = true;
-                break;
-            }
-            parsed_blocks[i].o_indices = std::move(o_indices[i]);
+            parse_blocks(blocks, o_indices, parsed_blocks, error);
         }
+        last = !blocks.empty() && parsed_blocks.back().block.get_height() + 1 == current_height;
 
-        std::mutex error_lock;
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            parsed_blocks[i].txes.resize(blocks[i].txs.size());
-            for (size_t j = 0; j < blocks[i].txs.size(); ++j) {
-                tpool.submit(
-                        &waiter,
-                        [&, i, j]() {
-                            if (!parse_and_validate_tx_base_from_blob(
-                                        blocks[i].txs[j], parsed_blocks[i].txes[j])) {
-                                std::lock_guard lock{error_lock};
-                                error = true;
-                            }
-                        },
-                        true);
+        if (pipeline && !error && !blocks.empty()) {
+            if (requested && blocks.size() > requested) {
+                log::debug(logcat, "Daemon ignores max_count, not prefetching blocks");
+                pipeline->speculate = false;
+                pipeline->discard();
+            } else if (blocks.size() < requested && !last) {
+                // The daemon cut the batch short (it also limits the response size), so whatever
+                // we prefetched after it starts in the wrong place; ask for smaller batches, which
+                // it is evidently going to send anyway.
+                pipeline->discard();
+                pipeline->batch_size.store(
+                        std::max<uint64_t>(blocks.size(), REFRESH_MIN_BATCH),
+                        std::memory_order_relaxed);
             }
+            if (!last && m_run.load(std::memory_order_relaxed))
+                prefetch_blocks(*pipeline, blocks_start_height + blocks.size() - 1, current_height);
         }
-        waiter.wait(&tpool);
-        last = !blocks.empty() && parsed_blocks.back().block.get_height() + 1 == current_height;
     } catch (...) {
         error = true;
     }
 }
+//----------------------------------------------------------------------------------------------------
+bool wallet2::take_prefetched_blocks(
+        refresh_pipeline& pipeline,
+        const std::vector<parsed_block>& prev_parsed_blocks,
+        uint64_t& blocks_start_height,
+        std::vector<cryptonote::block_complete_entry>& blocks,
+        std::vector<parsed_block>& parsed_blocks,
+        uint64_t& current_height) {
+    if (pipeline.prefetches.empty())
+        return false;
+    auto& p = *pipeline.prefetches.front();
+    p.waiter.wait(&tools::threadpool::getInstance());
+
+    // A request by chain history starts with the last block we already have, so a prefetched batch
+    // has to as well: if it doesn't, either a batch before it came back shorter than we assumed or
+    // the chain reorganized under us, and in both cases everything after it is useless too.
+    // Checking the hash also stands in for the reorg detection that the chain history gives us.
+    if (p.error || p.blocks.empty() || prev_parsed_blocks.empty() ||
+        p.start_height != prev_parsed_blocks.back().block.get_height() ||
+        p.parsed_blocks.front().hash != prev_parsed_blocks.back().hash) {
+        log::debug(logcat, "Discarding blocks prefetched from height {}", p.start_height);
+        pipeline.discard();
+        return false;
+    }
+
+    blocks_start_height = p.start_height;
+    blocks = std::move(p.blocks);
+    parsed_blocks = std::move(p.parsed_blocks);
+    current_height = p.current_height;
+    pipeline.prefetches.pop_front();
+    return true;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::prefetch_blocks(
+        refresh_pipeline& pipeline, uint64_t next_start, uint64_t node_height) {
+    if (!pipeline.speculate)
+        return;
+    if (!pipeline.prefetches.empty()) {
+        auto& newest = *pipeline.prefetches.back();
+        next_start = newest.start_height + newest.count - 1;
+    }
+
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    // next_start is the last block of the previous batch, which the next one repeats; a request at
+    // height 0 would be taken as a request by (empty) chain history.
+    while (pipeline.prefetches.size() < REFRESH_PREFETCH_DEPTH && next_start > 0 &&
+           next_start + 1 < node_height) {
+        auto& p = *pipeline.prefetches.emplace_back(std::make_unique<refresh_pipeline::prefetch>());
+        p.start_height = next_start;
+        p.count = pipeline.batch_size.load(std::memory_order_relaxed);
+        auto& client = m_refresh_clients[pipeline.next_client++ % m_refresh_clients.size()];
+        tpool.submit(
+                &p.waiter,
+                [this, &p, &client] {
+                    try {
+                        std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices>
+                                o_indices;
+                        uint64_t start;
+                        pull_blocks(
+                                p.start_height,
+                                start,
+                                {},
+                                p.blocks,
+                                o_indices,
+                                p.current_height,
+                                p.count,
+                                &client);
+                        p.error = start != p.start_height || p.blocks.size() != o_indices.size();
+                        if (!p.error)
+                            parse_blocks(p.blocks, o_indices, p.parsed_blocks, p.error);
+                    } catch (...) {
+                        p.error = true;
+                    }
+                },
+                "refresh_prefetch");
+        next_start += p.count - 1;
+    }
+}
 
 void wallet2::remove_obsolete_pool_txs(const std::vector<crypto::hash>& tx_hashes) {
     // remove pool txes to us that aren't in the pool anymore
@@ -3754,37 +4035,41 @@ std::vector<wallet2::get_pool_state_tx> wallet2::get_pool_state(bool refreshed)
     log::trace(logcat, "get_pool_state: take hashes from cache");
     std::vector<crypto::hash> blink_hashes, pool_hashes;
     {
-        // We make two requests here: one for all pool txes, and then (assuming there are any) a
-        // second one for blink txes.
-        cryptonote::rpc::GET_TRANSACTION_POOL_HASHES_BIN::request req{};
-        cryptonote::rpc::GET_TRANSACTION_POOL_HASHES_BIN::response res{};
-        bool r = invoke_http<rpc::GET_TRANSACTION_POOL_HASHES_BIN>(req, res);
-        THROW_WALLET_EXCEPTION_IF(
-                !r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
-        THROW_WALLET_EXCEPTION_IF(
-                res.status == rpc::STATUS_BUSY,
-                error::daemon_busy,
-                "get_transaction_pool_hashes.bin");
-        THROW_WALLET_EXCEPTION_IF(res.status != rpc::STATUS_OK, error::get_tx_pool_error);
+        // Updates the cached hashes with the changes since the last request (or replaces them, if
+        // the daemon doesn't support or can't give us just the changes) and returns them.
+        auto update_pool_hashes = [this](pool_hashes_cache& cache, bool blinked_only) {
+            cryptonote::rpc::GET_TRANSACTION_POOL_HASHES_BIN::request req{};
+            req.blinked_txs_only = blinked_only;
+            req.pool_seqno = cache.seqno;
+            cryptonote::rpc::GET_TRANSACTION_POOL_HASHES_BIN::response res{};
+            bool r = invoke_http<rpc::GET_TRANSACTION_POOL_HASHES_BIN>(req, res);
+            THROW_WALLET_EXCEPTION_IF(
+                    !r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
+            THROW_WALLET_EXCEPTION_IF(
+                    res.status == rpc::STATUS_BUSY,
+                    error::daemon_busy,
+                    "get_transaction_pool_hashes.bin");
+            THROW_WALLET_EXCEPTION_IF(res.status != rpc::STATUS_OK, error::get_tx_pool_error);
+
+            if (!res.incremental)
+                cache.hashes.clear();
+            for (const auto& h : res.removed_tx_hashes)
+                cache.hashes.erase(h);
+            cache.hashes.insert(res.tx_hashes.begin(), res.tx_hashes.end());
+            cache.seqno = res.pool_seqno;
+            return std::vector<crypto::hash>{cache.hashes.begin(), cache.hashes.end()};
+        };
+
+        // We make two requests here: one for all pool txes, and then a second one for blink txes.
+        pool_hashes = update_pool_hashes(m_pool_hashes, false);
         log::trace(logcat, "get_pool_state got full pool");
-        pool_hashes = std::move(res.tx_hashes);
 
         // NOTE: Only request blinked transactions, normal transactions will appear
         // in the wallet when it arrives in a block. This is to prevent pulling down
         // TX's that are awaiting blink approval being cached in the wallet as
         // non-blink and external applications failing to respect this.
-        req.blinked_txs_only = true;
-        res = {};
-        r = invoke_http<rpc::GET_TRANSACTION_POOL_HASHES_BIN>(req, res);
-        THROW_WALLET_EXCEPTION_IF(
-                !r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
-        THROW_WALLET_EXCEPTION_IF(
-                res.status == rpc::STATUS_BUSY,
-                error::daemon_busy,
-                "get_transaction_pool_hashes.bin");
-        THROW_WALLET_EXCEPTION_IF(res.status != rpc::STATUS_OK, error::get_tx_pool_error);
+        blink_hashes = update_pool_hashes(m_pool_blink_hashes, true);
         log::trace(logcat, "get_pool_state got blinks");
-        blink_hashes = std::move(res.tx_hashes);
     }
 
     OXEN_DEFER {
@@ -3816,6 +4101,7 @@ std::vector<wallet2::get_pool_state_tx> wallet2::get_pool_state(bool refreshed)
                     refreshed) {
                 log::info(logcat, "Pending txid {} not in pool, marking as failed", txid);
                 pit->second.m_state = wallet2::unconfirmed_transfer_details::failed;
+                invalidate_balance_cache();
 
                 // the inputs aren't spent anymore, since the tx failed
                 for (size_t vini = 0; vini < pit->second.m_tx.vin.size(); ++vini) {
@@ -4120,6 +4406,8 @@ void wallet2::refresh(
     size_t try_count = 0;
     crypto::hash last_tx_hash_id = m_transfers.size() ? m_transfers.back().m_txid : null<hash>;
     std::list<crypto::hash> short_chain_history;
+    // Declared before the waiter so that it outlives the fetching task that uses it
+    refresh_pipeline pipeline;
     tools::threadpool& tpool = tools::threadpool::getInstance();
     tools::threadpool::waiter waiter;
     uint64_t blocks_start_height;
@@ -4127,6 +4415,8 @@ void wallet2::refresh(
     std::vector<parsed_block> parsed_blocks;
     std::shared_ptr<std::map<std::pair<uint64_t, uint64_t>, size_t>> output_tracker_cache;
     hw::device& hwdev = m_account.get_device();
+    for (auto& client : m_refresh_clients)
+        client.copy_params_from(m_http_client);
 
     // pull the first set of blocks
     get_short_chain_history(
@@ -4198,17 +4488,21 @@ void wallet2::refresh(
                             next_parsed_blocks,
                             last,
                             error,
-                            exception);
+                            exception,
+                            &pipeline);
                 });
 
             if (!first) {
                 try {
+                    auto process_start = std::chrono::steady_clock::now();
                     process_parsed_blocks(
                             blocks_start_height,
                             blocks,
                             parsed_blocks,
                             added_blocks,
                             output_tracker_cache.get());
+                    pipeline.processed(
+                            blocks.size(), std::chrono::steady_clock::now() - process_start);
                 } catch (const tools::error::out_of_hashchain_bounds_error&) {
                     log::info(
                             logcat,
@@ -4344,10 +4638,17 @@ bool wallet2::get_rct_distribution(uint64_t& start_height, std::vector<uint64_t>
     }
     log::debug(logcat, "Daemon is recent enough, requesting rct distribution");
 
+    // We keep the distribution from the last call and only request the blocks since then (plus a
+    // few before that in case they got reorged).
+    uint64_t from_height = 0;
+    if (m_rct_distribution.size() > RCT_DISTRIBUTION_REFETCH_BLOCKS)
+        from_height = m_rct_distribution_start_height + m_rct_distribution.size() -
+                      RCT_DISTRIBUTION_REFETCH_BLOCKS;
+
     cryptonote::rpc::GET_OUTPUT_DISTRIBUTION_BIN::request req{};
     cryptonote::rpc::GET_OUTPUT_DISTRIBUTION_BIN::response res{};
     req.amounts.push_back(0);
-    req.from_height = 0;
+    req.from_height = from_height;
     req.cumulative = false;
     req.binary = true;
     req.compress = true;
@@ -4373,10 +4674,28 @@ bool wallet2::get_rct_distribution(uint64_t& start_height, std::vector<uint64_t>
         log::warning(logcat, "Failed to request output distribution: results are not for amount 0");
         return false;
     }
-    for (size_t i = 1; i < res.distributions[0].data.distribution.size(); ++i)
-        res.distributions[0].data.distribution[i] += res.distributions[0].data.distribution[i - 1];
-    start_height = res.distributions[0].data.start_height;
-    distribution = std::move(res.distributions[0].data.distribution);
+    auto& data = res.distributions[0].data;
+    if (from_height > 0) {
+        // `base` is the number of outputs before from_height, which has to match what we have
+        // kept; if it doesn't then a reorg went deeper than we refetch and we start over.
+        if (data.start_height != from_height ||
+            data.base != m_rct_distribution[from_height - m_rct_distribution_start_height - 1]) {
+            log::info(logcat, "Cached rct distribution is out of date, requesting all of it");
+            m_rct_distribution.clear();
+            return get_rct_distribution(start_height, distribution);
+        }
+        m_rct_distribution.resize(from_height - m_rct_distribution_start_height);
+    } else {
+        m_rct_distribution.clear();
+        m_rct_distribution_start_height = data.start_height;
+    }
+    m_rct_distribution.reserve(m_rct_distribution.size() + data.distribution.size());
+    uint64_t total = from_height > 0 ? data.base : 0;
+    for (auto n : data.distribution)
+        m_rct_distribution.push_back(total += n);
+
+    start_height = m_rct_distribution_start_height;
+    distribution = m_rct_distribution;
     return true;
 }
 //----------------------------------------------------------------------------------------------------
@@ -4468,6 +4787,8 @@ void wallet2::detach_blockchain(
         else
             ++it;
     }
+    invalidate_history_index();
+    invalidate_balance_cache();
 
     log::warning(
             logcat,
@@ -4495,6 +4816,8 @@ bool wallet2::clear() {
     m_tx_keys.clear();
     m_additional_tx_keys.clear();
     m_confirmed_txs.clear();
+    invalidate_history_index();
+    invalidate_balance_cache();
     m_unconfirmed_payments.clear();
     m_scanned_pool_txs[0].clear();
     m_scanned_pool_txs[1].clear();
@@ -4515,6 +4838,8 @@ void wallet2::clear_soft(bool keep_key_images) {
     m_unconfirmed_txs.clear();
     m_payments.clear();
     m_confirmed_txs.clear();
+    invalidate_history_index();
+    invalidate_balance_cache();
     m_unconfirmed_payments.clear();
     m_scanned_pool_txs[0].clear();
     m_scanned_pool_txs[1].clear();
@@ -6671,6 +6996,14 @@ void wallet2::trim_hashchain() {
         if (td.m_block_height < height)
             height = td.m_block_height;
 
+    // Blocks below the immutable (service node checkpointed) height can't be reorged either, and
+    // are usually far more recent than the newest hardcoded checkpoint, so there is no need to
+    // keep every hash back to the checkpoint (32 bytes per block, i.e. tens of MB for an old
+    // wallet).  We keep a day's worth of extra blocks in case the daemon is wrong about it.
+    if (const uint64_t margin = get_config(m_nettype).BLOCKS_IN(24h);
+        m_immutable_height > margin && m_blockchain.size() > m_immutable_height)
+        height = std::max<uint64_t>(height, m_immutable_height - margin);
+
     if (!m_blockchain.empty() && m_blockchain.size() == m_blockchain.offset()) {
         log::info(logcat, "Fixing empty hashchain");
         nlohmann::json req_params{{"height", m_blockchain.size() - 1}};
@@ -6823,17 +7156,16 @@ std::optional<wallet2::cache_file_data> wallet2::get_cache_file_data(
         ar << *this;
 
         std::optional<wallet2::cache_file_data> cache_file_data = (wallet2::cache_file_data){};
-        cache_file_data->cache_data = oss.str();
-        std::string cipher;
-        cipher.resize(cache_file_data->cache_data.size());
+        // Take over the stream's buffer and encrypt it in place (chacha20 supports that), rather
+        // than making two more copies of what can be a very large cache.
+        cache_file_data->cache_data = std::move(oss).str();
         cache_file_data->iv = crypto::rand<crypto::chacha_iv>();
         crypto::chacha20(
                 cache_file_data->cache_data.data(),
                 cache_file_data->cache_data.size(),
                 m_cache_key,
                 cache_file_data->iv,
-                &cipher[0]);
-        cache_file_data->cache_data = cipher;
+                cache_file_data->cache_data.data());
         return cache_file_data;
     } catch (...) {
         return std::nullopt;
@@ -6875,71 +7207,228 @@ uint64_t wallet2::unlocked_balance(
     return amount;
 }
 //----------------------------------------------------------------------------------------------------
-std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(
-        uint32_t index_major, bool strict) const {
-    std::map<uint32_t, uint64_t> amount_per_subaddr;
-    for (const auto& td : m_transfers) {
-        if (td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen) {
-            auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-            if (found == amount_per_subaddr.end())
-                amount_per_subaddr[td.m_subaddr_index.minor] = td.amount();
-            else
-                found->second += td.amount();
+// Which balances (non-strict, strict) a transfer counts towards
+static std::array<bool, 2> balance_modes(const wallet2::transfer_details& td) {
+    if (td.m_frozen)
+        return {false, false};
+    return {!td.m_spent, !(td.m_spent && td.m_spent_height > 0)};
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::invalidate_balance_cache() {
+    m_balance_cache.valid = false;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_balance_cache() const {
+    auto& cache = m_balance_cache;
+    cache = {};
+    cache.valid = true;
+    cache.height = get_blockchain_current_height();
+    cache.height_unlocked.resize(m_transfers.size());
+    for (size_t i = 0; i < m_transfers.size(); i++) {
+        const transfer_details& td = m_transfers[i];
+        auto modes = balance_modes(td);
+        if (!modes[0] && !modes[1])
+            continue;
+
+        // The height at which both is_tx_spendtime_unlocked() and the spendable age check in
+        // is_transfer_unlocked() pass, unless this unlocks at a time rather than a height.
+        const uint64_t unlock_time = td.m_tx.get_unlock_time(td.m_internal_output_index);
+        const bool unsettled =
+                unlock_time >= MAX_BLOCK_NUMBER || (td.m_block_height == 0 && td.m_unmined_blink);
+        uint64_t unlock_height = td.m_block_height + DEFAULT_TX_SPENDABLE_AGE;
+        if (unlock_time + 1 > LOCKED_TX_ALLOWED_DELTA_BLOCKS)
+            unlock_height =
+                    std::max(unlock_height, unlock_time + 1 - LOCKED_TX_ALLOWED_DELTA_BLOCKS);
+        const bool unlocked = !unsettled && unlock_height <= cache.height;
+
+        auto& totals = cache.accounts[td.m_subaddr_index.major][td.m_subaddr_index.minor];
+        for (int strict : {0, 1}) {
+            if (!modes[strict])
+                continue;
+            totals.outputs[strict]++;
+            totals.balance[strict] += td.amount();
+            if (unlocked)
+                totals.unlocked[strict] += td.amount();
+            else if (!unsettled)
+                totals.max_unlock_height[strict] =
+                        std::max(totals.max_unlock_height[strict], unlock_height);
         }
+        if (unsettled)
+            cache.unsettled.push_back(i);
+        else if (unlocked)
+            cache.height_unlocked[i] = true;
+        else
+            cache.locked.emplace(unlock_height, i);
     }
-    if (!strict) {
-        for (const auto& utx : m_unconfirmed_txs) {
-            if (utx.second.m_subaddr_account == index_major &&
-                utx.second.m_state != wallet2::unconfirmed_transfer_details::failed) {
-                // all changes go to 0-th subaddress (in the current subaddress account)
-                auto found = amount_per_subaddr.find(0);
-                if (found == amount_per_subaddr.end())
-                    amount_per_subaddr[0] = utx.second.m_change;
-                else
-                    found->second += utx.second.m_change;
-            }
+
+    for (const auto& [txid, utx] : m_unconfirmed_txs) {
+        if (utx.m_state == wallet2::unconfirmed_transfer_details::failed)
+            continue;
+        // all changes go to 0-th subaddress (in the current subaddress account)
+        auto& totals = cache.accounts[utx.m_subaddr_account][0];
+        totals.has_change = true;
+        totals.change += utx.m_change;
+    }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::update_network_locks() const {
+    auto& cache = m_balance_cache;
+    for (auto& [major, subaddrs] : cache.accounts)
+        for (auto& [minor, totals] : subaddrs)
+            totals.network_locked = {};
+
+    uint64_t node_height;
+    if (m_offline || !m_node_rpc_proxy.get_height(node_height)) {
+        cache.node_height.reset();
+        return;
+    }
+    cache.node_height = node_height;
+
+    std::unordered_set<size_t> locked;
+    auto lock = [&](std::string_view key_image_hex) {
+        crypto::key_image key_image;
+        if (!tools::try_load_from_hex_guts(key_image_hex, key_image)) {
+            log::error(
+                    logcat, "Failed to parse hex representation of key image: {}", key_image_hex);
+            return false;
+        }
+        auto it = m_key_images.find(key_image);
+        if (it == m_key_images.end() || it->second >= cache.height_unlocked.size() ||
+            !cache.height_unlocked[it->second] || !locked.insert(it->second).second)
+            return true;
+        const transfer_details& td = m_transfers[it->second];
+        auto modes = balance_modes(td);
+        auto& totals = cache.accounts[td.m_subaddr_index.major][td.m_subaddr_index.minor];
+        for (int strict : {0, 1})
+            if (modes[strict])
+                totals.network_locked[strict] += td.amount();
+        return true;
+    };
+
+    if (auto [success, blacklist] = m_node_rpc_proxy.get_service_node_blacklisted_key_images();
+        success) {
+        for (auto const& entry : blacklist)
+            if (!lock(entry["key_image"].get<std::string_view>()))
+                break;
+    } else
+        log::info(
+                logcat,
+                "Failed to query service node for blacklisted transfers, assuming transfers not "
+                "blacklisted");
+
+    const std::string primary_address = get_address_as_str();
+    auto [success, service_nodes_states] =
+            m_node_rpc_proxy.get_contributed_service_nodes(primary_address);
+    if (!success) {
+        log::info(
+                logcat,
+                "Failed to query service node for locked transfers, assuming transfers not "
+                "locked");
+        return;
+    }
+    for (auto const& entry : service_nodes_states)
+        for (auto const& contributor : entry.at("contributors")) {
+            if (primary_address != contributor.at("address").get<std::string_view>())
+                continue;
+            for (auto const& contribution : contributor.at("locked_contributions"))
+                if (!lock(contribution.at("key_image").get<std::string_view>()))
+                    break;
+        }
+}
+//----------------------------------------------------------------------------------------------------
+const wallet2::balance_cache& wallet2::get_balance_cache() const {
+    auto& cache = m_balance_cache;
+    const uint64_t height = get_blockchain_current_height();
+    bool unlocked_more = false;
+    if (!cache.valid || height < cache.height) {
+        rebuild_balance_cache();
+        unlocked_more = true;
+    } else if (height > cache.height) {
+        cache.height = height;
+        while (!cache.locked.empty() && cache.locked.top().first <= height) {
+            size_t i = cache.locked.top().second;
+            cache.locked.pop();
+            const transfer_details& td = m_transfers[i];
+            auto modes = balance_modes(td);
+            auto& totals = cache.accounts[td.m_subaddr_index.major][td.m_subaddr_index.minor];
+            for (int strict : {0, 1})
+                if (modes[strict])
+                    totals.unlocked[strict] += td.amount();
+            cache.height_unlocked[i] = true;
+            unlocked_more = true;
         }
     }
+
+    if (m_offline) {
+        if (cache.node_height)
+            update_network_locks();
+    } else if (uint64_t node_height; unlocked_more || !m_node_rpc_proxy.get_height(node_height) ||
+                                     node_height != cache.node_height)
+        update_network_locks();
+    return cache;
+}
+//----------------------------------------------------------------------------------------------------
+std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(
+        uint32_t index_major, bool strict) const {
+    std::map<uint32_t, uint64_t> amount_per_subaddr;
+    const auto& accounts = get_balance_cache().accounts;
+    auto account = accounts.find(index_major);
+    if (account == accounts.end())
+        return amount_per_subaddr;
+    for (const auto& [minor, totals] : account->second) {
+        if (totals.outputs[strict])
+            amount_per_subaddr[minor] = totals.balance[strict];
+        if (!strict && totals.has_change)
+            amount_per_subaddr[minor] += totals.change;
+    }
     return amount_per_subaddr;
 }
 //----------------------------------------------------------------------------------------------------
 std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>>
 wallet2::unlocked_balance_per_subaddress(uint32_t index_major, bool strict) const {
     std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> amount_per_subaddr;
+    const auto& cache = get_balance_cache();
+    auto account = cache.accounts.find(index_major);
+    if (account == cache.accounts.end())
+        return amount_per_subaddr;
+    for (const auto& [minor, totals] : account->second) {
+        if (!totals.outputs[strict])
+            continue;
+        uint64_t blocks_to_unlock = totals.max_unlock_height[strict] > cache.height
+                                          ? totals.max_unlock_height[strict] - cache.height
+                                          : 0;
+        amount_per_subaddr[minor] = std::make_pair(
+                totals.unlocked[strict] - totals.network_locked[strict],
+                std::make_pair(blocks_to_unlock, uint64_t{0}));
+    }
+
     const uint64_t blockchain_height = get_blockchain_current_height();
     const uint64_t now = time(nullptr);
-    for (const transfer_details& td : m_transfers) {
-        if (td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen) {
-            uint64_t amount = 0, blocks_to_unlock = 0, time_to_unlock = 0;
-            if (is_transfer_unlocked(td)) {
-                amount = td.amount();
-                blocks_to_unlock = 0;
-                time_to_unlock = 0;
-            } else {
-                uint64_t unlock_height = td.m_unmined_blink && td.m_block_height == 0
-                                               ? blockchain_height
-                                               : td.m_block_height;
-                unlock_height += std::max<uint64_t>(
-                        DEFAULT_TX_SPENDABLE_AGE, LOCKED_TX_ALLOWED_DELTA_BLOCKS);
-                if (td.m_tx.unlock_time < MAX_BLOCK_NUMBER && td.m_tx.unlock_time > unlock_height)
-                    unlock_height = td.m_tx.unlock_time;
-                uint64_t unlock_time =
-                        td.m_tx.unlock_time >= MAX_BLOCK_NUMBER ? td.m_tx.unlock_time : 0;
-                blocks_to_unlock =
-                        unlock_height > blockchain_height ? unlock_height - blockchain_height : 0;
-                time_to_unlock = unlock_time > now ? unlock_time - now : 0;
-                amount = 0;
-            }
-            auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-            if (found == amount_per_subaddr.end())
-                amount_per_subaddr[td.m_subaddr_index.minor] =
-                        std::make_pair(amount, std::make_pair(blocks_to_unlock, time_to_unlock));
-            else {
-                found->second.first += amount;
-                found->second.second.first = std::max(found->second.second.first, blocks_to_unlock);
-                found->second.second.second = std::max(found->second.second.second, time_to_unlock);
-            }
+    for (size_t i : cache.unsettled) {
+        const transfer_details& td = m_transfers[i];
+        if (td.m_subaddr_index.major != index_major || !balance_modes(td)[strict])
+            continue;
+        uint64_t amount = 0, blocks_to_unlock = 0, time_to_unlock = 0;
+        if (is_transfer_unlocked(td)) {
+            amount = td.amount();
+        } else {
+            uint64_t unlock_height = td.m_unmined_blink && td.m_block_height == 0
+                                           ? blockchain_height
+                                           : td.m_block_height;
+            unlock_height += std::max<uint64_t>(
+                    DEFAULT_TX_SPENDABLE_AGE, LOCKED_TX_ALLOWED_DELTA_BLOCKS);
+            if (td.m_tx.unlock_time < MAX_BLOCK_NUMBER && td.m_tx.unlock_time > unlock_height)
+                unlock_height = td.m_tx.unlock_time;
+            uint64_t unlock_time =
+                    td.m_tx.unlock_time >= MAX_BLOCK_NUMBER ? td.m_tx.unlock_time : 0;
+            blocks_to_unlock =
+                    unlock_height > blockchain_height ? unlock_height - blockchain_height : 0;
+            time_to_unlock = unlock_time > now ? unlock_time - now : 0;
         }
+        auto& [found_amount, found_unlock] = amount_per_subaddr[td.m_subaddr_index.minor];
+        found_amount += amount;
+        found_unlock.first = std::max(found_unlock.first, blocks_to_unlock);
+        found_unlock.second = std::max(found_unlock.second, time_to_unlock);
     }
     return amount_per_subaddr;
 }
@@ -7120,7 +7609,43 @@ wallet::transfer_view wallet2::make_transfer_view(
     return result;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::get_transfers(
+// Calls `f` with each entry of a history index with a height in [min_height, max_height], in
+// height order, restricting to one account if given, until `f` returns false.
+template <typename Ptr, typename F>
+static void for_each_indexed(
+        const std::multimap<uint64_t, Ptr>& by_height,
+        const std::multimap<std::pair<uint32_t, uint64_t>, Ptr>& by_account,
+        const std::optional<uint32_t>& account,
+        uint64_t min_height,
+        uint64_t max_height,
+        F&& f) {
+    if (min_height > max_height)
+        return;
+    auto each = [&f](const auto& index, const auto& lo, const auto& hi) {
+        for (auto it = index.lower_bound(lo), end = index.upper_bound(hi); it != end; ++it)
+            if (!f(*it->second))
+                return;
+    };
+    if (account)
+        each(by_account,
+             std::make_pair(*account, min_height),
+             std::make_pair(*account, max_height));
+    else
+        each(by_height, min_height, max_height);
+}
+static bool has_subaddr(const tools::wallet2::payment_details& pd, const std::set<uint32_t>& subs) {
+    return subs.empty() || subs.count(pd.m_subaddr_index.minor);
+}
+static bool has_subaddr(
+        const tools::wallet2::confirmed_transfer_details& ctd, const std::set<uint32_t>& subs) {
+    return subs.empty() ||
+           std::any_of(
+                   ctd.m_subaddr_indices.begin(),
+                   ctd.m_subaddr_indices.end(),
+                   [&subs](uint32_t index) { return subs.count(index) > 0; });
+}
+//----------------------------------------------------------------------------------------------------
+std::optional<uint64_t> wallet2::get_transfers(
         get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers) {
     std::optional<uint32_t> account_index = args.account_index;
     if (args.all_accounts) {
@@ -7136,6 +7661,73 @@ void wallet2::get_transfers(
         args.in = args.out = args.stake = args.pending = args.failed = args.pool = args.coinbase =
                 true;
 
+    auto out_type_matches = [&](const confirmed_transfer_details& ctd) {
+        if (args.ons && args_count == 1)
+            return ctd.m_pay_type == wallet::pay_type::ons;
+        if (args.stake && args_count == 1)
+            return ctd.m_pay_type == wallet::pay_type::stake;
+        return true;
+    };
+
+    // With a limit, find the block in which the limit is reached and only fetch confirmed transfers
+    // up to the end of it; the index lets us do that by looking at no more than `limit` of each.
+    std::optional<uint64_t> next_height;
+    if (args.limit > 0 && (args.in || args.out || args.stake)) {
+        const auto& idx = get_history_index();
+        auto in_matches = [&](const payment_details& pd) {
+            return has_subaddr(pd, args.subaddr_indices);
+        };
+        auto out_matches = [&](const confirmed_transfer_details& ctd) {
+            return has_subaddr(ctd, args.subaddr_indices) && out_type_matches(ctd);
+        };
+        // Calls f(height) for the first `count` matching incoming and the first `count` matching
+        // outgoing transfers with heights in [min_height, max_height]
+        auto each_height = [&](uint64_t min_height, uint64_t max_height, uint64_t count, auto&& f) {
+            uint64_t n = 0;
+            auto visit = [&](uint64_t height) {
+                f(height);
+                return ++n < count;
+            };
+            if (args.in)
+                for_each_indexed(
+                        idx.payments,
+                        idx.account_payments,
+                        account_index,
+                        min_height,
+                        max_height,
+                        [&](const auto& p) {
+                            return !in_matches(p.second) || visit(p.second.m_block_height);
+                        });
+            n = 0;
+            if (args.out || args.stake)
+                for_each_indexed(
+                        idx.confirmed,
+                        idx.account_confirmed,
+                        account_index,
+                        min_height,
+                        max_height,
+                        [&](const auto& c) {
+                            return !out_matches(c.second) || visit(c.second.m_block_height);
+                        });
+        };
+
+        std::vector<uint64_t> heights;
+        each_height(args.min_height, args.max_height, args.limit, [&heights](uint64_t h) {
+            heights.push_back(h);
+        });
+        if (heights.size() >= args.limit) {
+            std::nth_element(heights.begin(), heights.begin() + (args.limit - 1), heights.end());
+            uint64_t last = heights[args.limit - 1];
+            bool more = false;
+            if (last < args.max_height)
+                each_height(last + 1, args.max_height, 1, [&more](uint64_t) { more = true; });
+            if (more) {
+                args.max_height = last;
+                next_height = last + 1;
+            }
+        }
+    }
+
     std::list<std::pair<crypto::hash, tools::wallet2::payment_details>> in;
     std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>> out;
     std::list<std::pair<crypto::hash, tools::wallet2::unconfirmed_transfer_details>>
@@ -7179,16 +7771,9 @@ void wallet2::get_transfers(
     transfers.reserve(size);
     for (const auto& i : in)
         transfers.push_back(make_transfer_view(i.second.m_tx_hash, i.first, i.second));
-    for (const auto& o : out) {
-        bool add_entry = true;
-        if (args.stake && args_count == 1)
-            add_entry = o.second.m_pay_type == wallet::pay_type::stake;
-        if (args.ons && args_count == 1)
-            add_entry = o.second.m_pay_type == wallet::pay_type::ons;
-
-        if (add_entry)
+    for (const auto& o : out)
+        if (out_type_matches(o.second))
             transfers.push_back(make_transfer_view(o.first, o.second));
-    }
     for (const auto& pof : pending_or_failed) {
         bool is_failed = pof.second.m_state == tools::wallet2::unconfirmed_transfer_details::failed;
         if (is_failed ? args.failed : args.pending)
@@ -7208,6 +7793,7 @@ void wallet2::get_transfers(
             return a.timestamp < b.timestamp;
         return a.hash < b.hash;
     });
+    return next_height;
 }
 
 std::string wallet2::transfers_to_csv(
@@ -7340,22 +7926,69 @@ void wallet2::get_payments(
             });
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::index_payment(const payment_container::value_type& p) const {
+    auto& idx = m_history_index;
+    if (!idx.valid)
+        return;
+    const auto& pd = p.second;
+    idx.payments.emplace(pd.m_block_height, &p);
+    idx.account_payments.emplace(std::make_pair(pd.m_subaddr_index.major, pd.m_block_height), &p);
+    idx.txid_payments.emplace(pd.m_tx_hash, &p);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::index_confirmed(
+        const std::pair<const crypto::hash, confirmed_transfer_details>& c) const {
+    auto& idx = m_history_index;
+    if (!idx.valid)
+        return;
+    const auto& ctd = c.second;
+    idx.confirmed.emplace(ctd.m_block_height, &c);
+    idx.account_confirmed.emplace(std::make_pair(ctd.m_subaddr_account, ctd.m_block_height), &c);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::invalidate_history_index() {
+    m_history_index = {};
+}
+//----------------------------------------------------------------------------------------------------
+const wallet2::history_index& wallet2::get_history_index() const {
+    if (!m_history_index.valid) {
+        m_history_index.valid = true;
+        for (const auto& p : m_payments)
+            index_payment(p);
+        for (const auto& c : m_confirmed_txs)
+            index_confirmed(c);
+    }
+    return m_history_index;
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::get_payments(
         std::list<std::pair<crypto::hash, wallet2::payment_details>>& payments,
         uint64_t min_height,
         uint64_t max_height,
         const std::optional<uint32_t>& subaddr_account,
         const std::set<uint32_t>& subaddr_indices) const {
-    auto range = std::make_pair(m_payments.begin(), m_payments.end());
-    for (auto it = range.first; it != range.second; it++) {
-        const auto& [hash, details] = *it;
-        if (min_height <= details.m_block_height && max_height >= details.m_block_height &&
-            (!subaddr_account || *subaddr_account == details.m_subaddr_index.major) &&
-            (subaddr_indices.empty() ||
-             subaddr_indices.count(details.m_subaddr_index.minor) == 1)) {
-            payments.emplace_back(hash, details);
-        }
-    }
+    const auto& idx = get_history_index();
+    for_each_indexed(
+            idx.payments,
+            idx.account_payments,
+            subaddr_account,
+            min_height,
+            max_height,
+            [&](const payment_container::value_type& p) {
+                if (has_subaddr(p.second, subaddr_indices))
+                    payments.push_back(p);
+                return true;
+            });
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::get_payments_by_txid(
+        const crypto::hash& txid,
+        std::list<std::pair<crypto::hash, wallet2::payment_details>>& payments,
+        const std::optional<uint32_t>& subaddr_account) const {
+    auto [begin, end] = get_history_index().txid_payments.equal_range(txid);
+    for (auto it = begin; it != end; ++it)
+        if (!subaddr_account || *subaddr_account == it->second->second.m_subaddr_index.major)
+            payments.push_back(*it->second);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::get_payments_out(
@@ -7364,20 +7997,24 @@ void wallet2::get_payments_out(
         uint64_t max_height,
         const std::optional<uint32_t>& subaddr_account,
         const std::set<uint32_t>& subaddr_indices) const {
-    for (const auto& [hash, details] : m_confirmed_txs) {
-        if (details.m_block_height < min_height || details.m_block_height > max_height)
-            continue;
-        if (subaddr_account && *subaddr_account != details.m_subaddr_account)
-            continue;
-        if (!subaddr_indices.empty() && std::none_of(
-                                                details.m_subaddr_indices.begin(),
-                                                details.m_subaddr_indices.end(),
-                                                [&subaddr_indices](uint32_t index) {
-                                                    return subaddr_indices.count(index) > 0;
-                                                }))
-            continue;
-        confirmed_payments.emplace_back(hash, details);
-    }
+    const auto& idx = get_history_index();
+    for_each_indexed(
+            idx.confirmed,
+            idx.account_confirmed,
+            subaddr_account,
+            min_height,
+            max_height,
+            [&](const std::pair<const crypto::hash, confirmed_transfer_details>& c) {
+                if (has_subaddr(c.second, subaddr_indices))
+                    confirmed_payments.push_back(c);
+                return true;
+            });
+}
+//----------------------------------------------------------------------------------------------------
+const wallet2::confirmed_transfer_details* wallet2::get_payment_out(
+        const crypto::hash& txid) const {
+    auto it = m_confirmed_txs.find(txid);
+    return it == m_confirmed_txs.end() ? nullptr : &it->second;
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::get_unconfirmed_payments_out(
@@ -7452,26 +8089,26 @@ void wallet2::get_unconfirmed_payments(
     }
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::rescan_spent() {
+std::vector<rpc::IS_KEY_IMAGE_SPENT::SPENT> wallet2::get_key_images_spent_status(
+        const std::vector<std::string>& key_images) {
     // This is RPC call that can take a long time if there are many outputs,
     // so we call it several times, in stripes, so we don't time out spuriously
-    std::vector<int> spent_status;
-    spent_status.reserve(m_transfers.size());
+    std::vector<rpc::IS_KEY_IMAGE_SPENT::SPENT> spent_status;
+    spent_status.reserve(key_images.size());
     const size_t chunk_size = 1000;
-    for (size_t start_offset = 0; start_offset < m_transfers.size(); start_offset += chunk_size) {
-        const size_t n_outputs = std::min<size_t>(chunk_size, m_transfers.size() - start_offset);
+    for (size_t start_offset = 0; start_offset < key_images.size(); start_offset += chunk_size) {
+        const size_t n_outputs = std::min<size_t>(chunk_size, key_images.size() - start_offset);
         log::debug(
                 logcat,
                 "Calling is_key_image_spent on {} - {}, out of {}",
                 start_offset,
                 (start_offset + n_outputs - 1),
-                m_transfers.size());
-        std::vector<std::string> key_images;
-        key_images.reserve(n_outputs);
+                key_images.size());
+        auto chunk = nlohmann::json::array();
         for (size_t n = start_offset; n < start_offset + n_outputs; ++n)
-            key_images.push_back(tools::hex_guts(m_transfers[n].m_key_image));
+            chunk.push_back(key_images[n]);
 
-        nlohmann::json req_params{{"key_images", key_images}};
+        nlohmann::json req_params{{"key_images", std::move(chunk)}};
         auto kispent_res = m_http_client.json_rpc("is_key_image_spent", req_params);
         THROW_WALLET_EXCEPTION_IF(
                 kispent_res["status"] == rpc::STATUS_BUSY,
@@ -7487,11 +8124,18 @@ void wallet2::rescan_spent() {
                 "daemon returned wrong response for is_key_image_spent, wrong amounts count = " +
                         std::to_string(kispent_res["spent_status"].size()) + ", expected " +
                         std::to_string(n_outputs));
-        std::copy(
-                kispent_res["spent_status"].begin(),
-                kispent_res["spent_status"].end(),
-                std::back_inserter(spent_status));
+        for (const auto& status : kispent_res["spent_status"])
+            spent_status.push_back(status.get<rpc::IS_KEY_IMAGE_SPENT::SPENT>());
     }
+    return spent_status;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rescan_spent() {
+    std::vector<std::string> key_images;
+    key_images.reserve(m_transfers.size());
+    for (const auto& td : m_transfers)
+        key_images.push_back(tools::hex_guts(td.m_key_image));
+    auto spent_status = get_key_images_spent_status(key_images);
 
     // update spent status
     for (size_t i = 0; i < m_transfers.size(); ++i) {
@@ -7499,8 +8143,7 @@ void wallet2::rescan_spent() {
         // a view wallet may not know about key images
         if (!td.m_key_image_known || td.m_key_image_partial)
             continue;
-        if (td.m_spent != (static_cast<rpc::IS_KEY_IMAGE_SPENT::SPENT>(spent_status[i]) !=
-                           rpc::IS_KEY_IMAGE_SPENT::SPENT::UNSPENT)) {
+        if (td.m_spent != (spent_status[i] != rpc::IS_KEY_IMAGE_SPENT::SPENT::UNSPENT)) {
             if (td.m_spent) {
                 log::warning(
                         logcat,
@@ -7803,6 +8446,7 @@ void wallet2::add_unconfirmed_tx(
         uint64_t change_amount,
         uint32_t subaddr_account,
         const std::set<uint32_t>& subaddr_indices) {
+    invalidate_balance_cache();
     unconfirmed_transfer_details& utd = m_unconfirmed_txs[cryptonote::get_transaction_hash(tx)];
     utd.m_amount_in = amount_in;
     utd.m_amount_out = 0;
@@ -8580,6 +9224,32 @@ bool wallet2::load_multisig_tx_from_file(
     return true;
 }
 //----------------------------------------------------------------------------------------------------
+// Runs f(i) for each i in [0, n) on the thread pool.  If any of the calls throw, the exception from
+// the lowest i -- i.e. the one a sequential loop would have hit first -- is rethrown once all the
+// calls have finished.
+template <typename F>
+static void multisig_parallel_for(size_t n, F&& f, size_t min_chunk, const char* tag) {
+    std::vector<std::exception_ptr> errors(n);
+    std::atomic<bool> failed{false};
+    tools::threadpool::getInstance().parallel_for(
+            0,
+            n,
+            [&](size_t i) {
+                try {
+                    f(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                    failed = true;
+                }
+            },
+            min_chunk,
+            tag);
+    if (failed)
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+}
+//----------------------------------------------------------------------------------------------------
 bool wallet2::sign_multisig_tx(multisig_tx_set& exported_txs, std::vector<crypto::hash>& txids) {
     THROW_WALLET_EXCEPTION_IF(
             exported_txs.m_ptx.empty(), error::wallet_internal_error, "No tx found");
@@ -8669,9 +9339,14 @@ bool wallet2::sign_multisig_tx(multisig_tx_set& exported_txs, std::vector<crypto
                     memwipe(&skey, sizeof(skey));
                 };
 
-                k.reserve(sd.selected_transfers.size());
-                for (size_t idx : sd.selected_transfers)
-                    k.push_back(get_multisig_k(idx, sig.used_L));
+                // Finding each input's k means trying every exported k against used_L, which is a
+                // scalarmult per candidate, so spread the inputs across the pool.
+                k.resize(sd.selected_transfers.size());
+                multisig_parallel_for(
+                        k.size(),
+                        [&](size_t i) { k[i] = get_multisig_k(sd.selected_transfers[i], sig.used_L); },
+                        4,
+                        "multisig_sign");
 
                 for (const auto& msk : get_account().get_multisig_keys()) {
                     crypto::public_key pmsk = get_multisig_signing_public_key(msk);
@@ -8907,6 +9582,18 @@ bool wallet2::add_rings(const crypto::chacha_key& key, const cryptonote::transac
     }
 }
 
+bool wallet2::add_rings(
+        const crypto::chacha_key& key,
+        const std::vector<const cryptonote::transaction_prefix*>& txs) {
+    if (!m_ringdb)
+        return false;
+    try {
+        return m_ringdb->add_rings(key, txs);
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
 bool wallet2::add_rings(const cryptonote::transaction_prefix& tx) {
     try {
         return add_rings(get_ringdb_key(), tx);
@@ -8980,6 +9667,19 @@ bool wallet2::set_ring(
     }
 }
 
+bool wallet2::set_rings(
+        const std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>>& rings,
+        bool relative) {
+    if (!m_ringdb)
+        return false;
+
+    try {
+        return m_ringdb->set_rings(get_ringdb_key(), rings, relative);
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
 bool wallet2::unset_ring(const std::vector<crypto::key_image>& key_images) {
     if (!m_ringdb)
         return false;
@@ -9047,21 +9747,24 @@ bool wallet2::find_and_save_rings(bool force) {
         auto res = m_http_client.json_rpc("get_transactions", get_transactions_params);
 
         log::debug(logcat, "Scanning {} transactions", res["txs"].size());
+        std::vector<cryptonote::transaction> txs(res["txs"].size());
+        std::vector<const cryptonote::transaction_prefix*> tx_ptrs;
+        tx_ptrs.reserve(txs.size());
         for (size_t i = 0; i < res["txs"].size(); ++i, ++it) {
             const auto& tx_info = res["txs"][i];
-            cryptonote::transaction tx;
             crypto::hash tx_hash;
             THROW_WALLET_EXCEPTION_IF(
-                    !get_pruned_tx(tx_info, tx, tx_hash),
+                    !get_pruned_tx(tx_info, txs[i], tx_hash),
                     error::wallet_internal_error,
                     "Failed to get transaction from daemon");
             THROW_WALLET_EXCEPTION_IF(
                     !(tx_hash == *it), error::wallet_internal_error, "Wrong txid received");
-            THROW_WALLET_EXCEPTION_IF(
-                    !add_rings(get_ringdb_key(), tx),
-                    error::wallet_internal_error,
-                    "Failed to save ring");
+            tx_ptrs.push_back(&txs[i]);
         }
+        THROW_WALLET_EXCEPTION_IF(
+                !add_rings(get_ringdb_key(), tx_ptrs),
+                error::wallet_internal_error,
+                "Failed to save ring");
     }
 
     log::info(logcat, "Found and saved rings for {} transactions", txs_hashes.size());
@@ -10301,6 +11004,12 @@ void wallet2::get_outs(
     }
 #endif
 
+    // Picking outputs makes a ring lookup per input and a blackball lookup per candidate, so
+    // have them all share one ringdb transaction
+    std::optional<ringdb::read_session> ringdb_session;
+    if (m_ringdb)
+        ringdb_session.emplace(*m_ringdb);
+
     if (fake_outputs_count > 0) {
         uint64_t segregation_fork_height = get_segregation_fork_height();
         // check whether we're shortly after the fork
@@ -11005,20 +11714,22 @@ void wallet2::get_outs(
     }
 
     // save those outs in the ringdb for reuse
+    std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>> rings;
+    rings.reserve(selected_transfers.size());
     for (size_t i = 0; i < selected_transfers.size(); ++i) {
         const size_t idx = selected_transfers[i];
         THROW_WALLET_EXCEPTION_IF(
                 idx >= m_transfers.size(),
                 error::wallet_internal_error,
                 "selected_transfers entry out of range");
-        const transfer_details& td = m_transfers[idx];
-        std::vector<uint64_t> ring;
+        auto& [key_image, ring] = rings.emplace_back();
+        key_image = m_transfers[idx].m_key_image;
         ring.reserve(outs[i].size());
         for (const auto& e : outs[i])
             ring.push_back(std::get<0>(e));
-        if (!set_ring(td.m_key_image, ring, false))
-            log::error(logcat, "Failed to set ring for {}", td.m_key_image);
     }
+    if (!set_rings(rings, false))
+        log::error(logcat, "Failed to set rings for {} inputs", rings.size());
 }
 
 void wallet2::transfer_selected_rct(
@@ -11428,7 +12139,7 @@ void wallet2::transfer_selected_rct(
     ptx.construction_data.rct_config = {
             tx.rct_signatures.p.bulletproofs.empty() ? rct::RangeProofType::Borromean
                                                      : rct::RangeProofType::PaddedBulletproof,
-            use_fork_rules(feature::CLSAG, 0) ? 3 : 2};
+            rct_config.bp_version};
     ptx.construction_data.dests = dsts;
     // record which subaddress indices are being used as inputs
     ptx.construction_data.subaddr_account = subaddr_account;
@@ -11789,6 +12500,7 @@ bool wallet2::light_wallet_import_wallet_request(
 
 void wallet2::light_wallet_get_unspent_outs() {
     log::debug(logcat, "Getting unspent outs");
+    invalidate_balance_cache();
 
     light_rpc::GET_UNSPENT_OUTS::request oreq{};
     light_rpc::GET_UNSPENT_OUTS::response ores{};
@@ -11972,6 +12684,7 @@ bool wallet2::light_wallet_get_address_info(light_rpc::GET_ADDRESS_INFO::respons
 
 void wallet2::light_wallet_get_address_txs() {
     log::debug(logcat, "Refreshing light wallet");
+    invalidate_balance_cache();
 
     light_rpc::GET_ADDRESS_TXS::request ireq{};
     light_rpc::GET_ADDRESS_TXS::response ires{};
@@ -12102,7 +12815,7 @@ void wallet2::light_wallet_get_address_txs() {
                                 t.height, payment.m_tx_hash, payment.m_amount);
                 }
             } else if (!payments_txs.count(tx_hash)) {
-                m_payments.emplace(tx_hash, payment);
+                index_payment(*m_payments.emplace(tx_hash, payment));
                 if (m_callback)
                     m_callback->on_lw_money_received(t.height, payment.m_tx_hash, payment.m_amount);
             }
@@ -12142,7 +12855,7 @@ void wallet2::light_wallet_get_address_txs() {
                         ctd.m_payment_id = payment_id;
                         ctd.m_block_height = t.height;
                         ctd.m_timestamp = t.timestamp;
-                        m_confirmed_txs.emplace(tx_hash, ctd);
+                        index_confirmed(*m_confirmed_txs.emplace(tx_hash, ctd).first);
                     }
                     if (m_callback)
                         m_callback->on_lw_money_spent(t.height, tx_hash, amount_sent);
@@ -12275,6 +12988,39 @@ bool wallet2::light_wallet_key_image_is_ours(
 }
 #endif
 
+// Builds the final version of each planned transaction by calling `finalize(tx)` for each of
+// `txes`.  Every tx already has its inputs, decoys and fee fixed by the planning pass, so the
+// (expensive) signing and range proofs of different txes are independent and, when `parallel` is
+// set, get done concurrently on the thread pool.  If any of them throws the first exception is
+// rethrown once all have finished.
+template <typename TX, typename Finalize>
+static void finalize_transactions(std::vector<TX>& txes, bool parallel, Finalize&& finalize) {
+    if (!parallel || txes.size() < 2) {
+        for (auto& tx : txes)
+            finalize(tx);
+        return;
+    }
+
+    std::mutex exception_mutex;
+    std::exception_ptr exception;
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    for (auto& tx : txes) {
+        tpool.submit(&waiter, [&, ptx = &tx] {
+            try {
+                finalize(*ptx);
+            } catch (...) {
+                std::lock_guard lock{exception_mutex};
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        });
+    }
+    waiter.wait(&tpool);
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
 // Another implementation of transaction creation that is hopefully better
 // While there is anything left to pay, it goes through random outputs and tries
 // to fill the next destination/amount. If it fully fills it, it will use the
@@ -13014,13 +13760,21 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(
             print_money(accumulated_fee),
             print_money(accumulated_change));
 
+    // Hardware devices and multisig signing carry state from one tx to the next, and a tx without
+    // its decoys would have to fetch them from the daemon, so only finalize in parallel when none
+    // of those apply.
+    const bool parallel = !m_multisig && !hwdev.is_hardware_device() &&
+                          std::all_of(txes.begin(), txes.end(), [](const TX& tx) {
+                              return !tx.outs.empty();
+                          });
     hwdev.set_mode(hw::device::mode::TRANSACTION_CREATE_REAL);
-    for (auto& tx : txes) {
+    finalize_transactions(txes, parallel, [&](TX& tx) {
+        auto params = tx_params;
         // Convert burn percent into a fixed burn amount because this is the last place we can back
         // out the base fee that would apply at 100% (the actual fee here is that times the
         // priority-based fee percent)
         if (burning)
-            tx_params.burn_fixed =
+            params.burn_fixed =
                     burn_fixed + (tx.needed_fee - burn_fixed) * burn_percent / fee_percent;
 
         cryptonote::transaction test_tx;
@@ -13036,12 +13790,12 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(
                 test_tx,       /* OUT   cryptonote::transaction& tx, */
                 test_ptx,      /* OUT   cryptonote::transaction& tx, */
                 rct_config,
-                tx_params);
+                params);
         auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
         tx.tx = test_tx;
         tx.ptx = test_ptx;
         tx.weight = get_transaction_weight(test_tx, txBlob.size());
-    }
+    });
 
     std::vector<wallet2::pending_tx> ptx_vector;
     for (auto i = txes.begin(); i != txes.end(); ++i) {
@@ -13561,13 +14315,21 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(
             print_money(accumulated_fee),
             print_money(accumulated_change));
 
+    // Hardware devices and multisig signing carry state from one tx to the next, and a tx without
+    // its decoys would have to fetch them from the daemon, so only finalize in parallel when none
+    // of those apply.
+    const bool parallel = !m_multisig && !hwdev.is_hardware_device() &&
+                          std::all_of(txes.begin(), txes.end(), [](const TX& tx) {
+                              return !tx.outs.empty();
+                          });
     hwdev.set_mode(hw::device::mode::TRANSACTION_CREATE_REAL);
-    for (auto& tx : txes) {
+    finalize_transactions(txes, parallel, [&](TX& tx) {
+        auto params = oxen_tx_params;
         // Convert burn percent into a fixed burn amount because this is the last place we can back
         // out the base fee that would apply at 100% (the actual fee here is that times the
         // priority-based fee percent)
         if (burning)
-            oxen_tx_params.burn_fixed = burn_fixed + tx.needed_fee * burn_percent / fee_percent;
+            params.burn_fixed = burn_fixed + tx.needed_fee * burn_percent / fee_percent;
 
         cryptonote::transaction test_tx;
         pending_tx test_ptx;
@@ -13582,12 +14344,12 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(
                 test_tx,
                 test_ptx,
                 rct_config,
-                oxen_tx_params);
+                params);
         auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
         tx.tx = test_tx;
         tx.ptx = test_ptx;
         tx.weight = get_transaction_weight(test_tx, txBlob.size());
-    }
+    });
 
     std::vector<wallet2::pending_tx> ptx_vector;
     for (auto i = txes.begin(); i != txes.end(); ++i) {
@@ -15577,6 +16339,9 @@ wallet2::export_key_images(bool requested_only) const {
     }
 
     ski.reserve(m_transfers.size() - offset);
+    // Output public and secret keys to sign the key images with, once we've derived them all
+    std::vector<std::pair<crypto::public_key, crypto::secret_key>> signing_keys;
+    signing_keys.reserve(m_transfers.size() - offset);
     for (size_t n = offset; n < m_transfers.size(); ++n) {
         const transfer_details& td = m_transfers[n];
 
@@ -15624,11 +16389,30 @@ wallet2::export_key_images(bool requested_only) const {
                 error::wallet_internal_error,
                 "key_image generated ephemeral public key not matched with output_key");
 
-        // sign the key image with the output secret key
-        auto& ki_s = ski.emplace_back();
-        ki_s.first = td.m_key_image;
-        crypto::generate_key_image_signature(ki_s.first, pkey, in_ephemeral.sec, ki_s.second);
+        ski.emplace_back().first = td.m_key_image;
+        signing_keys.emplace_back(pkey, in_ephemeral.sec);
     }
+
+    // sign the key images with the output secret keys
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    const size_t batch_size = 256;
+    for (size_t start = 0; start < ski.size(); start += batch_size) {
+        const size_t end = std::min(start + batch_size, ski.size());
+        tpool.submit(
+                &waiter,
+                [&, start, end] {
+                    for (size_t n = start; n < end; ++n)
+                        crypto::generate_key_image_signature(
+                                ski[n].first,
+                                signing_keys[n].first,
+                                signing_keys[n].second,
+                                ski[n].second);
+                },
+                "key_image_export",
+                true);
+    }
+    waiter.wait(&tpool);
     return std::make_pair(offset, ski);
 }
 
@@ -15716,6 +16500,7 @@ uint64_t wallet2::import_key_images(
         uint64_t& spent,
         uint64_t& unspent,
         bool check_spent) {
+    invalidate_balance_cache();
     THROW_WALLET_EXCEPTION_IF(
             offset > m_transfers.size(),
             error::wallet_internal_error,
@@ -15733,11 +16518,10 @@ uint64_t wallet2::import_key_images(
 
     std::vector<std::string> key_images{};
     key_images.reserve(signed_key_images.size());
-
+    std::vector<const crypto::public_key*> pkeys;
+    pkeys.reserve(signed_key_images.size());
     for (size_t n = 0; n < signed_key_images.size(); ++n) {
         const transfer_details& td = m_transfers[n + offset];
-        const crypto::key_image& key_image = signed_key_images[n].first;
-        const crypto::signature& signature = signed_key_images[n].second;
 
         // get ephemeral public key
         const cryptonote::tx_out& out = td.m_tx.vout[td.m_internal_output_index];
@@ -15745,69 +16529,81 @@ uint64_t wallet2::import_key_images(
                 !std::holds_alternative<txout_to_key>(out.target),
                 error::wallet_internal_error,
                 "Non txout_to_key output found");
-        const auto& pkey = var::get<cryptonote::txout_to_key>(out.target).key;
+        pkeys.push_back(&var::get<cryptonote::txout_to_key>(out.target).key);
+        key_images.push_back(tools::hex_guts(signed_key_images[n].first));
+    }
 
-        std::string const key_image_str = tools::hex_guts(key_image);
-        if (!td.m_key_image_known || !(key_image == td.m_key_image)) {
-            THROW_WALLET_EXCEPTION_IF(
-                    !(rct::scalarmultKey(rct::ki2rct(key_image), rct::curveOrder()) ==
-                      rct::identity()),
-                    error::wallet_internal_error,
-                    "Key image out of validity domain: input " + std::to_string(n + offset) + "/" +
-                            std::to_string(signed_key_images.size()) + ", key image " +
-                            key_image_str);
-
-            // TODO(oxen): This can fail in a worse-case scenario. We re-sort blinks
-            // when they arrive out of order (i.e. blink is confirmed in mempool and
-            // gets inserted into m_transfers in a different order from the order they
-            // are committed to the blockchain).
-
-            // If a watch only wallet sees a blink and the main wallet doesn't, then
-            // for that block, export_key_images will fail temporarily until the
-            // block is commited and the wallets sorts its transfers into a finalized
-            // canonical ordering.
-            THROW_WALLET_EXCEPTION_IF(
-                    !crypto::check_key_image_signature(key_image, pkey, signature),
-                    error::signature_check_failed,
-                    std::to_string(n + offset) + "/" + std::to_string(signed_key_images.size()) +
-                            ", key image " + key_image_str + ", signature " +
-                            tools::hex_guts(signature) + ", pubkey " + tools::hex_guts(pkey));
+    // Check the key images we didn't already know on the thread pool, in batches, while this
+    // thread asks the daemon which of them are spent.
+    enum class key_image_check : uint8_t { ok, out_of_domain, bad_signature };
+    std::vector<key_image_check> checks(signed_key_images.size(), key_image_check::ok);
+    std::vector<rpc::IS_KEY_IMAGE_SPENT::SPENT> spent_status;
+    {
+        tools::threadpool& tpool = tools::threadpool::getInstance();
+        tools::threadpool::waiter waiter;
+        const size_t batch_size = 256;
+        for (size_t start = 0; start < signed_key_images.size(); start += batch_size) {
+            const size_t end = std::min(start + batch_size, signed_key_images.size());
+            tpool.submit(
+                    &waiter,
+                    [&, start, end] {
+                        for (size_t n = start; n < end; ++n) {
+                            const transfer_details& td = m_transfers[n + offset];
+                            const auto& [key_image, signature] = signed_key_images[n];
+                            if (td.m_key_image_known && key_image == td.m_key_image)
+                                continue;
+                            if (!(rct::scalarmultKey(rct::ki2rct(key_image), rct::curveOrder()) ==
+                                  rct::identity()))
+                                checks[n] = key_image_check::out_of_domain;
+                            else if (!crypto::check_key_image_signature(
+                                             key_image, *pkeys[n], signature))
+                                checks[n] = key_image_check::bad_signature;
+                        }
+                    },
+                    "key_image_import",
+                    true);
         }
-        key_images.push_back(key_image_str);
-    }
 
-    for (size_t n = 0; n < signed_key_images.size(); ++n) {
-        m_transfers[n + offset].m_key_image = signed_key_images[n].first;
-        m_key_images[m_transfers[n + offset].m_key_image] = n + offset;
-        m_transfers[n + offset].m_key_image_known = true;
-        m_transfers[n + offset].m_key_image_request = false;
-        m_transfers[n + offset].m_key_image_partial = false;
+        if (check_spent)
+            spent_status = get_key_images_spent_status(key_images);
+        waiter.wait(&tpool);
     }
 
-    nlohmann::json req_params{{"key_images", key_images}};
-
-    nlohmann::json is_key_image_spent_response;
-    if (check_spent) {
-        is_key_image_spent_response = m_http_client.json_rpc("is_key_image_spent", req_params);
-        THROW_WALLET_EXCEPTION_IF(
-                is_key_image_spent_response["status"] == rpc::STATUS_BUSY,
-                error::daemon_busy,
-                "is_key_image_spent");
-        THROW_WALLET_EXCEPTION_IF(
-                is_key_image_spent_response["status"] != rpc::STATUS_OK,
-                error::is_key_image_spent_error,
-                is_key_image_spent_response["status"]);
+    for (size_t n = 0; n < signed_key_images.size(); ++n) {
+        const crypto::signature& signature = signed_key_images[n].second;
+        const std::string& key_image_str = key_images[n];
         THROW_WALLET_EXCEPTION_IF(
-                is_key_image_spent_response["spent_status"].size() != signed_key_images.size(),
+                checks[n] == key_image_check::out_of_domain,
                 error::wallet_internal_error,
-                "daemon returned wrong response for is_key_image_spent, wrong amounts count = " +
-                        std::to_string(is_key_image_spent_response["spent_status"].size()) +
-                        ", expected " + std::to_string(signed_key_images.size()));
-        for (size_t n = 0; n < is_key_image_spent_response["spent_status"].size(); ++n) {
-            transfer_details& td = m_transfers[n + offset];
-            td.m_spent = is_key_image_spent_response["spent_status"][n] !=
-                         rpc::IS_KEY_IMAGE_SPENT::SPENT::UNSPENT;
-        }
+                "Key image out of validity domain: input " + std::to_string(n + offset) + "/" +
+                        std::to_string(signed_key_images.size()) + ", key image " + key_image_str);
+
+        // TODO(oxen): This can fail in a worse-case scenario. We re-sort blinks
+        // when they arrive out of order (i.e. blink is confirmed in mempool and
+        // gets inserted into m_transfers in a different order from the order they
+        // are committed to the blockchain).
+
+        // If a watch only wallet sees a blink and the main wallet doesn't, then
+        // for that block, export_key_images will fail temporarily until the
+        // block is commited and the wallets sorts its transfers into a finalized
+        // canonical ordering.
+        THROW_WALLET_EXCEPTION_IF(
+                checks[n] == key_image_check::bad_signature,
+                error::signature_check_failed,
+                std::to_string(n + offset) + "/" + std::to_string(signed_key_images.size()) +
+                        ", key image " + key_image_str + ", signature " +
+                        tools::hex_guts(signature) + ", pubkey " + tools::hex_guts(*pkeys[n]));
+    }
+
+    for (size_t n = 0; n < signed_key_images.size(); ++n) {
+        transfer_details& td = m_transfers[n + offset];
+        td.m_key_image = signed_key_images[n].first;
+        m_key_images[td.m_key_image] = n + offset;
+        td.m_key_image_known = true;
+        td.m_key_image_request = false;
+        td.m_key_image_partial = false;
+        if (n < spent_status.size())
+            td.m_spent = spent_status[n] != rpc::IS_KEY_IMAGE_SPENT::SPENT::UNSPENT;
     }
     std::unordered_set<crypto::hash> spent_txids;  // For each spent key image, search for a tx in
                                                    // m_transfers that uses it as input.
@@ -15853,9 +16649,8 @@ uint64_t wallet2::import_key_images(
                 (td.m_spent ? "spent" : "unspent"),
                 key_images[i]);
 
-        if (i < is_key_image_spent_response["spent_status"].size() &&
-            is_key_image_spent_response["spent_status"][i] ==
-                    rpc::IS_KEY_IMAGE_SPENT::SPENT::BLOCKCHAIN) {
+        if (i < spent_status.size() &&
+            spent_status[i] == rpc::IS_KEY_IMAGE_SPENT::SPENT::BLOCKCHAIN) {
             if (auto skii = spent_key_images.find(td.m_key_image); skii == spent_key_images.end())
                 swept_transfers.push_back(i);
             else
@@ -15875,6 +16670,7 @@ uint64_t wallet2::import_key_images(
         auto spent_txid = spent_txids.begin();
         hw::device& hwdev = m_account.get_device();
         auto it = spent_txids.begin();
+        std::unordered_set<crypto::hash> processed_txids;
         for (const auto& e : gettxs_res["txs"]) {
             THROW_WALLET_EXCEPTION_IF(
                     e["in_pool"],
@@ -16008,15 +16804,19 @@ uint64_t wallet2::import_key_images(
                     subaddr_account,
                     subaddr_indices);
 
-            // erase corresponding incoming payment
+            processed_txids.insert(*spent_txid);
+            ++spent_txid;
+        }
+
+        // erase the corresponding incoming payments
+        if (!processed_txids.empty()) {
             for (auto j = m_payments.begin(); j != m_payments.end();) {
-                if (j->second.m_tx_hash == *spent_txid)
+                if (processed_txids.count(j->second.m_tx_hash))
                     j = m_payments.erase(j);
                 else
                     ++j;
             }
-
-            ++spent_txid;
+            invalidate_history_index();
         }
 
         for (size_t n : swept_transfers) {
@@ -16028,7 +16828,8 @@ uint64_t wallet2::import_key_images(
             bool stake =
                     service_nodes::tx_get_staking_components(td.m_tx, nullptr /*stake*/, td.m_txid);
             pd.m_pay_type = stake ? wallet::pay_type::stake : wallet::pay_type::out;
-            m_confirmed_txs.emplace(null<hash>, pd);
+            if (auto [it, ins] = m_confirmed_txs.emplace(null<hash>, pd); ins)
+                index_confirmed(*it);
         }
     }
 
@@ -16044,6 +16845,7 @@ bool wallet2::import_key_images(
         log::info(logcat, "More key images returned that we know outputs for");
         return false;
     }
+    invalidate_balance_cache();
     for (size_t ki_idx = 0; ki_idx < key_images.size(); ++ki_idx) {
         const size_t transfer_idx = ki_idx + offset;
         if (selected_transfers && !selected_transfers->count(transfer_idx))
@@ -16091,6 +16893,7 @@ wallet2::payment_container wallet2::export_payments() const {
 }
 void wallet2::import_payments(const payment_container& payments) {
     m_payments.clear();
+    invalidate_history_index();
     for (auto const& p : payments) {
         m_payments.emplace(p);
     }
@@ -16099,6 +16902,7 @@ void wallet2::import_payments_out(
         const std::list<std::pair<crypto::hash, wallet2::confirmed_transfer_details>>&
                 confirmed_payments) {
     m_confirmed_txs.clear();
+    invalidate_history_index();
     for (auto const& p : confirmed_payments) {
         m_confirmed_txs.emplace(p);
     }
@@ -16181,6 +16985,7 @@ size_t wallet2::import_outputs(
 
     const size_t offset = outputs.first;
     const size_t original_size = m_transfers.size();
+    invalidate_balance_cache();
     m_transfers.resize(offset + outputs.second.size());
     for (size_t i = 0; i < offset; ++i)
         m_transfers[i].m_key_image_request = false;
@@ -16443,38 +17248,46 @@ std::string wallet2::export_multisig() {
 
     const crypto::public_key signer = get_multisig_signer_public_key();
 
-    info.resize(m_transfers.size());
-    for (size_t n = 0; n < m_transfers.size(); ++n) {
-        transfer_details& td = m_transfers[n];
-        crypto::key_image ki;
-        memwipe(td.m_multisig_k.data(), td.m_multisig_k.size() * sizeof(td.m_multisig_k[0]));
-        info[n].m_LR.clear();
-        info[n].m_partial_key_images.clear();
+    // Wallet tries to create as many transactions as many signers combinations. We calculate
+    // the maximum number here as follows: if we have 2/4 wallet with signers: A, B, C, D and A
+    // is a transaction creator it will need to pick up 1 signer from 3 wallets left. That means
+    // counting combinations for excluding 2-of-3 wallets (k = total signers count - threshold,
+    // n = total signers count - 1).
+    const size_t nlr = tools::combinations_count(
+            m_multisig_signers.size() - m_multisig_threshold, m_multisig_signers.size() - 1);
 
-        for (size_t m = 0; m < get_account().get_multisig_keys().size(); ++m) {
-            // we want to export the partial key image, not the full one, so we can't use
-            // td.m_key_image
-            bool r = generate_multisig_key_image(
-                    get_account().get_keys(), m, td.get_public_key(), ki);
-            CHECK_AND_ASSERT_THROW_MES(r, "Failed to generate key image");
-            info[n].m_partial_key_images.push_back(ki);
-        }
+    // Each output only touches its own transfer_details and info entry, so the key image and L/R
+    // computations (all scalarmults) can run in parallel across outputs.
+    info.resize(m_transfers.size());
+    multisig_parallel_for(
+            m_transfers.size(),
+            [&](size_t n) {
+                transfer_details& td = m_transfers[n];
+                crypto::key_image ki;
+                memwipe(td.m_multisig_k.data(),
+                        td.m_multisig_k.size() * sizeof(td.m_multisig_k[0]));
+                info[n].m_LR.clear();
+                info[n].m_partial_key_images.clear();
+
+                for (size_t m = 0; m < get_account().get_multisig_keys().size(); ++m) {
+                    // we want to export the partial key image, not the full one, so we can't use
+                    // td.m_key_image
+                    bool r = generate_multisig_key_image(
+                            get_account().get_keys(), m, td.get_public_key(), ki);
+                    CHECK_AND_ASSERT_THROW_MES(r, "Failed to generate key image");
+                    info[n].m_partial_key_images.push_back(ki);
+                }
 
-        // Wallet tries to create as many transactions as many signers combinations. We calculate
-        // the maximum number here as follows: if we have 2/4 wallet with signers: A, B, C, D and A
-        // is a transaction creator it will need to pick up 1 signer from 3 wallets left. That means
-        // counting combinations for excluding 2-of-3 wallets (k = total signers count - threshold,
-        // n = total signers count - 1).
-        size_t nlr = tools::combinations_count(
-                m_multisig_signers.size() - m_multisig_threshold, m_multisig_signers.size() - 1);
-        for (size_t m = 0; m < nlr; ++m) {
-            td.m_multisig_k.push_back(rct::skGen());
-            const rct::multisig_kLRki kLRki = get_multisig_kLRki(n, td.m_multisig_k.back());
-            info[n].m_LR.push_back({kLRki.L, kLRki.R});
-        }
+                for (size_t m = 0; m < nlr; ++m) {
+                    td.m_multisig_k.push_back(rct::skGen());
+                    const rct::multisig_kLRki kLRki = get_multisig_kLRki(n, td.m_multisig_k.back());
+                    info[n].m_LR.push_back({kLRki.L, kLRki.R});
+                }
 
-        info[n].m_signer = signer;
-    }
+                info[n].m_signer = signer;
+            },
+            8,
+            "multisig_export");
 
     std::stringstream oss;
     boost::archive::portable_binary_oarchive ar(oss);
@@ -16499,18 +17312,29 @@ void wallet2::update_multisig_rescan_info(
             multisig_k.size() >= m_transfers.size(), "Mismatched sizes of multisig_k and info");
 
     log::debug(logcat, "update_multisig_rescan_info: updating index {}", n);
+    set_multisig_info(info, n);
+    set_multisig_key_image(n, get_multisig_composite_key_image(n), multisig_k[n]);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::set_multisig_info(
+        const std::vector<std::vector<wallet::multisig_info>>& info, size_t n) {
     transfer_details& td = m_transfers[n];
     td.m_multisig_info.clear();
     for (const auto& pi : info) {
         CHECK_AND_ASSERT_THROW_MES(n < pi.size(), "Bad pi size");
         td.m_multisig_info.push_back(pi[n]);
     }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::set_multisig_key_image(
+        size_t n, const crypto::key_image& ki, const std::vector<rct::key>& multisig_k) {
+    transfer_details& td = m_transfers[n];
     m_key_images.erase(td.m_key_image);
-    td.m_key_image = get_multisig_composite_key_image(n);
+    td.m_key_image = ki;
     td.m_key_image_known = true;
     td.m_key_image_request = false;
     td.m_key_image_partial = false;
-    td.m_multisig_k = multisig_k[n];
+    td.m_multisig_k = multisig_k;
     m_key_images[td.m_key_image] = n;
 }
 //----------------------------------------------------------------------------------------------------
@@ -16620,8 +17444,21 @@ size_t wallet2::import_multisig(std::vector<std::string> blobs) {
         break;
     }
 
-    for (size_t n = 0; n < n_outputs && n < m_transfers.size(); ++n) {
-        update_multisig_rescan_info(k, info, n);
+    // Composing the key images is the expensive part and is independent per output, so do that
+    // across the thread pool, then record them (which updates the shared m_key_images) serially.
+    const size_t n_update = std::min(n_outputs, m_transfers.size());
+    std::vector<crypto::key_image> composite_kis(n_update);
+    multisig_parallel_for(
+            n_update,
+            [&](size_t n) {
+                set_multisig_info(info, n);
+                composite_kis[n] = get_multisig_composite_key_image(n);
+            },
+            8,
+            "multisig_import");
+    for (size_t n = 0; n < n_update; ++n) {
+        log::debug(logcat, "import_multisig: updating index {}", n);
+        set_multisig_key_image(n, composite_kis[n], k[n]);
     }
 
     m_multisig_rescan_k = &k;
@@ -17181,10 +18018,16 @@ void wallet2::finish_rescan_bc_keep_key_images(uint64_t transfer_height, const c
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::get_bytes_sent() const {
-    return m_http_client.get_bytes_sent() + m_long_poll_client.get_bytes_sent();
+    uint64_t bytes = m_http_client.get_bytes_sent() + m_long_poll_client.get_bytes_sent();
+    for (auto& client : m_refresh_clients)
+        bytes += client.get_bytes_sent();
+    return bytes;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::get_bytes_received() const {
-    return m_http_client.get_bytes_received() + m_long_poll_client.get_bytes_received();
+    uint64_t bytes = m_http_client.get_bytes_received() + m_long_poll_client.get_bytes_received();
+    for (auto& client : m_refresh_clients)
+        bytes += client.get_bytes_received();
+    return bytes;
 }
 }  // namespace tools
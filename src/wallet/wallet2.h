@@ -31,15 +31,19 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <boost/serialization/deque.hpp>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/vector.hpp>
+#include <map>
 #include <memory>
 #include <nlohmann/json.hpp>
+#include <queue>
 #include <random>
+#include <unordered_set>
 
 #include "checkpoints/checkpoints.h"
 #include "common/file.h"
@@ -1030,8 +1034,16 @@ class wallet2 {
         std::set<uint32_t> subaddr_indices;
         uint32_t account_index;
         bool all_accounts;
+        // If non-zero, stop returning confirmed transfers once this many have been collected, at
+        // the end of the block containing the last of them.  (Unconfirmed transfers are always
+        // returned in full).
+        uint64_t limit = 0;
     };
-    void get_transfers(get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers);
+    // Fetches the requested transfers, sorted by height.  If they were truncated by `args.limit`
+    // this returns the height to pass as the `min_height` of the next call to continue from where
+    // this left off, otherwise nullopt.
+    std::optional<uint64_t> get_transfers(
+            get_transfers_args_t args, std::vector<wallet::transfer_view>& transfers);
     std::string transfers_to_csv(
             const std::vector<wallet::transfer_view>& transfers, bool formatting = false) const;
     void get_payments(
@@ -1046,6 +1058,10 @@ class wallet2 {
             uint64_t max_height = (uint64_t)-1,
             const std::optional<uint32_t>& subaddr_account = std::nullopt,
             const std::set<uint32_t>& subaddr_indices = {}) const;
+    void get_payments_by_txid(
+            const crypto::hash& txid,
+            std::list<std::pair<crypto::hash, wallet2::payment_details>>& payments,
+            const std::optional<uint32_t>& subaddr_account = std::nullopt) const;
     void get_payments_out(
             std::list<std::pair<crypto::hash, wallet2::confirmed_transfer_details>>&
                     confirmed_payments,
@@ -1053,6 +1069,8 @@ class wallet2 {
             uint64_t max_height = (uint64_t)-1,
             const std::optional<uint32_t>& subaddr_account = std::nullopt,
             const std::set<uint32_t>& subaddr_indices = {}) const;
+    // Returns the confirmed outgoing transfer with the given txid, or nullptr if there isn't one.
+    const confirmed_transfer_details* get_payment_out(const crypto::hash& txid) const;
     void get_unconfirmed_payments_out(
             std::list<std::pair<crypto::hash, wallet2::unconfirmed_transfer_details>>&
                     unconfirmed_payments,
@@ -1139,6 +1157,8 @@ class wallet2 {
             a& m_blockchain;
         }
         m_cached_height = m_blockchain.size();
+        invalidate_history_index();
+        invalidate_balance_cache();
         a& m_transfers;
         a& m_account_public_address;
         a& m_key_images;
@@ -1707,6 +1727,16 @@ class wallet2 {
             const typename RPC::request& req,
             typename RPC::response& res,
             bool throw_on_error = false) {
+        return invoke_http<RPC>(m_http_client, req, res, throw_on_error);
+    }
+
+    // Same as above, but makes the request through the given client instead of m_http_client.
+    template <typename RPC>
+    bool invoke_http(
+            cryptonote::rpc::http_client& client,
+            const typename RPC::request& req,
+            typename RPC::response& res,
+            bool throw_on_error = false) {
         using namespace cryptonote::rpc;
         static_assert(
                 std::is_base_of_v<RPC_COMMAND, RPC>
@@ -1723,13 +1753,13 @@ class wallet2 {
                 // TODO: post-8.x hard fork we can remove this one and let everything go through the
                 // non-binary json_rpc version instead (because all legacy json commands are
                 // callable via json_rpc as of daemon 8.x).
-                res = m_http_client.json<RPC>(RPC::names().front(), req);
+                res = client.json<RPC>(RPC::names().front(), req);
             else if constexpr (std::is_base_of_v<BINARY, RPC>)
-                res = m_http_client.binary<RPC>(RPC::names().front(), req);
+                res = client.binary<RPC>(RPC::names().front(), req);
             else if constexpr (std::is_base_of_v<RPC_COMMAND, RPC>)
-                res = m_http_client.json_rpc<RPC>(RPC::names().front(), req);
+                res = client.json_rpc<RPC>(RPC::names().front(), req);
             else  // light RPC:
-                res = m_http_client.json<RPC>(RPC::name, req);
+                res = client.json<RPC>(RPC::name, req);
             return true;
         } catch (const std::exception& e) {
             if (throw_on_error)
@@ -1757,6 +1787,9 @@ class wallet2 {
             std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>>& outs);
     bool set_ring(
             const crypto::key_image& key_image, const std::vector<uint64_t>& outs, bool relative);
+    bool set_rings(
+            const std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>>& rings,
+            bool relative);
     bool unset_ring(const std::vector<crypto::key_image>& key_images);
     bool unset_ring(const crypto::hash& txid);
     bool find_and_save_rings(bool force = true);
@@ -1998,13 +2031,24 @@ class wallet2 {
     void get_short_chain_history(std::list<crypto::hash>& ids, uint64_t granularity = 1) const;
     bool clear();
     void clear_soft(bool keep_key_images = false);
+    // State of the requests refresh() makes by height ahead of the batch it needs next; see
+    // prefetch_blocks().
+    struct refresh_pipeline;
+    static constexpr size_t REFRESH_PREFETCH_DEPTH = 3;
     void pull_blocks(
             uint64_t start_height,
             uint64_t& blocks_start_height,
             const std::list<crypto::hash>& short_chain_history,
             std::vector<cryptonote::block_complete_entry>& blocks,
             std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices>& o_indices,
-            uint64_t& current_height);
+            uint64_t& current_height,
+            uint64_t max_count = 0,
+            cryptonote::rpc::http_client* client = nullptr);
+    void parse_blocks(
+            const std::vector<cryptonote::block_complete_entry>& blocks,
+            std::vector<cryptonote::rpc::GET_BLOCKS_BIN::block_output_indices>& o_indices,
+            std::vector<parsed_block>& parsed_blocks,
+            bool& error) const;
     void pull_hashes(
             uint64_t start_height,
             uint64_t& blocks_start_height,
@@ -2025,7 +2069,16 @@ class wallet2 {
             std::vector<parsed_block>& parsed_blocks,
             bool& last,
             bool& error,
-            std::exception_ptr& exception);
+            std::exception_ptr& exception,
+            refresh_pipeline* pipeline = nullptr);
+    bool take_prefetched_blocks(
+            refresh_pipeline& pipeline,
+            const std::vector<parsed_block>& prev_parsed_blocks,
+            uint64_t& blocks_start_height,
+            std::vector<cryptonote::block_complete_entry>& blocks,
+            std::vector<parsed_block>& parsed_blocks,
+            uint64_t& current_height);
+    void prefetch_blocks(refresh_pipeline& pipeline, uint64_t next_start, uint64_t node_height);
     void process_parsed_blocks(
             uint64_t start_height,
             const std::vector<cryptonote::block_complete_entry>& blocks,
@@ -2058,6 +2111,10 @@ class wallet2 {
             const std::set<uint32_t>& subaddr_indices);
     void generate_genesis(cryptonote::block& b) const;
     void check_genesis(const crypto::hash& genesis_hash) const;  // throws
+    // Asks the daemon whether each of the given (hex) key images is spent, in chunks so that the
+    // requests don't time out; throws on failure.
+    std::vector<rpc::IS_KEY_IMAGE_SPENT::SPENT> get_key_images_spent_status(
+            const std::vector<std::string>& key_images);
     bool generate_chacha_key_from_secret_keys(crypto::chacha_key& key) const;
     void generate_chacha_key_from_password(
             const epee::wipeable_string& pass, crypto::chacha_key& key) const;
@@ -2145,7 +2202,13 @@ class wallet2 {
             const std::vector<std::vector<rct::key>>& multisig_k,
             const std::vector<std::vector<wallet::multisig_info>>& info,
             size_t n);
+    void set_multisig_info(const std::vector<std::vector<wallet::multisig_info>>& info, size_t n);
+    void set_multisig_key_image(
+            size_t n, const crypto::key_image& ki, const std::vector<rct::key>& multisig_k);
     bool add_rings(const crypto::chacha_key& key, const cryptonote::transaction_prefix& tx);
+    bool add_rings(
+            const crypto::chacha_key& key,
+            const std::vector<const cryptonote::transaction_prefix*>& txs);
     bool add_rings(const cryptonote::transaction_prefix& tx);
     bool remove_rings(const cryptonote::transaction_prefix& tx);
     bool get_ring(
@@ -2213,12 +2276,81 @@ class wallet2 {
     std::unordered_map<crypto::hash, std::vector<crypto::secret_key>> m_additional_tx_keys;
 
     cryptonote::rpc::http_client m_long_poll_client;
+
+    // Each of the requests refresh() has outstanding ahead of the batch it needs next gets its own
+    // client so that they actually run concurrently.
+    std::array<cryptonote::rpc::http_client, REFRESH_PREFETCH_DEPTH> m_refresh_clients;
     bool m_long_poll_local;
     mutable std::mutex m_long_poll_tx_pool_checksum_mutex;
     crypto::hash m_long_poll_tx_pool_checksum = {};
 
+    // Pool tx hashes (all txes, and blinks only) from the last get_pool_state() along with the
+    // daemon's pool sequence number for each, so that later calls only fetch what has changed.
+    struct pool_hashes_cache {
+        uint64_t seqno = 0;
+        std::unordered_set<crypto::hash> hashes;
+    };
+    pool_hashes_cache m_pool_hashes, m_pool_blink_hashes;
+
     transfer_container m_transfers;
     payment_container m_payments;
+
+    // Secondary indices of m_payments and m_confirmed_txs by height, by account and height, and
+    // (for payments) by txid, so that history queries don't have to scan every transfer the wallet
+    // has ever seen.  Entries are added as payments get recorded; anything that erases from,
+    // reloads, or changes the heights or accounts of those containers instead invalidates the
+    // index, and it gets rebuilt by the next query.  The pointers stay valid as long as the
+    // element does: unordered containers don't move elements when rehashing.
+    struct history_index {
+        using payment_ptr = const payment_container::value_type*;
+        using confirmed_ptr = const std::pair<const crypto::hash, confirmed_transfer_details>*;
+        bool valid = false;
+        std::multimap<uint64_t, payment_ptr> payments;
+        std::multimap<std::pair<uint32_t, uint64_t>, payment_ptr> account_payments;
+        std::unordered_multimap<crypto::hash, payment_ptr> txid_payments;
+        std::multimap<uint64_t, confirmed_ptr> confirmed;
+        std::multimap<std::pair<uint32_t, uint64_t>, confirmed_ptr> account_confirmed;
+    };
+    mutable history_index m_history_index;
+    const history_index& get_history_index() const;
+    void index_payment(const payment_container::value_type& p) const;
+    void index_confirmed(
+            const std::pair<const crypto::hash, confirmed_transfer_details>& c) const;
+    void invalidate_history_index();
+
+    // Balance totals per account and subaddress, so that balance queries don't have to walk
+    // m_transfers.  Like the history index this is rebuilt lazily, after being invalidated by
+    // anything that changes m_transfers (or the spent or frozen state of its entries), the key
+    // images, or m_unconfirmed_txs.  Outputs still locked by height wait in a min-heap ordered by
+    // unlock height and move into the unlocked totals as the chain height passes them.  The rare
+    // outputs whose unlock isn't a fixed height (timestamp locks, unmined blinks) are checked on
+    // each query instead, and the outputs locked by the network (blacklisted, or staked to a
+    // service node) are looked up again whenever the node's height changes.
+    struct balance_cache {
+        // The arrays are indexed by strictness: [0] non-strict, [1] strict
+        struct totals {
+            std::array<size_t, 2> outputs{};
+            std::array<uint64_t, 2> balance{};
+            std::array<uint64_t, 2> unlocked{};
+            std::array<uint64_t, 2> network_locked{};  // Included in unlocked
+            std::array<uint64_t, 2> max_unlock_height{};
+            bool has_change = false;
+            uint64_t change = 0;  // Non-strict only
+        };
+        using locked_output = std::pair<uint64_t, size_t>;  // unlock height, m_transfers index
+        bool valid = false;
+        uint64_t height = 0;
+        std::optional<uint64_t> node_height;
+        std::map<uint32_t, std::map<uint32_t, totals>> accounts;
+        std::priority_queue<locked_output, std::vector<locked_output>, std::greater<>> locked;
+        std::vector<size_t> unsettled;
+        std::vector<bool> height_unlocked;
+    };
+    mutable balance_cache m_balance_cache;
+    const balance_cache& get_balance_cache() const;
+    void rebuild_balance_cache() const;
+    void update_network_locks() const;
+    void invalidate_balance_cache();
     std::unordered_map<crypto::key_image, size_t> m_key_images;
     std::unordered_map<crypto::public_key, size_t> m_pub_keys;
     cryptonote::account_public_address m_account_public_address;
@@ -2293,6 +2425,11 @@ class wallet2 {
     // Aux transaction data from device
     std::unordered_map<crypto::hash, std::string> m_tx_device;
 
+    // Cumulative rct output counts per block (starting at m_rct_distribution_start_height) as of
+    // the last get_rct_distribution call, which later calls extend instead of fetching it again.
+    std::vector<uint64_t> m_rct_distribution;
+    uint64_t m_rct_distribution_start_height = 0;
+
 #ifdef ENABLE_LIGHT_WALLET
     // Light wallet
     bool m_light_wallet; /* sends view key to daemon for scanning */
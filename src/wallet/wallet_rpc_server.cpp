@@ -35,11 +35,13 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/asio/ip/address.hpp>
+#include <algorithm>
 #include <chrono>
 #include <concepts>
 #include <cstdint>
 #include <exception>
 
+#include "common/alloc_profile.h"
 #include "common/command_line.h"
 #include "common/exception.h"
 #include "common/guts.h"
@@ -95,13 +97,15 @@ namespace {
         return pwd_container;
     }
 
-    using rpc_func_data = std::pair<
-            bool,             // restricted
-            std::string (*)(  // function to invoke
-                    epee::serialization::portable_storage& ps,
-                    epee::serialization::storage_entry id,
-                    std::optional<epee::serialization::storage_entry> params,
-                    tools::wallet_rpc_server& server)>;
+    struct rpc_func_data {
+        bool restricted;
+        bool read_only;
+        // Parses the params and invokes the command, returning the JSON of its result.
+        std::string (*invoke)(
+                epee::serialization::portable_storage& ps,
+                std::optional<epee::serialization::storage_entry> params,
+                tools::wallet_rpc_server& server);
+    };
 
     template <std::derived_from<RPC_COMMAND> RPC>
     void register_rpc_command(std::unordered_map<std::string, rpc_func_data>& regs) {
@@ -118,10 +122,11 @@ namespace {
                 "or does not return a Response");
         rpc_func_data invoke = {
                 std::is_base_of_v<RESTRICTED, RPC>,
+                std::is_base_of_v<READ_ONLY, RPC>,
                 [](epee::serialization::portable_storage& ps,
-                   epee::serialization::storage_entry id,
                    std::optional<epee::serialization::storage_entry> params,
                    tools::wallet_rpc_server& server) {
+                    OXEN_ALLOC_SCOPE("wallet_rpc");
                     Request req{};
                     if (params) {
                         if (auto* section = std::get_if<epee::serialization::section>(&*params)) {
@@ -132,13 +137,8 @@ namespace {
                             throw oxen::traced<std::runtime_error>{
                                     "only top-level JSON object values are currently supported"};
                     }
-                    epee::json_rpc::response<Response> r{
-                            "2.0", server.invoke(std::move(req)), std::move(id)};
-                    std::string response;
-                    epee::serialization::store_t_to_json(r, response);
-                    if (response.capacity() > response.size())
-                        response += '\n';
-                    return response;
+                    auto response = server.invoke(std::move(req));
+                    return epee::serialization::store_t_to_json(response);
                 }};
 
         for (const auto& name : RPC::names())
@@ -177,6 +177,79 @@ namespace {
         return result;
     }
 
+    // Invokes a command, setting `result` to the JSON of its result and returning nullopt, or
+    // returning the error to send back if it throws.
+    std::optional<wallet_rpc_error> call_rpc(
+            const rpc_func_data& command,
+            std::optional<epee::serialization::storage_entry> params,
+            wallet_rpc_server& server,
+            std::string& result) {
+        wallet_rpc_error json_error{-32603, "Internal error"};
+        try {
+            epee::serialization::portable_storage ps;
+            result = command.invoke(ps, std::move(params), server);
+            return std::nullopt;
+        } catch (const wallet_rpc_server::parse_error& e) {
+            json_error = {-32602, "Invalid params"};  // Reserved json code/message value for
+                                                      // specifically this failure
+        } catch (const wallet_rpc_error& e) {
+            json_error = e;
+        } catch (const tools::error::no_connection_to_daemon& e) {
+            json_error = {error_code::NO_DAEMON_CONNECTION, e.what()};
+        } catch (const tools::error::daemon_busy& e) {
+            json_error = {error_code::DAEMON_IS_BUSY, e.what()};
+        } catch (const tools::error::zero_destination& e) {
+            json_error = {error_code::ZERO_DESTINATION, e.what()};
+        } catch (const tools::error::not_enough_money& e) {
+            json_error = {error_code::NOT_ENOUGH_MONEY, e.what()};
+        } catch (const tools::error::not_enough_unlocked_money& e) {
+            json_error = {error_code::NOT_ENOUGH_UNLOCKED_MONEY, e.what()};
+        } catch (const tools::error::tx_not_possible& e) {
+            json_error = {
+                    error_code::TX_NOT_POSSIBLE,
+                    fmt::format(
+                            fmt::runtime(wallet_rpc_server::tr(
+                                    "Transaction not possible. Only {} available, but "
+                                    "transaction needs {} = {} + {} (fee)")),
+                            cryptonote::print_money(e.available()),
+                            cryptonote::print_money(e.tx_amount() + e.fee()),
+                            cryptonote::print_money(e.tx_amount()),
+                            cryptonote::print_money(e.fee()))};
+        } catch (const tools::error::not_enough_outs_to_mix& e) {
+            json_error = {
+                    error_code::NOT_ENOUGH_OUTS_TO_MIX,
+                    e.what() + std::string(" Please use sweep_dust.")};
+        } catch (const error::file_exists& e) {
+            json_error = {
+                    error_code::WALLET_ALREADY_EXISTS, "Cannot create wallet. Already exists."};
+        } catch (const error::invalid_password& e) {
+            json_error = {error_code::INVALID_PASSWORD, "Invalid password."};
+        } catch (const error::account_index_outofbound& e) {
+            json_error = {error_code::ACCOUNT_INDEX_OUT_OF_BOUNDS, e.what()};
+        } catch (const error::address_index_outofbound& e) {
+            json_error = {error_code::ADDRESS_INDEX_OUT_OF_BOUNDS, e.what()};
+        } catch (const error::signature_check_failed& e) {
+            json_error = {error_code::WRONG_SIGNATURE, e.what()};
+        } catch (const error::tx_blink_rejected& e) {
+            json_error = {error_code::BLINK_FAILED, e.what()};
+        } catch (const std::exception& e) {
+            json_error = {error_code::UNKNOWN_ERROR, e.what()};
+        } catch (...) {
+            // leave it as unknown error
+        }
+        return json_error;
+    }
+
+    // Wraps a command result in a JSON RPC response.
+    std::string jsonrpc_result(const nlohmann::json& id, std::string_view result) {
+        return fmt::format("{{\"id\":{},\"jsonrpc\":\"2.0\",\"result\":{}}}\n", id.dump(), result);
+    }
+
+    // The snapshot keeps the results of at most this many distinct read-only requests, and drops
+    // any that haven't been repeated for this long.
+    constexpr size_t MAX_SNAPSHOT_ENTRIES = 64;
+    constexpr auto SNAPSHOT_ENTRY_EXPIRY = 5min;
+
 }  // namespace
 
 const char* wallet_rpc_server::tr(const char* str) {
@@ -207,8 +280,11 @@ void wallet_rpc_server::handle_json_rpc_request(HttpResponse& res, HttpRequest&
     std::vector<std::pair<std::string, std::string>> extra_headers;
     handle_cors(req, extra_headers);
 
-    res.onAborted([] {});
-    res.onData([this, &res, extra_headers = std::move(extra_headers), buffer = ""s](
+    // Replies can be sent later, from a deferred wallet thread job, by which time the connection
+    // may have gone away
+    auto aborted = std::make_shared<bool>(false);
+    res.onAborted([aborted] { *aborted = true; });
+    res.onData([this, &res, aborted, extra_headers = std::move(extra_headers), buffer = ""s](
                        std::string_view d, bool done) mutable {
         if (!done) {
             buffer += d;
@@ -254,10 +330,10 @@ void wallet_rpc_server::handle_json_rpc_request(HttpResponse& res, HttpRequest&
                 method,
                 get_remote_address(res));
 
-        const auto& [restricted, invoke_ptr] = it->second;
+        const auto& command = it->second;
 
         // If it's a restricted command and we're in restricted mode then deny it
-        if (restricted && m_restricted) {
+        if (command.restricted && m_restricted) {
             log::warning(
                     logcat,
                     "JSON RPC request for restricted command {} in restricted mode from {}",
@@ -273,83 +349,165 @@ void wallet_rpc_server::handle_json_rpc_request(HttpResponse& res, HttpRequest&
         if (!ps.get_value("params", *params, nullptr))
             params.reset();
 
-        std::string result;
-        wallet_rpc_error json_error{-32603, "Internal error"};
+        auto send_result = [this, &res, extra_headers = std::move(extra_headers)](
+                                   const std::string& body) {
+            res.writeHeader("Server", server_header());
+            res.writeHeader("Content-Type", "application/json");
+            for (const auto& [name, value] : extra_headers)
+                res.writeHeader(name, value);
+            if (closing())
+                res.writeHeader("Connection", "close");
+
+            res.end(body);
+            if (closing())
+                res.close();
+        };
+
+        // Read-only requests that were made recently get answered straight from the snapshot,
+        // which is keyed by the request without its id.
+        std::string key;
+        if (command.read_only) {
+            ps.delete_entry("id");
+            ps.dump_as_json(key, 0, false);
+            if (auto result = snapshot_result(key))
+                return send_result(jsonrpc_result(id, *result));
+        }
 
+        queue_wallet_job([this,
+                          &res,
+                          &command,
+                          aborted,
+                          id = std::move(id),
+                          method = std::move(method),
+                          params = std::move(params),
+                          key = std::move(key),
+                          send_result = std::move(send_result)]() mutable {
+            std::string result;
+            auto error = call_rpc(command, params, *this, result);
+            if (command.read_only) {
+                if (!error)
+                    add_to_snapshot(key, std::move(method), std::move(params), result);
+            } else
+                // Update the snapshot before replying so that the caller's next read sees the
+                // result of this request
+                rebuild_snapshot();
+
+            loop_defer([this,
+                        &res,
+                        aborted,
+                        id = std::move(id),
+                        error = std::move(error),
+                        result = std::move(result),
+                        send_result = std::move(send_result)]() mutable {
+                if (*aborted)
+                    return;
+                if (error)
+                    jsonrpc_error_response(res, error->code, std::move(error->message), {});
+                else
+                    send_result(jsonrpc_result(id, result));
+            });
+        });
+    });
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void wallet_rpc_server::queue_wallet_job(std::function<void()> job) {
+    {
+        std::lock_guard lock{m_jobs_mutex};
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobs_cv.notify_one();
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void wallet_rpc_server::wallet_thread_loop() {
+    std::unique_lock lock{m_jobs_mutex};
+    for (;;) {
+        m_jobs_cv.wait(lock, [this] { return m_jobs_stop || !m_jobs.empty(); });
+        if (m_jobs.empty())
+            return;
+        auto job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        lock.unlock();
         try {
-            result = invoke_ptr(ps, std::move(epee_id), std::move(params), *this);
-            json_error.code = 0;
-        } catch (const parse_error& e) {
-            json_error = {-32602, "Invalid params"};  // Reserved json code/message value for
-                                                      // specifically this failure
-        } catch (const wallet_rpc_error& e) {
-            json_error = e;
-        } catch (const tools::error::no_connection_to_daemon& e) {
-            json_error = {error_code::NO_DAEMON_CONNECTION, e.what()};
-        } catch (const tools::error::daemon_busy& e) {
-            json_error = {error_code::DAEMON_IS_BUSY, e.what()};
-        } catch (const tools::error::zero_destination& e) {
-            json_error = {error_code::ZERO_DESTINATION, e.what()};
-        } catch (const tools::error::not_enough_money& e) {
-            json_error = {error_code::NOT_ENOUGH_MONEY, e.what()};
-        } catch (const tools::error::not_enough_unlocked_money& e) {
-            json_error = {error_code::NOT_ENOUGH_UNLOCKED_MONEY, e.what()};
-        } catch (const tools::error::tx_not_possible& e) {
-            json_error = {
-                    error_code::TX_NOT_POSSIBLE,
-                    fmt::format(
-                            fmt::runtime(tr("Transaction not possible. Only {} available, but "
-                                            "transaction needs {} = {} + {} (fee)")),
-                            cryptonote::print_money(e.available()),
-                            cryptonote::print_money(e.tx_amount() + e.fee()),
-                            cryptonote::print_money(e.tx_amount()),
-                            cryptonote::print_money(e.fee()))};
-        } catch (const tools::error::not_enough_outs_to_mix& e) {
-            json_error = {
-                    error_code::NOT_ENOUGH_OUTS_TO_MIX,
-                    e.what() + std::string(" Please use sweep_dust.")};
-        } catch (const error::file_exists& e) {
-            json_error = {
-                    error_code::WALLET_ALREADY_EXISTS, "Cannot create wallet. Already exists."};
-        } catch (const error::invalid_password& e) {
-            json_error = {error_code::INVALID_PASSWORD, "Invalid password."};
-        } catch (const error::account_index_outofbound& e) {
-            json_error = {error_code::ACCOUNT_INDEX_OUT_OF_BOUNDS, e.what()};
-        } catch (const error::address_index_outofbound& e) {
-            json_error = {error_code::ADDRESS_INDEX_OUT_OF_BOUNDS, e.what()};
-        } catch (const error::signature_check_failed& e) {
-            json_error = {error_code::WRONG_SIGNATURE, e.what()};
-        } catch (const error::tx_blink_rejected& e) {
-            json_error = {error_code::BLINK_FAILED, e.what()};
+            job();
         } catch (const std::exception& e) {
-            json_error = {error_code::UNKNOWN_ERROR, e.what()};
-        } catch (...) {
-            // leave it as unknown error
+            log::error(logcat, "Wallet job failed: {}", e.what());
         }
+        lock.lock();
+    }
+}
+//------------------------------------------------------------------------------------------------------------------------------
+std::optional<std::string> wallet_rpc_server::snapshot_result(const std::string& key) {
+    std::lock_guard lock{m_snapshot_mutex};
+    auto it = m_snapshot.find(key);
+    if (it == m_snapshot.end())
+        return std::nullopt;
+    it->second.last_used = std::chrono::steady_clock::now();
+    return it->second.result;
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void wallet_rpc_server::add_to_snapshot(
+        const std::string& key,
+        std::string method,
+        std::optional<epee::serialization::storage_entry> params,
+        std::string result) {
+    std::lock_guard lock{m_snapshot_mutex};
+    if (m_snapshot.size() >= MAX_SNAPSHOT_ENTRIES && !m_snapshot.count(key)) {
+        auto lru = std::min_element(m_snapshot.begin(), m_snapshot.end(), [](auto& a, auto& b) {
+            return a.second.last_used < b.second.last_used;
+        });
+        m_snapshot.erase(lru);
+    }
+    m_snapshot.insert_or_assign(
+            key,
+            snapshot_entry{
+                    std::move(method),
+                    std::move(params),
+                    std::move(result),
+                    std::chrono::steady_clock::now()});
+}
+//------------------------------------------------------------------------------------------------------------------------------
+void wallet_rpc_server::rebuild_snapshot() {
+    // key, method, params
+    std::vector<
+            std::tuple<std::string, std::string, std::optional<epee::serialization::storage_entry>>>
+            requests;
+    {
+        std::lock_guard lock{m_snapshot_mutex};
+        auto expired = std::chrono::steady_clock::now() - SNAPSHOT_ENTRY_EXPIRY;
+        std::erase_if(m_snapshot, [&](const auto& e) { return e.second.last_used < expired; });
+        for (const auto& [key, entry] : m_snapshot)
+            requests.emplace_back(key, entry.method, entry.params);
+    }
+    if (requests.empty())
+        return;
 
-        if (json_error.code != 0)
-            return jsonrpc_error_response(res, json_error.code, std::move(json_error.message), {});
-
-        res.writeHeader("Server", server_header());
-        res.writeHeader("Content-Type", "application/json");
-        for (const auto& [name, value] : extra_headers)
-            res.writeHeader(name, value);
-        if (closing())
-            res.writeHeader("Connection", "close");
+    std::unordered_map<std::string, std::string> results;
+    for (auto& [key, method, params] : requests) {
+        std::string result;
+        // Anything that fails now (for instance because the wallet got closed) just gets dropped
+        if (!call_rpc(rpc_commands.at(method), std::move(params), *this, result))
+            results.emplace(key, std::move(result));
+    }
 
-        res.end(result);
-        if (closing())
-            res.close();
-    });
+    std::lock_guard lock{m_snapshot_mutex};
+    for (auto it = m_snapshot.begin(); it != m_snapshot.end();) {
+        if (auto r = results.find(it->first); r != results.end()) {
+            it->second.result = std::move(r->second);
+            ++it;
+        } else
+            it = m_snapshot.erase(it);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------
 void wallet_rpc_server::run_loop() {
-    // We start 1-2 threads here:
-    // - the uWS thread that handles all requests.
+    // We start 2-3 threads here:
+    // - the uWS thread that handles all requests, answering repeated read-only requests from the
+    //   snapshot and passing everything else to the wallet thread.
+    // - the wallet thread, which runs the requests and refreshes that touch the wallet.
     // - a long poll thread (optional).
-    // then this parent thread handles injecting refresh jobs (either on a timer, or because of long
-    // polling detecting a change) into the uWS thread loop, and shutting down on a signal.
+    // then this parent thread handles queuing refresh jobs (either on a timer, or because of long
+    // polling detecting a change) for the wallet thread, and shutting down on a signal.
     std::promise<std::pair<uWS::Loop*, std::vector<us_listen_socket_t*>>> loop_promise;
     auto loop_future = loop_promise.get_future();
 
@@ -408,11 +566,13 @@ void wallet_rpc_server::run_loop() {
     if (m_wallet)
         start_long_poll_thread();
 
+    m_wallet_thread = std::thread{[this] { wallet_thread_loop(); }};
+
     // Used to prevent queuing up multiple refreshes at once
     std::atomic<bool> refreshing = false;
 
     // Now we just hang around and twiddle our thumbs until we're told to quit.  (And once in a
-    // while we inject a wallet refresh into the uWS loop).
+    // while we queue a wallet refresh).
     while (!m_stop.load(std::memory_order_relaxed)) {
         bool refresh_now = !refreshing && m_wallet &&
                            ((m_auto_refresh_period > 0s &&
@@ -423,8 +583,9 @@ void wallet_rpc_server::run_loop() {
         if (refresh_now) {
             refreshing = true;
 
-            // Queue the refresh to run in the uWS thread loop
-            loop_defer([this, &refreshing] {
+            // Queue the refresh to run in the wallet thread; read-only requests meanwhile get
+            // answered from the snapshot, which we then update with the refreshed state.
+            queue_wallet_job([this, &refreshing] {
                 m_long_poll_new_changes = false;  // Always consume the change, if we miss one due
                                                   // to thread race, not the end of the world.
 
@@ -434,6 +595,7 @@ void wallet_rpc_server::run_loop() {
                 } catch (const std::exception& ex) {
                     log::error(logcat, "Exception while refreshing: {}", ex.what());
                 }
+                rebuild_snapshot();
 
                 m_last_auto_refresh_time = std::chrono::steady_clock::now();
                 refreshing = false;
@@ -452,6 +614,14 @@ void wallet_rpc_server::run_loop() {
 
     stop_long_poll_thread();
 
+    log::debug(logcat, "Joining wallet thread");
+    {
+        std::lock_guard lock{m_jobs_mutex};
+        m_jobs_stop = true;
+    }
+    m_jobs_cv.notify_one();
+    m_wallet_thread.join();
+
     log::debug(logcat, "Joining uws thread");
     uws_thread.join();
 
@@ -2093,9 +2263,11 @@ GET_TRANSFERS::response wallet_rpc_server::invoke(GET_TRANSFERS::request&& req)
     args.subaddr_indices = req.subaddr_indices;
     args.account_index = req.account_index;
     args.all_accounts = req.all_accounts;
+    args.limit = req.limit;
 
     std::vector<wallet::transfer_view> transfers;
-    m_wallet->get_transfers(args, transfers);
+    if (auto next = m_wallet->get_transfers(args, transfers))
+        res.next_height = *next;
 
     for (wallet::transfer_view& entry : transfers) {
         // TODO(oxen): This discrepancy between having to use pay_type if type is
@@ -2162,27 +2334,13 @@ GET_TRANSFER_BY_TXID::response wallet_rpc_server::invoke(GET_TRANSFER_BY_TXID::r
                 error_code::ACCOUNT_INDEX_OUT_OF_BOUNDS, "Account index is out of bound"};
 
     std::list<std::pair<crypto::hash, tools::wallet2::payment_details>> payments;
-    m_wallet->get_payments(payments, 0, (uint64_t)-1, req.account_index);
-    for (std::list<std::pair<crypto::hash, tools::wallet2::payment_details>>::const_iterator i =
-                 payments.begin();
-         i != payments.end();
-         ++i) {
-        if (i->second.m_tx_hash == txid) {
-            res.transfers.push_back(
-                    m_wallet->make_transfer_view(i->second.m_tx_hash, i->first, i->second));
-        }
-    }
+    m_wallet->get_payments_by_txid(txid, payments, req.account_index);
+    for (const auto& [payment_id, pd] : payments)
+        res.transfers.push_back(m_wallet->make_transfer_view(pd.m_tx_hash, payment_id, pd));
 
-    std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>> payments_out;
-    m_wallet->get_payments_out(payments_out, 0, (uint64_t)-1, req.account_index);
-    for (std::list<std::pair<crypto::hash, tools::wallet2::confirmed_transfer_details>>::
-                 const_iterator i = payments_out.begin();
-         i != payments_out.end();
-         ++i) {
-        if (i->first == txid) {
-            res.transfers.push_back(m_wallet->make_transfer_view(i->first, i->second));
-        }
-    }
+    if (auto* ctd = m_wallet->get_payment_out(txid);
+        ctd && ctd->m_subaddr_account == req.account_index)
+        res.transfers.push_back(m_wallet->make_transfer_view(txid, *ctd));
 
     std::list<std::pair<crypto::hash, tools::wallet2::unconfirmed_transfer_details>> upayments;
     m_wallet->get_unconfirmed_payments_out(upayments, req.account_index);
@@ -3109,6 +3267,21 @@ GET_VERSION::response wallet_rpc_server::invoke(GET_VERSION::request&& req) {
     return res;
 }
 //------------------------------------------------------------------------------------------------------------------------------
+GET_ALLOCATION_STATS::response wallet_rpc_server::invoke(GET_ALLOCATION_STATS::request&& req) {
+    GET_ALLOCATION_STATS::response res{};
+    res.compiled = tools::alloc_profile::compiled();
+    for (auto& t : tools::alloc_profile::stats())
+        res.tags.push_back(
+                {std::move(t.name),
+                 t.live_bytes,
+                 t.live_allocs,
+                 t.allocs,
+                 t.bytes,
+                 t.alloc_rate,
+                 t.byte_rate});
+    return res;
+}
+//------------------------------------------------------------------------------------------------------------------------------
 
 //
 // Oxen
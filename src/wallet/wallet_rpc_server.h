@@ -35,7 +35,13 @@
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
 
 #include "common/fs.h"
 #include "common/periodic_task.h"
@@ -163,6 +169,8 @@ class wallet_rpc_server final : public cryptonote::rpc::http_server_base {
     wallet_rpc::SET_LOG_LEVEL::response invoke(wallet_rpc::SET_LOG_LEVEL::request&& req);
     wallet_rpc::SET_LOG_CATEGORIES::response invoke(wallet_rpc::SET_LOG_CATEGORIES::request&& req);
     wallet_rpc::GET_VERSION::response invoke(wallet_rpc::GET_VERSION::request&& req);
+    wallet_rpc::GET_ALLOCATION_STATS::response invoke(
+            wallet_rpc::GET_ALLOCATION_STATS::request&& req);
     wallet_rpc::STAKE::response invoke(wallet_rpc::STAKE::request&& req);
     wallet_rpc::REGISTER_SERVICE_NODE::response invoke(
             wallet_rpc::REGISTER_SERVICE_NODE::request&& req);
@@ -187,6 +195,30 @@ class wallet_rpc_server final : public cryptonote::rpc::http_server_base {
     /// Handles a POST request to /json_rpc.
     void handle_json_rpc_request(HttpResponse& res, HttpRequest& req);
 
+    // Queues a job to run on the wallet thread.  Every request that touches the wallet (other than
+    // those answered from the snapshot) and every auto-refresh runs there, one at a time and in the
+    // order queued, so that a long refresh or tx construction doesn't stall the uWS thread.
+    void queue_wallet_job(std::function<void()> job);
+
+    // Runs queued wallet jobs until m_jobs_stop is set and the queue is empty.
+    void wallet_thread_loop();
+
+    // Returns the snapshotted result of the read-only request with the given key, if there is one.
+    std::optional<std::string> snapshot_result(const std::string& key);
+
+    // Adds the result of a read-only request just run against the wallet to the snapshot.  Called
+    // on the wallet thread.
+    void add_to_snapshot(
+            const std::string& key,
+            std::string method,
+            std::optional<epee::serialization::storage_entry> params,
+            std::string result);
+
+    // Re-runs the read-only requests in the snapshot against the current wallet and then replaces
+    // all of their results at once, so that everything served from the snapshot reflects the same
+    // wallet state.  Called on the wallet thread after anything that may have changed the wallet.
+    void rebuild_snapshot();
+
     // Checks that a wallet is open; if not, throws an error.
     void require_open();
 
@@ -252,5 +284,23 @@ class wallet_rpc_server final : public cryptonote::rpc::http_server_base {
     std::atomic<bool> m_long_poll_new_changes;
     std::atomic<bool> m_long_poll_disabled;
     std::thread m_long_poll_thread;
+
+    std::thread m_wallet_thread;
+    std::mutex m_jobs_mutex;
+    std::condition_variable m_jobs_cv;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_jobs_stop = false;
+
+    // Recent read-only requests and their results as of the last snapshot, keyed by the request
+    // JSON without its id.  The uWS thread answers repeats of these straight from here, without
+    // waiting for the wallet thread.
+    struct snapshot_entry {
+        std::string method;
+        std::optional<epee::serialization::storage_entry> params;
+        std::string result;
+        std::chrono::steady_clock::time_point last_used;
+    };
+    std::mutex m_snapshot_mutex;
+    std::unordered_map<std::string, snapshot_entry> m_snapshot;
 };
 }  // namespace tools
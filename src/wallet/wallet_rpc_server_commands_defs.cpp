@@ -567,6 +567,7 @@ KV_SERIALIZE_OPT(max_height, cryptonote::MAX_BLOCK_NUMBER);
 KV_SERIALIZE(account_index);
 KV_SERIALIZE(subaddr_indices);
 KV_SERIALIZE_OPT(all_accounts, false);
+KV_SERIALIZE_OPT(limit, (uint64_t)0);
 KV_SERIALIZE_MAP_CODE_END()
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSFERS::response)
@@ -575,6 +576,7 @@ KV_SERIALIZE(out);
 KV_SERIALIZE(pending);
 KV_SERIALIZE(failed);
 KV_SERIALIZE(pool);
+KV_SERIALIZE(next_height);
 KV_SERIALIZE_MAP_CODE_END()
 
 KV_SERIALIZE_MAP_CODE_BEGIN(GET_TRANSFERS_CSV::response)
@@ -886,6 +888,21 @@ KV_SERIALIZE_MAP_CODE_BEGIN(GET_VERSION::response)
 KV_SERIALIZE(version)
 KV_SERIALIZE_MAP_CODE_END()
 
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_ALLOCATION_STATS::tag)
+KV_SERIALIZE(name)
+KV_SERIALIZE(live_bytes)
+KV_SERIALIZE(live_allocs)
+KV_SERIALIZE(allocs)
+KV_SERIALIZE(bytes)
+KV_SERIALIZE(alloc_rate)
+KV_SERIALIZE(byte_rate)
+KV_SERIALIZE_MAP_CODE_END()
+
+KV_SERIALIZE_MAP_CODE_BEGIN(GET_ALLOCATION_STATS::response)
+KV_SERIALIZE(compiled)
+KV_SERIALIZE(tags)
+KV_SERIALIZE_MAP_CODE_END()
+
 KV_SERIALIZE_MAP_CODE_BEGIN(STAKE::request)
 KV_SERIALIZE(subaddr_indices);
 KV_SERIALIZE(destination);
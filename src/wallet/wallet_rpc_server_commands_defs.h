@@ -66,6 +66,11 @@ struct RPC_COMMAND {};
 /// restricted mode).
 struct RESTRICTED : RPC_COMMAND {};
 
+/// Additional base class for commands that only read the wallet, so that the RPC server can answer
+/// a repeat of one from its latest snapshot of results rather than waiting for the wallet to be
+/// free (e.g. of a refresh).
+struct READ_ONLY {};
+
 /// Generic, serializable, no-argument request or response type, use as
 /// `struct request : EMPTY {};` or `using response = EMPTY;`
 struct EMPTY {
@@ -85,7 +90,7 @@ namespace {
 
 OXEN_RPC_DOC_INTROSPECT
 // Return the wallet's balance.
-struct GET_BALANCE : RPC_COMMAND {
+struct GET_BALANCE : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_balance", "getbalance"); }
 
     struct request {
@@ -136,7 +141,7 @@ struct GET_BALANCE : RPC_COMMAND {
 
 OXEN_RPC_DOC_INTROSPECT
 // Return the wallet's addresses for an account. Optionally filter for specific set of subaddresses.
-struct GET_ADDRESS : RPC_COMMAND {
+struct GET_ADDRESS : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_address", "getaddress"); }
 
     struct request {
@@ -166,7 +171,7 @@ struct GET_ADDRESS : RPC_COMMAND {
 
 OXEN_RPC_DOC_INTROSPECT
 // Get account and address indexes from a specific (sub)address.
-struct GET_ADDRESS_INDEX : RPC_COMMAND {
+struct GET_ADDRESS_INDEX : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_address_index"); }
 
     struct request {
@@ -223,7 +228,7 @@ struct LABEL_ADDRESS : RPC_COMMAND {
 
 OXEN_RPC_DOC_INTROSPECT
 // Get all accounts for a wallet. Optionally filter accounts by tag.
-struct GET_ACCOUNTS : RPC_COMMAND {
+struct GET_ACCOUNTS : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_accounts"); }
 
     struct request {
@@ -358,7 +363,7 @@ struct SET_ACCOUNT_TAG_DESCRIPTION : RPC_COMMAND {
 
 OXEN_RPC_DOC_INTROSPECT
 // Returns the wallet's current block height and blockchain immutable height
-struct GET_HEIGHT : RPC_COMMAND {
+struct GET_HEIGHT : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_height", "getheight"); }
 
     struct request : EMPTY {};
@@ -738,7 +743,7 @@ struct payment_details {
 
 OXEN_RPC_DOC_INTROSPECT
 // Get a list of incoming payments using a given payment id.
-struct GET_PAYMENTS : RPC_COMMAND {
+struct GET_PAYMENTS : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_payments"); }
 
     struct request {
@@ -761,7 +766,7 @@ OXEN_RPC_DOC_INTROSPECT
 // This method is the preferred method over  get_paymentsbecause it
 // has the same functionality but is more extendable.
 // Either is fine for looking up transactions by a single payment ID.
-struct GET_BULK_PAYMENTS : RPC_COMMAND {
+struct GET_BULK_PAYMENTS : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("get_bulk_payments"); }
 
     struct request {
@@ -801,7 +806,7 @@ struct transfer_details {
 
 OXEN_RPC_DOC_INTROSPECT
 // Return a list of incoming transfers to the wallet.
-struct INCOMING_TRANSFERS : RPC_COMMAND {
+struct INCOMING_TRANSFERS : RPC_COMMAND, READ_ONLY {
     static constexpr auto names() { return NAMES("incoming_transfers"); }
 
     struct request {
@@ -1154,7 +1159,7 @@ struct CHECK_RESERVE_PROOF : RPC_COMMAND {
 OXEN_RPC_DOC_INTROSPECT
 // Returns a list of transfers, by default all transfer types are included. If all requested type
 // fields are false, then all transfers will be queried.
-struct GET_TRANSFERS : RESTRICTED {
+struct GET_TRANSFERS : RESTRICTED, READ_ONLY {
     static constexpr auto names() { return NAMES("get_transfers"); }
 
     struct request {
@@ -1177,6 +1182,10 @@ struct GET_TRANSFERS : RESTRICTED {
                                              // transfers. (defaults to 0)
         bool all_accounts;  // If true, return transfers for all accounts, subaddr_indices and
                             // account_index are ignored
+        uint64_t limit;  // (Optional) If non-zero, return about this many confirmed transfers:
+                         // the response stops at the end of the block in which the limit is
+                         // reached and sets `next_height` to continue from.  Unconfirmed transfers
+                         // are always included.
 
         KV_MAP_SERIALIZABLE
     };
@@ -1187,6 +1196,9 @@ struct GET_TRANSFERS : RESTRICTED {
         std::list<wallet::transfer_view> pending;  //
         std::list<wallet::transfer_view> failed;   //
         std::list<wallet::transfer_view> pool;     //
+        uint64_t next_height;  // If `limit` cut the confirmed transfers short, the `min_height` to
+                               // request (with `filter_by_height`) to get the next page; 0 if
+                               // there are no more.
 
         KV_MAP_SERIALIZABLE
     };
@@ -1208,7 +1220,7 @@ struct GET_TRANSFERS_CSV : RESTRICTED {
 
 OXEN_RPC_DOC_INTROSPECT
 // Show information about a transfer to/from this address.
-struct GET_TRANSFER_BY_TXID : RESTRICTED {
+struct GET_TRANSFER_BY_TXID : RESTRICTED, READ_ONLY {
     static constexpr auto names() { return NAMES("get_transfer_by_txid"); }
 
     struct request {
@@ -1906,6 +1918,34 @@ struct GET_VERSION : RPC_COMMAND {
     };
 };
 
+OXEN_RPC_DOC_INTROSPECT
+// Get the wallet's heap allocation counts by subsystem, for attributing memory growth.  This is
+// only compiled in with -DENABLE_ALLOC_PROFILING=ON; otherwise `tags` is empty.
+struct GET_ALLOCATION_STATS : RESTRICTED {
+    static constexpr auto names() { return NAMES("get_allocation_stats"); }
+
+    struct request : EMPTY {};
+
+    struct tag {
+        std::string name;     // The subsystem; allocations outside of any count as "other".
+        int64_t live_bytes;   // Bytes allocated and not yet freed.
+        int64_t live_allocs;  // Allocations not yet freed.
+        uint64_t allocs;      // Allocations made since the wallet started.
+        uint64_t bytes;       // Bytes allocated since the wallet started.
+        double alloc_rate;    // Allocations per second since the previous call.
+        double byte_rate;     // Bytes allocated per second since the previous call.
+
+        KV_MAP_SERIALIZABLE
+    };
+
+    struct response {
+        bool compiled;          // True if allocation profiling is compiled into this wallet.
+        std::vector<tag> tags;  // The counts of each subsystem.
+
+        KV_MAP_SERIALIZABLE
+    };
+};
+
 OXEN_RPC_DOC_INTROSPECT
 // Stake for Service Node.
 struct STAKE : RESTRICTED {
@@ -2499,6 +2539,7 @@ using wallet_rpc_types = tools::type_list<
         SIGN_MULTISIG,
         SUBMIT_MULTISIG,
         GET_VERSION,
+        GET_ALLOCATION_STATS,
         STAKE,
         REGISTER_SERVICE_NODE,
         REQUEST_STAKE_UNLOCK,
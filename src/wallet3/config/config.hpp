@@ -39,6 +39,8 @@ struct DaemonCommsConfig {
                               // instead of system CA.  Requires an https:// address.
     bool ssl_allow_any_cert;  // Make HTTPS insecure: disable HTTPS certificate verification when
                               // using an https:// address.
+    int max_outstanding_block_requests = 4;  // How many block ranges to have requested from the
+                                             // daemon at once while syncing
 };
 
 namespace rpc {
@@ -16,6 +16,95 @@ static auto logcat = oxen::log::Cat("wallet");
 
 WalletDB::~WalletDB() {}
 
+// Added after the initial schema, so also created if missing from an existing database
+static constexpr auto SUBADDRESS_KEYS_SCHEMA = R"(
+          CREATE TABLE IF NOT EXISTS subaddress_keys (
+            spend_key BLOB NOT NULL PRIMARY KEY,
+            major_index INTEGER NOT NULL,
+            minor_index INTEGER NOT NULL
+          );
+        )";
+
+// Trigger-maintained summaries of the outputs that are available to spend (i.e. unspent and not
+// being spent): their total (in metadata 'available_balance'), their total per subaddress, and
+// their total by unlock height, so that the balances don't have to scan every output.  The partial
+// index gives the spendable outputs in amount order.  Added after the initial schema, so this
+// fills the summaries from the existing outputs when creating them.
+static constexpr auto BALANCE_VIEWS_SCHEMA = R"(
+          CREATE TABLE subaddress_balances (
+            major_index INTEGER NOT NULL,
+            minor_index INTEGER NOT NULL,
+            balance BIGINT NOT NULL,
+            PRIMARY KEY(major_index, minor_index)
+          );
+
+          CREATE TABLE unlock_buckets (
+            unlock_height INTEGER NOT NULL PRIMARY KEY,
+            amount BIGINT NOT NULL
+          );
+
+          CREATE INDEX spendable_outputs ON outputs(amount)
+            WHERE spent_height = 0 AND spending = FALSE;
+
+          INSERT INTO metadata(id, val_numeric)
+            SELECT 'available_balance', COALESCE(SUM(amount), 0) FROM outputs
+            WHERE spent_height = 0 AND spending = FALSE;
+          INSERT INTO subaddress_balances
+            SELECT subaddress_major, subaddress_minor, SUM(amount) FROM outputs
+            WHERE spent_height = 0 AND spending = FALSE
+            GROUP BY subaddress_major, subaddress_minor;
+          INSERT INTO unlock_buckets
+            SELECT block_height + unlock_time, SUM(amount) FROM outputs
+            WHERE spent_height = 0 AND spending = FALSE
+            GROUP BY block_height + unlock_time;
+
+          CREATE TRIGGER output_available AFTER INSERT ON outputs
+          FOR EACH ROW WHEN NEW.spent_height = 0 AND NOT NEW.spending
+          BEGIN
+            UPDATE metadata SET val_numeric = val_numeric + NEW.amount WHERE id = 'available_balance';
+            INSERT INTO subaddress_balances VALUES (NEW.subaddress_major, NEW.subaddress_minor, NEW.amount)
+              ON CONFLICT(major_index, minor_index) DO UPDATE SET balance = balance + excluded.balance;
+            INSERT INTO unlock_buckets VALUES (NEW.block_height + NEW.unlock_time, NEW.amount)
+              ON CONFLICT(unlock_height) DO UPDATE SET amount = amount + excluded.amount;
+          END;
+
+          CREATE TRIGGER output_made_available AFTER UPDATE OF spent_height, spending ON outputs
+          FOR EACH ROW WHEN (OLD.spent_height != 0 OR OLD.spending)
+            AND NEW.spent_height = 0 AND NOT NEW.spending
+          BEGIN
+            UPDATE metadata SET val_numeric = val_numeric + NEW.amount WHERE id = 'available_balance';
+            INSERT INTO subaddress_balances VALUES (NEW.subaddress_major, NEW.subaddress_minor, NEW.amount)
+              ON CONFLICT(major_index, minor_index) DO UPDATE SET balance = balance + excluded.balance;
+            INSERT INTO unlock_buckets VALUES (NEW.block_height + NEW.unlock_time, NEW.amount)
+              ON CONFLICT(unlock_height) DO UPDATE SET amount = amount + excluded.amount;
+          END;
+
+          CREATE TRIGGER output_made_unavailable AFTER UPDATE OF spent_height, spending ON outputs
+          FOR EACH ROW WHEN OLD.spent_height = 0 AND NOT OLD.spending
+            AND (NEW.spent_height != 0 OR NEW.spending)
+          BEGIN
+            UPDATE metadata SET val_numeric = val_numeric - OLD.amount WHERE id = 'available_balance';
+            UPDATE subaddress_balances SET balance = balance - OLD.amount
+              WHERE major_index = OLD.subaddress_major AND minor_index = OLD.subaddress_minor;
+            UPDATE unlock_buckets SET amount = amount - OLD.amount
+              WHERE unlock_height = OLD.block_height + OLD.unlock_time;
+            DELETE FROM unlock_buckets
+              WHERE unlock_height = OLD.block_height + OLD.unlock_time AND amount = 0;
+          END;
+
+          CREATE TRIGGER output_available_removed AFTER DELETE ON outputs
+          FOR EACH ROW WHEN OLD.spent_height = 0 AND NOT OLD.spending
+          BEGIN
+            UPDATE metadata SET val_numeric = val_numeric - OLD.amount WHERE id = 'available_balance';
+            UPDATE subaddress_balances SET balance = balance - OLD.amount
+              WHERE major_index = OLD.subaddress_major AND minor_index = OLD.subaddress_minor;
+            UPDATE unlock_buckets SET amount = amount - OLD.amount
+              WHERE unlock_height = OLD.block_height + OLD.unlock_time;
+            DELETE FROM unlock_buckets
+              WHERE unlock_height = OLD.block_height + OLD.unlock_time AND amount = 0;
+          END;
+        )";
+
 void WalletDB::create_schema(cryptonote::network_type nettype) {
     if (db.tableExists("outputs")) {
         if (auto stored_nettype = this->network_type(); stored_nettype != nettype) {
@@ -26,6 +115,12 @@ void WalletDB::create_schema(cryptonote::network_type nettype) {
             // TODO: log error as well
             throw oxen::traced<std::invalid_argument>(err);
         }
+        db.exec(SUBADDRESS_KEYS_SCHEMA);
+        if (!db.tableExists("unlock_buckets")) {
+            SQLite::Transaction db_tx(db);
+            db.exec(BALANCE_VIEWS_SCHEMA);
+            db_tx.commit();
+        }
         return;
     }
 
@@ -178,6 +273,8 @@ void WalletDB::create_schema(cryptonote::network_type nettype) {
           END;
 
         )");
+    db.exec(SUBADDRESS_KEYS_SCHEMA);
+    db.exec(BALANCE_VIEWS_SCHEMA);
 
     set_metadata_text("nettype", std::string(cryptonote::network_type_to_string(nettype)));
 
@@ -274,6 +371,34 @@ std::string WalletDB::get_address(int32_t major_index, int32_t minor_index) {
     return "";  // compilers can be dumb
 }
 
+void WalletDB::store_subaddress_keys(
+        const std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>& keys) {
+    if (keys.empty())
+        return;
+    SQLite::Transaction db_tx(db);
+    for (const auto& [key, index] : keys)
+        prepared_exec(
+                "INSERT OR REPLACE INTO subaddress_keys(spend_key, major_index, minor_index) "
+                "VALUES(?,?,?)",
+                db::blob_binder{tools::view_guts(key)},
+                static_cast<int64_t>(index.major),
+                static_cast<int64_t>(index.minor));
+    db_tx.commit();
+}
+
+std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>
+WalletDB::load_subaddress_keys() {
+    std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>> keys;
+    for (auto [key, major, minor] :
+         prepared_results<db::blob_guts<crypto::public_key>, int64_t, int64_t>(
+                 "SELECT spend_key, major_index, minor_index FROM subaddress_keys"))
+        keys.emplace_back(
+                key.value,
+                cryptonote::subaddress_index{
+                        static_cast<uint32_t>(major), static_cast<uint32_t>(minor)});
+    return keys;
+}
+
 void WalletDB::store_block(const Block& block) {
     int64_t output_count = 0;
     for (const auto& tx : block.transactions) {
@@ -380,22 +505,32 @@ int64_t WalletDB::overall_balance() {
 }
 
 int64_t WalletDB::unlocked_balance() {
+    // Everything available less what is still locked, which only has to look at the few unlock
+    // heights above the current one.
     return prepared_get<int64_t>(
-            "SELECT sum(o.amount) FROM outputs AS o WHERE o.spent_height = 0 AND o.spending = "
-            "false AND (o.block_height + o.unlock_time) <= (SELECT m.val_numeric FROM metadata as "
-            "m WHERE m.id = 'last_scan_height')");
+            "SELECT (SELECT val_numeric FROM metadata WHERE id = 'available_balance') - "
+            "COALESCE((SELECT sum(amount) FROM unlock_buckets WHERE unlock_height > "
+            "(SELECT val_numeric FROM metadata WHERE id = 'last_scan_height')), 0)");
 }
 
 int64_t WalletDB::available_balance(std::optional<int64_t> min_amount) {
-    std::string query =
-            "SELECT sum(amount) FROM outputs WHERE spent_height = 0 AND spending = FALSE";
+    if (!min_amount)
+        return get_metadata_int("available_balance");
 
-    if (min_amount) {
-        query += " AND amount > ?";
-        return prepared_get<int64_t>(query, *min_amount);
-    }
+    // Reads just the outputs above min_amount from the spendable_outputs index
+    return prepared_get<int64_t>(
+            "SELECT COALESCE(sum(amount), 0) FROM outputs "
+            "WHERE spent_height = 0 AND spending = FALSE AND amount > ?",
+            *min_amount);
+}
 
-    return prepared_get<int64_t>(query);
+int64_t WalletDB::subaddress_balance(const cryptonote::subaddress_index& index) {
+    return prepared_maybe_get<int64_t>(
+                   "SELECT balance FROM subaddress_balances "
+                   "WHERE major_index = ? AND minor_index = ?",
+                   index.major,
+                   index.minor)
+            .value_or(0);
 }
 
 std::vector<Output> WalletDB::available_outputs(std::optional<int64_t> min_amount) {
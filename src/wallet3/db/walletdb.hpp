@@ -55,6 +55,14 @@ class WalletDB : public db::Database {
 
     std::string get_address(int32_t major_index, int32_t minor_index);
 
+    // Saves derived subaddress spend public keys, so that the keyring doesn't have to derive its
+    // whole lookahead again every time the wallet is opened.
+    void store_subaddress_keys(
+            const std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>& keys);
+
+    std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>
+    load_subaddress_keys();
+
     void store_block(const Block& block);
 
     void pop_block();
@@ -89,6 +97,9 @@ class WalletDB : public db::Database {
     // TODO: subaddress specification
     int64_t available_balance(std::optional<int64_t> min_amount);
 
+    // Get the available balance of a single subaddress
+    int64_t subaddress_balance(const cryptonote::subaddress_index& index);
+
     // Selects all outputs with amount above an optional minimum amount.
     // TODO: subaddress specification
     std::vector<Output> available_outputs(std::optional<int64_t> min_amount);
@@ -1,8 +1,10 @@
 #include "default_daemon_comms.hpp"
 
 #include <common/string_util.h>
+#include <common/threadpool.h>
 #include <cryptonote_basic/cryptonote_format_utils.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include "block.hpp"
@@ -15,26 +17,32 @@
 namespace wallet {
 static auto logcat = oxen::log::Cat("wallet");
 
-void DefaultDaemonComms::on_get_blocks_response(std::vector<std::string> response) {
+DefaultDaemonComms::BlocksResponse DefaultDaemonComms::parse_get_blocks_response(
+        std::vector<std::string> response) {
+    BlocksResponse result;
     if (not response.size()) {
-        oxen::log::warning(logcat, "on_get_blocks_response(): empty get_blocks response");
-        return;
+        oxen::log::warning(logcat, "parse_get_blocks_response(): empty get_blocks response");
+        return result;
     }
+    for (const auto& part : response)
+        result.bytes += part.size();
 
     const auto& status = response[0];
     if (status != "OK" and status != "END") {
         oxen::log::warning(logcat, "get_blocks response: {}", response[0]);
-        return;
+        return result;
     }
 
     // "OK" response with no blocks may mean we requested blocks past the end of the chain
     // TODO: decide/confirm this behavior on the daemon side of things
     if (response.size() == 1) {
         oxen::log::warning(logcat, "get_blocks response.size() == 1");
-        return;
+        result.ok = true;
+        result.end = true;
+        return result;
     }
 
-    std::vector<Block> blocks;
+    auto& blocks = result.blocks;
     try {
         auto itr = response.cbegin();
         itr++;
@@ -45,88 +53,66 @@ void DefaultDaemonComms::on_get_blocks_response(std::vector<std::string> respons
             Block& b = blocks.emplace_back();
 
             if (block_dict.key() != "hash")
-                return;
+                return {};
             b.hash = tools::make_from_guts<crypto::hash>(block_dict.consume_string_view());
 
             if (block_dict.key() != "height")
-                return;
+                return {};
             b.height = block_dict.consume_integer<int64_t>();
 
             if (block_dict.key() != "timestamp")
-                return;
+                return {};
             b.timestamp = block_dict.consume_integer<int64_t>();
 
             if (block_dict.key() != "transactions")
-                return;
+                return {};
             auto txs_list = block_dict.consume_list_consumer();
 
             while (not txs_list.is_finished()) {
                 if (not txs_list.is_dict())
-                    return;
+                    return {};
 
                 BlockTX tx;
 
                 auto tx_dict = txs_list.consume_dict_consumer();
 
                 if (tx_dict.key() != "global_indices")
-                    return;
+                    return {};
                 tx.global_indices = tx_dict.consume_list<std::vector<int64_t>>();
 
                 if (tx_dict.key() != "hash")
-                    return;
+                    return {};
                 tx.hash = tools::make_from_guts<crypto::hash>(tx_dict.consume_string_view());
 
                 if (tx_dict.key() != "tx")
-                    return;
+                    return {};
 
                 tx.tx = wallet25::tx_from_blob(tx_dict.consume_string_view());
 
                 if (not tx_dict.is_finished())
-                    return;
+                    return {};
 
-                b.transactions.push_back(tx);
+                b.transactions.push_back(std::move(tx));
             }
 
             if (not block_dict.is_finished())
-                return;
+                return {};
 
             itr++;
         }
     } catch (const std::exception& e) {
         oxen::log::warning(logcat, "exception thrown: {}", e.what());
-        return;
+        return {};
     }
 
     if (blocks.size() == 0) {
         oxen::log::warning(logcat, "received no blocks, but server said response OK");
-        return;
+        return {};
     }
 
-    int64_t start_height = blocks.front().height;
-    int64_t end_height = blocks.back().height;
-
-    omq->job(
-            [blocks = std::move(blocks), this]() {
-                for_each_wallet(
-                        [&](std::shared_ptr<Wallet> wallet) { wallet->add_blocks(blocks); });
-            },
-            sync_thread);
-
-    if (status == "END") {
-        omq->job(
-                [this, old = this->sync_from_height, start_height, end_height]() {
-                    // if a new wallet hasn't been added requesting to sync from lower,
-                    // we should be done syncing all wallets
-                    if (old <= this->sync_from_height)
-                        syncing = false;
-                    got_blocks(start_height, end_height);
-                },
-                sync_thread);
-    } else {
-        omq->job(
-                [this, start_height, end_height]() { got_blocks(start_height, end_height); },
-                sync_thread);
-    }
+    result.ok = true;
+    result.end = status == "END";
+    return result;
 }
 
 void DefaultDaemonComms::request_top_block_info() {
@@ -235,7 +221,10 @@ void DefaultDaemonComms::request_top_block_info() {
 }
 
 DefaultDaemonComms::DefaultDaemonComms(std::shared_ptr<oxenmq::OxenMQ> omq, DaemonCommsConfig cfg) :
-        omq(omq), config(cfg), sync_thread(omq->add_tagged_thread("sync")) {
+        omq(omq),
+        config(cfg),
+        sync_thread(omq->add_tagged_thread("sync")),
+        max_outstanding_requests{std::max(1, cfg.max_outstanding_block_requests)} {
     omq->MAX_MSG_SIZE = max_response_size;
 }
 
@@ -269,37 +258,58 @@ void DefaultDaemonComms::propogate_config() {
     set_remote(config.address);
 }
 
-void DefaultDaemonComms::get_blocks() {
-    auto req_cb = [this](bool ok, std::vector<std::string> response) {
-        if (not ok or response.size() == 0) {
-            // TODO: error logging/handling
-
-            // Retry after a delay to not spam/spin
-            auto timer = std::make_shared<oxenmq::TimerID>();
-            auto& timer_ref = *timer;
-            omq->add_timer(
-                    timer_ref,
-                    [this, timer = std::move(timer)] {
-                        omq->cancel_timer(*timer);
-                        get_blocks();
-                    },
-                    500ms,
-                    true,
-                    sync_thread);
-            return;
-        }
-
-        on_get_blocks_response(response);
+void DefaultDaemonComms::request_blocks(
+        uint64_t generation, int64_t start_height, int64_t count) {
+    auto req_cb = [this, generation, start_height, count](
+                          bool ok, std::vector<std::string> response) {
+        // Parse here, on the worker thread, so that it overlaps with the sync thread scanning
+        // earlier ranges.
+        BlocksResponse result;
+        if (ok and response.size() > 0)
+            result = parse_get_blocks_response(std::move(response));
+        omq->job(
+                [this, generation, start_height, count, result = std::move(result)]() mutable {
+                    got_blocks(generation, start_height, count, std::move(result));
+                },
+                sync_thread);
     };
 
     std::map<std::string, int64_t> req_params_dict{
-            {"max_count", max_sync_blocks},
+            {"max_count", count},
             {"size_limit", max_response_size},
-            {"start_height", sync_from_height}};
+            {"start_height", start_height}};
 
+    oxen::log::debug(logcat, "requesting {} blocks from height {}", count, start_height);
     omq->request(conn, "rpc.get_blocks", req_cb, oxenc::bt_serialize(req_params_dict));
 }
 
+void DefaultDaemonComms::fill_pipeline() {
+    if (not syncing)
+        return;
+
+    while (not reached_end and
+           in_flight + static_cast<int>(pending_blocks.size()) < max_outstanding_requests) {
+        // Until we know the chain height only ask for one range at a time
+        if (top_block_height == 0 ? next_request_height != sync_from_height
+                                  : next_request_height > top_block_height)
+            break;
+        request_blocks(sync_generation, next_request_height, blocks_per_request);
+        next_request_height += blocks_per_request;
+        in_flight++;
+    }
+
+    if (in_flight == 0 and pending_blocks.empty())
+        syncing = false;
+}
+
+void DefaultDaemonComms::restart_pipeline() {
+    sync_generation++;
+    in_flight = 0;
+    pending_blocks.clear();
+    reached_end = false;
+    next_request_height = sync_from_height;
+}
+
 std::future<std::vector<Decoy>> DefaultDaemonComms::fetch_decoys(
         const std::vector<int64_t>& indexes, bool with_txid) {
     auto p = std::make_shared<std::promise<std::vector<Decoy>>>();
@@ -492,10 +502,13 @@ void DefaultDaemonComms::register_wallet(
                     wallets.emplace(w, height);
 
                 if (check_sync_height) {
+                    auto old_height = sync_from_height;
                     if (wallets.size() == 1)  // if it's the only wallet
                         sync_from_height = height;
                     else
                         sync_from_height = std::min(sync_from_height, height);
+                    if (sync_from_height != old_height)
+                        restart_pipeline();
                 }
                 start_syncing();
             },
@@ -533,6 +546,7 @@ void DefaultDaemonComms::deregister_wallet(wallet::Wallet& wallet, std::promise<
                         logcat,
                         "deregister_wallet() setting sync_from_height to {}",
                         sync_from_height);
+                restart_pipeline();
                 if (sync_from_height != 0 and sync_from_height == top_block_height)
                     syncing = false;
             },
@@ -545,22 +559,120 @@ void DefaultDaemonComms::for_each_wallet(std::function<void(std::shared_ptr<Wall
     }
 }
 
-void DefaultDaemonComms::got_blocks(int64_t start_height, int64_t end_height) {
-    if (start_height == sync_from_height)
-        sync_from_height = end_height + 1;
+void DefaultDaemonComms::got_blocks(
+        uint64_t generation, int64_t start_height, int64_t count, BlocksResponse response) {
+    // Left over from before the pipeline was restarted
+    if (generation != sync_generation)
+        return;
 
-    // if we get caught up, or all wallets are removed, no need to request more blocks
-    if (not syncing)
+    // The daemon refuses requests that start past the top of its chain (e.g. if it popped
+    // blocks since we last asked for its height), so there is nothing there to retry for.
+    if (not response.ok and top_block_height > 0 and start_height > top_block_height) {
+        response.ok = true;
+        response.end = true;
+    }
+
+    if (not response.ok) {
+        // TODO: error logging/handling
+
+        // Retry after a delay to not spam/spin; the range stays counted as in flight meanwhile
+        auto timer = std::make_shared<oxenmq::TimerID>();
+        auto& timer_ref = *timer;
+        omq->add_timer(
+                timer_ref,
+                [this, timer = std::move(timer), generation, start_height, count] {
+                    omq->cancel_timer(*timer);
+                    if (generation == sync_generation)
+                        request_blocks(generation, start_height, count);
+                },
+                500ms,
+                true,
+                sync_thread);
+        return;
+    }
+
+    in_flight--;
+
+    if (auto n = response.blocks.size()) {
+        // Size later requests from a running average of the block size so that a response comes
+        // close to, but not over, the response size limit.
+        double bytes_per_block = static_cast<double>(response.bytes) / n;
+        avg_block_bytes = avg_block_bytes == 0 ? bytes_per_block
+                                               : 0.75 * avg_block_bytes + 0.25 * bytes_per_block;
+        blocks_per_request = std::clamp<int64_t>(
+                static_cast<int64_t>(0.8 * max_response_size / avg_block_bytes),
+                1,
+                max_sync_blocks);
+
+        // The daemon stops early if the blocks would exceed the size limit, in which case we
+        // still need the rest of the range.
+        int64_t end_height = response.blocks.back().height;
+        if (not response.end and end_height + 1 < start_height + count) {
+            request_blocks(generation, end_height + 1, start_height + count - (end_height + 1));
+            in_flight++;
+        }
+    }
+
+    if (response.end) {
+        reached_end = true;
+        // Anything requested past here can only come back empty
+        next_request_height = start_height + response.blocks.size();
+    }
+
+    pending_blocks.emplace(start_height, PendingBlocks{response.end, std::move(response.blocks)});
+    apply_pending_blocks();
+    fill_pipeline();
+}
+
+void DefaultDaemonComms::apply_pending_blocks() {
+    while (not pending_blocks.empty() and pending_blocks.begin()->first == sync_from_height) {
+        auto node = pending_blocks.extract(pending_blocks.begin());
+        auto& [end, blocks] = node.mapped();
+
+        if (not blocks.empty()) {
+            add_blocks_to_wallets(blocks);
+            sync_from_height = blocks.back().height + 1;
+        }
+
+        if (end or blocks.empty()) {
+            // Caught up with the daemon; anything still pending or outstanding is beyond the end
+            // of the chain.  Syncing picks up again when request_top_block_info sees a new block.
+            restart_pipeline();
+            syncing = false;
+            return;
+        }
+    }
+}
+
+void DefaultDaemonComms::add_blocks_to_wallets(const std::vector<Block>& blocks) {
+    if (wallets.size() == 1) {
+        wallets.begin()->first->add_blocks(blocks);
         return;
+    }
 
-    get_blocks();
+    // Each wallet has its own keys and database, so they can all scan at once.  (A wallet's own
+    // per-transaction scanning then runs inline within its task.)
+    auto& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    for (const auto& [wallet, height] : wallets) {
+        tpool.submit(&waiter, [&blocks, wallet = wallet] {
+            try {
+                wallet->add_blocks(blocks);
+            } catch (const std::exception& e) {
+                oxen::log::error(logcat, "Failed to add blocks to wallet: {}", e.what());
+            }
+        });
+    }
+    waiter.wait(&tpool);
 }
 
 void DefaultDaemonComms::start_syncing() {
     if ((not syncing and sync_from_height <= top_block_height) or (top_block_height == 0)) {
+        if (not syncing)
+            restart_pipeline();
         syncing = true;
         oxen::log::debug(logcat, "Start Syncing");
-        get_blocks();
+        fill_pipeline();
     }
 }
 
@@ -4,16 +4,16 @@
 #include <oxenmq/oxenmq.h>
 
 #include <list>
+#include <map>
 #include <memory>
 
+#include "block.hpp"
 #include "config/config.hpp"
 #include "cryptonote_config.h"
 #include "daemon_comms.hpp"
 
 namespace wallet {
 struct Wallet;
-struct Block;
-struct BlockTX;
 
 class DefaultDaemonComms : public DaemonComms,
                            public std::enable_shared_from_this<DefaultDaemonComms> {
@@ -21,7 +21,21 @@ class DefaultDaemonComms : public DaemonComms,
     static constexpr int64_t DEFAULT_MAX_RESPONSE_SIZE = 1 * 1024 * 1024;  // 1 MiB
     static constexpr int64_t DEFAULT_MAX_SYNC_BLOCKS = 200;
 
-    void on_get_blocks_response(std::vector<std::string> response);
+    // Result of one rpc.get_blocks request, as handed from the reply callback to the sync thread.
+    struct BlocksResponse {
+        bool ok = false;   // false if the request failed or the response was bad (retry it)
+        bool end = false;  // the daemon says this range reached the end of the chain
+        size_t bytes = 0;  // total size of the response, for sizing later requests
+        std::vector<Block> blocks;
+    };
+
+    // A range received out of order, waiting for the ranges before it to arrive
+    struct PendingBlocks {
+        bool end;
+        std::vector<Block> blocks;
+    };
+
+    static BlocksResponse parse_get_blocks_response(std::vector<std::string> response);
 
     void request_top_block_info();
 
@@ -52,9 +66,25 @@ class DefaultDaemonComms : public DaemonComms,
   private:
     void for_each_wallet(std::function<void(std::shared_ptr<Wallet>)> func);
 
-    void get_blocks();
+    // Requests `count` blocks starting at `start_height` as part of sync pipeline `generation`.
+    void request_blocks(uint64_t generation, int64_t start_height, int64_t count);
+
+    // Sends new block range requests until the pipeline is full or we have requested up to the
+    // top of the chain.
+    void fill_pipeline();
+
+    // Drops all outstanding and pending block ranges and restarts fetching at sync_from_height;
+    // used when a wallet needs blocks from somewhere else.
+    void restart_pipeline();
 
-    void got_blocks(int64_t start_height, int64_t end_height);
+    void got_blocks(
+            uint64_t generation, int64_t start_height, int64_t count, BlocksResponse response);
+
+    // Hands any pending ranges that now directly follow what has been applied to the wallets.
+    void apply_pending_blocks();
+
+    // Gives blocks to all registered wallets, scanning for the different wallets in parallel.
+    void add_blocks_to_wallets(const std::vector<Block>& blocks);
 
     void start_syncing();
 
@@ -76,6 +106,22 @@ class DefaultDaemonComms : public DaemonComms,
     bool syncing = false;
     int64_t max_sync_blocks = DEFAULT_MAX_SYNC_BLOCKS;
 
+    // Sync pipeline state; only touched from sync_thread.  Block ranges are requested ahead of
+    // sync_from_height (up to next_request_height) so that fetching overlaps with scanning, and
+    // are applied to the wallets strictly in order.  Responses from a pipeline that has since
+    // been restarted are recognized by their generation and dropped.
+    uint64_t sync_generation = 0;
+    int64_t next_request_height = 0;
+    int in_flight = 0;
+    int max_outstanding_requests;
+    std::map<int64_t, PendingBlocks> pending_blocks;
+    bool reached_end = false;
+
+    // Blocks to ask for per request, adapted from the average block size seen so far so that
+    // responses stay under max_response_size.
+    int64_t blocks_per_request = DEFAULT_MAX_SYNC_BLOCKS;
+    double avg_block_bytes = 0;
+
     int64_t fee_per_byte = cryptonote::FEE_PER_BYTE_V13;
     int64_t fee_per_output = cryptonote::FEE_PER_OUTPUT_V18;
 };
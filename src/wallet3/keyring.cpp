@@ -8,6 +8,7 @@
 #include <cryptonote_basic/txtypes.h>
 #include <cryptonote_core/cryptonote_tx_utils.h>
 
+#include <algorithm>
 #include <device/device.hpp>
 #include <stdexcept>
 
@@ -42,15 +43,15 @@ crypto::public_key Keyring::secret_tx_key_to_public_tx_key(const crypto::secret_
 
 // Derivation Key = View Private Key * Transaction Pubkey = bR
 crypto::key_derivation Keyring::generate_key_derivation(const crypto::public_key& tx_pubkey) const {
-    return crypto::generate_key_derivation(tx_pubkey, view_private_key);
+    crypto::key_derivation d;
+    crypto::generate_key_derivation(tx_pubkey, view_derivation_key, d);
+    return d;
 }
 
 std::vector<crypto::key_derivation> Keyring::generate_key_derivations(
         const std::vector<crypto::public_key>& tx_pubkeys) const {
     std::vector<crypto::key_derivation> derivations;
-    for (const auto& key : tx_pubkeys) {
-        derivations.push_back(generate_key_derivation(key));
-    }
+    crypto::generate_key_derivations(tx_pubkeys, view_derivation_key, derivations);
     return derivations;
 }
 
@@ -110,6 +111,12 @@ std::pair<uint64_t, rct::key> Keyring::output_amount_and_mask(
     return {amount, std::move(mask)};
 }
 
+std::vector<std::pair<uint64_t, rct::key>> Keyring::output_amounts_and_masks(
+        const rct::rctSig& rv,
+        const std::vector<std::pair<crypto::key_derivation, unsigned int>>& outputs) {
+    return wallet25::output_amounts(rv, outputs, key_device);
+}
+
 // This gets called for every output in the transaction, there is some complication for how the
 // key gets generated for change address because the derivation is a*R or some simpler calc i guess
 // set the bool for this_dst_is_change_addr to false and optional null for the actual thingo
@@ -443,13 +450,37 @@ std::vector<crypto::public_key> Keyring::get_subaddress_spend_public_keys(
     return pkeys;
 }
 
-void Keyring::expand_subaddresses(const cryptonote::subaddress_index& lookahead) {
+std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>
+Keyring::expand_subaddresses(const cryptonote::subaddress_index& lookahead) {
+    std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>> added;
+    if (subaddress_minor_counts.size() < lookahead.major)
+        subaddress_minor_counts.resize(lookahead.major, 0);
     for (uint32_t i = 0; i < lookahead.major; i++) {
+        auto& have = subaddress_minor_counts[i];
+        if (have >= lookahead.minor)
+            continue;
         const std::vector<crypto::public_key> pkeys =
-                get_subaddress_spend_public_keys(i, 0, lookahead.minor);
-        for (uint32_t j = 0; j < lookahead.minor; j++) {
-            subaddresses[pkeys[j]] = {i, j};
+                get_subaddress_spend_public_keys(i, have, lookahead.minor - 1);
+        subaddresses.reserve(subaddresses.size() + pkeys.size());
+        for (uint32_t j = have; j < lookahead.minor; j++) {
+            const cryptonote::subaddress_index index{i, j};
+            subaddresses[pkeys[j - have]] = index;
+            added.emplace_back(pkeys[j - have], index);
         }
+        have = lookahead.minor;
+    }
+    return added;
+}
+
+void Keyring::load_subaddresses(
+        const std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>& subaddrs) {
+    subaddresses.reserve(subaddresses.size() + subaddrs.size());
+    for (const auto& [key, index] : subaddrs) {
+        subaddresses[key] = index;
+        if (subaddress_minor_counts.size() <= index.major)
+            subaddress_minor_counts.resize(index.major + 1, 0);
+        auto& have = subaddress_minor_counts[index.major];
+        have = std::max(have, index.minor + 1);
     }
 }
 
@@ -24,7 +24,8 @@ class Keyring : public WalletKeys {
             spend_public_key(_spend_public_key),
             view_private_key(_view_private_key),
             view_public_key(_view_public_key),
-            nettype(_nettype) {}
+            nettype(_nettype),
+            view_derivation_key(crypto::precompute_derivation_key(_view_private_key)) {}
 
     Keyring(std::string _spend_private_key,
             std::string _spend_public_key,
@@ -36,6 +37,7 @@ class Keyring : public WalletKeys {
         tools::load_from_hex_guts<crypto::public_key>(_spend_public_key, spend_public_key);
         tools::load_from_hex_guts<crypto::secret_key>(_view_private_key, view_private_key);
         tools::load_from_hex_guts<crypto::public_key>(_view_public_key, view_public_key);
+        view_derivation_key = crypto::precompute_derivation_key(view_private_key);
     }
 
     Keyring() {}
@@ -80,6 +82,12 @@ class Keyring : public WalletKeys {
     virtual std::pair<uint64_t, rct::key> output_amount_and_mask(
             const rct::rctSig& rv, const crypto::key_derivation& derivation, unsigned int i);
 
+    // output_amount_and_mask for several outputs of one transaction, given as derivation and
+    // output index pairs; the commitments are checked together, which is cheaper.
+    virtual std::vector<std::pair<uint64_t, rct::key>> output_amounts_and_masks(
+            const rct::rctSig& rv,
+            const std::vector<std::pair<crypto::key_derivation, unsigned int>>& outputs);
+
     virtual crypto::public_key generate_output_ephemeral_keys(
             const crypto::secret_key& tx_key,
             const cryptonote::tx_destination_entry& dst_entr,
@@ -104,7 +112,16 @@ class Keyring : public WalletKeys {
     virtual std::vector<crypto::public_key> get_subaddress_spend_public_keys(
             uint32_t account, uint32_t begin, uint32_t end);
 
-    virtual void expand_subaddresses(const cryptonote::subaddress_index& lookahead);
+    // Derives the spend public keys for subaddresses (0..lookahead.major-1, 0..lookahead.minor-1)
+    // that we don't already have, and returns the newly added ones so that they can be saved.
+    virtual std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>
+    expand_subaddresses(const cryptonote::subaddress_index& lookahead);
+
+    // Adds subaddress spend public keys derived by an earlier expand_subaddresses call, so that
+    // they don't have to be derived again.
+    virtual void load_subaddresses(
+            const std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>>&
+                    subaddrs);
 
     virtual cryptonote::account_keys export_keys();
 
@@ -131,8 +148,11 @@ class Keyring : public WalletKeys {
 
   private:
     hw::core::device_default key_device;
-    // TODO persist the subaddresses list to the database
+    // view_private_key, prepared for the key derivations done while scanning
+    crypto::precomputed_derivation_key view_derivation_key;
     std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    // How many minor indices (always starting from 0) we have keys for, by major index
+    std::vector<uint32_t> subaddress_minor_counts;
 };
 
 }  // namespace wallet
@@ -1,92 +1,116 @@
 #include "output_selection.hpp"
 
-namespace wallet {
-std::vector<Output> OutputSelector::operator()(
-        const std::vector<Output>& available_outputs, int64_t amount) const {
-    // Check that we actually have enough in the outputs to build this transaction. Fail early
-    int64_t wallet_balance = std::accumulate(
-            available_outputs.begin(),
-            available_outputs.end(),
-            int64_t{0},
-            [](const int64_t& accumulator, const auto& x) { return accumulator + x.amount; });
-    int64_t fee = 0;
-    auto pos = fee_map.find(1);
-    if (pos == fee_map.end()) {
-        throw std::runtime_error("Missing fee amount");
-    } else {
-        fee = pos->second;
-    }
-    if (wallet_balance < amount + fee) {
-        throw std::runtime_error("Insufficient Wallet Balance");
-    }
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
 
-    // Prefer a single output if suitable
-    std::vector<Output> outputs_bigger_than_amount{};
-    std::copy_if(
-            available_outputs.begin(),
-            available_outputs.end(),
-            std::back_inserter(outputs_bigger_than_amount),
-            [amount, fee](const auto& x) { return static_cast<int64_t>(x.amount) > amount + fee; });
+namespace wallet {
 
-    if (outputs_bigger_than_amount.size() > 0) {
-        std::random_device rd;
-        std::default_random_engine rng(rd());
-        auto start = outputs_bigger_than_amount.begin();
-        std::uniform_int_distribution<> dis(
-                0, std::distance(start, outputs_bigger_than_amount.end()) - 1);
-        std::advance(start, dis(rng));
-        std::vector<Output> single_output(start, start + 1);
-        return single_output;
-    }
+int64_t OutputSelector::fee(size_t input_count) const {
+    auto pos = fee_map.find(input_count);
+    if (pos == fee_map.end())
+        throw std::runtime_error("Missing fee amount");
+    return pos->second;
+}
 
-    // Else select some random outputs according to gamma distribution
-    std::vector<double> scores;
-    scores.reserve(available_outputs.size());
-    std::random_device rd;
-    std::default_random_engine rng(rd());
-    auto output_cmp = [](const Output& lhs, const Output& rhs) {
-        return lhs.block_height < rhs.block_height;
+std::vector<Output> OutputSelector::operator()(
+        const std::vector<Output>& available_outputs, int64_t amount) const {
+    // Indices of the outputs by increasing amount (which is the order the db gives them in, but
+    // don't rely on that).
+    std::vector<size_t> by_amount(available_outputs.size());
+    std::iota(by_amount.begin(), by_amount.end(), 0);
+    auto amount_less = [&](size_t a, size_t b) {
+        return available_outputs[a].amount < available_outputs[b].amount;
     };
+    if (!std::is_sorted(by_amount.begin(), by_amount.end(), amount_less))
+        std::sort(by_amount.begin(), by_amount.end(), amount_less);
 
-    int64_t min_output_height =
-            std::min_element(available_outputs.begin(), available_outputs.end(), output_cmp)
-                    ->block_height;
-    int64_t max_output_height =
-            std::max_element(available_outputs.begin(), available_outputs.end(), output_cmp)
-                    ->block_height;
-    std::gamma_distribution<double> distribution(min_output_height, max_output_height);
+    // Prefer a single output if suitable: the smallest one that covers everything
+    const int64_t single_target = amount + fee(1);
+    auto single = std::upper_bound(
+            by_amount.begin(), by_amount.end(), single_target, [&](int64_t target, size_t i) {
+                return target < available_outputs[i].amount;
+            });
+    if (single != by_amount.end())
+        return {available_outputs[*single]};
 
-    // Build a distribution and apply a score to each element of available outputs depending
-    // on distance from the number chosen. Lower score is better.
-    const int nrolls = 1000;  // number of experiments
-    for (size_t i = 0; i < nrolls; ++i) {
-        double number = distribution(rng);
-        for (size_t j = 0; j < available_outputs.size(); ++j) {
-            scores[j] += std::abs(number - available_outputs[j].block_height);
+    // Otherwise we need several: work with the amounts largest first, with prefix sums so that the
+    // sum of any run of them is O(1).
+    const size_t n = by_amount.size();
+    std::vector<int64_t> amounts(n);
+    for (size_t i = 0; i < n; i++)
+        amounts[i] = available_outputs[by_amount[n - 1 - i]].amount;
+    std::vector<int64_t> prefix(n + 1, 0);
+    std::partial_sum(amounts.begin(), amounts.end(), prefix.begin() + 1);
+    auto sum = [&](size_t begin, size_t end) { return prefix[end] - prefix[begin]; };
+
+    // As the k largest outputs are the k with the biggest total, taking the largest ones until they
+    // cover the amount and the fee for that many inputs gives the fewest inputs (and so the
+    // lowest fee) we can manage.
+    size_t count = 0;
+    int64_t target = 0;
+    for (size_t k = 2; k <= n && !count; k++) {
+        if (fee_map.count(k) == 0)
+            break;
+        if (sum(0, k) >= amount + fee(k)) {
+            count = k;
+            target = amount + fee(k);
         }
     }
+    if (!count)
+        throw std::runtime_error("Insufficient Wallet Balance");
 
-    // Build a list of indexes based on score
-    std::vector<int> indices(available_outputs.size());
-    std::iota(indices.begin(), indices.end(), 0);
-    std::sort(indices.begin(), indices.end(), [&](int A, int B) -> bool {
-        return scores[A] < scores[B];
-    });
-
-    // Iterate through the list until we have sufficient return value
-    std::vector<Output> multiple_outputs{};
-    int i = 0;
-    while (amount + fee > 0) {
-        auto pos = fee_map.find(i + 1);
-        if (pos == fee_map.end()) {
-            throw std::runtime_error("Missing fee amount");
-        } else {
-            fee = pos->second;
+    // Then look for the `count` outputs that cover the target with the least left over, so that
+    // we don't tie up more than we have to in change.  This is a depth-first branch and bound over
+    // the amounts (largest first), bounded in the work it does, starting from the largest outputs
+    // as the best known selection.
+    std::vector<size_t> best(count), chosen;
+    std::iota(best.begin(), best.end(), 0);
+    int64_t best_excess = sum(0, count) - target;
+    chosen.reserve(count);
+    size_t steps = 0;
+    auto search = [&](auto& self, size_t from, int64_t total) -> void {
+        if (best_excess == 0 || ++steps > MAX_SEARCH_STEPS)
+            return;
+        const size_t need = count - chosen.size();
+        if (need == 1) {
+            // The best last output is the smallest one (i.e. the last, going largest first) that
+            // still reaches the target.
+            auto it = std::upper_bound(
+                    amounts.begin() + from,
+                    amounts.end(),
+                    target - total,
+                    std::greater<int64_t>{});
+            if (it == amounts.begin() + from)
+                return;
+            auto last = static_cast<size_t>(it - amounts.begin()) - 1;
+            if (int64_t excess = total + amounts[last] - target; excess < best_excess) {
+                best = chosen;
+                best.push_back(last);
+                best_excess = excess;
+            }
+            return;
         }
-        multiple_outputs.push_back(available_outputs[indices[i]]);
-        amount = amount - available_outputs[indices[i]].amount;
-        i++;
-    }
-    return multiple_outputs;
+        for (size_t i = from; i + need <= n; i++) {
+            // Even the largest outputs from here can't reach the target, and it only gets worse
+            if (total + sum(i, i + need) < target)
+                return;
+            // Even the smallest outputs from here leave more over than the best we have
+            if (total + sum(n - need, n) - target >= best_excess)
+                return;
+            chosen.push_back(i);
+            self(self, i + 1, total + amounts[i]);
+            chosen.pop_back();
+            if (best_excess == 0 || steps > MAX_SEARCH_STEPS)
+                return;
+        }
+    };
+    search(search, 0, 0);
+
+    std::vector<Output> selected;
+    selected.reserve(count);
+    for (auto i : best)
+        selected.push_back(available_outputs[by_amount[n - 1 - i]]);
+    return selected;
 }
 }  // namespace wallet
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <map>
 #include <vector>
 
 #include "../output.hpp"
@@ -8,17 +10,29 @@ namespace wallet {
 // OutputSelector will choose some a subset of outputs from the provided list of outputs according
 // to the output selection algorithm. The sum of the amounts in the returned outputs will be
 // greater than the amount passed as the second parameter.
+//
+// A single output is used when one covers the amount (and its fee) by itself, taking the smallest
+// such output.  Otherwise the fewest outputs that can cover the amount plus the fee for that many
+// inputs are chosen, preferring (within a bounded search) the combination leaving the least change.
+// Throws if no number of inputs that we have a fee for can cover it.
 
 class OutputSelector {
   public:
     std::vector<Output> operator()(
             const std::vector<Output>& available_outputs, int64_t amount) const;
 
+    // The most partial selections the multiple output search will consider before settling for the
+    // best it has found so far.
+    static constexpr size_t MAX_SEARCH_STEPS = 100'000;
+
     void push_fee(int64_t input_count, int64_t fee) { fee_map[input_count] = fee; };
 
     void clear_fees() { fee_map.clear(); };
 
   private:
+    // Returns the fee for `input_count` inputs, throwing if it hasn't been provided
+    int64_t fee(size_t input_count) const;
+
     // Keeps track of the fees that need to be paid on top of the amount passed in
     // key represents the number of outputs and value represents the fee that needs
     // to be included if that many outputs are chosen
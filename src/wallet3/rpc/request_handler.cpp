@@ -76,6 +76,9 @@ const std::unordered_map<std::string, std::shared_ptr<const rpc_command>> rpc_co
 
 void RequestHandler::invoke(GET_BALANCE& command, rpc_context context) {
     if (auto w = wallet.lock()) {
+        // Read-only queries go through a snapshot so that they don't wait behind sync's writes
+        // (and so that both balances are as of the same block).
+        auto snapshot = w->db->read_snapshot();
         command.response["balance"] = w->get_balance();
         command.response["unlocked_balance"] = w->get_unlocked_balance();
     }
@@ -133,6 +136,7 @@ void RequestHandler::invoke(SET_ACCOUNT_TAG_DESCRIPTION& command, rpc_context co
 
 void RequestHandler::invoke(GET_HEIGHT& command, rpc_context context) {
     if (auto w = wallet.lock()) {
+        auto snapshot = w->db->read_snapshot();
         const auto immutable_height = w->db->scan_target_height();
         const auto height = w->db->current_height();
 
@@ -1,8 +1,12 @@
 #include "transaction_constructor.hpp"
 
+#include <common/format.h>
 #include <cryptonote_basic/hardfork.h>
 #include <oxenc/base64.h>
 
+#include <algorithm>
+#include <iterator>
+
 #include "db/walletdb.hpp"
 #include "decoy.hpp"
 #include "decoy_selection/decoy_selection.hpp"
@@ -234,25 +238,66 @@ void TransactionConstructor::select_inputs(PendingTransaction& ptx) const {
 // details necessary for a ring signature from the daemon and add them to the
 // transaction ready to sign at a later point in time.
 void TransactionConstructor::select_and_fetch_decoys(PendingTransaction& ptx) {
-    ptx.decoys = {};
-    // This initialises the decoys to be selected from global_output_index= 0 to global_output_index
-    // = highest_output_index
-    int64_t max_output_index = db->chain_output_count();
-    // DecoySelector decoy_selection(0, max_output_index);
+    select_and_fetch_decoys(std::vector<PendingTransaction*>{&ptx});
+}
+
+// Batched version of the above: the decoys for every input of every given transaction are
+// requested from the daemon together (in as few requests as the daemon's per-request limit
+// allows, all sent before waiting on any), rather than one round trip per input.
+void TransactionConstructor::select_and_fetch_decoys(const std::vector<PendingTransaction*>& ptxs) {
+    // Decoys are picked from global_output_index = 0 to the highest output index, which we know
+    // from the per-block output counts kept as we scan.
+    if (int64_t output_count = db->chain_output_count(); output_count > 0)
+        decoy_selector->max_output_index = output_count - 1;
     DecoySelector& decoy_selection = *decoy_selector;
+
     std::vector<int64_t> indexes;
-    for (const auto& output : ptx.chosen_outputs) {
-        indexes = decoy_selection(output);
-        auto decoy_future = daemon->fetch_decoys(indexes);
-        decoy_future.wait();
-        ptx.decoys.emplace_back(decoy_future.get());
-
-        bool good = false;
-        for (const auto& decoy : ptx.decoys.back())
-            good |= (output.key == decoy.key);
-        if (!good)
-            throw std::runtime_error{
-                    "Key from daemon for real output does not match our stored key."};
+    std::vector<size_t> ring_sizes;
+    for (auto* ptx : ptxs) {
+        ptx->decoys = {};
+        for (const auto& output : ptx->chosen_outputs) {
+            auto ring = decoy_selection(output);
+            ring_sizes.push_back(ring.size());
+            indexes.insert(indexes.end(), ring.begin(), ring.end());
+        }
+    }
+
+    std::vector<std::future<std::vector<Decoy>>> decoy_futures;
+    for (size_t i = 0; i < indexes.size(); i += MAX_DECOYS_PER_REQUEST) {
+        auto chunk_end = indexes.begin() + std::min(indexes.size(), i + MAX_DECOYS_PER_REQUEST);
+        decoy_futures.push_back(
+                daemon->fetch_decoys(std::vector<int64_t>{indexes.begin() + i, chunk_end}));
+    }
+    std::vector<Decoy> decoys;
+    decoys.reserve(indexes.size());
+    for (auto& decoy_future : decoy_futures) {
+        auto chunk = decoy_future.get();
+        decoys.insert(
+                decoys.end(),
+                std::make_move_iterator(chunk.begin()),
+                std::make_move_iterator(chunk.end()));
+    }
+    if (decoys.size() != indexes.size())
+        throw std::runtime_error{
+                "Daemon returned {} decoys, but {} were requested"_format(
+                        decoys.size(), indexes.size())};
+
+    auto next_decoy = decoys.begin();
+    auto ring_size = ring_sizes.begin();
+    for (auto* ptx : ptxs) {
+        for (const auto& output : ptx->chosen_outputs) {
+            auto& ring = ptx->decoys.emplace_back(
+                    std::make_move_iterator(next_decoy),
+                    std::make_move_iterator(next_decoy + *ring_size));
+            next_decoy += *ring_size++;
+
+            bool good = false;
+            for (const auto& decoy : ring)
+                good |= (output.key == decoy.key);
+            if (!good)
+                throw std::runtime_error{
+                        "Key from daemon for real output does not match our stored key."};
+        }
     }
 }
 
@@ -30,10 +30,8 @@ class TransactionConstructor {
         // transactions in each block so we can recreate the highest_output_index by summing all the
         // transactions in every block.
 
-        // TODO sean this should actually be kept track of somewhere in the schema. not just max of
-        // *our* outputs
-        // int64_t max_output_index = db->prepared_get<int>("SELECT max(global_index) FROM
-        // outputs;");
+        // This is only a placeholder: the maximum is updated from the wallet db's chain output
+        // count whenever decoys are selected.
         int64_t max_output_index = 1000;
         decoy_selector = std::make_unique<DecoySelector>(0, max_output_index);
     };
@@ -66,6 +64,14 @@ class TransactionConstructor {
 
     std::unique_ptr<DecoySelector> decoy_selector;
 
+    // The most decoys we request from the daemon at once; this is the daemon's limit on the
+    // outputs a (non-admin) `get_outs` request may ask for.
+    static constexpr size_t MAX_DECOYS_PER_REQUEST = 5000;
+
+    // Selects and fetches the decoys for all the inputs of all the given transactions (which must
+    // already have their inputs chosen) at once.
+    void select_and_fetch_decoys(const std::vector<PendingTransaction*>& ptxs);
+
   private:
     void select_inputs(PendingTransaction& ptx) const;
 
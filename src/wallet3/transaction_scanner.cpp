@@ -1,10 +1,15 @@
 #include "transaction_scanner.hpp"
 
 #include <common/string_util.h>
+#include <common/threadpool.h>
 
+#include <exception>
+#include <mutex>
+#include <span>
 #include <sqlitedb/database.hpp>
 #include <vector>
 
+#include "block.hpp"
 #include "block_tx.hpp"
 #include "common/exception.h"
 
@@ -43,6 +48,9 @@ std::vector<Output> TransactionScanner::scan_received(
     //
     // Output belongs to us if we have a public key B such that
     //      `out_key - Hs(R || output_index) * G == B`
+    // RingCT amounts are decoded after the loop, all at once
+    std::vector<size_t> rct_outputs;
+    std::vector<std::pair<crypto::key_derivation, unsigned int>> rct_amount_keys;
     for (size_t output_index = 0; output_index < tx.tx.vout.size(); output_index++) {
         log::debug(logcat, "scanning output at height: {} output index: {}", height, output_index);
         const auto& output = tx.tx.vout[output_index];
@@ -77,8 +85,8 @@ std::vector<Output> TransactionScanner::scan_received(
                 o.amount = output.amount;
                 o.rct_mask = rct::identity();
             } else {
-                std::tie(o.amount, o.rct_mask) = wallet_keys->output_amount_and_mask(
-                        tx.tx.rct_signatures, derivations[derivation_index], output_index);
+                rct_outputs.push_back(received_outputs.size());
+                rct_amount_keys.emplace_back(derivations[derivation_index], output_index);
             }
 
             o.key_image = key_image;
@@ -100,9 +108,51 @@ std::vector<Output> TransactionScanner::scan_received(
         }
     }
 
+    if (!rct_outputs.empty()) {
+        auto amounts = wallet_keys->output_amounts_and_masks(
+                tx.tx.rct_signatures, rct_amount_keys);
+        for (size_t i = 0; i < rct_outputs.size(); i++)
+            std::tie(received_outputs[rct_outputs[i]].amount,
+                     received_outputs[rct_outputs[i]].rct_mask) = std::move(amounts[i]);
+    }
+
     return received_outputs;
 }
 
+std::vector<std::vector<std::vector<Output>>> TransactionScanner::scan_received(
+        std::span<const Block> blocks) {
+    std::vector<std::vector<std::vector<Output>>> received(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++)
+        received[i].resize(blocks[i].transactions.size());
+
+    auto& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        for (size_t j = 0; j < blocks[i].transactions.size(); j++) {
+            tpool.submit(&waiter, [&, i, j] {
+                try {
+                    const auto& block = blocks[i];
+                    received[i][j] =
+                            scan_received(block.transactions[j], block.height, block.timestamp);
+                } catch (...) {
+                    std::lock_guard lock{error_mutex};
+                    if (!error)
+                        error = std::current_exception();
+                }
+            });
+        }
+    }
+    waiter.wait(&tpool);
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return received;
+}
+
 std::vector<crypto::key_image> TransactionScanner::scan_spent(const cryptonote::transaction& tx) {
     std::vector<crypto::key_image> spends;
 
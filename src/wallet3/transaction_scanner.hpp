@@ -2,6 +2,7 @@
 
 #include <cryptonote_basic/cryptonote_basic.h>
 
+#include <span>
 #include <vector>
 
 #include "keyring.hpp"
@@ -12,6 +13,7 @@ class Database;
 }
 
 namespace wallet {
+struct Block;
 struct BlockTX;
 
 class TransactionScanner {
@@ -21,6 +23,11 @@ class TransactionScanner {
 
     std::vector<Output> scan_received(const BlockTX& tx, int64_t height, int64_t timestamp);
 
+    // Runs scan_received on every transaction of the given blocks, spread across the common thread
+    // pool.  The result is indexed by block, then by transaction within the block.  This only
+    // touches the keyring (not the database), so it is safe to run ahead of storing the blocks.
+    std::vector<std::vector<std::vector<Output>>> scan_received(std::span<const Block> blocks);
+
     std::vector<crypto::key_image> scan_spent(const cryptonote::transaction& tx);
 
     void set_keys(std::shared_ptr<Keyring> keys);
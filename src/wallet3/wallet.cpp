@@ -9,6 +9,7 @@
 #include <future>
 #include <iostream>
 #include <oxen/log.hpp>
+#include <span>
 #include <sqlitedb/database.hpp>
 #include <thread>
 
@@ -79,8 +80,10 @@ Wallet::Wallet(
 }
 
 void Wallet::init() {
-    keys->expand_subaddresses(
+    keys->load_subaddresses(db->load_subaddress_keys());
+    auto new_subaddresses = keys->expand_subaddresses(
             {config.general.subaddress_lookahead_major, config.general.subaddress_lookahead_minor});
+    db->store_subaddress_keys(new_subaddresses);
     oxen::log::reset_level(*oxen::logging::parse_level(config.logging.level));
     fs::path log_location = "";
     if (config.logging.save_logs_in_subdirectory)
@@ -125,19 +128,31 @@ uint64_t Wallet::get_unlocked_balance() {
     return db->unlocked_balance();
 }
 
+std::vector<Output> Wallet::get_available_outputs(std::optional<int64_t> min_amount) {
+    return db->available_outputs(min_amount);
+}
+
 cryptonote::account_keys Wallet::export_keys() {
     return keys->export_keys();
 };
 
 void Wallet::add_block(const Block& block) {
     oxen::log::trace(logcat, "add block called with block height {}", block.height);
+    auto received = tx_scanner.scan_received(std::span{&block, 1});
+
     auto db_tx = db->db_transaction();
+    store_block(block, received.front());
+    db_tx.commit();
 
+    last_scan_height++;
+}
+
+void Wallet::store_block(const Block& block, const std::vector<std::vector<Output>>& received) {
     db->store_block(block);
 
-    for (const auto& tx : block.transactions) {
-        if (auto outputs = tx_scanner.scan_received(tx, block.height, block.timestamp);
-            not outputs.empty()) {
+    for (size_t i = 0; i < block.transactions.size(); i++) {
+        const auto& tx = block.transactions[i];
+        if (const auto& outputs = received[i]; not outputs.empty()) {
             oxen::log::info(
                     logcat,
                     "outputs: tx.hash {}, block.height {}, outputs {}",
@@ -157,10 +172,6 @@ void Wallet::add_block(const Block& block) {
             db->store_spends(tx.hash, block.height, spends);
         }
     }
-
-    db_tx.commit();
-
-    last_scan_height++;
 }
 
 void Wallet::add_blocks(const std::vector<Block>& blocks) {
@@ -180,9 +191,28 @@ void Wallet::add_blocks(const std::vector<Block>& blocks) {
         return;
     }
 
-    for (const auto& block : blocks) {
-        if (block.height == last_scan_height + 1)
-            add_block(block);
+    // Find the run of blocks that directly follows what we have already scanned; anything before
+    // it we already have, and anything after a gap has to wait for the next request.
+    auto begin = blocks.begin();
+    while (begin != blocks.end() && begin->height != last_scan_height + 1)
+        ++begin;
+    auto end = begin;
+    while (end != blocks.end() && end->height == last_scan_height + 1 + (end - begin))
+        ++end;
+
+    if (begin != end) {
+        // Deriving keys for the whole batch is the expensive part, and is independent for each
+        // transaction, so we do it in parallel; the database writes then all go into a single
+        // transaction.
+        std::span<const Block> batch{begin, end};
+        auto received = tx_scanner.scan_received(batch);
+
+        auto db_tx = db->db_transaction();
+        for (size_t i = 0; i < batch.size(); i++)
+            store_block(batch[i], received[i]);
+        db_tx.commit();
+
+        last_scan_height += batch.size();
     }
     daemon_comms->register_wallet(*this, last_scan_height + 1 /*next needed block*/, false);
 }
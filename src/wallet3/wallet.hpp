@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <string_view>
 
 #include "common/fs.h"
@@ -55,6 +56,9 @@ class Wallet : public std::enable_shared_from_this<Wallet> {
     uint64_t get_balance();
     uint64_t get_unlocked_balance();
 
+    // The unspent outputs not already being spent, optionally only those above `min_amount`.
+    std::vector<Output> get_available_outputs(std::optional<int64_t> min_amount = std::nullopt);
+
     cryptonote::account_keys export_keys();
 
     // TODO: error types to throw
@@ -84,6 +88,11 @@ class Wallet : public std::enable_shared_from_this<Wallet> {
 
     std::shared_ptr<WalletDB> db;
 
+    // Writes a block and the outputs found in it (as returned by TransactionScanner, indexed by
+    // transaction) to the database.  Must be called inside a db transaction, in block order, as
+    // spends are matched against outputs stored by earlier blocks.
+    void store_block(const Block& block, const std::vector<std::vector<Output>>& received);
+
     std::shared_ptr<Keyring> keys;
     TransactionScanner tx_scanner;
     std::shared_ptr<TransactionConstructor> tx_constructor;
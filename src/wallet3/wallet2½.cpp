@@ -26,6 +26,30 @@ uint64_t output_amount(
     }
 }
 
+std::vector<std::pair<uint64_t, rct::key>> output_amounts(
+        const rct::rctSig& rv,
+        const std::vector<std::pair<crypto::key_derivation, unsigned int>>& outputs,
+        hw::device& hwdev) {
+    if (rv.type != rct::RCTType::Full && !rct::is_rct_simple(rv.type))
+        throw std::invalid_argument("Unsupported rct type");
+    std::vector<std::pair<unsigned int, rct::key>> amount_keys;
+    amount_keys.reserve(outputs.size());
+    for (const auto& [derivation, i] : outputs) {
+        crypto::secret_key scalar1;
+        hwdev.derivation_to_scalar(derivation, i, scalar1);
+        amount_keys.emplace_back(i, rct::sk2rct(scalar1));
+    }
+    auto decoded = rct::decodeRctBatch(rv, amount_keys, hwdev);
+    std::vector<std::pair<uint64_t, rct::key>> result;
+    result.reserve(decoded.size());
+    for (auto& d : decoded) {
+        if (!d)
+            throw std::runtime_error("amount decoded incorrectly, will be unable to spend");
+        result.push_back(std::move(*d));
+    }
+    return result;
+}
+
 crypto::hash tx_hash(const cryptonote::transaction& tx) {
     crypto::hash h;
 
@@ -14,6 +14,13 @@ uint64_t output_amount(
         rct::key& mask,
         hw::device& hwdev);
 
+// output_amount for several outputs of the same tx at once, each given by its derivation and
+// output index; returns the amount and mask of each, in order.  Throws if any fails to decode.
+std::vector<std::pair<uint64_t, rct::key>> output_amounts(
+        const rct::rctSig& rv,
+        const std::vector<std::pair<crypto::key_derivation, unsigned int>>& outputs,
+        hw::device& hwdev);
+
 crypto::hash tx_hash(const cryptonote::transaction& tx);
 
 cryptonote::transaction tx_from_blob(const std::string_view blob);
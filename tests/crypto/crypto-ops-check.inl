@@ -0,0 +1,102 @@
+/* Byte-level wrappers around the crypto-ops point functions.  This gets included (with a
+ * different CRYPTO_OPS_CHECK naming macro) by both crypto-ops.c and crypto-ops-ref10.c, so that
+ * compare_ref10 can run the same operations through both field arithmetic backends. */
+
+#include <string.h>
+
+#ifndef CRYPTO_OPS_CHECK
+#error "CRYPTO_OPS_CHECK must be defined before including this file"
+#endif
+
+void CRYPTO_OPS_CHECK(scalarmult_base)(unsigned char* out, const unsigned char* a) {
+  ge_p3 r;
+  ge_scalarmult_base(&r, a);
+  ge_p3_tobytes(out, &r);
+}
+
+int CRYPTO_OPS_CHECK(frombytes)(unsigned char* out, const unsigned char* p) {
+  ge_p3 r;
+  if (ge_frombytes_vartime(&r, p) != 0)
+    return -1;
+  ge_p3_tobytes(out, &r);
+  return 0;
+}
+
+int CRYPTO_OPS_CHECK(scalarmult)(unsigned char* out, const unsigned char* a,
+    const unsigned char* p) {
+  ge_p3 pp;
+  ge_p2 r;
+  if (ge_frombytes_vartime(&pp, p) != 0)
+    return -1;
+  ge_scalarmult(&r, a, &pp);
+  ge_tobytes(out, &r);
+  return 0;
+}
+
+int CRYPTO_OPS_CHECK(double_scalarmult_base)(unsigned char* out, const unsigned char* a,
+    const unsigned char* p, const unsigned char* b) {
+  ge_p3 pp;
+  ge_p2 r;
+  if (ge_frombytes_vartime(&pp, p) != 0)
+    return -1;
+  ge_double_scalarmult_base_vartime(&r, a, &pp, b);
+  ge_tobytes(out, &r);
+  return 0;
+}
+
+int CRYPTO_OPS_CHECK(triple_scalarmult_base)(unsigned char* out, const unsigned char* a,
+    const unsigned char* b, const unsigned char* p, const unsigned char* c,
+    const unsigned char* q) {
+  ge_p3 pp, qq;
+  ge_dsmp pp_pre, qq_pre;
+  ge_p2 r;
+  if (ge_frombytes_vartime(&pp, p) != 0 || ge_frombytes_vartime(&qq, q) != 0)
+    return -1;
+  ge_dsm_precomp(pp_pre, &pp);
+  ge_dsm_precomp(qq_pre, &qq);
+  ge_triple_scalarmult_base_vartime(&r, a, b, pp_pre, c, qq_pre);
+  ge_tobytes(out, &r);
+  return 0;
+}
+
+/* Writes p + q and then p - q (64 bytes) */
+int CRYPTO_OPS_CHECK(add_sub)(unsigned char* out, const unsigned char* p, const unsigned char* q) {
+  ge_p3 pp, qq, r;
+  ge_cached qq_cached;
+  ge_p1p1 t;
+  if (ge_frombytes_vartime(&pp, p) != 0 || ge_frombytes_vartime(&qq, q) != 0)
+    return -1;
+  ge_p3_to_cached(&qq_cached, &qq);
+  ge_add(&t, &pp, &qq_cached);
+  ge_p1p1_to_p3(&r, &t);
+  ge_p3_tobytes(out, &r);
+  ge_sub(&t, &pp, &qq_cached);
+  ge_p1p1_to_p3(&r, &t);
+  ge_p3_tobytes(out + 32, &r);
+  return ge_p3_is_point_at_infinity(&r);
+}
+
+void CRYPTO_OPS_CHECK(fromfe_mul8)(unsigned char* out, const unsigned char* h) {
+  ge_p2 p;
+  ge_p1p1 t;
+  ge_p3 r;
+  ge_fromfe_frombytes_vartime(&p, h);
+  ge_mul8(&t, &p);
+  ge_p1p1_to_p3(&r, &t);
+  ge_p3_tobytes(out, &r);
+}
+
+/* n must be at most 16 */
+int CRYPTO_OPS_CHECK(tobytes_batch)(unsigned char* out, const unsigned char* points, size_t n) {
+  ge_p2 p[16];
+  fe tmp[16];
+  ge_p3 pp;
+  size_t i;
+  for (i = 0; i < n; i++) {
+    if (ge_frombytes_vartime(&pp, points + 32 * i) != 0)
+      return -1;
+    ge_p3_to_p2(&p[i], &pp);
+  }
+  ge_tobytes_batch(out, p, tmp, n);
+  return 0;
+}
@@ -29,3 +29,8 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include "crypto/crypto-ops.c"
+
+#include "crypto-tests.h"
+
+#define CRYPTO_OPS_CHECK(name) check_##name
+#include "crypto-ops-check.inl"
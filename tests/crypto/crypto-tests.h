@@ -30,6 +30,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #if defined(__cplusplus)
 #include "crypto/crypto.h"
 
@@ -38,10 +40,28 @@ extern "C" {
 
 void setup_random(void);
 
+/* The crypto-ops-check.inl wrappers, built against the default field arithmetic (check_*) and
+ * against ref10's (ref10_check_*) */
+#define CRYPTO_OPS_CHECK_DECLARE(name)                                                          \
+  void name##scalarmult_base(unsigned char*, const unsigned char*);                             \
+  int name##frombytes(unsigned char*, const unsigned char*);                                    \
+  int name##scalarmult(unsigned char*, const unsigned char*, const unsigned char*);             \
+  int name##double_scalarmult_base(unsigned char*, const unsigned char*, const unsigned char*, \
+      const unsigned char*);                                                                    \
+  int name##triple_scalarmult_base(unsigned char*, const unsigned char*, const unsigned char*, \
+      const unsigned char*, const unsigned char*, const unsigned char*);                        \
+  int name##add_sub(unsigned char*, const unsigned char*, const unsigned char*);                \
+  void name##fromfe_mul8(unsigned char*, const unsigned char*);                                 \
+  int name##tobytes_batch(unsigned char*, const unsigned char*, size_t);
+CRYPTO_OPS_CHECK_DECLARE(check_)
+CRYPTO_OPS_CHECK_DECLARE(ref10_check_)
+#undef CRYPTO_OPS_CHECK_DECLARE
+
 #if defined(__cplusplus)
 }
 
 bool check_scalar(const crypto::ec_scalar &scalar);
 void hash_to_point(const crypto::hash &h, crypto::ec_point &res);
 void hash_to_ec(const crypto::public_key &key, crypto::ec_point &res);
+bool compare_ref10(uint32_t seed, size_t rounds);
 #endif
@@ -30,6 +30,9 @@
 
 #include "crypto/crypto.cpp"
 
+#include <array>
+#include <random>
+
 #include "crypto-tests.h"
 
 bool check_scalar(const crypto::ec_scalar &scalar) {
@@ -47,3 +50,86 @@ void hash_to_ec(const crypto::public_key &key, crypto::ec_point &res) {
   crypto::hash_to_ec(key, tmp);
   ge_p3_tobytes(res.data(), &tmp);
 }
+
+// Runs `rounds` rounds of random point operations through both the default field arithmetic and
+// the ref10 one, returning true if they all gave the same results.
+bool compare_ref10(uint32_t seed, size_t rounds) {
+  std::mt19937_64 rng{seed};
+  using bytes = std::array<unsigned char, 32>;
+  auto random_bytes = [&] {
+    bytes b;
+    for (auto& c : b)
+      c = static_cast<unsigned char>(rng());
+    return b;
+  };
+  // Scalars for ge_scalarmult_base and friends must have the top bit clear
+  auto random_scalar = [&] {
+    bytes b = random_bytes();
+    b[31] &= 0x7f;
+    return b;
+  };
+  for (size_t i = 0; i < rounds; i++) {
+    bytes a = random_scalar(), b = random_scalar(), c = random_scalar();
+    bytes p, q, x, y;
+    std::array<unsigned char, 64> x2, y2;
+
+    check_scalarmult_base(p.data(), a.data());
+    ref10_check_scalarmult_base(x.data(), a.data());
+    if (p != x)
+      return false;
+    check_scalarmult_base(q.data(), b.data());
+
+    // Random bytes are a valid point about half the time; every so often also try y values just
+    // above and below p = 2^255 - 19, with either sign bit, to exercise the canonical check.
+    bytes r = random_bytes();
+    if (i % 64 == 0) {
+      size_t k = i / 64;
+      std::fill(r.begin(), r.end(), 0xff);
+      r[0] = static_cast<unsigned char>(0xff - k / 2 % 32);
+      r[31] = k % 2 ? 0xff : 0x7f;
+    }
+    int rc = check_frombytes(x.data(), r.data());
+    if (rc != ref10_check_frombytes(y.data(), r.data()) || (rc == 0 && x != y))
+      return false;
+
+    if (check_scalarmult(x.data(), c.data(), p.data()) != 0 ||
+        ref10_check_scalarmult(y.data(), c.data(), p.data()) != 0 || x != y)
+      return false;
+    if (check_double_scalarmult_base(x.data(), a.data(), p.data(), b.data()) != 0 ||
+        ref10_check_double_scalarmult_base(y.data(), a.data(), p.data(), b.data()) != 0 ||
+        x != y)
+      return false;
+    if (check_triple_scalarmult_base(
+            x.data(), a.data(), b.data(), p.data(), c.data(), q.data()) != 0 ||
+        ref10_check_triple_scalarmult_base(
+            y.data(), a.data(), b.data(), p.data(), c.data(), q.data()) != 0 ||
+        x != y)
+      return false;
+    if (check_add_sub(x2.data(), p.data(), q.data()) !=
+            ref10_check_add_sub(y2.data(), p.data(), q.data()) ||
+        x2 != y2)
+      return false;
+    // p - p must be recognized as the identity by both
+    if (check_add_sub(x2.data(), p.data(), p.data()) != 1 ||
+        ref10_check_add_sub(y2.data(), p.data(), p.data()) != 1 || x2 != y2)
+      return false;
+
+    r = random_bytes();
+    check_fromfe_mul8(x.data(), r.data());
+    ref10_check_fromfe_mul8(y.data(), r.data());
+    if (x != y)
+      return false;
+
+    if (i % 16 == 0) {
+      std::array<unsigned char, 32 * 16> points, out1, out2;
+      for (size_t j = 0; j < 16; j++) {
+        bytes s = random_scalar();
+        check_scalarmult_base(points.data() + 32 * j, s.data());
+      }
+      if (check_tobytes_batch(out1.data(), points.data(), 16) != 0 ||
+          ref10_check_tobytes_batch(out2.data(), points.data(), 16) != 0 || out1 != out2)
+        return false;
+    }
+  }
+  return true;
+}
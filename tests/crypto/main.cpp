@@ -236,6 +236,11 @@ int main(int argc, char *argv[]) {
       hash_to_ec(key, actual);
       if (expected != actual)
         fail_line = make(key, actual);
+    } else if (cmd == "compare_ref10") {
+      auto [seed, rounds, expected] = extract<uint32_t, size_t, bool>(test_args);
+      bool actual = compare_ref10(seed, rounds);
+      if (expected != actual)
+        fail_line = make(seed, rounds, actual);
     } else if (cmd == "generate_key_image") {
       auto [pub, sec, expected] = extract<public_key, secret_key, key_image>(test_args);
       key_image actual;
@@ -0,0 +1,795 @@
+// P2P relay load generator: connects many synthetic peers to one or more running oxend p2p
+// endpoints, replays recorded tx, block and uptime proof relay traffic through them at a scaled
+// rate, and reports how the nodes propagate it to the other synthetic peers: first-seen and
+// all-peers latency percentiles, messages that never arrived anywhere, and (given their pids) the
+// nodes' CPU time and memory over the run.
+//
+// The synthetic peers speak just enough levin to stay connected (handshake, timed sync, ping) and
+// advertise the node's own chain top as theirs, so that the node treats them as synchronized peers
+// and relays to them.  Point it at several nodes that are connected to each other (e.g. a local
+// devnet) to measure node-to-node propagation too.
+//
+// Traffic is recorded with --record, which logs each new relay message the peers receive from
+// live nodes as a line of "<seconds> <tx|block|proof> <hex levin payload>".  Replayed messages are
+// only relayed if the nodes accept them (txes not already known, blocks extending their chain), so
+// replay against nodes restored to the state the recording started from.
+//
+// Messages are sent open-loop: each is due at start + (its recorded time)/speed whether or not the
+// nodes are keeping up, and latency is measured from when it was due.
+
+#include <arpa/inet.h>
+#include <fmt/core.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <oxenc/hex.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "common/format.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "epee/int-util.h"
+#include "epee/net/levin_base.h"
+#include "epee/storages/portable_storage_template_helper.h"
+#include "networks.h"
+#include "p2p/p2p_protocol_defs.h"
+
+namespace po = boost::program_options;
+using namespace std::literals;
+using steady = std::chrono::steady_clock;
+
+namespace {
+
+// The relay messages we replay and track
+enum class msg_kind { tx, block, proof };
+constexpr std::array all_kinds{msg_kind::tx, msg_kind::block, msg_kind::proof};
+
+std::string_view name(msg_kind k) {
+    switch (k) {
+        case msg_kind::tx: return "tx"sv;
+        case msg_kind::block: return "block"sv;
+        case msg_kind::proof: return "proof"sv;
+    }
+    return "unknown"sv;
+}
+
+int command(msg_kind k) {
+    switch (k) {
+        case msg_kind::tx: return cryptonote::NOTIFY_NEW_TRANSACTIONS::ID;
+        case msg_kind::block: return cryptonote::NOTIFY_NEW_FLUFFY_BLOCK::ID;
+        case msg_kind::proof: return cryptonote::NOTIFY_BTENCODED_UPTIME_PROOF::ID;
+    }
+    return 0;
+}
+
+std::optional<msg_kind> kind_of_command(int cmd) {
+    for (auto k : all_kinds)
+        if (command(k) == cmd)
+            return k;
+    return std::nullopt;
+}
+
+// Identifies the objects relayed by a message, so that the same tx, block or proof can be matched
+// up when it arrives at other peers (possibly batched with different txes): one key per tx for tx
+// notifications, one for the block or proof otherwise.  Empty if the payload doesn't parse.
+std::vector<uint64_t> object_keys(msg_kind k, std::string_view payload) {
+    auto key = [](std::string_view blob) { return std::hash<std::string_view>{}(blob); };
+    std::vector<uint64_t> keys;
+    switch (k) {
+        case msg_kind::tx: {
+            cryptonote::NOTIFY_NEW_TRANSACTIONS::request req;
+            if (epee::serialization::load_t_from_binary(req, payload))
+                for (auto& tx : req.txs)
+                    keys.push_back(key(tx));
+            break;
+        }
+        case msg_kind::block: {
+            cryptonote::NOTIFY_NEW_FLUFFY_BLOCK::request req;
+            if (epee::serialization::load_t_from_binary(req, payload))
+                keys.push_back(key(req.b.block));
+            break;
+        }
+        case msg_kind::proof: {
+            cryptonote::NOTIFY_BTENCODED_UPTIME_PROOF::request req;
+            if (epee::serialization::load_t_from_binary(req, payload))
+                keys.push_back(key(req.proof));
+            break;
+        }
+    }
+    return keys;
+}
+
+struct node_addr {
+    std::string host;
+    uint16_t port;
+};
+
+struct options {
+    std::vector<node_addr> nodes;
+    unsigned peers = 8;  // Per node
+    cryptonote::network_type nettype = cryptonote::network_type::MAINNET;
+    std::string traffic;  // File to replay
+    std::string record;   // File to record to, instead of replaying
+    std::chrono::milliseconds record_duration = 60s;
+    double speed = 1;
+    std::chrono::milliseconds settle = 30s;
+    std::vector<pid_t> pids;
+};
+
+struct traffic_msg {
+    std::chrono::nanoseconds at;
+    msg_kind kind;
+    std::string payload;
+};
+
+// A blocking TCP connection to a node's p2p port that reads and writes whole levin messages.
+// Reads time out every so often so that reader threads can notice when to stop.
+class connection {
+  public:
+    connection(const node_addr& node, const std::string& bind_ip) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* res = nullptr;
+        const auto port = std::to_string(node.port);
+        if (int rc = getaddrinfo(node.host.c_str(), port.c_str(), &hints, &res))
+            throw std::runtime_error{
+                    "Unable to resolve {}: {}"_format(node.host, gai_strerror(rc))};
+        std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> free_res{res, &freeaddrinfo};
+
+        fd = socket(res->ai_family, SOCK_STREAM, 0);
+        if (fd < 0)
+            throw std::runtime_error{"socket() failed: {}"_format(strerror(errno))};
+        try {
+            if (!bind_ip.empty() && res->ai_family == AF_INET) {
+                sockaddr_in local{};
+                local.sin_family = AF_INET;
+                inet_pton(AF_INET, bind_ip.c_str(), &local.sin_addr);
+                if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+                    throw std::runtime_error{
+                            "Unable to bind to {}: {}"_format(bind_ip, strerror(errno))};
+            }
+            if (::connect(fd, res->ai_addr, res->ai_addrlen) != 0)
+                throw std::runtime_error{"Unable to connect to {}:{}: {}"_format(
+                        node.host, node.port, strerror(errno))};
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval tv{0, 250'000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    ~connection() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    connection(const connection&) = delete;
+    connection& operator=(const connection&) = delete;
+
+    // Sends a levin request, notification (`expect_response` false) or response.  Thread safe.
+    void send(int cmd, std::string_view body, uint32_t flags, bool expect_response, int code = 0) {
+        auto head = epee::levin::make_header(cmd, body.size(), flags, expect_response);
+        head.m_return_code = SWAP32LE(code);
+        std::string msg;
+        msg.reserve(sizeof(head) + body.size());
+        msg.append(reinterpret_cast<const char*>(&head), sizeof(head));
+        msg.append(body);
+        std::lock_guard lock{send_mutex};
+        for (size_t sent = 0; sent < msg.size();) {
+            auto n = ::send(fd, msg.data() + sent, msg.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error{"send failed: {}"_format(strerror(errno))};
+            sent += n;
+        }
+    }
+
+    // Reads the next message.  Returns false if nothing arrived before the read timeout; throws if
+    // the connection is closed or the stream isn't levin.
+    bool receive(epee::levin::bucket_head2& head, std::string& body) {
+        if (!read_exact(&head, sizeof(head), true))
+            return false;
+        if (SWAP64LE(head.m_signature) != LEVIN_SIGNATURE)
+            throw std::runtime_error{"Bad levin signature"};
+        auto size = SWAP64LE(head.m_cb);
+        if (size > LEVIN_DEFAULT_MAX_PACKET_SIZE)
+            throw std::runtime_error{"Oversized levin message"};
+        body.resize(size);
+        read_exact(body.data(), size, false);
+        return true;
+    }
+
+  private:
+    bool read_exact(void* buf, size_t size, bool may_time_out) {
+        auto* p = static_cast<char*>(buf);
+        for (size_t got = 0; got < size;) {
+            auto n = ::recv(fd, p + got, size - got, 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                // Only give up between messages; once one has started we wait for the rest.
+                if (got == 0 && may_time_out)
+                    return false;
+                continue;
+            }
+            if (n <= 0)
+                throw std::runtime_error{n == 0 ? "connection closed"s : strerror(errno)};
+            got += n;
+        }
+        return true;
+    }
+
+    int fd = -1;
+    std::mutex send_mutex;
+};
+
+// Handshakes as a new peer advertising `sync`, and returns the node's own sync data.
+cryptonote::CORE_SYNC_DATA handshake(
+        connection& conn, const options& opts, const cryptonote::CORE_SYNC_DATA& sync) {
+    nodetool::COMMAND_HANDSHAKE::request req{};
+    const auto& network_id = get_config(opts.nettype).NETWORK_ID;
+    std::copy(network_id.begin(), network_id.end(), req.node_data.network_id.begin());
+    req.node_data.my_port = 0;  // Not reachable, so the node doesn't try to ping us back
+    req.node_data.peer_id = std::mt19937_64{std::random_device{}()}();
+    req.payload_data = sync;
+    conn.send(
+            nodetool::COMMAND_HANDSHAKE::ID,
+            epee::serialization::store_t_to_binary(req),
+            LEVIN_PACKET_REQUEST,
+            true);
+
+    epee::levin::bucket_head2 head;
+    std::string body;
+    const auto timeout = steady::now() + 10s;
+    while (steady::now() < timeout) {
+        if (!conn.receive(head, body))
+            continue;
+        if (SWAP32LE(head.m_command) != nodetool::COMMAND_HANDSHAKE::ID ||
+            !(SWAP32LE(head.m_flags) & LEVIN_PACKET_RESPONSE))
+            continue;
+        nodetool::COMMAND_HANDSHAKE::response res;
+        if (!epee::serialization::load_t_from_binary(res, body))
+            throw std::runtime_error{"Invalid handshake response"};
+        return std::move(res.payload_data);
+    }
+    throw std::runtime_error{"Timed out waiting for the handshake response"};
+}
+
+// Where and when each replayed (or recorded) object was seen.  Thread safe.
+class propagation_log {
+  public:
+    struct object {
+        msg_kind kind;
+        steady::time_point due;
+        size_t sender;
+        std::unordered_map<size_t, steady::time_point> seen;  // peer -> first arrival
+    };
+
+    // Registers an object about to be sent by peer `sender`; returns false if it was sent before.
+    bool sent(uint64_t key, msg_kind kind, steady::time_point due, size_t sender) {
+        std::lock_guard lock{mutex};
+        return objects.emplace(key, object{kind, due, sender, {}}).second;
+    }
+
+    // Notes that `peer` received `key`.  Returns true if this is the first time any peer saw it
+    // and it wasn't one of ours, i.e. it is new traffic from the node.
+    bool received(uint64_t key, msg_kind kind, size_t peer, steady::time_point at) {
+        std::lock_guard lock{mutex};
+        auto [it, inserted] = objects.try_emplace(key, object{kind, at, SIZE_MAX, {}});
+        it->second.seen.try_emplace(peer, at);
+        cv.notify_all();
+        return inserted;
+    }
+
+    // Waits until every sent object has reached each of `peers` other than its sender, or until
+    // `timeout`.
+    void wait_for_all(size_t peers, steady::time_point timeout) {
+        std::unique_lock lock{mutex};
+        cv.wait_until(lock, timeout, [&] {
+            for (auto& [key, o] : objects)
+                if (o.sender != SIZE_MAX && o.seen.size() - o.seen.count(o.sender) + 1 < peers)
+                    return false;
+            return true;
+        });
+    }
+
+    nlohmann::json summarize(size_t peers) {
+        auto ms = [](std::chrono::nanoseconds d) { return d.count() / 1e6; };
+        std::lock_guard lock{mutex};
+        nlohmann::json out = nlohmann::json::object();
+        for (auto k : all_kinds) {
+            std::vector<std::chrono::nanoseconds> first, all;
+            uint64_t sent = 0, dropped = 0;
+            double reach = 0;
+            for (auto& [key, o] : objects) {
+                if (o.kind != k || o.sender == SIZE_MAX)
+                    continue;
+                sent++;
+                auto earliest = steady::time_point::max(), latest = steady::time_point::min();
+                size_t reached = 0;
+                for (auto& [peer, at] : o.seen) {
+                    if (peer == o.sender)
+                        continue;
+                    reached++;
+                    earliest = std::min(earliest, at);
+                    latest = std::max(latest, at);
+                }
+                if (!reached) {
+                    dropped++;
+                    continue;
+                }
+                first.push_back(earliest - o.due);
+                if (reached + 1 >= peers)
+                    all.push_back(latest - o.due);
+                reach += peers > 1 ? double(reached) / (peers - 1) : 1.0;
+            }
+            if (!sent)
+                continue;
+            auto& j = out[std::string{name(k)}];
+            j["sent"] = sent;
+            j["dropped"] = dropped;
+            j["reached_all"] = all.size();
+            j["mean_reach"] = reach / sent;
+            for (auto [l, prefix] : {std::pair{&first, "first"}, std::pair{&all, "all"}}) {
+                std::sort(l->begin(), l->end());
+                auto pct = [l](double p) {
+                    return l->empty() ? 0ns : (*l)[std::min<size_t>(l->size() - 1, l->size() * p)];
+                };
+                j["{}_p50_ms"_format(prefix)] = ms(pct(0.5));
+                j["{}_p99_ms"_format(prefix)] = ms(pct(0.99));
+                j["{}_max_ms"_format(prefix)] = ms(l->empty() ? 0ns : l->back());
+            }
+        }
+        return out;
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<uint64_t, object> objects;
+};
+
+// A synthetic peer: a connection that has completed the handshake, plus a thread that keeps it
+// alive and tells `on_relay` about every tx, block or proof notification that arrives.
+class peer {
+  public:
+    using relay_callback = std::function<void(size_t peer, msg_kind, std::string_view payload)>;
+
+    peer(size_t index,
+         const node_addr& node,
+         const std::string& bind_ip,
+         const options& opts,
+         const cryptonote::CORE_SYNC_DATA& sync,
+         relay_callback on_relay) :
+            index{index}, conn{node, bind_ip}, sync{sync}, on_relay{std::move(on_relay)} {
+        handshake(conn, opts, sync);
+        reader = std::thread{[this] { run(); }};
+    }
+
+    ~peer() {
+        stopping = true;
+        reader.join();
+    }
+
+    void send(msg_kind k, std::string_view payload) {
+        conn.send(command(k), payload, LEVIN_PACKET_REQUEST, false);
+    }
+
+    bool alive() const { return !failed; }
+
+  private:
+    void run() {
+        epee::levin::bucket_head2 head;
+        std::string body;
+        try {
+            while (!stopping) {
+                if (!conn.receive(head, body))
+                    continue;
+                const int cmd = SWAP32LE(head.m_command);
+                const bool request = SWAP32LE(head.m_flags) & LEVIN_PACKET_REQUEST;
+                if (!request)
+                    continue;
+                if (auto k = kind_of_command(cmd)) {
+                    on_relay(index, *k, body);
+                } else if (head.m_have_to_return_data) {
+                    respond(cmd);
+                }
+            }
+        } catch (const std::exception& e) {
+            if (!stopping) {
+                fmt::print(stderr, "Peer {} disconnected: {}\n", index, e.what());
+                failed = true;
+            }
+        }
+    }
+
+    // Answers the node's keep-alive requests; anything else it asks for we don't have.
+    void respond(int cmd) {
+        std::string body;
+        int code = LEVIN_ERROR_CONNECTION_HANDLER_NOT_DEFINED;
+        if (cmd == nodetool::COMMAND_TIMED_SYNC::ID) {
+            nodetool::COMMAND_TIMED_SYNC::response res{};
+            res.local_time = time(nullptr);
+            res.payload_data = sync;
+            body = epee::serialization::store_t_to_binary(res);
+            code = 1;
+        } else if (cmd == nodetool::COMMAND_PING::ID) {
+            nodetool::COMMAND_PING::response res{};
+            res.status = nodetool::COMMAND_PING::OK_RESPONSE;
+            body = epee::serialization::store_t_to_binary(res);
+            code = 1;
+        }
+        conn.send(cmd, body, LEVIN_PACKET_RESPONSE, false, code);
+    }
+
+    const size_t index;
+    connection conn;
+    const cryptonote::CORE_SYNC_DATA sync;
+    relay_callback on_relay;
+    std::atomic<bool> stopping{false}, failed{false};
+    std::thread reader;
+};
+
+// Daemon CPU time (user + system) so far, from /proc; negative if unavailable.
+double process_cpu_seconds(pid_t pid) {
+    std::ifstream stat{"/proc/{}/stat"_format(pid)};
+    std::string line;
+    if (!std::getline(stat, line))
+        return -1;
+    // The command name (field 2) is parenthesized and may contain spaces, so skip past it; utime
+    // and stime are then fields 14 and 15 of the whole line.
+    auto close = line.rfind(')');
+    if (close == std::string::npos)
+        return -1;
+    std::istringstream rest{line.substr(close + 2)};
+    std::string field;
+    for (int i = 3; i < 14 && rest >> field; i++) {}
+    unsigned long long utime = 0, stime = 0;
+    if (!(rest >> utime >> stime))
+        return -1;
+    return double(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+// Resident set size in bytes, from /proc; 0 if unavailable.
+uint64_t process_rss(pid_t pid) {
+    std::ifstream statm{"/proc/{}/statm"_format(pid)};
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident))
+        return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// Samples the nodes' memory once a second while a run is going, so that a soak run shows growth and
+// peaks rather than just the final value.
+class process_monitor {
+  public:
+    explicit process_monitor(const std::vector<pid_t>& pids) : pids{pids} {
+        for (auto pid : pids)
+            stats.push_back({process_cpu_seconds(pid), process_rss(pid), process_rss(pid)});
+        if (!pids.empty())
+            sampler = std::thread{[this] {
+                std::unique_lock lock{mutex};
+                while (!cv.wait_for(lock, 1s, [this] { return stopping; }))
+                    for (size_t i = 0; i < this->pids.size(); i++)
+                        stats[i].peak_rss = std::max(stats[i].peak_rss, process_rss(this->pids[i]));
+            }};
+    }
+
+    nlohmann::json finish() {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        cv.notify_all();
+        if (sampler.joinable())
+            sampler.join();
+        auto mb = [](uint64_t bytes) { return bytes / 1e6; };
+        nlohmann::json out = nlohmann::json::array();
+        for (size_t i = 0; i < pids.size(); i++) {
+            double cpu = process_cpu_seconds(pids[i]);
+            uint64_t rss = process_rss(pids[i]);
+            auto& s = stats[i];
+            out.push_back(
+                    {{"pid", pids[i]},
+                     {"cpu_s", cpu >= 0 && s.cpu_start >= 0 ? cpu - s.cpu_start : -1.0},
+                     {"rss_start_mb", mb(s.rss_start)},
+                     {"rss_end_mb", mb(rss)},
+                     {"rss_peak_mb", mb(std::max(s.peak_rss, rss))}});
+        }
+        return out;
+    }
+
+  private:
+    struct proc_stats {
+        double cpu_start;
+        uint64_t rss_start;
+        uint64_t peak_rss;
+    };
+    const std::vector<pid_t>& pids;
+    std::vector<proc_stats> stats;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread sampler;
+};
+
+std::vector<traffic_msg> load_traffic(const std::string& path) {
+    std::ifstream in{path};
+    if (!in)
+        throw std::runtime_error{"Unable to open {}"_format(path)};
+    std::vector<traffic_msg> msgs;
+    std::string line;
+    for (size_t lineno = 1; std::getline(in, line); lineno++) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields{line};
+        double seconds;
+        std::string kind, hex;
+        if (!(fields >> seconds >> kind >> hex) || !oxenc::is_hex(hex))
+            throw std::runtime_error{
+                    "{}:{}: expected '<seconds> <kind> <hex>'"_format(path, lineno)};
+        auto it = std::find_if(
+                all_kinds.begin(), all_kinds.end(), [&](msg_kind k) { return name(k) == kind; });
+        if (it == all_kinds.end())
+            throw std::runtime_error{"{}:{}: unknown message kind '{}'"_format(path, lineno, kind)};
+        msgs.push_back(
+                {std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::duration<double>{seconds}),
+                 *it,
+                 oxenc::from_hex(hex)});
+    }
+    std::stable_sort(msgs.begin(), msgs.end(), [](auto& a, auto& b) { return a.at < b.at; });
+    return msgs;
+}
+
+// Source address for peer `i`: nodes accept only a few connections from each host (20, or 1 on
+// mainnet), so when the node is on loopback give each peer a loopback address of its own.
+std::string bind_address(const node_addr& node, size_t i) {
+    if (node.host.rfind("127.", 0) != 0 && node.host != "localhost")
+        return "";
+    return "127.{}.{}.{}"_format(1 + i / 65536 % 254, i / 256 % 256, 1 + i % 254);
+}
+
+node_addr parse_node(const std::string& spec) {
+    auto colon = spec.rfind(':');
+    if (colon == std::string::npos)
+        throw std::invalid_argument{"Invalid node '{}': expected HOST:PORT"_format(spec)};
+    auto host = spec.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+    return {host, static_cast<uint16_t>(std::stoul(spec.substr(colon + 1)))};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    po::options_description desc{"Options"};
+    // clang-format off
+    desc.add_options()
+        ("help", "Show this help")
+        ("node", po::value<std::vector<std::string>>(), "oxend p2p address HOST:PORT to connect "
+            "synthetic peers to; may be repeated")
+        ("peers", po::value<unsigned>()->default_value(8), "Synthetic peers per node")
+        ("nettype", po::value<std::string>()->default_value("mainnet"),
+            "Network of the nodes: mainnet, testnet, devnet, stagenet or localdev")
+        ("traffic", po::value<std::string>(), "Recorded traffic file to replay")
+        ("speed", po::value<double>()->default_value(1), "Replay speed relative to the recording")
+        ("settle", po::value<double>()->default_value(30),
+            "Seconds to wait after the last message for relaying to finish")
+        ("record", po::value<std::string>(), "Instead of replaying, record the relay traffic the "
+            "peers receive to this file")
+        ("duration", po::value<double>()->default_value(60), "Seconds to record for")
+        ("pid", po::value<std::vector<int>>(), "Node pid to report CPU and memory use of; may be "
+            "repeated")
+        ("json", po::value<std::string>(), "Also write the results to this file as JSON");
+    // clang-format on
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n\n" << desc << "\n";
+        return 1;
+    }
+    if (vm.count("help") || !vm.count("node") || vm.count("traffic") == vm.count("record")) {
+        std::cerr << "Usage: " << argv[0]
+                  << " --node HOST:PORT [--node ...] {--traffic FILE|--record FILE} [options]\n\n"
+                  << desc << "\n";
+        return vm.count("help") ? 0 : 1;
+    }
+
+    options opts;
+    std::vector<traffic_msg> traffic;
+    try {
+        for (auto& n : vm["node"].as<std::vector<std::string>>())
+            opts.nodes.push_back(parse_node(n));
+        opts.peers = std::max(1u, vm["peers"].as<unsigned>());
+        opts.nettype = cryptonote::network_type_from_string(vm["nettype"].as<std::string>());
+        if (opts.nettype == cryptonote::network_type::UNDEFINED ||
+            opts.nettype == cryptonote::network_type::FAKECHAIN)
+            throw std::invalid_argument{"Invalid --nettype"};
+        opts.speed = vm["speed"].as<double>();
+        opts.settle = std::chrono::milliseconds{
+                static_cast<int64_t>(vm["settle"].as<double>() * 1000)};
+        opts.record_duration = std::chrono::milliseconds{
+                static_cast<int64_t>(vm["duration"].as<double>() * 1000)};
+        if (vm.count("pid"))
+            for (int pid : vm["pid"].as<std::vector<int>>())
+                opts.pids.push_back(pid);
+        if (opts.speed <= 0)
+            throw std::invalid_argument{"--speed must be positive"};
+        if (vm.count("record"))
+            opts.record = vm["record"].as<std::string>();
+        else
+            traffic = load_traffic(opts.traffic = vm["traffic"].as<std::string>());
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid options: " << e.what() << "\n";
+        return 1;
+    }
+
+    propagation_log propagation;
+    std::ofstream record_out;
+    std::mutex record_mutex;
+    const auto start = steady::now();
+    if (!opts.record.empty()) {
+        record_out.open(opts.record);
+        if (!record_out) {
+            std::cerr << "Unable to open " << opts.record << "\n";
+            return 1;
+        }
+    }
+    auto on_relay = [&](size_t p, msg_kind k, std::string_view payload) {
+        auto now = steady::now();
+        bool is_new = false;
+        for (auto key : object_keys(k, payload))
+            is_new |= propagation.received(key, k, p, now);
+        if (is_new && record_out.is_open()) {
+            std::lock_guard lock{record_mutex};
+            record_out << "{:.6f} {} {}\n"_format(
+                    std::chrono::duration<double>{now - start}.count(),
+                    name(k),
+                    oxenc::to_hex(payload));
+        }
+    };
+
+    // Connect a probe first to learn each node's chain top, then the peers advertising it as their
+    // own so that the node considers them synchronized.
+    std::vector<std::unique_ptr<peer>> peers;
+    try {
+        for (auto& node : opts.nodes) {
+            cryptonote::CORE_SYNC_DATA sync;
+            {
+                connection probe{node, bind_address(node, peers.size() + opts.peers)};
+                sync = handshake(probe, opts, cryptonote::CORE_SYNC_DATA{});
+            }
+            sync.blink_blocks.clear();
+            sync.blink_hash.clear();
+            fmt::print("{}:{}: height {}, top {}\n", node.host, node.port, sync.current_height,
+                       sync.top_id);
+            for (unsigned i = 0; i < opts.peers; i++) {
+                size_t index = peers.size();
+                peers.push_back(std::make_unique<peer>(
+                        index, node, bind_address(node, index), opts, sync, on_relay));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Unable to connect peers: " << e.what() << "\n";
+        return 1;
+    }
+    fmt::print("Connected {} peers to {} node(s)\n", peers.size(), opts.nodes.size());
+
+    process_monitor monitor{opts.pids};
+    nlohmann::json report{{"nodes", opts.nodes.size()}, {"peers", peers.size()}};
+
+    if (!opts.record.empty()) {
+        std::this_thread::sleep_for(opts.record_duration);
+        report["nodes_usage"] = monitor.finish();
+        peers.clear();
+        fmt::print("Recorded {}s of traffic to {}\n", opts.record_duration.count() / 1000.0,
+                   opts.record);
+    } else {
+        fmt::print("Replaying {} messages at {}x\n", traffic.size(), opts.speed);
+        const auto replay_start = steady::now() + 100ms;
+        uint64_t send_errors = 0;
+        for (size_t i = 0; i < traffic.size(); i++) {
+            auto& msg = traffic[i];
+            auto due = replay_start +
+                       std::chrono::duration_cast<steady::duration>(msg.at / opts.speed);
+            // Spread the senders over the peers (and so over the nodes) in turn
+            size_t sender = i % peers.size();
+            bool any_new = false;
+            for (auto key : object_keys(msg.kind, msg.payload))
+                any_new |= propagation.sent(key, msg.kind, due, sender);
+            if (!any_new)
+                continue;
+            std::this_thread::sleep_until(due);
+            try {
+                peers[sender]->send(msg.kind, msg.payload);
+            } catch (const std::exception&) {
+                send_errors++;
+            }
+        }
+        propagation.wait_for_all(peers.size(), steady::now() + opts.settle);
+        report["nodes_usage"] = monitor.finish();
+        size_t disconnected = std::count_if(
+                peers.begin(), peers.end(), [](auto& p) { return !p->alive(); });
+        peers.clear();
+
+        report["relay"] = propagation.summarize(report["peers"].get<size_t>());
+        report["send_errors"] = send_errors;
+        report["disconnected_peers"] = disconnected;
+
+        fmt::print(
+                "\n{:<6} {:>7} {:>7} {:>7} {:>6} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+                "kind",
+                "sent",
+                "dropped",
+                "all",
+                "reach",
+                "first p50",
+                "first p99",
+                "all p50",
+                "all p99",
+                "all max");
+        for (auto& [kind, j] : report["relay"].items())
+            fmt::print(
+                    "{:<6} {:>7} {:>7} {:>7} {:>5.0f}% {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} "
+                    "{:>10.1f}\n",
+                    kind,
+                    j["sent"].get<uint64_t>(),
+                    j["dropped"].get<uint64_t>(),
+                    j["reached_all"].get<uint64_t>(),
+                    j["mean_reach"].get<double>() * 100,
+                    j["first_p50_ms"].get<double>(),
+                    j["first_p99_ms"].get<double>(),
+                    j["all_p50_ms"].get<double>(),
+                    j["all_p99_ms"].get<double>(),
+                    j["all_max_ms"].get<double>());
+        fmt::print("(latencies in ms)  send errors: {}, disconnected peers: {}\n", send_errors,
+                   disconnected);
+    }
+
+    for (auto& n : report["nodes_usage"])
+        fmt::print(
+                "pid {}: {:.2f}s CPU, RSS {:.1f} MB -> {:.1f} MB (peak {:.1f} MB)\n",
+                n["pid"].get<int>(),
+                n["cpu_s"].get<double>(),
+                n["rss_start_mb"].get<double>(),
+                n["rss_end_mb"].get<double>(),
+                n["rss_peak_mb"].get<double>());
+
+    if (vm.count("json")) {
+        std::ofstream out{vm["json"].as<std::string>()};
+        out << report.dump(2) << '\n';
+        if (!out) {
+            std::cerr << "Failed to write " << vm["json"].as<std::string>() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
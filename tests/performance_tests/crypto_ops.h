@@ -41,6 +41,7 @@ enum test_op
   op_ge_add_raw,
   op_ge_add_p3_p3,
   op_zeroCommitCached,
+  op_ge_p2_dbl,
   ops_fast,
 
   op_addKeys,
@@ -62,6 +63,9 @@ enum test_op
   op_addKeys_aAbBcC,
   op_isInMainSubgroup,
   op_zeroCommitUncached,
+  op_ge_frombytes_vartime,
+  op_ge_p3_tobytes,
+  op_ge_fromfe_frombytes_vartime,
 };
 
 template<test_op op>
@@ -110,6 +114,12 @@ public:
         break;
       }
       case op_ge_add_raw: ge_add(&tmp_p1p1, &p3_1, &cached); break;
+      case op_ge_p2_dbl: {
+        ge_p3_to_p2(&tmp_p2, &p3_1);
+        ge_p2_dbl(&tmp_p1p1, &tmp_p2);
+        ge_p1p1_to_p3(&p3_1, &tmp_p1p1);
+        break;
+      }
       case op_addKeys: rct::addKeys(key, point0, point1); break;
       case op_scalarmultBase: rct::scalarmultBase(scalar0); break;
       case op_scalarmultKey: rct::scalarmultKey(point0, scalar0); break;
@@ -130,6 +140,9 @@ public:
       case op_isInMainSubgroup: rct::isInMainSubgroup(point0); break;
       case op_zeroCommitUncached: rct::zeroCommit(9001); break;
       case op_zeroCommitCached: rct::zeroCommit(9000); break;
+      case op_ge_frombytes_vartime: return ge_frombytes_vartime(&p3_2, point2.bytes) == 0;
+      case op_ge_p3_tobytes: ge_p3_tobytes(key.bytes, &p3_0); break;
+      case op_ge_fromfe_frombytes_vartime: ge_fromfe_frombytes_vartime(&tmp_p2, scalar0.bytes); break;
       default: return false;
     }
     return true;
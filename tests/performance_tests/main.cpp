@@ -237,6 +237,7 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_mul);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_add_raw);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_add_p3_p3);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_p2_dbl);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmultBase);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_scalarmultKey);
@@ -257,6 +258,9 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_isInMainSubgroup);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_zeroCommitUncached);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_zeroCommitCached);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_frombytes_vartime);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_p3_tobytes);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_fromfe_frombytes_vartime);
 
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 2);
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 4);
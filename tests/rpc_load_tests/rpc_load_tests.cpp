@@ -0,0 +1,505 @@
+// RPC load generator: drives a running oxend's HTTP or OxenMQ RPC interface with a weighted mix of
+// requests at a fixed offered rate and reports the latency distribution of each request type, and
+// (given the daemon's pid) the daemon CPU time each request type costs.
+//
+// Requests are scheduled open-loop: request i is due at start + i/qps whether or not earlier
+// requests have completed, and latency is measured from when it was due, so a server that falls
+// behind shows up as growing latency rather than as the load generator quietly slowing down.
+
+#include <fmt/core.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <oxenmq/oxenmq.h>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "common/format.h"
+#include "common/string_util.h"
+#include "epee/storages/portable_storage_template_helper.h"
+#include "rpc/core_rpc_server_binary_commands.h"
+#include "rpc/http_client.h"
+
+namespace po = boost::program_options;
+using namespace std::literals;
+using steady = std::chrono::steady_clock;
+using cryptonote::rpc::GET_BLOCKS_BIN;
+using cryptonote::rpc::GET_OUTPUTS_BIN;
+
+namespace {
+
+// The request types we know how to generate.  Binary requests go to "/get_x.bin" over HTTP and
+// "rpc.get_x.bin" over OMQ with the same epee-serialized body; json ones go through /json_rpc or
+// "rpc.x" with a json body.
+enum class req_type { get_info, get_blocks_bin, get_outs_bin, get_service_nodes, ons_resolve };
+constexpr std::array all_types{
+        req_type::get_info,
+        req_type::get_blocks_bin,
+        req_type::get_outs_bin,
+        req_type::get_service_nodes,
+        req_type::ons_resolve};
+
+std::string_view name(req_type t) {
+    switch (t) {
+        case req_type::get_info: return "get_info"sv;
+        case req_type::get_blocks_bin: return "get_blocks.bin"sv;
+        case req_type::get_outs_bin: return "get_outs.bin"sv;
+        case req_type::get_service_nodes: return "get_service_nodes"sv;
+        case req_type::ons_resolve: return "ons_resolve"sv;
+    }
+    return "unknown"sv;
+}
+
+bool is_binary(req_type t) {
+    return t == req_type::get_blocks_bin || t == req_type::get_outs_bin;
+}
+
+struct options {
+    std::string http;  // e.g. http://127.0.0.1:22023
+    std::string omq;   // e.g. tcp://127.0.0.1:22025
+    std::vector<std::pair<req_type, double>> mix;
+    double qps = 100;
+    std::chrono::milliseconds duration = 10s;
+    unsigned connections = 8;
+    uint64_t chain_height = 0;  // From get_info, if not given
+    uint64_t output_count = 1000;
+    std::string ons_name_hash;  // Random (i.e. a lookup miss) if empty
+    pid_t daemon_pid = 0;
+};
+
+// Builds request bodies.  Heights and output indices are picked at random across the fixture
+// chain so that the server can't serve everything from one warm page.
+class request_factory {
+  public:
+    explicit request_factory(const options& opts) : opts{opts} {}
+
+    std::string body(req_type t, std::mt19937_64& rng) const {
+        switch (t) {
+            case req_type::get_info: return "{}";
+            case req_type::get_service_nodes: return "{}";
+            case req_type::ons_resolve: {
+                std::string hash = opts.ons_name_hash;
+                if (hash.empty()) {
+                    // A 32-byte hash in base64: 43 chars plus padding
+                    static constexpr auto b64 =
+                            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"sv;
+                    for (int i = 0; i < 43; i++)
+                        hash += b64[rng() % 64];
+                    hash += '=';
+                }
+                return nlohmann::json{{"type", 0}, {"name_hash", hash}}.dump();
+            }
+            case req_type::get_blocks_bin: {
+                GET_BLOCKS_BIN::request req{};
+                req.start_height = rng() % std::max<uint64_t>(opts.chain_height, 1);
+                req.prune = true;
+                std::string out;
+                epee::serialization::store_t_to_binary(req, out);
+                return out;
+            }
+            case req_type::get_outs_bin: {
+                GET_OUTPUTS_BIN::request req{};
+                for (int i = 0; i < 10; i++)
+                    req.outputs.push_back({0, rng() % std::max<uint64_t>(opts.output_count, 1)});
+                std::string out;
+                epee::serialization::store_t_to_binary(req, out);
+                return out;
+            }
+        }
+        return "";
+    }
+
+  private:
+    const options& opts;
+};
+
+struct type_results {
+    std::vector<std::chrono::nanoseconds> latencies;
+    uint64_t errors = 0;
+    double server_cpu_seconds = -1;  // Only measured when the type runs on its own
+};
+
+// Daemon CPU time (user + system) so far, from /proc; negative if unavailable.
+double process_cpu_seconds(pid_t pid) {
+    if (!pid)
+        return -1;
+    std::ifstream stat{"/proc/{}/stat"_format(pid)};
+    std::string line;
+    if (!std::getline(stat, line))
+        return -1;
+    // The command name (field 2) is parenthesized and may contain spaces, so skip past it; utime
+    // and stime are then fields 14 and 15 of the whole line.
+    auto close = line.rfind(')');
+    if (close == std::string::npos)
+        return -1;
+    std::istringstream rest{line.substr(close + 2)};
+    std::string field;
+    for (int i = 3; i < 14 && rest >> field; i++) {}
+    unsigned long long utime = 0, stime = 0;
+    if (!(rest >> utime >> stime))
+        return -1;
+    return double(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+// Runs one phase: requests of `mix` at opts.qps for opts.duration.  Returns results per type.
+class load_runner {
+  public:
+    load_runner(
+            const options& opts,
+            const request_factory& factory,
+            oxenmq::OxenMQ* omq,
+            oxenmq::ConnectionID omq_conn) :
+            opts{opts}, factory{factory}, omq{omq}, omq_conn{std::move(omq_conn)} {}
+
+    std::map<req_type, type_results> run(const std::vector<std::pair<req_type, double>>& mix) {
+        std::vector<double> weights;
+        for (auto& [t, w] : mix)
+            weights.push_back(w);
+        std::discrete_distribution<size_t> pick{weights.begin(), weights.end()};
+
+        const uint64_t total = std::max<uint64_t>(1, opts.qps * opts.duration.count() / 1000.0);
+        const auto interval = std::chrono::duration_cast<steady::duration>(
+                std::chrono::duration<double>{1.0 / opts.qps});
+
+        // Decide the whole schedule up front so that request generation is off the clock
+        std::mt19937_64 rng{std::random_device{}()};
+        std::vector<req_type> types(total);
+        std::vector<std::string> bodies(total);
+        for (uint64_t i = 0; i < total; i++) {
+            types[i] = mix[pick(rng)].first;
+            bodies[i] = factory.body(types[i], rng);
+        }
+
+        std::vector<std::chrono::nanoseconds> latency(total, -1ns);
+        const auto start = steady::now() + 100ms;
+        auto due = [&](uint64_t i) { return start + static_cast<int64_t>(i) * interval; };
+
+        if (omq)
+            run_omq(types, bodies, latency, due);
+        else
+            run_http(types, bodies, latency, due);
+
+        std::map<req_type, type_results> results;
+        for (uint64_t i = 0; i < total; i++) {
+            auto& r = results[types[i]];
+            if (latency[i] < 0ns)
+                r.errors++;
+            else
+                r.latencies.push_back(latency[i]);
+        }
+        return results;
+    }
+
+  private:
+    template <typename Due>
+    void run_http(
+            const std::vector<req_type>& types,
+            const std::vector<std::string>& bodies,
+            std::vector<std::chrono::nanoseconds>& latency,
+            Due due) {
+        // Each connection is a thread with its own client (http_client is one request at a time);
+        // threads take the next due request in turn.
+        std::atomic<uint64_t> next{0};
+        std::vector<std::thread> threads;
+        for (unsigned c = 0; c < opts.connections; c++)
+            threads.emplace_back([&] {
+                cryptonote::rpc::http_client client{opts.http};
+                for (uint64_t i; (i = next++) < types.size();) {
+                    std::this_thread::sleep_until(due(i));
+                    try {
+                        auto t = types[i];
+                        cpr::Response res;
+                        if (is_binary(t))
+                            res = client.post(
+                                    std::string{name(t)},
+                                    bodies[i],
+                                    {{"Content-Type", "application/octet-stream"}});
+                        else
+                            res = client.post(
+                                    "json_rpc",
+                                    R"({{"jsonrpc":"2.0","id":"0","method":"{}","params":{}}})"
+                                    ""_format(name(t), bodies[i]),
+                                    {{"Content-Type", "application/json; charset=utf-8"}});
+                        if (res.status_code == 200)
+                            latency[i] = steady::now() - due(i);
+                    } catch (const std::exception&) {
+                    }
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+    }
+
+    template <typename Due>
+    void run_omq(
+            const std::vector<req_type>& types,
+            const std::vector<std::string>& bodies,
+            std::vector<std::chrono::nanoseconds>& latency,
+            Due due) {
+        // OMQ requests are asynchronous, so one thread can keep any number in flight
+        std::mutex m;
+        std::condition_variable cv;
+        uint64_t done = 0;
+        for (uint64_t i = 0; i < types.size(); i++) {
+            std::this_thread::sleep_until(due(i));
+            omq->request(
+                    omq_conn,
+                    "rpc.{}"_format(name(types[i])),
+                    [&, i](bool success, std::vector<std::string> data) {
+                        if (success && !data.empty() && data[0] == "200")
+                            latency[i] = steady::now() - due(i);
+                        std::lock_guard lock{m};
+                        done++;
+                        cv.notify_one();
+                    },
+                    bodies[i],
+                    oxenmq::send_option::request_timeout{30s});
+        }
+        std::unique_lock lock{m};
+        cv.wait(lock, [&] { return done == types.size(); });
+    }
+
+    const options& opts;
+    const request_factory& factory;
+    oxenmq::OxenMQ* omq;
+    oxenmq::ConnectionID omq_conn;
+};
+
+nlohmann::json summarize(
+        std::map<req_type, type_results>& results, std::chrono::milliseconds duration) {
+    auto ms = [](std::chrono::nanoseconds d) { return d.count() / 1e6; };
+    nlohmann::json out = nlohmann::json::object();
+    for (auto& [t, r] : results) {
+        auto& l = r.latencies;
+        std::sort(l.begin(), l.end());
+        auto pct = [&l](double p) {
+            return l.empty() ? 0ns : l[std::min<size_t>(l.size() - 1, l.size() * p)];
+        };
+        auto& j = out[std::string{name(t)}];
+        j["requests"] = l.size() + r.errors;
+        j["errors"] = r.errors;
+        j["achieved_qps"] = l.size() / (duration.count() / 1000.0);
+        j["p50_ms"] = ms(pct(0.5));
+        j["p99_ms"] = ms(pct(0.99));
+        j["p999_ms"] = ms(pct(0.999));
+        j["max_ms"] = ms(l.empty() ? 0ns : l.back());
+        if (r.server_cpu_seconds >= 0 && !l.empty())
+            j["server_cpu_ms_per_request"] = r.server_cpu_seconds * 1000 / (l.size() + r.errors);
+    }
+    return out;
+}
+
+void print_table(const nlohmann::json& summary) {
+    fmt::print(
+            "{:<20} {:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>12}\n",
+            "request",
+            "count",
+            "errors",
+            "qps",
+            "p50 ms",
+            "p99 ms",
+            "p999 ms",
+            "cpu ms/req");
+    for (auto& [type, j] : summary.items())
+        fmt::print(
+                "{:<20} {:>9} {:>7} {:>9.1f} {:>9.3f} {:>9.3f} {:>9.3f} {:>12}\n",
+                type,
+                j["requests"].get<uint64_t>(),
+                j["errors"].get<uint64_t>(),
+                j["achieved_qps"].get<double>(),
+                j["p50_ms"].get<double>(),
+                j["p99_ms"].get<double>(),
+                j["p999_ms"].get<double>(),
+                j.contains("server_cpu_ms_per_request")
+                        ? "{:.3f}"_format(j["server_cpu_ms_per_request"].get<double>())
+                        : "-");
+}
+
+std::vector<std::pair<req_type, double>> parse_mix(std::string_view spec) {
+    std::vector<std::pair<req_type, double>> mix;
+    for (auto part : tools::split(spec, ",", true)) {
+        auto colon = part.find(':');
+        auto type_name = part.substr(0, colon);
+        double weight = colon == std::string_view::npos
+                              ? 1.0
+                              : std::stod(std::string{part.substr(colon + 1)});
+        auto it = std::find_if(all_types.begin(), all_types.end(), [&](req_type t) {
+            return name(t) == type_name;
+        });
+        if (it == all_types.end())
+            throw std::invalid_argument{"Unknown request type '{}'"_format(type_name)};
+        if (weight > 0)
+            mix.emplace_back(*it, weight);
+    }
+    if (mix.empty())
+        throw std::invalid_argument{"Request mix is empty"};
+    return mix;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    po::options_description desc{"Options"};
+    // clang-format off
+    desc.add_options()
+        ("help", "Show this help")
+        ("http", po::value<std::string>(), "oxend HTTP RPC URL, e.g. http://127.0.0.1:22023")
+        ("omq", po::value<std::string>(), "oxend OxenMQ RPC address, e.g. tcp://127.0.0.1:22025 "
+            "(use curve://IP:PORT/PUBKEY for a curve-encrypted listener)")
+        ("mix", po::value<std::string>()->default_value(
+                "get_info:40,get_blocks.bin:20,get_outs.bin:20,"
+                "get_service_nodes:10,ons_resolve:10"),
+            "Comma-separated TYPE:WEIGHT request mix; types are get_info, get_blocks.bin, "
+            "get_outs.bin, get_service_nodes and ons_resolve")
+        ("qps", po::value<double>()->default_value(100), "Offered requests per second")
+        ("duration", po::value<double>()->default_value(10), "Seconds to run each phase for")
+        ("connections", po::value<unsigned>()->default_value(8),
+            "HTTP connections (one request in flight on each); OMQ uses one connection")
+        ("height", po::value<uint64_t>(), "Chain height to pick get_blocks.bin start heights "
+            "below (default: from get_info)")
+        ("outputs", po::value<uint64_t>()->default_value(1000),
+            "Number of RingCT outputs in the chain, to pick get_outs.bin indices below")
+        ("ons-name-hash", po::value<std::string>(),
+            "Base64 name hash for ons_resolve (default: random, i.e. lookup misses)")
+        ("daemon-pid", po::value<int>(), "oxend pid; if given, each request type is also run on "
+            "its own to attribute daemon CPU time per request")
+        ("json", po::value<std::string>(), "Also write the results to this file as JSON");
+    // clang-format on
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n\n" << desc << "\n";
+        return 1;
+    }
+    if (vm.count("help") || vm.count("http") == vm.count("omq")) {
+        std::cerr << "Usage: " << argv[0] << " {--http URL|--omq ADDRESS} [options]\n\n"
+                  << desc << "\n";
+        return vm.count("help") ? 0 : 1;
+    }
+
+    options opts;
+    try {
+        if (vm.count("http"))
+            opts.http = vm["http"].as<std::string>();
+        else
+            opts.omq = vm["omq"].as<std::string>();
+        opts.mix = parse_mix(vm["mix"].as<std::string>());
+        opts.qps = vm["qps"].as<double>();
+        opts.duration = std::chrono::milliseconds{
+                static_cast<int64_t>(vm["duration"].as<double>() * 1000)};
+        opts.connections = std::max(1u, vm["connections"].as<unsigned>());
+        opts.output_count = vm["outputs"].as<uint64_t>();
+        if (vm.count("ons-name-hash"))
+            opts.ons_name_hash = vm["ons-name-hash"].as<std::string>();
+        if (vm.count("daemon-pid"))
+            opts.daemon_pid = vm["daemon-pid"].as<int>();
+        if (opts.qps <= 0 || opts.duration <= 0ms)
+            throw std::invalid_argument{"--qps and --duration must be positive"};
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid options: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::optional<oxenmq::OxenMQ> omq;
+    oxenmq::ConnectionID conn;
+    try {
+        nlohmann::json info;
+        if (!opts.omq.empty()) {
+            omq.emplace();
+            omq->start();
+            std::promise<void> connected;
+            conn = omq->connect_remote(
+                    oxenmq::address{opts.omq},
+                    [&](auto) { connected.set_value(); },
+                    [&](auto, std::string_view reason) {
+                        connected.set_exception(std::make_exception_ptr(
+                                std::runtime_error{"Failed to connect: {}"_format(reason)}));
+                    });
+            connected.get_future().get();
+            std::promise<nlohmann::json> info_p;
+            omq->request(conn, "rpc.get_info", [&](bool ok, std::vector<std::string> data) {
+                if (ok && data.size() >= 2 && data[0] == "200")
+                    info_p.set_value(nlohmann::json::parse(data[1]));
+                else
+                    info_p.set_exception(std::make_exception_ptr(
+                            std::runtime_error{"get_info request failed"}));
+            });
+            info = info_p.get_future().get();
+        } else {
+            info = cryptonote::rpc::http_client{opts.http}.json_rpc("get_info");
+        }
+        opts.chain_height =
+                vm.count("height") ? vm["height"].as<uint64_t>() : info["height"].get<uint64_t>();
+    } catch (const std::exception& e) {
+        std::cerr << "Unable to query the daemon: " << e.what() << "\n";
+        return 1;
+    }
+
+    fmt::print(
+            "Offering {} requests/s over {} for {}s per phase against a chain of height {}\n\n",
+            opts.qps,
+            opts.omq.empty() ? "HTTP" : "OMQ",
+            opts.duration.count() / 1000.0,
+            opts.chain_height);
+
+    request_factory factory{opts};
+    load_runner runner{opts, factory, omq ? &*omq : nullptr, conn};
+    nlohmann::json report{
+            {"transport", opts.omq.empty() ? "http" : "omq"},
+            {"qps", opts.qps},
+            {"duration_s", opts.duration.count() / 1000.0},
+            {"chain_height", opts.chain_height}};
+
+    fmt::print("Mixed load:\n");
+    double cpu_before = process_cpu_seconds(opts.daemon_pid);
+    auto mixed = runner.run(opts.mix);
+    double cpu_after = process_cpu_seconds(opts.daemon_pid);
+    report["mixed"] = summarize(mixed, opts.duration);
+    if (cpu_before >= 0 && cpu_after >= 0)
+        report["mixed_server_cpu_s"] = cpu_after - cpu_before;
+    print_table(report["mixed"]);
+
+    if (opts.daemon_pid) {
+        // The daemon's CPU time can't be split between request types that run at the same time,
+        // so give each type a phase of its own.
+        fmt::print("\nEach request type alone:\n");
+        std::map<req_type, type_results> alone;
+        for (auto& [t, w] : opts.mix) {
+            cpu_before = process_cpu_seconds(opts.daemon_pid);
+            auto r = runner.run({{t, 1.0}});
+            cpu_after = process_cpu_seconds(opts.daemon_pid);
+            alone[t] = std::move(r[t]);
+            if (cpu_before >= 0 && cpu_after >= 0)
+                alone[t].server_cpu_seconds = cpu_after - cpu_before;
+        }
+        report["alone"] = summarize(alone, opts.duration);
+        print_table(report["alone"]);
+    }
+
+    if (vm.count("json")) {
+        std::ofstream out{vm["json"].as<std::string>()};
+        out << report.dump(2) << '\n';
+        if (!out) {
+            std::cerr << "Failed to write " << vm["json"].as<std::string>() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "blockchain_db/sqlite/address_activity.h"
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/oxen_name_system.h"
+
+namespace {
+
+using namespace cryptonote;
+
+constexpr auto NETTYPE = network_type::FAKECHAIN;
+
+struct test_chain {
+    AddressActivityDB db{NETTYPE, ":memory:"};
+    uint64_t next_txid = 1;
+
+    void add(std::vector<transaction> txs = {}) {
+        block blk{};
+        blk.major_version = hf::hf19_reward_batching;
+        blk.miner_tx.emplace();
+        blk.miner_tx->vin.emplace_back(txin_gen{db.height()});
+        for (size_t i = 0; i < txs.size(); i++) {
+            crypto::hash txid{};
+            std::memcpy(txid.data(), &next_txid, sizeof(next_txid));
+            next_txid++;
+            blk.tx_hashes.push_back(txid);
+        }
+        db.add_block(blk, txs);
+    }
+};
+
+account_public_address make_address() {
+    account_base acc;
+    acc.generate();
+    return acc.get_keys().m_account_address;
+}
+
+std::string address_str(const account_public_address& addr) {
+    return get_account_address_as_str(NETTYPE, false, addr);
+}
+
+transaction make_stake(
+        const crypto::public_key& sn,
+        const account_public_address& addr,
+        const crypto::key_image& ki) {
+    transaction tx{};
+    add_service_node_pubkey_to_tx_extra(tx.extra, sn);
+    add_service_node_contributor_to_tx_extra(tx.extra, addr);
+    tx_extra_tx_key_image_proofs proofs;
+    proofs.proofs.push_back({ki, {}});
+    add_tx_key_image_proofs_to_tx_extra(tx.extra, proofs);
+    return tx;
+}
+
+transaction make_unlock(const crypto::public_key& sn, const crypto::key_image& ki) {
+    transaction tx{};
+    add_service_node_pubkey_to_tx_extra(tx.extra, sn);
+    add_tx_key_image_unlock_to_tx_extra(
+            tx.extra, {ki, {}, tx_extra_tx_key_image_unlock::FAKE_NONCE});
+    return tx;
+}
+
+transaction make_ons(const tx_extra_oxen_name_system& ons) {
+    transaction tx{};
+    add_oxen_name_system_to_tx_extra(tx.extra, ons);
+    return tx;
+}
+
+}  // namespace
+
+TEST(address_activity, stake_and_unlock) {
+    test_chain chain;
+    auto alice = make_address(), bob = make_address();
+    crypto::public_key sn{};
+    sn.data()[0] = 1;
+    crypto::key_image ki_a{}, ki_b{};
+    ki_a.data()[0] = 1;
+    ki_b.data()[0] = 2;
+
+    chain.add();
+    chain.add({make_stake(sn, alice, ki_a), make_stake(sn, bob, ki_b)});
+    chain.add();
+    chain.add({make_unlock(sn, ki_b)});
+    EXPECT_EQ(chain.db.height(), 4);
+
+    auto a = chain.db.get_activity(address_str(alice));
+    ASSERT_EQ(a.size(), 1);
+    EXPECT_EQ(a[0].type, "sn_stake");
+    EXPECT_EQ(a[0].height, 1);
+    EXPECT_EQ(a[0].subject, tools::hex_guts(sn));
+
+    auto b = chain.db.get_activity(address_str(bob));
+    ASSERT_EQ(b.size(), 2);
+    EXPECT_EQ(b[0].type, "sn_stake");
+    EXPECT_EQ(b[1].type, "sn_unlock");
+    EXPECT_EQ(b[1].height, 3);
+    EXPECT_GT(b[1].id, b[0].id);
+
+    // Pagination
+    auto page = chain.db.get_activity(address_str(bob), 0, 1);
+    ASSERT_EQ(page.size(), 1);
+    EXPECT_EQ(page[0].type, "sn_stake");
+    page = chain.db.get_activity(address_str(bob), page[0].id, 1);
+    ASSERT_EQ(page.size(), 1);
+    EXPECT_EQ(page[0].type, "sn_unlock");
+    EXPECT_TRUE(chain.db.get_activity(address_str(bob), page[0].id).empty());
+}
+
+TEST(address_activity, ons_owners) {
+    test_chain chain;
+    auto alice = make_address(), carol = make_address();
+    crypto::hash name_hash{};
+    name_hash.data()[0] = 42;
+
+    auto alice_owner = ons::make_monero_owner(alice, false);
+    auto carol_owner = ons::make_monero_owner(carol, false);
+    chain.add({make_ons(tx_extra_oxen_name_system::make_buy(
+            alice_owner, nullptr, ons::mapping_type::session, name_hash, "value", {}))});
+    chain.add({make_ons(tx_extra_oxen_name_system::make_update(
+            {}, ons::mapping_type::session, name_hash, "", &carol_owner, nullptr, {}))});
+
+    auto a = chain.db.get_activity(address_str(alice));
+    ASSERT_EQ(a.size(), 2);
+    EXPECT_EQ(a[0].type, "ons_buy");
+    EXPECT_EQ(a[0].subject, tools::hex_guts(name_hash));
+    EXPECT_EQ(a[1].type, "ons_update");
+
+    auto c = chain.db.get_activity(address_str(carol));
+    ASSERT_EQ(c.size(), 1);
+    EXPECT_EQ(c[0].type, "ons_update");
+    EXPECT_EQ(c[0].height, 1);
+}
+
+TEST(address_activity, detach) {
+    test_chain chain;
+    auto alice = make_address();
+    crypto::public_key sn{};
+    crypto::key_image ki{};
+    ki.data()[0] = 7;
+
+    chain.add({make_stake(sn, alice, ki)});
+    chain.add({make_unlock(sn, ki)});
+    ASSERT_EQ(chain.db.get_activity(address_str(alice)).size(), 2);
+
+    chain.db.blockchain_detached(1);
+    EXPECT_EQ(chain.db.height(), 1);
+    EXPECT_EQ(chain.db.get_activity(address_str(alice)).size(), 1);
+
+    // Detaching the stake forgets the key image as well, so a replacement chain's unlock of it
+    // isn't attributed to anyone.
+    chain.db.blockchain_detached(0);
+    EXPECT_TRUE(chain.db.get_activity(address_str(alice)).empty());
+    chain.add();
+    chain.add({make_unlock(sn, ki)});
+    EXPECT_TRUE(chain.db.get_activity(address_str(alice)).empty());
+
+    // Adding a block beyond the next height is refused
+    block blk{};
+    blk.major_version = hf::hf19_reward_batching;
+    blk.miner_tx.emplace();
+    blk.miner_tx->vin.emplace_back(txin_gen{10});
+    EXPECT_THROW(chain.db.add_block(blk, {}), std::invalid_argument);
+}
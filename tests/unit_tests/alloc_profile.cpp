@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "common/alloc_profile.h"
+
+namespace {
+
+const tools::alloc_profile::tag_stats* find_tag(
+        const std::vector<tools::alloc_profile::tag_stats>& stats, std::string_view name) {
+    for (const auto& s : stats)
+        if (s.name == name)
+            return &s;
+    return nullptr;
+}
+
+}  // namespace
+
+TEST(alloc_profile, tags) {
+    namespace ap = tools::alloc_profile;
+    auto a = ap::detail::register_tag("test_a");
+    EXPECT_NE(a, 0);
+    EXPECT_EQ(ap::detail::register_tag("test_a"), a);
+    EXPECT_NE(ap::detail::register_tag("test_b"), a);
+
+    EXPECT_EQ(ap::detail::current, 0);
+    {
+        ap::scope s{a};
+        EXPECT_EQ(ap::detail::current, a);
+        {
+            ap::scope inner{0};
+            EXPECT_EQ(ap::detail::current, 0);
+        }
+        EXPECT_EQ(ap::detail::current, a);
+    }
+    EXPECT_EQ(ap::detail::current, 0);
+}
+
+TEST(alloc_profile, counts) {
+    namespace ap = tools::alloc_profile;
+    if (!ap::compiled()) {
+        EXPECT_TRUE(ap::stats().empty());
+        GTEST_SKIP() << "allocation profiling is not compiled in";
+    }
+
+    auto tag = ap::detail::register_tag("test_counts");
+    std::unique_ptr<char[]> kept;
+    {
+        ap::scope s{tag};
+        kept = std::make_unique<char[]>(1000);
+        auto freed = std::make_unique<char[]>(500);
+    }
+    auto stats = ap::stats();
+    auto* s = find_tag(stats, "test_counts");
+    ASSERT_TRUE(s);
+    EXPECT_EQ(s->allocs, 2);
+    EXPECT_EQ(s->bytes, 1500);
+    EXPECT_EQ(s->live_allocs, 1);
+    EXPECT_EQ(s->live_bytes, 1000);
+
+    // Freed outside the scope, but still counted against the tag it was allocated under
+    kept.reset();
+    stats = ap::stats();
+    s = find_tag(stats, "test_counts");
+    ASSERT_TRUE(s);
+    EXPECT_EQ(s->live_allocs, 0);
+    EXPECT_EQ(s->live_bytes, 0);
+    EXPECT_EQ(s->alloc_rate, 0);
+}
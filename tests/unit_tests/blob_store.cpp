@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "blockchain_db/blob_store.h"
+#include "random_path.h"
+
+#ifndef _WIN32
+
+namespace {
+
+struct temp_dir {
+    fs::path path = random_tmp_file();
+    ~temp_dir() {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+};
+
+}  // namespace
+
+TEST(blob_store, append_and_get) {
+    temp_dir dir;
+    cryptonote::blob_store store{dir.path, false, 64};
+
+    std::string a(40, 'a'), b(30, 'b'), c(100, 'c');
+    auto la = store.append(a);
+    auto lb = store.append(b);  // doesn't fit after a, so starts segment 1
+    auto lc = store.append(c);  // bigger than a whole segment: gets its own
+    EXPECT_EQ(la.segment, 0);
+    EXPECT_EQ(la.offset, 0);
+    EXPECT_EQ(lb.segment, 1);
+    EXPECT_EQ(lc.segment, 2);
+    EXPECT_EQ(lc.size, 100);
+
+    EXPECT_EQ(store.get(la), a);
+    EXPECT_EQ(store.get(lb), b);
+    EXPECT_EQ(store.get(lc), c);
+    EXPECT_EQ(store.filenames().size(), 3);
+
+    auto bad = lb;
+    bad.offset = 20;
+    EXPECT_THROW(store.get(bad), std::out_of_range);
+    bad.segment = 7;
+    EXPECT_THROW(store.get(bad), std::out_of_range);
+}
+
+TEST(blob_store, reopen) {
+    temp_dir dir;
+    cryptonote::blob_location la, lb;
+    {
+        cryptonote::blob_store store{dir.path, false, 64};
+        la = store.append("hello");
+        lb = store.append("world");
+        store.sync();
+    }
+
+    cryptonote::blob_store store{dir.path, false, 64};
+    EXPECT_EQ(store.get(la), "hello");
+    EXPECT_EQ(store.get(lb), "world");
+
+    // Appends continue in the last segment
+    auto lc = store.append("again");
+    EXPECT_EQ(lc.segment, 0);
+    EXPECT_EQ(lc.offset, 10);
+
+    // A read-only store picks up segments written after it was opened
+    cryptonote::blob_store reader{dir.path, true, 64};
+    EXPECT_EQ(reader.get(lc), "again");
+    auto ld = store.append(std::string(60, 'd'));
+    EXPECT_EQ(ld.segment, 1);
+    EXPECT_EQ(reader.get(ld), std::string(60, 'd'));
+    EXPECT_THROW(reader.append("x"), std::runtime_error);
+
+    store.clear();
+    EXPECT_TRUE(store.filenames().empty());
+    EXPECT_THROW(store.get(la), std::out_of_range);
+    EXPECT_EQ(store.append("new").segment, 0);
+}
+
+#endif
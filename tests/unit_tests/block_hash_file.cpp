@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <sodium/crypto_sign.h>
+
+#include <fstream>
+#include <vector>
+
+#include "cryptonote_core/block_hash_file.h"
+#include "random_path.h"
+
+using cryptonote::block_hash_file;
+using cryptonote::network_type;
+
+namespace {
+
+struct temp_file {
+  fs::path path = random_tmp_file();
+  ~temp_file() {
+    std::error_code ec;
+    fs::remove(path, ec);
+  }
+  void write(const std::string& data) {
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out << data;
+  }
+};
+
+std::vector<crypto::hash> make_hashes(size_t n) {
+  std::vector<crypto::hash> hashes(n);
+  for (size_t i = 0; i < n; i++)
+    hashes[i].data()[0] = static_cast<unsigned char>(i + 1);
+  return hashes;
+}
+
+}  // namespace
+
+TEST(block_hash_file, unsigned_roundtrip) {
+  temp_file f;
+  auto hashes = make_hashes(5);
+  f.write(block_hash_file::serialize(network_type::TESTNET, hashes));
+
+  block_hash_file file{f.path, network_type::TESTNET};
+  ASSERT_EQ(file.size(), 5);
+  EXPECT_EQ(file.covered_height(), 5 * cryptonote::HASH_OF_HASHES_STEP);
+  EXPECT_FALSE(file.is_signed());
+  for (size_t i = 0; i < hashes.size(); i++)
+    EXPECT_EQ(file[i], hashes[i]);
+
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET), std::runtime_error);
+
+  // A signer was required but the file isn't signed
+  crypto::ed25519_public_key pk;
+  crypto::ed25519_secret_key sk;
+  crypto_sign_keypair(pk.data(), sk.data());
+  EXPECT_THROW(block_hash_file(f.path, network_type::TESTNET, &pk), std::runtime_error);
+}
+
+TEST(block_hash_file, signed_file) {
+  crypto::ed25519_public_key pk, other_pk;
+  crypto::ed25519_secret_key sk, other_sk;
+  crypto_sign_keypair(pk.data(), sk.data());
+  crypto_sign_keypair(other_pk.data(), other_sk.data());
+
+  temp_file f;
+  auto hashes = make_hashes(3);
+  auto data = block_hash_file::serialize(network_type::MAINNET, hashes, &sk);
+  f.write(data);
+
+  block_hash_file file{f.path, network_type::MAINNET, &pk};
+  EXPECT_TRUE(file.is_signed());
+  ASSERT_EQ(file.size(), 3);
+  EXPECT_EQ(file[2], hashes[2]);
+
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET, &other_pk), std::runtime_error);
+
+  // Tampering with a hash breaks the signature
+  data[block_hash_file::HEADER_SIZE + 40] ^= 1;
+  f.write(data);
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET, &pk), std::runtime_error);
+}
+
+TEST(block_hash_file, malformed) {
+  temp_file f;
+  auto data = block_hash_file::serialize(network_type::MAINNET, make_hashes(2));
+
+  f.write(data.substr(0, data.size() - 1));
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET), std::runtime_error);
+
+  f.write(data.substr(0, 10));
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET), std::runtime_error);
+
+  auto bad_magic = data;
+  bad_magic[0] = 'X';
+  f.write(bad_magic);
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET), std::runtime_error);
+
+  auto bad_version = data;
+  bad_version[8] = 2;
+  f.write(bad_version);
+  EXPECT_THROW(block_hash_file(f.path, network_type::MAINNET), std::runtime_error);
+
+  EXPECT_THROW(block_hash_file(f.path.string() + ".missing", network_type::MAINNET),
+               std::runtime_error);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include "cryptonote_core/block_processing_stats.h"
+
+using namespace std::literals;
+
+namespace {
+
+cryptonote::block_processing_record make_record(uint64_t height) {
+    cryptonote::block_processing_record r{};
+    r.height = height;
+    r.txs = 2;
+    r.times.db_add = 3ms;
+    r.times.quorum_cop = 1ms;
+    r.times.total = 5ms;
+    return r;
+}
+
+}  // namespace
+
+TEST(block_processing_stats, recent_is_bounded) {
+    cryptonote::block_processing_stats stats{3};
+    EXPECT_TRUE(stats.recent().empty());
+
+    for (uint64_t h = 10; h < 15; h++)
+        stats.add(make_record(h));
+
+    auto recent = stats.recent();
+    ASSERT_EQ(recent.size(), 3);
+    EXPECT_EQ(recent[0].height, 12);
+    EXPECT_EQ(recent[2].height, 14);
+
+    recent = stats.recent(1);
+    ASSERT_EQ(recent.size(), 1);
+    EXPECT_EQ(recent[0].height, 14);
+    EXPECT_EQ(stats.recent(0).size(), 0);
+}
+
+TEST(block_processing_stats, totals_cover_evicted_blocks) {
+    cryptonote::block_processing_stats stats{2};
+    for (uint64_t h = 0; h < 4; h++)
+        stats.add(make_record(h));
+
+    auto totals = stats.totals();
+    EXPECT_EQ(totals.blocks, 4);
+    EXPECT_EQ(totals.txs, 8);
+    EXPECT_EQ(totals.times.db_add, 12ms);
+    EXPECT_EQ(totals.times.quorum_cop, 4ms);
+    EXPECT_EQ(totals.times.checkpoints, 0ms);
+    EXPECT_EQ(totals.times.total, 20ms);
+}
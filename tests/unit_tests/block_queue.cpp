@@ -31,6 +31,7 @@
 #include "crypto/crypto.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_protocol/block_queue.h"
+#include "random_path.h"
 
 template <size_t I>
 static const epee::connection_id_t& uuid()
@@ -80,3 +81,73 @@ TEST(block_queue, flush_uuid)
   bq.add_blocks(0, 200, uuid<1>(), std::chrono::steady_clock::now());
   ASSERT_EQ(bq.get_max_block_height(), 399);
 }
+
+TEST(block_queue, span_length)
+{
+  cryptonote::block_queue bq;
+  const uint64_t target_secs = std::chrono::seconds{cryptonote::block_queue::SPAN_TARGET_TIME}.count();
+
+  // unmeasured peers get the default
+  ASSERT_EQ(bq.get_span_length(uuid<1>(), 100, 500), 100);
+  ASSERT_FALSE(bq.get_expected_span_time(uuid<1>(), 100));
+
+  // 100 blocks of 1kB in 1s: the target time fits 100 blocks per second
+  bq.add_peer_measurement(uuid<1>(), 100, 100 * 1024, std::chrono::seconds{1});
+  ASSERT_EQ(bq.get_span_length(uuid<1>(), 100, 1000), 100 * target_secs);
+  ASSERT_EQ(bq.get_span_length(uuid<1>(), 100, 200), 200);
+  auto expected = bq.get_expected_span_time(uuid<1>(), 300);
+  ASSERT_TRUE(expected);
+  ASSERT_NEAR(std::chrono::duration<double>{*expected}.count(), 3.0, 1e-6);
+
+  // a very slow peer still gets the minimum
+  bq.add_peer_measurement(uuid<2>(), 10, 10 * 1024, std::chrono::seconds{60});
+  ASSERT_EQ(bq.get_span_length(uuid<2>(), 100, 500), cryptonote::block_queue::MIN_SPAN_BLOCKS);
+
+  // measurements are dropped along with the connection
+  bq.flush_stale_spans({uuid<1>()});
+  ASSERT_TRUE(bq.get_expected_span_time(uuid<1>(), 1));
+  ASSERT_FALSE(bq.get_expected_span_time(uuid<2>(), 1));
+  bq.flush_spans(uuid<1>(), true);
+  ASSERT_EQ(bq.get_span_length(uuid<1>(), 100, 500), 100);
+}
+
+TEST(block_queue, spill)
+{
+  const auto dir = random_tmp_file();
+  auto span_of = [](char c) {
+    std::vector<cryptonote::block_complete_entry> bcel(1);
+    bcel[0].block = std::string(80, c);
+    bcel[0].txs.push_back(std::string(20, c));
+    return bcel;
+  };
+  {
+    cryptonote::block_queue bq;
+    bq.set_memory_limit(150, dir);
+    bq.add_blocks(0, span_of('a'), uuid<1>(), 1000.f, 100);
+    bq.add_blocks(1, span_of('b'), uuid<1>(), 1000.f, 100);
+    bq.add_blocks(2, span_of('c'), uuid<1>(), 1000.f, 100);
+
+    // everything but the first span got written out
+    ASSERT_EQ(bq.get_num_filled_spans(), 3);
+    ASSERT_EQ(bq.get_data_size(), 300);
+    ASSERT_EQ(bq.get_memory_size(), 100);
+    ASSERT_EQ(std::distance(fs::directory_iterator{dir}, fs::directory_iterator{}), 2);
+
+    uint64_t height;
+    std::vector<cryptonote::block_complete_entry> bcel;
+    epee::connection_id_t connection_id;
+    ASSERT_TRUE(bq.remove_span(0));
+    ASSERT_TRUE(bq.get_next_span(height, bcel, connection_id));
+    ASSERT_EQ(height, 1);
+    ASSERT_EQ(bcel.size(), 1);
+    ASSERT_EQ(bcel[0].block, std::string(80, 'b'));
+    ASSERT_EQ(bcel[0].txs, std::vector<std::string>{std::string(20, 'b')});
+    ASSERT_EQ(connection_id, uuid<1>());
+
+    ASSERT_TRUE(bq.remove_span(1));
+    ASSERT_EQ(std::distance(fs::directory_iterator{dir}, fs::directory_iterator{}), 1);
+  }
+  // the queue cleans up after itself
+  ASSERT_EQ(std::distance(fs::directory_iterator{dir}, fs::directory_iterator{}), 0);
+  fs::remove_all(dir);
+}
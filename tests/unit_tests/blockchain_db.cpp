@@ -27,10 +27,13 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
+#include <mutex>
 #include <chrono>
 #include <random>
+#include <set>
 #include <thread>
 
 #include "gtest/gtest.h"
@@ -336,4 +339,302 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1].first), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, GetOutputKeysBulk)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, network_type::FAKECHAIN));
+  this->get_filenames();
+
+  db_wtxn_guard guard{*this->m_db};
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  std::set<uint64_t> distinct_amounts;
+  this->m_db->for_all_outputs([&](uint64_t amount, const crypto::hash&, uint64_t, size_t) {
+    distinct_amounts.insert(amount);
+    return true;
+  });
+  ASSERT_FALSE(distinct_amounts.empty());
+
+  // Request every output, shuffled and with repeats, so that the lookups (done in key order) have
+  // to be put back into request order
+  std::vector<std::pair<uint64_t, uint64_t>> requests;
+  for (uint64_t amount : distinct_amounts)
+  {
+    const uint64_t n = this->m_db->get_num_outputs(amount);
+    for (uint64_t i = 0; i < n; ++i)
+      requests.emplace_back(amount, i);
+    requests.emplace_back(amount, n - 1);
+  }
+  std::shuffle(requests.begin(), requests.end(), std::mt19937{42});
+  std::vector<uint64_t> amounts, offsets;
+  for (const auto& [amount, offset] : requests)
+  {
+    amounts.push_back(amount);
+    offsets.push_back(offset);
+  }
+
+  std::vector<output_data_t> outputs;
+  ASSERT_NO_THROW(this->m_db->get_output_key({amounts.data(), amounts.size()}, offsets, outputs));
+  ASSERT_EQ(outputs.size(), offsets.size());
+  for (size_t i = 0; i < offsets.size(); ++i)
+  {
+    const auto single = this->m_db->get_output_key(amounts[i], offsets[i]);
+    ASSERT_EQ(single.pubkey, outputs[i].pubkey);
+    ASSERT_EQ(single.commitment, outputs[i].commitment);
+    ASSERT_EQ(single.height, outputs[i].height);
+  }
+
+  // A missing output throws, or with allow_partial truncates the result at (in request order) the
+  // first missing output
+  const size_t missing_at = offsets.size() / 2;
+  offsets[missing_at] = this->m_db->get_num_outputs(amounts[missing_at]);
+  ASSERT_THROW(this->m_db->get_output_key({amounts.data(), amounts.size()}, offsets, outputs), OUTPUT_DNE);
+  ASSERT_NO_THROW(this->m_db->get_output_key({amounts.data(), amounts.size()}, offsets, outputs, true));
+  ASSERT_EQ(outputs.size(), missing_at);
+}
+
+TYPED_TEST(BlockchainDBTest, GetTxsData)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, network_type::FAKECHAIN));
+  this->get_filenames();
+
+  db_wtxn_guard guard{*this->m_db};
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  // Every tx (including the miner txes), in reverse, with a repeat and an unknown hash in the middle
+  std::vector<crypto::hash> hashes;
+  for (size_t b = 0; b < 2; ++b)
+  {
+    hashes.push_back(get_transaction_hash(this->m_blocks[b].first.miner_tx));
+    for (const auto& [tx, blob] : this->m_txs[b])
+      hashes.push_back(get_transaction_hash(tx));
+  }
+  std::reverse(hashes.begin(), hashes.end());
+  hashes.insert(hashes.begin() + hashes.size() / 2, crypto::hash{});
+  hashes.push_back(hashes.front());
+
+  std::vector<std::optional<tx_lookup>> batch, single;
+  ASSERT_NO_THROW(batch = this->m_db->get_txs_data(hashes));
+  // The generic implementation looks each tx up separately
+  ASSERT_NO_THROW(single = this->m_db->BlockchainDB::get_txs_data(hashes));
+  ASSERT_EQ(batch.size(), hashes.size());
+  ASSERT_EQ(single.size(), hashes.size());
+  for (size_t i = 0; i < hashes.size(); ++i)
+  {
+    ASSERT_EQ(batch[i].has_value(), hashes[i] != crypto::hash{});
+    ASSERT_EQ(single[i].has_value(), batch[i].has_value());
+    if (!batch[i])
+      continue;
+    EXPECT_EQ(batch[i]->hash, hashes[i]);
+    EXPECT_EQ(batch[i]->block_height, this->m_db->get_tx_block_height(hashes[i]));
+    EXPECT_EQ(batch[i]->pruned, single[i]->pruned);
+    EXPECT_EQ(batch[i]->prunable_hash, single[i]->prunable_hash);
+    EXPECT_EQ(batch[i]->prunable, single[i]->prunable);
+    EXPECT_EQ(batch[i]->output_indices, single[i]->output_indices);
+    std::string full;
+    ASSERT_TRUE(this->m_db->get_tx_blob(hashes[i], full));
+    EXPECT_EQ(batch[i]->pruned + batch[i]->prunable, full);
+  }
+}
+
+TYPED_TEST(BlockchainDBTest, ParallelIteration)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, network_type::FAKECHAIN));
+  this->get_filenames();
+
+  {
+    // The parallel scans read on other threads, so they only see committed data
+    db_wtxn_guard guard{*this->m_db};
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+  }
+
+  std::multiset<crypto::hash> serial, parallel;
+  std::mutex mutex;
+  this->m_db->for_all_transactions([&](const crypto::hash& h, const transaction&) {
+    serial.insert(h);
+    return true;
+  }, true);
+  ASSERT_FALSE(serial.empty());
+  // More shards than transactions, so that some are empty
+  ASSERT_TRUE(this->m_db->for_all_transactions_parallel([&](const crypto::hash& h, const transaction&) {
+    std::lock_guard lock{mutex};
+    parallel.insert(h);
+    return true;
+  }, true, 16));
+  ASSERT_EQ(serial, parallel);
+
+  // Stopping early is reported
+  ASSERT_FALSE(this->m_db->for_all_transactions_parallel([](const crypto::hash&, const transaction&) {
+    return false;
+  }, true, 4));
+
+  std::vector<uint64_t> heights;
+  ASSERT_TRUE(this->m_db->for_blocks_range_parallel(0, 1, [&](uint64_t height, const crypto::hash& hash, const block&) {
+    EXPECT_EQ(hash, get_block_hash(this->m_blocks[height].first));
+    heights.push_back(height);
+    return true;
+  }, true /*ordered*/, 4));
+  ASSERT_EQ(heights, (std::vector<uint64_t>{0, 1}));
+}
+
+TYPED_TEST(BlockchainDBTest, SpendingIndex)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, network_type::FAKECHAIN));
+  this->get_filenames();
+
+  ASSERT_FALSE(this->m_db->spending_index_height());
+  this->m_db->set_spending_index(true);
+  ASSERT_EQ(this->m_db->spending_index_height(), 0);
+
+  {
+    db_wtxn_guard guard{*this->m_db};
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+    ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+  }
+
+  const auto& miner_tx = *this->m_blocks[1].first.miner_tx;
+  const auto miner_hash = get_transaction_hash(miner_tx);
+  std::vector<crypto::public_key> miner_keys;
+  for (size_t i = 0; i < miner_tx.vout.size(); i++)
+  {
+    const auto& key = var::get<txout_to_key>(miner_tx.vout[i].target).key;
+    miner_keys.push_back(key);
+    auto found = this->m_db->get_output_key_tx(key);
+    ASSERT_TRUE(found);
+    ASSERT_HASH_EQ(miner_hash, found->first);
+    ASSERT_EQ(i, found->second);
+  }
+  ASSERT_FALSE(miner_keys.empty());
+
+  std::vector<crypto::key_image> spent;
+  for (const auto& [tx, blob] : this->m_txs[1])
+    for (const auto& in : tx.vin)
+      if (auto* in_to_key = std::get_if<txin_to_key>(&in))
+      {
+        spent.push_back(in_to_key->k_image);
+        auto found = this->m_db->get_spending_tx(in_to_key->k_image);
+        ASSERT_TRUE(found);
+        ASSERT_HASH_EQ(get_transaction_hash(tx), found->txid);
+        ASSERT_EQ(1, found->height);
+      }
+
+  // Popping the block forgets what it added
+  {
+    db_wtxn_guard guard{*this->m_db};
+    block blk;
+    std::vector<transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  }
+  for (const auto& key : miner_keys)
+    ASSERT_FALSE(this->m_db->get_output_key_tx(key));
+  for (const auto& ki : spent)
+    ASSERT_FALSE(this->m_db->get_spending_tx(ki));
+  const auto& genesis_key = var::get<txout_to_key>(this->m_blocks[0].first.miner_tx->vout[0].target).key;
+  ASSERT_TRUE(this->m_db->get_output_key_tx(genesis_key));
+
+  // Disabling drops the index
+  this->m_db->set_spending_index(false);
+  ASSERT_FALSE(this->m_db->spending_index_height());
+  ASSERT_FALSE(this->m_db->get_output_key_tx(genesis_key));
+  this->m_db->set_spending_index(true);
+  ASSERT_EQ(this->m_db->spending_index_height(), 1);
+  ASSERT_FALSE(this->m_db->get_output_key_tx(genesis_key));
+}
+
+TYPED_TEST(BlockchainDBTest, TxpoolWriteBehind)
+{
+  fs::path tempPath = random_tmp_file();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath, network_type::FAKECHAIN));
+  this->get_filenames();
+
+  // The db doesn't look inside the blobs, so these needn't be real txes
+  crypto::hash id1{}, id2{};
+  id1.data()[0] = 1;
+  id2.data()[0] = 2;
+  const std::string blob1 = "tx one", blob2 = "tx two";
+  txpool_tx_meta_t meta{};
+  meta.fee = 123;
+
+  // Changes are visible straight away, before and after being flushed
+  this->m_db->add_txpool_tx(id1, blob1, meta);
+  this->m_db->add_txpool_tx(id2, blob2, meta);
+  ASSERT_THROW(this->m_db->add_txpool_tx(id1, blob1, meta), DB_ERROR);
+  auto check = [&] {
+    ASSERT_EQ(2, this->m_db->get_txpool_tx_count());
+    ASSERT_TRUE(this->m_db->txpool_has_tx(id1));
+    txpool_tx_meta_t m;
+    ASSERT_TRUE(this->m_db->get_txpool_tx_meta(id2, m));
+    ASSERT_EQ(123, m.fee);
+    ASSERT_EQ(blob1, this->m_db->get_txpool_tx_blob(id1));
+    size_t n = 0;
+    this->m_db->for_all_txpool_txes([&](const auto& txid, const auto& m, const std::string* bd) {
+      EXPECT_EQ(txid == id1 ? blob1 : blob2, *bd);
+      n++;
+      return true;
+    }, true);
+    ASSERT_EQ(2, n);
+  };
+  check();
+  this->m_db->flush_txpool();
+  check();
+
+  // Pending changes to flushed txes
+  meta.fee = 456;
+  meta.do_not_relay = true;
+  this->m_db->update_txpool_tx(id2, meta);
+  this->m_db->remove_txpool_tx(id1);
+  auto check2 = [&] {
+    ASSERT_FALSE(this->m_db->txpool_has_tx(id1));
+    ASSERT_EQ(1, this->m_db->get_txpool_tx_count());
+    ASSERT_EQ(0, this->m_db->get_txpool_tx_count(false));
+    txpool_tx_meta_t m;
+    ASSERT_TRUE(this->m_db->get_txpool_tx_meta(id2, m));
+    ASSERT_EQ(456, m.fee);
+    ASSERT_EQ(blob2, this->m_db->get_txpool_tx_blob(id2));
+    std::string bd;
+    ASSERT_FALSE(this->m_db->get_txpool_tx_blob(id1, bd));
+    ASSERT_THROW(this->m_db->update_txpool_tx(id1, m), DB_ERROR);
+  };
+  check2();
+  this->m_db->flush_txpool();
+  check2();
+
+  // Closing writes out whatever is still pending
+  this->m_db->remove_txpool_tx(id2);
+  this->m_db->add_txpool_tx(id1, blob1, meta);
+  ASSERT_NO_THROW(this->m_db->close());
+  ASSERT_NO_THROW(this->m_db->open(dirPath, network_type::FAKECHAIN));
+  ASSERT_TRUE(this->m_db->txpool_has_tx(id1));
+  ASSERT_FALSE(this->m_db->txpool_has_tx(id2));
+  ASSERT_EQ(1, this->m_db->get_txpool_tx_count());
+}
+
 }  // anonymous namespace
@@ -2,7 +2,9 @@
 #include <gtest/gtest.h>
 #include <oxenc/hex.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "bls/bls_crypto.h"
 #include "common/guts.h"
@@ -137,3 +139,29 @@ TEST(BLS, signatures) {
     EXPECT_TRUE(eth::verify(devnet, sig3, pk, hash2));
     EXPECT_FALSE(eth::verify(devnet, sig3b, pk, hash2));
 }
+
+TEST(BLS, verify_batch) {
+    constexpr auto mainnet = cryptonote::network_type::MAINNET;
+    auto msg = crypto::keccak("hello world!"sv);
+    auto other_msg = crypto::keccak("Hello World!\n"sv);
+
+    std::vector<eth::bls_signature> sigs;
+    std::vector<eth::bls_public_key> pks;
+    for (int i = 0; i < 9; i++) {
+        auto sk = eth::generate_bls_key();
+        pks.push_back(get_pubkey(sk));
+        sigs.push_back(eth::sign(mainnet, sk, i == 3 ? other_msg : msg));
+    }
+    std::swap(sigs[5], sigs[6]);  // Valid signatures, but from the wrong keys
+    *(sigs[8].data() + 25) = 0x42;
+
+    auto valid = eth::verify_batch(mainnet, sigs, pks, msg);
+    ASSERT_EQ(valid.size(), sigs.size());
+    for (size_t i = 0; i < sigs.size(); i++)
+        EXPECT_EQ(valid[i], eth::verify(mainnet, sigs[i], pks[i], msg)) << "signature " << i;
+    EXPECT_EQ(std::count(valid.begin(), valid.end(), true), 5);
+
+    EXPECT_TRUE(eth::verify_batch(mainnet, {}, {}, msg).empty());
+    EXPECT_THROW(
+            eth::verify_batch(mainnet, sigs, std::span{pks}.first(2), msg), std::invalid_argument);
+}
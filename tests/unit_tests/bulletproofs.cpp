@@ -31,6 +31,7 @@
 #include "gtest/gtest.h"
 
 #include "common/guts.h"
+#include "common/threadpool.h"
 #include "epee/string_tools.h"
 #include "ringct/rctOps.h"
 #include "ringct/rctSigs.h"
@@ -77,6 +78,32 @@ TEST(bulletproofs, valid_multi_random)
   }
 }
 
+TEST(bulletproofs, valid_max_outputs_threaded)
+{
+  // Large proofs use the thread pool internally; make sure that works both when called directly
+  // and when called from inside thread pool jobs (where nested jobs run inline).
+  auto make_proof = [] {
+    std::vector<uint64_t> amounts;
+    rct::keyV gamma;
+    for (size_t i = 0; i < cryptonote::TX_BULLETPROOF_MAX_OUTPUTS; ++i)
+    {
+      amounts.push_back(crypto::rand<uint64_t>());
+      gamma.push_back(rct::skGen());
+    }
+    return bulletproof_PROVE(amounts, gamma);
+  };
+  ASSERT_TRUE(rct::bulletproof_VERIFY(make_proof()));
+
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  std::vector<rct::Bulletproof> proofs(4);
+  for (auto &proof : proofs)
+    tpool.submit(&waiter, [&proof, &make_proof] { proof = make_proof(); });
+  waiter.wait(&tpool);
+  for (const auto &proof : proofs)
+    ASSERT_TRUE(rct::bulletproof_VERIFY(proof));
+}
+
 TEST(bulletproofs, multi_splitting)
 {
   rct::ctkeyV sc, pc;
@@ -297,6 +324,12 @@ TEST(bulletproof, weight_pruned)
     ASSERT_TRUE(tx.version == cryptonote::txversion::v2_ringct);
     ASSERT_FALSE(tx.pruned);
     ASSERT_TRUE(rct::is_rct_bulletproof(tx.rct_signatures.type));
+    // The hashes taken straight from the blob must match those of the reserialized tx
+    crypto::hash calc_hash;
+    ASSERT_TRUE(cryptonote::calculate_transaction_hash(tx, calc_hash, nullptr));
+    ASSERT_EQ(tx_hash, calc_hash);
+    ASSERT_EQ(tx_prefix_hash, cryptonote::get_transaction_prefix_hash(
+        static_cast<const cryptonote::transaction_prefix&>(tx)));
     const uint64_t tx_size = bd.size();
     const uint64_t tx_weight = cryptonote::get_transaction_weight(tx);
     ASSERT_TRUE(parse_and_validate_tx_base_from_blob(bd, pruned_tx));
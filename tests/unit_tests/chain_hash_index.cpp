@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "blockchain_db/testdb.h"
+#include "cryptonote_core/chain_hash_index.h"
+
+namespace {
+
+crypto::hash make_hash(uint64_t height, uint8_t fork = 0) {
+    crypto::hash h{};
+    std::memcpy(h.data(), &height, sizeof(height));
+    h.data()[8] = fork;
+    return crypto::cn_fast_hash(h.data(), h.size());
+}
+
+// A main chain of `chain.size()` blocks; counts the hashes it gets asked for
+class TestDB : public cryptonote::BaseTestDB {
+  public:
+    std::vector<crypto::hash> chain;
+    mutable size_t lookups = 0;
+
+    void extend(uint64_t height, uint8_t fork = 0) {
+        while (chain.size() < height)
+            chain.push_back(make_hash(chain.size(), fork));
+    }
+
+    uint64_t height() const override { return chain.size(); }
+    crypto::hash get_block_hash_from_height(const uint64_t& height) const override {
+        lookups++;
+        return chain.at(height);
+    }
+    std::vector<crypto::hash> get_hashes_range(
+            const uint64_t& h1, const uint64_t& h2) const override {
+        lookups += h2 - h1 + 1;
+        return {chain.begin() + h1, chain.begin() + h2 + 1};
+    }
+};
+
+}  // namespace
+
+TEST(chain_hash_index, sync) {
+    TestDB db;
+    cryptonote::chain_hash_index index;
+    db.extend(2 * cryptonote::chain_hash_index::LOAD_BATCH + 5);
+    index.sync(db);
+    ASSERT_EQ(index.size(), db.chain.size());
+    EXPECT_EQ(db.lookups, db.chain.size());
+    for (uint64_t h = 0; h < db.chain.size(); h++) {
+        ASSERT_EQ(index[h], db.chain[h]);
+        ASSERT_EQ(index.height(db.chain[h]), h);
+    }
+    EXPECT_FALSE(index.height(make_hash(0, 1)));
+
+    // Once up to date a sync just checks the last hash, and new blocks are loaded from there
+    db.lookups = 0;
+    index.sync(db);
+    EXPECT_EQ(db.lookups, 1);
+    db.extend(db.chain.size() + 3);
+    index.sync(db);
+    EXPECT_EQ(db.lookups, 5);
+    EXPECT_EQ(index.height(db.chain.back()), db.chain.size() - 1);
+}
+
+TEST(chain_hash_index, detach) {
+    TestDB db;
+    cryptonote::chain_hash_index index;
+    db.extend(100);
+    index.sync(db);
+
+    db.chain.resize(90);
+    index.blockchain_detached(90);
+    db.extend(95, 1);
+    index.sync(db);
+    EXPECT_EQ(index.size(), 95);
+    EXPECT_EQ(index.height(make_hash(89)), 89);
+    EXPECT_FALSE(index.height(make_hash(90)));
+    EXPECT_EQ(index.height(make_hash(90, 1)), 90);
+
+    // Blocks replaced without a detach (as by an aborted db batch) are noticed and reloaded, even
+    // when the chain ends up at the same height
+    db.chain.resize(80);
+    db.extend(95, 2);
+    index.sync(db);
+    EXPECT_EQ(index.size(), 95);
+    EXPECT_EQ(index.height(make_hash(79)), 79);
+    EXPECT_FALSE(index.height(make_hash(80, 1)));
+    EXPECT_EQ(index.height(make_hash(94, 2)), 94);
+    db.chain.resize(50);
+    index.sync(db);
+    EXPECT_EQ(index.size(), 50);
+    EXPECT_FALSE(index.height(make_hash(60)));
+}
+
+TEST(chain_hash_index, colliding_slots) {
+    // Hashes that all want the same slot, to check that removal keeps the rest of the probe run
+    // reachable
+    cryptonote::chain_hash_index index;
+    std::vector<crypto::hash> hashes;
+    for (uint8_t i = 0; i < 50; i++) {
+        crypto::hash h{};
+        h.data()[31] = i;
+        hashes.push_back(h);
+        index.push_back(h);
+    }
+    for (uint64_t height : {45, 30, 10, 1}) {
+        index.blockchain_detached(height);
+        for (uint64_t h = 0; h < hashes.size(); h++)
+            if (h < height)
+                ASSERT_EQ(index.height(hashes[h]), h);
+            else
+                ASSERT_FALSE(index.height(hashes[h]));
+    }
+    index.push_back(hashes[5]);
+    EXPECT_EQ(index.height(hashes[5]), 1);
+    index.clear();
+    EXPECT_EQ(index.size(), 0);
+    EXPECT_FALSE(index.height(hashes[0]));
+}
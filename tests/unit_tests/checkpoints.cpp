@@ -280,7 +280,7 @@ TEST(checkpoints_is_alternative_block_allowed, override_1_sn_checkpoint)
   checkpoint_t checkpoint = {};
   checkpoint.type         = checkpoint_type::service_node;
   checkpoint.height       = 5;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   ASSERT_TRUE(cp.is_alternative_block_allowed(4, 4));
   ASSERT_TRUE(cp.is_alternative_block_allowed(4, 5));
@@ -303,10 +303,10 @@ TEST(checkpoints_is_alternative_block_allowed, cant_override_2nd_oldest_sn_check
   checkpoint_t checkpoint = {};
   checkpoint.type         = checkpoint_type::service_node;
   checkpoint.height       = 5;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   checkpoint.height       = 10;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
 
   ASSERT_TRUE(cp.is_alternative_block_allowed(4, 4));
@@ -334,10 +334,10 @@ TEST(checkpoints_is_alternative_block_allowed, hardcoded_checkpoint_overrides_sn
   checkpoint_t checkpoint = {};
   checkpoint.type         = checkpoint_type::service_node;
   checkpoint.height       = 5;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   checkpoint.height       = 10;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   ASSERT_TRUE(cp.add_checkpoint(6, "0000000000000000000000000000000000000000000000000000000000000000"));
 
@@ -361,10 +361,10 @@ TEST(checkpoints_blockchain_detached, detach_to_checkpoint_height)
   checkpoint_t checkpoint          = {};
   checkpoint.type                  = checkpoint_type::service_node;
   checkpoint.height                = FIRST_HEIGHT;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   checkpoint.height = SECOND_HEIGHT;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   // NOTE: Detaching to height. Our top checkpoint should be the 1st checkpoint, we should be deleting the checkpoint at checkpoint.height
   cp.blockchain_detached(SECOND_HEIGHT);
@@ -381,9 +381,53 @@ TEST(checkpoints_blockchain_detached, detach_to_1)
   checkpoint_t checkpoint = {};
   checkpoint.type         = checkpoint_type::service_node;
   checkpoint.height += service_nodes::CHECKPOINT_INTERVAL;
-  test_db->update_block_checkpoint(checkpoint);
+  cp.update_checkpoint(checkpoint);
 
   cp.blockchain_detached(1 /*height*/);
   checkpoint_t top_checkpoint;
   ASSERT_FALSE(test_db->get_top_checkpoint(top_checkpoint));
 }
+
+TEST(checkpoints_index, loads_db_checkpoints_and_tracks_changes)
+{
+  std::unique_ptr<TestDB> test_db(new TestDB());
+  uint64_t constexpr FIRST_HEIGHT  = service_nodes::CHECKPOINT_INTERVAL;
+  uint64_t constexpr SECOND_HEIGHT = FIRST_HEIGHT + service_nodes::CHECKPOINT_INTERVAL;
+
+  checkpoint_t checkpoint = {};
+  checkpoint.type         = checkpoint_type::service_node;
+  checkpoint.height       = FIRST_HEIGHT;
+  checkpoint.block_hash.data()[0] = 1;
+  checkpoint.signatures.emplace_back(3, crypto::signature{});
+  test_db->update_block_checkpoint(checkpoint);
+
+  // Checkpoints already in the db are picked up at init
+  checkpoints cp = {}; cp.init(network_type::FAKECHAIN, test_db.get());
+  ASSERT_EQ(cp.get_max_height(), FIRST_HEIGHT);
+
+  bool is_a_checkpoint = false, service_node_checkpoint = false;
+  ASSERT_TRUE(cp.check_block(FIRST_HEIGHT, checkpoint.block_hash, &is_a_checkpoint, &service_node_checkpoint));
+  ASSERT_TRUE(is_a_checkpoint);
+  ASSERT_TRUE(service_node_checkpoint);
+  ASSERT_FALSE(cp.check_block(FIRST_HEIGHT, crypto::hash{}));
+  ASSERT_TRUE(cp.check_block(FIRST_HEIGHT + 1, crypto::hash{}, &is_a_checkpoint));
+  ASSERT_FALSE(is_a_checkpoint);
+
+  // Signatures come from the db
+  checkpoint_t loaded;
+  ASSERT_TRUE(cp.get_checkpoint(FIRST_HEIGHT, loaded));
+  ASSERT_EQ(loaded.signatures.size(), 1);
+  ASSERT_EQ(loaded.signatures[0].voter_index, 3);
+  ASSERT_FALSE(cp.get_checkpoint(FIRST_HEIGHT + 1, loaded));
+
+  checkpoint.height = SECOND_HEIGHT;
+  ASSERT_TRUE(cp.update_checkpoint(checkpoint));
+  ASSERT_EQ(cp.get_max_height(), SECOND_HEIGHT);
+  ASSERT_TRUE(cp.is_in_checkpoint_zone(SECOND_HEIGHT));
+
+  cp.blockchain_detached(SECOND_HEIGHT);
+  ASSERT_EQ(cp.get_max_height(), FIRST_HEIGHT);
+  ASSERT_FALSE(cp.is_in_checkpoint_zone(SECOND_HEIGHT));
+  ASSERT_TRUE(cp.check_block(SECOND_HEIGHT, crypto::hash{}, &is_a_checkpoint));
+  ASSERT_FALSE(is_a_checkpoint);
+}
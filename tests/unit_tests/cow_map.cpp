@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "common/cow_map.h"
+
+TEST(cow_map, basic) {
+    tools::cow_unordered_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+
+    m[1] = "one";
+    EXPECT_TRUE(m.emplace(2, "two").second);
+    EXPECT_FALSE(m.emplace(2, "deux").second);
+    EXPECT_EQ(m.size(), 2);
+    EXPECT_EQ(m.at(2), "two");
+    EXPECT_TRUE(m.contains(1));
+    EXPECT_EQ(m.find(3), m.end());
+    EXPECT_THROW(m.at(3), std::out_of_range);
+
+    auto it = m.find(1);
+    m.modify(it) = "uno";
+    EXPECT_EQ(it->second, "uno");
+    EXPECT_EQ(m.at(1), "uno");
+
+    EXPECT_EQ(m.erase(3), 0);
+    EXPECT_EQ(m.erase(1), 1);
+    EXPECT_EQ(m.size(), 1);
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.begin(), m.end());
+}
+
+TEST(cow_map, copies_are_independent) {
+    tools::cow_unordered_map<int, int> a;
+    for (int i = 0; i < 1000; i++)
+        a[i] = i;
+
+    auto b = a;
+    EXPECT_TRUE(b.shares_all(a));
+    b[5] = -5;
+    auto it = b.find(6);
+    b.modify(it) = -6;
+    b.erase(7);
+    b.emplace(1000, 1000);
+
+    auto c = b;
+    c.clear();
+
+    EXPECT_EQ(a.size(), 1000);
+    EXPECT_EQ(b.size(), 1000);
+    EXPECT_TRUE(c.empty());
+    EXPECT_EQ(a.at(5), 5);
+    EXPECT_EQ(a.at(6), 6);
+    EXPECT_TRUE(a.contains(7));
+    EXPECT_FALSE(a.contains(1000));
+    EXPECT_EQ(b.at(5), -5);
+    EXPECT_EQ(b.at(6), -6);
+    EXPECT_FALSE(b.contains(7));
+    EXPECT_EQ(b.at(1000), 1000);
+}
+
+TEST(cow_map, differences) {
+    tools::cow_unordered_map<int, int> a;
+    for (int i = 0; i < 1000; i++)
+        a[i] = i;
+
+    auto b = a;
+    b[5] = -5;
+    b[6] = 6;  // Unshares the shard but doesn't change the value
+    b.erase(7);
+    b[1000] = 1000;
+
+    std::map<int, int> changed;
+    std::vector<int> removed;
+    b.for_each_difference(
+            a,
+            [&](int k, int v) { changed.emplace(k, v); },
+            [&](int k) { removed.push_back(k); });
+    EXPECT_EQ(changed, (std::map<int, int>{{5, -5}, {1000, 1000}}));
+    EXPECT_EQ(removed, std::vector<int>{7});
+    EXPECT_FALSE(b.shares_all(a));
+
+    changed.clear();
+    removed.clear();
+    a.for_each_difference(
+            a,
+            [&](int k, int v) { changed.emplace(k, v); },
+            [&](int k) { removed.push_back(k); });
+    EXPECT_TRUE(changed.empty());
+    EXPECT_TRUE(removed.empty());
+}
+
+TEST(cow_map, matches_std_map) {
+    std::mt19937_64 rng{123};
+    tools::cow_unordered_map<uint64_t, uint64_t> m;
+    std::map<uint64_t, uint64_t> expected;
+    std::vector<tools::cow_unordered_map<uint64_t, uint64_t>> snapshots;
+    std::vector<std::map<uint64_t, uint64_t>> expected_snapshots;
+
+    for (int i = 0; i < 5000; i++) {
+        uint64_t k = rng() % 500, v = rng();
+        switch (rng() % 4) {
+            case 0:
+            case 1:
+                m[k] = v;
+                expected[k] = v;
+                break;
+            case 2:
+                EXPECT_EQ(m.erase(k), expected.erase(k));
+                break;
+            case 3:
+                if (auto it = m.find(k); it != m.end()) {
+                    // Erase by iterator should give us a valid next iterator
+                    auto next = m.erase(it);
+                    expected.erase(k);
+                    if (next != m.end()) {
+                        EXPECT_TRUE(expected.count(next->first));
+                    }
+                }
+                break;
+        }
+        if (i % 250 == 0) {
+            snapshots.push_back(m);
+            expected_snapshots.push_back(expected);
+        }
+    }
+    snapshots.push_back(m);
+    expected_snapshots.push_back(expected);
+
+    for (size_t s = 0; s < snapshots.size(); s++) {
+        std::map<uint64_t, uint64_t> got{snapshots[s].begin(), snapshots[s].end()};
+        EXPECT_EQ(got, expected_snapshots[s]);
+        EXPECT_EQ(snapshots[s].size(), expected_snapshots[s].size());
+    }
+}
@@ -124,3 +124,147 @@ TEST(Crypto, verify_32)
     }
   }
 }
+
+TEST(Crypto, batch_key_derivations)
+{
+  crypto::public_key view_pub;
+  crypto::secret_key view_sec;
+  crypto::generate_keys(view_pub, view_sec);
+
+  std::vector<crypto::public_key> keys(5);
+  for (auto& k : keys)
+  {
+    crypto::secret_key unused;
+    crypto::generate_keys(k, unused);
+  }
+
+  std::vector<crypto::key_derivation> derivations;
+  ASSERT_TRUE(crypto::generate_key_derivations(keys, view_sec, derivations));
+  ASSERT_EQ(derivations.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    EXPECT_EQ(derivations[i], crypto::generate_key_derivation(keys[i], view_sec));
+
+  // Find something that isn't a point
+  crypto::public_key bad{};
+  crypto::key_derivation unused;
+  while (crypto::generate_key_derivation(bad, view_sec, unused))
+    bad.data()[0]++;
+  keys[2] = bad;
+
+  ASSERT_FALSE(crypto::generate_key_derivations(keys, view_sec, derivations));
+  EXPECT_EQ(derivations[2], crypto::key_derivation{});
+  for (size_t i : {0, 1, 3, 4})
+    EXPECT_EQ(derivations[i], crypto::generate_key_derivation(keys[i], view_sec));
+
+  ASSERT_TRUE(crypto::generate_key_derivations({}, view_sec, derivations));
+  EXPECT_TRUE(derivations.empty());
+}
+
+TEST(Crypto, batch_subaddress_public_keys)
+{
+  crypto::public_key view_pub;
+  crypto::secret_key view_sec;
+  crypto::generate_keys(view_pub, view_sec);
+
+  std::vector<crypto::public_key> keys(5);
+  std::vector<crypto::key_derivation> derivations(5);
+  std::vector<size_t> indices{0, 1, 2, 7, 1};
+  for (size_t i = 0; i < keys.size(); i++)
+  {
+    crypto::secret_key unused;
+    crypto::public_key tx_pub;
+    crypto::generate_keys(keys[i], unused);
+    crypto::generate_keys(tx_pub, unused);
+    derivations[i] = crypto::generate_key_derivation(tx_pub, view_sec);
+  }
+
+  auto expected = [&](size_t i) {
+    crypto::public_key res;
+    EXPECT_TRUE(crypto::derive_subaddress_public_key(keys[i], derivations[i], indices[i], res));
+    return res;
+  };
+
+  std::vector<crypto::public_key> results;
+  ASSERT_TRUE(crypto::derive_subaddress_public_keys(keys, derivations, indices, results));
+  ASSERT_EQ(results.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    EXPECT_EQ(results[i], expected(i));
+
+  // Find something that isn't a point
+  crypto::public_key bad{};
+  crypto::public_key unused;
+  while (crypto::derive_subaddress_public_key(bad, derivations[0], 0, unused))
+    bad.data()[0]++;
+  keys[3] = bad;
+
+  ASSERT_FALSE(crypto::derive_subaddress_public_keys(keys, derivations, indices, results));
+  EXPECT_EQ(results[3], crypto::public_key{});
+  for (size_t i : {0, 1, 2, 4})
+    EXPECT_EQ(results[i], expected(i));
+
+  indices.pop_back();
+  EXPECT_THROW(crypto::derive_subaddress_public_keys(keys, derivations, indices, results),
+      std::invalid_argument);
+}
+
+TEST(Crypto, precomputed_key_derivations)
+{
+  crypto::public_key view_pub;
+  crypto::secret_key view_sec;
+  crypto::generate_keys(view_pub, view_sec);
+  const auto precomputed = crypto::precompute_derivation_key(view_sec);
+
+  // Random valid points, which mostly have a torsion component that the derivation must clear
+  std::vector<crypto::public_key> keys;
+  while (keys.size() < 8)
+  {
+    crypto::public_key k;
+    crypto::rand(k.size(), k.data());
+    crypto::key_derivation unused;
+    if (crypto::generate_key_derivation(k, view_sec, unused))
+      keys.push_back(k);
+  }
+
+  for (const auto& k : keys)
+  {
+    crypto::key_derivation d;
+    ASSERT_TRUE(crypto::generate_key_derivation(k, precomputed, d));
+    EXPECT_EQ(d, crypto::generate_key_derivation(k, view_sec));
+  }
+
+  std::vector<crypto::key_derivation> derivations;
+  ASSERT_TRUE(crypto::generate_key_derivations(keys, precomputed, derivations));
+  ASSERT_EQ(derivations.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    EXPECT_EQ(derivations[i], crypto::generate_key_derivation(keys[i], view_sec));
+}
+
+TEST(Crypto, batch_check_signatures)
+{
+  std::vector<crypto::signature_check> checks(5);
+  for (size_t i = 0; i < checks.size(); i++)
+  {
+    crypto::secret_key sec;
+    crypto::generate_keys(checks[i].pub, sec);
+    checks[i].prefix_hash = crypto::cn_fast_hash(&i, sizeof(i));
+    checks[i].sig = crypto::generate_signature(checks[i].prefix_hash, checks[i].pub, sec);
+  }
+
+  std::vector<bool> valid;
+  ASSERT_TRUE(crypto::check_signatures(checks, &valid));
+  EXPECT_EQ(valid, std::vector<bool>(5, true));
+
+  // Signature for the wrong message, and an invalid scalar
+  checks[1].prefix_hash = checks[0].prefix_hash;
+  checks[3].sig.data()[63] = 0xff;
+  ASSERT_FALSE(crypto::check_signatures(checks, &valid));
+  EXPECT_EQ(valid, (std::vector<bool>{true, false, true, false, true}));
+  for (size_t i = 0; i < checks.size(); i++)
+  {
+    auto& c = checks[i];
+    EXPECT_EQ(valid[i], crypto::check_signature(c.prefix_hash, c.pub, c.sig));
+  }
+
+  EXPECT_TRUE(crypto::check_signatures({}));
+  EXPECT_FALSE(crypto::check_signatures(std::span{checks}.subspan(1, 1)));
+}
@@ -31,6 +31,9 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -130,3 +133,62 @@ TEST(boosted_tcp_server, worker_threads_are_exception_resistant)
   ASSERT_TRUE(srv.server_stop());
   ASSERT_TRUE(srv.deinit_server());
 }
+
+namespace
+{
+  struct sending_protocol_handler : test_protocol_handler
+  {
+    static inline std::vector<epee::shared_sv> messages;
+
+    epee::net_utils::i_service_endpoint* m_endpoint;
+
+    sending_protocol_handler(epee::net_utils::i_service_endpoint* psnd_hndlr, config_type& config, connection_context& conn_context)
+      : test_protocol_handler{psnd_hndlr, config, conn_context}, m_endpoint{psnd_hndlr}
+    {
+    }
+
+    void after_init_connection()
+    {
+      for (const auto& msg : messages)
+        m_endpoint->do_send(msg);
+    }
+  };
+}
+
+TEST(boosted_tcp_server, queued_sends_arrive_in_order)
+{
+  // Lots of small messages (more than get coalesced into a single write), all views into the same
+  // buffer, plus a couple bigger than the write batch byte limit.
+  auto buf = std::make_shared<std::string>();
+  for (size_t i = 0; i < 1'000'000; i++)
+    buf->push_back(static_cast<char>('a' + i % 23));
+  std::string expected;
+  std::vector<epee::shared_sv> messages;
+  epee::shared_sv all{buf};
+  for (size_t i = 1; !all.view.empty(); i++)
+  {
+    messages.push_back(all.extract_prefix(i % 50 == 0 ? 300'000 : i));
+    expected += messages.back().view;
+  }
+  ASSERT_GT(messages.size(), 200);
+  sending_protocol_handler::messages = std::move(messages);
+
+  epee::net_utils::boosted_tcp_server<sending_protocol_handler> srv(epee::net_utils::e_connection_type_RPC);
+  ASSERT_TRUE(srv.init_server(test_server_port, test_server_host));
+  ASSERT_TRUE(srv.run_server(2, false));
+
+  boost::asio::io_service io;
+  boost::asio::ip::tcp::socket sock{io};
+  sock.connect({boost::asio::ip::make_address(test_server_host), test_server_port});
+  std::string received(expected.size(), '\0');
+  boost::system::error_code ec;
+  boost::asio::read(sock, boost::asio::buffer(received), ec);
+  EXPECT_FALSE(ec);
+  EXPECT_TRUE(received == expected);
+  sock.close();
+
+  srv.send_stop_signal();
+  ASSERT_TRUE(srv.server_stop());
+  ASSERT_TRUE(srv.deinit_server());
+  sending_protocol_handler::messages.clear();
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "blockchain_db/hot_cache.h"
+
+namespace {
+
+crypto::hash txid(uint8_t n) {
+    crypto::hash h{};
+    h.data()[0] = n;
+    return h;
+}
+
+}  // namespace
+
+TEST(hot_cache, disabled_by_default) {
+    cryptonote::blob_hot_cache cache;
+    EXPECT_FALSE(cache.enabled());
+    cache.add_block(0, "block", {{txid(1), "tx"}});
+    EXPECT_FALSE(cache.block_blob(0));
+    EXPECT_FALSE(cache.tx_blob(txid(1)));
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(hot_cache, add_and_pop) {
+    cryptonote::blob_hot_cache cache;
+    cache.set_budget(1000);
+    cache.add_block(10, "block10", {{txid(1), "tx1"}, {txid(2), "tx2"}});
+    cache.add_block(11, "block11", {{txid(3), "tx3"}});
+    EXPECT_EQ(cache.size(), 7 + 3 + 3 + 7 + 3);
+    EXPECT_EQ(cache.block_blob(10), "block10");
+    EXPECT_EQ(cache.block_blob(11), "block11");
+    EXPECT_FALSE(cache.block_blob(12));
+    EXPECT_EQ(cache.tx_blob(txid(2)), "tx2");
+    EXPECT_EQ(cache.tx_blob(txid(3)), "tx3");
+
+    cache.pop_blocks(11);
+    EXPECT_FALSE(cache.block_blob(11));
+    EXPECT_FALSE(cache.tx_blob(txid(3)));
+    EXPECT_EQ(cache.block_blob(10), "block10");
+    EXPECT_EQ(cache.size(), 7 + 3 + 3);
+
+    // Adding at a height we already have replaces it (and anything above it)
+    cache.add_block(11, "block11", {{txid(3), "tx3"}});
+    cache.add_block(10, "other10", {{txid(4), "tx4"}});
+    EXPECT_EQ(cache.block_blob(10), "other10");
+    EXPECT_FALSE(cache.block_blob(11));
+    EXPECT_FALSE(cache.tx_blob(txid(1)));
+    EXPECT_FALSE(cache.tx_blob(txid(3)));
+    EXPECT_EQ(cache.tx_blob(txid(4)), "tx4");
+    EXPECT_EQ(cache.size(), 7 + 3);
+
+    cache.clear();
+    EXPECT_FALSE(cache.block_blob(10));
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(hot_cache, evicts_lowest) {
+    cryptonote::blob_hot_cache cache;
+    cache.set_budget(25);
+    cache.add_block(1, "0123456789", {});
+    cache.add_block(2, "0123456789", {{txid(2), "tx"}});
+    EXPECT_EQ(cache.size(), 22);
+    cache.add_block(3, "0123456789", {{txid(3), "tx"}});
+    EXPECT_FALSE(cache.block_blob(1));
+    EXPECT_TRUE(cache.block_blob(2));
+    EXPECT_TRUE(cache.block_blob(3));
+    EXPECT_EQ(cache.size(), 24);
+    cache.add_block(4, "0123456789", {});
+    EXPECT_FALSE(cache.block_blob(2));
+    EXPECT_FALSE(cache.tx_blob(txid(2)));
+    EXPECT_TRUE(cache.tx_blob(txid(3)));
+    EXPECT_EQ(cache.size(), 22);
+
+    // Too big to hold at all
+    cache.add_block(5, std::string(100, 'x'), {});
+    EXPECT_FALSE(cache.block_blob(5));
+    EXPECT_TRUE(cache.block_blob(4));
+
+    cache.set_budget(5);
+    EXPECT_EQ(cache.size(), 0);
+}
@@ -0,0 +1,88 @@
+#include "common/json_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <nlohmann/json.hpp>
+
+#include "common/guts.h"
+
+using namespace std::literals;
+using tools::json_writer;
+using encoding = tools::json_binary_proxy::fmt;
+
+namespace {
+
+std::string write_value(std::string_view s) {
+    std::string out;
+    json_writer{out}.value(s);
+    return out;
+}
+
+}  // namespace
+
+TEST(json_writer, escapes_like_nlohmann) {
+    for (std::string s :
+         {""s,
+          "plain"s,
+          "exactly8"s,
+          "a longer string that spans several words without escapes"s,
+          "quote\" and back\\slash"s,
+          "ctl\x01\x1f\b\f\n\r\t-chars"s,
+          std::string{"nul\0byte in the middle of a long string", 40},
+          "\"\"\"\"\"\"\"\"\"\"\""s,
+          "utf-8: \xc3\xa9\xe2\x82\xac"s})
+        EXPECT_EQ(write_value(s), nlohmann::json(s).dump()) << s;
+}
+
+TEST(json_writer, structure) {
+    std::string out;
+    json_writer w{out};
+    crypto::hash h{};
+    h.data()[0] = 0xab;
+    std::vector<crypto::hash> hashes{h, h};
+    w.begin_object()
+            .set("a", 1)
+            .set("neg", -5)
+            .set("big", std::numeric_limits<uint64_t>::max())
+            .set("t", true)
+            .set("s", "str")
+            .key("n")
+            .value(nullptr)
+            .key("empty")
+            .begin_array()
+            .end_array()
+            .key("list")
+            .begin_array()
+            .value(1)
+            .begin_object()
+            .set("x", 2)
+            .end_object()
+            .value("y")
+            .end_array()
+            .set("votes", std::vector<bool>{true, false})
+            .set_binary("hash", h, encoding::hex)
+            .set_binary("hashes", hashes, encoding::hex)
+            .set_binary("b64", std::string_view{"abcd"}, encoding::base64)
+            .key("raw")
+            .raw(R"({"z":[]})")
+            .end_object();
+
+    auto expected = nlohmann::json{
+            {"a", 1},
+            {"neg", -5},
+            {"big", std::numeric_limits<uint64_t>::max()},
+            {"t", true},
+            {"s", "str"},
+            {"n", nullptr},
+            {"empty", nlohmann::json::array()},
+            {"list", {1, {{"x", 2}}, "y"}},
+            {"votes", {true, false}},
+            {"hash", tools::hex_guts(h)},
+            {"hashes", {tools::hex_guts(h), tools::hex_guts(h)}},
+            {"b64", "YWJjZA=="},
+            {"raw", {{"z", nlohmann::json::array()}}}};
+    EXPECT_EQ(nlohmann::json::parse(out), expected);
+
+    EXPECT_THROW(json_writer{out}.binary(h, encoding::bt), std::logic_error);
+}
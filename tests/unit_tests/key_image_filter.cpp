@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "blockchain_db/key_image_filter.h"
+
+namespace {
+
+std::vector<crypto::key_image> random_key_images(size_t n) {
+    std::vector<crypto::key_image> kis(n);
+    for (auto& ki : kis)
+        crypto::rand(sizeof(ki), ki.data());
+    return kis;
+}
+
+}  // namespace
+
+TEST(key_image_filter, no_false_negatives) {
+    cryptonote::key_image_filter filter{10'000};
+    EXPECT_GE(filter.capacity(), 10'000);
+    auto kis = random_key_images(10'000);
+    for (const auto& ki : kis)
+        filter.insert(ki);
+    EXPECT_EQ(filter.size(), 10'000);
+    for (const auto& ki : kis)
+        EXPECT_TRUE(filter.maybe_contains(ki));
+}
+
+TEST(key_image_filter, false_positive_rate) {
+    cryptonote::key_image_filter filter{10'000};
+    for (const auto& ki : random_key_images(10'000))
+        filter.insert(ki);
+
+    // The expected rate at capacity is about 0.1%
+    int positives = 0;
+    for (const auto& ki : random_key_images(100'000))
+        positives += filter.maybe_contains(ki);
+    EXPECT_LT(positives, 500);
+
+    cryptonote::key_image_filter empty{1};
+    for (const auto& ki : random_key_images(100))
+        EXPECT_FALSE(empty.maybe_contains(ki));
+}
@@ -501,6 +501,64 @@ TEST_F(levin_notify, flood)
     }
 }
 
+TEST_F(levin_notify, public_flood_known_txs)
+{
+    cryptonote::levin::notify notifier = make_notifier(0, true);
+
+    for (unsigned count = 0; count < 10; ++count)
+        add_connection(count % 2 == 0);
+
+    std::vector<std::string> txs(2);
+    txs[0].resize(100, 'f');
+    txs[1].resize(200, 'e');
+    std::vector<crypto::hash> hashes(2);
+    hashes[0].data()[0] = 1;
+    hashes[1].data()[0] = 2;
+
+    ASSERT_EQ(10u, contexts_.size());
+    {
+        auto context = contexts_.begin();
+        EXPECT_TRUE(notifier.send_txs(txs, context->get_id(), false, hashes));
+
+        // batched until the flood timer fires
+        io_service_.reset();
+        io_service_.poll();
+        for (auto& c : contexts_)
+            EXPECT_EQ(0u, c.process_send_queue());
+
+        notifier.run_flood();
+        io_service_.reset();
+        ASSERT_LT(0u, io_service_.poll());
+        EXPECT_EQ(0u, context->process_send_queue());
+        for (++context; context != contexts_.end(); ++context)
+            EXPECT_EQ(1u, context->process_send_queue());
+
+        std::sort(txs.begin(), txs.end());
+        ASSERT_EQ(9u, receiver_.notified_size());
+        for (unsigned count = 0; count < 9; ++count)
+        {
+            auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+            EXPECT_EQ(txs, notification.txs);
+        }
+    }
+
+    // Relaying the same txs again (e.g. received from another peer) only goes to the peer that
+    // originally sent them to us, which is the only one we haven't sent them to
+    {
+        auto context = contexts_.begin();
+        EXPECT_TRUE(notifier.send_txs(txs, (++context)->get_id(), false, hashes));
+        notifier.run_flood();
+        io_service_.reset();
+        ASSERT_LT(0u, io_service_.poll());
+
+        EXPECT_EQ(1u, contexts_.begin()->process_send_queue());
+        for (++context; context != contexts_.end(); ++context)
+            EXPECT_EQ(0u, context->process_send_queue());
+        ASSERT_EQ(1u, receiver_.notified_size());
+        EXPECT_EQ(txs, receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second.txs);
+    }
+}
+
 TEST_F(levin_notify, private_flood)
 {
     cryptonote::levin::notify notifier = make_notifier(0, false);
@@ -572,6 +630,53 @@ TEST_F(levin_notify, private_flood)
     }
 }
 
+TEST_F(levin_notify, private_flood_held_without_connections)
+{
+    cryptonote::levin::notify notifier = make_notifier(0, false);
+
+    // Incoming connections never get txs in an anonymity zone
+    add_connection(true);
+
+    std::vector<std::string> txs(2);
+    txs[0].resize(100, 'f');
+    txs[1].resize(200, 'e');
+    std::vector<crypto::hash> hashes(2);
+    hashes[0].data()[0] = 1;
+    hashes[1].data()[0] = 2;
+
+    EXPECT_TRUE(notifier.send_txs(txs, {}, false, hashes));
+    io_service_.reset();
+    io_service_.poll();
+    notifier.run_flood();
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+    EXPECT_EQ(0u, contexts_.front().process_send_queue());
+
+    // Rebroadcasts while held don't get sent twice
+    EXPECT_TRUE(notifier.send_txs(txs, {}, false, hashes));
+    notifier.run_flood();
+    io_service_.reset();
+    io_service_.poll();
+    EXPECT_EQ(0u, contexts_.front().process_send_queue());
+
+    // The held txs go out once an outbound connection comes up
+    add_connection(false);
+    notifier.new_out_connection();
+    io_service_.reset();
+    io_service_.poll();
+    notifier.run_flood();
+    io_service_.reset();
+    ASSERT_LT(0u, io_service_.poll());
+    EXPECT_EQ(0u, contexts_.front().process_send_queue());
+    EXPECT_EQ(1u, contexts_.back().process_send_queue());
+
+    ASSERT_EQ(1u, receiver_.notified_size());
+    auto notification = receiver_.get_notification<cryptonote::NOTIFY_NEW_TRANSACTIONS>().second;
+    std::sort(txs.begin(), txs.end());
+    std::sort(notification.txs.begin(), notification.txs.end());
+    EXPECT_EQ(txs, notification.txs);
+}
+
 TEST_F(levin_notify, noise)
 {
     for (unsigned count = 0; count < 10; ++count)
@@ -656,3 +761,30 @@ TEST_F(levin_notify, noise)
         }
     }
 }
+
+TEST(levin_command_stats, add)
+{
+    cryptonote::levin_command_stats_map stats;
+    stats.add(1001, 100, 2000, 50us);
+    stats.add(1001, 300, 0, 5ms);
+    stats.add(2002, 10, 0, 2s);
+
+    const auto copy = stats;
+    stats.add(2002, 10, 0, 1us);
+
+    const auto totals = copy.get();
+    ASSERT_EQ(2u, totals.size());
+    const auto& a = totals.at(1001);
+    EXPECT_EQ(2u, a.count);
+    EXPECT_EQ(400u, a.bytes_in);
+    EXPECT_EQ(2000u, a.bytes_out);
+    EXPECT_EQ(5050us, a.handler_time);
+    EXPECT_EQ(5ms, a.max_handler_time);
+    EXPECT_EQ(1u, a.handler_time_histogram[0]);
+    EXPECT_EQ(1u, a.handler_time_histogram[2]);
+
+    const auto& b = totals.at(2002);
+    EXPECT_EQ(1u, b.count);
+    EXPECT_EQ(1u, b.handler_time_histogram.back());
+    EXPECT_EQ(2u, stats.get().at(2002).count);
+}
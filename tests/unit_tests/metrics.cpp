@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "common/metrics.h"
+
+TEST(metrics, counters_and_gauges) {
+    tools::metrics::registry r;
+    auto& hits = r.add_counter("test_lookups_total", "Lookups", {{"result", "hit"}});
+    auto& misses = r.add_counter("test_lookups_total", "Lookups", {{"result", "miss"}});
+    auto& depth = r.add_gauge("test_depth", "Queue depth");
+    hits.inc();
+    hits.inc(2);
+    misses.inc();
+    depth.inc(5);
+    depth.dec();
+
+    // Registering again gives back the same metric
+    EXPECT_EQ(&r.add_counter("test_lookups_total", "Lookups", {{"result", "hit"}}), &hits);
+    EXPECT_THROW(r.add_gauge("test_lookups_total", "Lookups"), std::logic_error);
+
+    EXPECT_EQ(
+            r.render(),
+            "# HELP test_depth Queue depth\n"
+            "# TYPE test_depth gauge\n"
+            "test_depth 4\n"
+            "# HELP test_lookups_total Lookups\n"
+            "# TYPE test_lookups_total counter\n"
+            "test_lookups_total{result=\"hit\"} 3\n"
+            "test_lookups_total{result=\"miss\"} 1\n");
+}
+
+TEST(metrics, histogram) {
+    tools::metrics::registry r;
+    auto& h = r.add_histogram("test_seconds", "Durations", {0.1, 1});
+    h.observe(0.05);
+    h.observe(0.1);
+    h.observe(0.5);
+    h.observe(2);
+
+    EXPECT_EQ(h.count(), 4);
+    EXPECT_EQ(
+            r.render(),
+            "# HELP test_seconds Durations\n"
+            "# TYPE test_seconds histogram\n"
+            "test_seconds_bucket{le=\"0.1\"} 2\n"
+            "test_seconds_bucket{le=\"1\"} 3\n"
+            "test_seconds_bucket{le=\"+Inf\"} 4\n"
+            "test_seconds_sum 2.65\n"
+            "test_seconds_count 4\n");
+}
+
+TEST(metrics, callback_gauges) {
+    tools::metrics::registry r;
+    int calls = 0;
+    {
+        auto handle = r.add_gauge_callback("test_pool", "Pool size", {{"kind", "a\"b"}}, [&] {
+            return ++calls;
+        });
+        EXPECT_THROW(r.add_counter("test_pool", "Pool size"), std::logic_error);
+        EXPECT_EQ(
+                r.render(),
+                "# HELP test_pool Pool size\n"
+                "# TYPE test_pool gauge\n"
+                "test_pool{kind=\"a\\\"b\"} 1\n");
+    }
+    // The handle going away unregisters it
+    EXPECT_EQ(r.render(), "");
+    EXPECT_EQ(calls, 1);
+}
@@ -328,3 +328,16 @@ TEST(multiexp, scalarmult_triple)
     }
   }
 }
+
+TEST(multiexp, pippenger_all_windows)
+{
+  std::vector<rct::MultiexpData> data;
+  for (int n = 0; n < 16; ++n)
+    data.push_back({rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))});
+  // Make sure windows reaching the top bits of the scalar are handled too
+  data.push_back({rct::L, get_p3(rct::scalarmultBase(rct::skGen()))});
+  data.push_back({TESTPOW2SCALAR, get_p3(rct::scalarmultBase(rct::skGen()))});
+  const rct::key expected = basic(data);
+  for (size_t c = 1; c <= 9; ++c)
+    ASSERT_TRUE(expected == pippenger(data, NULL, 0, c));
+}
@@ -92,6 +92,7 @@ public:
     bool get_short_chain_history(std::list<crypto::hash>& ids) const { return true; }
     bool is_within_compiled_block_hash_area(uint64_t height) const { return false; }
     uint32_t get_blockchain_pruning_seed() const { return 0; }
+    void precompute_block_pow(uint64_t height, std::vector<cryptonote::block_complete_entry> blocks, const std::vector<cryptonote::block>& preceding) {}
 
     struct fake_db {
         cryptonote::difficulty_type get_block_cumulative_difficulty(uint64_t height) const { return 0; }
@@ -286,6 +287,43 @@ TEST(ban, subnet)
   ASSERT_TRUE(server.get_blocked_subnets().size() == 0);
 }
 
+TEST(ban, nested_subnets)
+{
+  time_t seconds;
+  test_core pr_core;
+  cryptonote::t_cryptonote_protocol_handler<test_core> cprotocol(pr_core);
+  Server server(cprotocol);
+  cprotocol.set_p2p_endpoint(&server);
+
+  ASSERT_TRUE(server.block_subnet(MAKE_IPV4_SUBNET(10,0,0,0,8), 10));
+  ASSERT_TRUE(server.block_subnet(MAKE_IPV4_SUBNET(10,1,2,0,24), 1000));
+  ASSERT_TRUE(server.block_subnet(MAKE_IPV4_SUBNET(10,1,2,3,32), 100));
+  ASSERT_EQ(server.get_blocked_subnets().size(), 3);
+
+  // the longest ban of all the subnets containing the address is the one that counts
+  ASSERT_TRUE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,3), &seconds));
+  ASSERT_GE(seconds, 999);
+  ASSERT_TRUE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,4), &seconds));
+  ASSERT_GE(seconds, 999);
+  ASSERT_TRUE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,3,4), &seconds));
+  ASSERT_LE(seconds, 10);
+  ASSERT_FALSE(server.is_host_blocked(MAKE_IPV4_ADDRESS(11,1,2,3), &seconds));
+
+  // unblocking a subnet leaves the ones around and inside it alone
+  ASSERT_TRUE(server.unblock_subnet(MAKE_IPV4_SUBNET(10,1,2,0,24)));
+  ASSERT_TRUE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,3), &seconds));
+  ASSERT_LE(seconds, 100);
+  ASSERT_GE(seconds, 99);
+  ASSERT_TRUE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,4), &seconds));
+  ASSERT_LE(seconds, 10);
+  ASSERT_TRUE(server.unblock_subnet(MAKE_IPV4_SUBNET(10,0,0,0,8)));
+  ASSERT_FALSE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,4), &seconds));
+  ASSERT_TRUE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,3), &seconds));
+  ASSERT_TRUE(server.unblock_subnet(MAKE_IPV4_SUBNET(10,1,2,3,32)));
+  ASSERT_FALSE(server.is_host_blocked(MAKE_IPV4_ADDRESS(10,1,2,3), &seconds));
+  ASSERT_EQ(server.get_blocked_subnets().size(), 0);
+}
+
 TEST(ban, ignores_port)
 {
   time_t seconds;
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include "blockchain_db/testdb.h"
+#include "checkpoints/checkpoints.h"
+#include "cryptonote_core/rct_output_counts.h"
+
+namespace {
+
+// Block h has h+1 outputs; counts the heights it gets asked for
+class TestDB : public cryptonote::BaseTestDB {
+  public:
+    mutable size_t lookups = 0;
+    uint64_t offset = 0;
+
+    std::vector<uint64_t> get_block_cumulative_rct_outputs(
+            const std::vector<uint64_t>& heights) const override {
+        std::vector<uint64_t> counts;
+        for (auto h : heights)
+            counts.push_back((h + 1) * (h + 2) / 2 + offset);
+        lookups += heights.size();
+        return counts;
+    }
+};
+
+}  // namespace
+
+TEST(rct_output_counts, get) {
+    TestDB db;
+    cryptonote::rct_output_counts counts;
+
+    EXPECT_EQ(counts.get(db, 2, 4), std::vector<uint64_t>({6, 10, 15}));
+    EXPECT_EQ(db.lookups, 5);
+    EXPECT_EQ(counts.size(), 5);
+
+    // Already loaded heights don't hit the db again; later ones continue from the end
+    EXPECT_EQ(counts.get(db, 0, 1), std::vector<uint64_t>({1, 3}));
+    EXPECT_EQ(counts.get(db, 4, 6), std::vector<uint64_t>({15, 21, 28}));
+    EXPECT_EQ(db.lookups, 7);
+    EXPECT_TRUE(counts.get(db, 3, 2).empty());
+
+    uint64_t big = 2 * cryptonote::rct_output_counts::LOAD_BATCH + 5;
+    auto all = counts.get(db, 0, big);
+    EXPECT_EQ(all.size(), big + 1);
+    EXPECT_EQ(all.back(), (big + 1) * (big + 2) / 2);
+    EXPECT_EQ(db.lookups, big + 1);
+}
+
+TEST(rct_output_counts, detach) {
+    TestDB db;
+    cryptonote::rct_output_counts counts;
+    EXPECT_EQ(counts.get(db, 0, 9).back(), 55);
+
+    // Replacement blocks must be reloaded, but the ones below the detach height are kept
+    db.offset = 1000;
+    counts.blockchain_detached(8);
+    EXPECT_EQ(counts.size(), 8);
+    EXPECT_EQ(counts.get(db, 6, 9), std::vector<uint64_t>({28, 36, 1045, 1055}));
+    counts.blockchain_detached(20);
+    EXPECT_EQ(counts.size(), 10);
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cryptonote_protocol/request_queue.h"
+
+using namespace std::literals;
+
+namespace {
+
+cryptonote::connection_id_t make_conn(uint8_t i) {
+    cryptonote::connection_id_t c{};
+    *c.begin() = i;
+    return c;
+}
+
+}  // namespace
+
+TEST(request_queue, per_connection_order) {
+    const auto a = make_conn(1), b = make_conn(2);
+    std::mutex m;
+    std::vector<int> seen_a, seen_b;
+    std::atomic<int> done = 0;
+    {
+        cryptonote::request_queue queue{4, 100};
+        for (int i = 0; i < 50; i++) {
+            ASSERT_TRUE(queue.push(a, [&, i] {
+                std::this_thread::sleep_for(100us);
+                std::lock_guard lock{m};
+                seen_a.push_back(i);
+                done++;
+            }));
+            ASSERT_TRUE(queue.push(b, [&, i] {
+                std::lock_guard lock{m};
+                seen_b.push_back(i);
+                done++;
+            }));
+        }
+        for (int tries = 0; done < 100 && tries < 500; tries++)
+            std::this_thread::sleep_for(10ms);
+    }
+    ASSERT_EQ(done, 100);
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(seen_a[i], i);
+        EXPECT_EQ(seen_b[i], i);
+    }
+}
+
+TEST(request_queue, limit_and_stop) {
+    const auto a = make_conn(1), b = make_conn(2);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> ran = 0;
+
+    cryptonote::request_queue queue{1, 3};
+    ASSERT_TRUE(queue.push(a, [&] {
+        released.wait();
+        ran++;
+    }));
+    ASSERT_TRUE(queue.push(a, [&] { ran++; }));
+    ASSERT_TRUE(queue.push(a, [&] { ran++; }));
+    EXPECT_FALSE(queue.push(a, [&] { ran++; }));
+    EXPECT_EQ(queue.queued(a), 3);
+    // Other connections have their own limit
+    EXPECT_TRUE(queue.push(b, [&] { ran++; }));
+
+    // Stopping lets the running job finish, but (barring a slow stopper thread) nothing else
+    // gets started
+    std::thread stopper{[&] { queue.stop(); }};
+    std::this_thread::sleep_for(10ms);
+    release.set_value();
+    stopper.join();
+    EXPECT_LE(ran, 2);
+    EXPECT_GE(ran, 1);
+    EXPECT_FALSE(queue.push(a, [] {}));
+}
@@ -34,11 +34,13 @@
 #include <cstdint>
 #include <algorithm>
 #include <sstream>
+#include <thread>
 
 #include "ringct/rctTypes.h"
 #include "ringct/rctSigs.h"
 #include "ringct/rctOps.h"
 #include "device/device.hpp"
+#include "cryptonote_core/rct_batch_verifier.h"
 
 using namespace crypto;
 using namespace rct;
@@ -761,6 +763,69 @@ TEST_rctSig_elements(outPk_empty, sig.outPk.resize(0));
 TEST_rctSig_elements(outPk_too_many, sig.outPk.push_back(sig.outPk.back()));
 TEST_rctSig_elements(outPk_too_few, sig.outPk.pop_back());
 
+TEST(ringct, batch_non_semantics_simple)
+{
+  const rct::rctSig good = base_sig();
+  rct::rctSig bad = base_sig();
+  std::swap(bad.p.pseudoOuts[0], bad.p.pseudoOuts[1]);
+  rct::rctSig broken = base_sig();
+  broken.mixRing.pop_back();
+
+  std::vector<bool> results;
+  ASSERT_TRUE(rct::verRctNonSemanticsSimple({&good, &good, &good}, results));
+  ASSERT_EQ(results, std::vector<bool>({true, true, true}));
+
+  ASSERT_FALSE(rct::verRctNonSemanticsSimple({&good, &bad, &good, &broken}, results));
+  ASSERT_EQ(results, std::vector<bool>({true, false, true, false}));
+
+  ASSERT_TRUE(rct::verRctNonSemanticsSimple({}, results));
+  ASSERT_TRUE(results.empty());
+}
+
+TEST(ringct, batch_verifier)
+{
+  const rct::rctSig good = base_sig();
+  rct::rctSig bad = base_sig();
+  std::swap(bad.p.pseudoOuts[0], bad.p.pseudoOuts[1]);
+  bad.p.pseudoOuts[0] = rct::addKeys(bad.p.pseudoOuts[0], rct::H);
+
+  cryptonote::rct_batch_verifier verifier;
+  ASSERT_FALSE(verifier.enabled());
+  ASSERT_EQ(verifier.verify({&good, &bad, &good}), std::vector<bool>({true, false, true}));
+
+  verifier.configure(std::chrono::milliseconds{50}, 4);
+  ASSERT_TRUE(verifier.enabled());
+  std::vector<bool> r1, r2, r3;
+  std::thread t1{[&] { r1 = verifier.verify({&good, &good}); }};
+  std::thread t2{[&] { r2 = verifier.verify({&bad}); }};
+  std::thread t3{[&] { r3 = verifier.verify({&good, &bad, &good}); }};
+  t1.join();
+  t2.join();
+  t3.join();
+  EXPECT_EQ(r1, std::vector<bool>({true, true}));
+  EXPECT_EQ(r2, std::vector<bool>({false}));
+  EXPECT_EQ(r3, std::vector<bool>({true, false, true}));
+}
+
+TEST(ringct, split_bulletproof_batches)
+{
+  const rct::rctSig good = base_sig();
+  rct::rctSig bad = base_sig();
+  bad.p.bulletproofs[0].t = rct::skGen();
+
+  // Small enough batches that the proofs get split up
+  rct::set_bulletproof_batch_size(4);
+  ASSERT_EQ(rct::get_bulletproof_batch_size(), 4);
+  std::vector<const rct::rctSig*> sigs(10, &good);
+  EXPECT_TRUE(rct::verRctSemanticsSimple(sigs));
+  sigs[7] = &bad;
+  EXPECT_FALSE(rct::verRctSemanticsSimple(sigs));
+
+  rct::set_bulletproof_batch_size(0);
+  EXPECT_GT(rct::get_bulletproof_batch_size(), 4);
+  EXPECT_FALSE(rct::verRctSemanticsSimple(sigs));
+}
+
 TEST(ringct, reject_gen_simple_ver_non_simple)
 {
   const uint64_t inputs[] = {1000, 1000};
@@ -131,6 +131,41 @@ TEST(ringdb, different_genesis)
   ASSERT_FALSE(ringdb.get_ring(get_context().KEY_2, get_context().KEY_IMAGE_1, outs2));
 }
 
+TEST(ringdb, set_rings)
+{
+  RingDB ringdb;
+  crypto::key_image key_image_2 = generate_key_image();
+  std::vector<uint64_t> outs1{43, 7320, 8429}, outs2{5, 6, 7, 8}, found;
+  ASSERT_TRUE(ringdb.set_rings(get_context().KEY_1,
+      {{get_context().KEY_IMAGE_1, outs1}, {key_image_2, outs2}}, false));
+  ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, found));
+  ASSERT_EQ(found, outs1);
+  ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, key_image_2, found));
+  ASSERT_EQ(found, outs2);
+}
+
+TEST(ringdb, read_session)
+{
+  RingDB ringdb;
+  std::vector<uint64_t> outs{43, 7320, 8429}, found;
+  ASSERT_TRUE(ringdb.set_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, outs, false));
+  ASSERT_TRUE(ringdb.blackball(get_context().OUTPUT_1));
+  {
+    tools::ringdb::read_session session{ringdb};
+    ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, found));
+    ASSERT_EQ(found, outs);
+    ASSERT_TRUE(ringdb.blackballed(get_context().OUTPUT_1));
+    ASSERT_FALSE(ringdb.blackballed(get_context().OUTPUT_2));
+
+    // A write during the session ends its transaction, so later lookups see the change
+    ASSERT_TRUE(ringdb.blackball(get_context().OUTPUT_2));
+    ASSERT_TRUE(ringdb.blackballed(get_context().OUTPUT_2));
+    ASSERT_TRUE(ringdb.get_ring(get_context().KEY_1, get_context().KEY_IMAGE_1, found));
+    ASSERT_EQ(found, outs);
+  }
+  ASSERT_TRUE(ringdb.blackballed(get_context().OUTPUT_2));
+}
+
 TEST(spent_outputs, not_found)
 {
   RingDB ringdb;
@@ -199,3 +199,71 @@ TEST(rolling_median, size)
     ASSERT_EQ(m.size(), std::min<int>(10, i + 2));
   }
 }
+
+TEST(rolling_median, pop_back)
+{
+  epee::misc_utils::rolling_median_t<uint64_t> m(100);
+  std::vector<uint64_t> random;
+  random.reserve(10000);
+  for (int i = 0; i < 100; ++i)
+  {
+    random.push_back(crypto::rand<uint64_t>() % 1000);
+    m.insert(random.back());
+  }
+  std::vector<uint64_t> median{m.median()};
+  for (int i = 100; i < 10000; ++i)
+  {
+    random.push_back(crypto::rand<uint64_t>() % 1000);
+    m.insert(random.back());
+    median.push_back(m.median());
+  }
+  // walk the window back down, checking it against a fresh median at each step, then back up
+  for (int i = 10000 - 1; i >= 100; --i)
+  {
+    m.pop_back(random[i - 100]);
+    ASSERT_EQ(m.size(), 100);
+    ASSERT_EQ(m.median(), median[i - 100]);
+    std::vector<uint64_t> window(random.begin() + i - 100, random.begin() + i);
+    ASSERT_EQ(m.median(), tools::median(window));
+  }
+  for (int i = 100; i < 10000; ++i)
+  {
+    m.insert(random[i]);
+    ASSERT_EQ(m.median(), median[i - 100 + 1]);
+  }
+}
+
+TEST(rolling_median, copy)
+{
+  epee::misc_utils::rolling_median_t<uint64_t> m(100);
+  for (int i = 0; i < 250; ++i)
+    m.insert(crypto::rand<uint64_t>() % 1000);
+  epee::misc_utils::rolling_median_t<uint64_t> snapshot(m);
+  const uint64_t median = m.median();
+
+  // changing either one must leave the other alone
+  for (int i = 0; i < 250; ++i)
+    m.insert(crypto::rand<uint64_t>() % 1000 + 1000);
+  ASSERT_GE(m.median(), 1000);
+  ASSERT_EQ(snapshot.median(), median);
+  ASSERT_EQ(snapshot.size(), 100);
+
+  // restoring the snapshot puts the window back as it was, and it keeps rolling from there
+  m = snapshot;
+  ASSERT_EQ(m.median(), median);
+  std::vector<uint64_t> v;
+  for (int i = 0; i < 100; ++i)
+  {
+    v.push_back(crypto::rand<uint64_t>() % 1000);
+    m.insert(v.back());
+    snapshot.insert(v.back());
+    ASSERT_EQ(m.median(), snapshot.median());
+  }
+  ASSERT_EQ(m.median(), tools::median(v));
+
+  epee::misc_utils::rolling_median_t<uint64_t> small(3);
+  small = m;
+  ASSERT_EQ(small.median(), m.median());
+  small.insert(5000);
+  ASSERT_EQ(small.size(), 100);
+}
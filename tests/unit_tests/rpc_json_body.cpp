@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include "rpc/common/param_parser.hpp"
+#include "rpc/core_rpc_server_command_parser.h"
+
+using namespace cryptonote::rpc;
+
+namespace {
+
+// Parses `body` through both the single pass json_body path and the parsed json path
+template <typename RPC>
+std::pair<RPC, RPC> parse_both(std::string_view body) {
+    std::pair<RPC, RPC> result;
+    parse_request(result.first, json_body{body});
+    parse_request(result.second, json::parse(body));
+    return result;
+}
+
+}  // namespace
+
+TEST(rpc_json_body, loads_like_parsed_json) {
+    auto [a, b] = parse_both<GET_BLOCK_HEADERS_RANGE>(
+            R"({"start_height": 5, "ignored": {"x": [1, {"y": null}]}, "end_height": 10,)"
+            R"( "fill_pow_hash": true, "get_tx_hashes": 1})");
+    EXPECT_EQ(a.request.start_height, 5);
+    EXPECT_EQ(a.request.end_height, 10);
+    EXPECT_TRUE(a.request.fill_pow_hash);
+    EXPECT_TRUE(a.request.get_tx_hashes);
+    EXPECT_EQ(a.request.start_height, b.request.start_height);
+    EXPECT_EQ(a.request.end_height, b.request.end_height);
+    EXPECT_EQ(a.request.get_tx_hashes, b.request.get_tx_hashes);
+
+    auto [h1, h2] = parse_both<GET_BLOCK_HEADER_BY_HEIGHT>(R"({"heights": [3, 1, 2]})");
+    EXPECT_FALSE(h1.request.height);
+    EXPECT_EQ(h1.request.heights, (std::vector<uint64_t>{3, 1, 2}));
+    EXPECT_EQ(h1.request.heights, h2.request.heights);
+
+    auto [o1, o2] = parse_both<ONS_RESOLVE>(R"({"type": 0, "name_hash": "abc\"A"})");
+    EXPECT_EQ(o1.request.type, 0);
+    EXPECT_EQ(o1.request.name_hash, "abc\"A");
+    EXPECT_EQ(o1.request.name_hash, o2.request.name_hash);
+}
+
+TEST(rpc_json_body, rejects_bad_input) {
+    ONS_RESOLVE ons;
+    EXPECT_THROW(parse_request(ons, json_body{R"({"type": 0})"}), std::runtime_error);
+    EXPECT_THROW(
+            parse_request(ons, json_body{R"({"type": 0, "name_hash": 1})"}), std::domain_error);
+    EXPECT_THROW(parse_request(ons, json_body{R"({"type": 0, "name_hash": "x")"}), std::exception);
+    EXPECT_THROW(parse_request(ons, json_body{R"([1, 2])"}), std::domain_error);
+
+    GET_BLOCK_HEADERS_RANGE range;
+    EXPECT_THROW(parse_request(range, json_body{R"({"start_height": -1})"}), std::domain_error);
+    EXPECT_THROW(parse_request(range, json_body{R"({"start_height": [1]})"}), std::domain_error);
+    EXPECT_THROW(parse_request(range, json_body{R"({"fill_pow_hash": 2})"}), std::domain_error);
+    EXPECT_THROW(parse_request(range, json_body{R"({"start_height": 1} x)"}), std::exception);
+
+    GET_BLOCK_HASH bh;
+    EXPECT_THROW(parse_request(bh, json_body{R"({"heights": [1, [2]]})"}), std::domain_error);
+    EXPECT_THROW(parse_request(bh, json_body{R"({"heights": [1, "2"]})"}), std::domain_error);
+    EXPECT_NO_THROW(parse_request(bh, json_body{"null"}));
+}
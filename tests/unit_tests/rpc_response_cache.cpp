@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include "rpc/common/rpc_command.h"
+
+TEST(rpc_response_cache, get_and_put) {
+    cryptonote::rpc::response_cache cache;
+    EXPECT_FALSE(cache.get("Pa", "v1"));
+
+    cache.put("Pa", "v1", "hello");
+    ASSERT_TRUE(cache.get("Pa", "v1"));
+    EXPECT_EQ(*cache.get("Pa", "v1"), "hello");
+    EXPECT_FALSE(cache.get("Aa", "v1"));
+
+    // A new tip makes the entry unusable, and storing under it replaces the old one
+    EXPECT_FALSE(cache.get("Pa", "v2"));
+    cache.put("Pa", "v2", "world");
+    EXPECT_EQ(cache.get("Pa", "v2").value_or(""), "world");
+    EXPECT_FALSE(cache.get("Pa", "v1"));
+}
+
+TEST(rpc_response_cache, limit) {
+    cryptonote::rpc::response_cache cache;
+    for (size_t i = 0; i < cryptonote::rpc::response_cache::MAX_ENTRIES; i++)
+        cache.put(std::to_string(i), "v", "x");
+    EXPECT_TRUE(cache.get("0", "v"));
+
+    // Replacing an existing entry doesn't count against the limit, but a new one empties it
+    cache.put("0", "v", "y");
+    EXPECT_EQ(cache.get("0", "v").value_or(""), "y");
+    cache.put("new", "v", "z");
+    EXPECT_FALSE(cache.get("0", "v"));
+    EXPECT_TRUE(cache.get("new", "v"));
+}
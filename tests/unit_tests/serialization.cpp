@@ -147,6 +147,26 @@ TEST(serialization, binary_archive_integers_variable) {
   ASSERT_EQ(x, x1);
 }
 
+TEST(serialization, binary_string_unarchiver_truncated) {
+  auto data = "\x05\x80\x80\x01"s;
+  serialization::binary_string_unarchiver iar{data};
+  uint8_t a;
+  uint64_t b;
+  ASSERT_NO_THROW(iar.serialize_int(a));
+  ASSERT_EQ(a, 5);
+  ASSERT_EQ(iar.streampos(), 1);
+  ASSERT_THROW(iar.remaining_bytes(4), std::runtime_error);
+  ASSERT_NO_THROW(varint(iar, b));
+  ASSERT_EQ(b, 1 << 14);
+  ASSERT_EQ(iar.streampos(), 4);
+  ASSERT_THROW(iar.serialize_int(a), std::runtime_error);
+
+  // A varint that runs off the end of the data
+  auto data2 = "\x80\x80"s;
+  serialization::binary_string_unarchiver iar2{data2};
+  ASSERT_THROW(varint(iar2, b), std::runtime_error);
+}
+
 TEST(serialization, custom_type_serialization) {
   Struct1 s1;
   s1.si.push_back(0);
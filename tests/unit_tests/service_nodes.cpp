@@ -525,3 +525,58 @@ TEST(service_nodes, mainnet_unlock_dereg_periods)
   static_assert(conf.BLOCKS_IN(conf.UNLOCK_DURATION) == 15 * 720);
   static_assert(conf.BLOCKS_IN(conf.DEREGISTRATION_LOCK_DURATION) == 30 * 720);
 }
+
+TEST(service_nodes, voting_pool)
+{
+  cryptonote::keypair voter{hw::get_device("default")};
+  service_nodes::service_node_keys keys;
+  keys.pub = voter.pub;
+  keys.key = voter.sec;
+
+  service_nodes::voting_pool pool;
+  auto vote = [&](uint64_t height, uint16_t index, uint16_t worker) {
+    return service_nodes::make_state_change_vote(height, index, worker, service_nodes::new_state::decommission, 0, keys);
+  };
+
+  cryptonote::vote_verification_context vvc = {};
+  ASSERT_EQ(pool.add_pool_vote_if_unique(vote(100, 3, 1), vvc).size(), 1);
+  ASSERT_TRUE(vvc.m_added_to_pool);
+  ASSERT_EQ(pool.add_pool_vote_if_unique(vote(100, 1, 1), vvc).size(), 2);
+  ASSERT_TRUE(vvc.m_added_to_pool);
+
+  // Duplicates are rejected but still return the votes so far, ordered by voter
+  auto votes = pool.add_pool_vote_if_unique(vote(100, 3, 1), vvc);
+  ASSERT_FALSE(vvc.m_added_to_pool);
+  ASSERT_EQ(votes.size(), 2);
+  ASSERT_EQ(votes[0].vote.index_in_group, 1);
+  ASSERT_EQ(votes[1].vote.index_in_group, 3);
+
+  // A different worker at the same height is a separate group
+  ASSERT_EQ(pool.add_pool_vote_if_unique(vote(100, 3, 2), vvc).size(), 1);
+  ASSERT_TRUE(vvc.m_added_to_pool);
+  ASSERT_EQ(pool.add_pool_vote_if_unique(vote(130, 0, 1), vvc).size(), 1);
+
+  auto hf_version = cryptonote::hf::hf19_reward_batching;
+  auto relayable = pool.get_relayable_votes(130, hf_version, true);
+  ASSERT_EQ(relayable.size(), 4);
+  ASSERT_TRUE(pool.get_relayable_votes(130, hf_version, false).empty());
+
+  // Relayed votes aren't relayable again until some time has passed
+  std::vector<service_nodes::quorum_vote_t> relayed;
+  for (const auto& v : relayable)
+    if (v.block_height == 100)
+      relayed.push_back(v);
+  ASSERT_EQ(relayed.size(), 3);
+  pool.set_relayed(relayed);
+  relayable = pool.get_relayable_votes(130, hf_version, true);
+  ASSERT_EQ(relayable.size(), 1);
+  ASSERT_EQ(relayable[0].block_height, 130);
+
+  // Expiring drops everything for the old heights
+  ASSERT_FALSE(pool.received_checkpoint_vote(100, 3));  // (obligation votes aren't checkpoint votes)
+  pool.remove_expired_votes(100 + service_nodes::VOTE_LIFETIME + 1);
+  ASSERT_EQ(pool.add_pool_vote_if_unique(vote(100, 3, 1), vvc).size(), 1);
+  ASSERT_TRUE(vvc.m_added_to_pool);
+  ASSERT_EQ(pool.add_pool_vote_if_unique(vote(130, 0, 1), vvc).size(), 1);
+  ASSERT_FALSE(vvc.m_added_to_pool);
+}
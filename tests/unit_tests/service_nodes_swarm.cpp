@@ -653,3 +653,56 @@ TEST(swarm_to_snodes, deterministic_swarm_ids)
   EXPECT_EQ(ids[5046], 18442592317803069438ULL);
   EXPECT_EQ(ids[5047], 18445442251942264830ULL);
 }
+
+TEST(swarm_to_snodes, incremental_membership_matches_rebuild)
+{
+  // Applying membership changes one at a time must give exactly the map (including the order of
+  // each swarm's members, which calc_swarm_changes depends on) that we get building it from scratch
+  // with the active nodes in pubkey order.
+  std::mt19937_64 mt{42};
+  const std::vector<swarm_id_t> swarm_ids{0, 1000, 2000, 3000, UNASSIGNED_SWARM_ID};
+  auto random_swarm = [&]() -> std::optional<swarm_id_t> {
+    auto i = mt() % (swarm_ids.size() + 1);
+    if (i == swarm_ids.size())
+      return std::nullopt; // inactive
+    return swarm_ids[i];
+  };
+
+  std::map<crypto::public_key, std::optional<swarm_id_t>> nodes;
+  swarm_snode_map_t incremental;
+  auto rebuild = [&] {
+    swarm_snode_map_t swarms;
+    for (const auto& [pubkey, swarm] : nodes)
+      if (swarm)
+        swarms[*swarm].push_back(pubkey);
+    return swarms;
+  };
+
+  for (int i = 0; i < 3000; i++) {
+    auto action = mt() % 4;
+    if (action < 2 || nodes.empty()) { // new node
+      auto pubkey = newPubKey();
+      auto swarm = random_swarm();
+      nodes[pubkey] = swarm;
+      move_swarm_member(incremental, pubkey, std::nullopt, swarm);
+    } else {
+      auto it = std::next(nodes.begin(), mt() % nodes.size());
+      if (action == 2) { // change of swarm or active status
+        auto swarm = random_swarm();
+        move_swarm_member(incremental, it->first, it->second, swarm);
+        it->second = swarm;
+      } else { // removal
+        move_swarm_member(incremental, it->first, it->second, std::nullopt);
+        nodes.erase(it);
+      }
+    }
+    if (i % 100 == 0)
+      ASSERT_EQ(incremental, rebuild()) << "after " << i + 1 << " changes";
+  }
+
+  auto rebuilt = rebuild();
+  ASSERT_EQ(incremental, rebuilt);
+  calc_swarm_changes(incremental, 1234);
+  calc_swarm_changes(rebuilt, 1234);
+  EXPECT_EQ(incremental, rebuilt);
+}
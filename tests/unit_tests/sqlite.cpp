@@ -28,6 +28,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 #include "blockchain_db/sqlite/db_sqlite.h"
 
 #include "../blockchain_sqlite_test.h"
@@ -89,6 +91,100 @@ TEST(SQLITE, AddSNRewards)
   EXPECT_EQ(sqliteDB.batching_count(), 0);
 }
 
+TEST(SQLITE, BatchedRewardUpdates)
+{
+  test::BlockchainSQLiteTest sqliteDB(cryptonote::network_type::FAKECHAIN, ":memory:");
+
+  // Enough addresses to need several multi-row statements, with a partial chunk left over
+  cryptonote::block_payments payments;
+  for (uint32_t i = 1; i <= 300; i++) {
+    eth::address addr{};
+    std::memcpy(addr.data(), &i, sizeof(i));
+    payments[addr] = 1000 * i;
+  }
+
+  EXPECT_TRUE(sqliteDB.add_sn_rewards(payments));
+  EXPECT_TRUE(sqliteDB.add_sn_rewards(payments));
+  EXPECT_EQ(sqliteDB.batching_count(), 300);
+
+  EXPECT_TRUE(sqliteDB.subtract_sn_rewards(payments));
+  EXPECT_EQ(sqliteDB.batching_count(), 300);
+  EXPECT_TRUE(sqliteDB.subtract_sn_rewards(payments));
+  EXPECT_EQ(sqliteDB.batching_count(), 0);
+
+  // The rows were removed when they hit zero, so there is nothing left to subtract from
+  EXPECT_FALSE(sqliteDB.subtract_sn_rewards(payments));
+}
+
+TEST(SQLITE, DetachToRecentSnapshot)
+{
+  test::BlockchainSQLiteTest sqliteDB(cryptonote::network_type::FAKECHAIN, ":memory:");
+
+  eth::address addr{};
+  addr.data()[0] = 1;
+  cryptonote::block_payments payments;
+  payments[addr] = 1000;
+  const auto address_str = "0x{:x}"_format(addr);
+
+  for (uint64_t h = 1; h <= 4; h++) {
+    EXPECT_TRUE(sqliteDB.add_sn_rewards(payments));
+    sqliteDB.update_height(h);
+  }
+  EXPECT_EQ(sqliteDB.retrieve_amount_by_address(address_str), 4000);
+
+  // Detaching from height 3 leaves the chain at height 2, restored from the snapshot taken there
+  sqliteDB.blockchain_detached(3);
+  EXPECT_EQ(sqliteDB.height, 2);
+  EXPECT_EQ(sqliteDB.retrieve_amount_by_address(address_str), 2000);
+
+  // Adding blocks again continues from the restored state
+  EXPECT_TRUE(sqliteDB.add_sn_rewards(payments));
+  sqliteDB.update_height(3);
+  EXPECT_EQ(sqliteDB.retrieve_amount_by_address(address_str), 3000);
+  sqliteDB.blockchain_detached(2);
+  EXPECT_EQ(sqliteDB.height, 1);
+  EXPECT_EQ(sqliteDB.retrieve_amount_by_address(address_str), 1000);
+}
+
+TEST(SQLITE, L2EventStore)
+{
+  test::BlockchainSQLiteTest sqliteDB(cryptonote::network_type::FAKECHAIN, ":memory:");
+  EXPECT_FALSE(sqliteDB.load_l2_state());
+
+  std::vector<cryptonote::l2_stored_log> logs{
+      {100, 0, "0xaa", "0x01", {"0x1234", "0x5678"}, "0xdata1"},
+      {100, 1, "0xaa", "0x02", {"0x1234"}, "0xdata2"},
+      {105, 0, "0xbb", "0x03", {"0x9abc"}, "0xdata3"},
+      {120, 0, "0xcc", "0x04", {}, ""}};
+  sqliteDB.store_l2_logs(logs);
+
+  // A log from a different block at height 105 replaces the one from the reorged block
+  cryptonote::l2_stored_log reorged{105, 2, "0xdd", "0x05", {"0xdef0"}, "0xdata4"};
+  sqliteDB.store_l2_logs({&reorged, 1});
+
+  sqliteDB.store_l2_reward_rate(96, 1000);
+  sqliteDB.store_l2_reward_rate(112, 2000);
+  sqliteDB.store_l2_synced_height(130, 110);
+
+  // Logs above the safe height get discarded on load, so that they are fetched again
+  auto state = sqliteDB.load_l2_state();
+  ASSERT_TRUE(state);
+  EXPECT_EQ(state->synced_height, 110);
+  ASSERT_EQ(state->logs.size(), 3);
+  EXPECT_EQ(state->logs[0].topics, (std::vector<std::string>{"0x1234", "0x5678"}));
+  EXPECT_EQ(state->logs[1].data, "0xdata2");
+  EXPECT_EQ(state->logs[2].height, 105);
+  EXPECT_EQ(state->logs[2].block_hash, "0xdd");
+  EXPECT_EQ(state->reward_rates, (std::map<uint64_t, uint64_t>{{96, 1000}, {112, 2000}}));
+
+  sqliteDB.prune_l2_state(100, 100);
+  state = sqliteDB.load_l2_state();
+  ASSERT_TRUE(state);
+  ASSERT_EQ(state->logs.size(), 1);
+  EXPECT_EQ(state->logs[0].height, 105);
+  EXPECT_EQ(state->reward_rates.size(), 1);
+}
+
 TEST(SQLITE, CalculateRewards)
 {
   test::BlockchainSQLiteTest sqliteDB(cryptonote::network_type::TESTNET, ":memory:");
@@ -137,4 +233,18 @@ TEST(SQLITE, CalculateRewards)
   EXPECT_EQ(rewards[a1], 99 + 297); // fee + share
   EXPECT_EQ(rewards[a2], 297);
   EXPECT_EQ(rewards[a3], 306);
+
+  // Paying several nodes from one reward table is the same as paying each of them in turn
+  service_nodes::reward_table table;
+  table.add(single_contributor, hf_version, cryptonote::network_type::TESTNET);
+  table.add(multiple_contributors, hf_version, cryptonote::network_type::TESTNET);
+  table.add(single_contributor, hf_version, cryptonote::network_type::TESTNET);
+  ASSERT_EQ(table.size(), 3);
+  cryptonote::block_payments table_rewards;
+  sqliteDB.add_rewards(block.reward, table, table_rewards);
+  rewards.clear();
+  for (const auto* info : {&single_contributor, &multiple_contributors, &single_contributor})
+    sqliteDB.add_rewards(hf_version, block.reward, *info, rewards);
+  EXPECT_EQ(table_rewards, rewards);
+  EXPECT_EQ(table_rewards[a1], 2 * 1000 + 99 + 297);
 }
@@ -28,6 +28,8 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <set>
+
 #include "gtest/gtest.h"
 
 #include "common/util.h"
@@ -82,6 +84,50 @@ TEST(peer_list, merge_peer_lists)
 #define ADD_NODE_TO_PL(ip_, port_, id_, timestamp_) {  nodetool::peerlist_entry ple; epee::string_tools::get_ip_int32_from_string(ple.adr.ip, ip_); ple.last_seen = timestamp_; ple.adr.port = port_; ple.id = id_;outer_bs.push_back(ple);}  
 }
 
+TEST(peer_list, trim_and_select)
+{
+  nodetool::peerlist_manager plm;
+  plm.init(nodetool::peerlist_types{}, false);
+  const size_t limit = cryptonote::p2p::LOCAL_GRAY_PEERLIST_LIMIT;
+  for (uint32_t i = 1; i <= limit + 100; ++i)
+    ADD_GRAY_NODE(MAKE_IPV4_ADDRESS(10,1,i >> 8,i & 0xff, 8080), i, i);
+  for (uint32_t i = 1; i <= 300; ++i)
+    ADD_WHITE_NODE(MAKE_IPV4_ADDRESS(10,2,i >> 8,i & 0xff, 8080), i, i);
+
+  // The oldest entries get trimmed; by-index lookups go newest first
+  ASSERT_EQ(plm.get_gray_peers_count(), limit);
+  nodetool::peerlist_entry pe;
+  ASSERT_TRUE(plm.get_gray_peer_by_index(pe, 0));
+  EXPECT_EQ(pe.last_seen, limit + 100);
+  ASSERT_TRUE(plm.get_gray_peer_by_index(pe, limit - 1));
+  EXPECT_EQ(pe.last_seen, 101);
+  EXPECT_FALSE(plm.get_gray_peer_by_index(pe, limit));
+  ASSERT_TRUE(plm.get_random_gray_peer(pe));
+  EXPECT_GT(pe.last_seen, 100);
+
+  std::vector<nodetool::peerlist_entry> head;
+  ASSERT_TRUE(plm.get_peerlist_head(head, false, 10));
+  ASSERT_EQ(head.size(), 10);
+  EXPECT_EQ(head.front().last_seen, 300);
+  EXPECT_EQ(head.back().last_seen, 291);
+
+  // Anonymized heads are a random subset, without duplicates or timestamps
+  head.clear();
+  ASSERT_TRUE(plm.get_peerlist_head(head, true, 250));
+  ASSERT_EQ(head.size(), 250);
+  std::set<uint64_t> ids;
+  for (const auto& e : head)
+  {
+    EXPECT_EQ(e.last_seen, 0);
+    ids.insert(e.id);
+  }
+  EXPECT_EQ(ids.size(), 250);
+
+  head.clear();
+  ASSERT_TRUE(plm.get_peerlist_head(head, true, 1000));
+  EXPECT_EQ(head.size(), 300);
+}
+
 namespace
 {
   bool check_empty(nodetool::peerlist_storage& peers, std::initializer_list<epee::net_utils::zone> zones)
@@ -31,6 +31,7 @@
 #include "gtest/gtest.h"
 
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "rpc/core_rpc_server_binary_commands.h"
 #include "epee/storages/portable_storage_template_helper.h"
 
 TEST(protocol_pack, protocol_pack_command) 
@@ -53,3 +54,207 @@ TEST(protocol_pack, protocol_pack_command)
     ASSERT_TRUE(r.total_height == 3);
   }
 }
+
+TEST(protocol_pack, get_blocks_bin_serialize_response)
+{
+  using GBB = cryptonote::rpc::GET_BLOCKS_BIN;
+
+  auto check = [](const std::vector<GBB::block_blobs>& blocks, const std::vector<GBB::block_output_indices>& indices)
+  {
+    GBB::response res{};
+    for (const auto& b : blocks)
+    {
+      auto& e = res.blocks.emplace_back();
+      e.block = b.block;
+      e.txs.assign(b.txs.begin(), b.txs.end());
+    }
+    res.output_indices = indices;
+    res.start_height = 123;
+    res.current_height = 1ULL << 40;
+    res.status = "OK";
+    res.untrusted = true;
+
+    std::string expected;
+    ASSERT_TRUE(epee::serialization::store_t_to_binary(res, expected));
+    EXPECT_EQ(GBB::serialize_response(blocks, res.start_height, res.current_height, res.status, indices, res.untrusted), expected);
+  };
+
+  check({}, {});
+
+  std::string big(70000, 'x'), medium(300, 'y');
+  std::vector<GBB::block_blobs> blocks;
+  blocks.push_back({"block one", {"tx a", "", big}});
+  blocks.push_back({medium, {}});
+  blocks.push_back({"", {medium}});
+
+  std::vector<GBB::block_output_indices> indices(3);
+  indices[0].indices.resize(3);
+  indices[0].indices[0].indices = {1, 2, 3};
+  indices[0].indices[2].indices = {1ULL << 63};
+  indices[2].indices.resize(1);
+  indices[2].indices[0].indices.resize(100, 42);
+
+  check(blocks, indices);
+  check(blocks, {});
+}
+
+TEST(protocol_pack, get_blocks_bin_request_max_count)
+{
+  using GBB = cryptonote::rpc::GET_BLOCKS_BIN;
+
+  GBB::request req{};
+  req.start_height = 1000;
+  req.prune = true;
+  std::string unlimited;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, unlimited));
+
+  // Left at 0 it isn't sent at all, so old daemons see exactly the request they always did
+  req.max_count = 250;
+  std::string limited;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, limited));
+  EXPECT_GT(limited.size(), unlimited.size());
+
+  GBB::request req2{};
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(req2, limited));
+  EXPECT_EQ(req2.max_count, 250);
+  EXPECT_EQ(req2.start_height, 1000);
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(req2, unlimited));
+  EXPECT_EQ(req2.max_count, 0);
+}
+
+namespace {
+
+struct legacy_inner
+{
+  std::string name;
+  uint32_t value = 0;
+
+  BEGIN_KV_SERIALIZE_MAP()
+    KV_SERIALIZE(value)
+    KV_SERIALIZE(name)
+  END_KV_SERIALIZE_MAP()
+};
+
+struct writer_inner
+{
+  uint64_t b = 0;
+  std::string a;
+  std::vector<legacy_inner> legacy;
+
+  KV_MAP_SERIALIZABLE
+};
+
+struct writer_outer
+{
+  // Deliberately not in key order
+  std::string zeta;
+  int64_t alpha = 0;
+  bool flag = false;
+  crypto::hash hash{};
+  std::vector<crypto::hash> hashes;
+  std::vector<uint64_t> numbers;
+  std::list<std::string> strings;
+  std::optional<uint32_t> opt_set, opt_unset;
+  uint16_t with_default = 7;
+  writer_inner inner;
+  std::vector<writer_inner> inners;
+  legacy_inner legacy;
+
+  KV_MAP_SERIALIZABLE
+};
+
+KV_SERIALIZE_MAP_CODE_BEGIN(writer_inner)
+  KV_SERIALIZE(b)
+  KV_SERIALIZE(a)
+  KV_SERIALIZE(legacy)
+KV_SERIALIZE_MAP_CODE_END()
+
+KV_SERIALIZE_MAP_CODE_BEGIN(writer_outer)
+  KV_SERIALIZE(zeta)
+  KV_SERIALIZE(alpha)
+  KV_SERIALIZE(flag)
+  KV_SERIALIZE_VAL_POD_AS_BLOB(hash)
+  KV_SERIALIZE_CONTAINER_POD_AS_BLOB(hashes)
+  KV_SERIALIZE(numbers)
+  KV_SERIALIZE(strings)
+  KV_SERIALIZE(opt_set)
+  KV_SERIALIZE(opt_unset)
+  KV_SERIALIZE_OPT(with_default, (uint16_t)7)
+  KV_SERIALIZE(inner)
+  KV_SERIALIZE(inners)
+  KV_SERIALIZE(legacy)
+KV_SERIALIZE_MAP_CODE_END()
+
+template <typename T>
+std::string store_with_portable_storage(const T& t)
+{
+  epee::serialization::portable_storage ps;
+  t.store(ps);
+  std::string out;
+  EXPECT_TRUE(ps.store_to_binary(out));
+  return out;
+}
+
+template <typename T>
+std::string store_with_binary_writer(const T& t)
+{
+  epee::serialization::binary_writer writer;
+  EXPECT_TRUE(t.store(writer));
+  return writer.finish();
+}
+
+}
+
+TEST(protocol_pack, binary_writer_matches_portable_storage)
+{
+  writer_outer o;
+  EXPECT_EQ(store_with_binary_writer(o), store_with_portable_storage(o));
+
+  o.zeta = std::string(100, 'z');
+  o.alpha = -12345678901;
+  o.flag = true;
+  o.hash.data_[0] = 1;
+  o.hashes.resize(3);
+  o.hashes[2].data_[31] = 2;
+  o.numbers = {1, 1ULL << 40, 3};
+  o.strings = {"", "x", std::string(20000, 's')};
+  o.opt_set = 42;
+  o.with_default = 8;
+  o.inner.a = "a";
+  o.inner.b = 2;
+  o.inner.legacy.push_back({"one", 1});
+  o.inners.resize(70);
+  o.inners[5].a = "five";
+  o.inners[69].legacy.resize(2);
+  o.legacy = {"legacy", 3};
+  auto expected = store_with_portable_storage(o);
+  EXPECT_EQ(store_with_binary_writer(o), expected);
+  EXPECT_EQ(epee::serialization::store_t_to_binary(o), expected);
+
+  writer_outer o2;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(o2, expected));
+  EXPECT_EQ(o2.zeta, o.zeta);
+  EXPECT_EQ(o2.strings, o.strings);
+  EXPECT_EQ(o2.inners.size(), 70);
+  EXPECT_EQ(o2.inners[5].a, "five");
+  EXPECT_EQ(o2.legacy.name, "legacy");
+}
+
+TEST(protocol_pack, binary_writer_large_section)
+{
+  // More than 63 entries needs a wider count varint, which the writer has to make room for
+  epee::serialization::portable_storage ps;
+  epee::serialization::binary_writer writer;
+  for (int i = 99; i >= 0; i--)
+  {
+    auto name = "v" + std::to_string(i);
+    ps.set_value(name, std::to_string(i), nullptr);
+    writer.set_value(name, std::to_string(i));
+  }
+  // Storing a value again replaces it
+  ps.set_value("v50", uint8_t{50}, nullptr);
+  writer.set_value("v50", uint8_t{50});
+  std::string expected;
+  ASSERT_TRUE(ps.store_to_binary(expected));
+  EXPECT_EQ(writer.finish(), expected);
+}
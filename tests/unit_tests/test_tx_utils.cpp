@@ -135,6 +135,31 @@ TEST(parse_tx_extra, handles_pub_key_and_padding)
   ASSERT_TRUE(std::holds_alternative<cryptonote::tx_extra_padding>(tx_extra_fields[1]));
 }
 
+TEST(parse_tx_extra, cached_fields)
+{
+  cryptonote::transaction tx{};
+  crypto::public_key pk1, pk2;
+  std::memset(pk1.data(), 1, pk1.size());
+  std::memset(pk2.data(), 2, pk2.size());
+  cryptonote::add_tx_extra<cryptonote::tx_extra_pub_key>(tx, pk1);
+  ASSERT_EQ(pk1, cryptonote::get_tx_pub_key_from_extra(tx));
+  ASSERT_NE(tx.extra_cache.get(), nullptr);
+
+  // Changing the extra after it has been cached must not return stale fields
+  tx.extra.clear();
+  cryptonote::add_tx_extra<cryptonote::tx_extra_pub_key>(tx, pk2);
+  ASSERT_EQ(pk2, cryptonote::get_tx_pub_key_from_extra(tx));
+
+  // Copies start out without a cache
+  cryptonote::transaction copy = tx;
+  ASSERT_EQ(copy.extra_cache.get(), nullptr);
+  ASSERT_EQ(pk2, cryptonote::get_tx_pub_key_from_extra(copy));
+
+  tx.extra = {1};
+  cryptonote::tx_extra_pub_key field;
+  ASSERT_FALSE(cryptonote::get_field_from_tx_extra(tx, field));
+}
+
 TEST(parse_and_validate_tx_extra, is_valid_tx_extra_parsed)
 {
   cryptonote::transaction tx{};
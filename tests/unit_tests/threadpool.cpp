@@ -31,6 +31,8 @@
 #include "common/threadpool.h"
 #include <thread>
 #include <chrono>
+#include <numeric>
+#include <vector>
 
 using namespace std::literals;
 
@@ -147,3 +149,54 @@ TEST(threadpool, leaf_reentrancy)
   waiter.wait(tpool.get());
   ASSERT_EQ(counter, 500000);
 }
+
+TEST(threadpool, parallel_for)
+{
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(4));
+
+  std::vector<int> hits(10000);
+  tpool->parallel_for(0, hits.size(), [&](size_t i){ hits[i]++; }, 16);
+  ASSERT_EQ(std::count(hits.begin(), hits.end(), 1), hits.size());
+
+  // Nested loops, including from inside pool tasks
+  std::atomic<int> counter(0);
+  tpool->parallel_for(0, 100, [&](size_t){
+    tpool->parallel_for(0, 100, [&](size_t){ ++counter; });
+  });
+  ASSERT_EQ(counter, 10000);
+
+  // Too little work to split up runs in this thread
+  auto me = std::this_thread::get_id();
+  bool here = false;
+  tpool->parallel_for(5, 6, [&](size_t i){ here = i == 5 && std::this_thread::get_id() == me; });
+  ASSERT_TRUE(here);
+}
+
+TEST(threadpool, stats)
+{
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(4));
+  tools::threadpool::waiter waiter;
+
+  for (int i = 0; i < 100; ++i)
+    tpool->submit(&waiter, [](){}, "a");
+  for (int i = 0; i < 50; ++i)
+    tpool->submit(&waiter, [](){}, "b", true);
+  for (int i = 0; i < 25; ++i)
+    tpool->submit(&waiter, [](){});
+  waiter.wait(tpool.get());
+
+  auto stats = tpool->get_stats();
+  ASSERT_EQ(stats.threads, 4);
+  ASSERT_EQ(stats.queued, 0);
+  ASSERT_GE(stats.max_queued, 1);
+  ASSERT_LE(stats.max_queued, 175);
+  ASSERT_EQ(stats.total.submitted, 175);
+  ASSERT_EQ(stats.total.executed, 175);
+  const auto& run = stats.total.run_histogram, &wait = stats.total.wait_histogram;
+  ASSERT_EQ(std::accumulate(run.begin(), run.end(), uint64_t{0}), 175);
+  ASSERT_EQ(std::accumulate(wait.begin(), wait.end(), uint64_t{0}), 175);
+  ASSERT_EQ(stats.tags.size(), 2);
+  ASSERT_EQ(stats.tags["a"].executed, 100);
+  ASSERT_EQ(stats.tags["b"].submitted, 50);
+  ASSERT_EQ(stats.tags["b"].executed, 50);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include <thread>
+
+#include "logging/trace.h"
+
+namespace trace = oxen::logging::trace;
+
+namespace {
+
+auto logcat = oxen::log::Cat("test.trace");
+
+// Returns the names of the complete ("X") events in a dump
+std::vector<std::string> span_names(const std::string& dump) {
+    auto j = nlohmann::json::parse(dump);
+    std::vector<std::string> names;
+    for (const auto& e : j.at("traceEvents"))
+        if (e.at("ph") == "X")
+            names.push_back(e.at("name").get<std::string>());
+    return names;
+}
+
+}  // namespace
+
+TEST(trace, records_only_while_enabled) {
+    trace::clear();
+    { trace::span s{logcat, "before"}; }
+    trace::enable();
+    { trace::span s{logcat, "during"}; }
+    std::thread{[] { trace::span s{logcat, "other_thread"}; }}.join();
+    trace::enable(false);
+    { trace::span s{logcat, "after"}; }
+
+    auto names = span_names(trace::dump_chrome_trace());
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(names, (std::vector<std::string>{"during", "other_thread"}));
+
+    trace::clear();
+    EXPECT_TRUE(span_names(trace::dump_chrome_trace()).empty());
+}
+
+TEST(trace, keeps_newest_spans) {
+    trace::clear();
+    trace::enable();
+    std::thread{[] {
+        { trace::span s{logcat, "oldest"}; }
+        for (size_t i = 0; i < trace::THREAD_BUFFER_SPANS; i++)
+            trace::span s{logcat, "newer"};
+    }}.join();
+    trace::enable(false);
+
+    auto names = span_names(trace::dump_chrome_trace());
+    EXPECT_EQ(names.size(), trace::THREAD_BUFFER_SPANS);
+    EXPECT_EQ(std::count(names.begin(), names.end(), "oldest"), 0);
+    trace::clear();
+}
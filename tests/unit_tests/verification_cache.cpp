@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "cryptonote_core/verification_cache.h"
+#include "ringct/rctOps.h"
+
+namespace {
+
+crypto::hash make_hash(uint8_t a, uint8_t b = 0) {
+    crypto::hash h{};
+    h.data()[0] = a;
+    h.data()[crypto::hash::size() - 1] = b;
+    return h;
+}
+
+}  // namespace
+
+TEST(verification_cache, keys) {
+    auto txid = make_hash(1);
+    rct::rctSig rv;
+    rv.mixRing.resize(1);
+    rv.mixRing[0].push_back({rct::pkGen(), rct::pkGen()});
+    rv.mixRing[0].push_back({rct::pkGen(), rct::pkGen()});
+
+    auto rk = cryptonote::verification_cache::ring_key(txid, rv);
+    EXPECT_EQ(rk, cryptonote::verification_cache::ring_key(txid, rv));
+    EXPECT_NE(rk, cryptonote::verification_cache::semantics_key(txid));
+    EXPECT_NE(rk, cryptonote::verification_cache::ring_key(make_hash(2), rv));
+
+    // Any change to the ring members must change the key
+    auto rv2 = rv;
+    rv2.mixRing[0][1].mask = rct::pkGen();
+    EXPECT_NE(rk, cryptonote::verification_cache::ring_key(txid, rv2));
+
+    // As must the same members in a different ring layout
+    auto rv3 = rv;
+    rv3.mixRing.resize(2);
+    rv3.mixRing[1].push_back(rv3.mixRing[0].back());
+    rv3.mixRing[0].pop_back();
+    EXPECT_NE(rk, cryptonote::verification_cache::ring_key(txid, rv3));
+}
+
+TEST(verification_cache, add_and_detach) {
+    cryptonote::verification_cache cache;
+    auto a = make_hash(1), b = make_hash(2), c = make_hash(3);
+    cache.add(a, 100);
+    cache.add(b, 105);
+    cache.add(c, 110);
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_TRUE(cache.have(a));
+    EXPECT_FALSE(cache.have(make_hash(4)));
+
+    cache.blockchain_detached(105);
+    EXPECT_TRUE(cache.have(a));
+    EXPECT_FALSE(cache.have(b));
+    EXPECT_FALSE(cache.have(c));
+    EXPECT_EQ(cache.size(), 1);
+
+    cache.clear();
+    EXPECT_FALSE(cache.have(a));
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(verification_cache, eviction) {
+    // 16 shards of 2 entries each; all of these keys land in the same shard
+    cryptonote::verification_cache cache{32};
+    auto a = make_hash(1, 5), b = make_hash(2, 5), c = make_hash(3, 5);
+    cache.add(a, 1);
+    cache.add(b, 1);
+    cache.add(c, 1);
+    EXPECT_FALSE(cache.have(a));
+    EXPECT_TRUE(cache.have(b));
+    EXPECT_TRUE(cache.have(c));
+
+    // Keys in other shards are unaffected
+    auto d = make_hash(1, 6);
+    cache.add(d, 1);
+    EXPECT_TRUE(cache.have(d));
+    EXPECT_EQ(cache.size(), 3);
+}
@@ -3,6 +3,8 @@
 #include <wallet3/db/walletdb.hpp>
 #include <sqlitedb/database.hpp>
 
+#include <thread>
+
 TEST_CASE("DB Schema", "[wallet,db]")
 {
   wallet::WalletDB db{fs::path(":memory:"), ""};
@@ -71,6 +73,10 @@ TEST_CASE("DB Triggers", "[wallet,db]")
   {
     REQUIRE(db.prepared_get<int64_t>("SELECT amount FROM outputs WHERE id = 0") == 42);
     REQUIRE(db.overall_balance() == 42);
+    REQUIRE(db.available_balance(std::nullopt) == 42);
+    REQUIRE(db.unlocked_balance() == 42);
+    REQUIRE(db.subaddress_balance({0, 0}) == 42);
+    REQUIRE(db.subaddress_balance({0, 1}) == 0);
   }
 
   REQUIRE_NOTHROW(db.prepared_exec("INSERT INTO blocks VALUES(?,?,?,?);", 1, 0, "bar", 0));
@@ -80,6 +86,9 @@ TEST_CASE("DB Triggers", "[wallet,db]")
   SECTION("Confirm spend insert triggers")
   {
     REQUIRE(db.overall_balance() == 0);
+    REQUIRE(db.available_balance(std::nullopt) == 0);
+    REQUIRE(db.unlocked_balance() == 0);
+    REQUIRE(db.subaddress_balance({0, 0}) == 0);
     REQUIRE(db.prepared_get<int64_t>("SELECT spent_height FROM outputs WHERE key_image = 0") == 1);
   }
 
@@ -97,6 +106,8 @@ TEST_CASE("DB Triggers", "[wallet,db]")
     // existing output's spend height should be back to 0.
     REQUIRE(db.prepared_get<int>("SELECT COUNT(*) FROM spends;") == 0);
     REQUIRE(db.overall_balance() == 42);
+    REQUIRE(db.available_balance(std::nullopt) == 42);
+    REQUIRE(db.subaddress_balance({0, 0}) == 42);
     REQUIRE(db.prepared_get<int64_t>("SELECT spent_height FROM outputs WHERE key_image = 0") == 0);
   }
 
@@ -110,10 +121,46 @@ TEST_CASE("DB Triggers", "[wallet,db]")
     // key image should be removed as nothing references it.
     REQUIRE(db.prepared_get<int>("SELECT COUNT(*) FROM outputs;") == 0);
     REQUIRE(db.overall_balance() == 0);
+    REQUIRE(db.available_balance(std::nullopt) == 0);
+    REQUIRE(db.unlocked_balance() == 0);
+    REQUIRE(db.prepared_get<int64_t>("SELECT COUNT(*) FROM unlock_buckets;") == 0);
     REQUIRE(db.prepared_get<int64_t>("SELECT COUNT(*) FROM key_images;") == 0);
   }
 }
 
+TEST_CASE("DB read snapshots", "[wallet,db]")
+{
+  // Read snapshots need their own connections, so this needs an actual file
+  auto path = fs::temp_directory_path() / "wallet3-read-snapshot-test.sqlite";
+  auto remove = [&] {
+    for (auto suffix : {"", "-wal", "-shm"})
+      fs::remove(path.string() + suffix);
+  };
+  remove();
+  {
+    wallet::WalletDB db{path, ""};
+    db.create_schema();
+    db.prepared_exec("INSERT INTO blocks VALUES(?,?,?,?);", 0, 0, "foo", 0);
+
+    auto count_blocks = [&] { return db.prepared_get<int>("SELECT COUNT(*) FROM blocks"); };
+    {
+      auto snapshot = db.read_snapshot();
+      REQUIRE(count_blocks() == 1);
+
+      // A write from another thread goes through the main connection, and isn't seen here
+      std::thread writer{[&] {
+        db.prepared_exec("INSERT INTO blocks VALUES(?,?,?,?);", 1, 0, "bar", 0);
+      }};
+      writer.join();
+      REQUIRE(count_blocks() == 1);
+
+      // Nor can we write inside it
+      REQUIRE_THROWS(db.prepared_exec("INSERT INTO blocks VALUES(?,?,?,?);", 2, 0, "baz", 0));
+    }
+    REQUIRE(count_blocks() == 2);
+  }
+  remove();
+}
 
 /*
     // SQLiteCpp could throw on a bad query, so make sure the exception caught
@@ -97,6 +97,17 @@ class MockKeyring : public Keyring
       throw std::invalid_argument{"mock_keyring, output_amount_and_mask called on output that isn't ours"};
     }
 
+    virtual std::vector<std::pair<uint64_t, rct::key>>
+    output_amounts_and_masks(
+        const rct::rctSig& rv,
+        const std::vector<std::pair<crypto::key_derivation, unsigned int>>& outputs) override
+    {
+      std::vector<std::pair<uint64_t, rct::key>> result;
+      for (const auto& [derivation, i] : outputs)
+        result.push_back(output_amount_and_mask(rv, derivation, i));
+      return result;
+    }
+
     void
     add_tx_key(const std::string_view& key)
     {
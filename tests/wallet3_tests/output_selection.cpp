@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include <wallet3/output_selection/output_selection.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+  std::vector<wallet::Output>
+  make_outputs(std::initializer_list<int64_t> amounts)
+  {
+    std::vector<wallet::Output> outputs;
+    for (auto amount : amounts)
+    {
+      outputs.emplace_back();
+      outputs.back().amount = amount;
+      outputs.back().global_index = outputs.size();
+    }
+    return outputs;
+  }
+
+  int64_t
+  total(const std::vector<wallet::Output>& outputs)
+  {
+    return std::accumulate(outputs.begin(), outputs.end(), int64_t{0},
+        [](int64_t sum, const wallet::Output& o) { return sum + o.amount; });
+  }
+}
+
+TEST_CASE("Output Selection", "[wallet,tx]")
+{
+  wallet::OutputSelector select_outputs{};
+  for (int64_t input_count = 1; input_count < 10; ++input_count)
+    select_outputs.push_fee(input_count, 10 * input_count);
+
+  SECTION("Prefers the smallest single output that covers the amount")
+  {
+    auto outputs = make_outputs({500, 90, 200, 120, 111, 110});
+    auto chosen = select_outputs(outputs, 100);
+    REQUIRE(chosen.size() == 1);
+    REQUIRE(chosen[0].amount == 111);
+  }
+
+  SECTION("Uses the fewest outputs, with the least change")
+  {
+    auto outputs = make_outputs({100, 60, 45, 80, 30, 74});
+    // No single output covers 150 + 10, but the two largest cover 150 + 20; of the pairs that
+    // do, 100 + 74 leaves the least over.
+    auto chosen = select_outputs(outputs, 150);
+    REQUIRE(chosen.size() == 2);
+    REQUIRE(total(chosen) == 174);
+
+    // Needs three outputs, and 100 + 80 + 45 is exactly 195 + 30
+    chosen = select_outputs(outputs, 195);
+    REQUIRE(chosen.size() == 3);
+    REQUIRE(total(chosen) == 225);
+  }
+
+  SECTION("Does not choose the same output twice")
+  {
+    auto outputs = make_outputs({50, 50, 50, 50});
+    auto chosen = select_outputs(outputs, 150);
+    REQUIRE(chosen.size() == 4);
+    std::vector<int64_t> indices;
+    for (const auto& o : chosen)
+      indices.push_back(o.global_index);
+    std::sort(indices.begin(), indices.end());
+    REQUIRE(std::unique(indices.begin(), indices.end()) == indices.end());
+  }
+
+  SECTION("Fails if the outputs cannot cover the amount and fee")
+  {
+    REQUIRE_THROWS(select_outputs(make_outputs({}), 1));
+    REQUIRE_THROWS(select_outputs(make_outputs({50, 50, 50}), 121));
+  }
+
+  SECTION("Fails if covering the amount needs more inputs than there are fees for")
+  {
+    auto outputs = make_outputs({20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20});
+    REQUIRE_THROWS(select_outputs(outputs, 100));
+  }
+}
@@ -4,6 +4,7 @@
 #include <catch2/catch.hpp>
 
 #include <wallet3/transaction_scanner.hpp>
+#include <wallet3/block.hpp>
 #include <wallet3/block_tx.hpp>
 
 #include <crypto/crypto.h>
@@ -102,4 +103,39 @@ TEST_CASE("Transaction Scanner", "[wallet]")
     REQUIRE(outs.size() == 1);
     REQUIRE(outs[0].amount == 42);
   }
+
+  SECTION("scanning a batch of blocks keeps outputs with their block and tx")
+  {
+    rct::key mask1;
+    tools::load_from_hex_guts("deadbeef000000000000000000000000000000000000000000000000deadbeef"sv, mask1);
+    keys->add_key_index_pair_as_ours(tx_pubkey1, 0, 0, {2,1}, mask1);
+
+    wallet::BlockTX not_ours;
+    cryptonote::add_tx_extra<cryptonote::tx_extra_pub_key>(not_ours.tx, tx_pubkey1);
+    not_ours.tx.vout.push_back(out2);
+    not_ours.global_indices.resize(1, 0);
+
+    std::vector<wallet::Block> blocks(3);
+    for (size_t i = 0; i < blocks.size(); i++)
+      blocks[i].height = 10 + i;
+    blocks[0].transactions = {not_ours, block_tx};
+    blocks[2].transactions = {block_tx};
+
+    auto received = scanner->scan_received(blocks);
+    REQUIRE(received.size() == 3);
+    REQUIRE(received[0].size() == 2);
+    REQUIRE(received[0][0].empty());
+    REQUIRE(received[0][1].size() == 1);
+    REQUIRE(received[0][1][0].block_height == 10);
+    REQUIRE(received[0][1][0].subaddress_index == cryptonote::subaddress_index{2,1});
+    REQUIRE(received[1].empty());
+    REQUIRE(received[2].size() == 1);
+    REQUIRE(received[2][0].size() == 1);
+    REQUIRE(received[2][0][0].block_height == 12);
+
+    wallet::BlockTX bad = block_tx;
+    bad.global_indices.clear();
+    blocks[1].transactions = {bad};
+    REQUIRE_THROWS_AS(scanner->scan_received(blocks), std::invalid_argument);
+  }
 }
@@ -0,0 +1,488 @@
+// Wallet sync benchmark: feeds a generated block range to wallet2's process_parsed_blocks or to
+// the wallet3 scanner and database, the same way each would receive blocks from a daemon, and
+// reports blocks/s, outputs scanned/s, the time spent writing the wallet's storage, and peak RSS.
+//
+// The blocks are generated from a seed, so runs with the same options scan identical chains and
+// can be compared across builds.  Each transaction pays a configurable fraction of its outputs to
+// the benchmark wallet's subaddresses (with real RingCT amount encoding, so owned outputs cost
+// what they do on chain); all other outputs go to random keys.
+
+#include <fmt/core.h>
+#include <sys/resource.h>
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "common/format.h"
+#include "crypto/crypto.h"
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "device/device.hpp"
+#include "logging/oxen_logger.h"
+#include "ringct/rctOps.h"
+#include "wallet/wallet2.h"
+#include "wallet3/block.hpp"
+#include "wallet3/daemon_comms.hpp"
+#include "wallet3/db/walletdb.hpp"
+#include "wallet3/wallet.hpp"
+
+namespace po = boost::program_options;
+using namespace std::literals;
+using steady = std::chrono::steady_clock;
+
+// wallet2 keeps its block processing private; it befriends this name for tests
+class wallet_accessor_test {
+  public:
+    static crypto::hash genesis_hash(const tools::wallet2& wallet) {
+        return wallet.m_blockchain[0];
+    }
+    static void process_parsed_blocks(
+            tools::wallet2& wallet,
+            uint64_t start_height,
+            const std::vector<cryptonote::block_complete_entry>& blocks,
+            const std::vector<tools::wallet2::parsed_block>& parsed_blocks,
+            uint64_t& blocks_added) {
+        wallet.process_parsed_blocks(start_height, blocks, parsed_blocks, blocks_added);
+    }
+};
+
+namespace {
+
+struct options {
+    uint64_t blocks = 1000;
+    unsigned txs_per_block = 10;
+    unsigned outputs_per_tx = 2;
+    double owned_fraction = 0.01;
+    uint32_t subaddresses = 100;
+    size_t batch = 100;  // blocks handed to the wallet at a time
+    uint64_t seed = 1;
+};
+
+struct generated_tx {
+    crypto::hash hash;
+    cryptonote::transaction tx;
+    std::vector<uint64_t> global_indices;
+};
+
+struct generated_block {
+    crypto::hash hash;
+    cryptonote::block block;  // with miner_tx, and tx_hashes of `txs`
+    std::vector<uint64_t> miner_global_indices;
+    std::vector<generated_tx> txs;
+};
+
+struct chain_stats {
+    uint64_t txs = 0;
+    uint64_t outputs = 0;
+    uint64_t owned = 0;
+};
+
+// Generates the benchmark chain, starting at height 1 (on top of the wallets' genesis).
+class chain_generator {
+  public:
+    chain_generator(const options& opts, const cryptonote::account_keys& keys) :
+            opts{opts}, rng{opts.seed}, view_pub{keys.m_account_address.m_view_public_key} {
+        subaddress_spend_keys = hw::get_device("default").get_subaddress_spend_public_keys(
+                keys, 0, 0, opts.subaddresses);
+    }
+
+    std::vector<generated_block> generate(chain_stats& stats) {
+        std::vector<generated_block> chain(opts.blocks);
+        const auto now = static_cast<uint64_t>(std::time(nullptr));
+        crypto::hash prev{};
+        for (uint64_t i = 0; i < opts.blocks; i++) {
+            auto& gb = chain[i];
+            auto& b = gb.block;
+            b.major_version = cryptonote::hf::hf19_reward_batching;
+            b.minor_version = static_cast<uint8_t>(b.major_version);
+            b.timestamp = now;
+            b.prev_id = prev;
+
+            auto& miner = b.miner_tx.emplace();
+            miner.version = cryptonote::txversion::v4_tx_types;
+            miner.type = cryptonote::txtype::standard;
+            miner.vin.push_back(cryptonote::txin_gen{static_cast<size_t>(i + 1)});
+            add_outputs(miner, 1, false, gb.miner_global_indices, stats);
+
+            for (unsigned t = 0; t < opts.txs_per_block; t++) {
+                auto& gtx = gb.txs.emplace_back();
+                auto& tx = gtx.tx;
+                tx.version = cryptonote::txversion::v4_tx_types;
+                tx.type = cryptonote::txtype::standard;
+                cryptonote::txin_to_key in{};
+                in.key_offsets = {next_global_index / 2, 1};
+                in.k_image = random_key<crypto::key_image>();
+                tx.vin.push_back(std::move(in));
+                add_outputs(tx, opts.outputs_per_tx, true, gtx.global_indices, stats);
+                gtx.hash = random_key<crypto::hash>();
+                b.tx_hashes.push_back(gtx.hash);
+                stats.txs++;
+            }
+            gb.hash = random_key<crypto::hash>();
+            prev = gb.hash;
+        }
+        return chain;
+    }
+
+  private:
+    template <typename T>
+    T random_key() {
+        T k;
+        for (size_t i = 0; i < k.size(); i += 8) {
+            uint64_t r = rng();
+            std::memcpy(k.data() + i, &r, std::min<size_t>(8, k.size() - i));
+        }
+        return k;
+    }
+
+    void add_outputs(
+            cryptonote::transaction& tx,
+            unsigned count,
+            bool rct,
+            std::vector<uint64_t>& global_indices,
+            chain_stats& stats) {
+        crypto::public_key tx_pub;
+        crypto::secret_key tx_sec;
+        crypto::generate_keys(tx_pub, tx_sec);
+        cryptonote::add_tx_extra<cryptonote::tx_extra_pub_key>(tx, tx_pub);
+        crypto::key_derivation derivation;
+        crypto::generate_key_derivation(view_pub, tx_sec, derivation);
+
+        if (rct)
+            tx.rct_signatures.type = rct::RCTType::CLSAG;
+        for (unsigned i = 0; i < count; i++) {
+            bool owned = std::uniform_real_distribution<>{}(rng) < opts.owned_fraction;
+            uint64_t amount = 1'000'000'000 + rng() % 1'000'000'000;
+            crypto::public_key out_key;
+            rct::ecdhTuple ecdh{};
+            rct::ctkey out_pk{};
+            if (owned) {
+                const auto& spend = subaddress_spend_keys[rng() % subaddress_spend_keys.size()];
+                crypto::derive_public_key(derivation, i, spend, out_key);
+                if (rct) {
+                    crypto::ec_scalar scalar;
+                    crypto::derivation_to_scalar(derivation, i, scalar);
+                    rct::key shared;
+                    std::memcpy(shared.bytes, scalar.data(), sizeof(shared.bytes));
+                    out_pk.mask = rct::commit(amount, rct::genCommitmentMask(shared));
+                    ecdh.amount = rct::d2h(amount);
+                    rct::ecdhEncode(ecdh, shared, true);
+                }
+                stats.owned++;
+            } else {
+                crypto::secret_key unused;
+                crypto::generate_keys(out_key, unused);
+                if (rct) {
+                    out_pk.mask = rct::pkGen();
+                    ecdh.amount = rct::skGen();
+                }
+            }
+            tx.vout.push_back({rct ? 0 : amount, cryptonote::txout_to_key{out_key}});
+            tx.output_unlock_times.push_back(0);
+            if (rct) {
+                out_pk.dest = rct::pk2rct(out_key);
+                tx.rct_signatures.outPk.push_back(out_pk);
+                tx.rct_signatures.ecdhInfo.push_back(ecdh);
+            }
+            global_indices.push_back(next_global_index++);
+            stats.outputs++;
+        }
+    }
+
+    const options& opts;
+    std::mt19937_64 rng;
+    crypto::public_key view_pub;
+    std::vector<crypto::public_key> subaddress_spend_keys;
+    uint64_t next_global_index = 0;
+};
+
+struct sync_results {
+    std::chrono::nanoseconds scan{};     // finding received outputs (and spends)
+    std::chrono::nanoseconds storage{};  // writing the wallet's database or cache file
+};
+
+sync_results sync_wallet2(
+        const options& opts,
+        const cryptonote::account_base& account,
+        const std::vector<generated_block>& chain,
+        const fs::path& dir) {
+    tools::wallet2 w{cryptonote::network_type::TESTNET, 1, true};
+    w.generate(""s, ""s, account.get_keys().m_spend_secret_key, true, false, false);
+    w.expand_subaddresses({0, opts.subaddresses - 1});
+
+    // What pull_and_parse_next_blocks would have made of the daemon's responses, indexed by
+    // height.  All that matters about the genesis block is that its hash is the wallet's.
+    std::vector<cryptonote::block_complete_entry> entries(1 + chain.size());
+    std::vector<tools::wallet2::parsed_block> parsed(1 + chain.size());
+    parsed[0].hash = wallet_accessor_test::genesis_hash(w);
+    parsed[0].error = false;
+    for (size_t i = 0; i < chain.size(); i++) {
+        const auto& gb = chain[i];
+        auto& p = parsed[1 + i];
+        auto& e = entries[1 + i];
+        p.hash = gb.hash;
+        p.block = gb.block;
+        p.error = false;
+        auto& indices = p.o_indices["indices"];
+        indices.push_back(nlohmann::json{{"indices", gb.miner_global_indices}});
+        e.block = cryptonote::block_to_blob(gb.block);
+        for (const auto& gtx : gb.txs) {
+            p.txes.push_back(gtx.tx);
+            indices.push_back(nlohmann::json{{"indices", gtx.global_indices}});
+            e.txs.push_back(cryptonote::tx_to_blob(gtx.tx));
+        }
+    }
+
+    sync_results r;
+    auto start = steady::now();
+    for (size_t i = 0; i < chain.size(); i += opts.batch) {
+        // As with a daemon's response, each batch starts with the wallet's current top block
+        size_t end = std::min(i + opts.batch, chain.size()) + 1;
+        std::vector<cryptonote::block_complete_entry> batch_entries{
+                entries.begin() + i, entries.begin() + end};
+        std::vector<tools::wallet2::parsed_block> batch_parsed{
+                parsed.begin() + i, parsed.begin() + end};
+        uint64_t added;
+        wallet_accessor_test::process_parsed_blocks(w, i, batch_entries, batch_parsed, added);
+    }
+    r.scan = steady::now() - start;
+
+    start = steady::now();
+    w.store_to(dir / "wallet2", ""s);
+    r.storage = steady::now() - start;
+    return r;
+}
+
+// Stands in for the daemon: the benchmark hands the wallet its blocks directly.
+class null_daemon_comms : public wallet::DaemonComms {
+  public:
+    void set_remote(std::string_view) override {}
+    void propogate_config() override {}
+    int64_t get_height() override { return 0; }
+    void register_wallet(wallet::Wallet&, int64_t, bool, bool) override {}
+    void deregister_wallet(wallet::Wallet&, std::promise<void>& p) override { p.set_value(); }
+    std::pair<int64_t, int64_t> get_fee_parameters() override { return {0, 0}; }
+    std::future<std::vector<wallet::Decoy>> fetch_decoys(const std::vector<int64_t>&, bool)
+            override {
+        return {};
+    }
+    std::future<std::string> submit_transaction(const cryptonote::transaction&, bool) override {
+        return {};
+    }
+    std::future<std::pair<std::string, crypto::hash>> ons_names_to_owners(
+            const std::string&, uint16_t) override {
+        return {};
+    }
+};
+
+// Does what Wallet::add_blocks does, timing the scan and the database writes separately
+class bench_wallet : public wallet::Wallet {
+  public:
+    template <typename... T>
+    static std::shared_ptr<bench_wallet> create(T&&... args) {
+        std::shared_ptr<bench_wallet> w{new bench_wallet(std::forward<T>(args)...)};
+        w->init();
+        return w;
+    }
+
+    void add_blocks_timed(std::span<const wallet::Block> batch, sync_results& r) {
+        auto start = steady::now();
+        auto received = tx_scanner.scan_received(batch);
+        auto stored = steady::now();
+        r.scan += stored - start;
+
+        auto db_tx = db->db_transaction();
+        for (size_t i = 0; i < batch.size(); i++)
+            store_block(batch[i], received[i]);
+        db_tx.commit();
+        last_scan_height += batch.size();
+        // store_block also runs the spend scan against the database; count it all as storage
+        r.storage += steady::now() - stored;
+    }
+
+  private:
+    using wallet::Wallet::Wallet;
+};
+
+sync_results sync_wallet3(
+        const options& opts,
+        const cryptonote::account_base& account,
+        const std::vector<generated_block>& chain,
+        const fs::path& dir) {
+    const auto& keys = account.get_keys();
+    auto keyring = std::make_shared<wallet::Keyring>(
+            keys.m_spend_secret_key,
+            keys.m_account_address.m_spend_public_key,
+            keys.m_view_secret_key,
+            keys.m_account_address.m_view_public_key);
+
+    wallet::Config config;
+    config.general.datadir = dir.string();
+    config.general.append_network_type_to_datadir = false;
+    config.general.subaddress_lookahead_major = 1;
+    config.general.subaddress_lookahead_minor = opts.subaddresses;
+    config.logging.level = "warning";
+
+    auto w = bench_wallet::create(
+            nullptr,
+            keyring,
+            nullptr,
+            std::make_shared<null_daemon_comms>(),
+            "wallet3.sqlite",
+            "",
+            config);
+
+    // What DefaultDaemonComms would have made of the daemon's response
+    std::vector<wallet::Block> blocks(chain.size());
+    for (size_t i = 0; i < chain.size(); i++) {
+        const auto& gb = chain[i];
+        auto& b = blocks[i];
+        b.height = 1 + i;
+        b.hash = gb.hash;
+        b.timestamp = gb.block.timestamp;
+        auto& miner = b.transactions.emplace_back();
+        miner.hash = cryptonote::get_transaction_hash(*gb.block.miner_tx);
+        miner.tx = *gb.block.miner_tx;
+        miner.global_indices = {gb.miner_global_indices.begin(), gb.miner_global_indices.end()};
+        for (const auto& gtx : gb.txs) {
+            auto& t = b.transactions.emplace_back();
+            t.hash = gtx.hash;
+            t.tx = gtx.tx;
+            t.global_indices = {gtx.global_indices.begin(), gtx.global_indices.end()};
+        }
+    }
+
+    sync_results r;
+    std::span<const wallet::Block> all{blocks};
+    for (size_t i = 0; i < all.size(); i += opts.batch)
+        w->add_blocks_timed(all.subspan(i, std::min(opts.batch, all.size() - i)), r);
+    w->deregister();
+    return r;
+}
+
+uint64_t peak_rss_bytes() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    options opts;
+    po::options_description desc{"Options"};
+    // clang-format off
+    desc.add_options()
+        ("help", "Show this help")
+        ("wallet", po::value<std::string>()->default_value("wallet3"),
+            "Which wallet to sync: wallet2 or wallet3 (run each in its own process so that peak "
+            "memory is comparable)")
+        ("blocks", po::value(&opts.blocks)->default_value(opts.blocks), "Blocks to sync")
+        ("txs-per-block", po::value(&opts.txs_per_block)->default_value(opts.txs_per_block),
+            "Non-coinbase transactions per block")
+        ("outputs-per-tx", po::value(&opts.outputs_per_tx)->default_value(opts.outputs_per_tx),
+            "Outputs per transaction")
+        ("owned-fraction", po::value(&opts.owned_fraction)->default_value(opts.owned_fraction),
+            "Fraction of transaction outputs paid to the wallet")
+        ("subaddresses", po::value(&opts.subaddresses)->default_value(opts.subaddresses),
+            "Subaddresses the wallet has, and owned outputs are spread across")
+        ("batch", po::value(&opts.batch)->default_value(opts.batch),
+            "Blocks given to the wallet at a time")
+        ("seed", po::value(&opts.seed)->default_value(opts.seed), "Chain generation seed")
+        ("data-dir", po::value<std::string>()->default_value("wallet-sync-tests"),
+            "Directory for the wallet files; must not already contain a wallet")
+        ("json", po::value<std::string>(), "Also write the results to this file as JSON");
+    // clang-format on
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n\n" << desc << "\n";
+        return 1;
+    }
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+    auto which = vm["wallet"].as<std::string>();
+    if (which != "wallet2" && which != "wallet3") {
+        std::cerr << "--wallet must be wallet2 or wallet3\n";
+        return 1;
+    }
+    if (!opts.blocks || !opts.batch || !opts.subaddresses || opts.owned_fraction < 0 ||
+        opts.owned_fraction > 1) {
+        std::cerr << "Invalid options\n";
+        return 1;
+    }
+    oxen::logging::init("", "warning");
+
+    cryptonote::account_base account;
+    account.generate();
+
+    fmt::print("Generating {} blocks...\n", opts.blocks);
+    chain_stats stats;
+    auto chain = chain_generator{opts, account.get_keys()}.generate(stats);
+
+    fs::path dir = tools::utf8_path(vm["data-dir"].as<std::string>());
+    fs::create_directories(dir);
+
+    fmt::print("Syncing {}...\n", which);
+    auto start = steady::now();
+    auto r = which == "wallet2" ? sync_wallet2(opts, account, chain, dir)
+                                : sync_wallet3(opts, account, chain, dir);
+    auto elapsed = std::chrono::duration<double>{steady::now() - start}.count();
+    auto secs = [](std::chrono::nanoseconds d) { return std::chrono::duration<double>{d}.count(); };
+
+    nlohmann::json result{
+            {"wallet", which},
+            {"blocks", opts.blocks},
+            {"txs", stats.txs},
+            {"outputs", stats.outputs},
+            {"owned_outputs", stats.owned},
+            {"subaddresses", opts.subaddresses},
+            {"seconds", elapsed},
+            {"blocks_per_second", opts.blocks / elapsed},
+            {"outputs_per_second", stats.outputs / elapsed},
+            {"scan_seconds", secs(r.scan)},
+            {"storage_seconds", secs(r.storage)},
+            {"peak_rss_bytes", peak_rss_bytes()}};
+
+    fmt::print(
+            "{}: {} blocks, {} outputs ({} owned) in {:.3f}s: {:.1f} blocks/s, {:.0f} outputs/s\n"
+            "  scan {:.3f}s, storage {:.3f}s, peak RSS {:.1f} MiB\n",
+            which,
+            opts.blocks,
+            stats.outputs,
+            stats.owned,
+            elapsed,
+            opts.blocks / elapsed,
+            stats.outputs / elapsed,
+            secs(r.scan),
+            secs(r.storage),
+            peak_rss_bytes() / 1048576.0);
+
+    if (vm.count("json")) {
+        std::ofstream out{vm["json"].as<std::string>()};
+        out << result.dump(2) << '\n';
+        if (!out) {
+            std::cerr << "Failed to write " << vm["json"].as<std::string>() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}